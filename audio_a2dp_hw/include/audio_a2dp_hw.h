@@ -27,8 +27,11 @@
 #ifndef AUDIO_A2DP_HW_H
 #define AUDIO_A2DP_HW_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include <atomic>
+
 #include <hardware/bt_av.h>
 
 /*****************************************************************************
@@ -73,8 +76,39 @@
 // results in unnecessary latency and CPU overhead for Bluetooth.
 #define AUDIO_STREAM_OUTPUT_BUFFER_PERIODS 2
 
+// AUDIO_STREAM_OUTPUT_PERIOD_MS is the shortest time period of the output
+// buffer in the normal latency mode: the period is the smallest multiple of
+// the encoder interval that is at least this long, so that each AudioFlinger
+// write feeds whole encoder ticks. In the low latency mode the period is one
+// encoder interval. It is also the period used if the encoder interval is not
+// known.
+#define AUDIO_STREAM_OUTPUT_PERIOD_MS 20
+
 #define AUDIO_SKT_DISCONNECTED (-1)
 
+// The PCM ring is an optional shared memory ring buffer that replaces the
+// audio data socket for Source streams: the HAL writes the PCM data into it
+// and the stack reads the data from it, without any system call. The ring is
+// requested by the HAL with |A2DP_CTRL_CMD_SHM_OPEN| and its file descriptor
+// is passed over the control channel. The audio data socket stays connected
+// to track the lifetime of the stream.
+//
+// Sink streams use a ring in the other direction, requested with
+// |A2DP_CTRL_CMD_SHM_OPEN_INPUT|: the stack writes the decoded PCM data into
+// it instead of its audio track, and the HAL input stream reads it.
+#define A2DP_PCM_RING_MAGIC 0x52504441 /* "ADPR" */
+#define A2DP_PCM_RING_MAX_SIZE (1024 * 1024)
+
+// |A2DP_CTRL_GET_LATENCY| is acknowledged with three |tA2DP_LATENCY_US|
+// delays added after the audio data path, in microseconds: the encoder, the
+// transmit queue, and the sink as reported with AVDTP Delay Reporting (0 if
+// not reported).
+
+// |A2DP_CTRL_GET_OUTPUT_AUDIO_CONFIG| is acknowledged with the current codec
+// config and capability, the index of the current codec, then its
+// |tA2DP_ENCODER_INTERVAL_MS| encoder interval (0 if not known) and the
+// |tA2DP_LATENCY_MODE| of the encoder.
+
 typedef enum {
   A2DP_CTRL_CMD_NONE,
   A2DP_CTRL_CMD_CHECK_READY,
@@ -85,6 +119,9 @@ typedef enum {
   A2DP_CTRL_GET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG,
   A2DP_CTRL_CMD_OFFLOAD_START,
+  A2DP_CTRL_CMD_SHM_OPEN,
+  A2DP_CTRL_GET_LATENCY,
+  A2DP_CTRL_CMD_SHM_OPEN_INPUT,
 } tA2DP_CTRL_CMD;
 
 typedef enum {
@@ -97,6 +134,40 @@ typedef enum {
 typedef uint32_t tA2DP_SAMPLE_RATE;
 typedef uint8_t tA2DP_CHANNEL_COUNT;
 typedef uint8_t tA2DP_BITS_PER_SAMPLE;
+typedef uint32_t tA2DP_LATENCY_US;
+typedef uint32_t tA2DP_ENCODER_INTERVAL_MS;
+typedef uint8_t tA2DP_LATENCY_MODE;
+
+#define A2DP_LATENCY_MODE_NORMAL 0
+#define A2DP_LATENCY_MODE_LOW 1
+
+// The header at the beginning of the PCM ring shared memory, followed by
+// |size| octets of data. |write_pos| and |read_pos| are free-running
+// counters owned by the writer and the reader respectively.
+//
+// Each write also stamps the ring with the |write_pos| it reached and the
+// CLOCK_MONOTONIC time it was made, under the sequence counter |stamp_seq|,
+// odd while the writer is updating them.
+typedef struct {
+  uint32_t magic;
+  uint32_t size;  // Power of two
+  std::atomic<uint32_t> write_pos;
+  std::atomic<uint32_t> read_pos;
+  std::atomic<uint32_t> stamp_seq;
+  std::atomic<uint32_t> stamp_pos;
+  std::atomic<int64_t> stamp_time_ns;
+} tA2DP_PCM_RING_HDR;
+
+// A process-local mapping of the PCM ring. |size| is a private copy of the
+// shared |hdr->size|, so the peer cannot make the accesses overflow |data|.
+typedef struct {
+  int fd;
+  void* map;
+  size_t map_size;
+  tA2DP_PCM_RING_HDR* hdr;
+  uint8_t* data;
+  uint32_t size;
+} tA2DP_PCM_RING;
 
 /*****************************************************************************
  *  Type definitions for callback functions
@@ -119,6 +190,7 @@ typedef uint8_t tA2DP_BITS_PER_SAMPLE;
 // |codec_bits_per_sample| is the number of bits per sample of the output
 // stream.
 // |codec_channel_mode| is the channel mode of the output stream.
+// |time_period_ms| is the time period of the buffer.
 //
 // The buffer size is computed by using the following formula:
 //
@@ -136,16 +208,79 @@ typedef uint8_t tA2DP_BITS_PER_SAMPLE;
 // Furthermore, the AudioFlinger expects the buffer size to be a multiple
 // of 16 frames.
 //
-// NOTE: Currently, the computation uses the conservative 20ms time period.
+// The time period is computed with
+// |audio_a2dp_hw_stream_compute_period_ms|.
 //
 // Returns the computed buffer size. If any of the input parameters is
 // invalid, the return value is the default |AUDIO_STREAM_OUTPUT_BUFFER_SZ|.
 extern size_t audio_a2dp_hw_stream_compute_buffer_size(
     btav_a2dp_codec_sample_rate_t codec_sample_rate,
     btav_a2dp_codec_bits_per_sample_t codec_bits_per_sample,
-    btav_a2dp_codec_channel_mode_t codec_channel_mode);
+    btav_a2dp_codec_channel_mode_t codec_channel_mode,
+    uint64_t time_period_ms);
+
+// Computes the time period of the output buffer for an encoder with the
+// interval |encoder_interval_ms| in the latency mode |latency_mode|. See
+// |AUDIO_STREAM_OUTPUT_PERIOD_MS|.
+extern uint64_t audio_a2dp_hw_stream_compute_period_ms(
+    tA2DP_ENCODER_INTERVAL_MS encoder_interval_ms,
+    tA2DP_LATENCY_MODE latency_mode);
 
 // Returns a string representation of |event|.
 extern const char* audio_a2dp_hw_dump_ctrl_event(tA2DP_CTRL_CMD event);
 
+// Initializes |ring| as not mapped.
+extern void audio_a2dp_hw_pcm_ring_init(tA2DP_PCM_RING* ring);
+
+// Returns true if |ring| is mapped.
+extern bool audio_a2dp_hw_pcm_ring_is_open(const tA2DP_PCM_RING* ring);
+
+// Creates a new, empty PCM ring of at least |size| octets in anonymous
+// shared memory and maps it into |ring|. |size| is rounded up to a power of
+// two and capped to |A2DP_PCM_RING_MAX_SIZE|.
+// Returns true on success, otherwise false.
+extern bool audio_a2dp_hw_pcm_ring_create(tA2DP_PCM_RING* ring, size_t size);
+
+// Maps the PCM ring shared through the file descriptor |fd| into |ring|.
+// The ownership of |fd| is transferred to |ring|, even on failure.
+// Returns true on success, otherwise false.
+extern bool audio_a2dp_hw_pcm_ring_attach(tA2DP_PCM_RING* ring, int fd);
+
+// Unmaps |ring| and closes its file descriptor. This function is idempotent.
+extern void audio_a2dp_hw_pcm_ring_close(tA2DP_PCM_RING* ring);
+
+// Writes up to |len| octets from |buffer| into |ring|, and stamps it if any
+// was written. Must be called only by the writer side.
+// Returns the number of octets that were written.
+extern size_t audio_a2dp_hw_pcm_ring_write(tA2DP_PCM_RING* ring,
+                                           const void* buffer, size_t len);
+
+// Reads up to |len| octets from |ring| into |buffer|. Must be called only
+// by the reader side.
+// Returns the number of octets that were read.
+extern size_t audio_a2dp_hw_pcm_ring_read(tA2DP_PCM_RING* ring, void* buffer,
+                                          size_t len);
+
+// Discards all the data in |ring|, if mapped. Must be called only by the
+// reader side.
+extern void audio_a2dp_hw_pcm_ring_flush(tA2DP_PCM_RING* ring);
+
+// Discards up to |len| of the oldest octets in |ring|. Must be called only
+// by the reader side.
+// Returns the number of octets that were discarded.
+extern size_t audio_a2dp_hw_pcm_ring_skip(tA2DP_PCM_RING* ring, size_t len);
+
+// Gets the stamp of the last write to |ring|: the write position it reached
+// into |p_pos|, and its CLOCK_MONOTONIC time in nanoseconds into
+// |p_time_ns|.
+// Returns true on success, or false if there was no write yet or the writer
+// kept updating the stamp.
+extern bool audio_a2dp_hw_pcm_ring_get_stamp(const tA2DP_PCM_RING* ring,
+                                             uint32_t* p_pos,
+                                             int64_t* p_time_ns);
+
+// Returns the number of octets written to |ring| and not read yet, or 0 if
+// it is not mapped.
+extern size_t audio_a2dp_hw_pcm_ring_get_used(const tA2DP_PCM_RING* ring);
+
 #endif /* A2DP_AUDIO_HW_H */
@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <stdint.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
@@ -46,6 +47,7 @@
 #include "osi/include/hash_map_utils.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "osi/include/socket_utils/sockets.h"
 
 #include "audio_a2dp_hw.h"
@@ -63,6 +65,29 @@
 // sockets
 #define WRITE_POLL_MS 20
 
+// Poll interval while waiting for room in the shared memory PCM ring
+#define PCM_RING_WRITE_POLL_MS 5
+
+// Poll interval while waiting for data in the input PCM ring
+#define PCM_RING_READ_POLL_MS 2
+
+// The PCM queued in the input PCM ring before the capture starts, and kept
+// from growing past twice it, in milliseconds
+#define INPUT_LATENCY_TARGET_PROPERTY "persist.bluetooth.a2dp.sink_latency_ms"
+#define DEFAULT_INPUT_LATENCY_TARGET_MS 40
+
+// The input PCM ring holds this many times the latency target
+#define INPUT_PCM_RING_LATENCY_TARGETS 4
+
+// Set to false to always send the PCM data over the audio data socket
+#define PCM_RING_PROPERTY "persist.bluetooth.a2dp.pcm_shm"
+
+// Interval between two queries of the stack latency while streaming
+#define STACK_LATENCY_POLL_US (250 * 1000)
+
+// The sink delay assumed if the sink doesn't report it
+#define DEFAULT_SINK_DELAY_US (200 * 1000)
+
 #define FNLOG() LOG_VERBOSE(LOG_TAG, "%s", __func__);
 #define DEBUG(fmt, ...) \
   LOG_VERBOSE(LOG_TAG, "%s: " fmt, __func__, ##__VA_ARGS__)
@@ -115,10 +140,17 @@ struct a2dp_stream_common {
   int ctrl_fd;
   int audio_fd;
   size_t buffer_sz;
+  tA2DP_PCM_RING pcm_ring;  // Used instead of |audio_fd| for PCM if open
   struct a2dp_config cfg;
   a2dp_state_t state;
 //Chris Add      
   btav_a2dp_codec_index_t codec_index;
+  tA2DP_LATENCY_US encoder_delay_us;   // Encoder lookahead
+  tA2DP_LATENCY_US tx_queue_delay_us;  // Waiting in the stack transmit queue
+  tA2DP_LATENCY_US sink_delay_us;      // Reported by the sink, 0 if none
+  uint64_t stack_latency_update_us;    // When the delays above were read
+  tA2DP_ENCODER_INTERVAL_MS encoder_interval_ms;  // 0 if not known
+  tA2DP_LATENCY_MODE latency_mode;
 };
 
 struct a2dp_stream_out {
@@ -131,6 +163,11 @@ struct a2dp_stream_out {
 struct a2dp_stream_in {
   struct audio_stream_in stream;
   struct a2dp_stream_common common;
+  uint32_t latency_target_ms;  // See |INPUT_LATENCY_TARGET_PROPERTY|
+  bool pcm_ring_primed;        // The latency target was queued
+  uint32_t pcm_ring_read_pos;  // Octets read or skipped from the ring
+  int64_t frames_read;         // Returned by in_read since the stream opened
+  uint32_t frames_lost;        // Skipped since the last query
 };
 
 /*
@@ -333,6 +370,17 @@ static int skt_disconnect(int fd) {
   return 0;
 }
 
+static bool skt_is_hung_up(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = 0;
+  pfd.revents = 0;
+
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, 0));
+  return (ret < 0) || (pfd.revents & (POLLHUP | POLLERR | POLLNVAL));
+}
+
 /*****************************************************************************
  *
  *  AUDIO CONTROL PATH
@@ -454,6 +502,69 @@ static int a2dp_command(struct a2dp_stream_common* common, tA2DP_CTRL_CMD cmd) {
   return 0;
 }
 
+// Opens the shared memory PCM ring of |ring_size| octets for stream |common|
+// with |cmd|, |A2DP_CTRL_CMD_SHM_OPEN| for an output stream or
+// |A2DP_CTRL_CMD_SHM_OPEN_INPUT| for an input one. The ring replaces the
+// audio data socket for the PCM data, the socket stays connected so that
+// both sides detect when the other one goes away.
+// On success, returns 0, otherwise -1 and the socket is used.
+static int a2dp_open_pcm_ring(struct a2dp_stream_common* common,
+                              tA2DP_CTRL_CMD cmd, uint32_t ring_size) {
+  if (a2dp_command(common, cmd) < 0) {
+    INFO("PCM ring not supported, using the audio data socket");
+    return -1;
+  }
+  if (a2dp_ctrl_send(common, &ring_size, sizeof(ring_size)) < 0) return -1;
+
+  // The status octet carries the ring file descriptor on success
+  uint8_t status = A2DP_CTRL_ACK_FAILURE;
+  char cmsg_buf[CMSG_SPACE(sizeof(int))];
+  struct iovec iov;
+  iov.iov_base = &status;
+  iov.iov_len = sizeof(status);
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsg_buf;
+  msg.msg_controllen = sizeof(cmsg_buf);
+
+  ssize_t ret;
+  int i;
+  for (i = 0;; i++) {
+    OSI_NO_INTR(ret = recvmsg(common->ctrl_fd, &msg, MSG_NOSIGNAL));
+    if (ret > 0) break;
+    if (ret == 0 || (errno != EWOULDBLOCK && errno != EAGAIN) ||
+        i == (CTRL_CHAN_RETRY_COUNT - 1)) {
+      ERROR("receive PCM ring failed");
+      skt_disconnect(common->ctrl_fd);
+      common->ctrl_fd = AUDIO_SKT_DISCONNECTED;
+      return -1;
+    }
+  }
+
+  int fd = -1;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  if (status != A2DP_CTRL_ACK_SUCCESS || fd < 0) {
+    WARN("PCM ring not available (status %d), using the audio data socket",
+         status);
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+
+  if (!audio_a2dp_hw_pcm_ring_attach(&common->pcm_ring, fd)) {
+    ERROR("cannot map PCM ring, using the audio data socket");
+    return -1;
+  }
+  INFO("PCM ring of %u bytes", common->pcm_ring.size);
+  return 0;
+}
+
 static int check_a2dp_ready(struct a2dp_stream_common* common) {
   if (a2dp_command(common, A2DP_CTRL_CMD_CHECK_READY) < 0) {
     ERROR("check a2dp ready failed");
@@ -462,6 +573,39 @@ static int check_a2dp_ready(struct a2dp_stream_common* common) {
   return 0;
 }
 
+static uint64_t monotonic_time_us(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+// Reads the delays added by the stack and the sink after the audio data
+// path. The previous values are kept if the stack doesn't report them.
+static int a2dp_read_stack_latency(struct a2dp_stream_common* common) {
+  tA2DP_LATENCY_US encoder_delay_us;
+  tA2DP_LATENCY_US tx_queue_delay_us;
+  tA2DP_LATENCY_US sink_delay_us;
+
+  common->stack_latency_update_us = monotonic_time_us();
+  if (a2dp_command(common, A2DP_CTRL_GET_LATENCY) < 0) return -1;
+  if (a2dp_ctrl_receive(common, &encoder_delay_us,
+                        sizeof(tA2DP_LATENCY_US)) < 0 ||
+      a2dp_ctrl_receive(common, &tx_queue_delay_us,
+                        sizeof(tA2DP_LATENCY_US)) < 0 ||
+      a2dp_ctrl_receive(common, &sink_delay_us, sizeof(tA2DP_LATENCY_US)) <
+          0)
+    return -1;
+
+  DEBUG("encoder %" PRIu32 " us, tx queue %" PRIu32 " us, sink %" PRIu32
+        " us",
+        encoder_delay_us, tx_queue_delay_us, sink_delay_us);
+  common->encoder_delay_us = encoder_delay_us;
+  common->tx_queue_delay_us = tx_queue_delay_us;
+  common->sink_delay_us = sink_delay_us;
+  return 0;
+}
+
 static int a2dp_read_input_audio_config(struct a2dp_stream_common* common) {
   tA2DP_SAMPLE_RATE sample_rate;
   tA2DP_CHANNEL_COUNT channel_count;
@@ -551,6 +695,14 @@ static int a2dp_read_output_audio_config(
                         sizeof(btav_a2dp_codec_index_t)) < 0) {
     return -1;
   }
+  if (a2dp_ctrl_receive(common, &common->encoder_interval_ms,
+                        sizeof(tA2DP_ENCODER_INTERVAL_MS)) < 0) {
+    return -1;
+  }
+  if (a2dp_ctrl_receive(common, &common->latency_mode,
+                        sizeof(tA2DP_LATENCY_MODE)) < 0) {
+    return -1;
+  }
 
   // Check the codec config sample rate
   switch (codec_config->sample_rate) {
@@ -584,6 +736,8 @@ static int a2dp_read_output_audio_config(
       stream_config.format = AUDIO_FORMAT_PCM_16_BIT;
       break;
     case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24:
+      // Carried packed in 3 octets per sample up to the encoder, a quarter
+      // less than in a 32-bit container
       stream_config.format = AUDIO_FORMAT_PCM_24_BIT_PACKED;
       break;
     case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32:
@@ -616,18 +770,45 @@ static int a2dp_read_output_audio_config(
     common->cfg.format = stream_config.format;
     common->buffer_sz = audio_a2dp_hw_stream_compute_buffer_size(
         codec_config->sample_rate, codec_config->bits_per_sample,
-        codec_config->channel_mode);
+        codec_config->channel_mode,
+        audio_a2dp_hw_stream_compute_period_ms(common->encoder_interval_ms,
+                                               common->latency_mode));
   }
 
   INFO(
       "got output codec capability: sample_rate=0x%x bits_per_sample=0x%x "
-      "channel_mode=0x%x",
+      "channel_mode=0x%x encoder_interval_ms=%u latency_mode=%d",
       codec_capability->sample_rate, codec_capability->bits_per_sample,
-      codec_capability->channel_mode);
+      codec_capability->channel_mode, common->encoder_interval_ms,
+      common->latency_mode);
 
   return 0;
 }
 
+// Resizes the output buffer for the current encoder, which may have changed
+// since the output stream was opened. Only the socket buffer follows: the
+// AudioFlinger period is fixed while the stream is open.
+static void a2dp_update_output_buffer_size(struct a2dp_stream_common* common) {
+  btav_a2dp_codec_config_t codec_config;
+  btav_a2dp_codec_config_t codec_capability;
+
+  if (a2dp_read_output_audio_config(common, &codec_config, &codec_capability,
+                                    false /* update_stream_config */) < 0) {
+    ERROR("a2dp_read_output_audio_config failed");
+    return;
+  }
+
+  size_t buffer_sz = audio_a2dp_hw_stream_compute_buffer_size(
+      codec_config.sample_rate, codec_config.bits_per_sample,
+      codec_config.channel_mode,
+      audio_a2dp_hw_stream_compute_period_ms(common->encoder_interval_ms,
+                                             common->latency_mode));
+  if (buffer_sz == common->buffer_sz) return;
+
+  INFO("buffer size %zu -> %zu", common->buffer_sz, buffer_sz);
+  common->buffer_sz = buffer_sz;
+}
+
 static int a2dp_write_output_audio_config(struct a2dp_stream_common* common) {
   btav_a2dp_codec_config_t codec_config;
 
@@ -757,15 +938,32 @@ static void a2dp_stream_common_init(struct a2dp_stream_common* common) {
 
   /* manages max capacity of socket pipe */
   common->buffer_sz = AUDIO_STREAM_OUTPUT_BUFFER_SZ;
+
+  common->encoder_delay_us = 0;
+  common->tx_queue_delay_us = 0;
+  common->sink_delay_us = 0;
+  common->stack_latency_update_us = 0;
+  common->encoder_interval_ms = 0;
+  common->latency_mode = A2DP_LATENCY_MODE_NORMAL;
+
+  audio_a2dp_hw_pcm_ring_init(&common->pcm_ring);
 }
 
 static void a2dp_stream_common_destroy(struct a2dp_stream_common* common) {
   FNLOG();
 
+  audio_a2dp_hw_pcm_ring_close(&common->pcm_ring);
+
   delete common->mutex;
   common->mutex = NULL;
 }
 
+static void close_audio_datapath(struct a2dp_stream_common* common) {
+  skt_disconnect(common->audio_fd);
+  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  audio_a2dp_hw_pcm_ring_close(&common->pcm_ring);
+}
+
 static int start_audio_datapath(struct a2dp_stream_common* common) {
   INFO("state %d", common->state);
 
@@ -790,6 +988,7 @@ static int start_audio_datapath(struct a2dp_stream_common* common) {
     }
   }
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STARTED;
+  a2dp_read_stack_latency(common);
   return 0;
 
 error:
@@ -815,8 +1014,7 @@ static int stop_audio_datapath(struct a2dp_stream_common* common) {
   common->state = (a2dp_state_t)AUDIO_A2DP_STATE_STOPPED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  close_audio_datapath(common);
 
   return 0;
 }
@@ -835,13 +1033,139 @@ static int suspend_audio_datapath(struct a2dp_stream_common* common,
     common->state = AUDIO_A2DP_STATE_SUSPENDED;
 
   /* disconnect audio path */
-  skt_disconnect(common->audio_fd);
-
-  common->audio_fd = AUDIO_SKT_DISCONNECTED;
+  close_audio_datapath(common);
 
   return 0;
 }
 
+// Writes |len| octets from |p| into the PCM ring of stream |common|, waiting
+// for the stack to make room if needed. Called with |lock| held, which is
+// released while waiting.
+// On success, returns the number of octets written, otherwise -1.
+static int pcm_ring_write(struct a2dp_stream_common* common,
+                          std::unique_lock<std::recursive_mutex>& lock,
+                          const void* p, size_t len) {
+  ts_log("pcm_ring_write", len, NULL);
+
+  int ms_timeout = SOCK_SEND_TIMEOUT_MS;
+  size_t count = 0;
+  while (count < len) {
+    if (!audio_a2dp_hw_pcm_ring_is_open(&common->pcm_ring)) {
+      WARN("PCM ring closed, wrote %zu bytes", count);
+      return -1;
+    }
+    size_t written =
+        audio_a2dp_hw_pcm_ring_write(&common->pcm_ring, p, len - count);
+    if (written > 0) {
+      count += written;
+      p = (const uint8_t*)p + written;
+      continue;
+    }
+    if (skt_is_hung_up(common->audio_fd)) {
+      ERROR("audio data socket hung up, wrote %zu bytes", count);
+      return -1;
+    }
+    if (ms_timeout >= PCM_RING_WRITE_POLL_MS) {
+      lock.unlock();
+      usleep(PCM_RING_WRITE_POLL_MS * 1000);
+      lock.lock();
+      ms_timeout -= PCM_RING_WRITE_POLL_MS;
+      continue;
+    }
+    WARN("write timeout exceeded, wrote %zu bytes", count);
+    return -1;
+  }
+  return (int)count;
+}
+
+// Returns the octets of PCM of the latency target of input stream |in|.
+static size_t in_latency_target_bytes(const struct a2dp_stream_in* in) {
+  return (size_t)in->common.cfg.rate * in->latency_target_ms / 1000 *
+         audio_stream_in_frame_size(&in->stream);
+}
+
+// Opens the input PCM ring of stream |in|, sized for its latency target.
+static void in_open_pcm_ring(struct a2dp_stream_in* in) {
+  size_t ring_size =
+      in_latency_target_bytes(in) * INPUT_PCM_RING_LATENCY_TARGETS;
+  if (a2dp_open_pcm_ring(&in->common, A2DP_CTRL_CMD_SHM_OPEN_INPUT,
+                         ring_size) < 0)
+    return;
+
+  in->pcm_ring_primed = false;
+  in->pcm_ring_read_pos = 0;
+}
+
+// Reads |len| octets from the input PCM ring of stream |in| into |p|,
+// waiting for the stack to write them for up to their duration plus the
+// latency target. The reading starts once the latency target is queued,
+// and the oldest octets are skipped when more than twice it is, so that
+// the capture latency stays close to the target. The octets missing after
+// the wait are zeros. Called with |lock| held, which is released while
+// waiting.
+// On success, returns |len|, otherwise -1.
+static int pcm_ring_read(struct a2dp_stream_in* in,
+                         std::unique_lock<std::recursive_mutex>& lock,
+                         void* p, size_t len) {
+  struct a2dp_stream_common* common = &in->common;
+  const size_t frame_size = audio_stream_in_frame_size(&in->stream);
+  const size_t target = in_latency_target_bytes(in);
+  int ms_timeout =
+      calc_audiotime_usec(common->cfg, len) / 1000 + in->latency_target_ms;
+  size_t count = 0;
+
+  ts_log("pcm_ring_read", len, NULL);
+
+  while (count < len) {
+    if (!audio_a2dp_hw_pcm_ring_is_open(&common->pcm_ring)) {
+      WARN("PCM ring closed, read %zu bytes", count);
+      return -1;
+    }
+
+    size_t used = audio_a2dp_hw_pcm_ring_get_used(&common->pcm_ring);
+    if (!in->pcm_ring_primed && used >= target) in->pcm_ring_primed = true;
+    if (in->pcm_ring_primed) {
+      if (used > 2 * target + len) {
+        size_t excess = (used - target) / frame_size * frame_size;
+        size_t skipped =
+            audio_a2dp_hw_pcm_ring_skip(&common->pcm_ring, excess);
+        in->pcm_ring_read_pos += skipped;
+        in->frames_lost += skipped / frame_size;
+      }
+
+      size_t n = audio_a2dp_hw_pcm_ring_read(&common->pcm_ring, p,
+                                             len - count);
+      if (n > 0) {
+        in->pcm_ring_read_pos += n;
+        count += n;
+        p = (uint8_t*)p + n;
+        continue;
+      }
+    }
+
+    if (skt_is_hung_up(common->audio_fd)) {
+      ERROR("audio data socket hung up, read %zu bytes", count);
+      return -1;
+    }
+    if (ms_timeout >= PCM_RING_READ_POLL_MS) {
+      lock.unlock();
+      usleep(PCM_RING_READ_POLL_MS * 1000);
+      lock.lock();
+      ms_timeout -= PCM_RING_READ_POLL_MS;
+      continue;
+    }
+
+    // Underrun: queue the latency target again before reading on
+    DEBUG("read timeout, %zu of %zu bytes", count, len);
+    memset(p, 0, len - count);
+    in->pcm_ring_primed = false;
+    break;
+  }
+
+  in->frames_read += len / frame_size;
+  return (int)len;
+}
+
 /*****************************************************************************
  *
  *  audio output callbacks
@@ -865,21 +1189,36 @@ static ssize_t out_write(struct audio_stream_out* stream, const void* buffer,
   /* only allow autostarting if we are in stopped or standby */
   if ((out->common.state == AUDIO_A2DP_STATE_STOPPED) ||
       (out->common.state == AUDIO_A2DP_STATE_STANDBY)) {
+    if (out->common.audio_fd == AUDIO_SKT_DISCONNECTED)
+      a2dp_update_output_buffer_size(&out->common);
     if (start_audio_datapath(&out->common) < 0) {
       goto finish;
     }
+    char pcm_ring_enabled[PROPERTY_VALUE_MAX] = {0};
+    osi_property_get(PCM_RING_PROPERTY, pcm_ring_enabled, "true");
+    if (!audio_a2dp_hw_pcm_ring_is_open(&out->common.pcm_ring) &&
+        !strncmp(pcm_ring_enabled, "true", 4)) {
+      a2dp_open_pcm_ring(&out->common, A2DP_CTRL_CMD_SHM_OPEN,
+                         out->common.buffer_sz);
+    }
   } else if (out->common.state != AUDIO_A2DP_STATE_STARTED) {
     ERROR("stream not in stopped or standby");
     goto finish;
+  } else if (monotonic_time_us() - out->common.stack_latency_update_us >=
+             STACK_LATENCY_POLL_US) {
+    a2dp_read_stack_latency(&out->common);
   }
 
-  lock.unlock();
-  sent = skt_write(out->common.audio_fd, buffer, bytes);
-  lock.lock();
+  if (audio_a2dp_hw_pcm_ring_is_open(&out->common.pcm_ring)) {
+    sent = pcm_ring_write(&out->common, lock, buffer, bytes);
+  } else {
+    lock.unlock();
+    sent = skt_write(out->common.audio_fd, buffer, bytes);
+    lock.lock();
+  }
 
   if (sent == -1) {
-    skt_disconnect(out->common.audio_fd);
-    out->common.audio_fd = AUDIO_SKT_DISCONNECTED;
+    close_audio_datapath(&out->common);
     if ((out->common.state != AUDIO_A2DP_STATE_SUSPENDED) &&
         (out->common.state != AUDIO_A2DP_STATE_STOPPING)) {
       out->common.state = AUDIO_A2DP_STATE_STOPPED;
@@ -937,9 +1276,9 @@ static size_t out_get_buffer_size(const struct audio_stream* stream) {
 size_t audio_a2dp_hw_stream_compute_buffer_size(
     btav_a2dp_codec_sample_rate_t codec_sample_rate,
     btav_a2dp_codec_bits_per_sample_t codec_bits_per_sample,
-    btav_a2dp_codec_channel_mode_t codec_channel_mode) {
+    btav_a2dp_codec_channel_mode_t codec_channel_mode,
+    uint64_t time_period_ms) {
   size_t buffer_sz = AUDIO_STREAM_OUTPUT_BUFFER_SZ;  // Default value
-  uint64_t time_period_ms = 20;                // Conservative 20ms
   uint32_t sample_rate;
   uint32_t bits_per_sample;
   uint32_t number_of_channels;
@@ -1034,6 +1373,18 @@ size_t audio_a2dp_hw_stream_compute_buffer_size(
   return buffer_sz;
 }
 
+uint64_t audio_a2dp_hw_stream_compute_period_ms(
+    tA2DP_ENCODER_INTERVAL_MS encoder_interval_ms,
+    tA2DP_LATENCY_MODE latency_mode) {
+  if (encoder_interval_ms == 0) return AUDIO_STREAM_OUTPUT_PERIOD_MS;
+  if (latency_mode == A2DP_LATENCY_MODE_LOW) return encoder_interval_ms;
+
+  uint64_t intervals =
+      (AUDIO_STREAM_OUTPUT_PERIOD_MS + encoder_interval_ms - 1) /
+      encoder_interval_ms;
+  return intervals * encoder_interval_ms;
+}
+
 static uint32_t out_get_channels(const struct audio_stream* stream) {
   struct a2dp_stream_out* out = (struct a2dp_stream_out*)stream;
 
@@ -1227,6 +1578,22 @@ done:
   return strdup(result.c_str());
 }
 
+// Returns the delay of the audio after it left the HAL buffer: encoding,
+// queueing in the stack, and playback on the sink.
+static uint64_t out_get_stack_delay_us(const struct a2dp_stream_out* out) {
+  uint64_t delay_us =
+      out->common.encoder_delay_us + out->common.tx_queue_delay_us;
+
+  if (out->common.sink_delay_us != 0) {
+    delay_us += out->common.sink_delay_us;
+  } else if (out->common.codec_index !=
+             BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL) {
+    //Chris Add
+    delay_us += DEFAULT_SINK_DELAY_US;
+  }
+  return delay_us;
+}
+
 static uint32_t out_get_latency(const struct audio_stream_out* stream) {
   int latency_us;
 
@@ -1239,11 +1606,21 @@ static uint32_t out_get_latency(const struct audio_stream_out* stream) {
        audio_stream_out_frame_size(&out->stream) / out->common.cfg.rate) *
       1000;
 
-//Chris Add
-  if ( out->common.codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL)
-    return (latency_us / 1000);
-  else
-    return (latency_us / 1000) + 200;
+  return (latency_us + out_get_stack_delay_us(out)) / 1000;
+}
+
+// Returns the number of frames written to the HAL and not presented yet.
+// The frames still in the PCM ring, which the stack reads once per encoder
+// interval, are counted exactly; the socket buffer is assumed to be full.
+static uint64_t out_get_pending_frames(const struct a2dp_stream_out* out) {
+  size_t frame_size = audio_stream_out_frame_size(&out->stream);
+  size_t buffered_bytes =
+      audio_a2dp_hw_pcm_ring_is_open(&out->common.pcm_ring)
+          ? audio_a2dp_hw_pcm_ring_get_used(&out->common.pcm_ring)
+          : out->common.buffer_sz;
+
+  return buffered_bytes / frame_size +
+         out_get_stack_delay_us(out) * out->common.cfg.rate / USEC_PER_SEC;
 }
 
 static int out_set_volume(UNUSED_ATTR struct audio_stream_out* stream,
@@ -1265,8 +1642,7 @@ static int out_get_presentation_position(const struct audio_stream_out* stream,
 
   int ret = -EWOULDBLOCK;
   std::lock_guard<std::recursive_mutex> lock(*out->common.mutex);
-  uint64_t latency_frames =
-      (uint64_t)out_get_latency(stream) * out->common.cfg.rate / 1000;
+  uint64_t latency_frames = out_get_pending_frames(out);
   if (out->frames_presented >= latency_frames) {
     *frames = out->frames_presented - latency_frames;
     clock_gettime(CLOCK_MONOTONIC,
@@ -1284,8 +1660,7 @@ static int out_get_render_position(const struct audio_stream_out* stream,
   if (stream == NULL || dsp_frames == NULL) return -EINVAL;
 
   std::lock_guard<std::recursive_mutex> lock(*out->common.mutex);
-  uint64_t latency_frames =
-      (uint64_t)out_get_latency(stream) * out->common.cfg.rate / 1000;
+  uint64_t latency_frames = out_get_pending_frames(out);
   if (out->frames_rendered >= latency_frames) {
     *dsp_frames = (uint32_t)(out->frames_rendered - latency_frames);
   } else {
@@ -1407,14 +1782,24 @@ static ssize_t in_read(struct audio_stream_in* stream, void* buffer,
     if (start_audio_datapath(&in->common) < 0) {
       goto error;
     }
+    char pcm_ring_enabled[PROPERTY_VALUE_MAX] = {0};
+    osi_property_get(PCM_RING_PROPERTY, pcm_ring_enabled, "true");
+    if (!audio_a2dp_hw_pcm_ring_is_open(&in->common.pcm_ring) &&
+        !strncmp(pcm_ring_enabled, "true", 4)) {
+      in_open_pcm_ring(in);
+    }
   } else if (in->common.state != AUDIO_A2DP_STATE_STARTED) {
     ERROR("stream not in stopped or standby");
     goto error;
   }
 
-  lock.unlock();
-  read = skt_read(in->common.audio_fd, buffer, bytes);
-  lock.lock();
+  if (audio_a2dp_hw_pcm_ring_is_open(&in->common.pcm_ring)) {
+    read = pcm_ring_read(in, lock, buffer, bytes);
+  } else {
+    lock.unlock();
+    read = skt_read(in->common.audio_fd, buffer, bytes);
+    lock.lock();
+  }
   if (read == -1) {
     skt_disconnect(in->common.audio_fd);
     in->common.audio_fd = AUDIO_SKT_DISCONNECTED;
@@ -1444,9 +1829,37 @@ error:
   return bytes;
 }
 
-static uint32_t in_get_input_frames_lost(
-    UNUSED_ATTR struct audio_stream_in* stream) {
+static uint32_t in_get_input_frames_lost(struct audio_stream_in* stream) {
+  struct a2dp_stream_in* in = (struct a2dp_stream_in*)stream;
+
+  FNLOG();
+  std::lock_guard<std::recursive_mutex> lock(*in->common.mutex);
+  uint32_t frames_lost = in->frames_lost;
+  in->frames_lost = 0;
+  return frames_lost;
+}
+
+// The capture position is the frame at the stamp of the last write of the
+// stack to the input PCM ring, counted from the frames read before it.
+static int in_get_capture_position(const struct audio_stream_in* stream,
+                                   int64_t* frames, int64_t* time) {
+  struct a2dp_stream_in* in = (struct a2dp_stream_in*)stream;
+
   FNLOG();
+  if (frames == NULL || time == NULL) return -EINVAL;
+
+  std::lock_guard<std::recursive_mutex> lock(*in->common.mutex);
+  uint32_t stamp_pos;
+  int64_t stamp_time_ns;
+  if (!audio_a2dp_hw_pcm_ring_get_stamp(&in->common.pcm_ring, &stamp_pos,
+                                        &stamp_time_ns))
+    return -ENOSYS;
+
+  // Negative if the octets of the stamp were already read or skipped
+  int32_t queued = (int32_t)(stamp_pos - in->pcm_ring_read_pos);
+  *frames = in->frames_read +
+            queued / (int32_t)audio_stream_in_frame_size(&in->stream);
+  *time = stamp_time_ns;
   return 0;
 }
 
@@ -1711,6 +2124,14 @@ static int adev_open_input_stream(struct audio_hw_device* dev,
   in->stream.set_gain = in_set_gain;
   in->stream.read = in_read;
   in->stream.get_input_frames_lost = in_get_input_frames_lost;
+  in->stream.get_capture_position = in_get_capture_position;
+  {
+    int32_t latency_target_ms = osi_property_get_int32(
+        INPUT_LATENCY_TARGET_PROPERTY, DEFAULT_INPUT_LATENCY_TARGET_MS);
+    in->latency_target_ms = (latency_target_ms > 0)
+                                ? latency_target_ms
+                                : DEFAULT_INPUT_LATENCY_TARGET_MS;
+  }
 
   /* initialize a2dp specifics */
   a2dp_stream_common_init(&in->common);
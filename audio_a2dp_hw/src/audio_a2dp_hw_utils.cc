@@ -18,6 +18,15 @@
 
 #include "audio_a2dp_hw.h"
 
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <new>
+
 #define CASE_RETURN_STR(const) \
   case const:                  \
     return #const;
@@ -33,9 +42,204 @@ const char* audio_a2dp_hw_dump_ctrl_event(tA2DP_CTRL_CMD event) {
     CASE_RETURN_STR(A2DP_CTRL_GET_OUTPUT_AUDIO_CONFIG)
     CASE_RETURN_STR(A2DP_CTRL_SET_OUTPUT_AUDIO_CONFIG)
     CASE_RETURN_STR(A2DP_CTRL_CMD_OFFLOAD_START)
+    CASE_RETURN_STR(A2DP_CTRL_CMD_SHM_OPEN)
+    CASE_RETURN_STR(A2DP_CTRL_GET_LATENCY)
+    CASE_RETURN_STR(A2DP_CTRL_CMD_SHM_OPEN_INPUT)
     default:
       break;
   }
 
   return "UNKNOWN A2DP_CTRL_CMD";
 }
+
+void audio_a2dp_hw_pcm_ring_init(tA2DP_PCM_RING* ring) {
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+bool audio_a2dp_hw_pcm_ring_is_open(const tA2DP_PCM_RING* ring) {
+  return ring->hdr != NULL;
+}
+
+static bool pcm_ring_map(tA2DP_PCM_RING* ring, size_t map_size) {
+  void* map =
+      mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+  if (map == MAP_FAILED) return false;
+
+  ring->map = map;
+  ring->map_size = map_size;
+  ring->hdr = static_cast<tA2DP_PCM_RING_HDR*>(map);
+  ring->data = static_cast<uint8_t*>(map) + sizeof(tA2DP_PCM_RING_HDR);
+  return true;
+}
+
+bool audio_a2dp_hw_pcm_ring_create(tA2DP_PCM_RING* ring, size_t size) {
+#if defined(__NR_memfd_create)
+  size_t ring_size = 1;
+  while (ring_size < size && ring_size < A2DP_PCM_RING_MAX_SIZE)
+    ring_size <<= 1;
+  size_t map_size = sizeof(tA2DP_PCM_RING_HDR) + ring_size;
+
+  audio_a2dp_hw_pcm_ring_init(ring);
+  ring->fd = syscall(__NR_memfd_create, "a2dp_pcm_ring", 0);
+  if (ring->fd < 0) return false;
+  if (ftruncate(ring->fd, map_size) < 0 || !pcm_ring_map(ring, map_size)) {
+    audio_a2dp_hw_pcm_ring_close(ring);
+    return false;
+  }
+
+  tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  new (&hdr->write_pos) std::atomic<uint32_t>(0);
+  new (&hdr->read_pos) std::atomic<uint32_t>(0);
+  new (&hdr->stamp_seq) std::atomic<uint32_t>(0);
+  new (&hdr->stamp_pos) std::atomic<uint32_t>(0);
+  new (&hdr->stamp_time_ns) std::atomic<int64_t>(0);
+  hdr->size = ring_size;
+  hdr->magic = A2DP_PCM_RING_MAGIC;
+  ring->size = ring_size;
+  return true;
+#else
+  audio_a2dp_hw_pcm_ring_init(ring);
+  (void)size;
+  return false;
+#endif
+}
+
+bool audio_a2dp_hw_pcm_ring_attach(tA2DP_PCM_RING* ring, int fd) {
+  struct stat st;
+
+  audio_a2dp_hw_pcm_ring_init(ring);
+  ring->fd = fd;
+  if (fd < 0 || fstat(fd, &st) < 0 ||
+      st.st_size < (off_t)sizeof(tA2DP_PCM_RING_HDR) ||
+      !pcm_ring_map(ring, st.st_size)) {
+    audio_a2dp_hw_pcm_ring_close(ring);
+    return false;
+  }
+
+  // Sanity check the header against the mapping
+  uint32_t size = ring->hdr->size;
+  if (ring->hdr->magic != A2DP_PCM_RING_MAGIC || size == 0 ||
+      (size & (size - 1)) != 0 ||
+      sizeof(tA2DP_PCM_RING_HDR) + size > ring->map_size) {
+    audio_a2dp_hw_pcm_ring_close(ring);
+    return false;
+  }
+  ring->size = size;
+  return true;
+}
+
+void audio_a2dp_hw_pcm_ring_close(tA2DP_PCM_RING* ring) {
+  if (ring->map != NULL) munmap(ring->map, ring->map_size);
+  if (ring->fd >= 0) close(ring->fd);
+  audio_a2dp_hw_pcm_ring_init(ring);
+}
+
+size_t audio_a2dp_hw_pcm_ring_write(tA2DP_PCM_RING* ring, const void* buffer,
+                                    size_t len) {
+  tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  uint32_t size = ring->size;
+  uint32_t write_pos = hdr->write_pos.load(std::memory_order_relaxed);
+  uint32_t read_pos = hdr->read_pos.load(std::memory_order_acquire);
+  uint32_t used = write_pos - read_pos;
+  if (used > size) return 0;  // Corrupted by the reader
+
+  size_t n = size - used;
+  if (n > len) n = len;
+  uint32_t offset = write_pos & (size - 1);
+  size_t first = size - offset;
+  if (first > n) first = n;
+  memcpy(ring->data + offset, buffer, first);
+  memcpy(ring->data, static_cast<const uint8_t*>(buffer) + first, n - first);
+  hdr->write_pos.store(write_pos + n, std::memory_order_release);
+  if (n == 0) return 0;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint32_t seq = hdr->stamp_seq.load(std::memory_order_relaxed);
+  hdr->stamp_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  hdr->stamp_pos.store(write_pos + n, std::memory_order_relaxed);
+  hdr->stamp_time_ns.store(now.tv_sec * 1000000000LL + now.tv_nsec,
+                           std::memory_order_relaxed);
+  hdr->stamp_seq.store(seq + 2, std::memory_order_release);
+  return n;
+}
+
+size_t audio_a2dp_hw_pcm_ring_read(tA2DP_PCM_RING* ring, void* buffer,
+                                   size_t len) {
+  tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  uint32_t size = ring->size;
+  uint32_t read_pos = hdr->read_pos.load(std::memory_order_relaxed);
+  uint32_t write_pos = hdr->write_pos.load(std::memory_order_acquire);
+  uint32_t used = write_pos - read_pos;
+  if (used > size) {
+    // Corrupted by the writer: drop everything
+    hdr->read_pos.store(write_pos, std::memory_order_release);
+    return 0;
+  }
+
+  size_t n = used;
+  if (n > len) n = len;
+  uint32_t offset = read_pos & (size - 1);
+  size_t first = size - offset;
+  if (first > n) first = n;
+  memcpy(buffer, ring->data + offset, first);
+  memcpy(static_cast<uint8_t*>(buffer) + first, ring->data, n - first);
+  hdr->read_pos.store(read_pos + n, std::memory_order_release);
+  return n;
+}
+
+void audio_a2dp_hw_pcm_ring_flush(tA2DP_PCM_RING* ring) {
+  tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  if (hdr == NULL) return;
+  hdr->read_pos.store(hdr->write_pos.load(std::memory_order_acquire),
+                      std::memory_order_release);
+}
+
+size_t audio_a2dp_hw_pcm_ring_skip(tA2DP_PCM_RING* ring, size_t len) {
+  tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  uint32_t read_pos = hdr->read_pos.load(std::memory_order_relaxed);
+  uint32_t write_pos = hdr->write_pos.load(std::memory_order_acquire);
+  uint32_t used = write_pos - read_pos;
+  if (used > ring->size) {
+    // Corrupted by the writer: drop everything
+    hdr->read_pos.store(write_pos, std::memory_order_release);
+    return 0;
+  }
+
+  size_t n = used;
+  if (n > len) n = len;
+  hdr->read_pos.store(read_pos + n, std::memory_order_release);
+  return n;
+}
+
+bool audio_a2dp_hw_pcm_ring_get_stamp(const tA2DP_PCM_RING* ring,
+                                      uint32_t* p_pos, int64_t* p_time_ns) {
+  const tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  if (hdr == NULL) return false;
+
+  // The writer stamps the ring once per write, a few retries are enough
+  for (int i = 0; i < 4; i++) {
+    uint32_t seq = hdr->stamp_seq.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+    uint32_t pos = hdr->stamp_pos.load(std::memory_order_relaxed);
+    int64_t time_ns = hdr->stamp_time_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (hdr->stamp_seq.load(std::memory_order_relaxed) != seq) continue;
+    if (seq == 0) return false;
+
+    *p_pos = pos;
+    *p_time_ns = time_ns;
+    return true;
+  }
+  return false;
+}
+
+size_t audio_a2dp_hw_pcm_ring_get_used(const tA2DP_PCM_RING* ring) {
+  const tA2DP_PCM_RING_HDR* hdr = ring->hdr;
+  if (hdr == NULL) return 0;
+  uint32_t used = hdr->write_pos.load(std::memory_order_acquire) -
+                  hdr->read_pos.load(std::memory_order_acquire);
+  return (used > ring->size) ? ring->size : used;
+}
@@ -18,6 +18,10 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 
 namespace {
@@ -97,8 +101,10 @@ TEST_F(AudioA2dpHwTest, test_compute_buffer_size) {
   for (const auto codec_sample_rate : codec_sample_rate_array) {
     for (const auto codec_bits_per_sample : codec_bits_per_sample_array) {
       for (const auto codec_channel_mode : codec_channel_mode_array) {
+        const uint64_t time_period_ms = 20;
         size_t buffer_size = audio_a2dp_hw_stream_compute_buffer_size(
-            codec_sample_rate, codec_bits_per_sample, codec_channel_mode);
+            codec_sample_rate, codec_bits_per_sample, codec_channel_mode,
+            time_period_ms);
 
         // Check for invalid input
         if ((codec_sample_rate == BTAV_A2DP_CODEC_SAMPLE_RATE_NONE) ||
@@ -120,7 +126,6 @@ TEST_F(AudioA2dpHwTest, test_compute_buffer_size) {
             codec_channel_mode2value(codec_channel_mode);
         EXPECT_TRUE(number_of_channels != 0);
 
-        const uint64_t time_period_ms = 20;  // TODO: Must be a parameter
         size_t expected_buffer_size =
             (time_period_ms * AUDIO_STREAM_OUTPUT_BUFFER_PERIODS * sample_rate *
              number_of_channels * (bits_per_sample / 8)) /
@@ -140,3 +145,163 @@ TEST_F(AudioA2dpHwTest, test_compute_buffer_size) {
     }
   }
 }
+
+TEST_F(AudioA2dpHwTest, test_compute_buffer_size_packed_24) {
+  // 24-bit audio is carried packed: 96 kHz stereo over 20 ms periods
+  size_t buffer_size_24 = audio_a2dp_hw_stream_compute_buffer_size(
+      BTAV_A2DP_CODEC_SAMPLE_RATE_96000, BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24,
+      BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 20);
+  size_t buffer_size_32 = audio_a2dp_hw_stream_compute_buffer_size(
+      BTAV_A2DP_CODEC_SAMPLE_RATE_96000, BTAV_A2DP_CODEC_BITS_PER_SAMPLE_32,
+      BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 20);
+  EXPECT_EQ(23040U, buffer_size_24);  // 2 periods of 1920 frames of 6 octets
+  EXPECT_EQ(buffer_size_32 * 3 / 4, buffer_size_24);
+}
+
+TEST_F(AudioA2dpHwTest, test_compute_buffer_size_period) {
+  // The buffer follows the time period: LHDC LL, 11 ms at 48 kHz 16 bits
+  size_t buffer_size = audio_a2dp_hw_stream_compute_buffer_size(
+      BTAV_A2DP_CODEC_SAMPLE_RATE_48000, BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+      BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 11);
+  EXPECT_EQ(4224U, buffer_size);  // 2 periods of 528 frames of 4 octets
+
+  EXPECT_LT(buffer_size,
+            audio_a2dp_hw_stream_compute_buffer_size(
+                BTAV_A2DP_CODEC_SAMPLE_RATE_48000,
+                BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16,
+                BTAV_A2DP_CODEC_CHANNEL_MODE_STEREO, 20));
+}
+
+TEST_F(AudioA2dpHwTest, test_compute_period_ms) {
+  const tA2DP_LATENCY_MODE kNormal = A2DP_LATENCY_MODE_NORMAL;
+  const tA2DP_LATENCY_MODE kLow = A2DP_LATENCY_MODE_LOW;
+
+  // Unknown encoder interval
+  EXPECT_EQ(static_cast<uint64_t>(AUDIO_STREAM_OUTPUT_PERIOD_MS),
+            audio_a2dp_hw_stream_compute_period_ms(0, kLow));
+  EXPECT_EQ(static_cast<uint64_t>(AUDIO_STREAM_OUTPUT_PERIOD_MS),
+            audio_a2dp_hw_stream_compute_period_ms(0, kNormal));
+
+  // Whole encoder intervals, at least AUDIO_STREAM_OUTPUT_PERIOD_MS long
+  EXPECT_EQ(20U, audio_a2dp_hw_stream_compute_period_ms(20, kNormal));
+  EXPECT_EQ(22U, audio_a2dp_hw_stream_compute_period_ms(11, kNormal));
+  EXPECT_EQ(20U, audio_a2dp_hw_stream_compute_period_ms(10, kNormal));
+  EXPECT_EQ(30U, audio_a2dp_hw_stream_compute_period_ms(15, kNormal));
+  EXPECT_EQ(40U, audio_a2dp_hw_stream_compute_period_ms(40, kNormal));
+
+  // A single encoder interval in the low latency mode
+  EXPECT_EQ(11U, audio_a2dp_hw_stream_compute_period_ms(11, kLow));
+  EXPECT_EQ(20U, audio_a2dp_hw_stream_compute_period_ms(20, kLow));
+}
+
+TEST_F(AudioA2dpHwTest, test_pcm_ring_write_read) {
+  tA2DP_PCM_RING writer;
+  tA2DP_PCM_RING reader;
+
+  if (!audio_a2dp_hw_pcm_ring_create(&writer, 1000)) {
+    // Shared memory is not available on this platform
+    return;
+  }
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_is_open(&writer));
+  EXPECT_EQ(1024U, writer.size);
+
+  // The reader side maps the same memory through a duplicate descriptor
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_attach(&reader, dup(writer.fd)));
+
+  uint8_t in[700];
+  uint8_t out[700];
+  for (size_t i = 0; i < sizeof(in); i++) in[i] = i & 0xff;
+
+  // Wrap around the end of the ring a few times
+  for (int round = 0; round < 4; round++) {
+    EXPECT_EQ(sizeof(in), audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+    EXPECT_EQ(sizeof(in), audio_a2dp_hw_pcm_ring_get_used(&writer));
+    // Only the free space is written
+    EXPECT_EQ(1024U - sizeof(in),
+              audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+    EXPECT_EQ(1024U, audio_a2dp_hw_pcm_ring_get_used(&reader));
+    EXPECT_EQ(sizeof(out), audio_a2dp_hw_pcm_ring_read(&reader, out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+    EXPECT_EQ(1024U - sizeof(out), audio_a2dp_hw_pcm_ring_get_used(&writer));
+    audio_a2dp_hw_pcm_ring_flush(&reader);
+    EXPECT_EQ(0U, audio_a2dp_hw_pcm_ring_get_used(&writer));
+    EXPECT_EQ(0U, audio_a2dp_hw_pcm_ring_read(&reader, out, sizeof(out)));
+  }
+
+  audio_a2dp_hw_pcm_ring_close(&reader);
+  audio_a2dp_hw_pcm_ring_close(&writer);
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_is_open(&writer));
+  // Closing twice is fine
+  audio_a2dp_hw_pcm_ring_close(&writer);
+}
+
+TEST_F(AudioA2dpHwTest, test_pcm_ring_skip_and_stamp) {
+  tA2DP_PCM_RING writer;
+  tA2DP_PCM_RING reader;
+
+  if (!audio_a2dp_hw_pcm_ring_create(&writer, 1024)) {
+    // Shared memory is not available on this platform
+    return;
+  }
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_attach(&reader, dup(writer.fd)));
+
+  uint32_t pos;
+  int64_t time_ns;
+  // No stamp before the first write
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_get_stamp(&reader, &pos, &time_ns));
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t before_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+
+  uint8_t in[300];
+  for (size_t i = 0; i < sizeof(in); i++) in[i] = i & 0xff;
+  EXPECT_EQ(sizeof(in), audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+  EXPECT_EQ(sizeof(in), audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_get_stamp(&reader, &pos, &time_ns));
+  EXPECT_EQ(2 * sizeof(in), pos);
+  EXPECT_GE(time_ns, before_ns);
+
+  // The oldest octets are skipped, never more than are queued
+  EXPECT_EQ(sizeof(in) + 10, audio_a2dp_hw_pcm_ring_skip(&reader, 310));
+  uint8_t out[sizeof(in)];
+  EXPECT_EQ(sizeof(in) - 10,
+            audio_a2dp_hw_pcm_ring_read(&reader, out, sizeof(out)));
+  EXPECT_EQ(0, memcmp(in + 10, out, sizeof(in) - 10));
+  EXPECT_EQ(0U, audio_a2dp_hw_pcm_ring_skip(&reader, 10));
+
+  // A write with no room does not stamp the ring
+  int64_t last_ns = time_ns;
+  EXPECT_EQ(1024U - 300U,
+            audio_a2dp_hw_pcm_ring_write(&writer, in, 1024 - 300));
+  EXPECT_EQ(300U, audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_get_stamp(&reader, &pos, &time_ns));
+  EXPECT_EQ(2 * sizeof(in) + 1024U, pos);
+  EXPECT_EQ(0U, audio_a2dp_hw_pcm_ring_write(&writer, in, sizeof(in)));
+  uint32_t last_pos = pos;
+  ASSERT_TRUE(audio_a2dp_hw_pcm_ring_get_stamp(&reader, &pos, &time_ns));
+  EXPECT_EQ(last_pos, pos);
+  EXPECT_GE(time_ns, last_ns);
+
+  audio_a2dp_hw_pcm_ring_close(&reader);
+  audio_a2dp_hw_pcm_ring_close(&writer);
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_get_stamp(&writer, &pos, &time_ns));
+}
+
+TEST_F(AudioA2dpHwTest, test_pcm_ring_attach_invalid) {
+  tA2DP_PCM_RING ring;
+
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_attach(&ring, -1));
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_is_open(&ring));
+  EXPECT_EQ(0U, audio_a2dp_hw_pcm_ring_get_used(&ring));
+  // Flushing a ring that is not mapped is a no-op
+  audio_a2dp_hw_pcm_ring_flush(&ring);
+
+  // A file that does not contain a ring header is rejected
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  close(fds[1]);
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_attach(&ring, fds[0]));
+  EXPECT_FALSE(audio_a2dp_hw_pcm_ring_is_open(&ring));
+}
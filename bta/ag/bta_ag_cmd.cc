@@ -1174,15 +1174,28 @@ void bta_ag_at_hfp_cback(tBTA_AG_SCB* p_scb, uint16_t cmd, uint8_t arg_type,
       /* store available codecs from the peer */
       if ((p_scb->peer_features & BTA_AG_PEER_FEAT_CODEC) &&
           (p_scb->features & BTA_AG_FEAT_CODEC)) {
-        p_scb->peer_codecs = bta_ag_parse_bac(p_scb, p_arg);
-        p_scb->codec_updated = true;
-
-        if (p_scb->peer_codecs & BTA_AG_CODEC_MSBC) {
-          p_scb->sco_codec = UUID_CODEC_MSBC;
-          APPL_TRACE_DEBUG("Received AT+BAC, updating sco codec to MSBC");
+        tBTA_AG_PEER_CODEC peer_codecs = bta_ag_parse_bac(p_scb, p_arg);
+        bool in_codec_nego = (bta_ag_cb.sco.state == BTA_AG_SCO_CODEC_ST) &&
+                             (bta_ag_cb.sco.p_curr_scb == p_scb);
+
+        /* the codec negotiated already holds while the peer lists the same
+         * codecs */
+        if (p_scb->svc_conn && !in_codec_nego &&
+            peer_codecs == p_scb->peer_codecs) {
+          APPL_TRACE_DEBUG("Received AT+BAC, same codecs, keeping sco codec");
         } else {
-          p_scb->sco_codec = UUID_CODEC_CVSD;
-          APPL_TRACE_DEBUG("Received AT+BAC, updating sco codec to CVSD");
+          p_scb->peer_codecs = peer_codecs;
+          p_scb->codec_updated = true;
+
+          if (p_scb->peer_codecs & BTA_AG_CODEC_MSBC) {
+            p_scb->sco_codec = UUID_CODEC_MSBC;
+            APPL_TRACE_DEBUG("Received AT+BAC, updating sco codec to MSBC");
+          } else {
+            p_scb->sco_codec = UUID_CODEC_CVSD;
+            APPL_TRACE_DEBUG("Received AT+BAC, updating sco codec to CVSD");
+          }
+          /* start with the settings the last calls to the peer worked with */
+          bta_ag_sco_cache_restore(p_scb);
         }
         /* The above logic sets the stack preferred codec based on local and
         peer codec
@@ -1192,8 +1205,7 @@ void bta_ag_at_hfp_cback(tBTA_AG_SCB* p_scb, uint16_t cmd, uint8_t arg_type,
         application. */
         val.num = p_scb->peer_codecs;
         /* Received BAC while in codec negotiation. */
-        if ((bta_ag_cb.sco.state == BTA_AG_SCO_CODEC_ST) &&
-            (bta_ag_cb.sco.p_curr_scb == p_scb)) {
+        if (in_codec_nego) {
           bta_ag_codec_negotiate(p_scb);
         }
       } else {
@@ -263,6 +263,9 @@ typedef struct {
   bool codec_fallback; /* If sco nego fails for mSBC, fallback to CVSD */
   tBTA_AG_SCO_MSBC_SETTINGS
       codec_msbc_settings; /* settings to be used for the impending eSCO */
+  bool codec_msbc_retry;   /* mSBC T2 failed, retry with T1 settings */
+  uint8_t sco_attempts;    /* eSCO set ups tried for the impending audio */
+  period_ms_t sco_setup_ms; /* when the impending audio was first set up */
 
   tBTA_AG_HF_IND
       peer_hf_indicators[BTA_AG_MAX_NUM_PEER_HF_IND]; /* Peer supported
@@ -381,6 +384,7 @@ extern void bta_ag_sco_open(tBTA_AG_SCB* p_scb, tBTA_AG_DATA* p_data);
 extern void bta_ag_sco_close(tBTA_AG_SCB* p_scb, tBTA_AG_DATA* p_data);
 extern void bta_ag_sco_codec_nego(tBTA_AG_SCB* p_scb, bool result);
 extern void bta_ag_codec_negotiate(tBTA_AG_SCB* p_scb);
+extern void bta_ag_sco_cache_restore(tBTA_AG_SCB* p_scb);
 extern void bta_ag_sco_shutdown(tBTA_AG_SCB* p_scb, tBTA_AG_DATA* p_data);
 extern void bta_ag_sco_conn_open(tBTA_AG_SCB* p_scb, tBTA_AG_DATA* p_data);
 extern void bta_ag_sco_conn_close(tBTA_AG_SCB* p_scb, tBTA_AG_DATA* p_data);
@@ -261,6 +261,8 @@ static tBTA_AG_SCB* bta_ag_scb_alloc(void) {
       p_scb->sco_idx = BTM_INVALID_SCO_INDEX;
       p_scb->codec_updated = false;
       p_scb->codec_fallback = false;
+      p_scb->codec_msbc_retry = false;
+      p_scb->sco_attempts = 0;
       p_scb->peer_codecs = BTA_AG_CODEC_CVSD;
       p_scb->sco_codec = BTA_AG_CODEC_CVSD;
       /* set up timers */
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include <stddef.h>
+#include <string.h>
 
 #include "bt_common.h"
 #include "bta_ag_api.h"
@@ -36,6 +37,7 @@
 #include "device/include/controller.h"
 #include "device/include/esco_parameters.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "utl.h"
 
 #ifndef BTA_AG_SCO_DEBUG
@@ -73,6 +75,7 @@ enum {
 };
 
 static void bta_ag_create_pending_sco(tBTA_AG_SCB* p_scb, bool is_local);
+static void bta_ag_sco_cache_put(tBTA_AG_SCB* p_scb, period_ms_t setup_ms);
 
 /*******************************************************************************
  *
@@ -180,6 +183,7 @@ static void bta_ag_sco_disc_cback(uint16_t sco_idx) {
               __func__);
           bta_ag_cb.sco.p_curr_scb->codec_msbc_settings =
               BTA_AG_SCO_MSBC_SETTINGS_T1;
+          bta_ag_cb.sco.p_curr_scb->codec_msbc_retry = true;
         } else {
           APPL_TRACE_WARNING(
               "%s: eSCO/SCO failed to open, falling back to CVSD", __func__);
@@ -382,6 +386,7 @@ static void bta_ag_create_sco(tBTA_AG_SCB* p_scb, bool is_orig) {
     /* Reset mSBC settings to T2 for the next audio connection */
     p_scb->codec_msbc_settings = BTA_AG_SCO_MSBC_SETTINGS_T2;
   }
+  p_scb->codec_msbc_retry = false;
 
   esco_codec_t codec_index = ESCO_CODEC_CVSD;
   /* If WBS included, use CVSD by default, index is 0 for CVSD by
@@ -495,6 +500,9 @@ static void bta_ag_create_pending_sco(tBTA_AG_SCB* p_scb, bool is_local) {
                       TRUE);
 #endif
 
+    if (p_scb->sco_attempts++ == 0)
+      p_scb->sco_setup_ms = time_get_os_boottime_ms();
+
     tBTM_STATUS status = BTM_CreateSco(
         p_scb->peer_addr, true, params.packet_types, &p_scb->sco_idx,
         bta_ag_sco_conn_cback, bta_ag_sco_disc_cback);
@@ -515,6 +523,117 @@ static void bta_ag_create_pending_sco(tBTA_AG_SCB* p_scb, bool is_local) {
   }
 }
 
+#if (BTA_AG_SCO_CACHE_SIZE > 0)
+typedef struct {
+  bool in_use;
+  BD_ADDR peer_addr;
+  tBTA_AG_PEER_CODEC peer_codecs; /* codecs the peer had listed */
+  bool msbc_failed;               /* mSBC fell back to CVSD */
+  period_ms_t msbc_failed_ms;     /* when mSBC last fell back */
+  tBTA_AG_SCO_MSBC_SETTINGS msbc_settings; /* mSBC settings that worked */
+  uint32_t num_setups;   /* audio connections set up */
+  uint32_t num_attempts; /* eSCO set ups tried for them */
+  period_ms_t total_setup_ms;
+  period_ms_t updated_ms;
+} tBTA_AG_SCO_CACHE_ENT;
+
+static tBTA_AG_SCO_CACHE_ENT bta_ag_sco_cache[BTA_AG_SCO_CACHE_SIZE];
+#endif
+
+/*******************************************************************************
+ *
+ * Function         bta_ag_sco_cache_put
+ *
+ * Description      Remembers the codec settings the audio connection to the
+ *                  peer was just set up with, and the time it took, replacing
+ *                  the device updated the longest ago if the cache is full.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_ag_sco_cache_put(UNUSED_ATTR tBTA_AG_SCB* p_scb,
+                                 UNUSED_ATTR period_ms_t setup_ms) {
+#if (BTA_AG_SCO_CACHE_SIZE > 0)
+  tBTA_AG_SCO_CACHE_ENT* p_ent = &bta_ag_sco_cache[0];
+
+  for (int i = 0; i < BTA_AG_SCO_CACHE_SIZE; i++) {
+    tBTA_AG_SCO_CACHE_ENT* p = &bta_ag_sco_cache[i];
+    if (p->in_use && !bdcmp(p->peer_addr, p_scb->peer_addr)) {
+      p_ent = p;
+      break;
+    }
+    if (!p->in_use) {
+      if (p_ent->in_use) p_ent = p;
+    } else if (p_ent->in_use && p->updated_ms < p_ent->updated_ms) {
+      p_ent = p;
+    }
+  }
+
+  if (!p_ent->in_use || bdcmp(p_ent->peer_addr, p_scb->peer_addr)) {
+    memset(p_ent, 0, sizeof(*p_ent));
+    p_ent->in_use = true;
+    bdcpy(p_ent->peer_addr, p_scb->peer_addr);
+  }
+  p_ent->peer_codecs = p_scb->peer_codecs;
+  if (p_scb->inuse_codec == BTA_AG_CODEC_MSBC) {
+    p_ent->msbc_failed = false;
+    p_ent->msbc_settings = p_scb->codec_msbc_settings;
+  } else if (p_scb->sco_codec == BTA_AG_CODEC_MSBC) {
+    /* the CVSD fallback leaves the negotiated codec to mSBC */
+    p_ent->msbc_failed = true;
+    p_ent->msbc_failed_ms = time_get_os_boottime_ms();
+  }
+  p_ent->num_setups++;
+  p_ent->num_attempts += p_scb->sco_attempts;
+  p_ent->total_setup_ms += setup_ms;
+  p_ent->updated_ms = time_get_os_boottime_ms();
+
+  APPL_TRACE_DEBUG("%s: %d setups, %d attempts, %u ms on average", __func__,
+                   p_ent->num_setups, p_ent->num_attempts,
+                   (uint32_t)(p_ent->total_setup_ms / p_ent->num_setups));
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_ag_sco_cache_restore
+ *
+ * Description      Sets up the next audio connection to the peer to start
+ *                  with the codec settings the last one worked with, if the
+ *                  peer still lists the same codecs.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_ag_sco_cache_restore(tBTA_AG_SCB* p_scb) {
+  p_scb->codec_msbc_settings = BTA_AG_SCO_MSBC_SETTINGS_T2;
+#if (BTA_AG_SCO_CACHE_SIZE > 0)
+  for (int i = 0; i < BTA_AG_SCO_CACHE_SIZE; i++) {
+    tBTA_AG_SCO_CACHE_ENT* p_ent = &bta_ag_sco_cache[i];
+    if (!p_ent->in_use || bdcmp(p_ent->peer_addr, p_scb->peer_addr)) continue;
+
+    if (p_ent->peer_codecs != p_scb->peer_codecs) {
+      p_ent->in_use = false;
+      return;
+    }
+
+    /* mSBC is tried again a while after it failed */
+    if (p_ent->msbc_failed &&
+        time_get_os_boottime_ms() - p_ent->msbc_failed_ms >=
+            BTA_AG_SCO_FALLBACK_TIMEOUT_MS)
+      p_ent->msbc_failed = false;
+
+    p_scb->codec_msbc_settings = p_ent->msbc_settings;
+    if (p_ent->msbc_failed && p_scb->sco_codec == BTA_AG_CODEC_MSBC) {
+      APPL_TRACE_DEBUG("%s: mSBC failed last time, using CVSD", __func__);
+      p_scb->sco_codec = BTA_AG_CODEC_CVSD;
+      p_scb->codec_updated = true;
+    }
+    return;
+  }
+#endif
+}
+
 /*******************************************************************************
  *
  * Function         bta_ag_codec_negotiation_timer_cback
@@ -530,6 +649,7 @@ static void bta_ag_codec_negotiation_timer_cback(void* data) {
   tBTA_AG_SCB* p_scb = (tBTA_AG_SCB*)data;
 
   /* Announce that codec negotiation failed. */
+  p_scb->sco_attempts = 0;
   bta_ag_sco_codec_nego(p_scb, false);
 
   /* call app callback */
@@ -1259,8 +1379,16 @@ void bta_ag_sco_conn_open(tBTA_AG_SCB* p_scb,
   /* call app callback */
   bta_ag_cback_sco(p_scb, BTA_AG_AUDIO_OPEN_EVT);
 
-  /* reset to mSBC T2 settings as the preferred */
-  p_scb->codec_msbc_settings = BTA_AG_SCO_MSBC_SETTINGS_T2;
+  /* the next calls start with the settings that worked, the audio set up by
+   * the peer is left out as it is always CVSD */
+  if (p_scb->sco_attempts != 0) {
+    period_ms_t setup_ms = time_get_os_boottime_ms() - p_scb->sco_setup_ms;
+    APPL_TRACE_EVENT("%s: audio up in %u ms after %d attempts", __func__,
+                     (uint32_t)setup_ms, p_scb->sco_attempts);
+    bta_ag_sco_cache_put(p_scb, setup_ms);
+    p_scb->sco_attempts = 0;
+  }
+  bta_ag_sco_cache_restore(p_scb);
 }
 
 /*******************************************************************************
@@ -1283,10 +1411,13 @@ void bta_ag_sco_conn_close(tBTA_AG_SCB* p_scb,
    * OR if codec is msbc and T2 settings failed, then retry Safe T1 settings */
   if (p_scb->svc_conn &&
       (p_scb->codec_fallback ||
-       (p_scb->sco_codec == BTM_SCO_CODEC_MSBC &&
-        p_scb->codec_msbc_settings == BTA_AG_SCO_MSBC_SETTINGS_T1))) {
+       (p_scb->sco_codec == BTM_SCO_CODEC_MSBC && p_scb->codec_msbc_retry))) {
+    p_scb->codec_msbc_retry = false;
     bta_ag_sco_event(p_scb, BTA_AG_SCO_REOPEN_E);
   } else {
+    p_scb->codec_msbc_retry = false;
+    p_scb->sco_attempts = 0;
+
     /* Indicate if the closing of audio is because of transfer */
     bta_ag_sco_event(p_scb, BTA_AG_SCO_CONN_CLOSE_E);
 
@@ -1302,7 +1433,7 @@ void bta_ag_sco_conn_close(tBTA_AG_SCB* p_scb,
 
     /* call app callback */
     bta_ag_cback_sco(p_scb, BTA_AG_AUDIO_CLOSE_EVT);
-    p_scb->codec_msbc_settings = BTA_AG_SCO_MSBC_SETTINGS_T2;
+    bta_ag_sco_cache_restore(p_scb);
   }
 }
 
@@ -41,11 +41,6 @@
 /* Number of elements in service class id list. */
 #define BTA_AG_NUM_SVC_ELEMS 2
 
-/* size of database for service discovery */
-#ifndef BTA_AG_DISC_BUF_SIZE
-#define BTA_AG_DISC_BUF_SIZE BT_DEFAULT_BUFFER_SIZE
-#endif
-
 /* declare sdp callback functions */
 void bta_ag_sdp_cback_1(uint16_t status);
 void bta_ag_sdp_cback_2(uint16_t status);
@@ -419,12 +414,12 @@ void bta_ag_do_disc(tBTA_AG_SCB* p_scb, tBTA_SERVICE_MASK service) {
     return;
   }
 
-  /* allocate buffer for sdp database */
-  p_scb->p_disc_db = (tSDP_DISCOVERY_DB*)osi_malloc(BTA_AG_DISC_BUF_SIZE);
-  /* set up service discovery database; attr happens to be attr_list len */
+  /* set up service discovery database, growing with the records found;
+   * attr happens to be attr_list len */
   uuid_list[0].len = LEN_UUID_16;
-  db_inited = SDP_InitDiscoveryDb(p_scb->p_disc_db, BTA_AG_DISC_BUF_SIZE,
-                                  num_uuid, uuid_list, num_attr, attr_list);
+  p_scb->p_disc_db =
+      SDP_AllocDiscoveryDb(num_uuid, uuid_list, num_attr, attr_list);
+  db_inited = (p_scb->p_disc_db != NULL);
 
   if (db_inited) {
     /*Service discovery not initiated */
@@ -452,5 +447,6 @@ void bta_ag_do_disc(tBTA_AG_SCB* p_scb, tBTA_SERVICE_MASK service) {
  *
  ******************************************************************************/
 void bta_ag_free_db(tBTA_AG_SCB* p_scb, UNUSED_ATTR tBTA_AG_DATA* p_data) {
-  osi_free_and_reset((void**)&p_scb->p_disc_db);
+  SDP_FreeDiscoveryDb(p_scb->p_disc_db);
+  p_scb->p_disc_db = NULL;
 }
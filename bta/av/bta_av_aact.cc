@@ -28,6 +28,7 @@
 
 #include <base/logging.h>
 #include <string.h>
+#include <algorithm>
 #include <vector>
 
 #include "avdt_api.h"
@@ -35,6 +36,7 @@
 #include "bta_av_int.h"
 #include "btif/include/btif_av_co.h"
 #include "btif/include/btif_storage.h"
+#include "btm_api.h"
 #include "device/include/interop.h"
 #include "l2c_api.h"
 #include "l2cdefs.h"
@@ -67,8 +69,32 @@
 #define BTA_AV_RECONFIG_RETRY 6
 #endif
 
-/* ACL quota we are letting FW use for A2DP Offload Tx. */
-#define BTA_AV_A2DP_OFFLOAD_XMIT_QUOTA 4
+/* the format of the stream endpoints stored for a bonded peer, see
+ * bta_av_store_peer_caps */
+#define BTA_AV_PEER_CAPS_VERSION 1
+#define BTA_AV_PEER_CAPS_HDR_LEN 2
+#define BTA_AV_SEP_INFO_LEN 4
+#define BTA_AV_SEP_CAPS_LEN (4 + AVDT_CODEC_SIZE + AVDT_CP_INFO_LEN)
+#define BTA_AV_PEER_CAPS_MAX_LEN \
+  (BTA_AV_PEER_CAPS_HDR_LEN +    \
+   BTA_AV_NUM_SEPS * (BTA_AV_SEP_INFO_LEN + BTA_AV_SEP_CAPS_LEN))
+
+/* The device supports the A2DP offload, unless the user disabled it */
+#define BTA_AV_OFFLOAD_SUPPORTED_PROPERTY "ro.bluetooth.a2dp_offload.supported"
+#define BTA_AV_OFFLOAD_DISABLED_PROPERTY \
+  "persist.bluetooth.a2dp_offload.disabled"
+
+/* Length of the parameters of the A2DP offload start command */
+#define BTA_AV_OFFLOAD_START_PARAM_LEN \
+  (1 + 4 + 2 + 2 + 4 + 1 + 1 + 4 + 2 + 2 + 2 + HCI_A2DP_OFFLOAD_CODEC_INFO_LEN)
+
+/* The stream waiting for the controller to start the offload */
+static tBTA_AV_HNDL bta_av_offload_hndl;
+
+static bool bta_av_offload_is_enabled(void);
+static bool bta_av_offload_start(tBTA_AV_SCB* p_scb);
+static void bta_av_offload_stop(tBTA_AV_SCB* p_scb);
+static void bta_av_offload_vsc_cback(tBTM_VSC_CMPL* p_vsc_cmpl);
 
 static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
                                UNUSED_ATTR tBTA_AV_DATA* p_data);
@@ -355,6 +381,449 @@ static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_get_peer_bdaddr
+ *
+ * Description      Returns the address of the peer, as used by the storage.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_get_peer_bdaddr(tBTA_AV_SCB* p_scb, bt_bdaddr_t* p_bd_addr) {
+  for (int i = 0; i < BD_ADDR_LEN; i++)
+    p_bd_addr->address[i] = p_scb->peer_addr[i];
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_save_disc_results
+ *
+ * Description      Remembers the stream endpoints found by the discovery of
+ *                  the peer, before their capabilities are received.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_save_disc_results(tBTA_AV_SCB* p_scb) {
+  if (p_scb->use_cached_caps) return;
+
+  if (p_scb->p_peer_caps == NULL)
+    p_scb->p_peer_caps =
+        (tBTA_AV_PEER_CAPS*)osi_malloc(sizeof(tBTA_AV_PEER_CAPS));
+  memset(p_scb->p_peer_caps, 0, sizeof(tBTA_AV_PEER_CAPS));
+
+  tBTA_AV_PEER_CAPS* p_peer_caps = p_scb->p_peer_caps;
+  p_peer_caps->num_seps = std::min<uint8_t>(p_scb->num_seps, BTA_AV_NUM_SEPS);
+  memcpy(p_peer_caps->sep_info, p_scb->sep_info,
+         p_peer_caps->num_seps * sizeof(tAVDT_SEP_INFO));
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_save_sep_caps
+ *
+ * Description      Remembers the capabilities received for the stream endpoint
+ *                  sep_info_idx of the peer.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_save_sep_caps(tBTA_AV_SCB* p_scb) {
+  if (p_scb->use_cached_caps || p_scb->p_peer_caps == NULL) return;
+  if (p_scb->sep_info_idx >= p_scb->p_peer_caps->num_seps) return;
+
+  tBTA_AV_SEP_CAPS* p_caps = &p_scb->p_peer_caps->caps[p_scb->sep_info_idx];
+  p_caps->valid = true;
+  p_caps->num_codec = p_scb->p_cap->num_codec;
+  p_caps->num_protect = p_scb->p_cap->num_protect;
+  p_caps->psc_mask = p_scb->p_cap->psc_mask;
+  memcpy(p_caps->codec_info, p_scb->p_cap->codec_info, AVDT_CODEC_SIZE);
+  /* the call-out only uses the first content protection element */
+  memcpy(p_caps->protect_info, p_scb->p_cap->protect_info, AVDT_CP_INFO_LEN);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_store_peer_caps
+ *
+ * Description      Stores the stream endpoints of the peer and their
+ *                  capabilities, once all of them are received, so that the
+ *                  discovery is skipped when the bonded peer reconnects.
+ *                  The stream endpoints are stored as:
+ *                  version | num_seps | num_seps * (seid | media type | tsep |
+ *                  valid [| num_codec | num_protect | psc_mask | codec info |
+ *                  protect info])
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_store_peer_caps(tBTA_AV_SCB* p_scb) {
+  if (p_scb->use_cached_caps || p_scb->p_peer_caps == NULL) return;
+
+  const tBTA_AV_PEER_CAPS* p_peer_caps = p_scb->p_peer_caps;
+  uint8_t buf[BTA_AV_PEER_CAPS_MAX_LEN];
+  uint8_t* p = buf;
+  UINT8_TO_STREAM(p, BTA_AV_PEER_CAPS_VERSION);
+  UINT8_TO_STREAM(p, p_peer_caps->num_seps);
+  for (uint8_t i = 0; i < p_peer_caps->num_seps; i++) {
+    const tAVDT_SEP_INFO* p_info = &p_peer_caps->sep_info[i];
+    const tBTA_AV_SEP_CAPS* p_caps = &p_peer_caps->caps[i];
+    UINT8_TO_STREAM(p, p_info->seid);
+    UINT8_TO_STREAM(p, p_info->media_type);
+    UINT8_TO_STREAM(p, p_info->tsep);
+    UINT8_TO_STREAM(p, p_caps->valid);
+    if (!p_caps->valid) continue;
+    UINT8_TO_STREAM(p, p_caps->num_codec);
+    UINT8_TO_STREAM(p, p_caps->num_protect);
+    UINT16_TO_STREAM(p, p_caps->psc_mask);
+    ARRAY_TO_STREAM(p, p_caps->codec_info, AVDT_CODEC_SIZE);
+    ARRAY_TO_STREAM(p, p_caps->protect_info, AVDT_CP_INFO_LEN);
+  }
+
+  bt_bdaddr_t bd_addr;
+  bta_av_get_peer_bdaddr(p_scb, &bd_addr);
+  if (btif_storage_set_a2dp_peer_caps(&bd_addr, buf, p - buf) ==
+      BT_STATUS_SUCCESS) {
+    APPL_TRACE_DEBUG("%s: stored %d stream endpoints", __func__,
+                     p_peer_caps->num_seps);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_parse_peer_caps
+ *
+ * Description      Parses the |len| octets of |p| stored by
+ *                  bta_av_store_peer_caps in |p_peer_caps|.
+ *
+ * Returns          true if they are valid.
+ *
+ ******************************************************************************/
+static bool bta_av_parse_peer_caps(uint8_t* p, size_t len,
+                                   tBTA_AV_PEER_CAPS* p_peer_caps) {
+  uint8_t* p_end = p + len;
+  uint8_t version;
+
+  memset(p_peer_caps, 0, sizeof(tBTA_AV_PEER_CAPS));
+  if (len < BTA_AV_PEER_CAPS_HDR_LEN) return false;
+  STREAM_TO_UINT8(version, p);
+  STREAM_TO_UINT8(p_peer_caps->num_seps, p);
+  if (version != BTA_AV_PEER_CAPS_VERSION || p_peer_caps->num_seps == 0 ||
+      p_peer_caps->num_seps > BTA_AV_NUM_SEPS)
+    return false;
+
+  for (uint8_t i = 0; i < p_peer_caps->num_seps; i++) {
+    tAVDT_SEP_INFO* p_info = &p_peer_caps->sep_info[i];
+    tBTA_AV_SEP_CAPS* p_caps = &p_peer_caps->caps[i];
+    uint8_t valid;
+
+    if (p_end - p < BTA_AV_SEP_INFO_LEN) return false;
+    p_info->in_use = false;
+    STREAM_TO_UINT8(p_info->seid, p);
+    STREAM_TO_UINT8(p_info->media_type, p);
+    STREAM_TO_UINT8(p_info->tsep, p);
+    STREAM_TO_UINT8(valid, p);
+    if (!valid) continue;
+
+    if (p_end - p < BTA_AV_SEP_CAPS_LEN) return false;
+    p_caps->valid = true;
+    STREAM_TO_UINT8(p_caps->num_codec, p);
+    STREAM_TO_UINT8(p_caps->num_protect, p);
+    STREAM_TO_UINT16(p_caps->psc_mask, p);
+    STREAM_TO_ARRAY(p_caps->codec_info, p, AVDT_CODEC_SIZE);
+    STREAM_TO_ARRAY(p_caps->protect_info, p, AVDT_CP_INFO_LEN);
+  }
+  return p == p_end;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_load_peer_caps
+ *
+ * Description      Loads the stream endpoints of the peer and their
+ *                  capabilities stored by bta_av_store_peer_caps.
+ *
+ * Returns          true if they were found and are valid.
+ *
+ ******************************************************************************/
+static bool bta_av_load_peer_caps(tBTA_AV_SCB* p_scb) {
+  bt_bdaddr_t bd_addr;
+  bta_av_get_peer_bdaddr(p_scb, &bd_addr);
+
+  uint8_t buf[BTA_AV_PEER_CAPS_MAX_LEN];
+  size_t len = sizeof(buf);
+  if (!btif_storage_get_a2dp_peer_caps(&bd_addr, buf, &len)) return false;
+
+  if (p_scb->p_peer_caps == NULL)
+    p_scb->p_peer_caps =
+        (tBTA_AV_PEER_CAPS*)osi_malloc(sizeof(tBTA_AV_PEER_CAPS));
+  if (!bta_av_parse_peer_caps(buf, len, p_scb->p_peer_caps)) {
+    APPL_TRACE_WARNING("%s: invalid stream endpoints stored", __func__);
+    btif_storage_remove_a2dp_peer_caps(&bd_addr);
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_forget_peer_caps
+ *
+ * Description      Removes the stream endpoints of the peer from the storage,
+ *                  when the capabilities replayed from it are not the ones of
+ *                  the peer any more.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_forget_peer_caps(tBTA_AV_SCB* p_scb) {
+  bt_bdaddr_t bd_addr;
+  bta_av_get_peer_bdaddr(p_scb, &bd_addr);
+  btif_storage_remove_a2dp_peer_caps(&bd_addr);
+  p_scb->use_cached_caps = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_get_cached_caps
+ *
+ * Description      Returns the capabilities replayed from the storage for the
+ *                  stream endpoint |sep_info_idx| of the peer.
+ *
+ * Returns          the capabilities, or NULL if they must be got from the peer.
+ *
+ ******************************************************************************/
+static const tBTA_AV_SEP_CAPS* bta_av_get_cached_caps(tBTA_AV_SCB* p_scb,
+                                                      uint8_t sep_info_idx) {
+  if (!p_scb->use_cached_caps) return NULL;
+
+  const tBTA_AV_PEER_CAPS* p_peer_caps = p_scb->p_peer_caps;
+  if (sep_info_idx >= p_peer_caps->num_seps ||
+      p_peer_caps->sep_info[sep_info_idx].seid !=
+          p_scb->sep_info[sep_info_idx].seid ||
+      !p_peer_caps->caps[sep_info_idx].valid)
+    return NULL;
+  return &p_peer_caps->caps[sep_info_idx];
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_post_cached_evt
+ *
+ * Description      Posts the AVDT event |avdt_event|, as if received from the
+ *                  peer, with the results replayed from the storage.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_post_cached_evt(tBTA_AV_SCB* p_scb, uint8_t avdt_event) {
+  tBTA_AV_STR_MSG* p_msg =
+      (tBTA_AV_STR_MSG*)osi_calloc(sizeof(tBTA_AV_STR_MSG));
+
+  p_msg->hdr.event = bta_av_stream_evt_ok[avdt_event];
+  p_msg->hdr.layer_specific = p_scb->hndl;
+  bdcpy(p_msg->bd_addr, p_scb->peer_addr);
+  if (avdt_event == AVDT_DISCOVER_CFM_EVT)
+    p_msg->msg.discover_cfm.num_seps = p_scb->p_peer_caps->num_seps;
+  p_msg->avdt_event = avdt_event;
+  bta_sys_sendmsg(p_msg);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_is_getcap_sep
+ *
+ * Description      Checks if the stream endpoint |sep_info_idx| found in the
+ *                  discovery results is one to get the capabilities of.
+ *
+ * Returns          true if it is not in use, and of the direction and
+ *                  media type of the stream.
+ *
+ ******************************************************************************/
+static bool bta_av_is_getcap_sep(tBTA_AV_SCB* p_scb, uint8_t sep_info_idx) {
+  uint8_t sep_requested = 0;
+
+  if (p_scb->uuid_int == UUID_SERVCLASS_AUDIO_SOURCE)
+    sep_requested = AVDT_TSEP_SNK;
+  else if (p_scb->uuid_int == UUID_SERVCLASS_AUDIO_SINK)
+    sep_requested = AVDT_TSEP_SRC;
+
+  /* steam not in use, is a sink, and is the right media type (audio/video) */
+  return (p_scb->sep_info[sep_info_idx].in_use == false) &&
+         (p_scb->sep_info[sep_info_idx].tsep == sep_requested) &&
+         (p_scb->sep_info[sep_info_idx].media_type == p_scb->media_type);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_getcap_req
+ *
+ * Description      Requests the capabilities of the stream endpoint
+ *                  |sep_info_idx| to the peer, stored in |p_cfg|.
+ *
+ * Returns          AVDT_SUCCESS if successful, otherwise error.
+ *
+ ******************************************************************************/
+static uint16_t bta_av_getcap_req(tBTA_AV_SCB* p_scb, uint8_t sep_info_idx,
+                                  tAVDT_CFG* p_cfg) {
+  tAVDT_GETCAP_REQ* p_req;
+
+  if (p_scb->avdt_version >= AVDT_VERSION_SYNC) {
+    p_req = AVDT_GetAllCapReq;
+  } else {
+    p_req = AVDT_GetCapReq;
+  }
+  return (*p_req)(p_scb->peer_addr, p_scb->sep_info[sep_info_idx].seid, p_cfg,
+                  bta_av_dt_cback[p_scb->hdi]);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_reset_getcap_pipe
+ *
+ * Description      Forgets the capabilities got ahead, once the stream
+ *                  endpoints they are for are discovered again or the
+ *                  stream is closed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_reset_getcap_pipe(tBTA_AV_SCB* p_scb) {
+  tBTA_AV_GETCAP_PIPE* p_pipe = p_scb->p_getcap_pipe;
+  if (p_pipe == NULL) return;
+
+  /* AVDTP writes to the storage of the requests still awaiting their
+   * confirmation: it is freed once they are all confirmed */
+  if (p_pipe->num_sent > 0) {
+    p_pipe->stale = true;
+    p_pipe->waiting = false;
+    return;
+  }
+  osi_free_and_reset((void**)&p_scb->p_getcap_pipe);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_post_getcap_evt
+ *
+ * Description      Posts the AVDT_GETCAP_CFM_EVT of the capabilities got
+ *                  ahead for the stream endpoint |sep_info_idx|, once it is
+ *                  its turn.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_post_getcap_evt(tBTA_AV_SCB* p_scb, uint8_t sep_info_idx) {
+  tBTA_AV_GETCAP_PIPE* p_pipe = p_scb->p_getcap_pipe;
+  tBTA_AV_STR_MSG* p_msg =
+      (tBTA_AV_STR_MSG*)osi_calloc(sizeof(tBTA_AV_STR_MSG));
+
+  if (p_pipe->state[sep_info_idx] == BTA_AV_CAPS_OK) {
+    if (p_scb->p_cap == NULL)
+      p_scb->p_cap = (tAVDT_CFG*)osi_malloc(sizeof(tAVDT_CFG));
+    memcpy(p_scb->p_cap, &p_pipe->caps[sep_info_idx], sizeof(tAVDT_CFG));
+    p_msg->hdr.event = bta_av_stream_evt_ok[AVDT_GETCAP_CFM_EVT];
+  } else {
+    p_msg->hdr.event = bta_av_stream_evt_fail[AVDT_GETCAP_CFM_EVT];
+    p_msg->msg.hdr.err_code = p_pipe->err_code[sep_info_idx];
+  }
+  p_msg->hdr.layer_specific = p_scb->hndl;
+  bdcpy(p_msg->bd_addr, p_scb->peer_addr);
+  p_msg->avdt_event = AVDT_GETCAP_CFM_EVT;
+  bta_sys_sendmsg(p_msg);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_getcap_ahead
+ *
+ * Description      Gets the capabilities of the stream endpoint
+ *                  |sep_info_idx| from the ones requested back to back.
+ *                  The next stream endpoints are requested along with it, as
+ *                  many as AVDTP accepts at once: all of them if the peer
+ *                  accepts pipelined commands, one at a time otherwise.
+ *
+ * Returns          true if the capabilities are on their way, false if they
+ *                  must be requested alone.
+ *
+ ******************************************************************************/
+static bool bta_av_getcap_ahead(tBTA_AV_SCB* p_scb, uint8_t sep_info_idx) {
+  if (p_scb->use_cached_caps || sep_info_idx >= BTA_AV_NUM_SEPS) return false;
+
+  if (p_scb->p_getcap_pipe == NULL)
+    p_scb->p_getcap_pipe =
+        (tBTA_AV_GETCAP_PIPE*)osi_calloc(sizeof(tBTA_AV_GETCAP_PIPE));
+  tBTA_AV_GETCAP_PIPE* p_pipe = p_scb->p_getcap_pipe;
+  if (p_pipe->stale) return false;
+
+  for (uint8_t i = sep_info_idx;
+       i < std::min<uint8_t>(p_scb->num_seps, BTA_AV_NUM_SEPS); i++) {
+    if (p_pipe->state[i] != BTA_AV_CAPS_IDLE || !bta_av_is_getcap_sep(p_scb, i))
+      continue;
+    if (bta_av_getcap_req(p_scb, i, &p_pipe->caps[i]) != AVDT_SUCCESS) break;
+    p_pipe->state[i] = BTA_AV_CAPS_SENT;
+    p_pipe->num_sent++;
+  }
+
+  switch (p_pipe->state[sep_info_idx]) {
+    case BTA_AV_CAPS_IDLE:
+      return false;
+    case BTA_AV_CAPS_SENT:
+      p_pipe->waiting = true;
+      return true;
+    default:
+      bta_av_post_getcap_evt(p_scb, sep_info_idx);
+      return true;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_getcap_pipe_cfm
+ *
+ * Description      Keeps the capabilities confirmed by the peer ahead of
+ *                  their turn, and hands them to the stream state machine
+ *                  if it awaits them.
+ *
+ * Returns          true if the confirmation is for capabilities got ahead.
+ *
+ ******************************************************************************/
+static bool bta_av_getcap_pipe_cfm(tBTA_AV_SCB* p_scb, tAVDT_CTRL* p_data) {
+  tBTA_AV_GETCAP_PIPE* p_pipe = p_scb->p_getcap_pipe;
+  if (p_pipe == NULL || p_data == NULL) return false;
+
+  tAVDT_CFG* p_cfg = p_data->getcap_cfm.p_cfg;
+  if (p_cfg < p_pipe->caps || p_cfg >= p_pipe->caps + BTA_AV_NUM_SEPS)
+    return false;
+
+  uint8_t sep_info_idx = (uint8_t)(p_cfg - p_pipe->caps);
+  if (p_pipe->state[sep_info_idx] != BTA_AV_CAPS_SENT) return true;
+  p_pipe->num_sent--;
+
+  if (p_pipe->stale) {
+    p_pipe->state[sep_info_idx] = BTA_AV_CAPS_IDLE;
+    if (p_pipe->num_sent == 0)
+      osi_free_and_reset((void**)&p_scb->p_getcap_pipe);
+    return true;
+  }
+
+  if (p_data->hdr.err_code == 0) {
+    p_pipe->state[sep_info_idx] = BTA_AV_CAPS_OK;
+  } else {
+    p_pipe->state[sep_info_idx] = BTA_AV_CAPS_FAILED;
+    p_pipe->err_code[sep_info_idx] = p_data->hdr.err_code;
+  }
+  APPL_TRACE_DEBUG("%s: sep_info_idx:%d err_code:%d waiting:%d", __func__,
+                   sep_info_idx, p_data->hdr.err_code, p_pipe->waiting);
+
+  if (p_pipe->waiting && sep_info_idx == p_scb->sep_info_idx) {
+    p_pipe->waiting = false;
+    bta_av_post_getcap_evt(p_scb, sep_info_idx);
+  }
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_next_getcap
@@ -367,33 +836,30 @@ static void bta_av_st_rc_timer(tBTA_AV_SCB* p_scb,
  ******************************************************************************/
 static bool bta_av_next_getcap(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   int i;
-  tAVDT_GETCAP_REQ* p_req;
   bool sent_cmd = false;
-  uint16_t uuid_int = p_scb->uuid_int;
-  uint8_t sep_requested = 0;
-
-  if (uuid_int == UUID_SERVCLASS_AUDIO_SOURCE)
-    sep_requested = AVDT_TSEP_SNK;
-  else if (uuid_int == UUID_SERVCLASS_AUDIO_SINK)
-    sep_requested = AVDT_TSEP_SRC;
 
   for (i = p_scb->sep_info_idx; i < p_scb->num_seps; i++) {
-    /* steam not in use, is a sink, and is the right media type (audio/video) */
-    if ((p_scb->sep_info[i].in_use == false) &&
-        (p_scb->sep_info[i].tsep == sep_requested) &&
-        (p_scb->sep_info[i].media_type == p_scb->media_type)) {
+    if (bta_av_is_getcap_sep(p_scb, i)) {
       p_scb->sep_info_idx = i;
 
       /* we got a stream; get its capabilities */
       if (p_scb->p_cap == NULL)
         p_scb->p_cap = (tAVDT_CFG*)osi_malloc(sizeof(tAVDT_CFG));
-      if (p_scb->avdt_version >= AVDT_VERSION_SYNC) {
-        p_req = AVDT_GetAllCapReq;
-      } else {
-        p_req = AVDT_GetCapReq;
+      const tBTA_AV_SEP_CAPS* p_caps = bta_av_get_cached_caps(p_scb, i);
+      if (p_caps != NULL) {
+        memset(p_scb->p_cap, 0, sizeof(tAVDT_CFG));
+        p_scb->p_cap->num_codec = p_caps->num_codec;
+        p_scb->p_cap->num_protect = p_caps->num_protect;
+        p_scb->p_cap->psc_mask = p_caps->psc_mask;
+        memcpy(p_scb->p_cap->codec_info, p_caps->codec_info, AVDT_CODEC_SIZE);
+        memcpy(p_scb->p_cap->protect_info, p_caps->protect_info,
+               AVDT_CP_INFO_LEN);
+        bta_av_post_cached_evt(p_scb, AVDT_GETCAP_CFM_EVT);
+        sent_cmd = true;
+        break;
       }
-      (*p_req)(p_scb->peer_addr, p_scb->sep_info[i].seid, p_scb->p_cap,
-               bta_av_dt_cback[p_scb->hdi]);
+      if (!bta_av_getcap_ahead(p_scb, i))
+        bta_av_getcap_req(p_scb, i, p_scb->p_cap);
       sent_cmd = true;
       break;
     }
@@ -422,6 +888,11 @@ static void bta_av_proc_stream_evt(uint8_t handle, BD_ADDR bd_addr,
   uint16_t sec_len = 0;
   tBTA_AV_SCB* p_scb = bta_av_cb.p_scb[index];
 
+  /* the capabilities got ahead are handed to the state machine in turn */
+  if (event == AVDT_GETCAP_CFM_EVT && p_scb != NULL &&
+      bta_av_getcap_pipe_cfm(p_scb, p_data))
+    return;
+
   if (p_data) {
     if (event == AVDT_SECURITY_IND_EVT) {
       sec_len = (p_data->security_ind.len < BTA_AV_SECURITY_MAX_LEN)
@@ -588,8 +1059,11 @@ void bta_av_sink_data_cback(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
     return;
   }
   p_pkt->event = BTA_AV_SINK_MEDIA_DATA_EVT;
+  tBTA_AV_MEDIA media;
+  media.sink_media.p_pkt = p_pkt;
+  media.sink_media.time_stamp = time_stamp;
   p_scb->seps[p_scb->sep_idx].p_app_sink_data_cback(BTA_AV_SINK_MEDIA_DATA_EVT,
-                                                    (tBTA_AV_MEDIA*)p_pkt);
+                                                    &media);
   /* Free the buffer: a copy of the packet has been delivered */
   osi_free(p_pkt);
 }
@@ -1018,6 +1492,9 @@ void bta_av_cleanup(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
 
   /* free any buffers */
   osi_free_and_reset((void**)&p_scb->p_cap);
+  osi_free_and_reset((void**)&p_scb->p_peer_caps);
+  bta_av_reset_getcap_pipe(p_scb);
+  p_scb->use_cached_caps = false;
   p_scb->sdp_discovery_started = false;
   p_scb->avdt_version = 0;
 
@@ -1027,6 +1504,7 @@ void bta_av_cleanup(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   /* if de-registering shut everything down */
   msg.hdr.layer_specific = p_scb->hndl;
   p_scb->started = false;
+  bta_av_update_data_pump();
   p_scb->current_codec = nullptr;
   p_scb->cong = false;
   p_scb->role = role;
@@ -1035,16 +1513,7 @@ void bta_av_cleanup(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
   p_scb->num_disc_snks = 0;
   alarm_cancel(p_scb->avrc_ct_timer);
 
-  /* TODO(eisenbach): RE-IMPLEMENT USING VSC OR HAL EXTENSION
-    vendor_get_interface()->send_command(
-        (vendor_opcode_t)BT_VND_OP_A2DP_OFFLOAD_STOP, (void*)&p_scb->l2c_cid);
-    if (p_scb->offload_start_pending) {
-      tBTA_AV_STATUS status = BTA_AV_FAIL_STREAM;
-      (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
-    }
-  */
-
-  p_scb->offload_start_pending = false;
+  bta_av_offload_stop(p_scb);
 
   p_scb->skip_sdp = false;
   if (p_scb->deregistring) {
@@ -1262,6 +1731,7 @@ void bta_av_setconfig_rsp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
     /* callout module tells BTA the number of "good" SEPs and their SEIDs.
      * getcap on these SEID */
     p_scb->num_seps = num;
+    bta_av_reset_getcap_pipe(p_scb);
 
     if (p_scb->cur_psc_mask & AVDT_PSC_DELAY_RPT)
       p_scb->avdt_version = AVDT_VERSION_SYNC;
@@ -1325,6 +1795,7 @@ void bta_av_str_opened(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   /* set the congestion flag, so AV would not send media packets by accident */
   p_scb->cong = true;
   p_scb->offload_start_pending = false;
+  p_scb->offload_started = false;
 
   p_scb->stream_mtu =
       p_data->str_msg.msg.open_ind.peer_mtu - AVDT_MEDIA_HDR_SIZE;
@@ -1458,6 +1929,7 @@ void bta_av_do_close(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
 
   /* close stream */
   p_scb->started = false;
+  bta_av_update_data_pump();
   p_scb->current_codec = nullptr;
 
   /* drop the buffers queued in L2CAP */
@@ -1533,6 +2005,8 @@ void bta_av_disc_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   APPL_TRACE_DEBUG("%s: initiator UUID 0x%x", __func__, uuid_int);
   /* store number of stream endpoints returned */
   p_scb->num_seps = p_data->str_msg.msg.discover_cfm.num_seps;
+  bta_av_save_disc_results(p_scb);
+  bta_av_reset_getcap_pipe(p_scb);
 
   for (i = 0; i < p_scb->num_seps; i++) {
     /* steam not in use, is a sink, and is audio */
@@ -1583,6 +2057,8 @@ void bta_av_disc_res_as_acp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   /* store number of stream endpoints returned */
   p_scb->num_seps = p_data->str_msg.msg.discover_cfm.num_seps;
+  bta_av_save_disc_results(p_scb);
+  bta_av_reset_getcap_pipe(p_scb);
 
   for (i = 0; i < p_scb->num_seps; i++) {
     /* steam is a sink, and is audio */
@@ -1629,6 +2105,7 @@ void bta_av_save_caps(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   APPL_TRACE_DEBUG("%s: num_seps:%d sep_info_idx:%d wait:x%x", __func__,
                    p_scb->num_seps, p_scb->sep_info_idx, p_scb->wait);
   memcpy(&cfg, p_scb->p_cap, sizeof(tAVDT_CFG));
+  bta_av_save_sep_caps(p_scb);
   /* let application know the capability of the SNK */
   p_scb->p_cos->getcfg(p_scb->hndl, cfg.codec_info, &p_scb->sep_info_idx,
                        p_info->seid, &cfg.num_protect, cfg.protect_info);
@@ -1646,6 +2123,7 @@ void bta_av_save_caps(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   if (getcap_done) {
     /* we are done getting capabilities. restore the p_cb->sep_info_idx */
     p_scb->sep_info_idx = 0;
+    bta_av_store_peer_caps(p_scb);
     p_scb->wait &= ~(BTA_AV_WAIT_ACP_CAPS_ON | BTA_AV_WAIT_ACP_CAPS_STARTED);
     if (old_wait & BTA_AV_WAIT_ACP_CAPS_STARTED) {
       bta_av_start_ok(p_scb, NULL);
@@ -1699,6 +2177,16 @@ void bta_av_open_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   tBTA_AV_OPEN open;
 
   APPL_TRACE_DEBUG("%s", __func__);
+  if (p_scb->use_cached_caps) {
+    /* the peer changed since it was last discovered */
+    APPL_TRACE_WARNING("%s: stored capabilities failed, discovering the peer",
+                       __func__);
+    bta_av_forget_peer_caps(p_scb);
+    bta_av_set_scb_sst_opening(p_scb);
+    bta_av_discover_req(p_scb, NULL);
+    return;
+  }
+
   p_scb->open_status = BTA_AV_FAIL_STREAM;
   bta_av_cco_close(p_scb, p_data);
 
@@ -1753,6 +2241,8 @@ void bta_av_getcap_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   tAVDT_SEP_INFO* p_info = &p_scb->sep_info[p_scb->sep_info_idx];
   uint16_t uuid_int; /* UUID for which connection was initiatied */
 
+  bta_av_save_sep_caps(p_scb);
+
   memcpy(&cfg, &p_scb->cfg, sizeof(tAVDT_CFG));
   cfg.num_codec = 1;
   cfg.num_protect = p_scb->p_cap->num_protect;
@@ -1771,6 +2261,7 @@ void bta_av_getcap_results(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
                             cfg.protect_info) == A2DP_SUCCESS)) {
     /* save copy of codec configuration */
     memcpy(&p_scb->cfg, &cfg, sizeof(tAVDT_CFG));
+    bta_av_store_peer_caps(p_scb);
 
     uuid_int = p_scb->uuid_int;
     APPL_TRACE_DEBUG("%s: initiator UUID = 0x%x", __func__, uuid_int);
@@ -1847,8 +2338,21 @@ void bta_av_setconfig_rej(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
  *
  ******************************************************************************/
 void bta_av_discover_req(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
-  /* send avdtp discover request */
+  /* a bonded peer is not discovered again: its stream endpoints and their
+   * capabilities are replayed from the storage, and the stream is configured
+   * right away. If the peer rejects the configuration, it is discovered. */
+  p_scb->use_cached_caps = false;
+  if (!bta_av_is_rcfg_sst(p_scb) && bta_av_load_peer_caps(p_scb)) {
+    APPL_TRACE_DEBUG("%s: using the %d stream endpoints stored", __func__,
+                     p_scb->p_peer_caps->num_seps);
+    p_scb->use_cached_caps = true;
+    memcpy(p_scb->sep_info, p_scb->p_peer_caps->sep_info,
+           p_scb->p_peer_caps->num_seps * sizeof(tAVDT_SEP_INFO));
+    bta_av_post_cached_evt(p_scb, AVDT_DISCOVER_CFM_EVT);
+    return;
+  }
 
+  /* send avdtp discover request */
   AVDT_DiscoverReq(p_scb->peer_addr, p_scb->sep_info, BTA_AV_NUM_SEPS,
                    bta_av_dt_cback[p_scb->hdi]);
 }
@@ -1943,15 +2447,7 @@ void bta_av_str_stopped(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   bta_sys_set_policy(BTA_ID_AV, policy, p_scb->peer_addr);
 
   if (p_scb->co_started) {
-    /* TODO(eisenbach): RE-IMPLEMENT USING VSC OR HAL EXTENSION
-    vendor_get_interface()->send_command(
-        (vendor_opcode_t)BT_VND_OP_A2DP_OFFLOAD_STOP, (void*)&p_scb->l2c_cid);
-    if (p_scb->offload_start_pending) {
-      tBTA_AV_STATUS status = BTA_AV_FAIL_STREAM;
-      (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
-    }
-    p_scb->offload_start_pending = false;
-    */
+    bta_av_offload_stop(p_scb);
 
     bta_av_stream_chg(p_scb, false);
     p_scb->co_started = false;
@@ -2077,6 +2573,7 @@ void bta_av_reconfig(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
         bta_av_str_stopped(p_scb, NULL);
       }
       p_scb->started = false;
+      bta_av_update_data_pump();
     } else {
       // Close->Configure->Open
       bta_av_str_stopped(p_scb, NULL);
@@ -2192,6 +2689,7 @@ void bta_av_data_path(tBTA_AV_SCB* p_scb, UNUSED_ATTR tBTA_AV_DATA* p_data) {
       p_scb->cong = true;
     } else {
       /* there's a buffer, but L2CAP does not seem to be moving data */
+      bta_av_co_audio_congested(p_scb->hndl);
       if (new_buf) {
         /* just got this buffer from co_data,
          * put it in queue */
@@ -2234,6 +2732,7 @@ void bta_av_start_ok(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
                    p_scb->role);
 
   p_scb->started = true;
+  bta_av_update_data_pump();
   p_scb->current_codec = bta_av_get_a2dp_current_codec();
 
   if (p_scb->sco_suspend) {
@@ -2519,6 +3018,7 @@ void bta_av_suspend_cfm(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   } else {
     /* only set started to false when suspend is successful */
     p_scb->started = false;
+    bta_av_update_data_pump();
   }
 
   if (p_scb->role & BTA_AV_ROLE_SUSPEND) {
@@ -2534,15 +3034,7 @@ void bta_av_suspend_cfm(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   /* in case that we received suspend_ind, we may need to call co_stop here */
   if (p_scb->co_started) {
-    /* TODO(eisenbach): RE-IMPLEMENT USING VSC OR HAL EXTENSION
-    vendor_get_interface()->send_command(
-        (vendor_opcode_t)BT_VND_OP_A2DP_OFFLOAD_STOP, (void*)&p_scb->l2c_cid);
-    if (p_scb->offload_start_pending) {
-      tBTA_AV_STATUS status = BTA_AV_FAIL_STREAM;
-      (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
-    }
-    p_scb->offload_start_pending = false;
-    */
+    bta_av_offload_stop(p_scb);
 
     bta_av_stream_chg(p_scb, false);
 
@@ -2619,6 +3111,8 @@ void bta_av_rcfg_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
 
   APPL_TRACE_DEBUG("%s: num_recfg: %d, conn_lcb:0x%x", __func__,
                    p_scb->num_recfg, bta_av_cb.conn_lcb);
+  /* the next connection discovers the peer again */
+  if (p_scb->use_cached_caps) bta_av_forget_peer_caps(p_scb);
   if (p_scb->num_recfg > BTA_AV_RECONFIG_RETRY) {
     bta_av_cco_close(p_scb, p_data);
     /* report failure */
@@ -2702,6 +3196,7 @@ void bta_av_suspend_cont(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   tBTA_AV_RECONFIG evt;
 
   p_scb->started = false;
+  bta_av_update_data_pump();
   p_scb->cong = false;
   if (err_code) {
     if (AVDT_ERR_CONNECT == err_code) {
@@ -2976,6 +3471,173 @@ void bta_av_open_at_inc(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_offload_is_enabled
+ *
+ * Description      Check whether the A2DP offload is supported by the device,
+ *                  and not disabled by the user.
+ *
+ * Returns          true if the media can be offloaded
+ *
+ ******************************************************************************/
+static bool bta_av_offload_is_enabled(void) {
+  char value[PROPERTY_VALUE_MAX] = {0};
+
+  osi_property_get(BTA_AV_OFFLOAD_SUPPORTED_PROPERTY, value, "false");
+  if (strcmp(value, "true") != 0) return false;
+
+  osi_property_get(BTA_AV_OFFLOAD_DISABLED_PROPERTY, value, "false");
+  return strcmp(value, "true") != 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_offload_codec_type
+ *
+ * Description      Get the codec type of the A2DP offload start command for
+ *                  the codec |codec_index|.
+ *
+ * Returns          The codec type, or 0 if the codec cannot be offloaded
+ *
+ ******************************************************************************/
+static uint32_t bta_av_offload_codec_type(btav_a2dp_codec_index_t codec_index) {
+  switch (codec_index) {
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_SBC:
+      return HCI_A2DP_OFFLOAD_CODEC_SBC;
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_AAC:
+      return HCI_A2DP_OFFLOAD_CODEC_AAC;
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_APTX:
+      return HCI_A2DP_OFFLOAD_CODEC_APTX;
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD:
+      return HCI_A2DP_OFFLOAD_CODEC_APTX_HD;
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC:
+      return HCI_A2DP_OFFLOAD_CODEC_LDAC;
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC:
+    case BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL:
+      return HCI_A2DP_OFFLOAD_CODEC_LHDC;
+    default:
+      return 0;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_offload_start
+ *
+ * Description      Hand the codec configuration, the L2CAP channel, the MTU
+ *                  and the SCMS-T state of the stream to the controller, so
+ *                  that it encodes and sends the media instead of the host.
+ *
+ * Returns          true if the controller was asked to start the offload
+ *
+ ******************************************************************************/
+static bool bta_av_offload_start(tBTA_AV_SCB* p_scb) {
+  uint32_t codec_type =
+      bta_av_offload_codec_type(p_scb->current_codec->codecIndex());
+  if (codec_type == 0) {
+    APPL_TRACE_WARNING("%s: codec %s cannot be offloaded", __func__,
+                       p_scb->current_codec->name().c_str());
+    return false;
+  }
+
+  uint16_t acl_mtu, remote_cid, lm_handle;
+  if (!L2CA_GetConnectionConfig(p_scb->l2c_cid, &acl_mtu, &remote_cid,
+                                &lm_handle)) {
+    APPL_TRACE_ERROR("%s: no L2CAP channel 0x%x", __func__, p_scb->l2c_cid);
+    return false;
+  }
+
+  uint16_t mtu = bta_av_chk_mtu(p_scb, p_scb->stream_mtu);
+  if (mtu == 0 || mtu > p_scb->stream_mtu) mtu = p_scb->stream_mtu;
+
+  uint8_t cp_flag;
+  bool cp_active = bta_av_co_get_scmst_info(&cp_flag);
+  btav_a2dp_codec_config_t codec_config =
+      p_scb->current_codec->getCodecConfig();
+
+  APPL_TRACE_DEBUG(
+      "%s: codec %s lcid 0x%x rcid 0x%x lm_handle 0x%x mtu %d scms-t %d",
+      __func__, p_scb->current_codec->name().c_str(), p_scb->l2c_cid,
+      remote_cid, lm_handle, mtu, cp_active);
+
+  uint8_t param[BTA_AV_OFFLOAD_START_PARAM_LEN];
+  uint8_t* p = param;
+  UINT8_TO_STREAM(p, HCI_A2DP_OFFLOAD_START);
+  UINT32_TO_STREAM(p, codec_type);
+  UINT16_TO_STREAM(p, 0); /* max latency: the controller default */
+  UINT8_TO_STREAM(p, cp_active ? 1 : 0);
+  UINT8_TO_STREAM(p, cp_active ? cp_flag : 0);
+  UINT32_TO_STREAM(p, codec_config.sample_rate);
+  UINT8_TO_STREAM(p, codec_config.bits_per_sample);
+  UINT8_TO_STREAM(p, codec_config.channel_mode);
+  UINT32_TO_STREAM(p, 0); /* encoded bit rate: from the codec information */
+  UINT16_TO_STREAM(p, lm_handle);
+  UINT16_TO_STREAM(p, remote_cid);
+  UINT16_TO_STREAM(p, mtu);
+  memset(p, 0, HCI_A2DP_OFFLOAD_CODEC_INFO_LEN);
+  memcpy(p, p_scb->cfg.codec_info,
+         std::min(sizeof(p_scb->cfg.codec_info),
+                  (size_t)HCI_A2DP_OFFLOAD_CODEC_INFO_LEN));
+
+  bta_av_offload_hndl = p_scb->hndl;
+  p_scb->offload_start_pending = true;
+  BTM_VendorSpecificCommand(HCI_CONTROLLER_A2DP_OPCODE, sizeof(param), param,
+                            bta_av_offload_vsc_cback);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_offload_stop
+ *
+ * Description      Stop the offload of the stream, if any. A pending offload
+ *                  start request fails.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_offload_stop(tBTA_AV_SCB* p_scb) {
+  if (p_scb->offload_started || p_scb->offload_start_pending) {
+    uint8_t param = HCI_A2DP_OFFLOAD_STOP;
+    BTM_VendorSpecificCommand(HCI_CONTROLLER_A2DP_OPCODE, sizeof(param), &param,
+                              bta_av_offload_vsc_cback);
+  }
+
+  if (p_scb->offload_start_pending) {
+    tBTA_AV_STATUS status = BTA_AV_FAIL_STREAM;
+    (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
+  }
+  p_scb->offload_start_pending = false;
+  p_scb->offload_started = false;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_offload_vsc_cback
+ *
+ * Description      This function is called when the controller completes an
+ *                  A2DP offload command.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_offload_vsc_cback(tBTM_VSC_CMPL* p_vsc_cmpl) {
+  uint8_t status = HCI_ERR_UNSPECIFIED;
+  uint8_t sub_opcode = HCI_A2DP_OFFLOAD_START;
+  uint8_t* p = p_vsc_cmpl->p_param_buf;
+
+  if (p_vsc_cmpl->param_len >= 1) STREAM_TO_UINT8(status, p);
+  if (p_vsc_cmpl->param_len >= 2) STREAM_TO_UINT8(sub_opcode, p);
+  APPL_TRACE_DEBUG("%s: sub opcode 0x%x status 0x%x", __func__, sub_opcode,
+                   status);
+
+  if (sub_opcode != HCI_A2DP_OFFLOAD_START) return;
+  BTA_AvOffloadStartRsp(bta_av_offload_hndl, status == HCI_SUCCESS
+                                                 ? BTA_AV_SUCCESS
+                                                 : BTA_AV_FAIL_RESOURCES);
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_offload_req
@@ -2997,55 +3659,27 @@ void bta_av_offload_req(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
   /* Support offload if only one audio source stream is open. */
   if (p_scb->started != true) {
     status = BTA_AV_FAIL_STREAM;
+  } else if (p_scb->offload_start_pending) {
+    /* answered with the controller response */
+    return;
+  } else if (p_scb->offload_started) {
+    status = BTA_AV_SUCCESS;
+  } else if (bta_av_offload_is_enabled() && bta_av_cb.audio_open_cnt == 1 &&
+             p_scb->seps[p_scb->sep_idx].tsep == AVDT_TSEP_SRC &&
+             p_scb->chnl == BTA_AV_CHNL_AUDIO &&
+             p_scb->current_codec != nullptr) {
+    if (bta_av_offload_start(p_scb)) return;
   }
 
-  /* TODO(eisenbach): RE-IMPLEMENT USING VSC OR HAL EXTENSION
-   uint16_t mtu = bta_av_chk_mtu(p_scb, p_scb->stream_mtu);
-   else if (bta_av_cb.audio_open_cnt == 1 &&
-              p_scb->seps[p_scb->sep_idx].tsep == AVDT_TSEP_SRC &&
-              p_scb->chnl == BTA_AV_CHNL_AUDIO) {
-     bt_vendor_op_a2dp_offload_t a2dp_offload_start;
-
-     if (L2CA_GetConnectionConfig(
-             p_scb->l2c_cid, &a2dp_offload_start.acl_data_size,
-             &a2dp_offload_start.remote_cid, &a2dp_offload_start.lm_handle)) {
-       APPL_TRACE_DEBUG("%s: l2cmtu %d lcid 0x%02X rcid 0x%02X lm_handle
-   0x%02X",
-                        __func__, a2dp_offload_start.acl_data_size,
-                        p_scb->l2c_cid, a2dp_offload_start.remote_cid,
-                        a2dp_offload_start.lm_handle);
-
-       a2dp_offload_start.bta_av_handle = p_scb->hndl;
-       a2dp_offload_start.xmit_quota = BTA_AV_A2DP_OFFLOAD_XMIT_QUOTA;
-       a2dp_offload_start.stream_mtu =
-           (mtu < p_scb->stream_mtu) ? mtu : p_scb->stream_mtu;
-       a2dp_offload_start.local_cid = p_scb->l2c_cid;
-       a2dp_offload_start.is_flushable = true;
-       a2dp_offload_start.stream_source =
-           ((uint32_t)(p_scb->cfg.codec_info[1] | p_scb->cfg.codec_info[2]));
-
-       memcpy(a2dp_offload_start.codec_info, p_scb->cfg.codec_info,
-              sizeof(a2dp_offload_start.codec_info));
-
-       if (!vendor_get_interface()->send_command(
-               (vendor_opcode_t)BT_VND_OP_A2DP_OFFLOAD_START,
-               &a2dp_offload_start)) {
-         status = BTA_AV_SUCCESS;
-         p_scb->offload_start_pending = true;
-       }
-     }
-   }
-   */
-  if (status != BTA_AV_SUCCESS)
-    (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
+  (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
 }
 
 /*******************************************************************************
  *
  * Function         bta_av_offload_rsp
  *
- * Description      This function is called when the vendor lib responds to
- *                  BT_VND_OP_A2DP_OFFLOAD_START.
+ * Description      This function is called when the controller responds to
+ *                  the A2DP offload start command.
  *
  * Returns          void
  *
@@ -3057,11 +3691,15 @@ void bta_av_offload_rsp(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data) {
                    p_scb->started ? "STARTED" : "STOPPED",
                    status ? "FAIL" : "SUCCESS");
 
+  /* The stream stopped meanwhile, and the failure was reported then */
+  if (!p_scb->offload_start_pending) return;
+
   /* Check if stream has already been started. */
   if (status == BTA_AV_SUCCESS && p_scb->started != true) {
     status = BTA_AV_FAIL_STREAM;
   }
 
   p_scb->offload_start_pending = false;
+  p_scb->offload_started = (status == BTA_AV_SUCCESS);
   (*bta_av_cb.p_cback)(BTA_AV_OFFLOAD_START_RSP_EVT, (tBTA_AV*)&status);
 }
@@ -2106,6 +2106,8 @@ void bta_av_dereg_comp(tBTA_AV_DATA* p_data) {
 
     /* make sure that the timer is not active */
     alarm_cancel(p_scb->avrc_ct_timer);
+    osi_free_and_reset((void**)&p_scb->p_peer_caps);
+    osi_free_and_reset((void**)&p_scb->p_getcap_pipe);
     osi_free_and_reset((void**)&p_cb->p_scb[p_scb->hdi]);
   }
 
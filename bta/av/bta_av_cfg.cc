@@ -111,9 +111,12 @@ const uint8_t bta_avk_meta_caps_evt_ids[] = {
   (sizeof(bta_avk_meta_caps_evt_ids) / sizeof(bta_avk_meta_caps_evt_ids[0]))
 #endif /* BTA_AVK_NUM_RC_EVT_IDS */
 
-/* the MTU for the AVRCP browsing channel */
+/* the MTU for the AVRCP browsing channel. The folder listings fill messages
+ * up to the MTU of the channel, and the ERTM of the channel segments them, so
+ * a large MTU takes fewer round trips for a listing. AVCT caps it at what its
+ * buffers hold. */
 #ifndef BTA_AV_MAX_RC_BR_MTU
-#define BTA_AV_MAX_RC_BR_MTU 1008
+#define BTA_AV_MAX_RC_BR_MTU 4000
 #endif
 
 /* This configuration to be used when we are Src + TG + CT( only for abs vol) */
@@ -30,6 +30,15 @@
 
 #include <string.h>
 
+#include <atomic>
+
+/* Whether the data ready events of the audio channel go through the media
+ * data pump, set while an audio stream is started */
+static std::atomic<bool> bta_av_data_pump_enabled(false);
+
+/* The number of data ready events carried by the pump message in flight */
+static std::atomic<uint32_t> bta_av_data_pump_pending(0);
+
 /*******************************************************************************
  *
  * Function         bta_av_ci_src_data_ready
@@ -42,14 +51,60 @@
  *
  ******************************************************************************/
 void bta_av_ci_src_data_ready(tBTA_AV_CHNL chnl) {
+  uint16_t event = BTA_AV_CI_SRC_DATA_READY_EVT;
+
+  if (chnl == BTA_AV_CHNL_AUDIO && bta_av_data_pump_enabled) {
+    /* a single message carries the events until the pump handles them */
+    if (bta_av_data_pump_pending.fetch_add(1) != 0) return;
+    event = BTA_AV_CI_SRC_DATA_PUMP_EVT;
+  }
+
   BT_HDR* p_buf = (BT_HDR*)osi_malloc(sizeof(BT_HDR));
 
   p_buf->layer_specific = chnl;
-  p_buf->event = BTA_AV_CI_SRC_DATA_READY_EVT;
+  p_buf->event = event;
 
   bta_sys_sendmsg(p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_ci_enable_data_pump
+ *
+ * Description      This function turns the media data pump of the audio
+ *                  channel on or off.  While it is on, the data ready events
+ *                  are coalesced into a single BTA_AV_CI_SRC_DATA_PUMP_EVT
+ *                  message, which drives the data path of the started
+ *                  streams without going through their state machine.
+ *                  Turning it on drops the events of a pump message that
+ *                  was lost while it was off.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_av_ci_enable_data_pump(bool enable) {
+  if (!enable) {
+    bta_av_data_pump_enabled = false;
+    return;
+  }
+  if (!bta_av_data_pump_enabled.exchange(true)) bta_av_data_pump_pending = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_ci_take_data_pump_events
+ *
+ * Description      This function takes the data ready events carried by the
+ *                  pump message being handled.  The next data ready event
+ *                  sends a new pump message.
+ *
+ * Returns          The number of data ready events
+ *
+ ******************************************************************************/
+uint32_t bta_av_ci_take_data_pump_events(void) {
+  return bta_av_data_pump_pending.exchange(0);
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_ci_setconfig
@@ -93,6 +93,7 @@ enum {
   BTA_AV_API_DEREGISTER_EVT,
   BTA_AV_API_DISCONNECT_EVT,
   BTA_AV_CI_SRC_DATA_READY_EVT,
+  BTA_AV_CI_SRC_DATA_PUMP_EVT,
   BTA_AV_SIG_CHG_EVT,
   BTA_AV_SIGNALLING_TIMER_EVT,
   BTA_AV_SDP_AVRC_DISC_EVT,
@@ -441,6 +442,42 @@ typedef union {
 #define BTA_AV_COLL_API_CALLED \
   0x02 /* API open was called while incoming timer is running */
 
+/* the capabilities of a stream endpoint of the peer */
+typedef struct {
+  bool valid; /* true if the capabilities were received */
+  uint8_t num_codec;
+  uint8_t num_protect;
+  uint16_t psc_mask;
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  uint8_t protect_info[AVDT_CP_INFO_LEN];
+} tBTA_AV_SEP_CAPS;
+
+/* the stream endpoints of the peer and their capabilities, as found by the
+ * last discovery, and kept in the storage of a bonded peer to skip the
+ * discovery when it reconnects */
+typedef struct {
+  uint8_t num_seps;
+  tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS];
+  tBTA_AV_SEP_CAPS caps[BTA_AV_NUM_SEPS];
+} tBTA_AV_PEER_CAPS;
+
+/* the state of the capabilities of a stream endpoint got ahead */
+#define BTA_AV_CAPS_IDLE 0   /* not requested */
+#define BTA_AV_CAPS_SENT 1   /* requested, awaiting the confirmation */
+#define BTA_AV_CAPS_OK 2     /* received */
+#define BTA_AV_CAPS_FAILED 3 /* not returned by the peer */
+
+/* the capabilities of the stream endpoints of the peer, requested back to back
+ * ahead of their turn, and handed to the stream state machine in its order */
+typedef struct {
+  tAVDT_CFG caps[BTA_AV_NUM_SEPS];
+  uint8_t state[BTA_AV_NUM_SEPS];
+  uint8_t err_code[BTA_AV_NUM_SEPS];
+  uint8_t num_sent; /* requests awaiting their confirmation */
+  bool waiting;     /* the stream endpoint sep_info_idx awaits its turn */
+  bool stale;       /* the requests sent are for a previous discovery */
+} tBTA_AV_GETCAP_PIPE;
+
 /* type for AV stream control block */
 typedef struct {
   const tBTA_AV_ACT* p_act_tbl; /* the action table for stream state machine */
@@ -448,6 +485,9 @@ typedef struct {
   bool sdp_discovery_started; /* variable to determine whether SDP is started */
   tBTA_AV_SEP seps[BTAV_A2DP_CODEC_INDEX_MAX];
   tAVDT_CFG* p_cap;  /* buffer used for get capabilities */
+  tBTA_AV_PEER_CAPS* p_peer_caps; /* the discovery results of the peer */
+  bool use_cached_caps; /* true if the discovery results are from storage */
+  tBTA_AV_GETCAP_PIPE* p_getcap_pipe; /* the capabilities got ahead */
   list_t* a2dp_list; /* used for audio channels only */
   tBTA_AV_Q_INFO q_info;
   tAVDT_SEP_INFO sep_info[BTA_AV_NUM_SEPS]; /* stream discovery results */
@@ -497,7 +537,8 @@ typedef struct {
   uint8_t q_tag; /* identify the associated q_info union member */
   bool no_rtp_hdr;   /* true if add no RTP header*/
   uint16_t uuid_int; /*intended UUID of Initiator to connect to */
-  bool offload_start_pending;
+  bool offload_start_pending; /* Waiting for the controller to offload */
+  bool offload_started;       /* The controller encodes and sends the media */
   bool skip_sdp; /* Decides if sdp to be done prior to profile connection */
 } tBTA_AV_SCB;
 
@@ -604,7 +645,9 @@ extern bool bta_av_is_scb_opening(tBTA_AV_SCB* p_scb);
 extern bool bta_av_is_scb_incoming(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_init(tBTA_AV_SCB* p_scb);
 extern bool bta_av_is_scb_init(tBTA_AV_SCB* p_scb);
+extern bool bta_av_is_scb_open(tBTA_AV_SCB* p_scb);
 extern void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb);
+extern void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb);
 extern tBTA_AV_LCB* bta_av_find_lcb(BD_ADDR addr, uint8_t op);
 
 /* main functions */
@@ -673,6 +716,9 @@ extern void bta_av_do_start(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_str_stopped(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_reconfig(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_data_path(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
+extern void bta_av_update_data_pump(void);
+extern void bta_av_ci_enable_data_pump(bool enable);
+extern uint32_t bta_av_ci_take_data_pump_events(void);
 extern void bta_av_start_ok(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_start_failed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
 extern void bta_av_str_closed(tBTA_AV_SCB* p_scb, tBTA_AV_DATA* p_data);
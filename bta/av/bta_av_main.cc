@@ -161,6 +161,7 @@ typedef void (*tBTA_AV_NSM_ACT)(tBTA_AV_DATA* p_data);
 static void bta_av_api_enable(tBTA_AV_DATA* p_data);
 static void bta_av_api_register(tBTA_AV_DATA* p_data);
 static void bta_av_ci_data(tBTA_AV_DATA* p_data);
+static void bta_av_ci_data_pump(tBTA_AV_DATA* p_data);
 #if (AVDT_REPORTING == TRUE)
 static void bta_av_rpc_conn(tBTA_AV_DATA* p_data);
 #endif
@@ -178,6 +179,7 @@ const tBTA_AV_NSM_ACT bta_av_nsm_act[] = {
     bta_av_api_deregister,   /* BTA_AV_API_DEREGISTER_EVT */
     bta_av_api_disconnect,   /* BTA_AV_API_DISCONNECT_EVT */
     bta_av_ci_data,          /* BTA_AV_CI_SRC_DATA_READY_EVT */
+    bta_av_ci_data_pump,     /* BTA_AV_CI_SRC_DATA_PUMP_EVT */
     bta_av_sig_chg,          /* BTA_AV_SIG_CHG_EVT */
     bta_av_signalling_timer, /* BTA_AV_SIGNALLING_TIMER_EVT */
     bta_av_rc_disc_done,     /* BTA_AV_SDP_AVRC_DISC_EVT */
@@ -720,6 +722,67 @@ static void bta_av_ci_data(tBTA_AV_DATA* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_ci_data_pump
+ *
+ * Description      Handle the data ready events carried by the message of
+ *                  the media data pump. The data path of each started stream
+ *                  in the open state is called directly, once per event or
+ *                  until the stream is congested, the other streams of the
+ *                  channel get the event through their state machine.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_av_ci_data_pump(tBTA_AV_DATA* p_data) {
+  tBTA_AV_SCB* p_scb;
+  int i;
+  uint8_t chnl = (uint8_t)p_data->hdr.layer_specific;
+  uint32_t events = bta_av_ci_take_data_pump_events();
+
+  /* the events of a message in flight when the pump was turned back on */
+  if (events == 0) events = 1;
+
+  for (i = 0; i < BTA_AV_NUM_STRS; i++) {
+    p_scb = bta_av_cb.p_scb[i];
+    if (p_scb == NULL || p_scb->chnl != chnl) continue;
+
+    if (p_scb->started && bta_av_is_scb_open(p_scb)) {
+      for (uint32_t n = 0; n < events && !p_scb->cong; n++) {
+        bta_av_data_path(p_scb, p_data);
+      }
+    } else {
+      bta_av_ssm_execute(p_scb, BTA_AV_SRC_DATA_READY_EVT, p_data);
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_av_update_data_pump
+ *
+ * Description      Turn the media data pump on while an audio stream is
+ *                  started, and off once none is.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_av_update_data_pump(void) {
+  bool started = false;
+
+  for (int i = 0; i < BTA_AV_NUM_STRS; i++) {
+    tBTA_AV_SCB* p_scb = bta_av_cb.p_scb[i];
+    if (p_scb != NULL && p_scb->chnl == BTA_AV_CHNL_AUDIO && p_scb->started) {
+      started = true;
+      break;
+    }
+  }
+  bta_av_ci_enable_data_pump(started);
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_rpc_conn
@@ -1318,6 +1381,8 @@ const char* bta_av_evt_code(uint16_t evt_code) {
       return "API_DISCNT";
     case BTA_AV_CI_SRC_DATA_READY_EVT:
       return "CI_DATA_READY";
+    case BTA_AV_CI_SRC_DATA_PUMP_EVT:
+      return "CI_DATA_PUMP";
     case BTA_AV_SIG_CHG_EVT:
       return "SIG_CHG";
     case BTA_AV_SIGNALLING_TIMER_EVT:
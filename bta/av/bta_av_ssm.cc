@@ -626,6 +626,20 @@ bool bta_av_is_scb_init(tBTA_AV_SCB* p_scb) {
   return is_init;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_is_scb_open
+ *
+ * Description      Returns true if scb is in open state.
+ *
+ *
+ * Returns          true if scb is in open state.
+ *
+ ******************************************************************************/
+bool bta_av_is_scb_open(tBTA_AV_SCB* p_scb) {
+  return p_scb != NULL && p_scb->state == BTA_AV_OPEN_SST;
+}
+
 /*******************************************************************************
  *
  * Function         bta_av_set_scb_sst_incoming
@@ -642,6 +656,22 @@ void bta_av_set_scb_sst_incoming(tBTA_AV_SCB* p_scb) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_av_set_scb_sst_opening
+ *
+ * Description      Set SST state to opening.
+ *                  Use this function to change SST outside of state machine.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void bta_av_set_scb_sst_opening(tBTA_AV_SCB* p_scb) {
+  if (p_scb) {
+    p_scb->state = BTA_AV_OPENING_SST;
+  }
+}
+
 /*****************************************************************************
  *  Debug Functions
  ****************************************************************************/
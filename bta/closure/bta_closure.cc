@@ -20,6 +20,7 @@
 #include "base/time/time.h"
 #include "bta_closure_int.h"
 #include "bta_sys.h"
+#include "osi/include/stall_log.h"
 
 using base::PendingTask;
 using base::TaskQueue;
@@ -62,6 +63,9 @@ bool bta_closure_execute(BT_HDR* p_raw_msg) {
 
   APPL_TRACE_API("%s: executing closure %s", __func__,
                  p_msg->pending_task.posted_from.ToString().c_str());
+  const tracked_objects::Location& from = p_msg->pending_task.posted_from;
+  stall_log_set_origin(from.function_name(), from.file_name(),
+                       from.line_number());
   p_msg->pending_task.task.Run();
 
   p_msg->pending_task.~PendingTask();
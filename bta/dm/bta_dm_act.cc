@@ -34,6 +34,7 @@
 #include "bt_target.h"
 #include "bt_types.h"
 #include "bta_api.h"
+#include "bta_closure_api.h"
 #include "bta_dm_api.h"
 #include "bta_dm_co.h"
 #include "bta_dm_int.h"
@@ -45,6 +46,7 @@
 #include "l2c_api.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "sdp_api.h"
 #include "utl.h"
 
@@ -60,6 +62,8 @@ static void bta_dm_service_search_remname_cback(BD_ADDR bd_addr, DEV_CLASS dc,
 static void bta_dm_remname_cback(tBTM_REMOTE_DEV_NAME* p_remote_name);
 static void bta_dm_find_services(BD_ADDR bd_addr);
 static void bta_dm_discover_next_device(void);
+static void bta_dm_inq_disc_resume(void);
+static void bta_dm_inq_target_found(void);
 static void bta_dm_sdp_callback(uint16_t sdp_status);
 static uint8_t bta_dm_authorize_cback(BD_ADDR bd_addr, DEV_CLASS dev_class,
                                       BD_NAME bd_name, uint8_t* service_name,
@@ -96,12 +100,16 @@ static void bta_dm_disable_conn_down_timer_cback(void* data);
 static void bta_dm_rm_cback(tBTA_SYS_CONN_STATUS status, uint8_t id,
                             uint8_t app_id, BD_ADDR peer_addr);
 static void bta_dm_adjust_roles(bool delay_role_switch);
+static void bta_dm_adjust_role(tBTA_DM_PEER_DEVICE* p_dev, uint8_t br_count,
+                               bool delay_role_switch);
 static char* bta_dm_get_remname(void);
 static void bta_dm_bond_cancel_complete_cback(tBTM_STATUS result);
 
 static bool bta_dm_read_remote_device_name(BD_ADDR bd_addr,
                                            tBT_TRANSPORT transport);
 static void bta_dm_discover_device(BD_ADDR remote_bd_addr);
+static void bta_dm_name_cache_put(BD_ADDR bd_addr, BD_NAME bd_name);
+static bool bta_dm_name_cache_get(BD_ADDR bd_addr, BD_NAME bd_name);
 
 static void bta_dm_sys_hw_cback(tBTA_SYS_HW_EVT status);
 static void bta_dm_disable_search_and_disc(void);
@@ -145,6 +153,12 @@ static void bta_dm_ctrl_features_rd_cmpl_cback(tBTM_STATUS result);
 #define BTA_DM_SWITCH_DELAY_TIMER_MS 500
 #endif
 
+/* Failed role switches after which the role switch is no longer asked for
+ * again to a peer, until it reconnects */
+#ifndef BTA_DM_RS_MAX_FAILURES
+#define BTA_DM_RS_MAX_FAILURES 3
+#endif
+
 static void bta_dm_reset_sec_dev_pending(BD_ADDR remote_bd_addr);
 static void bta_dm_remove_sec_dev_entry(BD_ADDR remote_bd_addr);
 static void bta_dm_observe_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
@@ -1142,6 +1156,17 @@ void bta_dm_search_start(tBTA_DM_MSG* p_data) {
     bta_dm_search_cb.p_srvc_uuid = (tBT_UUID*)osi_malloc(len);
     memcpy(bta_dm_search_cb.p_srvc_uuid, p_data->search.p_uuid, len);
   }
+
+  /* name and service discovery may start before the inquiry completes */
+  bta_dm_search_cb.p_btm_inq_info = NULL;
+  bta_dm_search_cb.inq_done = false;
+  bta_dm_search_cb.disc_idle = false;
+  bta_dm_search_cb.has_target =
+      (p_data->search.inq_params.filter_type == BTA_DM_INQ_BD_ADDR);
+  if (bta_dm_search_cb.has_target)
+    bdcpy(bta_dm_search_cb.target_bda,
+          p_data->search.inq_params.filter_cond.bd_addr);
+
   result.status = BTM_StartInquiry((tBTM_INQ_PARMS*)&p_data->search.inq_params,
                                    bta_dm_inq_results_cb,
                                    (tBTM_CMPL_CB*)bta_dm_inq_cmpl_cb);
@@ -1167,6 +1192,11 @@ void bta_dm_search_cancel(UNUSED_ATTR tBTA_DM_MSG* p_data) {
   tBTA_DM_MSG* p_msg;
 
   if (BTM_IsInquiryActive()) {
+    /* a device found by the inquiry may be asked for its name */
+    if (bta_dm_search_cb.p_btm_inq_info != NULL &&
+        !bta_dm_search_cb.disc_idle && !bta_dm_search_cb.name_discover_done)
+      BTM_CancelRemoteDeviceName();
+
     if (BTM_CancelInquiry() == BTM_SUCCESS) {
       bta_dm_search_cancel_notify(NULL);
       p_msg = (tBTA_DM_MSG*)osi_malloc(sizeof(tBTA_DM_MSG));
@@ -1365,6 +1395,7 @@ static bool bta_dm_read_remote_device_name(BD_ADDR bd_addr,
 
   bdcpy(bta_dm_search_cb.peer_bdaddr, bd_addr);
   bta_dm_search_cb.peer_name[0] = 0;
+  bta_dm_search_cb.name_transport = transport;
 
   btm_status =
       BTM_ReadRemoteDeviceName(bta_dm_search_cb.peer_bdaddr,
@@ -1395,6 +1426,82 @@ static bool bta_dm_read_remote_device_name(BD_ADDR bd_addr,
   }
 }
 
+#if (BTA_DM_NAME_CACHE_SIZE > 0)
+typedef struct {
+  bool in_use;
+  BD_ADDR bd_addr;
+  BD_NAME bd_name;
+  period_ms_t resolved_ms;
+} tBTA_DM_NAME_CACHE_ENT;
+
+static tBTA_DM_NAME_CACHE_ENT bta_dm_name_cache[BTA_DM_NAME_CACHE_SIZE];
+#endif
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_name_cache_put
+ *
+ * Description      Remembers the name read from a remote device, replacing
+ *                  the name read the longest ago if the cache is full.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_name_cache_put(UNUSED_ATTR BD_ADDR bd_addr,
+                                  UNUSED_ATTR BD_NAME bd_name) {
+#if (BTA_DM_NAME_CACHE_SIZE > 0)
+  tBTA_DM_NAME_CACHE_ENT* p_ent = &bta_dm_name_cache[0];
+
+  for (int i = 0; i < BTA_DM_NAME_CACHE_SIZE; i++) {
+    tBTA_DM_NAME_CACHE_ENT* p = &bta_dm_name_cache[i];
+    if (p->in_use && !bdcmp(p->bd_addr, bd_addr)) {
+      p_ent = p;
+      break;
+    }
+    if (!p->in_use) {
+      if (p_ent->in_use) p_ent = p;
+    } else if (p_ent->in_use && p->resolved_ms < p_ent->resolved_ms) {
+      p_ent = p;
+    }
+  }
+
+  p_ent->in_use = true;
+  bdcpy(p_ent->bd_addr, bd_addr);
+  strlcpy((char*)p_ent->bd_name, (char*)bd_name, BD_NAME_LEN);
+  p_ent->resolved_ms = time_get_os_boottime_ms();
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_name_cache_get
+ *
+ * Description      Looks up the name read from a remote device less than
+ *                  BTA_DM_NAME_CACHE_TIMEOUT_MS ago.
+ *
+ * Returns          true if found, the name being copied to bd_name
+ *
+ ******************************************************************************/
+static bool bta_dm_name_cache_get(UNUSED_ATTR BD_ADDR bd_addr,
+                                  UNUSED_ATTR BD_NAME bd_name) {
+#if (BTA_DM_NAME_CACHE_SIZE > 0)
+  for (int i = 0; i < BTA_DM_NAME_CACHE_SIZE; i++) {
+    tBTA_DM_NAME_CACHE_ENT* p_ent = &bta_dm_name_cache[i];
+    if (!p_ent->in_use || bdcmp(p_ent->bd_addr, bd_addr)) continue;
+
+    if (time_get_os_boottime_ms() - p_ent->resolved_ms >=
+        BTA_DM_NAME_CACHE_TIMEOUT_MS) {
+      p_ent->in_use = false;
+      return false;
+    }
+
+    strlcpy((char*)bd_name, (char*)p_ent->bd_name, BD_NAME_LEN);
+    return true;
+  }
+#endif
+  return false;
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_inq_cmpl
@@ -1412,6 +1519,16 @@ void bta_dm_inq_cmpl(tBTA_DM_MSG* p_data) {
   data.inq_cmpl.num_resps = p_data->inq_cmpl.num;
   bta_dm_search_cb.p_search_cback(BTA_DM_INQ_CMPL_EVT, &data);
 
+  bta_dm_search_cb.inq_done = true;
+  if (bta_dm_search_cb.p_btm_inq_info != NULL) {
+    /* the devices found are being discovered, the last one ends the search */
+    if (bta_dm_search_cb.disc_idle) {
+      bta_dm_search_cb.disc_idle = false;
+      bta_dm_discover_next_device();
+    }
+    return;
+  }
+
   bta_dm_search_cb.p_btm_inq_info = BTM_InqDbFirst();
   if (bta_dm_search_cb.p_btm_inq_info != NULL) {
     /* start name and service discovery from the first device on inquiry result
@@ -2045,8 +2162,15 @@ static void bta_dm_discover_next_device(void) {
   APPL_TRACE_DEBUG("bta_dm_discover_next_device");
 
   /* searching next device on inquiry result */
-  bta_dm_search_cb.p_btm_inq_info =
-      BTM_InqDbNext(bta_dm_search_cb.p_btm_inq_info);
+  tBTM_INQ_INFO* p_next = BTM_InqDbNext(bta_dm_search_cb.p_btm_inq_info);
+  if (p_next == NULL && !bta_dm_search_cb.inq_done &&
+      bta_dm_search_cb.state == BTA_DM_SEARCH_ACTIVE) {
+    /* wait for the inquiry to find more devices */
+    bta_dm_search_cb.disc_idle = true;
+    return;
+  }
+
+  bta_dm_search_cb.p_btm_inq_info = p_next;
   if (bta_dm_search_cb.p_btm_inq_info != NULL) {
     bta_dm_search_cb.name_discover_done = false;
     bta_dm_search_cb.peer_name[0] = 0;
@@ -2117,11 +2241,19 @@ static void bta_dm_discover_device(BD_ADDR remote_bd_addr) {
       ((bta_dm_search_cb.p_btm_inq_info == NULL) ||
        (bta_dm_search_cb.p_btm_inq_info &&
         (!bta_dm_search_cb.p_btm_inq_info->appl_knows_rem_name)))) {
-    if (bta_dm_read_remote_device_name(bta_dm_search_cb.peer_bdaddr,
-                                       transport) == true)
+    /* a name read by a recent search is not asked for again, as the remote
+     * name request may page the device for long */
+    if (transport == BT_TRANSPORT_BR_EDR &&
+        bta_dm_name_cache_get(bta_dm_search_cb.peer_bdaddr,
+                              bta_dm_search_cb.peer_name)) {
+      APPL_TRACE_DEBUG("%s remote name cached <%s>", __func__,
+                       bta_dm_search_cb.peer_name);
+    } else if (bta_dm_read_remote_device_name(bta_dm_search_cb.peer_bdaddr,
+                                              transport) == true) {
       return;
+    }
 
-    /* starting name discovery failed */
+    /* name discovery is done, or starting it failed */
     bta_dm_search_cb.name_discover_done = true;
   }
 
@@ -2262,9 +2394,80 @@ static void bta_dm_inq_results_cb(tBTM_INQ_RESULTS* p_inq, uint8_t* p_eir,
      copy that to the inquiry data base*/
     if (result.inq_res.remt_name_not_required)
       p_inq_info->appl_knows_rem_name = true;
+
+    if (bta_dm_search_cb.state == BTA_DM_SEARCH_ACTIVE &&
+        !bta_dm_search_cb.inq_done) {
+      /* discover the device without waiting for the inquiry to complete */
+      if (p_bta_dm_cfg->disc_during_inq &&
+          (bta_dm_search_cb.p_btm_inq_info == NULL ||
+           bta_dm_search_cb.disc_idle))
+        do_in_bta_thread(FROM_HERE, base::Bind(&bta_dm_inq_disc_resume));
+
+      /* the only device the inquiry may find is found */
+      if (bta_dm_search_cb.has_target &&
+          !bdcmp(p_inq->remote_bd_addr, bta_dm_search_cb.target_bda))
+        do_in_bta_thread(FROM_HERE, base::Bind(&bta_dm_inq_target_found));
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_inq_disc_resume
+ *
+ * Description      Starts name and service discovery on the devices found
+ *                  since the last one was discovered, while the inquiry
+ *                  goes on
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_inq_disc_resume(void) {
+  if (bta_dm_search_cb.state != BTA_DM_SEARCH_ACTIVE ||
+      bta_dm_search_cb.inq_done)
+    return;
+
+  if (bta_dm_search_cb.p_btm_inq_info == NULL) {
+    bta_dm_search_cb.p_btm_inq_info = BTM_InqDbFirst();
+    if (bta_dm_search_cb.p_btm_inq_info == NULL) return;
+
+    APPL_TRACE_DEBUG("%s first device found", __func__);
+    bta_dm_search_cb.name_discover_done = false;
+    bta_dm_search_cb.peer_name[0] = 0;
+    bta_dm_discover_device(
+        bta_dm_search_cb.p_btm_inq_info->results.remote_bd_addr);
+  } else if (bta_dm_search_cb.disc_idle) {
+    bta_dm_search_cb.disc_idle = false;
+    bta_dm_discover_next_device();
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_inq_target_found
+ *
+ * Description      Ends the inquiry once the device it is filtered on is
+ *                  found, as it cannot find any other
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_inq_target_found(void) {
+  if (bta_dm_search_cb.state != BTA_DM_SEARCH_ACTIVE ||
+      bta_dm_search_cb.inq_done || bta_dm_search_cb.cancel_pending ||
+      !BTM_IsInquiryActive())
+    return;
+
+  APPL_TRACE_EVENT("%s ending the inquiry early", __func__);
+  if (BTM_CancelInquiry() != BTM_SUCCESS) return;
+
+  /* the inquiry complete callback is not called once cancelled */
+  tBTM_INQUIRY_CMPL result;
+  result.status = BTM_SUCCESS;
+  result.num_resp = btm_cb.btm_inq_vars.inq_cmpl_info.num_resp;
+  bta_dm_inq_cmpl_cb((void*)&result);
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_inq_cmpl_cb
@@ -2363,6 +2566,12 @@ static void bta_dm_remname_cback(tBTM_REMOTE_DEV_NAME* p_remote_name) {
   strlcpy((char*)bta_dm_search_cb.peer_name,
           (char*)p_remote_name->remote_bd_name, BD_NAME_LEN);
 
+  if (p_remote_name->status == BTM_SUCCESS &&
+      bta_dm_search_cb.peer_name[0] &&
+      bta_dm_search_cb.name_transport == BT_TRANSPORT_BR_EDR)
+    bta_dm_name_cache_put(bta_dm_search_cb.peer_bdaddr,
+                          bta_dm_search_cb.peer_name);
+
   BTM_SecDeleteRmtNameNotifyCallback(&bta_dm_service_search_remname_cback);
 
   if (bta_dm_search_cb.transport == BT_TRANSPORT_LE) {
@@ -2951,6 +3160,10 @@ void bta_dm_acl_change(tBTA_DM_MSG* p_data) {
             "bta_dm_acl_change role chg info:x%x new_role:%d dev count:%d",
             p_dev->info, p_data->acl_change.new_role,
             bta_dm_cb.device_list.count);
+        if (p_data->acl_change.hci_status != HCI_SUCCESS)
+          p_dev->rs_failures++;
+        else if (p_data->acl_change.new_role == HCI_ROLE_MASTER)
+          p_dev->rs_failures = 0;
         if (p_dev->info & BTA_DM_DI_AV_ACTIVE) {
           /* there's AV activity on this link */
           if (p_data->acl_change.new_role == HCI_ROLE_SLAVE &&
@@ -3025,6 +3238,8 @@ void bta_dm_acl_change(tBTA_DM_MSG* p_data) {
 
     bta_dm_cb.device_list.peer_device[i].conn_state = BTA_DM_CONNECTED;
     bta_dm_cb.device_list.peer_device[i].pref_role = BTA_ANY_ROLE;
+    bta_dm_cb.device_list.peer_device[i].rs_failures = 0;
+    bta_dm_cb.device_list.peer_device[i].p_role_reason = NULL;
     bdcpy(conn.link_up.bd_addr, p_bda);
     bta_dm_cb.device_list.peer_device[i].info = BTA_DM_DI_NONE;
     conn.link_up.link_type = p_data->acl_change.transport;
@@ -3311,40 +3526,24 @@ static void bta_dm_adjust_roles(bool delay_role_switch) {
       set_master_role = true;
     }
 
-    for (i = 0; i < bta_dm_cb.device_list.count; i++) {
-      if (bta_dm_cb.device_list.peer_device[i].conn_state == BTA_DM_CONNECTED &&
-          bta_dm_cb.device_list.peer_device[i].transport ==
-              BT_TRANSPORT_BR_EDR) {
-        if (!set_master_role &&
-            (bta_dm_cb.device_list.peer_device[i].pref_role != BTA_ANY_ROLE) &&
+    /* the links streaming AV are switched first, their bandwidth suffering
+     * the most from a scatternet */
+    for (int pass = 0; pass < 2; pass++) {
+      for (i = 0; i < bta_dm_cb.device_list.count; i++) {
+        tBTA_DM_PEER_DEVICE* p_dev = &bta_dm_cb.device_list.peer_device[i];
+        if (p_dev->conn_state != BTA_DM_CONNECTED ||
+            p_dev->transport != BT_TRANSPORT_BR_EDR)
+          continue;
+        if (((p_dev->info & BTA_DM_DI_AV_ACTIVE) != 0) != (pass == 0))
+          continue;
+
+        if (!set_master_role && (p_dev->pref_role != BTA_ANY_ROLE) &&
             (p_bta_dm_rm_cfg[0].cfg == BTA_DM_PARTIAL_SCATTERNET)) {
           L2CA_SetDesireRole(HCI_ROLE_MASTER);
           set_master_role = true;
         }
 
-        if ((bta_dm_cb.device_list.peer_device[i].pref_role ==
-             BTA_MASTER_ROLE_ONLY) ||
-            (br_count > 1)) {
-          /* Initiating immediate role switch with certain remote devices
-            has caused issues due to role  switch colliding with link encryption
-            setup and
-            causing encryption (and in turn the link) to fail .  These device .
-            Firmware
-            versions are stored in a blacklist and role switch with these
-            devices are
-            delayed to avoid the collision with link encryption setup */
-
-          if (bta_dm_cb.device_list.peer_device[i].pref_role !=
-                  BTA_SLAVE_ROLE_ONLY &&
-              delay_role_switch == false) {
-            BTM_SwitchRole(bta_dm_cb.device_list.peer_device[i].peer_bdaddr,
-                           HCI_ROLE_MASTER, NULL);
-          } else {
-            alarm_set_on_queue(
-                bta_dm_cb.switch_delay_timer, BTA_DM_SWITCH_DELAY_TIMER_MS,
-                bta_dm_delay_role_switch_cback, NULL, btu_bta_alarm_queue);
-          }
-        }
+        bta_dm_adjust_role(p_dev, br_count, delay_role_switch);
       }
     }
 
@@ -3357,6 +3556,105 @@ static void bta_dm_adjust_roles(bool delay_role_switch) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_adjust_role
+ *
+ * Description      Decides the role of a connected BR/EDR link: master if a
+ *                  service requires it, or if there are several links, so
+ *                  that they all are in the piconet of the local device.
+ *                  The role switch is not asked for again to a peer which
+ *                  refused it BTA_DM_RS_MAX_FAILURES times, nor to the links
+ *                  of the services requiring the slave role.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void bta_dm_adjust_role(tBTA_DM_PEER_DEVICE* p_dev, uint8_t br_count,
+                               bool delay_role_switch) {
+  uint8_t role;
+
+  if (p_dev->pref_role != BTA_MASTER_ROLE_ONLY && br_count <= 1) {
+    p_dev->p_role_reason = "single link";
+    return;
+  }
+  if (p_dev->pref_role == BTA_SLAVE_ROLE_ONLY) {
+    p_dev->p_role_reason = "slave required by a service";
+    return;
+  }
+  if (BTM_GetRole(p_dev->peer_bdaddr, &role) == BTM_SUCCESS &&
+      role == HCI_ROLE_MASTER) {
+    p_dev->p_role_reason = "master";
+    return;
+  }
+  if (p_dev->rs_failures >= BTA_DM_RS_MAX_FAILURES) {
+    p_dev->p_role_reason = "role switch refused by the peer";
+    return;
+  }
+
+  /* Initiating immediate role switch with certain remote devices has caused
+   * issues due to role switch colliding with link encryption setup and
+   * causing encryption (and in turn the link) to fail. These device Firmware
+   * versions are stored in a blacklist and role switch with these devices are
+   * delayed to avoid the collision with link encryption setup */
+  if (delay_role_switch) {
+    p_dev->p_role_reason = "switch to master delayed";
+    alarm_set_on_queue(bta_dm_cb.switch_delay_timer,
+                       BTA_DM_SWITCH_DELAY_TIMER_MS,
+                       bta_dm_delay_role_switch_cback, NULL,
+                       btu_bta_alarm_queue);
+    return;
+  }
+
+  p_dev->p_role_reason = (br_count > 1) ? "switch to master, several links"
+                                        : "switch to master, required";
+  BTM_SwitchRole(p_dev->peer_bdaddr, HCI_ROLE_MASTER, NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_dump_topology
+ *
+ * Description      Dumps the connected devices, their roles and the role
+ *                  decisions made for them to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_dm_dump_topology(int fd) {
+  dprintf(fd, "\nBluetooth Link Topology:\n");
+  dprintf(fd, "  Links: %d (LE: %d) AV streams: %d scatternet: %d\n",
+          bta_dm_cb.device_list.count, bta_dm_cb.device_list.le_count,
+          bta_dm_cb.cur_av_count, p_bta_dm_rm_cfg[0].cfg);
+
+  for (int i = 0; i < bta_dm_cb.device_list.count; i++) {
+    const tBTA_DM_PEER_DEVICE* p_dev = &bta_dm_cb.device_list.peer_device[i];
+    uint8_t role = HCI_ROLE_UNKNOWN;
+    BTM_GetRole((uint8_t*)p_dev->peer_bdaddr, &role);
+
+    dprintf(fd,
+            "  %02x:%02x:%02x:%02x:%02x:%02x %s role: %s preferred: %d "
+            "AV: %s\n",
+            p_dev->peer_bdaddr[0], p_dev->peer_bdaddr[1],
+            p_dev->peer_bdaddr[2], p_dev->peer_bdaddr[3],
+            p_dev->peer_bdaddr[4], p_dev->peer_bdaddr[5],
+            (p_dev->transport == BT_TRANSPORT_LE) ? "LE" : "BR/EDR",
+            (role == HCI_ROLE_MASTER)
+                ? "master"
+                : (role == HCI_ROLE_SLAVE) ? "slave" : "unknown",
+            p_dev->pref_role,
+            (p_dev->info & BTA_DM_DI_AV_ACTIVE) ? "streaming" : "idle");
+    dprintf(fd,
+            "    Policy: switch %s sniff %s failed switches: %d "
+            "decision: %s\n",
+            (p_dev->link_policy & HCI_ENABLE_MASTER_SLAVE_SWITCH) ? "on"
+                                                                 : "off",
+            (p_dev->link_policy & HCI_ENABLE_SNIFF_MODE) ? "on" : "off",
+            p_dev->rs_failures,
+            p_dev->p_role_reason ? p_dev->p_role_reason : "none");
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_get_remname
@@ -4210,6 +4508,69 @@ void bta_dm_add_ble_device(tBTA_DM_MSG* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_dm_add_bonded_devices
+ *
+ * Description      This function adds the bonded devices restored from the
+ *                  NVRAM to the security database, with their BR/EDR and LE
+ *                  keys, in the order bta_dm_add_device, bta_dm_add_ble_device
+ *                  and bta_dm_add_blekey would for each of them.
+ *
+ * Parameters:
+ *
+ ******************************************************************************/
+void bta_dm_add_bonded_devices(tBTA_DM_MSG* p_data) {
+  tBTA_DM_API_ADD_BONDED_DEVICES* p_msg = &p_data->add_bonded_devs;
+  uint32_t trusted_services_mask[BTM_SEC_SERVICE_ARRAY_SIZE];
+  uint8_t
+      features[BTA_FEATURE_BYTES_PER_PAGE * (BTA_EXT_FEATURES_PAGE_MAX + 1)];
+  BD_NAME bd_name;
+
+  memset(trusted_services_mask, 0, sizeof(trusted_services_mask));
+  memset(features, 0, sizeof(features));
+  memset(bd_name, 0, sizeof(bd_name));
+
+  APPL_TRACE_DEBUG("%s: %d devices", __func__, p_msg->num_devs);
+
+  for (uint16_t i = 0; i < p_msg->num_devs; i++) {
+    tBTA_DM_BONDED_DEV* p_dev = &p_msg->p_devs[i];
+
+    if (p_dev->link_key_known &&
+        !BTM_SecAddDevice(p_dev->bd_addr, p_dev->dc,
+                          bd_name, features, trusted_services_mask,
+                          p_dev->link_key, p_dev->key_type, 0,
+                          p_dev->pin_length)) {
+      APPL_TRACE_ERROR("BTA_DM: Error adding device %08x%04x",
+                       (p_dev->bd_addr[0] << 24) + (p_dev->bd_addr[1] << 16) +
+                           (p_dev->bd_addr[2] << 8) + p_dev->bd_addr[3],
+                       (p_dev->bd_addr[4] << 8) + p_dev->bd_addr[5]);
+    }
+
+    if (p_dev->num_le_keys == 0) continue;
+
+    if (!BTM_SecAddBleDevice(p_dev->bd_addr, NULL, BT_DEVICE_TYPE_BLE,
+                             p_dev->addr_type)) {
+      APPL_TRACE_ERROR("BTA_DM: Error adding BLE Device for device %08x%04x",
+                       (p_dev->bd_addr[0] << 24) + (p_dev->bd_addr[1] << 16) +
+                           (p_dev->bd_addr[2] << 8) + p_dev->bd_addr[3],
+                       (p_dev->bd_addr[4] << 8) + p_dev->bd_addr[5]);
+    }
+
+    for (uint8_t k = 0; k < p_dev->num_le_keys; k++) {
+      if (!BTM_SecAddBleKey(p_dev->bd_addr,
+                            (tBTM_LE_KEY_VALUE*)&p_dev->le_keys[k],
+                            p_dev->le_key_types[k])) {
+        APPL_TRACE_ERROR("BTA_DM: Error adding BLE Key for device %08x%04x",
+                         (p_dev->bd_addr[0] << 24) +
+                             (p_dev->bd_addr[1] << 16) +
+                             (p_dev->bd_addr[2] << 8) + p_dev->bd_addr[3],
+                         (p_dev->bd_addr[4] << 8) + p_dev->bd_addr[5]);
+      }
+    }
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_dm_add_ble_device
@@ -652,6 +652,36 @@ void BTA_DmAddBleDevice(BD_ADDR bd_addr, tBLE_ADDR_TYPE addr_type,
   bta_sys_sendmsg(p_msg);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_DmAddBondedDevices
+ *
+ * Description      Add the bonded devices restored from the NVRAM at once,
+ *                  with their BR/EDR and LE keys.
+ *
+ * Parameters:      p_devs           - The bonded devices, copied.
+ *                  num_devs         - The number of devices.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_DmAddBondedDevices(const tBTA_DM_BONDED_DEV* p_devs,
+                            uint16_t num_devs) {
+  if (num_devs == 0) return;
+
+  size_t devs_size = num_devs * sizeof(tBTA_DM_BONDED_DEV);
+  tBTA_DM_API_ADD_BONDED_DEVICES* p_msg =
+      (tBTA_DM_API_ADD_BONDED_DEVICES*)osi_malloc(
+          sizeof(tBTA_DM_API_ADD_BONDED_DEVICES) + devs_size);
+
+  p_msg->hdr.event = BTA_DM_API_ADD_BONDED_DEVICES_EVT;
+  p_msg->num_devs = num_devs;
+  p_msg->p_devs = (tBTA_DM_BONDED_DEV*)(p_msg + 1);
+  memcpy(p_msg->p_devs, p_devs, devs_size);
+
+  bta_sys_sendmsg(p_msg);
+}
+
 /*******************************************************************************
  *
  * Function         BTA_DmBlePasskeyReply
@@ -1198,4 +1228,19 @@ void BTA_VendorCleanup(void) {
   if (cmn_ble_vsc_cb.tot_scan_results_strg > 0) btm_ble_batchscan_cleanup();
 
   if (cmn_ble_vsc_cb.adv_inst_max > 0) btm_ble_multi_adv_cleanup();
+
+  btm_ble_energy_sampling_cleanup();
 }
+
+/*******************************************************************************
+ *
+ * Function         BTA_DmDumpTopology
+ *
+ * Description      This function dumps the connected devices, their roles
+ *                  and link policies, and the role decisions made for them,
+ *                  to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_DmDumpTopology(int fd) { bta_dm_dump_topology(fd); }
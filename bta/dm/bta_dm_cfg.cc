@@ -52,6 +52,11 @@
 #define BTA_DM_AVOID_SCATTER_A2DP TRUE
 #endif
 
+/* TRUE to discover the devices found while the inquiry goes on */
+#ifndef BTA_DM_DISC_DURING_INQUIRY
+#define BTA_DM_DISC_DURING_INQUIRY TRUE
+#endif
+
 /* For Insight, PM cfg lookup tables are runtime configurable (to allow tweaking
  * of params for power consumption measurements) */
 #ifndef BTE_SIM_APP
@@ -70,7 +75,9 @@ const tBTA_DM_CFG bta_dm_cfg = {
     /* link supervision timeout in 625uS*/
     BTA_DM_LINK_TIMEOUT,
     /* true to avoid scatternet when av is streaming (be the master) */
-    BTA_DM_AVOID_SCATTER_A2DP};
+    BTA_DM_AVOID_SCATTER_A2DP,
+    /* true to discover the devices found while the inquiry goes on */
+    BTA_DM_DISC_DURING_INQUIRY};
 
 #ifndef BTA_DM_SCATTERNET
 /* By default, allow partial scatternet */
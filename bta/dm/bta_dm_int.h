@@ -96,6 +96,7 @@ enum {
   BTA_DM_API_EXECUTE_CBACK_EVT,
   BTA_DM_API_REMOVE_ALL_ACL_EVT,
   BTA_DM_API_REMOVE_DEVICE_EVT,
+  BTA_DM_API_ADD_BONDED_DEVICES_EVT,
   BTA_DM_MAX_EVT
 };
 
@@ -338,6 +339,13 @@ typedef struct {
 
 } tBTA_DM_API_ADD_BLE_DEVICE;
 
+/* data type for BTA_DM_API_ADD_BONDED_DEVICES_EVT */
+typedef struct {
+  BT_HDR hdr;
+  uint16_t num_devs;
+  tBTA_DM_BONDED_DEV* p_devs; /* follows the message */
+} tBTA_DM_API_ADD_BONDED_DEVICES;
+
 typedef struct {
   BT_HDR hdr;
   BD_ADDR bd_addr;
@@ -493,6 +501,7 @@ typedef union {
 
   tBTA_DM_API_ADD_BLEKEY add_ble_key;
   tBTA_DM_API_ADD_BLE_DEVICE add_ble_device;
+  tBTA_DM_API_ADD_BONDED_DEVICES add_bonded_devs;
   tBTA_DM_API_PASSKEY_REPLY ble_passkey_reply;
   tBTA_DM_API_BLE_SEC_GRANT ble_sec_grant;
   tBTA_DM_API_BLE_CONN_PARAMS ble_set_conn_params;
@@ -548,6 +557,9 @@ typedef struct {
 #endif
   tBTA_DM_PM_ACTION pm_mode_attempted;
   tBTA_DM_PM_ACTION pm_mode_failed;
+  period_ms_t pm_sniff_deferred_ms; /* time the sniff timer was extended */
+  uint8_t rs_failures;         /* role switches that failed in a row */
+  const char* p_role_reason;   /* the last role decision, for the dump */
   bool remove_dev_pending;
   uint16_t conn_handle;
   tBT_TRANSPORT transport;
@@ -664,6 +676,7 @@ typedef struct {
   BD_ADDR peer_bdaddr;
   bool name_discover_done;
   BD_NAME peer_name;
+  tBT_TRANSPORT name_transport; /* of the remote name request */
   alarm_t* search_timer;
   uint8_t service_index;
   tBTA_DM_MSG* p_search_queue; /* search or discover commands during search
@@ -674,6 +687,10 @@ typedef struct {
   uint8_t peer_scn;
   bool sdp_search;
   bool cancel_pending; /* inquiry cancel is pending */
+  bool inq_done;  /* inquiry complete, the last device discovered ends search */
+  bool disc_idle; /* name and service discovery waits for inquiry results */
+  bool has_target; /* the inquiry is filtered on the address of one device */
+  BD_ADDR target_bda; /* the device the inquiry is filtered on */
   tBTA_TRANSPORT transport;
   tBTA_DM_SEARCH_CBACK* p_scan_cback;
   tBTA_GATTC_IF client_if;
@@ -716,6 +733,8 @@ typedef struct {
   uint16_t link_timeout; /* link supervision timeout in slots */
   bool avoid_scatter; /* true to avoid scatternet when av is streaming (be the
                          master) */
+  bool disc_during_inq; /* true to discover names and services of the devices
+                           found while the inquiry goes on */
 
 } tBTA_DM_CFG;
 
@@ -814,6 +833,7 @@ extern void bta_dm_add_ampkey(tBTA_DM_MSG* p_data);
 
 extern void bta_dm_add_blekey(tBTA_DM_MSG* p_data);
 extern void bta_dm_add_ble_device(tBTA_DM_MSG* p_data);
+extern void bta_dm_add_bonded_devices(tBTA_DM_MSG* p_data);
 extern void bta_dm_ble_passkey_reply(tBTA_DM_MSG* p_data);
 extern void bta_dm_ble_confirm_reply(tBTA_DM_MSG* p_data);
 extern void bta_dm_security_grant(tBTA_DM_MSG* p_data);
@@ -870,4 +890,5 @@ extern void bta_dm_disable_test_mode(tBTA_DM_MSG* p_data);
 extern void bta_dm_execute_callback(tBTA_DM_MSG* p_data);
 
 extern void bta_dm_remove_all_acl(tBTA_DM_MSG* p_data);
+extern void bta_dm_dump_topology(int fd);
 #endif /* BTA_DM_INT_H */
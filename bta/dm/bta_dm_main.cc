@@ -91,6 +91,7 @@ const tBTA_DM_ACTION bta_dm_action[] = {
 
     bta_dm_remove_all_acl, /* BTA_DM_API_REMOVE_ALL_ACL_EVT */
     bta_dm_remove_device,  /* BTA_DM_API_REMOVE_DEVICE_EVT */
+    bta_dm_add_bonded_devices, /* BTA_DM_API_ADD_BONDED_DEVICES_EVT */
 };
 
 /* state machine action enumeration list */
@@ -24,6 +24,7 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <inttypes.h>
 #include <string.h>
 
 #include "bt_common.h"
@@ -51,6 +52,7 @@ static void bta_dm_pm_set_sniff_policy(tBTA_DM_PEER_DEVICE* p_dev,
                                        bool bDisable);
 static void bta_dm_pm_stop_timer_by_index(tBTA_PM_TIMER* p_timer,
                                           uint8_t timer_idx);
+static period_ms_t bta_dm_pm_sniff_defer_ms(tBTA_DM_PEER_DEVICE* p_peer_dev);
 
 #if (BTM_SSR_INCLUDED == TRUE)
 #if (BTA_HH_INCLUDED == TRUE)
@@ -573,6 +575,18 @@ static void bta_dm_pm_set_mode(BD_ADDR peer_addr, tBTA_DM_PM_ACTION pm_request,
       }
     }
   }
+  /* if the sniff timer expired, the link may still be about to be used */
+  if (pm_req == BTA_DM_PM_EXECUTE && (pm_action & BTA_DM_PM_SNIFF) &&
+      pm_request >= pm_action) {
+    timeout_ms = bta_dm_pm_sniff_defer_ms(p_peer_device);
+    if (timeout_ms > 0)
+      pm_req = BTA_DM_PM_RESTART;
+    else
+      p_peer_device->pm_sniff_deferred_ms = 0;
+  } else {
+    p_peer_device->pm_sniff_deferred_ms = 0;
+  }
+
   /* if need to start a timer */
   if ((pm_req != BTA_DM_PM_EXECUTE) && (timeout_ms > 0)) {
     for (i = 0; i < BTA_DM_NUM_PM_TIMER; i++) {
@@ -643,6 +657,55 @@ static void bta_dm_pm_set_mode(BD_ADDR peer_addr, tBTA_DM_PM_ACTION pm_request,
     bta_dm_pm_active(peer_addr);
   }
 }
+
+/*******************************************************************************
+ *
+ * Function         bta_dm_pm_sniff_defer_ms
+ *
+ * Description      Checks the traffic of a link whose sniff timer expired.
+ *                  The link is kept active if it had traffic lately, or if
+ *                  its pause is predicted to end soon, so that the traffic
+ *                  resuming does not wait for the link to leave sniff mode.
+ *                  The HID links are not kept active, as their traffic is
+ *                  sparse but not tolerated to be delayed by the deferral.
+ *
+ * Returns          the time to wait before trying sniff mode again, or 0 to
+ *                  go to sniff mode now.
+ *
+ ******************************************************************************/
+static period_ms_t bta_dm_pm_sniff_defer_ms(tBTA_DM_PEER_DEVICE* p_peer_dev) {
+  period_ms_t idle_ms = 0;
+  period_ms_t predicted_ms = 0;
+  period_ms_t defer_ms = 0;
+
+  for (int i = 0; i < bta_dm_conn_srvcs.count; i++) {
+    if (bta_dm_conn_srvcs.conn_srvc[i].id == BTA_ID_HH &&
+        !bdcmp(bta_dm_conn_srvcs.conn_srvc[i].peer_bdaddr,
+               p_peer_dev->peer_bdaddr))
+      return 0;
+  }
+
+  if (BTM_PmReadIdle(p_peer_dev->peer_bdaddr, &idle_ms, &predicted_ms) !=
+      BTM_SUCCESS)
+    return 0;
+
+  if (idle_ms < BTA_DM_PM_SNIFF_MIN_IDLE_MS)
+    defer_ms = BTA_DM_PM_SNIFF_MIN_IDLE_MS - idle_ms;
+  else if (predicted_ms > idle_ms &&
+           predicted_ms - idle_ms <= BTA_DM_PM_SNIFF_RESUME_MS)
+    defer_ms = predicted_ms - idle_ms;
+
+  if (defer_ms == 0 || p_peer_dev->pm_sniff_deferred_ms + defer_ms >
+                           BTA_DM_PM_SNIFF_MAX_DEFER_MS)
+    return 0;
+
+  p_peer_dev->pm_sniff_deferred_ms += defer_ms;
+  APPL_TRACE_DEBUG("%s: sniff deferred by %" PRIu64 " ms, idle for %" PRIu64
+                   " ms of %" PRIu64 " ms",
+                   __func__, defer_ms, idle_ms, predicted_ms);
+  return defer_ms;
+}
+
 /*******************************************************************************
  *
  * Function         bta_ag_pm_park
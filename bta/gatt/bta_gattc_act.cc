@@ -110,6 +110,7 @@ static void bta_gattc_enable() {
     /* initialize control block */
     memset(&bta_gattc_cb, 0, sizeof(tBTA_GATTC_CB));
     bta_gattc_cb.state = BTA_GATTC_STATE_ENABLED;
+    bta_gattc_cache_init();
   } else {
     APPL_TRACE_DEBUG("GATTC is arelady enabled");
   }
@@ -154,6 +155,7 @@ void bta_gattc_disable() {
   if (bta_gattc_cb.state != BTA_GATTC_STATE_DISABLING) {
     memset(&bta_gattc_cb, 0, sizeof(tBTA_GATTC_CB));
     bta_gattc_cb.state = BTA_GATTC_STATE_DISABLED;
+    bta_gattc_cache_cleanup();
   }
 }
 
@@ -430,6 +432,9 @@ void bta_gattc_open_fail(tBTA_GATTC_CLCB* p_clcb,
 void bta_gattc_open(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
   tBTA_GATTC_DATA gattc_data;
 
+  /* the cache is read while the connection is set up */
+  bta_gattc_cache_preload(p_data->api_conn.remote_bda);
+
   /* open/hold a connection */
   if (!GATT_Connect(p_clcb->p_rcb->client_if, p_data->api_conn.remote_bda, true,
                     p_data->api_conn.transport, p_data->api_conn.opportunistic,
@@ -466,6 +471,9 @@ void bta_gattc_init_bk_conn(tBTA_GATTC_API_OPEN* p_data,
   tBTA_GATTC_DATA gattc_data;
 
   if (bta_gattc_mark_bg_conn(p_data->client_if, p_data->remote_bda, true)) {
+    /* the cache is read before the device shows up */
+    bta_gattc_cache_preload(p_data->remote_bda);
+
     /* always call open to hold a connection */
     if (!GATT_Connect(p_data->client_if, p_data->remote_bda, false,
                       p_data->transport, false)) {
@@ -845,7 +853,9 @@ void bta_gattc_start_discover(tBTA_GATTC_CLCB* p_clcb,
       bta_gattc_set_discover_st(p_clcb->p_srcb);
 
       p_clcb->status = bta_gattc_init_cache(p_clcb->p_srcb);
-      if (p_clcb->status == BTA_GATT_OK) {
+      /* the discovery starts, or is skipped for a known database, once the
+       * Database Hash is read */
+      if (p_clcb->status == BTA_GATT_OK && !bta_gattc_read_db_hash(p_clcb)) {
         p_clcb->status = bta_gattc_discover_pri_service(
             p_clcb->bta_conn_id, p_clcb->p_srcb, GATT_DISC_SRVC_ALL);
       }
@@ -888,10 +898,7 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB* p_clcb,
 
   if (p_clcb->status != GATT_SUCCESS) {
     /* clean up cache */
-    if (p_clcb->p_srcb && p_clcb->p_srcb->p_srvc_cache) {
-      list_free(p_clcb->p_srcb->p_srvc_cache);
-      p_clcb->p_srcb->p_srvc_cache = NULL;
-    }
+    if (p_clcb->p_srcb) bta_gattc_clear_cache(p_clcb->p_srcb);
 
     /* used to reset cache in application */
     bta_gattc_cache_reset(p_clcb->p_srcb->server_bda);
@@ -1333,6 +1340,7 @@ static void bta_gattc_deregister_cmpl(tBTA_GATTC_RCB* p_clreg) {
   if (bta_gattc_num_reg_app() == 0 &&
       bta_gattc_cb.state == BTA_GATTC_STATE_DISABLING) {
     bta_gattc_cb.state = BTA_GATTC_STATE_DISABLED;
+    bta_gattc_cache_cleanup();
   }
 }
 /*******************************************************************************
@@ -1442,10 +1450,7 @@ void bta_gattc_process_api_refresh(tBTA_GATTC_DATA* p_msg) {
       }
     }
     /* in all other cases, mark it and delete the cache */
-    if (p_srvc_cb->p_srvc_cache != NULL) {
-      list_free(p_srvc_cb->p_srvc_cache);
-      p_srvc_cb->p_srvc_cache = NULL;
-    }
+    bta_gattc_clear_cache(p_srvc_cb);
   }
   /* used to reset cache in application */
   bta_gattc_cache_reset(p_msg->api_conn.remote_bda);
@@ -1663,6 +1668,13 @@ static void bta_gattc_cmpl_cback(uint16_t conn_id, tGATTC_OPTYPE op,
     }
   }
 
+  /* the Database Hash read before discovery is not an application request */
+  if (op == GATTC_OPTYPE_READ && p_clcb->p_srcb &&
+      p_clcb->p_srcb->db_hash_pending) {
+    bta_gattc_db_hash_cmpl(p_clcb, status, p_data);
+    return;
+  }
+
   /* if over BR_EDR, inform PM for mode change */
   if (p_clcb->transport == BTA_TRANSPORT_BR_EDR) {
     bta_sys_busy(BTA_ID_GATTC, BTA_ALL_APP_ID, p_clcb->bda);
@@ -32,6 +32,9 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <mutex>
+
 #include "bt_common.h"
 #include "bta_gattc_int.h"
 #include "bta_sys.h"
@@ -40,16 +43,30 @@
 #include "btm_int.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/thread.h"
+#include "osi/include/time.h"
 #include "sdp_api.h"
 #include "sdpdefs.h"
 #include "utl.h"
 
-static void bta_gattc_cache_write(BD_ADDR server_bda, uint16_t num_attr,
+static void bta_gattc_cache_write(const char* fname, uint16_t num_attr,
                                   tBTA_GATTC_NV_ATTR* attr);
-static void bta_gattc_char_dscpt_disc_cmpl(uint16_t conn_id,
-                                           tBTA_GATTC_SERV* p_srvc_cb);
+static bool bta_gattc_cache_write_file(const char* fname, uint16_t num_attr,
+                                       tBTA_GATTC_NV_ATTR* attr);
+static bool bta_gattc_cache_file_matches(const char* fname, uint16_t num_attr,
+                                         const tBTA_GATTC_NV_ATTR* attr);
+static bool bta_gattc_cache_read(tBTA_GATTC_SERV* p_srcb, const char* fname);
+static tBTA_GATTC_NV_ATTR* bta_gattc_cache_read_file(const char* fname,
+                                                     uint16_t* p_num_attr);
 static tBTA_GATT_STATUS bta_gattc_sdp_service_disc(
     uint16_t conn_id, tBTA_GATTC_SERV* p_server_cb);
+static void bta_gattc_cache_write_job(void* context);
+static void bta_gattc_cache_preload_job(void* context);
+static void bta_gattc_cache_unlink_job(void* context);
+static void bta_gattc_cache_post(thread_fn job, void* context);
+static tBTA_GATTC_NV_ATTR* bta_gattc_cache_take_preload(BD_ADDR server_bda,
+                                                        uint16_t* p_num_attr);
+static void bta_gattc_cache_drop_preload(BD_ADDR server_bda);
 extern void bta_to_btif_uuid(bt_uuid_t* p_dest, tBT_UUID* p_src);
 tBTA_GATTC_SERVICE* bta_gattc_find_matching_service(const list_t* services,
                                                     uint16_t handle);
@@ -57,18 +74,84 @@ tBTA_GATTC_DESCRIPTOR* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
                                                      uint16_t handle);
 tBTA_GATTC_CHARACTERISTIC* bta_gattc_get_characteristic_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle);
+static void bta_gattc_build_handle_index(tBTA_GATTC_SERV* p_srvc_cb);
+static void bta_gattc_free_handle_index(tBTA_GATTC_SERV* p_srvc_cb);
 
 #define BTA_GATT_SDP_DB_SIZE 4096
 
 #define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
 #define GATT_CACHE_VERSION 2
 
+/* The databases are stored once per content, and the cache files of the
+ * servers with the same database, by address or by Database Hash, are hard
+ * links to it. */
+#define GATT_CACHE_DB_PREFIX GATT_CACHE_PREFIX "db_"
+#define GATT_CACHE_HASH_PREFIX GATT_CACHE_PREFIX "hash_"
+
+#define GATT_CACHE_FNAME_LEN 255
+
+/* The cache files are read and written on their own thread, in the order
+ * they are posted, so that the BTU thread does not wait on the file system.
+ * The caches of the servers a connection is requested to are read ahead of
+ * the connection, and taken from memory when it completes. */
+static thread_t* cache_io_thread = NULL;
+
+#define GATT_CACHE_PRELOAD_MAX BTA_GATTC_KNOWN_SR_MAX
+
+typedef struct {
+  bool in_use;
+  bool pending;  /* the read has not completed yet */
+  uint32_t seq;  /* identifies the read that is pending */
+  BD_ADDR bda;
+  uint16_t num_attr;
+  tBTA_GATTC_NV_ATTR* attr;
+} tBTA_GATTC_PRELOAD;
+
+/* The preloaded caches, shared with the I/O thread */
+static std::mutex preload_lock;
+static tBTA_GATTC_PRELOAD preload[GATT_CACHE_PRELOAD_MAX];
+static uint32_t preload_seq = 0;
+
+typedef struct {
+  char fname[GATT_CACHE_FNAME_LEN];      /* by address, or empty */
+  char hash_fname[GATT_CACHE_FNAME_LEN]; /* by Database Hash, or empty */
+  uint16_t num_attr;
+  tBTA_GATTC_NV_ATTR* attr;
+} tBTA_GATTC_CACHE_WRITE;
+
+typedef struct {
+  char fname[GATT_CACHE_FNAME_LEN];
+  uint32_t seq;
+} tBTA_GATTC_CACHE_PRELOAD;
+
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
                                                BD_ADDR bda) {
   snprintf(buffer, buffer_len, "%s%02x%02x%02x%02x%02x%02x", GATT_CACHE_PREFIX,
            bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
 }
 
+static void bta_gattc_generate_hash_file_name(char* buffer, size_t buffer_len,
+                                              const BT_OCTET16 db_hash) {
+  int len = snprintf(buffer, buffer_len, "%s", GATT_CACHE_HASH_PREFIX);
+  for (int i = 0; i < BT_OCTET16_LEN && len > 0 && (size_t)len < buffer_len;
+       i++)
+    len += snprintf(buffer + len, buffer_len - len, "%02x", db_hash[i]);
+}
+
+static void bta_gattc_generate_db_file_name(char* buffer, size_t buffer_len,
+                                            uint16_t num_attr,
+                                            const tBTA_GATTC_NV_ATTR* attr) {
+  /* FNV-1a of the attributes, which is only a hint: the content is compared
+   * before a file is shared */
+  uint64_t hash = 14695981039346656037ULL;
+  const uint8_t* p = (const uint8_t*)attr;
+  for (size_t i = 0; i < num_attr * sizeof(tBTA_GATTC_NV_ATTR); i++)
+    hash = (hash ^ p[i]) * 1099511628211ULL;
+
+  snprintf(buffer, buffer_len, "%s%016llx", GATT_CACHE_DB_PREFIX,
+           (unsigned long long)hash);
+}
+
 /*****************************************************************************
  *  Constants and data types
  ****************************************************************************/
@@ -160,22 +243,37 @@ static void bta_gattc_display_explore_record(tBTA_GATTC_ATTR_REC* p_rec,
  *
  ******************************************************************************/
 tBTA_GATT_STATUS bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb) {
-  if (p_srvc_cb->p_srvc_cache != NULL) {
-    list_free(p_srvc_cb->p_srvc_cache);
-    p_srvc_cb->p_srvc_cache = NULL;
-  }
+  bta_gattc_clear_cache(p_srvc_cb);
 
   osi_free(p_srvc_cb->p_srvc_list);
   p_srvc_cb->p_srvc_list =
-      (tBTA_GATTC_ATTR_REC*)osi_malloc(BTA_GATTC_ATTR_LIST_SIZE);
+      (tBTA_GATTC_ATTR_REC*)osi_malloc_tagged(
+          BTA_GATTC_ATTR_LIST_SIZE, OSI_MEM_GATT_CACHE);
   p_srvc_cb->total_srvc = 0;
-  p_srvc_cb->cur_srvc_idx = 0;
-  p_srvc_cb->cur_char_idx = 0;
   p_srvc_cb->next_avail_idx = 0;
+  p_srvc_cb->disc_char_handle = 0;
+  p_srvc_cb->disc_start_ms = time_get_os_boottime_ms();
+  p_srvc_cb->disc_procedures = 0;
 
   return BTA_GATT_OK;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_clear_cache
+ *
+ * Description      Free the database cache of a server and its handle index.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_clear_cache(tBTA_GATTC_SERV* p_srvc_cb) {
+  bta_gattc_free_handle_index(p_srvc_cb);
+
+  list_free(p_srvc_cb->p_srvc_cache);
+  p_srvc_cb->p_srvc_cache = NULL;
+}
+
 static void characteristic_free(void* ptr) {
   tBTA_GATTC_CHARACTERISTIC* p_char = (tBTA_GATTC_CHARACTERISTIC*)ptr;
   list_free(p_char->descriptors);
@@ -208,7 +306,8 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_cache(tBTA_GATTC_SERV* p_srvc_cb,
 #endif
 
   tBTA_GATTC_SERVICE* p_new_srvc =
-      (tBTA_GATTC_SERVICE*)osi_malloc(sizeof(tBTA_GATTC_SERVICE));
+      (tBTA_GATTC_SERVICE*)osi_malloc_tagged(
+          sizeof(tBTA_GATTC_SERVICE), OSI_MEM_GATT_CACHE);
 
   /* update service information */
   p_new_srvc->s_handle = s_handle;
@@ -219,6 +318,7 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_cache(tBTA_GATTC_SERV* p_srvc_cb,
   p_new_srvc->characteristics = list_new(characteristic_free);
   p_new_srvc->included_svc = list_new(osi_free);
 
+  bta_gattc_free_handle_index(p_srvc_cb);
   if (p_srvc_cb->p_srvc_cache == NULL) {
     p_srvc_cb->p_srvc_cache = list_new(service_free);
   }
@@ -253,7 +353,8 @@ static tBTA_GATT_STATUS bta_gattc_add_char_to_cache(tBTA_GATTC_SERV* p_srvc_cb,
   if (service->e_handle < value_handle) service->e_handle = value_handle;
 
   tBTA_GATTC_CHARACTERISTIC* characteristic =
-      (tBTA_GATTC_CHARACTERISTIC*)osi_malloc(sizeof(tBTA_GATTC_CHARACTERISTIC));
+      (tBTA_GATTC_CHARACTERISTIC*)osi_malloc_tagged(
+          sizeof(tBTA_GATTC_CHARACTERISTIC), OSI_MEM_GATT_CACHE);
 
   characteristic->handle = value_handle;
   characteristic->properties = property;
@@ -261,6 +362,7 @@ static tBTA_GATT_STATUS bta_gattc_add_char_to_cache(tBTA_GATTC_SERV* p_srvc_cb,
   memcpy(&characteristic->uuid, p_uuid, sizeof(tBT_UUID));
 
   characteristic->service = service;
+  bta_gattc_free_handle_index(p_srvc_cb);
   list_append(service->characteristics, characteristic);
 
   return BTA_GATT_OK;
@@ -294,8 +396,16 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(
   }
 
   if (type == BTA_GATTC_ATTR_TYPE_INCL_SRVC) {
+    /* already found by a previous include discovery */
+    for (list_node_t* in = list_begin(service->included_svc);
+         in != list_end(service->included_svc); in = list_next(in)) {
+      if (((tBTA_GATTC_INCLUDED_SVC*)list_node(in))->handle == handle)
+        return BTA_GATT_OK;
+    }
+
     tBTA_GATTC_INCLUDED_SVC* isvc =
-        (tBTA_GATTC_INCLUDED_SVC*)osi_malloc(sizeof(tBTA_GATTC_INCLUDED_SVC));
+        (tBTA_GATTC_INCLUDED_SVC*)osi_malloc_tagged(
+            sizeof(tBTA_GATTC_INCLUDED_SVC), OSI_MEM_GATT_CACHE);
 
     isvc->handle = handle;
     memcpy(&isvc->uuid, p_uuid, sizeof(tBT_UUID));
@@ -313,13 +423,23 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(
     list_append(service->included_svc, isvc);
   } else if (type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR) {
     tBTA_GATTC_DESCRIPTOR* descriptor =
-        (tBTA_GATTC_DESCRIPTOR*)osi_malloc(sizeof(tBTA_GATTC_DESCRIPTOR));
+        (tBTA_GATTC_DESCRIPTOR*)osi_malloc_tagged(
+            sizeof(tBTA_GATTC_DESCRIPTOR), OSI_MEM_GATT_CACHE);
 
     descriptor->handle = handle;
     memcpy(&descriptor->uuid, p_uuid, sizeof(tBT_UUID));
 
-    if (service->characteristics == NULL ||
-        list_is_empty(service->characteristics)) {
+    /* the descriptor belongs to the last characteristic before it */
+    tBTA_GATTC_CHARACTERISTIC* char_node = NULL;
+    for (list_node_t* cn = list_begin(service->characteristics);
+         cn != list_end(service->characteristics); cn = list_next(cn)) {
+      tBTA_GATTC_CHARACTERISTIC* p_char =
+          (tBTA_GATTC_CHARACTERISTIC*)list_node(cn);
+      if (p_char->handle >= handle) break;
+      char_node = p_char;
+    }
+
+    if (char_node == NULL) {
       APPL_TRACE_ERROR(
           "%s: Illegal action to add descriptor before adding a "
           "characteristic!",
@@ -328,10 +448,8 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(
       return GATT_WRONG_STATE;
     }
 
-    tBTA_GATTC_CHARACTERISTIC* char_node =
-        (tBTA_GATTC_CHARACTERISTIC*)list_back(service->characteristics);
-
     descriptor->characteristic = char_node;
+    bta_gattc_free_handle_index(p_srvc_cb);
     list_append(char_node->descriptors, descriptor);
   }
   return BTA_GATT_OK;
@@ -339,31 +457,57 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(
 
 /*******************************************************************************
  *
- * Function         bta_gattc_get_disc_range
+ * Function         bta_gattc_get_dscp_disc_range
  *
- * Description      get discovery stating and ending handle range.
+ * Description      Find the first characteristic after after_handle that
+ *                  leaves room for descriptors, and get the handle range of
+ *                  its descriptors.
  *
- * Returns          None.
+ * Returns          true if such a characteristic is found, false otherwise.
  *
  ******************************************************************************/
-void bta_gattc_get_disc_range(tBTA_GATTC_SERV* p_srvc_cb, uint16_t* p_s_hdl,
-                              uint16_t* p_e_hdl, bool is_srvc) {
-  tBTA_GATTC_ATTR_REC* p_rec = NULL;
+static bool bta_gattc_get_dscp_disc_range(tBTA_GATTC_SERV* p_srvc_cb,
+                                          uint16_t after_handle,
+                                          uint16_t* p_char_handle,
+                                          uint16_t* p_e_hdl) {
+  bool found = false;
 
-  if (is_srvc) {
-    p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_srvc_idx;
-    *p_s_hdl = p_rec->s_handle;
-  } else {
-    p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_char_idx;
-    *p_s_hdl = p_rec->s_handle + 1;
+  if (p_srvc_cb->p_srvc_cache == NULL) return false;
+
+  /* the secondary services are not in handle order in the cache */
+  for (list_node_t* sn = list_begin(p_srvc_cb->p_srvc_cache);
+       sn != list_end(p_srvc_cb->p_srvc_cache); sn = list_next(sn)) {
+    tBTA_GATTC_SERVICE* p_svc = (tBTA_GATTC_SERVICE*)list_node(sn);
+
+    for (list_node_t* cn = list_begin(p_svc->characteristics);
+         cn != list_end(p_svc->characteristics); cn = list_next(cn)) {
+      tBTA_GATTC_CHARACTERISTIC* p_char =
+          (tBTA_GATTC_CHARACTERISTIC*)list_node(cn);
+
+      if (p_char->handle <= after_handle) continue;
+      if (found && p_char->handle >= *p_char_handle) break;
+
+      /* the descriptors end before the declaration of the next
+       * characteristic, which is right before its value */
+      uint16_t e_handle = p_svc->e_handle;
+      list_node_t* next = list_next(cn);
+      if (next != list_end(p_svc->characteristics))
+        e_handle = ((tBTA_GATTC_CHARACTERISTIC*)list_node(next))->handle - 2;
+
+      if (p_char->handle < e_handle) {
+        *p_char_handle = p_char->handle;
+        *p_e_hdl = e_handle;
+        found = true;
+        break;
+      }
+    }
   }
 
-  *p_e_hdl = p_rec->e_handle;
 #if (BTA_GATT_DEBUG == TRUE)
-  APPL_TRACE_DEBUG("discover range [%d ~ %d]", p_rec->s_handle,
-                   p_rec->e_handle);
+  if (found)
+    APPL_TRACE_DEBUG("discover range [%d ~ %d]", *p_char_handle + 1, *p_e_hdl);
 #endif
-  return;
+  return found;
 }
 /*******************************************************************************
  *
@@ -394,6 +538,10 @@ tBTA_GATT_STATUS bta_gattc_discover_pri_service(uint16_t conn_id,
  * Function         bta_gattc_discover_procedure
  *
  * Description      Start a particular type of discovery procedure on server.
+ *                  The services, included services and characteristics are
+ *                  discovered over the whole database at once, so that each
+ *                  response carries as many of them as fit, across services.
+ *                  The descriptors are discovered per characteristic.
  *
  * Returns          status of the operation.
  *
@@ -402,24 +550,61 @@ tBTA_GATT_STATUS bta_gattc_discover_procedure(uint16_t conn_id,
                                               tBTA_GATTC_SERV* p_server_cb,
                                               uint8_t disc_type) {
   tGATT_DISC_PARAM param;
-  bool is_service = true;
 
   memset(&param, 0, sizeof(tGATT_DISC_PARAM));
 
-  if (disc_type == GATT_DISC_SRVC_ALL || disc_type == GATT_DISC_SRVC_BY_UUID) {
+  if (disc_type == GATT_DISC_CHAR_DSCPT) {
+    param.s_handle = p_server_cb->disc_char_handle + 1;
+    param.e_handle = p_server_cb->disc_dscp_e_handle;
+  } else {
     param.s_handle = 1;
     param.e_handle = 0xFFFF;
-  } else {
-    if (disc_type == GATT_DISC_CHAR_DSCPT) is_service = false;
+  }
 
-    bta_gattc_get_disc_range(p_server_cb, &param.s_handle, &param.e_handle,
-                             is_service);
+  p_server_cb->disc_procedures++;
+  return GATTC_Discover(conn_id, disc_type, &param);
+}
+/*******************************************************************************
+ *
+ * Function         bta_gattc_explore_cmpl
+ *
+ * Description      process the end of the server discovery
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_explore_cmpl(uint16_t conn_id,
+                                   tBTA_GATTC_SERV* p_srvc_cb) {
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
 
-    if (param.s_handle > param.e_handle) {
-      return GATT_ERROR;
-    }
+  if (p_clcb == NULL) {
+    APPL_TRACE_ERROR("unknown connection ID");
+    return;
   }
-  return GATTC_Discover(conn_id, disc_type, &param);
+
+#if (BTA_GATT_DEBUG == TRUE)
+  bta_gattc_display_cache_server(p_srvc_cb->p_srvc_cache);
+#endif
+  bta_gattc_build_handle_index(p_srvc_cb);
+
+  LOG_INFO(LOG_TAG,
+           "%s: %02x:%02x:%02x:%02x:%02x:%02x discovered in %u ms, %d "
+           "services, %d GATT procedures",
+           __func__, p_srvc_cb->server_bda[0], p_srvc_cb->server_bda[1],
+           p_srvc_cb->server_bda[2], p_srvc_cb->server_bda[3],
+           p_srvc_cb->server_bda[4], p_srvc_cb->server_bda[5],
+           time_get_os_boottime_ms() - p_srvc_cb->disc_start_ms,
+           p_srvc_cb->total_srvc, p_srvc_cb->disc_procedures);
+
+  /* save cache to NV */
+  p_clcb->p_srcb->state = BTA_GATTC_SERV_SAVE;
+
+  if (btm_sec_is_a_bonded_dev(p_srvc_cb->server_bda) ||
+      p_srvc_cb->db_hash_valid) {
+    bta_gattc_cache_save(p_clcb->p_srcb, p_clcb->bta_conn_id);
+  }
+
+  bta_gattc_reset_discover_st(p_clcb->p_srcb, BTA_GATT_OK);
 }
 /*******************************************************************************
  *
@@ -432,6 +617,9 @@ tBTA_GATT_STATUS bta_gattc_discover_procedure(uint16_t conn_id,
  ******************************************************************************/
 tBTA_GATT_STATUS bta_gattc_start_disc_include_srvc(uint16_t conn_id,
                                                    tBTA_GATTC_SERV* p_srvc_cb) {
+  p_srvc_cb->incl_disc_srvc = p_srvc_cb->total_srvc;
+  p_srvc_cb->incl_srvc_missed = false;
+
   return bta_gattc_discover_procedure(conn_id, p_srvc_cb, GATT_DISC_INC_SRVC);
 }
 /*******************************************************************************
@@ -445,15 +633,15 @@ tBTA_GATT_STATUS bta_gattc_start_disc_include_srvc(uint16_t conn_id,
  ******************************************************************************/
 tBTA_GATT_STATUS bta_gattc_start_disc_char(uint16_t conn_id,
                                            tBTA_GATTC_SERV* p_srvc_cb) {
-  p_srvc_cb->total_char = 0;
-
   return bta_gattc_discover_procedure(conn_id, p_srvc_cb, GATT_DISC_CHAR);
 }
 /*******************************************************************************
  *
  * Function         bta_gattc_start_disc_char_dscp
  *
- * Description      Start discovery for characteristic descriptor
+ * Description      Start discovery for the descriptors of the next
+ *                  characteristic, or end the server discovery if there is
+ *                  none left.
  *
  * Returns          none.
  *
@@ -462,9 +650,17 @@ void bta_gattc_start_disc_char_dscp(uint16_t conn_id,
                                     tBTA_GATTC_SERV* p_srvc_cb) {
   APPL_TRACE_DEBUG("starting discover characteristics descriptor");
 
-  if (bta_gattc_discover_procedure(conn_id, p_srvc_cb, GATT_DISC_CHAR_DSCPT) !=
-      0)
-    bta_gattc_char_dscpt_disc_cmpl(conn_id, p_srvc_cb);
+  /* the characteristics without room for descriptors are skipped, so are the
+   * ones whose discovery fails to start */
+  while (bta_gattc_get_dscp_disc_range(p_srvc_cb, p_srvc_cb->disc_char_handle,
+                                       &p_srvc_cb->disc_char_handle,
+                                       &p_srvc_cb->disc_dscp_e_handle)) {
+    if (bta_gattc_discover_procedure(conn_id, p_srvc_cb,
+                                     GATT_DISC_CHAR_DSCPT) == 0)
+      return;
+  }
+
+  bta_gattc_explore_cmpl(conn_id, p_srvc_cb);
 }
 /*******************************************************************************
  *
@@ -477,42 +673,30 @@ void bta_gattc_start_disc_char_dscp(uint16_t conn_id,
  ******************************************************************************/
 static void bta_gattc_explore_srvc(uint16_t conn_id,
                                    tBTA_GATTC_SERV* p_srvc_cb) {
-  tBTA_GATTC_ATTR_REC* p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_srvc_idx;
-  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
-
-  APPL_TRACE_DEBUG("Start service discovery: srvc_idx = %d",
-                   p_srvc_cb->cur_srvc_idx);
-
-  p_srvc_cb->cur_char_idx = p_srvc_cb->next_avail_idx = p_srvc_cb->total_srvc;
+  APPL_TRACE_DEBUG("Start service discovery: %d services",
+                   p_srvc_cb->total_srvc);
 
-  if (p_clcb == NULL) {
+  if (bta_gattc_find_clcb_by_conn_id(conn_id) == NULL) {
     APPL_TRACE_ERROR("unknown connection ID");
     return;
   }
-  /* start expore a service if there is service not been explored */
-  if (p_srvc_cb->cur_srvc_idx < p_srvc_cb->total_srvc) {
-    /* add the first service into cache */
-    if (bta_gattc_add_srvc_to_cache(p_srvc_cb, p_rec->s_handle, p_rec->e_handle,
-                                    &p_rec->uuid, p_rec->is_primary) == 0) {
-      /* start discovering included services */
-      bta_gattc_start_disc_include_srvc(conn_id, p_srvc_cb);
-      return;
-    }
-  }
-  /* no service found at all, the end of server discovery*/
-  LOG_WARN(LOG_TAG, "%s no more services found", __func__);
 
-#if (BTA_GATT_DEBUG == TRUE)
-  bta_gattc_display_cache_server(p_srvc_cb->p_srvc_cache);
-#endif
-  /* save cache to NV */
-  p_clcb->p_srcb->state = BTA_GATTC_SERV_SAVE;
+  /* add the services found into cache */
+  for (uint8_t i = 0; i < p_srvc_cb->total_srvc; i++) {
+    tBTA_GATTC_ATTR_REC* p_rec = p_srvc_cb->p_srvc_list + i;
+    bta_gattc_add_srvc_to_cache(p_srvc_cb, p_rec->s_handle, p_rec->e_handle,
+                                &p_rec->uuid, p_rec->is_primary);
+  }
 
-  if (btm_sec_is_a_bonded_dev(p_srvc_cb->server_bda)) {
-    bta_gattc_cache_save(p_clcb->p_srcb, p_clcb->bta_conn_id);
+  if (p_srvc_cb->total_srvc == 0) {
+    /* no service found at all, the end of server discovery*/
+    LOG_WARN(LOG_TAG, "%s no services found", __func__);
+    bta_gattc_explore_cmpl(conn_id, p_srvc_cb);
+    return;
   }
 
-  bta_gattc_reset_discover_st(p_clcb->p_srcb, BTA_GATT_OK);
+  /* start discovering included services */
+  bta_gattc_start_disc_include_srvc(conn_id, p_srvc_cb);
 }
 /*******************************************************************************
  *
@@ -525,7 +709,13 @@ static void bta_gattc_explore_srvc(uint16_t conn_id,
  ******************************************************************************/
 static void bta_gattc_incl_srvc_disc_cmpl(uint16_t conn_id,
                                           tBTA_GATTC_SERV* p_srvc_cb) {
-  p_srvc_cb->cur_char_idx = p_srvc_cb->total_srvc;
+  /* an include declared in a secondary service found later in the database was
+   * dropped: discover again now that the service is known */
+  if (p_srvc_cb->incl_srvc_missed &&
+      p_srvc_cb->total_srvc > p_srvc_cb->incl_disc_srvc) {
+    bta_gattc_start_disc_include_srvc(conn_id, p_srvc_cb);
+    return;
+  }
 
   /* start discoverying characteristic */
   bta_gattc_start_disc_char(conn_id, p_srvc_cb);
@@ -541,23 +731,9 @@ static void bta_gattc_incl_srvc_disc_cmpl(uint16_t conn_id,
  ******************************************************************************/
 static void bta_gattc_char_disc_cmpl(uint16_t conn_id,
                                      tBTA_GATTC_SERV* p_srvc_cb) {
-  tBTA_GATTC_ATTR_REC* p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_char_idx;
-
-  /* if there are characteristic needs to be explored */
-  if (p_srvc_cb->total_char > 0) {
-    /* add the first characteristic into cache */
-    bta_gattc_add_char_to_cache(p_srvc_cb, p_rec->char_decl_handle,
-                                p_rec->s_handle, &p_rec->uuid, p_rec->property);
-
-    /* start discoverying characteristic descriptor , if failed, disc for next
-     * char*/
-    bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
-  } else /* otherwise start with next service */
-  {
-    p_srvc_cb->cur_srvc_idx++;
-
-    bta_gattc_explore_srvc(conn_id, p_srvc_cb);
-  }
+  /* start discoverying the descriptors from the first characteristic */
+  p_srvc_cb->disc_char_handle = 0;
+  bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
 }
 /*******************************************************************************
  *
@@ -570,25 +746,8 @@ static void bta_gattc_char_disc_cmpl(uint16_t conn_id,
  ******************************************************************************/
 static void bta_gattc_char_dscpt_disc_cmpl(uint16_t conn_id,
                                            tBTA_GATTC_SERV* p_srvc_cb) {
-  tBTA_GATTC_ATTR_REC* p_rec = NULL;
-
-  if (--p_srvc_cb->total_char > 0) {
-    p_rec = p_srvc_cb->p_srvc_list + (++p_srvc_cb->cur_char_idx);
-    /* add the next characteristic into cache */
-    bta_gattc_add_char_to_cache(p_srvc_cb, p_rec->char_decl_handle,
-                                p_rec->s_handle, &p_rec->uuid, p_rec->property);
-
-    /* start discoverying next characteristic for char descriptor */
-    bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
-  } else
-  /* all characteristic has been explored, start with next service if any */
-  {
-#if (BTA_GATT_DEBUG == TRUE)
-    APPL_TRACE_ERROR("all char has been explored");
-#endif
-    p_srvc_cb->cur_srvc_idx++;
-    bta_gattc_explore_srvc(conn_id, p_srvc_cb);
-  }
+  /* start discoverying next characteristic for char descriptor */
+  bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
 }
 static bool bta_gattc_srvc_in_list(tBTA_GATTC_SERV* p_srvc_cb,
                                    uint16_t s_handle, uint16_t e_handle,
@@ -653,51 +812,6 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_list(tBTA_GATTC_SERV* p_srvc_cb,
   }
   return status;
 }
-/*******************************************************************************
- *
- * Function         bta_gattc_add_char_to_list
- *
- * Description      Add a characteristic into explore pending list
- *
- * Returns          status
- *
- ******************************************************************************/
-static tBTA_GATT_STATUS bta_gattc_add_char_to_list(tBTA_GATTC_SERV* p_srvc_cb,
-                                                   uint16_t decl_handle,
-                                                   uint16_t value_handle,
-                                                   tBT_UUID uuid,
-                                                   uint8_t property) {
-  tBTA_GATTC_ATTR_REC* p_rec = NULL;
-  tBTA_GATT_STATUS status = BTA_GATT_OK;
-
-  if (p_srvc_cb->p_srvc_list == NULL) {
-    APPL_TRACE_ERROR("No service available, unexpected char discovery result");
-    status = BTA_GATT_INTERNAL_ERROR;
-  } else if (p_srvc_cb->next_avail_idx < BTA_GATTC_MAX_CACHE_CHAR) {
-    p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->next_avail_idx;
-
-    p_srvc_cb->total_char++;
-
-    p_rec->s_handle = value_handle;
-    p_rec->char_decl_handle = decl_handle;
-    p_rec->property = property;
-    p_rec->e_handle =
-        (p_srvc_cb->p_srvc_list + p_srvc_cb->cur_srvc_idx)->e_handle;
-    memcpy(&p_rec->uuid, &uuid, sizeof(tBT_UUID));
-
-    /* update the endind handle of pervious characteristic if available */
-    if (p_srvc_cb->total_char > 1) {
-      p_rec -= 1;
-      p_rec->e_handle = decl_handle - 1;
-    }
-    p_srvc_cb->next_avail_idx++;
-  } else {
-    APPL_TRACE_ERROR("char not added, no resources");
-    /* allocate bigger buffer ?? */
-    status = BTA_GATT_DB_FULL;
-  }
-  return status;
-}
 
 /*******************************************************************************
  *
@@ -785,9 +899,11 @@ static tBTA_GATT_STATUS bta_gattc_sdp_service_disc(
    * otherwise it will be freed within this function.
    */
   tBTA_GATTC_CB_DATA* cb_data =
-      (tBTA_GATTC_CB_DATA*)osi_malloc(sizeof(tBTA_GATTC_CB_DATA));
+      (tBTA_GATTC_CB_DATA*)osi_malloc_tagged(
+          sizeof(tBTA_GATTC_CB_DATA), OSI_MEM_GATT_CACHE);
 
-  cb_data->p_sdp_db = (tSDP_DISCOVERY_DB*)osi_malloc(BTA_GATT_SDP_DB_SIZE);
+  cb_data->p_sdp_db = (tSDP_DISCOVERY_DB*)osi_malloc_tagged(
+      BTA_GATT_SDP_DB_SIZE, OSI_MEM_GATT_CACHE);
   attr_list[0] = ATTR_ID_SERVICE_CLASS_ID_LIST;
   attr_list[1] = ATTR_ID_PROTOCOL_DESC_LIST;
 
@@ -848,24 +964,33 @@ void bta_gattc_disc_res_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
             p_data->value.incl_service.e_handle,
             p_data->value.incl_service.service_type);
 
-        if (!pri_srvc)
-          bta_gattc_add_srvc_to_list(
+        if (!pri_srvc &&
+            bta_gattc_add_srvc_to_list(
+                p_srvc_cb, p_data->value.incl_service.s_handle,
+                p_data->value.incl_service.e_handle,
+                p_data->value.incl_service.service_type,
+                false) == BTA_GATT_OK) {
+          bta_gattc_add_srvc_to_cache(
               p_srvc_cb, p_data->value.incl_service.s_handle,
               p_data->value.incl_service.e_handle,
-              p_data->value.incl_service.service_type, false);
-        /* add into database */
-        bta_gattc_add_attr_to_cache(
-            p_srvc_cb, p_data->handle, &p_data->value.incl_service.service_type,
-            pri_srvc, p_data->value.incl_service.s_handle,
-            BTA_GATTC_ATTR_TYPE_INCL_SRVC);
+              &p_data->value.incl_service.service_type, false);
+        }
+        /* add into database, the including service may be a secondary service
+         * included later in the database */
+        if (bta_gattc_add_attr_to_cache(
+                p_srvc_cb, p_data->handle,
+                &p_data->value.incl_service.service_type, pri_srvc,
+                p_data->value.incl_service.s_handle,
+                BTA_GATTC_ATTR_TYPE_INCL_SRVC) != BTA_GATT_OK)
+          p_srvc_cb->incl_srvc_missed = true;
         break;
 
       case GATT_DISC_CHAR:
         /* add char value into database */
-        bta_gattc_add_char_to_list(p_srvc_cb, p_data->handle,
-                                   p_data->value.dclr_value.val_handle,
-                                   p_data->value.dclr_value.char_uuid,
-                                   p_data->value.dclr_value.char_prop);
+        bta_gattc_add_char_to_cache(p_srvc_cb, p_data->handle,
+                                    p_data->value.dclr_value.val_handle,
+                                    &p_data->value.dclr_value.char_uuid,
+                                    p_data->value.dclr_value.char_prop);
         break;
 
       case GATT_DISC_CHAR_DSCPT:
@@ -905,10 +1030,6 @@ void bta_gattc_disc_cmpl_cback(uint16_t conn_id, tGATT_DISC_TYPE disc_type,
         break;
 
       case GATT_DISC_CHAR:
-#if (BTA_GATT_DEBUG == TRUE)
-        bta_gattc_display_explore_record(p_srvc_cb->p_srvc_list,
-                                         p_srvc_cb->next_avail_idx);
-#endif
         bta_gattc_char_disc_cmpl(conn_id, p_srvc_cb);
         break;
 
@@ -991,8 +1112,34 @@ tBTA_GATTC_SERVICE* bta_gattc_find_matching_service(const list_t* services,
   return NULL;
 }
 
+/* Returns the first of the |count| attributes of |attrs|, sorted by handle,
+ * with the handle |handle|, or NULL if there is none. */
+template <typename T>
+static T* bta_gattc_find_by_handle(T** attrs, uint16_t count,
+                                   uint16_t handle) {
+  T** it = std::lower_bound(
+      attrs, attrs + count, handle,
+      [](const T* attr, uint16_t handle) { return attr->handle < handle; });
+  return (it != attrs + count && (*it)->handle == handle) ? *it : NULL;
+}
+
 const tBTA_GATTC_SERVICE* bta_gattc_get_service_for_handle_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle) {
+  if (p_srcb && p_srcb->p_handle_index) {
+    const tBTA_GATTC_HANDLE_INDEX* p_index = p_srcb->p_handle_index;
+
+    /* the last service starting at or before the handle */
+    tBTA_GATTC_SERVICE** it = std::upper_bound(
+        p_index->services, p_index->services + p_index->num_services, handle,
+        [](uint16_t handle, const tBTA_GATTC_SERVICE* service) {
+          return handle < service->s_handle;
+        });
+    if (it == p_index->services) return NULL;
+
+    const tBTA_GATTC_SERVICE* service = *(it - 1);
+    return (handle <= service->e_handle) ? service : NULL;
+  }
+
   const list_t* services = bta_gattc_get_services_srcb(p_srcb);
 
   return bta_gattc_find_matching_service(services, handle);
@@ -1000,13 +1147,21 @@ const tBTA_GATTC_SERVICE* bta_gattc_get_service_for_handle_srcb(
 
 const tBTA_GATTC_SERVICE* bta_gattc_get_service_for_handle(uint16_t conn_id,
                                                            uint16_t handle) {
-  const list_t* services = bta_gattc_get_services(conn_id);
+  tBTA_GATTC_CLCB* p_clcb = bta_gattc_find_clcb_by_conn_id(conn_id);
 
-  return bta_gattc_find_matching_service(services, handle);
+  if (p_clcb == NULL) return NULL;
+
+  return bta_gattc_get_service_for_handle_srcb(p_clcb->p_srcb, handle);
 }
 
 tBTA_GATTC_CHARACTERISTIC* bta_gattc_get_characteristic_srcb(
     tBTA_GATTC_SERV* p_srcb, uint16_t handle) {
+  if (p_srcb && p_srcb->p_handle_index) {
+    const tBTA_GATTC_HANDLE_INDEX* p_index = p_srcb->p_handle_index;
+    return bta_gattc_find_by_handle(p_index->characteristics,
+                                    p_index->num_characteristics, handle);
+  }
+
   const tBTA_GATTC_SERVICE* service =
       bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
 
@@ -1034,6 +1189,12 @@ tBTA_GATTC_CHARACTERISTIC* bta_gattc_get_characteristic(uint16_t conn_id,
 
 tBTA_GATTC_DESCRIPTOR* bta_gattc_get_descriptor_srcb(tBTA_GATTC_SERV* p_srcb,
                                                      uint16_t handle) {
+  if (p_srcb && p_srcb->p_handle_index) {
+    const tBTA_GATTC_HANDLE_INDEX* p_index = p_srcb->p_handle_index;
+    return bta_gattc_find_by_handle(p_index->descriptors,
+                                    p_index->num_descriptors, handle);
+  }
+
   const tBTA_GATTC_SERVICE* service =
       bta_gattc_get_service_for_handle_srcb(p_srcb, handle);
 
@@ -1065,6 +1226,103 @@ tBTA_GATTC_DESCRIPTOR* bta_gattc_get_descriptor(uint16_t conn_id,
   return bta_gattc_get_descriptor_srcb(p_srcb, handle);
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_build_handle_index
+ *
+ * Description      Build the handle index of a complete database cache, so
+ *                  that the lookups by handle are binary searches instead of
+ *                  walks of the service, characteristic and descriptor lists.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_build_handle_index(tBTA_GATTC_SERV* p_srvc_cb) {
+  bta_gattc_free_handle_index(p_srvc_cb);
+
+  list_t* services = p_srvc_cb->p_srvc_cache;
+  if (!services || list_is_empty(services)) return;
+
+  size_t num_services = list_length(services);
+  size_t num_characteristics = 0;
+  size_t num_descriptors = 0;
+  for (list_node_t* sn = list_begin(services); sn != list_end(services);
+       sn = list_next(sn)) {
+    tBTA_GATTC_SERVICE* p_svc = (tBTA_GATTC_SERVICE*)list_node(sn);
+    num_characteristics += list_length(p_svc->characteristics);
+    for (list_node_t* cn = list_begin(p_svc->characteristics);
+         cn != list_end(p_svc->characteristics); cn = list_next(cn)) {
+      tBTA_GATTC_CHARACTERISTIC* p_char =
+          (tBTA_GATTC_CHARACTERISTIC*)list_node(cn);
+      num_descriptors += list_length(p_char->descriptors);
+    }
+  }
+
+  /* the counts of a consistent cache fit the 16 bit handles */
+  if (num_services > UINT16_MAX || num_characteristics > UINT16_MAX ||
+      num_descriptors > UINT16_MAX) {
+    APPL_TRACE_ERROR("%s: too many attributes to index", __func__);
+    return;
+  }
+
+  /* the index and its arrays are a single allocation */
+  tBTA_GATTC_HANDLE_INDEX* p_index =
+      (tBTA_GATTC_HANDLE_INDEX*)osi_malloc_tagged(
+          sizeof(tBTA_GATTC_HANDLE_INDEX) +
+              (num_services + num_characteristics + num_descriptors) *
+                  sizeof(void*),
+          OSI_MEM_GATT_CACHE);
+  p_index->services = (tBTA_GATTC_SERVICE**)(p_index + 1);
+  p_index->characteristics =
+      (tBTA_GATTC_CHARACTERISTIC**)(p_index->services + num_services);
+  p_index->descriptors = (tBTA_GATTC_DESCRIPTOR**)(p_index->characteristics +
+                                                   num_characteristics);
+  p_index->num_services = 0;
+  p_index->num_characteristics = 0;
+  p_index->num_descriptors = 0;
+
+  for (list_node_t* sn = list_begin(services); sn != list_end(services);
+       sn = list_next(sn)) {
+    tBTA_GATTC_SERVICE* p_svc = (tBTA_GATTC_SERVICE*)list_node(sn);
+    p_index->services[p_index->num_services++] = p_svc;
+    for (list_node_t* cn = list_begin(p_svc->characteristics);
+         cn != list_end(p_svc->characteristics); cn = list_next(cn)) {
+      tBTA_GATTC_CHARACTERISTIC* p_char =
+          (tBTA_GATTC_CHARACTERISTIC*)list_node(cn);
+      p_index->characteristics[p_index->num_characteristics++] = p_char;
+      for (list_node_t* dn = list_begin(p_char->descriptors);
+           dn != list_end(p_char->descriptors); dn = list_next(dn)) {
+        p_index->descriptors[p_index->num_descriptors++] =
+            (tBTA_GATTC_DESCRIPTOR*)list_node(dn);
+      }
+    }
+  }
+
+  /* stable, so that the first of duplicated handles is found, as in the
+   * lists */
+  std::stable_sort(
+      p_index->services, p_index->services + p_index->num_services,
+      [](const tBTA_GATTC_SERVICE* a, const tBTA_GATTC_SERVICE* b) {
+        return a->s_handle < b->s_handle;
+      });
+  std::stable_sort(
+      p_index->characteristics,
+      p_index->characteristics + p_index->num_characteristics,
+      [](const tBTA_GATTC_CHARACTERISTIC* a,
+         const tBTA_GATTC_CHARACTERISTIC* b) { return a->handle < b->handle; });
+  std::stable_sort(
+      p_index->descriptors, p_index->descriptors + p_index->num_descriptors,
+      [](const tBTA_GATTC_DESCRIPTOR* a, const tBTA_GATTC_DESCRIPTOR* b) {
+        return a->handle < b->handle;
+      });
+
+  p_srvc_cb->p_handle_index = p_index;
+}
+
+static void bta_gattc_free_handle_index(tBTA_GATTC_SERV* p_srvc_cb) {
+  osi_free_and_reset((void**)&p_srvc_cb->p_handle_index);
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_fill_gatt_db_el
@@ -1158,7 +1416,8 @@ static void bta_gattc_get_gatt_db_impl(tBTA_GATTC_SERV* p_srvc_cb,
   size_t db_size =
       bta_gattc_get_db_size(p_srvc_cb->p_srvc_cache, start_handle, end_handle);
 
-  void* buffer = osi_malloc(db_size * sizeof(btgatt_db_element_t));
+  void* buffer = osi_malloc_tagged(
+      db_size * sizeof(btgatt_db_element_t), OSI_MEM_GATT_CACHE);
   btgatt_db_element_t* curr_db_attr = (btgatt_db_element_t*)buffer;
 
   for (list_node_t* sn = list_begin(p_srvc_cb->p_srvc_cache);
@@ -1283,8 +1542,7 @@ void bta_gattc_rebuild_cache(tBTA_GATTC_SERV* p_srvc_cb, uint16_t num_attr,
   /* first attribute loading, initialize buffer */
   APPL_TRACE_ERROR("%s: bta_gattc_rebuild_cache", __func__);
 
-  list_free(p_srvc_cb->p_srvc_cache);
-  p_srvc_cb->p_srvc_cache = NULL;
+  bta_gattc_clear_cache(p_srvc_cb);
 
   while (num_attr > 0 && p_attr != NULL) {
     switch (p_attr->attr_type) {
@@ -1311,6 +1569,8 @@ void bta_gattc_rebuild_cache(tBTA_GATTC_SERV* p_srvc_cb, uint16_t num_attr,
     p_attr++;
     num_attr--;
   }
+
+  bta_gattc_build_handle_index(p_srvc_cb);
 }
 
 /*******************************************************************************
@@ -1354,7 +1614,8 @@ void bta_gattc_cache_save(tBTA_GATTC_SERV* p_srvc_cb, uint16_t conn_id) {
   size_t db_size =
       bta_gattc_get_db_size(p_srvc_cb->p_srvc_cache, 0x0000, 0xFFFF);
   tBTA_GATTC_NV_ATTR* nv_attr =
-      (tBTA_GATTC_NV_ATTR*)osi_malloc(db_size * sizeof(tBTA_GATTC_NV_ATTR));
+      (tBTA_GATTC_NV_ATTR*)osi_malloc_tagged(
+          db_size * sizeof(tBTA_GATTC_NV_ATTR), OSI_MEM_GATT_CACHE);
 
   for (list_node_t* sn = list_begin(p_srvc_cb->p_srvc_cache);
        sn != list_end(p_srvc_cb->p_srvc_cache); sn = list_next(sn)) {
@@ -1409,8 +1670,232 @@ void bta_gattc_cache_save(tBTA_GATTC_SERV* p_srvc_cb, uint16_t conn_id) {
     }
   }
 
-  bta_gattc_cache_write(p_srvc_cb->server_bda, db_size, nv_attr);
-  osi_free(nv_attr);
+  tBTA_GATTC_CACHE_WRITE* p_write =
+      (tBTA_GATTC_CACHE_WRITE*)osi_calloc(sizeof(tBTA_GATTC_CACHE_WRITE));
+  if (btm_sec_is_a_bonded_dev(p_srvc_cb->server_bda))
+    bta_gattc_generate_cache_file_name(p_write->fname, sizeof(p_write->fname),
+                                       p_srvc_cb->server_bda);
+
+  /* the servers with the same Database Hash have the same database, so the
+   * next ones can skip the discovery */
+  if (p_srvc_cb->db_hash_valid)
+    bta_gattc_generate_hash_file_name(p_write->hash_fname,
+                                      sizeof(p_write->hash_fname),
+                                      p_srvc_cb->db_hash);
+
+  p_write->num_attr = db_size;
+  p_write->attr = nv_attr;
+
+  /* a cache read ahead is older than this one */
+  bta_gattc_cache_drop_preload(p_srvc_cb->server_bda);
+  bta_gattc_cache_post(bta_gattc_cache_write_job, p_write);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_write_job
+ *
+ * Description      Write the cache files of a server on the I/O thread.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_write_job(void* context) {
+  tBTA_GATTC_CACHE_WRITE* p_write = (tBTA_GATTC_CACHE_WRITE*)context;
+
+  if (p_write->fname[0] != '\0')
+    bta_gattc_cache_write(p_write->fname, p_write->num_attr, p_write->attr);
+  if (p_write->hash_fname[0] != '\0')
+    bta_gattc_cache_write(p_write->hash_fname, p_write->num_attr,
+                          p_write->attr);
+
+  osi_free(p_write->attr);
+  osi_free(p_write);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_post
+ *
+ * Description      Run a cache file job on the I/O thread, or right away if
+ *                  there is no I/O thread.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_post(thread_fn job, void* context) {
+  if (cache_io_thread == NULL || !thread_post(cache_io_thread, job, context))
+    job(context);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_init
+ *
+ * Description      Start the I/O thread of the cache files.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_cache_init(void) {
+  if (cache_io_thread != NULL) return;
+
+  cache_io_thread = thread_new("bta_gattc_io");
+  if (cache_io_thread == NULL)
+    APPL_TRACE_ERROR("%s: unable to create the GATT cache I/O thread",
+                     __func__);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_cleanup
+ *
+ * Description      Complete the pending cache file jobs, stop the I/O thread
+ *                  and drop the preloaded caches.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_cache_cleanup(void) {
+  /* the thread runs the jobs that are still queued before it exits */
+  thread_free(cache_io_thread);
+  cache_io_thread = NULL;
+
+  std::lock_guard<std::mutex> lock(preload_lock);
+  for (int i = 0; i < GATT_CACHE_PRELOAD_MAX; i++) {
+    osi_free(preload[i].attr);
+    memset(&preload[i], 0, sizeof(tBTA_GATTC_PRELOAD));
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_preload
+ *
+ * Description      Read the cache of a server ahead of the connection to it,
+ *                  on the I/O thread.
+ *
+ * Parameter        server_bda: address of the server to connect to
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_cache_preload(BD_ADDR server_bda) {
+  tBTA_GATTC_SERV* p_srcb = bta_gattc_find_srcb(server_bda);
+  if (cache_io_thread == NULL || !btm_sec_is_a_bonded_dev(server_bda) ||
+      (p_srcb != NULL && p_srcb->p_srvc_cache != NULL))
+    return;
+
+  tBTA_GATTC_CACHE_PRELOAD* p_job =
+      (tBTA_GATTC_CACHE_PRELOAD*)osi_malloc(sizeof(tBTA_GATTC_CACHE_PRELOAD));
+  bta_gattc_generate_cache_file_name(p_job->fname, sizeof(p_job->fname),
+                                     server_bda);
+
+  {
+    std::lock_guard<std::mutex> lock(preload_lock);
+    tBTA_GATTC_PRELOAD* p_free = NULL;
+    for (int i = 0; i < GATT_CACHE_PRELOAD_MAX; i++) {
+      if (!preload[i].in_use) {
+        if (p_free == NULL) p_free = &preload[i];
+      } else if (bdcmp(preload[i].bda, server_bda) == 0) {
+        /* read already, or being read */
+        osi_free(p_job);
+        return;
+      }
+    }
+    if (p_free == NULL) {
+      osi_free(p_job);
+      return;
+    }
+
+    p_free->in_use = true;
+    p_free->pending = true;
+    p_free->seq = p_job->seq = ++preload_seq;
+    bdcpy(p_free->bda, server_bda);
+  }
+
+  if (!thread_post(cache_io_thread, bta_gattc_cache_preload_job, p_job)) {
+    osi_free(p_job);
+    bta_gattc_cache_drop_preload(server_bda);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_preload_job
+ *
+ * Description      Read a cache file ahead of the connection on the I/O
+ *                  thread, unless it has been dropped meanwhile.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_preload_job(void* context) {
+  tBTA_GATTC_CACHE_PRELOAD* p_job = (tBTA_GATTC_CACHE_PRELOAD*)context;
+  uint16_t num_attr = 0;
+  tBTA_GATTC_NV_ATTR* attr = NULL;
+  if (access(p_job->fname, F_OK) == 0)
+    attr = bta_gattc_cache_read_file(p_job->fname, &num_attr);
+
+  std::lock_guard<std::mutex> lock(preload_lock);
+  for (int i = 0; i < GATT_CACHE_PRELOAD_MAX; i++) {
+    tBTA_GATTC_PRELOAD* p_preload = &preload[i];
+    if (!p_preload->in_use || p_preload->seq != p_job->seq) continue;
+
+    if (attr == NULL) {
+      memset(p_preload, 0, sizeof(tBTA_GATTC_PRELOAD));
+    } else {
+      p_preload->pending = false;
+      p_preload->num_attr = num_attr;
+      p_preload->attr = attr;
+      attr = NULL;
+    }
+    break;
+  }
+
+  osi_free(attr);
+  osi_free(p_job);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_take_preload
+ *
+ * Description      Take the preloaded cache of a server, if it has been read.
+ *
+ * Returns          the attributes, to be freed by the caller, or NULL
+ *
+ ******************************************************************************/
+static tBTA_GATTC_NV_ATTR* bta_gattc_cache_take_preload(BD_ADDR server_bda,
+                                                        uint16_t* p_num_attr) {
+  std::lock_guard<std::mutex> lock(preload_lock);
+  for (int i = 0; i < GATT_CACHE_PRELOAD_MAX; i++) {
+    tBTA_GATTC_PRELOAD* p_preload = &preload[i];
+    if (!p_preload->in_use || bdcmp(p_preload->bda, server_bda) != 0)
+      continue;
+
+    /* a read still pending is dropped, the caller reads the file itself */
+    tBTA_GATTC_NV_ATTR* attr = p_preload->attr;
+    *p_num_attr = p_preload->num_attr;
+    memset(p_preload, 0, sizeof(tBTA_GATTC_PRELOAD));
+    return attr;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_drop_preload
+ *
+ * Description      Drop the preloaded cache of a server, or the read of it
+ *                  that is pending.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_drop_preload(BD_ADDR server_bda) {
+  uint16_t num_attr;
+  osi_free(bta_gattc_cache_take_preload(server_bda, &num_attr));
 }
 
 /*******************************************************************************
@@ -1425,20 +1910,138 @@ void bta_gattc_cache_save(tBTA_GATTC_SERV* p_srvc_cb, uint16_t conn_id) {
  *
  ******************************************************************************/
 bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb) {
-  char fname[255] = {0};
+  uint16_t num_attr = 0;
+  tBTA_GATTC_NV_ATTR* attr =
+      bta_gattc_cache_take_preload(p_clcb->p_srcb->server_bda, &num_attr);
+  if (attr != NULL) {
+    bta_gattc_rebuild_cache(p_clcb->p_srcb, num_attr, attr);
+    osi_free(attr);
+    return true;
+  }
+
+  char fname[GATT_CACHE_FNAME_LEN] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname),
                                      p_clcb->p_srcb->server_bda);
 
+  return bta_gattc_cache_read(p_clcb->p_srcb, fname);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_read_db_hash
+ *
+ * Description      Read the Database Hash characteristic of the server before
+ *                  discovering it, as the database may be known already from
+ *                  another server.
+ *
+ * Parameter        p_clcb: pointer to the clcb of the server to discover
+ *
+ * Returns          true if the read is started, and bta_gattc_db_hash_cmpl
+ *                  continues the discovery, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_read_db_hash(tBTA_GATTC_CLCB* p_clcb) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  p_srcb->db_hash_valid = false;
+
+  tGATT_READ_PARAM param;
+  memset(&param, 0, sizeof(tGATT_READ_PARAM));
+  param.char_type.uuid.len = LEN_UUID_16;
+  param.char_type.uuid.uu.uuid16 = GATT_UUID_DATABASE_HASH;
+  param.char_type.s_handle = 0x0001;
+  param.char_type.e_handle = 0xFFFF;
+  param.char_type.auth_req = GATT_AUTH_REQ_NONE;
+
+  p_srcb->db_hash_pending = true;
+  if (GATTC_Read(p_clcb->bta_conn_id, GATT_READ_BY_TYPE, &param) !=
+      GATT_SUCCESS) {
+    p_srcb->db_hash_pending = false;
+    return false;
+  }
+
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_db_hash_cmpl
+ *
+ * Description      Load the cached database of the Database Hash read from the
+ *                  server, or discover the server if it is unknown.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_db_hash_cmpl(tBTA_GATTC_CLCB* p_clcb, tGATT_STATUS status,
+                            tGATT_CL_COMPLETE* p_data) {
+  tBTA_GATTC_SERV* p_srcb = p_clcb->p_srcb;
+  p_srcb->db_hash_pending = false;
+
+  if (status == GATT_SUCCESS && p_data != NULL &&
+      p_data->att_value.len == BT_OCTET16_LEN) {
+    memcpy(p_srcb->db_hash, p_data->att_value.value, BT_OCTET16_LEN);
+    p_srcb->db_hash_valid = true;
+
+    char fname[GATT_CACHE_FNAME_LEN] = {0};
+    bta_gattc_generate_hash_file_name(fname, sizeof(fname), p_srcb->db_hash);
+    if (access(fname, F_OK) == 0 && bta_gattc_cache_read(p_srcb, fname)) {
+      LOG_INFO(LOG_TAG, "%s known Database Hash, skipping discovery",
+               __func__);
+      p_srcb->state = BTA_GATTC_SERV_SAVE;
+      bta_gattc_cache_save(p_srcb, p_clcb->bta_conn_id);
+      bta_gattc_reset_discover_st(p_srcb, BTA_GATT_OK);
+      return;
+    }
+  }
+
+  status = bta_gattc_discover_pri_service(p_clcb->bta_conn_id, p_srcb,
+                                          GATT_DISC_SRVC_ALL);
+  if (status != GATT_SUCCESS) {
+    APPL_TRACE_ERROR("%s: discovery on server failed", __func__);
+    bta_gattc_reset_discover_st(p_srcb, status);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_read
+ *
+ * Description      Load the GATT cache file fname into the cache of a server.
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_cache_read(tBTA_GATTC_SERV* p_srcb, const char* fname) {
+  uint16_t num_attr = 0;
+  tBTA_GATTC_NV_ATTR* attr = bta_gattc_cache_read_file(fname, &num_attr);
+  if (attr == NULL) return false;
+
+  bta_gattc_rebuild_cache(p_srcb, num_attr, attr);
+  osi_free(attr);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_read_file
+ *
+ * Description      Read the attributes of the GATT cache file fname. It does
+ *                  not touch the server caches, and runs on any thread.
+ *
+ * Returns          the attributes, to be freed by the caller, or NULL
+ *
+ ******************************************************************************/
+static tBTA_GATTC_NV_ATTR* bta_gattc_cache_read_file(const char* fname,
+                                                     uint16_t* p_num_attr) {
   FILE* fd = fopen(fname, "rb");
   if (!fd) {
     APPL_TRACE_ERROR("%s: can't open GATT cache file %s for reading, error: %s",
                      __func__, fname, strerror(errno));
-    return false;
+    return NULL;
   }
 
   uint16_t cache_ver = 0;
   tBTA_GATTC_NV_ATTR* attr = NULL;
-  bool success = false;
   uint16_t num_attr = 0;
 
   if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
@@ -1458,21 +2061,21 @@ bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb) {
     goto done;
   }
 
-  attr = (tBTA_GATTC_NV_ATTR*)osi_malloc(sizeof(tBTA_GATTC_NV_ATTR) * num_attr);
+  attr = (tBTA_GATTC_NV_ATTR*)osi_malloc_tagged(
+      sizeof(tBTA_GATTC_NV_ATTR) * num_attr, OSI_MEM_GATT_CACHE);
 
-  if (fread(attr, sizeof(tBTA_GATTC_NV_ATTR), 0xFF, fd) != num_attr) {
+  if (fread(attr, sizeof(tBTA_GATTC_NV_ATTR), num_attr, fd) != num_attr ||
+      fgetc(fd) != EOF) {
     APPL_TRACE_ERROR("%s: can't read GATT attributes: %s", __func__, fname);
+    osi_free_and_reset((void**)&attr);
     goto done;
   }
 
-  bta_gattc_rebuild_cache(p_clcb->p_srcb, num_attr, attr);
-
-  success = true;
+  *p_num_attr = num_attr;
 
 done:
-  osi_free(attr);
   fclose(fd);
-  return success;
+  return attr;
 }
 
 /*******************************************************************************
@@ -1482,46 +2085,121 @@ done:
  * Description      This callout function is executed by GATT when a server
  *                  cache is available to save.
  *
- * Parameter        server_bda: server bd address of this cache belongs to
+ * Parameter        fname: cache file of the server, by address or by
+ *                         Database Hash
  *                  num_attr: number of attribute to be save.
  *                  attr: pointer to the list of attributes to save.
  * Returns
  *
  ******************************************************************************/
-static void bta_gattc_cache_write(BD_ADDR server_bda, uint16_t num_attr,
+static void bta_gattc_cache_write(const char* fname, uint16_t num_attr,
                                   tBTA_GATTC_NV_ATTR* attr) {
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
+  char db_fname[GATT_CACHE_FNAME_LEN] = {0};
+  bta_gattc_generate_db_file_name(db_fname, sizeof(db_fname), num_attr, attr);
 
+  /* the file may be shared with other servers: replace it, do not write over
+   * it */
+  unlink(fname);
+
+  if (!bta_gattc_cache_file_matches(db_fname, num_attr, attr)) {
+    /* a different database with the same hash keeps its file */
+    if (access(db_fname, F_OK) == 0 ||
+        !bta_gattc_cache_write_file(db_fname, num_attr, attr)) {
+      bta_gattc_cache_write_file(fname, num_attr, attr);
+      return;
+    }
+  }
+
+  if (link(db_fname, fname) != 0) {
+    APPL_TRACE_ERROR("%s: can't link GATT cache file %s: %s", __func__, fname,
+                     strerror(errno));
+    bta_gattc_cache_write_file(fname, num_attr, attr);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_write_file
+ *
+ * Description      Write the attributes of a server cache to the file fname.
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_cache_write_file(const char* fname, uint16_t num_attr,
+                                       tBTA_GATTC_NV_ATTR* attr) {
   FILE* fd = fopen(fname, "wb");
   if (!fd) {
     APPL_TRACE_ERROR("%s: can't open GATT cache file for writing: %s", __func__,
                      fname);
-    return;
+    return false;
   }
 
   uint16_t cache_ver = GATT_CACHE_VERSION;
   if (fwrite(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
     APPL_TRACE_ERROR("%s: can't write GATT cache version: %s", __func__, fname);
-    fclose(fd);
-    return;
+    goto error;
   }
 
   if (fwrite(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
     APPL_TRACE_ERROR("%s: can't write GATT cache attribute count: %s", __func__,
                      fname);
-    fclose(fd);
-    return;
+    goto error;
   }
 
   if (fwrite(attr, sizeof(tBTA_GATTC_NV_ATTR), num_attr, fd) != num_attr) {
     APPL_TRACE_ERROR("%s: can't write GATT cache attributes: %s", __func__,
                      fname);
-    fclose(fd);
-    return;
+    goto error;
+  }
+
+  if (fclose(fd) != 0) {
+    unlink(fname);
+    return false;
   }
+  return true;
 
+error:
   fclose(fd);
+  unlink(fname);
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_file_matches
+ *
+ * Description      Check whether the file fname holds exactly the attributes
+ *                  of a server cache.
+ *
+ * Returns          true if it does, false otherwise
+ *
+ ******************************************************************************/
+static bool bta_gattc_cache_file_matches(const char* fname, uint16_t num_attr,
+                                         const tBTA_GATTC_NV_ATTR* attr) {
+  FILE* fd = fopen(fname, "rb");
+  if (!fd) return false;
+
+  uint16_t cache_ver = 0;
+  uint16_t file_num_attr = 0;
+  bool matches = fread(&cache_ver, sizeof(uint16_t), 1, fd) == 1 &&
+                 cache_ver == GATT_CACHE_VERSION &&
+                 fread(&file_num_attr, sizeof(uint16_t), 1, fd) == 1 &&
+                 file_num_attr == num_attr;
+
+  if (matches) {
+    tBTA_GATTC_NV_ATTR* file_attr = (tBTA_GATTC_NV_ATTR*)osi_malloc_tagged(
+        sizeof(tBTA_GATTC_NV_ATTR) * num_attr, OSI_MEM_GATT_CACHE);
+    matches = fread(file_attr, sizeof(tBTA_GATTC_NV_ATTR), num_attr, fd) ==
+                  num_attr &&
+              fgetc(fd) == EOF &&
+              memcmp(file_attr, attr, sizeof(tBTA_GATTC_NV_ATTR) * num_attr) ==
+                  0;
+    osi_free(file_attr);
+  }
+
+  fclose(fd);
+  return matches;
 }
 
 /*******************************************************************************
@@ -1538,7 +2216,25 @@ static void bta_gattc_cache_write(BD_ADDR server_bda, uint16_t num_attr,
  ******************************************************************************/
 void bta_gattc_cache_reset(BD_ADDR server_bda) {
   BTIF_TRACE_DEBUG("%s", __func__);
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
+  char* fname = (char*)osi_malloc(GATT_CACHE_FNAME_LEN);
+  bta_gattc_generate_cache_file_name(fname, GATT_CACHE_FNAME_LEN, server_bda);
+
+  /* after the writes still pending for the server */
+  bta_gattc_cache_drop_preload(server_bda);
+  bta_gattc_cache_post(bta_gattc_cache_unlink_job, fname);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_unlink_job
+ *
+ * Description      Remove a cache file on the I/O thread.
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+static void bta_gattc_cache_unlink_job(void* context) {
+  char* fname = (char*)context;
   unlink(fname);
+  osi_free(fname);
 }
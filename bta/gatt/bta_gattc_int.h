@@ -86,6 +86,22 @@ typedef uint16_t tBTA_GATTC_INT_EVT;
 
 #define BTA_GATTC_WRITE_PREPARE GATT_WRITE_PREPARE
 
+/* max client requests waiting behind the one in progress on a connection */
+#ifndef BTA_GATTC_CMD_Q_DEPTH
+#define BTA_GATTC_CMD_Q_DEPTH 32
+#endif
+
+/* max write commands (write without response) waiting behind the request in
+ * progress on a connection, in a lane of their own */
+#ifndef BTA_GATTC_WRITE_CMD_Q_DEPTH
+#define BTA_GATTC_WRITE_CMD_Q_DEPTH 16
+#endif
+
+/* write commands served in a row ahead of the waiting requests */
+#ifndef BTA_GATTC_WRITE_CMD_CREDITS
+#define BTA_GATTC_WRITE_CMD_CREDITS 4
+#endif
+
 /* internal strucutre for GATTC register API  */
 typedef struct {
   BT_HDR hdr;
@@ -224,6 +240,18 @@ typedef struct {
 #define BTA_GATTC_ATTR_LIST_SIZE \
   (BTA_GATTC_MAX_CACHE_CHAR * sizeof(tBTA_GATTC_ATTR_REC))
 
+/* Handle-sorted views of a server cache, for the lookups by handle. The
+ * arrays point into the list_t tree of the cache, and are rebuilt once the
+ * cache is complete. */
+typedef struct {
+  tBTA_GATTC_SERVICE** services; /* by start handle */
+  tBTA_GATTC_CHARACTERISTIC** characteristics; /* by value handle */
+  tBTA_GATTC_DESCRIPTOR** descriptors;         /* by handle */
+  uint16_t num_services;
+  uint16_t num_characteristics;
+  uint16_t num_descriptors;
+} tBTA_GATTC_HANDLE_INDEX;
+
 #ifndef BTA_GATTC_CACHE_SRVR_SIZE
 #define BTA_GATTC_CACHE_SRVR_SIZE 600
 #endif
@@ -250,15 +278,22 @@ typedef struct {
   uint8_t state;
 
   list_t* p_srvc_cache; /* list of tBTA_GATTC_SERVICE */
+  tBTA_GATTC_HANDLE_INDEX* p_handle_index; /* of p_srvc_cache, or NULL */
+  bool db_hash_pending; /* Database Hash read before discovery in progress */
+  bool db_hash_valid;   /* db_hash was read from the server */
+  BT_OCTET16 db_hash;
   uint8_t update_count; /* indication received */
   uint8_t num_clcb;     /* number of associated CLCB */
 
-  tBTA_GATTC_ATTR_REC* p_srvc_list;
-  uint8_t cur_srvc_idx;
-  uint8_t cur_char_idx;
+  tBTA_GATTC_ATTR_REC* p_srvc_list; /* services found by the discovery */
   uint8_t next_avail_idx;
   uint8_t total_srvc;
-  uint8_t total_char;
+  uint8_t incl_disc_srvc; /* total_srvc when the include discovery started */
+  bool incl_srvc_missed;  /* an include was found before its service */
+  uint16_t disc_char_handle;   /* characteristic of descriptor discovery */
+  uint16_t disc_dscp_e_handle; /* end of its descriptors */
+  uint32_t disc_start_ms;      /* boot time the discovery started at */
+  uint16_t disc_procedures;    /* GATT procedures run by the discovery */
 
   uint8_t srvc_hdl_chg; /* service handle change indication pending */
   uint16_t attr_index;  /* cahce NV saving/loading attribute index */
@@ -287,6 +322,13 @@ typedef struct {
   tBTA_GATTC_NOTIF_REG notif_reg[BTA_GATTC_NOTIF_REG_MAX];
 } tBTA_GATTC_RCB;
 
+/* client requests waiting for execution, oldest first */
+typedef struct {
+  tBTA_GATTC_DATA* p_cmd[BTA_GATTC_CMD_Q_DEPTH];
+  uint8_t first; /* index of the oldest request */
+  uint8_t count; /* number of requests */
+} tBTA_GATTC_CMD_Q;
+
 /* client channel is a mapping between a BTA client(cl_id) and a remote BD
  * address */
 typedef struct {
@@ -296,6 +338,9 @@ typedef struct {
   tBTA_GATTC_RCB* p_rcb;    /* pointer to the registration CB */
   tBTA_GATTC_SERV* p_srcb;  /* server cache CB */
   tBTA_GATTC_DATA* p_q_cmd; /* command in queue waiting for execution */
+  tBTA_GATTC_CMD_Q cmd_q;   /* requests waiting behind p_q_cmd */
+  tBTA_GATTC_CMD_Q write_cmd_q; /* write commands waiting behind p_q_cmd */
+  uint8_t write_cmd_credits;    /* write commands to serve before a request */
 
 #define BTA_GATTC_NO_SCHEDULE 0
 #define BTA_GATTC_DISC_WAITING 0x01
@@ -447,6 +492,10 @@ extern tBTA_GATTC_CLCB* bta_gattc_find_int_conn_clcb(tBTA_GATTC_DATA* p_msg);
 extern tBTA_GATTC_CLCB* bta_gattc_find_int_disconn_clcb(tBTA_GATTC_DATA* p_msg);
 
 extern bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data);
+extern tBTA_GATTC_DATA* bta_gattc_cmd_q_pop(tBTA_GATTC_CMD_Q* p_q);
+extern bool bta_gattc_holds_cmd(tBTA_GATTC_CLCB* p_clcb,
+                                tBTA_GATTC_DATA* p_data);
+extern void bta_gattc_continue(tBTA_GATTC_CLCB* p_clcb);
 
 extern bool bta_gattc_uuid_compare(const tBT_UUID* p_src, const tBT_UUID* p_tar,
                                    bool is_precise);
@@ -489,6 +538,7 @@ extern void bta_gattc_get_gatt_db(uint16_t conn_id, uint16_t start_handle,
                                   uint16_t end_handle, btgatt_db_element_t** db,
                                   int* count);
 extern tBTA_GATT_STATUS bta_gattc_init_cache(tBTA_GATTC_SERV* p_srvc_cb);
+extern void bta_gattc_clear_cache(tBTA_GATTC_SERV* p_srvc_cb);
 extern void bta_gattc_rebuild_cache(tBTA_GATTC_SERV* p_srcv, uint16_t num_attr,
                                     tBTA_GATTC_NV_ATTR* attr);
 extern void bta_gattc_cache_save(tBTA_GATTC_SERV* p_srvc_cb, uint16_t conn_id);
@@ -501,6 +551,13 @@ extern tBTA_GATTC_CONN* bta_gattc_conn_find_alloc(BD_ADDR remote_bda);
 extern bool bta_gattc_conn_dealloc(BD_ADDR remote_bda);
 
 extern bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb);
+extern bool bta_gattc_read_db_hash(tBTA_GATTC_CLCB* p_clcb);
+extern void bta_gattc_db_hash_cmpl(tBTA_GATTC_CLCB* p_clcb,
+                                   tGATT_STATUS status,
+                                   tGATT_CL_COMPLETE* p_data);
 extern void bta_gattc_cache_reset(BD_ADDR server_bda);
+extern void bta_gattc_cache_preload(BD_ADDR server_bda);
+extern void bta_gattc_cache_init(void);
+extern void bta_gattc_cache_cleanup(void);
 
 #endif /* BTA_GATTC_INT_H */
@@ -328,7 +328,7 @@ bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
     action = state_table[event][i];
     if (action != BTA_GATTC_IGNORE) {
       (*bta_gattc_action[action])(p_clcb, p_data);
-      if (p_clcb->p_q_cmd == p_data) {
+      if (bta_gattc_holds_cmd(p_clcb, p_data)) {
         /* buffer is queued, don't free in the bta dispatcher.
          * we free it ourselves when a completion event is received.
          */
@@ -346,6 +346,9 @@ bool bta_gattc_sm_execute(tBTA_GATTC_CLCB* p_clcb, uint16_t event,
                      gattc_state_code(p_clcb->state), gattc_evt_code(in_event));
   }
 #endif
+
+  /* serve the requests that wait for the one that just completed */
+  bta_gattc_continue(p_clcb);
   return rt;
 }
 
@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include "bt_common.h"
+#include "bt_uuid_key.h"
 #include "bta_gattc_int.h"
 #include "bta_sys.h"
 #include "btcore/include/bdaddr.h"
@@ -73,9 +74,6 @@ void bta_gatt_convert_uuid16_to_uuid128(uint8_t uuid_128[LEN_UUID_128],
  ******************************************************************************/
 bool bta_gattc_uuid_compare(const tBT_UUID* p_src, const tBT_UUID* p_tar,
                             bool is_precise) {
-  uint8_t su[LEN_UUID_128], tu[LEN_UUID_128];
-  const uint8_t *ps, *pt;
-
   /* any of the UUID is unspecified */
   if (p_src == 0 || p_tar == 0) {
     if (is_precise)
@@ -84,27 +82,7 @@ bool bta_gattc_uuid_compare(const tBT_UUID* p_src, const tBT_UUID* p_tar,
       return true;
   }
 
-  /* If both are 16-bit, we can do a simple compare */
-  if (p_src->len == 2 && p_tar->len == 2) {
-    return p_src->uu.uuid16 == p_tar->uu.uuid16;
-  }
-
-  /* One or both of the UUIDs is 128-bit */
-  if (p_src->len == LEN_UUID_16) {
-    /* convert a 16 bits UUID to 128 bits value */
-    bta_gatt_convert_uuid16_to_uuid128(su, p_src->uu.uuid16);
-    ps = su;
-  } else
-    ps = p_src->uu.uuid128;
-
-  if (p_tar->len == LEN_UUID_16) {
-    /* convert a 16 bits UUID to 128 bits value */
-    bta_gatt_convert_uuid16_to_uuid128(tu, p_tar->uu.uuid16);
-    pt = tu;
-  } else
-    pt = p_tar->uu.uuid128;
-
-  return (memcmp(ps, pt, LEN_UUID_128) == 0);
+  return BtUuidKey::Equal(*p_src, *p_tar);
 }
 
 /*******************************************************************************
@@ -208,6 +186,7 @@ tBTA_GATTC_CLCB* bta_gattc_clcb_alloc(tBTA_GATTC_IF client_if,
       p_clcb->in_use = true;
       p_clcb->status = BTA_GATT_OK;
       p_clcb->transport = transport;
+      p_clcb->write_cmd_credits = BTA_GATTC_WRITE_CMD_CREDITS;
       bdcpy(p_clcb->bda, remote_bda);
 
       p_clcb->p_rcb = bta_gattc_cl_get_regcb(client_if);
@@ -275,13 +254,15 @@ void bta_gattc_clcb_dealloc(tBTA_GATTC_CLCB* p_clcb) {
       p_srcb->mtu = 0;
 
       /* clean up cache */
-      if (p_srcb->p_srvc_cache) {
-        list_free(p_srcb->p_srvc_cache);
-        p_srcb->p_srvc_cache = NULL;
-      }
+      bta_gattc_clear_cache(p_srcb);
     }
 
     osi_free_and_reset((void**)&p_clcb->p_q_cmd);
+    tBTA_GATTC_DATA* p_cmd;
+    while ((p_cmd = bta_gattc_cmd_q_pop(&p_clcb->cmd_q)) != NULL)
+      osi_free(p_cmd);
+    while ((p_cmd = bta_gattc_cmd_q_pop(&p_clcb->write_cmd_q)) != NULL)
+      osi_free(p_cmd);
     memset(p_clcb, 0, sizeof(tBTA_GATTC_CLCB));
   } else {
     APPL_TRACE_ERROR("bta_gattc_clcb_dealloc p_clcb=NULL");
@@ -372,7 +353,7 @@ tBTA_GATTC_SERV* bta_gattc_srcb_alloc(BD_ADDR bda) {
     p_tcb = p_recycle;
 
   if (p_tcb != NULL) {
-    if (p_tcb->p_srvc_cache != NULL) list_free(p_tcb->p_srvc_cache);
+    bta_gattc_clear_cache(p_tcb);
 
     osi_free_and_reset((void**)&p_tcb->p_srvc_list);
     memset(p_tcb, 0, sizeof(tBTA_GATTC_SERV));
@@ -382,13 +363,87 @@ tBTA_GATTC_SERV* bta_gattc_srcb_alloc(BD_ADDR bda) {
   }
   return p_tcb;
 }
+/*******************************************************************************
+ *
+ * Function         bta_gattc_is_write_cmd
+ *
+ * Description      check if a client request is a write command, i.e. a
+ *                  write without response.
+ *
+ * Returns          true if it is a write command.
+ *
+ ******************************************************************************/
+static bool bta_gattc_is_write_cmd(const tBTA_GATTC_DATA* p_data) {
+  return p_data->hdr.event == BTA_GATTC_API_WRITE_EVT &&
+         p_data->api_write.write_type == BTA_GATTC_TYPE_WRITE_NO_RSP;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cmd_q_push
+ *
+ * Description      add a client request at the end of a request queue of
+ *                  max_count requests.
+ *
+ * Returns          false if the queue is full.
+ *
+ ******************************************************************************/
+static bool bta_gattc_cmd_q_push(tBTA_GATTC_CMD_Q* p_q, uint8_t max_count,
+                                 tBTA_GATTC_DATA* p_data) {
+  if (p_q->count >= max_count) return false;
+
+  p_q->p_cmd[(p_q->first + p_q->count) % BTA_GATTC_CMD_Q_DEPTH] = p_data;
+  p_q->count++;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cmd_q_pop
+ *
+ * Description      take the oldest client request out of a request queue.
+ *
+ * Returns          the request, or NULL if the queue is empty.
+ *
+ ******************************************************************************/
+tBTA_GATTC_DATA* bta_gattc_cmd_q_pop(tBTA_GATTC_CMD_Q* p_q) {
+  if (p_q->count == 0) return NULL;
+
+  tBTA_GATTC_DATA* p_data = p_q->p_cmd[p_q->first];
+  p_q->first = (p_q->first + 1) % BTA_GATTC_CMD_Q_DEPTH;
+  p_q->count--;
+  return p_data;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cmd_q_contains
+ *
+ * Description      check if a client request is in a request queue.
+ *
+ * Returns          true if it is.
+ *
+ ******************************************************************************/
+static bool bta_gattc_cmd_q_contains(const tBTA_GATTC_CMD_Q* p_q,
+                                     const tBTA_GATTC_DATA* p_data) {
+  for (uint8_t i = 0; i < p_q->count; i++) {
+    if (p_q->p_cmd[(p_q->first + i) % BTA_GATTC_CMD_Q_DEPTH] == p_data)
+      return true;
+  }
+  return false;
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_enqueue
  *
- * Description      enqueue a client request in clcb.
+ * Description      enqueue a client request in clcb. The request is the
+ *                  command in progress if there is none, otherwise it waits
+ *                  in the request queue, or in the write command lane for a
+ *                  write without response.
  *
- * Returns          success or failure.
+ * Returns          true if the request is to be executed now, false if it
+ *                  waits or the queue is full.
  *
  ******************************************************************************/
 bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
@@ -397,11 +452,71 @@ bool bta_gattc_enqueue(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
     return true;
   }
 
-  APPL_TRACE_ERROR("%s: already has a pending command!!", __func__);
-  /* skip the callback now. ----- need to send callback ? */
+  bool queued;
+  if (bta_gattc_is_write_cmd(p_data)) {
+    queued = bta_gattc_cmd_q_push(&p_clcb->write_cmd_q,
+                                  BTA_GATTC_WRITE_CMD_Q_DEPTH, p_data);
+  } else {
+    queued = bta_gattc_cmd_q_push(&p_clcb->cmd_q, BTA_GATTC_CMD_Q_DEPTH,
+                                  p_data);
+  }
+  if (!queued) {
+    APPL_TRACE_ERROR("%s: too many pending commands!!", __func__);
+    /* skip the callback now. ----- need to send callback ? */
+  }
   return false;
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_gattc_holds_cmd
+ *
+ * Description      check if a client request is in progress or waiting in
+ *                  clcb, and so is freed by GATTC once it completes.
+ *
+ * Returns          true if clcb holds the request.
+ *
+ ******************************************************************************/
+bool bta_gattc_holds_cmd(tBTA_GATTC_CLCB* p_clcb, tBTA_GATTC_DATA* p_data) {
+  if (p_data == NULL) return false;
+
+  return p_clcb->p_q_cmd == p_data ||
+         bta_gattc_cmd_q_contains(&p_clcb->cmd_q, p_data) ||
+         bta_gattc_cmd_q_contains(&p_clcb->write_cmd_q, p_data);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_continue
+ *
+ * Description      execute the waiting client requests of a connected clcb,
+ *                  in order, until one of them is in progress. The write
+ *                  commands go first, up to BTA_GATTC_WRITE_CMD_CREDITS in a
+ *                  row while requests are waiting.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void bta_gattc_continue(tBTA_GATTC_CLCB* p_clcb) {
+  while (p_clcb->in_use && p_clcb->p_q_cmd == NULL &&
+         p_clcb->state == BTA_GATTC_CONN_ST) {
+    tBTA_GATTC_DATA* p_cmd;
+    if (p_clcb->write_cmd_q.count > 0 &&
+        (p_clcb->write_cmd_credits > 0 || p_clcb->cmd_q.count == 0)) {
+      if (p_clcb->cmd_q.count > 0) p_clcb->write_cmd_credits--;
+      p_cmd = bta_gattc_cmd_q_pop(&p_clcb->write_cmd_q);
+    } else {
+      p_clcb->write_cmd_credits = BTA_GATTC_WRITE_CMD_CREDITS;
+      p_cmd = bta_gattc_cmd_q_pop(&p_clcb->cmd_q);
+    }
+    if (p_cmd == NULL) break;
+
+    bta_gattc_sm_execute(p_clcb, p_cmd->hdr.event, p_cmd);
+    /* free it unless it is in progress, or waiting again */
+    if (!bta_gattc_holds_cmd(p_clcb, p_cmd)) osi_free(p_cmd);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_gattc_check_notif_registry
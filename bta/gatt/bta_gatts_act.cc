@@ -358,6 +358,35 @@ void bta_gatts_send_rsp(UNUSED_ATTR tBTA_GATTS_CB* p_cb,
     APPL_TRACE_ERROR("Sending response failed");
   }
 }
+
+/*******************************************************************************
+ *
+ * Function         bta_gatts_set_attr_value
+ *
+ * Description      GATTS set or invalidate the value of an attribute read by
+ *                  the stack.
+ *
+ * Returns          none.
+ *
+ ******************************************************************************/
+void bta_gatts_set_attr_value(UNUSED_ATTR tBTA_GATTS_CB* p_cb,
+                              tBTA_GATTS_DATA* p_msg) {
+  tBTA_GATTS_API_SET_VALUE& set_value = p_msg->api_set_value;
+  tGATT_STATUS status;
+
+  if (set_value.invalidate)
+    status = GATTS_InvalidateAttributeValue(
+        set_value.server_if, set_value.attr_id, set_value.version);
+  else
+    status = GATTS_SetAttributeValue(set_value.server_if, set_value.attr_id,
+                                     set_value.version, set_value.len,
+                                     set_value.value);
+
+  if (status != GATT_SUCCESS)
+    APPL_TRACE_WARNING("%s: attr_id=0x%04x version=%u status=0x%02x",
+                       __func__, set_value.attr_id, set_value.version,
+                       status);
+}
 /*******************************************************************************
  *
  * Function         bta_gatts_indicate_handle
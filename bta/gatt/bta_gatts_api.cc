@@ -265,6 +265,77 @@ void BTA_GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
   bta_sys_sendmsg(p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_SetAttributeValue
+ *
+ * Description      This function is called to give the stack the value of a
+ *                  characteristic or descriptor, so that it answers the reads
+ *                  of the clients without sending them to the application.
+ *                  The value stays until it is invalidated, or until a client
+ *                  writes the attribute.
+ *
+ * Parameters       server_if - server interface.
+ *                  attr_id - attribute ID of the value.
+ *                  version - of the value; an update older than the last one
+ *                            applied to the attribute is ignored.
+ *                  value - the value.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void BTA_GATTS_SetAttributeValue(tBTA_GATTS_IF server_if, uint16_t attr_id,
+                                 uint32_t version,
+                                 std::vector<uint8_t> value) {
+  tBTA_GATTS_API_SET_VALUE* p_buf =
+      (tBTA_GATTS_API_SET_VALUE*)osi_calloc(sizeof(tBTA_GATTS_API_SET_VALUE));
+
+  if (value.size() > BTA_GATT_MAX_ATTR_LEN) {
+    APPL_TRACE_ERROR("%s: value of %zu octets is too long", __func__,
+                     value.size());
+    osi_free(p_buf);
+    return;
+  }
+
+  p_buf->hdr.event = BTA_GATTS_API_SET_VALUE_EVT;
+  p_buf->server_if = server_if;
+  p_buf->attr_id = attr_id;
+  p_buf->version = version;
+  p_buf->len = value.size();
+  if (value.size() > 0) memcpy(p_buf->value, value.data(), value.size());
+
+  bta_sys_sendmsg(p_buf);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_InvalidateAttributeValue
+ *
+ * Description      This function is called to drop the value given by
+ *                  BTA_GATTS_SetAttributeValue, so that the reads of the
+ *                  attribute are sent to the application again.
+ *
+ * Parameters       server_if - server interface.
+ *                  attr_id - attribute ID of the value.
+ *                  version - of the invalidation, ordered with the updates.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void BTA_GATTS_InvalidateAttributeValue(tBTA_GATTS_IF server_if,
+                                        uint16_t attr_id, uint32_t version) {
+  tBTA_GATTS_API_SET_VALUE* p_buf =
+      (tBTA_GATTS_API_SET_VALUE*)osi_calloc(sizeof(tBTA_GATTS_API_SET_VALUE));
+
+  p_buf->hdr.event = BTA_GATTS_API_SET_VALUE_EVT;
+  p_buf->server_if = server_if;
+  p_buf->attr_id = attr_id;
+  p_buf->version = version;
+  p_buf->invalidate = true;
+
+  bta_sys_sendmsg(p_buf);
+}
+
 /*******************************************************************************
  *
  * Function         BTA_GATTS_Open
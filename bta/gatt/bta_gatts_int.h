@@ -46,7 +46,8 @@ enum {
   BTA_GATTS_API_OPEN_EVT,
   BTA_GATTS_API_CANCEL_OPEN_EVT,
   BTA_GATTS_API_CLOSE_EVT,
-  BTA_GATTS_API_DISABLE_EVT
+  BTA_GATTS_API_DISABLE_EVT,
+  BTA_GATTS_API_SET_VALUE_EVT
 };
 typedef uint16_t tBTA_GATTS_INT_EVT;
 
@@ -92,6 +93,16 @@ typedef struct {
   tBTA_GATTS_RSP* p_rsp;
 } tBTA_GATTS_API_RSP;
 
+typedef struct {
+  BT_HDR hdr;
+  tBTA_GATTS_IF server_if;
+  uint16_t attr_id;
+  uint32_t version;
+  bool invalidate; /* the reads go to the app again */
+  uint16_t len;
+  uint8_t value[BTA_GATT_MAX_ATTR_LEN];
+} tBTA_GATTS_API_SET_VALUE;
+
 typedef struct {
   BT_HDR hdr;
   tBTA_GATT_TRANSPORT transport;
@@ -115,6 +126,7 @@ typedef union {
   tBTA_GATTS_API_ADD_SERVICE api_add_service;
   tBTA_GATTS_API_INDICATION api_indicate;
   tBTA_GATTS_API_RSP api_rsp;
+  tBTA_GATTS_API_SET_VALUE api_set_value;
   tBTA_GATTS_API_OPEN api_open;
   tBTA_GATTS_API_CANCEL_OPEN api_cancel_open;
 
@@ -168,6 +180,8 @@ extern void bta_gatts_stop_service(tBTA_GATTS_SRVC_CB* p_srvc_cb,
                                    tBTA_GATTS_DATA* p_msg);
 
 extern void bta_gatts_send_rsp(tBTA_GATTS_CB* p_cb, tBTA_GATTS_DATA* p_msg);
+extern void bta_gatts_set_attr_value(tBTA_GATTS_CB* p_cb,
+                                     tBTA_GATTS_DATA* p_msg);
 extern void bta_gatts_indicate_handle(tBTA_GATTS_CB* p_cb,
                                       tBTA_GATTS_DATA* p_msg);
 
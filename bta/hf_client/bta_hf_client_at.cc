@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "bta_hf_client_api.h"
@@ -827,21 +828,30 @@ static char* bta_hf_client_parse_ring(tBTA_HF_CLIENT_CB* client_cb,
   return buffer;
 }
 
+/* parses the unsigned decimal at |buffer| as sscanf("%u") would, returns the
+ * character following it or NULL if there is none */
+static char* bta_hf_client_parse_uint(char* buffer, uint32_t* value) {
+  char* end;
+
+  *value = (uint32_t)strtoul(buffer, &end, 10);
+  if (end == buffer) {
+    return NULL;
+  }
+
+  return end;
+}
+
 /* generic uint32 parser */
 static char* bta_hf_client_parse_uint32(
     tBTA_HF_CLIENT_CB* client_cb, char* buffer,
     void (*handler_callback)(tBTA_HF_CLIENT_CB*, uint32_t)) {
   uint32_t value;
-  int res;
-  int offset;
 
-  res = sscanf(buffer, "%u%n", &value, &offset);
-  if (res < 1) {
+  buffer = bta_hf_client_parse_uint(buffer, &value);
+  if (buffer == NULL) {
     return NULL;
   }
 
-  buffer += offset;
-
   AT_CHECK_RN(buffer);
 
   handler_callback(client_cb, value);
@@ -988,23 +998,20 @@ static char* bta_hf_client_parse_chld(tBTA_HF_CLIENT_CB* client_cb,
 static char* bta_hf_client_parse_ciev(tBTA_HF_CLIENT_CB* client_cb,
                                       char* buffer) {
   uint32_t index, value;
-  int res;
-  int offset = 0;
 
   AT_CHECK_EVENT(buffer, "+CIEV:");
 
-  res = sscanf(buffer, "%u,%u%n", &index, &value, &offset);
-  if (res < 2) {
+  /* the phones send these constantly, they are parsed without sscanf */
+  buffer = bta_hf_client_parse_uint(buffer, &index);
+  if (buffer == NULL || *buffer != ',') {
     return NULL;
   }
 
-  if (offset == 0) {
-    APPL_TRACE_ERROR("%s: Format Error %s", __func__, buffer);
+  buffer = bta_hf_client_parse_uint(buffer + 1, &value);
+  if (buffer == NULL) {
     return NULL;
   }
 
-  buffer += offset;
-
   AT_CHECK_RN(buffer);
 
   bta_hf_client_handle_ciev(client_cb, index, value);
@@ -1456,25 +1463,72 @@ static char* bta_hf_client_skip_unknown(tBTA_HF_CLIENT_CB* client_cb,
  */
 typedef char* (*tBTA_HF_CLIENT_PARSER_CALLBACK)(tBTA_HF_CLIENT_CB*, char*);
 
-static const tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_parser_cb[] = {
-    bta_hf_client_parse_ok,          bta_hf_client_parse_error,
-    bta_hf_client_parse_ring,        bta_hf_client_parse_brsf,
-    bta_hf_client_parse_cind,        bta_hf_client_parse_ciev,
-    bta_hf_client_parse_chld,        bta_hf_client_parse_bcs,
-    bta_hf_client_parse_bsir,        bta_hf_client_parse_cmeerror,
-    bta_hf_client_parse_vgm,         bta_hf_client_parse_vgme,
-    bta_hf_client_parse_vgs,         bta_hf_client_parse_vgse,
-    bta_hf_client_parse_bvra,        bta_hf_client_parse_clip,
-    bta_hf_client_parse_ccwa,        bta_hf_client_parse_cops,
-    bta_hf_client_parse_binp,        bta_hf_client_parse_clcc,
-    bta_hf_client_parse_cnum,        bta_hf_client_parse_btrh,
-    bta_hf_client_parse_busy,        bta_hf_client_parse_delayed,
-    bta_hf_client_parse_no_carrier,  bta_hf_client_parse_no_answer,
-    bta_hf_client_parse_blacklisted, bta_hf_client_skip_unknown};
+typedef struct {
+  const char* event;
+  uint8_t event_len;
+  tBTA_HF_CLIENT_PARSER_CALLBACK parser;
+} tBTA_HF_CLIENT_PARSER;
+
+#define BTA_HF_CLIENT_PARSER_ENTRY(event, parser) \
+  { event, sizeof(event) - 1, parser }
+
+/* The events, following the <cr><lf>, in ASCII order. None of them is the
+ * prefix of another: each one is found with a binary search, instead of each
+ * parser being tried in turn. */
+static const tBTA_HF_CLIENT_PARSER bta_hf_client_parsers[] = {
+    BTA_HF_CLIENT_PARSER_ENTRY("+BCS:", bta_hf_client_parse_bcs),
+    BTA_HF_CLIENT_PARSER_ENTRY("+BINP:", bta_hf_client_parse_binp),
+    BTA_HF_CLIENT_PARSER_ENTRY("+BRSF:", bta_hf_client_parse_brsf),
+    BTA_HF_CLIENT_PARSER_ENTRY("+BSIR:", bta_hf_client_parse_bsir),
+    BTA_HF_CLIENT_PARSER_ENTRY("+BTRH:", bta_hf_client_parse_btrh),
+    BTA_HF_CLIENT_PARSER_ENTRY("+BVRA:", bta_hf_client_parse_bvra),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CCWA:", bta_hf_client_parse_ccwa),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CHLD:", bta_hf_client_parse_chld),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CIEV:", bta_hf_client_parse_ciev),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CIND:", bta_hf_client_parse_cind),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CLCC:", bta_hf_client_parse_clcc),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CLIP:", bta_hf_client_parse_clip),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CME ERROR:", bta_hf_client_parse_cmeerror),
+    BTA_HF_CLIENT_PARSER_ENTRY("+CNUM:", bta_hf_client_parse_cnum),
+    BTA_HF_CLIENT_PARSER_ENTRY("+COPS:", bta_hf_client_parse_cops),
+    BTA_HF_CLIENT_PARSER_ENTRY("+VGM:", bta_hf_client_parse_vgm),
+    BTA_HF_CLIENT_PARSER_ENTRY("+VGM=", bta_hf_client_parse_vgme),
+    BTA_HF_CLIENT_PARSER_ENTRY("+VGS:", bta_hf_client_parse_vgs),
+    BTA_HF_CLIENT_PARSER_ENTRY("+VGS=", bta_hf_client_parse_vgse),
+    BTA_HF_CLIENT_PARSER_ENTRY("BLACKLISTED", bta_hf_client_parse_blacklisted),
+    BTA_HF_CLIENT_PARSER_ENTRY("BUSY", bta_hf_client_parse_busy),
+    BTA_HF_CLIENT_PARSER_ENTRY("DELAYED", bta_hf_client_parse_delayed),
+    BTA_HF_CLIENT_PARSER_ENTRY("ERROR", bta_hf_client_parse_error),
+    BTA_HF_CLIENT_PARSER_ENTRY("NO ANSWER", bta_hf_client_parse_no_answer),
+    BTA_HF_CLIENT_PARSER_ENTRY("NO CARRIER", bta_hf_client_parse_no_carrier),
+    BTA_HF_CLIENT_PARSER_ENTRY("OK", bta_hf_client_parse_ok),
+    BTA_HF_CLIENT_PARSER_ENTRY("RING", bta_hf_client_parse_ring),
+};
 
 /* calculate supported event list length */
-static const uint16_t bta_hf_client_parser_cb_count =
-    sizeof(bta_hf_client_parser_cb) / sizeof(bta_hf_client_parser_cb[0]);
+static const uint16_t bta_hf_client_parsers_count =
+    sizeof(bta_hf_client_parsers) / sizeof(bta_hf_client_parsers[0]);
+
+/* returns the parser of the event at |buf|, or NULL if it is unknown */
+static tBTA_HF_CLIENT_PARSER_CALLBACK bta_hf_client_find_parser(
+    const char* buf) {
+  if (buf[0] != '\r' || buf[1] != '\n') return NULL;
+  buf += 2;
+
+  uint16_t low = 0;
+  uint16_t high = bta_hf_client_parsers_count;
+  while (low < high) {
+    uint16_t mid = (low + high) / 2;
+    const tBTA_HF_CLIENT_PARSER* p = &bta_hf_client_parsers[mid];
+    int cmp = strncmp(p->event, buf, p->event_len);
+    if (cmp == 0) return p->parser;
+    if (cmp < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return NULL;
+}
 
 #ifdef BTA_HF_CLIENT_AT_DUMP
 static void bta_hf_client_dump_at(tBTA_HF_CLIENT_CB* client_cb) {
@@ -1514,23 +1568,20 @@ static void bta_hf_client_at_parse_start(tBTA_HF_CLIENT_CB* client_cb) {
 #endif
 
   while (*buf != '\0') {
-    int i;
     char* tmp = NULL;
+    tBTA_HF_CLIENT_PARSER_CALLBACK parser = bta_hf_client_find_parser(buf);
 
-    for (i = 0; i < bta_hf_client_parser_cb_count; i++) {
-      tmp = bta_hf_client_parser_cb[i](client_cb, buf);
+    if (parser != NULL) {
+      tmp = parser(client_cb, buf);
       if (tmp == NULL) {
         APPL_TRACE_ERROR("HFPCient: AT event/reply parsing failed, skipping");
-        tmp = bta_hf_client_skip_unknown(client_cb, buf);
-        break;
       }
+    }
 
-      /* matched or unknown skipped, if unknown failed tmp is NULL so
-         this is also handled */
-      if (tmp != buf) {
-        buf = tmp;
-        break;
-      }
+    /* unknown or not parsed, if skipping failed tmp is NULL so this is also
+       handled */
+    if (tmp == NULL || tmp == buf) {
+      tmp = bta_hf_client_skip_unknown(client_cb, buf);
     }
 
     /* could not skip unknown (received garbage?)... disconnect */
@@ -1111,6 +1111,19 @@ static void bta_hh_cback(uint8_t dev_handle, BD_ADDR addr, uint8_t event,
       sm_event = BTA_HH_INT_CLOSE_EVT;
       break;
     case HID_HDEV_EVT_INTR_DATA:
+      /* The input reports of a connected device are given to the platform at
+       * once, without a round trip through the BTA message queue: the
+       * state machine would only do the same */
+      xx = bta_hh_dev_handle_to_cb_idx(dev_handle);
+      if (xx != BTA_HH_IDX_INVALID &&
+          bta_hh_cb.kdev[xx].state == BTA_HH_CONN_ST && pdata != NULL) {
+        tBTA_HH_DEV_CB* p_cb = &bta_hh_cb.kdev[xx];
+        bta_hh_co_data(dev_handle, (uint8_t*)(pdata + 1) + pdata->offset,
+                       pdata->len, p_cb->mode, p_cb->sub_class,
+                       p_cb->dscp_info.ctry_code, p_cb->addr, p_cb->app_id);
+        osi_free(pdata);
+        return;
+      }
       sm_event = BTA_HH_INT_DATA_EVT;
       break;
     case HID_HDEV_EVT_HANDSHAKE:
@@ -201,6 +201,7 @@ typedef struct {
   uint8_t* rpt_map;
   uint16_t ext_rpt_ref;
   tBTA_HH_DEV_DESCR descriptor;
+  bool cached; /* saved to, or restored from, the report cache */
 
 } tBTA_HH_LE_HID_SRVC;
 
@@ -68,10 +68,10 @@ static const uint16_t bta_hh_uuid_to_rtp_type[BTA_LE_HID_RTP_UUID_MAX][2] = {
 
 static void bta_hh_gattc_callback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data);
 static void bta_hh_le_add_dev_bg_conn(tBTA_HH_DEV_CB* p_cb, bool check_bond);
-// TODO(jpawlowski): uncomment when fixed
-// static void bta_hh_process_cache_rpt (tBTA_HH_DEV_CB *p_cb,
-//                                       tBTA_HH_RPT_CACHE_ENTRY *p_rpt_cache,
-//                                       uint8_t num_rpt);
+static bool bta_hh_process_cache_rpt(tBTA_HH_DEV_CB* p_cb,
+                                     tBTA_HH_RPT_CACHE_ENTRY* p_rpt_cache,
+                                     uint8_t num_rpt);
+static void bta_hh_le_save_rpt_cache(tBTA_HH_DEV_CB* p_cb);
 
 #define GATT_READ_CHAR 0
 #define GATT_READ_DESC 1
@@ -659,14 +659,6 @@ void bta_hh_le_save_report_ref(tBTA_HH_DEV_CB* p_dev_cb, tBTA_HH_LE_RPT* p_rpt,
 #if (BTA_HH_DEBUG == TRUE)
     APPL_TRACE_DEBUG("%s: report ID: %d", __func__, p_rpt->rpt_id);
 #endif
-    tBTA_HH_RPT_CACHE_ENTRY rpt_entry;
-    rpt_entry.rpt_id = p_rpt->rpt_id;
-    rpt_entry.rpt_type = p_rpt->rpt_type;
-    rpt_entry.rpt_uuid = p_rpt->uuid;
-    rpt_entry.srvc_inst_id = p_rpt->srvc_inst_id;
-    rpt_entry.char_inst_id = p_rpt->char_inst_id;
-
-    bta_hh_le_co_rpt_info(p_dev_cb->addr, &rpt_entry, p_dev_cb->app_id);
   }
 
   if (p_rpt->index < BTA_HH_LE_RPT_MAX - 1)
@@ -782,6 +774,9 @@ void bta_hh_le_open_cmpl(tBTA_HH_DEV_CB* p_cb) {
 #if (BTA_HH_DEBUG == TRUE)
     bta_hh_le_hid_report_dbg(p_cb);
 #endif
+    if (p_cb->status == BTA_HH_OK && !p_cb->hid_srvc.cached)
+      bta_hh_le_save_rpt_cache(p_cb);
+
     bta_hh_le_register_input_notif(p_cb, p_cb->mode, true);
     bta_hh_sm_execute(p_cb, BTA_HH_OPEN_CMPL_EVT, NULL);
 
@@ -1138,14 +1133,12 @@ void bta_hh_security_cmpl(tBTA_HH_DEV_CB* p_cb,
       APPL_TRACE_DEBUG("bta_hh_security_cmpl no reports loaded, try to load");
 
       /* start loading the cache if not in stack */
-      // TODO(jpawlowski): cache storage is broken, fix it
-      // tBTA_HH_RPT_CACHE_ENTRY     *p_rpt_cache;
-      // uint8_t                       num_rpt = 0;
-      // if ((p_rpt_cache = bta_hh_le_co_cache_load(p_cb->addr, &num_rpt,
-      // p_cb->app_id)) != NULL)
-      // {
-      //     bta_hh_process_cache_rpt(p_cb, p_rpt_cache, num_rpt);
-      // }
+      tBTA_HH_RPT_CACHE_ENTRY* p_rpt_cache;
+      uint8_t num_rpt = 0;
+      p_rpt_cache = bta_hh_le_co_cache_load(p_cb->addr, &num_rpt, p_cb->app_id);
+      if (p_rpt_cache == NULL ||
+          !bta_hh_process_cache_rpt(p_cb, p_rpt_cache, num_rpt))
+        APPL_TRACE_DEBUG("%s: no usable report cache", __func__);
     }
     /*  discovery has been done for HID service */
     if (p_cb->app_id != 0 && p_cb->hid_srvc.in_use) {
@@ -2286,59 +2279,123 @@ void bta_hh_le_hid_read_rpt_clt_cfg(BD_ADDR bd_addr, uint8_t rpt_id) {
 
 /*******************************************************************************
  *
- * Function         bta_hh_process_cache_rpt
+ * Function         bta_hh_le_save_rpt_cache
  *
- * Description      Process the cached reports
+ * Description      Save the HID service of a bonded device once discovered,
+ *                  so that its next connections skip the discovery.
  *
  * Parameters:
  *
  ******************************************************************************/
-// TODO(jpawlowski): uncomment when fixed
-// static void bta_hh_process_cache_rpt (tBTA_HH_DEV_CB *p_cb,
-//                                       tBTA_HH_RPT_CACHE_ENTRY *p_rpt_cache,
-//                                       uint8_t num_rpt)
-// {
-//     uint8_t                       i = 0;
-//     tBTA_HH_LE_RPT              *p_rpt;
-
-//     if (num_rpt != 0)  /* no cache is found */
-//     {
-//         p_cb->hid_srvc.in_use = true;
-
-//         /* set the descriptor info */
-//         p_cb->hid_srvc.descriptor.dl_len =
-//                 p_cb->dscp_info.descriptor.dl_len;
-//         p_cb->hid_srvc.descriptor.dsc_list =
-//                     p_cb->dscp_info.descriptor.dsc_list;
-
-//         for (; i <num_rpt; i ++, p_rpt_cache ++)
-//         {
-//             if ((p_rpt = bta_hh_le_find_alloc_report_entry (p_cb,
-//                                                p_rpt_cache->srvc_inst_id,
-//                                                p_rpt_cache->rpt_uuid,
-//                                                p_rpt_cache->char_inst_id,
-//                                                p_rpt_cache->prop))  == NULL)
-//             {
-//                 APPL_TRACE_ERROR("bta_hh_process_cache_rpt: allocation report
-//                 entry failure");
-//                 break;
-//             }
-//             else
-//             {
-//                 p_rpt->rpt_type =  p_rpt_cache->rpt_type;
-//                 p_rpt->rpt_id   =  p_rpt_cache->rpt_id;
-
-//                 if (p_rpt->uuid == GATT_UUID_HID_BT_KB_INPUT ||
-//                     p_rpt->uuid == GATT_UUID_HID_BT_MOUSE_INPUT ||
-//                     (p_rpt->uuid == GATT_UUID_HID_REPORT && p_rpt->rpt_type
-//                     == BTA_HH_RPTT_INPUT))
-//                 {
-//                     p_rpt->client_cfg_value =
-//                     BTA_GATT_CLT_CONFIG_NOTIFICATION;
-//                 }
-//             }
-//         }
-//     }
-// }
+static void bta_hh_le_save_rpt_cache(tBTA_HH_DEV_CB* p_cb) {
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
+  tBTA_HH_LE_RPT* p_rpt = &p_srvc->report[0];
+  tBTA_HH_RPT_CACHE_ENTRY entry;
+  uint8_t sec_flag = 0;
+  uint8_t i;
+
+  /* only a bonded device keeps its client configurations */
+  BTM_GetSecurityFlagsByTransport(p_cb->addr, &sec_flag, BT_TRANSPORT_LE);
+  if ((sec_flag & BTM_SEC_FLAG_LKEY_KNOWN) == 0) return;
+
+  bta_hh_le_co_reset_rpt_cache(p_cb->addr, p_cb->app_id);
+
+  /* the protocol mode and control point first, as the reports may not all
+   * fit */
+  memset(&entry, 0, sizeof(entry));
+  entry.srvc_inst_id = p_srvc->srvc_inst_id;
+  if (p_srvc->proto_mode_handle != 0) {
+    entry.rpt_uuid = GATT_UUID_HID_PROTO_MODE;
+    entry.char_inst_id = p_srvc->proto_mode_handle;
+    bta_hh_le_co_rpt_info(p_cb->addr, &entry, p_cb->app_id);
+  }
+  if (p_srvc->control_point_handle != 0) {
+    entry.rpt_uuid = GATT_UUID_HID_CONTROL_POINT;
+    entry.char_inst_id = p_srvc->control_point_handle;
+    bta_hh_le_co_rpt_info(p_cb->addr, &entry, p_cb->app_id);
+  }
+
+  for (i = 0; i < BTA_HH_LE_RPT_MAX && p_rpt->in_use; i++, p_rpt++) {
+    entry.rpt_uuid = p_rpt->uuid;
+    entry.rpt_id = p_rpt->rpt_id;
+    entry.rpt_type = p_rpt->rpt_type;
+    entry.srvc_inst_id = p_rpt->srvc_inst_id;
+    entry.char_inst_id = p_rpt->char_inst_id;
+    bta_hh_le_co_rpt_info(p_cb->addr, &entry, p_cb->app_id);
+  }
+
+  p_srvc->cached = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_hh_process_cache_rpt
+ *
+ * Description      Process the cached reports: restore the HID service as it
+ *                  was discovered, the report map being the one stored with
+ *                  the device. The input reports are taken as notifying, as
+ *                  the bonded device kept its client configurations.
+ *
+ * Returns          true if the HID service was restored, false if it is to
+ *                  be discovered.
+ *
+ ******************************************************************************/
+static bool bta_hh_process_cache_rpt(tBTA_HH_DEV_CB* p_cb,
+                                     tBTA_HH_RPT_CACHE_ENTRY* p_rpt_cache,
+                                     uint8_t num_rpt) {
+  tBTA_HH_LE_HID_SRVC* p_srvc = &p_cb->hid_srvc;
+  tBTA_HH_DEV_DESCR* p_dscp = &p_cb->dscp_info.descriptor;
+  tBTA_HH_LE_RPT* p_rpt;
+  uint8_t i, num = 0;
+
+  if (num_rpt == 0 || p_dscp->dl_len == 0 || p_dscp->dsc_list == NULL)
+    return false;
+
+  for (i = 0; i < num_rpt; i++, p_rpt_cache++) {
+    /* the services of the device changed since */
+    if (BTA_GATTC_GetCharacteristic(p_cb->conn_id,
+                                    p_rpt_cache->char_inst_id) == NULL) {
+      APPL_TRACE_WARNING("%s: no characteristic 0x%04x, discarding the cache",
+                         __func__, p_rpt_cache->char_inst_id);
+      memset(p_srvc, 0, sizeof(tBTA_HH_LE_HID_SRVC));
+      return false;
+    }
+
+    p_srvc->srvc_inst_id = p_rpt_cache->srvc_inst_id;
+    switch (p_rpt_cache->rpt_uuid) {
+      case GATT_UUID_HID_PROTO_MODE:
+        p_srvc->proto_mode_handle = p_rpt_cache->char_inst_id;
+        break;
+      case GATT_UUID_HID_CONTROL_POINT:
+        p_srvc->control_point_handle = (uint8_t)p_rpt_cache->char_inst_id;
+        break;
+      default:
+        if (num == BTA_HH_LE_RPT_MAX) break;
+
+        p_rpt = &p_srvc->report[num];
+        p_rpt->index = num++;
+        p_rpt->in_use = true;
+        p_rpt->srvc_inst_id = p_rpt_cache->srvc_inst_id;
+        p_rpt->char_inst_id = (uint8_t)p_rpt_cache->char_inst_id;
+        p_rpt->uuid = p_rpt_cache->rpt_uuid;
+        p_rpt->rpt_id = p_rpt_cache->rpt_id;
+        p_rpt->rpt_type = p_rpt_cache->rpt_type;
+        if (p_rpt->rpt_type == BTA_HH_RPTT_INPUT)
+          p_rpt->client_cfg_value = BTA_GATT_CLT_CONFIG_NOTIFICATION;
+        break;
+    }
+  }
+
+  p_srvc->rpt_map = (uint8_t*)osi_malloc(p_dscp->dl_len);
+  memcpy(p_srvc->rpt_map, p_dscp->dsc_list, p_dscp->dl_len);
+  p_srvc->descriptor.dl_len = p_dscp->dl_len;
+  p_srvc->descriptor.dsc_list = p_srvc->rpt_map;
+
+  p_srvc->in_use = true;
+  p_srvc->cached = true;
+
+  APPL_TRACE_DEBUG("%s: restored %d reports", __func__, num);
+  return true;
+}
 
 #endif
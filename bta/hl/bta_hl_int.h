@@ -44,7 +44,8 @@ typedef uint16_t(tBTA_HL_ALLOCATE_PSM)(void);
 #define BTA_HL_MIN_SDP_MDEP_LEN 7
 
 /* L2CAP defualt parameters */
-#define BTA_HL_L2C_TX_WIN_SIZE 10
+#define BTA_HL_L2C_TX_WIN_SIZE 32     /* the least window of a channel */
+#define BTA_HL_L2C_MAX_TX_WIN_SIZE 63 /* the largest ERTM window */
 #define BTA_HL_L2C_MAX_TRANSMIT 32
 #define BTA_HL_L2C_RTRANS_TOUT 2000
 #define BTA_HL_L2C_MON_TOUT 12000
@@ -537,8 +538,9 @@ typedef struct {
  *  Global data
  ****************************************************************************/
 
-/* HL control block */
-extern tBTA_HL_CB bta_hl_cb;
+/* HL control block, allocated while HL is enabled */
+extern tBTA_HL_CB* bta_hl_cb_ptr;
+#define bta_hl_cb (*bta_hl_cb_ptr)
 
 #define BTA_HL_GET_CB_PTR() &(bta_hl_cb)
 #define BTA_HL_GET_APP_CB_PTR(app_idx) &(bta_hl_cb.acb[(app_idx)])
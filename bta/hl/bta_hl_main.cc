@@ -415,8 +415,9 @@ const tBTA_HL_CCH_ST_TBL bta_hl_cch_st_tbl[] = {
  * Global data
  ****************************************************************************/
 
-/* HL control block */
-tBTA_HL_CB bta_hl_cb;
+/* HL control block, allocated on the enable request and freed once the
+ * disable has completed */
+tBTA_HL_CB* bta_hl_cb_ptr = NULL;
 
 /*******************************************************************************
  *
@@ -1714,6 +1715,15 @@ bool bta_hl_hdl_event(BT_HDR* p_msg) {
                    bta_hl_evt_code(p_msg->event));
 #endif
 
+  if (bta_hl_cb_ptr == NULL) {
+    if (p_msg->event != BTA_HL_API_ENABLE_EVT) {
+      APPL_TRACE_WARNING("%s: HL is not enabled, event 0x%04x dropped",
+                         __func__, p_msg->event);
+      return true;
+    }
+    bta_hl_cb_ptr = (tBTA_HL_CB*)osi_calloc(sizeof(tBTA_HL_CB));
+  }
+
   switch (p_msg->event) {
     case BTA_HL_API_ENABLE_EVT:
       bta_hl_api_enable(&bta_hl_cb, (tBTA_HL_DATA*)p_msg);
@@ -1813,6 +1823,9 @@ bool bta_hl_hdl_event(BT_HDR* p_msg) {
       break;
   }
 
+  /* the control block of a completed disable is not needed any more */
+  if (!bta_hl_cb.enable) osi_free_and_reset((void**)&bta_hl_cb_ptr);
+
   return (success);
 }
 
@@ -150,13 +150,15 @@ uint16_t bta_hl_set_user_rx_buf_size(uint16_t mtu) {
  *
  * Function      bta_hl_set_tx_win_size
  *
- * Description  This function sets the tx window size
+ * Description  This function sets the tx window size: a few APDUs at
+ *              least, so that the streams of small APDUs are not sent one
+ *              I-frame at a time.
  *
  * Returns      uint8_t tx_win_size
  *
  ******************************************************************************/
 uint8_t bta_hl_set_tx_win_size(uint16_t mtu, uint16_t mps) {
-  uint8_t tx_win_size;
+  uint16_t tx_win_size;
 
   if (mtu <= mps) {
     tx_win_size = 1;
@@ -169,6 +171,11 @@ uint8_t bta_hl_set_tx_win_size(uint16_t mtu, uint16_t mps) {
     }
   }
 
+  if (tx_win_size < BTA_HL_L2C_TX_WIN_SIZE)
+    tx_win_size = BTA_HL_L2C_TX_WIN_SIZE;
+  else if (tx_win_size > BTA_HL_L2C_MAX_TX_WIN_SIZE)
+    tx_win_size = BTA_HL_L2C_MAX_TX_WIN_SIZE;
+
 #if (BTA_HL_DEBUG == TRUE)
   APPL_TRACE_DEBUG("bta_hl_set_tx_win_size win_size=%d mtu=%d mps=%d",
                    tx_win_size, mtu, mps);
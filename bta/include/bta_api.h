@@ -484,6 +484,28 @@ typedef union {
   tBTA_LE_PID_KEYS lid_key; /* local device ID key for the particular remote */
 } tBTA_LE_KEY_VALUE;
 
+/* The number of LE keys kept for a bonded device: PENC, PID, PCSRK, LENC,
+ * LID and LCSRK */
+#define BTA_DM_BONDED_LE_KEYS_MAX 6
+
+/* A bonded device restored from the NVRAM, with all of its keys */
+typedef struct {
+  BD_ADDR bd_addr;
+
+  /* BR/EDR bond */
+  bool link_key_known;
+  LINK_KEY link_key;
+  uint8_t key_type;
+  uint8_t pin_length;
+  DEV_CLASS dc;
+
+  /* LE bond, added if any key is known */
+  tBLE_ADDR_TYPE addr_type;
+  uint8_t num_le_keys;
+  tBTA_LE_KEY_TYPE le_key_types[BTA_DM_BONDED_LE_KEYS_MAX];
+  tBTA_LE_KEY_VALUE le_keys[BTA_DM_BONDED_LE_KEYS_MAX];
+} tBTA_DM_BONDED_DEV;
+
 #define BTA_BLE_LOCAL_KEY_TYPE_ID 1
 #define BTA_BLE_LOCAL_KEY_TYPE_ER 2
 typedef uint8_t tBTA_DM_BLE_LOCAL_KEY_MASK;
@@ -923,6 +945,23 @@ typedef uint8_t tBTA_DM_PM_ACTION;
 #define BTA_DM_PM_HH_IDLE_DELAY 30000
 #endif
 
+/* When its sniff timer expires, a link is kept active a while longer if it
+ * still had traffic less than BTA_DM_PM_SNIFF_MIN_IDLE_MS ago, or if its past
+ * traffic predicts the current pause to end within BTA_DM_PM_SNIFF_RESUME_MS,
+ * as when a stream is about to resume. A link is kept active so for
+ * BTA_DM_PM_SNIFF_MAX_DEFER_MS at most. The HID links are never kept. */
+#ifndef BTA_DM_PM_SNIFF_MIN_IDLE_MS
+#define BTA_DM_PM_SNIFF_MIN_IDLE_MS 1000
+#endif
+
+#ifndef BTA_DM_PM_SNIFF_RESUME_MS
+#define BTA_DM_PM_SNIFF_RESUME_MS 3000
+#endif
+
+#ifndef BTA_DM_PM_SNIFF_MAX_DEFER_MS
+#define BTA_DM_PM_SNIFF_MAX_DEFER_MS 10000
+#endif
+
 /* The Sniff Parameters defined below must be ordered from highest
  * latency (biggest interval) to lowest latency.  If there is a conflict
  * among the connected services the setting with the lowest latency will
@@ -1501,6 +1540,24 @@ extern void BTA_DmAddBleDevice(BD_ADDR bd_addr, tBLE_ADDR_TYPE addr_type,
 extern void BTA_DmAddBleKey(BD_ADDR bd_addr, tBTA_LE_KEY_VALUE* p_le_key,
                             tBTA_LE_KEY_TYPE key_type);
 
+/*******************************************************************************
+ *
+ * Function         BTA_DmAddBondedDevices
+ *
+ * Description      Add the bonded devices restored from the NVRAM at once,
+ *                  with their BR/EDR and LE keys. This is the same as
+ *                  calling BTA_DmAddDevice, BTA_DmAddBleDevice and
+ *                  BTA_DmAddBleKey for each of them, in a single message.
+ *
+ * Parameters:      p_devs           - The bonded devices, copied.
+ *                  num_devs         - The number of devices.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_DmAddBondedDevices(const tBTA_DM_BONDED_DEV* p_devs,
+                                   uint16_t num_devs);
+
 /*******************************************************************************
  *
  * Function         BTA_DmSetBlePrefConnParams
@@ -1723,6 +1780,31 @@ extern void BTA_DmBleSetDataLength(BD_ADDR remote_device,
  ******************************************************************************/
 extern void BTA_DmBleGetEnergyInfo(tBTA_BLE_ENERGY_INFO_CBACK* p_cmpl_cback);
 
+/*******************************************************************************
+ *
+ * Function         BTA_DmDumpTopology
+ *
+ * Description      This function dumps the connected devices, their roles
+ *                  and link policies, and the role decisions made for them,
+ *                  to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_DmDumpTopology(int fd);
+
+/*******************************************************************************
+ *
+ * Function         BTA_SysDumpStatistics
+ *
+ * Description      This function dumps the depth and the queuing latency of
+ *                  the BTA message lanes to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTA_SysDumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTA_BrcmInit
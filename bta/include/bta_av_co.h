@@ -183,6 +183,20 @@ void* bta_av_co_audio_src_data_path(const uint8_t* p_codec_info,
  ******************************************************************************/
 void bta_av_co_audio_drop(tBTA_AV_HNDL hndl);
 
+/*******************************************************************************
+ *
+ * Function         bta_av_co_audio_congested
+ *
+ * Description      L2CAP is not draining the Audio packets sent on the
+ *                  connection with this handle. The implementation may want
+ *                  to reduce the encoder bit rate setting before packets are
+ *                  dropped.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_av_co_audio_congested(tBTA_AV_HNDL hndl);
+
 /*******************************************************************************
  *
  * Function         bta_av_co_audio_delay
@@ -1101,6 +1101,48 @@ extern void BTA_GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_id,
                                             vector<uint8_t> value,
                                             bool need_confirm);
 
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_SetAttributeValue
+ *
+ * Description      This function is called to give the stack the value of a
+ *                  characteristic or descriptor, so that it answers the reads
+ *                  of the clients without sending them to the application.
+ *                  The value stays until it is invalidated, or until a client
+ *                  writes the attribute.
+ *
+ * Parameters       server_if - server interface.
+ *                  attr_id - attribute ID of the value.
+ *                  version - of the value; an update older than the last one
+ *                            applied to the attribute is ignored.
+ *                  value - the value.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+extern void BTA_GATTS_SetAttributeValue(tBTA_GATTS_IF server_if,
+                                        uint16_t attr_id, uint32_t version,
+                                        vector<uint8_t> value);
+
+/*******************************************************************************
+ *
+ * Function         BTA_GATTS_InvalidateAttributeValue
+ *
+ * Description      This function is called to drop the value given by
+ *                  BTA_GATTS_SetAttributeValue, so that the reads of the
+ *                  attribute are sent to the application again.
+ *
+ * Parameters       server_if - server interface.
+ *                  attr_id - attribute ID of the value.
+ *                  version - of the invalidation, ordered with the updates.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+extern void BTA_GATTS_InvalidateAttributeValue(tBTA_GATTS_IF server_if,
+                                               uint16_t attr_id,
+                                               uint32_t version);
+
 /*******************************************************************************
  *
  * Function         BTA_GATTS_SendRsp
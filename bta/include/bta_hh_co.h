@@ -26,12 +26,15 @@
 
 #include "bta_hh_api.h"
 
+/* A characteristic of the HID service of a bonded HOGP device: its reports, and
+ * the protocol mode and control point characteristics, which have no report
+ * ID nor type */
 typedef struct {
   uint16_t rpt_uuid;
   uint8_t rpt_id;
   tBTA_HH_RPT_TYPE rpt_type;
   uint8_t srvc_inst_id;
-  uint8_t char_inst_id;
+  uint16_t char_inst_id; /* characteristic handle */
 } tBTA_HH_RPT_CACHE_ENTRY;
 
 /*******************************************************************************
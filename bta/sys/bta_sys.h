@@ -208,6 +208,16 @@ typedef uint8_t tBTA_SYS_HW_EVT;
 /* HW enable callback type */
 typedef void(tBTA_SYS_HW_CBACK)(tBTA_SYS_HW_EVT status);
 
+/* The message lanes of BTA. Each lane has a queue of its own, and the lanes
+ * are served from the first to the last: see bta_sys_sendmsg(). */
+enum {
+  BTA_SYS_LANE_MEDIA,   /* AV source and sink */
+  BTA_SYS_LANE_HID,     /* HID host and device */
+  BTA_SYS_LANE_DEFAULT, /* all the other modules */
+  BTA_SYS_LANE_MAX
+};
+typedef uint8_t tBTA_SYS_LANE;
+
 /*****************************************************************************
  *  Function declarations
  ****************************************************************************/
@@ -215,6 +225,7 @@ typedef void(tBTA_SYS_HW_CBACK)(tBTA_SYS_HW_EVT status);
 extern void bta_sys_init(void);
 extern void bta_sys_free(void);
 extern void bta_sys_event(BT_HDR* p_msg);
+extern void bta_sys_lane_event(tBTA_SYS_LANE lane, BT_HDR* p_msg);
 extern void bta_sys_set_trace_level(uint8_t level);
 extern void bta_sys_register(uint8_t id, const tBTA_SYS_REG* p_reg);
 extern void bta_sys_deregister(uint8_t id);
@@ -28,6 +28,9 @@
 #include <pthread.h>
 #include <string.h>
 
+#include <deque>
+#include <mutex>
+
 #include "bt_common.h"
 #include "bta_api.h"
 #include "bta_closure_int.h"
@@ -36,9 +39,11 @@
 #include "btm_api.h"
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/latency_histogram.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/thread.h"
+#include "osi/include/time.h"
 #include "utl.h"
 
 #if (defined BTA_AR_INCLUDED) && (BTA_AR_INCLUDED == true)
@@ -56,8 +61,24 @@ extern thread_t* bt_workqueue_thread;
 uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;  // APPL_INITIAL_TRACE_LEVEL;
 uint8_t btif_trace_level = BT_TRACE_LEVEL_WARNING;
 
-// Communication queue between btu_task and bta.
-extern fixed_queue_t* btu_bta_msg_queue;
+// Communication queues between btu_task and bta, one per lane.
+extern fixed_queue_t* btu_bta_msg_queue[BTA_SYS_LANE_MAX];
+
+/* The statistics of a message lane */
+typedef struct {
+  std::deque<uint64_t> enqueue_us; /* Of the queued messages, oldest first */
+  uint64_t msg_count;
+  size_t max_depth;
+  latency_histogram_t latency; /* From bta_sys_sendmsg() to the dispatch */
+} tBTA_SYS_LANE_STATS;
+
+static const char* const bta_sys_lane_names[BTA_SYS_LANE_MAX] = {
+    "media", "HID", "default"};
+
+/* Guards |bta_sys_lane_stats|, and keeps the messages and their timestamps in
+ * the same order in each lane */
+static std::mutex bta_sys_lane_mutex;
+static tBTA_SYS_LANE_STATS bta_sys_lane_stats[BTA_SYS_LANE_MAX];
 
 static const tBTA_SYS_REG bta_sys_hw_reg = {bta_sys_sm_execute, NULL};
 
@@ -479,6 +500,34 @@ void bta_sys_event(BT_HDR* p_msg) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         bta_sys_lane_event
+ *
+ * Description      Handles a message dequeued from the queue of |lane|.
+ *
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_sys_lane_event(tBTA_SYS_LANE lane, BT_HDR* p_msg) {
+  {
+    std::lock_guard<std::mutex> lock(bta_sys_lane_mutex);
+    tBTA_SYS_LANE_STATS* stats = &bta_sys_lane_stats[lane];
+    /* Drop the timestamps left by the messages of a freed queue */
+    size_t queued = fixed_queue_length(btu_bta_msg_queue[lane]) + 1;
+    while (stats->enqueue_us.size() > queued) stats->enqueue_us.pop_front();
+    if (!stats->enqueue_us.empty()) {
+      latency_histogram_add(
+          &stats->latency,
+          time_get_os_boottime_us() - stats->enqueue_us.front());
+      stats->enqueue_us.pop_front();
+    }
+  }
+
+  bta_sys_event(p_msg);
+}
+
 /*******************************************************************************
  *
  * Function         bta_sys_register
@@ -521,6 +570,32 @@ void bta_sys_deregister(uint8_t id) { bta_sys_cb.is_reg[id] = false; }
  ******************************************************************************/
 bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
 
+/*******************************************************************************
+ *
+ * Function         bta_sys_msg_lane
+ *
+ * Description      Returns the lane of |p_msg|, from the module it is sent
+ *                  to. The AV messages, e.g. a stream start or suspend, go
+ *                  ahead of the HID ones, which go ahead of the others, e.g.
+ *                  a burst of discovery events.
+ *
+ *
+ * Returns          The lane of the message
+ *
+ ******************************************************************************/
+static tBTA_SYS_LANE bta_sys_msg_lane(const BT_HDR* p_msg) {
+  switch (p_msg->event >> 8) {
+    case BTA_ID_AV:
+    case BTA_ID_AVK:
+      return BTA_SYS_LANE_MEDIA;
+    case BTA_ID_HH:
+    case BTA_ID_HD:
+      return BTA_SYS_LANE_HID;
+    default:
+      return BTA_SYS_LANE_DEFAULT;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         bta_sys_sendmsg
@@ -529,16 +604,62 @@ bool bta_sys_is_register(uint8_t id) { return bta_sys_cb.is_reg[id]; }
  *                  optimize sending of messages to BTA.  It is called by BTA
  *                  API functions and call-in functions.
  *
+ *                  The message is queued in its lane. The messages of a lane
+ *                  are handled in order, and the lanes are dispatched by the
+ *                  BTU reactor from the media lane to the default lane, one
+ *                  message per lane at a time, so that no lane starves.
+ *
  *
  * Returns          void
  *
  ******************************************************************************/
 void bta_sys_sendmsg(void* p_msg) {
+  tBTA_SYS_LANE lane = bta_sys_msg_lane((BT_HDR*)p_msg);
+  std::lock_guard<std::mutex> lock(bta_sys_lane_mutex);
+
   // There is a race condition that occurs if the stack is shut down while
   // there is a procedure in progress that can schedule a task via this
   // message queue. This causes |btu_bta_msg_queue| to get cleaned up before
   // it gets used here; hence we check for NULL before using it.
-  if (btu_bta_msg_queue) fixed_queue_enqueue(btu_bta_msg_queue, p_msg);
+  fixed_queue_t* queue = btu_bta_msg_queue[lane];
+  if (queue == NULL) return;
+
+  tBTA_SYS_LANE_STATS* stats = &bta_sys_lane_stats[lane];
+  stats->enqueue_us.push_back(time_get_os_boottime_us());
+  stats->msg_count++;
+  fixed_queue_enqueue(queue, p_msg);
+  size_t depth = fixed_queue_length(queue);
+  if (depth > stats->max_depth) stats->max_depth = depth;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTA_SysDumpStatistics
+ *
+ * Description      This function dumps the depth and the queuing latency of
+ *                  the BTA message lanes to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTA_SysDumpStatistics(int fd) {
+  std::lock_guard<std::mutex> lock(bta_sys_lane_mutex);
+
+  dprintf(fd, "\nBTA Message Lanes:\n");
+  dprintf(fd,
+          "  Lane: messages / depth (max) / latency us "
+          "(p50 / p99 / p99.9 / max)\n");
+  for (int lane = 0; lane < BTA_SYS_LANE_MAX; lane++) {
+    const tBTA_SYS_LANE_STATS* stats = &bta_sys_lane_stats[lane];
+    const latency_histogram_t* latency = &stats->latency;
+    dprintf(fd, "    %s: %llu / %zu (%zu) / %llu / %llu / %llu / %llu\n",
+            bta_sys_lane_names[lane], (unsigned long long)stats->msg_count,
+            fixed_queue_length(btu_bta_msg_queue[lane]), stats->max_depth,
+            (unsigned long long)latency_histogram_percentile(latency, 500),
+            (unsigned long long)latency_histogram_percentile(latency, 990),
+            (unsigned long long)latency_histogram_percentile(latency, 999),
+            (unsigned long long)latency->max_us);
+  }
 }
 
 /*******************************************************************************
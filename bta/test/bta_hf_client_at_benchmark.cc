@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of parsing the AT results a phone sends to the HF client, as captured
+// during a call: indicator updates, and the current calls listed after each.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <string>
+
+#include "bta/hf_client/bta_hf_client_int.h"
+
+namespace {
+
+const BD_ADDR bdaddr = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+// The results, as received in the RFCOMM frames of the phone
+const char* const kCallTraffic[] = {
+    "\r\n+CIEV: 5,3\r\n",
+    "\r\n+CIEV: 2,1\r\n\r\n+CIEV: 3,0\r\n",
+    "\r\n+CLCC: 1,1,0,0,0,\"+15551234567\",145\r\n",
+    "\r\n+CLCC: 2,1,5,0,0,\"5550000\",129\r\n\r\n+CIEV: 7,4\r\n",
+    "\r\nRING\r\n\r\n+CLIP: \"+15551234567\",145,,,\"Work\"\r\n",
+    "\r\n+CCWA: \"5550000\",129,1\r\n\r\n+CIEV: 6,0\r\n",
+    "\r\n+VGS=9\r\n\r\n+BSIR: 0\r\n\r\n+XAPL=iPhone,6\r\n",
+};
+
+void event_cback(tBTA_HF_CLIENT_EVT event, tBTA_HF_CLIENT* p_data) {
+  benchmark::DoNotOptimize(p_data);
+}
+
+void BM_ParseCallTraffic(benchmark::State& state) {
+  bta_hf_client_cb_arr_init();
+  bta_hf_client_cb_arr.p_cback = event_cback;
+  uint16_t handle;
+  bta_hf_client_allocate_handle(bdaddr, &handle);
+  tBTA_HF_CLIENT_CB* client_cb = bta_hf_client_find_cb_by_handle(handle);
+
+  size_t bytes = 0;
+  for (const char* frame : kCallTraffic) bytes += strlen(frame);
+
+  char frame[BTA_HF_CLIENT_AT_PARSER_MAX_LEN];
+  while (state.KeepRunning()) {
+    for (const char* traffic : kCallTraffic) {
+      size_t len = strlen(traffic);
+      memcpy(frame, traffic, len);
+      bta_hf_client_at_parse(client_cb, frame, len);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+  bta_hf_client_cb_arr.p_cback = NULL;
+}
+BENCHMARK(BM_ParseCallTraffic);
+
+}  // namespace
+
+BENCHMARK_MAIN();
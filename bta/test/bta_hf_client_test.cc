@@ -18,6 +18,11 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#include <string>
+#include <vector>
+
 #include "bta/hf_client/bta_hf_client_int.h"
 #include "bta/include/bta_hf_client_api.h"
 
@@ -82,3 +87,89 @@ TEST_F(BtaHfClientTest, test_allocate_block_diff_device) {
   EXPECT_GT(p_handle_second, 0);
   EXPECT_NE(p_handle_first, p_handle_second);
 }
+
+namespace {
+std::vector<tBTA_HF_CLIENT_EVT> at_events;
+std::vector<tBTA_HF_CLIENT> at_event_data;
+
+void at_event_cback(tBTA_HF_CLIENT_EVT event, tBTA_HF_CLIENT* p_data) {
+  at_events.push_back(event);
+  at_event_data.push_back(*p_data);
+}
+}  // namespace
+
+class BtaHfClientAtTest : public BtaHfClientTest {
+ protected:
+  void SetUp() override {
+    BtaHfClientTest::SetUp();
+    at_events.clear();
+    at_event_data.clear();
+    bta_hf_client_cb_arr.p_cback = at_event_cback;
+
+    uint16_t handle;
+    ASSERT_TRUE(bta_hf_client_allocate_handle(bdaddr1, &handle));
+    client_cb = bta_hf_client_find_cb_by_handle(handle);
+    ASSERT_TRUE(client_cb != NULL);
+  }
+
+  void TearDown() override { bta_hf_client_cb_arr.p_cback = NULL; }
+
+  void Parse(std::string at) {
+    bta_hf_client_at_parse(client_cb, &at[0], at.size());
+  }
+
+  tBTA_HF_CLIENT_CB* client_cb;
+};
+
+// Test that the unsolicited results received at once are all parsed, in order
+TEST_F(BtaHfClientAtTest, test_parse_unsolicited_results) {
+  Parse(
+      "\r\nRING\r\n"
+      "\r\n+CLIP: \"+15551234567\",145\r\n"
+      "\r\n+VGS=7\r\n"
+      "\r\n+VGM:16\r\n"
+      "\r\n+CCWA: \"5550000\",129,1\r\n");
+
+  ASSERT_EQ(4U, at_events.size());
+  EXPECT_EQ(BTA_HF_CLIENT_RING_INDICATION, at_events[0]);
+  EXPECT_EQ(BTA_HF_CLIENT_CLIP_EVT, at_events[1]);
+  EXPECT_STREQ("+15551234567", at_event_data[1].number.number);
+  EXPECT_EQ(BTA_HF_CLIENT_SPK_EVT, at_events[2]);
+  EXPECT_EQ(7, at_event_data[2].val.value);
+  // the microphone gain of 16 is out of range
+  EXPECT_EQ(BTA_HF_CLIENT_CCWA_EVT, at_events[3]);
+  EXPECT_STREQ("5550000", at_event_data[3].number.number);
+}
+
+// Test that the current calls are parsed, with and without their number
+TEST_F(BtaHfClientAtTest, test_parse_clcc) {
+  Parse(
+      "\r\n+CLCC: 1,1,4,0,0,\"5551234\",129\r\n"
+      "\r\n+CLCC: 2,0,0,0,1\r\n");
+
+  ASSERT_EQ(2U, at_events.size());
+  EXPECT_EQ(BTA_HF_CLIENT_CLCC_EVT, at_events[0]);
+  EXPECT_EQ(1U, at_event_data[0].clcc.idx);
+  EXPECT_TRUE(at_event_data[0].clcc.inc);
+  EXPECT_EQ(4, at_event_data[0].clcc.status);
+  EXPECT_TRUE(at_event_data[0].clcc.number_present);
+  EXPECT_STREQ("5551234", at_event_data[0].clcc.number);
+
+  EXPECT_EQ(BTA_HF_CLIENT_CLCC_EVT, at_events[1]);
+  EXPECT_EQ(2U, at_event_data[1].clcc.idx);
+  EXPECT_TRUE(at_event_data[1].clcc.mpty);
+  EXPECT_FALSE(at_event_data[1].clcc.number_present);
+}
+
+// Test that the unknown and malformed results are skipped
+TEST_F(BtaHfClientAtTest, test_skip_unknown_results) {
+  Parse(
+      "\r\n+XAPL=iPhone,7\r\n"
+      "\r\n+VGS=\r\n"
+      "\r\nRINGING\r\n"
+      "\r\n+BSIR: 1\r\n");
+
+  ASSERT_EQ(1U, at_events.size());
+  EXPECT_EQ(BTA_HF_CLIENT_BSIR_EVT, at_events[0]);
+  EXPECT_EQ(1, at_event_data[0].val.value);
+}
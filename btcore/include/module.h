@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "osi/include/future.h"
 #include "osi/include/thread.h"
@@ -50,6 +51,12 @@ bool module_init(const module_t* module);
 // Start up the provided module. |module| may not be NULL
 // and must be initialized or have no init function.
 bool module_start_up(const module_t* module);
+// Start up the |count| provided |modules|, each once the modules of |modules|
+// it depends on are started, so that the modules independent of each other
+// start up concurrently. The dependencies not in |modules| must be started
+// already. Returns true if they all started; otherwise, the ones started are
+// left started. |modules| may not be NULL, nor contain NULL.
+bool module_start_up_all(const module_t** modules, size_t count);
 // Shut down the provided module. |module| may not be NULL.
 // If not started, does nothing.
 void module_shut_down(const module_t* module);
@@ -66,3 +73,8 @@ void module_clean_up(const module_t* module);
 void module_start_up_callbacked_wrapper(const module_t* module,
                                         thread_t* callback_thread,
                                         thread_fn callback);
+
+// Dump the times at which the modules last started up, and how long each
+// took, to the |fd| file descriptor.
+// The caller is responsible for closing the |fd|.
+void module_debug_dump(int fd);
@@ -20,15 +20,20 @@
 
 #include <base/logging.h>
 #include <dlfcn.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 typedef enum {
   MODULE_STATE_NONE = 0,
@@ -36,7 +41,16 @@ typedef enum {
   MODULE_STATE_STARTED = 2
 } module_state_t;
 
+typedef struct {
+  const module_t* module;
+  uint32_t start_ms;  // When the start up began
+  uint32_t end_ms;    // When the start up ended, 0 while running
+  bool success;
+} module_timing_t;
+
 static std::unordered_map<const module_t*, module_state_t> metadata;
+// The last start up of each module, guarded by |metadata_mutex|
+static std::unordered_map<const module_t*, module_timing_t> timings;
 
 // TODO(jamuraa): remove this lock after the startup sequence is clean
 static std::mutex metadata_mutex;
@@ -44,11 +58,15 @@ static std::mutex metadata_mutex;
 static bool call_lifecycle_function(module_lifecycle_fn function);
 static module_state_t get_module_state(const module_t* module);
 static void set_module_state(const module_t* module, module_state_t state);
+static void set_module_timing(const module_t* module, uint32_t start_ms,
+                              uint32_t end_ms, bool success);
 
 void module_management_start(void) {}
 
 void module_management_stop(void) {
+  std::lock_guard<std::mutex> lock(metadata_mutex);
   metadata.clear();
+  timings.clear();
 }
 
 const module_t* get_module(const char* name) {
@@ -82,17 +100,108 @@ bool module_start_up(const module_t* module) {
         module->init == NULL);
 
   LOG_INFO(LOG_TAG, "%s Starting module \"%s\"", __func__, module->name);
+  uint32_t start_ms = time_get_os_boottime_ms();
+  set_module_timing(module, start_ms, 0, false);
   if (!call_lifecycle_function(module->start_up)) {
+    set_module_timing(module, start_ms, time_get_os_boottime_ms(), false);
     LOG_ERROR(LOG_TAG, "%s Failed to start up module \"%s\"", __func__,
               module->name);
     return false;
   }
-  LOG_INFO(LOG_TAG, "%s Started module \"%s\"", __func__, module->name);
+  uint32_t end_ms = time_get_os_boottime_ms();
+  set_module_timing(module, start_ms, end_ms, true);
+  LOG_INFO(LOG_TAG, "%s Started module \"%s\" in %u ms", __func__,
+           module->name, end_ms - start_ms);
 
   set_module_state(module, MODULE_STATE_STARTED);
   return true;
 }
 
+// A module of |module_start_up_all|, started up on a thread of its own
+typedef struct {
+  const module_t* module;
+  thread_t* thread;
+  fixed_queue_t* done_queue;  // we don't own this queue
+  bool launched;
+  bool done;
+  bool success;
+} start_up_job_t;
+
+static void run_start_up_job(void* context) {
+  start_up_job_t* job = (start_up_job_t*)context;
+  job->success = module_start_up(job->module);
+  fixed_queue_enqueue(job->done_queue, job);
+}
+
+// Returns true if |job| depends on no module of |jobs| not yet started.
+static bool start_up_job_is_ready(const start_up_job_t* job,
+                                  const start_up_job_t* jobs, size_t count) {
+  for (size_t i = 0; i < BTCORE_MAX_MODULE_DEPENDENCIES; i++) {
+    const char* dependency = job->module->dependencies[i];
+    if (dependency == NULL) break;
+
+    for (size_t j = 0; j < count; j++) {
+      if (strcmp(jobs[j].module->name, dependency) == 0 && !jobs[j].done)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool module_start_up_all(const module_t** modules, size_t count) {
+  CHECK(modules != NULL);
+
+  fixed_queue_t* done_queue = fixed_queue_new(count);
+  start_up_job_t* jobs =
+      (start_up_job_t*)osi_calloc(count * sizeof(start_up_job_t));
+  for (size_t i = 0; i < count; i++) {
+    CHECK(modules[i] != NULL);
+    jobs[i].module = modules[i];
+    jobs[i].done_queue = done_queue;
+  }
+
+  bool success = true;
+  size_t running = 0;
+  size_t done = 0;
+  while (done < count) {
+    // Once a module failed, only wait for the ones running
+    for (size_t i = 0; i < count && success; i++) {
+      if (jobs[i].launched || !start_up_job_is_ready(&jobs[i], jobs, count))
+        continue;
+
+      jobs[i].launched = true;
+      jobs[i].thread = thread_new(jobs[i].module->name);
+      if (jobs[i].thread == NULL) {
+        LOG_ERROR(LOG_TAG, "%s unable to create a thread for module \"%s\"",
+                  __func__, jobs[i].module->name);
+        success = false;
+        break;
+      }
+      thread_post(jobs[i].thread, run_start_up_job, &jobs[i]);
+      running++;
+    }
+
+    // A dependency cycle, or a failure
+    if (running == 0) break;
+
+    start_up_job_t* job = (start_up_job_t*)fixed_queue_dequeue(done_queue);
+    thread_free(job->thread);
+    job->done = true;
+    running--;
+    done++;
+    if (!job->success) success = false;
+  }
+
+  if (done < count && success) {
+    LOG_ERROR(LOG_TAG, "%s modules depending on each other", __func__);
+    success = false;
+  }
+
+  osi_free(jobs);
+  fixed_queue_free(done_queue, NULL);
+  return success;
+}
+
 void module_shut_down(const module_t* module) {
   CHECK(module != NULL);
   module_state_t state = get_module_state(module);
@@ -157,6 +266,40 @@ static void set_module_state(const module_t* module, module_state_t state) {
   metadata[module] = state;
 }
 
+static void set_module_timing(const module_t* module, uint32_t start_ms,
+                              uint32_t end_ms, bool success) {
+  std::lock_guard<std::mutex> lock(metadata_mutex);
+  timings[module] = {module, start_ms, end_ms, success};
+}
+
+void module_debug_dump(int fd) {
+  std::vector<module_timing_t> timeline;
+  {
+    std::lock_guard<std::mutex> lock(metadata_mutex);
+    for (const auto& timing : timings) timeline.push_back(timing.second);
+  }
+  std::sort(timeline.begin(), timeline.end(),
+            [](const module_timing_t& a, const module_timing_t& b) {
+              return a.start_ms < b.start_ms;
+            });
+
+  dprintf(fd, "\nBluetooth Module Start Up Timeline:\n");
+  if (timeline.empty()) return;
+
+  uint32_t origin_ms = timeline[0].start_ms;
+  dprintf(fd, "  Started at %u ms after boot\n", origin_ms);
+  for (const auto& timing : timeline) {
+    if (timing.end_ms == 0) {
+      dprintf(fd, "  +%6u ms  %-20s running\n", timing.start_ms - origin_ms,
+              timing.module->name);
+      continue;
+    }
+    dprintf(fd, "  +%6u ms  %-20s %6u ms%s\n", timing.start_ms - origin_ms,
+            timing.module->name, timing.end_ms - timing.start_ms,
+            timing.success ? "" : " (failed)");
+  }
+}
+
 // TODO(zachoverflow): remove when everything modulized
 // Temporary callback-wrapper-related code
 
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "osi/test/AllocationTestHarness.h"
+
+#include "btcore/include/module.h"
+#include "osi/include/future.h"
+
+static std::mutex order_mutex;
+static std::string order;
+static std::atomic<bool> second_started;
+
+static void record(const char* name) {
+  std::lock_guard<std::mutex> lock(order_mutex);
+  order += name;
+}
+
+static future_t* start_up_a(void) {
+  record("a");
+  return NULL;
+}
+
+static future_t* start_up_b(void) {
+  record("b");
+  return NULL;
+}
+
+static future_t* start_up_failing(void) {
+  return future_new_immediate(FUTURE_FAIL);
+}
+
+// Only succeeds if |start_up_second| runs while it waits
+static future_t* start_up_first(void) {
+  for (int i = 0; i < 2000 && !second_started; i++) usleep(1000);
+  return future_new_immediate(second_started ? FUTURE_SUCCESS : FUTURE_FAIL);
+}
+
+static future_t* start_up_second(void) {
+  second_started = true;
+  return NULL;
+}
+
+static const module_t module_a = {
+    "test_module_a", NULL, start_up_a, NULL, NULL, {"test_module_b", NULL}};
+static const module_t module_b = {
+    "test_module_b", NULL, start_up_b, NULL, NULL, {NULL}};
+static const module_t module_failing = {
+    "test_module_failing", NULL, start_up_failing, NULL, NULL, {NULL}};
+static const module_t module_after_failing = {
+    "test_module_after", NULL, start_up_a, NULL, NULL, {"test_module_failing"}};
+static const module_t module_first = {
+    "test_module_first", NULL, start_up_first, NULL, NULL, {NULL}};
+static const module_t module_second = {
+    "test_module_second", NULL, start_up_second, NULL, NULL, {NULL}};
+static const module_t module_cycle_a = {
+    "test_module_cyc_a", NULL, start_up_a, NULL, NULL, {"test_module_cyc_b"}};
+static const module_t module_cycle_b = {
+    "test_module_cyc_b", NULL, start_up_b, NULL, NULL, {"test_module_cyc_a"}};
+
+class ModuleTest : public AllocationTestHarness {
+ protected:
+  virtual void SetUp() {
+    AllocationTestHarness::SetUp();
+    module_management_start();
+    order.clear();
+    second_started = false;
+  }
+
+  virtual void TearDown() {
+    module_management_stop();
+    AllocationTestHarness::TearDown();
+  }
+};
+
+TEST_F(ModuleTest, test_dependency_order) {
+  const module_t* modules[] = {&module_a, &module_b};
+  EXPECT_TRUE(module_start_up_all(modules, 2));
+  EXPECT_EQ("ba", order);
+}
+
+TEST_F(ModuleTest, test_concurrent) {
+  const module_t* modules[] = {&module_first, &module_second};
+  EXPECT_TRUE(module_start_up_all(modules, 2));
+}
+
+TEST_F(ModuleTest, test_failure) {
+  const module_t* modules[] = {&module_after_failing, &module_failing};
+  EXPECT_FALSE(module_start_up_all(modules, 2));
+  EXPECT_EQ("", order);
+}
+
+TEST_F(ModuleTest, test_cycle) {
+  const module_t* modules[] = {&module_cycle_a, &module_cycle_b};
+  EXPECT_FALSE(module_start_up_all(modules, 2));
+  EXPECT_EQ("", order);
+}
+
+TEST_F(ModuleTest, test_debug_dump) {
+  const module_t* modules[] = {&module_a, &module_b, &module_failing};
+  EXPECT_FALSE(module_start_up_all(modules, 3));
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  module_debug_dump(fds[1]);
+  close(fds[1]);
+  char buf[1024];
+  ssize_t len = read(fds[0], buf, sizeof(buf) - 1);
+  close(fds[0]);
+  ASSERT_GT(len, 0);
+  buf[len] = '\0';
+
+  std::string dump(buf);
+  EXPECT_NE(std::string::npos, dump.find("test_module_a"));
+  EXPECT_NE(std::string::npos, dump.find("test_module_b"));
+  EXPECT_NE(std::string::npos, dump.find("(failed)"));
+}
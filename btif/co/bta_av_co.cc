@@ -33,9 +33,11 @@
 #include "bta_av_ci.h"
 #include "bta_sys.h"
 
+#include "btif_a2dp_source.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_util.h"
+#include "osi/include/allocator.h"
 #include "osi/include/mutex.h"
 #include "osi/include/osi.h"
 
@@ -84,6 +86,7 @@ typedef struct {
   bool reconfig_needed;                  /* reconfiguration is needed */
   bool opened;                           /* opened */
   uint16_t mtu;                          /* maximum transmit unit size */
+  uint16_t delay_report; /* sink delay report in 1/10 ms, 0 if none */
   uint16_t uuid_to_connect;              /* uuid of peer device */
   tBTA_AV_HNDL handle;                   /* handle to use */
 } tBTA_AV_CO_PEER;
@@ -95,7 +98,9 @@ typedef struct {
 
 class BtaAvCoCb {
  public:
-  BtaAvCoCb() : codecs(nullptr) { reset(); }
+  BtaAvCoCb() : codecs(nullptr), pending_buf(nullptr), pending_flush_count(0) {
+    reset();
+  }
 
   /* Connected peer information */
   tBTA_AV_CO_PEER peers[BTA_AV_NUM_STRS];
@@ -103,10 +108,16 @@ class BtaAvCoCb {
   uint8_t codec_config[AVDT_CODEC_SIZE];
   A2dpCodecs* codecs; /* Locally supported codecs */
   tBTA_AV_CO_CP cp;
+  /* Media packet read after the one sent last, that could not be merged */
+  BT_HDR* pending_buf;
+  /* Flush count of the A2DP source when pending_buf was read */
+  uint32_t pending_flush_count;
 
   void reset() {
     delete codecs;
     codecs = nullptr;
+    osi_free(pending_buf);
+    pending_buf = nullptr;
     // TODO: Ugly leftover reset from the original C code. Should go away once
     // the rest of the code in this file migrates to C++.
     memset(peers, 0, sizeof(peers));
@@ -143,6 +154,7 @@ static bool bta_av_co_set_codec_ota_config(tBTA_AV_CO_PEER* p_peer,
                                            uint8_t num_protect,
                                            const uint8_t* p_protect_info,
                                            bool* p_restart_output);
+static uint16_t bta_av_co_get_min_mtu(void);
 
 /*******************************************************************************
  **
@@ -679,6 +691,53 @@ void bta_av_co_audio_start(UNUSED_ATTR tBTA_AV_HNDL hndl,
  ******************************************************************************/
 void bta_av_co_audio_stop(UNUSED_ATTR tBTA_AV_HNDL hndl) {
   APPL_TRACE_DEBUG("%s", __func__);
+
+  /* Drop the media packet read ahead of the stream */
+  osi_free_and_reset((void**)&bta_av_co_cb.pending_buf);
+}
+
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_read_packet
+ **
+ ** Description      Reads the next media packet to send, and merges into it
+ **                  the packets queued behind it, as long as the codec can
+ **                  carry them in a single media packet within the MTU of
+ **                  the peers. The first packet that cannot be merged is
+ **                  kept for the next call, unless the queue is flushed
+ **                  before it.
+ **
+ ** Returns          The media packet to send, NULL if none is queued
+ **
+ ******************************************************************************/
+static BT_HDR* bta_av_co_audio_read_packet(const uint8_t* p_codec_info) {
+  /* The packet read ahead is dropped if the queue was flushed since then */
+  uint32_t flush_count = btif_a2dp_source_audio_flush_count();
+  if (bta_av_co_cb.pending_flush_count != flush_count)
+    osi_free_and_reset((void**)&bta_av_co_cb.pending_buf);
+
+  BT_HDR* p_buf = bta_av_co_cb.pending_buf;
+  bta_av_co_cb.pending_buf = NULL;
+  if (p_buf == NULL) p_buf = btif_a2dp_source_audio_readbuf();
+  if (p_buf == NULL) return NULL;
+
+  uint16_t max_len = bta_av_co_get_min_mtu();
+#if (BTA_AV_CO_CP_SCMS_T == TRUE)
+  /* Leave room for the content protection header */
+  if (bta_av_co_cb.cp.active && max_len > 0) max_len--;
+#endif
+
+  BT_HDR* p_next;
+  while ((p_next = btif_a2dp_source_audio_readbuf()) != NULL) {
+    if (!A2DP_MergePackets(p_codec_info, p_buf, p_next, max_len)) {
+      bta_av_co_cb.pending_buf = p_next;
+      bta_av_co_cb.pending_flush_count = flush_count;
+      break;
+    }
+    osi_free(p_next);
+  }
+
+  return p_buf;
 }
 
 /*******************************************************************************
@@ -698,7 +757,7 @@ void* bta_av_co_audio_src_data_path(const uint8_t* p_codec_info,
 
   APPL_TRACE_DEBUG("%s: codec: %s", __func__, A2DP_CodecName(p_codec_info));
 
-  p_buf = btif_a2dp_source_audio_readbuf();
+  p_buf = bta_av_co_audio_read_packet(p_codec_info);
   if (p_buf == NULL) return NULL;
 
   /*
@@ -743,6 +802,24 @@ void* bta_av_co_audio_src_data_path(const uint8_t* p_codec_info,
  ******************************************************************************/
 void bta_av_co_audio_drop(tBTA_AV_HNDL hndl) {
   APPL_TRACE_ERROR("%s: dropped audio packet on handle 0x%x", __func__, hndl);
+  btif_a2dp_source_on_congested();
+}
+
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_congested
+ **
+ ** Description      L2CAP is not draining the Audio packets sent on the
+ **                  connection with this handle. The implementation may want
+ **                  to reduce the encoder bit rate setting before packets are
+ **                  dropped.
+ **
+ ** Returns          void
+ **
+ ******************************************************************************/
+void bta_av_co_audio_congested(tBTA_AV_HNDL hndl) {
+  APPL_TRACE_DEBUG("%s: congested audio link on handle 0x%x", __func__, hndl);
+  btif_a2dp_source_on_congested();
 }
 
 /*******************************************************************************
@@ -758,7 +835,22 @@ void bta_av_co_audio_drop(tBTA_AV_HNDL hndl) {
  **
  ******************************************************************************/
 void bta_av_co_audio_delay(tBTA_AV_HNDL hndl, uint16_t delay) {
-  APPL_TRACE_ERROR("%s: handle: x%x, delay:0x%x", __func__, hndl, delay);
+  tBTA_AV_CO_PEER* p_peer;
+
+  APPL_TRACE_DEBUG("%s: handle: x%x, delay: %d.%d ms", __func__, hndl,
+                   delay / 10, delay % 10);
+
+  /* Retrieve the peer info */
+  p_peer = bta_av_co_get_peer(hndl);
+  if (p_peer == NULL) {
+    APPL_TRACE_ERROR("%s: could not find peer entry", __func__);
+    return;
+  }
+
+  /* Protect access to the peer delay read by the audio path */
+  mutex_global_lock();
+  p_peer->delay_report = delay;
+  mutex_global_unlock();
 }
 
 void bta_av_co_audio_update_mtu(tBTA_AV_HNDL hndl, uint16_t mtu) {
@@ -1010,9 +1102,27 @@ static void bta_av_co_save_new_codec_config(tBTA_AV_CO_PEER* p_peer,
   mutex_global_unlock();
 }
 
-void bta_av_co_get_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params) {
+/* Returns the smallest MTU of the opened peers. Must be called with the
+ * global mutex held. */
+static uint16_t bta_av_co_get_min_mtu_locked(void) {
   uint16_t min_mtu = 0xFFFF;
 
+  for (size_t i = 0; i < BTA_AV_CO_NUM_ELEMENTS(bta_av_co_cb.peers); i++) {
+    const tBTA_AV_CO_PEER* p_peer = &bta_av_co_cb.peers[i];
+    if (!p_peer->opened) continue;
+    if (p_peer->mtu < min_mtu) min_mtu = p_peer->mtu;
+  }
+  return min_mtu;
+}
+
+static uint16_t bta_av_co_get_min_mtu(void) {
+  mutex_global_lock();
+  uint16_t min_mtu = bta_av_co_get_min_mtu_locked();
+  mutex_global_unlock();
+  return min_mtu;
+}
+
+void bta_av_co_get_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params) {
   APPL_TRACE_DEBUG("%s", __func__);
   CHECK(p_peer_params != nullptr);
 
@@ -1020,12 +1130,7 @@ void bta_av_co_get_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params) {
   mutex_global_lock();
 
   /* Compute the MTU */
-  for (size_t i = 0; i < BTA_AV_CO_NUM_ELEMENTS(bta_av_co_cb.peers); i++) {
-    const tBTA_AV_CO_PEER* p_peer = &bta_av_co_cb.peers[i];
-    if (!p_peer->opened) continue;
-    if (p_peer->mtu < min_mtu) min_mtu = p_peer->mtu;
-  }
-  p_peer_params->peer_mtu = min_mtu;
+  p_peer_params->peer_mtu = bta_av_co_get_min_mtu_locked();
   p_peer_params->is_peer_edr = btif_av_is_peer_edr();
   p_peer_params->peer_supports_3mbps = btif_av_peer_supports_3mbps();
 
@@ -1033,6 +1138,27 @@ void bta_av_co_get_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params) {
   mutex_global_unlock();
 }
 
+uint32_t bta_av_co_get_sink_delay_us(void) {
+  uint32_t delay_us = 0;
+
+  mutex_global_lock();
+  /* The audio plays on the slowest of the opened peers */
+  for (size_t i = 0; i < BTA_AV_CO_NUM_ELEMENTS(bta_av_co_cb.peers); i++) {
+    const tBTA_AV_CO_PEER* p_peer = &bta_av_co_cb.peers[i];
+    if (!p_peer->opened) continue;
+    uint32_t peer_delay_us = p_peer->delay_report * 100;
+    if (peer_delay_us > delay_us) delay_us = peer_delay_us;
+  }
+  mutex_global_unlock();
+
+  return delay_us;
+}
+
+bool bta_av_co_get_scmst_info(uint8_t* p_cp_flag) {
+  *p_cp_flag = bta_av_co_cp_get_flag();
+  return bta_av_co_cb.cp.active;
+}
+
 const tA2DP_ENCODER_INTERFACE* bta_av_co_get_encoder_interface(void) {
   /* Protect access to bta_av_co_cb.codec_config */
   mutex_global_lock();
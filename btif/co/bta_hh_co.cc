@@ -16,31 +16,44 @@
  *
  ******************************************************************************/
 
+#include <base/bind.h>
 #include <base/logging.h>
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/uhid.h>
-#include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/poll.h>
 #include <unistd.h>
 
 #include "bta_api.h"
+#include "bta_closure_api.h"
 #include "bta_hh_api.h"
 #include "bta_hh_co.h"
 #include "btcore/include/bdaddr.h"
 #include "btif_hh.h"
 #include "btif_util.h"
 #include "osi/include/osi.h"
+#include "osi/include/thread.h"
+#include "osi/include/time.h"
 
 const char* dev_path = "/dev/uhid";
 
+/* The thread reading the events of all the uhid devices */
+static thread_t* uhid_thread;
+
+/* The upper bounds of the input latency buckets, in us */
+static const uint64_t input_latency_bounds_us[] = {125,  250,  500, 1000,
+                                                   2000, 5000, 10000};
+
+static void btif_hh_uhid_unregister_fd(int fd);
+
 #if (BTA_HH_LE_INCLUDED == TRUE)
 #include "btif_config.h"
-#define BTA_HH_NV_LOAD_MAX 16
+/* The protocol mode, the control point and the reports of the HID service */
+#define BTA_HH_NV_LOAD_MAX 24
 static tBTA_HH_RPT_CACHE_ENTRY sReportCache[BTA_HH_NV_LOAD_MAX];
 #endif
 
@@ -57,24 +70,29 @@ void uhid_set_non_blocking(int fd) {
                      strerror(errno));
 }
 
-/*Internal function to perform UHID write and error checking*/
-static int uhid_write(int fd, const struct uhid_event* ev) {
+/* Internal function to perform UHID write and error checking. Only the first
+ * |len| octets of |ev| are written, the kernel zeroing the rest. */
+static int uhid_write_len(int fd, const struct uhid_event* ev, size_t len) {
   ssize_t ret;
-  OSI_NO_INTR(ret = write(fd, ev, sizeof(*ev)));
+  OSI_NO_INTR(ret = write(fd, ev, len));
 
   if (ret < 0) {
     int rtn = -errno;
     APPL_TRACE_ERROR("%s: Cannot write to uhid:%s", __func__, strerror(errno));
     return rtn;
-  } else if (ret != (ssize_t)sizeof(*ev)) {
+  } else if (ret != (ssize_t)len) {
     APPL_TRACE_ERROR("%s: Wrong size written to uhid: %zd != %zu", __func__,
-                     ret, sizeof(*ev));
+                     ret, len);
     return -EFAULT;
   }
 
   return 0;
 }
 
+static int uhid_write(int fd, const struct uhid_event* ev) {
+  return uhid_write_len(fd, ev, sizeof(*ev));
+}
+
 /* Internal function to parse the events received from UHID driver*/
 static int uhid_read_event(btif_hh_device_t* p_dev) {
   CHECK(p_dev);
@@ -157,78 +175,114 @@ static int uhid_read_event(btif_hh_device_t* p_dev) {
 
 /*******************************************************************************
  *
- * Function create_thread
+ * Function btif_hh_uhid_thread_start
  *
- * Description creat a select loop
+ * Description starts the thread reading the events of the uhid devices
  *
- * Returns pthread_t
+ * Returns void
  *
  ******************************************************************************/
-static inline pthread_t create_thread(void* (*start_routine)(void*),
-                                      void* arg) {
-  APPL_TRACE_DEBUG("create_thread: entered");
-  pthread_attr_t thread_attr;
-
-  pthread_attr_init(&thread_attr);
-  pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
-  pthread_t thread_id = -1;
-  if (pthread_create(&thread_id, &thread_attr, start_routine, arg) != 0) {
-    APPL_TRACE_ERROR("pthread_create : %s", strerror(errno));
-    return -1;
+void btif_hh_uhid_thread_start(void) {
+  if (uhid_thread != NULL) return;
+
+  uhid_thread = thread_new("bt_hh_uhid");
+  if (uhid_thread == NULL) {
+    APPL_TRACE_ERROR("%s: unable to create the uhid thread", __func__);
   }
-  APPL_TRACE_DEBUG("create_thread: thread created successfully");
-  return thread_id;
 }
 
 /*******************************************************************************
  *
- * Function btif_hh_poll_event_thread
+ * Function btif_hh_uhid_thread_stop
  *
- * Description the polling thread which polls for event from UHID driver
+ * Description stops the thread reading the events of the uhid devices, once
+ *             they are all closed
  *
  * Returns void
  *
  ******************************************************************************/
-static void* btif_hh_poll_event_thread(void* arg) {
-  btif_hh_device_t* p_dev = (btif_hh_device_t*)arg;
-  APPL_TRACE_DEBUG("%s: Thread created fd = %d", __func__, p_dev->fd);
-  struct pollfd pfds[1];
+void btif_hh_uhid_thread_stop(void) {
+  thread_free(uhid_thread);
+  uhid_thread = NULL;
+}
 
-  pfds[0].fd = p_dev->fd;
-  pfds[0].events = POLLIN;
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_ready
+ *
+ * Description reads the events of a uhid device, on the uhid thread
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_ready(void* context) {
+  btif_hh_device_t* p_dev = (btif_hh_device_t*)context;
 
-  // Set the uhid fd as non-blocking to ensure we never block the BTU thread
-  uhid_set_non_blocking(p_dev->fd);
+  if (p_dev->uhid_read_failed) return;
 
-  while (p_dev->hh_keep_polling) {
-    int ret;
-    OSI_NO_INTR(ret = poll(pfds, 1, 50));
-    if (ret < 0) {
-      APPL_TRACE_ERROR("%s: Cannot poll for fds: %s\n", __func__,
-                       strerror(errno));
-      break;
-    }
-    if (pfds[0].revents & POLLIN) {
-      APPL_TRACE_DEBUG("%s: POLLIN", __func__);
-      ret = uhid_read_event(p_dev);
-      if (ret != 0) break;
-    }
+  int ret = uhid_read_event(p_dev);
+  if (ret == 0 || ret == -EAGAIN) return;
+
+  // The device stops being read, as its own poll thread used to. It is
+  // unregistered on the BTU thread, which registers the devices.
+  p_dev->uhid_read_failed = true;
+  APPL_TRACE_WARNING("%s: stop reading uhid fd = %d", __func__, p_dev->fd);
+  do_in_bta_thread(FROM_HERE, base::Bind(&btif_hh_uhid_unregister_fd,
+                                         p_dev->fd));
+}
+
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_register
+ *
+ * Description starts reading the events of the uhid device of |p_dev|, on
+ *             the uhid thread shared by all the devices
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_register(btif_hh_device_t* p_dev) {
+  if (p_dev->uhid_object != NULL) return;
+  if (uhid_thread == NULL) {
+    APPL_TRACE_ERROR("%s: no uhid thread for fd = %d", __func__, p_dev->fd);
+    return;
   }
 
-  p_dev->hh_poll_thread_id = -1;
-  return 0;
+  // Set the uhid fd as non-blocking to ensure we never block the BTU thread
+  uhid_set_non_blocking(p_dev->fd);
+  p_dev->uhid_read_failed = false;
+  p_dev->uhid_object =
+      reactor_register(thread_get_reactor(uhid_thread), p_dev->fd, p_dev,
+                       btif_hh_uhid_ready, NULL);
 }
 
-static inline void btif_hh_close_poll_thread(btif_hh_device_t* p_dev) {
-  APPL_TRACE_DEBUG("%s", __func__);
-  p_dev->hh_keep_polling = 0;
-  if (p_dev->hh_poll_thread_id > 0)
-    pthread_join(p_dev->hh_poll_thread_id, NULL);
+/*******************************************************************************
+ *
+ * Function btif_hh_uhid_unregister
+ *
+ * Description stops reading the events of the uhid device of |p_dev|. No
+ *             event of the device is being read once this returns.
+ *
+ * Returns void
+ *
+ ******************************************************************************/
+static void btif_hh_uhid_unregister(btif_hh_device_t* p_dev) {
+  if (p_dev->uhid_object == NULL) return;
 
-  return;
+  reactor_unregister(p_dev->uhid_object);
+  p_dev->uhid_object = NULL;
+}
+
+static void btif_hh_uhid_unregister_fd(int fd) {
+  for (int i = 0; i < BTIF_HH_MAX_HID; i++) {
+    if (btif_hh_cb.devices[i].fd == fd)
+      btif_hh_uhid_unregister(&btif_hh_cb.devices[i]);
+  }
 }
 
 void bta_hh_co_destroy(int fd) {
+  btif_hh_uhid_unregister_fd(fd);
+
   struct uhid_event ev;
   memset(&ev, 0, sizeof(ev));
   ev.type = UHID_DESTROY;
@@ -240,17 +294,19 @@ void bta_hh_co_destroy(int fd) {
 int bta_hh_co_write(int fd, uint8_t* rpt, uint16_t len) {
   APPL_TRACE_VERBOSE("%s: UHID write %d", __func__, len);
 
+  // UHID_INPUT2 carries the size before the data, so that only the report is
+  // copied and written instead of the whole event.
   struct uhid_event ev;
-  memset(&ev, 0, sizeof(ev));
-  ev.type = UHID_INPUT;
-  ev.u.input.size = len;
-  if (len > sizeof(ev.u.input.data)) {
+  if (len > sizeof(ev.u.input2.data)) {
     APPL_TRACE_WARNING("%s: Report size greater than allowed size", __func__);
     return -1;
   }
-  memcpy(ev.u.input.data, rpt, len);
+  ev.type = UHID_INPUT2;
+  ev.u.input2.size = len;
+  memcpy(ev.u.input2.data, rpt, len);
 
-  return uhid_write(fd, &ev);
+  return uhid_write_len(fd, &ev, offsetof(struct uhid_event, u.input2.data) +
+                                     len);
 }
 
 /*******************************************************************************
@@ -300,9 +356,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
       }
 
-      p_dev->hh_keep_polling = 1;
-      p_dev->hh_poll_thread_id =
-          create_thread(btif_hh_poll_event_thread, p_dev);
+      btif_hh_uhid_register(p_dev);
       break;
     }
     p_dev = NULL;
@@ -318,6 +372,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
         p_dev->sub_class = sub_class;
         p_dev->app_id = app_id;
         p_dev->local_vup = false;
+        memset(p_dev->input_latency, 0, sizeof(p_dev->input_latency));
 
         btif_hh_cb.device_num++;
         // This is a new device,open the uhid driver now.
@@ -328,9 +383,7 @@ void bta_hh_co_open(uint8_t dev_handle, uint8_t sub_class,
           return;
         } else {
           APPL_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
-          p_dev->hh_keep_polling = 1;
-          p_dev->hh_poll_thread_id =
-              create_thread(btif_hh_poll_event_thread, p_dev);
+          btif_hh_uhid_register(p_dev);
         }
 
         break;
@@ -379,7 +432,7 @@ void bta_hh_co_close(uint8_t dev_handle, uint8_t app_id) {
           "%s: Found an existing device with the same handle "
           "dev_status = %d, dev_handle =%d",
           __func__, p_dev->dev_status, p_dev->dev_handle);
-      btif_hh_close_poll_thread(p_dev);
+      btif_hh_uhid_unregister(p_dev);
       break;
     }
   }
@@ -406,6 +459,7 @@ void bta_hh_co_data(uint8_t dev_handle, uint8_t* p_rpt, uint16_t len,
                     uint8_t ctry_code, UNUSED_ATTR BD_ADDR peer_addr,
                     uint8_t app_id) {
   btif_hh_device_t* p_dev;
+  uint64_t start_us = time_get_os_boottime_us();
 
   APPL_TRACE_DEBUG(
       "%s: dev_handle = %d, subclass = 0x%02X, mode = %d, "
@@ -432,6 +486,13 @@ void bta_hh_co_data(uint8_t dev_handle, uint8_t* p_rpt, uint16_t len,
   // Send the HID data to the kernel.
   if ((p_dev->fd >= 0) && p_dev->ready_for_data) {
     bta_hh_co_write(p_dev->fd, p_rpt, len);
+
+    uint64_t latency_us = time_get_os_boottime_us() - start_us;
+    size_t bucket = 0;
+    while (bucket < BTIF_HH_INPUT_LATENCY_BUCKETS - 1 &&
+           latency_us >= input_latency_bounds_us[bucket])
+      bucket++;
+    p_dev->input_latency[bucket]++;
   } else {
     APPL_TRACE_WARNING("%s: Error: fd = %d, ready %d, len = %d", __func__,
                        p_dev->fd, p_dev->ready_for_data, len);
@@ -498,6 +559,7 @@ void bta_hh_co_send_hid_info(btif_hh_device_t* p_dev, const char* dev_name,
                        result);
 
     /* The HID report descriptor is corrupted. Close the driver. */
+    btif_hh_uhid_unregister(p_dev);
     close(p_dev->fd);
     p_dev->fd = -1;
   }
@@ -529,15 +591,15 @@ void bta_hh_le_co_rpt_info(BD_ADDR remote_bda, tBTA_HH_RPT_CACHE_ENTRY* p_entry,
            remote_bda[1], remote_bda[2], remote_bda[3], remote_bda[4],
            remote_bda[5]);
 
-  size_t len = btif_config_get_bin_length(bdstr, "HidReport");
+  size_t len = btif_config_get_bin_length(bdstr, "HidReportCache");
   if (len >= sizeof(tBTA_HH_RPT_CACHE_ENTRY) && len <= sizeof(sReportCache)) {
-    btif_config_get_bin(bdstr, "HidReport", (uint8_t*)sReportCache, &len);
+    btif_config_get_bin(bdstr, "HidReportCache", (uint8_t*)sReportCache, &len);
     idx = len / sizeof(tBTA_HH_RPT_CACHE_ENTRY);
   }
 
   if (idx < BTA_HH_NV_LOAD_MAX) {
     memcpy(&sReportCache[idx++], p_entry, sizeof(tBTA_HH_RPT_CACHE_ENTRY));
-    btif_config_set_bin(bdstr, "HidReport", (const uint8_t*)sReportCache,
+    btif_config_set_bin(bdstr, "HidReportCache", (const uint8_t*)sReportCache,
                         idx * sizeof(tBTA_HH_RPT_CACHE_ENTRY));
     BTIF_TRACE_DEBUG("%s() - Saving report; dev=%s, idx=%d", __func__, bdstr,
                      idx);
@@ -568,11 +630,11 @@ tBTA_HH_RPT_CACHE_ENTRY* bta_hh_le_co_cache_load(BD_ADDR remote_bda,
            remote_bda[1], remote_bda[2], remote_bda[3], remote_bda[4],
            remote_bda[5]);
 
-  size_t len = btif_config_get_bin_length(bdstr, "HidReport");
-  if (!p_num_rpt && len < sizeof(tBTA_HH_RPT_CACHE_ENTRY)) return NULL;
+  size_t len = btif_config_get_bin_length(bdstr, "HidReportCache");
+  if (!p_num_rpt || len < sizeof(tBTA_HH_RPT_CACHE_ENTRY)) return NULL;
 
   if (len > sizeof(sReportCache)) len = sizeof(sReportCache);
-  btif_config_get_bin(bdstr, "HidReport", (uint8_t*)sReportCache, &len);
+  btif_config_get_bin(bdstr, "HidReportCache", (uint8_t*)sReportCache, &len);
   *p_num_rpt = len / sizeof(tBTA_HH_RPT_CACHE_ENTRY);
 
   BTIF_TRACE_DEBUG("%s() - Loaded %d reports; dev=%s", __func__, *p_num_rpt,
@@ -598,6 +660,8 @@ void bta_hh_le_co_reset_rpt_cache(BD_ADDR remote_bda,
   snprintf(bdstr, sizeof(bdstr), "%02x:%02x:%02x:%02x:%02x:%02x", remote_bda[0],
            remote_bda[1], remote_bda[2], remote_bda[3], remote_bda[4],
            remote_bda[5]);
+  btif_config_remove(bdstr, "HidReportCache");
+  /* the entries of the previous format, which were never loaded */
   btif_config_remove(bdstr, "HidReport");
 
   BTIF_TRACE_DEBUG("%s() - Reset cache for bda %s", __func__, bdstr);
@@ -302,10 +302,11 @@ void bta_hl_co_get_tx_data(uint8_t app_id, tBTA_HL_MDL_HANDLE mdl_handle,
                                         &mdl_idx)) {
     p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
 
-    if ((p_dcb->tx_size <= buf_size) && p_dcb->p_tx_pkt) {
+    /* the APDU is kept until its send is confirmed, to be sent again if
+     * the channel was congested */
+    if (p_dcb->tx_size > 0 && (p_dcb->tx_size <= buf_size) &&
+        p_dcb->p_tx_pkt) {
       memcpy(p_buf, p_dcb->p_tx_pkt, p_dcb->tx_size);
-      osi_free_and_reset((void**)&p_dcb->p_tx_pkt);
-      p_dcb->tx_size = 0;
       status = BTA_HL_STATUS_OK;
     }
   }
@@ -341,14 +342,11 @@ void bta_hl_co_put_rx_data(uint8_t app_id, tBTA_HL_MDL_HANDLE mdl_handle,
                                         &mdl_idx)) {
     p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
 
-    p_dcb->p_rx_pkt = (uint8_t*)osi_malloc(data_size);
-    memcpy(p_dcb->p_rx_pkt, p_data, data_size);
     if (p_dcb->p_scb) {
       BTIF_TRACE_DEBUG("app_idx=%d mcl_idx=0x%x mdl_idx=0x%x data_size=%d",
                        app_idx, mcl_idx, mdl_idx, data_size);
       ssize_t r;
-      OSI_NO_INTR(
-          r = send(p_dcb->p_scb->socket_id[1], p_dcb->p_rx_pkt, data_size, 0));
+      OSI_NO_INTR(r = send(p_dcb->p_scb->socket_id[1], p_data, data_size, 0));
       if (r == data_size) {
         BTIF_TRACE_DEBUG("socket send success data_size=%d", data_size);
         status = BTA_HL_STATUS_OK;
@@ -356,7 +354,6 @@ void bta_hl_co_put_rx_data(uint8_t app_id, tBTA_HL_MDL_HANDLE mdl_handle,
         BTIF_TRACE_ERROR("socket send failed r=%d data_size=%d", r, data_size);
       }
     }
-    osi_free_and_reset((void**)&p_dcb->p_rx_pkt);
   }
 
   bta_hl_ci_put_rx_data(mdl_handle, status, evt);
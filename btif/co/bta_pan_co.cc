@@ -98,6 +98,7 @@ void bta_pan_co_open(uint16_t handle, uint8_t app_id, tBTA_PAN_ROLE local_role,
     }
     if (btpan_cb.tap_fd >= 0) {
       btpan_cb.flow = 1;
+      conn->flow = true;
       conn->state = PAN_STATE_OPEN;
       bta_pan_ci_rx_ready(handle);
     }
@@ -278,7 +279,7 @@ void bta_pan_co_rx_flow(UNUSED_ATTR uint16_t handle, UNUSED_ATTR uint8_t app_id,
   BTIF_TRACE_API("bta_pan_co_rx_flow, enabled:%d, not used", enable);
   btpan_conn_t* conn = btpan_find_conn_handle(handle);
   if (!conn || conn->state != PAN_STATE_OPEN) return;
-  btpan_set_flow_control(enable);
+  btpan_set_conn_flow_control(conn, enable);
 }
 
 /*******************************************************************************
@@ -34,4 +34,25 @@ void btif_a2dp_control_cleanup(void);
 // |status| is the acknowledement status - see |tA2DP_CTRL_ACK|.
 void btif_a2dp_command_ack(tA2DP_CTRL_ACK status);
 
+// Read up to |len| bytes of PCM audio data sent by the origin of audio
+// streaming into |p_buf|. The data is taken from the shared memory ring if
+// the audio HAL opened one, otherwise it is read from the audio data channel.
+// Returns the number of bytes read.
+uint32_t btif_a2dp_control_read_audio(uint8_t* p_buf, uint32_t len);
+
+// Get the number of bytes of PCM audio data that can be read without
+// waiting, into |p_len|.
+// Returns true on success, or false if it is not known.
+bool btif_a2dp_control_get_audio_available(uint32_t* p_len);
+
+// Discard the PCM audio data pending from the origin of audio streaming.
+void btif_a2dp_control_flush_audio(void);
+
+// Write up to |len| bytes of decoded Sink PCM audio data from |p_buf| to the
+// shared memory ring of the audio HAL input stream, and the number of bytes
+// written into |p_written|.
+// Returns false if the audio HAL input stream did not open a ring.
+bool btif_a2dp_control_write_sink_audio(const uint8_t* p_buf, uint32_t len,
+                                        uint32_t* p_written);
+
 #endif /* BTIF_A2DP_CONTROL_H */
@@ -76,12 +76,13 @@ void btif_a2dp_sink_on_suspended(tBTA_AV_SUSPEND* p_av_suspend);
 // If |enable| is true, the discarding is enabled, otherwise is disabled.
 void btif_a2dp_sink_set_rx_flush(bool enable);
 
-// Enqueue a buffer to the A2DP Sink queue. If the queue has reached its
-// maximum size |MAX_INPUT_A2DP_FRAME_QUEUE_SZ|, the oldest buffer is
+// Enqueue a buffer to the A2DP Sink queue. If the queue holds much more
+// than the target playout delay of the jitter buffer, the oldest buffer is
 // removed from the queue.
 // |p_buf| is the buffer to enqueue.
+// |timestamp| is the RTP timestamp of the media packet in |p_buf|.
 // Returns the number of buffers in the Sink queue after the enqueing.
-uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_buf);
+uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_buf, uint32_t timestamp);
 
 // Dump debug-related information for the A2DP Sink module.
 // |fd| is the file descriptor to use for writing the ASCII formatted
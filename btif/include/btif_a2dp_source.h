@@ -86,10 +86,35 @@ void btif_a2dp_source_on_suspended(tBTA_AV_SUSPEND* p_av_suspend);
 // If |enable| is true, the discarding is enabled, otherwise is disabled.
 void btif_a2dp_source_set_tx_flush(bool enable);
 
+// Notify that the link is not draining the transmitted A2DP buffers.
+// The congestion is reported to the encoder on the next timer tick.
+// This function can be called from any thread.
+void btif_a2dp_source_on_congested(void);
+
+// Gets the delays (in microseconds) added by the A2DP Source while
+// streaming, after the audio was read from the audio data path.
+// |p_encoder_delay_us| is set to the encoder lookahead of the current codec,
+// and |p_tx_queue_delay_us| to how long the audio currently waits in the
+// transmit queue. Both are set to 0 if not streaming.
+void btif_a2dp_source_get_delay_us(uint32_t* p_encoder_delay_us,
+                                   uint32_t* p_tx_queue_delay_us);
+
+// Get the periodic interval of the current encoder.
+// |p_interval_ms| is set to the encoder interval, or 0 if no encoder is set
+// up, and |p_low_latency| to whether the encoder runs in a low latency mode,
+// sending each packet as soon as it is encoded.
+void btif_a2dp_source_get_encoder_interval(period_ms_t* p_interval_ms,
+                                           bool* p_low_latency);
+
 // Get the next A2DP buffer to send.
 // Returns the next A2DP buffer to send if available, otherwise NULL.
 BT_HDR* btif_a2dp_source_audio_readbuf(void);
 
+// Get the number of times the A2DP buffers to send were flushed.
+// A buffer read before the count last changed belongs to the flushed audio.
+// This function can be called from any thread.
+uint32_t btif_a2dp_source_audio_flush_count(void);
+
 // Dump debug-related information for the A2DP Source module.
 // |fd| is the file descriptor to use for writing the ASCII formatted
 // information.
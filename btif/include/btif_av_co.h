@@ -31,6 +31,17 @@ extern "C" {
 // |p_peer_params| cannot be null.
 void bta_av_co_get_peer_params(tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params);
 
+// Gets the audio delay reported by the connected A2DP Sink(s) with AVDTP
+// Delay Reporting.
+// Returns the largest delay of the opened peers in microseconds, or 0 if
+// none of them reported its delay.
+uint32_t bta_av_co_get_sink_delay_us(void);
+
+// Gets the SCMS-T content protection state of the stream.
+// Returns true if the content protection is active, and sets |p_cp_flag| to
+// the SCMS-T header sent with the media packets.
+bool bta_av_co_get_scmst_info(uint8_t* p_cp_flag);
+
 // Gets the current A2DP encoder interface that can be used to encode and
 // prepare A2DP packets for transmission - see |tA2DP_ENCODER_INTERFACE|.
 // Returns the A2DP encoder interface if the current codec is setup,
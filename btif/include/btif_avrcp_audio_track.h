@@ -26,6 +26,8 @@
  * volume control we should deprecate this file.
  */
 
+#include <stdint.h>
+
 /**
  * Creates an audio track object and returns a void handle. Use this handle to
  * the
@@ -66,3 +68,9 @@ void BtifAvrcpAudioTrackDelete(void* handle);
  */
 int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
                                  int bufferlen);
+
+/**
+ * Returns the number of frames the audio track played as silence, for lack
+ * of data written in time.
+ */
+uint32_t BtifAvrcpAudioTrackGetUnderrunFrames(void* handle);
@@ -249,6 +249,10 @@ bt_status_t btif_transfer_context(tBTIF_CBACK* p_cback, uint16_t event,
                                   char* p_params, int param_len,
                                   tBTIF_COPY_CBACK* p_copy_cback);
 
+/* Dumps the context switch statistics of each callback, to find the chatty
+ * paths */
+void btif_debug_context_switch_dump(int fd);
+
 void btif_init_ok(UNUSED_ATTR uint16_t event, UNUSED_ATTR char* p_param);
 
 #endif /* BTIF_COMMON_H */
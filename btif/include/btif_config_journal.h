@@ -0,0 +1,52 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <string>
+
+typedef struct config_t config_t;
+
+// The journal of bt_config.conf holds the changes made to the config since
+// it was last saved, one record per line, so that a change costs an append
+// instead of rewriting the whole file. The journal is replayed over the saved
+// config when it is loaded, and emptied each time the config is saved again.
+
+// Adds to |records| the record of setting |key| of |section| to |value|.
+// Returns false if the record cannot be journaled, in which case the change
+// has to be persisted by saving the whole config. None of the arguments may
+// be NULL.
+bool btif_config_journal_add_set(std::string* records, const char* section,
+                                 const char* key, const char* value);
+
+// Adds to |records| the record of removing |key| of |section|. Returns false
+// if the record cannot be journaled. None of the arguments may be NULL.
+bool btif_config_journal_add_remove(std::string* records, const char* section,
+                                    const char* key);
+
+// Applies the records of the journal file |filename| to |config|, in order.
+// A missing journal is an empty one. Returns false if the journal is torn or
+// corrupted: the records up to the first bad one are still applied, and the
+// config should be saved again to start over from an empty journal. The
+// number of records applied is stored in |applied| if it is not NULL.
+// Neither |config| nor |filename| may be NULL.
+bool btif_config_journal_replay(config_t* config, const char* filename,
+                                size_t* applied);
@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bta_gatt_api.h"
+
+// The notification batch carries the GATT client notifications and
+// indications from the BTU thread to the JNI thread without a context
+// transfer for each of them. The values are queued in a ring buffer per
+// connection, the JNI thread is woken up once for all the notifications
+// queued meanwhile, and it takes them in batches, round robin across the
+// connections. The order of the notifications of a connection is kept, and
+// so is their order with the events posted after them.
+//
+// When the ring buffer of a connection is full, its new notifications are
+// dropped instead of queued, while an indication drops the oldest
+// notifications to make room as it has to be confirmed.
+
+typedef struct btif_gatt_notify_batch_t btif_gatt_notify_batch_t;
+
+// Delivers |count| notifications, in the order they were received. The
+// notifications are only valid during the callback.
+typedef void (*btif_gatt_notify_batch_cb)(const tBTA_GATTC_NOTIFY* notify,
+                                           size_t count);
+
+// Creates a notification batch with a ring buffer of |ring_size| octets per
+// connection, delivering up to |batch_size| notifications per |callback|.
+// Returns NULL on failure. The batch must be freed with
+// |btif_gatt_notify_batch_free|.
+btif_gatt_notify_batch_t* btif_gatt_notify_batch_new(
+    size_t ring_size, size_t batch_size, btif_gatt_notify_batch_cb callback);
+
+// Frees |batch| and the notifications still queued. |batch| may be NULL.
+void btif_gatt_notify_batch_free(btif_gatt_notify_batch_t* batch);
+
+// Queues |notify| on the ring buffer of its connection. Returns true if the
+// caller has to schedule |btif_gatt_notify_batch_drain|, which is the case
+// when no drain is pending yet. Neither |batch| nor |notify| may be NULL.
+// This function is safe to call from any thread.
+bool btif_gatt_notify_batch_put(btif_gatt_notify_batch_t* batch,
+                                const tBTA_GATTC_NOTIFY* notify);
+
+// Marks the connection |conn_id| as closed: its ring buffer is freed once the
+// notifications queued on it have been delivered. |batch| may not be NULL.
+// This function is safe to call from any thread.
+void btif_gatt_notify_batch_close(btif_gatt_notify_batch_t* batch,
+                                  uint16_t conn_id);
+
+// Delivers all the queued notifications to the callback of |batch|, including
+// the ones queued while it runs, and ends the pending drain. |batch| may not
+// be NULL. Only one thread at a time may drain a batch.
+void btif_gatt_notify_batch_drain(btif_gatt_notify_batch_t* batch);
+
+// Returns the number of notifications dropped by |batch| as their ring buffer
+// was full. |batch| may not be NULL.
+size_t btif_gatt_notify_batch_get_dropped(
+    const btif_gatt_notify_batch_t* batch);
@@ -25,6 +25,7 @@
 #include <stdint.h>
 #include "bta_hh_api.h"
 #include "btu.h"
+#include "osi/include/reactor.h"
 
 /*******************************************************************************
  *  Constants & Macros
@@ -41,6 +42,11 @@
 #define BTIF_HH_MAX_POLLING_ATTEMPTS 10
 #define BTIF_HH_POLLING_SLEEP_DURATION_US 5000
 
+/* The input reports are counted by the time from their reception by the HID
+ * host to their write to uhid: below 125 us, 250 us, 500 us, 1 ms, 2 ms,
+ * 5 ms, 10 ms, or more */
+#define BTIF_HH_INPUT_LATENCY_BUCKETS 8
+
 /*******************************************************************************
  *  Type definitions and return values
  ******************************************************************************/
@@ -64,10 +70,11 @@ typedef struct {
   uint8_t app_id;
   int fd;
   bool ready_for_data;
-  pthread_t hh_poll_thread_id;
-  uint8_t hh_keep_polling;
+  reactor_object_t* uhid_object;  // uhid fd events, on the uhid thread
+  bool uhid_read_failed;          // the uhid fd is no longer read
   alarm_t* vup_timer;
   bool local_vup;  // Indicated locally initiated VUP
+  uint32_t input_latency[BTIF_HH_INPUT_LATENCY_BUCKETS];
 } btif_hh_device_t;
 
 /* Control block to maintain properties of devices */
@@ -106,6 +113,15 @@ extern void btif_hh_setreport(btif_hh_device_t* p_dev,
                               uint8_t* report);
 extern void btif_hh_service_registration(bool enable);
 
+/* Starts and stops the thread reading the events of the uhid devices of all
+ * the connected HID devices. */
+extern void btif_hh_uhid_thread_start(void);
+extern void btif_hh_uhid_thread_stop(void);
+
+/* Dumps the connected HID devices, with the latency of their input reports,
+ * to |fd|. */
+extern void btif_hh_debug_dump(int fd);
+
 bool btif_hh_add_added_dev(bt_bdaddr_t bd_addr, tBTA_HH_ATTR_MASK attr_mask);
 
 #endif
@@ -54,6 +54,7 @@ typedef enum {
   BTIF_HL_SOC_STATE_W4_ADD,
   BTIF_HL_SOC_STATE_W4_CONN,
   BTIF_HL_SOC_STATE_W4_READ,
+  BTIF_HL_SOC_STATE_W4_TX, /* not read until its last APDU is sent */
   BTIF_HL_SOC_STATE_W4_REL
 } btif_hl_soc_state_t;
 
@@ -161,8 +162,8 @@ typedef struct {
   bool delete_mdl;
   uint16_t mtu;
   tMCA_CHNL_CFG chnl_cfg;
-  uint16_t tx_size;
-  uint8_t* p_tx_pkt;
+  uint16_t tx_size;  /* size of the APDU being sent, 0 if none */
+  uint8_t* p_tx_pkt; /* |mtu| octets, kept while the channel is open */
   uint8_t* p_rx_pkt;
   bool cong;
   btif_hl_soc_cb_t* p_scb;
@@ -29,6 +29,7 @@
 
 #include "bt_types.h"
 #include "btif_pan.h"
+#include "osi/include/fixed_queue.h"
 
 /*******************************************************************************
  *  Constants & Macros
@@ -70,6 +71,8 @@ typedef struct {
   int local_role;
   int remote_role;
   unsigned char eth_addr[ETH_ADDR_LEN];
+  bool flow;              // outbound data flow to the peer on
+  fixed_queue_t* hold_q;  // frames to the peer held while its flow is off
 } btpan_conn_t;
 
 typedef struct {
@@ -80,8 +83,6 @@ typedef struct {
   int open_count;
   int flow;  // 1: outbound data flow on; 0: outbound data flow off
   btpan_conn_t conns[MAX_PAN_CONNS];
-  int congest_packet_size;
-  unsigned char congest_packet[1600];  // max ethernet packet size
 } btpan_cb_t;
 
 /*******************************************************************************
@@ -94,6 +95,7 @@ btpan_conn_t* btpan_new_conn(int handle, const BD_ADDR addr, int local_role,
 btpan_conn_t* btpan_find_conn_addr(const BD_ADDR addr);
 btpan_conn_t* btpan_find_conn_handle(uint16_t handle);
 void btpan_set_flow_control(bool enable);
+void btpan_set_conn_flow_control(btpan_conn_t* conn, bool enable);
 int btpan_get_connected_count(void);
 int btpan_tap_open(void);
 void create_tap_read_thread(int tap_fd);
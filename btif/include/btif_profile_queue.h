@@ -33,7 +33,7 @@ typedef bt_status_t (*btif_connect_cb_t)(bt_bdaddr_t* bda, uint16_t uuid);
 
 bt_status_t btif_queue_connect(uint16_t uuid, const bt_bdaddr_t* bda,
                                btif_connect_cb_t connect_cb);
-void btif_queue_advance();
+void btif_queue_advance_by_uuid(uint16_t uuid);
 bt_status_t btif_queue_connect_next(void);
 void btif_queue_release();
 
@@ -0,0 +1,71 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avrc_defs.h"
+#include "osi/include/time.h"
+
+// The attribute cache keeps the media attributes the app gave for the items
+// browsed by a controller, keyed by (player, scope, UID, attribute), so that
+// the GetItemAttributes following a GetFolderItems are answered without
+// asking the app again. An attribute is only returned for the UID counter it
+// was given with, and until |timeout_ms| after it was given. The cache is
+// direct mapped: an attribute may evict another one.
+//
+// The attributes may also be cached as absent, the app having given none
+// for an item asked for it, so that they are not asked for again either.
+
+typedef struct btif_rc_attr_cache_t btif_rc_attr_cache_t;
+
+// Creates a cache of |size| attributes, rounded up to a power of two, valid
+// |timeout_ms| each. Returns NULL if |size| is 0. The cache must be freed
+// with |btif_rc_attr_cache_free|.
+btif_rc_attr_cache_t* btif_rc_attr_cache_new(size_t size,
+                                             period_ms_t timeout_ms);
+
+// Frees |cache| and the attributes it holds. |cache| may be NULL.
+void btif_rc_attr_cache_free(btif_rc_attr_cache_t* cache);
+
+// Caches the value |value| of the attribute |attr_id| of the item |uid| of
+// the scope |scope| of the player |player_id|, given at the time |now_ms|
+// for the UID counter |uid_counter|. A NULL |value| caches the attribute as
+// absent. The value is copied. |cache| may not be NULL.
+void btif_rc_attr_cache_put(btif_rc_attr_cache_t* cache, uint16_t player_id,
+                            uint8_t scope, const tAVRC_UID uid,
+                            uint16_t uid_counter, uint32_t attr_id,
+                            const tAVRC_FULL_NAME* value, period_ms_t now_ms);
+
+// Looks up the |num_attr_ids| attributes |attr_ids| of the item |uid| at the
+// time |now_ms|. Returns true if all of them are cached for |uid_counter|,
+// in which case the ones not absent are copied to |attrs|, in the order of
+// |attr_ids|, and their number to |num_attrs|. The values of |attrs| are
+// owned by |cache|, and only valid until it is next modified. |cache| may not
+// be NULL.
+bool btif_rc_attr_cache_get(btif_rc_attr_cache_t* cache, uint16_t player_id,
+                            uint8_t scope, const tAVRC_UID uid,
+                            uint16_t uid_counter, const uint32_t* attr_ids,
+                            uint8_t num_attr_ids, period_ms_t now_ms,
+                            tAVRC_ATTR_ENTRY* attrs, uint8_t* num_attrs);
+
+// Forgets all the attributes of |cache|. |cache| may not be NULL.
+void btif_rc_attr_cache_clear(btif_rc_attr_cache_t* cache);
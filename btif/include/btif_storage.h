@@ -139,6 +139,18 @@ bt_status_t btif_storage_add_bonded_device(bt_bdaddr_t* remote_bd_addr,
  ******************************************************************************/
 bt_status_t btif_storage_remove_bonded_device(bt_bdaddr_t* remote_bd_addr);
 
+/*******************************************************************************
+ *
+ * Function         btif_storage_invalidate_sdp_cache
+ *
+ * Description      BTIF storage API - Drops the SDP responses cached for the
+ *                  remote device, so that its services are searched again.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_invalidate_sdp_cache(bt_bdaddr_t* remote_bd_addr);
+
 /*******************************************************************************
  *
  * Function         btif_storage_remove_bonded_device
@@ -261,6 +273,49 @@ bt_status_t btif_storage_set_hidd(bt_bdaddr_t* remote_bd_addr);
 
 bt_status_t btif_storage_remove_hidd(bt_bdaddr_t* remote_bd_addr);
 
+/*******************************************************************************
+ *
+ * Function         btif_storage_set_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Stores the |length| octets of |caps|, the
+ *                  stream endpoints of the bonded A2DP peer and their
+ *                  capabilities, in NVRAM
+ *
+ * Returns          BT_STATUS_SUCCESS if the store was successful,
+ *                  BT_STATUS_FAIL otherwise, or if the peer is not bonded
+ *
+ ******************************************************************************/
+bt_status_t btif_storage_set_a2dp_peer_caps(const bt_bdaddr_t* remote_bd_addr,
+                                            const uint8_t* caps,
+                                            size_t length);
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_get_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Reads the stream endpoints of the A2DP
+ *                  peer stored by btif_storage_set_a2dp_peer_caps in |caps|,
+ *                  of |*length| octets. |*length| is set to the length read.
+ *
+ * Returns          true if they were found and fit in |caps|
+ *
+ ******************************************************************************/
+bool btif_storage_get_a2dp_peer_caps(const bt_bdaddr_t* remote_bd_addr,
+                                     uint8_t* caps, size_t* length);
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_remove_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Deletes the stream endpoints of the A2DP
+ *                  peer from NVRAM
+ *
+ * Returns          BT_STATUS_SUCCESS
+ *
+ ******************************************************************************/
+bt_status_t btif_storage_remove_a2dp_peer_caps(
+    const bt_bdaddr_t* remote_bd_addr);
+
 // Gets the device name for a given Bluetooth address |bd_addr|.
 // The device name (if found) is stored in |name|.
 // Returns true if the device name is found, othervise false.
@@ -48,22 +48,33 @@
 
 #include "bt_utils.h"
 #include "bta/include/bta_hf_client_api.h"
+#include "btcore/include/module.h"
 #include "btif/include/btif_debug_btsnoop.h"
 #include "btif/include/btif_debug_conn.h"
 #include "btif_a2dp.h"
 #include "btif_api.h"
 #include "btif_config.h"
 #include "btif_debug.h"
+#include "btif_hh.h"
 #include "btif_storage.h"
+#include "btm_ble_api.h"
 #include "btsnoop.h"
 #include "btsnoop_mem.h"
+#include "btu.h"
 #include "device/include/interop.h"
+#include "gatt_api.h"
+#include "hci_layer.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
 #include "osi/include/metrics.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/slab.h"
+#include "osi/include/stall_log.h"
+#include "osi/include/trace_ring.h"
 #include "osi/include/wakelock.h"
+#include "smp_api.h"
 #include "stack_manager.h"
 
 /* Test interface includes */
@@ -76,6 +87,9 @@
 bt_callbacks_t* bt_hal_cbacks = NULL;
 bool restricted_mode = false;
 
+// Enables the osi slab allocator when set to "true"
+static const char* SLAB_ALLOCATOR_PROPERTY = "persist.bluetooth.slaballocator";
+
 /*******************************************************************************
  *  Externs
  ******************************************************************************/
@@ -140,6 +154,10 @@ static int init(bt_callbacks_t* callbacks) {
   allocation_tracker_init();
 #endif
 
+  char slab_allocator[PROPERTY_VALUE_MAX] = {0};
+  osi_property_get(SLAB_ALLOCATOR_PROPERTY, slab_allocator, "false");
+  if (strncmp(slab_allocator, "true", 4) == 0) slab_init();
+
   bt_hal_cbacks = callbacks;
   stack_manager_get_interface()->init_stack();
   btif_debug_init();
@@ -312,11 +330,27 @@ static void dump(int fd, const char** arguments) {
   btif_debug_conn_dump(fd);
   btif_debug_bond_event_dump(fd);
   btif_debug_a2dp_dump(fd);
+  btif_hh_debug_dump(fd);
   btif_debug_config_dump(fd);
+  btif_debug_context_switch_dump(fd);
+  module_debug_dump(fd);
+  hci_layer_debug_dump(fd);
   BTA_HfClientDumpStatistics(fd);
+  BTM_BleBatchScanDumpStatistics(fd);
+  BTM_BleAdvRotationDumpStatistics(fd);
+  BTM_BleResolvingListDumpStatistics(fd);
+  BTM_ScoDumpStatistics(fd);
+  BTM_PmDumpStatistics(fd);
+  BTA_DmDumpTopology(fd);
+  BTA_SysDumpStatistics(fd);
+  BTU_DumpStatistics(fd);
+  SMP_DumpKeyPairPool(fd);
+  GATT_DumpConnections(fd);
   wakelock_debug_dump(fd);
   osi_allocator_debug_dump(fd);
   alarm_debug_dump(fd);
+  trace_ring_debug_dump(fd);
+  stall_log_debug_dump(fd);
 #if (BTSNOOP_MEM == TRUE)
   btif_debug_btsnoop_dump(fd);
 #endif
@@ -103,6 +103,8 @@ void btif_a2dp_on_offload_started(tBTA_AV_STATUS status) {
 
   switch (status) {
     case BTA_AV_SUCCESS:
+      /* The controller encodes from now on: stop the host encoding */
+      if (btif_a2dp_source_is_streaming()) btif_a2dp_source_stop_audio_req();
       ack = A2DP_CTRL_ACK_SUCCESS;
       break;
     case BTA_AV_FAIL_RESOURCES:
@@ -22,6 +22,7 @@
 #include <base/logging.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <mutex>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "bt_common.h"
@@ -33,17 +34,49 @@
 #include "btif_av_co.h"
 #include "btif_hf.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
 #include "uipc.h"
 
 #define A2DP_DATA_READ_POLL_MS 10
 
+// The window the audio data is busy-polled for before the media task blocks
+// on it, in microseconds. The default of 0 disables the busy-poll.
+#define A2DP_DATA_READ_BUSY_POLL_US_PROPERTY \
+  "persist.bluetooth.a2dp.read_busy_poll_us"
+
 static void btif_a2dp_data_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
 static void btif_a2dp_ctrl_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
 
 /* We can have max one command pending */
 static tA2DP_CTRL_CMD a2dp_cmd_pending = A2DP_CTRL_CMD_NONE;
 
+/*
+ * The shared memory ring the audio HAL writes the PCM data to, if any.
+ * It is opened from the control channel and read from the media task.
+ */
+static tA2DP_PCM_RING a2dp_pcm_ring;
+static std::mutex a2dp_pcm_ring_mutex;
+
+/*
+ * The shared memory ring the audio HAL input stream reads the Sink PCM data
+ * from, if any. It is opened from the control channel and written from the
+ * Sink worker thread.
+ */
+static tA2DP_PCM_RING a2dp_input_pcm_ring;
+static std::mutex a2dp_input_pcm_ring_mutex;
+
+static void btif_a2dp_control_close_pcm_ring(void) {
+  {
+    std::lock_guard<std::mutex> lock(a2dp_pcm_ring_mutex);
+    audio_a2dp_hw_pcm_ring_close(&a2dp_pcm_ring);
+  }
+  std::lock_guard<std::mutex> lock(a2dp_input_pcm_ring_mutex);
+  audio_a2dp_hw_pcm_ring_close(&a2dp_input_pcm_ring);
+}
+
 void btif_a2dp_control_init(void) {
+  audio_a2dp_hw_pcm_ring_init(&a2dp_pcm_ring);
+  audio_a2dp_hw_pcm_ring_init(&a2dp_input_pcm_ring);
   UIPC_Init(NULL);
   UIPC_Open(UIPC_CH_ID_AV_CTRL, btif_a2dp_ctrl_cb);
 }
@@ -51,6 +84,87 @@ void btif_a2dp_control_init(void) {
 void btif_a2dp_control_cleanup(void) {
   /* This calls blocks until UIPC is fully closed */
   UIPC_Close(UIPC_CH_ID_ALL);
+  btif_a2dp_control_close_pcm_ring();
+}
+
+uint32_t btif_a2dp_control_read_audio(uint8_t* p_buf, uint32_t len) {
+  {
+    std::lock_guard<std::mutex> lock(a2dp_pcm_ring_mutex);
+    if (audio_a2dp_hw_pcm_ring_is_open(&a2dp_pcm_ring))
+      return audio_a2dp_hw_pcm_ring_read(&a2dp_pcm_ring, p_buf, len);
+  }
+
+  uint16_t event;
+  return UIPC_Read(UIPC_CH_ID_AV_AUDIO, &event, p_buf, len);
+}
+
+bool btif_a2dp_control_get_audio_available(uint32_t* p_len) {
+  {
+    std::lock_guard<std::mutex> lock(a2dp_pcm_ring_mutex);
+    if (audio_a2dp_hw_pcm_ring_is_open(&a2dp_pcm_ring)) {
+      *p_len = audio_a2dp_hw_pcm_ring_get_used(&a2dp_pcm_ring);
+      return true;
+    }
+  }
+
+  return UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_AVAILABLE, p_len);
+}
+
+void btif_a2dp_control_flush_audio(void) {
+  {
+    std::lock_guard<std::mutex> lock(a2dp_pcm_ring_mutex);
+    audio_a2dp_hw_pcm_ring_flush(&a2dp_pcm_ring);
+  }
+
+  UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, NULL);
+}
+
+bool btif_a2dp_control_write_sink_audio(const uint8_t* p_buf, uint32_t len,
+                                        uint32_t* p_written) {
+  std::lock_guard<std::mutex> lock(a2dp_input_pcm_ring_mutex);
+  if (!audio_a2dp_hw_pcm_ring_is_open(&a2dp_input_pcm_ring)) return false;
+
+  *p_written = audio_a2dp_hw_pcm_ring_write(&a2dp_input_pcm_ring, p_buf, len);
+  return true;
+}
+
+// Creates the PCM |ring| guarded by |ring_mutex|, of the size the audio HAL
+// asks for, and sends it to the audio HAL.
+static void btif_a2dp_open_pcm_ring(tA2DP_PCM_RING* ring,
+                                    std::mutex* ring_mutex) {
+  uint32_t ring_size = 0;
+  uint8_t status = A2DP_CTRL_ACK_FAILURE;
+  int fd = -1;
+
+  btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
+  if (UIPC_Read(UIPC_CH_ID_AV_CTRL, 0, reinterpret_cast<uint8_t*>(&ring_size),
+                sizeof(ring_size)) != sizeof(ring_size)) {
+    APPL_TRACE_ERROR("Error reading PCM ring size from audio HAL");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(*ring_mutex);
+    audio_a2dp_hw_pcm_ring_close(ring);
+    if (audio_a2dp_hw_pcm_ring_create(ring, ring_size)) {
+      status = A2DP_CTRL_ACK_SUCCESS;
+      fd = ring->fd;
+    } else {
+      APPL_TRACE_WARNING("%s: cannot create PCM ring of %u bytes", __func__,
+                         ring_size);
+    }
+  }
+
+  // The audio HAL falls back to the audio data channel if there is no ring
+  if (fd < 0) {
+    UIPC_Send(UIPC_CH_ID_AV_CTRL, 0, &status, sizeof(status));
+    return;
+  }
+  if (!UIPC_SendFd(UIPC_CH_ID_AV_CTRL, &status, sizeof(status), fd)) {
+    APPL_TRACE_ERROR("Error sending PCM ring to audio HAL");
+    std::lock_guard<std::mutex> lock(*ring_mutex);
+    audio_a2dp_hw_pcm_ring_close(ring);
+  }
 }
 
 static void btif_a2dp_recv_ctrl_data(void) {
@@ -179,7 +293,9 @@ static void btif_a2dp_recv_ctrl_data(void) {
       btav_a2dp_codec_config_t codec_config;
       btav_a2dp_codec_config_t codec_capability;
 //Chris Add      
-      btav_a2dp_codec_index_t codec_index;
+      btav_a2dp_codec_index_t codec_index = BTAV_A2DP_CODEC_INDEX_MAX;
+      period_ms_t encoder_interval_ms;
+      bool low_latency;
       codec_config.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_NONE;
       codec_config.bits_per_sample = BTAV_A2DP_CODEC_BITS_PER_SAMPLE_NONE;
       codec_config.channel_mode = BTAV_A2DP_CODEC_CHANNEL_MODE_NONE;
@@ -193,6 +309,8 @@ static void btif_a2dp_recv_ctrl_data(void) {
         codec_capability = current_codec->getCodecCapability();
         codec_index = current_codec->codecIndex();
       }
+      btif_a2dp_source_get_encoder_interval(&encoder_interval_ms,
+                                            &low_latency);
 
       btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
       // Send the current codec config
@@ -219,6 +337,17 @@ static void btif_a2dp_recv_ctrl_data(void) {
       UIPC_Send(UIPC_CH_ID_AV_CTRL, 0, reinterpret_cast<const uint8_t*>(
                                            &codec_index),
                 sizeof(btav_a2dp_codec_index_t));
+      // Send the current encoder interval and latency mode
+      tA2DP_ENCODER_INTERVAL_MS interval_ms =
+          (tA2DP_ENCODER_INTERVAL_MS)encoder_interval_ms;
+      tA2DP_LATENCY_MODE latency_mode =
+          low_latency ? A2DP_LATENCY_MODE_LOW : A2DP_LATENCY_MODE_NORMAL;
+      UIPC_Send(UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&interval_ms),
+                sizeof(tA2DP_ENCODER_INTERVAL_MS));
+      UIPC_Send(UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&latency_mode),
+                sizeof(tA2DP_LATENCY_MODE));
       break;
     }
 
@@ -265,6 +394,34 @@ static void btif_a2dp_recv_ctrl_data(void) {
       btif_dispatch_sm_event(BTIF_AV_OFFLOAD_START_REQ_EVT, NULL, 0);
       break;
 
+    case A2DP_CTRL_CMD_SHM_OPEN:
+      btif_a2dp_open_pcm_ring(&a2dp_pcm_ring, &a2dp_pcm_ring_mutex);
+      break;
+
+    case A2DP_CTRL_CMD_SHM_OPEN_INPUT:
+      btif_a2dp_open_pcm_ring(&a2dp_input_pcm_ring,
+                              &a2dp_input_pcm_ring_mutex);
+      break;
+
+    case A2DP_CTRL_GET_LATENCY: {
+      tA2DP_LATENCY_US encoder_delay_us;
+      tA2DP_LATENCY_US tx_queue_delay_us;
+      tA2DP_LATENCY_US sink_delay_us = bta_av_co_get_sink_delay_us();
+
+      btif_a2dp_source_get_delay_us(&encoder_delay_us, &tx_queue_delay_us);
+      btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
+      UIPC_Send(UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&encoder_delay_us),
+                sizeof(tA2DP_LATENCY_US));
+      UIPC_Send(UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&tx_queue_delay_us),
+                sizeof(tA2DP_LATENCY_US));
+      UIPC_Send(UIPC_CH_ID_AV_CTRL, 0,
+                reinterpret_cast<const uint8_t*>(&sink_delay_us),
+                sizeof(tA2DP_LATENCY_US));
+      break;
+    }
+
     default:
       APPL_TRACE_ERROR("UNSUPPORTED CMD (%d)", cmd);
       btif_a2dp_command_ack(A2DP_CTRL_ACK_FAILURE);
@@ -311,6 +468,10 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
       UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REG_REMOVE_ACTIVE_READSET, NULL);
       UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_SET_READ_POLL_TMO,
                  reinterpret_cast<void*>(A2DP_DATA_READ_POLL_MS));
+      UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_SET_READ_MEDIA_MODE,
+                 reinterpret_cast<void*>(static_cast<intptr_t>(
+                     osi_property_get_int32(
+                         A2DP_DATA_READ_BUSY_POLL_US_PROPERTY, 0))));
 
       if (btif_av_get_peer_sep() == AVDT_TSEP_SNK) {
         /* Start the media task to encode the audio */
@@ -322,6 +483,7 @@ static void btif_a2dp_data_cb(UNUSED_ATTR tUIPC_CH_ID ch_id,
 
     case UIPC_CLOSE_EVT:
       APPL_TRACE_EVENT("## AUDIO PATH DETACHED ##");
+      btif_a2dp_control_close_pcm_ring();
       btif_a2dp_command_ack(A2DP_CTRL_ACK_SUCCESS);
       /*
        * Send stop request only if we are actively streaming and haven't
@@ -20,31 +20,36 @@
 #define LOG_TAG "bt_btif_a2dp_sink"
 
 #include <string.h>
+#include <atomic>
+#include <mutex>
 
+#include "a2dp_jitter_buffer.h"
 #include "bt_common.h"
 #include "btif_a2dp.h"
+#include "btif_a2dp_control.h"
 #include "btif_a2dp_sink.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_avrcp_audio_track.h"
 #include "btif_util.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/ringbuffer.h"
+#include "osi/include/spsc_queue.h"
 #include "osi/include/thread.h"
-
-#include "oi_codec_sbc.h"
-#include "oi_status.h"
-
-/**
- * The receiving queue buffer size.
- */
-#define MAX_INPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
+#include "osi/include/time.h"
 
 #define BTIF_SINK_MEDIA_TIME_TICK_MS 20
 
-/* In case of A2DP Sink, we will delay start by 5 AVDTP Packets */
-#define MAX_A2DP_DELAYED_START_FRAME_COUNT 5
+/* Number of decoded packets waiting to be played */
+#define BTIF_A2DP_SINK_PCM_QUEUE_SZ 4
+
+/* Duration of the PCM played, waiting to be written to the audio track */
+#ifndef BTIF_A2DP_SINK_TRACK_RING_MS
+#define BTIF_A2DP_SINK_TRACK_RING_MS 100
+#endif
 
 enum {
   BTIF_A2DP_SINK_STATE_OFF,
@@ -78,31 +83,88 @@ typedef struct {
   uint16_t layer_specific;
 } tBT_SBC_HDR;
 
+/* The PCM of a decoded packet, followed by |num_frames| * |frame_len| octets
+ * of interleaved 16-bit samples */
+typedef struct {
+  uint32_t generation;    /* |btif_a2dp_sink_pcm_generation| of the packet */
+  uint16_t num_frames;    /* Number of decoded frames */
+  uint16_t played_frames; /* Number of frames already played */
+  uint32_t frame_len;     /* Octets of PCM of each frame */
+} tBTIF_A2DP_SINK_PCM;
+
+typedef struct {
+  uint32_t decoded_frames;
+  uint32_t decode_error_frames; /* Played as silence */
+  uint32_t late_frames;         /* Skipped as not decoded in time */
+  uint32_t decoded_packets;
+  uint64_t decode_us_total;
+  uint64_t decode_us_max; /* Decoding time of a packet */
+  uint32_t track_overruns;     /* Writes to a full |track_ring| */
+  uint64_t track_overrun_len;  /* Octets of PCM dropped by the overruns */
+  uint32_t track_underrun_frames; /* Underruns reported by the audio track */
+  uint32_t track_writes;
+  uint64_t track_write_us_total;
+  uint64_t track_write_us_max; /* Time the audio track blocked a write */
+  size_t track_ring_size;
+  size_t track_ring_peak; /* Octets of PCM queued in |track_ring| */
+} tBTIF_A2DP_SINK_STATS;
+
 /* BTIF A2DP Sink control block */
 typedef struct {
   thread_t* worker_thread;
+  thread_t* decode_thread; /* Decodes |rx_audio_queue| into |pcm_queue| */
+  thread_t* track_thread;  /* Writes |track_ring| to |audio_track| */
   fixed_queue_t* cmd_msg_queue;
   fixed_queue_t* rx_audio_queue;
+  spsc_queue_t* pcm_queue; /* Filled by the decoder, drained by the timer */
+  tBTIF_A2DP_SINK_PCM* p_pcm; /* Packet of |pcm_queue| being played */
+  uint32_t late_frames; /* Frames to skip as not decoded in time */
   bool rx_flush; /* discards any incoming data when true */
   alarm_t* decode_alarm;
   uint8_t frames_to_process;
+  tA2DP_JITTER_BUFFER jitter_buffer; /* playout of |rx_audio_queue| */
+  const tA2DP_DECODER_INTERFACE* decoder_interface;
   tA2DP_SAMPLE_RATE sample_rate;
   tA2DP_CHANNEL_COUNT channel_count;
   btif_a2dp_sink_focus_state_t rx_focus_state; /* audio focus state */
   void* audio_track;
+  ringbuffer_t* track_ring; /* Filled by the timer, drained by |track_thread| */
+  tBTIF_A2DP_SINK_STATS stats;
 } tBTIF_A2DP_SINK_CB;
 
 static tBTIF_A2DP_SINK_CB btif_a2dp_sink_cb;
 
-static int btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
+// Guards |rx_audio_queue| and |jitter_buffer|: packets are enqueued from the
+// BTA context, decoded from the decode thread, and played from the worker
+// thread.
+static std::mutex btif_a2dp_sink_rx_mutex;
+
+// Guards |decoder_interface| against the decoder updates while decoding. It
+// is taken before |btif_a2dp_sink_rx_mutex| when both are needed.
+static std::mutex btif_a2dp_sink_decoder_mutex;
+
+// Incremented on each flush, so that the packets decoded before a flush are
+// not played after it.
+static std::atomic<uint32_t> btif_a2dp_sink_pcm_generation(0);
+
+// Set while a decoding request is posted to the decode thread.
+static std::atomic<bool> btif_a2dp_sink_decode_pending(false);
+
+// Guards |audio_track| and |track_ring| while the track thread writes them:
+// the worker thread takes it to replace or delete them.
+static std::mutex btif_a2dp_sink_track_mutex;
+
+// Set while a write request is posted to the track thread.
+static std::atomic<bool> btif_a2dp_sink_track_write_pending(false);
+
+// Set by the worker thread for the track thread to discard |track_ring|.
+static std::atomic<bool> btif_a2dp_sink_track_flush(false);
 
-static OI_CODEC_SBC_DECODER_CONTEXT btif_a2dp_sink_context;
-static uint32_t btif_a2dp_sink_context_data[CODEC_DATA_WORDS(
-    2, SBC_CODEC_FAST_FILTER_BUFFERS)];
-static int16_t
-    btif_a2dp_sink_pcm_data[15 * SBC_MAX_SAMPLES_PER_FRAME * SBC_MAX_CHANNELS];
+static int btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 
 static void btif_a2dp_sink_startup_delayed(void* context);
+static void btif_a2dp_sink_decoder_startup_delayed(void* context);
+static void btif_a2dp_sink_track_startup_delayed(void* context);
 static void btif_a2dp_sink_shutdown_delayed(void* context);
 static void btif_a2dp_sink_command_ready(fixed_queue_t* queue, void* context);
 static void btif_a2dp_sink_audio_handle_stop_decoding(void);
@@ -110,8 +172,18 @@ static void btif_decode_alarm_cb(void* context);
 static void btif_a2dp_sink_audio_handle_start_decoding(void);
 static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context);
 static void btif_a2dp_sink_audio_rx_flush_req(void);
-/* Handle incoming media packets A2DP SINK streaming */
-static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg);
+static void btif_a2dp_sink_rx_queue_flush(void);
+static void btif_a2dp_sink_pcm_flush(void);
+static void btif_a2dp_sink_decode_req(void);
+static void btif_a2dp_sink_decode_handler(void* context);
+static void btif_a2dp_sink_track_write_req(void);
+static void btif_a2dp_sink_track_write_handler(void* context);
+/* Decode incoming media packets A2DP SINK streaming */
+static void btif_a2dp_sink_handle_inc_media(
+    const tA2DP_DECODER_INTERFACE* decoder_interface, tBT_SBC_HDR* p_msg,
+    uint32_t generation);
+static void btif_a2dp_sink_play_frames(uint16_t num_frames,
+                                       tA2DP_JITTER_ACTION action);
 static void btif_a2dp_sink_decoder_update_event(
     tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf);
 static void btif_a2dp_sink_clear_track_event(void);
@@ -151,9 +223,36 @@ bool btif_a2dp_sink_startup(void) {
     return false;
   }
 
+  /* Start the decoder task, so that decoding never delays the playout */
+  btif_a2dp_sink_cb.decode_thread = thread_new("btif_a2dp_sink_decode_thread");
+  if (btif_a2dp_sink_cb.decode_thread == NULL) {
+    APPL_TRACE_ERROR("%s: unable to start up decode thread", __func__);
+    thread_free(btif_a2dp_sink_cb.worker_thread);
+    btif_a2dp_sink_cb.worker_thread = NULL;
+    btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
+    return false;
+  }
+
+  /* Start the audio track task, so that a blocking write never delays the
+   * playout */
+  btif_a2dp_sink_cb.track_thread = thread_new("btif_a2dp_sink_track_thread");
+  if (btif_a2dp_sink_cb.track_thread == NULL) {
+    APPL_TRACE_ERROR("%s: unable to start up audio track thread", __func__);
+    thread_free(btif_a2dp_sink_cb.decode_thread);
+    btif_a2dp_sink_cb.decode_thread = NULL;
+    thread_free(btif_a2dp_sink_cb.worker_thread);
+    btif_a2dp_sink_cb.worker_thread = NULL;
+    btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
+    return false;
+  }
+
   btif_a2dp_sink_cb.rx_focus_state = BTIF_A2DP_SINK_FOCUS_NOT_GRANTED;
   btif_a2dp_sink_cb.audio_track = NULL;
   btif_a2dp_sink_cb.rx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_sink_cb.pcm_queue = spsc_queue_new(BTIF_A2DP_SINK_PCM_QUEUE_SZ);
+  btif_a2dp_sink_decode_pending = false;
+  btif_a2dp_sink_track_write_pending = false;
+  btif_a2dp_sink_track_flush = false;
 
   btif_a2dp_sink_cb.cmd_msg_queue = fixed_queue_new(SIZE_MAX);
   fixed_queue_register_dequeue(
@@ -166,6 +265,10 @@ bool btif_a2dp_sink_startup(void) {
   /* Schedule the rest of the startup operations */
   thread_post(btif_a2dp_sink_cb.worker_thread, btif_a2dp_sink_startup_delayed,
               NULL);
+  thread_post(btif_a2dp_sink_cb.decode_thread,
+              btif_a2dp_sink_decoder_startup_delayed, NULL);
+  thread_post(btif_a2dp_sink_cb.track_thread,
+              btif_a2dp_sink_track_startup_delayed, NULL);
 
   return true;
 }
@@ -175,6 +278,14 @@ static void btif_a2dp_sink_startup_delayed(UNUSED_ATTR void* context) {
   btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_RUNNING;
 }
 
+static void btif_a2dp_sink_decoder_startup_delayed(UNUSED_ATTR void* context) {
+  raise_priority_a2dp(TASK_HIGH_MEDIA_DECODER);
+}
+
+static void btif_a2dp_sink_track_startup_delayed(UNUSED_ATTR void* context) {
+  raise_priority_a2dp(TASK_HIGH_MEDIA_TRACK);
+}
+
 void btif_a2dp_sink_shutdown(void) {
   if ((btif_a2dp_sink_state == BTIF_A2DP_SINK_STATE_OFF) ||
       (btif_a2dp_sink_state == BTIF_A2DP_SINK_STATE_SHUTTING_DOWN)) {
@@ -190,6 +301,14 @@ void btif_a2dp_sink_shutdown(void) {
   alarm_free(btif_a2dp_sink_cb.decode_alarm);
   btif_a2dp_sink_cb.decode_alarm = NULL;
 
+  // Exit the decoder thread first, as it fills the PCM queue
+  thread_free(btif_a2dp_sink_cb.decode_thread);
+  btif_a2dp_sink_cb.decode_thread = NULL;
+
+  // Then the audio track thread, as it drains the PCM ring
+  thread_free(btif_a2dp_sink_cb.track_thread);
+  btif_a2dp_sink_cb.track_thread = NULL;
+
   // Exit the thread
   fixed_queue_free(btif_a2dp_sink_cb.cmd_msg_queue, NULL);
   btif_a2dp_sink_cb.cmd_msg_queue = NULL;
@@ -200,8 +319,18 @@ void btif_a2dp_sink_shutdown(void) {
 }
 
 static void btif_a2dp_sink_shutdown_delayed(UNUSED_ATTR void* context) {
+  if (btif_a2dp_sink_cb.decoder_interface != NULL)
+    btif_a2dp_sink_cb.decoder_interface->decoder_cleanup();
+  btif_a2dp_sink_cb.decoder_interface = NULL;
+
   fixed_queue_free(btif_a2dp_sink_cb.rx_audio_queue, NULL);
   btif_a2dp_sink_cb.rx_audio_queue = NULL;
+  osi_free(btif_a2dp_sink_cb.p_pcm);
+  btif_a2dp_sink_cb.p_pcm = NULL;
+  spsc_queue_free(btif_a2dp_sink_cb.pcm_queue, osi_free);
+  btif_a2dp_sink_cb.pcm_queue = NULL;
+  ringbuffer_free(btif_a2dp_sink_cb.track_ring);
+  btif_a2dp_sink_cb.track_ring = NULL;
 
   btif_a2dp_sink_state = BTIF_A2DP_SINK_STATE_OFF;
 }
@@ -303,8 +432,12 @@ static void btif_decode_alarm_cb(UNUSED_ATTR void* context) {
 static void btif_a2dp_sink_clear_track_event(void) {
   APPL_TRACE_DEBUG("%s", __func__);
 
+  /* Stopping the track returns a write blocked on it */
 #ifndef OS_GENERIC
   BtifAvrcpAudioTrackStop(btif_a2dp_sink_cb.audio_track);
+#endif
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_mutex);
+#ifndef OS_GENERIC
   BtifAvrcpAudioTrackDelete(btif_a2dp_sink_cb.audio_track);
 #endif
   btif_a2dp_sink_cb.audio_track = NULL;
@@ -327,16 +460,46 @@ static void btif_a2dp_sink_audio_handle_start_decoding(void) {
             btif_decode_alarm_cb, NULL);
 }
 
-static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg) {
-  uint8_t* sbc_start_frame = ((uint8_t*)(p_msg + 1) + p_msg->offset + 1);
-  int count;
-  uint32_t pcmBytes, availPcmBytes;
-  int16_t* pcmDataPointer =
-      btif_a2dp_sink_pcm_data; /* Will be overwritten on next packet receipt */
-  OI_STATUS status;
-  int num_sbc_frames = p_msg->num_frames_to_be_processed;
-  uint32_t sbc_frame_len = p_msg->len - 1;
-  availPcmBytes = sizeof(btif_a2dp_sink_pcm_data);
+static void btif_a2dp_sink_decode_req(void) {
+  if (btif_a2dp_sink_decode_pending.exchange(true))
+    return;  // Already requested
+
+  if (btif_a2dp_sink_cb.decode_thread != NULL) {
+    thread_post(btif_a2dp_sink_cb.decode_thread,
+                btif_a2dp_sink_decode_handler, NULL);
+  }
+}
+
+static void btif_a2dp_sink_decode_handler(UNUSED_ATTR void* context) {
+  btif_a2dp_sink_decode_pending = false;
+
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_decoder_mutex);
+  const tA2DP_DECODER_INTERFACE* decoder_interface =
+      btif_a2dp_sink_cb.decoder_interface;
+  if (decoder_interface == NULL) return;
+
+  /* Decode ahead of the playout, as much as |pcm_queue| holds */
+  while (spsc_queue_length(btif_a2dp_sink_cb.pcm_queue) <
+         spsc_queue_capacity(btif_a2dp_sink_cb.pcm_queue)) {
+    tBT_SBC_HDR* p_msg;
+    uint32_t generation;
+    {
+      std::lock_guard<std::mutex> rx_lock(btif_a2dp_sink_rx_mutex);
+      p_msg = (tBT_SBC_HDR*)fixed_queue_try_dequeue(
+          btif_a2dp_sink_cb.rx_audio_queue);
+      generation = btif_a2dp_sink_pcm_generation;
+    }
+    if (p_msg == NULL) break;
+    btif_a2dp_sink_handle_inc_media(decoder_interface, p_msg, generation);
+    osi_free(p_msg);
+  }
+}
+
+static void btif_a2dp_sink_handle_inc_media(
+    const tA2DP_DECODER_INTERFACE* decoder_interface, tBT_SBC_HDR* p_msg,
+    uint32_t generation) {
+  uint8_t* p_frames = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint16_t num_frames = p_msg->num_frames_to_be_processed;
 
   if ((btif_av_get_peer_sep() == AVDT_TSEP_SNK) ||
       (btif_a2dp_sink_cb.rx_flush)) {
@@ -344,41 +507,198 @@ static void btif_a2dp_sink_handle_inc_media(tBT_SBC_HDR* p_msg) {
     return;
   }
 
-  APPL_TRACE_DEBUG("%s Number of SBC frames %d, frame_len %d", __func__,
-                   num_sbc_frames, sbc_frame_len);
+  uint32_t frame_len = decoder_interface->get_frame_samples() *
+                       btif_a2dp_sink_cb.channel_count * sizeof(int16_t);
+  if (num_frames == 0 || frame_len == 0) return;
+
+  APPL_TRACE_DEBUG("%s Number of frames %d, frames_len %d", __func__,
+                   num_frames, p_msg->len);
+
+  /* The frames that fail to decode are played as silence, so that the
+   * playout stays in step with the jitter buffer */
+  uint32_t pcm_len = num_frames * frame_len;
+  tBTIF_A2DP_SINK_PCM* p_pcm = reinterpret_cast<tBTIF_A2DP_SINK_PCM*>(
+      osi_calloc(sizeof(tBTIF_A2DP_SINK_PCM) + pcm_len));
+  p_pcm->generation = generation;
+  p_pcm->num_frames = num_frames;
+  p_pcm->frame_len = frame_len;
+
+  uint64_t start_us = time_get_os_boottime_us();
+  uint16_t decoded_frames = decoder_interface->decode_frames(
+      p_frames, p_msg->len, num_frames, (int16_t*)(p_pcm + 1), &pcm_len);
+  uint64_t decode_us = time_get_os_boottime_us() - start_us;
+  if (decoded_frames < num_frames) {
+    APPL_TRACE_ERROR("%s: Decoding failure: %d of %d frames decoded", __func__,
+                     decoded_frames, num_frames);
+  }
 
-  for (count = 0; count < num_sbc_frames && sbc_frame_len != 0; count++) {
-    pcmBytes = availPcmBytes;
-    status = OI_CODEC_SBC_DecodeFrame(
-        &btif_a2dp_sink_context, (const OI_BYTE**)&sbc_start_frame,
-        (uint32_t*)&sbc_frame_len, (int16_t*)pcmDataPointer,
-        (uint32_t*)&pcmBytes);
-    if (!OI_SUCCESS(status)) {
-      APPL_TRACE_ERROR("%s: Decoding failure: %d", __func__, status);
-      break;
+  tBTIF_A2DP_SINK_STATS* stats = &btif_a2dp_sink_cb.stats;
+  stats->decoded_frames += decoded_frames;
+  stats->decode_error_frames += num_frames - decoded_frames;
+  stats->decoded_packets++;
+  stats->decode_us_total += decode_us;
+  if (decode_us > stats->decode_us_max) stats->decode_us_max = decode_us;
+
+  if (!spsc_queue_try_enqueue(btif_a2dp_sink_cb.pcm_queue, p_pcm))
+    osi_free(p_pcm);
+}
+
+/* Returns the packet of |pcm_queue| to play from, if any */
+static tBTIF_A2DP_SINK_PCM* btif_a2dp_sink_pcm_current(void) {
+  tBTIF_A2DP_SINK_PCM* p_pcm = btif_a2dp_sink_cb.p_pcm;
+  if (p_pcm != NULL && p_pcm->played_frames < p_pcm->num_frames) return p_pcm;
+
+  osi_free(p_pcm);
+  btif_a2dp_sink_cb.p_pcm = NULL;
+  while ((p_pcm = (tBTIF_A2DP_SINK_PCM*)spsc_queue_try_dequeue(
+              btif_a2dp_sink_cb.pcm_queue)) != NULL) {
+    if (p_pcm->generation == btif_a2dp_sink_pcm_generation) {
+      btif_a2dp_sink_cb.p_pcm = p_pcm;
+      return p_pcm;
+    }
+    osi_free(p_pcm); /* Decoded before the last flush */
+  }
+  return NULL;
+}
+
+/* Queues |len| octets of PCM at |p_data| for the track thread to write them
+ * to the audio track. The PCM that does not fit in |track_ring| is dropped. */
+static void btif_a2dp_sink_track_write(const uint8_t* p_data, size_t len) {
+  tBTIF_A2DP_SINK_STATS* stats = &btif_a2dp_sink_cb.stats;
+
+  /* The audio HAL input stream takes the PCM instead of the audio track
+   * when it opened a ring for it */
+  uint32_t written_input;
+  if (btif_a2dp_control_write_sink_audio(p_data, len, &written_input)) {
+    if (written_input < len) {
+      stats->track_overruns++;
+      stats->track_overrun_len += len - written_input;
     }
-    availPcmBytes -= pcmBytes;
-    pcmDataPointer += pcmBytes / 2;
-    p_msg->offset += (p_msg->len - 1) - sbc_frame_len;
-    p_msg->len = sbc_frame_len + 1;
+    return;
   }
 
+  ringbuffer_t* track_ring = btif_a2dp_sink_cb.track_ring;
+  if (track_ring == NULL) return;
+
+  size_t written = ringbuffer_insert(track_ring, p_data, len);
+  if (written < len) {
+    stats->track_overruns++;
+    stats->track_overrun_len += len - written;
+  }
+  size_t queued = ringbuffer_size(track_ring);
+  if (queued > stats->track_ring_peak) stats->track_ring_peak = queued;
+}
+
+static void btif_a2dp_sink_track_write_req(void) {
+  if (btif_a2dp_sink_track_write_pending.exchange(true))
+    return;  // Already requested
+
+  if (btif_a2dp_sink_cb.track_thread != NULL) {
+    thread_post(btif_a2dp_sink_cb.track_thread,
+                btif_a2dp_sink_track_write_handler, NULL);
+  }
+}
+
+/* Writes |track_ring| to the audio track, from the track thread */
+static void btif_a2dp_sink_track_write_handler(UNUSED_ATTR void* context) {
+  btif_a2dp_sink_track_write_pending = false;
+
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_mutex);
+  ringbuffer_t* track_ring = btif_a2dp_sink_cb.track_ring;
+  if (track_ring == NULL) return;
+
+  tBTIF_A2DP_SINK_STATS* stats = &btif_a2dp_sink_cb.stats;
+  while (true) {
+    /* The PCM queued right after a flush may be discarded too: the playout
+     * only resumes once the jitter buffer is filled again */
+    if (btif_a2dp_sink_track_flush.exchange(false))
+      ringbuffer_delete(track_ring, ringbuffer_size(track_ring));
+
+    const uint8_t* p_data;
+    size_t len = ringbuffer_peek_contiguous(track_ring, &p_data);
+    if (len == 0) break;
+
+    void* audio_track = btif_a2dp_sink_cb.audio_track;
+    if (audio_track != NULL) {
+      uint64_t start_us = time_get_os_boottime_us();
 #ifndef OS_GENERIC
-  BtifAvrcpAudioTrackWriteData(
-      btif_a2dp_sink_cb.audio_track, (void*)btif_a2dp_sink_pcm_data,
-      (sizeof(btif_a2dp_sink_pcm_data) - availPcmBytes));
+      BtifAvrcpAudioTrackWriteData(audio_track, (void*)p_data, len);
+      stats->track_underrun_frames =
+          BtifAvrcpAudioTrackGetUnderrunFrames(audio_track);
 #endif
+      uint64_t write_us = time_get_os_boottime_us() - start_us;
+      stats->track_writes++;
+      stats->track_write_us_total += write_us;
+      if (write_us > stats->track_write_us_max)
+        stats->track_write_us_max = write_us;
+    }
+    ringbuffer_release(track_ring, len);
+  }
 }
 
-static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
-  tBT_SBC_HDR* p_msg;
-  int num_sbc_frames;
-  int num_frames_to_process;
+/* Consumes up to |num_frames| frames of |pcm_queue|, writing them to the
+ * audio track if |write| is true. Returns the number of frames consumed. */
+static uint32_t btif_a2dp_sink_pcm_consume(uint32_t num_frames, bool write) {
+  uint32_t consumed = 0;
+
+  while (consumed < num_frames) {
+    tBTIF_A2DP_SINK_PCM* p_pcm = btif_a2dp_sink_pcm_current();
+    if (p_pcm == NULL) break;
+    uint32_t count = p_pcm->num_frames - p_pcm->played_frames;
+    if (count > num_frames - consumed) count = num_frames - consumed;
+    if (write) {
+      uint8_t* p_data =
+          (uint8_t*)(p_pcm + 1) + p_pcm->played_frames * p_pcm->frame_len;
+      btif_a2dp_sink_track_write(p_data, count * p_pcm->frame_len);
+    }
+    p_pcm->played_frames += count;
+    consumed += count;
+  }
 
-  if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
-    APPL_TRACE_DEBUG("%s: empty queue", __func__);
-    return;
+  return consumed;
+}
+
+static void btif_a2dp_sink_play_frames(uint16_t num_frames,
+                                       tA2DP_JITTER_ACTION action) {
+  /* The jitter buffer already played the frames the decoder was late for:
+   * skip them, so that they do not add to the playout delay */
+  btif_a2dp_sink_cb.late_frames -=
+      btif_a2dp_sink_pcm_consume(btif_a2dp_sink_cb.late_frames, false);
+
+  uint32_t played_frames = 0;
+  if (btif_a2dp_sink_cb.late_frames == 0) {
+    switch (action) {
+      case A2DP_JITTER_ACTION_DROP:
+        /* Skip the first frame to reduce the playout delay */
+        played_frames = btif_a2dp_sink_pcm_consume(1, false);
+        break;
+      case A2DP_JITTER_ACTION_REPEAT: {
+        /* Play the first frame twice to increase the playout delay */
+        tBTIF_A2DP_SINK_PCM* p_pcm = btif_a2dp_sink_pcm_current();
+        if (p_pcm == NULL) break;
+        uint8_t* p_data =
+            (uint8_t*)(p_pcm + 1) + p_pcm->played_frames * p_pcm->frame_len;
+        btif_a2dp_sink_track_write(p_data, p_pcm->frame_len);
+        break;
+      }
+      case A2DP_JITTER_ACTION_NONE:
+        break;
+    }
+    played_frames +=
+        btif_a2dp_sink_pcm_consume(num_frames - played_frames, true);
+  }
+
+  if (played_frames < num_frames) {
+    APPL_TRACE_DEBUG("%s: %d frames not decoded in time", __func__,
+                     num_frames - played_frames);
+    btif_a2dp_sink_cb.late_frames += num_frames - played_frames;
+    btif_a2dp_sink_cb.stats.late_frames += num_frames - played_frames;
   }
+}
+
+static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
+  uint32_t num_frames_to_process;
+  tA2DP_JITTER_ACTION jitter_action;
 
   /* Don't do anything in case of focus not granted */
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
@@ -388,48 +708,34 @@ static void btif_a2dp_sink_avk_handle_timer(UNUSED_ATTR void* context) {
   }
   /* Play only in BTIF_A2DP_SINK_FOCUS_GRANTED case */
   if (btif_a2dp_sink_cb.rx_flush) {
-    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_rx_queue_flush();
     return;
   }
 
-  num_frames_to_process = btif_a2dp_sink_cb.frames_to_process;
-  APPL_TRACE_DEBUG(" Process Frames + ");
-
-  do {
-    p_msg = (tBT_SBC_HDR*)fixed_queue_try_peek_first(
-        btif_a2dp_sink_cb.rx_audio_queue);
-    if (p_msg == NULL) return;
-    /* Number of frames in queue packets */
-    num_sbc_frames = p_msg->num_frames_to_be_processed;
-    APPL_TRACE_DEBUG("Frames left in topmost packet %d", num_sbc_frames);
-    APPL_TRACE_DEBUG("Remaining frames to process in tick %d",
-                     num_frames_to_process);
-    APPL_TRACE_DEBUG("Number of packets in queue %d",
-                     fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue));
-
-    if (num_sbc_frames > num_frames_to_process) {
-      /* Queue packet has more frames */
-      p_msg->num_frames_to_be_processed = num_frames_to_process;
-      btif_a2dp_sink_handle_inc_media(p_msg);
-      p_msg->num_frames_to_be_processed =
-          num_sbc_frames - num_frames_to_process;
-      num_frames_to_process = 0;
-      break;
+  {
+    std::lock_guard<std::mutex> lock(btif_a2dp_sink_rx_mutex);
+    num_frames_to_process = a2dp_jitter_buffer_tick(
+        &btif_a2dp_sink_cb.jitter_buffer, &jitter_action);
+    if (num_frames_to_process == 0) {
+      APPL_TRACE_DEBUG("%s: buffering %llu ms of %llu ms", __func__,
+                       (unsigned long long)a2dp_jitter_buffer_get_queued_us(
+                           &btif_a2dp_sink_cb.jitter_buffer) /
+                           1000,
+                       (unsigned long long)
+                               btif_a2dp_sink_cb.jitter_buffer.target_us /
+                           1000);
+      return;
     }
-    /* Queue packet has less frames */
-    btif_a2dp_sink_handle_inc_media(p_msg);
-    p_msg =
-        (tBT_SBC_HDR*)fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue);
-    if (p_msg == NULL) {
-      APPL_TRACE_ERROR("Insufficient data in queue");
-      break;
-    }
-    num_frames_to_process =
-        num_frames_to_process - p_msg->num_frames_to_be_processed;
-    osi_free(p_msg);
-  } while (num_frames_to_process > 0);
+  }
 
+  /* The audio track may block: play without holding the lock */
+  APPL_TRACE_DEBUG(" Process Frames + ");
+  btif_a2dp_sink_play_frames(num_frames_to_process, jitter_action);
+  btif_a2dp_sink_track_write_req();
   APPL_TRACE_DEBUG("Process Frames - ");
+
+  /* Make room for the next tick */
+  btif_a2dp_sink_decode_req();
 }
 
 /* when true media task discards any rx frames */
@@ -442,13 +748,29 @@ static void btif_a2dp_sink_audio_rx_flush_event(void) {
   /* Flush all received SBC buffers (encoded) */
   APPL_TRACE_DEBUG("%s", __func__);
 
+  btif_a2dp_sink_rx_queue_flush();
+}
+
+static void btif_a2dp_sink_rx_queue_flush(void) {
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_rx_mutex);
   fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  btif_a2dp_sink_pcm_flush();
+  a2dp_jitter_buffer_flush(&btif_a2dp_sink_cb.jitter_buffer);
+}
+
+/* Must be called from the worker thread, with |btif_a2dp_sink_rx_mutex| */
+static void btif_a2dp_sink_pcm_flush(void) {
+  /* The packets being decoded are also discarded once decoded */
+  btif_a2dp_sink_pcm_generation++;
+  osi_free(btif_a2dp_sink_cb.p_pcm);
+  btif_a2dp_sink_cb.p_pcm = NULL;
+  spsc_queue_flush(btif_a2dp_sink_cb.pcm_queue, osi_free);
+  btif_a2dp_sink_cb.late_frames = 0;
+  btif_a2dp_sink_track_flush = true;
 }
 
 static void btif_a2dp_sink_decoder_update_event(
     tBTIF_MEDIA_SINK_DECODER_UPDATE* p_buf) {
-  OI_STATUS status;
-
   APPL_TRACE_DEBUG("%s: p_codec_info[%x:%x:%x:%x:%x:%x]", __func__,
                    p_buf->codec_info[1], p_buf->codec_info[2],
                    p_buf->codec_info[3], p_buf->codec_info[4],
@@ -469,26 +791,55 @@ static void btif_a2dp_sink_decoder_update_event(
     APPL_TRACE_ERROR("%s: cannot get the Sink channel type", __func__);
     return;
   }
-  btif_a2dp_sink_cb.sample_rate = sample_rate;
-  btif_a2dp_sink_cb.channel_count = channel_count;
+  const tA2DP_DECODER_INTERFACE* decoder_interface =
+      A2DP_GetDecoderInterface(p_buf->codec_info);
+  if (decoder_interface == NULL) {
+    APPL_TRACE_ERROR("%s: cannot get the decoder interface", __func__);
+    return;
+  }
+
+  size_t samples_per_frame;
+  {
+    /* Drop the packets of the previous codec before changing the decoder */
+    std::lock_guard<std::mutex> lock(btif_a2dp_sink_decoder_mutex);
+    std::lock_guard<std::mutex> rx_lock(btif_a2dp_sink_rx_mutex);
+    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_pcm_flush();
 
-  btif_a2dp_sink_cb.rx_flush = false;
-  APPL_TRACE_DEBUG("%s: Reset to Sink role", __func__);
-  status = OI_CODEC_SBC_DecoderReset(
-      &btif_a2dp_sink_context, btif_a2dp_sink_context_data,
-      sizeof(btif_a2dp_sink_context_data), 2, 2, false);
-  if (!OI_SUCCESS(status)) {
-    APPL_TRACE_ERROR("%s: OI_CODEC_SBC_DecoderReset failed with error code %d",
-                     __func__, status);
+    if (btif_a2dp_sink_cb.decoder_interface != NULL)
+      btif_a2dp_sink_cb.decoder_interface->decoder_cleanup();
+    btif_a2dp_sink_cb.decoder_interface = NULL;
+    btif_a2dp_sink_cb.sample_rate = sample_rate;
+    btif_a2dp_sink_cb.channel_count = channel_count;
+
+    btif_a2dp_sink_cb.rx_flush = false;
+    APPL_TRACE_DEBUG("%s: Reset to Sink role", __func__);
+    if (!decoder_interface->decoder_init(p_buf->codec_info)) {
+      APPL_TRACE_ERROR("%s: cannot initialize the decoder", __func__);
+      return;
+    }
+    btif_a2dp_sink_cb.decoder_interface = decoder_interface;
+    samples_per_frame = decoder_interface->get_frame_samples();
   }
 
-  APPL_TRACE_DEBUG("%s: A2dpSink: SBC create track", __func__);
-  btif_a2dp_sink_cb.audio_track =
+  APPL_TRACE_DEBUG("%s: A2dpSink: create track", __func__);
+  void* audio_track =
 #ifndef OS_GENERIC
       BtifAvrcpAudioTrackCreate(sample_rate, channel_type);
 #else
       NULL;
 #endif
+  {
+    /* Replaced once the track thread is done writing the previous ones */
+    std::lock_guard<std::mutex> lock(btif_a2dp_sink_track_mutex);
+    btif_a2dp_sink_cb.audio_track = audio_track;
+    ringbuffer_free(btif_a2dp_sink_cb.track_ring);
+    size_t ring_size = (size_t)sample_rate * channel_count * sizeof(int16_t) *
+                       BTIF_A2DP_SINK_TRACK_RING_MS / 1000;
+    btif_a2dp_sink_cb.track_ring = ringbuffer_init(ring_size);
+    btif_a2dp_sink_cb.stats.track_ring_size = ring_size;
+    btif_a2dp_sink_track_flush = false;
+  }
   if (btif_a2dp_sink_cb.audio_track == NULL) {
     APPL_TRACE_ERROR("%s: A2dpSink: Track creation failed", __func__);
     return;
@@ -502,55 +853,144 @@ static void btif_a2dp_sink_decoder_update_event(
     APPL_TRACE_ERROR("%s: Cannot compute the number of frames to process",
                      __func__);
   }
+
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_rx_mutex);
+  fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+  btif_a2dp_sink_pcm_flush();
+  a2dp_jitter_buffer_init(&btif_a2dp_sink_cb.jitter_buffer, sample_rate,
+                          samples_per_frame,
+                          btif_a2dp_sink_cb.frames_to_process);
 }
 
-uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt) {
+uint8_t btif_a2dp_sink_enqueue_buf(BT_HDR* p_pkt, uint32_t timestamp) {
   if (btif_a2dp_sink_cb.rx_flush) /* Flush enabled, do not enqueue */
     return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
 
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_INPUT_A2DP_FRAME_QUEUE_SZ) {
-    uint8_t ret = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
-    osi_free(fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue));
-    return ret;
-  }
-
+  FLOW_TRACE_END(FLOW_TRACE_BTIF, p_pkt, "BTIF A2DP sink rx");
   BTIF_TRACE_VERBOSE("%s +", __func__);
-  /* Allocate and queue this buffer */
+  std::unique_lock<std::mutex> lock(btif_a2dp_sink_rx_mutex);
+  const tA2DP_DECODER_INTERFACE* decoder_interface =
+      btif_a2dp_sink_cb.decoder_interface;
+  if (decoder_interface == NULL)
+    return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+
+  /* Reassemble the frames, which may be fragmented over several packets */
+  const uint8_t* p_frames;
+  uint16_t frames_len;
+  uint16_t num_frames = decoder_interface->assemble_frames(
+      (uint8_t*)(p_pkt + 1) + p_pkt->offset, p_pkt->len, &p_frames,
+      &frames_len);
+  if (num_frames == 0)
+    return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+
+  /* Allocate and queue the frames */
   tBT_SBC_HDR* p_msg = reinterpret_cast<tBT_SBC_HDR*>(
-      osi_malloc(sizeof(tBT_SBC_HDR) + p_pkt->offset + p_pkt->len));
-  memcpy((uint8_t*)(p_msg + 1), (uint8_t*)(p_pkt + 1) + p_pkt->offset,
-         p_pkt->len);
-  p_msg->num_frames_to_be_processed =
-      (*((uint8_t*)(p_pkt + 1) + p_pkt->offset)) & 0x0f;
-  p_msg->len = p_pkt->len;
+      osi_malloc(sizeof(tBT_SBC_HDR) + frames_len));
+  memcpy((uint8_t*)(p_msg + 1), p_frames, frames_len);
+  p_msg->num_frames_to_be_processed = num_frames;
+  p_msg->len = frames_len;
   p_msg->offset = 0;
   p_msg->layer_specific = p_pkt->layer_specific;
   BTIF_TRACE_VERBOSE("%s: frames to process %d, len %d", __func__,
                      p_msg->num_frames_to_be_processed, p_msg->len);
+
+  tA2DP_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+  a2dp_jitter_buffer_on_packet(p_jb, time_get_os_boottime_us(), timestamp,
+                               p_msg->num_frames_to_be_processed);
+
+  /* Drop the oldest buffers if far more than the target delay is queued */
+  while (a2dp_jitter_buffer_is_overflow(p_jb)) {
+    tBT_SBC_HDR* p_old =
+        (tBT_SBC_HDR*)fixed_queue_try_dequeue(btif_a2dp_sink_cb.rx_audio_queue);
+    if (p_old == NULL) break;
+    a2dp_jitter_buffer_on_overflow(p_jb, p_old->num_frames_to_be_processed);
+    osi_free(p_old);
+  }
   fixed_queue_enqueue(btif_a2dp_sink_cb.rx_audio_queue, p_msg);
-  if (fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue) ==
-      MAX_A2DP_DELAYED_START_FRAME_COUNT) {
+
+  /* Start decoding once the target delay is queued */
+  if (btif_a2dp_sink_cb.decode_alarm == NULL &&
+      a2dp_jitter_buffer_get_queued_us(p_jb) >= p_jb->target_us) {
     BTIF_TRACE_DEBUG("%s: Initiate decoding", __func__);
     btif_a2dp_sink_audio_handle_start_decoding();
   }
 
-  return fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+  uint8_t length = fixed_queue_length(btif_a2dp_sink_cb.rx_audio_queue);
+  lock.unlock();
+
+  btif_a2dp_sink_decode_req();
+  return length;
 }
 
 void btif_a2dp_sink_audio_rx_flush_req(void) {
-  if (fixed_queue_is_empty(btif_a2dp_sink_cb.rx_audio_queue)) {
-    /* Queue is already empty */
-    return;
-  }
-
+  /* The decoded frames are only known to the worker thread: the flush is
+   * requested even if |rx_audio_queue| is empty */
   BT_HDR* p_buf = reinterpret_cast<BT_HDR*>(osi_malloc(sizeof(BT_HDR)));
   p_buf->event = BTIF_MEDIA_SINK_AUDIO_RX_FLUSH;
   fixed_queue_enqueue(btif_a2dp_sink_cb.cmd_msg_queue, p_buf);
 }
 
-void btif_a2dp_sink_debug_dump(UNUSED_ATTR int fd) {
-  // Nothing to do
+void btif_a2dp_sink_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(btif_a2dp_sink_rx_mutex);
+  const tA2DP_JITTER_BUFFER* p_jb = &btif_a2dp_sink_cb.jitter_buffer;
+
+  dprintf(fd, "\nA2DP Sink State:\n");
+  dprintf(fd, "  Jitter buffer:\n");
+  dprintf(fd,
+          "  Playout delay in ms (queued/target)                     : %llu / "
+          "%llu\n",
+          (unsigned long long)a2dp_jitter_buffer_get_queued_us(p_jb) / 1000,
+          (unsigned long long)p_jb->target_us / 1000);
+  dprintf(fd,
+          "  Arrival jitter in ms (average/peak)                     : %llu / "
+          "%llu\n",
+          (unsigned long long)p_jb->jitter_us / 1000,
+          (unsigned long long)p_jb->peak_us / 1000);
+  dprintf(fd,
+          "  Frames (dropped/repeated/overflow)                      : %u / %u "
+          "/ %u\n",
+          p_jb->dropped_frames, p_jb->repeated_frames, p_jb->overflow_frames);
+  dprintf(fd,
+          "  Underruns                                               : %u\n",
+          p_jb->underruns);
+
+  const tBTIF_A2DP_SINK_STATS* stats = &btif_a2dp_sink_cb.stats;
+  dprintf(fd, "  Decoder:\n");
+  dprintf(fd,
+          "  Frames (decoded/errors/late)                            : %u / %u "
+          "/ %u\n",
+          stats->decoded_frames, stats->decode_error_frames,
+          stats->late_frames);
+  dprintf(fd,
+          "  Packet decoding time in us (average/max)                : %llu / "
+          "%llu\n",
+          (unsigned long long)((stats->decoded_packets > 0)
+                                   ? stats->decode_us_total /
+                                         stats->decoded_packets
+                                   : 0),
+          (unsigned long long)stats->decode_us_max);
+
+  dprintf(fd, "  Audio track:\n");
+  dprintf(fd,
+          "  PCM ring in octets (peak/size)                          : %zu / "
+          "%zu\n",
+          stats->track_ring_peak, stats->track_ring_size);
+  dprintf(fd,
+          "  Ring overruns (count/octets dropped)                    : %u / "
+          "%llu\n",
+          stats->track_overruns,
+          (unsigned long long)stats->track_overrun_len);
+  dprintf(fd,
+          "  Track underruns in frames                               : %u\n",
+          stats->track_underrun_frames);
+  dprintf(fd,
+          "  Track write time in us (average/max)                    : %llu / "
+          "%llu\n",
+          (unsigned long long)((stats->track_writes > 0)
+                                   ? stats->track_write_us_total /
+                                         stats->track_writes
+                                   : 0),
+          (unsigned long long)stats->track_write_us_max);
 }
 
 void btif_a2dp_sink_set_focus_state_req(btif_a2dp_sink_focus_state_t state) {
@@ -571,7 +1011,7 @@ static void btif_a2dp_sink_set_focus_state_event(
   APPL_TRACE_DEBUG("%s: setting focus state to %d", __func__, state);
   btif_a2dp_sink_cb.rx_focus_state = state;
   if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_NOT_GRANTED) {
-    fixed_queue_flush(btif_a2dp_sink_cb.rx_audio_queue, osi_free);
+    btif_a2dp_sink_rx_queue_flush();
     btif_a2dp_sink_cb.rx_flush = true;
   } else if (btif_a2dp_sink_cb.rx_focus_state == BTIF_A2DP_SINK_FOCUS_GRANTED) {
     btif_a2dp_sink_cb.rx_flush = false;
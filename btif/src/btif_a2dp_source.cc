@@ -21,8 +21,13 @@
 
 #include <base/logging.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "bt_common.h"
@@ -35,12 +40,19 @@
 #include "btif_av_co.h"
 #include "btif_util.h"
 #include "osi/include/fixed_queue.h"
+#include "osi/include/flow_trace.h"
+#include "osi/include/latency_histogram.h"
+#include "osi/include/link_timeline.h"
 #include "osi/include/log.h"
+#include "osi/include/media_clock.h"
 #include "osi/include/metrics.h"
 #include "osi/include/mutex.h"
 #include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/spsc_queue.h"
 #include "osi/include/thread.h"
 #include "osi/include/time.h"
+#include "osi/include/wakelock.h"
 #include "uipc.h"
 
 using system_bt_osi::BluetoothMetricsLogger;
@@ -53,6 +65,43 @@ using system_bt_osi::A2dpSessionMetrics;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 6)
 
+/**
+ * What to do when the tx queue is full - see
+ * tBTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY. The byte budget of the
+ * "byte_budget" policy defaults to a quarter of the tx queue filled with
+ * MTU-sized packets.
+ */
+#define BTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY_PROPERTY \
+  "persist.bluetooth.a2dp.tx_overflow_policy"
+#define BTIF_A2DP_SOURCE_TX_QUEUE_MAX_BYTES_PROPERTY \
+  "persist.bluetooth.a2dp.tx_queue_max_bytes"
+
+/**
+ * The age past which the frames at the head of the tx queue are dropped
+ * instead of sent, in ms. Late audio is dropped only with a deadline, which
+ * defaults to BTIF_A2DP_SOURCE_ULL_TX_QUEUE_DEADLINE_MS in the ultra-low
+ * latency mode and to none otherwise. A negative value disables it.
+ */
+#define BTIF_A2DP_SOURCE_TX_QUEUE_DEADLINE_PROPERTY \
+  "persist.bluetooth.a2dp.tx_queue_deadline_ms"
+#define BTIF_A2DP_SOURCE_ULL_TX_QUEUE_DEADLINE_MS 60
+
+/**
+ * The CPUs the encoder thread may run on, as a bit mask where bit N stands
+ * for CPU N (e.g. "0xf0"). The encoder thread is not pinned when unset.
+ */
+#define BTIF_A2DP_SOURCE_ENCODER_CPU_MASK_PROPERTY \
+  "persist.bluetooth.a2dp.encoder_cpu_mask"
+
+/* Minimum interval between RSSI reads triggered by tx queue overflows */
+#define BTIF_A2DP_SOURCE_OVERFLOW_RSSI_INTERVAL_US (1000 * 1000)
+
+/* Interval between the RSSI reads sampled in the link timeline */
+#define BTIF_A2DP_SOURCE_TIMELINE_RSSI_INTERVAL_US (5 * 1000 * 1000)
+
+/* Interval between the link signal reads for the encoders that use them */
+#define BTIF_A2DP_SOURCE_LINK_QUALITY_INTERVAL_US (1000 * 1000)
+
 enum {
   BTIF_A2DP_SOURCE_STATE_OFF,
   BTIF_A2DP_SOURCE_STATE_STARTING_UP,
@@ -60,6 +109,18 @@ enum {
   BTIF_A2DP_SOURCE_STATE_SHUTTING_DOWN
 };
 
+/* Tx queue overflow policy */
+typedef enum {
+  /* Flush the whole queue */
+  BTIF_A2DP_SOURCE_TX_OVERFLOW_FLUSH_ALL,
+  /* Drop the oldest encoded frames (with all their fragments) until the
+   * new packet fits */
+  BTIF_A2DP_SOURCE_TX_OVERFLOW_DROP_OLDEST,
+  /* Same as BTIF_A2DP_SOURCE_TX_OVERFLOW_DROP_OLDEST, and additionally cap
+   * the number of queued bytes */
+  BTIF_A2DP_SOURCE_TX_OVERFLOW_BYTE_BUDGET,
+} tBTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY;
+
 /* BTIF Media Source event definition */
 enum {
   BTIF_MEDIA_AUDIO_TX_START = 1,
@@ -142,21 +203,47 @@ typedef struct {
   size_t tx_queue_total_dropped_messages;
   size_t tx_queue_max_dropped_messages;
   size_t tx_queue_dropouts;
+  size_t tx_queue_total_dropped_bytes;
+  size_t tx_queue_total_dropped_frames;
   uint64_t tx_queue_last_dropouts_us;
 
+  // Dropped at the head of the queue past the deadline
+  size_t tx_queue_total_expired_messages;
+  size_t tx_queue_total_expired_frames;
+
   size_t media_read_total_underflow_bytes;
   size_t media_read_total_underflow_count;
   uint64_t media_read_last_underflow_us;
+
+  // Per-stage latency of the audio path
+  latency_histogram_t media_read_latency; /* Reading from the audio HAL */
+  latency_histogram_t encode_latency;     /* Media tick to tx queue */
+  latency_histogram_t tx_queue_latency;   /* Waiting in the tx queue */
+
+  // Encoder quality, RSSI and congestion over the session
+  link_timeline_t link_timeline;
+  uint64_t link_timeline_last_rssi_us; /* Time of the last RSSI read */
 } btif_media_stats_t;
 
 typedef struct {
-  thread_t* worker_thread;
+  thread_t* worker_thread;  /* Handles the commands */
+  thread_t* encoder_thread; /* Encodes the audio on each media clock tick */
   fixed_queue_t* cmd_msg_queue;
-  fixed_queue_t* tx_audio_queue;
+  spsc_queue_t* tx_audio_queue; /* Filled by the encoder, drained by BTA */
+  tBTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY tx_overflow_policy;
+  size_t tx_queue_max_bytes; /* Used by the byte budget overflow policy */
+  uint64_t tx_queue_deadline_us; /* Age of the late frames, 0 if none */
+  uint8_t codec_info[AVDT_CODEC_SIZE]; /* The codec of the tx audio queue */
   bool tx_flush; /* Discards any outgoing data when true */
-  alarm_t* media_alarm;
+  media_clock_t* media_clock; /* Drives the encoder on the encoder thread */
+  bool media_wakelock_held; /* The media wakelock is held for media_clock */
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
   period_ms_t encoder_interval_ms; /* Local copy of the encoder interval */
+  uint64_t media_tick_us; /* Time of the media clock tick being handled */
+  bool send_on_enqueue; /* Sends each packet as soon as it is enqueued */
+  uint64_t link_timeline_start_us; /* Time origin of the link timeline */
+  uint64_t link_quality_last_read_us; /* Time of the last link signal reads */
+  bool acl_high_tput; /* The ACL link is set for a high bitrate codec */
   btif_media_stats_t stats;
   btif_media_stats_t accumulated_stats;
 } tBTIF_A2DP_SOURCE_CB;
@@ -164,11 +251,41 @@ typedef struct {
 static tBTIF_A2DP_SOURCE_CB btif_a2dp_source_cb;
 static int btif_a2dp_source_state = BTIF_A2DP_SOURCE_STATE_OFF;
 
+/* Set when the link reported congestion since the last timer tick */
+static std::atomic<bool> tx_congested(false);
+/* Number of bytes in tx_audio_queue */
+static std::atomic<size_t> tx_queue_bytes(0);
+/* Serializes the readers of tx_audio_queue: BTA, the overflow drops and the
+ * flushes. Protects tx_in_frame and tx_frame_tail. */
+static std::mutex tx_read_mutex;
+/* Set when the last buffer read by BTA does not end its frame */
+static bool tx_in_frame = false;
+/* The rest of the frame being read by BTA, with the enqueue times, taken out
+ * of tx_audio_queue by an overflow drop. BTA reads it before the queue. */
+static std::deque<std::pair<BT_HDR*, uint64_t>> tx_frame_tail;
+/* Number of flushes of tx_audio_queue, for BTA to drop what it read ahead */
+static std::atomic<uint32_t> tx_flush_count(0);
+/* Waiting time of the oldest packet in tx_audio_queue on the last tick */
+static std::atomic<uint64_t> tx_queue_delay_us(0);
+/* Serializes the encoder between the commands and the media clock ticks */
+static std::mutex encoder_mutex;
+/* Protects the media clock pointer, read by the encoder thread on each tick
+ * and replaced by the worker thread */
+static std::mutex media_clock_mutex;
+/* The link signals read since the last timer tick, and their lock */
+static std::mutex link_quality_mutex;
+static tA2DP_LINK_QUALITY link_quality;
+static bool link_quality_updated = false;
+
 static void btif_a2dp_source_command_ready(fixed_queue_t* queue, void* context);
 static void btif_a2dp_source_startup_delayed(void* context);
+static void btif_a2dp_source_encoder_startup_delayed(void* context);
 static void btif_a2dp_source_shutdown_delayed(void* context);
 static void btif_a2dp_source_audio_tx_start_event(void);
 static void btif_a2dp_source_audio_tx_stop_event(void);
+static void btif_a2dp_source_update_media_wakelock(void);
+static bool btif_a2dp_source_media_clock_is_running(void);
+static void btif_a2dp_source_free_media_clock(void);
 static void btif_a2dp_source_audio_tx_flush_event(BT_HDR* p_msg);
 static void btif_a2dp_source_encoder_init_event(BT_HDR* p_msg);
 static void btif_a2dp_source_encoder_user_config_update_event(BT_HDR* p_msg);
@@ -177,14 +294,29 @@ static void btif_a2dp_source_encoder_init(void);
 static void btif_a2dp_source_encoder_init_req(
     tBTIF_A2DP_SOURCE_ENCODER_INIT* p_msg);
 static bool btif_a2dp_source_audio_tx_flush_req(void);
-static void btif_a2dp_source_alarm_cb(void* context);
-static void btif_a2dp_source_audio_handle_timer(void* context);
+static void btif_a2dp_source_audio_handle_timer(void* context,
+                                                uint64_t timestamp_us);
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len);
 static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n);
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us);
 static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
                                     uint64_t expected_delta);
 static void btm_read_rssi_cb(void* data);
+static void btif_a2dp_source_update_link_quality(uint64_t timestamp_us);
+static void btif_a2dp_source_link_rssi_cb(void* data);
+static void btif_a2dp_source_link_quality_cb(void* data);
+static void btif_a2dp_source_failed_contact_counter_cb(void* data);
+static void btif_a2dp_source_set_acl_high_tput(bool enable);
+static void btif_a2dp_source_update_link_timeline(uint64_t timestamp_us,
+                                                  bool is_congested);
+static void btif_a2dp_source_finish_link_timeline(void);
+static void btif_a2dp_source_free_tx_buf(void* p_data);
+static void btif_a2dp_source_drop_tx_buf(void* p_data);
+static size_t btif_a2dp_source_flush_tx_queue(spsc_queue_free_cb free_cb);
+static size_t btif_a2dp_source_drop_oldest_frame(void);
+static bool btif_a2dp_source_tx_queue_is_full(size_t frames_n, size_t len);
+static const char* dump_tx_overflow_policy(
+    tBTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY policy);
 
 UNUSED_ATTR static const char* dump_media_event(uint16_t event) {
   switch (event) {
@@ -236,7 +368,11 @@ void btif_a2dp_source_accumulate_stats(btif_media_stats_t* src,
   dst->tx_queue_max_dropped_messages = std::max(
       dst->tx_queue_max_dropped_messages, src->tx_queue_max_dropped_messages);
   dst->tx_queue_dropouts += src->tx_queue_dropouts;
+  dst->tx_queue_total_dropped_bytes += src->tx_queue_total_dropped_bytes;
+  dst->tx_queue_total_dropped_frames += src->tx_queue_total_dropped_frames;
   dst->tx_queue_last_dropouts_us = src->tx_queue_last_dropouts_us;
+  dst->tx_queue_total_expired_messages += src->tx_queue_total_expired_messages;
+  dst->tx_queue_total_expired_frames += src->tx_queue_total_expired_frames;
   dst->media_read_total_underflow_bytes +=
       src->media_read_total_underflow_bytes;
   dst->media_read_total_underflow_count +=
@@ -246,6 +382,10 @@ void btif_a2dp_source_accumulate_stats(btif_media_stats_t* src,
                                                &dst->tx_queue_enqueue_stats);
   btif_a2dp_source_accumulate_scheduling_stats(&src->tx_queue_dequeue_stats,
                                                &dst->tx_queue_dequeue_stats);
+  latency_histogram_merge(&src->media_read_latency, &dst->media_read_latency);
+  latency_histogram_merge(&src->encode_latency, &dst->encode_latency);
+  latency_histogram_merge(&src->tx_queue_latency, &dst->tx_queue_latency);
+  link_timeline_merge(&src->link_timeline, &dst->link_timeline);
   memset(src, 0, sizeof(btif_media_stats_t));
 }
 
@@ -269,7 +409,21 @@ bool btif_a2dp_source_startup(void) {
     return false;
   }
 
-  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  /* Start the encoder task, so that encoding never waits for a command */
+  btif_a2dp_source_cb.encoder_thread =
+      thread_new("btif_a2dp_source_encoder_thread");
+  if (btif_a2dp_source_cb.encoder_thread == NULL) {
+    APPL_TRACE_ERROR("%s: unable to start up encoder thread", __func__);
+    thread_free(btif_a2dp_source_cb.worker_thread);
+    btif_a2dp_source_cb.worker_thread = NULL;
+    btif_a2dp_source_state = BTIF_A2DP_SOURCE_STATE_OFF;
+    return false;
+  }
+
+  btif_a2dp_source_cb.tx_audio_queue =
+      spsc_queue_new(MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
+  tx_queue_bytes = 0;
+  btif_a2dp_source_flush_tx_queue(NULL);
 
   btif_a2dp_source_cb.cmd_msg_queue = fixed_queue_new(SIZE_MAX);
   fixed_queue_register_dequeue(
@@ -282,6 +436,8 @@ bool btif_a2dp_source_startup(void) {
   /* Schedule the rest of the startup operations */
   thread_post(btif_a2dp_source_cb.worker_thread,
               btif_a2dp_source_startup_delayed, NULL);
+  thread_post(btif_a2dp_source_cb.encoder_thread,
+              btif_a2dp_source_encoder_startup_delayed, NULL);
 
   return true;
 }
@@ -294,6 +450,22 @@ static void btif_a2dp_source_startup_delayed(UNUSED_ATTR void* context) {
       system_bt_osi::CONNECTION_TECHNOLOGY_TYPE_BREDR, 0);
 }
 
+static void btif_a2dp_source_encoder_startup_delayed(
+    UNUSED_ATTR void* context) {
+  raise_priority_a2dp(TASK_HIGH_MEDIA_ENCODER);
+
+  char value[PROPERTY_VALUE_MAX] = {'\0'};
+  if (osi_property_get(BTIF_A2DP_SOURCE_ENCODER_CPU_MASK_PROPERTY, value,
+                       "") > 0) {
+    uint64_t cpu_mask = strtoull(value, NULL, 0);
+    if (!thread_set_cpu_affinity(btif_a2dp_source_cb.encoder_thread,
+                                 cpu_mask)) {
+      LOG_WARN(LOG_TAG, "%s: invalid encoder CPU mask \"%s\"", __func__,
+               value);
+    }
+  }
+}
+
 void btif_a2dp_source_shutdown(void) {
   if ((btif_a2dp_source_state == BTIF_A2DP_SOURCE_STATE_OFF) ||
       (btif_a2dp_source_state == BTIF_A2DP_SOURCE_STATE_SHUTTING_DOWN)) {
@@ -306,8 +478,12 @@ void btif_a2dp_source_shutdown(void) {
   APPL_TRACE_EVENT("## A2DP SOURCE STOP MEDIA THREAD ##");
 
   // Stop the timer
-  alarm_free(btif_a2dp_source_cb.media_alarm);
-  btif_a2dp_source_cb.media_alarm = NULL;
+  btif_a2dp_source_free_media_clock();
+  btif_a2dp_source_update_media_wakelock();
+
+  // Exit the encoder thread first, as it fills the tx queue
+  thread_free(btif_a2dp_source_cb.encoder_thread);
+  btif_a2dp_source_cb.encoder_thread = NULL;
 
   // Exit the thread
   fixed_queue_free(btif_a2dp_source_cb.cmd_msg_queue, NULL);
@@ -320,8 +496,10 @@ void btif_a2dp_source_shutdown(void) {
 
 static void btif_a2dp_source_shutdown_delayed(UNUSED_ATTR void* context) {
   btif_a2dp_control_cleanup();
-  fixed_queue_free(btif_a2dp_source_cb.tx_audio_queue, NULL);
+  btif_a2dp_source_flush_tx_queue(btif_a2dp_source_free_tx_buf);
+  spsc_queue_free(btif_a2dp_source_cb.tx_audio_queue, NULL);
   btif_a2dp_source_cb.tx_audio_queue = NULL;
+  A2DP_CleanupEncoderPacketPool();
 
   btif_a2dp_source_state = BTIF_A2DP_SOURCE_STATE_OFF;
   BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionEnd(
@@ -337,7 +515,7 @@ bool btif_a2dp_source_media_task_is_shutting_down(void) {
 }
 
 bool btif_a2dp_source_is_streaming(void) {
-  return alarm_is_scheduled(btif_a2dp_source_cb.media_alarm);
+  return btif_a2dp_source_media_clock_is_running();
 }
 
 static void btif_a2dp_source_command_ready(fixed_queue_t* queue,
@@ -399,6 +577,9 @@ void btif_a2dp_source_start_audio_req(void) {
     btif_a2dp_source_cb.stats.session_start_us = 1;
   }
   btif_a2dp_source_cb.stats.session_end_us = 0;
+  btif_a2dp_source_cb.link_timeline_start_us =
+      btif_a2dp_source_cb.stats.session_start_us;
+  btif_a2dp_source_cb.link_quality_last_read_us = 0;
 }
 
 void btif_a2dp_source_stop_audio_req(void) {
@@ -455,6 +636,7 @@ static void btif_a2dp_source_encoder_init_event(BT_HDR* p_msg) {
 
   APPL_TRACE_DEBUG("%s", __func__);
 
+  std::lock_guard<std::mutex> lock(encoder_mutex);
   btif_a2dp_source_cb.encoder_interface = bta_av_co_get_encoder_interface();
   if (btif_a2dp_source_cb.encoder_interface == NULL) {
     APPL_TRACE_ERROR("%s: Cannot stream audio: no source encoder interface",
@@ -469,6 +651,35 @@ static void btif_a2dp_source_encoder_init_event(BT_HDR* p_msg) {
     return;
   }
 
+  A2DP_InitEncoderPacketPool(p_encoder_init->peer_params.peer_mtu,
+                             MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
+
+  // Setup the tx queue overflow policy
+  char value[PROPERTY_VALUE_MAX] = {'\0'};
+  osi_property_get(BTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY_PROPERTY, value,
+                   "drop_oldest");
+  if (strcmp(value, "flush_all") == 0) {
+    btif_a2dp_source_cb.tx_overflow_policy =
+        BTIF_A2DP_SOURCE_TX_OVERFLOW_FLUSH_ALL;
+  } else if (strcmp(value, "byte_budget") == 0) {
+    btif_a2dp_source_cb.tx_overflow_policy =
+        BTIF_A2DP_SOURCE_TX_OVERFLOW_BYTE_BUDGET;
+  } else {
+    btif_a2dp_source_cb.tx_overflow_policy =
+        BTIF_A2DP_SOURCE_TX_OVERFLOW_DROP_OLDEST;
+  }
+  btif_a2dp_source_cb.tx_queue_max_bytes = osi_property_get_int32(
+      BTIF_A2DP_SOURCE_TX_QUEUE_MAX_BYTES_PROPERTY, 0);
+  if (btif_a2dp_source_cb.tx_queue_max_bytes == 0) {
+    btif_a2dp_source_cb.tx_queue_max_bytes =
+        p_encoder_init->peer_params.peer_mtu * MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ /
+        4;
+  }
+  if (!a2dp_codec_config->copyOutOtaCodecConfig(
+          btif_a2dp_source_cb.codec_info)) {
+    memset(btif_a2dp_source_cb.codec_info, 0, AVDT_CODEC_SIZE);
+  }
+
   btif_a2dp_source_cb.encoder_interface->encoder_init(
       &p_encoder_init->peer_params, a2dp_codec_config,
       btif_a2dp_source_read_callback, btif_a2dp_source_enqueue_callback);
@@ -476,6 +687,16 @@ static void btif_a2dp_source_encoder_init_event(BT_HDR* p_msg) {
   // Save a local copy of the encoder_interval_ms
   btif_a2dp_source_cb.encoder_interval_ms =
       btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms();
+  btif_a2dp_source_cb.send_on_enqueue =
+      btif_a2dp_source_cb.encoder_interface->is_ultra_low_latency != NULL &&
+      btif_a2dp_source_cb.encoder_interface->is_ultra_low_latency();
+
+  int32_t deadline_ms = osi_property_get_int32(
+      BTIF_A2DP_SOURCE_TX_QUEUE_DEADLINE_PROPERTY, 0);
+  if (deadline_ms == 0 && btif_a2dp_source_cb.send_on_enqueue)
+    deadline_ms = BTIF_A2DP_SOURCE_ULL_TX_QUEUE_DEADLINE_MS;
+  btif_a2dp_source_cb.tx_queue_deadline_us =
+      (deadline_ms > 0) ? (uint64_t)deadline_ms * 1000 : 0;
 }
 
 void btif_a2dp_source_encoder_user_config_update_req(
@@ -587,42 +808,80 @@ void btif_a2dp_source_set_tx_flush(bool enable) {
 
 static void btif_a2dp_source_audio_tx_start_event(void) {
   APPL_TRACE_DEBUG(
-      "%s media_alarm is %srunning, streaming %s", __func__,
-      alarm_is_scheduled(btif_a2dp_source_cb.media_alarm) ? "" : "not ",
+      "%s media_clock is %srunning, streaming %s", __func__,
+      btif_a2dp_source_media_clock_is_running() ? "" : "not ",
       btif_a2dp_source_is_streaming() ? "true" : "false");
 
   /* Reset the media feeding state */
-  CHECK(btif_a2dp_source_cb.encoder_interface != NULL);
-  btif_a2dp_source_cb.encoder_interface->feeding_reset();
+  {
+    std::lock_guard<std::mutex> lock(encoder_mutex);
+    CHECK(btif_a2dp_source_cb.encoder_interface != NULL);
+    btif_a2dp_source_cb.encoder_interface->feeding_reset();
+    // The encoder may pick another interval on resume
+    btif_a2dp_source_cb.encoder_interval_ms =
+        btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms();
+  }
 
-  APPL_TRACE_EVENT(
-      "starting timer %dms",
-      btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms());
+  APPL_TRACE_EVENT("starting timer %dms",
+                   (int)btif_a2dp_source_cb.encoder_interval_ms);
 
-  alarm_free(btif_a2dp_source_cb.media_alarm);
-  btif_a2dp_source_cb.media_alarm =
-      alarm_new_periodic("btif.a2dp_source_media_alarm");
-  if (btif_a2dp_source_cb.media_alarm == NULL) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate media alarm", __func__);
+  btif_a2dp_source_free_media_clock();
+  media_clock_t* media_clock = media_clock_new("btif.a2dp_source_media_clock");
+  if (media_clock == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to allocate media clock", __func__);
+    btif_a2dp_source_update_media_wakelock();
     return;
   }
 
-  alarm_set(btif_a2dp_source_cb.media_alarm,
-            btif_a2dp_source_cb.encoder_interface->get_encoder_interval_ms(),
-            btif_a2dp_source_alarm_cb, NULL);
+  bool is_started;
+  {
+    /* Set before the first tick, which checks it on the encoder thread */
+    std::lock_guard<std::mutex> lock(media_clock_mutex);
+    btif_a2dp_source_cb.media_clock = media_clock;
+    is_started = media_clock_start(
+        media_clock, thread_get_reactor(btif_a2dp_source_cb.encoder_thread),
+        btif_a2dp_source_cb.encoder_interval_ms,
+        btif_a2dp_source_audio_handle_timer, NULL);
+  }
+  if (!is_started) {
+    LOG_ERROR(LOG_TAG, "%s unable to start media clock", __func__);
+    btif_a2dp_source_free_media_clock();
+  } else {
+    btav_a2dp_codec_index_t codec_index =
+        A2DP_SourceCodecIndex(btif_a2dp_source_cb.codec_info);
+    if (codec_index != BTAV_A2DP_CODEC_INDEX_MAX)
+      BTM_BleSetEnergyA2dpCodec(codec_index);
+    // The high bitrate codecs need the 5 slot EDR packets
+    if (codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC ||
+        codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC ||
+        codec_index == BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL)
+      btif_a2dp_source_set_acl_high_tput(true);
+  }
+  btif_a2dp_source_update_media_wakelock();
+}
+
+static void btif_a2dp_source_set_acl_high_tput(bool enable) {
+  if (btif_a2dp_source_cb.acl_high_tput == enable) return;
+  btif_a2dp_source_cb.acl_high_tput = enable;
+
+  bt_bdaddr_t peer_bda = btif_av_get_addr();
+  BTM_SetAclHighThroughput(peer_bda.address, enable);
 }
 
 static void btif_a2dp_source_audio_tx_stop_event(void) {
   APPL_TRACE_DEBUG(
-      "%s media_alarm is %srunning, streaming %s", __func__,
-      alarm_is_scheduled(btif_a2dp_source_cb.media_alarm) ? "" : "not ",
+      "%s media_clock is %srunning, streaming %s", __func__,
+      btif_a2dp_source_media_clock_is_running() ? "" : "not ",
       btif_a2dp_source_is_streaming() ? "true" : "false");
 
   const bool send_ack = btif_a2dp_source_is_streaming();
 
-  /* Stop the timer first */
-  alarm_free(btif_a2dp_source_cb.media_alarm);
-  btif_a2dp_source_cb.media_alarm = NULL;
+  /* Stop the timer first: no encoder tick runs once it returns */
+  btif_a2dp_source_free_media_clock();
+  btif_a2dp_source_update_media_wakelock();
+  BTM_BleSetEnergyA2dpCodec(-1);
+  btif_a2dp_source_set_acl_high_tput(false);
+  tx_queue_delay_us = 0;
 
   UIPC_Close(UIPC_CH_ID_AV_AUDIO);
 
@@ -645,30 +904,88 @@ static void btif_a2dp_source_audio_tx_stop_event(void) {
   btif_a2dp_source_cb.tx_flush = false;
 
   /* Reset the media feeding state */
+  std::lock_guard<std::mutex> lock(encoder_mutex);
   if (btif_a2dp_source_cb.encoder_interface != NULL)
     btif_a2dp_source_cb.encoder_interface->feeding_reset();
 }
 
-static void btif_a2dp_source_alarm_cb(UNUSED_ATTR void* context) {
-  thread_post(btif_a2dp_source_cb.worker_thread,
-              btif_a2dp_source_audio_handle_timer, NULL);
+static bool btif_a2dp_source_media_clock_is_running(void) {
+  std::lock_guard<std::mutex> lock(media_clock_mutex);
+  return media_clock_is_running(btif_a2dp_source_cb.media_clock);
 }
 
-static void btif_a2dp_source_audio_handle_timer(UNUSED_ATTR void* context) {
-  uint64_t timestamp_us = time_get_os_boottime_us();
+/*
+ * Stops and frees the media clock. The clock is only taken out under
+ * media_clock_mutex: freeing it waits for a running tick to complete, and the
+ * tick checks the clock under that mutex.
+ */
+static void btif_a2dp_source_free_media_clock(void) {
+  media_clock_t* media_clock;
+  {
+    std::lock_guard<std::mutex> lock(media_clock_mutex);
+    media_clock = btif_a2dp_source_cb.media_clock;
+    btif_a2dp_source_cb.media_clock = NULL;
+  }
+  media_clock_free(media_clock);
+}
+
+/*
+ * Holds the media wakelock while the media clock runs: unlike the alarms,
+ * its timer doesn't keep the system awake by itself.
+ */
+static void btif_a2dp_source_update_media_wakelock(void) {
+  const bool is_running = btif_a2dp_source_cb.media_clock != NULL;
+  if (is_running == btif_a2dp_source_cb.media_wakelock_held) return;
+
+  if (is_running) {
+    btif_a2dp_source_cb.media_wakelock_held =
+        wakelock_acquire_reason(WAKELOCK_REASON_MEDIA);
+  } else {
+    wakelock_release_reason(WAKELOCK_REASON_MEDIA);
+    btif_a2dp_source_cb.media_wakelock_held = false;
+  }
+}
+
+static void btif_a2dp_source_audio_handle_timer(UNUSED_ATTR void* context,
+                                                uint64_t timestamp_us) {
   log_tstamps_us("A2DP Source tx timer", timestamp_us);
 
-  if (alarm_is_scheduled(btif_a2dp_source_cb.media_alarm)) {
+  if (btif_a2dp_source_media_clock_is_running()) {
+    std::unique_lock<std::mutex> lock(encoder_mutex);
     CHECK(btif_a2dp_source_cb.encoder_interface != NULL);
     if (btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length !=
         NULL) {
       size_t transmit_queue_length =
-          fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+          spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue);
       btif_a2dp_source_cb.encoder_interface->set_transmit_queue_length(
           transmit_queue_length);
     }
+    uint64_t first_enqueue_us =
+        spsc_queue_first_enqueue_us(btif_a2dp_source_cb.tx_audio_queue);
+    uint64_t queue_delay_us =
+        (first_enqueue_us > 0 && timestamp_us > first_enqueue_us)
+            ? (timestamp_us - first_enqueue_us)
+            : 0;
+    tx_queue_delay_us = queue_delay_us;
+    bool is_congested = tx_congested.exchange(false);
+    if (btif_a2dp_source_cb.encoder_interface->set_transmit_queue_delay !=
+        NULL) {
+      btif_a2dp_source_cb.encoder_interface->set_transmit_queue_delay(
+          queue_delay_us, is_congested);
+    }
+    btif_a2dp_source_update_link_quality(timestamp_us);
+    uint32_t pcm_available;
+    if (btif_a2dp_source_cb.encoder_interface->set_pcm_available != NULL &&
+        btif_a2dp_control_get_audio_available(&pcm_available)) {
+      btif_a2dp_source_cb.encoder_interface->set_pcm_available(pcm_available);
+    }
+    btif_a2dp_source_cb.media_tick_us = timestamp_us;
     btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
-    bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
+    btif_a2dp_source_update_link_timeline(timestamp_us, is_congested);
+    lock.unlock();
+    // In the ultra-low-latency mode, each packet was signaled on enqueue
+    if (!btif_a2dp_source_cb.send_on_enqueue)
+      bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
                             timestamp_us,
                             btif_a2dp_source_cb.encoder_interval_ms * 1000);
@@ -678,8 +995,10 @@ static void btif_a2dp_source_audio_handle_timer(UNUSED_ATTR void* context) {
 }
 
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
-  uint16_t event;
-  uint32_t bytes_read = UIPC_Read(UIPC_CH_ID_AV_AUDIO, &event, p_buf, len);
+  uint64_t start_us = time_get_os_boottime_us();
+  uint32_t bytes_read = btif_a2dp_control_read_audio(p_buf, len);
+  latency_histogram_add(&btif_a2dp_source_cb.stats.media_read_latency,
+                        time_get_os_boottime_us() - start_us);
 
   if (bytes_read < len) {
     LOG_WARN(LOG_TAG, "%s: UNDERFLOW: ONLY READ %d BYTES OUT OF %d", __func__,
@@ -698,7 +1017,7 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n) {
   uint64_t now_us = time_get_os_boottime_us();
 
   /* Check if timer was stopped (media task stopped) */
-  if (!alarm_is_scheduled(btif_a2dp_source_cb.media_alarm)) {
+  if (!btif_a2dp_source_media_clock_is_running()) {
     osi_free(p_buf);
     return false;
   }
@@ -708,48 +1027,73 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n) {
     LOG_VERBOSE(LOG_TAG, "%s: tx suspended, discarded frame", __func__);
 
     btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
-        fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+        btif_a2dp_source_flush_tx_queue(btif_a2dp_source_free_tx_buf);
     btif_a2dp_source_cb.stats.tx_queue_last_flushed_us = now_us;
-    fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
     osi_free(p_buf);
     return false;
   }
 
   // Check for TX queue overflow
-  // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
-  if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) + frames_n >
-      MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ) {
-    LOG_WARN(LOG_TAG, "%s: TX queue buffer size now=%u adding=%u max=%d",
+  if (btif_a2dp_source_tx_queue_is_full(frames_n, p_buf->len)) {
+    LOG_WARN(LOG_TAG,
+             "%s: TX queue buffer size now=%u (%u bytes) adding=%u max=%d",
              __func__,
-             (uint32_t)fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue),
-             (uint32_t)frames_n, MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
+             (uint32_t)spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue),
+             (uint32_t)tx_queue_bytes.load(), (uint32_t)frames_n,
+             MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ);
     // Keep track of drop-outs
+    uint64_t last_dropouts_us =
+        btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us;
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
 
-    // Flush all queued buffers
-    size_t drop_n = fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+    size_t drop_n = 0;
+    if (btif_a2dp_source_cb.tx_overflow_policy ==
+        BTIF_A2DP_SOURCE_TX_OVERFLOW_FLUSH_ALL) {
+      // Flush all queued buffers
+      drop_n = btif_a2dp_source_flush_tx_queue(btif_a2dp_source_drop_tx_buf);
+    } else {
+      // Drop as few complete frames as needed for the new buffer to fit
+      do {
+        drop_n += btif_a2dp_source_drop_oldest_frame();
+      } while (!spsc_queue_is_empty(btif_a2dp_source_cb.tx_audio_queue) &&
+               btif_a2dp_source_tx_queue_is_full(frames_n, p_buf->len));
+    }
     btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages = std::max(
         drop_n, btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages);
-    while (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue)) {
-      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
-      osi_free(fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue));
-    }
+    btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages += drop_n;
 
-    // Request RSSI for log purposes if we had to flush buffers
-    bt_bdaddr_t peer_bda = btif_av_get_addr();
-    BTM_ReadRSSI(peer_bda.address, btm_read_rssi_cb);
+    // Request RSSI for log purposes if we had to drop buffers
+    if (now_us - last_dropouts_us >=
+        BTIF_A2DP_SOURCE_OVERFLOW_RSSI_INTERVAL_US) {
+      bt_bdaddr_t peer_bda = btif_av_get_addr();
+      BTM_ReadRSSI(peer_bda.address, btm_read_rssi_cb);
+    }
   }
 
   /* Update the statistics */
+  if (btif_a2dp_source_cb.media_tick_us > 0 &&
+      now_us > btif_a2dp_source_cb.media_tick_us) {
+    latency_histogram_add(&btif_a2dp_source_cb.stats.encode_latency,
+                          now_us - btif_a2dp_source_cb.media_tick_us);
+  }
   btif_a2dp_source_cb.stats.tx_queue_total_frames += frames_n;
   btif_a2dp_source_cb.stats.tx_queue_max_frames_per_packet = std::max(
       frames_n, btif_a2dp_source_cb.stats.tx_queue_max_frames_per_packet);
   CHECK(btif_a2dp_source_cb.encoder_interface != NULL);
 
-  fixed_queue_enqueue(btif_a2dp_source_cb.tx_audio_queue, p_buf);
+  FLOW_TRACE_START(FLOW_TRACE_BTIF, p_buf, "BTIF A2DP source tx");
+  tx_queue_bytes += p_buf->len;
+  if (!spsc_queue_try_enqueue(btif_a2dp_source_cb.tx_audio_queue, p_buf)) {
+    // Cannot happen: the overflow check above always leaves room
+    btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
+    btif_a2dp_source_drop_tx_buf(p_buf);
+    return false;
+  }
 
+  if (btif_a2dp_source_cb.send_on_enqueue)
+    bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
   return true;
 }
 
@@ -757,16 +1101,18 @@ static void btif_a2dp_source_audio_tx_flush_event(UNUSED_ATTR BT_HDR* p_msg) {
   /* Flush all enqueued audio buffers (encoded) */
   APPL_TRACE_DEBUG("%s", __func__);
 
-  if (btif_a2dp_source_cb.encoder_interface != NULL)
-    btif_a2dp_source_cb.encoder_interface->feeding_flush();
+  {
+    std::lock_guard<std::mutex> lock(encoder_mutex);
+    if (btif_a2dp_source_cb.encoder_interface != NULL)
+      btif_a2dp_source_cb.encoder_interface->feeding_flush();
+  }
 
   btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
-      fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+      btif_a2dp_source_flush_tx_queue(btif_a2dp_source_free_tx_buf);
   btif_a2dp_source_cb.stats.tx_queue_last_flushed_us =
       time_get_os_boottime_us();
-  fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
-  UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, NULL);
+  btif_a2dp_control_flush_audio();
 }
 
 static bool btif_a2dp_source_audio_tx_flush_req(void) {
@@ -790,10 +1136,54 @@ static bool btif_a2dp_source_audio_tx_flush_req(void) {
   return true;
 }
 
+// Drops the frames at the head of the tx audio queue that were encoded more
+// than the deadline before |now_us|, together with all of their fragments.
+// This is called between two frames only, so no frame is sent in part, with
+// tx_read_mutex held.
+static void btif_a2dp_source_drop_expired_frames(uint64_t now_us) {
+  uint64_t deadline_us = btif_a2dp_source_cb.tx_queue_deadline_us;
+  uint64_t enqueue_us;
+
+  while ((enqueue_us = spsc_queue_first_enqueue_us(
+              btif_a2dp_source_cb.tx_audio_queue)) > 0 &&
+         now_us > enqueue_us + deadline_us) {
+    BT_HDR* p_buf;
+    while ((p_buf = (BT_HDR*)spsc_queue_try_dequeue(
+                btif_a2dp_source_cb.tx_audio_queue)) != NULL) {
+      bool frame_end =
+          A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info, p_buf);
+      btif_a2dp_source_cb.stats.tx_queue_total_expired_messages++;
+      btif_a2dp_source_free_tx_buf(p_buf);
+      if (frame_end) break;
+    }
+    btif_a2dp_source_cb.stats.tx_queue_total_expired_frames++;
+  }
+}
+
 BT_HDR* btif_a2dp_source_audio_readbuf(void) {
   uint64_t now_us = time_get_os_boottime_us();
-  BT_HDR* p_buf =
-      (BT_HDR*)fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
+  uint64_t enqueue_us = 0;
+  BT_HDR* p_buf = NULL;
+  {
+    std::lock_guard<std::mutex> lock(tx_read_mutex);
+    if (btif_a2dp_source_cb.tx_queue_deadline_us > 0 && !tx_in_frame)
+      btif_a2dp_source_drop_expired_frames(now_us);
+    if (!tx_frame_tail.empty()) {
+      p_buf = tx_frame_tail.front().first;
+      enqueue_us = tx_frame_tail.front().second;
+      tx_frame_tail.pop_front();
+    } else {
+      p_buf = (BT_HDR*)spsc_queue_try_dequeue_timed(
+          btif_a2dp_source_cb.tx_audio_queue, &enqueue_us);
+    }
+    if (p_buf != NULL)
+      tx_in_frame =
+          !A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info, p_buf);
+  }
+  if (p_buf != NULL) {
+    FLOW_TRACE(FLOW_TRACE_BTIF, p_buf, "BTIF A2DP source to BTA");
+    tx_queue_bytes -= p_buf->len;
+  }
 
   btif_a2dp_source_cb.stats.tx_queue_total_readbuf_calls++;
   btif_a2dp_source_cb.stats.tx_queue_last_readbuf_us = now_us;
@@ -802,16 +1192,269 @@ BT_HDR* btif_a2dp_source_audio_readbuf(void) {
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_dequeue_stats,
                             now_us,
                             btif_a2dp_source_cb.encoder_interval_ms * 1000);
+    if (enqueue_us > 0 && now_us > enqueue_us) {
+      uint64_t queueing_time_us = now_us - enqueue_us;
+      btif_a2dp_source_cb.stats.tx_queue_total_queueing_time_us +=
+          queueing_time_us;
+      btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us =
+          std::max(queueing_time_us,
+                   btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us);
+      latency_histogram_add(&btif_a2dp_source_cb.stats.tx_queue_latency,
+                            queueing_time_us);
+    }
   }
 
   return p_buf;
 }
 
+uint32_t btif_a2dp_source_audio_flush_count(void) { return tx_flush_count; }
+
+void btif_a2dp_source_on_congested(void) { tx_congested = true; }
+
+// Records in the link timeline the quality used by the encoder on the tick
+// at |timestamp_us|, whether the link was congested since the previous
+// tick, and samples the RSSI at a regular interval.
+static void btif_a2dp_source_update_link_timeline(uint64_t timestamp_us,
+                                                  bool is_congested) {
+  uint64_t start_us = btif_a2dp_source_cb.link_timeline_start_us;
+  if (start_us == 0 || timestamp_us < start_us) return;
+  uint64_t time_us = timestamp_us - start_us;
+  link_timeline_t* timeline = &btif_a2dp_source_cb.stats.link_timeline;
+
+  if (btif_a2dp_source_cb.encoder_interface->get_quality_index != NULL) {
+    int quality_index =
+        btif_a2dp_source_cb.encoder_interface->get_quality_index();
+    if (quality_index >= 0) {
+      link_timeline_set_quality(
+          timeline, time_us, quality_index,
+          spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue));
+    }
+  }
+  link_timeline_set_congested(timeline, time_us, is_congested);
+
+  uint64_t last_rssi_us = btif_a2dp_source_cb.stats.link_timeline_last_rssi_us;
+  if (last_rssi_us == 0 ||
+      timestamp_us - last_rssi_us >=
+          BTIF_A2DP_SOURCE_TIMELINE_RSSI_INTERVAL_US) {
+    btif_a2dp_source_cb.stats.link_timeline_last_rssi_us = timestamp_us;
+    bt_bdaddr_t peer_bda = btif_av_get_addr();
+    BTM_ReadRSSI(peer_bda.address, btm_read_rssi_cb);
+  }
+}
+
+// Hands the link signals read since the previous tick to the encoder, and
+// reads them again at a regular interval, if the encoder uses them.
+static void btif_a2dp_source_update_link_quality(uint64_t timestamp_us) {
+  if (btif_a2dp_source_cb.encoder_interface->set_link_quality == NULL) return;
+
+  tA2DP_LINK_QUALITY sample;
+  bool has_sample = false;
+  {
+    std::lock_guard<std::mutex> lock(link_quality_mutex);
+    if (link_quality_updated) {
+      sample = link_quality;
+      link_quality_updated = false;
+      has_sample = true;
+    }
+  }
+  if (has_sample)
+    btif_a2dp_source_cb.encoder_interface->set_link_quality(&sample);
+
+  uint64_t last_read_us = btif_a2dp_source_cb.link_quality_last_read_us;
+  if (last_read_us != 0 &&
+      timestamp_us - last_read_us < BTIF_A2DP_SOURCE_LINK_QUALITY_INTERVAL_US)
+    return;
+  btif_a2dp_source_cb.link_quality_last_read_us = timestamp_us;
+  bt_bdaddr_t peer_bda = btif_av_get_addr();
+  BTM_ReadRSSI(peer_bda.address, btif_a2dp_source_link_rssi_cb);
+  BTM_ReadLinkQuality(peer_bda.address, btif_a2dp_source_link_quality_cb);
+  BTM_ReadFailedContactCounter(peer_bda.address,
+                               btif_a2dp_source_failed_contact_counter_cb);
+}
+
+// Returns true if |bd_addr| is the current peer, so that the link signals
+// of a previous peer are not handed to the encoder.
+static bool btif_a2dp_source_is_peer(const BD_ADDR bd_addr) {
+  bt_bdaddr_t peer_bda = btif_av_get_addr();
+  return memcmp(peer_bda.address, bd_addr, BD_ADDR_LEN) == 0;
+}
+
+static void btif_a2dp_source_record_rssi(const tBTM_RSSI_RESULTS* result) {
+  if (!btif_a2dp_source_is_peer(result->rem_bda)) return;
+  std::lock_guard<std::mutex> lock(link_quality_mutex);
+  link_quality.has_rssi = true;
+  link_quality.rssi = result->rssi;
+  link_quality_updated = true;
+}
+
+static void btif_a2dp_source_link_rssi_cb(void* data) {
+  tBTM_RSSI_RESULTS* result = (tBTM_RSSI_RESULTS*)data;
+  if (result == nullptr || result->status != BTM_SUCCESS) return;
+  btif_a2dp_source_record_rssi(result);
+}
+
+static void btif_a2dp_source_link_quality_cb(void* data) {
+  tBTM_LINK_QUALITY_RESULTS* result = (tBTM_LINK_QUALITY_RESULTS*)data;
+  if (result == nullptr || result->status != BTM_SUCCESS) return;
+  if (!btif_a2dp_source_is_peer(result->rem_bda)) return;
+  std::lock_guard<std::mutex> lock(link_quality_mutex);
+  link_quality.has_link_quality = true;
+  link_quality.link_quality = result->link_quality;
+  link_quality_updated = true;
+}
+
+static void btif_a2dp_source_failed_contact_counter_cb(void* data) {
+  tBTM_FAILED_CONTACT_COUNTER_RESULTS* result =
+      (tBTM_FAILED_CONTACT_COUNTER_RESULTS*)data;
+  if (result == nullptr || result->status != BTM_SUCCESS) return;
+  if (!btif_a2dp_source_is_peer(result->rem_bda)) return;
+  std::lock_guard<std::mutex> lock(link_quality_mutex);
+  link_quality.has_failed_contact_counter = true;
+  link_quality.failed_contact_counter = result->failed_contact_counter;
+  link_quality_updated = true;
+}
+
+// Accounts the current quality and congestion of the link timeline up to
+// now, before the statistics are reported.
+static void btif_a2dp_source_finish_link_timeline(void) {
+  uint64_t start_us = btif_a2dp_source_cb.link_timeline_start_us;
+  uint64_t now_us = time_get_os_boottime_us();
+  if (start_us == 0 || now_us < start_us) return;
+  link_timeline_finish(&btif_a2dp_source_cb.stats.link_timeline,
+                       now_us - start_us);
+}
+
+void btif_a2dp_source_get_delay_us(uint32_t* p_encoder_delay_us,
+                                   uint32_t* p_tx_queue_delay_us) {
+  *p_encoder_delay_us = 0;
+  *p_tx_queue_delay_us = 0;
+  if (!btif_a2dp_source_is_streaming()) return;
+
+  A2dpCodecConfig* a2dp_codec_config = bta_av_get_a2dp_current_codec();
+  if (a2dp_codec_config != nullptr)
+    *p_encoder_delay_us = (uint32_t)a2dp_codec_config->encoderLookaheadUs();
+  *p_tx_queue_delay_us = (uint32_t)tx_queue_delay_us.load();
+}
+
+void btif_a2dp_source_get_encoder_interval(period_ms_t* p_interval_ms,
+                                           bool* p_low_latency) {
+  *p_interval_ms = 0;
+  *p_low_latency = false;
+  if (btif_a2dp_source_cb.encoder_interface == NULL) return;
+
+  *p_interval_ms = btif_a2dp_source_cb.encoder_interval_ms;
+  *p_low_latency = btif_a2dp_source_cb.send_on_enqueue;
+}
+
+// Frees a buffer that was taken out of the tx audio queue.
+static void btif_a2dp_source_free_tx_buf(void* p_data) {
+  BT_HDR* p_buf = (BT_HDR*)p_data;
+
+  tx_queue_bytes -= p_buf->len;
+  osi_free(p_buf);
+}
+
+// Frees a buffer that was taken out of the tx audio queue because of an
+// overflow.
+static void btif_a2dp_source_drop_tx_buf(void* p_data) {
+  BT_HDR* p_buf = (BT_HDR*)p_data;
+
+  btif_a2dp_source_cb.stats.tx_queue_total_dropped_bytes += p_buf->len;
+  if (A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info, p_buf))
+    btif_a2dp_source_cb.stats.tx_queue_total_dropped_frames++;
+  btif_a2dp_source_free_tx_buf(p_buf);
+}
+
+// Flushes the tx audio queue and the rest of the frame being read by BTA,
+// calling |free_cb| on each buffer if it is not NULL. Returns the number of
+// flushed buffers.
+static size_t btif_a2dp_source_flush_tx_queue(spsc_queue_free_cb free_cb) {
+  std::lock_guard<std::mutex> lock(tx_read_mutex);
+  size_t flush_n = tx_frame_tail.size();
+
+  for (const auto& held : tx_frame_tail) {
+    if (free_cb != NULL) free_cb(held.first);
+  }
+  tx_frame_tail.clear();
+  flush_n += spsc_queue_flush(btif_a2dp_source_cb.tx_audio_queue, free_cb);
+  tx_in_frame = false;
+  tx_flush_count++;
+
+  return flush_n;
+}
+
+// Drops the oldest encoded frame from the tx audio queue, together with all
+// of its fragments, so no partial frame is left behind in the queue.
+// The first fragments of the frame at the head of the queue may already be
+// sent: the rest of that frame is then moved to |tx_frame_tail| for BTA to
+// finish it, and the next frame is dropped instead.
+// Returns the number of dropped buffers.
+static size_t btif_a2dp_source_drop_oldest_frame(void) {
+  std::lock_guard<std::mutex> lock(tx_read_mutex);
+  size_t drop_n = 0;
+  BT_HDR* p_buf;
+
+  if (tx_in_frame &&
+      (tx_frame_tail.empty() ||
+       !A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info,
+                             tx_frame_tail.back().first))) {
+    uint64_t enqueue_us = 0;
+    while ((p_buf = (BT_HDR*)spsc_queue_try_dequeue_timed(
+                btif_a2dp_source_cb.tx_audio_queue, &enqueue_us)) != NULL) {
+      tx_frame_tail.push_back(std::make_pair(p_buf, enqueue_us));
+      if (A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info, p_buf)) break;
+    }
+  }
+
+  while ((p_buf = (BT_HDR*)spsc_queue_try_dequeue(
+              btif_a2dp_source_cb.tx_audio_queue)) != NULL) {
+    bool frame_end =
+        A2DP_PacketEndsFrame(btif_a2dp_source_cb.codec_info, p_buf);
+    drop_n++;
+    btif_a2dp_source_drop_tx_buf(p_buf);
+    if (frame_end) break;
+  }
+
+  return drop_n;
+}
+
+// Checks whether a buffer of |len| bytes with |frames_n| frames overflows
+// the tx audio queue under the current overflow policy.
+static bool btif_a2dp_source_tx_queue_is_full(size_t frames_n, size_t len) {
+  size_t queue_length = spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+
+  switch (btif_a2dp_source_cb.tx_overflow_policy) {
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_FLUSH_ALL:
+      // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
+      return queue_length + frames_n > MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ;
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_DROP_OLDEST:
+      return queue_length + 1 > MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ;
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_BYTE_BUDGET:
+      return (queue_length + 1 > MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ) ||
+             (tx_queue_bytes + len > btif_a2dp_source_cb.tx_queue_max_bytes);
+  }
+
+  return false;
+}
+
+static const char* dump_tx_overflow_policy(
+    tBTIF_A2DP_SOURCE_TX_OVERFLOW_POLICY policy) {
+  switch (policy) {
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_FLUSH_ALL:
+      return "flush_all";
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_DROP_OLDEST:
+      return "drop_oldest";
+    case BTIF_A2DP_SOURCE_TX_OVERFLOW_BYTE_BUDGET:
+      return "byte_budget";
+  }
+  return "unknown";
+}
+
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us) {
   static uint64_t prev_us = 0;
   APPL_TRACE_DEBUG("[%s] ts %08llu, diff : %08llu, queue sz %d", comment,
                    timestamp_us, timestamp_us - prev_us,
-                   fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue));
+                   spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue));
   prev_us = timestamp_us;
 }
 
@@ -854,7 +1497,18 @@ static void update_scheduling_stats(scheduling_stats_t* stats, uint64_t now_us,
   }
 }
 
+static void btif_a2dp_source_dump_latency(
+    int fd, const char* stage, const latency_histogram_t* histogram) {
+  dprintf(fd, "    %s: %llu / %llu / %llu / %llu / %llu\n", stage,
+          (unsigned long long)histogram->count,
+          (unsigned long long)latency_histogram_percentile(histogram, 500),
+          (unsigned long long)latency_histogram_percentile(histogram, 990),
+          (unsigned long long)latency_histogram_percentile(histogram, 999),
+          (unsigned long long)histogram->max_us);
+}
+
 void btif_a2dp_source_debug_dump(int fd) {
+  btif_a2dp_source_finish_link_timeline();
   btif_a2dp_source_accumulate_stats(&btif_a2dp_source_cb.stats,
                                     &btif_a2dp_source_cb.accumulated_stats);
   uint64_t now_us = time_get_os_boottime_us();
@@ -902,6 +1556,17 @@ void btif_a2dp_source_debug_dump(int fd) {
           accumulated_stats->tx_queue_total_frames,
           accumulated_stats->tx_queue_max_frames_per_packet, ave_size);
 
+  uint64_t ave_queueing_time_us = 0;
+  if (dequeue_stats->total_updates != 0)
+    ave_queueing_time_us = accumulated_stats->tx_queue_total_queueing_time_us /
+                           dequeue_stats->total_updates;
+  dprintf(fd,
+          "  Queueing time in ms (max/ave)                           : %llu / "
+          "%llu\n",
+          (unsigned long long)accumulated_stats->tx_queue_max_queueing_time_us /
+              1000,
+          (unsigned long long)ave_queueing_time_us / 1000);
+
   dprintf(fd,
           "  Counts (flushed/dropped/dropouts)                       : %zu / "
           "%zu / %zu\n",
@@ -913,6 +1578,25 @@ void btif_a2dp_source_debug_dump(int fd) {
           "  Counts (max dropped)                                    : %zu\n",
           accumulated_stats->tx_queue_max_dropped_messages);
 
+  dprintf(fd,
+          "  Overflow policy (max bytes)                             : %s "
+          "(%zu)\n",
+          dump_tx_overflow_policy(btif_a2dp_source_cb.tx_overflow_policy),
+          btif_a2dp_source_cb.tx_queue_max_bytes);
+
+  dprintf(fd,
+          "  Dropped on overflow (bytes/frames)                      : %zu / "
+          "%zu\n",
+          accumulated_stats->tx_queue_total_dropped_bytes,
+          accumulated_stats->tx_queue_total_dropped_frames);
+
+  dprintf(fd,
+          "  Dropped past the deadline in ms (messages/frames)       : %llu "
+          "(%zu / %zu)\n",
+          (unsigned long long)btif_a2dp_source_cb.tx_queue_deadline_us / 1000,
+          accumulated_stats->tx_queue_total_expired_messages,
+          accumulated_stats->tx_queue_total_expired_frames);
+
   dprintf(
       fd,
       "  Last update time ago in ms (flushed/dropped)            : %llu / "
@@ -1021,6 +1705,75 @@ void btif_a2dp_source_debug_dump(int fd) {
           1000,
       (unsigned long long)ave_time_us / 1000);
 
+  //
+  // Per-stage latency
+  //
+  dprintf(fd, "  Latency in us (count/p50/p99/p99.9/max):\n");
+  btif_a2dp_source_dump_latency(fd, "Media read                    ",
+                                &accumulated_stats->media_read_latency);
+  btif_a2dp_source_dump_latency(fd, "Encode (tick to tx queue)     ",
+                                &accumulated_stats->encode_latency);
+  btif_a2dp_source_dump_latency(fd, "Tx queue wait                 ",
+                                &accumulated_stats->tx_queue_latency);
+
+  //
+  // Link timeline
+  //
+  const link_timeline_t* timeline = &accumulated_stats->link_timeline;
+  dprintf(fd, "  Time at encoder quality index in ms                     :");
+  for (int i = 0; i < LINK_TIMELINE_MAX_QUALITY_INDEX; i++) {
+    if (timeline->quality_duration_ms[i] == 0) continue;
+    dprintf(fd, " %d: %llu", i,
+            (unsigned long long)timeline->quality_duration_ms[i]);
+  }
+  dprintf(fd, "\n");
+
+  dprintf(fd,
+          "  Encoder quality index changes (total)                   : %u\n",
+          timeline->num_transitions);
+  for (uint32_t i = 0; i < timeline->transitions_kept; i++) {
+    const link_timeline_transition_t* transition =
+        link_timeline_get_transition(timeline, i);
+    dprintf(fd, "    %llu ms: %d -> %d (rssi %d, tx queue %u)\n",
+            (unsigned long long)transition->time_ms, transition->from_index,
+            transition->to_index, transition->rssi,
+            transition->tx_queue_length);
+  }
+
+  dprintf(fd,
+          "  RSSI samples (total)                                    : %u\n",
+          timeline->num_rssi_samples);
+  for (uint32_t i = 0; i < timeline->rssi_samples_kept; i++) {
+    const link_timeline_rssi_sample_t* sample =
+        link_timeline_get_rssi_sample(timeline, i);
+    dprintf(fd, "    %llu ms: %d dBm (tx queue %u)\n",
+            (unsigned long long)sample->time_ms, sample->rssi,
+            sample->tx_queue_length);
+  }
+
+  dprintf(fd,
+          "  Congestion (count/total ms/max ms)                      : %u / "
+          "%llu / %llu\n",
+          timeline->congestion_count,
+          (unsigned long long)timeline->congestion_total_us / 1000,
+          (unsigned long long)timeline->congestion_max_us / 1000);
+
+  tBTM_ACL_THROUGHPUT acl_tput;
+  bt_bdaddr_t peer_bda = btif_av_get_addr();
+  if (BTM_ReadAclThroughput(peer_bda.address, &acl_tput)) {
+    dprintf(fd,
+            "  ACL goodput in kbps (last second)                       : %u"
+            " (%u%% blocked)\n",
+            acl_tput.goodput_kbps, acl_tput.blocked_pct);
+    dprintf(fd,
+            "  ACL packet types (mask/high throughput/fallbacks)       : "
+            "0x%04x / %s / %u%s\n",
+            acl_tput.pkt_types_mask, acl_tput.high_throughput ? "on" : "off",
+            acl_tput.num_fallbacks, acl_tput.fallback ? " (2-DH3 now)" : "");
+  }
+
+  A2DP_EncoderPacketPoolDebugDump(fd);
+
   //
   // Codec-specific stats
   //
@@ -1070,6 +1823,15 @@ void btif_a2dp_source_update_metrics(void) {
           metrics.buffer_underruns_count;
     }
   }
+  metrics.media_read_latency = stats->media_read_latency;
+  metrics.encode_latency = stats->encode_latency;
+  metrics.tx_queue_latency = stats->tx_queue_latency;
+  btav_a2dp_codec_index_t codec_index =
+      A2DP_SourceCodecIndex(btif_a2dp_source_cb.codec_info);
+  if (codec_index != BTAV_A2DP_CODEC_INDEX_MAX)
+    metrics.codec_index = codec_index;
+  btif_a2dp_source_finish_link_timeline();
+  metrics.link_timeline = stats->link_timeline;
   BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics);
 }
 
@@ -1086,8 +1848,18 @@ static void btm_read_rssi_cb(void* data) {
     return;
   }
 
+  btif_a2dp_source_record_rssi(result);
+
+  uint64_t start_us = btif_a2dp_source_cb.link_timeline_start_us;
+  uint64_t now_us = time_get_os_boottime_us();
+  if (start_us != 0 && now_us >= start_us) {
+    link_timeline_add_rssi(
+        &btif_a2dp_source_cb.stats.link_timeline, now_us - start_us,
+        result->rssi, spsc_queue_length(btif_a2dp_source_cb.tx_audio_queue));
+  }
+
   char temp_buffer[20] = {0};
-  LOG_WARN(LOG_TAG, "%s device: %s, rssi: %d", __func__,
+  LOG_INFO(LOG_TAG, "%s device: %s, rssi: %d", __func__,
            bdaddr_to_string((bt_bdaddr_t*)result->rem_bda, temp_buffer,
                             sizeof(temp_buffer)),
            result->rssi);
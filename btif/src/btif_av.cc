@@ -285,6 +285,23 @@ static void btif_report_audio_state(btav_audio_state_t state,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_av_queue_advance
+ *
+ * Description      Lets the connection queue start the connections that were
+ *                  waiting for the A2DP connection in progress.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void btif_av_queue_advance(void) {
+  if (bt_av_sink_callbacks != NULL)
+    btif_queue_advance_by_uuid(UUID_SERVCLASS_AUDIO_SINK);
+  else
+    btif_queue_advance_by_uuid(UUID_SERVCLASS_AUDIO_SOURCE);
+}
+
 static void btif_update_source_codec(void* p_data) {
   btav_a2dp_codec_config_t req;
   // copy to avoid alignment problems
@@ -462,7 +479,7 @@ static bool btif_av_state_idle_handler(btif_sm_event_t event, void* p_data) {
         /* Bring up AVRCP connection too */
         BTA_AvOpenRc(btif_av_cb.bta_handle);
       }
-      btif_queue_advance();
+      btif_av_queue_advance();
     } break;
 
     case BTA_AV_REMOTE_CMD_EVT:
@@ -574,7 +591,7 @@ static bool btif_av_state_opening_handler(btif_sm_event_t event, void* p_data) {
         /* Bring up AVRCP connection too */
         BTA_AvOpenRc(btif_av_cb.bta_handle);
       }
-      btif_queue_advance();
+      btif_av_queue_advance();
     } break;
 
     case BTIF_AV_SOURCE_CONFIG_REQ_EVT:
@@ -607,7 +624,7 @@ static bool btif_av_state_opening_handler(btif_sm_event_t event, void* p_data) {
         BTIF_TRACE_DEBUG(
             "%s: Same device moved to Opening state,ignore Connect Req",
             __func__);
-        btif_queue_advance();
+        btif_av_queue_advance();
         break;
       } else {
         BTIF_TRACE_DEBUG("%s: Moved from idle by Incoming Connection request",
@@ -615,7 +632,7 @@ static bool btif_av_state_opening_handler(btif_sm_event_t event, void* p_data) {
         btif_report_connection_state(
             BTAV_CONNECTION_STATE_DISCONNECTED,
             ((btif_av_connect_req_t*)p_data)->target_bda);
-        btif_queue_advance();
+        btif_av_queue_advance();
         break;
       }
 
@@ -881,7 +898,7 @@ static bool btif_av_state_opened_handler(btif_sm_event_t event, void* p_data) {
         btif_report_connection_state(BTAV_CONNECTION_STATE_DISCONNECTED,
                                      (bt_bdaddr_t*)p_data);
       }
-      btif_queue_advance();
+      btif_av_queue_advance();
       break;
 
     case BTIF_AV_OFFLOAD_START_REQ_EVT:
@@ -1171,7 +1188,8 @@ static void bte_av_sink_media_callback(tBTA_AV_EVT event,
     case BTA_AV_SINK_MEDIA_DATA_EVT: {
       btif_sm_state_t state = btif_sm_get_state(btif_av_cb.sm_handle);
       if ((state == BTIF_AV_STATE_STARTED) || (state == BTIF_AV_STATE_OPENED)) {
-        uint8_t queue_len = btif_a2dp_sink_enqueue_buf((BT_HDR*)p_data);
+        uint8_t queue_len = btif_a2dp_sink_enqueue_buf(
+            p_data->sink_media.p_pkt, p_data->sink_media.time_stamp);
         BTIF_TRACE_DEBUG("%s: packets in sink queue %d", __func__, queue_len);
       }
       break;
@@ -1569,10 +1587,12 @@ bt_status_t btif_av_execute_service(bool b_enable) {
  * be initiated by the app/audioflinger layers */
 /* Support for browsing for SDP record should work only if we enable BROWSE
  * while registering. */
+/* Added BTA_AV_FEAT_DELAY_RPT - the sink delay reports are used to compute
+ * the presentation position reported to the audio HAL */
 #if (AVRC_METADATA_INCLUDED == TRUE)
     BTA_AvEnable(BTA_SEC_AUTHENTICATE,
                  BTA_AV_FEAT_RCTG | BTA_AV_FEAT_METADATA | BTA_AV_FEAT_VENDOR |
-                     BTA_AV_FEAT_NO_SCO_SSPD
+                     BTA_AV_FEAT_NO_SCO_SSPD | BTA_AV_FEAT_DELAY_RPT
 #if (AVRC_ADV_CTRL_INCLUDED == TRUE)
                      | BTA_AV_FEAT_RCCT | BTA_AV_FEAT_ADV_CTRL |
                      BTA_AV_FEAT_BROWSE
@@ -1581,7 +1601,9 @@ bt_status_t btif_av_execute_service(bool b_enable) {
                  bte_av_callback);
 #else
     BTA_AvEnable(BTA_SEC_AUTHENTICATE,
-                 (BTA_AV_FEAT_RCTG | BTA_AV_FEAT_NO_SCO_SSPD), bte_av_callback);
+                 (BTA_AV_FEAT_RCTG | BTA_AV_FEAT_NO_SCO_SSPD |
+                  BTA_AV_FEAT_DELAY_RPT),
+                 bte_av_callback);
 #endif
     BTA_AvRegister(BTA_AV_CHNL_AUDIO, BTIF_AV_SERVICE_NAME, 0, NULL,
                    UUID_SERVCLASS_AUDIO_SOURCE);
@@ -144,3 +144,13 @@ int BtifAvrcpAudioTrackWriteData(void* handle, void* audioBuffer,
               bufferlen, retval);
   return retval;
 }
+
+uint32_t BtifAvrcpAudioTrackGetUnderrunFrames(void* handle) {
+  if (handle == NULL) {
+    LOG_DEBUG(LOG_TAG, "%s handle is null.", __func__);
+    return 0;
+  }
+  BtifAvrcpAudioTrack* trackHolder = static_cast<BtifAvrcpAudioTrack*>(handle);
+  if (trackHolder == NULL || trackHolder->track == NULL) return 0;
+  return trackHolder->track->getUnderrunFrames();
+}
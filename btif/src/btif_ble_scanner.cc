@@ -149,13 +149,16 @@ void bta_scan_results_cb_impl(bt_bdaddr_t bd_addr, tBT_DEVICE_TYPE device_type,
   bt_device_type_t dev_type;
   bt_property_t properties;
 
-  const uint8_t* p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-      value, BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
-
-  if (p_eir_remote_name == NULL) {
-    p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        value, BT_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
-  }
+  /* the complete name, or the shortened one, in a single pass */
+  const uint8_t name_types[] = {BTM_EIR_COMPLETE_LOCAL_NAME_TYPE,
+                                BT_EIR_SHORTENED_LOCAL_NAME_TYPE};
+  AdvertiseDataParser::Field names[2];
+  AdvertiseDataParser::GetFieldsByType(value.data(), value.size(), name_types,
+                                       2, names);
+  const AdvertiseDataParser::Field& name =
+      (names[0].data != NULL) ? names[0] : names[1];
+  const uint8_t* p_eir_remote_name = name.data;
+  remote_name_len = name.len;
 
   if ((addr_type != BLE_ADDR_RANDOM) || (p_eir_remote_name)) {
     if (!btif_gattc_find_bdaddr(bd_addr.address)) {
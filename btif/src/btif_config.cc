@@ -22,12 +22,17 @@
 
 #include <base/logging.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <string>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "bt_types.h"
@@ -35,6 +40,7 @@
 #include "btcore/include/module.h"
 #include "btif_api.h"
 #include "btif_common.h"
+#include "btif_config_journal.h"
 #include "btif_config_transcode.h"
 #include "btif_util.h"
 #include "osi/include/alarm.h"
@@ -44,6 +50,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/thread.h"
 
 #define BT_CONFIG_SOURCE_TAG_NUM 1010001
 
@@ -57,22 +64,43 @@ static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
 #if defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
+static const char* CONFIG_SNAPSHOT_PATH = "bt_config.snap";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.journal";
+static const char* CONFIG_SNAPSHOT_PATH = "/data/misc/bluedroid/bt_config.snap";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
 #endif  // defined(OS_GENERIC)
 static const period_ms_t CONFIG_SETTLE_PERIOD_MS = 3000;
+// The save may be deferred to share a wakeup with other timers
+static const period_ms_t CONFIG_SETTLE_SLACK_MS = 2000;
+// The journal is compacted into the config file once it grows past this size
+static const size_t CONFIG_JOURNAL_MAX_SIZE = 64 * 1024;
 
 static void timer_config_save_cb(void* data);
-static void btif_config_write(uint16_t event, char* p_param);
+static void config_io_write_cb(void* context);
+static void btif_config_write(void);
+static void btif_config_compact(const config_t* snapshot);
+static std::shared_ptr<const config_t> btif_config_snapshot(void);
+static std::shared_ptr<const config_t> btif_config_snapshot_locked(void);
+static bool journal_append(const std::string& records);
+static void journal_truncate(void);
+static void journal_set(const char* section, const char* key);
+static void journal_remove(const char* section, const char* key);
 static bool is_factory_reset(void);
 static void delete_config_files(void);
+static bool btif_config_is_unpaired(const config_t* config,
+                                    const char* section);
+static bool btif_config_has_unpaired(const config_t* config);
 static void btif_config_remove_unpaired(config_t* config);
 static void btif_config_remove_restricted(config_t* config);
-static config_t* btif_config_open(const char* filename);
+static config_t* btif_config_open(const char* filename,
+                                  const char* snapshot_filename);
 
 static enum ConfigSource {
   NOT_LOADED,
@@ -125,6 +153,27 @@ static std::mutex config_lock;  // protects operations on |config|.
 static config_t* config;
 static alarm_t* config_timer;
 
+// The readers' view of |config|: an immutable copy they take without
+// |config_lock|, and keep alive for as long as they use it. The writers only
+// mark it stale, and the first read after them publishes a new copy, so that
+// a burst of writes costs a single copy. It is also what gets saved.
+static std::shared_ptr<const config_t> config_snapshot;
+static std::atomic<bool> config_snapshot_stale;
+
+// The changes to |config| not written to the journal yet, and whether some
+// could not be journaled, so that the next write has to save the whole
+// config instead. Both are protected by |config_lock|.
+static std::string journal_records;
+static bool compaction_needed;
+
+// The journal and config files are written on |config_io_thread|, except on
+// flushes, and serialized by |journal_lock|. When both are held,
+// |journal_lock| is taken first.
+static thread_t* config_io_thread;
+static std::mutex journal_lock;  // protects |journal_fd| and |journal_size|.
+static int journal_fd = -1;
+static size_t journal_size;
+
 // Module lifecycle functions
 
 static future_t* init(void) {
@@ -134,12 +183,12 @@ static future_t* init(void) {
 
   std::string file_source;
 
-  config = btif_config_open(CONFIG_FILE_PATH);
+  config = btif_config_open(CONFIG_FILE_PATH, CONFIG_SNAPSHOT_PATH);
   btif_config_source = ORIGINAL;
   if (!config) {
     LOG_WARN(LOG_TAG, "%s unable to load config file: %s; using backup.",
              __func__, CONFIG_FILE_PATH);
-    config = btif_config_open(CONFIG_BACKUP_PATH);
+    config = btif_config_open(CONFIG_BACKUP_PATH, NULL);
     btif_config_source = BACKUP;
     file_source = "Backup";
   }
@@ -160,14 +209,24 @@ static future_t* init(void) {
     file_source = "Empty";
   }
 
-  if (!file_source.empty())
-    config_set_string(config, INFO_SECTION, FILE_SOURCE, file_source.c_str());
-
   if (!config) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate a config object.", __func__);
     goto error;
   }
 
+  // The journal holds the changes made since the config was last saved
+  size_t journal_records_applied;
+  if (!btif_config_journal_replay(config, CONFIG_JOURNAL_PATH,
+                                  &journal_records_applied))
+    compaction_needed = true;
+  LOG_INFO(LOG_TAG, "%s applied %zu journal records", __func__,
+           journal_records_applied);
+
+  if (!file_source.empty()) {
+    config_set_string(config, INFO_SECTION, FILE_SOURCE, file_source.c_str());
+    journal_set(INFO_SECTION, FILE_SOURCE);
+  }
+
   btif_config_remove_unpaired(config);
 
   // Cleanup temporary pairings if we have left guest mode
@@ -185,6 +244,7 @@ static future_t* init(void) {
              time_created);
     config_set_string(config, INFO_SECTION, FILE_TIMESTAMP,
                       btif_config_time_created);
+    journal_set(INFO_SECTION, FILE_TIMESTAMP);
   }
 
   // TODO(sharvil): use a non-wake alarm for this once we have
@@ -196,8 +256,17 @@ static future_t* init(void) {
     goto error;
   }
 
+  config_io_thread = thread_new("btif_config_io");
+  if (!config_io_thread) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the I/O thread.", __func__);
+    goto error;
+  }
+
   LOG_EVENT_INT(BT_CONFIG_SOURCE_TAG_NUM, btif_config_source);
 
+  config_snapshot_stale = true;
+  btif_config_snapshot_locked();
+
   return future_new_immediate(FUTURE_SUCCESS);
 
 error:
@@ -205,13 +274,28 @@ error:
   config_free(config);
   config_timer = NULL;
   config = NULL;
+  journal_records.clear();
+  compaction_needed = false;
   btif_config_source = NOT_LOADED;
   return future_new_immediate(FUTURE_FAIL);
 }
 
-static config_t* btif_config_open(const char* filename) {
-  config_t* config = config_new(filename);
-  if (!config) return NULL;
+// Loads |filename|, from its binary snapshot |snapshot_filename| if it is
+// not NULL and still up to date.
+static config_t* btif_config_open(const char* filename,
+                                  const char* snapshot_filename) {
+  config_t* config = NULL;
+  if (snapshot_filename)
+    config = config_new_snapshot(snapshot_filename, filename);
+
+  if (!config) {
+    config = config_new(filename);
+    if (!config) return NULL;
+
+    // Spare the parsing on the next load
+    if (snapshot_filename)
+      config_save_snapshot(config, snapshot_filename, filename);
+  }
 
   if (!config_has_section(config, "Adapter")) {
     LOG_ERROR(LOG_TAG, "Config is missing adapter section");
@@ -230,7 +314,15 @@ static future_t* shut_down(void) {
 static future_t* clean_up(void) {
   btif_config_flush();
 
+  thread_free(config_io_thread);
+  config_io_thread = NULL;
+
+  if (journal_fd != -1) close(journal_fd);
+  journal_fd = -1;
+  journal_size = 0;
+
   alarm_free(config_timer);
+  std::atomic_store(&config_snapshot, std::shared_ptr<const config_t>());
   config_free(config);
   config_timer = NULL;
   config = NULL;
@@ -247,8 +339,7 @@ bool btif_config_has_section(const char* section) {
   CHECK(config != NULL);
   CHECK(section != NULL);
 
-  std::unique_lock<std::mutex> lock(config_lock);
-  return config_has_section(config, section);
+  return config_has_section(btif_config_snapshot().get(), section);
 }
 
 bool btif_config_exist(const char* section, const char* key) {
@@ -256,8 +347,7 @@ bool btif_config_exist(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::mutex> lock(config_lock);
-  return config_has_key(config, section, key);
+  return config_has_key(btif_config_snapshot().get(), section, key);
 }
 
 bool btif_config_get_int(const char* section, const char* key, int* value) {
@@ -266,9 +356,9 @@ bool btif_config_get_int(const char* section, const char* key, int* value) {
   CHECK(key != NULL);
   CHECK(value != NULL);
 
-  std::unique_lock<std::mutex> lock(config_lock);
-  bool ret = config_has_key(config, section, key);
-  if (ret) *value = config_get_int(config, section, key, *value);
+  std::shared_ptr<const config_t> snapshot = btif_config_snapshot();
+  bool ret = config_has_key(snapshot.get(), section, key);
+  if (ret) *value = config_get_int(snapshot.get(), section, key, *value);
 
   return ret;
 }
@@ -280,6 +370,8 @@ bool btif_config_set_int(const char* section, const char* key, int value) {
 
   std::unique_lock<std::mutex> lock(config_lock);
   config_set_int(config, section, key, value);
+  config_snapshot_stale = true;
+  journal_set(section, key);
 
   return true;
 }
@@ -293,8 +385,9 @@ bool btif_config_get_str(const char* section, const char* key, char* value,
   CHECK(size_bytes != NULL);
 
   {
-    std::unique_lock<std::mutex> lock(config_lock);
-    const char* stored_value = config_get_string(config, section, key, NULL);
+    std::shared_ptr<const config_t> snapshot = btif_config_snapshot();
+    const char* stored_value =
+        config_get_string(snapshot.get(), section, key, NULL);
     if (!stored_value) return false;
     strlcpy(value, stored_value, *size_bytes);
   }
@@ -312,6 +405,8 @@ bool btif_config_set_str(const char* section, const char* key,
 
   std::unique_lock<std::mutex> lock(config_lock);
   config_set_string(config, section, key, value);
+  config_snapshot_stale = true;
+  journal_set(section, key);
   return true;
 }
 
@@ -323,8 +418,8 @@ bool btif_config_get_bin(const char* section, const char* key, uint8_t* value,
   CHECK(value != NULL);
   CHECK(length != NULL);
 
-  std::unique_lock<std::mutex> lock(config_lock);
-  const char* value_str = config_get_string(config, section, key, NULL);
+  std::shared_ptr<const config_t> snapshot = btif_config_snapshot();
+  const char* value_str = config_get_string(snapshot.get(), section, key, NULL);
 
   if (!value_str) return false;
 
@@ -345,8 +440,8 @@ size_t btif_config_get_bin_length(const char* section, const char* key) {
   CHECK(section != NULL);
   CHECK(key != NULL);
 
-  std::unique_lock<std::mutex> lock(config_lock);
-  const char* value_str = config_get_string(config, section, key, NULL);
+  std::shared_ptr<const config_t> snapshot = btif_config_snapshot();
+  const char* value_str = config_get_string(snapshot.get(), section, key, NULL);
   if (!value_str) return 0;
 
   size_t value_len = strlen(value_str);
@@ -373,6 +468,8 @@ bool btif_config_set_bin(const char* section, const char* key,
   {
     std::unique_lock<std::mutex> lock(config_lock);
     config_set_string(config, section, key, str);
+    config_snapshot_stale = true;
+    journal_set(section, key);
   }
 
   osi_free(str);
@@ -410,14 +507,20 @@ bool btif_config_remove(const char* section, const char* key) {
   CHECK(key != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
-  return config_remove_key(config, section, key);
+  bool ret = config_remove_key(config, section, key);
+  if (ret) {
+    config_snapshot_stale = true;
+    journal_remove(section, key);
+  }
+  return ret;
 }
 
 void btif_config_save(void) {
   CHECK(config != NULL);
   CHECK(config_timer != NULL);
 
-  alarm_set(config_timer, CONFIG_SETTLE_PERIOD_MS, timer_config_save_cb, NULL);
+  alarm_set_with_slack(config_timer, CONFIG_SETTLE_PERIOD_MS,
+                       CONFIG_SETTLE_SLACK_MS, timer_config_save_cb, NULL);
 }
 
 void btif_config_flush(void) {
@@ -425,7 +528,7 @@ void btif_config_flush(void) {
   CHECK(config_timer != NULL);
 
   alarm_cancel(config_timer);
-  btif_config_write(0, NULL);
+  btif_config_write();
 }
 
 bool btif_config_clear(void) {
@@ -434,35 +537,214 @@ bool btif_config_clear(void) {
 
   alarm_cancel(config_timer);
 
+  std::unique_lock<std::mutex> journal_guard(journal_lock);
   std::unique_lock<std::mutex> lock(config_lock);
   config_free(config);
+  journal_records.clear();
+  compaction_needed = false;
 
   config = config_new_empty();
+  config_snapshot_stale = true;
   if (config == NULL) return false;
 
   bool ret = config_save(config, CONFIG_FILE_PATH);
+  if (ret) {
+    config_save_snapshot(config, CONFIG_SNAPSHOT_PATH, CONFIG_FILE_PATH);
+    journal_truncate();
+  }
+  else
+    compaction_needed = true;
   btif_config_source = RESET;
   return ret;
 }
 
 static void timer_config_save_cb(UNUSED_ATTR void* data) {
-  // Moving file I/O to btif context instead of timer callback because
-  // it usually takes a lot of time to be completed, introducing
-  // delays during A2DP playback causing blips or choppiness.
-  btif_transfer_context(btif_config_write, 0, NULL, 0, NULL);
+  // Moving file I/O off the timer callback because it usually takes a lot of
+  // time to be completed, introducing delays during A2DP playback causing
+  // blips or choppiness.
+  thread_post(config_io_thread, config_io_write_cb, NULL);
+}
+
+static void config_io_write_cb(UNUSED_ATTR void* context) {
+  btif_config_write();
 }
 
-static void btif_config_write(UNUSED_ATTR uint16_t event,
-                              UNUSED_ATTR char* p_param) {
+// Appends the pending changes to the journal with a single fsync, or saves
+// the whole config instead once the journal has grown too large.
+static void btif_config_write(void) {
   CHECK(config != NULL);
   CHECK(config_timer != NULL);
 
+  std::unique_lock<std::mutex> journal_guard(journal_lock);
+  std::string records;
+  std::shared_ptr<const config_t> snapshot;
+  {
+    std::unique_lock<std::mutex> lock(config_lock);
+    if (compaction_needed ||
+        journal_size + journal_records.size() > CONFIG_JOURNAL_MAX_SIZE) {
+      // The snapshot includes the pending changes
+      snapshot = btif_config_snapshot_locked();
+      journal_records.clear();
+      compaction_needed = false;
+    } else {
+      records.swap(journal_records);
+    }
+  }
+
+  if (!snapshot) {
+    if (records.empty() || journal_append(records)) return;
+
+    std::unique_lock<std::mutex> lock(config_lock);
+    snapshot = btif_config_snapshot_locked();
+    journal_records.clear();
+  }
+
+  btif_config_compact(snapshot.get());
+}
+
+// Returns the current snapshot of |config|, without taking |config_lock|
+// unless it is stale.
+static std::shared_ptr<const config_t> btif_config_snapshot(void) {
+  // Checked first, so that a snapshot found fresh has every write made
+  // before it was published
+  if (!config_snapshot_stale.load(std::memory_order_acquire)) {
+    std::shared_ptr<const config_t> snapshot =
+        std::atomic_load(&config_snapshot);
+    if (snapshot) return snapshot;
+  }
+
   std::unique_lock<std::mutex> lock(config_lock);
+  return btif_config_snapshot_locked();
+}
+
+// Returns the current snapshot of |config|, publishing a new one if it is
+// stale. |config_lock| must be held.
+static std::shared_ptr<const config_t> btif_config_snapshot_locked(void) {
+  if (!config_snapshot_stale.load(std::memory_order_relaxed))
+    return std::atomic_load(&config_snapshot);
+
+  std::shared_ptr<const config_t> snapshot(
+      config_new_clone(config),
+      [](const config_t* copy) { config_free((config_t*)copy); });
+  std::atomic_store(&config_snapshot, snapshot);
+  config_snapshot_stale.store(false, std::memory_order_release);
+  return snapshot;
+}
+
+// Saves |snapshot|, without the unpaired devices, as the config file and its
+// binary snapshot, and empties the journal. |snapshot| is only copied if it
+// has unpaired devices to leave out. |journal_lock| must be held.
+static void btif_config_compact(const config_t* snapshot) {
+  config_t* paired = NULL;
+  if (btif_config_has_unpaired(snapshot)) {
+    paired = config_new_clone(snapshot);
+    btif_config_remove_unpaired(paired);
+    snapshot = paired;
+  }
+
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
-  config_t* config_paired = config_new_clone(config);
-  btif_config_remove_unpaired(config_paired);
-  config_save(config_paired, CONFIG_FILE_PATH);
-  config_free(config_paired);
+  bool saved = config_save(snapshot, CONFIG_FILE_PATH);
+  if (saved)
+    config_save_snapshot(snapshot, CONFIG_SNAPSHOT_PATH, CONFIG_FILE_PATH);
+  config_free(paired);
+
+  if (!saved) {
+    // Keep the journal, and save again on the next write
+    std::unique_lock<std::mutex> lock(config_lock);
+    compaction_needed = true;
+    return;
+  }
+
+  journal_truncate();
+}
+
+// Appends |records| to the journal and syncs it to disk. Returns false if
+// the records may not have been fully written. |journal_lock| must be held.
+static bool journal_append(const std::string& records) {
+  if (journal_fd == -1) {
+    journal_fd = open(CONFIG_JOURNAL_PATH,
+                      O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+                      S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (journal_fd == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to open journal '%s': %s", __func__,
+                CONFIG_JOURNAL_PATH, strerror(errno));
+      return false;
+    }
+
+    struct stat journal_stat;
+    journal_size = (fstat(journal_fd, &journal_stat) == 0)
+                       ? journal_stat.st_size
+                       : CONFIG_JOURNAL_MAX_SIZE;
+  }
+
+  const char* data = records.data();
+  size_t remaining = records.size();
+  while (remaining > 0) {
+    ssize_t written;
+    OSI_NO_INTR(written = write(journal_fd, data, remaining));
+    if (written == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to write journal '%s': %s", __func__,
+                CONFIG_JOURNAL_PATH, strerror(errno));
+      return false;
+    }
+    data += written;
+    remaining -= written;
+    journal_size += written;
+  }
+
+  if (fsync(journal_fd) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to fsync journal '%s': %s", __func__,
+              CONFIG_JOURNAL_PATH, strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+// Empties the journal once its records are in the config file.
+// |journal_lock| must be held.
+static void journal_truncate(void) {
+  int ret = (journal_fd != -1) ? ftruncate(journal_fd, 0)
+                               : truncate(CONFIG_JOURNAL_PATH, 0);
+  if (ret == -1 && errno != ENOENT) {
+    LOG_WARN(LOG_TAG, "%s unable to truncate journal '%s': %s", __func__,
+             CONFIG_JOURNAL_PATH, strerror(errno));
+  }
+  journal_size = 0;
+}
+
+// Journals the current value of |key| in |section|. |config_lock| must be
+// held.
+static void journal_set(const char* section, const char* key) {
+  const char* value = config_get_string(config, section, key, NULL);
+  if (value == NULL ||
+      !btif_config_journal_add_set(&journal_records, section, key, value))
+    compaction_needed = true;
+}
+
+// Journals the removal of |key| in |section|. |config_lock| must be held.
+static void journal_remove(const char* section, const char* key) {
+  if (!btif_config_journal_add_remove(&journal_records, section, key))
+    compaction_needed = true;
+}
+
+// Returns true if |section| of |conf| is a device with no keys.
+static bool btif_config_is_unpaired(const config_t* conf, const char* section) {
+  return string_is_bdaddr(section) &&
+         !config_has_key(conf, section, "LinkKey") &&
+         !config_has_key(conf, section, "LE_KEY_PENC") &&
+         !config_has_key(conf, section, "LE_KEY_PID") &&
+         !config_has_key(conf, section, "LE_KEY_PCSRK") &&
+         !config_has_key(conf, section, "LE_KEY_LENC") &&
+         !config_has_key(conf, section, "LE_KEY_LCSRK");
+}
+
+static bool btif_config_has_unpaired(const config_t* conf) {
+  for (const config_section_node_t* snode = config_section_begin(conf);
+       snode != config_section_end(conf); snode = config_section_next(snode)) {
+    if (btif_config_is_unpaired(conf, config_section_name(snode))) return true;
+  }
+  return false;
 }
 
 static void btif_config_remove_unpaired(config_t* conf) {
@@ -475,19 +757,12 @@ static void btif_config_remove_unpaired(config_t* conf) {
   const config_section_node_t* snode = config_section_begin(conf);
   while (snode != config_section_end(conf)) {
     const char* section = config_section_name(snode);
-    if (string_is_bdaddr(section)) {
-      if (!config_has_key(conf, section, "LinkKey") &&
-          !config_has_key(conf, section, "LE_KEY_PENC") &&
-          !config_has_key(conf, section, "LE_KEY_PID") &&
-          !config_has_key(conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(conf, section, "LE_KEY_LENC") &&
-          !config_has_key(conf, section, "LE_KEY_LCSRK")) {
-        snode = config_section_next(snode);
-        config_remove_section(conf, section);
-        continue;
-      }
-      paired_devices++;
+    if (btif_config_is_unpaired(conf, section)) {
+      snode = config_section_next(snode);
+      config_remove_section(conf, section);
+      continue;
     }
+    if (string_is_bdaddr(section)) paired_devices++;
     snode = config_section_next(snode);
   }
 
@@ -523,8 +798,15 @@ void btif_debug_config_dump(int fd) {
 
   dprintf(fd, "  Devices loaded: %d\n", btif_config_devices_loaded);
   dprintf(fd, "  File created/tagged: %s\n", btif_config_time_created);
+  std::shared_ptr<const config_t> snapshot = btif_config_snapshot();
   dprintf(fd, "  File source: %s\n",
-          config_get_string(config, INFO_SECTION, FILE_SOURCE, "Original"));
+          snapshot ? config_get_string(snapshot.get(), INFO_SECTION,
+                                       FILE_SOURCE, "Original")
+                   : "Original");
+  {
+    std::unique_lock<std::mutex> lock(journal_lock);
+    dprintf(fd, "  Journal size: %zu bytes\n", journal_size);
+  }
 }
 
 static void btif_config_remove_restricted(config_t* config) {
@@ -551,5 +833,7 @@ static bool is_factory_reset(void) {
 static void delete_config_files(void) {
   remove(CONFIG_FILE_PATH);
   remove(CONFIG_BACKUP_PATH);
+  remove(CONFIG_JOURNAL_PATH);
+  remove(CONFIG_SNAPSHOT_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
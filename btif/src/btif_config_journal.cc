@@ -0,0 +1,150 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_config_journal"
+
+#include "btif_config_journal.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osi/include/config.h"
+#include "osi/include/log.h"
+
+// A record is a line of tab separated fields, starting with its type:
+//   S <section> <key> <value>
+//   R <section> <key>
+#define JOURNAL_RECORD_SET 'S'
+#define JOURNAL_RECORD_REMOVE 'R'
+#define JOURNAL_MAX_FIELDS 4
+
+static bool is_journalable(const char* field);
+static bool apply_record(config_t* config, char* line);
+
+bool btif_config_journal_add_set(std::string* records, const char* section,
+                                 const char* key, const char* value) {
+  CHECK(records != NULL);
+  CHECK(section != NULL);
+  CHECK(key != NULL);
+  CHECK(value != NULL);
+
+  if (!is_journalable(section) || !is_journalable(key) ||
+      !is_journalable(value))
+    return false;
+
+  records->push_back(JOURNAL_RECORD_SET);
+  records->append("\t").append(section);
+  records->append("\t").append(key);
+  records->append("\t").append(value);
+  records->push_back('\n');
+  return true;
+}
+
+bool btif_config_journal_add_remove(std::string* records, const char* section,
+                                    const char* key) {
+  CHECK(records != NULL);
+  CHECK(section != NULL);
+  CHECK(key != NULL);
+
+  if (!is_journalable(section) || !is_journalable(key)) return false;
+
+  records->push_back(JOURNAL_RECORD_REMOVE);
+  records->append("\t").append(section);
+  records->append("\t").append(key);
+  records->push_back('\n');
+  return true;
+}
+
+bool btif_config_journal_replay(config_t* config, const char* filename,
+                                size_t* applied) {
+  CHECK(config != NULL);
+  CHECK(filename != NULL);
+
+  if (applied) *applied = 0;
+
+  FILE* fp = fopen(filename, "rt");
+  if (!fp) {
+    if (errno == ENOENT) return true;
+    LOG_ERROR(LOG_TAG, "%s unable to open journal '%s': %s", __func__,
+              filename, strerror(errno));
+    return false;
+  }
+
+  bool intact = true;
+  char* line = NULL;
+  size_t line_size = 0;
+  ssize_t length;
+  while ((length = getline(&line, &line_size, fp)) != -1) {
+    // A record is only complete once its newline is written: a missing one
+    // is the tail of a write cut short.
+    if (line[length - 1] != '\n') {
+      LOG_WARN(LOG_TAG, "%s ignoring torn record at the end of '%s'",
+               __func__, filename);
+      intact = false;
+      break;
+    }
+    line[length - 1] = '\0';
+
+    if (!apply_record(config, line)) {
+      LOG_ERROR(LOG_TAG, "%s corrupted record in '%s'; ignoring the rest",
+                __func__, filename);
+      intact = false;
+      break;
+    }
+    if (applied) ++*applied;
+  }
+
+  free(line);
+  fclose(fp);
+  return intact;
+}
+
+static bool is_journalable(const char* field) {
+  return strpbrk(field, "\t\n") == NULL;
+}
+
+// Applies the record |line|, without its newline, to |config|. Returns false
+// if the record is malformed.
+static bool apply_record(config_t* config, char* line) {
+  char* fields[JOURNAL_MAX_FIELDS];
+  size_t count = 0;
+  for (char* field = line; field != NULL && count < JOURNAL_MAX_FIELDS;
+       count++) {
+    fields[count] = field;
+    field = strchr(field, '\t');
+    if (field) *field++ = '\0';
+  }
+
+  if (strlen(fields[0]) != 1 || count < 3) return false;
+
+  switch (fields[0][0]) {
+    case JOURNAL_RECORD_SET:
+      if (count != 4 || strchr(fields[3], '\t')) return false;
+      config_set_string(config, fields[1], fields[2], fields[3]);
+      return true;
+    case JOURNAL_RECORD_REMOVE:
+      if (count != 3) return false;
+      config_remove_key(config, fields[1], fields[2]);
+      return true;
+    default:
+      return false;
+  }
+}
@@ -34,7 +34,9 @@
 #include <base/threading/thread.h>
 #include <ctype.h>
 #include <dirent.h>
+#include <dlfcn.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <hardware/bluetooth.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,6 +44,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <mutex>
+
 #include "bdaddr.h"
 #include "bt_common.h"
 #include "bt_utils.h"
@@ -62,8 +66,10 @@
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/pool.h"
 #include "osi/include/properties.h"
 #include "osi/include/thread.h"
+#include "osi/include/time.h"
 #include "stack_manager.h"
 
 /*******************************************************************************
@@ -102,6 +108,25 @@ typedef union {
   btif_storage_write_t write_req;
 } btif_storage_req_t;
 
+/* The context switches with at most this many octets of parameters, which
+ * covers the common BTA events, take their message from a preallocated pool
+ * instead of the heap */
+#define BTIF_CONTEXT_SWITCH_POOL_PARAM_LEN 256
+#define BTIF_CONTEXT_SWITCH_POOL_SIZE 64
+
+/* The number of context switch callbacks with their own statistics. The
+ * callbacks beyond it are accounted together. */
+#define BTIF_CONTEXT_SWITCH_STATS_MAX 32
+
+typedef struct {
+  tBTIF_CBACK* p_cb;        /* NULL for the callbacks beyond the table */
+  uint64_t count;           /* Number of context switches */
+  uint64_t heap_count;      /* Number of messages allocated from the heap */
+  uint64_t window_start_ms; /* Start of the current one second window */
+  uint32_t window_count;    /* Number of context switches in the window */
+  uint32_t peak_per_sec;    /* Most context switches in a window */
+} btif_context_switch_stats_t;
+
 typedef enum {
   BTIF_CORE_STATE_DISABLED = 0,
   BTIF_CORE_STATE_ENABLING,
@@ -129,6 +154,11 @@ static uid_set_t* uid_set = NULL;
 base::MessageLoop* message_loop_ = NULL;
 base::RunLoop* jni_run_loop = NULL;
 
+static pool_t* btif_context_switch_pool = NULL;
+static btif_context_switch_stats_t
+    btif_context_switch_stats[BTIF_CONTEXT_SWITCH_STATS_MAX + 1];
+static std::mutex btif_context_switch_stats_mutex;
+
 /*******************************************************************************
  *  Static functions
  ******************************************************************************/
@@ -137,6 +167,7 @@ static void btif_jni_disassociate();
 
 /* sends message to btif task */
 static void btif_sendmsg(void* p_msg);
+static void btif_context_switch_account(tBTIF_CBACK* p_cback, bool from_heap);
 
 /*******************************************************************************
  *  Externs
@@ -189,8 +220,17 @@ static void btif_context_switched(void* p_msg) {
 bt_status_t btif_transfer_context(tBTIF_CBACK* p_cback, uint16_t event,
                                   char* p_params, int param_len,
                                   tBTIF_COPY_CBACK* p_copy_cback) {
-  tBTIF_CONTEXT_SWITCH_CBACK* p_msg = (tBTIF_CONTEXT_SWITCH_CBACK*)osi_malloc(
-      sizeof(tBTIF_CONTEXT_SWITCH_CBACK) + param_len);
+  /* The message is freed with osi_free, which returns pool buffers to their
+   * pool */
+  tBTIF_CONTEXT_SWITCH_CBACK* p_msg = NULL;
+  pool_t* pool = btif_context_switch_pool;
+  if (pool != NULL && param_len <= BTIF_CONTEXT_SWITCH_POOL_PARAM_LEN)
+    p_msg = (tBTIF_CONTEXT_SWITCH_CBACK*)pool_alloc(pool);
+  btif_context_switch_account(p_cback, p_msg == NULL);
+  if (p_msg == NULL) {
+    p_msg = (tBTIF_CONTEXT_SWITCH_CBACK*)osi_malloc(
+        sizeof(tBTIF_CONTEXT_SWITCH_CBACK) + param_len);
+  }
 
   BTIF_TRACE_VERBOSE("btif_transfer_context event %d, len %d", event,
                      param_len);
@@ -213,6 +253,71 @@ bt_status_t btif_transfer_context(tBTIF_CBACK* p_cback, uint16_t event,
   return BT_STATUS_SUCCESS;
 }
 
+static void btif_context_switch_account(tBTIF_CBACK* p_cback,
+                                        bool from_heap) {
+  uint64_t now_ms = time_get_os_boottime_ms();
+  std::lock_guard<std::mutex> lock(btif_context_switch_stats_mutex);
+
+  btif_context_switch_stats_t* stats = NULL;
+  for (int i = 0; i < BTIF_CONTEXT_SWITCH_STATS_MAX; i++) {
+    stats = &btif_context_switch_stats[i];
+    if (stats->p_cb == p_cback) break;
+    if (stats->p_cb == NULL) {
+      stats->p_cb = p_cback;
+      break;
+    }
+    stats = NULL;
+  }
+  if (stats == NULL)
+    stats = &btif_context_switch_stats[BTIF_CONTEXT_SWITCH_STATS_MAX];
+
+  stats->count++;
+  if (from_heap) stats->heap_count++;
+  if (now_ms - stats->window_start_ms >= 1000) {
+    stats->window_start_ms = now_ms;
+    stats->window_count = 0;
+  }
+  stats->window_count++;
+  if (stats->window_count > stats->peak_per_sec)
+    stats->peak_per_sec = stats->window_count;
+}
+
+void btif_debug_context_switch_dump(int fd) {
+  std::lock_guard<std::mutex> lock(btif_context_switch_stats_mutex);
+
+  dprintf(fd, "\nBTIF Context Switches:\n");
+  if (btif_context_switch_pool != NULL) {
+    dprintf(fd, "  Pool buffers (available/total): %zu / %zu, exhausted: %zu\n",
+            pool_available(btif_context_switch_pool),
+            pool_capacity(btif_context_switch_pool),
+            pool_exhausted_count(btif_context_switch_pool));
+  }
+  dprintf(fd, "  %-48s %10s %10s %10s\n", "Callback", "Count", "Heap",
+          "Peak/s");
+  for (int i = 0; i <= BTIF_CONTEXT_SWITCH_STATS_MAX; i++) {
+    const btif_context_switch_stats_t* stats = &btif_context_switch_stats[i];
+    if (stats->count == 0) continue;
+
+    /* Most callbacks are static: name them by their offset in the library
+     * when they have no symbol */
+    char name[64] = "(other)";
+    Dl_info info;
+    if (stats->p_cb != NULL && dladdr((void*)stats->p_cb, &info) != 0) {
+      if (info.dli_sname != NULL) {
+        snprintf(name, sizeof(name), "%s", info.dli_sname);
+      } else {
+        const char* lib = strrchr(info.dli_fname, '/');
+        snprintf(name, sizeof(name), "%s+0x%" PRIxPTR,
+                 (lib != NULL) ? lib + 1 : info.dli_fname,
+                 (uintptr_t)stats->p_cb - (uintptr_t)info.dli_fbase);
+      }
+    }
+    dprintf(fd, "  %-48.48s %10llu %10llu %10u\n", name,
+            (unsigned long long)stats->count,
+            (unsigned long long)stats->heap_count, stats->peak_per_sec);
+  }
+}
+
 /**
  * This function posts a task into the btif message loop, that executes it in
  * the JNI message loop.
@@ -347,6 +452,11 @@ void run_message_loop(UNUSED_ATTR void* context) {
 bt_status_t btif_init_bluetooth() {
   bte_main_boot_entry();
 
+  btif_context_switch_pool =
+      pool_new(sizeof(tBTIF_CONTEXT_SWITCH_CBACK) +
+                   BTIF_CONTEXT_SWITCH_POOL_PARAM_LEN,
+               BTIF_CONTEXT_SWITCH_POOL_SIZE);
+
   bt_jni_workqueue_thread = thread_new(BT_JNI_WORKQUEUE_NAME);
   if (bt_jni_workqueue_thread == NULL) {
     LOG_ERROR(LOG_TAG, "%s Unable to create thread %s", __func__,
@@ -513,6 +623,10 @@ bt_status_t btif_cleanup_bluetooth(void) {
   thread_free(bt_jni_workqueue_thread);
   bt_jni_workqueue_thread = NULL;
 
+  /* The buffers still in flight are released once freed */
+  pool_free(btif_context_switch_pool);
+  btif_context_switch_pool = NULL;
+
   bte_main_cleanup();
 
   btif_dut_mode = 0;
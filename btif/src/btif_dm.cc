@@ -347,14 +347,17 @@ static bool check_eir_remote_name(tBTA_DM_SEARCH* p_search_data,
 
   /* Check EIR for remote name and services */
   if (p_search_data->inq_res.p_eir) {
-    p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-        p_search_data->inq_res.p_eir, p_search_data->inq_res.eir_len,
-        BTM_EIR_COMPLETE_LOCAL_NAME_TYPE, &remote_name_len);
-    if (!p_eir_remote_name) {
-      p_eir_remote_name = AdvertiseDataParser::GetFieldByType(
-          p_search_data->inq_res.p_eir, p_search_data->inq_res.eir_len,
-          BTM_EIR_SHORTENED_LOCAL_NAME_TYPE, &remote_name_len);
-    }
+    /* the complete name, or the shortened one, in a single pass */
+    const uint8_t name_types[] = {BTM_EIR_COMPLETE_LOCAL_NAME_TYPE,
+                                  BTM_EIR_SHORTENED_LOCAL_NAME_TYPE};
+    AdvertiseDataParser::Field names[2];
+    AdvertiseDataParser::GetFieldsByType(p_search_data->inq_res.p_eir,
+                                         p_search_data->inq_res.eir_len,
+                                         name_types, 2, names);
+    const AdvertiseDataParser::Field& name =
+        (names[0].data != NULL) ? names[0] : names[1];
+    p_eir_remote_name = name.data;
+    remote_name_len = name.len;
 
     if (p_eir_remote_name) {
       if (remote_name_len > BD_NAME_LEN) remote_name_len = BD_NAME_LEN;
@@ -2505,6 +2508,8 @@ bt_status_t btif_dm_get_remote_services(bt_bdaddr_t* remote_addr) {
   BTIF_TRACE_EVENT("%s: remote_addr=%s", __func__,
                    bdaddr_to_string(remote_addr, bdstr, sizeof(bdstr)));
 
+  /* Asked for the services as they are now, not as SDP cached them */
+  btif_storage_invalidate_sdp_cache(remote_addr);
   BTA_DmDiscover(remote_addr->address, BTA_ALL_SERVICE_MASK,
                  bte_dm_search_services_evt, true);
 
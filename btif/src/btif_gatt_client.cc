@@ -47,9 +47,11 @@
 #include "btif_config.h"
 #include "btif_dm.h"
 #include "btif_gatt.h"
+#include "btif_gatt_notify_batch.h"
 #include "btif_gatt_util.h"
 #include "btif_storage.h"
 #include "osi/include/log.h"
+#include "osi/include/properties.h"
 #include "vendor_api.h"
 
 using base::Bind;
@@ -84,6 +86,12 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
     }                                                            \
   } while (0)
 
+/* Set to "true" to deliver the notifications in batches, without a context
+ * transfer for each of them. Read once, when the first event is received. */
+#define BTIF_GATTC_NOTIFY_BATCH_PROPERTY "persist.bluetooth.gatt.notify_batch"
+#define BTIF_GATTC_NOTIFY_RING_SIZE 4096 /* octets per connection */
+#define BTIF_GATTC_NOTIFY_BATCH_SIZE 16
+
 #define BLE_RESOLVE_ADDR_MSB                                                   \
   0x40                             /* bit7, bit6 is 01 to be resolvable random \
                                       */
@@ -95,6 +103,46 @@ namespace {
 
 uint8_t rssi_request_client_if;
 
+void btif_gattc_notify(const tBTA_GATTC_NOTIFY* notify) {
+  btgatt_notify_params_t data;
+
+  bdcpy(data.bda.address, notify->bda);
+  memcpy(data.value, notify->value, notify->len);
+
+  data.handle = notify->handle;
+  data.is_notify = notify->is_notify;
+  data.len = notify->len;
+
+  HAL_CBACK(bt_gatt_callbacks, client->notify_cb, notify->conn_id, &data);
+
+  if (notify->is_notify == false)
+    BTA_GATTC_SendIndConfirm(notify->conn_id, notify->handle);
+}
+
+void btif_gattc_notify_batch_cb(const tBTA_GATTC_NOTIFY* notify,
+                                size_t count) {
+  for (size_t i = 0; i < count; i++) btif_gattc_notify(&notify[i]);
+}
+
+/* The batch is kept for the lifetime of the process, as the drains posted to
+ * the JNI thread refer to it. It is NULL when batching is not enabled. */
+btif_gatt_notify_batch_t* btif_gattc_get_notify_batch() {
+  static bool initialized = false;
+  static btif_gatt_notify_batch_t* notify_batch = NULL;
+
+  if (!initialized) {
+    char value[PROPERTY_VALUE_MAX] = {'\0'};
+    osi_property_get(BTIF_GATTC_NOTIFY_BATCH_PROPERTY, value, "false");
+    if (strcmp(value, "true") == 0) {
+      notify_batch = btif_gatt_notify_batch_new(BTIF_GATTC_NOTIFY_RING_SIZE,
+                                                BTIF_GATTC_NOTIFY_BATCH_SIZE,
+                                                btif_gattc_notify_batch_cb);
+    }
+    initialized = true;
+  }
+  return notify_batch;
+}
+
 void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
   LOG_VERBOSE(LOG_TAG, "%s: Event %d", __func__, event);
 
@@ -115,24 +163,9 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
       break;
     }
 
-    case BTA_GATTC_NOTIF_EVT: {
-      btgatt_notify_params_t data;
-
-      bdcpy(data.bda.address, p_data->notify.bda);
-      memcpy(data.value, p_data->notify.value, p_data->notify.len);
-
-      data.handle = p_data->notify.handle;
-      data.is_notify = p_data->notify.is_notify;
-      data.len = p_data->notify.len;
-
-      HAL_CBACK(bt_gatt_callbacks, client->notify_cb, p_data->notify.conn_id,
-                &data);
-
-      if (p_data->notify.is_notify == false)
-        BTA_GATTC_SendIndConfirm(p_data->notify.conn_id, p_data->notify.handle);
-
+    case BTA_GATTC_NOTIF_EVT:
+      btif_gattc_notify(&p_data->notify);
       break;
-    }
 
     case BTA_GATTC_OPEN_EVT: {
       bt_bdaddr_t bda;
@@ -200,6 +233,18 @@ void btif_gattc_upstreams_evt(uint16_t event, char* p_param) {
 }
 
 void bta_gattc_cback(tBTA_GATTC_EVT event, tBTA_GATTC* p_data) {
+  btif_gatt_notify_batch_t* notify_batch = btif_gattc_get_notify_batch();
+  if (notify_batch != NULL) {
+    if (event == BTA_GATTC_NOTIF_EVT) {
+      if (btif_gatt_notify_batch_put(notify_batch, &p_data->notify))
+        do_in_jni_thread(Bind(&btif_gatt_notify_batch_drain, notify_batch));
+      return;
+    }
+    /* the notifications already queued are delivered before the close */
+    if (event == BTA_GATTC_CLOSE_EVT)
+      btif_gatt_notify_batch_close(notify_batch, p_data->close.conn_id);
+  }
+
   bt_status_t status =
       btif_transfer_context(btif_gattc_upstreams_evt, (uint16_t)event,
                             (char*)p_data, sizeof(tBTA_GATTC), NULL);
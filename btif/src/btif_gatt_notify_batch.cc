@@ -0,0 +1,227 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_gatt_notify_batch"
+
+#include "btif_gatt_notify_batch.h"
+
+#include <base/logging.h>
+#include <string.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/ringbuffer.h"
+
+// The header queued before the value of each notification.
+typedef struct {
+  BD_ADDR bda;
+  uint16_t handle;
+  uint16_t len;
+  bool is_notify;
+} notify_record_t;
+
+typedef struct {
+  ringbuffer_t* ring;
+  bool closed;  // The ring is freed once empty
+} notify_conn_t;
+
+struct btif_gatt_notify_batch_t {
+  size_t ring_size;
+  size_t batch_size;
+  btif_gatt_notify_batch_cb callback;
+
+  mutable std::mutex mutex;  // Protects the fields below
+  std::unordered_map<uint16_t, notify_conn_t> conns;
+  bool drain_pending;
+  size_t dropped;
+
+  // The notifications being delivered, only used by the drain.
+  tBTA_GATTC_NOTIFY* notify;
+};
+
+static bool conn_pop_locked(notify_conn_t* conn, uint16_t conn_id,
+                            tBTA_GATTC_NOTIFY* notify);
+static void conn_drop_oldest_locked(notify_conn_t* conn);
+
+btif_gatt_notify_batch_t* btif_gatt_notify_batch_new(
+    size_t ring_size, size_t batch_size, btif_gatt_notify_batch_cb callback) {
+  CHECK(ring_size >= sizeof(notify_record_t) + BTA_GATT_MAX_ATTR_LEN);
+  CHECK(batch_size > 0);
+  CHECK(callback != NULL);
+
+  btif_gatt_notify_batch_t* batch = new btif_gatt_notify_batch_t;
+  batch->ring_size = ring_size;
+  batch->batch_size = batch_size;
+  batch->callback = callback;
+  batch->drain_pending = false;
+  batch->dropped = 0;
+  batch->notify = static_cast<tBTA_GATTC_NOTIFY*>(
+      osi_malloc(sizeof(tBTA_GATTC_NOTIFY) * batch_size));
+  return batch;
+}
+
+void btif_gatt_notify_batch_free(btif_gatt_notify_batch_t* batch) {
+  if (batch == NULL) return;
+
+  for (auto& it : batch->conns) ringbuffer_free(it.second.ring);
+  osi_free(batch->notify);
+  delete batch;
+}
+
+bool btif_gatt_notify_batch_put(btif_gatt_notify_batch_t* batch,
+                                const tBTA_GATTC_NOTIFY* notify) {
+  CHECK(batch != NULL);
+  CHECK(notify != NULL);
+
+  notify_record_t record;
+  memcpy(record.bda, notify->bda, sizeof(BD_ADDR));
+  record.handle = notify->handle;
+  record.len = notify->len;
+  record.is_notify = notify->is_notify;
+  size_t length = sizeof(record) + record.len;
+
+  std::lock_guard<std::mutex> lock(batch->mutex);
+
+  auto it = batch->conns.find(notify->conn_id);
+  if (it == batch->conns.end()) {
+    notify_conn_t conn;
+    conn.ring = ringbuffer_init(batch->ring_size);
+    if (conn.ring == NULL) {
+      LOG_ERROR(LOG_TAG, "%s unable to allocate the ring of conn_id %d",
+                __func__, notify->conn_id);
+      batch->dropped++;
+      return false;
+    }
+    it = batch->conns.emplace(notify->conn_id, conn).first;
+  }
+
+  // The connection id may be reused for a new connection.
+  notify_conn_t* conn = &it->second;
+  conn->closed = false;
+
+  if (ringbuffer_available(conn->ring) < length) {
+    if (notify->is_notify) {
+      batch->dropped++;
+      return false;
+    }
+    while (ringbuffer_available(conn->ring) < length) {
+      conn_drop_oldest_locked(conn);
+      batch->dropped++;
+    }
+  }
+
+  ringbuffer_insert(conn->ring, reinterpret_cast<const uint8_t*>(&record),
+                    sizeof(record));
+  ringbuffer_insert(conn->ring, notify->value, record.len);
+
+  // A ring is never left with notifications without a drain pending.
+  if (batch->drain_pending) return false;
+  batch->drain_pending = true;
+  return true;
+}
+
+void btif_gatt_notify_batch_close(btif_gatt_notify_batch_t* batch,
+                                  uint16_t conn_id) {
+  CHECK(batch != NULL);
+
+  std::lock_guard<std::mutex> lock(batch->mutex);
+
+  auto it = batch->conns.find(conn_id);
+  if (it == batch->conns.end()) return;
+
+  if (ringbuffer_size(it->second.ring) == 0) {
+    ringbuffer_free(it->second.ring);
+    batch->conns.erase(it);
+  } else {
+    it->second.closed = true;
+  }
+}
+
+void btif_gatt_notify_batch_drain(btif_gatt_notify_batch_t* batch) {
+  CHECK(batch != NULL);
+
+  while (true) {
+    size_t count = 0;
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+
+      // One notification per connection and per round.
+      bool popped = true;
+      while (popped && count < batch->batch_size) {
+        popped = false;
+        for (auto& it : batch->conns) {
+          if (count == batch->batch_size) break;
+          if (conn_pop_locked(&it.second, it.first, &batch->notify[count])) {
+            count++;
+            popped = true;
+          }
+        }
+      }
+
+      for (auto it = batch->conns.begin(); it != batch->conns.end();) {
+        if (it->second.closed && ringbuffer_size(it->second.ring) == 0) {
+          ringbuffer_free(it->second.ring);
+          it = batch->conns.erase(it);
+        } else {
+          ++it;
+        }
+      }
+
+      if (count == 0) {
+        batch->drain_pending = false;
+        return;
+      }
+    }
+
+    batch->callback(batch->notify, count);
+  }
+}
+
+size_t btif_gatt_notify_batch_get_dropped(
+    const btif_gatt_notify_batch_t* batch) {
+  CHECK(batch != NULL);
+
+  std::lock_guard<std::mutex> lock(batch->mutex);
+  return batch->dropped;
+}
+
+static bool conn_pop_locked(notify_conn_t* conn, uint16_t conn_id,
+                            tBTA_GATTC_NOTIFY* notify) {
+  notify_record_t record;
+  if (ringbuffer_pop(conn->ring, reinterpret_cast<uint8_t*>(&record),
+                     sizeof(record)) != sizeof(record))
+    return false;
+
+  notify->conn_id = conn_id;
+  memcpy(notify->bda, record.bda, sizeof(BD_ADDR));
+  notify->handle = record.handle;
+  notify->len = record.len;
+  notify->is_notify = record.is_notify;
+  ringbuffer_pop(conn->ring, notify->value, record.len);
+  return true;
+}
+
+static void conn_drop_oldest_locked(notify_conn_t* conn) {
+  notify_record_t record;
+  ringbuffer_peek(conn->ring, 0, reinterpret_cast<uint8_t*>(&record),
+                  sizeof(record));
+  ringbuffer_delete(conn->ring, sizeof(record) + record.len);
+}
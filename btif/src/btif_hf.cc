@@ -385,7 +385,8 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
       if (btif_hf_cb[idx].state == BTHF_CONNECTION_STATE_DISCONNECTED)
         bdsetany(btif_hf_cb[idx].connected_bda.address);
 
-      if (p_data->open.status != BTA_AG_SUCCESS) btif_queue_advance();
+      if (p_data->open.status != BTA_AG_SUCCESS)
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE);
       break;
 
     case BTA_AG_CLOSE_EVT:
@@ -405,7 +406,7 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
       *seconds),
       ** then AG_CLOSE may be received. We need to advance the queue here
       */
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE);
       break;
 
     case BTA_AG_CONN_EVT:
@@ -417,7 +418,7 @@ static void btif_hf_upstreams_evt(uint16_t event, char* p_param) {
 
       HAL_CBACK(bt_hf_callbacks, connection_state_cb, btif_hf_cb[idx].state,
                 &btif_hf_cb[idx].connected_bda);
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_AG_HANDSFREE);
       break;
 
     case BTA_AG_AUDIO_OPEN_EVT:
@@ -47,6 +47,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+#include <vector>
+
 #include <hardware/bluetooth.h>
 #include <hardware/bt_hf_client.h>
 
@@ -136,6 +139,18 @@ char btif_hf_client_version[PROPERTY_VALUE_MAX];
 
 static btif_hf_client_cb_arr_t btif_hf_client_cb_arr;
 
+/* The BTA events not yet executed in btif context. A phone sends the
+ * indicators, the calls and the subscriber numbers in bursts: the events
+ * received while btif is busy are executed together, in a single context
+ * switch, rather than one at a time. */
+typedef struct {
+  uint16_t event;
+  tBTA_HF_CLIENT data;
+} btif_hf_client_evt_t;
+
+static std::mutex pending_evts_mutex;
+static std::vector<btif_hf_client_evt_t> pending_evts;
+
 /*******************************************************************************
  *  Static functions
  ******************************************************************************/
@@ -858,7 +873,8 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
       if (cb->state == BTHF_CLIENT_CONNECTION_STATE_DISCONNECTED)
         bdsetany(cb->peer_bda.address);
 
-      if (p_data->open.status != BTA_HF_CLIENT_SUCCESS) btif_queue_advance();
+      if (p_data->open.status != BTA_HF_CLIENT_SUCCESS)
+        btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE);
       break;
 
     case BTA_HF_CLIENT_CONN_EVT:
@@ -875,7 +891,7 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
                   BTHF_CLIENT_IN_BAND_RINGTONE_PROVIDED);
       }
 
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE);
       break;
 
     case BTA_HF_CLIENT_CLOSE_EVT:
@@ -885,7 +901,7 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
       bdsetany(cb->peer_bda.address);
       cb->peer_feat = 0;
       cb->chld_feat = 0;
-      btif_queue_advance();
+      btif_queue_advance_by_uuid(UUID_SERVCLASS_HF_HANDSFREE);
       break;
 
     case BTA_HF_CLIENT_IND_EVT:
@@ -997,6 +1013,29 @@ static void btif_hf_client_upstreams_evt(uint16_t event, char* p_param) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_hf_client_pending_evts
+ *
+ * Description      Executes the pending HF CLIENT UPSTREAMS events in btif
+ *                  context, in the order they were received
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btif_hf_client_pending_evts(UNUSED_ATTR uint16_t event,
+                                        UNUSED_ATTR char* p_param) {
+  std::vector<btif_hf_client_evt_t> evts;
+  {
+    std::lock_guard<std::mutex> lock(pending_evts_mutex);
+    evts.swap(pending_evts);
+  }
+
+  BTIF_TRACE_DEBUG("%s: %zu events", __func__, evts.size());
+  for (btif_hf_client_evt_t& evt : evts)
+    btif_hf_client_upstreams_evt(evt.event, (char*)&evt.data);
+}
+
 /*******************************************************************************
  *
  * Function         bta_hf_client_evt
@@ -1011,10 +1050,21 @@ static void bta_hf_client_evt(tBTA_HF_CLIENT_EVT event,
                               tBTA_HF_CLIENT* p_data) {
   bt_status_t status;
 
-  /* switch context to btif task context (copy full union size for convenience)
-   */
-  status = btif_transfer_context(btif_hf_client_upstreams_evt, (uint16_t)event,
-                                 (char*)p_data, sizeof(*p_data), NULL);
+  /* the events are queued (copying full union size for convenience): a
+   * context switch is only needed if none is pending already */
+  {
+    std::lock_guard<std::mutex> lock(pending_evts_mutex);
+    bool switch_pending = !pending_evts.empty();
+    btif_hf_client_evt_t evt;
+    evt.event = (uint16_t)event;
+    evt.data = *p_data;
+    pending_evts.push_back(evt);
+    if (switch_pending) return;
+  }
+
+  /* switch context to btif task context */
+  status = btif_transfer_context(btif_hf_client_pending_evts, (uint16_t)event,
+                                 NULL, 0, NULL);
 
   /* catch any failed context transfers */
   ASSERTC(status == BT_STATUS_SUCCESS, "context transfer failed", status);
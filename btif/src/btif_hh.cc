@@ -38,6 +38,7 @@
 
 #include "bt_common.h"
 #include "bta_api.h"
+#include "btcore/include/bdaddr.h"
 #include "btif_common.h"
 #include "btif_storage.h"
 #include "btif_util.h"
@@ -510,8 +511,6 @@ void btif_hh_remove_device(bt_bdaddr_t bd_addr) {
     BTIF_TRACE_WARNING("%s: device_num = 0", __func__);
   }
 
-  p_dev->hh_keep_polling = 0;
-  p_dev->hh_poll_thread_id = -1;
   BTIF_TRACE_DEBUG("%s: uhid fd = %d", __func__, p_dev->fd);
   if (p_dev->fd >= 0) {
     bta_hh_co_destroy(p_dev->fd);
@@ -1234,6 +1233,7 @@ static bt_status_t init(bthh_callbacks_t* callbacks) {
   for (i = 0; i < BTIF_HH_MAX_HID; i++) {
     btif_hh_cb.devices[i].dev_status = BTHH_CONN_STATE_UNKNOWN;
   }
+  btif_hh_uhid_thread_start();
   /* Invoke the enable service API to the core to set the appropriate service_id
    */
   btif_enable_service(BTA_HID_SERVICE_ID);
@@ -1647,13 +1647,43 @@ static void cleanup(void) {
         bta_hh_co_destroy(p_dev->fd);
         p_dev->fd = -1;
       }
-      p_dev->hh_keep_polling = 0;
-      p_dev->hh_poll_thread_id = -1;
     }
   }
+  btif_hh_uhid_thread_stop();
 
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_hh_debug_dump
+ *
+ * Description      Dumps the connected HID devices, with the latency of their
+ *                  input reports, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_hh_debug_dump(int fd) {
+  static const char* bucket_names[BTIF_HH_INPUT_LATENCY_BUCKETS] = {
+      "< 125 us", "< 250 us", "< 500 us", "< 1 ms",
+      "< 2 ms",   "< 5 ms",   "< 10 ms",  ">= 10 ms"};
+
+  dprintf(fd, "\nHID Host Devices:\n");
+  for (int i = 0; i < BTIF_HH_MAX_HID; i++) {
+    const btif_hh_device_t* p_dev = &btif_hh_cb.devices[i];
+    if (p_dev->dev_status != BTHH_CONN_STATE_CONNECTED) continue;
+
+    bdstr_t bdstr;
+    dprintf(fd, "  %s handle %d uhid fd %d ready %d\n",
+            bdaddr_to_string(&p_dev->bd_addr, bdstr, sizeof(bdstr)),
+            p_dev->dev_handle, p_dev->fd, p_dev->ready_for_data);
+    dprintf(fd, "    Input report latency        :");
+    for (int j = 0; j < BTIF_HH_INPUT_LATENCY_BUCKETS; j++)
+      dprintf(fd, " %s: %u%s", bucket_names[j], p_dev->input_latency[j],
+              j + 1 < BTIF_HH_INPUT_LATENCY_BUCKETS ? "," : "\n");
+  }
+}
+
 static const bthh_interface_t bthhInterface = {
     sizeof(bthhInterface), init, connect, disconnect, virtual_unplug, set_info,
     get_protocol, set_protocol,
@@ -94,6 +94,13 @@ const int btif_hl_signal_select_wakeup = 1;
 const int btif_hl_signal_select_exit = 2;
 const int btif_hl_signal_select_close_connected = 3;
 
+/* The socket buffers of the data channels, holding the APDUs of a few
+ * seconds of a waveform stream, so that the stack does not wait for the app
+ * to read them */
+#ifndef BTIF_HL_SOCKET_BUF_SIZE
+#define BTIF_HL_SOCKET_BUF_SIZE (64 * 1024)
+#endif
+
 static int listen_s = -1;
 static int connected_s = -1;
 static pthread_t select_thread_id = -1;
@@ -2878,7 +2885,7 @@ static void btif_hl_proc_abort_cfm(tBTA_HL_MCL_HANDLE mcl_handle) {
  *
  ******************************************************************************/
 static void btif_hl_proc_send_data_cfm(tBTA_HL_MDL_HANDLE mdl_handle,
-                                       UNUSED_ATTR tBTA_HL_STATUS status) {
+                                       tBTA_HL_STATUS status) {
   uint8_t app_idx, mcl_idx, mdl_idx;
   btif_hl_mdl_cb_t* p_dcb;
 
@@ -2886,9 +2893,18 @@ static void btif_hl_proc_send_data_cfm(tBTA_HL_MDL_HANDLE mdl_handle,
   if (btif_hl_find_mdl_idx_using_handle(mdl_handle, &app_idx, &mcl_idx,
                                         &mdl_idx)) {
     p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
-    osi_free_and_reset((void**)&p_dcb->p_tx_pkt);
-    BTIF_TRACE_DEBUG("send success free p_tx_pkt tx_size=%d", p_dcb->tx_size);
+    BTIF_TRACE_DEBUG("%s status=%d tx_size=%d", __func__, status,
+                     p_dcb->tx_size);
+    /* a congested channel is sent the APDU again once the congestion
+     * clears, the app being held until then */
+    if (status == BTA_HL_STATUS_DCH_BUSY && p_dcb->cong) return;
+
     p_dcb->tx_size = 0;
+    if (p_dcb->p_scb &&
+        btif_hl_get_socket_state(p_dcb->p_scb) == BTIF_HL_SOC_STATE_W4_TX) {
+      btif_hl_set_socket_state(p_dcb->p_scb, BTIF_HL_SOC_STATE_W4_READ);
+      btif_hl_select_wakeup();
+    }
   }
 }
 
@@ -2913,6 +2929,8 @@ static void btif_hl_proc_dch_cong_ind(tBTA_HL* p_data)
                                         &app_idx, &mcl_idx, &mdl_idx)) {
     p_dcb = BTIF_HL_GET_MDL_CB_PTR(app_idx, mcl_idx, mdl_idx);
     p_dcb->cong = p_data->dch_cong_ind.cong;
+    if (!p_dcb->cong && p_dcb->tx_size > 0)
+      BTA_HlSendData(p_dcb->mdl_handle, p_dcb->tx_size);
   }
 }
 
@@ -4229,6 +4247,13 @@ bool btif_hl_create_socket(uint8_t app_idx, uint8_t mcl_idx, uint8_t mdl_idx) {
     if (socketpair(AF_UNIX, SOCK_STREAM, 0, p_scb->socket_id) >= 0) {
       BTIF_TRACE_DEBUG("socket id[0]=%d id[1]=%d", p_scb->socket_id[0],
                        p_scb->socket_id[1]);
+      int buf_size = BTIF_HL_SOCKET_BUF_SIZE;
+      if (setsockopt(p_scb->socket_id[1], SOL_SOCKET, SO_SNDBUF, &buf_size,
+                     sizeof(buf_size)) < 0 ||
+          setsockopt(p_scb->socket_id[1], SOL_SOCKET, SO_RCVBUF, &buf_size,
+                     sizeof(buf_size)) < 0)
+        BTIF_TRACE_WARNING("%s unable to size the socket buffers: %s",
+                           __func__, strerror(errno));
       p_dcb->p_scb = p_scb;
       p_scb->app_idx = app_idx;
       p_scb->mcl_idx = mcl_idx;
@@ -4273,7 +4298,10 @@ void btif_hl_add_socket_to_set(fd_set* p_org_set) {
     btif_hl_soc_cb_t* p_scb = (btif_hl_soc_cb_t*)list_node(node);
 
     BTIF_TRACE_DEBUG("btif_hl_add_socket_to_set first p_scb=0x%x", p_scb);
-    if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_ADD) {
+    if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_READ) {
+      /* the last APDU read from the socket was sent */
+      FD_SET(p_scb->socket_id[1], p_org_set);
+    } else if (btif_hl_get_socket_state(p_scb) == BTIF_HL_SOC_STATE_W4_ADD) {
       btif_hl_set_socket_state(p_scb, BTIF_HL_SOC_STATE_W4_READ);
       FD_SET(p_scb->socket_id[1], p_org_set);
       BTIF_TRACE_DEBUG("found and set socket_id=%d is_set=%d",
@@ -4392,8 +4420,7 @@ void btif_hl_select_wakeup_callback(fd_set* p_org_set, int wakeup_signal) {
  * Returns void
  *
  ******************************************************************************/
-void btif_hl_select_monitor_callback(fd_set* p_cur_set,
-                                     UNUSED_ATTR fd_set* p_org_set) {
+void btif_hl_select_monitor_callback(fd_set* p_cur_set, fd_set* p_org_set) {
   BTIF_TRACE_DEBUG("entering %s", __func__);
 
   for (const list_node_t* node = list_begin(soc_queue);
@@ -4405,24 +4432,19 @@ void btif_hl_select_monitor_callback(fd_set* p_cur_set,
         btif_hl_mdl_cb_t* p_dcb = BTIF_HL_GET_MDL_CB_PTR(
             p_scb->app_idx, p_scb->mcl_idx, p_scb->mdl_idx);
         CHECK(p_dcb != NULL);
-        if (p_dcb->p_tx_pkt) {
-          BTIF_TRACE_ERROR(
-              "Rcv new pkt but the last pkt is still not been"
-              "  sent tx_size=%d",
-              p_dcb->tx_size);
-          osi_free_and_reset((void**)&p_dcb->p_tx_pkt);
-        }
-        p_dcb->p_tx_pkt = (uint8_t*)osi_malloc(p_dcb->mtu);
+        if (p_dcb->p_tx_pkt == NULL)
+          p_dcb->p_tx_pkt = (uint8_t*)osi_malloc(p_dcb->mtu);
         ssize_t r;
         OSI_NO_INTR(r = recv(p_scb->socket_id[1], p_dcb->p_tx_pkt, p_dcb->mtu,
                              MSG_DONTWAIT));
         if (r > 0) {
           BTIF_TRACE_DEBUG("btif_hl_select_monitor_callback send data r =%d",
                            r);
+          /* The socket is not read again until the APDU is sent: the app
+           * is held by the socket buffer when the channel can not keep up */
+          btif_hl_set_socket_state(p_scb, BTIF_HL_SOC_STATE_W4_TX);
+          FD_CLR(p_scb->socket_id[1], p_org_set);
           p_dcb->tx_size = r;
-          BTIF_TRACE_DEBUG(
-              "btif_hl_select_monitor_callback send data tx_size=%d",
-              p_dcb->tx_size);
           BTA_HlSendData(p_dcb->mdl_handle, p_dcb->tx_size);
         } else {
           BTIF_TRACE_DEBUG(
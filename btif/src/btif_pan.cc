@@ -41,10 +41,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/ioctl.h>
-#include <sys/poll.h>
 #include <sys/prctl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -62,6 +62,7 @@
 #include "btif_util.h"
 #include "btm_api.h"
 #include "device/include/controller.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -156,8 +157,11 @@ void btif_pan_cleanup() {
   if (!stack_initialized) return;
 
   // Bluetooth is shuting down, invalidate all BTA PAN handles
-  for (int i = 0; i < MAX_PAN_CONNS; i++)
+  for (int i = 0; i < MAX_PAN_CONNS; i++) {
     btpan_cleanup_conn(&btpan_cb.conns[i]);
+    fixed_queue_free(btpan_cb.conns[i].hold_q, NULL);
+    btpan_cb.conns[i].hold_q = NULL;
+  }
 
   pan_disable();
   stack_initialized = false;
@@ -324,6 +328,16 @@ static int tap_if_up(const char* devname, const bt_bdaddr_t* addr) {
     return -1;
   }
 
+  // Let the driver queue more frames for us, while the connections are flow
+  // controlled.
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, devname, IF_NAMESIZE - 1);
+  ifr.ifr_qlen = PAN_TAP_TXQUEUELEN;
+  if (ioctl(sk, SIOCSIFTXQLEN, (caddr_t)&ifr) < 0)
+    BTIF_TRACE_WARNING("Could not set the queue length of interface:%s, "
+                       "errno:%d",
+                       devname, errno);
+
   // bring it up
   memset(&ifr, 0, sizeof(ifr));
   strncpy(ifr.ifr_name, devname, IF_NAMESIZE - 1);
@@ -373,6 +387,21 @@ void btpan_set_flow_control(bool enable) {
   }
 }
 
+static void btpan_release_held_frames(btpan_conn_t* conn);
+
+void btpan_set_conn_flow_control(btpan_conn_t* conn, bool enable) {
+  conn->flow = enable;
+  if (enable) btpan_release_held_frames(conn);
+
+  // The tap is only left unread once none of the peers accepts data.
+  bool flow = false;
+  for (int i = 0; i < MAX_PAN_CONNS; i++) {
+    if (btpan_cb.conns[i].state == PAN_STATE_OPEN && btpan_cb.conns[i].flow)
+      flow = true;
+  }
+  if (flow != (bool)btpan_cb.flow) btpan_set_flow_control(flow);
+}
+
 int btpan_tap_open() {
   struct ifreq ifr;
   int fd, err;
@@ -416,18 +445,21 @@ int btpan_tap_send(int tap_fd, const BD_ADDR src, const BD_ADDR dst,
     memcpy(&eth_hdr.h_dest, dst, ETH_ADDR_LEN);
     memcpy(&eth_hdr.h_src, src, ETH_ADDR_LEN);
     eth_hdr.h_proto = htons(proto);
-    char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
-    memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
     if (len > TAP_MAX_PKT_WRITE_LEN) {
       LOG_ERROR(LOG_TAG, "btpan_tap_send eth packet size:%d is exceeded limit!",
                 len);
       return -1;
     }
-    memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-    /* Send data to network interface */
+    /* Send data to network interface, the header and the payload being
+     * gathered from where they are */
+    struct iovec iov[2];
+    iov[0].iov_base = &eth_hdr;
+    iov[0].iov_len = sizeof(tETH_HDR);
+    iov[1].iov_base = (void*)buf;
+    iov[1].iov_len = len;
     ssize_t ret;
-    OSI_NO_INTR(ret = write(tap_fd, packet, len + sizeof(tETH_HDR)));
+    OSI_NO_INTR(ret = writev(tap_fd, iov, 2));
     BTIF_TRACE_DEBUG("ret:%d", ret);
     return (int)ret;
   }
@@ -480,6 +512,7 @@ static void btpan_open_conn(btpan_conn_t* conn, tBTA_PAN* p_data) {
 
     if (btpan_cb.tap_fd >= 0) {
       btpan_cb.flow = 1;
+      conn->flow = true;
       conn->state = PAN_STATE_OPEN;
     }
   }
@@ -504,8 +537,18 @@ static void btpan_close_conn(btpan_conn_t* conn) {
   }
 }
 
+static void btpan_drop_held_frames(btpan_conn_t* conn) {
+  if (!conn->hold_q) return;
+
+  BT_HDR* p_buf;
+  while ((p_buf = (BT_HDR*)fixed_queue_try_dequeue(conn->hold_q)) != NULL)
+    osi_free(p_buf);
+}
+
 static void btpan_cleanup_conn(btpan_conn_t* conn) {
   if (conn) {
+    btpan_drop_held_frames(conn);
+    conn->flow = false;
     conn->handle = -1;
     conn->state = -1;
     memset(&conn->peer, 0, sizeof(conn->peer));
@@ -526,6 +569,7 @@ btpan_conn_t* btpan_new_conn(int handle, const BD_ADDR addr, int local_role,
       bdcpy(btpan_cb.conns[i].peer, addr);
       btpan_cb.conns[i].local_role = local_role;
       btpan_cb.conns[i].remote_role = remote_role;
+      btpan_cb.conns[i].flow = true;
       return &btpan_cb.conns[i];
     }
   }
@@ -536,6 +580,8 @@ btpan_conn_t* btpan_new_conn(int handle, const BD_ADDR addr, int local_role,
 
 void btpan_close_handle(btpan_conn_t* p) {
   BTIF_TRACE_DEBUG("btpan_close_handle : close handle %d", p->handle);
+  btpan_drop_held_frames(p);
+  p->flow = false;
   p->handle = -1;
   p->local_role = -1;
   p->remote_role = -1;
@@ -550,6 +596,24 @@ static inline bool should_forward(tETH_HDR* hdr) {
   return false;
 }
 
+// Holds |hdr|, a frame to |conn| whose ethernet header was skipped, until its
+// flow is back on. The frames are dropped once too many are held, as a network
+// interface would.
+static void btpan_hold_frame(btpan_conn_t* conn, BT_HDR* hdr) {
+  if (!conn->hold_q) conn->hold_q = fixed_queue_new(SIZE_MAX);
+
+  if (fixed_queue_length(conn->hold_q) >= PAN_CONN_HOLD_Q_MAX) {
+    BTIF_TRACE_DEBUG("%s dropping frame to handle:%d", __func__, conn->handle);
+    osi_free(hdr);
+    return;
+  }
+
+  // The ethernet header is still in the buffer, in front of the payload.
+  hdr->offset -= sizeof(tETH_HDR);
+  hdr->len += sizeof(tETH_HDR);
+  fixed_queue_enqueue(conn->hold_q, hdr);
+}
+
 static int forward_bnep(tETH_HDR* eth_hdr, BT_HDR* hdr) {
   int broadcast = eth_hdr->h_dest[0] & 1;
 
@@ -562,10 +626,19 @@ static int forward_bnep(tETH_HDR* eth_hdr, BT_HDR* hdr) {
              0 ||
          memcmp(btpan_cb.conns[i].peer, eth_hdr->h_dest, sizeof(BD_ADDR)) ==
              0)) {
+      btpan_conn_t* conn = &btpan_cb.conns[i];
+      if (!conn->flow) {
+        btpan_hold_frame(conn, hdr);
+        return FORWARD_CONGEST;
+      }
+
       int result = PAN_WriteBuf(handle, eth_hdr->h_dest, eth_hdr->h_src,
                                 ntohs(eth_hdr->h_proto), hdr, 0);
       switch (result) {
         case PAN_Q_SIZE_EXCEEDED:
+          // The frame is dropped by BNEP, and the indication that the flow is
+          // off is on its way: the next frames are held until it is back on.
+          conn->flow = false;
           return FORWARD_CONGEST;
         case PAN_SUCCESS:
           return FORWARD_SUCCESS;
@@ -671,9 +744,39 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data) {
                         sizeof(tBTA_PAN), NULL);
 }
 
-#define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
+// Forwards |buffer|, an ethernet frame, to the connection of its destination.
+static void btpan_forward_frame(BT_HDR* buffer) {
+  uint8_t* packet = (uint8_t*)(buffer + 1) + buffer->offset;
+
+  if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
+    // Extract the ethernet header from the buffer since the PAN_WriteBuf
+    // inside forward_bnep can't handle two pointers that point inside the
+    // same GKI buffer.
+    tETH_HDR hdr;
+    memcpy(&hdr, packet, sizeof(tETH_HDR));
+
+    // Skip the ethernet header.
+    buffer->len -= sizeof(tETH_HDR);
+    buffer->offset += sizeof(tETH_HDR);
+    forward_bnep(&hdr, buffer);
+  } else {
+    BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__,
+                       buffer->len);
+    osi_free(buffer);
+  }
+}
+
+// Forwards the frames held for |conn|, in order, as long as its flow is on.
+static void btpan_release_held_frames(btpan_conn_t* conn) {
+  if (!conn->hold_q) return;
+
+  BT_HDR* p_buf;
+  while (conn->flow &&
+         (p_buf = (BT_HDR*)fixed_queue_try_dequeue(conn->hold_q)) != NULL)
+    btpan_forward_frame(p_buf);
+}
+
 static void btu_exec_tap_fd_read(void* p_param) {
-  struct pollfd ufd;
   int fd = PTR_TO_INT(p_param);
 
   if (fd == INVALID_FD || fd != btpan_cb.tap_fd) return;
@@ -688,67 +791,23 @@ static void btu_exec_tap_fd_read(void* p_param) {
 
     uint8_t* packet = (uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset;
 
-    // If we don't have an undelivered packet left over, pull one from the TAP
-    // driver.
-    // We save it in the congest_packet right away in case we can't deliver it
-    // in this
-    // attempt.
-    if (!btpan_cb.congest_packet_size) {
-      ssize_t ret;
-      OSI_NO_INTR(ret = read(fd, btpan_cb.congest_packet,
-                             sizeof(btpan_cb.congest_packet)));
-      switch (ret) {
-        case -1:
-          BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
-                           strerror(errno));
-          osi_free(buffer);
-          // add fd back to monitor thread to try it again later
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        case 0:
-          BTIF_TRACE_WARNING("%s end of file reached.", __func__);
-          osi_free(buffer);
-          // add fd back to monitor thread to process the exception
-          btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
-          return;
-        default:
-          btpan_cb.congest_packet_size = ret;
-          break;
+    // The frames are read straight into the buffers handed to BNEP. The fd
+    // being non-blocking, they are read until the driver has none left.
+    ssize_t ret;
+    OSI_NO_INTR(ret = read(fd, packet, buffer->len));
+    if (ret <= 0) {
+      if (ret == 0) {
+        BTIF_TRACE_WARNING("%s end of file reached.", __func__);
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        BTIF_TRACE_ERROR("%s unable to read from driver: %s", __func__,
+                         strerror(errno));
       }
-    }
-
-    memcpy(packet, btpan_cb.congest_packet,
-           MIN(btpan_cb.congest_packet_size, buffer->len));
-    buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
-
-    if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
-      // Extract the ethernet header from the buffer since the PAN_WriteBuf
-      // inside
-      // forward_bnep can't handle two pointers that point inside the same GKI
-      // buffer.
-      tETH_HDR hdr;
-      memcpy(&hdr, packet, sizeof(tETH_HDR));
-
-      // Skip the ethernet header.
-      buffer->len -= sizeof(tETH_HDR);
-      buffer->offset += sizeof(tETH_HDR);
-      if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-        btpan_cb.congest_packet_size = 0;
-    } else {
-      BTIF_TRACE_WARNING("%s dropping packet of length %d", __func__,
-                         buffer->len);
-      btpan_cb.congest_packet_size = 0;
       osi_free(buffer);
+      break;
     }
+    buffer->len = ret;
 
-    // Bail out of the loop if reading from the TAP fd would block.
-    ufd.fd = fd;
-    ufd.events = POLLIN;
-    ufd.revents = 0;
-
-    int ret;
-    OSI_NO_INTR(ret = poll(&ufd, 1, 0));
-    if (ret <= 0 || IS_EXCEPTION(ufd.revents)) break;
+    btpan_forward_frame(buffer);
   }
 
   if (btpan_cb.flow) {
@@ -33,8 +33,12 @@
 
 #include "bt_common.h"
 #include "btif_common.h"
+#include "device/include/interop.h"
+#include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
 #include "osi/include/list.h"
+#include "osi/include/osi.h"
+#include "sdpdefs.h"
 #include "stack_manager.h"
 
 /*******************************************************************************
@@ -44,6 +48,7 @@
 typedef enum {
   BTIF_QUEUE_CONNECT_EVT,
   BTIF_QUEUE_ADVANCE_EVT,
+  BTIF_QUEUE_TIMEOUT_EVT,
 } btif_queue_event_t;
 
 typedef struct {
@@ -51,6 +56,8 @@ typedef struct {
   uint16_t uuid;
   bool busy;
   btif_connect_cb_t connect_cb;
+  uint32_t id;
+  alarm_t* timer;
 } connect_node_t;
 
 /*******************************************************************************
@@ -58,16 +65,75 @@ typedef struct {
  ******************************************************************************/
 
 static list_t* connect_queue;
+static uint32_t next_id;
 
 static const size_t MAX_REASONABLE_REQUESTS = 10;
 
+/* Time given to a profile to connect or fail before the next connection of
+ * the profile is started. */
+#ifndef BTIF_QUEUE_CONNECT_TIMEOUT_MS
+#define BTIF_QUEUE_CONNECT_TIMEOUT_MS (20 * 1000)
+#endif
+
 /*******************************************************************************
  *  Queue helper functions
  ******************************************************************************/
 
+static void queue_int_handle_evt(uint16_t event, char* p_param);
+
+static void queue_int_free_node(void* data) {
+  connect_node_t* p_node = (connect_node_t*)data;
+  alarm_free(p_node->timer);
+  osi_free(p_node);
+}
+
+/* The profiles connected by the same state machine, that only connects one
+ * device at a time. */
+static uint16_t queue_int_group(uint16_t uuid) {
+  if (uuid == UUID_SERVCLASS_AUDIO_SINK) return UUID_SERVCLASS_AUDIO_SOURCE;
+  return uuid;
+}
+
+/* A connection waits for the one in progress with the same profile, and for
+ * any one to the same device if the device does not cope with several
+ * profiles connecting at once. */
+static bool queue_int_can_start(const connect_node_t* p_node) {
+  for (const list_node_t* node = list_begin(connect_queue);
+       node != list_end(connect_queue); node = list_next(node)) {
+    const connect_node_t* p_busy = (const connect_node_t*)list_node(node);
+    if (!p_busy->busy) continue;
+
+    if (queue_int_group(p_busy->uuid) == queue_int_group(p_node->uuid))
+      return false;
+    if (!memcmp(&p_busy->bda, &p_node->bda, sizeof(bt_bdaddr_t)) &&
+        interop_match_addr(INTEROP_SERIALIZE_PROFILE_CONNECTIONS,
+                           &p_node->bda))
+      return false;
+  }
+  return true;
+}
+
+static connect_node_t* queue_int_find_busy(uint16_t uuid) {
+  if (!connect_queue) return NULL;
+
+  for (const list_node_t* node = list_begin(connect_queue);
+       node != list_end(connect_queue); node = list_next(node)) {
+    connect_node_t* p_node = (connect_node_t*)list_node(node);
+    if (p_node->busy && queue_int_group(p_node->uuid) == queue_int_group(uuid))
+      return p_node;
+  }
+  return NULL;
+}
+
+static void queue_int_timeout(void* data) {
+  uint32_t id = PTR_TO_UINT(data);
+  btif_transfer_context(queue_int_handle_evt, BTIF_QUEUE_TIMEOUT_EVT,
+                        (char*)&id, sizeof(id), NULL);
+}
+
 static void queue_int_add(connect_node_t* p_param) {
   if (!connect_queue) {
-    connect_queue = list_new(osi_free);
+    connect_queue = list_new(queue_int_free_node);
     CHECK(connect_queue != NULL);
   }
 
@@ -85,12 +151,31 @@ static void queue_int_add(connect_node_t* p_param) {
 
   connect_node_t* p_node = (connect_node_t*)osi_malloc(sizeof(connect_node_t));
   memcpy(p_node, p_param, sizeof(connect_node_t));
+  p_node->id = next_id++;
+  p_node->timer = alarm_new("btif.queue_connect");
   list_append(connect_queue, p_node);
 }
 
-static void queue_int_advance() {
-  if (connect_queue && !list_is_empty(connect_queue))
-    list_remove(connect_queue, list_front(connect_queue));
+static void queue_int_advance(uint16_t uuid) {
+  connect_node_t* p_node = queue_int_find_busy(uuid);
+  if (p_node == NULL) return;
+
+  list_remove(connect_queue, p_node);
+}
+
+static void queue_int_expire(uint32_t id) {
+  if (!connect_queue) return;
+
+  for (const list_node_t* node = list_begin(connect_queue);
+       node != list_end(connect_queue); node = list_next(node)) {
+    connect_node_t* p_node = (connect_node_t*)list_node(node);
+    if (p_node->id != id) continue;
+
+    LOG_WARN(LOG_TAG, "%s connection of uuid: %04x timed out", __func__,
+             p_node->uuid);
+    list_remove(connect_queue, p_node);
+    return;
+  }
 }
 
 static void queue_int_handle_evt(uint16_t event, char* p_param) {
@@ -100,7 +185,11 @@ static void queue_int_handle_evt(uint16_t event, char* p_param) {
       break;
 
     case BTIF_QUEUE_ADVANCE_EVT:
-      queue_int_advance();
+      queue_int_advance(*(uint16_t*)p_param);
+      break;
+
+    case BTIF_QUEUE_TIMEOUT_EVT:
+      queue_int_expire(*(uint32_t*)p_param);
       break;
   }
 
@@ -132,32 +221,40 @@ bt_status_t btif_queue_connect(uint16_t uuid, const bt_bdaddr_t* bda,
 
 /*******************************************************************************
  *
- * Function         btif_queue_advance
+ * Function         btif_queue_advance_by_uuid
  *
- * Description      Clear the queue's busy status and advance to the next
- *                  scheduled connection.
+ * Description      Remove the connection in progress of the profile |uuid|
+ *                  from the queue, once it is connected or failed, and start
+ *                  the scheduled connections it was holding.
  *
  * Returns          void
  *
  ******************************************************************************/
-void btif_queue_advance() {
-  btif_transfer_context(queue_int_handle_evt, BTIF_QUEUE_ADVANCE_EVT, NULL, 0,
-                        NULL);
+void btif_queue_advance_by_uuid(uint16_t uuid) {
+  btif_transfer_context(queue_int_handle_evt, BTIF_QUEUE_ADVANCE_EVT,
+                        (char*)&uuid, sizeof(uuid), NULL);
 }
 
-// This function dispatches the next pending connect request. It is called from
-// stack_manager when the stack comes up.
+// This function dispatches the pending connect requests that can start. It is
+// called from stack_manager when the stack comes up.
 bt_status_t btif_queue_connect_next(void) {
   if (!connect_queue || list_is_empty(connect_queue)) return BT_STATUS_FAIL;
 
-  connect_node_t* p_head = (connect_node_t*)list_front(connect_queue);
-
-  // If the queue is currently busy, we return success anyway,
-  // since the connection has been queued...
-  if (p_head->busy) return BT_STATUS_SUCCESS;
+  // The connections waiting for another one return success anyway, since
+  // they have been queued...
+  bt_status_t status = BT_STATUS_SUCCESS;
+  for (const list_node_t* node = list_begin(connect_queue);
+       node != list_end(connect_queue); node = list_next(node)) {
+    connect_node_t* p_node = (connect_node_t*)list_node(node);
+    if (p_node->busy || !queue_int_can_start(p_node)) continue;
 
-  p_head->busy = true;
-  return p_head->connect_cb(&p_head->bda, p_head->uuid);
+    p_node->busy = true;
+    alarm_set(p_node->timer, BTIF_QUEUE_CONNECT_TIMEOUT_MS, queue_int_timeout,
+              UINT_TO_PTR(p_node->id));
+    bt_status_t node_status = p_node->connect_cb(&p_node->bda, p_node->uuid);
+    if (node_status != BT_STATUS_SUCCESS) status = node_status;
+  }
+  return status;
 }
 
 /*******************************************************************************
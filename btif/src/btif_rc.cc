@@ -43,12 +43,14 @@
 #include "bta_av_api.h"
 #include "btif_av.h"
 #include "btif_common.h"
+#include "btif_rc_attr_cache.h"
 #include "btif_util.h"
 #include "btu.h"
 #include "device/include/interop.h"
 #include "osi/include/list.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/time.h"
 #define RC_INVALID_TRACK_ID (0xFFFFFFFFFFFFFFFFULL)
 
 /*****************************************************************************
@@ -109,6 +111,12 @@
 typedef struct {
   uint8_t bNotify;
   uint8_t label;
+  /* The time of the last CHANGED response sent, and the one held until the
+   * minimum interval of the event has passed since then */
+  bool changed_sent;
+  uint32_t changed_ms;
+  bool changed_held;
+  tAVRC_NOTIF_RSP_PARAM held_param;
 } btif_rc_reg_notifications_t;
 
 typedef struct {
@@ -165,6 +173,16 @@ typedef struct {
   btrc_player_app_ext_attr_t ext_attrs[AVRC_MAX_APP_ATTR_SIZE];
 } btif_rc_player_app_settings_t;
 
+/* The item of the get item attributes command waiting for the app */
+typedef struct {
+  uint16_t player_id;
+  uint8_t scope;
+  tAVRC_UID uid;
+  uint16_t uid_counter;
+  uint8_t num_attr;
+  uint32_t attr_ids[BTRC_MAX_ELEM_ATTR_SIZE];
+} btif_rc_item_attr_req_t;
+
 /* TODO : Merge btif_rc_reg_notifications_t and btif_rc_cmd_ctxt_t to a single
  * struct */
 typedef struct {
@@ -182,13 +200,24 @@ typedef struct {
   list_t* rc_supported_event_list;
   btif_rc_player_app_settings_t rc_app_settings;
   alarm_t* rc_play_status_timer;
+  alarm_t* rc_notif_timer; /* sends the CHANGED responses held */
   bool rc_features_processed;
   uint64_t rc_playing_uid;
   bool rc_procedure_complete;
+  /* The players the browsing commands are for, and the ones set by the
+   * commands waiting for the app */
+  uint16_t rc_addr_player_id;
+  uint16_t rc_br_player_id;
+  uint16_t rc_pending_addr_player_id;
+  uint16_t rc_pending_br_player_id;
+  uint8_t rc_folder_items_scope;
+  btif_rc_item_attr_req_t rc_item_attr_req;
+  btif_rc_attr_cache_t* rc_attr_cache;
 } btif_rc_device_cb_t;
 
 typedef struct {
   std::mutex lock;
+  std::mutex attr_cache_lock; /* the commands and the app fill the caches */
   btif_rc_device_cb_t rc_multi_cb[BTIF_RC_NUM_CONN];
 } rc_cb_t;
 
@@ -254,6 +283,8 @@ static uint8_t opcode_from_pdu(uint8_t pdu);
 static void send_metamsg_rsp(btif_rc_device_cb_t* p_dev, int index,
                              uint8_t label, tBTA_AV_CODE code,
                              tAVRC_RESPONSE* pmetamsg_resp);
+static void send_item_attr_rsp(btif_rc_device_cb_t* p_dev, tAVRC_STS status,
+                               uint8_t num_attr, tAVRC_ATTR_ENTRY* p_attrs);
 static void register_volumechange(uint8_t label, btif_rc_device_cb_t* p_dev);
 static void lbl_init();
 static void init_all_transactions();
@@ -332,6 +363,7 @@ static void btif_rc_upstreams_rsp_evt(uint16_t event,
                                       btif_rc_device_cb_t* p_dev);
 
 static void rc_start_play_status_timer(btif_rc_device_cb_t* p_dev);
+static void schedule_held_notifications(btif_rc_device_cb_t* p_dev);
 static bool absolute_volume_disabled(void);
 
 /*****************************************************************************
@@ -448,6 +480,40 @@ void fill_avrc_attr_entry(tAVRC_ATTR_ENTRY* attr_vals, int num_attrs,
   }
 }
 
+/* The now playing list is the one of the addressed player, the other scopes
+ * are browsed in the browsed player */
+static uint16_t get_scope_player_id(btif_rc_device_cb_t* p_dev,
+                                    uint8_t scope) {
+  return scope == AVRC_SCOPE_NOW_PLAYING ? p_dev->rc_addr_player_id
+                                         : p_dev->rc_br_player_id;
+}
+
+/* Returns the attribute cache of |p_dev|, created on first use, or NULL if
+ * the cache is disabled. Called with btif_rc_cb.attr_cache_lock held, as the
+ * cache is used until it is released */
+static btif_rc_attr_cache_t* get_attr_cache(btif_rc_device_cb_t* p_dev) {
+  if (p_dev->rc_attr_cache == NULL) {
+    p_dev->rc_attr_cache = btif_rc_attr_cache_new(
+        BTIF_RC_ATTR_CACHE_SIZE, BTIF_RC_ATTR_CACHE_TIMEOUT_MS);
+  }
+  return p_dev->rc_attr_cache;
+}
+
+static void cache_item_attrs(btif_rc_device_cb_t* p_dev, uint16_t player_id,
+                             uint8_t scope, const tAVRC_UID uid,
+                             uint16_t uid_counter,
+                             const tAVRC_ATTR_ENTRY* p_attrs,
+                             uint8_t num_attrs) {
+  btif_rc_attr_cache_t* cache = get_attr_cache(p_dev);
+  if (cache == NULL) return;
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  for (uint8_t i = 0; i < num_attrs; i++) {
+    btif_rc_attr_cache_put(cache, player_id, scope, uid, uid_counter,
+                           p_attrs[i].attr_id, &p_attrs[i].name, now_ms);
+  }
+}
+
 void rc_cleanup_sent_cmd(void* p_data) { BTIF_TRACE_DEBUG("%s: ", __func__); }
 
 void handle_rc_ctrl_features(btif_rc_device_cb_t* p_dev) {
@@ -680,6 +746,14 @@ void handle_rc_disconnect(tBTA_AV_RC_CLOSE* p_rc_close) {
   p_dev->rc_features_processed = false;
   p_dev->rc_procedure_complete = false;
   rc_stop_play_status_timer(p_dev);
+  alarm_cancel(p_dev->rc_notif_timer);
+  {
+    std::lock_guard<std::mutex> lock(btif_rc_cb.attr_cache_lock);
+    btif_rc_attr_cache_free(p_dev->rc_attr_cache);
+    p_dev->rc_attr_cache = NULL;
+  }
+  p_dev->rc_addr_player_id = 0;
+  p_dev->rc_br_player_id = 0;
   /* Check and clear the notification event list */
   if (p_dev->rc_supported_event_list != NULL) {
     list_clear(p_dev->rc_supported_event_list);
@@ -1532,6 +1606,7 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
                sizeof(uint32_t) * num_attr);
       }
 
+      p_dev->rc_folder_items_scope = pavrc_cmd->get_items.scope;
       fill_pdu_queue(IDX_GET_FOLDER_ITEMS_RSP, ctype, label, true, p_dev);
       HAL_CBACK(bt_rc_callbacks, get_folder_items_cb,
                 pavrc_cmd->get_items.scope, pavrc_cmd->get_items.start_item,
@@ -1539,12 +1614,14 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
     } break;
 
     case AVRC_PDU_SET_ADDRESSED_PLAYER: {
+      p_dev->rc_pending_addr_player_id = pavrc_cmd->addr_player.player_id;
       fill_pdu_queue(IDX_SET_ADDR_PLAYER_RSP, ctype, label, true, p_dev);
       HAL_CBACK(bt_rc_callbacks, set_addressed_player_cb,
                 pavrc_cmd->addr_player.player_id, &rc_addr);
     } break;
 
     case AVRC_PDU_SET_BROWSED_PLAYER: {
+      p_dev->rc_pending_br_player_id = pavrc_cmd->br_player.player_id;
       fill_pdu_queue(IDX_SET_BROWSED_PLAYER_RSP, ctype, label, true, p_dev);
       HAL_CBACK(bt_rc_callbacks, set_browsed_player_cb,
                 pavrc_cmd->br_player.player_id, &rc_addr);
@@ -1610,6 +1687,34 @@ static void btif_rc_upstreams_evt(uint16_t event, tAVRC_COMMAND* pavrc_cmd,
       fill_pdu_queue(IDX_GET_ITEM_ATTR_RSP, ctype, label, true, p_dev);
       BTIF_TRACE_DEBUG("%s: GET_ITEM_ATTRIBUTES: num_attr: %d", __func__,
                        num_attr);
+
+      /* The attributes of the items just browsed are usually cached */
+      btif_rc_item_attr_req_t* p_req = &p_dev->rc_item_attr_req;
+      p_req->scope = pavrc_cmd->get_attrs.scope;
+      p_req->player_id = get_scope_player_id(p_dev, p_req->scope);
+      memcpy(p_req->uid, pavrc_cmd->get_attrs.uid, AVRC_UID_SIZE);
+      p_req->uid_counter = pavrc_cmd->get_attrs.uid_counter;
+      p_req->num_attr = num_attr;
+      for (uint8_t i = 0; i < num_attr; i++)
+        p_req->attr_ids[i] = item_attrs[i];
+
+      std::lock_guard<std::mutex> cache_lock(btif_rc_cb.attr_cache_lock);
+      btif_rc_attr_cache_t* cache = get_attr_cache(p_dev);
+      tAVRC_ATTR_ENTRY cached_attrs[BTRC_MAX_ELEM_ATTR_SIZE];
+      uint8_t num_cached = 0;
+      if (cache != NULL &&
+          btif_rc_attr_cache_get(cache, p_req->player_id, p_req->scope,
+                                 p_req->uid, p_req->uid_counter,
+                                 p_req->attr_ids, p_req->num_attr,
+                                 time_get_os_boottime_ms(), cached_attrs,
+                                 &num_cached)) {
+        BTIF_TRACE_DEBUG("%s: GET_ITEM_ATTRIBUTES answered from the cache",
+                         __func__);
+        send_item_attr_rsp(p_dev, AVRC_STS_NO_ERROR, num_cached,
+                           cached_attrs);
+        return;
+      }
+
       HAL_CBACK(bt_rc_callbacks, get_item_attr_cb, pavrc_cmd->get_attrs.scope,
                 pavrc_cmd->get_attrs.uid, pavrc_cmd->get_attrs.uid_counter,
                 num_attr, item_attrs, &rc_addr);
@@ -1908,11 +2013,182 @@ static void reject_pending_notification(btrc_event_id_t event_id, int idx) {
   avrc_rsp.reg_notif.status = AVRC_STS_ADDR_PLAYER_CHG;
   BTIF_TRACE_WARNING("%s: Handling event ID: 0x%x", __func__, event_id);
 
+  /* the change held is for the previous player */
+  btif_rc_cb.rc_multi_cb[idx].rc_notif[event_id - 1].changed_held = false;
   send_metamsg_rsp(&btif_rc_cb.rc_multi_cb[idx], -1,
                    btif_rc_cb.rc_multi_cb[idx].rc_notif[event_id - 1].label,
                    AVRC_RSP_REJ, &avrc_rsp);
 }
 
+/***************************************************************************
+ *
+ * Function         update_browsing_state
+ *
+ * Description      Follows the addressed player, and forgets the attributes
+ *                  cached when the items change.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void update_browsing_state(btif_rc_device_cb_t* p_dev,
+                                  btrc_event_id_t event_id,
+                                  btrc_notification_type_t type,
+                                  btrc_register_notification_t* p_param) {
+  if (event_id == BTRC_EVT_ADDR_PLAYER_CHANGE)
+    p_dev->rc_addr_player_id = p_param->addr_player_changed.player_id;
+
+  if (type == BTRC_NOTIFICATION_TYPE_CHANGED &&
+      (event_id == BTRC_EVT_UIDS_CHANGED ||
+       event_id == BTRC_EVT_NOW_PLAYING_CONTENT_CHANGED)) {
+    std::lock_guard<std::mutex> lock(btif_rc_cb.attr_cache_lock);
+    if (p_dev->rc_attr_cache != NULL)
+      btif_rc_attr_cache_clear(p_dev->rc_attr_cache);
+  }
+}
+
+/* The minimum interval between the CHANGED responses of |event_id| sent to
+ * a device. The changes meanwhile are folded into one, of the last value. */
+static uint32_t notif_min_interval_ms(uint8_t event_id) {
+  switch (event_id) {
+    case BTRC_EVT_PLAY_POS_CHANGED:
+      return BTIF_RC_NOTIF_PLAY_POS_INTERVAL_MS;
+    case BTRC_EVT_TRACK_CHANGE:
+      return BTIF_RC_NOTIF_TRACK_CHANGE_INTERVAL_MS;
+    default:
+      return 0;
+  }
+}
+
+/***************************************************************************
+ *
+ * Function         send_held_notifications
+ *
+ * Description      Sends the CHANGED responses held whose minimum interval
+ *                  has passed, if the device is still registered for them.
+ *                  Called with btif_rc_cb.lock held.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void send_held_notifications(btif_rc_device_cb_t* p_dev) {
+  uint32_t now_ms = time_get_os_boottime_ms();
+
+  for (uint8_t event_id = 1; event_id <= MAX_RC_NOTIFICATIONS; event_id++) {
+    btif_rc_reg_notifications_t* p_notif = &p_dev->rc_notif[event_id - 1];
+    if (!p_notif->changed_held ||
+        now_ms - p_notif->changed_ms < notif_min_interval_ms(event_id))
+      continue;
+
+    tAVRC_RESPONSE avrc_rsp;
+    memset(&(avrc_rsp.reg_notif), 0, sizeof(tAVRC_REG_NOTIF_RSP));
+    avrc_rsp.reg_notif.event_id = event_id;
+    avrc_rsp.reg_notif.pdu = AVRC_PDU_REGISTER_NOTIFICATION;
+    avrc_rsp.reg_notif.opcode =
+        opcode_from_pdu(AVRC_PDU_REGISTER_NOTIFICATION);
+    avrc_rsp.reg_notif.status = AVRC_STS_NO_ERROR;
+    avrc_rsp.reg_notif.param = p_notif->held_param;
+
+    p_notif->changed_held = false;
+    p_notif->changed_ms = now_ms;
+    send_metamsg_rsp(p_dev, -1, p_notif->label, AVRC_RSP_CHANGED, &avrc_rsp);
+  }
+
+  schedule_held_notifications(p_dev);
+}
+
+static void btif_rc_notif_timeout_handler(UNUSED_ATTR uint16_t event,
+                                          char* p_data) {
+  btif_rc_handle_t* rc_handle = (btif_rc_handle_t*)p_data;
+  std::unique_lock<std::mutex> lock(btif_rc_cb.lock);
+  btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_handle(rc_handle->handle);
+  if (p_dev == NULL || !p_dev->rc_connected) return;
+  send_held_notifications(p_dev);
+}
+
+static void btif_rc_notif_timer_timeout(void* data) {
+  btif_rc_handle_t rc_handle;
+  rc_handle.handle = PTR_TO_UINT(data);
+  btif_transfer_context(btif_rc_notif_timeout_handler, 0, (char*)(&rc_handle),
+                        sizeof(btif_rc_handle_t), NULL);
+}
+
+/***************************************************************************
+ *
+ * Function         schedule_held_notifications
+ *
+ * Description      Sets the notification timer of |p_dev| for the first of
+ *                  the CHANGED responses held to be due.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void schedule_held_notifications(btif_rc_device_cb_t* p_dev) {
+  uint32_t now_ms = time_get_os_boottime_ms();
+  bool held = false;
+  uint32_t delay_ms = 0;
+
+  for (uint8_t event_id = 1; event_id <= MAX_RC_NOTIFICATIONS; event_id++) {
+    btif_rc_reg_notifications_t* p_notif = &p_dev->rc_notif[event_id - 1];
+    if (!p_notif->changed_held) continue;
+
+    uint32_t elapsed_ms = now_ms - p_notif->changed_ms;
+    uint32_t interval_ms = notif_min_interval_ms(event_id);
+    uint32_t remaining_ms =
+        elapsed_ms < interval_ms ? interval_ms - elapsed_ms : 0;
+    if (!held || remaining_ms < delay_ms) delay_ms = remaining_ms;
+    held = true;
+  }
+
+  if (!held) {
+    alarm_cancel(p_dev->rc_notif_timer);
+    return;
+  }
+  if (p_dev->rc_notif_timer == NULL)
+    p_dev->rc_notif_timer = alarm_new("btif_rc.rc_notif_timer");
+  alarm_set_on_queue(p_dev->rc_notif_timer, delay_ms,
+                     btif_rc_notif_timer_timeout, UINT_TO_PTR(p_dev->rc_handle),
+                     btu_general_alarm_queue);
+}
+
+/***************************************************************************
+ *
+ * Function         hold_changed_notification
+ *
+ * Description      Holds the CHANGED response of |event_id| with |p_param|
+ *                  if one was sent less than the minimum interval of the
+ *                  event ago, in place of the one already held. Called with
+ *                  btif_rc_cb.lock held.
+ *
+ * Returns          true if the response is held, false if it is to be sent
+ *                  now.
+ *
+ **************************************************************************/
+static bool hold_changed_notification(btif_rc_device_cb_t* p_dev,
+                                      uint8_t event_id,
+                                      const tAVRC_NOTIF_RSP_PARAM* p_param) {
+  uint32_t interval_ms = notif_min_interval_ms(event_id);
+  if (interval_ms == 0) return false;
+
+  btif_rc_reg_notifications_t* p_notif = &p_dev->rc_notif[event_id - 1];
+  uint32_t now_ms = time_get_os_boottime_ms();
+  if (!p_notif->changed_held &&
+      (!p_notif->changed_sent ||
+       now_ms - p_notif->changed_ms >= interval_ms)) {
+    p_notif->changed_sent = true;
+    p_notif->changed_ms = now_ms;
+    return false;
+  }
+
+  BTIF_TRACE_DEBUG("%s: event_id: 0x%x held for the last change", __func__,
+                   event_id);
+  p_notif->held_param = *p_param;
+  if (!p_notif->changed_held) {
+    p_notif->changed_held = true;
+    schedule_held_notifications(p_dev);
+  }
+  return true;
+}
+
 /***************************************************************************
  *
  * Function         register_notification_rsp
@@ -1946,6 +2222,10 @@ static bt_status_t register_notification_rsp(
       continue;
     }
 
+    /* The items of the app change whether the device registered or not */
+    update_browsing_state(&btif_rc_cb.rc_multi_cb[idx], event_id, type,
+                          p_param);
+
     if (btif_rc_cb.rc_multi_cb[idx].rc_notif[event_id - 1].bNotify == false) {
       BTIF_TRACE_WARNING(
           "%s: Avrcp Event id is not registered: event_id: %x, handle: 0x%x",
@@ -1990,6 +2270,13 @@ static bt_status_t register_notification_rsp(
         return BT_STATUS_UNHANDLED;
     }
 
+    /* Changes too close to the previous one are sent later, folded */
+    if (type == BTRC_NOTIFICATION_TYPE_CHANGED &&
+        hold_changed_notification(&btif_rc_cb.rc_multi_cb[idx], event_id,
+                                  &avrc_rsp.reg_notif.param)) {
+      continue;
+    }
+
     /* Send the response. */
     send_metamsg_rsp(
         &btif_rc_cb.rc_multi_cb[idx], -1,
@@ -2038,7 +2325,8 @@ static bt_status_t get_folder_items_list_rsp(bt_bdaddr_t* bd_addr,
                                              uint8_t num_items,
                                              btrc_folder_items_t* p_items) {
   tAVRC_RESPONSE avrc_rsp;
-  tAVRC_ITEM item;
+  tAVRC_ITEM* p_item_list = NULL;
+  tAVRC_ATTR_ENTRY* p_attr_vals = NULL;
   tBTA_AV_CODE code = 0, ctype = 0;
   BT_HDR* p_msg = NULL;
   int item_cnt;
@@ -2058,7 +2346,6 @@ static bt_status_t get_folder_items_list_rsp(bt_bdaddr_t* bd_addr,
   }
 
   memset(&avrc_rsp, 0, sizeof(tAVRC_RESPONSE));
-  memset(&item, 0, sizeof(tAVRC_ITEM));
 
   avrc_rsp.get_items.pdu = AVRC_PDU_GET_FOLDER_ITEMS;
   avrc_rsp.get_items.opcode = opcode_from_pdu(AVRC_PDU_GET_FOLDER_ITEMS);
@@ -2069,59 +2356,65 @@ static bt_status_t get_folder_items_list_rsp(bt_bdaddr_t* bd_addr,
         "%s: Error in parsing the received getfolderitems cmd. status: 0x%02x",
         __func__, avrc_rsp.get_items.status);
     status = avrc_rsp.get_items.status;
-  } else {
+  } else if (num_items > 0) {
     avrc_rsp.get_items.uid_counter = uid_counter;
-    avrc_rsp.get_items.item_count = 1;
+    avrc_rsp.get_items.item_count = num_items;
+
+    /* The items are all built into the response at once, which takes as many
+     * as it has room for */
+    p_item_list = (tAVRC_ITEM*)osi_calloc(sizeof(tAVRC_ITEM) * num_items);
+    if (p_items->item_type == AVRC_ITEM_MEDIA) {
+      p_attr_vals = (tAVRC_ATTR_ENTRY*)osi_calloc(
+          sizeof(tAVRC_ATTR_ENTRY) * BTRC_MAX_ELEM_ATTR_SIZE * num_items);
+    }
 
-    /* create single item and build response iteratively for all num_items */
     for (item_cnt = 0; item_cnt < num_items; item_cnt++) {
+      tAVRC_ITEM* item = &p_item_list[item_cnt];
       cur_item = &p_items[item_cnt];
-      item.item_type = p_items->item_type;
+      item->item_type = p_items->item_type;
       /* build respective item based on item_type. All items should be of same
        * type within
        * a response */
       switch (p_items->item_type) {
         case AVRC_ITEM_PLAYER: {
-          item.u.player.name.charset_id = cur_item->player.charset_id;
-          memcpy(&(item.u.player.features), &(cur_item->player.features),
+          item->u.player.name.charset_id = cur_item->player.charset_id;
+          memcpy(&(item->u.player.features), &(cur_item->player.features),
                  sizeof(cur_item->player.features));
-          item.u.player.major_type = cur_item->player.major_type;
-          item.u.player.sub_type = cur_item->player.sub_type;
-          item.u.player.play_status = cur_item->player.play_status;
-          item.u.player.player_id = cur_item->player.player_id;
-          item.u.player.name.p_str = cur_item->player.name;
-          item.u.player.name.str_len =
+          item->u.player.major_type = cur_item->player.major_type;
+          item->u.player.sub_type = cur_item->player.sub_type;
+          item->u.player.play_status = cur_item->player.play_status;
+          item->u.player.player_id = cur_item->player.player_id;
+          item->u.player.name.p_str = cur_item->player.name;
+          item->u.player.name.str_len =
               (uint16_t)strlen((char*)(cur_item->player.name));
         } break;
 
         case AVRC_ITEM_FOLDER: {
-          memcpy(item.u.folder.uid, cur_item->folder.uid, sizeof(tAVRC_UID));
-          item.u.folder.type = cur_item->folder.type;
-          item.u.folder.playable = cur_item->folder.playable;
-          item.u.folder.name.charset_id = AVRC_CHARSET_ID_UTF8;
-          item.u.folder.name.str_len = strlen((char*)cur_item->folder.name);
-          item.u.folder.name.p_str = cur_item->folder.name;
+          memcpy(item->u.folder.uid, cur_item->folder.uid, sizeof(tAVRC_UID));
+          item->u.folder.type = cur_item->folder.type;
+          item->u.folder.playable = cur_item->folder.playable;
+          item->u.folder.name.charset_id = AVRC_CHARSET_ID_UTF8;
+          item->u.folder.name.str_len = strlen((char*)cur_item->folder.name);
+          item->u.folder.name.p_str = cur_item->folder.name;
         } break;
 
         case AVRC_ITEM_MEDIA: {
-          tAVRC_ATTR_ENTRY attr_vals[BTRC_MAX_ELEM_ATTR_SIZE];
-
-          memcpy(item.u.media.uid, cur_item->media.uid, sizeof(tAVRC_UID));
-          item.u.media.type = cur_item->media.type;
-          item.u.media.name.charset_id = cur_item->media.charset_id;
-          item.u.media.name.str_len = strlen((char*)cur_item->media.name);
-          item.u.media.name.p_str = cur_item->media.name;
-          item.u.media.attr_count = cur_item->media.num_attrs;
+          memcpy(item->u.media.uid, cur_item->media.uid, sizeof(tAVRC_UID));
+          item->u.media.type = cur_item->media.type;
+          item->u.media.name.charset_id = cur_item->media.charset_id;
+          item->u.media.name.str_len = strlen((char*)cur_item->media.name);
+          item->u.media.name.p_str = cur_item->media.name;
+          item->u.media.attr_count = cur_item->media.num_attrs;
 
           /* Handle attributes of given item */
-          if (item.u.media.attr_count == 0) {
-            item.u.media.p_attr_list = NULL;
+          if (item->u.media.attr_count == 0) {
+            item->u.media.p_attr_list = NULL;
           } else {
-            memset(&attr_vals, 0,
-                   sizeof(tAVRC_ATTR_ENTRY) * BTRC_MAX_ELEM_ATTR_SIZE);
-            fill_avrc_attr_entry(attr_vals, item.u.media.attr_count,
+            item->u.media.p_attr_list =
+                &p_attr_vals[item_cnt * BTRC_MAX_ELEM_ATTR_SIZE];
+            fill_avrc_attr_entry(item->u.media.p_attr_list,
+                                 item->u.media.attr_count,
                                  cur_item->media.p_attrs);
-            item.u.media.p_attr_list = attr_vals;
           }
         } break;
 
@@ -2132,30 +2425,36 @@ static bt_status_t get_folder_items_list_rsp(bt_bdaddr_t* bd_addr,
         } break;
       }
 
-      avrc_rsp.get_items.p_item_list = &item;
-
-      /* Add current item to buffer and build response if no error in item type
-       */
       if (status != AVRC_STS_NO_ERROR) {
         /* Reject response due to error occured for unknown item_type, break the
          * loop */
         break;
       }
+    }
 
-      int len_before = p_msg ? p_msg->len : 0;
-      BTIF_TRACE_DEBUG("%s: item_cnt: %d len: %d", __func__, item_cnt,
-                       len_before);
+    if (status == AVRC_STS_NO_ERROR) {
+      avrc_rsp.get_items.p_item_list = p_item_list;
       status = AVRC_BldResponse(p_dev->rc_handle, &avrc_rsp, &p_msg);
       BTIF_TRACE_DEBUG("%s: Build rsp status: %d len: %d", __func__, status,
                        (p_msg ? p_msg->len : 0));
-      int len_after = p_msg ? p_msg->len : 0;
-      if (status != AVRC_STS_NO_ERROR || len_before == len_after) {
-        /* Error occured in build response or we ran out of buffer so break the
-         * loop */
-        break;
+    }
+
+    /* The attributes of the media items are asked for next, one item at a
+     * time */
+    if (status == AVRC_STS_NO_ERROR && p_attr_vals != NULL) {
+      std::lock_guard<std::mutex> lock(btif_rc_cb.attr_cache_lock);
+      uint8_t scope = p_dev->rc_folder_items_scope;
+      uint16_t player_id = get_scope_player_id(p_dev, scope);
+      for (item_cnt = 0; item_cnt < num_items; item_cnt++) {
+        const tAVRC_ITEM_MEDIA* p_media = &p_item_list[item_cnt].u.media;
+        cache_item_attrs(p_dev, player_id, scope, p_media->uid, uid_counter,
+                         p_media->p_attr_list, p_media->attr_count);
       }
     }
 
+    osi_free(p_item_list);
+    osi_free(p_attr_vals);
+
     /* setting the error status */
     avrc_rsp.get_items.status = status;
   }
@@ -2207,6 +2506,8 @@ static bt_status_t set_addressed_player_rsp(bt_bdaddr_t* bd_addr,
   avrc_rsp.addr_player.pdu = AVRC_PDU_SET_ADDRESSED_PLAYER;
   avrc_rsp.addr_player.opcode = opcode_from_pdu(AVRC_PDU_SET_ADDRESSED_PLAYER);
   avrc_rsp.addr_player.status = status_code_map[rsp_status];
+  if (rsp_status == BTRC_STS_NO_ERROR)
+    p_dev->rc_addr_player_id = p_dev->rc_pending_addr_player_id;
 
   /* Send the response. */
   send_metamsg_rsp(p_dev, IDX_SET_ADDR_PLAYER_RSP,
@@ -2269,6 +2570,7 @@ static bt_status_t set_browsed_player_rsp(bt_bdaddr_t* bd_addr,
   }
 
   if (AVRC_STS_NO_ERROR == avrc_rsp.get_items.status) {
+    p_dev->rc_br_player_id = p_dev->rc_pending_br_player_id;
     avrc_rsp.br_player.num_items = num_items;
     avrc_rsp.br_player.charset_id = charset_id;
     avrc_rsp.br_player.folder_depth = folder_depth;
@@ -2406,6 +2708,66 @@ static bt_status_t search_rsp(bt_bdaddr_t* bd_addr, btrc_status_t rsp_status,
 
   return BT_STATUS_SUCCESS;
 }
+/***************************************************************************
+ *
+ * Function         send_item_attr_rsp
+ *
+ * Description      Sends the response to the pending get item attributes
+ *                  command.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void send_item_attr_rsp(btif_rc_device_cb_t* p_dev, tAVRC_STS status,
+                               uint8_t num_attr, tAVRC_ATTR_ENTRY* p_attrs) {
+  tAVRC_RESPONSE avrc_rsp;
+
+  avrc_rsp.get_attrs.status = status;
+  avrc_rsp.get_attrs.num_attrs = num_attr;
+  avrc_rsp.get_attrs.p_attrs = p_attrs;
+  avrc_rsp.get_attrs.pdu = AVRC_PDU_GET_ITEM_ATTRIBUTES;
+  avrc_rsp.get_attrs.opcode = opcode_from_pdu(AVRC_PDU_GET_ITEM_ATTRIBUTES);
+
+  /* Send the response. */
+  send_metamsg_rsp(p_dev, IDX_GET_ITEM_ATTR_RSP,
+                   p_dev->rc_pdu_info[IDX_GET_ITEM_ATTR_RSP].label,
+                   p_dev->rc_pdu_info[IDX_GET_ITEM_ATTR_RSP].ctype, &avrc_rsp);
+}
+
+/***************************************************************************
+ *
+ * Function         cache_item_attr_rsp
+ *
+ * Description      Caches the attributes given by the app for the pending get
+ *                  item attributes command, the ones asked for and not given
+ *                  as absent.
+ *
+ * Returns          void
+ *
+ **************************************************************************/
+static void cache_item_attr_rsp(btif_rc_device_cb_t* p_dev, uint8_t num_attr,
+                                const tAVRC_ATTR_ENTRY* p_attrs) {
+  std::lock_guard<std::mutex> lock(btif_rc_cb.attr_cache_lock);
+  const btif_rc_item_attr_req_t* p_req = &p_dev->rc_item_attr_req;
+  btif_rc_attr_cache_t* cache = get_attr_cache(p_dev);
+  if (cache == NULL) return;
+
+  cache_item_attrs(p_dev, p_req->player_id, p_req->scope, p_req->uid,
+                   p_req->uid_counter, p_attrs, num_attr);
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  for (uint8_t i = 0; i < p_req->num_attr; i++) {
+    bool given = false;
+    for (uint8_t j = 0; j < num_attr && !given; j++)
+      given = (p_attrs[j].attr_id == p_req->attr_ids[i]);
+    if (!given) {
+      btif_rc_attr_cache_put(cache, p_req->player_id, p_req->scope,
+                             p_req->uid, p_req->uid_counter,
+                             p_req->attr_ids[i], NULL, now_ms);
+    }
+  }
+}
+
 /***************************************************************************
  *
  * Function         get_item_attr_rsp
@@ -2421,7 +2783,6 @@ static bt_status_t search_rsp(bt_bdaddr_t* bd_addr, btrc_status_t rsp_status,
 static bt_status_t get_item_attr_rsp(bt_bdaddr_t* bd_addr,
                                      btrc_status_t rsp_status, uint8_t num_attr,
                                      btrc_element_attr_val_t* p_attrs) {
-  tAVRC_RESPONSE avrc_rsp;
   tAVRC_ATTR_ENTRY item_attrs[BTRC_MAX_ELEM_ATTR_SIZE];
   btif_rc_device_cb_t* p_dev = btif_rc_get_device_by_bda(bd_addr);
 
@@ -2430,20 +2791,13 @@ static bt_status_t get_item_attr_rsp(bt_bdaddr_t* bd_addr,
 
   memset(item_attrs, 0, sizeof(tAVRC_ATTR_ENTRY) * num_attr);
 
-  avrc_rsp.get_attrs.status = status_code_map[rsp_status];
   if (rsp_status == BTRC_STS_NO_ERROR) {
     fill_avrc_attr_entry(item_attrs, num_attr, p_attrs);
+    cache_item_attr_rsp(p_dev, num_attr, item_attrs);
   }
 
-  avrc_rsp.get_attrs.num_attrs = num_attr;
-  avrc_rsp.get_attrs.p_attrs = item_attrs;
-  avrc_rsp.get_attrs.pdu = AVRC_PDU_GET_ITEM_ATTRIBUTES;
-  avrc_rsp.get_attrs.opcode = opcode_from_pdu(AVRC_PDU_GET_ITEM_ATTRIBUTES);
-
-  /* Send the response. */
-  send_metamsg_rsp(p_dev, IDX_GET_ITEM_ATTR_RSP,
-                   p_dev->rc_pdu_info[IDX_GET_ITEM_ATTR_RSP].label,
-                   p_dev->rc_pdu_info[IDX_GET_ITEM_ATTR_RSP].ctype, &avrc_rsp);
+  send_item_attr_rsp(p_dev, status_code_map[rsp_status], num_attr,
+                     item_attrs);
 
   return BT_STATUS_SUCCESS;
 }
@@ -4423,6 +4777,8 @@ static void cleanup() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_notif_timer);
+    btif_rc_attr_cache_free(btif_rc_cb.rc_multi_cb[idx].rc_attr_cache);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
@@ -4448,6 +4804,8 @@ static void cleanup_ctrl() {
 
   for (int idx = 0; idx < BTIF_RC_NUM_CONN; idx++) {
     alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_play_status_timer);
+    alarm_free(btif_rc_cb.rc_multi_cb[idx].rc_notif_timer);
+    btif_rc_attr_cache_free(btif_rc_cb.rc_multi_cb[idx].rc_attr_cache);
     memset(&btif_rc_cb.rc_multi_cb[idx], 0,
            sizeof(btif_rc_cb.rc_multi_cb[idx]));
   }
@@ -0,0 +1,160 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_rc_attr_cache"
+
+#include "btif_rc_attr_cache.h"
+
+#include <base/logging.h>
+#include <string.h>
+
+#include "osi/include/allocator.h"
+
+typedef struct {
+  bool valid;
+  uint16_t player_id;
+  uint8_t scope;
+  tAVRC_UID uid;
+  uint16_t uid_counter;
+  uint32_t attr_id;
+  period_ms_t expiry_ms;
+  bool absent;
+  tAVRC_FULL_NAME value;  // |value.p_str| is owned by the entry
+} attr_entry_t;
+
+struct btif_rc_attr_cache_t {
+  period_ms_t timeout_ms;
+  size_t num_slots;  // A power of two
+  attr_entry_t* slots;
+};
+
+static attr_entry_t* cache_slot(const btif_rc_attr_cache_t* cache,
+                                uint16_t player_id, uint8_t scope,
+                                const tAVRC_UID uid, uint32_t attr_id);
+static bool entry_matches(const attr_entry_t* entry, uint16_t player_id,
+                          uint8_t scope, const tAVRC_UID uid,
+                          uint32_t attr_id);
+static void entry_reset(attr_entry_t* entry);
+
+btif_rc_attr_cache_t* btif_rc_attr_cache_new(size_t size,
+                                             period_ms_t timeout_ms) {
+  if (size == 0) return NULL;
+
+  btif_rc_attr_cache_t* cache = static_cast<btif_rc_attr_cache_t*>(
+      osi_calloc(sizeof(btif_rc_attr_cache_t)));
+  cache->timeout_ms = timeout_ms;
+  cache->num_slots = 1;
+  while (cache->num_slots < size) cache->num_slots <<= 1;
+  cache->slots = static_cast<attr_entry_t*>(
+      osi_calloc(sizeof(attr_entry_t) * cache->num_slots));
+  return cache;
+}
+
+void btif_rc_attr_cache_free(btif_rc_attr_cache_t* cache) {
+  if (cache == NULL) return;
+
+  btif_rc_attr_cache_clear(cache);
+  osi_free(cache->slots);
+  osi_free(cache);
+}
+
+void btif_rc_attr_cache_put(btif_rc_attr_cache_t* cache, uint16_t player_id,
+                            uint8_t scope, const tAVRC_UID uid,
+                            uint16_t uid_counter, uint32_t attr_id,
+                            const tAVRC_FULL_NAME* value, period_ms_t now_ms) {
+  CHECK(cache != NULL);
+
+  attr_entry_t* entry = cache_slot(cache, player_id, scope, uid, attr_id);
+  entry_reset(entry);
+
+  entry->valid = true;
+  entry->player_id = player_id;
+  entry->scope = scope;
+  memcpy(entry->uid, uid, AVRC_UID_SIZE);
+  entry->uid_counter = uid_counter;
+  entry->attr_id = attr_id;
+  entry->expiry_ms = now_ms + cache->timeout_ms;
+  entry->absent = (value == NULL);
+  if (value != NULL) {
+    entry->value.charset_id = value->charset_id;
+    entry->value.str_len = value->str_len;
+    // Allocated even when empty, as a NULL string is not a valid attribute
+    entry->value.p_str = static_cast<uint8_t*>(osi_malloc(value->str_len + 1));
+    if (value->str_len > 0)
+      memcpy(entry->value.p_str, value->p_str, value->str_len);
+    entry->value.p_str[value->str_len] = '\0';
+  }
+}
+
+bool btif_rc_attr_cache_get(btif_rc_attr_cache_t* cache, uint16_t player_id,
+                            uint8_t scope, const tAVRC_UID uid,
+                            uint16_t uid_counter, const uint32_t* attr_ids,
+                            uint8_t num_attr_ids, period_ms_t now_ms,
+                            tAVRC_ATTR_ENTRY* attrs, uint8_t* num_attrs) {
+  CHECK(cache != NULL);
+
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < num_attr_ids; i++) {
+    const attr_entry_t* entry =
+        cache_slot(cache, player_id, scope, uid, attr_ids[i]);
+    if (!entry_matches(entry, player_id, scope, uid, attr_ids[i]) ||
+        entry->uid_counter != uid_counter || now_ms >= entry->expiry_ms)
+      return false;
+    if (entry->absent) continue;
+
+    attrs[count].attr_id = entry->attr_id;
+    attrs[count].name = entry->value;
+    count++;
+  }
+
+  *num_attrs = count;
+  return true;
+}
+
+void btif_rc_attr_cache_clear(btif_rc_attr_cache_t* cache) {
+  CHECK(cache != NULL);
+
+  for (size_t i = 0; i < cache->num_slots; i++) entry_reset(&cache->slots[i]);
+}
+
+static attr_entry_t* cache_slot(const btif_rc_attr_cache_t* cache,
+                                uint16_t player_id, uint8_t scope,
+                                const tAVRC_UID uid, uint32_t attr_id) {
+  // FNV-1a over the key. The UIDs are often sequential, and only differ in
+  // their last octets.
+  uint32_t hash = 2166136261u;
+  hash = (hash ^ (player_id & 0xff)) * 16777619u;
+  hash = (hash ^ (player_id >> 8)) * 16777619u;
+  hash = (hash ^ scope) * 16777619u;
+  for (int i = 0; i < AVRC_UID_SIZE; i++) hash = (hash ^ uid[i]) * 16777619u;
+  hash = (hash ^ attr_id) * 16777619u;
+  return &cache->slots[hash & (cache->num_slots - 1)];
+}
+
+static bool entry_matches(const attr_entry_t* entry, uint16_t player_id,
+                          uint8_t scope, const tAVRC_UID uid,
+                          uint32_t attr_id) {
+  return entry->valid && entry->player_id == player_id &&
+         entry->scope == scope && entry->attr_id == attr_id &&
+         memcmp(entry->uid, uid, AVRC_UID_SIZE) == 0;
+}
+
+static void entry_reset(attr_entry_t* entry) {
+  osi_free(entry->value.p_str);
+  memset(entry, 0, sizeof(attr_entry_t));
+}
@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -30,8 +31,10 @@
 
 #include <hardware/bt_sock.h>
 
+#include "osi/include/alarm.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
+#include "osi/include/time.h"
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -83,6 +86,11 @@ typedef struct l2cap_socket {
   unsigned outgoing_congest : 1;  // should we hold?
   unsigned server_psm_sent : 1;   // The server shall only send PSM once.
   bool is_le_coc;                 // is le connection oriented channel?
+
+  uint16_t tx_mtu;                  // largest SDU the peer accepts
+  uint8_t* tx_pending;              // app writes held to be sent in one SDU
+  uint16_t tx_pending_len;          // length of the writes held
+  uint32_t tx_pending_deadline_ms;  // when the writes held are sent
 } l2cap_socket;
 
 static bt_status_t btSock_start_l2cap_server_l(l2cap_socket* sock);
@@ -93,6 +101,11 @@ l2cap_socket* socks = NULL;
 static uid_set_t* uid_set = NULL;
 static int pth = -1;
 
+// Sends the app writes held by the sockets once their latency budget is spent.
+// It is shared by the sockets as it is never cancelled: a socket freed while
+// the alarm waits for |state_lock| is simply no longer found.
+static alarm_t* coalesce_alarm = NULL;
+
 static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
                              uint32_t l2cap_socket_id);
 
@@ -197,6 +210,34 @@ static char packet_put_tail_l(l2cap_socket* sock, const void* data,
   return true;
 }
 
+/* Sends the data to the app right away when nothing is queued before it,
+ * and only queues a copy of what the app cannot take yet. Returns false if
+ * the data can be neither sent nor queued: the connection must be dropped. */
+static bool packet_send_or_put_tail_l(l2cap_socket* sock, const uint8_t* data,
+                                      uint32_t len) {
+  if (!sock->first_packet) {
+    ssize_t sent;
+    OSI_NO_INTR(sent = send(sock->our_fd, data, len, MSG_DONTWAIT));
+    if (sent == (signed)len) return true;
+
+    if (sent > 0) {
+      data += sent;
+      len -= sent;
+    } else if (sent < 0 && errno != EWOULDBLOCK && errno != EAGAIN) {
+      LOG_ERROR(LOG_TAG, "%s error writing L2CAP data to app: %s", __func__,
+                strerror(errno));
+      return false;
+    }
+  }
+
+  if (!packet_put_tail_l(sock, data, len)) return false;
+
+  /* wait for the app to read */
+  btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
+                       sock->id);
+  return true;
+}
+
 static inline void bd_copy(uint8_t* dest, uint8_t* src, bool swap) {
   if (swap) {
     for (int i = 0; i < 6; i++) dest[i] = src[5 - i];
@@ -244,6 +285,7 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
   }
 
   while (packet_get_head_l(sock, &buf, NULL)) osi_free(buf);
+  osi_free(sock->tx_pending);
 
   // lower-level close() should be idempotent... so let's call it and see...
   if (sock->is_le_coc) {
@@ -349,13 +391,20 @@ bt_status_t btsock_l2cap_init(int handle, uid_set_t* set) {
   pth = handle;
   socks = NULL;
   uid_set = set;
+  if (BTIF_SOCK_L2CAP_LE_COALESCE_MS > 0)
+    coalesce_alarm = alarm_new("btif_sock_l2cap.coalesce_alarm");
   return BT_STATUS_SUCCESS;
 }
 
 bt_status_t btsock_l2cap_cleanup() {
-  std::unique_lock<std::mutex> lock(state_lock);
-  pth = -1;
-  while (socks) btsock_l2cap_free_l(socks);
+  {
+    std::unique_lock<std::mutex> lock(state_lock);
+    pth = -1;
+    while (socks) btsock_l2cap_free_l(socks);
+  }
+  // Freed without |state_lock|, as the alarm callback may be waiting for it.
+  alarm_free(coalesce_alarm);
+  coalesce_alarm = NULL;
   return BT_STATUS_SUCCESS;
 }
 
@@ -453,6 +502,7 @@ static void on_srv_l2cap_psm_connect_l(tBTA_JV_L2CAP_OPEN* p_open,
   sock->handle =
       -1; /* We should no longer associate this handle with the server socket */
   accept_rs->is_le_coc = sock->is_le_coc;
+  accept_rs->tx_mtu = p_open->tx_mtu;
 
   /* Swap IDs to hand over the GAP connection to the accepted socket, and start
      a new server on
@@ -528,6 +578,7 @@ static void on_srv_l2cap_le_connect_l(tBTA_JV_L2CAP_LE_OPEN* p_open,
 static void on_cl_l2cap_psm_connect_l(tBTA_JV_L2CAP_OPEN* p_open,
                                       l2cap_socket* sock) {
   bd_copy(sock->addr.address, p_open->rem_bda, 0);
+  sock->tx_mtu = p_open->tx_mtu;
 
   if (!send_app_psm_or_chan_l(sock)) {
     APPL_TRACE_ERROR("send_app_psm_or_chan_l failed");
@@ -696,10 +747,8 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     BT_HDR* p_buf = p_le_data_ind->p_buf;
     uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
+    if (packet_send_or_put_tail_l(sock, data, p_buf->len)) {
       bytes_read = p_buf->len;
-      btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
-                           sock->id);
     } else {  // connection must be dropped
       APPL_TRACE_DEBUG(
           "on_l2cap_data_ind() unable to push data to socket - closing"
@@ -715,10 +764,8 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
       if (BTA_JvL2capRead(sock->handle, sock->id, buffer, count) ==
           BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer, count)) {
+        if (packet_send_or_put_tail_l(sock, buffer, count)) {
           bytes_read = count;
-          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
-                               SOCK_THREAD_FD_WR, sock->id);
         } else {  // connection must be dropped
           APPL_TRACE_DEBUG(
               "on_l2cap_data_ind() unable to push data to socket"
@@ -1008,6 +1055,140 @@ static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
   return false;
 }
 
+// Hands |buffer|, of |count| bytes read from the app, to the stack. It is
+// freed once written.
+static void btsock_l2cap_write_l(l2cap_socket* sock, uint8_t* buffer,
+                                 ssize_t count) {
+  if (sock->fixed_chan) {
+    if (BTA_JvL2capWriteFixed(sock->channel, (BD_ADDR*)&sock->addr,
+                              PTR_TO_UINT(buffer), btsock_l2cap_cbk, buffer,
+                              count, sock->id) == BTA_JV_SUCCESS)
+      return;
+  } else {
+    if (BTA_JvL2capWrite(sock->handle, PTR_TO_UINT(buffer), buffer, count,
+                         sock->id) == BTA_JV_SUCCESS)
+      return;
+  }
+
+  // On fail, free the buffer and keep reading the app, as the write done
+  // callbacks would. They are not called, as they take |state_lock|.
+  osi_free(buffer);
+  if (!sock->outgoing_congest)
+    btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
+                         sock->id);
+}
+
+// Reads a message written by the app, and sends it as an SDU of its own.
+static void btsock_l2cap_read_l(l2cap_socket* sock, int fd) {
+  uint8_t* buffer = (uint8_t*)osi_malloc(L2CAP_MAX_SDU_LENGTH);
+  /* The socket is created with SOCK_SEQPACKET, hence we read one message
+   * at the time. The maximum size of a message is allocated to ensure
+   * data is not lost. This is okay to do as Android uses virtual memory,
+   * hence even if we only use a fraction of the memory it should not
+   * block for others to use the memory. As the definition of
+   * ioctl(FIONREAD) do not clearly define what value will be returned if
+   * multiple messages are written to the socket before any message is
+   * read from the socket, we could potentially risk to allocate way more
+   * memory than needed. One of the use cases for this socket is obex
+   * where multiple 64kbyte messages are typically written to the socket
+   * in a tight loop, hence we risk the ioctl will return the total amount
+   * of data in the buffer, which could be multiple 64kbyte chunks.
+   * UPDATE: As the stack cannot handle 64kbyte buffers, the size is
+   * reduced to around 8kbyte - and using malloc for buffer allocation
+   * here seems to be wrong
+   * UPDATE: Since we are responsible for freeing the buffer in the
+   * write_complete_ind, it is OK to use malloc. */
+  ssize_t count;
+  OSI_NO_INTR(count = recv(fd, buffer, L2CAP_MAX_SDU_LENGTH,
+                           MSG_NOSIGNAL | MSG_DONTWAIT));
+  APPL_TRACE_DEBUG("btsock_l2cap_signaled - %d bytes received from socket",
+                   count);
+
+  btsock_l2cap_write_l(sock, buffer, count);
+}
+
+static void btsock_l2cap_flush_pending_l(l2cap_socket* sock) {
+  if (!sock->tx_pending_len) return;
+
+  uint8_t* buffer = sock->tx_pending;
+  uint16_t count = sock->tx_pending_len;
+  sock->tx_pending = NULL;
+  sock->tx_pending_len = 0;
+  APPL_TRACE_DEBUG("%s - %d bytes of app writes sent", __func__, count);
+  btsock_l2cap_write_l(sock, buffer, count);
+}
+
+static void btsock_l2cap_coalesce_timeout(UNUSED_ATTR void* data) {
+  std::unique_lock<std::mutex> lock(state_lock);
+  uint32_t now_ms = time_get_os_boottime_ms();
+  uint32_t next_ms = 0;
+  bool pending = false;
+
+  for (l2cap_socket* sock = socks; sock; sock = sock->next) {
+    if (!sock->tx_pending_len) continue;
+
+    int32_t remaining_ms = (int32_t)(sock->tx_pending_deadline_ms - now_ms);
+    if (remaining_ms <= 0) {
+      btsock_l2cap_flush_pending_l(sock);
+    } else if (!pending || (uint32_t)remaining_ms < next_ms) {
+      next_ms = remaining_ms;
+      pending = true;
+    }
+  }
+
+  if (pending)
+    alarm_set(coalesce_alarm, next_ms, btsock_l2cap_coalesce_timeout, NULL);
+}
+
+// Reads the messages written by the app to an LE CoC socket into a single SDU,
+// as long as they fit in the MTU of the peer. The SDU is sent once full, or
+// BTIF_SOCK_L2CAP_LE_COALESCE_MS after its first message otherwise, rather
+// than each small write costing a PDU, and a credit, of its own.
+static void btsock_l2cap_coalesce_l(l2cap_socket* sock, int fd) {
+  for (;;) {
+    // The size of the next message, the socket being a SOCK_SEQPACKET one
+    ssize_t size;
+    OSI_NO_INTR(size = recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT));
+    if (size <= 0) break;
+
+    if (sock->tx_pending_len &&
+        (sock->tx_pending_len + size > sock->tx_mtu ||
+         sock->tx_pending_len + size > L2CAP_MAX_SDU_LENGTH)) {
+      // The message is read once the ones held are written
+      btsock_l2cap_flush_pending_l(sock);
+      return;
+    }
+
+    if (!sock->tx_pending)
+      sock->tx_pending = (uint8_t*)osi_malloc(L2CAP_MAX_SDU_LENGTH);
+
+    ssize_t count;
+    OSI_NO_INTR(count = recv(fd, sock->tx_pending + sock->tx_pending_len,
+                             L2CAP_MAX_SDU_LENGTH - sock->tx_pending_len,
+                             MSG_NOSIGNAL | MSG_DONTWAIT));
+    if (count <= 0) break;
+
+    if (!sock->tx_pending_len)
+      sock->tx_pending_deadline_ms =
+          time_get_os_boottime_ms() + BTIF_SOCK_L2CAP_LE_COALESCE_MS;
+    sock->tx_pending_len += count;
+
+    if (sock->tx_pending_len >= sock->tx_mtu) {
+      btsock_l2cap_flush_pending_l(sock);
+      return;
+    }
+  }
+
+  // The app has nothing more to write for now: the messages read wait for
+  // the next ones, up to their deadline.
+  if (sock->tx_pending_len && !alarm_is_scheduled(coalesce_alarm))
+    alarm_set(coalesce_alarm, BTIF_SOCK_L2CAP_LE_COALESCE_MS,
+              btsock_l2cap_coalesce_timeout, NULL);
+  if (!sock->outgoing_congest)
+    btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_RD,
+                         sock->id);
+}
+
 void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
   l2cap_socket* sock;
   char drop_it = false;
@@ -1025,44 +1206,10 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
 
       if (!(flags & SOCK_THREAD_FD_EXCEPTION) ||
           (ioctl(sock->our_fd, FIONREAD, &size) == 0 && size)) {
-        uint8_t* buffer = (uint8_t*)osi_malloc(L2CAP_MAX_SDU_LENGTH);
-        /* The socket is created with SOCK_SEQPACKET, hence we read one message
-         * at the time. The maximum size of a message is allocated to ensure
-         * data is not lost. This is okay to do as Android uses virtual memory,
-         * hence even if we only use a fraction of the memory it should not
-         * block for others to use the memory. As the definition of
-         * ioctl(FIONREAD) do not clearly define what value will be returned if
-         * multiple messages are written to the socket before any message is
-         * read from the socket, we could potentially risk to allocate way more
-         * memory than needed. One of the use cases for this socket is obex
-         * where multiple 64kbyte messages are typically written to the socket
-         * in a tight loop, hence we risk the ioctl will return the total amount
-         * of data in the buffer, which could be multiple 64kbyte chunks.
-         * UPDATE: As the stack cannot handle 64kbyte buffers, the size is
-         * reduced to around 8kbyte - and using malloc for buffer allocation
-         * here seems to be wrong
-         * UPDATE: Since we are responsible for freeing the buffer in the
-         * write_complete_ind, it is OK to use malloc. */
-        ssize_t count;
-        OSI_NO_INTR(count = recv(fd, buffer, L2CAP_MAX_SDU_LENGTH,
-                                 MSG_NOSIGNAL | MSG_DONTWAIT));
-        APPL_TRACE_DEBUG(
-            "btsock_l2cap_signaled - %d bytes received from socket", count);
-
-        if (sock->fixed_chan) {
-          if (BTA_JvL2capWriteFixed(sock->channel, (BD_ADDR*)&sock->addr,
-                                    PTR_TO_UINT(buffer), btsock_l2cap_cbk,
-                                    buffer, count, user_id) != BTA_JV_SUCCESS) {
-            // On fail, free the buffer
-            on_l2cap_write_fixed_done(buffer, count, user_id);
-          }
-        } else {
-          if (BTA_JvL2capWrite(sock->handle, PTR_TO_UINT(buffer), buffer, count,
-                               user_id) != BTA_JV_SUCCESS) {
-            // On fail, free the buffer
-            on_l2cap_write_done(buffer, count, user_id);
-          }
-        }
+        if (sock->is_le_coc && BTIF_SOCK_L2CAP_LE_COALESCE_MS > 0)
+          btsock_l2cap_coalesce_l(sock, fd);
+        else
+          btsock_l2cap_read_l(sock, fd);
       }
     } else
       drop_it = true;
@@ -38,8 +38,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/poll.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -48,13 +49,18 @@
 
 #include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "bta_api.h"
 #include "btif_common.h"
 #include "btif_sock.h"
 #include "btif_sock_util.h"
 #include "btif_util.h"
+#include "osi/include/compat.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "osi/include/thread_policy.h"
+
+#define SOCK_POLL_THREAD_NAME "bt_sock_poll"
 
 #define asrt(s)                                                              \
   do {                                                                       \
@@ -64,11 +70,15 @@
   } while (0)
 
 #define MAX_THREAD 8
-#define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+/* the number of ready sockets handled per wakeup of the poll thread */
+#define MAX_POLL_EVENTS 32
+/* the number of commands handled per wakeup, the sockets being handled
+ * between two batches of commands */
+#define MAX_CMDS_PER_WAKEUP 16
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e)&POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e)&POLLIN)
-#define IS_WRITE(e) ((e)&POLLOUT)
+#define IS_READ(e) ((e)&EPOLLIN)
+#define IS_WRITE(e) ((e)&EPOLLOUT)
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP 1
 #define CMD_EXIT 2
@@ -77,16 +87,17 @@
 #define CMD_USER_PRIVATE 5
 
 typedef struct {
-  struct pollfd pfd;
+  int fd;
   uint32_t user_id;
   int type;
   int flags;
 } poll_slot_t;
 typedef struct {
   int cmd_fdr, cmd_fdw;
-  int poll_count;
-  poll_slot_t ps[MAX_POLL];
-  int psi[MAX_POLL];  // index of poll slot
+  int epoll_fd;
+  // the monitored sockets, by fd. Only accessed by the poll thread once it
+  // is started.
+  std::unordered_map<int, poll_slot_t> ps;
   pthread_t thread_id;
   btsock_signaled_cb callback;
   btsock_cmd_cb cmd_callback;
@@ -107,25 +118,31 @@ static inline int create_thread(void* (*start_routine)(void*), void* arg,
   pthread_attr_t thread_attr;
   pthread_attr_init(&thread_attr);
   pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
-  int policy;
-  int min_pri = 0;
-  int ret = -1;
-  struct sched_param param;
-
-  ret = pthread_create(thread_id, &thread_attr, start_routine, arg);
+  int ret = pthread_create(thread_id, &thread_attr, start_routine, arg);
   if (ret != 0) {
     APPL_TRACE_ERROR("pthread_create : %s", strerror(errno));
-    return ret;
   }
+  return ret;
+}
+
+/* Called by the created thread: it applies its configured policy, or lowers
+ * its own priority */
+static void set_thread_policy() {
+  prctl(PR_SET_NAME, (unsigned long)SOCK_POLL_THREAD_NAME);
+  pid_t tid = gettid();
+  thread_policy_register(tid, SOCK_POLL_THREAD_NAME);
+  if (thread_policy_sets_scheduling(tid)) return;
+
   /* We need to lower the priority of this thread to ensure the stack gets
    * priority over transfer to a socket */
-  pthread_getschedparam(*thread_id, &policy, &param);
-  min_pri = sched_get_priority_min(policy);
+  int policy;
+  struct sched_param param;
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  int min_pri = sched_get_priority_min(policy);
   if (param.sched_priority > min_pri) {
     param.sched_priority -= 1;
   }
-  pthread_setschedparam(*thread_id, policy, &param);
-  return ret;
+  pthread_setschedparam(pthread_self(), policy, &param);
 }
 static void init_poll(int cmd_fd);
 static int alloc_thread_slot() {
@@ -145,6 +162,7 @@ static int alloc_thread_slot() {
 static void free_thread_slot(int h) {
   if (0 <= h && h < MAX_THREAD) {
     close_cmd_fd(h);
+    ts[h].ps.clear();
     ts[h].used = 0;
   } else
     APPL_TRACE_ERROR("invalid thread handle:%d", h);
@@ -159,7 +177,7 @@ int btsock_thread_init() {
       ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
       ts[h].used = 0;
       ts[h].thread_id = -1;
-      ts[h].poll_count = 0;
+      ts[h].epoll_fd = -1;
       ts[h].callback = NULL;
       ts[h].cmd_callback = NULL;
     }
@@ -192,16 +210,32 @@ int btsock_thread_create(btsock_signaled_cb callback,
 /* create dummy socket pair used to wake up select loop */
 static inline void init_cmd_fd(int h) {
   asrt(ts[h].cmd_fdr == -1 && ts[h].cmd_fdw == -1);
+  asrt(ts[h].epoll_fd == -1);
+  ts[h].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (ts[h].epoll_fd == -1) {
+    APPL_TRACE_ERROR("epoll_create1 failed: %s", strerror(errno));
+    return;
+  }
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, &ts[h].cmd_fdr) < 0) {
     APPL_TRACE_ERROR("socketpair failed: %s", strerror(errno));
     return;
   }
   APPL_TRACE_DEBUG("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr,
                    ts[h].cmd_fdw);
-  // add the cmd fd for read & write
-  add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+  // the cmd fd is level triggered: the commands left after a batch wake up
+  // the thread again
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = ts[h].cmd_fdr;
+  if (epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ts[h].cmd_fdr, &event) == -1)
+    APPL_TRACE_ERROR("epoll_ctl cmd fd failed: %s", strerror(errno));
 }
 static inline void close_cmd_fd(int h) {
+  if (ts[h].epoll_fd != -1) {
+    close(ts[h].epoll_fd);
+    ts[h].epoll_fd = -1;
+  }
   if (ts[h].cmd_fdr != -1) {
     close(ts[h].cmd_fdr);
     ts[h].cmd_fdr = -1;
@@ -340,28 +374,36 @@ int btsock_thread_exit(int h) {
   return false;
 }
 static void init_poll(int h) {
-  int i;
-  ts[h].poll_count = 0;
   ts[h].thread_id = -1;
   ts[h].callback = NULL;
   ts[h].cmd_callback = NULL;
-  for (i = 0; i < MAX_POLL; i++) {
-    ts[h].ps[i].pfd.fd = -1;
-    ts[h].psi[i] = -1;
-  }
+  ts[h].ps.clear();
   init_cmd_fd(h);
 }
-static inline unsigned int flags2pevents(int flags) {
-  unsigned int pevents = 0;
-  if (flags & SOCK_THREAD_FD_WR) pevents |= POLLOUT;
-  if (flags & SOCK_THREAD_FD_RD) pevents |= POLLIN;
+static inline uint32_t flags2pevents(int flags) {
+  uint32_t pevents = 0;
+  if (flags & SOCK_THREAD_FD_WR) pevents |= EPOLLOUT;
+  if (flags & SOCK_THREAD_FD_RD) pevents |= EPOLLIN;
   pevents |= POLL_EXCEPTION_EVENTS;
-  return pevents;
+  // The sockets are monitored once: each signal disables the socket until
+  // its owner adds it again. Adding it again checks whether it is ready, so
+  // edge triggering does not miss the data left unread.
+  return pevents | EPOLLET | EPOLLONESHOT;
+}
+
+// Arms the socket of |ps| for its flags in the epoll set of |h|. Returns
+// false if the socket is not in the set, as when its fd was closed.
+static bool arm_poll(int h, const poll_slot_t* ps, int op) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = flags2pevents(ps->flags);
+  event.data.fd = ps->fd;
+  return epoll_ctl(ts[h].epoll_fd, op, ps->fd, &event) == 0;
 }
 
 static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
                             uint32_t user_id) {
-  ps->pfd.fd = fd;
+  ps->fd = fd;
   ps->user_id = user_id;
   if (ps->type != 0 && ps->type != type)
     APPL_TRACE_ERROR(
@@ -369,44 +411,47 @@ static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags,
         ps->type, type);
   ps->type = type;
   ps->flags = flags;
-  ps->pfd.events = flags2pevents(flags);
-  ps->pfd.revents = 0;
 }
 static inline void add_poll(int h, int fd, int type, int flags,
                             uint32_t user_id) {
   asrt(fd != -1);
-  int i;
-  int empty = -1;
-  poll_slot_t* ps = ts[h].ps;
+  auto it = ts[h].ps.find(fd);
+  if (it != ts[h].ps.end()) {
+    poll_slot_t* ps = &it->second;
+    set_poll(ps, fd, type, flags | ps->flags, user_id);
+    if (arm_poll(h, ps, EPOLL_CTL_MOD)) return;
 
-  for (i = 0; i < MAX_POLL; i++) {
-    if (ps[i].pfd.fd == fd) {
-      asrt(ts[h].poll_count < MAX_POLL);
-
-      set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
-      return;
-    } else if (empty < 0 && ps[i].pfd.fd == -1)
-      empty = i;
+    // the fd was closed without being removed, and now is another socket
+    memset(ps, 0, sizeof(*ps));
+    set_poll(ps, fd, type, flags, user_id);
+    if (!arm_poll(h, ps, EPOLL_CTL_ADD)) {
+      APPL_TRACE_ERROR("epoll_ctl add fd:%d failed: %s", fd, strerror(errno));
+      ts[h].ps.erase(it);
+    }
+    return;
   }
-  if (empty >= 0) {
-    asrt(ts[h].poll_count < MAX_POLL);
-    set_poll(&ps[empty], fd, type, flags, user_id);
-    ++ts[h].poll_count;
+
+  poll_slot_t slot;
+  memset(&slot, 0, sizeof(slot));
+  set_poll(&slot, fd, type, flags, user_id);
+  // a socket signaled for all its flags is left in the epoll set, disabled
+  if (!arm_poll(h, &slot, EPOLL_CTL_MOD) &&
+      !arm_poll(h, &slot, EPOLL_CTL_ADD)) {
+    APPL_TRACE_ERROR("epoll_ctl add fd:%d failed: %s", fd, strerror(errno));
     return;
   }
-  APPL_TRACE_ERROR("exceeded max poll slot:%d!", MAX_POLL);
+  ts[h].ps[fd] = slot;
 }
 static inline void remove_poll(int h, poll_slot_t* ps, int flags) {
   if (flags == ps->flags) {
-    // all monitored events signaled. To remove it, just clear the slot
-    --ts[h].poll_count;
-    memset(ps, 0, sizeof(*ps));
-    ps->pfd.fd = -1;
+    // all monitored events signaled. To remove it, just clear the slot. The
+    // fd stays disabled in the epoll set until it is added again.
+    ts[h].ps.erase(ps->fd);
   } else {
     // one read or one write monitor event signaled, removed the accordding bit
     ps->flags &= ~flags;
-    // update the poll events mask
-    ps->pfd.events = flags2pevents(ps->flags);
+    // monitor the other event again
+    arm_poll(h, ps, EPOLL_CTL_MOD);
   }
 }
 static int process_cmd_sock(int h) {
@@ -426,13 +471,8 @@ static int process_cmd_sock(int h) {
       add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
       break;
     case CMD_REMOVE_FD:
-      for (int i = 1; i < MAX_POLL; ++i) {
-        poll_slot_t* poll_slot = &ts[h].ps[i];
-        if (poll_slot->pfd.fd == cmd.fd) {
-          remove_poll(h, poll_slot, poll_slot->flags);
-          break;
-        }
-      }
+      ts[h].ps.erase(cmd.fd);
+      epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_DEL, cmd.fd, NULL);
       close(cmd.fd);
       break;
     case CMD_WAKEUP:
@@ -451,102 +491,88 @@ static int process_cmd_sock(int h) {
   return true;
 }
 
-static void print_events(short events) {
-  std::string flags("");
-  if ((events)&POLLIN) flags += " POLLIN";
-  if ((events)&POLLPRI) flags += " POLLPRI";
-  if ((events)&POLLOUT) flags += " POLLOUT";
-  if ((events)&POLLERR) flags += " POLLERR";
-  if ((events)&POLLHUP) flags += " POLLHUP ";
-  if ((events)&POLLNVAL) flags += " POLLNVAL";
-  if ((events)&POLLRDHUP) flags += " POLLRDHUP";
-  APPL_TRACE_DEBUG("print poll event:%x = %s", (events), flags.c_str());
+// Returns true if another command is queued on the cmd fd of |h|.
+static bool has_cmd(int h) {
+  int pending = 0;
+  if (ioctl(ts[h].cmd_fdr, FIONREAD, &pending) == -1) return false;
+  return pending >= (int)sizeof(sock_cmd_t);
 }
 
-static void process_data_sock(int h, struct pollfd* pfds, int count) {
-  asrt(count <= ts[h].poll_count);
-  int i;
-  for (i = 1; i < ts[h].poll_count; i++) {
-    if (pfds[i].revents) {
-      int ps_i = ts[h].psi[i];
-      asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-      uint32_t user_id = ts[h].ps[ps_i].user_id;
-      int type = ts[h].ps[ps_i].type;
-      int flags = 0;
-      print_events(pfds[i].revents);
-      if (IS_READ(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_RD;
-      }
-      if (IS_WRITE(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_WR;
-      }
-      if (IS_EXCEPTION(pfds[i].revents)) {
-        flags |= SOCK_THREAD_FD_EXCEPTION;
-        // remove the whole slot not flags
-        remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-      } else if (flags)
-        remove_poll(h, &ts[h].ps[ps_i],
-                    flags);  // remove the monitor flags that already processed
-      if (flags) ts[h].callback(pfds[i].fd, type, flags, user_id);
-    }
-  }
+static void print_events(uint32_t events) {
+  std::string flags("");
+  if ((events)&EPOLLIN) flags += " POLLIN";
+  if ((events)&EPOLLPRI) flags += " POLLPRI";
+  if ((events)&EPOLLOUT) flags += " POLLOUT";
+  if ((events)&EPOLLERR) flags += " POLLERR";
+  if ((events)&EPOLLHUP) flags += " POLLHUP ";
+  if ((events)&EPOLLRDHUP) flags += " POLLRDHUP";
+  APPL_TRACE_DEBUG("print poll event:%x = %s", (events), flags.c_str());
 }
 
-static void prepare_poll_fds(int h, struct pollfd* pfds) {
-  int count = 0;
-  int ps_i = 0;
-  int pfd_i = 0;
-  asrt(ts[h].poll_count <= MAX_POLL);
-  memset(pfds, 0, sizeof(pfds[0]) * ts[h].poll_count);
-  while (count < ts[h].poll_count) {
-    if (ps_i >= MAX_POLL) {
-      APPL_TRACE_ERROR(
-          "exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, "
-          "ts[h].poll_count:%d",
-          ps_i, MAX_POLL, count, ts[h].poll_count);
-      return;
+static void process_data_sock(int h, struct epoll_event* events, int count) {
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == ts[h].cmd_fdr) continue;
+
+    // removed by the callback of another socket of the batch
+    auto it = ts[h].ps.find(fd);
+    if (it == ts[h].ps.end()) continue;
+
+    poll_slot_t* ps = &it->second;
+    uint32_t user_id = ps->user_id;
+    int type = ps->type;
+    int flags = 0;
+    print_events(events[i].events);
+    if (IS_READ(events[i].events)) {
+      flags |= SOCK_THREAD_FD_RD;
     }
-    if (ts[h].ps[ps_i].pfd.fd >= 0) {
-      pfds[pfd_i] = ts[h].ps[ps_i].pfd;
-      ts[h].psi[pfd_i] = ps_i;
-      count++;
-      pfd_i++;
+    if (IS_WRITE(events[i].events)) {
+      flags |= SOCK_THREAD_FD_WR;
     }
-    ps_i++;
+    if (IS_EXCEPTION(events[i].events)) {
+      flags |= SOCK_THREAD_FD_EXCEPTION;
+      // remove the whole slot not flags
+      remove_poll(h, ps, ps->flags);
+    } else if (flags)
+      remove_poll(h, ps, flags);  // remove the monitor flags that already
+                                  // processed
+    if (flags) ts[h].callback(fd, type, flags, user_id);
   }
 }
+
 static void* sock_poll_thread(void* arg) {
-  struct pollfd pfds[MAX_POLL];
-  memset(pfds, 0, sizeof(pfds));
+  struct epoll_event events[MAX_POLL_EVENTS];
   int h = (intptr_t)arg;
+  set_thread_policy();
   for (;;) {
-    prepare_poll_fds(h, pfds);
     int ret;
-    OSI_NO_INTR(ret = poll(pfds, ts[h].poll_count, -1));
+    OSI_NO_INTR(ret = epoll_wait(ts[h].epoll_fd, events, MAX_POLL_EVENTS, -1));
     if (ret == -1) {
-      APPL_TRACE_ERROR("poll ret -1, exit the thread, errno:%d, err:%s", errno,
-                       strerror(errno));
+      APPL_TRACE_ERROR("epoll_wait ret -1, exit the thread, errno:%d, err:%s",
+                       errno, strerror(errno));
       break;
     }
-    if (ret != 0) {
-      int need_process_data_fd = true;
-      if (pfds[0].revents)  // cmd fd always is the first one
-      {
-        asrt(pfds[0].fd == ts[h].cmd_fdr);
+
+    bool cmd_ready = false;
+    for (int i = 0; i < ret; i++) {
+      if (events[i].data.fd == ts[h].cmd_fdr) cmd_ready = true;
+    }
+    if (cmd_ready) {
+      // the sockets a command closes are removed first, before they signal
+      bool exit = false;
+      int cmds = 0;
+      do {
         if (!process_cmd_sock(h)) {
           APPL_TRACE_DEBUG("h:%d, process_cmd_sock return false, exit...", h);
+          exit = true;
           break;
         }
-        if (ret == 1)
-          need_process_data_fd = false;
-        else
-          ret--;  // exclude the cmd fd
-      }
-      if (need_process_data_fd) process_data_sock(h, pfds, ret);
-    } else {
-      APPL_TRACE_DEBUG("no data, select ret: %d", ret)
-    };
+      } while (++cmds < MAX_CMDS_PER_WAKEUP && has_cmd(h));
+      if (exit) break;
+    }
+    process_data_sock(h, events, ret);
   }
   APPL_TRACE_DEBUG("socket poll thread exiting, h:%d", h);
+  thread_policy_unregister(gettid());
   return 0;
 }
@@ -33,13 +33,17 @@
 #include "btif_storage.h"
 
 #include <alloca.h>
+#include <base/bind.h>
 #include <base/logging.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include <vector>
+
 #include "bt_common.h"
+#include "bta_closure_api.h"
 #include "bta_hd_api.h"
 #include "bta_hh_api.h"
 #include "btcore/include/bdaddr.h"
@@ -54,6 +58,7 @@
 #include "osi/include/config.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "sdp_api.h"
 
 /*******************************************************************************
  *  Constants & Macros
@@ -76,6 +81,8 @@
 #define BTIF_STORAGE_PATH_REMOTE_ALIASE "Aliase"
 #define BTIF_STORAGE_PATH_REMOTE_SERVICE "Service"
 #define BTIF_STORAGE_PATH_REMOTE_HIDINFO "HidInfo"
+#define BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS "A2dpPeerCaps"
+#define BTIF_STORAGE_PATH_REMOTE_SDP_CACHE "SdpCache"
 #define BTIF_STORAGE_KEY_ADAPTER_NAME "Name"
 #define BTIF_STORAGE_KEY_ADAPTER_SCANMODE "ScanMode"
 #define BTIF_STORAGE_KEY_ADAPTER_DISC_TIMEOUT "DiscoveryTimeout"
@@ -167,9 +174,10 @@ extern void btif_gatts_add_bonded_dev_from_nv(BD_ADDR bda);
  *  Internal Functions
  ******************************************************************************/
 
-static bt_status_t btif_in_fetch_bonded_ble_device(
-    const char* remote_bd_addr, int add,
-    btif_bonded_devices_t* p_bonded_devices);
+static void btif_in_read_bonded_ble_device(const char* remote_bd_addr,
+                                           tBTA_DM_BONDED_DEV* p_dev);
+static void btif_read_le_key(const uint8_t key_type, const size_t key_len,
+                             bt_bdaddr_t bd_addr, tBTA_DM_BONDED_DEV* p_dev);
 static bt_status_t btif_in_fetch_bonded_device(const char* bdstr);
 
 static bool btif_has_ble_keys(const char* bdstr);
@@ -178,6 +186,53 @@ static bool btif_has_ble_keys(const char* bdstr);
  *  Static functions
  ******************************************************************************/
 
+// Called on the stack thread, each time the cached SDP responses of a device
+// change.
+static void btif_storage_sdp_cache_cback(BD_ADDR bd_addr, uint8_t* p_data,
+                                         uint16_t data_len) {
+  bt_bdaddr_t remote_bd_addr;
+  bdstr_t bdstr;
+  bdcpy(remote_bd_addr.address, bd_addr);
+  bdaddr_to_string(&remote_bd_addr, bdstr, sizeof(bdstr));
+
+  // The responses of a device unbonded since are not kept.
+  if (!btif_config_exist(bdstr, "LinkKey")) return;
+
+  if (data_len > 0)
+    btif_config_set_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE, p_data,
+                        data_len);
+  else
+    btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE);
+  btif_config_save();
+}
+
+static void btif_storage_sdp_cache_load(bt_bdaddr_t bd_addr,
+                                        std::vector<uint8_t> data) {
+  SDP_LoadCache(bd_addr.address, data.data(), data.size());
+}
+
+static void btif_storage_sdp_cache_invalidate(bt_bdaddr_t bd_addr) {
+  SDP_InvalidateCache(bd_addr.address);
+}
+
+// Hands the persisted SDP responses of the bonded device |bdstr| to the
+// stack, to answer its profiles without connecting.
+static void btif_storage_load_sdp_cache(const char* bdstr,
+                                        bt_bdaddr_t* bd_addr) {
+  size_t size =
+      btif_config_get_bin_length(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE);
+  if (size == 0 || size > UINT16_MAX) return;
+
+  std::vector<uint8_t> data(size);
+  if (!btif_config_get_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE,
+                           data.data(), &size))
+    return;
+  data.resize(size);
+
+  do_in_bta_thread(FROM_HERE, base::Bind(&btif_storage_sdp_cache_load,
+                                         *bd_addr, std::move(data)));
+}
+
 static int prop2cfg(bt_bdaddr_t* remote_bd_addr, bt_property_t* prop) {
   bdstr_t bdstr = {0};
   if (remote_bd_addr) bdaddr_to_string(remote_bd_addr, bdstr, sizeof(bdstr));
@@ -371,30 +426,56 @@ static int cfg2prop(bt_bdaddr_t* remote_bd_addr, bt_property_t* prop) {
 
 /*******************************************************************************
  *
- * Function         btif_in_fetch_bonded_devices
+ * Function         btif_in_read_bonded_device
  *
- * Description      Internal helper function to fetch the bonded devices
- *                  from NVRAM
+ * Description      Internal helper function to read the BR/EDR and LE keys
+ *                  of the device |bdstr| from NVRAM, in a single pass
+ *
+ * Returns          true if the device is bonded, false otherwise
+ *
+ ******************************************************************************/
+static bool btif_in_read_bonded_device(const char* bdstr,
+                                       tBTA_DM_BONDED_DEV* p_dev) {
+  memset(p_dev, 0, sizeof(tBTA_DM_BONDED_DEV));
+
+  bt_bdaddr_t bd_addr;
+  string_to_bdaddr(bdstr, &bd_addr);
+  bdcpy(p_dev->bd_addr, bd_addr.address);
+
+  size_t size = sizeof(p_dev->link_key);
+  int linkkey_type;
+  if (btif_config_get_bin(bdstr, "LinkKey", p_dev->link_key, &size) &&
+      btif_config_get_int(bdstr, "LinkKeyType", &linkkey_type)) {
+    p_dev->link_key_known = true;
+    p_dev->key_type = (uint8_t)linkkey_type;
+
+    int cod;
+    if (btif_config_get_int(bdstr, "DevClass", &cod))
+      uint2devclass((uint32_t)cod, p_dev->dc);
+
+    int pin_length = 0;
+    btif_config_get_int(bdstr, "PinLength", &pin_length);
+    p_dev->pin_length = (uint8_t)pin_length;
+  }
+
+  btif_in_read_bonded_ble_device(bdstr, p_dev);
+
+  return p_dev->link_key_known || p_dev->num_le_keys > 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_in_fetch_bonded_device
+ *
+ * Description      Internal helper function to check that the device |bdstr|
+ *                  is bonded
  *
  * Returns          BT_STATUS_SUCCESS if successful, BT_STATUS_FAIL otherwise
  *
  ******************************************************************************/
 static bt_status_t btif_in_fetch_bonded_device(const char* bdstr) {
-  bool bt_linkkey_file_found = false;
-
-  LINK_KEY link_key;
-  size_t size = sizeof(link_key);
-  if (btif_config_get_bin(bdstr, "LinkKey", (uint8_t*)link_key, &size)) {
-    int linkkey_type;
-    if (btif_config_get_int(bdstr, "LinkKeyType", &linkkey_type)) {
-      bt_linkkey_file_found = true;
-    } else {
-      bt_linkkey_file_found = false;
-    }
-  }
-  if ((btif_in_fetch_bonded_ble_device(bdstr, false, NULL) !=
-       BT_STATUS_SUCCESS) &&
-      (!bt_linkkey_file_found)) {
+  tBTA_DM_BONDED_DEV dev;
+  if (!btif_in_read_bonded_device(bdstr, &dev)) {
     BTIF_TRACE_DEBUG("Remote device:%s, no link key or ble key found", bdstr);
     return BT_STATUS_FAIL;
   }
@@ -406,18 +487,17 @@ static bt_status_t btif_in_fetch_bonded_device(const char* bdstr) {
  * Function         btif_in_fetch_bonded_devices
  *
  * Description      Internal helper function to fetch the bonded devices
- *                  from NVRAM
+ *                  from NVRAM. With |p_devs|, their keys are also read to
+ *                  it, to be added to BTA.
  *
  * Returns          BT_STATUS_SUCCESS if successful, BT_STATUS_FAIL otherwise
  *
  ******************************************************************************/
 static bt_status_t btif_in_fetch_bonded_devices(
-    btif_bonded_devices_t* p_bonded_devices, int add) {
+    btif_bonded_devices_t* p_bonded_devices,
+    std::vector<tBTA_DM_BONDED_DEV>* p_devs) {
   memset(p_bonded_devices, 0, sizeof(btif_bonded_devices_t));
 
-  bool bt_linkkey_file_found = false;
-  int device_type;
-
   for (const btif_config_section_iter_t* iter = btif_config_section_begin();
        iter != btif_config_section_end();
        iter = btif_config_section_next(iter)) {
@@ -425,71 +505,74 @@ static bt_status_t btif_in_fetch_bonded_devices(
     if (!string_is_bdaddr(name)) continue;
 
     BTIF_TRACE_DEBUG("Remote device:%s", name);
-    LINK_KEY link_key;
-    size_t size = sizeof(link_key);
-    if (btif_config_get_bin(name, "LinkKey", link_key, &size)) {
-      int linkkey_type;
-      if (btif_config_get_int(name, "LinkKeyType", &linkkey_type)) {
-        bt_bdaddr_t bd_addr;
-        string_to_bdaddr(name, &bd_addr);
-        if (add) {
-          DEV_CLASS dev_class = {0, 0, 0};
-          int cod;
-          int pin_length = 0;
-          if (btif_config_get_int(name, "DevClass", &cod))
-            uint2devclass((uint32_t)cod, dev_class);
-          btif_config_get_int(name, "PinLength", &pin_length);
-          BTA_DmAddDevice(bd_addr.address, dev_class, link_key, 0, 0,
-                          (uint8_t)linkkey_type, 0, pin_length);
-
-          if (btif_config_get_int(name, "DevType", &device_type) &&
-              (device_type == BT_DEVICE_TYPE_DUMO)) {
-            btif_gatts_add_bonded_dev_from_nv(bd_addr.address);
-          }
-        }
-        bt_linkkey_file_found = true;
-        memcpy(&p_bonded_devices->devices[p_bonded_devices->num_devices++],
-               &bd_addr, sizeof(bt_bdaddr_t));
-      } else {
-        bt_linkkey_file_found = false;
-      }
-    }
-    if (!btif_in_fetch_bonded_ble_device(name, add, p_bonded_devices) &&
-        !bt_linkkey_file_found) {
+    tBTA_DM_BONDED_DEV dev;
+    if (!btif_in_read_bonded_device(name, &dev)) {
       BTIF_TRACE_DEBUG("Remote device:%s, no link key or ble key found", name);
+      continue;
     }
+
+    if (p_bonded_devices->num_devices == BTM_SEC_MAX_DEVICE_RECORDS) {
+      BTIF_TRACE_WARNING("%s: more than %d bonded devices, %s ignored",
+                         __func__, BTM_SEC_MAX_DEVICE_RECORDS, name);
+      continue;
+    }
+    bdcpy(p_bonded_devices->devices[p_bonded_devices->num_devices++].address,
+          dev.bd_addr);
+    if (p_devs != NULL) p_devs->push_back(dev);
   }
   return BT_STATUS_SUCCESS;
 }
 
-static void btif_read_le_key(const uint8_t key_type, const size_t key_len,
-                             bt_bdaddr_t bd_addr, const uint8_t addr_type,
-                             const bool add_key, bool* device_added,
-                             bool* key_found) {
-  CHECK(device_added);
-  CHECK(key_found);
-
-  char buffer[100];
-  memset(buffer, 0, sizeof(buffer));
-
-  if (btif_storage_get_ble_bonding_key(&bd_addr, key_type, buffer, key_len) ==
-      BT_STATUS_SUCCESS) {
-    if (add_key) {
-      BD_ADDR bta_bd_addr;
-      bdcpy(bta_bd_addr, bd_addr.address);
-
-      if (!*device_added) {
-        BTA_DmAddBleDevice(bta_bd_addr, addr_type, BT_DEVICE_TYPE_BLE);
-        *device_added = true;
-      }
-
-      char bd_str[20] = {0};
-      BTIF_TRACE_DEBUG("%s() Adding key type %d for %s", __func__, key_type,
-                       bdaddr_to_string(&bd_addr, bd_str, sizeof(bd_str)));
-      BTA_DmAddBleKey(bta_bd_addr, (tBTA_LE_KEY_VALUE*)buffer, key_type);
+/*******************************************************************************
+ *
+ * Function         btif_in_load_bonded_devices
+ *
+ * Description      Internal helper function to fetch the bonded devices
+ *                  from NVRAM and add them to BTA, all in one message
+ *
+ * Returns          BT_STATUS_SUCCESS if successful, BT_STATUS_FAIL otherwise
+ *
+ ******************************************************************************/
+static bt_status_t btif_in_load_bonded_devices(
+    btif_bonded_devices_t* p_bonded_devices) {
+  std::vector<tBTA_DM_BONDED_DEV> devs;
+  btif_in_fetch_bonded_devices(p_bonded_devices, &devs);
+
+  BTA_DmAddBondedDevices(devs.data(), (uint16_t)devs.size());
+
+  for (const tBTA_DM_BONDED_DEV& dev : devs) {
+    bt_bdaddr_t bd_addr;
+    bdstr_t bdstr;
+    bdcpy(bd_addr.address, dev.bd_addr);
+    bdaddr_to_string(&bd_addr, bdstr, sizeof(bdstr));
+
+    int device_type;
+    if (dev.link_key_known) {
+      btif_storage_load_sdp_cache(bdstr, &bd_addr);
+      if (btif_config_get_int(bdstr, "DevType", &device_type) &&
+          device_type == BT_DEVICE_TYPE_DUMO)
+        btif_gatts_add_bonded_dev_from_nv(bd_addr.address);
     }
+    if (dev.num_le_keys > 0) btif_gatts_add_bonded_dev_from_nv(bd_addr.address);
+  }
+  return BT_STATUS_SUCCESS;
+}
 
-    *key_found = true;
+// Reads the LE key |key_type| of |key_len| octets of the device |bd_addr|
+// to the next key of |p_dev|, if it was stored.
+static void btif_read_le_key(const uint8_t key_type, const size_t key_len,
+                             bt_bdaddr_t bd_addr, tBTA_DM_BONDED_DEV* p_dev) {
+  CHECK(p_dev->num_le_keys < BTA_DM_BONDED_LE_KEYS_MAX);
+
+  tBTA_LE_KEY_VALUE* p_key = &p_dev->le_keys[p_dev->num_le_keys];
+  memset(p_key, 0, sizeof(tBTA_LE_KEY_VALUE));
+
+  if (btif_storage_get_ble_bonding_key(&bd_addr, key_type, (char*)p_key,
+                                       key_len) == BT_STATUS_SUCCESS) {
+    char bd_str[20] = {0};
+    BTIF_TRACE_DEBUG("%s() Adding key type %d for %s", __func__, key_type,
+                     bdaddr_to_string(&bd_addr, bd_str, sizeof(bd_str)));
+    p_dev->le_key_types[p_dev->num_le_keys++] = key_type;
   }
 }
 
@@ -564,7 +647,7 @@ bt_status_t btif_storage_get_adapter_property(bt_property_t* property) {
   } else if (property->type == BT_PROPERTY_ADAPTER_BONDED_DEVICES) {
     btif_bonded_devices_t bonded_devices;
 
-    btif_in_fetch_bonded_devices(&bonded_devices, 0);
+    btif_in_fetch_bonded_devices(&bonded_devices, NULL);
 
     BTIF_TRACE_DEBUG(
         "%s: Number of bonded devices: %d "
@@ -770,11 +853,32 @@ bt_status_t btif_storage_remove_bonded_device(bt_bdaddr_t* remote_bd_addr) {
     ret &= btif_config_remove(bdstr, "PinLength");
   if (btif_config_exist(bdstr, "LinkKey"))
     ret &= btif_config_remove(bdstr, "LinkKey");
+  if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS))
+    ret &= btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS);
+  if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE))
+    ret &= btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_SDP_CACHE);
+  btif_storage_invalidate_sdp_cache(remote_bd_addr);
   /* write bonded info immediately */
   btif_config_flush();
   return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_storage_invalidate_sdp_cache
+ *
+ * Description      BTIF storage API - Drops the SDP responses cached for the
+ *                  remote device, so that its services are searched again.
+ *                  The persisted ones are removed by the stack in turn.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btif_storage_invalidate_sdp_cache(bt_bdaddr_t* remote_bd_addr) {
+  do_in_bta_thread(FROM_HERE, base::Bind(&btif_storage_sdp_cache_invalidate,
+                                         *remote_bd_addr));
+}
+
 /*******************************************************************************
  *
  * Function         btif_storage_load_bonded_devices
@@ -802,7 +906,11 @@ bt_status_t btif_storage_load_bonded_devices(void) {
   bt_uuid_t remote_uuids[BT_MAX_NUM_UUIDS];
   bt_status_t status;
 
-  btif_in_fetch_bonded_devices(&bonded_devices, 1);
+  /* The SDP responses of the bonded devices are persisted, and loaded with
+   * them */
+  do_in_bta_thread(FROM_HERE, base::Bind(&SDP_SetCacheCallback,
+                                         &btif_storage_sdp_cache_cback));
+  btif_in_load_bonded_devices(&bonded_devices);
 
   /* Now send the adapter_properties_cb with all adapter_properties */
   {
@@ -1118,60 +1226,45 @@ bt_status_t btif_storage_remove_ble_local_keys(void) {
   return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
 }
 
-static bt_status_t btif_in_fetch_bonded_ble_device(
-    const char* remote_bd_addr, int add,
-    btif_bonded_devices_t* p_bonded_devices) {
+static void btif_in_read_bonded_ble_device(const char* remote_bd_addr,
+                                           tBTA_DM_BONDED_DEV* p_dev) {
   int device_type;
   int addr_type;
   bt_bdaddr_t bd_addr;
-  BD_ADDR bta_bd_addr;
-  bool device_added = false;
-  bool key_found = false;
 
-  if (!btif_config_get_int(remote_bd_addr, "DevType", &device_type))
-    return BT_STATUS_FAIL;
+  if (!btif_config_get_int(remote_bd_addr, "DevType", &device_type)) return;
 
   if ((device_type & BT_DEVICE_TYPE_BLE) == BT_DEVICE_TYPE_BLE ||
       btif_has_ble_keys(remote_bd_addr)) {
     BTIF_TRACE_DEBUG("%s Found a LE device: %s", __func__, remote_bd_addr);
 
     string_to_bdaddr(remote_bd_addr, &bd_addr);
-    bdcpy(bta_bd_addr, bd_addr.address);
 
     if (btif_storage_get_remote_addr_type(&bd_addr, &addr_type) !=
         BT_STATUS_SUCCESS) {
       addr_type = BLE_ADDR_PUBLIC;
       btif_storage_set_remote_addr_type(&bd_addr, BLE_ADDR_PUBLIC);
     }
+    p_dev->addr_type = (tBLE_ADDR_TYPE)addr_type;
 
     btif_read_le_key(BTIF_DM_LE_KEY_PENC, sizeof(tBTM_LE_PENC_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     p_dev);
 
     btif_read_le_key(BTIF_DM_LE_KEY_PID, sizeof(tBTM_LE_PID_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     p_dev);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LID, sizeof(tBTM_LE_PID_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     p_dev);
 
     btif_read_le_key(BTIF_DM_LE_KEY_PCSRK, sizeof(tBTM_LE_PCSRK_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     p_dev);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LENC, sizeof(tBTM_LE_LENC_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
+                     p_dev);
 
     btif_read_le_key(BTIF_DM_LE_KEY_LCSRK, sizeof(tBTM_LE_LCSRK_KEYS), bd_addr,
-                     addr_type, add, &device_added, &key_found);
-
-    // Fill in the bonded devices
-    if (device_added) {
-      memcpy(&p_bonded_devices->devices[p_bonded_devices->num_devices++],
-             &bd_addr, sizeof(bt_bdaddr_t));
-      btif_gatts_add_bonded_dev_from_nv(bta_bd_addr);
-    }
-
-    if (key_found) return BT_STATUS_SUCCESS;
+                     p_dev);
   }
-  return BT_STATUS_FAIL;
 }
 
 bt_status_t btif_storage_set_remote_addr_type(bt_bdaddr_t* remote_bd_addr,
@@ -1432,6 +1525,81 @@ bt_status_t btif_storage_remove_hidd(bt_bdaddr_t* remote_bd_addr) {
   return BT_STATUS_SUCCESS;
 }
 
+/*******************************************************************************
+ *
+ * Function         btif_storage_set_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Stores the |length| octets of |caps|, the
+ *                  stream endpoints of the bonded A2DP peer and their
+ *                  capabilities, in NVRAM
+ *
+ * Returns          BT_STATUS_SUCCESS if the store was successful,
+ *                  BT_STATUS_FAIL otherwise, or if the peer is not bonded
+ *
+ ******************************************************************************/
+bt_status_t btif_storage_set_a2dp_peer_caps(const bt_bdaddr_t* remote_bd_addr,
+                                            const uint8_t* caps,
+                                            size_t length) {
+  bdstr_t bdstr;
+  bdaddr_to_string(remote_bd_addr, bdstr, sizeof(bdstr));
+
+  /* the capabilities are only kept along with the bond */
+  if (!btif_config_exist(bdstr, "LinkKey")) return BT_STATUS_FAIL;
+
+  if (!btif_config_set_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS, caps,
+                           length))
+    return BT_STATUS_FAIL;
+  btif_config_save();
+  return BT_STATUS_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_get_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Reads the stream endpoints of the A2DP
+ *                  peer stored by btif_storage_set_a2dp_peer_caps in |caps|,
+ *                  of |*length| octets. |*length| is set to the length read.
+ *
+ * Returns          true if they were found and fit in |caps|
+ *
+ ******************************************************************************/
+bool btif_storage_get_a2dp_peer_caps(const bt_bdaddr_t* remote_bd_addr,
+                                     uint8_t* caps, size_t* length) {
+  bdstr_t bdstr;
+  bdaddr_to_string(remote_bd_addr, bdstr, sizeof(bdstr));
+
+  size_t stored_length =
+      btif_config_get_bin_length(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS);
+  if (stored_length == 0 || stored_length > *length) return false;
+
+  *length = stored_length;
+  return btif_config_get_bin(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS, caps,
+                             length);
+}
+
+/*******************************************************************************
+ *
+ * Function         btif_storage_remove_a2dp_peer_caps
+ *
+ * Description      BTIF storage API - Deletes the stream endpoints of the A2DP
+ *                  peer from NVRAM
+ *
+ * Returns          BT_STATUS_SUCCESS
+ *
+ ******************************************************************************/
+bt_status_t btif_storage_remove_a2dp_peer_caps(
+    const bt_bdaddr_t* remote_bd_addr) {
+  bdstr_t bdstr;
+  bdaddr_to_string(remote_bd_addr, bdstr, sizeof(bdstr));
+
+  if (btif_config_exist(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS)) {
+    btif_config_remove(bdstr, BTIF_STORAGE_PATH_REMOTE_A2DP_CAPS);
+    btif_config_save();
+  }
+  return BT_STATUS_SUCCESS;
+}
+
 // Get the name of a device from btif for interop database matching.
 bool btif_storage_get_stored_remote_name(const bt_bdaddr_t& bd_addr,
                                          char* name) {
@@ -22,23 +22,55 @@
  *                 socket usage per app UID.
  *
  ******************************************************************************/
+#include <atomic>
 #include <mutex>
+#include <new>
 
 #include "bt_common.h"
 #include "btif_uid.h"
 
+// Number of UIDs each thread accounts without the lock. The transfers of any
+// other UID take the lock.
+#define UID_SHARD_SIZE 16
+
 typedef struct uid_set_node_t {
   struct uid_set_node_t* next;
   bt_uid_traffic_t data;
 } uid_set_node_t;
 
+// A slot is claimed once for a UID by its owner thread, then only its
+// counters change: the owner adds to them, and uid_set_read_and_clear()
+// takes them.
+typedef struct {
+  std::atomic<int32_t> app_uid;  // -1 while the slot is free
+  std::atomic<uint64_t> tx_bytes;
+  std::atomic<uint64_t> rx_bytes;
+} uid_shard_slot_t;
+
+// The counters of the UIDs accounted by one thread.
+typedef struct uid_shard_t {
+  struct uid_shard_t* next;
+  uid_shard_slot_t slots[UID_SHARD_SIZE];
+} uid_shard_t;
+
 typedef struct uid_set_t {
   std::mutex lock;
   uid_set_node_t* head;
+  uid_shard_t* shards;
+  uint32_t id;
 } uid_set_t;
 
+// Tells a set from a set allocated later at the same address.
+static std::atomic<uint32_t> uid_set_next_id(1);
+
+// The shard of the calling thread, for the set |id|.
+static thread_local uint32_t uid_shard_set_id = 0;
+static thread_local uid_shard_t* uid_shard = NULL;
+
 uid_set_t* uid_set_create(void) {
   uid_set_t* set = (uid_set_t*)osi_calloc(sizeof(uid_set_t));
+  new (&set->lock) std::mutex();
+  set->id = uid_set_next_id++;
   return set;
 }
 
@@ -51,6 +83,17 @@ void uid_set_destroy(uid_set_t* set) {
     osi_free(temp);
   }
   set->head = NULL;
+
+  uid_shard_t* shard = set->shards;
+  while (shard) {
+    uid_shard_t* temp = shard;
+    shard = shard->next;
+    osi_free(temp);
+  }
+  set->shards = NULL;
+  lock.unlock();
+
+  set->lock.~mutex();
   osi_free(set);
 }
 
@@ -71,9 +114,55 @@ static uid_set_node_t* uid_set_find_or_create_node(uid_set_t* set,
   return node;
 }
 
+// Returns the shard of the calling thread for |set|, created on the first
+// transfer it accounts.
+static uid_shard_t* uid_set_get_shard(uid_set_t* set) {
+  if (uid_shard_set_id == set->id) return uid_shard;
+
+  uid_shard_t* shard = (uid_shard_t*)osi_calloc(sizeof(uid_shard_t));
+  for (size_t i = 0; i < UID_SHARD_SIZE; i++) {
+    new (&shard->slots[i].app_uid) std::atomic<int32_t>(-1);
+    new (&shard->slots[i].tx_bytes) std::atomic<uint64_t>(0);
+    new (&shard->slots[i].rx_bytes) std::atomic<uint64_t>(0);
+  }
+
+  std::unique_lock<std::mutex> lock(set->lock);
+  shard->next = set->shards;
+  set->shards = shard;
+  lock.unlock();
+
+  uid_shard_set_id = set->id;
+  uid_shard = shard;
+  return shard;
+}
+
+// Returns the slot of |app_uid| in the shard of the calling thread, or NULL
+// if the shard is full.
+static uid_shard_slot_t* uid_set_get_slot(uid_set_t* set, int32_t app_uid) {
+  uid_shard_t* shard = uid_set_get_shard(set);
+
+  size_t start = (uint32_t)app_uid % UID_SHARD_SIZE;
+  for (size_t i = 0; i < UID_SHARD_SIZE; i++) {
+    uid_shard_slot_t* slot = &shard->slots[(start + i) % UID_SHARD_SIZE];
+    int32_t slot_uid = slot->app_uid.load(std::memory_order_relaxed);
+    if (slot_uid == app_uid) return slot;
+    if (slot_uid == -1) {
+      slot->app_uid.store(app_uid, std::memory_order_release);
+      return slot;
+    }
+  }
+  return NULL;
+}
+
 void uid_set_add_tx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
   if (app_uid == -1 || bytes == 0) return;
 
+  uid_shard_slot_t* slot = uid_set_get_slot(set, app_uid);
+  if (slot) {
+    slot->tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(set->lock);
   uid_set_node_t* node = uid_set_find_or_create_node(set, app_uid);
   node->data.tx_bytes += bytes;
@@ -82,6 +171,12 @@ void uid_set_add_tx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
 void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
   if (app_uid == -1 || bytes == 0) return;
 
+  uid_shard_slot_t* slot = uid_set_get_slot(set, app_uid);
+  if (slot) {
+    slot->rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(set->lock);
   uid_set_node_t* node = uid_set_find_or_create_node(set, app_uid);
   node->data.rx_bytes += bytes;
@@ -90,6 +185,22 @@ void uid_set_add_rx(uid_set_t* set, int32_t app_uid, uint64_t bytes) {
 bt_uid_traffic_t* uid_set_read_and_clear(uid_set_t* set) {
   std::unique_lock<std::mutex> lock(set->lock);
 
+  // Collect the counters of the threads. The transfers accounted meanwhile
+  // are left for the next read.
+  for (uid_shard_t* shard = set->shards; shard; shard = shard->next) {
+    for (size_t i = 0; i < UID_SHARD_SIZE; i++) {
+      uid_shard_slot_t* slot = &shard->slots[i];
+      int32_t app_uid = slot->app_uid.load(std::memory_order_acquire);
+      if (app_uid == -1) continue;
+
+      uid_set_node_t* node = uid_set_find_or_create_node(set, app_uid);
+      node->data.tx_bytes +=
+          slot->tx_bytes.exchange(0, std::memory_order_relaxed);
+      node->data.rx_bytes +=
+          slot->rx_bytes.exchange(0, std::memory_order_relaxed);
+    }
+  }
+
   // Find the length
   size_t len = 0;
   uid_set_node_t* node = set->head;
@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "btif/include/btif_config_journal.h"
+#include "osi/include/config.h"
+
+static const char JOURNAL_FILE[] = "/data/local/tmp/bt_config_journal_test";
+
+class BtifConfigJournalTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { remove(JOURNAL_FILE); }
+  virtual void TearDown() { remove(JOURNAL_FILE); }
+
+  void WriteJournal(const std::string& records) {
+    FILE* fp = fopen(JOURNAL_FILE, "wt");
+    ASSERT_TRUE(fp != NULL);
+    fwrite(records.data(), 1, records.size(), fp);
+    fclose(fp);
+  }
+};
+
+TEST_F(BtifConfigJournalTest, test_replay_missing_journal) {
+  config_t* config = config_new_empty();
+  size_t applied = 1;
+  EXPECT_TRUE(btif_config_journal_replay(config, JOURNAL_FILE, &applied));
+  EXPECT_EQ(0u, applied);
+  config_free(config);
+}
+
+TEST_F(BtifConfigJournalTest, test_replay_in_order) {
+  std::string records;
+  EXPECT_TRUE(btif_config_journal_add_set(&records, "Adapter", "Name", "a"));
+  EXPECT_TRUE(btif_config_journal_add_set(&records, "Adapter", "Name", "b"));
+  EXPECT_TRUE(btif_config_journal_add_set(&records, "00:11:22:33:44:55",
+                                          "LinkKey", "0123"));
+  EXPECT_TRUE(btif_config_journal_add_set(&records, "Adapter", "Mode", "1"));
+  EXPECT_TRUE(btif_config_journal_add_remove(&records, "Adapter", "Mode"));
+  WriteJournal(records);
+
+  config_t* config = config_new_empty();
+  config_set_string(config, "Adapter", "Mode", "0");
+  size_t applied = 0;
+  EXPECT_TRUE(btif_config_journal_replay(config, JOURNAL_FILE, &applied));
+  EXPECT_EQ(5u, applied);
+  EXPECT_STREQ("b", config_get_string(config, "Adapter", "Name", NULL));
+  EXPECT_STREQ("0123", config_get_string(config, "00:11:22:33:44:55",
+                                         "LinkKey", NULL));
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Mode"));
+  config_free(config);
+}
+
+TEST_F(BtifConfigJournalTest, test_replay_ignores_torn_record) {
+  std::string records;
+  btif_config_journal_add_set(&records, "Adapter", "Name", "a");
+  btif_config_journal_add_set(&records, "Adapter", "Address", "0011");
+  records.resize(records.size() - 3);
+  WriteJournal(records);
+
+  config_t* config = config_new_empty();
+  size_t applied = 0;
+  EXPECT_FALSE(btif_config_journal_replay(config, JOURNAL_FILE, &applied));
+  EXPECT_EQ(1u, applied);
+  EXPECT_STREQ("a", config_get_string(config, "Adapter", "Name", NULL));
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Address"));
+  config_free(config);
+}
+
+TEST_F(BtifConfigJournalTest, test_replay_stops_at_corrupted_record) {
+  std::string records;
+  btif_config_journal_add_set(&records, "Adapter", "Name", "a");
+  records.append("X\tAdapter\n");
+  btif_config_journal_add_set(&records, "Adapter", "Address", "0011");
+  WriteJournal(records);
+
+  config_t* config = config_new_empty();
+  size_t applied = 0;
+  EXPECT_FALSE(btif_config_journal_replay(config, JOURNAL_FILE, &applied));
+  EXPECT_EQ(1u, applied);
+  EXPECT_FALSE(config_has_key(config, "Adapter", "Address"));
+  config_free(config);
+}
+
+TEST_F(BtifConfigJournalTest, test_unjournalable_fields) {
+  std::string records;
+  EXPECT_FALSE(
+      btif_config_journal_add_set(&records, "Adapter", "Name", "a\tb"));
+  EXPECT_FALSE(btif_config_journal_add_remove(&records, "Adap\nter", "Name"));
+  EXPECT_TRUE(records.empty());
+}
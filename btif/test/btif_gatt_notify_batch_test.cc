@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "btif/include/btif_gatt_notify_batch.h"
+
+static const size_t RING_SIZE = 1024;
+
+static std::vector<tBTA_GATTC_NOTIFY> delivered;
+static std::vector<size_t> batch_counts;
+
+static void record_batch(const tBTA_GATTC_NOTIFY* notify, size_t count) {
+  delivered.insert(delivered.end(), notify, notify + count);
+  batch_counts.push_back(count);
+}
+
+class BtifGattNotifyBatchTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    delivered.clear();
+    batch_counts.clear();
+  }
+
+  tBTA_GATTC_NOTIFY MakeNotify(uint16_t conn_id, uint16_t handle,
+                               uint16_t len, bool is_notify) {
+    tBTA_GATTC_NOTIFY notify;
+    memset(&notify, 0, sizeof(notify));
+    notify.conn_id = conn_id;
+    notify.bda[5] = conn_id;
+    notify.handle = handle;
+    notify.len = len;
+    memset(notify.value, handle, len);
+    notify.is_notify = is_notify;
+    return notify;
+  }
+};
+
+TEST_F(BtifGattNotifyBatchTest, test_new_free) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 4, record_batch);
+  ASSERT_TRUE(batch != NULL);
+  btif_gatt_notify_batch_free(batch);
+  btif_gatt_notify_batch_free(NULL);
+}
+
+TEST_F(BtifGattNotifyBatchTest, test_single_drain_scheduled) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 4, record_batch);
+
+  tBTA_GATTC_NOTIFY notify = MakeNotify(1, 0x10, 20, true);
+  EXPECT_TRUE(btif_gatt_notify_batch_put(batch, &notify));
+  for (int i = 0; i < 5; i++)
+    EXPECT_FALSE(btif_gatt_notify_batch_put(batch, &notify));
+
+  btif_gatt_notify_batch_drain(batch);
+  EXPECT_EQ(6U, delivered.size());
+  ASSERT_EQ(2U, batch_counts.size());
+  EXPECT_EQ(4U, batch_counts[0]);
+  EXPECT_EQ(2U, batch_counts[1]);
+
+  // The drain is over, the next notification schedules a new one.
+  EXPECT_TRUE(btif_gatt_notify_batch_put(batch, &notify));
+
+  btif_gatt_notify_batch_free(batch);
+}
+
+TEST_F(BtifGattNotifyBatchTest, test_order_and_contents) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 16, record_batch);
+
+  for (uint16_t handle = 1; handle <= 3; handle++) {
+    tBTA_GATTC_NOTIFY notify = MakeNotify(1, handle, handle * 10, handle != 2);
+    btif_gatt_notify_batch_put(batch, &notify);
+  }
+  tBTA_GATTC_NOTIFY other = MakeNotify(2, 0x20, 0, true);
+  btif_gatt_notify_batch_put(batch, &other);
+
+  btif_gatt_notify_batch_drain(batch);
+  ASSERT_EQ(4U, delivered.size());
+
+  uint16_t next_handle = 1;
+  for (const tBTA_GATTC_NOTIFY& notify : delivered) {
+    if (notify.conn_id == 2) {
+      EXPECT_EQ(0x20, notify.handle);
+      EXPECT_EQ(0, notify.len);
+      continue;
+    }
+    EXPECT_EQ(1, notify.conn_id);
+    EXPECT_EQ(1, notify.bda[5]);
+    EXPECT_EQ(next_handle, notify.handle);
+    EXPECT_EQ(next_handle * 10, notify.len);
+    EXPECT_EQ(next_handle != 2, notify.is_notify);
+    for (uint16_t i = 0; i < notify.len; i++)
+      EXPECT_EQ(next_handle, notify.value[i]);
+    next_handle++;
+  }
+  EXPECT_EQ(4, next_handle);
+
+  btif_gatt_notify_batch_free(batch);
+}
+
+TEST_F(BtifGattNotifyBatchTest, test_round_robin) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 2, record_batch);
+
+  for (int i = 0; i < 4; i++) {
+    tBTA_GATTC_NOTIFY notify = MakeNotify(1, 0x10, 1, true);
+    btif_gatt_notify_batch_put(batch, &notify);
+  }
+  tBTA_GATTC_NOTIFY other = MakeNotify(2, 0x20, 1, true);
+  btif_gatt_notify_batch_put(batch, &other);
+
+  // The second connection is not starved by the first one.
+  btif_gatt_notify_batch_drain(batch);
+  ASSERT_EQ(5U, delivered.size());
+  EXPECT_TRUE(delivered[0].conn_id == 2 || delivered[1].conn_id == 2);
+
+  btif_gatt_notify_batch_free(batch);
+}
+
+TEST_F(BtifGattNotifyBatchTest, test_full_ring) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 16, record_batch);
+
+  size_t queued = 0;
+  for (int i = 0; i < 16; i++) {
+    tBTA_GATTC_NOTIFY notify = MakeNotify(1, 0x10, 200, true);
+    btif_gatt_notify_batch_put(batch, &notify);
+  }
+  queued = 16 - btif_gatt_notify_batch_get_dropped(batch);
+  EXPECT_GT(btif_gatt_notify_batch_get_dropped(batch), 0U);
+
+  // An indication is never dropped, the oldest notifications are.
+  tBTA_GATTC_NOTIFY indication = MakeNotify(1, 0x30, 200, false);
+  btif_gatt_notify_batch_put(batch, &indication);
+
+  btif_gatt_notify_batch_drain(batch);
+  ASSERT_FALSE(delivered.empty());
+  EXPECT_LE(delivered.size(), queued);
+  EXPECT_EQ(0x30, delivered.back().handle);
+  EXPECT_FALSE(delivered.back().is_notify);
+
+  btif_gatt_notify_batch_free(batch);
+}
+
+TEST_F(BtifGattNotifyBatchTest, test_close_delivers_queued) {
+  btif_gatt_notify_batch_t* batch =
+      btif_gatt_notify_batch_new(RING_SIZE, 16, record_batch);
+
+  tBTA_GATTC_NOTIFY notify = MakeNotify(1, 0x10, 20, true);
+  btif_gatt_notify_batch_put(batch, &notify);
+  btif_gatt_notify_batch_close(batch, 1);
+
+  btif_gatt_notify_batch_drain(batch);
+  EXPECT_EQ(1U, delivered.size());
+
+  // Closing a connection without notifications is harmless.
+  btif_gatt_notify_batch_close(batch, 1);
+  btif_gatt_notify_batch_close(batch, 2);
+
+  btif_gatt_notify_batch_free(batch);
+}
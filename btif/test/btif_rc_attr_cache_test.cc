@@ -0,0 +1,188 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <string>
+
+#include "btif/include/btif_rc_attr_cache.h"
+
+static const size_t CACHE_SIZE = 64;
+static const period_ms_t TIMEOUT_MS = 1000;
+static const uint16_t PLAYER_ID = 3;
+static const uint16_t UID_COUNTER = 7;
+
+static void make_uid(uint8_t n, tAVRC_UID uid) {
+  memset(uid, 0, AVRC_UID_SIZE);
+  uid[AVRC_UID_SIZE - 1] = n;
+}
+
+static tAVRC_FULL_NAME make_value(const char* text) {
+  tAVRC_FULL_NAME value;
+  value.charset_id = AVRC_CHARSET_ID_UTF8;
+  value.str_len = strlen(text);
+  value.p_str = (uint8_t*)text;
+  return value;
+}
+
+static std::string value_text(const tAVRC_ATTR_ENTRY& attr) {
+  return std::string((const char*)attr.name.p_str, attr.name.str_len);
+}
+
+class BtifRcAttrCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    cache = btif_rc_attr_cache_new(CACHE_SIZE, TIMEOUT_MS);
+    ASSERT_TRUE(cache != NULL);
+  }
+
+  virtual void TearDown() { btif_rc_attr_cache_free(cache); }
+
+  void PutTitleArtist(uint8_t n, period_ms_t now_ms) {
+    tAVRC_UID uid;
+    make_uid(n, uid);
+    tAVRC_FULL_NAME title = make_value("title");
+    tAVRC_FULL_NAME artist = make_value("artist");
+    btif_rc_attr_cache_put(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM, uid,
+                           UID_COUNTER, AVRC_MEDIA_ATTR_ID_TITLE, &title,
+                           now_ms);
+    btif_rc_attr_cache_put(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM, uid,
+                           UID_COUNTER, AVRC_MEDIA_ATTR_ID_ARTIST, &artist,
+                           now_ms);
+  }
+
+  bool Get(uint8_t n, uint16_t player_id, uint16_t uid_counter,
+           period_ms_t now_ms) {
+    tAVRC_UID uid;
+    make_uid(n, uid);
+    const uint32_t attr_ids[] = {AVRC_MEDIA_ATTR_ID_ARTIST,
+                                 AVRC_MEDIA_ATTR_ID_TITLE};
+    return btif_rc_attr_cache_get(cache, player_id, AVRC_SCOPE_FILE_SYSTEM,
+                                  uid, uid_counter, attr_ids, 2, now_ms, attrs,
+                                  &num_attrs);
+  }
+
+  btif_rc_attr_cache_t* cache;
+  tAVRC_ATTR_ENTRY attrs[8];
+  uint8_t num_attrs;
+};
+
+TEST(BtifRcAttrCacheNewTest, test_disabled) {
+  EXPECT_TRUE(btif_rc_attr_cache_new(0, TIMEOUT_MS) == NULL);
+  btif_rc_attr_cache_free(NULL);
+}
+
+TEST_F(BtifRcAttrCacheTest, test_put_get) {
+  EXPECT_FALSE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+
+  PutTitleArtist(1, 0);
+  ASSERT_TRUE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+  ASSERT_EQ(2, num_attrs);
+  EXPECT_EQ((uint32_t)AVRC_MEDIA_ATTR_ID_ARTIST, attrs[0].attr_id);
+  EXPECT_EQ("artist", value_text(attrs[0]));
+  EXPECT_EQ(AVRC_CHARSET_ID_UTF8, attrs[0].name.charset_id);
+  EXPECT_EQ((uint32_t)AVRC_MEDIA_ATTR_ID_TITLE, attrs[1].attr_id);
+  EXPECT_EQ("title", value_text(attrs[1]));
+
+  /* the other items, players and UID counters are not cached */
+  EXPECT_FALSE(Get(2, PLAYER_ID, UID_COUNTER, 0));
+  EXPECT_FALSE(Get(1, PLAYER_ID + 1, UID_COUNTER, 0));
+  EXPECT_FALSE(Get(1, PLAYER_ID, UID_COUNTER + 1, 0));
+}
+
+TEST_F(BtifRcAttrCacheTest, test_value_copied) {
+  tAVRC_UID uid;
+  make_uid(1, uid);
+  char text[] = "title";
+  tAVRC_FULL_NAME title = make_value(text);
+  btif_rc_attr_cache_put(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM, uid,
+                         UID_COUNTER, AVRC_MEDIA_ATTR_ID_TITLE, &title, 0);
+  memset(text, 'x', strlen(text));
+
+  const uint32_t attr_id = AVRC_MEDIA_ATTR_ID_TITLE;
+  ASSERT_TRUE(btif_rc_attr_cache_get(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM,
+                                     uid, UID_COUNTER, &attr_id, 1, 0, attrs,
+                                     &num_attrs));
+  ASSERT_EQ(1, num_attrs);
+  EXPECT_EQ("title", value_text(attrs[0]));
+}
+
+TEST_F(BtifRcAttrCacheTest, test_partial) {
+  tAVRC_UID uid;
+  make_uid(1, uid);
+  tAVRC_FULL_NAME title = make_value("title");
+  btif_rc_attr_cache_put(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM, uid,
+                         UID_COUNTER, AVRC_MEDIA_ATTR_ID_TITLE, &title, 0);
+
+  /* the artist is not known */
+  EXPECT_FALSE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+
+  /* the artist is known to be absent */
+  btif_rc_attr_cache_put(cache, PLAYER_ID, AVRC_SCOPE_FILE_SYSTEM, uid,
+                         UID_COUNTER, AVRC_MEDIA_ATTR_ID_ARTIST, NULL, 0);
+  ASSERT_TRUE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+  ASSERT_EQ(1, num_attrs);
+  EXPECT_EQ((uint32_t)AVRC_MEDIA_ATTR_ID_TITLE, attrs[0].attr_id);
+}
+
+TEST_F(BtifRcAttrCacheTest, test_scope) {
+  PutTitleArtist(1, 0);
+
+  tAVRC_UID uid;
+  make_uid(1, uid);
+  const uint32_t attr_id = AVRC_MEDIA_ATTR_ID_TITLE;
+  EXPECT_FALSE(btif_rc_attr_cache_get(cache, PLAYER_ID, AVRC_SCOPE_NOW_PLAYING,
+                                      uid, UID_COUNTER, &attr_id, 1, 0, attrs,
+                                      &num_attrs));
+}
+
+TEST_F(BtifRcAttrCacheTest, test_timeout) {
+  PutTitleArtist(1, 100);
+  EXPECT_TRUE(Get(1, PLAYER_ID, UID_COUNTER, 100 + TIMEOUT_MS - 1));
+  EXPECT_FALSE(Get(1, PLAYER_ID, UID_COUNTER, 100 + TIMEOUT_MS));
+}
+
+TEST_F(BtifRcAttrCacheTest, test_clear) {
+  PutTitleArtist(1, 0);
+  PutTitleArtist(2, 0);
+  btif_rc_attr_cache_clear(cache);
+  EXPECT_FALSE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+  EXPECT_FALSE(Get(2, PLAYER_ID, UID_COUNTER, 0));
+
+  PutTitleArtist(1, 0);
+  EXPECT_TRUE(Get(1, PLAYER_ID, UID_COUNTER, 0));
+}
+
+TEST_F(BtifRcAttrCacheTest, test_many_items) {
+  /* more attributes than the cache holds: some are evicted, and the others
+   * are still returned as they were given */
+  for (int n = 0; n < 100; n++) PutTitleArtist(n, 0);
+
+  int hits = 0;
+  for (int n = 0; n < 100; n++) {
+    if (!Get(n, PLAYER_ID, UID_COUNTER, 0)) continue;
+    hits++;
+    ASSERT_EQ(2, num_attrs);
+    EXPECT_EQ("artist", value_text(attrs[0]));
+    EXPECT_EQ("title", value_text(attrs[1]));
+  }
+  EXPECT_GT(hits, 0);
+  EXPECT_TRUE(Get(99, PLAYER_ID, UID_COUNTER, 0));
+}
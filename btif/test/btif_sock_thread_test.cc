@@ -0,0 +1,221 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "btif/include/btif_sock_thread.h"
+
+namespace {
+
+/* more than the 64 sockets the poll thread used to be limited to */
+const int NUM_SOCKETS = 100;
+const int TYPE = 7;
+
+std::mutex signals_mutex;
+std::condition_variable signals_cv;
+std::map<uint32_t, int> signals;  // the flags signaled, by user id
+int num_signals;
+
+std::vector<uint8_t> cmd_data;
+int num_cmds;
+
+void signaled(int fd, int type, int flags, uint32_t user_id) {
+  /* the data is not read, for the socket to be signaled again once added
+   * again */
+  EXPECT_EQ(TYPE, type);
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  signals[user_id] |= flags;
+  num_signals++;
+  signals_cv.notify_all();
+}
+
+void cmd_received(int cmd_fd, int type, int size, uint32_t user_id) {
+  std::vector<uint8_t> data(size);
+  EXPECT_EQ(size, recv(cmd_fd, data.data(), size, MSG_WAITALL));
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  cmd_data.insert(cmd_data.end(), data.begin(), data.end());
+  num_cmds++;
+  signals_cv.notify_all();
+}
+
+/* Waits for |count| signals in total, returning false on timeout */
+bool WaitForSignals(int count) {
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  return signals_cv.wait_for(lock, std::chrono::seconds(5),
+                             [count] { return num_signals >= count; });
+}
+
+/* Waits for the commands sent to the poll thread of |handle| to be handled */
+void WaitForCommands(int handle) {
+  int count;
+  {
+    std::unique_lock<std::mutex> lock(signals_mutex);
+    count = num_cmds + 1;
+  }
+  const unsigned char data = 0;
+  EXPECT_TRUE(btsock_thread_post_cmd(handle, 0, &data, sizeof(data), 0));
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  EXPECT_TRUE(signals_cv.wait_for(lock, std::chrono::seconds(5),
+                                  [count] { return num_cmds >= count; }));
+}
+
+/* Checks that no more than |count| signals are received for a while */
+void ExpectNoMoreSignals(int count) {
+  /* a wakeup command is handled after the sockets already ready */
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  EXPECT_EQ(count, num_signals);
+}
+
+}  // namespace
+
+class BtifSockThreadTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    signals.clear();
+    num_signals = 0;
+    cmd_data.clear();
+    num_cmds = 0;
+
+    btsock_thread_init();
+    handle_ = btsock_thread_create(signaled, cmd_received);
+    ASSERT_GE(handle_, 0);
+
+    for (int i = 0; i < NUM_SOCKETS; i++) {
+      int fds[2];
+      ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+      our_fds_.push_back(fds[0]);
+      app_fds_.push_back(fds[1]);
+    }
+  }
+
+  virtual void TearDown() {
+    EXPECT_TRUE(btsock_thread_exit(handle_));
+    for (int fd : our_fds_)
+      if (fd != -1) close(fd);
+    for (int fd : app_fds_)
+      if (fd != -1) close(fd);
+  }
+
+  int handle_;
+  std::vector<int> our_fds_;
+  std::vector<int> app_fds_;
+};
+
+TEST_F(BtifSockThreadTest, test_many_sockets_signaled_once) {
+  for (int i = 0; i < NUM_SOCKETS; i++)
+    EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[i], TYPE,
+                                     SOCK_THREAD_FD_RD, i));
+  for (int i = 0; i < NUM_SOCKETS; i++)
+    ASSERT_EQ(1, write(app_fds_[i], "x", 1));
+
+  ASSERT_TRUE(WaitForSignals(NUM_SOCKETS));
+  ExpectNoMoreSignals(NUM_SOCKETS);
+  for (int i = 0; i < NUM_SOCKETS; i++)
+    EXPECT_EQ(SOCK_THREAD_FD_RD, signals[i]) << i;
+
+  /* the data left unread is signaled again once the socket is added again */
+  signals.clear();
+  for (int i = 0; i < NUM_SOCKETS; i++)
+    EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[i], TYPE,
+                                     SOCK_THREAD_FD_RD, i));
+  ASSERT_TRUE(WaitForSignals(2 * NUM_SOCKETS));
+  ExpectNoMoreSignals(2 * NUM_SOCKETS);
+  EXPECT_EQ((size_t)NUM_SOCKETS, signals.size());
+}
+
+TEST_F(BtifSockThreadTest, test_read_and_write) {
+  /* the socket is writable at once; the read stays monitored */
+  EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[0], TYPE,
+                                   SOCK_THREAD_FD_RD | SOCK_THREAD_FD_WR, 0));
+  ASSERT_TRUE(WaitForSignals(1));
+  EXPECT_EQ(SOCK_THREAD_FD_WR, signals[0]);
+
+  ASSERT_EQ(1, write(app_fds_[0], "x", 1));
+  ASSERT_TRUE(WaitForSignals(2));
+  EXPECT_EQ(SOCK_THREAD_FD_RD | SOCK_THREAD_FD_WR, signals[0]);
+  ExpectNoMoreSignals(2);
+}
+
+TEST_F(BtifSockThreadTest, test_exception) {
+  EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[0], TYPE,
+                                   SOCK_THREAD_FD_RD, 0));
+  close(app_fds_[0]);
+  app_fds_[0] = -1;
+
+  ASSERT_TRUE(WaitForSignals(1));
+  EXPECT_TRUE(signals[0] & SOCK_THREAD_FD_EXCEPTION);
+}
+
+TEST_F(BtifSockThreadTest, test_remove_fd_and_close) {
+  EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[0], TYPE,
+                                   SOCK_THREAD_FD_RD, 0));
+  EXPECT_TRUE(btsock_thread_remove_fd_and_close(handle_, our_fds_[0]));
+  our_fds_[0] = -1;
+
+  /* the socket closed is never signaled */
+  EXPECT_TRUE(btsock_thread_wakeup(handle_));
+  ExpectNoMoreSignals(0);
+}
+
+TEST_F(BtifSockThreadTest, test_fd_closed_and_reused) {
+  EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[0], TYPE,
+                                   SOCK_THREAD_FD_RD, 0));
+  WaitForCommands(handle_);
+  int fd = our_fds_[0];
+  close(our_fds_[0]);
+  close(app_fds_[0]);
+
+  /* the fd of another socket reuses the number of the one closed. It is only
+   * monitored for its own flags */
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  our_fds_[0] = fds[0];
+  app_fds_[0] = fds[1];
+  ASSERT_EQ(fd, our_fds_[0]);
+  ASSERT_EQ(1, write(app_fds_[0], "x", 1));
+
+  EXPECT_TRUE(btsock_thread_add_fd(handle_, our_fds_[0], TYPE,
+                                   SOCK_THREAD_FD_WR, 1));
+  ASSERT_TRUE(WaitForSignals(1));
+  ExpectNoMoreSignals(1);
+  EXPECT_EQ(SOCK_THREAD_FD_WR, signals[1]);
+}
+
+TEST_F(BtifSockThreadTest, test_post_cmd) {
+  const unsigned char data[] = {1, 2, 3, 4};
+  for (int i = 0; i < 40; i++)
+    EXPECT_TRUE(btsock_thread_post_cmd(handle_, 0, data, sizeof(data), i));
+
+  std::unique_lock<std::mutex> lock(signals_mutex);
+  ASSERT_TRUE(signals_cv.wait_for(lock, std::chrono::seconds(5),
+                                  [] { return num_cmds == 40; }));
+  ASSERT_EQ(40 * sizeof(data), cmd_data.size());
+  for (size_t i = 0; i < cmd_data.size(); i++)
+    EXPECT_EQ(data[i % sizeof(data)], cmd_data[i]);
+}
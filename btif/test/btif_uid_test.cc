@@ -0,0 +1,137 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "btif/include/btif_uid.h"
+
+namespace {
+
+typedef std::pair<uint64_t, uint64_t> Bytes;
+typedef std::map<int32_t, Bytes> Traffic;
+
+/* Returns the tx and rx bytes of each UID read from |set| */
+Traffic ReadAndClear(uid_set_t* set) {
+  Traffic traffic;
+  bt_uid_traffic_t* data = uid_set_read_and_clear(set);
+  for (bt_uid_traffic_t* p = data; p->app_uid != -1; p++) {
+    EXPECT_EQ(0U, traffic.count(p->app_uid)) << "UID reported twice";
+    traffic[p->app_uid] = Bytes(p->tx_bytes, p->rx_bytes);
+  }
+  osi_free(data);
+  return traffic;
+}
+
+}  // namespace
+
+TEST(BtifUidTest, AccountsAndClears) {
+  uid_set_t* set = uid_set_create();
+
+  uid_set_add_tx(set, 1000, 10);
+  uid_set_add_rx(set, 1000, 20);
+  uid_set_add_tx(set, 1001, 5);
+  uid_set_add_tx(set, -1, 5);
+  uid_set_add_rx(set, 1002, 0);
+
+  Traffic traffic = ReadAndClear(set);
+  EXPECT_EQ(2U, traffic.size());
+  EXPECT_EQ(Bytes(10, 20), traffic[1000]);
+  EXPECT_EQ(Bytes(5, 0), traffic[1001]);
+
+  /* the UIDs seen are still reported, with cleared counters */
+  uid_set_add_rx(set, 1001, 7);
+  traffic = ReadAndClear(set);
+  EXPECT_EQ(2U, traffic.size());
+  EXPECT_EQ(Bytes(0, 0), traffic[1000]);
+  EXPECT_EQ(Bytes(0, 7), traffic[1001]);
+
+  uid_set_destroy(set);
+}
+
+TEST(BtifUidTest, ManyUids) {
+  uid_set_t* set = uid_set_create();
+
+  /* more UIDs than a thread accounts without the lock */
+  for (int32_t uid = 0; uid < 100; uid++) {
+    uid_set_add_tx(set, 10000 + uid, uid + 1);
+    uid_set_add_rx(set, 10000 + uid, 2 * (uid + 1));
+  }
+
+  Traffic traffic = ReadAndClear(set);
+  EXPECT_EQ(100U, traffic.size());
+  for (int32_t uid = 0; uid < 100; uid++) {
+    EXPECT_EQ(Bytes(uid + 1, 2 * (uid + 1)), traffic[10000 + uid]);
+  }
+
+  uid_set_destroy(set);
+}
+
+TEST(BtifUidTest, NewSetAfterDestroy) {
+  uid_set_t* set = uid_set_create();
+  uid_set_add_tx(set, 1000, 10);
+  uid_set_destroy(set);
+
+  /* the thread does not account into the shard of the destroyed set */
+  set = uid_set_create();
+  uid_set_add_tx(set, 1000, 3);
+  Traffic traffic = ReadAndClear(set);
+  EXPECT_EQ(Bytes(3, 0), traffic[1000]);
+  uid_set_destroy(set);
+}
+
+TEST(BtifUidTest, Concurrent) {
+  const int num_threads = 4;
+  const int num_transfers = 100000;
+  uid_set_t* set = uid_set_create();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([set, i]() {
+      for (int j = 0; j < num_transfers; j++) {
+        uid_set_add_tx(set, 1000 + j % 4, 1);
+        uid_set_add_rx(set, 2000 + i, 2);
+      }
+    });
+  }
+
+  /* the reads meanwhile lose nothing */
+  Traffic total;
+  for (int i = 0; i < 100; i++) {
+    for (const auto& it : ReadAndClear(set)) {
+      total[it.first].first += it.second.first;
+      total[it.first].second += it.second.second;
+    }
+  }
+  for (auto& thread : threads) thread.join();
+  for (const auto& it : ReadAndClear(set)) {
+    total[it.first].first += it.second.first;
+    total[it.first].second += it.second.second;
+  }
+
+  for (int32_t uid = 1000; uid < 1004; uid++)
+    EXPECT_EQ((uint64_t)num_threads * num_transfers / 4, total[uid].first);
+  for (int32_t uid = 2000; uid < 2000 + num_threads; uid++)
+    EXPECT_EQ((uint64_t)2 * num_transfers, total[uid].second);
+
+  uid_set_destroy(set);
+}
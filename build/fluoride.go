@@ -61,5 +61,11 @@ func globalDefaults(ctx android.BaseContext) ([]string, []string) {
     cflags = append(cflags, "-DHAS_NO_BDROID_BUILDCFG")
   }
 
+  // The highest trace level compiled in, see BT_TRACE_MAX_LEVEL
+  trace_max_level := ctx.AConfig().Getenv("BLUETOOTH_TRACE_MAX_LEVEL")
+  if (len(trace_max_level) > 0) {
+    cflags = append(cflags, "-DBT_TRACE_MAX_LEVEL=" + trace_max_level)
+  }
+
   return cflags, includeDirs
 }
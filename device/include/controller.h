@@ -60,11 +60,17 @@ typedef struct controller_t {
   bool (*supports_ble_coded_phy)(void);
   bool (*supports_ble_extended_advertising)(void);
   bool (*supports_ble_periodic_advertising)(void);
+  // Whether CIS can be set up as master, or BIS broadcast, with ISO data
+  // sent by the host.
+  bool (*supports_ble_isochronous_channels)(void);
 
   // Get the cached acl data sizes for the controller.
   uint16_t (*get_acl_data_size_classic)(void);
   uint16_t (*get_acl_data_size_ble)(void);
 
+  // Get the cached ISO data size for the controller, 0 without ISO channels.
+  uint16_t (*get_iso_data_size)(void);
+
   // Get the cached acl packet sizes for the controller.
   // This is a convenience function for the respective
   // acl data size + size of the acl header.
@@ -79,6 +85,9 @@ typedef struct controller_t {
   uint16_t (*get_acl_buffer_count_classic)(void);
   uint8_t (*get_acl_buffer_count_ble)(void);
 
+  // Get the number of ISO data packets the controller can buffer.
+  uint8_t (*get_iso_buffer_count)(void);
+
   uint8_t (*get_ble_white_list_size)(void);
 
   uint8_t (*get_ble_resolving_list_max_size)(void);
@@ -79,6 +79,21 @@ typedef enum {
   // Some A2DP Sink devices report SUCCESS to the AVDTP RECONFIGURE command,
   // but fail to play the reconfigured audio stream.
   INTEROP_DISABLE_AVDTP_RECONFIGURE,
+
+  // Do not exchange the ATT MTU nor negotiate the LE data length as soon as
+  // the LE link is up. Some devices disconnect when they receive these
+  // requests before they have started their own procedures.
+  INTEROP_DISABLE_LE_AUTO_MTU_AND_DATA_LENGTH,
+
+  // Do not send AVDTP get capabilities commands back to back, before the
+  // response to the previous one. Some devices drop or reject a command
+  // while they have not responded to the previous one.
+  INTEROP_DISABLE_AVDTP_PIPELINING,
+
+  // Do not connect several profiles at once, wait for each profile to be
+  // connected before connecting the next one. Some devices fail to set up a
+  // profile while they are setting up another one.
+  INTEROP_SERIALIZE_PROFILE_CONNECTIONS,
 } interop_feature_t;
 
 // Check if a given |addr| matches a known interoperability workaround as
@@ -21,18 +21,29 @@
 #include "device/include/controller.h"
 
 #include <base/logging.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "bt_types.h"
 #include "btcore/include/event_mask.h"
 #include "btcore/include/module.h"
 #include "btcore/include/version.h"
+#include "hci_event_filter.h"
 #include "hcimsgs.h"
+#include "osi/include/config.h"
 #include "osi/include/future.h"
+#include "osi/include/log.h"
+#include "osi/include/time.h"
 #include "stack/include/btm_ble_api.h"
 
 const bt_event_mask_t BLE_EVENT_MASK = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x1E, 0x7f}};
 
+// BLE_EVENT_MASK with the CIS Established, CIS Request, Create BIG Complete
+// and Terminate BIG Complete events, bits 24 to 27.
+const bt_event_mask_t BLE_ISO_EVENT_MASK = {
+    {0x00, 0x00, 0x00, 0x00, 0x0F, 0x02, 0x1E, 0x7f}};
+
 const bt_event_mask_t CLASSIC_EVENT_MASK = {HCI_DUMO_EVENT_MASK_EXT};
 
 // TODO(zachoverflow): factor out into common module
@@ -59,6 +70,8 @@ static uint16_t acl_data_size_classic;
 static uint16_t acl_data_size_ble;
 static uint16_t acl_buffer_count_classic;
 static uint8_t acl_buffer_count_ble;
+static uint16_t iso_data_size;
+static uint8_t iso_buffer_count;
 
 static uint8_t ble_white_list_size;
 static uint8_t ble_resolving_list_max_size;
@@ -78,81 +91,133 @@ static bool secure_connections_supported;
 #define AWAIT_COMMAND(command) \
   static_cast<BT_HDR*>(future_await(hci->transmit_command_futured(command)))
 
+#define AWAIT_FUTURE(future) static_cast<BT_HDR*>(future_await(future))
+
+// The capabilities read from the controller once the host features are set
+// only change with its firmware, so they are kept across the restarts of the
+// stack, keyed by the version of the controller, and not read again.
+#if defined(OS_GENERIC)
+static const char* CAPABILITIES_CACHE_PATH = "bt_controller_cache.conf";
+#else  // !defined(OS_GENERIC)
+static const char* CAPABILITIES_CACHE_PATH =
+    "/data/misc/bluedroid/bt_controller_cache.conf";
+#endif  // defined(OS_GENERIC)
+static const char* CAPABILITIES_SECTION = "Controller";
+
+static bool load_capabilities(void);
+static void save_capabilities(void);
+static void read_ble_capabilities(void);
+static bool iso_channels_supported(void);
+static void log_phase(const char* phase, uint32_t* phase_start_ms);
+
 // Module lifecycle functions
 
 static future_t* start_up(void) {
   BT_HDR* response;
+  uint32_t start_ms = time_get_os_boottime_ms();
+  uint32_t phase_start_ms = start_ms;
 
   // Send the initial reset command
   response = AWAIT_COMMAND(packet_factory->make_reset());
   packet_parser->parse_generic_command_complete(response);
+  log_phase("reset", &phase_start_ms);
 
-  // Request the classic buffer size next
-  response = AWAIT_COMMAND(packet_factory->make_read_buffer_size());
-  packet_parser->parse_read_buffer_size_response(
-      response, &acl_data_size_classic, &acl_buffer_count_classic);
+  // The reads below do not depend on each other, so send them back to back
+  // and let the HCI layer pipeline them as far as the controller's command
+  // credits allow, instead of waiting for each response in turn.
+  future_t* read_buffer_size_future =
+      hci->transmit_command_futured(packet_factory->make_read_buffer_size());
 
   // Tell the controller about our buffer sizes and buffer counts next
   // TODO(zachoverflow): factor this out. eww l2cap contamination. And why just
   // a hardcoded 10?
-  response = AWAIT_COMMAND(packet_factory->make_host_buffer_size(
-      L2CAP_MTU_SIZE, SCO_HOST_BUFFER_SIZE, L2CAP_HOST_FC_ACL_BUFS, 10));
-
-  packet_parser->parse_generic_command_complete(response);
+  future_t* host_buffer_size_future =
+      hci->transmit_command_futured(packet_factory->make_host_buffer_size(
+          L2CAP_MTU_SIZE, SCO_HOST_BUFFER_SIZE, L2CAP_HOST_FC_ACL_BUFS, 10));
 
   // Read the local version info off the controller next, including
   // information such as manufacturer and supported HCI version
-  response = AWAIT_COMMAND(packet_factory->make_read_local_version_info());
-  packet_parser->parse_read_local_version_info_response(response, &bt_version);
+  future_t* read_local_version_info_future = hci->transmit_command_futured(
+      packet_factory->make_read_local_version_info());
 
   // Read the bluetooth address off the controller next
-  response = AWAIT_COMMAND(packet_factory->make_read_bd_addr());
-  packet_parser->parse_read_bd_addr_response(response, &address);
+  future_t* read_bd_addr_future =
+      hci->transmit_command_futured(packet_factory->make_read_bd_addr());
 
   // Request the controller's supported commands next
-  response =
-      AWAIT_COMMAND(packet_factory->make_read_local_supported_commands());
-  packet_parser->parse_read_local_supported_commands_response(
-      response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
+  future_t* read_local_supported_commands_future =
+      hci->transmit_command_futured(
+          packet_factory->make_read_local_supported_commands());
 
   // Read page 0 of the controller features next
   uint8_t page_number = 0;
-  response = AWAIT_COMMAND(
+  future_t* read_local_extended_features_future = hci->transmit_command_futured(
       packet_factory->make_read_local_extended_features(page_number));
+
+  response = AWAIT_FUTURE(read_buffer_size_future);
+  packet_parser->parse_read_buffer_size_response(
+      response, &acl_data_size_classic, &acl_buffer_count_classic);
+
+  response = AWAIT_FUTURE(host_buffer_size_future);
+  packet_parser->parse_generic_command_complete(response);
+
+  response = AWAIT_FUTURE(read_local_version_info_future);
+  packet_parser->parse_read_local_version_info_response(response, &bt_version);
+
+  response = AWAIT_FUTURE(read_bd_addr_future);
+  packet_parser->parse_read_bd_addr_response(response, &address);
+
+  response = AWAIT_FUTURE(read_local_supported_commands_future);
+  packet_parser->parse_read_local_supported_commands_response(
+      response, supported_commands, HCI_SUPPORTED_COMMANDS_ARRAY_SIZE);
+
+  response = AWAIT_FUTURE(read_local_extended_features_future);
   packet_parser->parse_read_local_extended_features_response(
       response, &page_number, &last_features_classic_page_index,
       features_classic, MAX_FEATURES_CLASSIC_PAGE_COUNT);
 
   CHECK(page_number == 0);
   page_number++;
+  log_phase("local info", &phase_start_ms);
 
   // Inform the controller what page 0 features we support, based on what
   // it told us it supports. We need to do this first before we request the
   // next page, because the controller's response for page 1 may be
-  // dependent on what we configure from page 0
+  // dependent on what we configure from page 0. The two writes do not depend
+  // on each other.
+  future_t* write_simple_pairing_mode_future = NULL;
   simple_pairing_supported =
       HCI_SIMPLE_PAIRING_SUPPORTED(features_classic[0].as_array);
   if (simple_pairing_supported) {
-    response = AWAIT_COMMAND(
+    write_simple_pairing_mode_future = hci->transmit_command_futured(
         packet_factory->make_write_simple_pairing_mode(HCI_SP_MODE_ENABLED));
-    packet_parser->parse_generic_command_complete(response);
   }
 
+  future_t* ble_write_host_support_future = NULL;
   if (HCI_LE_SPT_SUPPORTED(features_classic[0].as_array)) {
     uint8_t simultaneous_le_host =
         HCI_SIMUL_LE_BREDR_SUPPORTED(features_classic[0].as_array)
             ? BTM_BLE_SIMULTANEOUS_HOST
             : 0;
-    response = AWAIT_COMMAND(packet_factory->make_ble_write_host_support(
-        BTM_BLE_HOST_SUPPORT, simultaneous_le_host));
-
-    packet_parser->parse_generic_command_complete(response);
+    ble_write_host_support_future = hci->transmit_command_futured(
+        packet_factory->make_ble_write_host_support(BTM_BLE_HOST_SUPPORT,
+                                                    simultaneous_le_host));
 
     // If we modified the BT_HOST_SUPPORT, we will need ext. feat. page 1
     if (last_features_classic_page_index < 1)
       last_features_classic_page_index = 1;
   }
 
+  if (write_simple_pairing_mode_future != NULL) {
+    response = AWAIT_FUTURE(write_simple_pairing_mode_future);
+    packet_parser->parse_generic_command_complete(response);
+  }
+
+  if (ble_write_host_support_future != NULL) {
+    response = AWAIT_FUTURE(ble_write_host_support_future);
+    packet_parser->parse_generic_command_complete(response);
+  }
+
   // Done telling the controller about what page 0 features we support
   // Request the remaining feature pages
   while (page_number <= last_features_classic_page_index &&
@@ -176,82 +241,80 @@ static future_t* start_up(void) {
     packet_parser->parse_generic_command_complete(response);
   }
 #endif
+  log_phase("host features", &phase_start_ms);
 
   ble_supported = last_features_classic_page_index >= 1 &&
                   HCI_LE_HOST_SUPPORTED(features_classic[1].as_array);
-  if (ble_supported) {
-    // Request the ble white list size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_white_list_size());
-    packet_parser->parse_ble_read_white_list_size_response(
-        response, &ble_white_list_size);
 
-    // Request the ble buffer size next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_buffer_size());
-    packet_parser->parse_ble_read_buffer_size_response(
-        response, &acl_data_size_ble, &acl_buffer_count_ble);
+  bool capabilities_cached = load_capabilities();
+  if (!capabilities_cached && ble_supported) read_ble_capabilities();
 
-    // Response of 0 indicates ble has the same buffer size as classic
-    if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
+  // Set the event masks, and read the local supported codecs, together. The
+  // masks leave out the events of the stack features not active yet, which
+  // the event filter asks for when they start.
+  const bt_event_mask_t* ble_event_mask = NULL;
+  future_t* ble_set_host_feature_future = NULL;
+  if (ble_supported) {
+    ble_event_mask = &BLE_EVENT_MASK;
+    if (iso_channels_supported()) {
+      ble_event_mask = &BLE_ISO_EVENT_MASK;
+      ble_set_host_feature_future = hci->transmit_command_futured(
+          packet_factory->make_ble_set_host_feature(
+              HCI_LE_FEATURE_ISO_HOST_SUPPORT_BIT, 1));
+    }
+  }
+  hci_event_filter_start_up(
+      hci, packet_factory,
+      simple_pairing_supported ? &CLASSIC_EVENT_MASK : NULL, ble_event_mask);
 
-    // Request the ble supported states next
-    response = AWAIT_COMMAND(packet_factory->make_ble_read_supported_states());
-    packet_parser->parse_ble_read_supported_states_response(
-        response, ble_supported_states, sizeof(ble_supported_states));
+  future_t* ble_set_event_mask_future = NULL;
+  if (ble_supported) {
+    bt_event_mask_t event_mask = hci_event_filter_get_le_mask();
+    ble_set_event_mask_future = hci->transmit_command_futured(
+        packet_factory->make_ble_set_event_mask(&event_mask));
+  }
 
-    // Request the ble supported features next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_read_local_supported_features());
-    packet_parser->parse_ble_read_local_supported_features_response(
-        response, &features_ble);
-
-    if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
-      response =
-          AWAIT_COMMAND(packet_factory->make_ble_read_resolving_list_size());
-      packet_parser->parse_ble_read_resolving_list_size_response(
-          response, &ble_resolving_list_max_size);
-    }
+  future_t* set_event_mask_future = NULL;
+  if (simple_pairing_supported) {
+    bt_event_mask_t event_mask = hci_event_filter_get_classic_mask();
+    set_event_mask_future = hci->transmit_command_futured(
+        packet_factory->make_set_event_mask(&event_mask));
+  }
 
-    if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_suggested_default_data_length());
-      packet_parser->parse_ble_read_suggested_default_data_length_response(
-          response, &ble_suggested_default_data_length);
-    }
+  future_t* read_local_supported_codecs_future = NULL;
+  if (!capabilities_cached &&
+      HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
+    read_local_supported_codecs_future = hci->transmit_command_futured(
+        packet_factory->make_read_local_supported_codecs());
+  }
 
-    if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_maximum_advertising_data_length());
-      packet_parser->parse_ble_read_maximum_advertising_data_length(
-          response, &ble_maxium_advertising_data_length);
-
-      response = AWAIT_COMMAND(
-          packet_factory->make_ble_read_number_of_supported_advertising_sets());
-      packet_parser->parse_ble_read_number_of_supported_advertising_sets(
-          response, &ble_number_of_supported_advertising_sets);
-    } else {
-      /* If LE Excended Advertising is not supported, use the default value */
-      ble_maxium_advertising_data_length = 31;
-    }
+  if (ble_set_host_feature_future != NULL) {
+    response = AWAIT_FUTURE(ble_set_host_feature_future);
+    packet_parser->parse_generic_command_complete(response);
+  }
 
-    // Set the ble event mask next
-    response =
-        AWAIT_COMMAND(packet_factory->make_ble_set_event_mask(&BLE_EVENT_MASK));
+  if (ble_set_event_mask_future != NULL) {
+    response = AWAIT_FUTURE(ble_set_event_mask_future);
     packet_parser->parse_generic_command_complete(response);
   }
 
-  if (simple_pairing_supported) {
-    response =
-        AWAIT_COMMAND(packet_factory->make_set_event_mask(&CLASSIC_EVENT_MASK));
+  if (set_event_mask_future != NULL) {
+    response = AWAIT_FUTURE(set_event_mask_future);
     packet_parser->parse_generic_command_complete(response);
   }
 
-  // read local supported codecs
-  if (HCI_READ_LOCAL_CODECS_SUPPORTED(supported_commands)) {
-    response =
-        AWAIT_COMMAND(packet_factory->make_read_local_supported_codecs());
+  if (read_local_supported_codecs_future != NULL) {
+    response = AWAIT_FUTURE(read_local_supported_codecs_future);
     packet_parser->parse_read_local_supported_codecs_response(
         response, &number_of_local_supported_codecs, local_supported_codecs);
   }
+  log_phase(capabilities_cached ? "capabilities (cached)" : "capabilities",
+            &phase_start_ms);
+
+  if (!capabilities_cached) save_capabilities();
+
+  LOG_INFO(LOG_TAG, "Controller start up took %u ms",
+           time_get_os_boottime_ms() - start_ms);
 
   readable = true;
   return future_new_immediate(FUTURE_SUCCESS);
@@ -259,6 +322,7 @@ static future_t* start_up(void) {
 
 static future_t* shut_down(void) {
   readable = false;
+  hci_event_filter_shut_down();
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -270,6 +334,276 @@ EXPORT_SYMBOL extern const module_t controller_module = {
     .clean_up = NULL,
     .dependencies = {HCI_MODULE, NULL}};
 
+// Internal functions
+
+// Reads the BLE capabilities of the controller: the reads of each batch do not
+// depend on each other, and are pipelined as those of the local info.
+static void read_ble_capabilities(void) {
+  BT_HDR* response;
+
+  // Request the ble white list size next
+  future_t* ble_read_white_list_size_future = hci->transmit_command_futured(
+      packet_factory->make_ble_read_white_list_size());
+
+  // Request the ble buffer size next
+  future_t* ble_read_buffer_size_future = hci->transmit_command_futured(
+      packet_factory->make_ble_read_buffer_size());
+
+  // Request the ble supported states next
+  future_t* ble_read_supported_states_future = hci->transmit_command_futured(
+      packet_factory->make_ble_read_supported_states());
+
+  // Request the ble supported features next
+  future_t* ble_read_local_supported_features_future =
+      hci->transmit_command_futured(
+          packet_factory->make_ble_read_local_supported_features());
+
+  response = AWAIT_FUTURE(ble_read_white_list_size_future);
+  packet_parser->parse_ble_read_white_list_size_response(response,
+                                                         &ble_white_list_size);
+
+  response = AWAIT_FUTURE(ble_read_buffer_size_future);
+  packet_parser->parse_ble_read_buffer_size_response(
+      response, &acl_data_size_ble, &acl_buffer_count_ble);
+
+  // Response of 0 indicates ble has the same buffer size as classic
+  if (acl_data_size_ble == 0) acl_data_size_ble = acl_data_size_classic;
+
+  response = AWAIT_FUTURE(ble_read_supported_states_future);
+  packet_parser->parse_ble_read_supported_states_response(
+      response, ble_supported_states, sizeof(ble_supported_states));
+
+  response = AWAIT_FUTURE(ble_read_local_supported_features_future);
+  packet_parser->parse_ble_read_local_supported_features_response(
+      response, &features_ble);
+
+  // The reads below depend on the ble features only
+  future_t* ble_read_resolving_list_size_future = NULL;
+  if (HCI_LE_ENHANCED_PRIVACY_SUPPORTED(features_ble.as_array)) {
+    ble_read_resolving_list_size_future = hci->transmit_command_futured(
+        packet_factory->make_ble_read_resolving_list_size());
+  }
+
+  future_t* ble_read_suggested_default_data_length_future = NULL;
+  if (HCI_LE_DATA_LEN_EXT_SUPPORTED(features_ble.as_array)) {
+    ble_read_suggested_default_data_length_future =
+        hci->transmit_command_futured(
+            packet_factory->make_ble_read_suggested_default_data_length());
+  }
+
+  future_t* ble_read_maximum_advertising_data_length_future = NULL;
+  future_t* ble_read_number_of_supported_advertising_sets_future = NULL;
+  if (HCI_LE_EXTENDED_ADVERTISING_SUPPORTED(features_ble.as_array)) {
+    ble_read_maximum_advertising_data_length_future =
+        hci->transmit_command_futured(
+            packet_factory->make_ble_read_maximum_advertising_data_length());
+    ble_read_number_of_supported_advertising_sets_future =
+        hci->transmit_command_futured(
+            packet_factory
+                ->make_ble_read_number_of_supported_advertising_sets());
+  } else {
+    /* If LE Excended Advertising is not supported, use the default value */
+    ble_maxium_advertising_data_length = 31;
+  }
+
+  future_t* ble_read_buffer_size_v2_future = NULL;
+  if ((HCI_LE_CIS_MASTER_SUPPORTED(features_ble.as_array) ||
+       HCI_LE_ISO_BROADCASTER_SUPPORTED(features_ble.as_array)) &&
+      HCI_BLE_READ_BUFFER_SIZE_V2_SUPPORTED(supported_commands)) {
+    ble_read_buffer_size_v2_future = hci->transmit_command_futured(
+        packet_factory->make_ble_read_buffer_size_v2());
+  }
+
+  if (ble_read_resolving_list_size_future != NULL) {
+    response = AWAIT_FUTURE(ble_read_resolving_list_size_future);
+    packet_parser->parse_ble_read_resolving_list_size_response(
+        response, &ble_resolving_list_max_size);
+  }
+
+  if (ble_read_suggested_default_data_length_future != NULL) {
+    response = AWAIT_FUTURE(ble_read_suggested_default_data_length_future);
+    packet_parser->parse_ble_read_suggested_default_data_length_response(
+        response, &ble_suggested_default_data_length);
+  }
+
+  if (ble_read_maximum_advertising_data_length_future != NULL) {
+    response = AWAIT_FUTURE(ble_read_maximum_advertising_data_length_future);
+    packet_parser->parse_ble_read_maximum_advertising_data_length(
+        response, &ble_maxium_advertising_data_length);
+
+    response =
+        AWAIT_FUTURE(ble_read_number_of_supported_advertising_sets_future);
+    packet_parser->parse_ble_read_number_of_supported_advertising_sets(
+        response, &ble_number_of_supported_advertising_sets);
+  }
+
+  if (ble_read_buffer_size_v2_future != NULL) {
+    // The ACL buffers are those read by the first version already
+    uint16_t acl_data_size;
+    uint8_t acl_buffer_count;
+    response = AWAIT_FUTURE(ble_read_buffer_size_v2_future);
+    packet_parser->parse_ble_read_buffer_size_v2_response(
+        response, &acl_data_size, &acl_buffer_count, &iso_data_size,
+        &iso_buffer_count);
+  }
+}
+
+// Whether the ISO channels the host sends on are supported, needing the ISO
+// buffers read with the features.
+static bool iso_channels_supported(void) {
+  return (HCI_LE_CIS_MASTER_SUPPORTED(features_ble.as_array) ||
+          HCI_LE_ISO_BROADCASTER_SUPPORTED(features_ble.as_array)) &&
+         iso_data_size != 0 && iso_buffer_count != 0;
+}
+
+// Formats the key of the capabilities of the controller: its version, and
+// whether it runs with BLE.
+static void capabilities_key(char* key, size_t size) {
+  snprintf(key, size, "%02x:%04x:%02x:%04x:%04x:%d", bt_version.hci_version,
+           bt_version.hci_revision, bt_version.lmp_version,
+           bt_version.manufacturer, bt_version.lmp_subversion, ble_supported);
+}
+
+static bool get_hex(const config_t* config, const char* key, uint8_t* value,
+                    size_t len) {
+  const char* str = config_get_string(config, CAPABILITIES_SECTION, key, NULL);
+  if (str == NULL || strlen(str) != len * 2) return false;
+
+  for (size_t i = 0; i < len; i++) {
+    unsigned int byte;
+    if (sscanf(&str[i * 2], "%02x", &byte) != 1) return false;
+    value[i] = (uint8_t)byte;
+  }
+  return true;
+}
+
+static void set_hex(config_t* config, const char* key, const uint8_t* value,
+                    size_t len) {
+  // The arrays cached are at most 8 octets
+  char str[2 * 8 + 1];
+  CHECK(len <= 8);
+
+  for (size_t i = 0; i < len; i++) sprintf(&str[i * 2], "%02x", value[i]);
+  str[len * 2] = '\0';
+  config_set_string(config, CAPABILITIES_SECTION, key, str);
+}
+
+// Loads the capabilities cached for the controller. Returns false, leaving
+// them unset, if they were not cached for its version.
+static bool load_capabilities(void) {
+  config_t* config = config_new(CAPABILITIES_CACHE_PATH);
+  if (config == NULL) return false;
+
+  char key[32];
+  capabilities_key(key, sizeof(key));
+  const char* cached_key =
+      config_get_string(config, CAPABILITIES_SECTION, "Key", NULL);
+  bool loaded = cached_key != NULL && strcmp(cached_key, key) == 0;
+
+  number_of_local_supported_codecs =
+      config_get_int(config, CAPABILITIES_SECTION, "NumCodecs", 0);
+  if (number_of_local_supported_codecs > MAX_LOCAL_SUPPORTED_CODECS_SIZE)
+    loaded = false;
+  else if (number_of_local_supported_codecs > 0)
+    loaded = loaded && get_hex(config, "Codecs", local_supported_codecs,
+                               number_of_local_supported_codecs);
+
+  if (ble_supported) {
+    acl_data_size_ble =
+        config_get_int(config, CAPABILITIES_SECTION, "AclDataSizeBle", 0);
+    acl_buffer_count_ble =
+        config_get_int(config, CAPABILITIES_SECTION, "AclBufferCountBle", 0);
+    ble_white_list_size =
+        config_get_int(config, CAPABILITIES_SECTION, "WhiteListSize", 0);
+    ble_resolving_list_max_size =
+        config_get_int(config, CAPABILITIES_SECTION, "ResolvingListSize", 0);
+    ble_suggested_default_data_length = config_get_int(
+        config, CAPABILITIES_SECTION, "SuggestedDataLength", 0);
+    ble_maxium_advertising_data_length =
+        config_get_int(config, CAPABILITIES_SECTION, "MaxAdvDataLength", 0);
+    ble_number_of_supported_advertising_sets =
+        config_get_int(config, CAPABILITIES_SECTION, "NumAdvSets", 0);
+    iso_data_size =
+        config_get_int(config, CAPABILITIES_SECTION, "IsoDataSize", 0);
+    iso_buffer_count =
+        config_get_int(config, CAPABILITIES_SECTION, "IsoBufferCount", 0);
+    // The caches written before the ISO buffers were read are stale
+    loaded = loaded && acl_data_size_ble != 0 &&
+             config_has_key(config, CAPABILITIES_SECTION, "IsoDataSize") &&
+             get_hex(config, "FeaturesBle", features_ble.as_array,
+                     BLE_SUPPORTED_FEATURES_SIZE) &&
+             get_hex(config, "SupportedStatesBle", ble_supported_states,
+                     BLE_SUPPORTED_STATES_SIZE);
+  }
+  config_free(config);
+
+  if (!loaded) {
+    number_of_local_supported_codecs = 0;
+    ble_maxium_advertising_data_length = 0;
+    ble_number_of_supported_advertising_sets = 0;
+    ble_resolving_list_max_size = 0;
+    ble_suggested_default_data_length = 0;
+    iso_data_size = 0;
+    iso_buffer_count = 0;
+  }
+  return loaded;
+}
+
+// Caches the capabilities read from the controller for its version, replacing
+// those of any previous version.
+static void save_capabilities(void) {
+  config_t* config = config_new_empty();
+  if (config == NULL) return;
+
+  char key[32];
+  capabilities_key(key, sizeof(key));
+  config_set_string(config, CAPABILITIES_SECTION, "Key", key);
+
+  config_set_int(config, CAPABILITIES_SECTION, "NumCodecs",
+                 number_of_local_supported_codecs);
+  if (number_of_local_supported_codecs > 0)
+    set_hex(config, "Codecs", local_supported_codecs,
+            number_of_local_supported_codecs);
+
+  if (ble_supported) {
+    config_set_int(config, CAPABILITIES_SECTION, "AclDataSizeBle",
+                   acl_data_size_ble);
+    config_set_int(config, CAPABILITIES_SECTION, "AclBufferCountBle",
+                   acl_buffer_count_ble);
+    config_set_int(config, CAPABILITIES_SECTION, "WhiteListSize",
+                   ble_white_list_size);
+    config_set_int(config, CAPABILITIES_SECTION, "ResolvingListSize",
+                   ble_resolving_list_max_size);
+    config_set_int(config, CAPABILITIES_SECTION, "SuggestedDataLength",
+                   ble_suggested_default_data_length);
+    config_set_int(config, CAPABILITIES_SECTION, "MaxAdvDataLength",
+                   ble_maxium_advertising_data_length);
+    config_set_int(config, CAPABILITIES_SECTION, "NumAdvSets",
+                   ble_number_of_supported_advertising_sets);
+    config_set_int(config, CAPABILITIES_SECTION, "IsoDataSize", iso_data_size);
+    config_set_int(config, CAPABILITIES_SECTION, "IsoBufferCount",
+                   iso_buffer_count);
+    set_hex(config, "FeaturesBle", features_ble.as_array,
+            BLE_SUPPORTED_FEATURES_SIZE);
+    set_hex(config, "SupportedStatesBle", ble_supported_states,
+            BLE_SUPPORTED_STATES_SIZE);
+  }
+
+  if (!config_save(config, CAPABILITIES_CACHE_PATH))
+    LOG_WARN(LOG_TAG, "%s unable to save %s", __func__,
+             CAPABILITIES_CACHE_PATH);
+  config_free(config);
+}
+
+// Logs the time taken by the start up phase |phase|, started at
+// |*phase_start_ms|, and starts the next one.
+static void log_phase(const char* phase, uint32_t* phase_start_ms) {
+  uint32_t now_ms = time_get_os_boottime_ms();
+  LOG_INFO(LOG_TAG, "Controller start up: %s took %u ms", phase,
+           now_ms - *phase_start_ms);
+  *phase_start_ms = now_ms;
+}
+
 // Interface functions
 
 static bool get_is_ready(void) { return readable; }
@@ -414,6 +748,12 @@ static bool supports_ble_periodic_advertising(void) {
   return HCI_LE_PERIODIC_ADVERTISING_SUPPORTED(features_ble.as_array);
 }
 
+static bool supports_ble_isochronous_channels(void) {
+  CHECK(readable);
+  CHECK(ble_supported);
+  return iso_channels_supported();
+}
+
 static uint16_t get_acl_data_size_classic(void) {
   CHECK(readable);
   return acl_data_size_classic;
@@ -425,6 +765,11 @@ static uint16_t get_acl_data_size_ble(void) {
   return acl_data_size_ble;
 }
 
+static uint16_t get_iso_data_size(void) {
+  CHECK(readable);
+  return iso_data_size;
+}
+
 static uint16_t get_acl_packet_size_classic(void) {
   CHECK(readable);
   return acl_data_size_classic + HCI_DATA_PREAMBLE_SIZE;
@@ -464,6 +809,11 @@ static uint8_t get_acl_buffer_count_ble(void) {
   return acl_buffer_count_ble;
 }
 
+static uint8_t get_iso_buffer_count(void) {
+  CHECK(readable);
+  return iso_buffer_count;
+}
+
 static uint8_t get_ble_white_list_size(void) {
   CHECK(readable);
   CHECK(ble_supported);
@@ -525,9 +875,11 @@ static const controller_t interface = {
     supports_ble_coded_phy,
     supports_ble_extended_advertising,
     supports_ble_periodic_advertising,
+    supports_ble_isochronous_channels,
 
     get_acl_data_size_classic,
     get_acl_data_size_ble,
+    get_iso_data_size,
 
     get_acl_packet_size_classic,
     get_acl_packet_size_ble,
@@ -537,6 +889,7 @@ static const controller_t interface = {
 
     get_acl_buffer_count_classic,
     get_acl_buffer_count_ble,
+    get_iso_buffer_count,
 
     get_ble_white_list_size,
 
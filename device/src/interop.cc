@@ -21,21 +21,100 @@
 #include <base/logging.h>
 #include <string.h>  // For memcmp
 
+#include <unordered_map>
+#include <vector>
+
 #include "btcore/include/module.h"
 #include "device/include/interop.h"
 #include "device/include/interop_database.h"
-#include "osi/include/allocator.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 
 #define CASE_RETURN_STR(const) \
   case const:                  \
     return #const;
 
-static list_t* interop_list = NULL;
+namespace {
+
+// The entries of an address database by the OUI (the first three octets) of
+// their prefix, so that a lookup only compares the few entries of the OUI of
+// the address. The prefixes shorter than an OUI are kept aside.
+class InteropAddrIndex {
+ public:
+  void Add(const interop_addr_entry_t& entry) {
+    if (entry.length < kOuiLength)
+      short_entries_.push_back(entry);
+    else
+      by_oui_[OuiOf(&entry.addr)].push_back(entry);
+  }
+
+  bool Match(const interop_feature_t feature, const bt_bdaddr_t* addr) const {
+    for (const auto& entry : short_entries_)
+      if (Matches(entry, feature, addr)) return true;
+
+    const auto it = by_oui_.find(OuiOf(addr));
+    if (it == by_oui_.end()) return false;
+    for (const auto& entry : it->second)
+      if (Matches(entry, feature, addr)) return true;
+    return false;
+  }
+
+  void Clear() {
+    by_oui_.clear();
+    short_entries_.clear();
+  }
+
+ private:
+  static const size_t kOuiLength = 3;
+
+  static uint32_t OuiOf(const bt_bdaddr_t* addr) {
+    return addr->address[0] << 16 | addr->address[1] << 8 | addr->address[2];
+  }
+
+  static bool Matches(const interop_addr_entry_t& entry,
+                      const interop_feature_t feature,
+                      const bt_bdaddr_t* addr) {
+    return feature == entry.feature &&
+           memcmp(addr, &entry.addr, entry.length) == 0;
+  }
+
+  std::unordered_map<uint32_t, std::vector<interop_addr_entry_t>> by_oui_;
+  std::vector<interop_addr_entry_t> short_entries_;
+};
+
+// The entries of interop_name_database by the first character of their name.
+class InteropNameIndex {
+ public:
+  InteropNameIndex() {
+    for (const auto& entry : interop_name_database) {
+      if (entry.length == 0) {
+        // An empty prefix matches every name.
+        for (auto& entries : by_first_char_) entries.push_back(&entry);
+      } else {
+        by_first_char_[static_cast<uint8_t>(entry.name[0])].push_back(&entry);
+      }
+    }
+  }
+
+  bool Match(const interop_feature_t feature, const char* name) const {
+    const size_t length = strlen(name);
+    for (const auto* entry : by_first_char_[static_cast<uint8_t>(name[0])]) {
+      if (feature == entry->feature && length >= entry->length &&
+          strncmp(name, entry->name, entry->length) == 0)
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  std::vector<const interop_name_entry_t*> by_first_char_[256];
+};
+
+}  // namespace
+
+// The entries added at runtime, created on the first one.
+static InteropAddrIndex* interop_dynamic_index = NULL;
 
 static const char* interop_feature_string_(const interop_feature_t feature);
-static void interop_free_entry_(void* data);
 static void interop_lazy_init_(void);
 static bool interop_match_fixed_(const interop_feature_t feature,
                                  const bt_bdaddr_t* addr);
@@ -63,18 +142,9 @@ bool interop_match_addr(const interop_feature_t feature,
 bool interop_match_name(const interop_feature_t feature, const char* name) {
   CHECK(name);
 
-  const size_t db_size =
-      sizeof(interop_name_database) / sizeof(interop_name_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_name_database[i].feature &&
-        strlen(name) >= interop_name_database[i].length &&
-        strncmp(name, interop_name_database[i].name,
-                interop_name_database[i].length) == 0) {
-      return true;
-    }
-  }
-
-  return false;
+  // Built once, and never freed as the database is static.
+  static const InteropNameIndex* index = new InteropNameIndex();
+  return index->Match(feature, name);
 }
 
 void interop_database_add(const uint16_t feature, const bt_bdaddr_t* addr,
@@ -83,25 +153,25 @@ void interop_database_add(const uint16_t feature, const bt_bdaddr_t* addr,
   CHECK(length > 0);
   CHECK(length < sizeof(bt_bdaddr_t));
 
-  interop_addr_entry_t* entry = static_cast<interop_addr_entry_t*>(
-      osi_calloc(sizeof(interop_addr_entry_t)));
-  memcpy(&entry->addr, addr, length);
-  entry->feature = static_cast<interop_feature_t>(feature);
-  entry->length = length;
+  interop_addr_entry_t entry;
+  memset(&entry, 0, sizeof(entry));
+  memcpy(&entry.addr, addr, length);
+  entry.feature = static_cast<interop_feature_t>(feature);
+  entry.length = length;
 
   interop_lazy_init_();
-  list_append(interop_list, entry);
+  interop_dynamic_index->Add(entry);
 }
 
 void interop_database_clear() {
-  if (interop_list) list_clear(interop_list);
+  if (interop_dynamic_index) interop_dynamic_index->Clear();
 }
 
 // Module life-cycle functions
 
 static future_t* interop_clean_up(void) {
-  list_free(interop_list);
-  interop_list = NULL;
+  delete interop_dynamic_index;
+  interop_dynamic_index = NULL;
   return future_new_immediate(FUTURE_SUCCESS);
 }
 
@@ -127,54 +197,38 @@ static const char* interop_feature_string_(const interop_feature_t feature) {
     CASE_RETURN_STR(INTEROP_HID_PREF_CONN_SUP_TIMEOUT_3S)
     CASE_RETURN_STR(INTEROP_GATTC_NO_SERVICE_CHANGED_IND)
     CASE_RETURN_STR(INTEROP_DISABLE_AVDTP_RECONFIGURE)
+    CASE_RETURN_STR(INTEROP_DISABLE_LE_AUTO_MTU_AND_DATA_LENGTH)
+    CASE_RETURN_STR(INTEROP_DISABLE_AVDTP_PIPELINING)
+    CASE_RETURN_STR(INTEROP_SERIALIZE_PROFILE_CONNECTIONS)
   }
 
   return "UNKNOWN";
 }
 
-static void interop_free_entry_(void* data) {
-  interop_addr_entry_t* entry = (interop_addr_entry_t*)data;
-  osi_free(entry);
-}
-
 static void interop_lazy_init_(void) {
-  if (interop_list == NULL) {
-    interop_list = list_new(interop_free_entry_);
+  if (interop_dynamic_index == NULL) {
+    interop_dynamic_index = new InteropAddrIndex();
   }
 }
 
 static bool interop_match_dynamic_(const interop_feature_t feature,
                                    const bt_bdaddr_t* addr) {
-  if (interop_list == NULL || list_length(interop_list) == 0) return false;
-
-  const list_node_t* node = list_begin(interop_list);
-  while (node != list_end(interop_list)) {
-    interop_addr_entry_t* entry =
-        static_cast<interop_addr_entry_t*>(list_node(node));
-    CHECK(entry);
+  if (interop_dynamic_index == NULL) return false;
 
-    if (feature == entry->feature &&
-        memcmp(addr, &entry->addr, entry->length) == 0)
-      return true;
+  return interop_dynamic_index->Match(feature, addr);
+}
 
-    node = list_next(node);
-  }
-  return false;
+static const InteropAddrIndex* interop_build_fixed_index_(void) {
+  InteropAddrIndex* index = new InteropAddrIndex();
+  for (const auto& entry : interop_addr_database) index->Add(entry);
+  return index;
 }
 
 static bool interop_match_fixed_(const interop_feature_t feature,
                                  const bt_bdaddr_t* addr) {
   CHECK(addr);
 
-  const size_t db_size =
-      sizeof(interop_addr_database) / sizeof(interop_addr_entry_t);
-  for (size_t i = 0; i != db_size; ++i) {
-    if (feature == interop_addr_database[i].feature &&
-        memcmp(addr, &interop_addr_database[i].addr,
-               interop_addr_database[i].length) == 0) {
-      return true;
-    }
-  }
-
-  return false;
+  // Built once, and never freed as the database is static.
+  static const InteropAddrIndex* index = interop_build_fixed_index_();
+  return index->Match(feature, addr);
 }
@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of the interop checks of a connecting device: each address and name
+// check of the stack, against the static database and a dynamic one of
+// state.range(0) entries, as added from the interop configuration.
+
+#include <benchmark/benchmark.h>
+
+#include "device/include/interop.h"
+
+namespace {
+
+const interop_feature_t kAddrFeatures[] = {
+    INTEROP_DISABLE_LE_SECURE_CONNECTIONS, INTEROP_AUTO_RETRY_PAIRING,
+    INTEROP_DISABLE_ABSOLUTE_VOLUME,       INTEROP_2MBPS_LINK_ONLY,
+    INTEROP_HID_PREF_CONN_SUP_TIMEOUT_3S,  INTEROP_GATTC_NO_SERVICE_CHANGED_IND,
+    INTEROP_DISABLE_AVDTP_RECONFIGURE,
+    INTEROP_DISABLE_LE_AUTO_MTU_AND_DATA_LENGTH};
+
+const interop_feature_t kNameFeatures[] = {
+    INTEROP_DISABLE_AUTO_PAIRING, INTEROP_KEYBOARD_REQUIRES_FIXED_PIN,
+    INTEROP_GATTC_NO_SERVICE_CHANGED_IND, INTEROP_DISABLE_AVDTP_RECONFIGURE};
+
+// The devices connecting, none of them in the databases.
+const int kDevices = 64;
+
+void AddDynamicEntries(int count) {
+  interop_database_clear();
+  for (int i = 0; i < count; i++) {
+    bt_bdaddr_t addr = {{0x40, static_cast<uint8_t>(i >> 8),
+                         static_cast<uint8_t>(i), 0, 0, 0}};
+    interop_database_add(kAddrFeatures[i % 8], &addr, 3 + i % 2);
+  }
+}
+
+void BM_InteropMatchAddr(benchmark::State& state) {
+  AddDynamicEntries(state.range(0));
+  int device = 0;
+  while (state.KeepRunning()) {
+    bt_bdaddr_t addr = {{0x00, 0x5b, 0x7e, static_cast<uint8_t>(device), 0x12,
+                         0x34}};
+    for (const auto feature : kAddrFeatures)
+      benchmark::DoNotOptimize(interop_match_addr(feature, &addr));
+    device = (device + 1) % kDevices;
+  }
+  state.SetItemsProcessed(state.iterations() * 8);
+  interop_database_clear();
+}
+
+void BM_InteropMatchName(benchmark::State& state) {
+  const char* const kNames[] = {"Galaxy Buds", "Car Audio 3000",
+                                "Pixel C Keyboard", "JBL Flip 4"};
+  int device = 0;
+  while (state.KeepRunning()) {
+    for (const auto feature : kNameFeatures)
+      benchmark::DoNotOptimize(interop_match_name(feature, kNames[device]));
+    device = (device + 1) % 4;
+  }
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+
+}  // namespace
+
+BENCHMARK(BM_InteropMatchAddr)->Arg(0)->Arg(100);
+BENCHMARK(BM_InteropMatchName);
+
+BENCHMARK_MAIN();
@@ -67,11 +67,50 @@ TEST(InteropTest, test_dynamic) {
   EXPECT_FALSE(interop_match_addr(INTEROP_AUTO_RETRY_PAIRING, &test_address));
 }
 
+TEST(InteropTest, test_dynamic_prefix_lengths) {
+  bt_bdaddr_t test_address;
+  bt_bdaddr_t other_address;
+
+  // Shorter than an OUI
+  string_to_bdaddr("12:34:00:00:00:00", &test_address);
+  interop_database_add(INTEROP_DISABLE_ABSOLUTE_VOLUME, &test_address, 2);
+  string_to_bdaddr("12:34:56:78:9a:bc", &other_address);
+  EXPECT_TRUE(
+      interop_match_addr(INTEROP_DISABLE_ABSOLUTE_VOLUME, &other_address));
+  string_to_bdaddr("12:35:56:78:9a:bc", &other_address);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_ABSOLUTE_VOLUME, &other_address));
+
+  // Longer than an OUI, sharing the OUI of another entry
+  string_to_bdaddr("ab:cd:ef:01:00:00", &test_address);
+  interop_database_add(INTEROP_2MBPS_LINK_ONLY, &test_address, 4);
+  string_to_bdaddr("ab:cd:ef:02:00:00", &test_address);
+  interop_database_add(INTEROP_2MBPS_LINK_ONLY, &test_address, 5);
+  string_to_bdaddr("ab:cd:ef:01:23:45", &other_address);
+  EXPECT_TRUE(interop_match_addr(INTEROP_2MBPS_LINK_ONLY, &other_address));
+  string_to_bdaddr("ab:cd:ef:02:00:45", &other_address);
+  EXPECT_TRUE(interop_match_addr(INTEROP_2MBPS_LINK_ONLY, &other_address));
+  string_to_bdaddr("ab:cd:ef:02:01:45", &other_address);
+  EXPECT_FALSE(interop_match_addr(INTEROP_2MBPS_LINK_ONLY, &other_address));
+  string_to_bdaddr("ab:cd:ef:03:23:45", &other_address);
+  EXPECT_FALSE(interop_match_addr(INTEROP_2MBPS_LINK_ONLY, &other_address));
+
+  interop_database_clear();
+  string_to_bdaddr("12:34:56:78:9a:bc", &other_address);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_ABSOLUTE_VOLUME, &other_address));
+  string_to_bdaddr("ab:cd:ef:01:23:45", &other_address);
+  EXPECT_FALSE(interop_match_addr(INTEROP_2MBPS_LINK_ONLY, &other_address));
+}
+
 TEST(InteropTest, test_name_hit) {
   EXPECT_TRUE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "BMW M3"));
   EXPECT_TRUE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "Audi"));
   EXPECT_TRUE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING,
                                  "Caramel"));  // Starts with "Car" ;)
+  EXPECT_TRUE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "CAR M_MEDIA"));
+  EXPECT_TRUE(interop_match_name(INTEROP_GATTC_NO_SERVICE_CHANGED_IND,
+                                 "Pixel C Keyboard"));
 }
 
 TEST(InteropTest, test_name_miss) {
@@ -79,4 +118,7 @@ TEST(InteropTest, test_name_miss) {
   EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "BM"));
   EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, "audi"));
   EXPECT_FALSE(interop_match_name(INTEROP_AUTO_RETRY_PAIRING, "BMW M3"));
+  EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_AUTO_PAIRING, ""));
+  EXPECT_FALSE(
+      interop_match_name(INTEROP_GATTC_NO_SERVICE_CHANGED_IND, "Pixel C"));
 }
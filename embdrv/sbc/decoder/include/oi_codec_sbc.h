@@ -199,6 +199,9 @@ typedef struct {
   SBC_BUFFER_T* filterBuffer[SBC_MAX_CHANNELS];
   int32_t filterBufferLen;
   OI_UINT filterBufferOffset;
+  /** Windowing of the 8-subband synthesis, picked for the CPU on reset */
+  void (*synthWindow80)(int16_t* pcm, SBC_BUFFER_T const* buffer,
+                        OI_UINT strideShift);
 
   union {
     uint8_t uint8[SBC_MAX_CHANNELS * SBC_MAX_BANDS];
@@ -184,6 +184,15 @@ PRIVATE void cosineModulateSynth4(SBC_BUFFER_T* RESTRICT out,
 PRIVATE void SynthWindow40_int32_int32_symmetry_with_sum(
     int16_t* pcm, SBC_BUFFER_T buffer[80], OI_UINT strideShift);
 
+typedef void (*SYNTH_WINDOW)(int16_t* pcm, SBC_BUFFER_T const* RESTRICT buffer,
+                             OI_UINT strideShift);
+
+/* Picks the fastest synthesis windowing supported by the CPU */
+PRIVATE void OI_SBC_SynthInit(OI_CODEC_SBC_COMMON_CONTEXT* common);
+/* Returns the NEON windowing of the 8-subband synthesis, or NULL if the CPU
+ * has no NEON */
+PRIVATE SYNTH_WINDOW OI_SBC_GetNeonSynthWindow80(void);
+
 INLINE void dct3_4(int32_t* RESTRICT out, int32_t const* RESTRICT in);
 PRIVATE void analyze4_generated(SBC_BUFFER_T analysisBuffer[RESTRICT 40],
                                 int16_t* pcm, OI_UINT strideShift,
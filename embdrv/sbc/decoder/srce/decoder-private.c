@@ -74,6 +74,7 @@ INLINE OI_STATUS internal_DecoderReset(OI_CODEC_SBC_DECODER_CONTEXT* context,
   context->common.maxBitneed = 0;
   context->limitFrameFormat = FALSE;
   OI_SBC_ExpandFrameFields(&context->common.frameInfo);
+  OI_SBC_SynthInit(&context->common);
 
   /*PLATFORM_DECODER_RESET(context);*/
 
@@ -0,0 +1,145 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2014 The Android Open Source Project
+ *  Copyright 2003 - 2004 Open Interface North America, Inc. All rights
+ *                        reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/** @file
+
+ NEON windowing of the 8-subband synthesis. It computes every product, shift
+ and sum of SynthWindow80_generated(), so the PCM is bit exact with it.
+
+ Output sample j of SynthWindow80_generated() sums 10 products of
+ buffer[16 * m + 4 + j] and buffer[16 * m + 12 - j], for m = 0..4 (output 0
+ and 4 have fewer non-zero terms). The 8 outputs are computed together, from
+ one forward and one reversed load of the buffer per m. Each product is
+ shifted by its own amount before the sum, as in the generated code.
+
+@ingroup codec_internal
+*/
+
+/**@addgroup codec_internal*/
+/**@{*/
+
+#include "oi_codec_sbc_private.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+/* Coefficients of the forward and reversed samples, per m */
+static const int16_t synth80_coef[5][16] = {
+    {0, -3263, -10385, -16457, 10445, -8443, -10337, -6087,
+     8235, 29293, 24995, 19083, 0, 16913, 11167, 9293},
+    {-23167, -5229, -309, -23641, -5297, -301, -30605, -2893,
+     26479, 30835, 9161, -29015, 0, 3687, 1917, 1247},
+    {-17397, -27021, -23063, -12889, 22299, 10255, 9553, 18055,
+     9399, 31633, 27561, 6145, 0, 15447, 8317, 23671},
+    {17397, 17319, 2309, 24211, 10603, 9405, 16383, 1747,
+     26479, 26663, 12705, 23469, 0, -18233, 22117, 11537},
+    {23167, 4555, 6239, 21223, 9539, 26189, 8603, 8721,
+     8235, 12419, 9251, 26913, 0, 1499, 7543, 685},
+};
+
+/* Shift of each product, to the left if positive and to the right if
+ * negative */
+static const int32_t synth80_shift[5][16] = {
+    {0, -5, -6, -6, -4, -7, -4, -2,
+     -3, -5, -5, -5, 0, -5, -4, -3},
+    {-3, 0, 4, -2, 1, 5, -1, 3,
+     -2, -3, -3, -4, 0, 1, 2, 3},
+    {1, 1, 1, 2, 2, 2, 2, 1,
+     3, 1, 1, 3, 0, 2, 3, 2},
+    {1, 1, 3, -1, 0, -1, -2, 1,
+     -2, -2, -1, -2, 0, -3, -4, -1},
+    {-3, -1, -3, -8, -4, -7, -6, -7,
+     -3, -4, -4, -6, 0, -1, -3, 1},
+};
+
+/* Divides by 32768 rounding toward zero, then saturates to 16 bits */
+static inline int16x4_t synth80_scale(int32x4_t x) {
+  uint32x4_t bias = vshrq_n_u32(vreinterpretq_u32_s32(vshrq_n_s32(x, 31)), 17);
+
+  x = vaddq_s32(x, vreinterpretq_s32_u32(bias));
+  return vqmovn_s32(vshrq_n_s32(x, 15));
+}
+
+PRIVATE void SynthWindow80_neon(int16_t* pcm,
+                                SBC_BUFFER_T const* RESTRICT buffer,
+                                OI_UINT strideShift) {
+  int32x4_t lo = vdupq_n_s32(0);
+  int32x4_t hi = vdupq_n_s32(0);
+  int16x8_t out;
+  OI_UINT m;
+
+  for (m = 0; m < 5; m++) {
+    int16x8_t a = vld1q_s16(buffer + 16 * m + 4);
+    int16x8_t b = vld1q_s16(buffer + 16 * m + 5);
+    int16x8_t ca = vld1q_s16(synth80_coef[m]);
+    int16x8_t cb = vld1q_s16(synth80_coef[m] + 8);
+
+    /* b[j] = buffer[16 * m + 12 - j] */
+    b = vrev64q_s16(b);
+    b = vcombine_s16(vget_high_s16(b), vget_low_s16(b));
+
+    lo = vaddq_s32(lo, vshlq_s32(vmull_s16(vget_low_s16(a), vget_low_s16(ca)),
+                                 vld1q_s32(synth80_shift[m])));
+    hi = vaddq_s32(hi,
+                   vshlq_s32(vmull_s16(vget_high_s16(a), vget_high_s16(ca)),
+                             vld1q_s32(synth80_shift[m] + 4)));
+    lo = vaddq_s32(lo, vshlq_s32(vmull_s16(vget_low_s16(b), vget_low_s16(cb)),
+                                 vld1q_s32(synth80_shift[m] + 8)));
+    hi = vaddq_s32(hi,
+                   vshlq_s32(vmull_s16(vget_high_s16(b), vget_high_s16(cb)),
+                             vld1q_s32(synth80_shift[m] + 12)));
+  }
+
+  out = vcombine_s16(synth80_scale(lo), synth80_scale(hi));
+  if (strideShift == 0) {
+    vst1q_s16(pcm, out);
+  } else {
+    /* Interleaved channels: leave the samples of the other channel alone */
+    vst1q_lane_s16(pcm + (0 << strideShift), out, 0);
+    vst1q_lane_s16(pcm + (1 << strideShift), out, 1);
+    vst1q_lane_s16(pcm + (2 << strideShift), out, 2);
+    vst1q_lane_s16(pcm + (3 << strideShift), out, 3);
+    vst1q_lane_s16(pcm + (4 << strideShift), out, 4);
+    vst1q_lane_s16(pcm + (5 << strideShift), out, 5);
+    vst1q_lane_s16(pcm + (6 << strideShift), out, 6);
+    vst1q_lane_s16(pcm + (7 << strideShift), out, 7);
+  }
+}
+#endif
+
+PRIVATE SYNTH_WINDOW OI_SBC_GetNeonSynthWindow80(void) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#if defined(__arm__)
+  /* NEON is optional on ARMv7 */
+  if ((getauxval(AT_HWCAP) & HWCAP_NEON) == 0) return NULL;
+#endif
+  return SynthWindow80_neon;
+#else
+  return NULL;
+#endif
+}
+
+/**@}*/
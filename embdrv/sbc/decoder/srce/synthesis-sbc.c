@@ -303,8 +303,8 @@ PRIVATE void OI_SBC_SynthFrame_80(OI_CODEC_SBC_DECODER_CONTEXT* context,
 
     for (ch = 0; ch < nrof_channels; ch++) {
       DCT2_8(context->common.filterBuffer[ch] + offset, s);
-      SYNTH80(pcm + ch, context->common.filterBuffer[ch] + offset,
-              pcmStrideShift);
+      context->common.synthWindow80(
+          pcm + ch, context->common.filterBuffer[ch] + offset, pcmStrideShift);
       s += 8;
     }
     pcm += (8 << pcmStrideShift);
@@ -410,6 +410,12 @@ static const SYNTH_FRAME SynthFrame4SB[] = {
     OI_SBC_SynthFrame_4SB  /* stereo */
 };
 
+PRIVATE void OI_SBC_SynthInit(OI_CODEC_SBC_COMMON_CONTEXT* common) {
+  SYNTH_WINDOW neonWindow80 = OI_SBC_GetNeonSynthWindow80();
+
+  common->synthWindow80 = neonWindow80 != NULL ? neonWindow80 : SYNTH80;
+}
+
 PRIVATE void OI_SBC_SynthFrame(OI_CODEC_SBC_DECODER_CONTEXT* context,
                                int16_t* pcm, OI_UINT start_block,
                                OI_UINT nrof_blocks) {
@@ -0,0 +1,143 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Throughput of the SBC decoder, as used by the A2DP sink, over a fixed
+// corpus of 44.1kHz joint stereo frames at the high quality bitpool.
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "oi_codec_sbc.h"
+#include "oi_status.h"
+#include "sbc_encoder.h"
+
+extern "C" void SynthWindow80_generated(int16_t* pcm,
+                                        SBC_BUFFER_T const* buffer,
+                                        OI_UINT strideShift);
+
+namespace {
+
+constexpr int kCorpusFrames = 1000;
+constexpr int kSamplesPerFrame = 16 * 8 * 2;
+
+// Encodes a few seconds of a fixed two-tone signal over noise
+std::vector<uint8_t> BuildCorpus() {
+  SBC_ENC_PARAMS params;
+  memset(&params, 0, sizeof(params));
+  params.s16SamplingFreq = SBC_sf44100;
+  params.s16ChannelMode = SBC_JOINT_STEREO;
+  params.s16NumOfSubBands = SUB_BANDS_8;
+  params.s16NumOfBlocks = SBC_BLOCK_3;
+  params.s16AllocationMethod = SBC_LOUDNESS;
+  params.u16BitRate = 328;
+  SBC_Encoder_Init(&params);
+
+  std::vector<uint8_t> corpus;
+  uint32_t seed = 1;
+  int n = 0;
+  for (int i = 0; i < kCorpusFrames; i++) {
+    int16_t pcm[kSamplesPerFrame];
+    uint8_t frame[512];
+    for (int j = 0; j < kSamplesPerFrame; j += 2, n++) {
+      seed = seed * 1103515245 + 12345;
+      double noise = static_cast<int16_t>(seed >> 16) / 16.0;
+      pcm[j] = static_cast<int16_t>(12000 * sin(n * 0.0627) + noise);
+      pcm[j + 1] = static_cast<int16_t>(9000 * sin(n * 0.2137) + noise);
+    }
+    uint32_t frame_len = SBC_Encode(&params, pcm, frame);
+    corpus.insert(corpus.end(), frame, frame + frame_len);
+  }
+  return corpus;
+}
+
+const std::vector<uint8_t>& Corpus() {
+  static const std::vector<uint8_t> corpus = BuildCorpus();
+  return corpus;
+}
+
+// Decodes the whole corpus into |pcm|. Returns the number of frames decoded.
+int DecodeCorpus(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                 std::vector<int16_t>* pcm) {
+  const OI_BYTE* data = Corpus().data();
+  uint32_t bytes = Corpus().size();
+  int frames = 0;
+
+  pcm->resize(kCorpusFrames * kSamplesPerFrame);
+  int16_t* out = pcm->data();
+  while (bytes > 0) {
+    uint32_t pcm_bytes = kSamplesPerFrame * sizeof(int16_t);
+    OI_STATUS status =
+        OI_CODEC_SBC_DecodeFrame(context, &data, &bytes, out, &pcm_bytes);
+    if (!OI_SUCCESS(status)) break;
+    out += pcm_bytes / sizeof(int16_t);
+    frames++;
+  }
+  return frames;
+}
+
+// Decodes the corpus with the windowing picked for the CPU, or with the
+// scalar windowing if |scalar|. Returns the decoded PCM.
+std::vector<int16_t> Decode(OI_CODEC_SBC_DECODER_CONTEXT* context,
+                            uint32_t* context_data, size_t context_data_size,
+                            bool scalar) {
+  std::vector<int16_t> pcm;
+
+  // The reset does not clear the filter history
+  memset(context_data, 0, context_data_size);
+  OI_CODEC_SBC_DecoderReset(context, context_data, context_data_size, 2, 2,
+                            false);
+  if (scalar) context->common.synthWindow80 = SynthWindow80_generated;
+  DecodeCorpus(context, &pcm);
+  return pcm;
+}
+
+void BM_SbcDecode(benchmark::State& state, bool scalar) {
+  static OI_CODEC_SBC_DECODER_CONTEXT context;
+  static uint32_t context_data[CODEC_DATA_WORDS(2,
+                                                SBC_CODEC_FAST_FILTER_BUFFERS)];
+  std::vector<int16_t> pcm;
+
+  // The windowing picked for the CPU must match the scalar one
+  if (Decode(&context, context_data, sizeof(context_data), false) !=
+      Decode(&context, context_data, sizeof(context_data), true)) {
+    state.SkipWithError("PCM differs from the scalar windowing");
+    return;
+  }
+
+  OI_CODEC_SBC_DecoderReset(&context, context_data, sizeof(context_data), 2, 2,
+                            false);
+  if (scalar) context.common.synthWindow80 = SynthWindow80_generated;
+  int frames = 0;
+  while (state.KeepRunning()) {
+    frames += DecodeCorpus(&context, &pcm);
+  }
+  state.SetItemsProcessed(frames);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          Corpus().size());
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_SbcDecode, default, false);
+BENCHMARK_CAPTURE(BM_SbcDecode, scalar, true);
+
+BENCHMARK_MAIN();
@@ -35,6 +35,28 @@ extern const int32_t gas32CoeffFor4SBs[];
 extern const int32_t gas32CoeffFor8SBs[];
 #endif
 
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
+/* Window coefficients of the analysis filter, 5 rows of 4 or 8 subbands * 2
+ * coefficients. Row k weighs the samples at offset k * 2 * subbands. */
+extern const int16_t gas16WindowFor4SBs[];
+extern const int16_t gas16WindowFor8SBs[];
+#endif
+
+/* Windowing of the analysis filter: computes the partial sums of one block
+ * from the channel history |ps16X| into |ps32DCTY|. */
+typedef void (*tSBC_WINDOW_FUNC)(const int16_t* ps16X, int32_t* ps32DCTY);
+
+typedef struct {
+  tSBC_WINDOW_FUNC Window4;
+  tSBC_WINDOW_FUNC Window8;
+} tSBC_ANALYSIS_FUNCS;
+
+extern const tSBC_ANALYSIS_FUNCS SbcAnalysisScalarFuncs;
+extern const tSBC_ANALYSIS_FUNCS* pSbcAnalysisFuncs;
+
+/* Returns the SIMD windowing supported by the CPU, or NULL if none. */
+extern const tSBC_ANALYSIS_FUNCS* SbcAnalysisGetSimdFuncs(void);
+
 /* Global functions*/
 
 extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
@@ -113,6 +113,14 @@
 #define SBC_IS_64_MULT_IN_WINDOW_ACCU FALSE
 #endif /*SBC_IS_64_MULT_IN_WINDOW_ACCU */
 
+/* Set SBC_SIMD_OPT to TRUE to use the NEON or SSE2 windowing of the analysis
+ * filter when the CPU supports it. The output is bit exact with the scalar
+ * windowing.
+ */
+#ifndef SBC_SIMD_OPT
+#define SBC_SIMD_OPT TRUE
+#endif /*SBC_SIMD_OPT */
+
 /* Set SBC_IS_64_MULT_IN_IDCT to TRUE to use 64 bits multiplication in the DCT
  * of Matrixing
  */
@@ -201,6 +209,11 @@ extern uint32_t SBC_Encode(SBC_ENC_PARAMS* strEncParams, int16_t* input,
                            uint8_t* output);
 extern void SBC_Encoder_Init(SBC_ENC_PARAMS* strEncParams);
 
+/* Allows the encoder to use the SIMD windowing of the CPU, if |enable| is
+ * true and there is one. It is allowed by default and takes effect on the
+ * next SBC_Encoder_Init(). */
+extern void SBC_Encoder_EnableSimd(bool enable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,154 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the NEON and SSE2 windowing of the analysis filter.
+ *  The products and sums are the ones of the scalar windowing, in 32 bits,
+ *  so the output of the encoder is bit exact with the scalar code.
+ *
+ ******************************************************************************/
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_SIMD_OPT == TRUE) && (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SBC_WINDOW_NEON
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#elif defined(__SSE2__)
+#define SBC_WINDOW_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#if defined(SBC_WINDOW_NEON)
+/* Accumulates the products of 8 samples |x| and coefficients |c| */
+static inline void SbcWindowMac8(const int16_t* x, const int16_t* c,
+                                 int32x4_t* pLo, int32x4_t* pHi) {
+  int16x8_t s16x8X = vld1q_s16(x);
+  int16x8_t s16x8C = vld1q_s16(c);
+
+  *pLo = vmlal_s16(*pLo, vget_low_s16(s16x8X), vget_low_s16(s16x8C));
+  *pHi = vmlal_s16(*pHi, vget_high_s16(s16x8X), vget_high_s16(s16x8C));
+}
+
+static void SbcWindow4Neon(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int32x4_t s32x4Lo = vdupq_n_s32(0);
+  int32x4_t s32x4Hi = vdupq_n_s32(0);
+  int k;
+
+  for (k = 0; k < 5; k++) {
+    SbcWindowMac8(ps16X + k * 8, gas16WindowFor4SBs + k * 8, &s32x4Lo,
+                  &s32x4Hi);
+  }
+  vst1q_s32(ps32DCTY, s32x4Lo);
+  vst1q_s32(ps32DCTY + 4, s32x4Hi);
+}
+
+static void SbcWindow8Neon(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int32x4_t s32x4Acc0 = vdupq_n_s32(0);
+  int32x4_t s32x4Acc1 = vdupq_n_s32(0);
+  int32x4_t s32x4Acc2 = vdupq_n_s32(0);
+  int32x4_t s32x4Acc3 = vdupq_n_s32(0);
+  int k;
+
+  for (k = 0; k < 5; k++) {
+    SbcWindowMac8(ps16X + k * 16, gas16WindowFor8SBs + k * 16, &s32x4Acc0,
+                  &s32x4Acc1);
+    SbcWindowMac8(ps16X + k * 16 + 8, gas16WindowFor8SBs + k * 16 + 8,
+                  &s32x4Acc2, &s32x4Acc3);
+  }
+  vst1q_s32(ps32DCTY, s32x4Acc0);
+  vst1q_s32(ps32DCTY + 4, s32x4Acc1);
+  vst1q_s32(ps32DCTY + 8, s32x4Acc2);
+  vst1q_s32(ps32DCTY + 12, s32x4Acc3);
+}
+
+static const tSBC_ANALYSIS_FUNCS SbcAnalysisNeonFuncs = {SbcWindow4Neon,
+                                                         SbcWindow8Neon};
+#endif
+
+#if defined(SBC_WINDOW_SSE2)
+/* Accumulates the products of 8 samples |x| and coefficients |c|. The 32 bit
+ * products are rebuilt from their low and high halves. */
+static inline void SbcWindowMac8(const int16_t* x, const int16_t* c,
+                                 __m128i* pLo, __m128i* pHi) {
+  __m128i s16x8X = _mm_loadu_si128((const __m128i*)x);
+  __m128i s16x8C = _mm_loadu_si128((const __m128i*)c);
+  __m128i s16x8ProdLo = _mm_mullo_epi16(s16x8X, s16x8C);
+  __m128i s16x8ProdHi = _mm_mulhi_epi16(s16x8X, s16x8C);
+
+  *pLo = _mm_add_epi32(*pLo, _mm_unpacklo_epi16(s16x8ProdLo, s16x8ProdHi));
+  *pHi = _mm_add_epi32(*pHi, _mm_unpackhi_epi16(s16x8ProdLo, s16x8ProdHi));
+}
+
+static void SbcWindow4Sse2(const int16_t* ps16X, int32_t* ps32DCTY) {
+  __m128i s32x4Lo = _mm_setzero_si128();
+  __m128i s32x4Hi = _mm_setzero_si128();
+  int k;
+
+  for (k = 0; k < 5; k++) {
+    SbcWindowMac8(ps16X + k * 8, gas16WindowFor4SBs + k * 8, &s32x4Lo,
+                  &s32x4Hi);
+  }
+  _mm_storeu_si128((__m128i*)ps32DCTY, s32x4Lo);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 4), s32x4Hi);
+}
+
+static void SbcWindow8Sse2(const int16_t* ps16X, int32_t* ps32DCTY) {
+  __m128i s32x4Acc0 = _mm_setzero_si128();
+  __m128i s32x4Acc1 = _mm_setzero_si128();
+  __m128i s32x4Acc2 = _mm_setzero_si128();
+  __m128i s32x4Acc3 = _mm_setzero_si128();
+  int k;
+
+  for (k = 0; k < 5; k++) {
+    SbcWindowMac8(ps16X + k * 16, gas16WindowFor8SBs + k * 16, &s32x4Acc0,
+                  &s32x4Acc1);
+    SbcWindowMac8(ps16X + k * 16 + 8, gas16WindowFor8SBs + k * 16 + 8,
+                  &s32x4Acc2, &s32x4Acc3);
+  }
+  _mm_storeu_si128((__m128i*)ps32DCTY, s32x4Acc0);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 4), s32x4Acc1);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 8), s32x4Acc2);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 12), s32x4Acc3);
+}
+
+static const tSBC_ANALYSIS_FUNCS SbcAnalysisSse2Funcs = {SbcWindow4Sse2,
+                                                         SbcWindow8Sse2};
+#endif
+
+const tSBC_ANALYSIS_FUNCS* SbcAnalysisGetSimdFuncs(void) {
+#if defined(SBC_WINDOW_NEON)
+#if defined(__arm__)
+  /* NEON is optional on ARMv7 */
+  if ((getauxval(AT_HWCAP) & HWCAP_NEON) == 0) return NULL;
+#endif
+  return &SbcAnalysisNeonFuncs;
+#elif defined(SBC_WINDOW_SSE2)
+  return &SbcAnalysisSse2Funcs;
+#else
+  return NULL;
+#endif
+}
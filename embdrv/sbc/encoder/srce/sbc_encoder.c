@@ -28,6 +28,7 @@
 #include "sbc_enc_func_declare.h"
 
 int16_t EncMaxShiftCounter;
+static bool sbc_enc_simd_enabled = true;
 
 #if (SBC_JOINT_STE_INCLUDED == TRUE)
 int32_t s32LRDiff[SBC_MAX_NUM_OF_BLOCKS] = {0};
@@ -254,5 +255,12 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
       EncMaxShiftCounter = ((ENC_VX_BUFFER_SIZE - 8 * 10 * 2) >> 4) << 3;
   }
 
+  /* Windowing of the analysis filter */
+  pSbcAnalysisFuncs = NULL;
+  if (sbc_enc_simd_enabled) pSbcAnalysisFuncs = SbcAnalysisGetSimdFuncs();
+  if (pSbcAnalysisFuncs == NULL) pSbcAnalysisFuncs = &SbcAnalysisScalarFuncs;
+
   SbcAnalysisInit();
 }
+
+void SBC_Encoder_EnableSimd(bool enable) { sbc_enc_simd_enabled = enable; }
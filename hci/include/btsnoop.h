@@ -29,6 +29,15 @@ typedef struct btsnoop_t {
   // true, the packet is marked as incoming. Otherwise, the packet is marked
   // as outgoing.
   void (*capture)(const BT_HDR* packet, bool is_received);
+
+  // Registers the L2CAP channel from |local_cid| to |remote_cid| of |psm| on
+  // the ACL link |handle|, so that the capture filter rules by PSM apply to
+  // its packets.
+  void (*add_l2c_channel)(uint16_t handle, uint16_t psm, uint16_t local_cid,
+                          uint16_t remote_cid);
+
+  // Unregisters the L2CAP channel |local_cid| of the ACL link |handle|.
+  void (*remove_l2c_channel)(uint16_t handle, uint16_t local_cid);
 } btsnoop_t;
 
 const btsnoop_t* btsnoop_get_interface(void);
@@ -0,0 +1,48 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// The header of each packet record of a btsnoop log, in network order
+typedef struct {
+  uint32_t length_original;
+  uint32_t length_captured;
+  uint32_t flags;
+  uint32_t dropped_packets;
+  uint64_t timestamp;
+  uint8_t type;
+} __attribute__((__packed__)) btsnoop_header_t;
+
+// Starts listening for the clients of the live capture on the local port
+// 8872. Several clients may be connected at once.
+void btsnoop_net_open();
+
+// Disconnects the clients and stops listening.
+void btsnoop_net_close();
+
+// Sends the packet record starting with |header| and followed by the
+// |iovcnt| parts of |packet| to each client. This never blocks: the record
+// is queued if a client does not read fast enough, and dropped if its queue
+// is full. The drops are added to the |dropped_packets| of the next record
+// the client does get.
+void btsnoop_net_write(const btsnoop_header_t* header,
+                       const struct iovec* packet, int iovcnt);
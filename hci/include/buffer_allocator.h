@@ -21,3 +21,11 @@
 #include "osi/include/allocator.h"
 
 const allocator_t* buffer_allocator_get_interface();
+
+// Returns the allocator of the HCI command buffers. It takes the buffers of up
+// to HCI_CMD_BUF_SIZE octets from a preallocated pool, and the others, or
+// those beyond the pool, from the heap. They are all freed with |osi_free|.
+const allocator_t* buffer_allocator_get_command_interface();
+
+// Dumps the use of the HCI command buffer pool to |fd|.
+void buffer_allocator_debug_dump(int fd);
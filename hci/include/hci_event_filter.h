@@ -0,0 +1,86 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bt_types.h"
+#include "event_mask.h"
+#include "hci_layer.h"
+#include "hci_packet_factory.h"
+
+// The event filter keeps the HCI events the stack has no use for at the
+// moment from waking it up. The controller is asked, through its event
+// masks, not to send the events of the stack features which are not active,
+// like the inquiry results outside of an inquiry. The events which arrive
+// anyway, and those no module subscribed to, are dropped by the HCI layer
+// before they are dispatched to the stack.
+//
+// The features are set by the thread sending the HCI commands which start
+// and stop them, before the commands starting them and after those stopping
+// them, so that the event mask updates keep their order around them. All
+// functions are thread-safe.
+
+typedef enum {
+  HCI_EVENT_FEATURE_INQUIRY = 0,       // The inquiry results
+  HCI_EVENT_FEATURE_PERIODIC_INQUIRY,  // The inquiry results
+  HCI_EVENT_FEATURE_LE_SCAN,           // The LE advertising reports
+  HCI_EVENT_FEATURE_MAX,
+} hci_event_feature_t;
+
+// Starts the filter of the controller started by |hci|. |classic_mask| and
+// |le_mask| are the masks of all the events the stack takes, NULL for a mask
+// the controller keeps at its default. The masks narrowed to the active
+// features are given by |hci_event_filter_get_classic_mask| and
+// |hci_event_filter_get_le_mask| to the caller, which sets them when it
+// starts the controller, and are then updated by the filter through |hci|.
+void hci_event_filter_start_up(const hci_t* hci,
+                               const hci_packet_factory_t* packet_factory,
+                               const bt_event_mask_t* classic_mask,
+                               const bt_event_mask_t* le_mask);
+
+// Stops the updates of the event masks, and sets all the features inactive.
+void hci_event_filter_shut_down(void);
+
+// Returns the event masks to set in the controller for the active features.
+bt_event_mask_t hci_event_filter_get_classic_mask(void);
+bt_event_mask_t hci_event_filter_get_le_mask(void);
+
+// Sets |feature| active or inactive, and updates the event masks of the
+// controller if they change.
+void hci_event_filter_set_feature_active(hci_event_feature_t feature,
+                                         bool active);
+
+// Subscribes the stack to the |event_count| events of |event_codes| and the
+// |le_subevent_count| LE meta events of |le_subevent_codes|, in place of
+// the events it subscribed to before. Until it subscribes, or after it
+// unsubscribes with no events, all the events are taken.
+void hci_event_filter_subscribe(const uint8_t* event_codes, size_t event_count,
+                                const uint8_t* le_subevent_codes,
+                                size_t le_subevent_count);
+
+// Returns true if the HCI event |packet| should not be dispatched to the
+// stack, because its feature is not active or no module subscribed to it.
+// The caller then frees it.
+bool hci_event_filter_drops(const BT_HDR* packet);
+
+// Dumps the event masks and the dropped events to |fd|.
+void hci_event_filter_debug_dump(int fd);
@@ -24,5 +24,8 @@
 #define HCI_ACL_PREAMBLE_SIZE 4
 // 2 bytes for handle, 1 byte for data length (Volume 2, Part E, 5.4.3)
 #define HCI_SCO_PREAMBLE_SIZE 3
+// 2 bytes for handle and flags, 2 bytes for data load length (Volume 4, Part
+// E, 5.4.5)
+#define HCI_ISO_PREAMBLE_SIZE 4
 // 1 byte for event code, 1 byte for parameter length (Volume 2, Part E, 5.4.4)
 #define HCI_EVENT_PREAMBLE_SIZE 2
@@ -55,6 +55,11 @@ typedef struct {
                                               uint16_t* data_size_ptr,
                                               uint8_t* acl_buffer_count_ptr);
 
+  void (*parse_ble_read_buffer_size_v2_response)(
+      BT_HDR* response, uint16_t* acl_data_size_ptr,
+      uint8_t* acl_buffer_count_ptr, uint16_t* iso_data_size_ptr,
+      uint8_t* iso_buffer_count_ptr);
+
   void (*parse_ble_read_supported_states_response)(
       BT_HDR* response, uint8_t* supported_states,
       size_t supported_states_size);
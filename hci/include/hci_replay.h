@@ -0,0 +1,53 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bt_types.h"
+
+// The HCI replay replaces the controller with the controller to host traffic
+// of a btsnoop log: the events, ACL and SCO packets are fed to the stack in
+// their order in the log, and at their original times divided by the speed
+// up factor, or as fast as possible if it is 0.
+//
+// When the log shows a command or an ACL packet sent by the host, the replay
+// waits for the stack to send it, and counts the time the stack took since
+// it was fed the preceding packet, by the type of that packet. The commands
+// that the log has no more of are answered with a Command Complete event
+// with the Unknown HCI Command status.
+
+// Feeds a packet of HCI packet type |type| to the stack.
+typedef void (*hci_replay_dispatch_cb)(BT_HDR* packet, uint8_t type);
+
+// Loads the btsnoop log at |path| and starts replaying it through
+// |dispatch_cb|. Returns false if the log cannot be read.
+bool hci_replay_open(const char* path, uint32_t speed_up,
+                     hci_replay_dispatch_cb dispatch_cb);
+
+// Stops the replay and logs its statistics.
+void hci_replay_close();
+
+// Takes the packet |packet| of HCI packet type |type| sent by the stack in
+// place of the controller. |packet| is not freed.
+void hci_replay_transmit(const BT_HDR* packet, uint8_t type);
+
+// Dumps the replay statistics to |fd|.
+void hci_replay_debug_dump(int fd);
@@ -18,6 +18,8 @@
 
 #define LOG_TAG "bt_snoop"
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 
 #include <arpa/inet.h>
@@ -32,14 +34,18 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "bt_types.h"
 #include "hci/include/btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
+#include "hci/include/btsnoop_net.h"
 #include "hci_layer.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
+#include "osi/include/thread.h"
 #include "osi/include/time.h"
 #include "stack_config.h"
 
@@ -54,11 +60,34 @@
 #define DEFAULT_BTSNOOP_PATH "/data/misc/bluetooth/logs/btsnoop_hci.log"
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
 
+// The captured packets are copied to a ring buffer of this size, a power of
+// two, and written to the log by a low priority thread, so that a slow
+// storage does not stall the threads capturing them. The packets that do not
+// fit are dropped, and counted in the btsnoop record header.
+#define BTSNOOP_RING_SIZE (256 * 1024)
+#define BTSNOOP_WRITER_NICE 10
+
+// The capture filter truncates, and optionally samples, the ACL packets of
+// the L2CAP channels matching one of the comma separated rules of this
+// property, each being "psm:<psm>=<octets>[/<k>]" or
+// "cid:<cid>=<octets>[/<k>]".
+// The L2CAP PDUs longer than <octets> of payload are logged up to <octets>,
+// and only one of <k> of them is logged if <k> is set. E.g. "psm:25=64/10"
+// logs the headers of one A2DP media packet of ten, while the shorter AVDTP
+// signaling PDUs are still logged in full.
+#define BTSNOOP_FILTER_PROPERTY "persist.bluetooth.btsnoopfilter"
+#define BTSNOOP_FILTER_MAX_RULES 8
+#define BTSNOOP_FILTER_MAX_CHANNELS 16
+#define BTSNOOP_ACL_HANDLE_MASK 0x0FFF
+#define BTSNOOP_ACL_CONTINUATION 0x01
+#define BTSNOOP_L2CAP_HDR_LEN 4
+
 typedef enum {
   kCommandPacket = 1,
   kAclPacket = 2,
   kScoPacket = 3,
-  kEventPacket = 4
+  kEventPacket = 4,
+  kIsoPacket = 5
 } packet_type_t;
 
 // Epoch in microseconds since 01/01/0000.
@@ -70,10 +99,44 @@ static std::mutex btsnoop_mutex;
 static int32_t packets_per_file;
 static int32_t packet_counter;
 
-// TODO(zachoverflow): merge btsnoop and btsnoop_net together
-void btsnoop_net_open();
-void btsnoop_net_close();
-void btsnoop_net_write(const void* data, size_t length);
+// The ring buffer is written only under |btsnoop_mutex|, and read only by the
+// writer thread, so the two positions are enough to synchronize them.
+static uint8_t* ring_buf;
+static std::atomic<uint64_t> ring_head;  // Octets captured
+static std::atomic<uint64_t> ring_tail;  // Octets written to the log
+static uint32_t dropped_packets;
+static thread_t* writer_thread;
+static std::atomic<bool> writer_idle;
+
+typedef struct {
+  bool is_psm;      // Matches the channel PSM, otherwise the CID
+  uint16_t id;      // The PSM or CID to match
+  uint16_t octets;  // L2CAP payload octets logged
+  uint16_t sample;  // Log one of |sample| truncated PDUs
+  uint32_t count;   // Truncated PDUs seen
+} btsnoop_filter_rule_t;
+
+typedef struct {
+  bool in_use;
+  uint16_t handle;
+  uint16_t psm;
+  uint16_t local_cid;
+  uint16_t remote_cid;
+} btsnoop_l2c_channel_t;
+
+// How the ACL fragments continuing an L2CAP PDU are logged
+typedef enum {
+  kFilterNone = 0,
+  kFilterTruncate,
+  kFilterSkip
+} filter_action_t;
+
+static btsnoop_filter_rule_t filter_rules[BTSNOOP_FILTER_MAX_RULES];
+static size_t num_filter_rules;
+static btsnoop_l2c_channel_t l2c_channels[BTSNOOP_FILTER_MAX_CHANNELS];
+// The action of the PDU being continued, for each direction and handle
+static uint8_t continuation_action[2][BTSNOOP_ACL_HANDLE_MASK + 1];
+
 
 static void delete_btsnoop_files();
 static bool is_btsnoop_enabled();
@@ -82,6 +145,12 @@ static char* get_btsnoop_last_log_path(char* last_log_path, char* log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void btsnoop_writer_start();
+static void btsnoop_writer_stop();
+static void btsnoop_writer_run(void* context);
+static void btsnoop_write_pending();
+static void btsnoop_filter_init();
+static int32_t btsnoop_filter_acl(const uint8_t* packet, bool is_received);
 
 // Module lifecycle functions
 
@@ -95,6 +164,8 @@ static future_t* start_up(void) {
     packets_per_file = osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
+    btsnoop_filter_init();
+    if (logfile_fd != INVALID_FD) btsnoop_writer_start();
   }
 
   return NULL;
@@ -103,6 +174,9 @@ static future_t* start_up(void) {
 static future_t* shut_down(void) {
   std::lock_guard<std::mutex> lock(btsnoop_mutex);
 
+  btsnoop_writer_stop();
+  num_filter_rules = 0;
+
   if (!is_btsnoop_enabled()) {
     delete_btsnoop_files();
   }
@@ -131,7 +205,7 @@ static void capture(const BT_HDR* buffer, bool is_received) {
   uint64_t timestamp_us = time_gettimeofday_us();
   btsnoop_mem_capture(buffer, timestamp_us);
 
-  if (logfile_fd == INVALID_FD) return;
+  if (ring_buf == NULL) return;
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
@@ -148,10 +222,51 @@ static void capture(const BT_HDR* buffer, bool is_received) {
     case MSG_STACK_TO_HC_HCI_CMD:
       btsnoop_write_packet(kCommandPacket, p, true, timestamp_us);
       break;
+    case MSG_HC_TO_STACK_HCI_ISO:
+    case MSG_STACK_TO_HC_HCI_ISO:
+      btsnoop_write_packet(kIsoPacket, p, is_received, timestamp_us);
+      break;
   }
 }
 
-static const btsnoop_t interface = {capture};
+static void add_l2c_channel(uint16_t handle, uint16_t psm, uint16_t local_cid,
+                            uint16_t remote_cid) {
+  std::lock_guard<std::mutex> lock(btsnoop_mutex);
+  if (num_filter_rules == 0) return;
+
+  btsnoop_l2c_channel_t* p_free = NULL;
+  for (btsnoop_l2c_channel_t& channel : l2c_channels) {
+    if (channel.in_use && channel.handle == handle &&
+        channel.local_cid == local_cid) {
+      p_free = &channel;
+      break;
+    }
+    if (!channel.in_use && p_free == NULL) p_free = &channel;
+  }
+  if (p_free == NULL) {
+    LOG_WARN(LOG_TAG, "%s no room to filter channel 0x%04x", __func__,
+             local_cid);
+    return;
+  }
+
+  p_free->in_use = true;
+  p_free->handle = handle;
+  p_free->psm = psm;
+  p_free->local_cid = local_cid;
+  p_free->remote_cid = remote_cid;
+}
+
+static void remove_l2c_channel(uint16_t handle, uint16_t local_cid) {
+  std::lock_guard<std::mutex> lock(btsnoop_mutex);
+  for (btsnoop_l2c_channel_t& channel : l2c_channels) {
+    if (channel.in_use && channel.handle == handle &&
+        channel.local_cid == local_cid)
+      channel.in_use = false;
+  }
+}
+
+static const btsnoop_t interface = {capture, add_l2c_channel,
+                                    remove_l2c_channel};
 
 const btsnoop_t* btsnoop_get_interface() {
   return &interface;
@@ -216,15 +331,6 @@ static void open_next_snoop_file() {
   write(logfile_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
 }
 
-typedef struct {
-  uint32_t length_original;
-  uint32_t length_captured;
-  uint32_t flags;
-  uint32_t dropped_packets;
-  uint64_t timestamp;
-  uint8_t type;
-} __attribute__((__packed__)) btsnoop_header_t;
-
 static uint64_t htonll(uint64_t ll) {
   const uint32_t l = 1;
   if (*(reinterpret_cast<const uint8_t*>(&l)) == 1)
@@ -234,6 +340,106 @@ static uint64_t htonll(uint64_t ll) {
   return ll;
 }
 
+static void ring_copy_in(uint64_t pos, const void* data, size_t length) {
+  size_t offset = pos & (BTSNOOP_RING_SIZE - 1);
+  size_t first = std::min(length, (size_t)BTSNOOP_RING_SIZE - offset);
+  memcpy(ring_buf + offset, data, first);
+  memcpy(ring_buf, static_cast<const uint8_t*>(data) + first, length - first);
+}
+
+static void ring_copy_out(uint64_t pos, void* data, size_t length) {
+  size_t offset = pos & (BTSNOOP_RING_SIZE - 1);
+  size_t first = std::min(length, (size_t)BTSNOOP_RING_SIZE - offset);
+  memcpy(data, ring_buf + offset, first);
+  memcpy(static_cast<uint8_t*>(data) + first, ring_buf, length - first);
+}
+
+static void btsnoop_filter_init() {
+  char rules[PROPERTY_VALUE_MAX] = {0};
+  osi_property_get(BTSNOOP_FILTER_PROPERTY, rules, "");
+
+  num_filter_rules = 0;
+  memset(l2c_channels, 0, sizeof(l2c_channels));
+  memset(continuation_action, kFilterNone, sizeof(continuation_action));
+
+  char* save_ptr = NULL;
+  for (char* rule = strtok_r(rules, ",", &save_ptr); rule != NULL;
+       rule = strtok_r(NULL, ",", &save_ptr)) {
+    char kind[4];
+    int id = 0;
+    unsigned int octets = 0;
+    unsigned int sample = 1;
+    if (num_filter_rules == BTSNOOP_FILTER_MAX_RULES ||
+        sscanf(rule, " %3[a-z]:%i=%u/%u", kind, &id, &octets, &sample) < 3 ||
+        (strcmp(kind, "psm") != 0 && strcmp(kind, "cid") != 0) || id <= 0 ||
+        id > UINT16_MAX || octets > UINT16_MAX || sample == 0 ||
+        sample > UINT16_MAX) {
+      LOG_ERROR(LOG_TAG, "%s ignoring filter rule '%s'", __func__, rule);
+      continue;
+    }
+
+    btsnoop_filter_rule_t* p_rule = &filter_rules[num_filter_rules++];
+    p_rule->is_psm = (strcmp(kind, "psm") == 0);
+    p_rule->id = id;
+    p_rule->octets = octets;
+    p_rule->sample = sample;
+    p_rule->count = 0;
+    LOG_INFO(LOG_TAG, "%s %s 0x%04x: %u octets, 1 of %u", __func__, kind, id,
+             octets, sample);
+  }
+}
+
+static btsnoop_filter_rule_t* btsnoop_filter_find_rule(uint16_t handle,
+                                                       uint16_t cid,
+                                                       bool is_received) {
+  uint16_t psm = 0;
+  for (const btsnoop_l2c_channel_t& channel : l2c_channels) {
+    // The received PDUs are sent to our CID, the others to the peer CID
+    if (channel.in_use && channel.handle == handle &&
+        (is_received ? channel.local_cid : channel.remote_cid) == cid) {
+      psm = channel.psm;
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < num_filter_rules; i++) {
+    btsnoop_filter_rule_t* p_rule = &filter_rules[i];
+    if (p_rule->id == (p_rule->is_psm ? psm : cid)) return p_rule;
+  }
+  return NULL;
+}
+
+// Returns the ACL payload octets of |packet| to log, which are fewer than
+// its length if it is truncated, or -1 if it is not logged at all.
+static int32_t btsnoop_filter_acl(const uint8_t* packet, bool is_received) {
+  uint16_t handle = (packet[0] | (packet[1] << 8)) & BTSNOOP_ACL_HANDLE_MASK;
+  uint8_t boundary = (packet[1] >> 4) & 0x03;
+  uint16_t acl_length = packet[2] | (packet[3] << 8);
+  uint8_t* p_action = &continuation_action[is_received][handle];
+
+  if (boundary == BTSNOOP_ACL_CONTINUATION) {
+    if (*p_action == kFilterSkip) return -1;
+    return (*p_action == kFilterTruncate) ? 0 : acl_length;
+  }
+
+  *p_action = kFilterNone;
+  if (acl_length < BTSNOOP_L2CAP_HDR_LEN) return acl_length;
+
+  const uint8_t* p_l2cap = packet + 4;
+  uint16_t l2cap_length = p_l2cap[0] | (p_l2cap[1] << 8);
+  uint16_t cid = p_l2cap[2] | (p_l2cap[3] << 8);
+  btsnoop_filter_rule_t* p_rule =
+      btsnoop_filter_find_rule(handle, cid, is_received);
+  if (p_rule == NULL || l2cap_length <= p_rule->octets) return acl_length;
+
+  if (p_rule->count++ % p_rule->sample != 0) {
+    *p_action = kFilterSkip;
+    return -1;
+  }
+  *p_action = kFilterTruncate;
+  return std::min<int32_t>(acl_length, BTSNOOP_L2CAP_HDR_LEN + p_rule->octets);
+}
+
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us) {
   uint32_t length_he = 0;
@@ -256,27 +462,133 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       length_he = packet[1] + 3;
       flags = 3;
       break;
+    case kIsoPacket:
+      length_he = ((packet[3] & 0x3F) << 8) + packet[2] + 5;
+      flags = is_received;
+      break;
+  }
+
+  uint32_t captured_he = length_he;
+  if (type == kAclPacket && num_filter_rules > 0) {
+    int32_t kept = btsnoop_filter_acl(packet, is_received);
+    if (kept < 0) return;
+    captured_he = kept + 5;
   }
 
   btsnoop_header_t header;
   header.length_original = htonl(length_he);
-  header.length_captured = header.length_original;
+  header.length_captured = htonl(captured_he);
   header.flags = htonl(flags);
-  header.dropped_packets = 0;
+  header.dropped_packets = htonl(dropped_packets);
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
-  btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  // Only copy the packet here, the writer thread does the I/O
+  uint64_t head = ring_head.load(std::memory_order_relaxed);
+  uint64_t tail = ring_tail.load(std::memory_order_acquire);
+  size_t length = sizeof(btsnoop_header_t) + captured_he - 1;
+  if (BTSNOOP_RING_SIZE - (head - tail) < length) {
+    dropped_packets++;
+    return;
+  }
+
+  ring_copy_in(head, &header, sizeof(btsnoop_header_t));
+  ring_copy_in(head + sizeof(btsnoop_header_t), packet, captured_he - 1);
+  ring_head.store(head + length, std::memory_order_release);
+
+  // Wake the writer up, unless it is already running
+  if (writer_idle.exchange(false))
+    thread_post(writer_thread, btsnoop_writer_run, NULL);
+}
+
+static void btsnoop_writer_start() {
+  writer_thread = thread_new("btsnoop_writer");
+  if (writer_thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the writer thread", __func__);
+    return;
+  }
+  thread_set_priority(writer_thread, BTSNOOP_WRITER_NICE);
+
+  ring_buf = static_cast<uint8_t*>(osi_malloc_tagged(
+      BTSNOOP_RING_SIZE, OSI_MEM_BTSNOOP));
+  ring_head = 0;
+  ring_tail = 0;
+  dropped_packets = 0;
+  writer_idle = true;
+}
+
+static void btsnoop_writer_stop() {
+  if (writer_thread == NULL) return;
+
+  // Runs the writes still posted before the thread exits
+  thread_free(writer_thread);
+  writer_thread = NULL;
+
+  btsnoop_write_pending();
+  if (dropped_packets > 0)
+    LOG_WARN(LOG_TAG, "%s %u packets were dropped from the snoop log",
+             __func__, dropped_packets);
+
+  osi_free(ring_buf);
+  ring_buf = NULL;
+}
+
+static void btsnoop_writer_run(UNUSED_ATTR void* context) {
+  while (true) {
+    btsnoop_write_pending();
+
+    // Stop unless more packets were captured before we went idle, and
+    // capture() did not post another run for them
+    writer_idle = true;
+    if (ring_head.load() == ring_tail.load()) return;
+    if (!writer_idle.exchange(false)) return;
+  }
+}
+
+// Writes the ring buffer octets from |start| to |end| to the log in one go
+static void btsnoop_write_block(uint64_t start, uint64_t end) {
+  if (start == end) return;
+
+  size_t offset = start & (BTSNOOP_RING_SIZE - 1);
+  size_t length = end - start;
+  size_t first = std::min(length, (size_t)BTSNOOP_RING_SIZE - offset);
+  iovec iov[] = {{ring_buf + offset, first}, {ring_buf, length - first}};
+  int iovcnt = (length > first) ? 2 : 1;
+
+  if (logfile_fd != INVALID_FD)
+    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, iovcnt));
+}
+
+static void btsnoop_write_pending() {
+  uint64_t tail = ring_tail.load(std::memory_order_relaxed);
+  uint64_t head = ring_head.load(std::memory_order_acquire);
+  uint64_t block_start = tail;
+
+  // Write all the captured packets at once, but rotate the file on the
+  // packet boundary where it is full
+  while (tail != head) {
+    btsnoop_header_t header;
+    ring_copy_out(tail, &header, sizeof(btsnoop_header_t));
 
-  if (logfile_fd != INVALID_FD) {
     packet_counter++;
     if (packet_counter > packets_per_file) {
+      btsnoop_write_block(block_start, tail);
+      block_start = tail;
       open_next_snoop_file();
     }
 
-    iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
+    // The live capture clients get each packet on its own, so that they can
+    // drop the packets they are too slow for
+    uint64_t packet = tail + sizeof(btsnoop_header_t);
+    size_t offset = packet & (BTSNOOP_RING_SIZE - 1);
+    size_t length = ntohl(header.length_captured) - 1;
+    size_t first = std::min(length, (size_t)BTSNOOP_RING_SIZE - offset);
+    iovec iov[] = {{ring_buf + offset, first}, {ring_buf, length - first}};
+    btsnoop_net_write(&header, iov, (length > first) ? 2 : 1);
+
+    tail = packet + length;
   }
+
+  btsnoop_write_block(block_start, tail);
+  ring_tail.store(tail, std::memory_order_release);
 }
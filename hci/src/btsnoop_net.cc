@@ -21,22 +21,47 @@
 #include <base/logging.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 
+#include "hci/include/btsnoop_net.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
+// Each client has a queue of this size for the records it is not ready to
+// receive yet, enough for the longest ACL packet. The records that do not
+// fit are dropped for this client only, so that a slow client never blocks
+// the capture, nor the other clients.
+#define BTSNOOP_NET_MAX_CLIENTS 4
+#define BTSNOOP_NET_QUEUE_SIZE (128 * 1024)
+
+typedef struct {
+  int socket;
+  uint8_t* queue;    // The octets not sent yet are from |start| to |end|
+  size_t start;
+  size_t end;
+  uint32_t dropped;  // The records dropped for this client
+} client_t;
+
 static void safe_close_(int* fd);
 static void* listen_fn_(void* context);
+static void client_open_l_(int client_socket);
+static void client_close_l_(client_t* client);
+static void client_queue_l_(client_t* client, const void* data,
+                            size_t length);
+static void client_send_l_(client_t* client);
 
 static const char* LISTEN_THREAD_NAME_ = "btsnoop_net_listen";
 static const int LOCALHOST_ = 0x7F000001;
@@ -44,20 +69,35 @@ static const int LISTEN_PORT_ = 8872;
 
 static pthread_t listen_thread_;
 static bool listen_thread_valid_ = false;
+static std::atomic<bool> listen_thread_stop_(false);
 static std::mutex client_socket_mutex_;
 static int listen_socket_ = -1;
-static int client_socket_ = -1;
+// Wakes the listen thread up to poll the clients with queued records
+static int wakeup_fd_ = -1;
+static client_t clients_[BTSNOOP_NET_MAX_CLIENTS];
+static int num_clients_ = 0;
 
 void btsnoop_net_open() {
 #if (BT_NET_DEBUG != TRUE)
   return;  // Disable using network sockets for security reasons
 #endif
 
+  for (client_t& client : clients_) client.socket = -1;
+  listen_thread_stop_ = false;
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK);
+  if (wakeup_fd_ == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to create wakeup fd: %s", __func__,
+              strerror(errno));
+    return;
+  }
+
   listen_thread_valid_ =
       (pthread_create(&listen_thread_, NULL, listen_fn_, NULL) == 0);
-  if (!listen_thread_valid_)
+  if (!listen_thread_valid_) {
     LOG_ERROR(LOG_TAG, "%s pthread_create failed: %s", __func__,
               strerror(errno));
+    safe_close_(&wakeup_fd_);
+  }
 }
 
 void btsnoop_net_close() {
@@ -66,27 +106,55 @@ void btsnoop_net_close() {
 #endif
 
   if (listen_thread_valid_) {
+    listen_thread_stop_ = true;
     shutdown(listen_socket_, SHUT_RDWR);
+    eventfd_write(wakeup_fd_, 1);
     pthread_join(listen_thread_, NULL);
-    safe_close_(&client_socket_);
+
+    std::lock_guard<std::mutex> lock(client_socket_mutex_);
+    for (client_t& client : clients_) client_close_l_(&client);
+    safe_close_(&wakeup_fd_);
     listen_thread_valid_ = false;
   }
 }
 
-void btsnoop_net_write(const void* data, size_t length) {
+void btsnoop_net_write(const btsnoop_header_t* header,
+                       const struct iovec* packet, int iovcnt) {
 #if (BT_NET_DEBUG != TRUE)
   return;  // Disable using network sockets for security reasons
 #endif
 
   std::lock_guard<std::mutex> lock(client_socket_mutex_);
-  if (client_socket_ != -1) {
-    ssize_t ret;
-    OSI_NO_INTR(ret = send(client_socket_, data, length, 0));
+  if (num_clients_ == 0) return;
+
+  size_t length = sizeof(btsnoop_header_t);
+  for (int i = 0; i < iovcnt; i++) length += packet[i].iov_len;
+
+  bool wakeup = false;
+  for (client_t& client : clients_) {
+    if (client.socket == -1) continue;
 
-    if (ret == -1 && errno == ECONNRESET) {
-      safe_close_(&client_socket_);
+    if (BTSNOOP_NET_QUEUE_SIZE - (client.end - client.start) < length) {
+      client.dropped++;
+      continue;
     }
+
+    btsnoop_header_t client_header = *header;
+    client_header.dropped_packets =
+        htonl(ntohl(header->dropped_packets) + client.dropped);
+    bool was_empty = (client.start == client.end);
+    client_queue_l_(&client, &client_header, sizeof(client_header));
+    for (int i = 0; i < iovcnt; i++)
+      client_queue_l_(&client, packet[i].iov_base, packet[i].iov_len);
+
+    // A client reading fast enough never has queued records; the others are
+    // sent to when the listen thread sees their socket is writable
+    if (!was_empty) continue;
+    client_send_l_(&client);
+    if (client.socket != -1 && client.start != client.end) wakeup = true;
   }
+
+  if (wakeup) eventfd_write(wakeup_fd_, 1);
 }
 
 static void* listen_fn_(UNUSED_ATTR void* context) {
@@ -124,6 +192,62 @@ static void* listen_fn_(UNUSED_ATTR void* context) {
   }
 
   for (;;) {
+    // The listen socket, the wakeup fd, then the clients
+    struct pollfd fds[2 + BTSNOOP_NET_MAX_CLIENTS];
+    client_t* polled[BTSNOOP_NET_MAX_CLIENTS];
+    nfds_t nfds = 0;
+    fds[nfds++] = {listen_socket_, POLLIN, 0};
+    fds[nfds++] = {wakeup_fd_, POLLIN, 0};
+    {
+      std::lock_guard<std::mutex> lock(client_socket_mutex_);
+      for (client_t& client : clients_) {
+        if (client.socket == -1) continue;
+        polled[nfds - 2] = &client;
+        short events = (client.start != client.end) ? POLLIN | POLLOUT : POLLIN;
+        fds[nfds++] = {client.socket, events, 0};
+      }
+    }
+
+    int ret;
+    OSI_NO_INTR(ret = poll(fds, nfds, -1));
+    if (ret == -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to poll: %s", __func__, strerror(errno));
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      eventfd_t value;
+      eventfd_read(wakeup_fd_, &value);
+    }
+    if (listen_thread_stop_) break;
+
+    std::lock_guard<std::mutex> lock(client_socket_mutex_);
+    for (nfds_t i = 2; i < nfds; i++) {
+      client_t* client = polled[i - 2];
+      // Closed by btsnoop_net_write() since the poll
+      if (client->socket != fds[i].fd) continue;
+
+      if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        client_close_l_(client);
+        continue;
+      }
+
+      // The clients do not send anything, this is only the end of stream
+      if (fds[i].revents & POLLIN) {
+        char buf[64];
+        ssize_t n;
+        OSI_NO_INTR(n = recv(client->socket, buf, sizeof(buf), MSG_DONTWAIT));
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          client_close_l_(client);
+          continue;
+        }
+      }
+
+      if (fds[i].revents & POLLOUT) client_send_l_(client);
+    }
+
+    if (fds[0].revents == 0) continue;
+
     int client_socket;
     OSI_NO_INTR(client_socket = accept(listen_socket_, NULL, NULL));
     if (client_socket == -1) {
@@ -134,14 +258,7 @@ static void* listen_fn_(UNUSED_ATTR void* context) {
                strerror(errno));
       continue;
     }
-
-    /* When a new client connects, we have to send the btsnoop file header. This
-     * allows a decoder to treat the session as a new, valid btsnoop file. */
-    std::lock_guard<std::mutex> lock(client_socket_mutex_);
-    safe_close_(&client_socket_);
-    client_socket_ = client_socket;
-
-    OSI_NO_INTR(send(client_socket_, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16, 0));
+    client_open_l_(client_socket);
   }
 
 cleanup:
@@ -149,6 +266,81 @@ cleanup:
   return NULL;
 }
 
+static void client_open_l_(int client_socket) {
+  client_t* client = NULL;
+  for (client_t& it : clients_) {
+    if (it.socket == -1) {
+      client = &it;
+      break;
+    }
+  }
+  if (client == NULL) {
+    LOG_WARN(LOG_TAG, "%s rejecting client, already %d connected", __func__,
+             BTSNOOP_NET_MAX_CLIENTS);
+    close(client_socket);
+    return;
+  }
+
+  client->socket = client_socket;
+  client->queue = static_cast<uint8_t*>(
+      osi_malloc_tagged(BTSNOOP_NET_QUEUE_SIZE, OSI_MEM_BTSNOOP));
+  client->start = 0;
+  client->end = 0;
+  client->dropped = 0;
+  num_clients_++;
+
+  /* When a new client connects, we have to send the btsnoop file header. This
+   * allows a decoder to treat the session as a new, valid btsnoop file. */
+  client_queue_l_(client, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+  client_send_l_(client);
+}
+
+static void client_close_l_(client_t* client) {
+  if (client->socket == -1) return;
+
+  if (client->dropped > 0)
+    LOG_WARN(LOG_TAG, "%s %u packets were dropped for the client", __func__,
+             client->dropped);
+  safe_close_(&client->socket);
+  osi_free(client->queue);
+  client->queue = NULL;
+  num_clients_--;
+}
+
+// Appends |length| octets to the queue of |client|, which must have room
+// for them.
+static void client_queue_l_(client_t* client, const void* data,
+                            size_t length) {
+  if (BTSNOOP_NET_QUEUE_SIZE - client->end < length) {
+    memmove(client->queue, client->queue + client->start,
+            client->end - client->start);
+    client->end -= client->start;
+    client->start = 0;
+  }
+  CHECK(BTSNOOP_NET_QUEUE_SIZE - client->end >= length);
+
+  memcpy(client->queue + client->end, data, length);
+  client->end += length;
+}
+
+// Sends as much of the queue of |client| as its socket takes without
+// blocking, and closes the client if the connection is gone.
+static void client_send_l_(client_t* client) {
+  while (client->start != client->end) {
+    ssize_t ret;
+    OSI_NO_INTR(ret = send(client->socket, client->queue + client->start,
+                           client->end - client->start,
+                           MSG_DONTWAIT | MSG_NOSIGNAL));
+    if (ret == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) client_close_l_(client);
+      return;
+    }
+    client->start += ret;
+  }
+  client->start = 0;
+  client->end = 0;
+}
+
 static void safe_close_(int* fd) {
   CHECK(fd != NULL);
   if (*fd != -1) {
@@ -17,15 +17,54 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <stdio.h>
 
 #include "bt_common.h"
 #include "buffer_allocator.h"
+#include "osi/include/pool.h"
+
+// The HCI commands of up to HCI_CMD_BUF_SIZE octets, i.e. all of them, take
+// their buffer from a preallocated pool instead of the heap. The pool covers
+// the commands queued at once in a burst of scan, advertising or connection
+// parameter updates.
+#define COMMAND_POOL_SIZE 32
 
 static void* buffer_alloc(size_t size) {
   CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
-  return osi_malloc(size);
+  return osi_malloc_tagged(size, OSI_MEM_HCI);
+}
+
+// The pool lives as long as the process. It is created on the first command,
+// and its buffers are returned to it by |osi_free|.
+static pool_t* command_pool() {
+  static pool_t* pool = pool_new(HCI_CMD_BUF_SIZE, COMMAND_POOL_SIZE);
+  return pool;
+}
+
+static void* command_buffer_alloc(size_t size) {
+  CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
+  pool_t* pool = command_pool();
+  void* buffer = NULL;
+  if (pool != NULL && size <= HCI_CMD_BUF_SIZE) buffer = pool_alloc(pool);
+  if (buffer == NULL) buffer = osi_malloc_tagged(size, OSI_MEM_HCI);
+  return buffer;
 }
 
 static const allocator_t interface = {buffer_alloc, osi_free};
+static const allocator_t command_interface = {command_buffer_alloc, osi_free};
 
 const allocator_t* buffer_allocator_get_interface() { return &interface; }
+
+const allocator_t* buffer_allocator_get_command_interface() {
+  return &command_interface;
+}
+
+void buffer_allocator_debug_dump(int fd) {
+  pool_t* pool = command_pool();
+  if (pool == NULL) return;
+
+  dprintf(fd, "\nHCI command buffers:\n");
+  dprintf(fd, "  Pool buffers (available/total): %zu / %zu, exhausted: %zu\n",
+          pool_available(pool), pool_capacity(pool),
+          pool_exhausted_count(pool));
+}
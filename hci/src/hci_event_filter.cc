@@ -0,0 +1,306 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_hci_event_filter"
+
+#include "hci_event_filter.h"
+
+#include <base/logging.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+// The bits of the event masks, numbered as in the Set Event Mask and the
+// LE Set Event Mask commands. Bit N of the LE mask is the LE meta event of
+// subevent code N + 1.
+#define EVENT_BIT(bit) (1ULL << (bit))
+#define LE_SUBEVENT_BIT(subevent_code) EVENT_BIT((subevent_code)-1)
+
+#define INQUIRY_RESULT_BITS \
+  (EVENT_BIT(1) | EVENT_BIT(33) | EVENT_BIT(38))
+#define LE_ADVERTISING_REPORT_BITS                   \
+  (LE_SUBEVENT_BIT(HCI_BLE_ADV_PKT_RPT_EVT) |        \
+   LE_SUBEVENT_BIT(HCI_BLE_DIRECT_ADV_EVT) |         \
+   LE_SUBEVENT_BIT(HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT))
+
+#define EVENT_CODES 256
+#define WORD_BITS 64
+
+static const struct {
+  uint64_t classic_bits;
+  uint64_t le_bits;
+} feature_bits[HCI_EVENT_FEATURE_MAX] = {
+    {INQUIRY_RESULT_BITS, 0},         // HCI_EVENT_FEATURE_INQUIRY
+    {INQUIRY_RESULT_BITS, 0},         // HCI_EVENT_FEATURE_PERIODIC_INQUIRY
+    {0, LE_ADVERTISING_REPORT_BITS},  // HCI_EVENT_FEATURE_LE_SCAN
+};
+
+// The classic events of the features, and their bits
+static const struct {
+  uint8_t event_code;
+  uint8_t bit;
+} classic_event_bits[] = {
+    {HCI_INQUIRY_RESULT_EVT, 1},
+    {HCI_INQUIRY_RSSI_RESULT_EVT, 33},
+    {HCI_EXTENDED_INQUIRY_RESULT_EVT, 38},
+};
+
+static std::mutex filter_mutex;
+static const hci_t* hci;
+static const hci_packet_factory_t* packet_factory;
+static bool feature_active[HCI_EVENT_FEATURE_MAX];
+static bool has_classic_mask;
+static bool has_le_mask;
+static uint64_t classic_mask;
+static uint64_t le_mask;
+static uint64_t classic_mask_set;
+static uint64_t le_mask_set;
+static uint64_t mask_updates;
+
+// Read by the HCI thread for each event
+static std::atomic<uint64_t> active_classic_bits(0);
+static std::atomic<uint64_t> active_le_bits(0);
+static std::atomic<bool> subscribed(false);
+static std::atomic<uint64_t> subscribed_events[EVENT_CODES / WORD_BITS];
+static std::atomic<uint64_t> subscribed_le_subevents[EVENT_CODES / WORD_BITS];
+
+static std::atomic<uint64_t> dropped_inactive(0);
+static std::atomic<uint64_t> dropped_unsubscribed(0);
+static std::atomic<uint32_t> dropped_events[EVENT_CODES];
+static std::atomic<uint32_t> dropped_le_subevents[EVENT_CODES];
+
+static uint64_t all_feature_classic_bits(void) {
+  uint64_t bits = 0;
+  for (const auto& feature : feature_bits) bits |= feature.classic_bits;
+  return bits;
+}
+
+static uint64_t all_feature_le_bits(void) {
+  uint64_t bits = 0;
+  for (const auto& feature : feature_bits) bits |= feature.le_bits;
+  return bits;
+}
+
+static uint64_t from_event_mask(const bt_event_mask_t* mask) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; i++) bits = (bits << 8) | mask->as_array[i];
+  return bits;
+}
+
+// The octets of |bt_event_mask_t| go from the highest bits to the lowest.
+static bt_event_mask_t to_event_mask(uint64_t bits) {
+  return {{(uint8_t)(bits >> 56), (uint8_t)(bits >> 48), (uint8_t)(bits >> 40),
+           (uint8_t)(bits >> 32), (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+           (uint8_t)(bits >> 8), (uint8_t)bits}};
+}
+
+// |filter_mutex| must be held by the callers of the functions below.
+
+static void update_active_bits(void) {
+  uint64_t classic_bits = 0;
+  uint64_t le_bits = 0;
+  for (int i = 0; i < HCI_EVENT_FEATURE_MAX; i++) {
+    if (!feature_active[i]) continue;
+    classic_bits |= feature_bits[i].classic_bits;
+    le_bits |= feature_bits[i].le_bits;
+  }
+  active_classic_bits = classic_bits;
+  active_le_bits = le_bits;
+}
+
+static uint64_t effective_classic_mask(void) {
+  return classic_mask & ~(all_feature_classic_bits() & ~active_classic_bits);
+}
+
+static uint64_t effective_le_mask(void) {
+  return le_mask & ~(all_feature_le_bits() & ~active_le_bits);
+}
+
+static void mask_update_complete(BT_HDR* response, UNUSED_ATTR void* context) {
+  // Event code, length, credits and opcode, then the status
+  uint8_t status = response->len > 5 ? response->data[5] : HCI_ERR_UNSPECIFIED;
+  if (status != HCI_SUCCESS)
+    LOG_WARN(LOG_TAG, "%s event mask update failed: 0x%02x", __func__, status);
+  osi_free(response);
+}
+
+static void update_controller_masks(void) {
+  if (hci == NULL) return;
+
+  if (has_classic_mask && effective_classic_mask() != classic_mask_set) {
+    classic_mask_set = effective_classic_mask();
+    bt_event_mask_t mask = to_event_mask(classic_mask_set);
+    hci->transmit_command(packet_factory->make_set_event_mask(&mask),
+                          mask_update_complete, NULL, NULL);
+    mask_updates++;
+  }
+
+  if (has_le_mask && effective_le_mask() != le_mask_set) {
+    le_mask_set = effective_le_mask();
+    bt_event_mask_t mask = to_event_mask(le_mask_set);
+    hci->transmit_command(packet_factory->make_ble_set_event_mask(&mask),
+                          mask_update_complete, NULL, NULL);
+    mask_updates++;
+  }
+}
+
+void hci_event_filter_start_up(const hci_t* hci_interface,
+                               const hci_packet_factory_t* factory,
+                               const bt_event_mask_t* classic_event_mask,
+                               const bt_event_mask_t* le_event_mask) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  hci = hci_interface;
+  packet_factory = factory;
+  has_classic_mask = classic_event_mask != NULL;
+  classic_mask = has_classic_mask ? from_event_mask(classic_event_mask) : 0;
+  has_le_mask = le_event_mask != NULL;
+  le_mask = has_le_mask ? from_event_mask(le_event_mask) : 0;
+  classic_mask_set = effective_classic_mask();
+  le_mask_set = effective_le_mask();
+}
+
+void hci_event_filter_shut_down(void) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  hci = NULL;
+  packet_factory = NULL;
+  for (int i = 0; i < HCI_EVENT_FEATURE_MAX; i++) feature_active[i] = false;
+  update_active_bits();
+}
+
+bt_event_mask_t hci_event_filter_get_classic_mask(void) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  return to_event_mask(classic_mask_set);
+}
+
+bt_event_mask_t hci_event_filter_get_le_mask(void) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  return to_event_mask(le_mask_set);
+}
+
+void hci_event_filter_set_feature_active(hci_event_feature_t feature,
+                                         bool active) {
+  CHECK(feature < HCI_EVENT_FEATURE_MAX);
+
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  if (feature_active[feature] == active) return;
+  feature_active[feature] = active;
+
+  // The events are let through before the controller is asked for them,
+  // and dropped as soon as they are not wanted any more.
+  update_active_bits();
+  update_controller_masks();
+}
+
+static void set_codes(std::atomic<uint64_t>* words, const uint8_t* codes,
+                      size_t count) {
+  uint64_t bits[EVENT_CODES / WORD_BITS] = {0};
+  for (size_t i = 0; i < count; i++)
+    bits[codes[i] / WORD_BITS] |= 1ULL << (codes[i] % WORD_BITS);
+  for (int i = 0; i < EVENT_CODES / WORD_BITS; i++) words[i] = bits[i];
+}
+
+void hci_event_filter_subscribe(const uint8_t* event_codes, size_t event_count,
+                                const uint8_t* le_subevent_codes,
+                                size_t le_subevent_count) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+  subscribed = false;
+  set_codes(subscribed_events, event_codes, event_count);
+  set_codes(subscribed_le_subevents, le_subevent_codes, le_subevent_count);
+  subscribed = event_count > 0;
+}
+
+static bool has_code(const std::atomic<uint64_t>* words, uint8_t code) {
+  return words[code / WORD_BITS].load(std::memory_order_relaxed) &
+         (1ULL << (code % WORD_BITS));
+}
+
+static bool is_feature_inactive(uint8_t event_code, int le_subevent_code) {
+  if (le_subevent_code > 0) {
+    if (le_subevent_code > WORD_BITS) return false;
+    uint64_t bit = LE_SUBEVENT_BIT(le_subevent_code);
+    return (all_feature_le_bits() & bit) && !(active_le_bits & bit);
+  }
+
+  for (const auto& event_bit : classic_event_bits) {
+    if (event_bit.event_code == event_code)
+      return !(active_classic_bits & EVENT_BIT(event_bit.bit));
+  }
+  return false;
+}
+
+static bool is_unsubscribed(uint8_t event_code, int le_subevent_code) {
+  if (!subscribed) return false;
+  if (!has_code(subscribed_events, event_code)) return true;
+  return le_subevent_code > 0 &&
+         !has_code(subscribed_le_subevents, le_subevent_code);
+}
+
+bool hci_event_filter_drops(const BT_HDR* packet) {
+  if (packet->len < 2) return false;
+  uint8_t event_code = packet->data[0];
+  int le_subevent_code = -1;
+  if (event_code == HCI_BLE_EVENT && packet->len > 2)
+    le_subevent_code = packet->data[2];
+
+  if (is_feature_inactive(event_code, le_subevent_code)) {
+    dropped_inactive++;
+  } else if (is_unsubscribed(event_code, le_subevent_code)) {
+    dropped_unsubscribed++;
+  } else {
+    return false;
+  }
+
+  if (le_subevent_code > 0)
+    dropped_le_subevents[le_subevent_code]++;
+  else
+    dropped_events[event_code]++;
+  return true;
+}
+
+void hci_event_filter_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(filter_mutex);
+
+  dprintf(fd, "\nHCI event filter:\n");
+  if (has_classic_mask)
+    dprintf(fd, "  Event mask: 0x%016llx\n",
+            (unsigned long long)classic_mask_set);
+  if (has_le_mask)
+    dprintf(fd, "  LE event mask: 0x%016llx\n",
+            (unsigned long long)le_mask_set);
+  dprintf(fd, "  Event mask updates: %llu\n",
+          (unsigned long long)mask_updates);
+  dprintf(fd, "  Dropped events (feature inactive/unsubscribed): %llu / %llu\n",
+          (unsigned long long)dropped_inactive.load(),
+          (unsigned long long)dropped_unsubscribed.load());
+
+  for (int code = 0; code < EVENT_CODES; code++) {
+    if (dropped_events[code] != 0)
+      dprintf(fd, "    Event 0x%02x: %u\n", code, dropped_events[code].load());
+  }
+  for (int code = 0; code < EVENT_CODES; code++) {
+    if (dropped_le_subevents[code] != 0)
+      dprintf(fd, "    LE event 0x%02x: %u\n", code,
+              dropped_le_subevents[code].load());
+  }
+}
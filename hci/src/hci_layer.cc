@@ -37,21 +37,27 @@
 #include "btcore/include/module.h"
 #include "btsnoop.h"
 #include "buffer_allocator.h"
+#include "hci_event_filter.h"
 #include "hci_inject.h"
 #include "hci_internals.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "osi/include/alarm.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "osi/include/reactor.h"
+#include "osi/include/wakelock.h"
 #include "packet_fragmenter.h"
 
 #define BT_HCI_TIMEOUT_TAG_NUM 1010000
 
 extern void hci_initialize();
 extern void hci_transmit(BT_HDR* packet);
+extern void hci_transmit_fragment(BT_HDR* packet);
+extern void hci_transmit_flush();
+extern void hci_transport_debug_dump(int fd);
 extern void hci_close();
 extern int hci_open_firmware_log_file();
 extern void hci_close_firmware_log_file(int fd);
@@ -105,6 +111,8 @@ static std::queue<base::Closure> command_queue;
 // Inbound-related
 static alarm_t* command_response_timer;
 static list_t* commands_pending_response;
+// True if the HCI wakelock is held for |commands_pending_response|
+static bool command_wakelock_held;
 static std::recursive_mutex commands_pending_response_mutex;
 
 // The hand-off point for data going to a higher layer, set by the higher layer
@@ -150,11 +158,19 @@ void hci_event_received(BT_HDR* packet) {
 
 void acl_event_received(BT_HDR* packet) {
   btsnoop->capture(packet, true);
+  FLOW_TRACE_START(FLOW_TRACE_HCI, packet, "HCI ACL rx");
   packet_fragmenter->reassemble_and_dispatch(packet);
 }
 
 void sco_data_received(BT_HDR* packet) {
   btsnoop->capture(packet, true);
+  FLOW_TRACE_START(FLOW_TRACE_HCI, packet, "HCI SCO rx");
+  packet_fragmenter->reassemble_and_dispatch(packet);
+}
+
+void iso_data_received(BT_HDR* packet) {
+  btsnoop->capture(packet, true);
+  FLOW_TRACE_START(FLOW_TRACE_HCI, packet, "HCI ISO rx");
   packet_fragmenter->reassemble_and_dispatch(packet);
 }
 
@@ -258,6 +274,10 @@ static future_t* hci_module_shut_down() {
     command_response_timer = NULL;
     alarm_free(startup_timer);
     startup_timer = NULL;
+    if (command_wakelock_held) {
+      wakelock_release_reason(WAKELOCK_REASON_HCI);
+      command_wakelock_held = false;
+    }
   }
 
   {
@@ -304,7 +324,7 @@ static void transmit_command(BT_HDR* command,
                              command_complete_cb complete_callback,
                              command_status_cb status_callback, void* context) {
   waiting_command_t* wait_entry = reinterpret_cast<waiting_command_t*>(
-      osi_calloc(sizeof(waiting_command_t)));
+      osi_calloc_tagged(sizeof(waiting_command_t), OSI_MEM_HCI));
 
   uint8_t* stream = command->data + command->offset;
   STREAM_TO_UINT16(wait_entry->opcode, stream);
@@ -322,7 +342,7 @@ static void transmit_command(BT_HDR* command,
 
 static future_t* transmit_command_futured(BT_HDR* command) {
   waiting_command_t* wait_entry = reinterpret_cast<waiting_command_t*>(
-      osi_calloc(sizeof(waiting_command_t)));
+      osi_calloc_tagged(sizeof(waiting_command_t), OSI_MEM_HCI));
   future_t* future = future_new();
 
   uint8_t* stream = command->data + command->offset;
@@ -420,10 +440,19 @@ static void event_packet_ready(void* pkt) {
 // Callback for the fragmenter to send a fragment
 static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
   btsnoop->capture(packet, false);
+  if (send_transmit_finished)
+    FLOW_TRACE_END(FLOW_TRACE_HCI, packet, "HCI tx");
+  else
+    FLOW_TRACE(FLOW_TRACE_HCI, packet, "HCI tx fragment");
 
-  hci_transmit(packet);
-
+  // The fragments ahead of the last one may be sent along with it, the
+  // transport has to send them before the packet is released.
   uint16_t event = packet->event & MSG_EVT_MASK;
+  if (event == MSG_STACK_TO_HC_HCI_ACL && !send_transmit_finished)
+    hci_transmit_fragment(packet);
+  else
+    hci_transmit(packet);
+
   if (event != MSG_STACK_TO_HC_HCI_CMD && send_transmit_finished)
     buffer_allocator->free(packet);
 }
@@ -436,6 +465,7 @@ static void fragmenter_transmit_finished(BT_HDR* packet,
     // This is kind of a weird case, since we're dispatching a partially sent
     // packet up to a higher layer.
     // TODO(zachoverflow): rework upper layer so this isn't necessary.
+    hci_transmit_flush();
     data_dispatcher_dispatch(interface.event_dispatcher,
                              packet->event & MSG_EVT_MASK, packet);
   }
@@ -528,9 +558,10 @@ void process_command_credits(int credits) {
   }
 }
 
-// Returns true if the event was intercepted and should not proceed to
-// higher layers. Also inspects an incoming event for interesting
-// information, like how many commands are now able to be sent.
+// Returns true if the event was intercepted, or dropped by the event filter,
+// and should not proceed to higher layers. Also inspects an incoming event
+// for interesting information, like how many commands are now able to be
+// sent.
 static bool filter_incoming_event(BT_HDR* packet) {
   waiting_command_t* wait_entry = NULL;
   uint8_t* stream = packet->data;
@@ -598,6 +629,9 @@ static bool filter_incoming_event(BT_HDR* packet) {
     if (hci_firmware_log_fd != INVALID_FD)
       hci_log_firmware_debug_packet(hci_firmware_log_fd, packet);
 
+    buffer_allocator->free(packet);
+    return true;
+  } else if (hci_event_filter_drops(packet)) {
     buffer_allocator->free(packet);
     return true;
   }
@@ -663,7 +697,13 @@ static void update_command_response_timer(void) {
   if (command_response_timer == NULL) return;
   if (list_is_empty(commands_pending_response)) {
     alarm_cancel(command_response_timer);
+    if (command_wakelock_held) {
+      wakelock_release_reason(WAKELOCK_REASON_HCI);
+      command_wakelock_held = false;
+    }
   } else {
+    if (!command_wakelock_held)
+      command_wakelock_held = wakelock_acquire_reason(WAKELOCK_REASON_HCI);
     alarm_set(command_response_timer, COMMAND_PENDING_TIMEOUT_MS,
               command_timed_out, list_front(commands_pending_response));
   }
@@ -700,6 +740,12 @@ void hci_layer_cleanup_interface() {
   }
 }
 
+void hci_layer_debug_dump(int fd) {
+  hci_transport_debug_dump(fd);
+  buffer_allocator_debug_dump(fd);
+  hci_event_filter_debug_dump(fd);
+}
+
 const hci_t* hci_layer_get_interface() {
   buffer_allocator = buffer_allocator_get_interface();
   btsnoop = btsnoop_get_interface();
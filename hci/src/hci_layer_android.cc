@@ -133,12 +133,23 @@ void hci_transmit(BT_HDR* packet) {
     case MSG_STACK_TO_HC_HCI_SCO:
       btHci->sendScoData(data);
       break;
+    case MSG_STACK_TO_HC_HCI_ISO:
+      // The 1.0 HAL has no ISO data path, the SDUs are dropped
+      LOG_ERROR(LOG_TAG, "%s: no ISO data path in the HAL", __func__);
+      break;
     default:
       LOG_ERROR(LOG_TAG, "Unknown packet type (%d)", event);
       break;
   }
 }
 
+// The HAL copies each packet as it is sent, there is nothing to batch.
+void hci_transmit_fragment(BT_HDR* packet) { hci_transmit(packet); }
+
+void hci_transmit_flush() {}
+
+void hci_transport_debug_dump(int fd) {}
+
 int hci_open_firmware_log_file() {
   if (rename(LOG_PATH, LAST_LOG_PATH) == -1 && errno != ENOENT) {
     LOG_ERROR(LOG_TAG, "%s unable to rename '%s' to '%s': %s", __func__,
@@ -18,6 +18,7 @@
  *
  **********************************************************************/
 #include <base/bind.h>
+#include <base/command_line.h>
 #include <base/logging.h>
 #include <base/threading/thread.h>
 #include <errno.h>
@@ -28,13 +29,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
+#include <string>
 
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "buffer_allocator.h"
 #include "hci_internals.h"
 #include "hci_layer.h"
+#include "hci_replay.h"
 #include "osi/include/compat.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -47,6 +52,16 @@ using base::Thread;
 #define HCI_CHANNEL_CONTROL 3
 #define HCI_DEV_NONE 0xffff
 
+/* Command line switch selecting the controller, overriding the
+ * bluetooth.interface property: each process drives a single controller,
+ * several controllers are driven by running a stack for each of them. */
+#define HCI_INTERFACE_SWITCH "hci"
+
+/* Command line switches replaying a btsnoop log in place of a controller,
+ * at the original speed or N times faster, as fast as possible with 0. */
+#define HCI_REPLAY_SWITCH "hci-replay"
+#define HCI_REPLAY_SPEED_SWITCH "hci-replay-speed"
+
 #define RFKILL_TYPE_BLUETOOTH 2
 #define RFKILL_OP_CHANGE_ALL 3
 
@@ -56,6 +71,13 @@ using base::Thread;
 #define MGMT_EV_SIZE_MAX 1024
 #define MGMT_EV_POLL_TIMEOUT 3000 /* 3000ms */
 
+/* Packets read or written by a single system call on the user channel. */
+#ifndef HCI_IO_BATCH_SIZE
+#define HCI_IO_BATCH_SIZE 8
+#endif
+
+#define HCI_READ_BUF_SIZE 2000
+
 struct sockaddr_hci {
   sa_family_t hci_family;
   unsigned short hci_dev;
@@ -88,64 +110,130 @@ enum HciPacketType {
   HCI_PACKET_TYPE_COMMAND = 1,
   HCI_PACKET_TYPE_ACL_DATA = 2,
   HCI_PACKET_TYPE_SCO_DATA = 3,
-  HCI_PACKET_TYPE_EVENT = 4
+  HCI_PACKET_TYPE_EVENT = 4,
+  HCI_PACKET_TYPE_ISO_DATA = 5
 };
 
 extern void initialization_complete();
 extern void hci_event_received(BT_HDR* packet);
 extern void acl_event_received(BT_HDR* packet);
 extern void sco_data_received(BT_HDR* packet);
+extern void iso_data_received(BT_HDR* packet);
 
 static int bt_vendor_fd = -1;
 static int hci_interface;
 static int rfkill_en;
+static bool replaying;
 static int wait_hcidev(void);
 static int rfkill(int block);
 
 int reader_thread_ctrl_fd = -1;
 Thread* reader_thread = NULL;
 
-void monitor_socket(int ctrl_fd, int fd) {
+/* Batches by number of packets, |batches[n - 1]| counting those of n. */
+struct io_stats_t {
+  std::atomic<uint32_t> packets;
+  std::atomic<uint32_t> batches[HCI_IO_BATCH_SIZE];
+};
+
+static io_stats_t rx_stats;
+static io_stats_t tx_stats;
+static std::atomic<uint32_t> tx_fragments_coalesced;
+
+/* The packets to write, sent from the buffers of the stack: the fragments
+ * of an ACL packet wait to be sent along with the last one, whose buffer
+ * lives until then. */
+static uint8_t tx_types[HCI_IO_BATCH_SIZE];
+static uint8_t tx_tails[HCI_IO_BATCH_SIZE][HCI_ACL_PREAMBLE_SIZE];
+static struct iovec tx_iov[HCI_IO_BATCH_SIZE][3];
+static struct mmsghdr tx_msgs[HCI_IO_BATCH_SIZE];
+static size_t tx_lens[HCI_IO_BATCH_SIZE];
+static int tx_num;
+
+static void count_batch(io_stats_t* stats, int num_packets) {
+  stats->packets.fetch_add(num_packets, std::memory_order_relaxed);
+  stats->batches[num_packets - 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void dispatch_packet(BT_HDR* packet, uint8_t type) {
+  switch (type) {
+    case HCI_PACKET_TYPE_COMMAND:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_ACL_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ACL;
+      acl_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_SCO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_SCO;
+      sco_data_received(packet);
+      break;
+    case HCI_PACKET_TYPE_EVENT:
+      packet->event = MSG_HC_TO_STACK_HCI_EVT;
+      hci_event_received(packet);
+      break;
+    case HCI_PACKET_TYPE_ISO_DATA:
+      packet->event = MSG_HC_TO_STACK_HCI_ISO;
+      iso_data_received(packet);
+      break;
+    default:
+      LOG(FATAL) << "Unexpected event type: " << +type;
+      break;
+  }
+}
+
+/* Reads the packets received, up to HCI_IO_BATCH_SIZE, waiting for the first
+ * one only. The packet type goes to |types| and the rest straight in the
+ * buffers of |packets|, allocated for the missing ones. */
+static int read_packets(int fd, BT_HDR** packets, uint8_t* types) {
   const allocator_t* buffer_allocator = buffer_allocator_get_interface();
-  const size_t buf_size = 2000;
-  uint8_t buf[buf_size];
-  ssize_t len = read(fd, buf, buf_size);
+  struct iovec iov[HCI_IO_BATCH_SIZE][2];
+  struct mmsghdr msgs[HCI_IO_BATCH_SIZE];
+
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < HCI_IO_BATCH_SIZE; i++) {
+    if (packets[i] == NULL)
+      packets[i] = reinterpret_cast<BT_HDR*>(
+          buffer_allocator->alloc(HCI_READ_BUF_SIZE + BT_HDR_SIZE));
+    iov[i][0].iov_base = &types[i];
+    iov[i][0].iov_len = sizeof(types[i]);
+    iov[i][1].iov_base = packets[i]->data;
+    iov[i][1].iov_len = HCI_READ_BUF_SIZE - sizeof(types[i]);
+    msgs[i].msg_hdr.msg_iov = iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 2;
+  }
 
-  while (len > 0) {
-    if (len == buf_size)
+  int num;
+  OSI_NO_INTR(num = recvmmsg(fd, msgs, HCI_IO_BATCH_SIZE, MSG_WAITFORONE,
+                             NULL));
+
+  for (int i = 0; i < num; i++) {
+    if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+        msgs[i].msg_len == HCI_READ_BUF_SIZE)
       LOG(FATAL) << "This packet filled buffer, if it have continuation we "
                     "don't know how to merge it, increase buffer size!";
+    if (msgs[i].msg_len == 0) return i;
 
-    uint8_t type = buf[0];
-
-    size_t packet_size = buf_size + BT_HDR_SIZE;
-    BT_HDR* packet =
-        reinterpret_cast<BT_HDR*>(buffer_allocator->alloc(packet_size));
+    BT_HDR* packet = packets[i];
     packet->offset = 0;
     packet->layer_specific = 0;
-    packet->len = len - 1;
-    memcpy(packet->data, buf + 1, len - 1);
+    packet->len = msgs[i].msg_len - 1;
+  }
+  return num;
+}
 
-    switch (type) {
-      case HCI_PACKET_TYPE_COMMAND:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_ACL_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_ACL;
-        acl_event_received(packet);
-        break;
-      case HCI_PACKET_TYPE_SCO_DATA:
-        packet->event = MSG_HC_TO_STACK_HCI_SCO;
-        sco_data_received(packet);
-        break;
-      case HCI_PACKET_TYPE_EVENT:
-        packet->event = MSG_HC_TO_STACK_HCI_EVT;
-        hci_event_received(packet);
-        break;
-      default:
-        LOG(FATAL) << "Unexpected event type: " << +type;
-        break;
+void monitor_socket(int ctrl_fd, int fd) {
+  const allocator_t* buffer_allocator = buffer_allocator_get_interface();
+  BT_HDR* packets[HCI_IO_BATCH_SIZE] = {NULL};
+  uint8_t types[HCI_IO_BATCH_SIZE];
+  int num = read_packets(fd, packets, types);
+
+  while (num > 0) {
+    count_batch(&rx_stats, num);
+    for (int i = 0; i < num; i++) {
+      dispatch_packet(packets[i], types[i]);
+      packets[i] = NULL;
     }
 
     fd_set fds;
@@ -157,25 +245,66 @@ void monitor_socket(int ctrl_fd, int fd) {
 
     if (FD_ISSET(ctrl_fd, &fds)) {
       LOG(INFO) << "exitting";
-      return;
+      break;
     }
 
-    len = read(fd, buf, buf_size);
+    num = read_packets(fd, packets, types);
+  }
+
+  for (int i = 0; i < HCI_IO_BATCH_SIZE; i++) {
+    if (packets[i] != NULL) buffer_allocator->free(packets[i]);
   }
 }
 
 /* TODO: should thread the device waiting and return immedialty */
+/* Replays the btsnoop log of the command line, if any, in place of a
+ * controller. */
+static bool replay_initialize() {
+  if (!base::CommandLine::InitializedForCurrentProcess()) return false;
+  const base::CommandLine* command_line =
+      base::CommandLine::ForCurrentProcess();
+  if (!command_line->HasSwitch(HCI_REPLAY_SWITCH)) return false;
+
+  std::string path = command_line->GetSwitchValueASCII(HCI_REPLAY_SWITCH);
+  uint32_t speed_up = 1;
+  if (command_line->HasSwitch(HCI_REPLAY_SPEED_SWITCH))
+    speed_up = strtoul(
+        command_line->GetSwitchValueASCII(HCI_REPLAY_SPEED_SWITCH).c_str(),
+        NULL, 10);
+
+  if (!hci_replay_open(path.c_str(), speed_up, dispatch_packet))
+    LOG(FATAL) << "unable to replay " << path;
+  LOG(INFO) << "Replaying " << path << " at speed " << speed_up;
+  return true;
+}
+
 void hci_initialize() {
   LOG(INFO) << __func__;
 
+  if (replay_initialize()) {
+    replaying = true;
+    initialization_complete();
+    return;
+  }
+
   char prop_value[PROPERTY_VALUE_MAX];
   osi_property_get("bluetooth.interface", prop_value, "0");
 
+  std::string interface_value(prop_value);
+  if (base::CommandLine::InitializedForCurrentProcess()) {
+    const base::CommandLine* command_line =
+        base::CommandLine::ForCurrentProcess();
+    if (command_line->HasSwitch(HCI_INTERFACE_SWITCH))
+      interface_value =
+          command_line->GetSwitchValueASCII(HCI_INTERFACE_SWITCH);
+  }
+
+  const char* value = interface_value.c_str();
   errno = 0;
-  if (memcmp(prop_value, "hci", 3))
-    hci_interface = strtol(prop_value, NULL, 10);
+  if (memcmp(value, "hci", 3))
+    hci_interface = strtol(value, NULL, 10);
   else
-    hci_interface = strtol(prop_value + 3, NULL, 10);
+    hci_interface = strtol(value + 3, NULL, 10);
   if (errno) hci_interface = 0;
 
   LOG(INFO) << "Using interface hci" << +hci_interface;
@@ -223,6 +352,14 @@ void hci_initialize() {
 void hci_close() {
   LOG(INFO) << __func__;
 
+  if (replaying) {
+    hci_replay_close();
+    replaying = false;
+    return;
+  }
+
+  tx_num = 0;
+
   if (bt_vendor_fd != -1) {
     close(bt_vendor_fd);
     bt_vendor_fd = -1;
@@ -243,11 +380,61 @@ void hci_close() {
   rfkill(1);
 }
 
-void hci_transmit(BT_HDR* packet) {
-  uint8_t type;
+static void write_packets() {
+  int sent = 0;
+
+  count_batch(&tx_stats, tx_num);
+  while (sent < tx_num) {
+    int ret;
+    OSI_NO_INTR(ret = sendmmsg(bt_vendor_fd, tx_msgs + sent, tx_num - sent, 0));
+    if (ret == -1) LOG(FATAL) << strerror(errno);
+
+    for (int i = sent; i < sent + ret; i++) {
+      if (tx_msgs[i].msg_len != tx_lens[i])
+        LOG(ERROR) << "Should have send whole packet";
+    }
+    sent += ret;
+  }
+  tx_num = 0;
+}
 
+/* Queues |packet| to be written with the next batch. The packet type is sent
+ * from its own iovec, so that the packet needs no headroom and is not
+ * written to while it is in flight. */
+static void queue_packet(BT_HDR* packet, uint8_t type, bool fragment) {
   CHECK(bt_vendor_fd != -1);
 
+  if (tx_num == HCI_IO_BATCH_SIZE) write_packets();
+
+  int i = tx_num++;
+  uint8_t* data = packet->data + packet->offset;
+  size_t len = packet->len;
+
+  tx_types[i] = type;
+  tx_iov[i][0].iov_base = &tx_types[i];
+  tx_iov[i][0].iov_len = sizeof(tx_types[i]);
+  tx_iov[i][1].iov_base = data;
+  tx_iov[i][1].iov_len = len;
+  memset(&tx_msgs[i], 0, sizeof(tx_msgs[i]));
+  tx_msgs[i].msg_hdr.msg_iov = tx_iov[i];
+  tx_msgs[i].msg_hdr.msg_iovlen = 2;
+  tx_lens[i] = len + sizeof(type);
+
+  /* the fragmenter writes the header of the next fragment over the end of
+   * this one, keep a copy of it */
+  if (fragment && len >= HCI_ACL_PREAMBLE_SIZE) {
+    tx_iov[i][1].iov_len = len - HCI_ACL_PREAMBLE_SIZE;
+    memcpy(tx_tails[i], data + len - HCI_ACL_PREAMBLE_SIZE,
+           HCI_ACL_PREAMBLE_SIZE);
+    tx_iov[i][2].iov_base = tx_tails[i];
+    tx_iov[i][2].iov_len = HCI_ACL_PREAMBLE_SIZE;
+    tx_msgs[i].msg_hdr.msg_iovlen = 3;
+  }
+}
+
+void hci_transmit(BT_HDR* packet) {
+  uint8_t type;
+
   uint16_t event = packet->event & MSG_EVT_MASK;
   switch (event & MSG_EVT_MASK) {
     case MSG_STACK_TO_HC_HCI_CMD:
@@ -259,21 +446,63 @@ void hci_transmit(BT_HDR* packet) {
     case MSG_STACK_TO_HC_HCI_SCO:
       type = 3;
       break;
+    case MSG_STACK_TO_HC_HCI_ISO:
+      type = HCI_PACKET_TYPE_ISO_DATA;
+      break;
     default:
       LOG(FATAL) << "Unknown packet type " << event;
       break;
   }
 
-  uint8_t* addr = packet->data + packet->offset - 1;
-  uint8_t store = *addr;
-  *addr = type;
-  size_t ret = write(bt_vendor_fd, addr, packet->len + 1);
+  if (replaying) {
+    // The recorded sessions have no ISO data to answer
+    if (type != HCI_PACKET_TYPE_ISO_DATA) hci_replay_transmit(packet, type);
+    return;
+  }
 
-  *(addr) = store;
+  queue_packet(packet, type, false);
+  write_packets();
+}
 
-  if (ret != packet->len + 1) LOG(ERROR) << "Should have send whole packet";
+void hci_transmit_fragment(BT_HDR* packet) {
+  if (replaying) {
+    hci_replay_transmit(packet, HCI_PACKET_TYPE_ACL_DATA);
+    return;
+  }
+
+  queue_packet(packet, HCI_PACKET_TYPE_ACL_DATA, true);
+  tx_fragments_coalesced.fetch_add(1, std::memory_order_relaxed);
+}
+
+void hci_transmit_flush() {
+  if (tx_num > 0) write_packets();
+}
+
+static void dump_io_stats(int fd, const char* name, io_stats_t* stats) {
+  uint32_t batches = 0;
+  for (int i = 0; i < HCI_IO_BATCH_SIZE; i++)
+    batches += stats->batches[i].load(std::memory_order_relaxed);
+
+  dprintf(fd, "  %s: %u packets in %u batches\n", name,
+          stats->packets.load(std::memory_order_relaxed), batches);
+  dprintf(fd, "    Batches by size:");
+  for (int i = 0; i < HCI_IO_BATCH_SIZE; i++)
+    dprintf(fd, " %d: %u", i + 1,
+            stats->batches[i].load(std::memory_order_relaxed));
+  dprintf(fd, "\n");
+}
+
+void hci_transport_debug_dump(int fd) {
+  if (replaying) {
+    hci_replay_debug_dump(fd);
+    return;
+  }
 
-  if (ret == -1) LOG(FATAL) << strerror(errno);
+  dprintf(fd, "\nHCI User Channel (hci%d):\n", hci_interface);
+  dump_io_stats(fd, "Received", &rx_stats);
+  dump_io_stats(fd, "Sent", &tx_stats);
+  dprintf(fd, "    ACL fragments sent with the next packet: %u\n",
+          tx_fragments_coalesced.load(std::memory_order_relaxed));
 }
 
 static int wait_hcidev(void) {
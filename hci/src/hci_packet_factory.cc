@@ -126,6 +126,10 @@ static BT_HDR* make_ble_read_buffer_size(void) {
   return make_command_no_params(HCI_BLE_READ_BUFFER_SIZE);
 }
 
+static BT_HDR* make_ble_read_buffer_size_v2(void) {
+  return make_command_no_params(HCI_BLE_READ_BUFFER_SIZE_V2);
+}
+
 static BT_HDR* make_ble_read_supported_states(void) {
   return make_command_no_params(HCI_BLE_READ_SUPPORTED_STATES);
 }
@@ -165,6 +169,18 @@ static BT_HDR* make_ble_set_event_mask(const bt_event_mask_t* event_mask) {
   return packet;
 }
 
+static BT_HDR* make_ble_set_host_feature(uint8_t bit_number,
+                                         uint8_t bit_value) {
+  uint8_t* stream;
+  const uint8_t parameter_size = 1 + 1;
+  BT_HDR* packet =
+      make_command(HCI_BLE_SET_HOST_FEATURE, parameter_size, &stream);
+
+  UINT8_TO_STREAM(stream, bit_number);
+  UINT8_TO_STREAM(stream, bit_value);
+  return packet;
+}
+
 // Internal functions
 
 static BT_HDR* make_command_no_params(uint16_t opcode) {
@@ -208,6 +224,7 @@ static const hci_packet_factory_t interface = {
     make_ble_write_host_support,
     make_ble_read_white_list_size,
     make_ble_read_buffer_size,
+    make_ble_read_buffer_size_v2,
     make_ble_read_supported_states,
     make_ble_read_local_supported_features,
     make_ble_read_resolving_list_size,
@@ -215,9 +232,10 @@ static const hci_packet_factory_t interface = {
     make_ble_read_maximum_advertising_data_length,
     make_ble_read_number_of_supported_advertising_sets,
     make_ble_set_event_mask,
+    make_ble_set_host_feature,
     make_read_local_supported_codecs};
 
 const hci_packet_factory_t* hci_packet_factory_get_interface() {
-  buffer_allocator = buffer_allocator_get_interface();
+  buffer_allocator = buffer_allocator_get_command_interface();
   return &interface;
 }
@@ -148,6 +148,21 @@ static void parse_ble_read_buffer_size_response(BT_HDR* response,
   buffer_allocator->free(response);
 }
 
+static void parse_ble_read_buffer_size_v2_response(
+    BT_HDR* response, uint16_t* acl_data_size_ptr,
+    uint8_t* acl_buffer_count_ptr, uint16_t* iso_data_size_ptr,
+    uint8_t* iso_buffer_count_ptr) {
+  uint8_t* stream = read_command_complete_header(
+      response, HCI_BLE_READ_BUFFER_SIZE_V2, 6 /* bytes after */);
+  CHECK(stream != NULL);
+  STREAM_TO_UINT16(*acl_data_size_ptr, stream);
+  STREAM_TO_UINT8(*acl_buffer_count_ptr, stream);
+  STREAM_TO_UINT16(*iso_data_size_ptr, stream);
+  STREAM_TO_UINT8(*iso_buffer_count_ptr, stream);
+
+  buffer_allocator->free(response);
+}
+
 static void parse_ble_read_supported_states_response(
     BT_HDR* response, uint8_t* supported_states, size_t supported_states_size) {
   uint8_t* stream =
@@ -258,6 +273,7 @@ static const hci_packet_parser_t interface = {
     parse_read_local_extended_features_response,
     parse_ble_read_white_list_size_response,
     parse_ble_read_buffer_size_response,
+    parse_ble_read_buffer_size_v2_response,
     parse_ble_read_supported_states_response,
     parse_ble_read_local_supported_features_response,
     parse_ble_read_resolving_list_size_response,
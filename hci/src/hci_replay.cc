@@ -0,0 +1,365 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_hci_replay"
+
+#include "hci_replay.h"
+
+#include <arpa/inet.h>
+#include <base/logging.h>
+#include <endian.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "buffer_allocator.h"
+#include "hci/include/btsnoop_net.h"
+#include "hcidefs.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/thread.h"
+
+// How long the replay waits for the stack to send a packet of the log
+#define HCI_REPLAY_RESPONSE_TIMEOUT_MS 2000
+// The packets sent by the stack that the replay has not reached in the log,
+// the oldest ones are forgotten beyond it
+#define HCI_REPLAY_MAX_HOST_PACKETS 256
+
+#define HCI_REPLAY_COMMAND 1
+#define HCI_REPLAY_ACL 2
+#define HCI_REPLAY_SCO 3
+#define HCI_REPLAY_EVENT 4
+#define HCI_REPLAY_NUM_TYPES 5
+
+#define HCI_REPLAY_ACL_HANDLE_MASK 0x0FFF
+
+using Clock = std::chrono::steady_clock;
+
+typedef struct {
+  uint64_t timestamp_us;
+  bool received;  // Sent by the controller
+  uint8_t type;   // The HCI packet type
+  std::vector<uint8_t> data;
+} record_t;
+
+// A packet sent by the stack, keyed by its opcode or its ACL handle
+typedef struct {
+  uint8_t type;
+  uint16_t key;
+  Clock::time_point time;
+} host_packet_t;
+
+typedef struct {
+  uint32_t fed;        // Packets fed to the stack
+  uint32_t responses;  // Packets of the log the stack sent after one
+  uint64_t total_us;   // Time the stack took to send them
+  uint64_t max_us;
+} type_stats_t;
+
+typedef enum { kReady, kTimeout, kStopping } wait_result_t;
+
+static const char* const type_names[HCI_REPLAY_NUM_TYPES] = {
+    NULL, "Commands", "ACL", "SCO", "Events"};
+
+static std::vector<record_t> records;
+static hci_replay_dispatch_cb dispatch;
+static uint32_t speed;
+static thread_t* replay_thread;
+
+// Guards everything below
+static std::mutex replay_mutex;
+static std::condition_variable replay_cond;
+static bool stopping;
+static std::deque<host_packet_t> host_packets;
+// The commands of the log the stack has not sent yet, by opcode
+static std::map<uint16_t, uint32_t> commands_left;
+// The commands sent by the stack that are not in the log
+static std::deque<uint16_t> unknown_commands;
+static type_stats_t stats[HCI_REPLAY_NUM_TYPES];
+static uint32_t records_skipped;
+static uint32_t timeouts;
+static uint32_t unknown_answered;
+
+static void replay_run(void* context);
+
+static uint16_t packet_key(uint8_t type, const uint8_t* data) {
+  uint16_t key = data[0] | (data[1] << 8);
+  return (type == HCI_REPLAY_ACL) ? (key & HCI_REPLAY_ACL_HANDLE_MASK) : key;
+}
+
+static bool load_records(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to open '%s': %s", __func__, path,
+              strerror(errno));
+    return false;
+  }
+
+  char file_header[16];
+  if (fread(file_header, sizeof(file_header), 1, fp) != 1 ||
+      memcmp(file_header, "btsnoop", 8) != 0) {
+    LOG_ERROR(LOG_TAG, "%s '%s' is not a btsnoop log", __func__, path);
+    fclose(fp);
+    return false;
+  }
+
+  // The header of a record ends with the first octet of the packet, its type
+  btsnoop_header_t header;
+  while (fread(&header, sizeof(header), 1, fp) == 1) {
+    uint32_t captured = ntohl(header.length_captured);
+    if (captured == 0) break;
+
+    record_t record;
+    record.timestamp_us = be64toh(header.timestamp);
+    record.received = (ntohl(header.flags) & 0x01) != 0;
+    record.type = header.type;
+    record.data.resize(captured - 1);
+    if (captured > 1 &&
+        fread(record.data.data(), record.data.size(), 1, fp) != 1)
+      break;
+
+    // The packets truncated by the capture filter cannot be fed again
+    if (record.type < HCI_REPLAY_COMMAND || record.type > HCI_REPLAY_EVENT ||
+        record.data.size() < 2 ||
+        (record.received && captured != ntohl(header.length_original))) {
+      records_skipped++;
+      continue;
+    }
+
+    if (!record.received && record.type == HCI_REPLAY_COMMAND)
+      commands_left[packet_key(record.type, record.data.data())]++;
+    records.push_back(std::move(record));
+  }
+
+  fclose(fp);
+  LOG_INFO(LOG_TAG, "%s %zu packets loaded from '%s', %u skipped", __func__,
+           records.size(), path, records_skipped);
+  return true;
+}
+
+bool hci_replay_open(const char* path, uint32_t speed_up,
+                     hci_replay_dispatch_cb dispatch_cb) {
+  CHECK(replay_thread == NULL);
+  CHECK(dispatch_cb != NULL);
+
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    stopping = false;
+    host_packets.clear();
+    commands_left.clear();
+    unknown_commands.clear();
+    memset(stats, 0, sizeof(stats));
+    records_skipped = 0;
+    timeouts = 0;
+    unknown_answered = 0;
+    records.clear();
+    if (!load_records(path)) return false;
+  }
+
+  dispatch = dispatch_cb;
+  speed = speed_up;
+  replay_thread = thread_new("hci_replay");
+  if (replay_thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the replay thread", __func__);
+    return false;
+  }
+  thread_post(replay_thread, replay_run, NULL);
+  return true;
+}
+
+void hci_replay_close() {
+  if (replay_thread == NULL) return;
+
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    stopping = true;
+  }
+  replay_cond.notify_all();
+  thread_free(replay_thread);
+  replay_thread = NULL;
+
+  hci_replay_debug_dump(STDERR_FILENO);
+  records.clear();
+}
+
+void hci_replay_transmit(const BT_HDR* packet, uint8_t type) {
+  if (type == HCI_REPLAY_SCO || packet->len < 2) return;
+
+  uint16_t key = packet_key(type, packet->data + packet->offset);
+  {
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    if (type == HCI_REPLAY_COMMAND) {
+      auto it = commands_left.find(key);
+      if (it == commands_left.end() || it->second == 0) {
+        unknown_commands.push_back(key);
+        replay_cond.notify_all();
+        return;
+      }
+      it->second--;
+    }
+
+    if (host_packets.size() == HCI_REPLAY_MAX_HOST_PACKETS)
+      host_packets.pop_front();
+    host_packets.push_back({type, key, Clock::now()});
+  }
+  replay_cond.notify_all();
+}
+
+void hci_replay_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(replay_mutex);
+
+  dprintf(fd, "\nHCI Replay:\n");
+  dprintf(fd, "  Packets in the log: %zu, %u skipped\n", records.size(),
+          records_skipped);
+  dprintf(fd, "  Packets the stack did not send in time: %u\n", timeouts);
+  dprintf(fd, "  Commands not in the log: %u\n", unknown_answered);
+  for (int type = HCI_REPLAY_ACL; type < HCI_REPLAY_NUM_TYPES; type++) {
+    const type_stats_t& s = stats[type];
+    dprintf(fd, "  %s: %u fed, %u responses", type_names[type], s.fed,
+            s.responses);
+    if (s.responses > 0)
+      dprintf(fd, " after %" PRIu64 " us on average, %" PRIu64 " us at most",
+              s.total_us / s.responses, s.max_us);
+    dprintf(fd, "\n");
+  }
+}
+
+static void feed(uint8_t type, const uint8_t* data, size_t length) {
+  BT_HDR* packet = static_cast<BT_HDR*>(
+      buffer_allocator_get_interface()->alloc(BT_HDR_SIZE + length));
+  packet->offset = 0;
+  packet->layer_specific = 0;
+  packet->len = length;
+  memcpy(packet->data, data, length);
+  dispatch(packet, type);
+}
+
+// Answers the commands that are not in the log, without holding |lock|
+static void answer_unknown_commands(std::unique_lock<std::mutex>& lock) {
+  while (!unknown_commands.empty()) {
+    uint16_t opcode = unknown_commands.front();
+    unknown_commands.pop_front();
+    unknown_answered++;
+
+    lock.unlock();
+    uint8_t event[] = {HCI_COMMAND_COMPLETE_EVT,
+                       4,
+                       1,
+                       (uint8_t)opcode,
+                       (uint8_t)(opcode >> 8),
+                       HCI_ERR_ILLEGAL_COMMAND};
+    feed(HCI_REPLAY_EVENT, event, sizeof(event));
+    lock.lock();
+  }
+}
+
+// Waits until |due|
+static wait_result_t wait_until(Clock::time_point due) {
+  std::unique_lock<std::mutex> lock(replay_mutex);
+  while (true) {
+    answer_unknown_commands(lock);
+    if (stopping) return kStopping;
+    if (Clock::now() >= due) return kReady;
+    replay_cond.wait_until(lock, due);
+  }
+}
+
+// Waits for the stack to send the packet of |record|, and returns the time
+// it did in |sent|
+static wait_result_t wait_for_host(const record_t& record,
+                                   Clock::time_point* sent) {
+  uint16_t key = packet_key(record.type, record.data.data());
+  Clock::time_point deadline =
+      Clock::now() +
+      std::chrono::milliseconds(HCI_REPLAY_RESPONSE_TIMEOUT_MS);
+
+  std::unique_lock<std::mutex> lock(replay_mutex);
+  while (true) {
+    answer_unknown_commands(lock);
+    if (stopping) return kStopping;
+
+    for (auto it = host_packets.begin(); it != host_packets.end(); ++it) {
+      if (it->type == record.type && it->key == key) {
+        *sent = it->time;
+        host_packets.erase(it);
+        return kReady;
+      }
+    }
+
+    if (Clock::now() >= deadline) {
+      timeouts++;
+      // Not sent in time, as if it had been
+      if (record.type == HCI_REPLAY_COMMAND) commands_left[key]--;
+      return kTimeout;
+    }
+    replay_cond.wait_until(lock, deadline);
+  }
+}
+
+static void replay_run(UNUSED_ATTR void* context) {
+  Clock::time_point start = Clock::now();
+  uint64_t first_us = records.empty() ? 0 : records.front().timestamp_us;
+  uint8_t fed_type = 0;
+  Clock::time_point fed_time;
+
+  for (const record_t& record : records) {
+    if (record.received) {
+      Clock::time_point due = start;
+      if (speed != 0)
+        due += std::chrono::microseconds(
+            (record.timestamp_us - first_us) / speed);
+      if (wait_until(due) == kStopping) return;
+
+      feed(record.type, record.data.data(), record.data.size());
+      fed_type = record.type;
+      fed_time = Clock::now();
+      std::lock_guard<std::mutex> lock(replay_mutex);
+      stats[fed_type].fed++;
+      continue;
+    }
+
+    // The stack sends its SCO packets at its own pace
+    if (record.type == HCI_REPLAY_SCO) continue;
+
+    Clock::time_point sent;
+    wait_result_t result = wait_for_host(record, &sent);
+    if (result == kStopping) return;
+    if (result == kTimeout || fed_type == 0 || sent < fed_time) continue;
+
+    // The stack answered the last packet it was fed
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      sent - fed_time)
+                      .count();
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    type_stats_t& s = stats[fed_type];
+    s.responses++;
+    s.total_us += us;
+    if (us > s.max_us) s.max_us = us;
+  }
+
+  LOG_INFO(LOG_TAG, "%s end of the log", __func__);
+}
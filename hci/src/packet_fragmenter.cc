@@ -22,12 +22,12 @@
 
 #include <base/logging.h>
 #include <string.h>
-#include <unordered_map>
 
 #include "bt_target.h"
 #include "buffer_allocator.h"
 #include "device/include/controller.h"
 #include "hci_internals.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 
@@ -41,19 +41,97 @@
 #define CONTINUATION_PACKET_BOUNDARY 1
 #define L2CAP_HEADER_SIZE 4
 
+// The packet boundary flags of the ISO data packets (Volume 4, Part E, 5.4.5)
+#define APPLY_ISO_BOUNDARY_FLAG(handle, flag) \
+  (((handle)&0xCFFF) | ((flag) << 12))
+#define ISO_FIRST_FRAGMENT 0
+#define ISO_CONTINUATION_FRAGMENT 1
+#define ISO_COMPLETE_SDU 2
+#define ISO_LAST_FRAGMENT 3
+#define ISO_TIME_STAMP_FLAG 0x4000
+#define ISO_DATA_LOAD_LENGTH_MASK 0x3FFF
+#define ISO_SDU_LENGTH_MASK 0x0FFF
+// The packet sequence number and the SDU length, and the time stamp when
+// flagged, ahead of the SDU in the first fragment
+#define ISO_DATA_LOAD_HEADER_SIZE 4
+#define ISO_TIME_STAMP_SIZE 4
+
 // Our interface and callbacks
 
 static const allocator_t* buffer_allocator;
 static const controller_t* controller;
 static const packet_fragmenter_callbacks_t* callbacks;
 
-static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
+// The packets being reassembled, indexed by handle. Indexing a flat array on
+// each inbound ACL packet is cheaper than a hash map lookup.
+static BT_HDR* partial_packets[HANDLE_MASK + 1];
+
+// The ISO SDUs being reassembled, indexed by the CIS or BIS handle.
+static BT_HDR* partial_iso_packets[HANDLE_MASK + 1];
 
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  for (BT_HDR*& partial_packet : partial_packets) {
+    if (partial_packet != NULL) {
+      buffer_allocator->free(partial_packet);
+      partial_packet = NULL;
+    }
+  }
+  for (BT_HDR*& partial_packet : partial_iso_packets) {
+    if (partial_packet != NULL) {
+      buffer_allocator->free(partial_packet);
+      partial_packet = NULL;
+    }
+  }
+}
+
+// Splits an ISO SDU sent whole into the ISO data packets the controller
+// buffers: the first fragment keeps the time stamp and the data load header,
+// the others only carry the rest of the SDU.
+static void fragment_iso_and_dispatch(BT_HDR* packet) {
+  uint16_t max_data_size = controller->get_iso_data_size();
+  uint16_t max_packet_size = max_data_size + HCI_ISO_PREAMBLE_SIZE;
+  uint16_t remaining_length = packet->len;
+
+  if (max_data_size == 0 || remaining_length <= max_packet_size) {
+    callbacks->fragmented(packet, true);
+    return;
+  }
+
+  uint8_t* stream = packet->data + packet->offset;
+  uint16_t handle;
+  STREAM_TO_UINT16(handle, stream);
+  uint16_t continuation_handle = handle & ~ISO_TIME_STAMP_FLAG;
+
+  stream = packet->data + packet->offset;
+  UINT16_TO_STREAM(stream, APPLY_ISO_BOUNDARY_FLAG(handle, ISO_FIRST_FRAGMENT));
+
+  while (remaining_length > max_packet_size) {
+    stream = packet->data + packet->offset;
+    STREAM_SKIP_UINT16(stream);
+    UINT16_TO_STREAM(stream, max_data_size);
+
+    packet->len = max_packet_size;
+    callbacks->fragmented(packet, false);
+
+    packet->offset += max_data_size;
+    remaining_length -= max_data_size;
+    packet->len = remaining_length;
+
+    // Write the ISO header for the next fragment
+    uint8_t flag = ISO_LAST_FRAGMENT;
+    if (remaining_length > max_packet_size) flag = ISO_CONTINUATION_FRAGMENT;
+    stream = packet->data + packet->offset;
+    UINT16_TO_STREAM(stream,
+                     APPLY_ISO_BOUNDARY_FLAG(continuation_handle, flag));
+    UINT16_TO_STREAM(stream, remaining_length - HCI_ISO_PREAMBLE_SIZE);
+  }
+
+  callbacks->fragmented(packet, true);
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -61,7 +139,12 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   uint16_t event = packet->event & MSG_EVT_MASK;
   uint8_t* stream = packet->data + packet->offset;
 
-  // We only fragment ACL packets
+  if (event == MSG_STACK_TO_HC_HCI_ISO) {
+    fragment_iso_and_dispatch(packet);
+    return;
+  }
+
+  // We only fragment ACL and ISO packets
   if (event != MSG_STACK_TO_HC_HCI_ACL) {
     callbacks->fragmented(packet, true);
     return;
@@ -117,7 +200,130 @@ static bool check_uint16_overflow(uint16_t a, uint16_t b) {
   return (UINT16_MAX - a) < b;
 }
 
+// Puts the fragments of an ISO SDU back together, dispatching it as a single
+// ISO data packet holding the complete SDU. The SDUs whose fragments do not
+// add up to their length are dropped, they would be played out of time.
+static void reassemble_iso_and_dispatch(BT_HDR* packet) {
+  uint8_t* stream = packet->data;
+  uint16_t handle;
+  uint16_t iso_length;
+
+  STREAM_TO_UINT16(handle, stream);
+  STREAM_TO_UINT16(iso_length, stream);
+  iso_length &= ISO_DATA_LOAD_LENGTH_MASK;
+
+  if (iso_length != packet->len - HCI_ISO_PREAMBLE_SIZE) {
+    LOG_WARN(LOG_TAG, "%s ISO data load length %d, packet length %d. Dropping.",
+             __func__, iso_length, packet->len);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  uint8_t boundary_flag = GET_BOUNDARY_FLAG(handle);
+  bool has_time_stamp = (handle & ISO_TIME_STAMP_FLAG) != 0;
+  handle = handle & HANDLE_MASK;
+  BT_HDR*& partial_packet = partial_iso_packets[handle];
+
+  if (boundary_flag == ISO_COMPLETE_SDU ||
+      boundary_flag == ISO_FIRST_FRAGMENT) {
+    if (partial_packet != NULL) {
+      LOG_WARN(LOG_TAG,
+               "%s found unfinished SDU for handle 0x%x with new SDU. "
+               "Dropping old.",
+               __func__, handle);
+      buffer_allocator->free(partial_packet);
+      partial_packet = NULL;
+    }
+
+    if (boundary_flag == ISO_COMPLETE_SDU) {
+      callbacks->reassembled(packet);
+      return;
+    }
+
+    uint16_t header_size = ISO_DATA_LOAD_HEADER_SIZE;
+    if (has_time_stamp) header_size += ISO_TIME_STAMP_SIZE;
+    if (iso_length < header_size) {
+      LOG_WARN(LOG_TAG, "%s ISO fragment too small (%d < %d). Dropping it.",
+               __func__, iso_length, header_size);
+      buffer_allocator->free(packet);
+      return;
+    }
+
+    uint16_t sdu_length;
+    stream += header_size - sizeof(sdu_length);
+    STREAM_TO_UINT16(sdu_length, stream);
+    sdu_length &= ISO_SDU_LENGTH_MASK;
+
+    uint16_t full_length = HCI_ISO_PREAMBLE_SIZE + header_size + sdu_length;
+    if (full_length <= packet->len ||
+        full_length + sizeof(BT_HDR) > BT_DEFAULT_BUFFER_SIZE) {
+      LOG_WARN(LOG_TAG, "%s ISO SDU of invalid length (%d). Dropping it.",
+               __func__, sdu_length);
+      buffer_allocator->free(packet);
+      return;
+    }
+
+    partial_packet =
+        (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+    partial_packet->event = packet->event;
+    partial_packet->layer_specific = packet->layer_specific;
+    FLOW_TRACE_COPY(partial_packet, packet);
+    partial_packet->len = full_length;
+    partial_packet->offset = packet->len;
+    memcpy(partial_packet->data, packet->data, packet->len);
+
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  if (partial_packet == NULL) {
+    LOG_WARN(LOG_TAG, "%s got continuation for unknown SDU. Dropping it.",
+             __func__);
+    buffer_allocator->free(packet);
+    return;
+  }
+
+  uint16_t projected_offset = partial_packet->offset + iso_length;
+  if (projected_offset > partial_packet->len ||
+      (boundary_flag == ISO_LAST_FRAGMENT &&
+       projected_offset != partial_packet->len)) {
+    LOG_WARN(LOG_TAG,
+             "%s fragments of %d octets for an ISO packet of %d. Dropping SDU.",
+             __func__, projected_offset, partial_packet->len);
+    buffer_allocator->free(packet);
+    buffer_allocator->free(partial_packet);
+    partial_packet = NULL;
+    return;
+  }
+
+  memcpy(partial_packet->data + partial_packet->offset,
+         packet->data + HCI_ISO_PREAMBLE_SIZE, iso_length);
+  buffer_allocator->free(packet);
+  partial_packet->offset = projected_offset;
+
+  if (boundary_flag == ISO_LAST_FRAGMENT) {
+    // The SDU is now dispatched as a complete one
+    uint16_t first_handle;
+    stream = partial_packet->data;
+    STREAM_TO_UINT16(first_handle, stream);
+    stream = partial_packet->data;
+    UINT16_TO_STREAM(stream,
+                     APPLY_ISO_BOUNDARY_FLAG(first_handle, ISO_COMPLETE_SDU));
+    UINT16_TO_STREAM(stream, partial_packet->len - HCI_ISO_PREAMBLE_SIZE);
+
+    BT_HDR* complete_packet = partial_packet;
+    partial_packet = NULL;
+    complete_packet->offset = 0;
+    callbacks->reassembled(complete_packet);
+  }
+}
+
 static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
+  if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ISO) {
+    reassemble_iso_and_dispatch(packet);
+    return;
+  }
+
   if ((packet->event & MSG_EVT_MASK) == MSG_HC_TO_STACK_HCI_ACL) {
     uint8_t* stream = packet->data;
     uint16_t handle;
@@ -134,16 +340,14 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
     handle = handle & HANDLE_MASK;
 
     if (boundary_flag == START_PACKET_BOUNDARY) {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter != partial_packets.end()) {
+      if (partial_packets[handle] != NULL) {
         LOG_WARN(LOG_TAG,
                  "%s found unfinished packet for handle with start packet. "
                  "Dropping old.",
                  __func__);
 
-        BT_HDR* hdl = map_iter->second;
-        partial_packets.erase(map_iter);
-        buffer_allocator->free(hdl);
+        buffer_allocator->free(partial_packets[handle]);
+        partial_packets[handle] = NULL;
       }
 
       if (acl_length < L2CAP_HEADER_SIZE) {
@@ -180,6 +384,7 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       BT_HDR* partial_packet =
           (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
       partial_packet->event = packet->event;
+      FLOW_TRACE_COPY(partial_packet, packet);
       partial_packet->len = full_length;
       partial_packet->offset = packet->len;
 
@@ -195,15 +400,14 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
     } else {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter == partial_packets.end()) {
+      BT_HDR* partial_packet = partial_packets[handle];
+      if (partial_packet == NULL) {
         LOG_WARN(LOG_TAG,
                  "%s got continuation for unknown packet. Dropping it.",
                  __func__);
         buffer_allocator->free(packet);
         return;
       }
-      BT_HDR* partial_packet = map_iter->second;
 
       packet->offset = HCI_ACL_PREAMBLE_SIZE;
       uint16_t projected_offset =
@@ -226,7 +430,7 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
       partial_packet->offset = projected_offset;
 
       if (partial_packet->offset == partial_packet->len) {
-        partial_packets.erase(handle);
+        partial_packets[handle] = NULL;
         partial_packet->offset = 0;
         callbacks->reassembled(partial_packet);
       }
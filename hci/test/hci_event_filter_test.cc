@@ -0,0 +1,184 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "hci_event_filter.h"
+#include "hcidefs.h"
+#include "osi/include/allocator.h"
+
+static const bt_event_mask_t CLASSIC_MASK = {HCI_DUMO_EVENT_MASK_EXT};
+static const bt_event_mask_t LE_MASK = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x1E, 0x7f}};
+
+static std::vector<uint16_t> sent_opcodes;
+static std::vector<uint64_t> sent_masks;
+
+static void transmit_command(BT_HDR* command,
+                             UNUSED_ATTR command_complete_cb complete_callback,
+                             UNUSED_ATTR command_status_cb status_cb,
+                             UNUSED_ATTR void* context) {
+  uint8_t* stream = command->data + command->offset;
+  sent_opcodes.push_back(stream[0] | (stream[1] << 8));
+  uint64_t mask = 0;
+  for (int i = 7; i >= 0; i--) mask = (mask << 8) | stream[3 + i];
+  sent_masks.push_back(mask);
+  osi_free(command);
+}
+
+static const hci_t fake_hci = {NULL, NULL, transmit_command, NULL, NULL};
+
+static BT_HDR* make_command(uint16_t opcode, const bt_event_mask_t* mask) {
+  BT_HDR* command = (BT_HDR*)osi_calloc(sizeof(BT_HDR) + 11);
+  uint8_t* stream = command->data;
+  command->len = 11;
+  UINT16_TO_STREAM(stream, opcode);
+  UINT8_TO_STREAM(stream, 8);
+  ARRAY8_TO_STREAM(stream, mask->as_array);
+  return command;
+}
+
+static BT_HDR* make_set_event_mask(const bt_event_mask_t* mask) {
+  return make_command(HCI_SET_EVENT_MASK, mask);
+}
+
+static BT_HDR* make_ble_set_event_mask(const bt_event_mask_t* mask) {
+  return make_command(HCI_BLE_SET_EVENT_MASK, mask);
+}
+
+static hci_packet_factory_t fake_packet_factory;
+
+static uint64_t mask_bits(const bt_event_mask_t& mask) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; i++) bits = (bits << 8) | mask.as_array[i];
+  return bits;
+}
+
+// Returns true if the event |event_code|, of LE subevent |le_subevent_code|
+// for the LE meta events, is dropped
+static bool drops(uint8_t event_code, uint8_t le_subevent_code = 0) {
+  BT_HDR* packet = (BT_HDR*)osi_calloc(sizeof(BT_HDR) + 3);
+  packet->len = 3;
+  packet->data[0] = event_code;
+  packet->data[1] = 1;
+  packet->data[2] = le_subevent_code;
+  bool dropped = hci_event_filter_drops(packet);
+  osi_free(packet);
+  return dropped;
+}
+
+class HciEventFilterTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    sent_opcodes.clear();
+    sent_masks.clear();
+    fake_packet_factory.make_set_event_mask = make_set_event_mask;
+    fake_packet_factory.make_ble_set_event_mask = make_ble_set_event_mask;
+    hci_event_filter_start_up(&fake_hci, &fake_packet_factory, &CLASSIC_MASK,
+                              &LE_MASK);
+  }
+
+  void TearDown() override {
+    hci_event_filter_shut_down();
+    hci_event_filter_subscribe(NULL, 0, NULL, 0);
+    AllocationTestHarness::TearDown();
+  }
+};
+
+TEST_F(HciEventFilterTest, test_startup_masks_leave_out_inactive_features) {
+  uint64_t classic_mask = mask_bits(hci_event_filter_get_classic_mask());
+  EXPECT_EQ(mask_bits(CLASSIC_MASK) & ~(1ULL << 1 | 1ULL << 33 | 1ULL << 38),
+            classic_mask);
+
+  uint64_t le_mask = mask_bits(hci_event_filter_get_le_mask());
+  EXPECT_EQ(mask_bits(LE_MASK) & ~(1ULL << 1 | 1ULL << 10 | 1ULL << 12),
+            le_mask);
+  EXPECT_TRUE(sent_opcodes.empty());
+}
+
+TEST_F(HciEventFilterTest, test_feature_updates_mask_once) {
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, true);
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, true);
+  ASSERT_EQ(1u, sent_opcodes.size());
+  EXPECT_EQ(HCI_BLE_SET_EVENT_MASK, sent_opcodes[0]);
+  EXPECT_EQ(mask_bits(LE_MASK), sent_masks[0]);
+
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, false);
+  ASSERT_EQ(2u, sent_opcodes.size());
+  EXPECT_EQ(mask_bits(hci_event_filter_get_le_mask()), sent_masks[1]);
+}
+
+TEST_F(HciEventFilterTest, test_features_sharing_events) {
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, true);
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_PERIODIC_INQUIRY,
+                                      true);
+  ASSERT_EQ(1u, sent_opcodes.size());
+  EXPECT_EQ(HCI_SET_EVENT_MASK, sent_opcodes[0]);
+  EXPECT_EQ(mask_bits(CLASSIC_MASK), sent_masks[0]);
+
+  // The inquiry results are still wanted by the periodic inquiry
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, false);
+  EXPECT_EQ(1u, sent_opcodes.size());
+  EXPECT_FALSE(drops(HCI_INQUIRY_RESULT_EVT));
+
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_PERIODIC_INQUIRY,
+                                      false);
+  EXPECT_EQ(2u, sent_opcodes.size());
+  EXPECT_TRUE(drops(HCI_INQUIRY_RESULT_EVT));
+}
+
+TEST_F(HciEventFilterTest, test_no_update_of_default_mask) {
+  hci_event_filter_start_up(&fake_hci, &fake_packet_factory, NULL, &LE_MASK);
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, true);
+  EXPECT_TRUE(sent_opcodes.empty());
+}
+
+TEST_F(HciEventFilterTest, test_drops_events_of_inactive_features) {
+  EXPECT_TRUE(drops(HCI_INQUIRY_RESULT_EVT));
+  EXPECT_TRUE(drops(HCI_EXTENDED_INQUIRY_RESULT_EVT));
+  EXPECT_TRUE(drops(HCI_BLE_EVENT, HCI_BLE_ADV_PKT_RPT_EVT));
+  EXPECT_FALSE(drops(HCI_BLE_EVENT, HCI_BLE_CONN_COMPLETE_EVT));
+  EXPECT_FALSE(drops(HCI_CONNECTION_COMP_EVT));
+
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, true);
+  EXPECT_FALSE(drops(HCI_BLE_EVENT, HCI_BLE_ADV_PKT_RPT_EVT));
+  EXPECT_FALSE(drops(HCI_BLE_EVENT, HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT));
+  EXPECT_TRUE(drops(HCI_INQUIRY_RESULT_EVT));
+}
+
+TEST_F(HciEventFilterTest, test_drops_unsubscribed_events) {
+  const uint8_t events[] = {HCI_CONNECTION_COMP_EVT, HCI_BLE_EVENT};
+  const uint8_t le_subevents[] = {HCI_BLE_CONN_COMPLETE_EVT};
+  hci_event_filter_subscribe(events, sizeof(events), le_subevents,
+                             sizeof(le_subevents));
+
+  EXPECT_FALSE(drops(HCI_CONNECTION_COMP_EVT));
+  EXPECT_TRUE(drops(HCI_DISCONNECTION_COMP_EVT));
+  EXPECT_FALSE(drops(HCI_BLE_EVENT, HCI_BLE_CONN_COMPLETE_EVT));
+  EXPECT_TRUE(drops(HCI_BLE_EVENT, HCI_BLE_DATA_LENGTH_CHANGE_EVT));
+
+  hci_event_filter_subscribe(NULL, 0, NULL, 0);
+  EXPECT_FALSE(drops(HCI_DISCONNECTION_COMP_EVT));
+}
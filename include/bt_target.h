@@ -128,6 +128,29 @@
 #define BTA_DM_SDP_DB_SIZE 8000
 #endif
 
+/* The number of remote names resolved during the device searches that are
+ * remembered, and for how long, so that the devices found again by the next
+ * searches are not asked their name again. 0 disables the cache. */
+#ifndef BTA_DM_NAME_CACHE_SIZE
+#define BTA_DM_NAME_CACHE_SIZE 16
+#endif
+
+#ifndef BTA_DM_NAME_CACHE_TIMEOUT_MS
+#define BTA_DM_NAME_CACHE_TIMEOUT_MS (10 * 60 * 1000)
+#endif
+
+/* The number of hands-free devices the eSCO codec settings last set up with
+ * are remembered for, so that the next calls to them try those settings
+ * first, and for how long the devices mSBC failed with get CVSD right away.
+ * 0 disables the cache. */
+#ifndef BTA_AG_SCO_CACHE_SIZE
+#define BTA_AG_SCO_CACHE_SIZE 8
+#endif
+
+#ifndef BTA_AG_SCO_FALLBACK_TIMEOUT_MS
+#define BTA_AG_SCO_FALLBACK_TIMEOUT_MS (60 * 60 * 1000)
+#endif
+
 #ifndef HL_INCLUDED
 #define HL_INCLUDED TRUE
 #endif
@@ -140,6 +163,36 @@
 #define BTIF_DM_OOB_TEST TRUE
 #endif
 
+// How long the small writes of the apps to an LE CoC socket may be held, to be
+// sent in a single SDU with the writes following them. The writes are then no
+// longer delivered to the peer one SDU each. 0 sends each write on its own.
+#ifndef BTIF_SOCK_L2CAP_LE_COALESCE_MS
+#define BTIF_SOCK_L2CAP_LE_COALESCE_MS 0
+#endif
+
+// The number of media item attributes cached per AVRCP controller, for the
+// item attributes it asks for again, and how long they are kept. 0 disables
+// the cache.
+#ifndef BTIF_RC_ATTR_CACHE_SIZE
+#define BTIF_RC_ATTR_CACHE_SIZE 512
+#endif
+
+#ifndef BTIF_RC_ATTR_CACHE_TIMEOUT_MS
+#define BTIF_RC_ATTR_CACHE_TIMEOUT_MS 30000
+#endif
+
+// The minimum interval between the AVRCP position and track changed
+// notifications sent to a controller. The changes meanwhile are sent as one,
+// with the last value, once the interval has passed. 0 sends each change as
+// it comes.
+#ifndef BTIF_RC_NOTIF_PLAY_POS_INTERVAL_MS
+#define BTIF_RC_NOTIF_PLAY_POS_INTERVAL_MS 500
+#endif
+
+#ifndef BTIF_RC_NOTIF_TRACK_CHANGE_INTERVAL_MS
+#define BTIF_RC_NOTIF_TRACK_CHANGE_INTERVAL_MS 0
+#endif
+
 // How long to wait before activating sniff mode after entering the
 // idle state for FTS, OPS connections
 #ifndef BTA_FTS_OPS_IDLE_TO_SNIFF_DELAY_MS
@@ -251,6 +304,17 @@
 #define PAN_BUF_MAX 100
 #endif
 
+/* Maximum number of frames held for a PAN connection while its outbound flow
+ * is off. The frames to the other connections keep flowing meanwhile. */
+#ifndef PAN_CONN_HOLD_Q_MAX
+#define PAN_CONN_HOLD_Q_MAX 32
+#endif
+
+/* The number of frames the tap interface queues until they are read. */
+#ifndef PAN_TAP_TXQUEUELEN
+#define PAN_TAP_TXQUEUELEN 1000
+#endif
+
 /* AVCTP buffer size for protocol messages */
 #ifndef AVCT_CMD_BUF_SIZE
 #define AVCT_CMD_BUF_SIZE 288
@@ -316,7 +380,8 @@
 #define BTM_SCO_DATA_SIZE_MAX 240
 #endif
 
-/* The size in bytes of the BTM inquiry database. */
+/* The number of devices kept in the BTM inquiry database, the least recently
+ * used one being replaced once it is full. */
 #ifndef BTM_INQ_DB_SIZE
 #define BTM_INQ_DB_SIZE 40
 #endif
@@ -373,6 +438,16 @@
 #define BTM_MAX_SCO_LINKS 3
 #endif
 
+/* The number of LE isochronous streams, CIS or BIS, and the most a CIG or
+ * a BIG holds. */
+#ifndef BTM_ISO_MAX_STREAMS
+#define BTM_ISO_MAX_STREAMS 8
+#endif
+
+#ifndef BTM_ISO_MAX_GROUP_STREAMS
+#define BTM_ISO_MAX_GROUP_STREAMS 4
+#endif
+
 /* The preferred type of SCO links (2-eSCO, 0-SCO). */
 #ifndef BTM_DEFAULT_SCO_MODE
 #define BTM_DEFAULT_SCO_MODE 2
@@ -383,6 +458,12 @@
 #define BTM_SEC_MAX_DEVICE_RECORDS 100
 #endif
 
+/* The number of addresses and of handles remembered to find the security
+ * records without walking them. */
+#ifndef BTM_SEC_DEV_INDEX_SIZE
+#define BTM_SEC_DEV_INDEX_SIZE (4 * BTM_SEC_MAX_DEVICE_RECORDS)
+#endif
+
 /* The number of security records for services. */
 #ifndef BTM_SEC_MAX_SERVICE_RECORDS
 #define BTM_SEC_MAX_SERVICE_RECORDS 32
@@ -505,18 +586,35 @@
  *
  *****************************************************************************/
 
-/* The maximum number of simultaneous links that L2CAP can support. */
+/* The maximum number of simultaneous links that L2CAP can support. The links
+ * are looked up through hash tables, so the limit can be raised (up to 255,
+ * the ACL indexes of BTM being 8 bits) without slowing down the data path. */
+#ifndef MAX_L2CAP_LINKS
 #ifndef MAX_ACL_CONNECTIONS
 #define MAX_L2CAP_LINKS 7
 #else
 #define MAX_L2CAP_LINKS MAX_ACL_CONNECTIONS
 #endif
+#endif
+
+/* The number of buckets of the tables looking up the L2CAP links by address
+ * and by handle, a power of two. */
+#ifndef L2CAP_LCB_HASH_SIZE
+#define L2CAP_LCB_HASH_SIZE 64
+#endif
 
 /* The maximum number of simultaneous channels that L2CAP can support. */
 #ifndef MAX_L2CAP_CHANNELS
 #define MAX_L2CAP_CHANNELS 16
 #endif
 
+/* The most channels that L2CAP can be given by the capacity profile in
+ * bt_stack.conf, in place of MAX_L2CAP_CHANNELS. The LCID maps of the
+ * profiles are sized for it. */
+#ifndef L2CAP_CHANNELS_LIMIT
+#define L2CAP_CHANNELS_LIMIT 256
+#endif
+
 /* The maximum number of simultaneous applications that can register with L2CAP.
  */
 #ifndef MAX_L2CAP_CLIENTS
@@ -646,6 +744,39 @@
 #define L2CAP_MAX_RX_BUFFER 0x100000
 #endif
 
+/* The initial credits given to the peer of the LE Credit Based channels opened
+ * through GAP. The credits are returned to the peer once half of them are
+ * used, so it does not wait for them. */
+#ifndef L2CAP_LE_COC_INITIAL_CREDIT
+#define L2CAP_LE_COC_INITIAL_CREDIT 32
+#endif
+
+/* The LE links carrying more than this many octets per second, both ways, are
+ * moved to the throughput link parameters: the 2M PHY, the longest data PDUs
+ * and a short connection interval. 0 disables the traffic policy. */
+#ifndef L2CAP_BLE_BULK_OCTETS_PER_SEC
+#define L2CAP_BLE_BULK_OCTETS_PER_SEC 8192
+#endif
+
+/* How often the traffic of the LE links is sampled, and how many samples in a
+ * row below the bulk rate give a link its connection interval back. */
+#ifndef L2CAP_BLE_TRAFFIC_SAMPLE_MS
+#define L2CAP_BLE_TRAFFIC_SAMPLE_MS 1000
+#endif
+
+#ifndef L2CAP_BLE_BULK_IDLE_SAMPLES
+#define L2CAP_BLE_BULK_IDLE_SAMPLES 3
+#endif
+
+/* The connection interval of the LE links carrying bulk traffic, in 1.25 ms */
+#ifndef L2CAP_BLE_BULK_CONN_INT_MIN
+#define L2CAP_BLE_BULK_CONN_INT_MIN 6
+#endif
+
+#ifndef L2CAP_BLE_BULK_CONN_INT_MAX
+#define L2CAP_BLE_BULK_CONN_INT_MAX 12
+#endif
+
 /******************************************************************************
  *
  * BLE
@@ -690,6 +821,42 @@
 #define BLE_MAX_L2CAP_CLIENTS 15
 #endif
 
+/* The number of devices the observer keeps track of to suppress their
+ * duplicate advertising reports, which are only delivered when their data
+ * changes, their RSSI moves by more than BTM_BLE_SCAN_DEDUP_RSSI_THRESHOLD dB
+ * or BTM_BLE_SCAN_DEDUP_AGING_MS have elapsed since the last one delivered.
+ * 0 delivers all the reports. */
+#ifndef BTM_BLE_SCAN_DEDUP_MAX_DEVICES
+#define BTM_BLE_SCAN_DEDUP_MAX_DEVICES 10240
+#endif
+
+#ifndef BTM_BLE_SCAN_DEDUP_AGING_MS
+#define BTM_BLE_SCAN_DEDUP_AGING_MS 1000
+#endif
+
+#ifndef BTM_BLE_SCAN_DEDUP_RSSI_THRESHOLD
+#define BTM_BLE_SCAN_DEDUP_RSSI_THRESHOLD 5
+#endif
+
+/* The number of private addresses whose resolution by the host, successful
+ * or not, is cached, and for how long. The cache is cleared when the IRKs
+ * change. 0 disables the cache. */
+#ifndef BTM_BLE_RPA_CACHE_SIZE
+#define BTM_BLE_RPA_CACHE_SIZE 256
+#endif
+
+#ifndef BTM_BLE_RPA_CACHE_TIMEOUT_MS
+#define BTM_BLE_RPA_CACHE_TIMEOUT_MS (60 * 1000)
+#endif
+
+/* The size, in octets, of the buffer holding the batch scan reports read from
+ * the controller until the client reads them. The reports are drained from
+ * the controller as soon as it reaches its notification threshold, and the
+ * oldest ones are dropped once the buffer is full. */
+#ifndef BTM_BLE_BATCH_SCAN_HOST_BUFFER_SIZE
+#define BTM_BLE_BATCH_SCAN_HOST_BUFFER_SIZE (64 * 1024)
+#endif
+
 /******************************************************************************
  *
  * ATT/GATT Protocol/Profile Settings
@@ -729,10 +896,26 @@
 #define GATT_MAX_APPS 32 /* note: 2 apps used internally GATT and GAP */
 #endif
 
+/* The maximum number of links GATT can hold, below 255 as the index of a link
+ * is 8 bits in the connection IDs. */
 #ifndef GATT_MAX_PHY_CHANNEL
 #define GATT_MAX_PHY_CHANNEL 7
 #endif
 
+/* The number of buckets of the tables looking up the GATT links by address
+ * and by L2CAP CID, a power of two. */
+#ifndef GATT_TCB_HASH_SIZE
+#define GATT_TCB_HASH_SIZE 64
+#endif
+
+/* The ATT MTU requested by the stack itself as soon as an LE link is up, so
+ * that the peers are not limited to the default MTU until an application asks
+ * for a larger one. 0 disables the request.
+*/
+#ifndef GATT_AUTO_MTU_SIZE
+#define GATT_AUTO_MTU_SIZE GATT_MAX_MTU_SIZE
+#endif
+
 /* Used for conformance testing ONLY */
 #ifndef GATT_CONFORMANCE_TESTING
 #define GATT_CONFORMANCE_TESTING FALSE
@@ -745,6 +928,13 @@
 #define GATT_MAX_BG_CONN_DEV 32
 #endif
 
+/* number of notifications a server connection holds while its ATT channel is
+ * congested, before the new ones are refused
+*/
+#ifndef GATT_MAX_PENDING_NOTIF
+#define GATT_MAX_PENDING_NOTIF 32
+#endif
+
 /******************************************************************************
  *
  * SMP
@@ -773,6 +963,18 @@
 #define SMP_LINK_TOUT_MIN 2
 #endif
 #endif
+
+/* The number of LE Secure Connections key pairs generated ahead of the
+ * pairings. Must be at least 1. */
+#ifndef SMP_KEY_PAIR_POOL_SIZE
+#define SMP_KEY_PAIR_POOL_SIZE 2
+#endif
+
+/* The time after which a key pair of the pool not used is replaced. */
+#ifndef SMP_KEY_PAIR_LIFETIME_MS
+#define SMP_KEY_PAIR_LIFETIME_MS (10 * 60 * 1000)
+#endif
+
 /******************************************************************************
  *
  * SDP
@@ -808,6 +1010,12 @@
 #define SDP_MAX_ATTR_FILTERS 15
 #endif
 
+/* The size, in bytes, of the chunks a growable SDP discovery database takes
+ * when its records do not fit. */
+#ifndef SDP_DB_CHUNK_SIZE
+#define SDP_DB_CHUNK_SIZE 512
+#endif
+
 /* The maximum number of UUID filters supported by SDP databases. */
 #ifndef SDP_MAX_UUID_FILTERS
 #define SDP_MAX_UUID_FILTERS 3
@@ -849,6 +1057,24 @@
 #define SDP_SERVICE_NAME "Service Discovery"
 #endif
 
+/* The number of ServiceSearchAttributeResponse attribute lists the server
+ * keeps for the requests made again, 0 to build each of them anew. */
+#ifndef SDP_SERVER_RSP_CACHE_SIZE
+#define SDP_SERVER_RSP_CACHE_SIZE 4
+#endif
+
+/* The number of service search attribute responses of the bonded devices
+ * kept, and persisted, to answer the same requests made again without
+ * connecting. 0 to always search. */
+#ifndef SDP_CACHE_SIZE
+#define SDP_CACHE_SIZE 32
+#endif
+
+/* The time, in seconds, a cached response is used for. */
+#ifndef SDP_CACHE_TTL_SEC
+#define SDP_CACHE_TTL_SEC (7 * 24 * 60 * 60)
+#endif
+
 /* The security level for BTM. */
 #ifndef SDP_SECURITY_LEVEL
 #define SDP_SECURITY_LEVEL BTM_SEC_NONE
@@ -938,6 +1164,18 @@
 #define PORT_CREDIT_RX_LOW 8
 #endif
 
+/* The maximum number of credits sent to the peer by the ports delivering the
+ * data received to a call-out, as the RFCOMM sockets do. */
+#ifndef PORT_CO_CREDIT_RX_MAX
+#define PORT_CO_CREDIT_RX_MAX 32
+#endif
+
+/* The credit low watermark level of the ports delivering the data received to
+ * a call-out. */
+#ifndef PORT_CO_CREDIT_RX_LOW
+#define PORT_CO_CREDIT_RX_LOW 16
+#endif
+
 /******************************************************************************
  *
  * OBEX
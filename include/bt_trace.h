@@ -138,6 +138,101 @@ static const char BTE_LOGMSG_MODULE[] = "bte_logmsg_module";
  *      BT_TRACE_LEVEL_DEBUG   5        * Debug messages (general)
  *****************************************************************************/
 
+/* The highest trace level compiled in: the traces above it are removed at
+ * compile time, whatever the runtime trace levels. It is set by the
+ * "bt_trace_max_level" GN argument, the BLUETOOTH_TRACE_MAX_LEVEL variable of
+ * the Android build, or bdroid_buildcfg.h. */
+#ifndef BT_TRACE_MAX_LEVEL
+#define BT_TRACE_MAX_LEVEL BT_TRACE_LEVEL_VERBOSE
+#endif
+
+/* The highest trace level compiled in for each layer, which defaults to
+ * BT_TRACE_MAX_LEVEL. A module may set the ceiling of a layer by defining
+ * <layer>_TRACE_MAX_LEVEL before including this file. */
+#ifndef HCI_TRACE_MAX_LEVEL
+#define HCI_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef BTM_TRACE_MAX_LEVEL
+#define BTM_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef L2CAP_TRACE_MAX_LEVEL
+#define L2CAP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef SDP_TRACE_MAX_LEVEL
+#define SDP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef RFCOMM_TRACE_MAX_LEVEL
+#define RFCOMM_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef GAP_TRACE_MAX_LEVEL
+#define GAP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef HIDH_TRACE_MAX_LEVEL
+#define HIDH_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef HIDD_TRACE_MAX_LEVEL
+#define HIDD_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef BNEP_TRACE_MAX_LEVEL
+#define BNEP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef PAN_TRACE_MAX_LEVEL
+#define PAN_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef A2DP_TRACE_MAX_LEVEL
+#define A2DP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef AVDT_TRACE_MAX_LEVEL
+#define AVDT_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef AVCT_TRACE_MAX_LEVEL
+#define AVCT_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef AVRC_TRACE_MAX_LEVEL
+#define AVRC_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef MCA_TRACE_MAX_LEVEL
+#define MCA_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef GATT_TRACE_MAX_LEVEL
+#define GATT_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef SMP_TRACE_MAX_LEVEL
+#define SMP_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef BTIF_TRACE_MAX_LEVEL
+#define BTIF_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+#ifndef APPL_TRACE_MAX_LEVEL
+#define APPL_TRACE_MAX_LEVEL BT_TRACE_MAX_LEVEL
+#endif
+
+/* True if the traces of BT_TRACE_LEVEL_<level> of |layer| are enabled by
+ * |trace_level|. The traces above the ceiling of the layer are a constant
+ * false condition, so that neither the trace level nor the arguments of the
+ * trace are evaluated. */
+#define BT_TRACE_ON(layer, trace_level, level)          \
+  (BT_TRACE_LEVEL_##level <= layer##_TRACE_MAX_LEVEL && \
+   (trace_level) >= BT_TRACE_LEVEL_##level)
+
 /* Core Stack default trace levels */
 #ifndef HCI_INITIAL_TRACE_LEVEL
 #define HCI_INITIAL_TRACE_LEVEL BT_TRACE_LEVEL_WARNING
@@ -213,454 +308,454 @@ static const char BTE_LOGMSG_MODULE[] = "bte_logmsg_module";
 /* Define tracing for the HCI unit */
 #define HCI_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (btu_trace_level >= BT_TRACE_LEVEL_ERROR)                  \
+    if (BT_TRACE_ON(HCI, btu_trace_level, ERROR))                 \
       BT_TRACE(TRACE_LAYER_HCI, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define HCI_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (btu_trace_level >= BT_TRACE_LEVEL_WARNING)                  \
+    if (BT_TRACE_ON(HCI, btu_trace_level, WARNING))                 \
       BT_TRACE(TRACE_LAYER_HCI, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define HCI_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (btu_trace_level >= BT_TRACE_LEVEL_EVENT)                  \
+    if (BT_TRACE_ON(HCI, btu_trace_level, EVENT))                 \
       BT_TRACE(TRACE_LAYER_HCI, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define HCI_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (btu_trace_level >= BT_TRACE_LEVEL_DEBUG)                  \
+    if (BT_TRACE_ON(HCI, btu_trace_level, DEBUG))                 \
       BT_TRACE(TRACE_LAYER_HCI, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for BTM */
 #define BTM_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (btm_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(BTM, btm_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_BTM, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define BTM_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (btm_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(BTM, btm_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_BTM, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define BTM_TRACE_API(...)                                      \
   {                                                             \
-    if (btm_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(BTM, btm_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_BTM, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define BTM_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (btm_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(BTM, btm_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_BTM, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define BTM_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (btm_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(BTM, btm_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_BTM, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the L2CAP unit */
 #define L2CAP_TRACE_ERROR(...)                                      \
   {                                                                 \
-    if (l2cb.l2cap_trace_level >= BT_TRACE_LEVEL_ERROR)             \
+    if (BT_TRACE_ON(L2CAP, l2cb.l2cap_trace_level, ERROR))          \
       BT_TRACE(TRACE_LAYER_L2CAP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define L2CAP_TRACE_WARNING(...)                                      \
   {                                                                   \
-    if (l2cb.l2cap_trace_level >= BT_TRACE_LEVEL_WARNING)             \
+    if (BT_TRACE_ON(L2CAP, l2cb.l2cap_trace_level, WARNING))          \
       BT_TRACE(TRACE_LAYER_L2CAP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define L2CAP_TRACE_API(...)                                      \
   {                                                               \
-    if (l2cb.l2cap_trace_level >= BT_TRACE_LEVEL_API)             \
+    if (BT_TRACE_ON(L2CAP, l2cb.l2cap_trace_level, API))          \
       BT_TRACE(TRACE_LAYER_L2CAP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define L2CAP_TRACE_EVENT(...)                                      \
   {                                                                 \
-    if (l2cb.l2cap_trace_level >= BT_TRACE_LEVEL_EVENT)             \
+    if (BT_TRACE_ON(L2CAP, l2cb.l2cap_trace_level, EVENT))          \
       BT_TRACE(TRACE_LAYER_L2CAP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define L2CAP_TRACE_DEBUG(...)                                      \
   {                                                                 \
-    if (l2cb.l2cap_trace_level >= BT_TRACE_LEVEL_DEBUG)             \
+    if (BT_TRACE_ON(L2CAP, l2cb.l2cap_trace_level, DEBUG))          \
       BT_TRACE(TRACE_LAYER_L2CAP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the SDP unit */
 #define SDP_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (sdp_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(SDP, sdp_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_SDP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define SDP_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (sdp_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(SDP, sdp_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_SDP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define SDP_TRACE_API(...)                                      \
   {                                                             \
-    if (sdp_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(SDP, sdp_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_SDP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define SDP_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (sdp_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(SDP, sdp_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_SDP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define SDP_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (sdp_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(SDP, sdp_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_SDP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the RFCOMM unit */
 #define RFCOMM_TRACE_ERROR(...)                                      \
   {                                                                  \
-    if (rfc_cb.trace_level >= BT_TRACE_LEVEL_ERROR)                  \
+    if (BT_TRACE_ON(RFCOMM, rfc_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_RFCOMM, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define RFCOMM_TRACE_WARNING(...)                                      \
   {                                                                    \
-    if (rfc_cb.trace_level >= BT_TRACE_LEVEL_WARNING)                  \
+    if (BT_TRACE_ON(RFCOMM, rfc_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_RFCOMM, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define RFCOMM_TRACE_API(...)                                      \
   {                                                                \
-    if (rfc_cb.trace_level >= BT_TRACE_LEVEL_API)                  \
+    if (BT_TRACE_ON(RFCOMM, rfc_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_RFCOMM, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define RFCOMM_TRACE_EVENT(...)                                      \
   {                                                                  \
-    if (rfc_cb.trace_level >= BT_TRACE_LEVEL_EVENT)                  \
+    if (BT_TRACE_ON(RFCOMM, rfc_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_RFCOMM, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define RFCOMM_TRACE_DEBUG(...)                                      \
   {                                                                  \
-    if (rfc_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)                  \
+    if (BT_TRACE_ON(RFCOMM, rfc_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_RFCOMM, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Generic Access Profile traces */
 #define GAP_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (gap_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(GAP, gap_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_GAP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define GAP_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (gap_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(GAP, gap_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_GAP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define GAP_TRACE_API(...)                                      \
   {                                                             \
-    if (gap_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(GAP, gap_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_GAP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define GAP_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (gap_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(GAP, gap_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_GAP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 
 /* define traces for HID Host */
 #define HIDH_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (hh_cb.trace_level >= BT_TRACE_LEVEL_ERROR)                \
+    if (BT_TRACE_ON(HIDH, hh_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define HIDH_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (hh_cb.trace_level >= BT_TRACE_LEVEL_WARNING)                \
+    if (BT_TRACE_ON(HIDH, hh_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define HIDH_TRACE_API(...)                                     \
   {                                                             \
-    if (hh_cb.trace_level >= BT_TRACE_LEVEL_API)                \
+    if (BT_TRACE_ON(HIDH, hh_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define HIDH_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (hh_cb.trace_level >= BT_TRACE_LEVEL_EVENT)                \
+    if (BT_TRACE_ON(HIDH, hh_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define HIDH_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (hh_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)                \
+    if (BT_TRACE_ON(HIDH, hh_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* define traces for HID Device */
 #define HIDD_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_ERROR)                \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define HIDD_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_WARNING)                \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define HIDD_TRACE_API(...)                                     \
   {                                                             \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_API)                \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define HIDD_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_EVENT)                \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define HIDD_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)                \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define HIDD_TRACE_VERBOSE(...)                                   \
   {                                                               \
-    if (hd_cb.trace_level >= BT_TRACE_LEVEL_VERBOSE)              \
+    if (BT_TRACE_ON(HIDD, hd_cb.trace_level, VERBOSE))            \
       BT_TRACE(TRACE_LAYER_HID, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* define traces for BNEP */
 #define BNEP_TRACE_ERROR(...)                                      \
   {                                                                \
-    if (bnep_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(BNEP, bnep_cb.trace_level, ERROR))             \
       BT_TRACE(TRACE_LAYER_BNEP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define BNEP_TRACE_WARNING(...)                                      \
   {                                                                  \
-    if (bnep_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(BNEP, bnep_cb.trace_level, WARNING))             \
       BT_TRACE(TRACE_LAYER_BNEP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define BNEP_TRACE_API(...)                                      \
   {                                                              \
-    if (bnep_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(BNEP, bnep_cb.trace_level, API))             \
       BT_TRACE(TRACE_LAYER_BNEP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define BNEP_TRACE_EVENT(...)                                      \
   {                                                                \
-    if (bnep_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(BNEP, bnep_cb.trace_level, EVENT))             \
       BT_TRACE(TRACE_LAYER_BNEP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define BNEP_TRACE_DEBUG(...)                                      \
   {                                                                \
-    if (bnep_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(BNEP, bnep_cb.trace_level, DEBUG))             \
       BT_TRACE(TRACE_LAYER_BNEP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* define traces for PAN */
 #define PAN_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (pan_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(PAN, pan_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_PAN, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define PAN_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (pan_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(PAN, pan_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_PAN, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define PAN_TRACE_API(...)                                      \
   {                                                             \
-    if (pan_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(PAN, pan_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_PAN, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define PAN_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (pan_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(PAN, pan_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_PAN, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define PAN_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (pan_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(PAN, pan_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_PAN, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the A2DP profile */
 #define A2DP_TRACE_ERROR(...)                                      \
   {                                                                \
-    if (a2dp_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(A2DP, a2dp_cb.trace_level, ERROR))             \
       BT_TRACE(TRACE_LAYER_A2DP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define A2DP_TRACE_WARNING(...)                                      \
   {                                                                  \
-    if (a2dp_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(A2DP, a2dp_cb.trace_level, WARNING))             \
       BT_TRACE(TRACE_LAYER_A2DP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define A2DP_TRACE_EVENT(...)                                      \
   {                                                                \
-    if (a2dp_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(A2DP, a2dp_cb.trace_level, EVENT))             \
       BT_TRACE(TRACE_LAYER_A2DP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define A2DP_TRACE_DEBUG(...)                                      \
   {                                                                \
-    if (a2dp_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(A2DP, a2dp_cb.trace_level, DEBUG))             \
       BT_TRACE(TRACE_LAYER_A2DP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define A2DP_TRACE_API(...)                                      \
   {                                                              \
-    if (a2dp_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(A2DP, a2dp_cb.trace_level, API))             \
       BT_TRACE(TRACE_LAYER_A2DP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 
 /* AVDTP */
 #define AVDT_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (avdt_cb.trace_level >= BT_TRACE_LEVEL_ERROR)              \
+    if (BT_TRACE_ON(AVDT, avdt_cb.trace_level, ERROR))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define AVDT_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (avdt_cb.trace_level >= BT_TRACE_LEVEL_WARNING)              \
+    if (BT_TRACE_ON(AVDT, avdt_cb.trace_level, WARNING))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define AVDT_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (avdt_cb.trace_level >= BT_TRACE_LEVEL_EVENT)              \
+    if (BT_TRACE_ON(AVDT, avdt_cb.trace_level, EVENT))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define AVDT_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (avdt_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)              \
+    if (BT_TRACE_ON(AVDT, avdt_cb.trace_level, DEBUG))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define AVDT_TRACE_API(...)                                     \
   {                                                             \
-    if (avdt_cb.trace_level >= BT_TRACE_LEVEL_API)              \
+    if (BT_TRACE_ON(AVDT, avdt_cb.trace_level, API))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the AVCTP protocol */
 #define AVCT_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (avct_cb.trace_level >= BT_TRACE_LEVEL_ERROR)              \
+    if (BT_TRACE_ON(AVCT, avct_cb.trace_level, ERROR))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define AVCT_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (avct_cb.trace_level >= BT_TRACE_LEVEL_WARNING)              \
+    if (BT_TRACE_ON(AVCT, avct_cb.trace_level, WARNING))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define AVCT_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (avct_cb.trace_level >= BT_TRACE_LEVEL_EVENT)              \
+    if (BT_TRACE_ON(AVCT, avct_cb.trace_level, EVENT))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define AVCT_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (avct_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)              \
+    if (BT_TRACE_ON(AVCT, avct_cb.trace_level, DEBUG))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define AVCT_TRACE_API(...)                                     \
   {                                                             \
-    if (avct_cb.trace_level >= BT_TRACE_LEVEL_API)              \
+    if (BT_TRACE_ON(AVCT, avct_cb.trace_level, API))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the AVRCP profile */
 #define AVRC_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (avrc_cb.trace_level >= BT_TRACE_LEVEL_ERROR)              \
+    if (BT_TRACE_ON(AVRC, avrc_cb.trace_level, ERROR))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define AVRC_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (avrc_cb.trace_level >= BT_TRACE_LEVEL_WARNING)              \
+    if (BT_TRACE_ON(AVRC, avrc_cb.trace_level, WARNING))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define AVRC_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (avrc_cb.trace_level >= BT_TRACE_LEVEL_EVENT)              \
+    if (BT_TRACE_ON(AVRC, avrc_cb.trace_level, EVENT))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define AVRC_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (avrc_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)              \
+    if (BT_TRACE_ON(AVRC, avrc_cb.trace_level, DEBUG))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define AVRC_TRACE_API(...)                                     \
   {                                                             \
-    if (avrc_cb.trace_level >= BT_TRACE_LEVEL_API)              \
+    if (BT_TRACE_ON(AVRC, avrc_cb.trace_level, API))            \
       BT_TRACE(TRACE_LAYER_AVP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 
 /* MCAP */
 #define MCA_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (mca_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(MCA, mca_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_MCA, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define MCA_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (mca_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(MCA, mca_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_MCA, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define MCA_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (mca_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(MCA, mca_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_MCA, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define MCA_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (mca_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(MCA, mca_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_MCA, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 #define MCA_TRACE_API(...)                                      \
   {                                                             \
-    if (mca_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(MCA, mca_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_MCA, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the ATT/GATT unit */
 #define GATT_TRACE_ERROR(...)                                     \
   {                                                               \
-    if (gatt_cb.trace_level >= BT_TRACE_LEVEL_ERROR)              \
+    if (BT_TRACE_ON(GATT, gatt_cb.trace_level, ERROR))            \
       BT_TRACE(TRACE_LAYER_ATT, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define GATT_TRACE_WARNING(...)                                     \
   {                                                                 \
-    if (gatt_cb.trace_level >= BT_TRACE_LEVEL_WARNING)              \
+    if (BT_TRACE_ON(GATT, gatt_cb.trace_level, WARNING))            \
       BT_TRACE(TRACE_LAYER_ATT, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define GATT_TRACE_API(...)                                     \
   {                                                             \
-    if (gatt_cb.trace_level >= BT_TRACE_LEVEL_API)              \
+    if (BT_TRACE_ON(GATT, gatt_cb.trace_level, API))            \
       BT_TRACE(TRACE_LAYER_ATT, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define GATT_TRACE_EVENT(...)                                     \
   {                                                               \
-    if (gatt_cb.trace_level >= BT_TRACE_LEVEL_EVENT)              \
+    if (BT_TRACE_ON(GATT, gatt_cb.trace_level, EVENT))            \
       BT_TRACE(TRACE_LAYER_ATT, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define GATT_TRACE_DEBUG(...)                                     \
   {                                                               \
-    if (gatt_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)              \
+    if (BT_TRACE_ON(GATT, gatt_cb.trace_level, DEBUG))            \
       BT_TRACE(TRACE_LAYER_ATT, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
 /* Define tracing for the SMP unit */
 #define SMP_TRACE_ERROR(...)                                      \
   {                                                               \
-    if (smp_cb.trace_level >= BT_TRACE_LEVEL_ERROR)               \
+    if (BT_TRACE_ON(SMP, smp_cb.trace_level, ERROR))              \
       BT_TRACE(TRACE_LAYER_SMP, TRACE_TYPE_ERROR, ##__VA_ARGS__); \
   }
 #define SMP_TRACE_WARNING(...)                                      \
   {                                                                 \
-    if (smp_cb.trace_level >= BT_TRACE_LEVEL_WARNING)               \
+    if (BT_TRACE_ON(SMP, smp_cb.trace_level, WARNING))              \
       BT_TRACE(TRACE_LAYER_SMP, TRACE_TYPE_WARNING, ##__VA_ARGS__); \
   }
 #define SMP_TRACE_API(...)                                      \
   {                                                             \
-    if (smp_cb.trace_level >= BT_TRACE_LEVEL_API)               \
+    if (BT_TRACE_ON(SMP, smp_cb.trace_level, API))              \
       BT_TRACE(TRACE_LAYER_SMP, TRACE_TYPE_API, ##__VA_ARGS__); \
   }
 #define SMP_TRACE_EVENT(...)                                      \
   {                                                               \
-    if (smp_cb.trace_level >= BT_TRACE_LEVEL_EVENT)               \
+    if (BT_TRACE_ON(SMP, smp_cb.trace_level, EVENT))              \
       BT_TRACE(TRACE_LAYER_SMP, TRACE_TYPE_EVENT, ##__VA_ARGS__); \
   }
 #define SMP_TRACE_DEBUG(...)                                      \
   {                                                               \
-    if (smp_cb.trace_level >= BT_TRACE_LEVEL_DEBUG)               \
+    if (BT_TRACE_ON(SMP, smp_cb.trace_level, DEBUG))              \
       BT_TRACE(TRACE_LAYER_SMP, TRACE_TYPE_DEBUG, ##__VA_ARGS__); \
   }
 
@@ -669,42 +764,42 @@ extern uint8_t btif_trace_level;
 /* define traces for application */
 #define BTIF_TRACE_ERROR(...)                                         \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_ERROR)                     \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, ERROR))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_ERROR,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define BTIF_TRACE_WARNING(...)                                       \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_WARNING)                   \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, WARNING))                 \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_WARNING,                                  \
              ##__VA_ARGS__);                                          \
   }
 #define BTIF_TRACE_API(...)                                           \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_API)                       \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, API))                     \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_API,                                      \
              ##__VA_ARGS__);                                          \
   }
 #define BTIF_TRACE_EVENT(...)                                         \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_EVENT)                     \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, EVENT))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_EVENT,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define BTIF_TRACE_DEBUG(...)                                         \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_DEBUG)                     \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, DEBUG))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_DEBUG,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define BTIF_TRACE_VERBOSE(...)                                       \
   {                                                                   \
-    if (btif_trace_level >= BT_TRACE_LEVEL_VERBOSE)                   \
+    if (BT_TRACE_ON(BTIF, btif_trace_level, VERBOSE))                 \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_DEBUG,                                    \
              ##__VA_ARGS__);                                          \
@@ -713,42 +808,42 @@ extern uint8_t btif_trace_level;
 /* define traces for application */
 #define APPL_TRACE_ERROR(...)                                         \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_ERROR)                     \
+    if (BT_TRACE_ON(APPL, appl_trace_level, ERROR))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_ERROR,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define APPL_TRACE_WARNING(...)                                       \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_WARNING)                   \
+    if (BT_TRACE_ON(APPL, appl_trace_level, WARNING))                 \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_WARNING,                                  \
              ##__VA_ARGS__);                                          \
   }
 #define APPL_TRACE_API(...)                                           \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_API)                       \
+    if (BT_TRACE_ON(APPL, appl_trace_level, API))                     \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_API,                                      \
              ##__VA_ARGS__);                                          \
   }
 #define APPL_TRACE_EVENT(...)                                         \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_EVENT)                     \
+    if (BT_TRACE_ON(APPL, appl_trace_level, EVENT))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_EVENT,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define APPL_TRACE_DEBUG(...)                                         \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_DEBUG)                     \
+    if (BT_TRACE_ON(APPL, appl_trace_level, DEBUG))                   \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_DEBUG,                                    \
              ##__VA_ARGS__);                                          \
   }
 #define APPL_TRACE_VERBOSE(...)                                       \
   {                                                                   \
-    if (appl_trace_level >= BT_TRACE_LEVEL_VERBOSE)                   \
+    if (BT_TRACE_ON(APPL, appl_trace_level, VERBOSE))                 \
       LogMsg(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_APPL | \
                  TRACE_TYPE_DEBUG,                                    \
              ##__VA_ARGS__);                                          \
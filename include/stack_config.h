@@ -27,11 +27,17 @@ static const char STACK_CONFIG_MODULE[] = "stack_config_module";
 
 typedef struct {
   bool (*get_trace_config_enabled)(void);
+  bool (*get_trace_ring_enabled)(void);
   bool (*get_pts_secure_only_mode)(void);
   bool (*get_pts_conn_updates_disabled)(void);
   bool (*get_pts_crosskey_sdp_disable)(void);
   const char* (*get_pts_smp_options)(void);
   int (*get_pts_smp_failure_case)(void);
+  int (*get_ble_adv_rotated_advertisers)(void);
+  int (*get_l2cap_max_channels)(void);
+  int (*get_stall_threshold_ms)(void);
+  bool (*get_stall_sampling_enabled)(void);
+  int (*get_flow_trace_categories)(void);
   config_t* (*get_all)(void);
 } stack_config_t;
 
@@ -37,6 +37,9 @@
 #include "main_int.h"
 #include "osi/include/config.h"
 #include "osi/include/log.h"
+#include "osi/include/flow_trace.h"
+#include "osi/include/stall_log.h"
+#include "osi/include/trace_ring.h"
 #include "port_api.h"
 #include "sdp_api.h"
 #include "stack_config.h"
@@ -149,17 +152,43 @@ static tBTTRC_FUNC_MAP bttrc_set_level_map[] = {
 
     {0, 0, NULL, NULL, DEFAULT_CONF_TRACE_LEVEL}};
 
+static trace_ring_priority_t trace_ring_priority(uint32_t trace_type) {
+  switch (trace_type) {
+    case TRACE_TYPE_ERROR:
+      return TRACE_RING_ERROR;
+    case TRACE_TYPE_WARNING:
+      return TRACE_RING_WARN;
+    case TRACE_TYPE_API:
+    case TRACE_TYPE_EVENT:
+      return TRACE_RING_INFO;
+    default:
+      return TRACE_RING_DEBUG;
+  }
+}
+
 void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {
   static char buffer[BTE_LOG_BUF_SIZE];
   int trace_layer = TRACE_GET_LAYER(trace_set_mask);
   if (trace_layer >= TRACE_LAYER_MAX_NUM) trace_layer = 0;
 
   va_list ap;
+  uint32_t trace_type = TRACE_GET_TYPE(trace_set_mask);
+  if (trace_ring_is_enabled()) {
+    // The traces below the warnings are only kept in the ring, and are not
+    // formatted until it is dumped
+    va_start(ap, fmt_str);
+    trace_ring_vlog(trace_ring_priority(trace_type), bt_layer_tags[trace_layer],
+                    fmt_str, ap);
+    va_end(ap);
+    if (trace_type != TRACE_TYPE_ERROR && trace_type != TRACE_TYPE_WARNING)
+      return;
+  }
+
   va_start(ap, fmt_str);
   vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
   va_end(ap);
 
-  switch (TRACE_GET_TYPE(trace_set_mask)) {
+  switch (trace_type) {
     case TRACE_TYPE_ERROR:
       LOG_ERROR(bt_layer_tags[trace_layer], "%s", buffer);
       break;
@@ -176,7 +205,7 @@ void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {
     default:
       /* we should never get this */
       LOG_ERROR(bt_layer_tags[trace_layer], "!BAD TRACE TYPE! %s", buffer);
-      CHECK(TRACE_GET_TYPE(trace_set_mask) == TRACE_TYPE_ERROR);
+      CHECK(trace_type == TRACE_TYPE_ERROR);
       break;
   }
 }
@@ -215,6 +244,16 @@ static void load_levels_from_config(const config_t* config) {
 
 static future_t* init(void) {
   const stack_config_t* stack_config = stack_config_get_interface();
+  if (stack_config->get_trace_ring_enabled()) {
+    LOG_INFO(LOG_TAG, "recording the traces in the trace ring");
+    trace_ring_init();
+  }
+
+  int stall_threshold_ms = stack_config->get_stall_threshold_ms();
+  stall_log_set_threshold_ms(stall_threshold_ms > 0 ? stall_threshold_ms : 0);
+  stall_log_set_sampling(stack_config->get_stall_sampling_enabled());
+  flow_trace_set_categories(stack_config->get_flow_trace_categories());
+
   if (!stack_config->get_trace_config_enabled()) {
     LOG_INFO(LOG_TAG, "using compile default trace settings");
     return NULL;
@@ -53,6 +53,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/thread.h"
+#include "osi/include/thread_policy.h"
 #include "stack_config.h"
 
 /*******************************************************************************
@@ -115,6 +116,7 @@ void bte_main_boot_entry(void) {
   hci->set_data_queue(btu_hci_msg_queue);
 
   module_init(get_module(STACK_CONFIG_MODULE));
+  thread_policy_load(stack_config_get_interface()->get_all());
 }
 
 /******************************************************************************
@@ -152,8 +154,9 @@ void bte_main_cleanup() {
 void bte_main_enable() {
   APPL_TRACE_DEBUG("%s", __func__);
 
-  module_start_up(get_module(BTSNOOP_MODULE));
-  module_start_up(get_module(HCI_MODULE));
+  const module_t* modules[] = {get_module(BTSNOOP_MODULE),
+                               get_module(HCI_MODULE)};
+  module_start_up_all(modules, ARRAY_SIZE(modules));
 
   BTU_StartUp();
 }
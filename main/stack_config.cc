@@ -24,13 +24,20 @@
 
 #include "osi/include/future.h"
 #include "osi/include/log.h"
+#include "osi/include/stall_log.h"
 
 const char* TRACE_CONFIG_ENABLED_KEY = "TraceConf";
+const char* TRACE_RING_ENABLED_KEY = "TraceRing";
 const char* PTS_SECURE_ONLY_MODE = "PTS_SecurePairOnly";
 const char* PTS_LE_CONN_UPDATED_DISABLED = "PTS_DisableConnUpdates";
 const char* PTS_DISABLE_SDP_LE_PAIR = "PTS_DisableSDPOnLEPair";
 const char* PTS_SMP_PAIRING_OPTIONS_KEY = "PTS_SmpOptions";
 const char* PTS_SMP_FAILURE_CASE_KEY = "PTS_SmpFailureCase";
+const char* BLE_ADV_ROTATED_ADVERTISERS_KEY = "BleAdvRotatedAdvertisers";
+const char* L2CAP_MAX_CHANNELS_KEY = "L2capMaxChannels";
+const char* STALL_THRESHOLD_MS_KEY = "StallThresholdMs";
+const char* STALL_SAMPLING_KEY = "StallSampling";
+const char* FLOW_TRACE_CATEGORIES_KEY = "FlowTraceCategories";
 
 static config_t* config;
 
@@ -76,6 +83,11 @@ static bool get_trace_config_enabled(void) {
                          TRACE_CONFIG_ENABLED_KEY, false);
 }
 
+static bool get_trace_ring_enabled(void) {
+  return config_get_bool(config, CONFIG_DEFAULT_SECTION, TRACE_RING_ENABLED_KEY,
+                         false);
+}
+
 static bool get_pts_secure_only_mode(void) {
   return config_get_bool(config, CONFIG_DEFAULT_SECTION, PTS_SECURE_ONLY_MODE,
                          false);
@@ -101,14 +113,45 @@ static int get_pts_smp_failure_case(void) {
                         PTS_SMP_FAILURE_CASE_KEY, 0);
 }
 
+static int get_ble_adv_rotated_advertisers(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION,
+                        BLE_ADV_ROTATED_ADVERTISERS_KEY, 0);
+}
+
+static int get_l2cap_max_channels(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION, L2CAP_MAX_CHANNELS_KEY,
+                        0);
+}
+
+static int get_stall_threshold_ms(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION, STALL_THRESHOLD_MS_KEY,
+                        STALL_LOG_DEFAULT_THRESHOLD_MS);
+}
+
+static bool get_stall_sampling_enabled(void) {
+  return config_get_bool(config, CONFIG_DEFAULT_SECTION, STALL_SAMPLING_KEY,
+                         false);
+}
+
+static int get_flow_trace_categories(void) {
+  return config_get_int(config, CONFIG_DEFAULT_SECTION,
+                        FLOW_TRACE_CATEGORIES_KEY, 0);
+}
+
 static config_t* get_all(void) { return config; }
 
 const stack_config_t interface = {get_trace_config_enabled,
+                                  get_trace_ring_enabled,
                                   get_pts_secure_only_mode,
                                   get_pts_conn_updates_disabled,
                                   get_pts_crosskey_sdp_disable,
                                   get_pts_smp_options,
                                   get_pts_smp_failure_case,
+                                  get_ble_adv_rotated_advertisers,
+                                  get_l2cap_max_channels,
+                                  get_stall_threshold_ms,
+                                  get_stall_sampling_enabled,
+                                  get_flow_trace_categories,
                                   get_all};
 
 const stack_config_t* stack_config_get_interface(void) { return &interface; }
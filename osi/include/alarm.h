@@ -84,6 +84,21 @@ void alarm_set(alarm_t* alarm, period_ms_t interval_ms, alarm_callback_t cb,
 void alarm_set_on_queue(alarm_t* alarm, period_ms_t interval_ms,
                         alarm_callback_t cb, void* data, fixed_queue_t* queue);
 
+// Sets an |alarm| like |alarm_set|, except that the callback may be
+// deferred by up to |slack_ms| after |interval_ms|. The alarms whose slack
+// windows overlap are expired together, which saves wakeups for the timers
+// that need not be precise. The same deferral applies to each period of a
+// periodic |alarm|.
+void alarm_set_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                          period_ms_t slack_ms, alarm_callback_t cb,
+                          void* data);
+
+// Sets an |alarm| like |alarm_set_on_queue|, with the deferral of up to
+// |slack_ms| of |alarm_set_with_slack|.
+void alarm_set_on_queue_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                                   period_ms_t slack_ms, alarm_callback_t cb,
+                                   void* data, fixed_queue_t* queue);
+
 // This function cancels the |alarm| if it was previously set.
 // When this call returns, the caller has a guarantee that the
 // callback is not in progress and will not be called if it
@@ -96,6 +111,8 @@ void alarm_cancel(alarm_t* alarm);
 bool alarm_is_scheduled(const alarm_t* alarm);
 
 // Registers |queue| for processing alarm callbacks on |thread|.
+// The alarms set on |queue| are then expired by a timer in the reactor of
+// |thread|, and their callbacks are called there directly.
 // |queue| may not be NULL. |thread| may not be NULL.
 void alarm_register_processing_queue(fixed_queue_t* queue, thread_t* thread);
 
@@ -57,3 +57,7 @@ void* allocation_tracker_notify_free(allocator_id_t allocator_id, void* ptr);
 // Get the full size for an allocation, taking into account the size of
 // canaries.
 size_t allocation_tracker_resize_for_canary(size_t size);
+
+// Dump the statistics of the tracked allocations to the |fd| file
+// descriptor. Nothing is counted while the tracker is not initialized.
+void allocation_tracker_debug_dump(int fd);
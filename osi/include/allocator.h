@@ -34,6 +34,28 @@ typedef struct {
 extern const allocator_t allocator_malloc;
 extern const allocator_t allocator_calloc;
 
+// The subsystems the osi allocations are accounted to. The allocations of
+// the plain osi_* functions are accounted to |OSI_MEM_OTHER|.
+typedef enum {
+  OSI_MEM_OTHER = 0,
+  OSI_MEM_HCI,
+  OSI_MEM_L2CAP,
+  OSI_MEM_GATT_CACHE,
+  OSI_MEM_A2DP,
+  OSI_MEM_BTSNOOP,
+  OSI_MEM_CONFIG,
+  OSI_MEM_NUM_CATEGORIES
+} osi_mem_category_t;
+
+// The allocations of a category, in requested octets and in objects, and
+// the highest they have been since the start of the process.
+typedef struct {
+  size_t bytes;
+  size_t objects;
+  size_t peak_bytes;
+  size_t peak_objects;
+} osi_mem_stats_t;
+
 char* osi_strdup(const char* str);
 char* osi_strndup(const char* str, size_t len);
 
@@ -41,6 +63,16 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Same as |osi_strdup|, |osi_malloc| and |osi_calloc|, with the allocation
+// accounted to |category|. The allocation is freed with |osi_free|.
+char* osi_strdup_tagged(const char* str, osi_mem_category_t category);
+void* osi_malloc_tagged(size_t size, osi_mem_category_t category);
+void* osi_calloc_tagged(size_t size, osi_mem_category_t category);
+
+// Copies the current allocations of |category| to |stats|.
+void osi_allocator_get_stats(osi_mem_category_t category,
+                             osi_mem_stats_t* stats);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
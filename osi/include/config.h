@@ -141,6 +141,14 @@ const config_section_node_t* config_section_next(
 // NULL and must not equal the value returned by |config_section_end|.
 const char* config_section_name(const config_section_node_t* iter);
 
+// Loads the binary snapshot |filename| written by |config_save_snapshot| for
+// the config file |source|. The snapshot is mapped read-only and its sections
+// are built without parsing any text. Returns NULL if the snapshot is
+// missing, corrupted, or does not match the current |source| file, in which
+// case the caller is expected to load |source| with |config_new| instead.
+// Neither |filename| nor |source| may be NULL.
+config_t* config_new_snapshot(const char* filename, const char* source);
+
 // Saves |config| to a file given by |filename|. Note that this could be a
 // destructive operation: if |filename| already exists, it will be overwritten.
 // The config module does not preserve comments or formatting so if a config
@@ -148,3 +156,12 @@ const char* config_section_name(const config_section_node_t* iter);
 // |config_save|, all comments and special formatting in the original file will
 // be lost. Neither |config| nor |filename| may be NULL.
 bool config_save(const config_t* config, const char* filename);
+
+// Saves |config| as a binary snapshot to |filename|, stamped with the current
+// size, inode and modification time of |source|, the config file |config| was
+// loaded from or saved to. The config file remains the source of truth: the
+// snapshot only speeds up loading it, and is ignored by |config_new_snapshot|
+// once |source| changes. Neither |config|, |filename| nor |source| may be
+// NULL.
+bool config_save_snapshot(const config_t* config, const char* filename,
+                          const char* source);
@@ -0,0 +1,73 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "osi/include/future.h"
+#include "osi/include/thread.h"
+
+// An executor runs order-independent, CPU-heavy tasks on a pool of worker
+// threads, so that they do not hold up the thread that submitted them. Each
+// worker keeps its own queue of tasks, and a worker that runs out of tasks
+// steals from the others. Tasks may run in any order and concurrently, so
+// they must not touch state owned by the submitting thread; they compute a
+// result that is handed back either through a future or by posting a
+// completion to the owning thread.
+
+#define EXECUTOR_MAX_WORKERS 8
+
+typedef struct executor_t executor_t;
+
+// Runs on a worker thread. Returns the result of the task.
+typedef void* (*executor_task_fn)(void* context);
+
+// Runs on the owning thread with the |context| given to |executor_post| and
+// the |result| returned by the task.
+typedef void (*executor_completion_fn)(void* context, void* result);
+
+// Creates a new executor with |num_workers| worker threads named after
+// |name|. |num_workers| must be between 1 and EXECUTOR_MAX_WORKERS. Returns
+// NULL on failure. The returned executor must be freed with |executor_free|.
+// |name| may not be NULL.
+executor_t* executor_new(const char* name, size_t num_workers);
+
+// Frees |executor|. The tasks already submitted run to completion first, and
+// their completions are posted, so the owning threads must outlive the call.
+// Must not be called from a task. |executor| may be NULL.
+void executor_free(executor_t* executor);
+
+// Submits |task| with |context| to |executor|. Returns a future that is
+// ready with the result of the task, or NULL on failure. The future must be
+// awaited exactly once with |future_await|. Neither |executor| nor |task| may
+// be NULL.
+future_t* executor_submit(executor_t* executor, executor_task_fn task,
+                          void* context);
+
+// Submits |task| with |context| to |executor|, and posts |completion| with
+// |context| and the result of the task to |owner| once the task is done.
+// Returns true on success, otherwise false. |executor|, |task|, |owner| and
+// |completion| may not be NULL.
+bool executor_post(executor_t* executor, executor_task_fn task, void* context,
+                   thread_t* owner, executor_completion_fn completion);
+
+// Returns the number of tasks |executor| ran that were stolen from the queue
+// of another worker. |executor| may not be NULL.
+size_t executor_get_steal_count(const executor_t* executor);
@@ -22,10 +22,10 @@
 #include <stdlib.h>
 
 #include "osi/include/list.h"
+#include "osi/include/reactor.h"
 
 struct fixed_queue_t;
 typedef struct fixed_queue_t fixed_queue_t;
-typedef struct reactor_t reactor_t;
 
 typedef void (*fixed_queue_free_cb)(void* data);
 typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
@@ -81,6 +81,13 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data);
 // immediately. Otherwise, the next element in the queue is returned.
 void* fixed_queue_try_dequeue(fixed_queue_t* queue);
 
+// Tries to dequeue up to |max_count| elements from |queue| into |data|, in
+// queue order. This function will never block the caller. Returns the number
+// of elements dequeued, which is 0 if the queue is empty or NULL. |data| may
+// not be NULL.
+size_t fixed_queue_try_dequeue_batch(fixed_queue_t* queue, void** data,
+                                     size_t max_count);
+
 // Returns the first element from |queue|, if present, without dequeuing it.
 // This function will never block the caller. Returns NULL if there are no
 // elements in the queue or |queue| is NULL.
@@ -112,6 +119,9 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue);
 // descriptor is readable, the caller may call |fixed_queue_enqueue| without
 // blocking. The caller must not close the returned file descriptor. |queue|
 // may not be NULL.
+//
+// The file descriptor is created on the first call, from then on each
+// operation on the queue also updates it.
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue);
 
 // This function returns a valid file descriptor. Callers may perform one
@@ -119,6 +129,9 @@ int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue);
 // descriptor is readable, the caller may call |fixed_queue_dequeue| without
 // blocking. The caller must not close the returned file descriptor. |queue|
 // may not be NULL.
+//
+// The file descriptor is created on the first call, from then on each
+// operation on the queue also updates it.
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue);
 
 // Registers |queue| with |reactor| for dequeue operations. When there is an
@@ -128,6 +141,14 @@ int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue);
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                                   fixed_queue_cb ready_cb, void* context);
 
+// Same as |fixed_queue_register_dequeue|, but |queue| is dispatched by
+// |reactor| with |priority|.
+void fixed_queue_register_dequeue_with_priority(fixed_queue_t* queue,
+                                                reactor_t* reactor,
+                                                reactor_priority_t priority,
+                                                fixed_queue_cb ready_cb,
+                                                void* context);
+
 // Unregisters the dequeue ready callback for |queue| from whichever reactor
 // it is registered with, if any. This function is idempotent.
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue);
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The flow trace follows the packets through the layers of the stack: each
+// packet gets a flow ID, carried in the |flow_id| field of its BT_HDR, and
+// each layer it goes through emits a systrace slice named
+// "bt_flow <ID>: <point>" on the thread handling it. Searching a trace for
+// "bt_flow <ID>:" then shows the journey of one packet across the threads.
+//
+// A packet gets its ID at the first enabled trace point it goes through, and
+// keeps it until the last one. The buffers carrying a packet on are given
+// the ID of the packet with |FLOW_TRACE_COPY|.
+//
+// The flow trace is off until categories are enabled with
+// |flow_trace_set_categories|; on Android the slices are only emitted while
+// the "bluetooth" atrace category is captured. The arguments of the macros
+// are not evaluated otherwise. All functions are thread-safe.
+
+typedef enum {
+  FLOW_TRACE_HCI = 1 << 0,
+  FLOW_TRACE_L2CAP = 1 << 1,
+  FLOW_TRACE_AVDTP = 1 << 2,
+  FLOW_TRACE_ATT = 1 << 3,
+  FLOW_TRACE_RFCOMM = 1 << 4,
+  FLOW_TRACE_BTIF = 1 << 5,
+} flow_trace_category_t;
+
+#define FLOW_TRACE_ALL_CATEGORIES 0x3f
+
+// The ID of the packets not followed
+#define FLOW_TRACE_NO_FLOW 0
+
+// Traces the packet of |p_buf| at |point| of |category|: a string literal
+// naming the layer and direction, e.g. "L2CAP rx". The packet keeps its
+// flow ID if it has one, or gets a new one.
+#define FLOW_TRACE(category, p_buf, point)                       \
+  do {                                                           \
+    if (flow_trace_is_enabled(category))                         \
+      flow_trace_point((category), &(p_buf)->flow_id, (point));  \
+  } while (0)
+
+// Same as |FLOW_TRACE|, for the point where a packet enters the stack: it
+// always gets a new flow ID, whatever its buffer held.
+#define FLOW_TRACE_START(category, p_buf, point)                 \
+  do {                                                           \
+    if (flow_trace_is_enabled(category))                         \
+      flow_trace_start((category), &(p_buf)->flow_id, (point));  \
+  } while (0)
+
+// Same as |FLOW_TRACE|, for the point where a packet leaves the stack: its
+// flow ID is released.
+#define FLOW_TRACE_END(category, p_buf, point)                   \
+  do {                                                           \
+    if (flow_trace_is_enabled(category))                         \
+      flow_trace_end((category), &(p_buf)->flow_id, (point));    \
+  } while (0)
+
+// Gives the buffer |p_dst| the flow ID of |p_src|, as it carries the same
+// packet on: a fragment, a reassembled packet, a copy.
+#define FLOW_TRACE_COPY(p_dst, p_src) ((p_dst)->flow_id = (p_src)->flow_id)
+
+// Sets the categories traced, a mask of |flow_trace_category_t|. 0 turns
+// the flow trace off.
+void flow_trace_set_categories(uint32_t categories);
+
+// Returns true if the points of |category| are traced.
+bool flow_trace_is_enabled(uint32_t category);
+
+// Traces the packet with |*flow_id| at |point|. |flow_trace_point| keeps the
+// ID if it is one given out and not released, and gives a new one otherwise.
+// |flow_trace_start| always gives a new one, and |flow_trace_end| releases
+// it after the trace. Use the macros above rather than calling them.
+void flow_trace_point(uint32_t category, uint16_t* flow_id, const char* point);
+void flow_trace_start(uint32_t category, uint16_t* flow_id, const char* point);
+void flow_trace_end(uint32_t category, uint16_t* flow_id, const char* point);
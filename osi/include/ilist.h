@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// An intrusive doubly linked list. Unlike |list_t|, the list does not
+// allocate anything: the link is a |ilist_link_t| member embedded in the
+// element, and the element is found back from its link with |ILIST_ENTRY|.
+// Appending, removing and popping are constant time, and an element can be
+// removed without searching for it. Used as a FIFO with |ilist_append| and
+// |ilist_pop_front|, it is an allocation-free queue.
+//
+// An element may be in at most one list per embedded link, and the list
+// neither owns nor frees its elements. As the elements point back to it, an
+// |ilist_t| must not be copied or moved once initialized. The list is not
+// thread-safe.
+
+typedef struct ilist_link_t {
+  struct ilist_link_t* prev;
+  struct ilist_link_t* next;
+} ilist_link_t;
+
+typedef struct {
+  ilist_link_t head;  // The sentinel: |head.next| is the first element
+  size_t length;
+} ilist_t;
+
+// Returns the element of type |type| that embeds |link| as |member|.
+#define ILIST_ENTRY(link, type, member) \
+  ((type*)((char*)(link)-offsetof(type, member)))
+
+// Initializes |list| as an empty list. |list| may not be NULL.
+void ilist_init(ilist_t* list);
+
+// Initializes |link| as not linked into any list. |link| may not be NULL.
+void ilist_link_init(ilist_link_t* link);
+
+// Returns true if |link| is linked into a list. |link| must have been
+// initialized with |ilist_link_init| or added to a list before, and may not
+// be NULL.
+bool ilist_is_linked(const ilist_link_t* link);
+
+// Returns true if |list| is empty. |list| may not be NULL.
+bool ilist_is_empty(const ilist_t* list);
+
+// Returns the number of elements in |list|. |list| may not be NULL.
+size_t ilist_length(const ilist_t* list);
+
+// Returns the first or the last link of |list|, or NULL if the list is
+// empty. |list| may not be NULL.
+ilist_link_t* ilist_front(const ilist_t* list);
+ilist_link_t* ilist_back(const ilist_t* list);
+
+// Adds |link| at the end or at the beginning of |list|. |link| must not be
+// linked. Neither |list| nor |link| may be NULL.
+void ilist_append(ilist_t* list, ilist_link_t* link);
+void ilist_prepend(ilist_t* list, ilist_link_t* link);
+
+// Inserts |link| right after |prev|, which must be linked into |list|.
+// |link| must not be linked. None of the arguments may be NULL.
+void ilist_insert_after(ilist_t* list, ilist_link_t* prev, ilist_link_t* link);
+
+// Removes |link| from |list|, which it must be linked into. |link| is not
+// linked anymore on return. Neither |list| nor |link| may be NULL.
+void ilist_remove(ilist_t* list, ilist_link_t* link);
+
+// Removes and returns the first link of |list|, or returns NULL if the list
+// is empty. |list| may not be NULL.
+ilist_link_t* ilist_pop_front(ilist_t* list);
+
+// Iterates over |list|:
+//   for (ilist_link_t* link = ilist_begin(list); link != ilist_end(list);
+//        link = ilist_next(link))
+// The current link may be removed from the list only after moving on to the
+// next one. None of the arguments may be NULL.
+ilist_link_t* ilist_begin(const ilist_t* list);
+ilist_link_t* ilist_end(const ilist_t* list);
+ilist_link_t* ilist_next(const ilist_link_t* link);
@@ -0,0 +1,62 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A histogram of latencies in microseconds, with log-scaled buckets: each
+// power of two is split in |LATENCY_HISTOGRAM_SUB_BUCKETS| buckets, so a
+// percentile is reported within 25% of the actual value. The histogram is a
+// plain structure that may be embedded in statistics and cleared with
+// memset. It is not thread-safe.
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 4
+// Values of 2^26us (about 67 seconds) and above go to an overflow bucket
+#define LATENCY_HISTOGRAM_MAX_EXPONENT 26
+#define LATENCY_HISTOGRAM_BUCKETS                                         \
+  (LATENCY_HISTOGRAM_SUB_BUCKETS +                                        \
+   (LATENCY_HISTOGRAM_MAX_EXPONENT - 2) * LATENCY_HISTOGRAM_SUB_BUCKETS + \
+   1)
+
+typedef struct {
+  uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+  uint64_t count;
+  uint64_t total_us;
+  uint64_t max_us;
+} latency_histogram_t;
+
+// Clears |histogram|. |histogram| may not be NULL.
+void latency_histogram_reset(latency_histogram_t* histogram);
+
+// Adds a sample of |latency_us| to |histogram|. |histogram| may not be NULL.
+void latency_histogram_add(latency_histogram_t* histogram,
+                           uint64_t latency_us);
+
+// Adds all the samples of |src| to |dst|. Neither |src| nor |dst| may be
+// NULL.
+void latency_histogram_merge(const latency_histogram_t* src,
+                             latency_histogram_t* dst);
+
+// Returns the latency in microseconds below which |per_mille| thousandths of
+// the samples of |histogram| are, e.g. 500 for the median or 999 for the
+// 99.9th percentile. The value is the upper bound of the matching bucket,
+// capped to the maximum sample. Returns 0 if |histogram| is empty.
+// |histogram| may not be NULL, and |per_mille| may not exceed 1000.
+uint64_t latency_histogram_percentile(const latency_histogram_t* histogram,
+                                      uint32_t per_mille);
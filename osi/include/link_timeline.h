@@ -0,0 +1,114 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The timeline of an audio link over a streaming session: the time spent at
+// each bitrate quality index of the encoder and the changes between them,
+// the RSSI of the link sampled over time, and the periods of congestion.
+// All the times are relative to the start of the session. Only the last
+// changes and samples are kept. The timeline is a plain structure that may
+// be embedded in statistics and cleared with memset. It is not thread-safe.
+#define LINK_TIMELINE_MAX_QUALITY_INDEX 8
+#define LINK_TIMELINE_MAX_TRANSITIONS 32
+#define LINK_TIMELINE_MAX_RSSI_SAMPLES 32
+
+typedef struct {
+  uint64_t time_ms;
+  int32_t from_index;
+  int32_t to_index;
+  int32_t rssi;              // The last RSSI sampled, or 0 if none
+  uint32_t tx_queue_length;  // Packets waiting in the transmit queue
+} link_timeline_transition_t;
+
+typedef struct {
+  uint64_t time_ms;
+  int32_t rssi;
+  uint32_t tx_queue_length;  // Packets waiting in the transmit queue
+} link_timeline_rssi_sample_t;
+
+typedef struct {
+  // Time spent at each quality index. Indices beyond the last one are
+  // accounted to the last one.
+  uint64_t quality_duration_ms[LINK_TIMELINE_MAX_QUALITY_INDEX];
+  uint64_t quality_since_us;  // Start of the current quality index
+  int32_t quality_index;      // Valid if |has_quality_index|
+  bool has_quality_index;
+
+  // |num_transitions| and |num_rssi_samples| count all of them, the arrays
+  // are rings of the last |*_kept| ones, the oldest at |*_first|
+  uint32_t num_transitions;
+  uint32_t transitions_first;
+  uint32_t transitions_kept;
+  link_timeline_transition_t transitions[LINK_TIMELINE_MAX_TRANSITIONS];
+  uint32_t num_rssi_samples;
+  uint32_t rssi_samples_first;
+  uint32_t rssi_samples_kept;
+  link_timeline_rssi_sample_t rssi_samples[LINK_TIMELINE_MAX_RSSI_SAMPLES];
+
+  bool is_congested;
+  uint64_t congestion_since_us;  // Start of the current congestion
+  uint32_t congestion_count;
+  uint64_t congestion_total_us;
+  uint64_t congestion_max_us;
+} link_timeline_t;
+
+// Clears |timeline|. |timeline| may not be NULL.
+void link_timeline_reset(link_timeline_t* timeline);
+
+// Sets the quality index of the encoder to |quality_index| at the time
+// |time_us|, recording a transition if it changed. |tx_queue_length| is the
+// number of packets waiting to be sent. |timeline| may not be NULL, and
+// |quality_index| may not be negative.
+void link_timeline_set_quality(link_timeline_t* timeline, uint64_t time_us,
+                               int32_t quality_index,
+                               uint32_t tx_queue_length);
+
+// Adds a sample of the RSSI |rssi| of the link at the time |time_us|.
+// |timeline| may not be NULL.
+void link_timeline_add_rssi(link_timeline_t* timeline, uint64_t time_us,
+                            int32_t rssi, uint32_t tx_queue_length);
+
+// Sets whether the link is congested at the time |time_us|. A congestion
+// lasts from the first time it is set until the first time it is cleared.
+// |timeline| may not be NULL.
+void link_timeline_set_congested(link_timeline_t* timeline, uint64_t time_us,
+                                 bool is_congested);
+
+// Accounts the time spent at the current quality index and in the current
+// congestion up to |time_us|, and ends both, e.g. at the end of the session.
+// |timeline| may not be NULL.
+void link_timeline_finish(link_timeline_t* timeline, uint64_t time_us);
+
+// Adds the durations, transitions, samples and congestions of |src| to
+// |dst|. The ongoing quality index and congestion of |src| are ignored, see
+// |link_timeline_finish|. Neither |src| nor |dst| may be NULL.
+void link_timeline_merge(const link_timeline_t* src, link_timeline_t* dst);
+
+// Returns the |i|-th of the transitions kept in |timeline|, the oldest
+// first. |i| must be below |transitions_kept|.
+const link_timeline_transition_t* link_timeline_get_transition(
+    const link_timeline_t* timeline, uint32_t i);
+
+// Returns the |i|-th of the RSSI samples kept in |timeline|, the oldest
+// first. |i| must be below |rssi_samples_kept|.
+const link_timeline_rssi_sample_t* link_timeline_get_rssi_sample(
+    const link_timeline_t* timeline, uint32_t i);
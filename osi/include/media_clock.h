@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "osi/include/reactor.h"
+#include "osi/include/time.h"
+
+// A periodic clock for media processing. Unlike |alarm_t|, the clock is a
+// timerfd registered directly on the reactor of the thread consuming the
+// ticks, so a tick does not go through the alarm dispatcher thread. The
+// ticks follow absolute CLOCK_BOOTTIME deadlines: a late tick does not
+// delay the following ones.
+struct media_clock_t;
+typedef struct media_clock_t media_clock_t;
+
+// Called on the reactor thread on each tick. |timestamp_us| is the
+// CLOCK_BOOTTIME time the tick was handled at.
+typedef void (*media_clock_callback_t)(void* context, uint64_t timestamp_us);
+
+// Creates a new stopped media clock. |name| is used for logging and may not
+// be NULL. Returns NULL on failure. The caller must free the returned clock
+// with |media_clock_free|.
+media_clock_t* media_clock_new(const char* name);
+
+// Stops and frees a media clock. |clock| may be NULL.
+void media_clock_free(media_clock_t* clock);
+
+// Starts |clock| with a period of |period_ms|, calling |cb| with |context|
+// on |reactor| on each tick. The first tick is one period from now. If the
+// clock is already running, it is restarted. Returns true on success.
+// |clock|, |reactor| and |cb| may not be NULL, and |period_ms| may not be 0.
+bool media_clock_start(media_clock_t* clock, reactor_t* reactor,
+                       period_ms_t period_ms, media_clock_callback_t cb,
+                       void* context);
+
+// Stops |clock|. No callback is running or will run once this function
+// returns. Stopping a stopped clock has no effect. |clock| may not be NULL.
+void media_clock_stop(media_clock_t* clock);
+
+// Returns true if |clock| is running. This function is safe to call from
+// any thread. If |clock| is NULL, the return value is false.
+bool media_clock_is_running(const media_clock_t* clock);
+
+// Returns the number of ticks that were missed since |clock| was started
+// because the reactor thread did not handle them in time. |clock| may not
+// be NULL.
+uint64_t media_clock_get_missed_ticks(const media_clock_t* clock);
@@ -22,6 +22,9 @@
 #include <memory>
 #include <string>
 
+#include "osi/include/latency_histogram.h"
+#include "osi/include/link_timeline.h"
+
 namespace system_bt_osi {
 
 // Typedefs to hide protobuf definition to the rest of stack
@@ -58,6 +61,29 @@ typedef enum {
   DISCONNECT_REASON_NEXT_START_WITHOUT_END_PREVIOUS,
 } disconnect_reason_t;
 
+/* Activity of the controller over a period between two reads of its energy
+ * counters
+ *    duration_ms: length of the period.
+ *    tx_time_ms, rx_time_ms, idle_time_ms: time the controller spent
+ *                                          transmitting, receiving and idle.
+ *    energy_used: energy used by the controller, in the unit it reports.
+ *    a2dp_codec_index: the btav_a2dp_codec_index_t of the A2DP stream at the
+ *                      end of the period, -1 if none.
+ *    le_scanning: whether LE scanning was on at the end of the period.
+ *    num_le_links, num_bredr_links: ACL links open at the end of the period.
+ */
+typedef struct {
+  uint64_t duration_ms;
+  uint32_t tx_time_ms;
+  uint32_t rx_time_ms;
+  uint32_t idle_time_ms;
+  uint32_t energy_used;
+  int32_t a2dp_codec_index;
+  bool le_scanning;
+  uint32_t num_le_links;
+  uint32_t num_bredr_links;
+} energy_sample_t;
+
 /* Values of A2DP metrics that we care about
  *
  *    audio_duration_ms : sum of audio duration (in milliseconds).
@@ -74,6 +100,14 @@ typedef enum {
  *    buffer_underruns_average: TODO - not clear what this is.
  *    buffer_underruns_count: number of times there was no enough
  *                            audio data to add to the media buffer.
+ *    media_read_latency: time spent reading the audio from the audio HAL.
+ *    encode_latency: time from the media timer tick to the encoded packet
+ *                    being queued.
+ *    tx_queue_latency: time encoded packets wait in the transmit queue.
+ *    codec_index: the btav_a2dp_codec_index_t of the codec used.
+ *    link_timeline: time spent at each bitrate quality index of the encoder
+ *                   and the changes between them, RSSI samples, and the
+ *                   L2CAP congestion periods.
  * NOTE: Negative values are invalid
 */
 class A2dpSessionMetrics {
@@ -104,6 +138,20 @@ class A2dpSessionMetrics {
   int32_t buffer_overruns_total = -1;
   float buffer_underruns_average = -1;
   int32_t buffer_underruns_count = -1;
+
+  /*
+   * Latency histograms, empty when invalid
+   */
+  latency_histogram_t media_read_latency = {};
+  latency_histogram_t encode_latency = {};
+  latency_histogram_t tx_queue_latency = {};
+
+  int32_t codec_index = -1;
+
+  /*
+   * Timeline of the link, empty when invalid
+   */
+  link_timeline_t link_timeline = {};
 };
 
 class BluetoothMetricsLogger {
@@ -151,6 +199,17 @@ class BluetoothMetricsLogger {
   void LogScanEvent(bool start, const std::string& initator, scan_tech_t type,
                     uint32_t results, uint64_t timestamp_ms);
 
+  /*
+   * Record a sample of the controller energy counters
+   *
+   * Parameters
+   *    timestamp_ms : Unix epoch time in milliseconds, at the end of the
+   *                   period sampled
+   *    sample : the activity of the controller over the period, and the
+   *             profiles active at its end
+   */
+  void LogEnergySample(const energy_sample_t& sample, uint64_t timestamp_ms);
+
   /*
    * Start logging a Bluetooth session
    *
@@ -230,6 +289,7 @@ class BluetoothMetricsLogger {
   static const size_t kMaxNumPairEvent = 50;
   static const size_t kMaxNumWakeEvent = 1000;
   static const size_t kMaxNumScanEvent = 50;
+  static const size_t kMaxNumEnergySample = 96;
 
  private:
   BluetoothMetricsLogger();
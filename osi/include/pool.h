@@ -0,0 +1,72 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A pool is a fixed number of equally sized buffers carved out of a single
+// preallocated slab. Buffers taken from a pool are released with the regular
+// |osi_free| (and therefore with |fixed_queue_flush(queue, osi_free)| or the
+// HCI buffer allocator), which recognizes pool buffers and returns them to
+// their pool instead of the heap. This allows hot paths to hand buffers to
+// the lower layers of the stack without any heap allocation.
+//
+// All functions are thread-safe. A small, fixed number of pools may exist at
+// the same time - see |POOL_MAX_POOLS|.
+typedef struct pool_t pool_t;
+
+// The maximum number of pools that may exist at the same time.
+#define POOL_MAX_POOLS 4
+
+// Creates a new pool of |capacity| buffers of |buffer_size| octets each.
+// Neither |buffer_size| nor |capacity| may be 0.
+// Returns NULL if all pool slots are in use. The caller must free the
+// returned pool with |pool_free|.
+pool_t* pool_new(size_t buffer_size, size_t capacity);
+
+// Frees |pool|. Buffers that are still outstanding remain valid: the pool
+// memory is released once the last of them is freed with |osi_free|.
+// |pool| may be NULL.
+void pool_free(pool_t* pool);
+
+// Takes a buffer out of |pool|. The buffer contents are not initialized.
+// Returns NULL if the pool is exhausted - the caller is expected to fall
+// back to |osi_malloc| in that case. |pool| may not be NULL.
+void* pool_alloc(pool_t* pool);
+
+// Returns the size (in octets) of each buffer in |pool|. |pool| may not be
+// NULL.
+size_t pool_buffer_size(const pool_t* pool);
+
+// Returns the total number of buffers in |pool|. |pool| may not be NULL.
+size_t pool_capacity(const pool_t* pool);
+
+// Returns the number of buffers currently available in |pool|. |pool| may
+// not be NULL.
+size_t pool_available(pool_t* pool);
+
+// Returns the number of |pool_alloc| calls on |pool| that failed because
+// the pool was exhausted. |pool| may not be NULL.
+size_t pool_exhausted_count(pool_t* pool);
+
+// Returns |ptr| to the pool it was taken from. Returns true if |ptr| is a
+// pool buffer, otherwise false and |ptr| is left untouched.
+// NOTE: This is called by |osi_free| and should not be called directly.
+bool pool_release(void* ptr);
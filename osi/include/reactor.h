@@ -37,6 +37,36 @@ typedef enum {
                          // variants).
 } reactor_status_t;
 
+// Enumerates the dispatch classes of the registered objects. On each
+// iteration, the ready objects are dispatched from the highest class to the
+// lowest, so that e.g. a media or HCI fd is not held up behind a burst of
+// control or housekeeping events on the same reactor.
+typedef enum {
+  REACTOR_PRIORITY_HIGH,    // latency-critical: media, HCI.
+  REACTOR_PRIORITY_NORMAL,  // the default: control and protocol messages.
+  REACTOR_PRIORITY_LOW,     // bulk and housekeeping work.
+} reactor_priority_t;
+
+// At most this many ready objects of REACTOR_PRIORITY_LOW are dispatched per
+// iteration. The other ones are dispatched on the next iterations, after the
+// objects of the higher classes that became ready in the meantime.
+#define REACTOR_LOW_PRIORITY_BATCH 4
+
+// The dispatch statistics of a registered object.
+typedef struct {
+  uint64_t dispatch_count;  // number of times the callbacks were called.
+  uint64_t total_delay_us;  // time from the reactor wakeup to the callbacks.
+  uint64_t max_delay_us;
+  uint64_t total_run_us;    // time spent in the callbacks.
+  uint64_t max_run_us;
+} reactor_object_stats_t;
+
+// The occupancy of a reactor, for a watchdog of its thread.
+typedef struct {
+  uint64_t busy_us;            // total time spent in the callbacks.
+  uint64_t dispatch_start_us;  // start of the running callbacks, 0 if idle.
+} reactor_occupancy_t;
+
 // Creates a new reactor object. Returns NULL on failure. The returned object
 // must be freed by calling |reactor_free|.
 reactor_t* reactor_new(void);
@@ -66,11 +96,17 @@ void reactor_stop(reactor_t* reactor);
 // may be NULL. This function returns an opaque object that represents the file
 // descriptor's registration with the reactor. When the caller is no longer
 // interested in events on the |fd|, it must free the returned object by calling
-// |reactor_unregister|.
+// |reactor_unregister|. The object is dispatched with
+// REACTOR_PRIORITY_NORMAL.
 reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
                                    void (*read_ready)(void* context),
                                    void (*write_ready)(void* context));
 
+// Same as |reactor_register|, but the object is dispatched with |priority|.
+reactor_object_t* reactor_register_with_priority(
+    reactor_t* reactor, int fd, void* context, reactor_priority_t priority,
+    void (*read_ready)(void* context), void (*write_ready)(void* context));
+
 // Changes the subscription mode for the file descriptor represented by
 // |object|. If the caller has already registered a file descriptor with a
 // reactor, has a valid |object|, and decides to change the |read_ready| and/or
@@ -85,3 +121,14 @@ bool reactor_change_registration(reactor_object_t* object,
 // may not be NULL. |obj| is invalid after calling this function so the caller
 // must drop all references to it.
 void reactor_unregister(reactor_object_t* obj);
+
+// Copies the occupancy of |reactor| into |occupancy|. This function is safe
+// to call from any thread, including while the reactor is stuck in a
+// callback. Neither |reactor| nor |occupancy| may be NULL.
+void reactor_get_occupancy(const reactor_t* reactor,
+                           reactor_occupancy_t* occupancy);
+
+// Copies the dispatch statistics of |object| into |stats|. Must not be called
+// from the callbacks of |object|. Neither |object| nor |stats| may be NULL.
+void reactor_object_get_stats(reactor_object_t* object,
+                              reactor_object_stats_t* stats);
@@ -19,13 +19,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <sys/types.h>
 
 typedef struct ringbuffer_t ringbuffer_t;
 
 // NOTE:
-// None of the functions below are thread safe when it comes to accessing the
-// *rb pointer. It is *NOT* possible to insert and pop/delete at the same time.
-// Callers must protect the *rb pointer separately.
+// The ringbuffer is safe for a single producer and a single consumer running
+// on different threads without a lock: one thread may insert (or reserve and
+// commit) while another one peeks and pops (or deletes and releases). Calls
+// on the same side must be serialized by the caller, and freeing the
+// ringbuffer while it is in use results in undefined behaviour.
 
 // Create a ringbuffer with the specified size
 // Returns NULL if memory allocation failed. Resulting pointer must be freed
@@ -60,3 +63,35 @@ size_t ringbuffer_pop(ringbuffer_t* rb, uint8_t* p, size_t length);
 // Deletes |length| bytes from the ringbuffer starting from the head
 // Return actual number of bytes deleted.
 size_t ringbuffer_delete(ringbuffer_t* rb, size_t length);
+
+// Zero-copy access
+//
+// The producer writes straight into the buffer: |ringbuffer_reserve| returns
+// the free space contiguous to the tail, and |ringbuffer_commit| makes the
+// bytes written there visible to the consumer. Likewise, the consumer reads
+// straight from the buffer: |ringbuffer_peek_contiguous| returns the data
+// contiguous to the head, and |ringbuffer_release| frees it.
+//
+// A span never wraps around the end of the buffer: when free space or data
+// wraps, it comes as two spans, the second one returned by the next call
+// once the first one is committed or released.
+
+// Stores at |p| the address of the free space at the tail of the buffer, and
+// returns its contiguous length, at most |length|. Returns 0 if the buffer
+// is full. Only the producer may call this function.
+size_t ringbuffer_reserve(ringbuffer_t* rb, uint8_t** p, size_t length);
+
+// Appends |length| bytes, written at the address returned by
+// |ringbuffer_reserve|, to the data of the buffer. |length| may not exceed
+// the length returned by |ringbuffer_reserve|.
+void ringbuffer_commit(ringbuffer_t* rb, size_t length);
+
+// Stores at |p| the address of the data at the head of the buffer, and
+// returns its contiguous length. Returns 0 if the buffer is empty. Only the
+// consumer may call this function.
+size_t ringbuffer_peek_contiguous(const ringbuffer_t* rb, const uint8_t** p);
+
+// Frees |length| bytes of data at the head of the buffer, once the consumer
+// is done with the span returned by |ringbuffer_peek_contiguous|. |length|
+// may not exceed the size of the data.
+void ringbuffer_release(ringbuffer_t* rb, size_t length);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 struct semaphore_t;
 typedef struct semaphore_t semaphore_t;
@@ -28,8 +29,15 @@ typedef struct semaphore_t semaphore_t;
 // with |semaphore_free|.
 semaphore_t* semaphore_new(unsigned int value);
 
-// Frees a semaphore allocated with |semaphore_new|. |semaphore| may
-// be NULL.
+// Creates a new semaphore with an initial value of |value| which is not
+// backed by a file descriptor. Waiting and posting only enter the kernel
+// when a thread has to block or to be woken up, but |semaphore_get_fd| may
+// not be called on it. The returned object must be released with
+// |semaphore_free|.
+semaphore_t* semaphore_new_lightweight(unsigned int value);
+
+// Frees a semaphore allocated with |semaphore_new| or
+// |semaphore_new_lightweight|. |semaphore| may be NULL.
 void semaphore_free(semaphore_t* semaphore);
 
 // Decrements the value of |semaphore|. If it is 0, this call blocks until
@@ -41,9 +49,19 @@ void semaphore_wait(semaphore_t* semaphore);
 // |semaphore| may not be NULL.
 bool semaphore_try_wait(semaphore_t* semaphore);
 
+// Tries to decrement the value of |semaphore| up to |count| times. Returns
+// the number of times the value was decremented, which is less than |count|
+// if the value reached 0. This function never blocks. |semaphore| may not be
+// NULL.
+size_t semaphore_try_wait_n(semaphore_t* semaphore, size_t count);
+
 // Increments the value of |semaphore|. |semaphore| may not be NULL.
 void semaphore_post(semaphore_t* semaphore);
 
+// Increments the value of |semaphore| by |count| at once. |semaphore| may not
+// be NULL.
+void semaphore_post_n(semaphore_t* semaphore, size_t count);
+
 // Returns a file descriptor representing this semaphore. The caller may
 // only perform one operation on the file descriptor: select(2). If |select|
 // indicates the fd is readable, the caller may call |semaphore_wait|
@@ -53,5 +71,5 @@ void semaphore_post(semaphore_t* semaphore);
 // which results in blocking behaviour.
 //
 // The caller must not close the returned file descriptor. |semaphore| may not
-// be NULL.
+// be NULL, nor a lightweight semaphore.
 int semaphore_get_fd(const semaphore_t* semaphore);
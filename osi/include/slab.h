@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The slab allocator serves the |osi_malloc| and |osi_calloc| requests of the
+// few sizes that dominate the Bluetooth traffic from size classes, instead of
+// the heap. Each size class carves its objects out of pages of a single
+// arena reserved by |slab_init|, and each thread keeps a magazine of free
+// objects per size class, so that the HCI, BTU and media threads allocate
+// and free without contending on a lock. Objects freed by another thread
+// than the one that allocated them go back through a locked per-class depot.
+//
+// The slab allocator is opt-in: until |slab_init| is called, the osi
+// allocator uses the heap only. It sits below the allocation tracker, which
+// keeps adding its canaries around the objects.
+
+// The size classes, in octets. The larger ones fit an HCI command buffer and
+// a BT_DEFAULT_BUFFER_SIZE buffer, each with the osi allocation header.
+#define SLAB_SIZE_CLASSES \
+  { 32, 64, 128, 256, 688, 4128 }
+#define SLAB_NUM_SIZE_CLASSES 6
+
+// The number of free objects a thread keeps per size class.
+#define SLAB_MAGAZINE_SIZE 32
+
+// Reserves the slab arena and enables the slab allocator. Calling it again
+// has no effect. The arena is never released.
+void slab_init(void);
+
+// Returns true if the slab allocator is enabled.
+bool slab_is_enabled(void);
+
+// Allocates an object of at least |size| octets. The contents are not
+// initialized. Returns NULL if the slab allocator is not enabled, if |size|
+// is larger than the largest size class, or if the arena is exhausted: the
+// caller is expected to fall back to the heap in that case.
+// NOTE: This is called by the osi allocator and should not be called
+// directly.
+void* slab_alloc(size_t size);
+
+// Returns |ptr| to its size class. Returns true if |ptr| is a slab object,
+// otherwise false and |ptr| is left untouched.
+// NOTE: This is called by |osi_free| and should not be called directly.
+bool slab_release(void* ptr);
+
+// Dumps the statistics of the size classes to the |fd| file descriptor.
+void slab_debug_dump(int fd);
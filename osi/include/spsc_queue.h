@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// A lock-free, non-blocking variant of |fixed_queue_t| for the case where a
+// single thread enqueues elements while another thread dequeues them.
+// Neither side ever takes a lock or makes a system call.
+//
+// Only one thread at a time may call |spsc_queue_try_enqueue|. The dequeue
+// side (|spsc_queue_try_dequeue| and |spsc_queue_flush|) may be called from
+// any thread, including the producer: this allows the producer to flush the
+// queue while the consumer keeps draining it.
+//
+// Each element is stamped with its enqueue time, so the owner can tell how
+// long elements wait in the queue.
+struct spsc_queue_t;
+typedef struct spsc_queue_t spsc_queue_t;
+
+typedef void (*spsc_queue_free_cb)(void* data);
+
+// Creates a new queue with the given |capacity|. |capacity| may not be 0.
+// Returns NULL on failure. The caller must free the returned queue with
+// |spsc_queue_free|.
+spsc_queue_t* spsc_queue_new(size_t capacity);
+
+// Frees a queue and (optionally) the enqueued elements.
+// |queue| is the queue to free. If the |free_cb| callback is not null,
+// it is called on each queue element to free it.
+// Freeing a queue that is currently in use by another thread results in
+// undefined behaviour.
+void spsc_queue_free(spsc_queue_t* queue, spsc_queue_free_cb free_cb);
+
+// Flushes a queue and (optionally) frees the enqueued elements.
+// |queue| is the queue to flush. If the |free_cb| callback is not null,
+// it is called on each queue element to free it.
+// Returns the number of flushed elements.
+size_t spsc_queue_flush(spsc_queue_t* queue, spsc_queue_free_cb free_cb);
+
+// Returns a value indicating whether the given |queue| is empty. If |queue|
+// is NULL, the return value is true.
+bool spsc_queue_is_empty(spsc_queue_t* queue);
+
+// Returns the length of the |queue|. If |queue| is NULL, the return value
+// is 0.
+size_t spsc_queue_length(spsc_queue_t* queue);
+
+// Returns the maximum number of elements this queue may hold. |queue| may
+// not be NULL.
+size_t spsc_queue_capacity(spsc_queue_t* queue);
+
+// Tries to enqueue |data| into the |queue|. This function will never block
+// the caller. If the queue capacity would be exceeded by adding one more
+// element, this function returns false immediately. Otherwise, this function
+// returns true. Neither |queue| nor |data| may be NULL.
+bool spsc_queue_try_enqueue(spsc_queue_t* queue, void* data);
+
+// Tries to dequeue an element from |queue|. This function will never block
+// the caller. If the queue is empty or NULL, this function returns NULL
+// immediately. Otherwise, the next element in the queue is returned.
+void* spsc_queue_try_dequeue(spsc_queue_t* queue);
+
+// Same as |spsc_queue_try_dequeue|, and if an element is returned, its
+// enqueue time (in microseconds since boot) is stored in |p_enqueue_us|.
+// |p_enqueue_us| may not be NULL.
+void* spsc_queue_try_dequeue_timed(spsc_queue_t* queue, uint64_t* p_enqueue_us);
+
+// Returns the enqueue time (in microseconds since boot) of the first element
+// in |queue|, or 0 if the queue is empty or NULL.
+uint64_t spsc_queue_first_enqueue_us(spsc_queue_t* queue);
@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The stall log records the reactor callbacks that run for longer than a
+// threshold, on any thread: the posted work items, the queue and socket
+// callbacks, and so the BTU messages, closures and alarms. Each record holds
+// the thread, the run time and the origin of the callback: the posting site
+// of a closure when it is known, or else the function called.
+//
+// With sampling on, a callback still running at the threshold is also
+// interrupted once by a signal, which samples its stack: the frames show
+// what it was stuck in, rather than where it ended.
+//
+// All functions are thread-safe.
+
+// The run time from which a callback is recorded, unless set otherwise
+#define STALL_LOG_DEFAULT_THRESHOLD_MS 20
+
+// The most recent stalls kept, and the frames kept of each sampled stack
+#define STALL_LOG_SIZE 32
+#define STALL_LOG_MAX_FRAMES 16
+
+// Sets the run time from which a callback is recorded. 0 disables the
+// recording.
+void stall_log_set_threshold_ms(uint32_t threshold_ms);
+
+// Returns the run time from which a callback is recorded, 0 if disabled.
+uint32_t stall_log_get_threshold_ms(void);
+
+// Enables or disables sampling the stack of the callbacks running at the
+// threshold. It costs a timer update per callback, and is off by default.
+void stall_log_set_sampling(bool enable);
+
+// Called by the reactor around each callback on the calling thread, with
+// the function it calls. The callbacks nested in a callback are part of it.
+// |stall_log_dispatch_end| takes the start and run times measured by the
+// reactor.
+void stall_log_dispatch_start(const void* function);
+void stall_log_dispatch_end(uint64_t start_us, uint64_t run_us);
+
+// Tells the origin of the callback running on the calling thread, more
+// precise than its function: the function a work item runs, or the site a
+// closure was posted from. |function| and |file| must be string literals.
+// Does nothing outside of a callback.
+void stall_log_set_origin_function(const void* function);
+void stall_log_set_origin(const char* function, const char* file, int line);
+
+// Returns the number of stalls recorded since the start.
+uint64_t stall_log_get_count(void);
+
+// Drops the stalls recorded.
+void stall_log_clear(void);
+
+// Writes the stalls recorded, most recent last, to the |fd| file
+// descriptor.
+void stall_log_debug_dump(int fd);
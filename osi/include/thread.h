@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #define THREAD_NAME_MAX 16
@@ -61,7 +62,9 @@ bool thread_post(thread_t* thread, thread_fn func, void* context);
 void thread_stop(thread_t* thread);
 
 // Attempts to sets the |priority| of a given |thread|.
-// The |thread| has to be running for this call to succeed.
+// The |thread| has to be running for this call to succeed. A |thread| with a
+// scheduling policy in the stack configuration keeps it (see
+// osi/include/thread_policy.h).
 // Returns true on success.
 bool thread_set_priority(thread_t* thread, int priority);
 
@@ -69,9 +72,16 @@ bool thread_set_priority(thread_t* thread, int priority);
 // The |thread| has to be running for this call to succeed.
 // Priority values are valid in the range sched_get_priority_max(SCHED_FIFO)
 // to sched_get_priority_min(SCHED_FIFO).  Larger values are higher priority.
+// As with |thread_set_priority|, a configured scheduling policy is kept.
 // Returns true on success.
 bool thread_set_rt_priority(thread_t* thread, int priority);
 
+// Attempts to restrict |thread| to the CPUs set in |cpu_mask|, where bit N
+// stands for CPU N. The |thread| has to be running for this call to succeed.
+// |cpu_mask| may not be 0. A |thread| with CPUs in its configured policy keeps
+// them. Returns true on success.
+bool thread_set_cpu_affinity(thread_t* thread, uint64_t cpu_mask);
+
 // Returns true if the current thread is the same as the one represented by
 // |thread|.
 // |thread| may not be NULL.
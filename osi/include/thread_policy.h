@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "osi/include/config.h"
+
+// The thread policies pin the stack threads to CPUs and set their
+// scheduling, by thread name, from sections of the stack configuration:
+//
+//   [ThreadPolicy:hci_thread]
+//   CpuMask=0xf0
+//   SchedClass=fifo
+//   Priority=2
+//
+// The names are the ones given to |thread_new|, cut to |THREAD_NAME_MAX|.
+// SchedClass is one of "other", "batch", "idle", "fifo", "rr" and
+// "deadline". Priority is the nice value of the "other" and "batch"
+// classes, and the real-time priority of "fifo" and "rr". The "deadline"
+// class takes RuntimeUs, DeadlineUs and PeriodUs instead.
+//
+// The threads register themselves by name when they start; a policy is
+// applied to the registered threads when it is loaded, and to the threads
+// starting afterwards. A thread with a policy keeps the scheduling and the
+// CPUs of the policy when the code asks for others. All functions are
+// thread-safe.
+
+#define THREAD_POLICY_SECTION_PREFIX "ThreadPolicy:"
+
+typedef enum {
+  THREAD_SCHED_KEEP = 0,  // Keep the scheduling of the thread
+  THREAD_SCHED_OTHER,
+  THREAD_SCHED_BATCH,
+  THREAD_SCHED_IDLE,
+  THREAD_SCHED_FIFO,
+  THREAD_SCHED_RR,
+  THREAD_SCHED_DEADLINE,
+} thread_sched_class_t;
+
+typedef struct {
+  uint64_t cpu_mask;  // Bit N for CPU N, 0 to keep the CPUs of the thread
+  thread_sched_class_t sched_class;
+  int priority;
+  uint64_t runtime_us;  // The budget of the "deadline" class
+  uint64_t deadline_us;
+  uint64_t period_us;
+} thread_policy_t;
+
+// Replaces the policies with the ones of the |ThreadPolicy:| sections of
+// |config|, and applies them to the registered threads. |config| may be
+// NULL, which drops the policies.
+void thread_policy_load(const config_t* config);
+
+// Fills |policy| with the policy of the threads named |name|. Returns false
+// if they have none.
+bool thread_policy_get(const char* name, thread_policy_t* policy);
+
+// Applies |policy| to the thread |tid|. Returns true on success.
+bool thread_policy_apply(pid_t tid, const thread_policy_t* policy);
+
+// Registers the thread |tid| under |name|, and applies the policy of |name|
+// to it if there is one. |thread_policy_unregister| is called before the
+// thread exits.
+void thread_policy_register(pid_t tid, const char* name);
+void thread_policy_unregister(pid_t tid);
+
+// Returns true if the policy of the registered thread |tid| sets its
+// scheduling, or its CPUs.
+bool thread_policy_sets_scheduling(pid_t tid);
+bool thread_policy_sets_cpu_affinity(pid_t tid);
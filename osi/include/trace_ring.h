@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+
+// The trace ring keeps the most recent traces in binary form: each record
+// holds the format string pointer and the raw arguments, and the traces are
+// only formatted when the ring is dumped. This keeps verbose tracing cheap
+// enough for the hot paths, as no trace is formatted or sent to the log
+// daemon when it is recorded.
+//
+// The format strings must outlive the ring, i.e. be string literals. The
+// string arguments are copied, and may be truncated. At most
+// |TRACE_RING_MAX_ARGS| arguments are kept; the "%n" conversion is not
+// supported.
+//
+// The trace ring is opt-in: until |trace_ring_init| is called, nothing is
+// recorded. All functions are thread-safe.
+
+// The number of records kept in the ring, as a power of two.
+#define TRACE_RING_SIZE 2048
+
+// The number of arguments kept in each record, counting the '*' widths and
+// precisions.
+#define TRACE_RING_MAX_ARGS 8
+
+typedef enum {
+  TRACE_RING_ERROR = 0,
+  TRACE_RING_WARN,
+  TRACE_RING_INFO,
+  TRACE_RING_DEBUG,
+  TRACE_RING_VERBOSE
+} trace_ring_priority_t;
+
+// Records the traces of the hot paths in the trace ring, if it is enabled.
+// The arguments are not evaluated otherwise.
+#define TRACE_RING_LOG(priority, tag, fmt, args...)     \
+  do {                                                  \
+    if (trace_ring_is_enabled())                        \
+      trace_ring_log((priority), (tag), (fmt), ##args); \
+  } while (0)
+
+// Allocates the ring and enables the recording. Calling it again has no
+// effect. The ring is never released.
+void trace_ring_init(void);
+
+// Returns true if the trace ring is enabled.
+bool trace_ring_is_enabled(void);
+
+// Records a trace of |priority| for the log tag |tag|, formatted as |fmt|
+// with the following arguments. Both |tag| and |fmt| must be string
+// literals. Does nothing if the ring is not enabled.
+void trace_ring_log(trace_ring_priority_t priority, const char* tag,
+                    const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Same as |trace_ring_log|, with the arguments of |fmt| in |ap|.
+void trace_ring_vlog(trace_ring_priority_t priority, const char* tag,
+                     const char* fmt, va_list ap);
+
+// Formats the records of the ring, oldest first, to the |fd| file
+// descriptor.
+void trace_ring_debug_dump(int fd);
@@ -21,22 +21,53 @@
 #include <hardware/bluetooth.h>
 #include <stdbool.h>
 
+#include "osi/include/time.h"
+
+// The users of the Bluetooth wakelock, accounted separately.
+typedef enum {
+  WAKELOCK_REASON_ALARM = 0,  // An alarm is about to expire
+  WAKELOCK_REASON_MEDIA,      // The A2DP media path is running
+  WAKELOCK_REASON_HCI,        // HCI commands are waiting for a response
+  WAKELOCK_REASON_MAX
+} wakelock_reason_t;
+
 // Set the Bluetooth OS callouts to |callouts|.
 // This function should be called when native kernel wakelocks are not used
 // directly. If this function is not called, or |callouts| is NULL, then native
 // kernel wakelocks will be used.
 void wakelock_set_os_callouts(bt_os_callouts_t* callouts);
 
-// Acquire the Bluetooth wakelock.
+// Acquire the Bluetooth wakelock for the alarms.
 // The function is thread safe.
 // Return true on success, otherwise false.
 bool wakelock_acquire(void);
 
-// Release the Bluetooth wakelock.
+// Release the Bluetooth wakelock for the alarms.
 // The function is thread safe.
 // Return true on success, otherwise false.
 bool wakelock_release(void);
 
+// Acquire the Bluetooth wakelock for |reason|.
+// The wakelock is reference counted: the OS wakelock is held as long as any
+// reason holds it, plus the release delay. Each acquire must be paired with
+// a wakelock_release_reason() for the same reason.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_acquire_reason(wakelock_reason_t reason);
+
+// Release the Bluetooth wakelock for |reason|.
+// Once no reason holds it, the OS wakelock is released after the release
+// delay, unless it is acquired again meanwhile.
+// The function is thread safe.
+// Return true on success, otherwise false.
+bool wakelock_release_reason(wakelock_reason_t reason);
+
+// Set the time the OS wakelock is kept after its last release to
+// |delay_ms|, so that short release and acquire cycles don't reach the OS.
+// Zero releases it right away. The default is restored by
+// wakelock_cleanup().
+void wakelock_set_release_delay_ms(period_ms_t delay_ms);
+
 // Cleanup the wakelock internal state.
 // This function should be called by the OSI module cleanup during
 // graceful shutdown.
@@ -30,7 +30,9 @@
 #include <pthread.h>
 #include <signal.h>
 #include <string.h>
+#include <sys/timerfd.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <hardware/bluetooth.h>
 
@@ -38,9 +40,9 @@
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 #include "osi/include/thread.h"
 #include "osi/include/wakelock.h"
@@ -77,6 +79,7 @@ struct alarm_t {
   std::recursive_mutex* callback_mutex;
   period_ms_t creation_time;
   period_ms_t period;
+  period_ms_t slack;  // Deferral of the deadline allowed to the scheduler
   period_ms_t deadline;
   period_ms_t prev_deadline;  // Previous deadline - used for accounting of
                               // periodic timers
@@ -85,8 +88,37 @@ struct alarm_t {
   alarm_callback_t callback;
   void* data;
   alarm_stats_t stats;
+  struct alarm_heap_t* heap;  // The heap the alarm is pending in, or NULL
+  size_t heap_index;          // Position in |heap|, if pending
+  uint64_t heap_sequence;     // Orders the alarms with the same deadline
 };
 
+// The pending alarms, kept as a binary min-heap on the deadline. Each alarm
+// tracks its own position in the heap, so that setting and canceling it are
+// O(log n) instead of a walk of a sorted list.
+typedef struct alarm_heap_t {
+  alarm_t** items;
+  size_t size;
+  size_t capacity;
+  uint64_t next_sequence;
+} alarm_heap_t;
+
+#define ALARM_NOT_PENDING SIZE_MAX
+#define ALARM_HEAP_INITIAL_CAPACITY 64
+
+// A processing queue whose alarms are dispatched by its own thread, from a
+// timerfd in the thread reactor, rather than by |dispatcher_thread| adding
+// them to the queue. This saves two thread switches per expiration.
+typedef struct {
+  fixed_queue_t* queue;
+  int timer_fd;
+  reactor_object_t* reactor_object;
+  alarm_heap_t* heap;          // The pending alarms of |queue|
+  period_ms_t armed_deadline;  // The deadline |timer_fd| is armed for, or 0
+} alarm_direct_queue_t;
+
+#define ALARM_MAX_DIRECT_QUEUES 8
+
 // If the next wakeup time is less than this threshold, we should acquire
 // a wakelock instead of setting a wake alarm so we're not bouncing in
 // and out of suspend frequently. This value is externally visible to allow
@@ -102,12 +134,20 @@ static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME_ALARM;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| heap and the |direct_queues|.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+static alarm_heap_t* alarms;  // The alarms of the other processing queues
+static alarm_direct_queue_t direct_queues[ALARM_MAX_DIRECT_QUEUES];
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
+static bool wakelock_held;
+
+// The dispatched expirations, and how many of them were due at the same time
+// as the previous one, thus saving a wakeup.
+static size_t expiration_count;
+static size_t coalesced_count;
+static period_ms_t last_expiration_deadline;
 
 // All alarm callbacks are dispatched from |dispatcher_thread|
 static thread_t* dispatcher_thread;
@@ -122,13 +162,18 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static period_ms_t now(void);
 static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue);
+                               period_ms_t slack, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
+static void alarm_direct_queue_ready(void* context);
+static void register_processing_queue(fixed_queue_t* queue, thread_t* thread);
+static void unregister_direct_queue(alarm_direct_queue_t* direct);
+static void dispatch_alarm(std::unique_lock<std::mutex>& lock,
+                           alarm_t* alarm);
 static void timer_callback(void* data);
 static void callback_dispatch(void* context);
 static bool timer_create_internal(const clockid_t clock_id, timer_t* timer);
@@ -136,6 +181,134 @@ static void update_scheduling_stats(alarm_stats_t* stats, period_ms_t now_ms,
                                     period_ms_t deadline_ms,
                                     period_ms_t execution_delta_ms);
 
+static alarm_heap_t* alarm_heap_new(void) {
+  alarm_heap_t* heap =
+      static_cast<alarm_heap_t*>(osi_calloc(sizeof(alarm_heap_t)));
+  heap->capacity = ALARM_HEAP_INITIAL_CAPACITY;
+  heap->items =
+      static_cast<alarm_t**>(osi_malloc(heap->capacity * sizeof(alarm_t*)));
+  return heap;
+}
+
+static void alarm_heap_free(alarm_heap_t* heap) {
+  if (heap == NULL) return;
+
+  for (size_t i = 0; i < heap->size; i++) {
+    heap->items[i]->heap = NULL;
+    heap->items[i]->heap_index = ALARM_NOT_PENDING;
+  }
+  osi_free(heap->items);
+  osi_free(heap);
+}
+
+// Returns the pending alarm with the earliest deadline, or NULL if none.
+static alarm_t* alarm_heap_front(const alarm_heap_t* heap) {
+  return (heap->size == 0) ? NULL : heap->items[0];
+}
+
+static bool alarm_heap_is_before(const alarm_t* a, const alarm_t* b) {
+  if (a->deadline != b->deadline) return a->deadline < b->deadline;
+  return a->heap_sequence < b->heap_sequence;
+}
+
+static void alarm_heap_place(alarm_heap_t* heap, size_t index,
+                             alarm_t* alarm) {
+  heap->items[index] = alarm;
+  alarm->heap_index = index;
+}
+
+// Moves the alarm at |index| to its place in the heap.
+static void alarm_heap_sift(alarm_heap_t* heap, size_t index) {
+  alarm_t* alarm = heap->items[index];
+
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!alarm_heap_is_before(alarm, heap->items[parent])) break;
+    alarm_heap_place(heap, index, heap->items[parent]);
+    index = parent;
+  }
+
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= heap->size) break;
+    if (child + 1 < heap->size &&
+        alarm_heap_is_before(heap->items[child + 1], heap->items[child]))
+      child++;
+    if (!alarm_heap_is_before(heap->items[child], alarm)) break;
+    alarm_heap_place(heap, index, heap->items[child]);
+    index = child;
+  }
+
+  alarm_heap_place(heap, index, alarm);
+}
+
+static void alarm_heap_push(alarm_heap_t* heap, alarm_t* alarm) {
+  if (heap->size == heap->capacity) {
+    heap->capacity *= 2;
+    alarm_t** items =
+        static_cast<alarm_t**>(osi_malloc(heap->capacity * sizeof(alarm_t*)));
+    memcpy(items, heap->items, heap->size * sizeof(alarm_t*));
+    osi_free(heap->items);
+    heap->items = items;
+  }
+
+  // The alarms with the same deadline expire in the order they were set
+  alarm->heap = heap;
+  alarm->heap_sequence = heap->next_sequence++;
+  alarm_heap_place(heap, heap->size++, alarm);
+  alarm_heap_sift(heap, alarm->heap_index);
+}
+
+// Removes |alarm| from its heap, if it is pending.
+static void alarm_heap_remove(alarm_t* alarm) {
+  alarm_heap_t* heap = alarm->heap;
+  size_t index = alarm->heap_index;
+  if (heap == NULL) return;
+
+  CHECK(index < heap->size && heap->items[index] == alarm);
+  alarm->heap = NULL;
+  alarm->heap_index = ALARM_NOT_PENDING;
+  heap->size--;
+  if (index == heap->size) return;
+
+  alarm_heap_place(heap, index, heap->items[heap->size]);
+  alarm_heap_sift(heap, index);
+}
+
+// Returns the direct dispatch of |queue|, or NULL if it has none.
+// Must be called with |alarms_mutex| held
+static alarm_direct_queue_t* find_direct_queue(const fixed_queue_t* queue) {
+  for (alarm_direct_queue_t& direct : direct_queues) {
+    if (direct.queue != NULL && direct.queue == queue) return &direct;
+  }
+  return NULL;
+}
+
+// Returns the heap the alarms on |queue| are pending in.
+// Must be called with |alarms_mutex| held
+static alarm_heap_t* heap_for_queue(const fixed_queue_t* queue) {
+  alarm_direct_queue_t* direct = find_direct_queue(queue);
+  return (direct != NULL) ? direct->heap : alarms;
+}
+
+// Returns true if |alarm| expires first among the alarms of its heap.
+static bool is_next_in_heap(const alarm_t* alarm) {
+  return alarm->heap != NULL && alarm_heap_front(alarm->heap) == alarm;
+}
+
+// Returns the pending alarm with the earliest deadline among all the heaps.
+// Must be called with |alarms_mutex| held
+static alarm_t* earliest_alarm(void) {
+  alarm_t* next = alarm_heap_front(alarms);
+  for (const alarm_direct_queue_t& direct : direct_queues) {
+    if (direct.queue == NULL) continue;
+    alarm_t* alarm = alarm_heap_front(direct.heap);
+    if (alarm != NULL && (next == NULL || alarm->deadline < next->deadline))
+      next = alarm;
+  }
+  return next;
+}
+
 static void update_stat(stat_t* stat, period_ms_t delta) {
   if (stat->max_ms < delta) stat->max_ms = delta;
   stat->total_ms += delta;
@@ -160,6 +333,7 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   ret->callback_mutex = new std::recursive_mutex;
   ret->is_periodic = is_periodic;
   ret->stats.name = osi_strdup(name);
+  ret->heap_index = ALARM_NOT_PENDING;
   // NOTE: The stats were reset by osi_calloc() above
 
   return ret;
@@ -193,13 +367,27 @@ void alarm_set(alarm_t* alarm, period_ms_t interval_ms, alarm_callback_t cb,
 void alarm_set_on_queue(alarm_t* alarm, period_ms_t interval_ms,
                         alarm_callback_t cb, void* data, fixed_queue_t* queue) {
   CHECK(queue != NULL);
-  alarm_set_internal(alarm, interval_ms, cb, data, queue);
+  alarm_set_internal(alarm, interval_ms, 0, cb, data, queue);
+}
+
+void alarm_set_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                          period_ms_t slack_ms, alarm_callback_t cb,
+                          void* data) {
+  alarm_set_on_queue_with_slack(alarm, interval_ms, slack_ms, cb, data,
+                                default_callback_queue);
+}
+
+void alarm_set_on_queue_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                                   period_ms_t slack_ms, alarm_callback_t cb,
+                                   void* data, fixed_queue_t* queue) {
+  CHECK(queue != NULL);
+  alarm_set_internal(alarm, interval_ms, slack_ms, cb, data, queue);
 }
 
 // Runs in exclusion with alarm_cancel and timer_callback.
 static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
-                               alarm_callback_t cb, void* data,
-                               fixed_queue_t* queue) {
+                               period_ms_t slack, alarm_callback_t cb,
+                               void* data, fixed_queue_t* queue) {
   CHECK(alarms != NULL);
   CHECK(alarm != NULL);
   CHECK(cb != NULL);
@@ -208,6 +396,7 @@ static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
 
   alarm->creation_time = now();
   alarm->period = period;
+  alarm->slack = slack;
   alarm->queue = queue;
   alarm->callback = cb;
   alarm->data = data;
@@ -232,8 +421,7 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = is_next_in_heap(alarm);
 
   remove_pending_alarm(alarm);
 
@@ -261,6 +449,8 @@ void alarm_cleanup(void) {
   thread_free(dispatcher_thread);
   dispatcher_thread = NULL;
 
+  alarm_unregister_processing_queue(default_callback_queue);
+
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
   fixed_queue_free(default_callback_queue, NULL);
@@ -273,7 +463,7 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  alarm_heap_free(alarms);
   alarms = NULL;
 }
 
@@ -287,11 +477,7 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
-    goto error;
-  }
+  alarms = alarm_heap_new();
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -319,8 +505,7 @@ static bool lazy_initialize(void) {
               __func__);
     goto error;
   }
-  alarm_register_processing_queue(default_callback_queue,
-                                  default_callback_thread);
+  register_processing_queue(default_callback_queue, default_callback_thread);
 
   dispatcher_thread_active = true;
   dispatcher_thread = thread_new("alarm_dispatcher");
@@ -333,6 +518,11 @@ static bool lazy_initialize(void) {
   return true;
 
 error:
+  if (default_callback_queue != NULL) {
+    alarm_direct_queue_t* direct = find_direct_queue(default_callback_queue);
+    if (direct != NULL) unregister_direct_queue(direct);
+    fixed_queue_unregister_dequeue(default_callback_queue);
+  }
   fixed_queue_free(default_callback_queue, NULL);
   default_callback_queue = NULL;
   thread_free(default_callback_thread);
@@ -350,7 +540,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  alarm_heap_free(alarms);
   alarms = NULL;
 
   return false;
@@ -369,22 +559,32 @@ static period_ms_t now(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+// Remove alarm from internal alarm heap and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  alarm_heap_remove(alarm);
   while (fixed_queue_try_remove_from_queue(alarm->queue, alarm) != NULL) {
     // Remove all repeated alarm instances from the queue.
     // NOTE: We are defensive here - we shouldn't have repeated alarm instances
   }
 }
 
+// Returns the time within |slack| after |deadline| with the most trailing
+// zero bits, so that the alarms whose slack windows overlap tend to get the
+// very same deadline, and expire on a single wakeup.
+static period_ms_t apply_slack(period_ms_t deadline, period_ms_t slack) {
+  if (slack == 0) return deadline;
+
+  period_ms_t latest = deadline + slack;
+  period_ms_t mask = 1ULL << (63 - __builtin_clzll(deadline ^ latest));
+  return latest & ~(mask - 1);
+}
+
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  // If the alarm is currently set and it's the earliest one, we'll need to
+  // re-schedule since we've adjusted the earliest deadline.
+  bool needs_reschedule = is_next_in_heap(alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -392,58 +592,79 @@ static void schedule_next_instance(alarm_t* alarm) {
   period_ms_t ms_into_period = 0;
   if ((alarm->is_periodic) && (alarm->period != 0))
     ms_into_period = ((just_now - alarm->creation_time) % alarm->period);
-  alarm->deadline = just_now + (alarm->period - ms_into_period);
+  alarm->deadline =
+      apply_slack(just_now + (alarm->period - ms_into_period), alarm->slack);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline > alarm->deadline) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline > alarm->deadline) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  // Add it into the timer heap ordered by deadline (earliest deadline first).
+  alarm_heap_push(heap_for_queue(alarm->queue), alarm);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || is_next_in_heap(alarm)) {
     reschedule_root_alarm();
   }
 }
 
+// Arms the timerfd of each direct queue for its earliest alarm.
+// NOTE: must be called with |alarms_mutex| held
+static void rearm_direct_queues(void) {
+  for (alarm_direct_queue_t& direct : direct_queues) {
+    if (direct.queue == NULL) continue;
+
+    alarm_t* next = alarm_heap_front(direct.heap);
+    period_ms_t deadline = (next != NULL) ? next->deadline : 0;
+    if (deadline == direct.armed_deadline) continue;
+
+    // If used in a zeroed state, disarms the timer.
+    struct itimerspec timer_time;
+    memset(&timer_time, 0, sizeof(timer_time));
+    timer_time.it_value.tv_sec = (deadline / 1000);
+    timer_time.it_value.tv_nsec = (deadline % 1000) * 1000000LL;
+    if (timerfd_settime(direct.timer_fd, TFD_TIMER_ABSTIME, &timer_time,
+                        NULL) == -1)
+      LOG_ERROR(LOG_TAG, "%s unable to set timerfd: %s", __func__,
+                strerror(errno));
+    direct.armed_deadline = deadline;
+  }
+}
+
 // NOTE: must be called with |alarms_mutex| held
 static void reschedule_root_alarm(void) {
   CHECK(alarms != NULL);
 
-  const bool timer_was_set = timer_set;
+  const bool wakelock_was_held = wakelock_held;
   alarm_t* next;
+  alarm_t* next_dispatched;
   int64_t next_expiration;
 
   // If used in a zeroed state, disarms the timer.
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  rearm_direct_queues();
+
+  wakelock_held = false;
+  next = earliest_alarm();
+  if (next == NULL) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
   next_expiration = next->deadline - now();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
-    if (!timer_set) {
+    if (!wakelock_was_held) {
       if (!wakelock_acquire()) {
         LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock", __func__);
         goto done;
       }
     }
-
-    timer_time.it_value.tv_sec = (next->deadline / 1000);
-    timer_time.it_value.tv_nsec = (next->deadline % 1000) * 1000000LL;
+    wakelock_held = true;
+
+    // The alarms of the direct queues are expired by their own timerfd, so
+    // |timer| is only needed for the others.
+    next_dispatched = alarm_heap_front(alarms);
+    if (next_dispatched != NULL) {
+      timer_time.it_value.tv_sec = (next_dispatched->deadline / 1000);
+      timer_time.it_value.tv_nsec =
+          (next_dispatched->deadline % 1000) * 1000000LL;
+    }
 
     // It is entirely unsafe to call timer_settime(2) with a zeroed timerspec
     // for timers with *_ALARM clock IDs. Although the man page states that the
@@ -478,7 +699,7 @@ static void reschedule_root_alarm(void) {
 done:
   timer_set =
       timer_time.it_value.tv_sec != 0 || timer_time.it_value.tv_nsec != 0;
-  if (timer_was_set && !timer_set) {
+  if (wakelock_was_held && !wakelock_held) {
     wakelock_release();
   }
 
@@ -513,8 +734,85 @@ void alarm_register_processing_queue(fixed_queue_t* queue, thread_t* thread) {
   CHECK(queue != NULL);
   CHECK(thread != NULL);
 
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  register_processing_queue(queue, thread);
+}
+
+// Returns the alarms of |heap| on |queue|, or all of them if |queue| is NULL.
+// The returned array must be freed with |osi_free|.
+// Must be called with |alarms_mutex| held
+static alarm_t** collect_alarms(const alarm_heap_t* heap,
+                                const fixed_queue_t* queue, size_t* p_count) {
+  alarm_t** collected =
+      static_cast<alarm_t**>(osi_malloc((heap->size + 1) * sizeof(alarm_t*)));
+  *p_count = 0;
+  for (size_t i = 0; i < heap->size; i++) {
+    if (queue == NULL || heap->items[i]->queue == queue)
+      collected[(*p_count)++] = heap->items[i];
+  }
+  return collected;
+}
+
+// Must be called with |alarms_mutex| held
+static void register_processing_queue(fixed_queue_t* queue, thread_t* thread) {
+  // The alarms already added to |queue| are still dequeued from it
   fixed_queue_register_dequeue(queue, thread_get_reactor(thread),
                                alarm_queue_ready, NULL);
+
+  if (find_direct_queue(queue) != NULL) return;
+
+  alarm_direct_queue_t* direct = NULL;
+  for (alarm_direct_queue_t& slot : direct_queues) {
+    if (slot.queue == NULL) {
+      direct = &slot;
+      break;
+    }
+  }
+  if (direct == NULL) {
+    LOG_WARN(LOG_TAG, "%s no room to dispatch the alarms on their thread",
+             __func__);
+    return;
+  }
+
+  int timer_fd = timerfd_create(CLOCK_ID, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to create timerfd: %s", __func__,
+              strerror(errno));
+    return;
+  }
+
+  direct->queue = queue;
+  direct->timer_fd = timer_fd;
+  direct->heap = alarm_heap_new();
+  direct->armed_deadline = 0;
+  direct->reactor_object =
+      reactor_register(thread_get_reactor(thread), timer_fd, direct,
+                       alarm_direct_queue_ready, NULL);
+
+  // Move the alarms already set on |queue| to its own heap
+  if (alarms == NULL) return;
+  size_t count;
+  alarm_t** moved = collect_alarms(alarms, queue, &count);
+  for (size_t i = 0; i < count; i++) {
+    alarm_heap_remove(moved[i]);
+    alarm_heap_push(direct->heap, moved[i]);
+  }
+  osi_free(moved);
+  if (count > 0) reschedule_root_alarm();
+}
+
+// Cancels the alarms of |direct| and releases it. Its reactor object must
+// have been unregistered.
+// Must be called with |alarms_mutex| held
+static void unregister_direct_queue(alarm_direct_queue_t* direct) {
+  size_t count;
+  alarm_t** canceled = collect_alarms(direct->heap, NULL, &count);
+  for (size_t i = 0; i < count; i++) alarm_cancel_internal(canceled[i]);
+  osi_free(canceled);
+
+  close(direct->timer_fd);
+  alarm_heap_free(direct->heap);
+  memset(direct, 0, sizeof(*direct));
 }
 
 void alarm_unregister_processing_queue(fixed_queue_t* queue) {
@@ -523,16 +821,32 @@ void alarm_unregister_processing_queue(fixed_queue_t* queue) {
 
   fixed_queue_unregister_dequeue(queue);
 
-  // Cancel all alarms that are using this queue
-  std::lock_guard<std::mutex> lock(alarms_mutex);
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    node = list_next(node);
-    // TODO: Each module is responsible for tearing down its alarms; currently,
-    // this is not the case. In the future, this check should be replaced by
-    // an assert.
-    if (alarm->queue == queue) alarm_cancel_internal(alarm);
+  // Stop the dispatch on the queue thread first, without |alarms_mutex|
+  // since it is taken by the dispatch.
+  reactor_object_t* reactor_object = NULL;
+  {
+    std::lock_guard<std::mutex> lock(alarms_mutex);
+    alarm_direct_queue_t* direct = find_direct_queue(queue);
+    if (direct != NULL) {
+      reactor_object = direct->reactor_object;
+      direct->reactor_object = NULL;
+    }
   }
+  if (reactor_object != NULL) reactor_unregister(reactor_object);
+
+  // Cancel all alarms that are using this queue. Canceling an alarm
+  // reorders the heap, so they are collected first.
+  std::lock_guard<std::mutex> lock(alarms_mutex);
+  size_t count;
+  // TODO: Each module is responsible for tearing down its alarms; currently,
+  // this is not the case. In the future, this should be replaced by an
+  // assert.
+  alarm_t** canceled = collect_alarms(alarms, queue, &count);
+  for (size_t i = 0; i < count; i++) alarm_cancel_internal(canceled[i]);
+  osi_free(canceled);
+
+  alarm_direct_queue_t* direct = find_direct_queue(queue);
+  if (direct != NULL) unregister_direct_queue(direct);
 }
 
 static void alarm_queue_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
@@ -544,6 +858,55 @@ static void alarm_queue_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
     return;  // The alarm was probably canceled
   }
 
+  dispatch_alarm(lock, alarm);
+}
+
+// Accounts the expiration of |alarm|, which was just taken out of its heap,
+// and sets the next instance of a periodic alarm.
+// Must be called with |alarms_mutex| held
+static void expire_alarm(alarm_t* alarm) {
+  expiration_count++;
+  if (expiration_count > 1 && alarm->deadline == last_expiration_deadline)
+    coalesced_count++;
+  last_expiration_deadline = alarm->deadline;
+
+  if (alarm->is_periodic) {
+    alarm->prev_deadline = alarm->deadline;
+    schedule_next_instance(alarm);
+    alarm->stats.rescheduled_count++;
+  }
+  reschedule_root_alarm();
+}
+
+// Runs on the thread of a direct queue when its timerfd expires, and
+// executes its earliest alarm if it is due.
+static void alarm_direct_queue_ready(void* context) {
+  alarm_direct_queue_t* direct = static_cast<alarm_direct_queue_t*>(context);
+
+  uint64_t expirations;
+  ssize_t ret;
+  OSI_NO_INTR(ret = read(direct->timer_fd, &expirations, sizeof(expirations)));
+
+  std::unique_lock<std::mutex> lock(alarms_mutex);
+  // The timer is disarmed once expired, even if the next alarm has the same
+  // deadline.
+  direct->armed_deadline = 0;
+
+  // Take into account that the alarm may get cancelled before we get to it.
+  alarm_t* alarm = alarm_heap_front(direct->heap);
+  if (alarm == NULL || alarm->deadline > now()) {
+    reschedule_root_alarm();
+    return;
+  }
+
+  alarm_heap_remove(alarm);
+  expire_alarm(alarm);
+  dispatch_alarm(lock, alarm);
+}
+
+// Executes the callback of the expired |alarm|, releasing |lock| meanwhile.
+static void dispatch_alarm(std::unique_lock<std::mutex>& lock,
+                           alarm_t* alarm) {
   //
   // If the alarm is not periodic, we've fully serviced it now, and can reset
   // some of its internal state. This is useful to distinguish between expired
@@ -591,25 +954,18 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
+    alarm_t* alarm = alarm_heap_front(alarms);
 
     // Take into account that the alarm may get cancelled before we get to it.
     // We're done here if there are no alarms or the alarm at the front is in
     // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline > now()) {
+    if (alarm == NULL || alarm->deadline > now()) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
-
-    if (alarm->is_periodic) {
-      alarm->prev_deadline = alarm->deadline;
-      schedule_next_instance(alarm);
-      alarm->stats.rescheduled_count++;
-    }
-    reschedule_root_alarm();
+    alarm_heap_remove(alarm);
+    expire_alarm(alarm);
 
     // Enqueue the alarm for processing
     fixed_queue_enqueue(alarm->queue, alarm);
@@ -681,6 +1037,38 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
+static void dump_alarm(int fd, alarm_t* alarm, period_ms_t just_now) {
+  alarm_stats_t* stats = &alarm->stats;
+
+  dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
+          (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
+
+  dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
+          "    Action counts (sched/resched/exec/cancel)",
+          stats->scheduled_count, stats->rescheduled_count,
+          stats->callback_execution.count, stats->canceled_count);
+
+  dprintf(fd, "%-51s: %zu / %zu\n", "    Deviation counts (overdue/premature)",
+          stats->overdue_scheduling.count, stats->premature_scheduling.count);
+
+  dprintf(fd, "%-51s: %llu / %llu / %lld\n",
+          "    Time in ms (since creation/interval/remaining)",
+          (unsigned long long)(just_now - alarm->creation_time),
+          (unsigned long long)alarm->period,
+          (long long)(alarm->deadline - just_now));
+
+  dump_stat(fd, &stats->callback_execution,
+            "    Callback execution time in ms (total/max/avg)");
+
+  dump_stat(fd, &stats->overdue_scheduling,
+            "    Overdue scheduling time in ms (total/max/avg)");
+
+  dump_stat(fd, &stats->premature_scheduling,
+            "    Premature scheduling time in ms (total/max/avg)");
+
+  dprintf(fd, "\n");
+}
+
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
@@ -693,41 +1081,26 @@ void alarm_debug_dump(int fd) {
 
   period_ms_t just_now = now();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
-
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    alarm_stats_t* stats = &alarm->stats;
-
-    dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
-            (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
-
-    dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
-            "    Action counts (sched/resched/exec/cancel)",
-            stats->scheduled_count, stats->rescheduled_count,
-            stats->callback_execution.count, stats->canceled_count);
-
-    dprintf(fd, "%-51s: %zu / %zu\n",
-            "    Deviation counts (overdue/premature)",
-            stats->overdue_scheduling.count, stats->premature_scheduling.count);
-
-    dprintf(fd, "%-51s: %llu / %llu / %lld\n",
-            "    Time in ms (since creation/interval/remaining)",
-            (unsigned long long)(just_now - alarm->creation_time),
-            (unsigned long long)alarm->period,
-            (long long)(alarm->deadline - just_now));
-
-    dump_stat(fd, &stats->callback_execution,
-              "    Callback execution time in ms (total/max/avg)");
-
-    dump_stat(fd, &stats->overdue_scheduling,
-              "    Overdue scheduling time in ms (total/max/avg)");
+  size_t total = alarms->size;
+  size_t num_direct_queues = 0;
+  for (const alarm_direct_queue_t& direct : direct_queues) {
+    if (direct.queue == NULL) continue;
+    total += direct.heap->size;
+    num_direct_queues++;
+  }
 
-    dump_stat(fd, &stats->premature_scheduling,
-              "    Premature scheduling time in ms (total/max/avg)");
+  dprintf(fd, "  Total Alarms: %zu\n", total);
+  dprintf(fd, "  Queues dispatched on their own thread: %zu\n",
+          num_direct_queues);
+  dprintf(fd, "  Expirations: %zu (%zu coalesced, saving a wakeup)\n\n",
+          expiration_count, coalesced_count);
 
-    dprintf(fd, "\n");
+  // Dump info for each alarm
+  for (size_t i = 0; i < alarms->size; i++)
+    dump_alarm(fd, alarms->items[i], just_now);
+  for (const alarm_direct_queue_t& direct : direct_queues) {
+    if (direct.queue == NULL) continue;
+    for (size_t i = 0; i < direct.heap->size; i++)
+      dump_alarm(fd, direct.heap->items[i], just_now);
   }
 }
@@ -174,10 +174,9 @@ size_t allocation_tracker_resize_for_canary(size_t size) {
   return (!enabled) ? size : size + (2 * canary_size);
 }
 
-void osi_allocator_debug_dump(int fd) {
-  dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
-
+void allocation_tracker_debug_dump(int fd) {
   std::unique_lock<std::mutex> lock(tracker_lock);
+  if (!enabled) return;
 
   dprintf(fd, "  Total allocated/free/used counts : %zu / %zu / %zu\n",
           alloc_counter, free_counter, alloc_counter - free_counter);
@@ -16,61 +16,129 @@
  *
  ******************************************************************************/
 #include <base/logging.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/pool.h"
+#include "osi/include/slab.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
-char* osi_strdup(const char* str) {
-  size_t size = strlen(str) + 1;  // + 1 for the null terminator
-  size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
+// Each allocation starts with a header that records what to account its
+// release to. It keeps the alignment of the heap for the buffer after it.
+typedef struct alignas(alignof(max_align_t)) {
+  size_t size;
+  osi_mem_category_t category;
+} allocation_header_t;
+
+typedef struct {
+  std::atomic<size_t> bytes;
+  std::atomic<size_t> objects;
+  std::atomic<size_t> peak_bytes;
+  std::atomic<size_t> peak_objects;
+} category_counters_t;
+
+static category_counters_t counters[OSI_MEM_NUM_CATEGORIES];
+
+static const char* const category_names[OSI_MEM_NUM_CATEGORIES] = {
+    "other", "hci", "l2cap", "gatt_cache", "a2dp", "btsnoop", "config"};
+
+static void raise_peak(std::atomic<size_t>& peak, size_t value) {
+  size_t current = peak.load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak.compare_exchange_weak(current, value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+static void account_alloc(osi_mem_category_t category, size_t size) {
+  category_counters_t& c = counters[category];
+  size_t bytes = c.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t objects = c.objects.fetch_add(1, std::memory_order_relaxed) + 1;
+  raise_peak(c.peak_bytes, bytes);
+  raise_peak(c.peak_objects, objects);
+}
+
+static void account_free(osi_mem_category_t category, size_t size) {
+  category_counters_t& c = counters[category];
+  c.bytes.fetch_sub(size, std::memory_order_relaxed);
+  c.objects.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Allocates |size| octets for |category| from the slab allocator if it is
+// enabled and has a size class for them, otherwise from the heap. Returns
+// the buffer after the header and the allocation tracker canary.
+static void* allocate(size_t size, osi_mem_category_t category, bool zero) {
+  CHECK(category < OSI_MEM_NUM_CATEGORIES);
+  size_t real_size =
+      sizeof(allocation_header_t) + allocation_tracker_resize_for_canary(size);
+  void* ptr = slab_alloc(real_size);
+  if (ptr != NULL) {
+    if (zero) memset(ptr, 0, real_size);
+  } else {
+    ptr = zero ? calloc(1, real_size) : malloc(real_size);
+  }
   CHECK(ptr);
 
-  char* new_string = static_cast<char*>(
-      allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size));
-  if (!new_string) return NULL;
+  allocation_header_t* header = static_cast<allocation_header_t*>(ptr);
+  header->size = size;
+  header->category = category;
+  account_alloc(category, size);
+
+  return allocation_tracker_notify_alloc(alloc_allocator_id, header + 1, size);
+}
 
+char* osi_strdup_tagged(const char* str, osi_mem_category_t category) {
+  size_t size = strlen(str) + 1;  // + 1 for the null terminator
+  char* new_string = static_cast<char*>(allocate(size, category, false));
   memcpy(new_string, str, size);
   return new_string;
 }
 
+char* osi_strdup(const char* str) {
+  return osi_strdup_tagged(str, OSI_MEM_OTHER);
+}
+
 char* osi_strndup(const char* str, size_t len) {
   size_t size = strlen(str);
   if (len < size) size = len;
 
-  size_t real_size = allocation_tracker_resize_for_canary(size + 1);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
-
-  char* new_string = static_cast<char*>(
-      allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size + 1));
-  if (!new_string) return NULL;
-
+  char* new_string =
+      static_cast<char*>(allocate(size + 1, OSI_MEM_OTHER, false));
   memcpy(new_string, str, size);
   new_string[size] = '\0';
   return new_string;
 }
 
-void* osi_malloc(size_t size) {
-  size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = malloc(real_size);
-  CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+void* osi_malloc_tagged(size_t size, osi_mem_category_t category) {
+  return allocate(size, category, false);
 }
 
-void* osi_calloc(size_t size) {
-  size_t real_size = allocation_tracker_resize_for_canary(size);
-  void* ptr = calloc(1, real_size);
-  CHECK(ptr);
-  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+void* osi_calloc_tagged(size_t size, osi_mem_category_t category) {
+  return allocate(size, category, true);
 }
 
+void* osi_malloc(size_t size) { return allocate(size, OSI_MEM_OTHER, false); }
+
+void* osi_calloc(size_t size) { return allocate(size, OSI_MEM_OTHER, true); }
+
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  if (ptr == NULL) return;
+
+  // Buffers taken from a pool go back to their pool, not to the heap
+  if (pool_release(ptr)) return;
+
+  allocation_header_t* header =
+      static_cast<allocation_header_t*>(
+          allocation_tracker_notify_free(alloc_allocator_id, ptr)) -
+      1;
+  account_free(header->category, header->size);
+  if (!slab_release(header)) free(header);
 }
 
 void osi_free_and_reset(void** p_ptr) {
@@ -79,6 +147,33 @@ void osi_free_and_reset(void** p_ptr) {
   *p_ptr = NULL;
 }
 
+void osi_allocator_get_stats(osi_mem_category_t category,
+                             osi_mem_stats_t* stats) {
+  CHECK(category < OSI_MEM_NUM_CATEGORIES);
+  CHECK(stats != NULL);
+  const category_counters_t& c = counters[category];
+  stats->bytes = c.bytes.load(std::memory_order_relaxed);
+  stats->objects = c.objects.load(std::memory_order_relaxed);
+  stats->peak_bytes = c.peak_bytes.load(std::memory_order_relaxed);
+  stats->peak_objects = c.peak_objects.load(std::memory_order_relaxed);
+}
+
+void osi_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Memory Allocation Statistics:\n");
+  allocation_tracker_debug_dump(fd);
+
+  dprintf(fd, "  %-12s %12s %10s %12s %10s\n", "Subsystem", "Octets",
+          "Objects", "Peak octets", "Peak objs");
+  for (int i = 0; i < OSI_MEM_NUM_CATEGORIES; i++) {
+    osi_mem_stats_t stats;
+    osi_allocator_get_stats(static_cast<osi_mem_category_t>(i), &stats);
+    dprintf(fd, "  %-12s %12zu %10zu %12zu %10zu\n", category_names[i],
+            stats.bytes, stats.objects, stats.peak_bytes, stats.peak_objects);
+  }
+
+  slab_debug_dump(fd);
+}
+
 const allocator_t allocator_calloc = {osi_calloc, osi_free};
 
 const allocator_t allocator_malloc = {osi_malloc, osi_free};
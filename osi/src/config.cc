@@ -28,55 +28,142 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "osi/include/allocator.h"
-#include "osi/include/list.h"
+#include "osi/include/ilist.h"
 #include "osi/include/log.h"
 
 typedef struct {
-  char* key;
+  ilist_link_t link;  // In the |entries| of the section
+  const char* key;    // Interned, see |intern_key|
   char* value;
 } entry_t;
 
 typedef struct {
+  ilist_link_t link;  // In the |sections| of the config
   char* name;
-  list_t* entries;
+  ilist_t entries;
 } section_t;
 
+namespace {
+
+// Hashes and compares C strings by value, so that the indexes below can be
+// looked up with the strings given by the caller, without copying them.
+struct CStringHash {
+  size_t operator()(const char* string) const {
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (; *string; string++) hash = (hash ^ (uint8_t)*string) * 16777619u;
+    return hash;
+  }
+};
+
+struct CStringEqual {
+  bool operator()(const char* a, const char* b) const {
+    return strcmp(a, b) == 0;
+  }
+};
+
+struct EntryKey {
+  const section_t* section;
+  const char* key;
+};
+
+struct EntryKeyHash {
+  size_t operator()(const EntryKey& entry_key) const {
+    return CStringHash()(entry_key.key) ^
+           std::hash<const section_t*>()(entry_key.section);
+  }
+};
+
+struct EntryKeyEqual {
+  bool operator()(const EntryKey& a, const EntryKey& b) const {
+    return a.section == b.section && CStringEqual()(a.key, b.key);
+  }
+};
+
+}  // namespace
+
 struct config_t {
-  list_t* sections;
+  ilist_t sections;
+
+  // The index keys point to the names of the sections and the keys of the
+  // entries they map to.
+  std::unordered_map<const char*, section_t*, CStringHash, CStringEqual>
+      section_index;
+  std::unordered_map<EntryKey, entry_t*, EntryKeyHash, EntryKeyEqual>
+      entry_index;
 };
 
-// Empty definition; this type is aliased to list_node_t.
+// The snapshot is a header, followed by the sections, the entries of all the
+// sections in order, and the string table the sections and entries point
+// into. It is in the byte order of the host, which is the only one to read
+// it.
+#define SNAPSHOT_MAGIC 0x53435442  // "BTCS"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  uint64_t source_inode;
+  int64_t source_mtime_sec;
+  int64_t source_mtime_nsec;
+  uint32_t section_count;
+  uint32_t entry_count;
+  uint32_t strings_size;
+  uint32_t checksum;  // Of everything after the header
+} snapshot_header_t;
+
+typedef struct {
+  uint32_t name;  // Offsets in the string table
+  uint32_t entry_count;
+} snapshot_section_t;
+
+typedef struct {
+  uint32_t key;
+  uint32_t value;
+} snapshot_entry_t;
+
+// Empty definition; this type is aliased to the ilist_link_t of a section.
 struct config_section_iter_t {};
 
+#define SECTION_OF(ptr) ILIST_ENTRY(ptr, section_t, link)
+#define ENTRY_OF(ptr) ILIST_ENTRY(ptr, entry_t, link)
+
 static bool config_parse(FILE* fp, config_t* config);
 
 static section_t* section_new(const char* name);
-static void section_free(void* ptr);
+static void section_free(section_t* section);
 static section_t* section_find(const config_t* config, const char* section);
 
 static entry_t* entry_new(const char* key, const char* value);
-static void entry_free(void* ptr);
+static void entry_free(entry_t* entry);
 static entry_t* entry_find(const config_t* config, const char* section,
                            const char* key);
+static entry_t* section_entry_find(const config_t* config,
+                                   const section_t* sec, const char* key);
+static void section_unindex(config_t* config, section_t* sec);
+static const char* intern_key(const char* key);
 
-config_t* config_new_empty(void) {
-  config_t* config = static_cast<config_t*>(osi_calloc(sizeof(config_t)));
+static bool snapshot_stamp(snapshot_header_t* header, const char* source);
+static uint32_t snapshot_checksum(const uint8_t* data, size_t length);
+static config_t* snapshot_load(const uint8_t* data, size_t length,
+                               const snapshot_header_t* stamp);
 
-  config->sections = list_new(section_free);
-  if (!config->sections) {
-    LOG_ERROR(LOG_TAG, "%s unable to allocate list for sections.", __func__);
-    goto error;
-  }
+config_t* config_new_empty(void) {
+  config_t* config = new config_t();
 
+  ilist_init(&config->sections);
   return config;
-
-error:;
-  config_free(config);
-  return NULL;
 }
 
 config_t* config_new(const char* filename) {
@@ -102,6 +189,48 @@ config_t* config_new(const char* filename) {
   return config;
 }
 
+config_t* config_new_snapshot(const char* filename, const char* source) {
+  CHECK(filename != NULL);
+  CHECK(source != NULL);
+
+  snapshot_header_t stamp;
+  if (!snapshot_stamp(&stamp, source)) return NULL;
+
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    if (errno != ENOENT)
+      LOG_WARN(LOG_TAG, "%s unable to open snapshot '%s': %s", __func__,
+               filename, strerror(errno));
+    return NULL;
+  }
+
+  struct stat snapshot_stat;
+  if (fstat(fd, &snapshot_stat) == -1 ||
+      (size_t)snapshot_stat.st_size < sizeof(snapshot_header_t)) {
+    LOG_WARN(LOG_TAG, "%s invalid snapshot '%s'", __func__, filename);
+    close(fd);
+    return NULL;
+  }
+
+  size_t length = snapshot_stat.st_size;
+  void* data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG_WARN(LOG_TAG, "%s unable to map snapshot '%s': %s", __func__,
+             filename, strerror(errno));
+    return NULL;
+  }
+
+  config_t* config =
+      snapshot_load(static_cast<const uint8_t*>(data), length, &stamp);
+  if (!config)
+    LOG_WARN(LOG_TAG, "%s ignoring stale or corrupted snapshot '%s'",
+             __func__, filename);
+
+  munmap(data, length);
+  return config;
+}
+
 config_t* config_new_clone(const config_t* src) {
   CHECK(src != NULL);
 
@@ -109,14 +238,14 @@ config_t* config_new_clone(const config_t* src) {
 
   CHECK(ret != NULL);
 
-  for (const list_node_t* node = list_begin(src->sections);
-       node != list_end(src->sections); node = list_next(node)) {
-    section_t* sec = static_cast<section_t*>(list_node(node));
+  for (const ilist_link_t* node = ilist_begin(&src->sections);
+       node != ilist_end(&src->sections); node = ilist_next(node)) {
+    const section_t* sec = SECTION_OF(node);
 
-    for (const list_node_t* node_entry = list_begin(sec->entries);
-         node_entry != list_end(sec->entries);
-         node_entry = list_next(node_entry)) {
-      entry_t* entry = static_cast<entry_t*>(list_node(node_entry));
+    for (const ilist_link_t* node_entry = ilist_begin(&sec->entries);
+         node_entry != ilist_end(&sec->entries);
+         node_entry = ilist_next(node_entry)) {
+      const entry_t* entry = ENTRY_OF(node_entry);
 
       config_set_string(ret, sec->name, entry->key, entry->value);
     }
@@ -128,8 +257,10 @@ config_t* config_new_clone(const config_t* src) {
 void config_free(config_t* config) {
   if (!config) return;
 
-  list_free(config->sections);
-  osi_free(config);
+  ilist_link_t* link;
+  while ((link = ilist_pop_front(&config->sections)) != NULL)
+    section_free(SECTION_OF(link));
+  delete config;
 }
 
 bool config_has_section(const config_t* config, const char* section) {
@@ -214,21 +345,20 @@ void config_set_string(config_t* config, const char* section, const char* key,
   section_t* sec = section_find(config, section);
   if (!sec) {
     sec = section_new(section);
-    list_append(config->sections, sec);
+    ilist_append(&config->sections, &sec->link);
+    config->section_index[sec->name] = sec;
   }
 
-  for (const list_node_t* node = list_begin(sec->entries);
-       node != list_end(sec->entries); node = list_next(node)) {
-    entry_t* entry = static_cast<entry_t*>(list_node(node));
-    if (!strcmp(entry->key, key)) {
-      osi_free(entry->value);
-      entry->value = osi_strdup(value);
-      return;
-    }
+  entry_t* entry = section_entry_find(config, sec, key);
+  if (entry) {
+    osi_free(entry->value);
+    entry->value = osi_strdup_tagged(value, OSI_MEM_CONFIG);
+    return;
   }
 
-  entry_t* entry = entry_new(key, value);
-  list_append(sec->entries, entry);
+  entry = entry_new(key, value);
+  ilist_append(&sec->entries, &entry->link);
+  config->entry_index[EntryKey{sec, entry->key}] = entry;
 }
 
 bool config_remove_section(config_t* config, const char* section) {
@@ -238,7 +368,10 @@ bool config_remove_section(config_t* config, const char* section) {
   section_t* sec = section_find(config, section);
   if (!sec) return false;
 
-  return list_remove(config->sections, sec);
+  section_unindex(config, sec);
+  ilist_remove(&config->sections, &sec->link);
+  section_free(sec);
+  return true;
 }
 
 bool config_remove_key(config_t* config, const char* section, const char* key) {
@@ -247,33 +380,35 @@ bool config_remove_key(config_t* config, const char* section, const char* key) {
   CHECK(key != NULL);
 
   section_t* sec = section_find(config, section);
-  entry_t* entry = entry_find(config, section, key);
-  if (!sec || !entry) return false;
+  if (!sec) return false;
+  entry_t* entry = section_entry_find(config, sec, key);
+  if (!entry) return false;
 
-  return list_remove(sec->entries, entry);
+  config->entry_index.erase(EntryKey{sec, entry->key});
+  ilist_remove(&sec->entries, &entry->link);
+  entry_free(entry);
+  return true;
 }
 
 const config_section_node_t* config_section_begin(const config_t* config) {
   CHECK(config != NULL);
-  return (const config_section_node_t*)list_begin(config->sections);
+  return (const config_section_node_t*)ilist_begin(&config->sections);
 }
 
 const config_section_node_t* config_section_end(const config_t* config) {
   CHECK(config != NULL);
-  return (const config_section_node_t*)list_end(config->sections);
+  return (const config_section_node_t*)ilist_end(&config->sections);
 }
 
 const config_section_node_t* config_section_next(
     const config_section_node_t* node) {
   CHECK(node != NULL);
-  return (const config_section_node_t*)list_next((const list_node_t*)node);
+  return (const config_section_node_t*)ilist_next((const ilist_link_t*)node);
 }
 
 const char* config_section_name(const config_section_node_t* node) {
   CHECK(node != NULL);
-  const list_node_t* lnode = (const list_node_t*)node;
-  const section_t* section = (const section_t*)list_node(lnode);
-  return section->name;
+  return SECTION_OF((const ilist_link_t*)node)->name;
 }
 
 bool config_save(const config_t* config, const char* filename) {
@@ -322,18 +457,18 @@ bool config_save(const config_t* config, const char* filename) {
     goto error;
   }
 
-  for (const list_node_t* node = list_begin(config->sections);
-       node != list_end(config->sections); node = list_next(node)) {
-    const section_t* section = (const section_t*)list_node(node);
+  for (const ilist_link_t* node = ilist_begin(&config->sections);
+       node != ilist_end(&config->sections); node = ilist_next(node)) {
+    const section_t* section = SECTION_OF(node);
     if (fprintf(fp, "[%s]\n", section->name) < 0) {
       LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
                 temp_filename, strerror(errno));
       goto error;
     }
 
-    for (const list_node_t* enode = list_begin(section->entries);
-         enode != list_end(section->entries); enode = list_next(enode)) {
-      const entry_t* entry = (const entry_t*)list_node(enode);
+    for (const ilist_link_t* enode = ilist_begin(&section->entries);
+         enode != ilist_end(&section->entries); enode = ilist_next(enode)) {
+      const entry_t* entry = ENTRY_OF(enode);
       if (fprintf(fp, "%s = %s\n", entry->key, entry->value) < 0) {
         LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
                   temp_filename, strerror(errno));
@@ -342,7 +477,7 @@ bool config_save(const config_t* config, const char* filename) {
     }
 
     // Only add a separating newline if there are more sections.
-    if (list_next(node) != list_end(config->sections)) {
+    if (ilist_next(node) != ilist_end(&config->sections)) {
       if (fputc('\n', fp) == EOF) {
         LOG_ERROR(LOG_TAG, "%s unable to write to file '%s': %s", __func__,
                   temp_filename, strerror(errno));
@@ -406,6 +541,73 @@ error:
   return false;
 }
 
+bool config_save_snapshot(const config_t* config, const char* filename,
+                          const char* source) {
+  CHECK(config != NULL);
+  CHECK(filename != NULL);
+  CHECK(source != NULL);
+
+  snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = SNAPSHOT_MAGIC;
+  header.version = SNAPSHOT_VERSION;
+  if (!snapshot_stamp(&header, source)) return false;
+
+  std::string sections;
+  std::string entries;
+  std::string strings;
+  for (const ilist_link_t* node = ilist_begin(&config->sections);
+       node != ilist_end(&config->sections); node = ilist_next(node)) {
+    const section_t* section = SECTION_OF(node);
+    snapshot_section_t snapshot_section = {(uint32_t)strings.size(),
+                                           (uint32_t)section->entries.length};
+    strings.append(section->name, strlen(section->name) + 1);
+    sections.append(reinterpret_cast<const char*>(&snapshot_section),
+                    sizeof(snapshot_section));
+    header.section_count++;
+
+    for (const ilist_link_t* enode = ilist_begin(&section->entries);
+         enode != ilist_end(&section->entries); enode = ilist_next(enode)) {
+      const entry_t* entry = ENTRY_OF(enode);
+      snapshot_entry_t snapshot_entry;
+      snapshot_entry.key = strings.size();
+      strings.append(entry->key, strlen(entry->key) + 1);
+      snapshot_entry.value = strings.size();
+      strings.append(entry->value, strlen(entry->value) + 1);
+      entries.append(reinterpret_cast<const char*>(&snapshot_entry),
+                     sizeof(snapshot_entry));
+      header.entry_count++;
+    }
+  }
+  header.strings_size = strings.size();
+
+  std::string body = sections + entries + strings;
+  header.checksum = snapshot_checksum(
+      reinterpret_cast<const uint8_t*>(body.data()), body.size());
+
+  // The snapshot is not synced to disk: a torn snapshot fails its checksum
+  // and the config file is loaded instead.
+  std::string temp_filename = std::string(filename) + ".new";
+  FILE* fp = fopen(temp_filename.c_str(), "wb");
+  if (!fp) {
+    LOG_ERROR(LOG_TAG, "%s unable to write file '%s': %s", __func__,
+              temp_filename.c_str(), strerror(errno));
+    return false;
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                 fwrite(body.data(), 1, body.size(), fp) == body.size();
+  if (fclose(fp) == EOF) written = false;
+  if (!written || rename(temp_filename.c_str(), filename) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to save snapshot '%s': %s", __func__,
+              filename, strerror(errno));
+    unlink(temp_filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
 static char* trim(char* str) {
   while (isspace(*str)) ++str;
 
@@ -459,45 +661,50 @@ static bool config_parse(FILE* fp, config_t* config) {
 }
 
 static section_t* section_new(const char* name) {
-  section_t* section = static_cast<section_t*>(osi_calloc(sizeof(section_t)));
+  section_t* section = static_cast<section_t*>(osi_calloc_tagged(
+      sizeof(section_t), OSI_MEM_CONFIG));
 
-  section->name = osi_strdup(name);
-  section->entries = list_new(entry_free);
+  section->name = osi_strdup_tagged(name, OSI_MEM_CONFIG);
+  ilist_init(&section->entries);
   return section;
 }
 
-static void section_free(void* ptr) {
-  if (!ptr) return;
+static void section_free(section_t* section) {
+  if (!section) return;
 
-  section_t* section = static_cast<section_t*>(ptr);
+  ilist_link_t* link;
+  while ((link = ilist_pop_front(&section->entries)) != NULL)
+    entry_free(ENTRY_OF(link));
   osi_free(section->name);
-  list_free(section->entries);
   osi_free(section);
 }
 
 static section_t* section_find(const config_t* config, const char* section) {
-  for (const list_node_t* node = list_begin(config->sections);
-       node != list_end(config->sections); node = list_next(node)) {
-    section_t* sec = static_cast<section_t*>(list_node(node));
-    if (!strcmp(sec->name, section)) return sec;
-  }
+  auto it = config->section_index.find(section);
+  return (it != config->section_index.end()) ? it->second : NULL;
+}
 
-  return NULL;
+// Removes |sec| and its entries from the indexes of |config|.
+static void section_unindex(config_t* config, section_t* sec) {
+  for (const ilist_link_t* node = ilist_begin(&sec->entries);
+       node != ilist_end(&sec->entries); node = ilist_next(node)) {
+    config->entry_index.erase(EntryKey{sec, ENTRY_OF(node)->key});
+  }
+  config->section_index.erase(sec->name);
 }
 
 static entry_t* entry_new(const char* key, const char* value) {
-  entry_t* entry = static_cast<entry_t*>(osi_calloc(sizeof(entry_t)));
+  entry_t* entry = static_cast<entry_t*>(osi_calloc_tagged(
+      sizeof(entry_t), OSI_MEM_CONFIG));
 
-  entry->key = osi_strdup(key);
-  entry->value = osi_strdup(value);
+  entry->key = intern_key(key);
+  entry->value = osi_strdup_tagged(value, OSI_MEM_CONFIG);
   return entry;
 }
 
-static void entry_free(void* ptr) {
-  if (!ptr) return;
+static void entry_free(entry_t* entry) {
+  if (!entry) return;
 
-  entry_t* entry = static_cast<entry_t*>(ptr);
-  osi_free(entry->key);
   osi_free(entry->value);
   osi_free(entry);
 }
@@ -507,11 +714,113 @@ static entry_t* entry_find(const config_t* config, const char* section,
   section_t* sec = section_find(config, section);
   if (!sec) return NULL;
 
-  for (const list_node_t* node = list_begin(sec->entries);
-       node != list_end(sec->entries); node = list_next(node)) {
-    entry_t* entry = static_cast<entry_t*>(list_node(node));
-    if (!strcmp(entry->key, key)) return entry;
+  return section_entry_find(config, sec, key);
+}
+
+static entry_t* section_entry_find(const config_t* config,
+                                   const section_t* sec, const char* key) {
+  auto it = config->entry_index.find(EntryKey{sec, key});
+  return (it != config->entry_index.end()) ? it->second : NULL;
+}
+
+// Returns the shared copy of |key|. The same few keys are repeated in every
+// section, e.g. in one section per remote device for btif_config, so they
+// are stored once for all the configs. The copies are never freed.
+static const char* intern_key(const char* key) {
+  static std::mutex interned_keys_mutex;
+  static std::unordered_set<std::string>* interned_keys =
+      new std::unordered_set<std::string>();
+
+  std::lock_guard<std::mutex> lock(interned_keys_mutex);
+  return interned_keys->insert(key).first->c_str();
+}
+
+// Fills the stamp fields of |header| from the config file |source|.
+static bool snapshot_stamp(snapshot_header_t* header, const char* source) {
+  struct stat source_stat;
+  if (stat(source, &source_stat) == -1) return false;
+
+  header->source_size = source_stat.st_size;
+  header->source_inode = source_stat.st_ino;
+  header->source_mtime_sec = source_stat.st_mtim.tv_sec;
+  header->source_mtime_nsec = source_stat.st_mtim.tv_nsec;
+  return true;
+}
+
+static uint32_t snapshot_checksum(const uint8_t* data, size_t length) {
+  // FNV-1a
+  uint32_t checksum = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+    checksum = (checksum ^ data[i]) * 16777619u;
+  return checksum;
+}
+
+// Builds a config from the snapshot |data| of |length| octets. Returns NULL
+// if the snapshot is corrupted or was not taken of the config file |stamp|
+// was filled from.
+static config_t* snapshot_load(const uint8_t* data, size_t length,
+                               const snapshot_header_t* stamp) {
+  snapshot_header_t header;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+    return NULL;
+
+  if (header.source_size != stamp->source_size ||
+      header.source_inode != stamp->source_inode ||
+      header.source_mtime_sec != stamp->source_mtime_sec ||
+      header.source_mtime_nsec != stamp->source_mtime_nsec)
+    return NULL;
+
+  const uint64_t body_size =
+      (uint64_t)header.section_count * sizeof(snapshot_section_t) +
+      (uint64_t)header.entry_count * sizeof(snapshot_entry_t) +
+      header.strings_size;
+  if (body_size != length - sizeof(header)) return NULL;
+
+  const uint8_t* body = data + sizeof(header);
+  if (snapshot_checksum(body, body_size) != header.checksum) return NULL;
+
+  const snapshot_section_t* sections =
+      reinterpret_cast<const snapshot_section_t*>(body);
+  const snapshot_entry_t* entries = reinterpret_cast<const snapshot_entry_t*>(
+      sections + header.section_count);
+  const char* strings =
+      reinterpret_cast<const char*>(entries + header.entry_count);
+  if (header.strings_size > 0 && strings[header.strings_size - 1] != '\0')
+    return NULL;
+
+  config_t* config = config_new_empty();
+  config->section_index.reserve(header.section_count);
+  config->entry_index.reserve(header.entry_count);
+
+  // The snapshot was taken of a config, so its sections and keys are
+  // unique and are added without looking them up first.
+  uint32_t next_entry = 0;
+  for (uint32_t i = 0; i < header.section_count; i++) {
+    if (sections[i].name >= header.strings_size ||
+        sections[i].entry_count > header.entry_count - next_entry) {
+      config_free(config);
+      return NULL;
+    }
+
+    section_t* sec = section_new(strings + sections[i].name);
+    ilist_append(&config->sections, &sec->link);
+    config->section_index[sec->name] = sec;
+
+    for (uint32_t j = 0; j < sections[i].entry_count; j++, next_entry++) {
+      const snapshot_entry_t* snapshot_entry = &entries[next_entry];
+      if (snapshot_entry->key >= header.strings_size ||
+          snapshot_entry->value >= header.strings_size) {
+        config_free(config);
+        return NULL;
+      }
+
+      entry_t* entry = entry_new(strings + snapshot_entry->key,
+                                 strings + snapshot_entry->value);
+      ilist_append(&sec->entries, &entry->link);
+      config->entry_index[EntryKey{sec, entry->key}] = entry;
+    }
   }
 
-  return NULL;
+  return config;
 }
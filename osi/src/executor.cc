@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_executor"
+
+#include "osi/include/executor.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include <base/logging.h>
+#include <stdio.h>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/semaphore.h"
+
+typedef struct {
+  executor_task_fn task;
+  void* context;
+  void* result;
+
+  // Either |future| is set, or the task completes by posting |completion|
+  // to |owner|.
+  future_t* future;
+  thread_t* owner;
+  executor_completion_fn completion;
+} executor_task_t;
+
+typedef struct {
+  executor_t* executor;
+  thread_t* thread;
+
+  // The worker takes its own tasks from the back of |tasks|, while the other
+  // workers steal from the front.
+  std::mutex mutex;
+  std::deque<executor_task_t*> tasks;
+} executor_worker_t;
+
+struct executor_t {
+  size_t num_workers;
+  executor_worker_t workers[EXECUTOR_MAX_WORKERS];
+
+  // Counts the tasks queued and not taken by a worker yet, plus one per
+  // worker once |is_shutting_down| is set.
+  semaphore_t* pending;
+  std::atomic_bool is_shutting_down;
+  std::atomic_size_t next_worker;
+  std::atomic_size_t steal_count;
+};
+
+// The worker running on the current thread, if any
+static thread_local executor_worker_t* current_worker = NULL;
+
+static void worker_run(void* context);
+static executor_task_t* worker_take_task(executor_worker_t* worker);
+static bool executor_enqueue(executor_t* executor, executor_task_t* task);
+static void executor_task_complete(void* context);
+
+executor_t* executor_new(const char* name, size_t num_workers) {
+  CHECK(name != NULL);
+  CHECK(num_workers > 0 && num_workers <= EXECUTOR_MAX_WORKERS);
+
+  executor_t* ret = new executor_t();
+  ret->num_workers = num_workers;
+  ret->is_shutting_down = false;
+  ret->next_worker = 0;
+  ret->steal_count = 0;
+
+  ret->pending = semaphore_new(0);
+  if (!ret->pending) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the semaphore.", __func__);
+    goto error;
+  }
+
+  for (size_t i = 0; i < num_workers; i++) {
+    executor_worker_t* worker = &ret->workers[i];
+    char thread_name[THREAD_NAME_MAX + 1];
+
+    snprintf(thread_name, sizeof(thread_name), "%s_%zu", name, i);
+    worker->executor = ret;
+    worker->thread = thread_new(thread_name);
+    if (!worker->thread) {
+      LOG_ERROR(LOG_TAG, "%s unable to create the worker thread %s.",
+                __func__, thread_name);
+      goto error;
+    }
+    thread_post(worker->thread, worker_run, worker);
+  }
+
+  return ret;
+
+error:
+  executor_free(ret);
+  return NULL;
+}
+
+void executor_free(executor_t* executor) {
+  if (!executor) return;
+
+  CHECK(current_worker == NULL || current_worker->executor != executor);
+
+  // Each worker takes the queued tasks until it finds none left, and returns
+  // on the extra count of |pending| once all the queues are empty.
+  executor->is_shutting_down = true;
+  for (size_t i = 0; i < executor->num_workers; i++) {
+    if (executor->workers[i].thread) semaphore_post(executor->pending);
+  }
+
+  for (size_t i = 0; i < executor->num_workers; i++)
+    thread_free(executor->workers[i].thread);
+
+  semaphore_free(executor->pending);
+  delete executor;
+}
+
+future_t* executor_submit(executor_t* executor, executor_task_fn task,
+                          void* context) {
+  CHECK(executor != NULL);
+  CHECK(task != NULL);
+
+  future_t* future = future_new();
+  if (!future) return NULL;
+
+  executor_task_t* item =
+      static_cast<executor_task_t*>(osi_calloc(sizeof(executor_task_t)));
+  item->task = task;
+  item->context = context;
+  item->future = future;
+
+  if (!executor_enqueue(executor, item)) {
+    osi_free(item);
+    // Nobody else has the future: resolve it so that it can be freed.
+    future_ready(future, NULL);
+    future_await(future);
+    return NULL;
+  }
+
+  return future;
+}
+
+bool executor_post(executor_t* executor, executor_task_fn task, void* context,
+                   thread_t* owner, executor_completion_fn completion) {
+  CHECK(executor != NULL);
+  CHECK(task != NULL);
+  CHECK(owner != NULL);
+  CHECK(completion != NULL);
+
+  executor_task_t* item =
+      static_cast<executor_task_t*>(osi_calloc(sizeof(executor_task_t)));
+  item->task = task;
+  item->context = context;
+  item->owner = owner;
+  item->completion = completion;
+
+  if (!executor_enqueue(executor, item)) {
+    osi_free(item);
+    return false;
+  }
+
+  return true;
+}
+
+size_t executor_get_steal_count(const executor_t* executor) {
+  CHECK(executor != NULL);
+
+  return executor->steal_count;
+}
+
+// Queues |task| on the worker that submits it, so that tasks spawned by a
+// task stay on the same CPU, or else on the workers in turn.
+static bool executor_enqueue(executor_t* executor, executor_task_t* task) {
+  if (executor->is_shutting_down) {
+    LOG_ERROR(LOG_TAG, "%s executor is shutting down.", __func__);
+    return false;
+  }
+
+  executor_worker_t* worker = current_worker;
+  if (worker == NULL || worker->executor != executor) {
+    size_t index = executor->next_worker++ % executor->num_workers;
+    worker = &executor->workers[index];
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->tasks.push_back(task);
+  }
+  semaphore_post(executor->pending);
+  return true;
+}
+
+static void worker_run(void* context) {
+  executor_worker_t* worker = static_cast<executor_worker_t*>(context);
+  executor_t* executor = worker->executor;
+
+  current_worker = worker;
+
+  for (;;) {
+    semaphore_wait(executor->pending);
+
+    executor_task_t* task = worker_take_task(worker);
+    if (task == NULL) break;
+
+    task->result = task->task(task->context);
+
+    if (task->future) {
+      future_ready(task->future, task->result);
+      osi_free(task);
+    } else {
+      thread_post(task->owner, executor_task_complete, task);
+    }
+  }
+
+  current_worker = NULL;
+}
+
+// Takes the next task of |worker|, or steals one from the other workers.
+// Returns NULL once the executor is shutting down and no task is left.
+static executor_task_t* worker_take_task(executor_worker_t* worker) {
+  executor_t* executor = worker->executor;
+  size_t self = worker - executor->workers;
+
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      if (!worker->tasks.empty()) {
+        executor_task_t* task = worker->tasks.back();
+        worker->tasks.pop_back();
+        return task;
+      }
+    }
+
+    for (size_t i = 1; i < executor->num_workers; i++) {
+      executor_worker_t* victim =
+          &executor->workers[(self + i) % executor->num_workers];
+      std::lock_guard<std::mutex> lock(victim->mutex);
+      if (!victim->tasks.empty()) {
+        executor_task_t* task = victim->tasks.front();
+        victim->tasks.pop_front();
+        executor->steal_count++;
+        return task;
+      }
+    }
+
+    if (executor->is_shutting_down) return NULL;
+
+    // The task counted by |pending| was taken by a worker that woke up
+    // earlier, and the task that worker was counted for is being queued:
+    // look again.
+  }
+}
+
+static void executor_task_complete(void* context) {
+  executor_task_t* task = static_cast<executor_task_t*>(context);
+
+  task->completion(task->context, task->result);
+  osi_free(task);
+}
@@ -16,14 +16,21 @@
  *
  ******************************************************************************/
 
+#define LOG_TAG "bt_osi_fixed_queue"
+
 #include <base/logging.h>
+#include <errno.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <mutex>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/list.h"
+#include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
@@ -35,12 +42,22 @@ typedef struct fixed_queue_t {
   std::mutex* mutex;
   size_t capacity;
 
+  // The semaphores are lightweight, these file descriptors are only created
+  // for the queues that are polled, e.g. registered with a reactor. They
+  // are readable while the queue has elements, and room for elements.
+  mutable int enqueue_fd;
+  mutable int dequeue_fd;
+
   reactor_object_t* dequeue_object;
   fixed_queue_cb dequeue_ready;
   void* dequeue_context;
 } fixed_queue_t;
 
 static void internal_dequeue_ready(void* context);
+static void appended_l(fixed_queue_t* queue);
+static void removed_l(fixed_queue_t* queue, size_t count);
+static unsigned int clamp_count(size_t count);
+static int new_fd(size_t value);
 
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
@@ -48,14 +65,16 @@ fixed_queue_t* fixed_queue_new(size_t capacity) {
 
   ret->mutex = new std::mutex;
   ret->capacity = capacity;
+  ret->enqueue_fd = INVALID_FD;
+  ret->dequeue_fd = INVALID_FD;
 
   ret->list = list_new(NULL);
   if (!ret->list) goto error;
 
-  ret->enqueue_sem = semaphore_new(capacity);
+  ret->enqueue_sem = semaphore_new_lightweight(clamp_count(capacity));
   if (!ret->enqueue_sem) goto error;
 
-  ret->dequeue_sem = semaphore_new(0);
+  ret->dequeue_sem = semaphore_new_lightweight(0);
   if (!ret->dequeue_sem) goto error;
 
   return ret;
@@ -78,6 +97,8 @@ void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   list_free(queue->list);
   semaphore_free(queue->enqueue_sem);
   semaphore_free(queue->dequeue_sem);
+  if (queue->enqueue_fd != INVALID_FD) close(queue->enqueue_fd);
+  if (queue->dequeue_fd != INVALID_FD) close(queue->dequeue_fd);
   delete queue->mutex;
   osi_free(queue);
 }
@@ -122,9 +143,8 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
     list_append(queue->list, data);
+    appended_l(queue);
   }
-
-  semaphore_post(queue->dequeue_sem);
 }
 
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
@@ -137,10 +157,9 @@ void* fixed_queue_dequeue(fixed_queue_t* queue) {
     std::lock_guard<std::mutex> lock(*queue->mutex);
     ret = list_front(queue->list);
     list_remove(queue->list, ret);
+    removed_l(queue, 1);
   }
 
-  semaphore_post(queue->enqueue_sem);
-
   return ret;
 }
 
@@ -153,9 +172,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
     list_append(queue->list, data);
+    appended_l(queue);
   }
-
-  semaphore_post(queue->dequeue_sem);
   return true;
 }
 
@@ -169,13 +187,33 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
     std::lock_guard<std::mutex> lock(*queue->mutex);
     ret = list_front(queue->list);
     list_remove(queue->list, ret);
+    removed_l(queue, 1);
   }
 
-  semaphore_post(queue->enqueue_sem);
-
   return ret;
 }
 
+size_t fixed_queue_try_dequeue_batch(fixed_queue_t* queue, void** data,
+                                     size_t max_count) {
+  CHECK(data != NULL);
+
+  if (queue == NULL) return 0;
+
+  size_t count = semaphore_try_wait_n(queue->dequeue_sem, max_count);
+  if (count == 0) return 0;
+
+  {
+    std::lock_guard<std::mutex> lock(*queue->mutex);
+    for (size_t i = 0; i < count; i++) {
+      data[i] = list_front(queue->list);
+      list_remove(queue->list, data[i]);
+    }
+    removed_l(queue, count);
+  }
+
+  return count;
+}
+
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
@@ -193,18 +231,12 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
-  bool removed = false;
-  {
-    std::lock_guard<std::mutex> lock(*queue->mutex);
-    if (list_contains(queue->list, data) &&
-        semaphore_try_wait(queue->dequeue_sem)) {
-      removed = list_remove(queue->list, data);
-      CHECK(removed);
-    }
-  }
-
-  if (removed) {
-    semaphore_post(queue->enqueue_sem);
+  std::lock_guard<std::mutex> lock(*queue->mutex);
+  if (list_contains(queue->list, data) &&
+      semaphore_try_wait(queue->dequeue_sem)) {
+    bool removed = list_remove(queue->list, data);
+    CHECK(removed);
+    removed_l(queue, 1);
     return data;
   }
   return NULL;
@@ -221,16 +253,34 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue) {
 
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
-  return semaphore_get_fd(queue->dequeue_sem);
+
+  std::lock_guard<std::mutex> lock(*queue->mutex);
+  if (queue->dequeue_fd == INVALID_FD)
+    queue->dequeue_fd = new_fd(list_length(queue->list));
+  return queue->dequeue_fd;
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
-  return semaphore_get_fd(queue->enqueue_sem);
+
+  std::lock_guard<std::mutex> lock(*queue->mutex);
+  if (queue->enqueue_fd == INVALID_FD)
+    queue->enqueue_fd =
+        new_fd(clamp_count(queue->capacity - list_length(queue->list)));
+  return queue->enqueue_fd;
 }
 
 void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
                                   fixed_queue_cb ready_cb, void* context) {
+  fixed_queue_register_dequeue_with_priority(
+      queue, reactor, REACTOR_PRIORITY_NORMAL, ready_cb, context);
+}
+
+void fixed_queue_register_dequeue_with_priority(fixed_queue_t* queue,
+                                                reactor_t* reactor,
+                                                reactor_priority_t priority,
+                                                fixed_queue_cb ready_cb,
+                                                void* context) {
   CHECK(queue != NULL);
   CHECK(reactor != NULL);
   CHECK(ready_cb != NULL);
@@ -240,9 +290,9 @@ void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
 
   queue->dequeue_ready = ready_cb;
   queue->dequeue_context = context;
-  queue->dequeue_object =
-      reactor_register(reactor, fixed_queue_get_dequeue_fd(queue), queue,
-                       internal_dequeue_ready, NULL);
+  queue->dequeue_object = reactor_register_with_priority(
+      reactor, fixed_queue_get_dequeue_fd(queue), queue, priority,
+      internal_dequeue_ready, NULL);
 }
 
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue) {
@@ -260,3 +310,44 @@ static void internal_dequeue_ready(void* context) {
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
   queue->dequeue_ready(queue, queue->dequeue_context);
 }
+
+// Returns |count| clamped to the largest initial value of the semaphores and
+// the file descriptors, INT32_MAX. The room of a queue created with SIZE_MAX
+// capacity, i.e. unbounded, starts at this value and can not run out in
+// practice.
+static unsigned int clamp_count(size_t count) {
+  return count < INT32_MAX ? count : INT32_MAX;
+}
+
+// Creates a file descriptor readable while |value| is not 0. Each read
+// decrements the value by one, and never blocks.
+static int new_fd(size_t value) {
+  int fd = eventfd(value, EFD_SEMAPHORE | EFD_NONBLOCK);
+  if (fd == INVALID_FD)
+    LOG_ERROR(LOG_TAG, "%s unable to create queue fd: %s", __func__,
+              strerror(errno));
+  return fd;
+}
+
+// Signals an element appended to the list of |queue|, to its dequeue
+// semaphore then to its file descriptors. A consumer woken up by the dequeue
+// file descriptor always finds the element with |fixed_queue_try_dequeue|.
+// Must be called with the mutex of |queue| held.
+static void appended_l(fixed_queue_t* queue) {
+  eventfd_t value;
+  semaphore_post(queue->dequeue_sem);
+  if (queue->dequeue_fd != INVALID_FD) eventfd_write(queue->dequeue_fd, 1);
+  if (queue->enqueue_fd != INVALID_FD) eventfd_read(queue->enqueue_fd, &value);
+}
+
+// Signals |count| elements removed from the list of |queue|, after their
+// dequeue semaphore was taken: the enqueue semaphore is posted before the
+// enqueue file descriptor shows the room. Must be called with the mutex of
+// |queue| held.
+static void removed_l(fixed_queue_t* queue, size_t count) {
+  eventfd_t value;
+  if (queue->dequeue_fd != INVALID_FD)
+    for (size_t i = 0; i < count; i++) eventfd_read(queue->dequeue_fd, &value);
+  semaphore_post_n(queue->enqueue_sem, count);
+  if (queue->enqueue_fd != INVALID_FD) eventfd_write(queue->enqueue_fd, count);
+}
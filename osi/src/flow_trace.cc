@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_flow_trace"
+
+#if !defined(OS_GENERIC)
+#define ATRACE_TAG ATRACE_TAG_BLUETOOTH
+#include <cutils/trace.h>
+#endif  // !defined(OS_GENERIC)
+
+#include "osi/include/flow_trace.h"
+
+#include <stdio.h>
+
+#include <atomic>
+
+// The flow IDs given out: the IDs of the packets in flight. A buffer not
+// carrying a traced packet may hold any value, which must not be taken for
+// the ID of a packet.
+#define FLOW_TRACE_IDS (UINT16_MAX + 1)
+#define FLOW_TRACE_WORD_BITS 32
+
+static std::atomic<uint32_t> enabled_categories(0);
+static std::atomic<uint16_t> last_flow_id(FLOW_TRACE_NO_FLOW);
+static std::atomic<uint32_t> live_flows[FLOW_TRACE_IDS / FLOW_TRACE_WORD_BITS];
+
+static bool is_live(uint16_t flow_id) {
+  if (flow_id == FLOW_TRACE_NO_FLOW) return false;
+  uint32_t bit = 1u << (flow_id % FLOW_TRACE_WORD_BITS);
+  return live_flows[flow_id / FLOW_TRACE_WORD_BITS].load(
+             std::memory_order_relaxed) &
+         bit;
+}
+
+static void set_live(uint16_t flow_id, bool live) {
+  uint32_t bit = 1u << (flow_id % FLOW_TRACE_WORD_BITS);
+  std::atomic<uint32_t>* word = &live_flows[flow_id / FLOW_TRACE_WORD_BITS];
+  if (live)
+    word->fetch_or(bit, std::memory_order_relaxed);
+  else
+    word->fetch_and(~bit, std::memory_order_relaxed);
+}
+
+static uint16_t new_flow_id(void) {
+  uint16_t flow_id;
+  do {
+    flow_id = ++last_flow_id;
+  } while (flow_id == FLOW_TRACE_NO_FLOW);
+  set_live(flow_id, true);
+  return flow_id;
+}
+
+static void trace(uint16_t flow_id, const char* point) {
+#if !defined(OS_GENERIC)
+  char name[64];
+  snprintf(name, sizeof(name), "bt_flow %u: %s", flow_id, point);
+  ATRACE_BEGIN(name);
+  ATRACE_END();
+#endif  // !defined(OS_GENERIC)
+}
+
+void flow_trace_set_categories(uint32_t categories) {
+  enabled_categories = categories & FLOW_TRACE_ALL_CATEGORIES;
+}
+
+bool flow_trace_is_enabled(uint32_t category) {
+  if (!(enabled_categories.load(std::memory_order_relaxed) & category))
+    return false;
+#if !defined(OS_GENERIC)
+  return ATRACE_ENABLED();
+#else
+  return true;
+#endif  // !defined(OS_GENERIC)
+}
+
+void flow_trace_point(uint32_t category, uint16_t* flow_id,
+                      const char* point) {
+  if (!is_live(*flow_id)) *flow_id = new_flow_id();
+  trace(*flow_id, point);
+}
+
+void flow_trace_start(uint32_t category, uint16_t* flow_id,
+                      const char* point) {
+  *flow_id = new_flow_id();
+  trace(*flow_id, point);
+}
+
+void flow_trace_end(uint32_t category, uint16_t* flow_id, const char* point) {
+  if (!is_live(*flow_id)) *flow_id = new_flow_id();
+  trace(*flow_id, point);
+  set_live(*flow_id, false);
+}
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/ilist.h"
+
+#include <base/logging.h>
+
+void ilist_init(ilist_t* list) {
+  CHECK(list != NULL);
+
+  list->head.prev = &list->head;
+  list->head.next = &list->head;
+  list->length = 0;
+}
+
+void ilist_link_init(ilist_link_t* link) {
+  CHECK(link != NULL);
+
+  link->prev = NULL;
+  link->next = NULL;
+}
+
+bool ilist_is_linked(const ilist_link_t* link) {
+  CHECK(link != NULL);
+  return link->next != NULL;
+}
+
+bool ilist_is_empty(const ilist_t* list) {
+  CHECK(list != NULL);
+  return list->length == 0;
+}
+
+size_t ilist_length(const ilist_t* list) {
+  CHECK(list != NULL);
+  return list->length;
+}
+
+ilist_link_t* ilist_front(const ilist_t* list) {
+  CHECK(list != NULL);
+  return ilist_is_empty(list) ? NULL : list->head.next;
+}
+
+ilist_link_t* ilist_back(const ilist_t* list) {
+  CHECK(list != NULL);
+  return ilist_is_empty(list) ? NULL : list->head.prev;
+}
+
+void ilist_append(ilist_t* list, ilist_link_t* link) {
+  CHECK(list != NULL);
+  ilist_insert_after(list, list->head.prev, link);
+}
+
+void ilist_prepend(ilist_t* list, ilist_link_t* link) {
+  CHECK(list != NULL);
+  ilist_insert_after(list, &list->head, link);
+}
+
+void ilist_insert_after(ilist_t* list, ilist_link_t* prev, ilist_link_t* link) {
+  CHECK(list != NULL);
+  CHECK(prev != NULL);
+  CHECK(link != NULL);
+  CHECK(link->next == NULL);
+
+  link->prev = prev;
+  link->next = prev->next;
+  prev->next->prev = link;
+  prev->next = link;
+  ++list->length;
+}
+
+void ilist_remove(ilist_t* list, ilist_link_t* link) {
+  CHECK(list != NULL);
+  CHECK(link != NULL);
+  CHECK(link->next != NULL);
+  CHECK(list->length > 0);
+
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->prev = NULL;
+  link->next = NULL;
+  --list->length;
+}
+
+ilist_link_t* ilist_pop_front(ilist_t* list) {
+  ilist_link_t* link = ilist_front(list);
+  if (link != NULL) ilist_remove(list, link);
+  return link;
+}
+
+ilist_link_t* ilist_begin(const ilist_t* list) {
+  CHECK(list != NULL);
+  return list->head.next;
+}
+
+ilist_link_t* ilist_end(const ilist_t* list) {
+  CHECK(list != NULL);
+  return const_cast<ilist_link_t*>(&list->head);
+}
+
+ilist_link_t* ilist_next(const ilist_link_t* link) {
+  CHECK(link != NULL);
+  return link->next;
+}
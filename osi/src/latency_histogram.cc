@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/latency_histogram.h"
+
+#include <base/logging.h>
+#include <string.h>
+
+// The sub-bucket count is a power of two: values below it have a bucket
+// each, and the buckets of 2^e up to 2^(e+1) are |2^(e-2)| wide.
+static_assert(LATENCY_HISTOGRAM_SUB_BUCKETS == 4,
+              "The bucket index math assumes 4 sub-buckets");
+
+static int bucket_index(uint64_t value) {
+  if (value < LATENCY_HISTOGRAM_SUB_BUCKETS) return (int)value;
+
+  int exponent = 63 - __builtin_clzll(value);
+  if (exponent >= LATENCY_HISTOGRAM_MAX_EXPONENT)
+    return LATENCY_HISTOGRAM_BUCKETS - 1;
+
+  int sub_bucket =
+      (value >> (exponent - 2)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+  return LATENCY_HISTOGRAM_SUB_BUCKETS +
+         (exponent - 2) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+// Returns the largest value that goes to |index|.
+static uint64_t bucket_upper_bound(int index) {
+  if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) return index;
+  if (index == LATENCY_HISTOGRAM_BUCKETS - 1) return UINT64_MAX;
+
+  int exponent = 2 + (index - LATENCY_HISTOGRAM_SUB_BUCKETS) /
+                         LATENCY_HISTOGRAM_SUB_BUCKETS;
+  uint64_t sub_bucket = (index - LATENCY_HISTOGRAM_SUB_BUCKETS) %
+                        LATENCY_HISTOGRAM_SUB_BUCKETS;
+  return ((LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1)
+          << (exponent - 2)) -
+         1;
+}
+
+void latency_histogram_reset(latency_histogram_t* histogram) {
+  CHECK(histogram != NULL);
+  memset(histogram, 0, sizeof(*histogram));
+}
+
+void latency_histogram_add(latency_histogram_t* histogram,
+                           uint64_t latency_us) {
+  CHECK(histogram != NULL);
+
+  histogram->buckets[bucket_index(latency_us)]++;
+  histogram->count++;
+  histogram->total_us += latency_us;
+  if (latency_us > histogram->max_us) histogram->max_us = latency_us;
+}
+
+void latency_histogram_merge(const latency_histogram_t* src,
+                             latency_histogram_t* dst) {
+  CHECK(src != NULL);
+  CHECK(dst != NULL);
+
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    dst->buckets[i] += src->buckets[i];
+  dst->count += src->count;
+  dst->total_us += src->total_us;
+  if (src->max_us > dst->max_us) dst->max_us = src->max_us;
+}
+
+uint64_t latency_histogram_percentile(const latency_histogram_t* histogram,
+                                      uint32_t per_mille) {
+  CHECK(histogram != NULL);
+  CHECK(per_mille <= 1000);
+
+  if (histogram->count == 0) return 0;
+
+  // The rank of the sample, rounded up
+  uint64_t rank = (histogram->count * per_mille + 999) / 1000;
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      uint64_t value = bucket_upper_bound(i);
+      return (value < histogram->max_us) ? value : histogram->max_us;
+    }
+  }
+  return histogram->max_us;
+}
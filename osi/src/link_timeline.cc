@@ -0,0 +1,174 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/link_timeline.h"
+
+#include <base/logging.h>
+#include <string.h>
+
+// Returns the slot of a ring of |size| entries to write the next entry to,
+// overwriting the oldest one when the ring is full.
+static uint32_t ring_push(uint32_t* p_first, uint32_t* p_kept, uint32_t size) {
+  if (*p_kept < size) return (*p_first + (*p_kept)++) % size;
+  uint32_t slot = *p_first;
+  *p_first = (*p_first + 1) % size;
+  return slot;
+}
+
+static void add_transition(link_timeline_t* timeline,
+                           const link_timeline_transition_t* transition) {
+  uint32_t slot = ring_push(&timeline->transitions_first,
+                            &timeline->transitions_kept,
+                            LINK_TIMELINE_MAX_TRANSITIONS);
+  timeline->transitions[slot] = *transition;
+}
+
+static void add_rssi_sample(link_timeline_t* timeline,
+                            const link_timeline_rssi_sample_t* sample) {
+  uint32_t slot = ring_push(&timeline->rssi_samples_first,
+                            &timeline->rssi_samples_kept,
+                            LINK_TIMELINE_MAX_RSSI_SAMPLES);
+  timeline->rssi_samples[slot] = *sample;
+}
+
+// Accounts the time spent at the current quality index up to |time_us|.
+static void account_quality(link_timeline_t* timeline, uint64_t time_us) {
+  if (!timeline->has_quality_index) return;
+  if (time_us > timeline->quality_since_us) {
+    int32_t index = timeline->quality_index;
+    if (index >= LINK_TIMELINE_MAX_QUALITY_INDEX)
+      index = LINK_TIMELINE_MAX_QUALITY_INDEX - 1;
+    // The boundaries are rounded rather than the durations, so that the
+    // rounding does not add up
+    timeline->quality_duration_ms[index] +=
+        (time_us / 1000) - (timeline->quality_since_us / 1000);
+  }
+  timeline->quality_since_us = time_us;
+}
+
+static void end_congestion(link_timeline_t* timeline, uint64_t time_us) {
+  if (!timeline->is_congested) return;
+  uint64_t duration_us = (time_us > timeline->congestion_since_us)
+                             ? time_us - timeline->congestion_since_us
+                             : 0;
+  timeline->is_congested = false;
+  timeline->congestion_total_us += duration_us;
+  if (duration_us > timeline->congestion_max_us)
+    timeline->congestion_max_us = duration_us;
+}
+
+void link_timeline_reset(link_timeline_t* timeline) {
+  CHECK(timeline != NULL);
+  memset(timeline, 0, sizeof(*timeline));
+}
+
+void link_timeline_set_quality(link_timeline_t* timeline, uint64_t time_us,
+                               int32_t quality_index,
+                               uint32_t tx_queue_length) {
+  CHECK(timeline != NULL);
+  CHECK(quality_index >= 0);
+
+  account_quality(timeline, time_us);
+  if (timeline->has_quality_index &&
+      timeline->quality_index != quality_index) {
+    link_timeline_transition_t transition;
+    transition.time_ms = time_us / 1000;
+    transition.from_index = timeline->quality_index;
+    transition.to_index = quality_index;
+    transition.rssi = 0;
+    if (timeline->rssi_samples_kept > 0) {
+      transition.rssi =
+          link_timeline_get_rssi_sample(timeline,
+                                        timeline->rssi_samples_kept - 1)
+              ->rssi;
+    }
+    transition.tx_queue_length = tx_queue_length;
+    add_transition(timeline, &transition);
+    timeline->num_transitions++;
+  }
+  timeline->quality_index = quality_index;
+  timeline->has_quality_index = true;
+}
+
+void link_timeline_add_rssi(link_timeline_t* timeline, uint64_t time_us,
+                            int32_t rssi, uint32_t tx_queue_length) {
+  CHECK(timeline != NULL);
+
+  link_timeline_rssi_sample_t sample;
+  sample.time_ms = time_us / 1000;
+  sample.rssi = rssi;
+  sample.tx_queue_length = tx_queue_length;
+  add_rssi_sample(timeline, &sample);
+  timeline->num_rssi_samples++;
+}
+
+void link_timeline_set_congested(link_timeline_t* timeline, uint64_t time_us,
+                                 bool is_congested) {
+  CHECK(timeline != NULL);
+
+  if (!is_congested) {
+    end_congestion(timeline, time_us);
+    return;
+  }
+  if (timeline->is_congested) return;
+  timeline->is_congested = true;
+  timeline->congestion_since_us = time_us;
+  timeline->congestion_count++;
+}
+
+void link_timeline_finish(link_timeline_t* timeline, uint64_t time_us) {
+  CHECK(timeline != NULL);
+
+  account_quality(timeline, time_us);
+  timeline->has_quality_index = false;
+  end_congestion(timeline, time_us);
+}
+
+void link_timeline_merge(const link_timeline_t* src, link_timeline_t* dst) {
+  CHECK(src != NULL);
+  CHECK(dst != NULL);
+
+  for (int i = 0; i < LINK_TIMELINE_MAX_QUALITY_INDEX; i++)
+    dst->quality_duration_ms[i] += src->quality_duration_ms[i];
+  for (uint32_t i = 0; i < src->transitions_kept; i++)
+    add_transition(dst, link_timeline_get_transition(src, i));
+  dst->num_transitions += src->num_transitions;
+  for (uint32_t i = 0; i < src->rssi_samples_kept; i++)
+    add_rssi_sample(dst, link_timeline_get_rssi_sample(src, i));
+  dst->num_rssi_samples += src->num_rssi_samples;
+  dst->congestion_count += src->congestion_count;
+  dst->congestion_total_us += src->congestion_total_us;
+  if (src->congestion_max_us > dst->congestion_max_us)
+    dst->congestion_max_us = src->congestion_max_us;
+}
+
+const link_timeline_transition_t* link_timeline_get_transition(
+    const link_timeline_t* timeline, uint32_t i) {
+  CHECK(timeline != NULL);
+  CHECK(i < timeline->transitions_kept);
+  return &timeline->transitions[(timeline->transitions_first + i) %
+                                LINK_TIMELINE_MAX_TRANSITIONS];
+}
+
+const link_timeline_rssi_sample_t* link_timeline_get_rssi_sample(
+    const link_timeline_t* timeline, uint32_t i) {
+  CHECK(timeline != NULL);
+  CHECK(i < timeline->rssi_samples_kept);
+  return &timeline->rssi_samples[(timeline->rssi_samples_first + i) %
+                                 LINK_TIMELINE_MAX_RSSI_SAMPLES];
+}
@@ -4,6 +4,12 @@
 #include "osi/include/list.h"
 #include "osi/include/osi.h"
 
+// The nodes of removed elements are kept for reuse, up to this many per
+// list, so that a list used as a queue (e.g. by fixed_queue_t) does not
+// allocate and free a node for every element once it reached its usual
+// length.
+#define LIST_MAX_SPARE_NODES 32
+
 struct list_node_t {
   struct list_node_t* next;
   void* data;
@@ -15,8 +21,11 @@ typedef struct list_t {
   size_t length;
   list_free_cb free_cb;
   const allocator_t* allocator;
+  list_node_t* spare_nodes;  // Linked through |next|
+  size_t spare_count;
 } list_t;
 
+static list_node_t* list_alloc_node_(list_t* list);
 static list_node_t* list_free_node_(list_t* list, list_node_t* node);
 
 // Hidden constructor, only to be used by the hash map for the allocation
@@ -40,6 +49,11 @@ void list_free(list_t* list) {
   if (!list) return;
 
   list_clear(list);
+  while (list->spare_nodes) {
+    list_node_t* node = list->spare_nodes;
+    list->spare_nodes = node->next;
+    list->allocator->free(node);
+  }
   list->allocator->free(list);
 }
 
@@ -91,7 +105,7 @@ bool list_insert_after(list_t* list, list_node_t* prev_node, void* data) {
   CHECK(prev_node != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list);
   if (!node) return false;
 
   node->next = prev_node->next;
@@ -106,7 +120,7 @@ bool list_prepend(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list);
   if (!node) return false;
   node->next = list->head;
   node->data = data;
@@ -120,7 +134,7 @@ bool list_append(list_t* list, void* data) {
   CHECK(list != NULL);
   CHECK(data != NULL);
 
-  list_node_t* node = (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+  list_node_t* node = list_alloc_node_(list);
   if (!node) return false;
   node->next = NULL;
   node->data = data;
@@ -201,6 +215,16 @@ void* list_node(const list_node_t* node) {
   return node->data;
 }
 
+static list_node_t* list_alloc_node_(list_t* list) {
+  if (!list->spare_nodes)
+    return (list_node_t*)list->allocator->alloc(sizeof(list_node_t));
+
+  list_node_t* node = list->spare_nodes;
+  list->spare_nodes = node->next;
+  --list->spare_count;
+  return node;
+}
+
 static list_node_t* list_free_node_(list_t* list, list_node_t* node) {
   CHECK(list != NULL);
   CHECK(node != NULL);
@@ -208,7 +232,13 @@ static list_node_t* list_free_node_(list_t* list, list_node_t* node) {
   list_node_t* next = node->next;
 
   if (list->free_cb) list->free_cb(node->data);
-  list->allocator->free(node);
+  if (list->spare_count < LIST_MAX_SPARE_NODES) {
+    node->next = list->spare_nodes;
+    list->spare_nodes = node;
+    ++list->spare_count;
+  } else {
+    list->allocator->free(node);
+  }
   --list->length;
 
   return next;
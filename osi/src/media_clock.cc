@@ -0,0 +1,172 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_media_clock"
+
+#include "osi/include/media_clock.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+struct media_clock_t {
+  char* name;
+  int fd;
+  reactor_object_t* reactor_object;
+  media_clock_callback_t callback;
+  void* context;
+  std::atomic<bool> is_running;
+  std::atomic<uint64_t> missed_ticks;
+};
+
+static void media_clock_ready(void* context);
+
+media_clock_t* media_clock_new(const char* name) {
+  CHECK(name != NULL);
+
+  int fd = timerfd_create(CLOCK_BOOTTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to create timerfd for %s: %s", __func__,
+              name, strerror(errno));
+    return NULL;
+  }
+
+  media_clock_t* clock =
+      static_cast<media_clock_t*>(osi_calloc(sizeof(media_clock_t)));
+  clock->name = osi_strdup(name);
+  clock->fd = fd;
+  new (&clock->is_running) std::atomic<bool>(false);
+  new (&clock->missed_ticks) std::atomic<uint64_t>(0);
+  return clock;
+}
+
+void media_clock_free(media_clock_t* clock) {
+  if (clock == NULL) return;
+
+  media_clock_stop(clock);
+  close(clock->fd);
+  osi_free(clock->name);
+  osi_free(clock);
+}
+
+bool media_clock_start(media_clock_t* clock, reactor_t* reactor,
+                       period_ms_t period_ms, media_clock_callback_t cb,
+                       void* context) {
+  CHECK(clock != NULL);
+  CHECK(reactor != NULL);
+  CHECK(cb != NULL);
+  CHECK(period_ms > 0);
+
+  media_clock_stop(clock);
+
+  clock->callback = cb;
+  clock->context = context;
+  clock->missed_ticks = 0;
+  clock->reactor_object = reactor_register_with_priority(
+      reactor, clock->fd, clock, REACTOR_PRIORITY_HIGH, media_clock_ready,
+      NULL);
+  if (clock->reactor_object == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to register %s on the reactor", __func__,
+              clock->name);
+    return false;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_BOOTTIME, &now);
+
+  // Arm the first deadline as an absolute time, the kernel then keeps the
+  // following ones on the same grid
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = period_ms / 1000;
+  spec.it_interval.tv_nsec = (period_ms % 1000) * 1000000LL;
+  spec.it_value.tv_sec = now.tv_sec + spec.it_interval.tv_sec;
+  spec.it_value.tv_nsec = now.tv_nsec + spec.it_interval.tv_nsec;
+  if (spec.it_value.tv_nsec >= 1000000000LL) {
+    spec.it_value.tv_sec++;
+    spec.it_value.tv_nsec -= 1000000000LL;
+  }
+
+  clock->is_running = true;
+  if (timerfd_settime(clock->fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to arm %s: %s", __func__, clock->name,
+              strerror(errno));
+    media_clock_stop(clock);
+    return false;
+  }
+
+  return true;
+}
+
+void media_clock_stop(media_clock_t* clock) {
+  CHECK(clock != NULL);
+
+  if (clock->reactor_object == NULL) return;
+
+  clock->is_running = false;
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  timerfd_settime(clock->fd, 0, &spec, NULL);
+
+  // Waits for a running callback to complete
+  reactor_unregister(clock->reactor_object);
+  clock->reactor_object = NULL;
+
+  // Drain an expiration that was pending when the clock was disarmed
+  uint64_t expirations;
+  OSI_NO_INTR(read(clock->fd, &expirations, sizeof(expirations)));
+}
+
+bool media_clock_is_running(const media_clock_t* clock) {
+  if (clock == NULL) return false;
+  return clock->is_running;
+}
+
+uint64_t media_clock_get_missed_ticks(const media_clock_t* clock) {
+  CHECK(clock != NULL);
+  return clock->missed_ticks;
+}
+
+static void media_clock_ready(void* context) {
+  media_clock_t* clock = static_cast<media_clock_t*>(context);
+
+  uint64_t expirations = 0;
+  ssize_t ret;
+  OSI_NO_INTR(ret = read(clock->fd, &expirations, sizeof(expirations)));
+  if (ret != sizeof(expirations) || expirations == 0) return;
+  if (!clock->is_running) return;
+
+  // A single callback catches up the ticks that were missed: the consumer
+  // accounts for the elapsed time through |timestamp_us|
+  if (expirations > 1) {
+    clock->missed_ticks += expirations - 1;
+    LOG_VERBOSE(LOG_TAG, "%s %s missed %llu ticks", __func__, clock->name,
+                (unsigned long long)(expirations - 1));
+  }
+
+  clock->callback(clock->context, time_get_os_boottime_us());
+}
@@ -41,6 +41,10 @@
 
 namespace system_bt_osi {
 
+using clearcut::connectivity::A2DPLatency;
+using clearcut::connectivity::A2DPQualityDuration;
+using clearcut::connectivity::A2DPQualityTransition;
+using clearcut::connectivity::A2DPRssiSample;
 using clearcut::connectivity::A2DPSession;
 using clearcut::connectivity::BluetoothLog;
 using clearcut::connectivity::BluetoothSession;
@@ -48,6 +52,7 @@ using clearcut::connectivity::BluetoothSession_ConnectionTechnologyType;
 using clearcut::connectivity::BluetoothSession_DisconnectReasonType;
 using clearcut::connectivity::DeviceInfo;
 using clearcut::connectivity::DeviceInfo_DeviceType;
+using clearcut::connectivity::EnergySample;
 using clearcut::connectivity::PairEvent;
 using clearcut::connectivity::ScanEvent;
 using clearcut::connectivity::ScanEvent_ScanTechnologyType;
@@ -133,6 +138,11 @@ void A2dpSessionMetrics::Update(const A2dpSessionMetrics& metrics) {
       buffer_underruns_count += metrics.buffer_underruns_count;
     }
   }
+  latency_histogram_merge(&metrics.media_read_latency, &media_read_latency);
+  latency_histogram_merge(&metrics.encode_latency, &encode_latency);
+  latency_histogram_merge(&metrics.tx_queue_latency, &tx_queue_latency);
+  if (metrics.codec_index >= 0) codec_index = metrics.codec_index;
+  link_timeline_merge(&metrics.link_timeline, &link_timeline);
 }
 
 bool A2dpSessionMetrics::operator==(const A2dpSessionMetrics& rhs) const {
@@ -144,7 +154,66 @@ bool A2dpSessionMetrics::operator==(const A2dpSessionMetrics& rhs) const {
          buffer_overruns_max_count == rhs.buffer_overruns_max_count &&
          buffer_overruns_total == rhs.buffer_overruns_total &&
          buffer_underruns_average == rhs.buffer_underruns_average &&
-         buffer_underruns_count == rhs.buffer_underruns_count;
+         buffer_underruns_count == rhs.buffer_underruns_count &&
+         memcmp(&media_read_latency, &rhs.media_read_latency,
+                sizeof(media_read_latency)) == 0 &&
+         memcmp(&encode_latency, &rhs.encode_latency,
+                sizeof(encode_latency)) == 0 &&
+         memcmp(&tx_queue_latency, &rhs.tx_queue_latency,
+                sizeof(tx_queue_latency)) == 0 &&
+         codec_index == rhs.codec_index &&
+         memcmp(&link_timeline, &rhs.link_timeline, sizeof(link_timeline)) ==
+             0;
+}
+
+static void set_a2dp_latency(A2DPLatency* latency,
+                             const latency_histogram_t* histogram) {
+  latency->set_count(histogram->count);
+  latency->set_p50_micros(latency_histogram_percentile(histogram, 500));
+  latency->set_p99_micros(latency_histogram_percentile(histogram, 990));
+  latency->set_p999_micros(latency_histogram_percentile(histogram, 999));
+  latency->set_max_micros(histogram->max_us);
+}
+
+static void set_a2dp_link_timeline(A2DPSession* a2dp_session,
+                                   const link_timeline_t* timeline) {
+  a2dp_session->clear_quality_durations();
+  for (int i = 0; i < LINK_TIMELINE_MAX_QUALITY_INDEX; i++) {
+    if (timeline->quality_duration_ms[i] == 0) continue;
+    A2DPQualityDuration* duration = a2dp_session->add_quality_durations();
+    duration->set_quality_index(i);
+    duration->set_duration_millis(timeline->quality_duration_ms[i]);
+  }
+  if (timeline->num_transitions > 0)
+    a2dp_session->set_quality_transitions_count(timeline->num_transitions);
+  a2dp_session->clear_quality_transitions();
+  for (uint32_t i = 0; i < timeline->transitions_kept; i++) {
+    const link_timeline_transition_t* src =
+        link_timeline_get_transition(timeline, i);
+    A2DPQualityTransition* transition =
+        a2dp_session->add_quality_transitions();
+    transition->set_session_time_millis(src->time_ms);
+    transition->set_from_quality_index(src->from_index);
+    transition->set_to_quality_index(src->to_index);
+    transition->set_rssi(src->rssi);
+    transition->set_tx_queue_length(src->tx_queue_length);
+  }
+  a2dp_session->clear_rssi_samples();
+  for (uint32_t i = 0; i < timeline->rssi_samples_kept; i++) {
+    const link_timeline_rssi_sample_t* src =
+        link_timeline_get_rssi_sample(timeline, i);
+    A2DPRssiSample* sample = a2dp_session->add_rssi_samples();
+    sample->set_session_time_millis(src->time_ms);
+    sample->set_rssi(src->rssi);
+    sample->set_tx_queue_length(src->tx_queue_length);
+  }
+  if (timeline->congestion_count > 0) {
+    a2dp_session->set_congestion_count(timeline->congestion_count);
+    a2dp_session->set_congestion_total_millis(timeline->congestion_total_us /
+                                              1000);
+    a2dp_session->set_congestion_max_millis(timeline->congestion_max_us /
+                                            1000);
+  }
 }
 
 static DeviceInfo_DeviceType get_device_type(device_type_t type) {
@@ -225,12 +294,15 @@ static BluetoothSession_DisconnectReasonType get_disconnect_reason_type(
 
 struct BluetoothMetricsLogger::impl {
   impl(size_t max_bluetooth_session, size_t max_pair_event,
-       size_t max_wake_event, size_t max_scan_event)
+       size_t max_wake_event, size_t max_scan_event,
+       size_t max_energy_sample)
       : bt_session_queue_(
             new LeakyBondedQueue<BluetoothSession>(max_bluetooth_session)),
         pair_event_queue_(new LeakyBondedQueue<PairEvent>(max_pair_event)),
         wake_event_queue_(new LeakyBondedQueue<WakeEvent>(max_wake_event)),
-        scan_event_queue_(new LeakyBondedQueue<ScanEvent>(max_scan_event)) {
+        scan_event_queue_(new LeakyBondedQueue<ScanEvent>(max_scan_event)),
+        energy_sample_queue_(
+            new LeakyBondedQueue<EnergySample>(max_energy_sample)) {
     bluetooth_log_ = BluetoothLog::default_instance().New();
     bluetooth_session_ = nullptr;
     bluetooth_session_start_time_ms_ = 0;
@@ -251,11 +323,13 @@ struct BluetoothMetricsLogger::impl {
   std::unique_ptr<LeakyBondedQueue<PairEvent>> pair_event_queue_;
   std::unique_ptr<LeakyBondedQueue<WakeEvent>> wake_event_queue_;
   std::unique_ptr<LeakyBondedQueue<ScanEvent>> scan_event_queue_;
+  std::unique_ptr<LeakyBondedQueue<EnergySample>> energy_sample_queue_;
 };
 
 BluetoothMetricsLogger::BluetoothMetricsLogger()
     : pimpl_(new impl(kMaxNumBluetoothSession, kMaxNumPairEvent,
-                      kMaxNumWakeEvent, kMaxNumScanEvent)) {}
+                      kMaxNumWakeEvent, kMaxNumScanEvent,
+                      kMaxNumEnergySample)) {}
 
 void BluetoothMetricsLogger::LogPairEvent(uint32_t disconnect_reason,
                                           uint64_t timestamp_ms,
@@ -314,6 +388,28 @@ void BluetoothMetricsLogger::LogScanEvent(bool start,
   }
 }
 
+void BluetoothMetricsLogger::LogEnergySample(const energy_sample_t& sample,
+                                             uint64_t timestamp_ms) {
+  EnergySample* event = new EnergySample();
+  event->set_duration_millis(sample.duration_ms);
+  event->set_tx_time_millis(sample.tx_time_ms);
+  event->set_rx_time_millis(sample.rx_time_ms);
+  event->set_idle_time_millis(sample.idle_time_ms);
+  event->set_energy_used(sample.energy_used);
+  if (sample.a2dp_codec_index >= 0)
+    event->set_a2dp_codec_index(sample.a2dp_codec_index);
+  event->set_le_scanning(sample.le_scanning);
+  event->set_num_le_links(sample.num_le_links);
+  event->set_num_bredr_links(sample.num_bredr_links);
+  event->set_event_time_millis(timestamp_ms);
+  pimpl_->energy_sample_queue_->Enqueue(event);
+  {
+    std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_log_lock_);
+    pimpl_->bluetooth_log_->set_num_energy_sample(
+        pimpl_->bluetooth_log_->num_energy_sample() + 1);
+  }
+}
+
 void BluetoothMetricsLogger::LogBluetoothSessionStart(
     connection_tech_t connection_tech_type, uint64_t timestamp_ms) {
   std::lock_guard<std::recursive_mutex> lock(pimpl_->bluetooth_session_lock_);
@@ -394,6 +490,23 @@ void BluetoothMetricsLogger::LogA2dpSession(
       pimpl_->a2dp_session_metrics_.buffer_underruns_average);
   a2dp_session->set_buffer_underruns_count(
       pimpl_->a2dp_session_metrics_.buffer_underruns_count);
+  if (pimpl_->a2dp_session_metrics_.media_read_latency.count > 0) {
+    set_a2dp_latency(a2dp_session->mutable_media_read_latency(),
+                     &pimpl_->a2dp_session_metrics_.media_read_latency);
+  }
+  if (pimpl_->a2dp_session_metrics_.encode_latency.count > 0) {
+    set_a2dp_latency(a2dp_session->mutable_encode_latency(),
+                     &pimpl_->a2dp_session_metrics_.encode_latency);
+  }
+  if (pimpl_->a2dp_session_metrics_.tx_queue_latency.count > 0) {
+    set_a2dp_latency(a2dp_session->mutable_tx_queue_latency(),
+                     &pimpl_->a2dp_session_metrics_.tx_queue_latency);
+  }
+  if (pimpl_->a2dp_session_metrics_.codec_index >= 0) {
+    a2dp_session->set_codec_index(pimpl_->a2dp_session_metrics_.codec_index);
+  }
+  set_a2dp_link_timeline(a2dp_session,
+                         &pimpl_->a2dp_session_metrics_.link_timeline);
 }
 
 void BluetoothMetricsLogger::WriteString(std::string* serialized, bool clear) {
@@ -469,6 +582,12 @@ void BluetoothMetricsLogger::Build() {
     bluetooth_log->mutable_wake_event()->AddAllocated(
         pimpl_->wake_event_queue_->Dequeue());
   }
+  while (!pimpl_->energy_sample_queue_->Empty() &&
+         static_cast<size_t>(bluetooth_log->energy_sample_size()) <=
+             pimpl_->energy_sample_queue_->Capacity()) {
+    bluetooth_log->mutable_energy_sample()->AddAllocated(
+        pimpl_->energy_sample_queue_->Dequeue());
+  }
   while (!pimpl_->bt_session_queue_->Empty() &&
          static_cast<size_t>(bluetooth_log->wake_event_size()) <=
              pimpl_->wake_event_queue_->Capacity()) {
@@ -499,6 +618,7 @@ void BluetoothMetricsLogger::Reset() {
   pimpl_->pair_event_queue_->Clear();
   pimpl_->wake_event_queue_->Clear();
   pimpl_->scan_event_queue_->Clear();
+  pimpl_->energy_sample_queue_->Clear();
 }
 
 }  // namespace system_bt_osi
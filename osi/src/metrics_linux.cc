@@ -156,6 +156,11 @@ void BluetoothMetricsLogger::LogScanEvent(bool start,
   // TODO(siyuanh): Implement for linux
 }
 
+void BluetoothMetricsLogger::LogEnergySample(const energy_sample_t& sample,
+                                             uint64_t timestamp_ms) {
+  // TODO(siyuanh): Implement for linux
+}
+
 void BluetoothMetricsLogger::LogBluetoothSessionStart(
     connection_tech_t connection_tech_type, uint64_t timestamp_ms) {
   // TODO(siyuanh): Implement for linux
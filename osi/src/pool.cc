@@ -0,0 +1,227 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_pool"
+
+#include "osi/include/pool.h"
+
+#include <base/logging.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+
+// Pool buffers are aligned the same way as the buffers returned by malloc()
+#define POOL_BUFFER_ALIGNMENT 16
+
+struct pool_t {
+  // The slab bounds are read without holding any lock by |pool_release|,
+  // which runs for every |osi_free|. |sequence| is odd while the bounds are
+  // being updated, so a reader can detect and skip an inconsistent snapshot.
+  std::atomic<uint32_t> sequence;
+  std::atomic<uintptr_t> slab_begin;
+  std::atomic<uintptr_t> slab_end;
+
+  std::mutex mutex;  // Protects all the fields below
+  bool in_use;       // True if this pool slot has been claimed
+  bool retired;      // True once |pool_free| has been called
+  uint8_t* slab;
+  size_t buffer_size;  // The buffer size requested by the user
+  size_t stride;       // The buffer size rounded up for alignment
+  size_t capacity;
+  size_t available;
+  size_t exhausted_count;
+  void* free_list;  // Singly linked through the first word of each buffer
+};
+
+static pool_t pools[POOL_MAX_POOLS];
+static std::mutex pools_mutex;  // Protects claiming and releasing pool slots
+static std::atomic<size_t> active_pools(0);
+
+static void pool_publish_slab(pool_t* pool, uintptr_t begin, uintptr_t end);
+static void pool_destroy(pool_t* pool);
+
+pool_t* pool_new(size_t buffer_size, size_t capacity) {
+  CHECK(buffer_size > 0);
+  CHECK(capacity > 0);
+
+  size_t stride = (buffer_size + POOL_BUFFER_ALIGNMENT - 1) &
+                  ~(size_t)(POOL_BUFFER_ALIGNMENT - 1);
+
+  std::lock_guard<std::mutex> lock(pools_mutex);
+
+  pool_t* pool = NULL;
+  for (size_t i = 0; i < POOL_MAX_POOLS; i++) {
+    if (!pools[i].in_use) {
+      pool = &pools[i];
+      break;
+    }
+  }
+  if (pool == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: no free pool slot (max %d)", __func__,
+              POOL_MAX_POOLS);
+    return NULL;
+  }
+
+  uint8_t* slab = static_cast<uint8_t*>(osi_malloc(stride * capacity));
+
+  {
+    std::lock_guard<std::mutex> pool_lock(pool->mutex);
+    pool->in_use = true;
+    pool->retired = false;
+    pool->slab = slab;
+    pool->buffer_size = buffer_size;
+    pool->stride = stride;
+    pool->capacity = capacity;
+    pool->available = capacity;
+    pool->exhausted_count = 0;
+    pool->free_list = NULL;
+    for (size_t i = capacity; i > 0; i--) {
+      void** buffer = reinterpret_cast<void**>(slab + (i - 1) * stride);
+      *buffer = pool->free_list;
+      pool->free_list = buffer;
+    }
+  }
+
+  pool_publish_slab(pool, reinterpret_cast<uintptr_t>(slab),
+                    reinterpret_cast<uintptr_t>(slab + stride * capacity));
+  active_pools++;
+
+  return pool;
+}
+
+void pool_free(pool_t* pool) {
+  if (pool == NULL) return;
+
+  bool destroy;
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    CHECK(pool->in_use);
+    CHECK(!pool->retired);
+    pool->retired = true;
+    destroy = (pool->available == pool->capacity);
+  }
+
+  if (destroy) pool_destroy(pool);
+}
+
+void* pool_alloc(pool_t* pool) {
+  CHECK(pool != NULL);
+
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  if (pool->retired || pool->free_list == NULL) {
+    pool->exhausted_count++;
+    return NULL;
+  }
+
+  void** buffer = static_cast<void**>(pool->free_list);
+  pool->free_list = *buffer;
+  pool->available--;
+  return buffer;
+}
+
+size_t pool_buffer_size(const pool_t* pool) {
+  CHECK(pool != NULL);
+  return pool->buffer_size;
+}
+
+size_t pool_capacity(const pool_t* pool) {
+  CHECK(pool != NULL);
+  return pool->capacity;
+}
+
+size_t pool_available(pool_t* pool) {
+  CHECK(pool != NULL);
+
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  return pool->available;
+}
+
+size_t pool_exhausted_count(pool_t* pool) {
+  CHECK(pool != NULL);
+
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  return pool->exhausted_count;
+}
+
+bool pool_release(void* ptr) {
+  if (ptr == NULL || active_pools.load(std::memory_order_relaxed) == 0)
+    return false;
+
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  for (size_t i = 0; i < POOL_MAX_POOLS; i++) {
+    pool_t* pool = &pools[i];
+
+    // A slab that is being published or withdrawn cannot contain |ptr|:
+    // a new slab has no outstanding buffers yet, and a slab is withdrawn
+    // only after all its buffers have been returned.
+    uint32_t sequence = pool->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) continue;
+    uintptr_t begin = pool->slab_begin.load(std::memory_order_relaxed);
+    uintptr_t end = pool->slab_end.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (pool->sequence.load(std::memory_order_relaxed) != sequence) continue;
+    if (address < begin || address >= end) continue;
+
+    bool destroy;
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      CHECK((address - begin) % pool->stride == 0);
+      CHECK(pool->available < pool->capacity);
+      void** buffer = static_cast<void**>(ptr);
+      *buffer = pool->free_list;
+      pool->free_list = buffer;
+      pool->available++;
+      destroy = pool->retired && (pool->available == pool->capacity);
+    }
+
+    if (destroy) pool_destroy(pool);
+    return true;
+  }
+
+  return false;
+}
+
+static void pool_publish_slab(pool_t* pool, uintptr_t begin, uintptr_t end) {
+  pool->sequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  pool->slab_begin.store(begin, std::memory_order_relaxed);
+  pool->slab_end.store(end, std::memory_order_relaxed);
+  pool->sequence.fetch_add(1, std::memory_order_release);
+}
+
+static void pool_destroy(pool_t* pool) {
+  uint8_t* slab;
+  {
+    std::lock_guard<std::mutex> lock(pools_mutex);
+    pool_publish_slab(pool, 0, 0);
+
+    std::lock_guard<std::mutex> pool_lock(pool->mutex);
+    slab = pool->slab;
+    pool->slab = NULL;
+    pool->free_list = NULL;
+    pool->in_use = false;
+  }
+  active_pools--;
+
+  // The slab is no longer published, so this goes to the heap.
+  osi_free(slab);
+}
@@ -29,11 +29,15 @@
 #include <sys/eventfd.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <mutex>
+#include <new>
 
 #include "osi/include/allocator.h"
 #include "osi/include/list.h"
 #include "osi/include/log.h"
+#include "osi/include/stall_log.h"
+#include "osi/include/time.h"
 
 #if !defined(EFD_SEMAPHORE)
 #define EFD_SEMAPHORE (1 << 0)
@@ -47,6 +51,8 @@ struct reactor_t {
   pthread_t run_thread;       // the pthread on which reactor_run is executing.
   bool is_running;            // indicates whether |run_thread| is valid.
   bool object_removed;
+  std::atomic<uint64_t> busy_us;            // time spent in the callbacks.
+  std::atomic<uint64_t> dispatch_start_us;  // 0 outside of the callbacks.
 };
 
 struct reactor_object_t {
@@ -59,15 +65,22 @@ struct reactor_object_t {
                                        // descriptor becomes readable.
   void (*write_ready)(void* context);  // function to call when the file
                                        // descriptor becomes writeable.
+
+  reactor_priority_t priority;  // the class this object is dispatched in.
+  reactor_object_stats_t stats;  // updated by the reactor thread.
 };
 
 static reactor_status_t run_reactor(reactor_t* reactor, int iterations);
+static void dispatch_object(reactor_t* reactor, reactor_object_t* object,
+                            uint32_t events, uint64_t wakeup_us);
 
 static const size_t MAX_EVENTS = 64;
 static const eventfd_t EVENT_REACTOR_STOP = 1;
 
 reactor_t* reactor_new(void) {
   reactor_t* ret = (reactor_t*)osi_calloc(sizeof(reactor_t));
+  new (&ret->busy_us) std::atomic<uint64_t>(0);
+  new (&ret->dispatch_start_us) std::atomic<uint64_t>(0);
 
   ret->epoll_fd = INVALID_FD;
   ret->event_fd = INVALID_FD;
@@ -139,8 +152,17 @@ void reactor_stop(reactor_t* reactor) {
 reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
                                    void (*read_ready)(void* context),
                                    void (*write_ready)(void* context)) {
+  return reactor_register_with_priority(reactor, fd, context,
+                                        REACTOR_PRIORITY_NORMAL, read_ready,
+                                        write_ready);
+}
+
+reactor_object_t* reactor_register_with_priority(
+    reactor_t* reactor, int fd, void* context, reactor_priority_t priority,
+    void (*read_ready)(void* context), void (*write_ready)(void* context)) {
   CHECK(reactor != NULL);
   CHECK(fd != INVALID_FD);
+  CHECK(priority >= REACTOR_PRIORITY_HIGH && priority <= REACTOR_PRIORITY_LOW);
 
   reactor_object_t* object =
       (reactor_object_t*)osi_calloc(sizeof(reactor_object_t));
@@ -150,6 +172,7 @@ reactor_object_t* reactor_register(reactor_t* reactor, int fd, void* context,
   object->context = context;
   object->read_ready = read_ready;
   object->write_ready = write_ready;
+  object->priority = priority;
   object->mutex = new std::mutex;
 
   struct epoll_event event;
@@ -228,6 +251,24 @@ void reactor_unregister(reactor_object_t* obj) {
   osi_free(obj);
 }
 
+void reactor_get_occupancy(const reactor_t* reactor,
+                           reactor_occupancy_t* occupancy) {
+  CHECK(reactor != NULL);
+  CHECK(occupancy != NULL);
+
+  occupancy->busy_us = reactor->busy_us;
+  occupancy->dispatch_start_us = reactor->dispatch_start_us;
+}
+
+void reactor_object_get_stats(reactor_object_t* object,
+                              reactor_object_stats_t* stats) {
+  CHECK(object != NULL);
+  CHECK(stats != NULL);
+
+  std::lock_guard<std::mutex> lock(*object->mutex);
+  *stats = object->stats;
+}
+
 // Runs the reactor loop for a maximum of |iterations|.
 // 0 |iterations| means loop forever.
 // |reactor| may not be NULL.
@@ -238,6 +279,10 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
   reactor->is_running = true;
 
   struct epoll_event events[MAX_EVENTS];
+  // The indexes in |events| of the ready objects, by priority class.
+  int ready[REACTOR_PRIORITY_LOW + 1][MAX_EVENTS];
+  int ready_count[REACTOR_PRIORITY_LOW + 1];
+
   for (int i = 0; iterations == 0 || i < iterations; ++i) {
     {
       std::lock_guard<std::mutex> lock(*reactor->list_mutex);
@@ -253,41 +298,39 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
       return REACTOR_STATUS_ERROR;
     }
 
-    for (int j = 0; j < ret; ++j) {
-      // The event file descriptor is the only one that registers with
-      // a NULL data pointer. We use the NULL to identify it and break
-      // out of the reactor loop.
-      if (events[j].data.ptr == NULL) {
-        eventfd_t value;
-        eventfd_read(reactor->event_fd, &value);
-        reactor->is_running = false;
-        return REACTOR_STATUS_STOP;
-      }
-
-      reactor_object_t* object = (reactor_object_t*)events[j].data.ptr;
+    uint64_t wakeup_us = time_get_os_boottime_us();
 
-      std::unique_lock<std::mutex> lock(*reactor->list_mutex);
-      if (list_contains(reactor->invalidation_list, object)) {
-        continue;
+    // Sort the ready objects by class. The objects are alive as long as they
+    // are not in |invalidation_list|, which is checked under |list_mutex|.
+    memset(ready_count, 0, sizeof(ready_count));
+    {
+      std::lock_guard<std::mutex> lock(*reactor->list_mutex);
+      for (int j = 0; j < ret; ++j) {
+        // The event file descriptor is the only one that registers with
+        // a NULL data pointer. We use the NULL to identify it and break
+        // out of the reactor loop.
+        if (events[j].data.ptr == NULL) {
+          eventfd_t value;
+          eventfd_read(reactor->event_fd, &value);
+          reactor->is_running = false;
+          return REACTOR_STATUS_STOP;
+        }
+
+        reactor_object_t* object = (reactor_object_t*)events[j].data.ptr;
+        if (list_contains(reactor->invalidation_list, object)) continue;
+        ready[object->priority][ready_count[object->priority]++] = j;
       }
+    }
 
-      // Downgrade the list lock to an object lock.
-      {
-        std::lock_guard<std::mutex> obj_lock(*object->mutex);
-        lock.unlock();
-
-        reactor->object_removed = false;
-        if (events[j].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) &&
-            object->read_ready)
-          object->read_ready(object->context);
-        if (!reactor->object_removed && events[j].events & EPOLLOUT &&
-            object->write_ready)
-          object->write_ready(object->context);
-      }
+    if (ready_count[REACTOR_PRIORITY_LOW] > REACTOR_LOW_PRIORITY_BATCH)
+      ready_count[REACTOR_PRIORITY_LOW] = REACTOR_LOW_PRIORITY_BATCH;
 
-      if (reactor->object_removed) {
-        delete object->mutex;
-        osi_free(object);
+    for (int priority = REACTOR_PRIORITY_HIGH; priority <= REACTOR_PRIORITY_LOW;
+         ++priority) {
+      for (int k = 0; k < ready_count[priority]; ++k) {
+        struct epoll_event* event = &events[ready[priority][k]];
+        dispatch_object(reactor, (reactor_object_t*)event->data.ptr,
+                        event->events, wakeup_us);
       }
     }
   }
@@ -295,3 +338,53 @@ static reactor_status_t run_reactor(reactor_t* reactor, int iterations) {
   reactor->is_running = false;
   return REACTOR_STATUS_DONE;
 }
+
+// Calls the callbacks of |object| for the epoll |events|, unless |object| was
+// unregistered by an earlier callback of the same iteration.
+static void dispatch_object(reactor_t* reactor, reactor_object_t* object,
+                            uint32_t events, uint64_t wakeup_us) {
+  std::unique_lock<std::mutex> lock(*reactor->list_mutex);
+  if (list_contains(reactor->invalidation_list, object)) {
+    return;
+  }
+
+  // Downgrade the list lock to an object lock.
+  {
+    std::lock_guard<std::mutex> obj_lock(*object->mutex);
+    lock.unlock();
+
+    uint64_t start_us = time_get_os_boottime_us();
+    reactor->dispatch_start_us = start_us;
+    stall_log_dispatch_start(object->read_ready
+                                 ? (const void*)object->read_ready
+                                 : (const void*)object->write_ready);
+
+    reactor->object_removed = false;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) &&
+        object->read_ready)
+      object->read_ready(object->context);
+    if (!reactor->object_removed && events & EPOLLOUT && object->write_ready)
+      object->write_ready(object->context);
+
+    uint64_t run_us = time_get_os_boottime_us() - start_us;
+    stall_log_dispatch_end(start_us, run_us);
+    reactor->busy_us += run_us;
+    reactor->dispatch_start_us = 0;
+
+    if (!reactor->object_removed) {
+      uint64_t delay_us = start_us - wakeup_us;
+      reactor_object_stats_t* stats = &object->stats;
+
+      stats->dispatch_count++;
+      stats->total_delay_us += delay_us;
+      if (delay_us > stats->max_delay_us) stats->max_delay_us = delay_us;
+      stats->total_run_us += run_us;
+      if (run_us > stats->max_run_us) stats->max_run_us = run_us;
+    }
+  }
+
+  if (reactor->object_removed) {
+    delete object->mutex;
+    osi_free(object);
+  }
+}
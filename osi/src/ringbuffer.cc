@@ -18,25 +18,53 @@
 
 #include <base/logging.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <new>
 
 #include "osi/include/allocator.h"
 #include "osi/include/ringbuffer.h"
 
+// |head| and |tail| are positions in [0, 2 * |total|): the data size is
+// |tail - head| modulo 2 * |total|, and the offset of a position in the
+// buffer is the position modulo |total|. Running over twice the buffer size
+// tells a full buffer from an empty one, without a shared counter.
+//
+// The producer owns |tail| and the consumer owns |head|: each side publishes
+// its position with a release store, once it is done with the bytes, and
+// reads the other side with an acquire load.
 struct ringbuffer_t {
   size_t total;
-  size_t available;
   uint8_t* base;
-  uint8_t* head;
-  uint8_t* tail;
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
 };
 
+static size_t ringbuffer_advance(const ringbuffer_t* rb, size_t pos,
+                                 size_t length) {
+  pos += length;
+  if (pos >= 2 * rb->total) pos -= 2 * rb->total;
+  return pos;
+}
+
+static size_t ringbuffer_offset(const ringbuffer_t* rb, size_t pos) {
+  return pos >= rb->total ? pos - rb->total : pos;
+}
+
+static size_t ringbuffer_used(const ringbuffer_t* rb, size_t head,
+                              size_t tail) {
+  return tail >= head ? tail - head : 2 * rb->total - head + tail;
+}
+
 ringbuffer_t* ringbuffer_init(const size_t size) {
   ringbuffer_t* p =
       static_cast<ringbuffer_t*>(osi_calloc(sizeof(ringbuffer_t)));
 
   p->base = static_cast<uint8_t*>(osi_calloc(size));
-  p->head = p->tail = p->base;
-  p->total = p->available = size;
+  p->total = size;
+  new (&p->head) std::atomic<size_t>(0);
+  new (&p->tail) std::atomic<size_t>(0);
 
   return p;
 }
@@ -48,27 +76,31 @@ void ringbuffer_free(ringbuffer_t* rb) {
 
 size_t ringbuffer_available(const ringbuffer_t* rb) {
   CHECK(rb);
-  return rb->available;
+  return rb->total - ringbuffer_size(rb);
 }
 
 size_t ringbuffer_size(const ringbuffer_t* rb) {
   CHECK(rb);
-  return rb->total - rb->available;
+  return ringbuffer_used(rb, rb->head.load(std::memory_order_acquire),
+                         rb->tail.load(std::memory_order_acquire));
 }
 
 size_t ringbuffer_insert(ringbuffer_t* rb, const uint8_t* p, size_t length) {
   CHECK(rb);
   CHECK(p);
 
-  if (length > ringbuffer_available(rb)) length = ringbuffer_available(rb);
+  size_t inserted = 0;
+  while (inserted < length) {
+    uint8_t* span;
+    size_t span_len = ringbuffer_reserve(rb, &span, length - inserted);
+    if (span_len == 0) break;
 
-  for (size_t i = 0; i != length; ++i) {
-    *rb->tail++ = *p++;
-    if (rb->tail >= (rb->base + rb->total)) rb->tail = rb->base;
+    memcpy(span, p + inserted, span_len);
+    ringbuffer_commit(rb, span_len);
+    inserted += span_len;
   }
 
-  rb->available -= length;
-  return length;
+  return inserted;
 }
 
 size_t ringbuffer_delete(ringbuffer_t* rb, size_t length) {
@@ -76,10 +108,7 @@ size_t ringbuffer_delete(ringbuffer_t* rb, size_t length) {
 
   if (length > ringbuffer_size(rb)) length = ringbuffer_size(rb);
 
-  rb->head += length;
-  if (rb->head >= (rb->base + rb->total)) rb->head -= rb->total;
-
-  rb->available += length;
+  ringbuffer_release(rb, length);
   return length;
 }
 
@@ -88,17 +117,21 @@ size_t ringbuffer_peek(const ringbuffer_t* rb, off_t offset, uint8_t* p,
   CHECK(rb);
   CHECK(p);
   CHECK(offset >= 0);
-  CHECK((size_t)offset <= ringbuffer_size(rb));
 
-  uint8_t* b = ((rb->head - rb->base + offset) % rb->total) + rb->base;
-  const size_t bytes_to_copy = (offset + length > ringbuffer_size(rb))
-                                   ? ringbuffer_size(rb) - offset
-                                   : length;
+  const size_t head = rb->head.load(std::memory_order_relaxed);
+  const size_t size =
+      ringbuffer_used(rb, head, rb->tail.load(std::memory_order_acquire));
+  CHECK((size_t)offset <= size);
 
-  for (size_t copied = 0; copied < bytes_to_copy; ++copied) {
-    *p++ = *b++;
-    if (b >= (rb->base + rb->total)) b = rb->base;
-  }
+  const size_t bytes_to_copy =
+      (offset + length > size) ? size - offset : length;
+
+  // At most two spans: up to the end of the buffer, then from its start
+  size_t start = ringbuffer_offset(rb, ringbuffer_advance(rb, head, offset));
+  size_t first = rb->total - start;
+  if (first > bytes_to_copy) first = bytes_to_copy;
+  memcpy(p, rb->base + start, first);
+  memcpy(p + first, rb->base, bytes_to_copy - first);
 
   return bytes_to_copy;
 }
@@ -108,9 +141,63 @@ size_t ringbuffer_pop(ringbuffer_t* rb, uint8_t* p, size_t length) {
   CHECK(p);
 
   const size_t copied = ringbuffer_peek(rb, 0, p, length);
-  rb->head += copied;
-  if (rb->head >= (rb->base + rb->total)) rb->head -= rb->total;
-
-  rb->available += copied;
+  ringbuffer_release(rb, copied);
   return copied;
 }
+
+size_t ringbuffer_reserve(ringbuffer_t* rb, uint8_t** p, size_t length) {
+  CHECK(rb);
+  CHECK(p);
+
+  const size_t tail = rb->tail.load(std::memory_order_relaxed);
+  const size_t free_len =
+      rb->total -
+      ringbuffer_used(rb, rb->head.load(std::memory_order_acquire), tail);
+
+  const size_t offset = ringbuffer_offset(rb, tail);
+  size_t contiguous = rb->total - offset;
+  if (contiguous > free_len) contiguous = free_len;
+  if (contiguous > length) contiguous = length;
+
+  *p = rb->base + offset;
+  return contiguous;
+}
+
+void ringbuffer_commit(ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+
+  const size_t tail = rb->tail.load(std::memory_order_relaxed);
+  const size_t head = rb->head.load(std::memory_order_acquire);
+  CHECK(length <= rb->total - ringbuffer_offset(rb, tail));
+  CHECK(length <= rb->total - ringbuffer_used(rb, head, tail));
+
+  rb->tail.store(ringbuffer_advance(rb, tail, length),
+                 std::memory_order_release);
+}
+
+size_t ringbuffer_peek_contiguous(const ringbuffer_t* rb, const uint8_t** p) {
+  CHECK(rb);
+  CHECK(p);
+
+  const size_t head = rb->head.load(std::memory_order_relaxed);
+  const size_t size =
+      ringbuffer_used(rb, head, rb->tail.load(std::memory_order_acquire));
+
+  const size_t offset = ringbuffer_offset(rb, head);
+  size_t contiguous = rb->total - offset;
+  if (contiguous > size) contiguous = size;
+
+  *p = rb->base + offset;
+  return contiguous;
+}
+
+void ringbuffer_release(ringbuffer_t* rb, size_t length) {
+  CHECK(rb);
+
+  const size_t head = rb->head.load(std::memory_order_relaxed);
+  CHECK(length <=
+        ringbuffer_used(rb, head, rb->tail.load(std::memory_order_acquire)));
+
+  rb->head.store(ringbuffer_advance(rb, head, length),
+                 std::memory_order_release);
+}
@@ -23,11 +23,17 @@
 #include <base/logging.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <malloc.h>
+#include <linux/futex.h>
 #include <string.h>
 #include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <new>
+
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -37,11 +43,32 @@
 #endif
 
 struct semaphore_t {
-  int fd;
+  int fd;  // INVALID_FD for a lightweight semaphore
+
+  // The value and the number of blocked threads of a lightweight semaphore.
+  // The threads sleep on the futex of |value| while it is 0.
+  std::atomic<int32_t> value;
+  std::atomic<int32_t> waiters;
 };
 
-semaphore_t* semaphore_new(unsigned int value) {
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "the value of a semaphore must be usable as a futex");
+
+static semaphore_t* semaphore_alloc(void) {
   semaphore_t* ret = static_cast<semaphore_t*>(osi_malloc(sizeof(semaphore_t)));
+  ret->fd = INVALID_FD;
+  new (&ret->value) std::atomic<int32_t>(0);
+  new (&ret->waiters) std::atomic<int32_t>(0);
+  return ret;
+}
+
+static int futex(std::atomic<int32_t>* addr, int op, int32_t value) {
+  return syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), op, value, NULL,
+                 NULL, 0);
+}
+
+semaphore_t* semaphore_new(unsigned int value) {
+  semaphore_t* ret = semaphore_alloc();
   ret->fd = eventfd(value, EFD_SEMAPHORE);
   if (ret->fd == INVALID_FD) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate semaphore: %s", __func__,
@@ -52,6 +79,14 @@ semaphore_t* semaphore_new(unsigned int value) {
   return ret;
 }
 
+semaphore_t* semaphore_new_lightweight(unsigned int value) {
+  CHECK(value <= INT32_MAX);
+
+  semaphore_t* ret = semaphore_alloc();
+  ret->value = value;
+  return ret;
+}
+
 void semaphore_free(semaphore_t* semaphore) {
   if (!semaphore) return;
 
@@ -61,7 +96,25 @@ void semaphore_free(semaphore_t* semaphore) {
 
 void semaphore_wait(semaphore_t* semaphore) {
   CHECK(semaphore != NULL);
-  CHECK(semaphore->fd != INVALID_FD);
+
+  if (semaphore->fd == INVALID_FD) {
+    int32_t value = semaphore->value.load();
+    while (true) {
+      if (value > 0) {
+        if (semaphore->value.compare_exchange_weak(value, value - 1)) return;
+        continue;
+      }
+
+      // Sleeps only if the value is still 0, a post in between wakes us up
+      semaphore->waiters++;
+      if (futex(&semaphore->value, FUTEX_WAIT_PRIVATE, 0) == -1 &&
+          errno != EAGAIN && errno != EINTR)
+        LOG_ERROR(LOG_TAG, "%s unable to wait on semaphore: %s", __func__,
+                  strerror(errno));
+      semaphore->waiters--;
+      value = semaphore->value.load();
+    }
+  }
 
   eventfd_t value;
   if (eventfd_read(semaphore->fd, &value) == -1)
@@ -70,36 +123,65 @@ void semaphore_wait(semaphore_t* semaphore) {
 }
 
 bool semaphore_try_wait(semaphore_t* semaphore) {
+  return semaphore_try_wait_n(semaphore, 1) == 1;
+}
+
+size_t semaphore_try_wait_n(semaphore_t* semaphore, size_t count) {
   CHECK(semaphore != NULL);
-  CHECK(semaphore->fd != INVALID_FD);
+
+  if (semaphore->fd == INVALID_FD) {
+    int32_t value = semaphore->value.load();
+    while (value > 0) {
+      int32_t decremented = count < (size_t)value ? (int32_t)count : value;
+      if (semaphore->value.compare_exchange_weak(value, value - decremented))
+        return decremented;
+    }
+    return 0;
+  }
 
   int flags = fcntl(semaphore->fd, F_GETFL);
   if (flags == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to get flags for semaphore fd: %s", __func__,
               strerror(errno));
-    return false;
+    return 0;
   }
   if (fcntl(semaphore->fd, F_SETFL, flags | O_NONBLOCK) == -1) {
     LOG_ERROR(LOG_TAG, "%s unable to set O_NONBLOCK for semaphore fd: %s",
               __func__, strerror(errno));
-    return false;
+    return 0;
   }
 
-  bool rc = true;
+  // Each read decrements the value by one, as the eventfd is a semaphore
+  size_t decremented = 0;
   eventfd_t value;
-  if (eventfd_read(semaphore->fd, &value) == -1) rc = false;
+  while (decremented < count && eventfd_read(semaphore->fd, &value) != -1)
+    decremented++;
 
   if (fcntl(semaphore->fd, F_SETFL, flags) == -1)
     LOG_ERROR(LOG_TAG, "%s unable to restore flags for semaphore fd: %s",
               __func__, strerror(errno));
-  return rc;
+  return decremented;
 }
 
-void semaphore_post(semaphore_t* semaphore) {
+void semaphore_post(semaphore_t* semaphore) { semaphore_post_n(semaphore, 1); }
+
+void semaphore_post_n(semaphore_t* semaphore, size_t count) {
   CHECK(semaphore != NULL);
-  CHECK(semaphore->fd != INVALID_FD);
 
-  if (eventfd_write(semaphore->fd, 1ULL) == -1)
+  if (count == 0) return;
+
+  if (semaphore->fd == INVALID_FD) {
+    CHECK(count <= INT32_MAX);
+    semaphore->value += count;
+    // No system call unless a thread is blocked on the semaphore
+    if (semaphore->waiters.load() > 0 &&
+        futex(&semaphore->value, FUTEX_WAKE_PRIVATE, count) == -1)
+      LOG_ERROR(LOG_TAG, "%s unable to post to semaphore: %s", __func__,
+                strerror(errno));
+    return;
+  }
+
+  if (eventfd_write(semaphore->fd, count) == -1)
     LOG_ERROR(LOG_TAG, "%s unable to post to semaphore: %s", __func__,
               strerror(errno));
 }
@@ -0,0 +1,292 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_slab"
+
+#include "osi/include/slab.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/log.h"
+
+// The arena is reserved at once, but only the pages handed to a size class
+// are ever touched and backed by memory.
+#define SLAB_ARENA_SIZE (8 * 1024 * 1024)
+#define SLAB_PAGE_SIZE (64 * 1024)
+#define SLAB_NUM_PAGES (SLAB_ARENA_SIZE / SLAB_PAGE_SIZE)
+
+typedef struct {
+  size_t size;
+  std::mutex mutex;  // Protects all the fields below
+  void* free_list;   // The depot, linked through the first word of objects
+  size_t free_count;
+  size_t pages;
+  size_t refills;    // Magazines refilled from the depot
+  size_t flushes;    // Magazines flushed to the depot
+  size_t fallbacks;  // Allocations left to the heap as the arena was full
+} slab_class_t;
+
+typedef struct {
+  size_t count[SLAB_NUM_SIZE_CLASSES];
+  void* objects[SLAB_NUM_SIZE_CLASSES][SLAB_MAGAZINE_SIZE];
+} slab_magazine_t;
+
+static const size_t class_sizes[SLAB_NUM_SIZE_CLASSES] = SLAB_SIZE_CLASSES;
+static slab_class_t classes[SLAB_NUM_SIZE_CLASSES];
+
+static std::atomic<uintptr_t> arena_begin(0);
+static std::mutex arena_mutex;  // Protects claiming pages
+static size_t next_page;
+static std::atomic<uint8_t> page_class[SLAB_NUM_PAGES];
+
+// The magazine of the current thread. It is flushed to the depots by the
+// destructor of |magazine_key| when the thread exits, after which the
+// thread uses the depots directly.
+static pthread_key_t magazine_key;
+static thread_local slab_magazine_t* magazine = NULL;
+static thread_local bool magazine_retired = false;
+
+static int size_class(size_t size);
+static slab_magazine_t* get_magazine(void);
+static void magazine_destructor(void* data);
+static bool class_grow_locked(size_t index);
+static void* depot_pop(size_t index);
+static void depot_push_locked(slab_class_t* slab_class, void* object);
+
+void slab_init(void) {
+  std::lock_guard<std::mutex> lock(arena_mutex);
+  if (arena_begin.load(std::memory_order_relaxed) != 0) return;
+
+  CHECK(SLAB_NUM_SIZE_CLASSES ==
+        sizeof(class_sizes) / sizeof(class_sizes[0]));
+
+  void* arena = mmap(NULL, SLAB_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (arena == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to reserve the arena: %s", __func__,
+              strerror(errno));
+    return;
+  }
+
+  if (pthread_key_create(&magazine_key, magazine_destructor) != 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the magazine key", __func__);
+    munmap(arena, SLAB_ARENA_SIZE);
+    return;
+  }
+
+  for (size_t i = 0; i < SLAB_NUM_SIZE_CLASSES; i++) {
+    CHECK(class_sizes[i] % sizeof(void*) == 0);
+    classes[i].size = class_sizes[i];
+  }
+
+  arena_begin.store(reinterpret_cast<uintptr_t>(arena),
+                    std::memory_order_release);
+  LOG_INFO(LOG_TAG, "%s slab allocator enabled", __func__);
+}
+
+bool slab_is_enabled(void) {
+  return arena_begin.load(std::memory_order_acquire) != 0;
+}
+
+void* slab_alloc(size_t size) {
+  if (!slab_is_enabled()) return NULL;
+
+  int index = size_class(size);
+  if (index < 0) return NULL;
+
+  slab_magazine_t* mag = get_magazine();
+  if (mag == NULL) return depot_pop(index);
+
+  if (mag->count[index] == 0) {
+    slab_class_t* slab_class = &classes[index];
+    std::lock_guard<std::mutex> lock(slab_class->mutex);
+    if (slab_class->free_list == NULL && !class_grow_locked(index)) {
+      slab_class->fallbacks++;
+      return NULL;
+    }
+    while (mag->count[index] < SLAB_MAGAZINE_SIZE / 2 &&
+           slab_class->free_list != NULL) {
+      void** object = static_cast<void**>(slab_class->free_list);
+      slab_class->free_list = *object;
+      slab_class->free_count--;
+      mag->objects[index][mag->count[index]++] = object;
+    }
+    slab_class->refills++;
+  }
+
+  return mag->objects[index][--mag->count[index]];
+}
+
+bool slab_release(void* ptr) {
+  uintptr_t begin = arena_begin.load(std::memory_order_acquire);
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  if (begin == 0 || address < begin || address >= begin + SLAB_ARENA_SIZE)
+    return false;
+
+  size_t page = (address - begin) / SLAB_PAGE_SIZE;
+  size_t index = page_class[page].load(std::memory_order_relaxed);
+  slab_class_t* slab_class = &classes[index];
+  CHECK((address - begin - page * SLAB_PAGE_SIZE) % slab_class->size == 0);
+
+  slab_magazine_t* mag = get_magazine();
+  if (mag == NULL) {
+    std::lock_guard<std::mutex> lock(slab_class->mutex);
+    depot_push_locked(slab_class, ptr);
+    return true;
+  }
+
+  // Flush half of a full magazine, so that a thread alternating between
+  // freeing and allocating does not go to the depot every time.
+  if (mag->count[index] == SLAB_MAGAZINE_SIZE) {
+    std::lock_guard<std::mutex> lock(slab_class->mutex);
+    while (mag->count[index] > SLAB_MAGAZINE_SIZE / 2)
+      depot_push_locked(slab_class, mag->objects[index][--mag->count[index]]);
+    slab_class->flushes++;
+  }
+
+  mag->objects[index][mag->count[index]++] = ptr;
+  return true;
+}
+
+void slab_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Slab Allocator:\n");
+
+  if (!slab_is_enabled()) {
+    dprintf(fd, "  Disabled\n");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    dprintf(fd, "  Arena pages used/total : %zu / %d (%d octets each)\n",
+            next_page, SLAB_NUM_PAGES, SLAB_PAGE_SIZE);
+  }
+
+  dprintf(fd,
+          "  Size   Pages  Objects  In depot  Refills  Flushes  "
+          "Fallbacks\n");
+  for (size_t i = 0; i < SLAB_NUM_SIZE_CLASSES; i++) {
+    slab_class_t* slab_class = &classes[i];
+    std::lock_guard<std::mutex> lock(slab_class->mutex);
+    dprintf(fd, "  %-5zu  %-5zu  %-7zu  %-8zu  %-7zu  %-7zu  %zu\n",
+            slab_class->size, slab_class->pages,
+            slab_class->pages * (SLAB_PAGE_SIZE / slab_class->size),
+            slab_class->free_count, slab_class->refills, slab_class->flushes,
+            slab_class->fallbacks);
+  }
+}
+
+// Returns the index of the smallest size class that fits |size|, or -1 if
+// none does.
+static int size_class(size_t size) {
+  for (int i = 0; i < SLAB_NUM_SIZE_CLASSES; i++) {
+    if (size <= class_sizes[i]) return i;
+  }
+  return -1;
+}
+
+static slab_magazine_t* get_magazine(void) {
+  if (magazine != NULL || magazine_retired) return magazine;
+
+  // Not from the osi allocator, which calls this function.
+  slab_magazine_t* mag =
+      static_cast<slab_magazine_t*>(calloc(1, sizeof(slab_magazine_t)));
+  if (mag == NULL) return NULL;
+
+  if (pthread_setspecific(magazine_key, mag) != 0) {
+    free(mag);
+    return NULL;
+  }
+
+  magazine = mag;
+  return mag;
+}
+
+static void magazine_destructor(void* data) {
+  slab_magazine_t* mag = static_cast<slab_magazine_t*>(data);
+
+  magazine = NULL;
+  magazine_retired = true;
+
+  for (size_t i = 0; i < SLAB_NUM_SIZE_CLASSES; i++) {
+    if (mag->count[i] == 0) continue;
+
+    slab_class_t* slab_class = &classes[i];
+    std::lock_guard<std::mutex> lock(slab_class->mutex);
+    while (mag->count[i] > 0)
+      depot_push_locked(slab_class, mag->objects[i][--mag->count[i]]);
+    slab_class->flushes++;
+  }
+
+  free(mag);
+}
+
+// Carves a new page into objects for the size class |index|. The lock of the
+// size class must be held. Returns false if the arena is exhausted.
+static bool class_grow_locked(size_t index) {
+  slab_class_t* slab_class = &classes[index];
+  size_t page;
+  {
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    if (next_page == SLAB_NUM_PAGES) return false;
+    page = next_page++;
+  }
+  page_class[page].store(index, std::memory_order_relaxed);
+
+  uint8_t* begin = reinterpret_cast<uint8_t*>(
+      arena_begin.load(std::memory_order_relaxed) + page * SLAB_PAGE_SIZE);
+  size_t count = SLAB_PAGE_SIZE / slab_class->size;
+  for (size_t i = count; i > 0; i--)
+    depot_push_locked(slab_class, begin + (i - 1) * slab_class->size);
+  slab_class->pages++;
+
+  return true;
+}
+
+// Takes an object of the size class |index| straight from the depot, for the
+// threads that have no magazine.
+static void* depot_pop(size_t index) {
+  slab_class_t* slab_class = &classes[index];
+  std::lock_guard<std::mutex> lock(slab_class->mutex);
+
+  if (slab_class->free_list == NULL && !class_grow_locked(index)) {
+    slab_class->fallbacks++;
+    return NULL;
+  }
+
+  void** object = static_cast<void**>(slab_class->free_list);
+  slab_class->free_list = *object;
+  slab_class->free_count--;
+  return object;
+}
+
+static void depot_push_locked(slab_class_t* slab_class, void* object) {
+  *static_cast<void**>(object) = slab_class->free_list;
+  slab_class->free_list = object;
+  slab_class->free_count++;
+}
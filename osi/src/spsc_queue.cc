@@ -0,0 +1,164 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/spsc_queue.h"
+
+#include <base/logging.h>
+
+#include <atomic>
+#include <new>
+
+#include "osi/include/allocator.h"
+#include "osi/include/time.h"
+
+typedef struct {
+  std::atomic<void*> data;
+  std::atomic<uint64_t> enqueue_us;
+} spsc_queue_slot_t;
+
+// |head| and |tail| are free-running counters: the element count is
+// |tail - head|, and the slot of a counter is |counter & mask|. The ring has
+// a power-of-two number of slots, so the counters may wrap around.
+//
+// The producer owns |tail|. Since the dequeue side may run on more than one
+// thread (e.g. a flush from the producer), |head| is advanced with a
+// compare-and-swap; a consumer that loses the race discards what it read.
+struct spsc_queue_t {
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  uint32_t mask;
+  size_t capacity;
+  spsc_queue_slot_t* slots;
+};
+
+spsc_queue_t* spsc_queue_new(size_t capacity) {
+  CHECK(capacity > 0);
+  CHECK(capacity <= (UINT32_MAX >> 1));
+
+  size_t slots_n = 1;
+  while (slots_n < capacity) slots_n <<= 1;
+
+  spsc_queue_t* queue =
+      static_cast<spsc_queue_t*>(osi_calloc(sizeof(spsc_queue_t)));
+  new (&queue->head) std::atomic<uint32_t>(0);
+  new (&queue->tail) std::atomic<uint32_t>(0);
+  queue->mask = slots_n - 1;
+  queue->capacity = capacity;
+  queue->slots = static_cast<spsc_queue_slot_t*>(
+      osi_calloc(slots_n * sizeof(spsc_queue_slot_t)));
+  for (size_t i = 0; i < slots_n; i++) {
+    new (&queue->slots[i].data) std::atomic<void*>(nullptr);
+    new (&queue->slots[i].enqueue_us) std::atomic<uint64_t>(0);
+  }
+
+  return queue;
+}
+
+void spsc_queue_free(spsc_queue_t* queue, spsc_queue_free_cb free_cb) {
+  if (!queue) return;
+
+  spsc_queue_flush(queue, free_cb);
+  osi_free(queue->slots);
+  osi_free(queue);
+}
+
+size_t spsc_queue_flush(spsc_queue_t* queue, spsc_queue_free_cb free_cb) {
+  if (!queue) return 0;
+
+  size_t flushed_n = 0;
+  void* data;
+  while ((data = spsc_queue_try_dequeue(queue)) != NULL) {
+    if (free_cb) free_cb(data);
+    flushed_n++;
+  }
+  return flushed_n;
+}
+
+bool spsc_queue_is_empty(spsc_queue_t* queue) {
+  return spsc_queue_length(queue) == 0;
+}
+
+size_t spsc_queue_length(spsc_queue_t* queue) {
+  if (!queue) return 0;
+
+  // Read |head| first: |tail| never falls behind a previously read |head|
+  uint32_t head = queue->head.load(std::memory_order_acquire);
+  uint32_t tail = queue->tail.load(std::memory_order_acquire);
+  return tail - head;
+}
+
+size_t spsc_queue_capacity(spsc_queue_t* queue) {
+  CHECK(queue != NULL);
+
+  return queue->capacity;
+}
+
+bool spsc_queue_try_enqueue(spsc_queue_t* queue, void* data) {
+  CHECK(queue != NULL);
+  CHECK(data != NULL);
+
+  uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+  uint32_t head = queue->head.load(std::memory_order_acquire);
+  if (tail - head >= queue->capacity) return false;
+
+  spsc_queue_slot_t* slot = &queue->slots[tail & queue->mask];
+  slot->enqueue_us.store(time_get_os_boottime_us(), std::memory_order_relaxed);
+  slot->data.store(data, std::memory_order_relaxed);
+  queue->tail.store(tail + 1, std::memory_order_release);
+
+  return true;
+}
+
+void* spsc_queue_try_dequeue(spsc_queue_t* queue) {
+  uint64_t enqueue_us;
+  return spsc_queue_try_dequeue_timed(queue, &enqueue_us);
+}
+
+void* spsc_queue_try_dequeue_timed(spsc_queue_t* queue,
+                                   uint64_t* p_enqueue_us) {
+  CHECK(p_enqueue_us != NULL);
+  if (!queue) return NULL;
+
+  uint32_t head = queue->head.load(std::memory_order_acquire);
+  while (true) {
+    uint32_t tail = queue->tail.load(std::memory_order_acquire);
+    if (head == tail) return NULL;
+
+    spsc_queue_slot_t* slot = &queue->slots[head & queue->mask];
+    void* data = slot->data.load(std::memory_order_relaxed);
+    uint64_t enqueue_us = slot->enqueue_us.load(std::memory_order_relaxed);
+    // On failure |head| is reloaded and the read slot is discarded
+    if (queue->head.compare_exchange_weak(head, head + 1,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+      *p_enqueue_us = enqueue_us;
+      return data;
+    }
+  }
+}
+
+uint64_t spsc_queue_first_enqueue_us(spsc_queue_t* queue) {
+  if (!queue) return 0;
+
+  uint32_t head = queue->head.load(std::memory_order_acquire);
+  uint32_t tail = queue->tail.load(std::memory_order_acquire);
+  if (head == tail) return 0;
+
+  return queue->slots[head & queue->mask].enqueue_us.load(
+      std::memory_order_relaxed);
+}
@@ -0,0 +1,323 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_stall_log"
+
+#include "osi/include/stall_log.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <unwind.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/compat.h"
+#include "osi/include/log.h"
+#include "osi/include/time.h"
+
+#if !defined(sigev_notify_thread_id)
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// The signal interrupting a callback to sample its stack
+#define STALL_LOG_SAMPLE_SIGNAL SIGPROF
+
+// The frames of the signal handler and of the unwinder, above the callback
+#define STALL_LOG_SAMPLE_SKIPPED_FRAMES 2
+
+// The threads summed up in the dump
+#define STALL_LOG_MAX_THREADS 16
+
+#define STALL_LOG_THREAD_NAME_LEN 16
+
+typedef struct {
+  uint64_t start_us;
+  uint64_t run_us;
+  char thread_name[STALL_LOG_THREAD_NAME_LEN];
+  const void* function;
+  const char* origin_function;
+  const char* origin_file;
+  int origin_line;
+  int frame_count;
+  void* frames[STALL_LOG_MAX_FRAMES];
+} stall_record_t;
+
+typedef struct {
+  char name[STALL_LOG_THREAD_NAME_LEN];
+  uint64_t count;
+  uint64_t total_run_us;
+  uint64_t max_run_us;
+} stall_thread_stats_t;
+
+// The callback running on a thread, read by the signal handler
+typedef struct {
+  int depth;
+  const void* function;
+  const char* origin_function;
+  const char* origin_file;
+  int origin_line;
+  bool has_timer;
+  bool timer_armed;
+  timer_t timer;
+  volatile sig_atomic_t sampling;
+  volatile sig_atomic_t frame_count;
+  void* frames[STALL_LOG_MAX_FRAMES + STALL_LOG_SAMPLE_SKIPPED_FRAMES];
+} stall_dispatch_t;
+
+static std::atomic<uint32_t> threshold_ms(STALL_LOG_DEFAULT_THRESHOLD_MS);
+static std::atomic_bool sampling_enabled(false);
+
+static std::mutex stall_mutex;
+static stall_record_t records[STALL_LOG_SIZE];
+static uint64_t record_count;
+static stall_thread_stats_t thread_stats[STALL_LOG_MAX_THREADS];
+
+static thread_local stall_dispatch_t dispatch;
+
+static std::once_flag handler_once;
+
+static _Unwind_Reason_Code sample_frame_cb(struct _Unwind_Context* context,
+                                           void* arg) {
+  stall_dispatch_t* d = (stall_dispatch_t*)arg;
+  uintptr_t pc = _Unwind_GetIP(context);
+  if (pc == 0) return _URC_END_OF_STACK;
+  d->frames[d->frame_count++] = (void*)pc;
+  if (d->frame_count == (int)(sizeof(d->frames) / sizeof(d->frames[0])))
+    return _URC_END_OF_STACK;
+  return _URC_NO_REASON;
+}
+
+static void sample_signal_handler(int signum, siginfo_t* info, void* ucontext) {
+  stall_dispatch_t* d = &dispatch;
+  if (!d->sampling || d->frame_count != 0) return;
+
+  int saved_errno = errno;
+  _Unwind_Backtrace(sample_frame_cb, d);
+  errno = saved_errno;
+}
+
+static void install_handler(void) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = sample_signal_handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(STALL_LOG_SAMPLE_SIGNAL, &action, NULL) != 0)
+    LOG_ERROR(LOG_TAG, "%s unable to install the sampling handler: %s",
+              __func__, strerror(errno));
+}
+
+// Arms the timer of the calling thread to sample the stack of the callback
+// at the threshold.
+static void arm_sampling(uint32_t threshold) {
+  if (!dispatch.has_timer) {
+    std::call_once(handler_once, install_handler);
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = STALL_LOG_SAMPLE_SIGNAL;
+    event.sigev_notify_thread_id = gettid();
+    if (timer_create(CLOCK_MONOTONIC, &event, &dispatch.timer) != 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to create the sampling timer: %s",
+                __func__, strerror(errno));
+      return;
+    }
+    dispatch.has_timer = true;
+  }
+
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = threshold / 1000;
+  spec.it_value.tv_nsec = (threshold % 1000) * 1000000;
+  dispatch.frame_count = 0;
+  dispatch.sampling = 1;
+  dispatch.timer_armed = timer_settime(dispatch.timer, 0, &spec, NULL) == 0;
+}
+
+static void disarm_sampling(void) {
+  dispatch.sampling = 0;
+  if (!dispatch.timer_armed) return;
+
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  timer_settime(dispatch.timer, 0, &spec, NULL);
+  dispatch.timer_armed = false;
+}
+
+void stall_log_set_threshold_ms(uint32_t threshold) {
+  threshold_ms = threshold;
+}
+
+uint32_t stall_log_get_threshold_ms(void) { return threshold_ms; }
+
+void stall_log_set_sampling(bool enable) { sampling_enabled = enable; }
+
+void stall_log_dispatch_start(const void* function) {
+  if (dispatch.depth++ != 0) return;
+
+  dispatch.function = function;
+  dispatch.origin_function = NULL;
+  dispatch.origin_file = NULL;
+  dispatch.origin_line = 0;
+
+  uint32_t threshold = threshold_ms;
+  if (threshold != 0 && sampling_enabled) arm_sampling(threshold);
+}
+
+static void record_stall(uint64_t start_us, uint64_t run_us) {
+  char name[STALL_LOG_THREAD_NAME_LEN + 1];
+  memset(name, 0, sizeof(name));
+  prctl(PR_GET_NAME, (unsigned long)name);
+
+  std::lock_guard<std::mutex> lock(stall_mutex);
+  stall_record_t* record = &records[record_count++ % STALL_LOG_SIZE];
+  record->start_us = start_us;
+  record->run_us = run_us;
+  strncpy(record->thread_name, name, STALL_LOG_THREAD_NAME_LEN - 1);
+  record->thread_name[STALL_LOG_THREAD_NAME_LEN - 1] = '\0';
+  record->function = dispatch.function;
+  record->origin_function = dispatch.origin_function;
+  record->origin_file = dispatch.origin_file;
+  record->origin_line = dispatch.origin_line;
+
+  record->frame_count = 0;
+  int frame_count = dispatch.frame_count;
+  for (int i = STALL_LOG_SAMPLE_SKIPPED_FRAMES; i < frame_count; i++)
+    record->frames[record->frame_count++] = dispatch.frames[i];
+
+  for (stall_thread_stats_t& stats : thread_stats) {
+    if (stats.name[0] != '\0' &&
+        strncmp(stats.name, record->thread_name, sizeof(stats.name)) != 0)
+      continue;
+    if (stats.name[0] == '\0')
+      memcpy(stats.name, record->thread_name, sizeof(stats.name));
+    stats.count++;
+    stats.total_run_us += run_us;
+    if (run_us > stats.max_run_us) stats.max_run_us = run_us;
+    break;
+  }
+}
+
+void stall_log_dispatch_end(uint64_t start_us, uint64_t run_us) {
+  if (dispatch.depth == 0 || --dispatch.depth != 0) return;
+
+  disarm_sampling();
+
+  uint32_t threshold = threshold_ms;
+  if (threshold != 0 && run_us >= (uint64_t)threshold * 1000)
+    record_stall(start_us, run_us);
+  dispatch.frame_count = 0;
+}
+
+void stall_log_set_origin_function(const void* function) {
+  if (dispatch.depth == 0) return;
+  dispatch.function = function;
+}
+
+void stall_log_set_origin(const char* function, const char* file, int line) {
+  if (dispatch.depth == 0) return;
+  dispatch.origin_function = function;
+  dispatch.origin_file = file;
+  dispatch.origin_line = line;
+}
+
+uint64_t stall_log_get_count(void) {
+  std::lock_guard<std::mutex> lock(stall_mutex);
+  return record_count;
+}
+
+void stall_log_clear(void) {
+  std::lock_guard<std::mutex> lock(stall_mutex);
+  memset(records, 0, sizeof(records));
+  memset(thread_stats, 0, sizeof(thread_stats));
+  record_count = 0;
+}
+
+// Writes the symbol of the code at |address|, as the dynamic linker knows it.
+static void dump_symbol(int fd, const void* address) {
+  Dl_info info;
+  if (address == NULL) {
+    dprintf(fd, "?");
+  } else if (dladdr(address, &info) == 0) {
+    dprintf(fd, "%p", address);
+  } else if (info.dli_sname != NULL) {
+    dprintf(fd, "%s+0x%" PRIxPTR, info.dli_sname,
+            (uintptr_t)address - (uintptr_t)info.dli_saddr);
+  } else {
+    const char* file = info.dli_fname ? info.dli_fname : "?";
+    const char* base = strrchr(file, '/');
+    dprintf(fd, "%s+0x%" PRIxPTR, base ? base + 1 : file,
+            (uintptr_t)address - (uintptr_t)info.dli_fbase);
+  }
+}
+
+void stall_log_debug_dump(int fd) {
+  std::lock_guard<std::mutex> lock(stall_mutex);
+
+  dprintf(fd, "\nCallback Stalls:\n");
+  uint32_t threshold = threshold_ms;
+  if (threshold == 0) {
+    dprintf(fd, "  Disabled\n");
+    return;
+  }
+  dprintf(fd, "  Threshold: %u ms, stack sampling %s\n", threshold,
+          sampling_enabled ? "on" : "off");
+  dprintf(fd, "  Total stalls: %" PRIu64 "\n", record_count);
+
+  for (const stall_thread_stats_t& stats : thread_stats) {
+    if (stats.name[0] == '\0') break;
+    dprintf(fd,
+            "  %-16s: %" PRIu64 " stalls, max %" PRIu64 " ms, average %" PRIu64
+            " ms\n",
+            stats.name, stats.count, stats.max_run_us / 1000,
+            stats.total_run_us / stats.count / 1000);
+  }
+
+  uint64_t first = record_count > STALL_LOG_SIZE
+                       ? record_count - STALL_LOG_SIZE
+                       : 0;
+  uint64_t now_us = time_get_os_boottime_us();
+  for (uint64_t i = first; i < record_count; i++) {
+    const stall_record_t* record = &records[i % STALL_LOG_SIZE];
+    dprintf(fd, "  %" PRIu64 " s ago, %s, %" PRIu64 ".%03" PRIu64 " ms: ",
+            (now_us - record->start_us) / 1000000, record->thread_name,
+            record->run_us / 1000, record->run_us % 1000);
+    if (record->origin_function != NULL) {
+      const char* base = strrchr(record->origin_file, '/');
+      dprintf(fd, "%s@%s:%d", record->origin_function,
+              base ? base + 1 : record->origin_file, record->origin_line);
+    } else {
+      dump_symbol(fd, record->function);
+    }
+    dprintf(fd, "\n");
+
+    for (int j = 0; j < record->frame_count; j++) {
+      dprintf(fd, "    #%02d ", j);
+      dump_symbol(fd, record->frames[j]);
+      dprintf(fd, "\n");
+    }
+  }
+}
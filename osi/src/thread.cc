@@ -26,6 +26,7 @@
 #include <errno.h>
 #include <malloc.h>
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
@@ -37,7 +38,9 @@
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/reactor.h"
+#include "osi/include/stall_log.h"
 #include "osi/include/semaphore.h"
+#include "osi/include/thread_policy.h"
 
 struct thread_t {
   std::atomic_bool is_joined{false};
@@ -148,6 +151,12 @@ void thread_stop(thread_t* thread) {
 bool thread_set_priority(thread_t* thread, int priority) {
   if (!thread) return false;
 
+  if (thread_policy_sets_scheduling(thread->tid)) {
+    LOG_INFO(LOG_TAG, "%s keeping the configured scheduling of %s", __func__,
+             thread->name);
+    return true;
+  }
+
   const int rc = setpriority(PRIO_PROCESS, thread->tid, priority);
   if (rc < 0) {
     LOG_ERROR(LOG_TAG,
@@ -162,6 +171,12 @@ bool thread_set_priority(thread_t* thread, int priority) {
 bool thread_set_rt_priority(thread_t* thread, int priority) {
   if (!thread) return false;
 
+  if (thread_policy_sets_scheduling(thread->tid)) {
+    LOG_INFO(LOG_TAG, "%s keeping the configured scheduling of %s", __func__,
+             thread->name);
+    return true;
+  }
+
   struct sched_param rt_params;
   rt_params.sched_priority = priority;
 
@@ -176,6 +191,33 @@ bool thread_set_rt_priority(thread_t* thread, int priority) {
   return true;
 }
 
+bool thread_set_cpu_affinity(thread_t* thread, uint64_t cpu_mask) {
+  if (!thread || cpu_mask == 0) return false;
+
+  if (thread_policy_sets_cpu_affinity(thread->tid)) {
+    LOG_INFO(LOG_TAG, "%s keeping the configured CPUs of %s", __func__,
+             thread->name);
+    return true;
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+    if (cpu_mask & (1ULL << cpu)) CPU_SET(cpu, &cpu_set);
+  }
+
+  const int rc = sched_setaffinity(thread->tid, sizeof(cpu_set), &cpu_set);
+  if (rc != 0) {
+    LOG_ERROR(LOG_TAG,
+              "%s unable to set CPU affinity 0x%llx for tid %d, error %s",
+              __func__, (unsigned long long)cpu_mask, thread->tid,
+              strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
 bool thread_is_self(const thread_t* thread) {
   CHECK(thread != NULL);
   return !!pthread_equal(pthread_self(), thread->pthread);
@@ -207,6 +249,7 @@ static void* run_thread(void* start_arg) {
     return NULL;
   }
   thread->tid = gettid();
+  thread_policy_register(thread->tid, thread->name);
 
   LOG_INFO(LOG_TAG, "%s: thread id %d, thread name %s started", __func__,
            thread->tid, thread->name);
@@ -238,6 +281,7 @@ static void* run_thread(void* start_arg) {
   if (count > fixed_queue_capacity(thread->work_queue))
     LOG_DEBUG(LOG_TAG, "%s growing event queue on shutdown.", __func__);
 
+  thread_policy_unregister(thread->tid);
   LOG_WARN(LOG_TAG, "%s: thread id %d, thread name %s exited", __func__,
            thread->tid, thread->name);
   return NULL;
@@ -248,6 +292,7 @@ static void work_queue_read_cb(void* context) {
 
   fixed_queue_t* queue = (fixed_queue_t*)context;
   work_item_t* item = static_cast<work_item_t*>(fixed_queue_dequeue(queue));
+  stall_log_set_origin_function((const void*)item->func);
   item->func(item->context);
   osi_free(item);
 }
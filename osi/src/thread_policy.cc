@@ -0,0 +1,256 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_thread_policy"
+
+#include "osi/include/thread_policy.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "osi/include/log.h"
+
+#if !defined(SCHED_BATCH)
+#define SCHED_BATCH 3
+#endif
+
+#if !defined(SCHED_IDLE)
+#define SCHED_IDLE 5
+#endif
+
+#if !defined(SCHED_DEADLINE)
+#define SCHED_DEADLINE 6
+#endif
+
+// The attributes of sched_setattr(2), which the C libraries do not declare
+struct thread_sched_attr {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+static const struct {
+  const char* name;
+  thread_sched_class_t sched_class;
+} sched_class_names[] = {
+    {"other", THREAD_SCHED_OTHER},   {"batch", THREAD_SCHED_BATCH},
+    {"idle", THREAD_SCHED_IDLE},     {"fifo", THREAD_SCHED_FIFO},
+    {"rr", THREAD_SCHED_RR},         {"deadline", THREAD_SCHED_DEADLINE},
+};
+
+static std::mutex policy_mutex;
+static std::map<std::string, thread_policy_t> policies;
+static std::map<pid_t, std::string> threads;
+
+static uint64_t get_uint64(const config_t* config, const char* section,
+                           const char* key) {
+  const char* value = config_get_string(config, section, key, NULL);
+  return value ? strtoull(value, NULL, 0) : 0;
+}
+
+static bool parse_policy(const config_t* config, const char* section,
+                         thread_policy_t* policy) {
+  memset(policy, 0, sizeof(*policy));
+  policy->cpu_mask = get_uint64(config, section, "CpuMask");
+  policy->priority = config_get_int(config, section, "Priority", 0);
+  policy->runtime_us = get_uint64(config, section, "RuntimeUs");
+  policy->deadline_us = get_uint64(config, section, "DeadlineUs");
+  policy->period_us = get_uint64(config, section, "PeriodUs");
+
+  const char* name = config_get_string(config, section, "SchedClass", NULL);
+  if (name == NULL) return true;
+  for (const auto& sched_class : sched_class_names) {
+    if (strcmp(name, sched_class.name) == 0) {
+      policy->sched_class = sched_class.sched_class;
+      break;
+    }
+  }
+  if (policy->sched_class == THREAD_SCHED_KEEP) {
+    LOG_ERROR(LOG_TAG, "%s unknown scheduling class \"%s\" in [%s]", __func__,
+              name, section);
+    return false;
+  }
+  if (policy->sched_class == THREAD_SCHED_DEADLINE &&
+      (policy->runtime_us == 0 || policy->period_us < policy->runtime_us)) {
+    LOG_ERROR(LOG_TAG, "%s invalid deadline budget in [%s]", __func__,
+              section);
+    return false;
+  }
+  return true;
+}
+
+static bool set_deadline(pid_t tid, const thread_policy_t* policy) {
+#if defined(__NR_sched_setattr)
+  struct thread_sched_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.sched_policy = SCHED_DEADLINE;
+  attr.sched_runtime = policy->runtime_us * 1000;
+  attr.sched_deadline =
+      (policy->deadline_us ? policy->deadline_us : policy->period_us) * 1000;
+  attr.sched_period = policy->period_us * 1000;
+  return syscall(__NR_sched_setattr, tid, &attr, 0) == 0;
+#else
+  errno = ENOSYS;
+  return false;
+#endif  // defined(__NR_sched_setattr)
+}
+
+static bool set_scheduling(pid_t tid, const thread_policy_t* policy) {
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+
+  switch (policy->sched_class) {
+    case THREAD_SCHED_KEEP:
+      return true;
+    case THREAD_SCHED_OTHER:
+    case THREAD_SCHED_BATCH:
+      if (sched_setscheduler(tid, policy->sched_class == THREAD_SCHED_OTHER
+                                      ? SCHED_OTHER
+                                      : SCHED_BATCH,
+                             &param) != 0)
+        return false;
+      return setpriority(PRIO_PROCESS, tid, policy->priority) == 0;
+    case THREAD_SCHED_IDLE:
+      return sched_setscheduler(tid, SCHED_IDLE, &param) == 0;
+    case THREAD_SCHED_FIFO:
+    case THREAD_SCHED_RR:
+      param.sched_priority = policy->priority;
+      return sched_setscheduler(tid, policy->sched_class == THREAD_SCHED_FIFO
+                                         ? SCHED_FIFO
+                                         : SCHED_RR,
+                                &param) == 0;
+    case THREAD_SCHED_DEADLINE:
+      return set_deadline(tid, policy);
+  }
+  return false;
+}
+
+static bool set_cpu_affinity(pid_t tid, uint64_t cpu_mask) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+    if (cpu_mask & (1ULL << cpu)) CPU_SET(cpu, &cpu_set);
+  }
+  return sched_setaffinity(tid, sizeof(cpu_set), &cpu_set) == 0;
+}
+
+void thread_policy_load(const config_t* config) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  policies.clear();
+  if (config == NULL) return;
+
+  const size_t prefix_len = strlen(THREAD_POLICY_SECTION_PREFIX);
+  for (const config_section_node_t* node = config_section_begin(config);
+       node != config_section_end(config); node = config_section_next(node)) {
+    const char* section = config_section_name(node);
+    if (strncmp(section, THREAD_POLICY_SECTION_PREFIX, prefix_len) != 0)
+      continue;
+
+    thread_policy_t policy;
+    if (!parse_policy(config, section, &policy)) continue;
+    policies[section + prefix_len] = policy;
+  }
+
+  for (const auto& thread : threads) {
+    auto policy = policies.find(thread.second);
+    if (policy != policies.end())
+      thread_policy_apply(thread.first, &policy->second);
+  }
+}
+
+bool thread_policy_get(const char* name, thread_policy_t* policy) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  auto it = policies.find(name);
+  if (it == policies.end()) return false;
+  *policy = it->second;
+  return true;
+}
+
+bool thread_policy_apply(pid_t tid, const thread_policy_t* policy) {
+  bool success = true;
+
+  if (policy->cpu_mask != 0 && !set_cpu_affinity(tid, policy->cpu_mask)) {
+    LOG_ERROR(LOG_TAG, "%s unable to set CPU mask 0x%llx for tid %d: %s",
+              __func__, (unsigned long long)policy->cpu_mask, tid,
+              strerror(errno));
+    success = false;
+  }
+
+  if (!set_scheduling(tid, policy)) {
+    LOG_ERROR(LOG_TAG,
+              "%s unable to set scheduling class %d priority %d for tid %d: "
+              "%s",
+              __func__, policy->sched_class, policy->priority, tid,
+              strerror(errno));
+    success = false;
+  }
+
+  return success;
+}
+
+void thread_policy_register(pid_t tid, const char* name) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  threads[tid] = name;
+
+  auto policy = policies.find(name);
+  if (policy == policies.end()) return;
+  LOG_INFO(LOG_TAG, "%s applying the policy of %s to tid %d", __func__, name,
+           tid);
+  thread_policy_apply(tid, &policy->second);
+}
+
+void thread_policy_unregister(pid_t tid) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  threads.erase(tid);
+}
+
+// Returns the policy of the registered thread |tid|, NULL if it has none.
+// |policy_mutex| must be held.
+static const thread_policy_t* find_thread_policy(pid_t tid) {
+  auto thread = threads.find(tid);
+  if (thread == threads.end()) return NULL;
+  auto policy = policies.find(thread->second);
+  return policy == policies.end() ? NULL : &policy->second;
+}
+
+bool thread_policy_sets_scheduling(pid_t tid) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  const thread_policy_t* policy = find_thread_policy(tid);
+  return policy && policy->sched_class != THREAD_SCHED_KEEP;
+}
+
+bool thread_policy_sets_cpu_affinity(pid_t tid) {
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  const thread_policy_t* policy = find_thread_policy(tid);
+  return policy && policy->cpu_mask != 0;
+}
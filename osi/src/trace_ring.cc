@@ -0,0 +1,391 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_trace_ring"
+
+#include "osi/include/trace_ring.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/allocator.h"
+#include "osi/include/time.h"
+
+// The room for the string arguments of each record
+#define TRACE_RING_STRINGS_LEN 64
+
+// The longest formatted trace, and conversion specification
+#define TRACE_RING_LINE_LEN 512
+#define TRACE_RING_SPEC_LEN 32
+
+typedef enum {
+  ARG_NONE = 0,
+  ARG_SIGNED,
+  ARG_UNSIGNED,
+  ARG_CHAR,
+  ARG_DOUBLE,
+  ARG_POINTER,
+  ARG_STRING,
+} arg_type_t;
+
+// A conversion specification of a format string
+typedef struct {
+  const char* begin;     // The '%'
+  const char* end;       // Past the conversion character
+  int num_stars;         // The '*' widths and precisions
+  int length;            // The number of 'h' (negative) or 'l' (positive)
+  bool is_size;          // The 'z', 'j' or 't' length modifier
+  bool is_long_double;   // The 'L' length modifier
+  arg_type_t type;
+} spec_t;
+
+// The sequence number of a record is odd while the record is written, and
+// |2 * index + 2| once record |index| is complete.
+typedef struct {
+  std::atomic<uint64_t> sequence;
+  uint64_t timestamp_us;
+  const char* tag;
+  const char* fmt;
+  uint32_t tid;
+  uint8_t priority;
+  uint8_t num_args;
+  uint16_t strings_len;
+  uint64_t args[TRACE_RING_MAX_ARGS];
+  char strings[TRACE_RING_STRINGS_LEN];
+} trace_record_t;
+
+static trace_record_t* records;
+static std::atomic<bool> enabled(false);
+static std::atomic<uint64_t> next_index(0);
+static std::mutex init_mutex;
+
+static const char* parse_spec(const char* p, spec_t* spec);
+static size_t format_record(const trace_record_t* record, char* buf,
+                            size_t len);
+
+void trace_ring_init(void) {
+  std::lock_guard<std::mutex> lock(init_mutex);
+  if (enabled) return;
+
+  records = static_cast<trace_record_t*>(
+      osi_calloc(sizeof(trace_record_t) * TRACE_RING_SIZE));
+  enabled = true;
+}
+
+bool trace_ring_is_enabled(void) {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+void trace_ring_log(trace_ring_priority_t priority, const char* tag,
+                    const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  trace_ring_vlog(priority, tag, fmt, ap);
+  va_end(ap);
+}
+
+void trace_ring_vlog(trace_ring_priority_t priority, const char* tag,
+                     const char* fmt, va_list ap) {
+  if (!enabled.load(std::memory_order_acquire)) return;
+
+  uint64_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+  trace_record_t* record = &records[index & (TRACE_RING_SIZE - 1)];
+  record->sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  record->timestamp_us = time_get_os_boottime_us();
+  record->tag = tag;
+  record->fmt = fmt;
+  record->tid = (uint32_t)syscall(SYS_gettid);
+  record->priority = priority;
+  record->num_args = 0;
+  record->strings_len = 0;
+
+  // Only the arguments are taken: the format is walked again on the dump
+  spec_t spec;
+  const char* p = fmt;
+  while ((p = parse_spec(p, &spec)) != NULL) {
+    if (record->num_args + spec.num_stars + 1 > TRACE_RING_MAX_ARGS) break;
+    for (int i = 0; i < spec.num_stars; i++)
+      record->args[record->num_args++] = (int64_t)va_arg(ap, int);
+
+    uint64_t arg = 0;
+    switch (spec.type) {
+      case ARG_NONE:
+        continue;
+      case ARG_SIGNED:
+        if (spec.is_size)
+          arg = (int64_t)va_arg(ap, ssize_t);
+        else if (spec.length >= 2)
+          arg = (int64_t)va_arg(ap, long long);
+        else if (spec.length == 1)
+          arg = (int64_t)va_arg(ap, long);
+        else
+          arg = (int64_t)va_arg(ap, int);
+        break;
+      case ARG_UNSIGNED:
+        if (spec.is_size)
+          arg = va_arg(ap, size_t);
+        else if (spec.length >= 2)
+          arg = va_arg(ap, unsigned long long);
+        else if (spec.length == 1)
+          arg = va_arg(ap, unsigned long);
+        else
+          arg = va_arg(ap, unsigned int);
+        break;
+      case ARG_CHAR:
+        arg = (uint64_t)va_arg(ap, int);
+        break;
+      case ARG_DOUBLE: {
+        double value = spec.is_long_double ? (double)va_arg(ap, long double)
+                                           : va_arg(ap, double);
+        memcpy(&arg, &value, sizeof(value));
+        break;
+      }
+      case ARG_POINTER:
+        arg = (uintptr_t)va_arg(ap, void*);
+        break;
+      case ARG_STRING: {
+        // Copied with its terminator, truncated to the room left
+        const char* str = va_arg(ap, const char*);
+        if (str == NULL) str = "(null)";
+        size_t room = TRACE_RING_STRINGS_LEN - record->strings_len;
+        size_t str_len = strnlen(str, room > 0 ? room - 1 : 0);
+        arg = record->strings_len;
+        if (room > 0) {
+          memcpy(record->strings + record->strings_len, str, str_len);
+          record->strings[record->strings_len + str_len] = '\0';
+          record->strings_len += str_len + 1;
+        } else {
+          arg = TRACE_RING_STRINGS_LEN;
+        }
+        break;
+      }
+    }
+    record->args[record->num_args++] = arg;
+  }
+
+  record->sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void trace_ring_debug_dump(int fd) {
+  dprintf(fd, "\nTrace Ring:\n");
+  if (!enabled) {
+    dprintf(fd, "  Disabled\n");
+    return;
+  }
+
+  uint64_t end = next_index.load(std::memory_order_acquire);
+  uint64_t begin = (end > TRACE_RING_SIZE) ? end - TRACE_RING_SIZE : 0;
+  dprintf(fd, "  Records: %" PRIu64 " (total), %" PRIu64 " (kept)\n", end,
+          end - begin);
+
+  static const char priorities[] = {'E', 'W', 'I', 'D', 'V'};
+  char line[TRACE_RING_LINE_LEN];
+  for (uint64_t index = begin; index < end; index++) {
+    const trace_record_t* slot = &records[index & (TRACE_RING_SIZE - 1)];
+    if (slot->sequence.load(std::memory_order_acquire) != 2 * index + 2)
+      continue;  // Being written, or already overwritten
+
+    trace_record_t record;
+    memcpy(reinterpret_cast<char*>(&record) + sizeof(record.sequence),
+           reinterpret_cast<const char*>(slot) + sizeof(record.sequence),
+           sizeof(record) - sizeof(record.sequence));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != 2 * index + 2)
+      continue;
+
+    format_record(&record, line, sizeof(line));
+    dprintf(fd, "  %" PRIu64 ".%06" PRIu64 " %5u %c %s: %s\n",
+            record.timestamp_us / 1000000, record.timestamp_us % 1000000,
+            record.tid,
+            (record.priority < sizeof(priorities)) ? priorities[record.priority]
+                                                   : '?',
+            record.tag, line);
+  }
+}
+
+// Finds the next conversion specification from |p|, stored in |spec|.
+// Returns the position past it, or NULL at the end of the format.
+static const char* parse_spec(const char* p, spec_t* spec) {
+  while (*p != '\0' && *p != '%') p++;
+  if (*p == '\0') return NULL;
+
+  memset(spec, 0, sizeof(*spec));
+  spec->begin = p++;
+  while (*p != '\0' && strchr("-+ #0'", *p) != NULL) p++;
+  for (; *p == '*' || (*p >= '0' && *p <= '9') || *p == '.'; p++) {
+    if (*p == '*') spec->num_stars++;
+  }
+  for (; *p != '\0' && strchr("hlLqjzt", *p) != NULL; p++) {
+    if (*p == 'h') spec->length--;
+    if (*p == 'l' || *p == 'q') spec->length++;
+    if (*p == 'L') spec->is_long_double = true;
+    if (*p == 'j' || *p == 'z' || *p == 't') spec->is_size = true;
+  }
+
+  switch (*p) {
+    case 'd':
+    case 'i':
+      spec->type = ARG_SIGNED;
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec->type = ARG_UNSIGNED;
+      break;
+    case 'c':
+      spec->type = ARG_CHAR;
+      break;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec->type = ARG_DOUBLE;
+      break;
+    case 'p':
+      spec->type = ARG_POINTER;
+      break;
+    case 's':
+      spec->type = ARG_STRING;
+      break;
+    case '\0':
+      spec->end = p;
+      return p;
+    default:  // "%%" and the unsupported conversions
+      spec->type = ARG_NONE;
+      break;
+  }
+  spec->end = p + 1;
+  return spec->end;
+}
+
+// Formats |record| into |buf| of |len| octets, which is always terminated.
+// Returns the length of the formatted trace.
+static size_t format_record(const trace_record_t* record, char* buf,
+                            size_t len) {
+  size_t out = 0;
+  int next_arg = 0;
+  const char* p = record->fmt;
+  spec_t spec;
+
+  buf[0] = '\0';
+  while (out + 1 < len) {
+    const char* literal = p;
+    const char* next = parse_spec(p, &spec);
+    const char* literal_end = (next != NULL) ? spec.begin : p + strlen(p);
+    size_t literal_len = literal_end - literal;
+    if (literal_len > len - 1 - out) literal_len = len - 1 - out;
+    memcpy(buf + out, literal, literal_len);
+    out += literal_len;
+    buf[out] = '\0';
+    if (next == NULL || out + 1 >= len) break;
+    p = next;
+
+    if (spec.type == ARG_NONE) {
+      if (spec.end > spec.begin && spec.end[-1] == '%') buf[out++] = '%';
+      buf[out] = '\0';
+      continue;
+    }
+    if (next_arg + spec.num_stars + 1 > record->num_args) {
+      snprintf(buf + out, len - out, "%s", "(...)");
+      out += strlen(buf + out);
+      break;
+    }
+
+    // Rewrite the specification with the widths given as '*', and with
+    // the length modifier of the stored argument type
+    char fmt[TRACE_RING_SPEC_LEN];
+    size_t fmt_len = 0;
+    for (const char* q = spec.begin; q < spec.end - 1; q++) {
+      if (fmt_len + 12 >= sizeof(fmt)) break;
+      if (*q == '*') {
+        fmt_len += snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "%d",
+                            (int)(int64_t)record->args[next_arg++]);
+      } else if (strchr("hlLqjzt", *q) == NULL) {
+        fmt[fmt_len++] = *q;
+      }
+    }
+    uint64_t arg = record->args[next_arg++];
+    char conversion = spec.end[-1];
+
+    int written = 0;
+    switch (spec.type) {
+      case ARG_SIGNED:
+      case ARG_UNSIGNED: {
+        int64_t value = (int64_t)arg;
+        // The narrow types were promoted when recorded
+        if (spec.length == -1)
+          value = (spec.type == ARG_SIGNED) ? (int64_t)(short)value
+                                            : (int64_t)(unsigned short)value;
+        else if (spec.length <= -2)
+          value = (spec.type == ARG_SIGNED)
+                      ? (int64_t)(signed char)value
+                      : (int64_t)(unsigned char)value;
+        else if (spec.length == 0 && !spec.is_size)
+          value = (spec.type == ARG_SIGNED) ? (int64_t)(int)value
+                                            : (int64_t)(unsigned int)value;
+        snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "ll%c", conversion);
+        written = snprintf(buf + out, len - out, fmt, (long long)value);
+        break;
+      }
+      case ARG_CHAR:
+        snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "%c", conversion);
+        written = snprintf(buf + out, len - out, fmt, (int)arg);
+        break;
+      case ARG_DOUBLE: {
+        double value;
+        memcpy(&value, &arg, sizeof(value));
+        snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "%c", conversion);
+        written = snprintf(buf + out, len - out, fmt, value);
+        break;
+      }
+      case ARG_POINTER:
+        snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "%c", conversion);
+        written = snprintf(buf + out, len - out, fmt, (void*)(uintptr_t)arg);
+        break;
+      case ARG_STRING: {
+        const char* str = (arg < TRACE_RING_STRINGS_LEN)
+                              ? record->strings + arg
+                              : "(...)";
+        snprintf(fmt + fmt_len, sizeof(fmt) - fmt_len, "%c", conversion);
+        written = snprintf(buf + out, len - out, fmt, str);
+        break;
+      }
+      case ARG_NONE:
+        break;
+    }
+    if (written < 0) break;
+    out += ((size_t)written < len - out) ? (size_t)written : len - 1 - out;
+  }
+
+  return out;
+}
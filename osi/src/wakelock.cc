@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -58,6 +59,43 @@ static pthread_once_t initialized = PTHREAD_ONCE_INIT;
 static int wake_lock_fd = INVALID_FD;
 static int wake_unlock_fd = INVALID_FD;
 
+// Time the OS wakelock is kept after the last reason released it.
+static const period_ms_t DEFAULT_RELEASE_DELAY_MS = 250;
+
+// The reference counts of the wakelock reasons, and the OS wakelock they
+// share. Once no reason holds it, the OS wakelock is released by
+// |release_timer| after |release_delay_ms|.
+typedef struct {
+  size_t reason_refs[WAKELOCK_REASON_MAX];
+  size_t total_refs;
+  bool os_lock_held;     // True if the OS wakelock is held
+  bool release_pending;  // True if |release_timer| is armed
+  bool has_release_timer;
+  timer_t release_timer;
+  period_ms_t release_delay_ms;
+} wakelock_state_t;
+
+static wakelock_state_t wakelock_state = {
+    {0}, 0, false, false, false, {}, DEFAULT_RELEASE_DELAY_MS};
+
+// This mutex serializes the changes of |wakelock_state| and the OS wakelock
+// calls. It is taken before |stats_mutex|.
+static std::mutex state_mutex;
+
+// The upper bounds of the buckets of the OS wakelock held time histogram.
+static const period_ms_t HELD_TIME_BUCKETS_MS[] = {10, 100, 1000, 10000,
+                                                   60000};
+#define WAKELOCK_HELD_TIME_BUCKETS_N \
+  (sizeof(HELD_TIME_BUCKETS_MS) / sizeof(HELD_TIME_BUCKETS_MS[0]) + 1)
+
+// Wakelock statistics of a reason
+typedef struct {
+  size_t acquired_count;
+  size_t held_count;  // Number of times the reason started to hold it
+  period_ms_t held_since_ms;
+  period_ms_t total_held_ms;
+} wakelock_reason_stats_t;
+
 // Wakelock statistics for the "bluetooth_timer"
 typedef struct {
   bool is_acquired;
@@ -74,6 +112,9 @@ typedef struct {
   period_ms_t last_reset_timestamp_ms;
   int last_acquired_error;
   int last_released_error;
+  size_t collapsed_count;  // Releases cancelled by an acquire in the delay
+  size_t held_time_histogram[WAKELOCK_HELD_TIME_BUCKETS_N];
+  wakelock_reason_stats_t reasons[WAKELOCK_REASON_MAX];
 } wakelock_stats_t;
 
 static wakelock_stats_t wakelock_stats;
@@ -91,6 +132,27 @@ static void wakelock_initialize_native(void);
 static void reset_wakelock_stats(void);
 static void update_wakelock_acquired_stats(bt_status_t acquired_status);
 static void update_wakelock_released_stats(bt_status_t released_status);
+static void update_wakelock_reason_stats(wakelock_reason_t reason,
+                                         bool acquired, bool is_held);
+static void update_wakelock_collapsed_stats(void);
+static bool os_lock_acquire(void);
+static bool os_lock_release(void);
+static bool release_timer_arm(void);
+static void release_timer_cancel(void);
+static void release_timer_callback(union sigval value);
+
+static const char* wakelock_reason_text(wakelock_reason_t reason) {
+  switch (reason) {
+    case WAKELOCK_REASON_ALARM:
+      return "alarm";
+    case WAKELOCK_REASON_MEDIA:
+      return "media";
+    case WAKELOCK_REASON_HCI:
+      return "hci";
+    default:
+      return "unknown";
+  }
+}
 
 void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
   wakelock_os_callouts = callouts;
@@ -100,8 +162,65 @@ void wakelock_set_os_callouts(bt_os_callouts_t* callouts) {
 }
 
 bool wakelock_acquire(void) {
+  return wakelock_acquire_reason(WAKELOCK_REASON_ALARM);
+}
+
+bool wakelock_release(void) {
+  return wakelock_release_reason(WAKELOCK_REASON_ALARM);
+}
+
+bool wakelock_acquire_reason(wakelock_reason_t reason) {
+  CHECK(reason < WAKELOCK_REASON_MAX);
   pthread_once(&initialized, wakelock_initialize);
 
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (wakelock_state.total_refs == 0) {
+    if (wakelock_state.release_pending) {
+      // Still held from the previous release: just keep it
+      release_timer_cancel();
+      update_wakelock_collapsed_stats();
+    } else if (!wakelock_state.os_lock_held) {
+      if (!os_lock_acquire()) return false;
+    }
+  }
+
+  wakelock_state.reason_refs[reason]++;
+  wakelock_state.total_refs++;
+  update_wakelock_reason_stats(reason, true,
+                               wakelock_state.reason_refs[reason] == 1);
+  return true;
+}
+
+bool wakelock_release_reason(wakelock_reason_t reason) {
+  CHECK(reason < WAKELOCK_REASON_MAX);
+  pthread_once(&initialized, wakelock_initialize);
+
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (wakelock_state.reason_refs[reason] == 0) {
+    LOG_WARN(LOG_TAG, "%s wake lock not held for %s", __func__,
+             wakelock_reason_text(reason));
+    return false;
+  }
+
+  wakelock_state.reason_refs[reason]--;
+  wakelock_state.total_refs--;
+  update_wakelock_reason_stats(reason, false,
+                               wakelock_state.reason_refs[reason] != 0);
+  if (wakelock_state.total_refs != 0) return true;
+
+  if (wakelock_state.release_delay_ms != 0 && release_timer_arm()) return true;
+  return os_lock_release();
+}
+
+void wakelock_set_release_delay_ms(period_ms_t delay_ms) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+  wakelock_state.release_delay_ms = delay_ms;
+}
+
+// NOTE: must be called with |state_mutex| held
+static bool os_lock_acquire(void) {
   bt_status_t status = BT_STATUS_FAIL;
 
   if (is_native)
@@ -111,12 +230,87 @@ bool wakelock_acquire(void) {
 
   update_wakelock_acquired_stats(status);
 
-  if (status != BT_STATUS_SUCCESS)
+  if (status != BT_STATUS_SUCCESS) {
     LOG_ERROR(LOG_TAG, "%s unable to acquire wake lock: %d", __func__, status);
+    return false;
+  }
+  wakelock_state.os_lock_held = true;
+  return true;
+}
+
+// NOTE: must be called with |state_mutex| held
+static bool os_lock_release(void) {
+  bt_status_t status = BT_STATUS_FAIL;
+
+  if (is_native)
+    status = wakelock_release_native();
+  else
+    status = wakelock_release_callout();
+
+  update_wakelock_released_stats(status);
+  wakelock_state.os_lock_held = false;
 
   return (status == BT_STATUS_SUCCESS);
 }
 
+// Arms |release_timer| to release the OS wakelock after the release delay.
+// Returns false if the timer cannot be used.
+// NOTE: must be called with |state_mutex| held
+static bool release_timer_arm(void) {
+  if (!wakelock_state.has_release_timer) {
+    struct sigevent sigevent;
+    memset(&sigevent, 0, sizeof(sigevent));
+    sigevent.sigev_notify = SIGEV_THREAD;
+    sigevent.sigev_notify_function = release_timer_callback;
+    if (timer_create(CLOCK_ID, &sigevent, &wakelock_state.release_timer) ==
+        -1) {
+      LOG_ERROR(LOG_TAG, "%s unable to create release timer: %s", __func__,
+                strerror(errno));
+      return false;
+    }
+    wakelock_state.has_release_timer = true;
+  }
+
+  struct itimerspec timer_time;
+  memset(&timer_time, 0, sizeof(timer_time));
+  timer_time.it_value.tv_sec = wakelock_state.release_delay_ms / 1000;
+  timer_time.it_value.tv_nsec =
+      (wakelock_state.release_delay_ms % 1000) * 1000000LL;
+  if (timer_settime(wakelock_state.release_timer, 0, &timer_time, NULL) ==
+      -1) {
+    LOG_ERROR(LOG_TAG, "%s unable to set release timer: %s", __func__,
+              strerror(errno));
+    return false;
+  }
+  wakelock_state.release_pending = true;
+  return true;
+}
+
+// NOTE: must be called with |state_mutex| held
+static void release_timer_cancel(void) {
+  struct itimerspec timer_time;
+  memset(&timer_time, 0, sizeof(timer_time));
+  timer_settime(wakelock_state.release_timer, 0, &timer_time, NULL);
+  wakelock_state.release_pending = false;
+}
+
+static void release_timer_callback(UNUSED_ATTR union sigval value) {
+  std::lock_guard<std::mutex> lock(state_mutex);
+
+  if (!wakelock_state.release_pending || wakelock_state.total_refs != 0)
+    return;
+
+  // A callback of a timer cancelled and armed again since it expired
+  struct itimerspec time_to_expire;
+  timer_gettime(wakelock_state.release_timer, &time_to_expire);
+  if (time_to_expire.it_value.tv_sec != 0 ||
+      time_to_expire.it_value.tv_nsec != 0)
+    return;
+
+  wakelock_state.release_pending = false;
+  os_lock_release();
+}
+
 static bt_status_t wakelock_acquire_callout(void) {
   return static_cast<bt_status_t>(
       wakelock_os_callouts->acquire_wake_lock(WAKE_LOCK_ID));
@@ -147,21 +341,6 @@ static bt_status_t wakelock_acquire_native(void) {
   return BT_STATUS_SUCCESS;
 }
 
-bool wakelock_release(void) {
-  pthread_once(&initialized, wakelock_initialize);
-
-  bt_status_t status = BT_STATUS_FAIL;
-
-  if (is_native)
-    status = wakelock_release_native();
-  else
-    status = wakelock_release_callout();
-
-  update_wakelock_released_stats(status);
-
-  return (status == BT_STATUS_SUCCESS);
-}
-
 static bt_status_t wakelock_release_callout(void) {
   return static_cast<bt_status_t>(
       wakelock_os_callouts->release_wake_lock(WAKE_LOCK_ID));
@@ -213,6 +392,18 @@ static void wakelock_initialize_native(void) {
 }
 
 void wakelock_cleanup(void) {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (wakelock_state.release_pending) {
+      release_timer_cancel();
+      os_lock_release();
+    }
+    if (wakelock_state.has_release_timer)
+      timer_delete(wakelock_state.release_timer);
+    memset(&wakelock_state, 0, sizeof(wakelock_state));
+    wakelock_state.release_delay_ms = DEFAULT_RELEASE_DELAY_MS;
+  }
+
   wake_lock_path.clear();
   wake_unlock_path.clear();
   initialized = PTHREAD_ONCE_INIT;
@@ -251,6 +442,10 @@ static void reset_wakelock_stats(void) {
   wakelock_stats.total_acquired_interval_ms = 0;
   wakelock_stats.last_acquired_timestamp_ms = 0;
   wakelock_stats.last_released_timestamp_ms = 0;
+  wakelock_stats.collapsed_count = 0;
+  memset(wakelock_stats.held_time_histogram, 0,
+         sizeof(wakelock_stats.held_time_histogram));
+  memset(wakelock_stats.reasons, 0, sizeof(wakelock_stats.reasons));
   wakelock_stats.last_reset_timestamp_ms = now();
 }
 
@@ -322,13 +517,54 @@ static void update_wakelock_released_stats(bt_status_t released_status) {
   wakelock_stats.last_acquired_interval_ms = delta_ms;
   wakelock_stats.total_acquired_interval_ms += delta_ms;
 
+  size_t bucket = 0;
+  while (bucket < WAKELOCK_HELD_TIME_BUCKETS_N - 1 &&
+         delta_ms >= HELD_TIME_BUCKETS_MS[bucket])
+    bucket++;
+  wakelock_stats.held_time_histogram[bucket]++;
+
   BluetoothMetricsLogger::GetInstance()->LogWakeEvent(
       system_bt_osi::WAKE_EVENT_RELEASED, "", "", now_ms);
 }
 
+//
+// Update the statistics of the wakelock |reason|.
+//
+// This function should be called every time when the wakelock is acquired
+// (|acquired| is true) or released for |reason|. |is_held| is true if the
+// reason holds the wakelock once done.
+// This function is thread-safe.
+//
+static void update_wakelock_reason_stats(wakelock_reason_t reason,
+                                         bool acquired, bool is_held) {
+  const period_ms_t now_ms = now();
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+
+  wakelock_reason_stats_t* stats = &wakelock_stats.reasons[reason];
+  if (acquired) {
+    stats->acquired_count++;
+    if (is_held) {
+      // The first reference of the reason
+      stats->held_count++;
+      stats->held_since_ms = now_ms;
+    }
+  } else if (!is_held) {
+    stats->total_held_ms += now_ms - stats->held_since_ms;
+  }
+}
+
+// Update the count of the OS wakelock releases cancelled by an acquire.
+// This function is thread-safe.
+static void update_wakelock_collapsed_stats(void) {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  wakelock_stats.collapsed_count++;
+}
+
 void wakelock_debug_dump(int fd) {
   const period_ms_t now_ms = now();
 
+  std::lock_guard<std::mutex> state_lock(state_mutex);
   std::lock_guard<std::mutex> lock(stats_mutex);
 
   // Compute the last acquired interval if the wakelock is still acquired
@@ -370,4 +606,29 @@ void wakelock_debug_dump(int fd) {
   dprintf(
       fd, "  Total run time (ms)            : %llu\n",
       (unsigned long long)(now_ms - wakelock_stats.last_reset_timestamp_ms));
+  dprintf(fd, "  Collapsed release/acquire count: %zu\n",
+          wakelock_stats.collapsed_count);
+
+  dprintf(fd, "  Acquired time histogram (ms)   :");
+  for (size_t i = 0; i < WAKELOCK_HELD_TIME_BUCKETS_N - 1; i++) {
+    dprintf(fd, " <%llu: %zu", (unsigned long long)HELD_TIME_BUCKETS_MS[i],
+            wakelock_stats.held_time_histogram[i]);
+  }
+  dprintf(fd, " >=%llu: %zu\n",
+          (unsigned long long)
+              HELD_TIME_BUCKETS_MS[WAKELOCK_HELD_TIME_BUCKETS_N - 2],
+          wakelock_stats.held_time_histogram[WAKELOCK_HELD_TIME_BUCKETS_N - 1]);
+
+  dprintf(fd, "  Reason: acquired count / held count / held time (ms)\n");
+  for (int i = 0; i < WAKELOCK_REASON_MAX; i++) {
+    const wakelock_reason_stats_t* stats = &wakelock_stats.reasons[i];
+    period_ms_t held_ms = stats->total_held_ms;
+    if (wakelock_state.reason_refs[i] != 0)
+      held_ms += now_ms - stats->held_since_ms;
+    dprintf(fd, "    %-6s: %zu / %zu / %llu%s\n",
+            wakelock_reason_text(static_cast<wakelock_reason_t>(i)),
+            stats->acquired_count, stats->held_count,
+            (unsigned long long)held_ms,
+            wakelock_state.reason_refs[i] != 0 ? " (held)" : "");
+  }
 }
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of setting and canceling an alarm while many others are pending, as
+// with the supervision, L2CAP and GATT timers of many connections.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "osi/include/alarm.h"
+
+namespace {
+
+// Far enough that none of the alarms expires during the benchmark
+constexpr period_ms_t kMinIntervalMs = 60 * 60 * 1000;
+
+void dummy_cb(void* data) {}
+
+// Returns the next interval of a fixed pseudo-random sequence
+period_ms_t NextInterval(uint32_t* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return kMinIntervalMs + (*seed >> 16);
+}
+
+class PendingAlarms {
+ public:
+  explicit PendingAlarms(int count) : alarms_(count) {
+    for (alarm_t*& alarm : alarms_) {
+      alarm = alarm_new("alarm_benchmark");
+      alarm_set(alarm, NextInterval(&seed_), dummy_cb, nullptr);
+    }
+  }
+
+  ~PendingAlarms() {
+    for (alarm_t* alarm : alarms_) alarm_free(alarm);
+    alarm_cleanup();
+  }
+
+  alarm_t* Next() { return alarms_[index_++ % alarms_.size()]; }
+  uint32_t* seed() { return &seed_; }
+
+ private:
+  std::vector<alarm_t*> alarms_;
+  size_t index_ = 0;
+  uint32_t seed_ = 1;
+};
+
+// Restarts pending alarms, e.g. a timer reset on each received packet
+void BM_AlarmReschedule(benchmark::State& state) {
+  PendingAlarms alarms(state.range(0));
+  while (state.KeepRunning()) {
+    alarm_set(alarms.Next(), NextInterval(alarms.seed()), dummy_cb, nullptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Cancels a pending alarm and sets it again
+void BM_AlarmCancelSet(benchmark::State& state) {
+  PendingAlarms alarms(state.range(0));
+  while (state.KeepRunning()) {
+    alarm_t* alarm = alarms.Next();
+    alarm_cancel(alarm);
+    alarm_set(alarm, NextInterval(alarms.seed()), dummy_cb, nullptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_AlarmReschedule)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_AlarmCancelSet)->Arg(1000)->Arg(10000);
+
+BENCHMARK_MAIN();
@@ -191,6 +191,26 @@ TEST_F(AlarmTest, test_set_short_short) {
   alarm_free(alarm[1]);
 }
 
+TEST_F(AlarmTest, test_set_with_slack) {
+  alarm_t* alarm = alarm_new("alarm_test.test_set_with_slack");
+
+  alarm_set_with_slack(alarm, 100, 400, cb, NULL);
+
+  // The deadline is deferred within the slack window
+  period_ms_t remaining_ms = alarm_get_remaining_ms(alarm);
+  EXPECT_GE(remaining_ms, 100u - EPSILON_MS);
+  EXPECT_LE(remaining_ms, 100u + 400u);
+  EXPECT_EQ(cb_counter, 0);
+  EXPECT_TRUE(WakeLockHeld());
+
+  semaphore_wait(semaphore);
+
+  EXPECT_EQ(cb_counter, 1);
+  EXPECT_FALSE(WakeLockHeld());
+
+  alarm_free(alarm);
+}
+
 TEST_F(AlarmTest, test_set_short_long) {
   alarm_t* alarm[2] = {alarm_new("alarm_test.test_set_short_long_0"),
                        alarm_new("alarm_test.test_set_short_long_1")};
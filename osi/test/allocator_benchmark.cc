@@ -0,0 +1,73 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of allocating and freeing osi buffers of each slab size class, from
+// the heap and from the slab allocator.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "osi/include/slab.h"
+
+namespace {
+
+// The requested sizes, which fit each size class once the osi allocation
+// header is added, and one that does not fit any.
+constexpr size_t kSizes[] = {16, 48, 112, 240, 672, 4096, 8192};
+
+// Allocates |state.range(1)| buffers of |state.range(0)| octets, then frees
+// them. Bursts larger than a magazine go through the slab depot.
+void MallocFree(benchmark::State& state) {
+  std::vector<void*> buffers(state.range(1));
+  while (state.KeepRunning()) {
+    for (void*& buffer : buffers) buffer = osi_malloc(state.range(0));
+    for (void* buffer : buffers) osi_free(buffer);
+  }
+  state.SetItemsProcessed(state.iterations() * buffers.size());
+}
+
+void BM_OsiMallocFreeHeap(benchmark::State& state) {
+  // The slab allocator cannot be disabled once enabled
+  if (slab_is_enabled()) {
+    state.SkipWithError("the slab allocator is enabled");
+    return;
+  }
+  MallocFree(state);
+}
+
+void BM_OsiMallocFreeSlab(benchmark::State& state) {
+  slab_init();
+  MallocFree(state);
+}
+
+void SizeClasses(benchmark::internal::Benchmark* benchmark) {
+  for (size_t size : kSizes) {
+    benchmark->Args({(int)size, 1});
+    benchmark->Args({(int)size, 2 * SLAB_MAGAZINE_SIZE});
+  }
+}
+
+}  // namespace
+
+// The heap runs first, before the slab allocator is enabled
+BENCHMARK(BM_OsiMallocFreeHeap)->Apply(SizeClasses);
+BENCHMARK(BM_OsiMallocFreeSlab)->Apply(SizeClasses);
+
+BENCHMARK_MAIN();
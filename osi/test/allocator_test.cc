@@ -50,3 +50,43 @@ TEST_F(AllocatorTest, test_osi_strndup) {
   EXPECT_EQ(0, strcmp(str, copy_str));
   osi_free(copy_str);
 }
+
+TEST_F(AllocatorTest, test_tagged_allocations_are_accounted) {
+  osi_mem_stats_t before;
+  osi_allocator_get_stats(OSI_MEM_L2CAP, &before);
+
+  void* first = osi_malloc_tagged(100, OSI_MEM_L2CAP);
+  void* second = osi_calloc_tagged(50, OSI_MEM_L2CAP);
+  char* str = osi_strdup_tagged("IloveBluetooth", OSI_MEM_L2CAP);
+
+  osi_mem_stats_t stats;
+  osi_allocator_get_stats(OSI_MEM_L2CAP, &stats);
+  EXPECT_EQ(before.bytes + 165, stats.bytes);
+  EXPECT_EQ(before.objects + 3, stats.objects);
+  EXPECT_LE(stats.bytes, stats.peak_bytes);
+  EXPECT_LE(stats.objects, stats.peak_objects);
+
+  osi_free(first);
+  osi_free(second);
+  osi_free(str);
+
+  osi_allocator_get_stats(OSI_MEM_L2CAP, &stats);
+  EXPECT_EQ(before.bytes, stats.bytes);
+  EXPECT_EQ(before.objects, stats.objects);
+  EXPECT_LE(before.bytes + 165, stats.peak_bytes);
+}
+
+TEST_F(AllocatorTest, test_untagged_allocations_are_other) {
+  osi_mem_stats_t before;
+  osi_allocator_get_stats(OSI_MEM_OTHER, &before);
+
+  void* ptr = osi_malloc(64);
+  osi_mem_stats_t stats;
+  osi_allocator_get_stats(OSI_MEM_OTHER, &stats);
+  EXPECT_EQ(before.bytes + 64, stats.bytes);
+  EXPECT_EQ(before.objects + 1, stats.objects);
+
+  osi_free(ptr);
+  osi_allocator_get_stats(OSI_MEM_OTHER, &stats);
+  EXPECT_EQ(before.bytes, stats.bytes);
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of looking up and updating keys in a config with many sections, as
+// in a bt_config.conf with one section per bonded or seen device.
+
+#include <benchmark/benchmark.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+namespace {
+
+const char* const kKeys[] = {"Name", "DevClass", "DevType", "AddrType",
+                             "Manufacturer", "LinkKey", "LinkKeyType",
+                             "PinLength", "Service", "Timestamp"};
+constexpr size_t kNumKeys = sizeof(kKeys) / sizeof(kKeys[0]);
+
+class DeviceConfig {
+ public:
+  explicit DeviceConfig(int count) : config_(config_new_empty()) {
+    for (int i = 0; i < count; i++) {
+      char section[18];
+      snprintf(section, sizeof(section), "%02x:%02x:%02x:%02x:%02x:%02x",
+               i >> 8 & 0xff, i & 0xff, 0, 0, 0, 0);
+      sections_.push_back(section);
+      for (const char* key : kKeys)
+        config_set_string(config_, section, key, "1");
+    }
+  }
+
+  ~DeviceConfig() { config_free(config_); }
+
+  config_t* config() { return config_; }
+
+  // Returns the next section, in an order that does not follow the file
+  const char* NextSection() {
+    seed_ = seed_ * 1103515245 + 12345;
+    return sections_[(seed_ >> 16) % sections_.size()].c_str();
+  }
+
+  const char* NextKey() { return kKeys[index_++ % kNumKeys]; }
+
+ private:
+  config_t* config_;
+  std::vector<std::string> sections_;
+  size_t index_ = 0;
+  uint32_t seed_ = 1;
+};
+
+void BM_ConfigGetString(benchmark::State& state) {
+  DeviceConfig config(state.range(0));
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(config_get_string(
+        config.config(), config.NextSection(), config.NextKey(), NULL));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ConfigSetString(benchmark::State& state) {
+  DeviceConfig config(state.range(0));
+  while (state.KeepRunning()) {
+    config_set_string(config.config(), config.NextSection(), config.NextKey(),
+                      "2");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_ConfigGetString)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ConfigSetString)->Arg(100)->Arg(1000);
+
+BENCHMARK_MAIN();
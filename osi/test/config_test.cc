@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
 #include "AllocationTestHarness.h"
 
 #include "osi/include/config.h"
 
 static const char CONFIG_FILE[] = "/data/local/tmp/config_test.conf";
+static const char CONFIG_SNAPSHOT_FILE[] = "/data/local/tmp/config_test.snap";
 static const char CONFIG_FILE_CONTENT[] =
     "                                                                                    \n\
 first_key=value                                                                      \n\
@@ -200,3 +203,59 @@ TEST_F(ConfigTest, config_save_basic) {
   EXPECT_TRUE(config_save(config, CONFIG_FILE));
   config_free(config);
 }
+
+TEST_F(ConfigTest, config_snapshot_round_trip) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save_snapshot(config, CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+
+  config_t* snapshot = config_new_snapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE);
+  ASSERT_TRUE(snapshot != NULL);
+  EXPECT_STREQ("0x1200", config_get_string(snapshot, "DID", "productId",
+                                           NULL));
+  EXPECT_STREQ("true", config_get_string(snapshot, "DID", "primaryRecord",
+                                         NULL));
+  EXPECT_STREQ("0x1436", config_get_string(snapshot, "DID", "version", NULL));
+
+  // Same sections, in the same order
+  const config_section_node_t* node = config_section_begin(config);
+  const config_section_node_t* snapshot_node = config_section_begin(snapshot);
+  while (node != config_section_end(config)) {
+    ASSERT_TRUE(snapshot_node != config_section_end(snapshot));
+    EXPECT_STREQ(config_section_name(node),
+                 config_section_name(snapshot_node));
+    node = config_section_next(node);
+    snapshot_node = config_section_next(snapshot_node);
+  }
+  EXPECT_EQ(snapshot_node, config_section_end(snapshot));
+
+  config_free(snapshot);
+  config_free(config);
+  unlink(CONFIG_SNAPSHOT_FILE);
+}
+
+TEST_F(ConfigTest, config_snapshot_stale) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save_snapshot(config, CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+
+  config_set_string(config, "DID", "version", "0x1437");
+  EXPECT_TRUE(config_save(config, CONFIG_FILE));
+  EXPECT_TRUE(config_new_snapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE) == NULL);
+
+  config_free(config);
+  unlink(CONFIG_SNAPSHOT_FILE);
+}
+
+TEST_F(ConfigTest, config_snapshot_corrupted) {
+  config_t* config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save_snapshot(config, CONFIG_SNAPSHOT_FILE, CONFIG_FILE));
+  config_free(config);
+
+  FILE* fp = fopen(CONFIG_SNAPSHOT_FILE, "r+b");
+  ASSERT_TRUE(fp != NULL);
+  fseek(fp, -2, SEEK_END);
+  fputc('X', fp);
+  fclose(fp);
+  EXPECT_TRUE(config_new_snapshot(CONFIG_SNAPSHOT_FILE, CONFIG_FILE) == NULL);
+
+  unlink(CONFIG_SNAPSHOT_FILE);
+}
@@ -0,0 +1,154 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/executor.h"
+#include "osi/include/osi.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/thread.h"
+
+class ExecutorTest : public AllocationTestHarness {};
+
+static void* square(void* context) {
+  uintptr_t value = (uintptr_t)context;
+  return (void*)(value * value);
+}
+
+TEST_F(ExecutorTest, test_new_free_simple) {
+  executor_t* executor = executor_new("test_executor", 2);
+  ASSERT_TRUE(executor != NULL);
+  executor_free(executor);
+}
+
+TEST_F(ExecutorTest, test_free_null) { executor_free(NULL); }
+
+TEST_F(ExecutorTest, test_submit) {
+  executor_t* executor = executor_new("test_executor", 2);
+
+  future_t* futures[32];
+  for (uintptr_t i = 0; i < 32; i++) {
+    futures[i] = executor_submit(executor, square, (void*)i);
+    ASSERT_TRUE(futures[i] != NULL);
+  }
+  for (uintptr_t i = 0; i < 32; i++)
+    EXPECT_EQ((void*)(i * i), future_await(futures[i]));
+
+  executor_free(executor);
+}
+
+static thread_t* owner_thread;
+static semaphore_t* completion_sem;
+static std::atomic_int completion_count;
+
+static void check_completion(void* context, void* result) {
+  uintptr_t value = (uintptr_t)context;
+  EXPECT_TRUE(thread_is_self(owner_thread));
+  EXPECT_EQ((void*)(value * value), result);
+  completion_count++;
+  semaphore_post(completion_sem);
+}
+
+TEST_F(ExecutorTest, test_post_completes_on_owner) {
+  executor_t* executor = executor_new("test_executor", 2);
+  owner_thread = thread_new("owner_thread");
+  completion_sem = semaphore_new(0);
+  completion_count = 0;
+
+  for (uintptr_t i = 0; i < 16; i++) {
+    EXPECT_TRUE(executor_post(executor, square, (void*)i, owner_thread,
+                              check_completion));
+  }
+  for (int i = 0; i < 16; i++) semaphore_wait(completion_sem);
+  EXPECT_EQ(16, completion_count);
+
+  executor_free(executor);
+  thread_free(owner_thread);
+  semaphore_free(completion_sem);
+}
+
+static semaphore_t* blocker_sem;
+static semaphore_t* blocked_sem;
+
+static void* block(void* context) {
+  semaphore_post(blocked_sem);
+  semaphore_wait(blocker_sem);
+  return context;
+}
+
+TEST_F(ExecutorTest, test_idle_worker_steals) {
+  executor_t* executor = executor_new("test_executor", 2);
+  blocker_sem = semaphore_new(0);
+  blocked_sem = semaphore_new(0);
+
+  // Tasks are queued on the workers in turn: while one worker is blocked,
+  // the other one has to steal the tasks queued on the blocked one.
+  future_t* blocked = executor_submit(executor, block, (void*)1);
+  semaphore_wait(blocked_sem);
+  future_t* futures[8];
+  for (uintptr_t i = 0; i < 8; i++)
+    futures[i] = executor_submit(executor, square, (void*)i);
+  for (uintptr_t i = 0; i < 8; i++)
+    EXPECT_EQ((void*)(i * i), future_await(futures[i]));
+
+  EXPECT_GT(executor_get_steal_count(executor), 0U);
+
+  semaphore_post(blocker_sem);
+  EXPECT_EQ((void*)1, future_await(blocked));
+
+  executor_free(executor);
+  semaphore_free(blocker_sem);
+  semaphore_free(blocked_sem);
+}
+
+static executor_t* nested_executor;
+
+static void* submit_nested(void* context) {
+  future_t* future = executor_submit(nested_executor, square, context);
+  return future_await(future);
+}
+
+TEST_F(ExecutorTest, test_submit_from_task) {
+  nested_executor = executor_new("test_executor", 2);
+
+  future_t* future = executor_submit(nested_executor, submit_nested, (void*)7);
+  EXPECT_EQ((void*)49, future_await(future));
+
+  executor_free(nested_executor);
+}
+
+TEST_F(ExecutorTest, test_free_runs_queued_tasks) {
+  executor_t* executor = executor_new("test_executor", 1);
+  owner_thread = thread_new("owner_thread");
+  completion_sem = semaphore_new(0);
+  completion_count = 0;
+
+  for (uintptr_t i = 0; i < 16; i++)
+    executor_post(executor, square, (void*)i, owner_thread, check_completion);
+  executor_free(executor);
+
+  for (int i = 0; i < 16; i++) semaphore_wait(completion_sem);
+  EXPECT_EQ(16, completion_count);
+
+  thread_free(owner_thread);
+  semaphore_free(completion_sem);
+}
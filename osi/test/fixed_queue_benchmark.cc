@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of handing a buffer to another thread and getting it back through
+// fixed queues, as the HCI and A2DP data paths do for each packet.
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+#include "osi/include/fixed_queue.h"
+
+namespace {
+
+constexpr size_t kQueueCapacity = 16;
+
+int data;
+int stop;
+
+// Sends each element of |ping| back through |pong| until it gets |stop|
+void Echo(fixed_queue_t* ping, fixed_queue_t* pong) {
+  while (true) {
+    void* element = fixed_queue_dequeue(ping);
+    if (element == &stop) return;
+    fixed_queue_enqueue(pong, element);
+  }
+}
+
+void BM_FixedQueuePingPong(benchmark::State& state) {
+  fixed_queue_t* ping = fixed_queue_new(kQueueCapacity);
+  fixed_queue_t* pong = fixed_queue_new(kQueueCapacity);
+  // A polled queue also keeps a file descriptor up to date
+  if (state.range(0)) {
+    fixed_queue_get_dequeue_fd(ping);
+    fixed_queue_get_dequeue_fd(pong);
+  }
+  std::thread echo(Echo, ping, pong);
+
+  while (state.KeepRunning()) {
+    fixed_queue_enqueue(ping, &data);
+    benchmark::DoNotOptimize(fixed_queue_dequeue(pong));
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  fixed_queue_enqueue(ping, &stop);
+  echo.join();
+  fixed_queue_free(ping, NULL);
+  fixed_queue_free(pong, NULL);
+}
+
+// Fills and drains a queue on the same thread, which never blocks
+void BM_FixedQueueTryEnqueueDequeue(benchmark::State& state) {
+  fixed_queue_t* queue = fixed_queue_new(kQueueCapacity);
+  if (state.range(0)) fixed_queue_get_dequeue_fd(queue);
+
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < kQueueCapacity; i++)
+      fixed_queue_try_enqueue(queue, &data);
+    for (size_t i = 0; i < kQueueCapacity; i++)
+      benchmark::DoNotOptimize(fixed_queue_try_dequeue(queue));
+  }
+  state.SetItemsProcessed(state.iterations() * kQueueCapacity);
+
+  fixed_queue_free(queue, NULL);
+}
+
+}  // namespace
+
+BENCHMARK(BM_FixedQueuePingPong)->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_FixedQueueTryEnqueueDequeue)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -193,6 +193,32 @@ TEST_F(FixedQueueTest, test_fixed_queue_capacity) {
   fixed_queue_free(queue, NULL);
 }
 
+TEST_F(FixedQueueTest, test_fixed_queue_unbounded) {
+  fixed_queue_t* queue = fixed_queue_new(SIZE_MAX);
+  ASSERT_TRUE(queue != NULL);
+
+  int enqueue_fd = fixed_queue_get_enqueue_fd(queue);
+  int dequeue_fd = fixed_queue_get_dequeue_fd(queue);
+  EXPECT_TRUE(is_fd_readable(enqueue_fd));
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  for (size_t i = 0; i < 2 * TEST_QUEUE_SIZE; i++)
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  EXPECT_EQ(2 * TEST_QUEUE_SIZE + 1, fixed_queue_length(queue));
+  EXPECT_TRUE(is_fd_readable(enqueue_fd));
+  EXPECT_TRUE(is_fd_readable(dequeue_fd));
+
+  for (size_t i = 0; i < 2 * TEST_QUEUE_SIZE; i++)
+    EXPECT_EQ(DUMMY_DATA_STRING, fixed_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_dequeue(queue));
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  EXPECT_TRUE(is_fd_readable(enqueue_fd));
+  EXPECT_FALSE(is_fd_readable(dequeue_fd));
+
+  fixed_queue_free(queue, NULL);
+}
+
 TEST_F(FixedQueueTest, test_fixed_queue_enqueue_dequeue) {
   fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
   ASSERT_TRUE(queue != NULL);
@@ -230,6 +256,43 @@ TEST_F(FixedQueueTest, test_fixed_queue_enqueue_dequeue) {
   fixed_queue_free(queue, NULL);
 }
 
+TEST_F(FixedQueueTest, test_fixed_queue_try_dequeue_batch) {
+  fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  void* data[TEST_QUEUE_SIZE];
+
+  // Test batch dequeue from a NULL queue and from an empty queue
+  EXPECT_EQ((size_t)0, fixed_queue_try_dequeue_batch(NULL, data, 2));
+  EXPECT_EQ((size_t)0, fixed_queue_try_dequeue_batch(queue, data, 2));
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+
+  // Test batch dequeue of fewer elements than queued, in queue order
+  EXPECT_EQ((size_t)2, fixed_queue_try_dequeue_batch(queue, data, 2));
+  EXPECT_EQ(DUMMY_DATA_STRING1, data[0]);
+  EXPECT_EQ(DUMMY_DATA_STRING2, data[1]);
+  EXPECT_EQ((size_t)1, fixed_queue_length(queue));
+
+  // Test batch dequeue of more elements than queued
+  EXPECT_EQ((size_t)1, fixed_queue_try_dequeue_batch(queue, data, 2));
+  EXPECT_EQ(DUMMY_DATA_STRING3, data[0]);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  // Test the queue capacity is released by the batch dequeue
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  }
+  EXPECT_EQ((size_t)TEST_QUEUE_SIZE,
+            fixed_queue_try_dequeue_batch(queue, data, TEST_QUEUE_SIZE));
+  for (size_t i = 0; i < TEST_QUEUE_SIZE; i++) {
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  }
+
+  fixed_queue_free(queue, NULL);
+}
+
 TEST_F(FixedQueueTest, test_fixed_queue_try_peek_first_last) {
   fixed_queue_t* queue = fixed_queue_new(TEST_QUEUE_SIZE);
   ASSERT_TRUE(queue != NULL);
@@ -0,0 +1,97 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include "osi/include/flow_trace.h"
+
+// The flow ID field of a BT_HDR
+struct test_buf_t {
+  uint16_t flow_id;
+};
+
+class FlowTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { flow_trace_set_categories(FLOW_TRACE_L2CAP); }
+  void TearDown() override { flow_trace_set_categories(0); }
+};
+
+TEST_F(FlowTraceTest, test_disabled_category_untouched) {
+  test_buf_t buf = {1234};
+  FLOW_TRACE(FLOW_TRACE_HCI, &buf, "HCI rx");
+  FLOW_TRACE_START(FLOW_TRACE_HCI, &buf, "HCI rx");
+  EXPECT_EQ(1234, buf.flow_id);
+
+  flow_trace_set_categories(0);
+  EXPECT_FALSE(flow_trace_is_enabled(FLOW_TRACE_L2CAP));
+  FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  EXPECT_EQ(1234, buf.flow_id);
+}
+
+TEST_F(FlowTraceTest, test_flow_id_kept_through_layers) {
+  test_buf_t buf = {FLOW_TRACE_NO_FLOW};
+  FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  uint16_t flow_id = buf.flow_id;
+  EXPECT_NE(FLOW_TRACE_NO_FLOW, flow_id);
+
+  FLOW_TRACE(FLOW_TRACE_L2CAP, &buf, "L2CAP to HCI");
+  EXPECT_EQ(flow_id, buf.flow_id);
+
+  // The copies carry the packet on
+  test_buf_t copy = {FLOW_TRACE_NO_FLOW};
+  FLOW_TRACE_COPY(&copy, &buf);
+  FLOW_TRACE_END(FLOW_TRACE_L2CAP, &copy, "HCI tx");
+  EXPECT_EQ(flow_id, copy.flow_id);
+}
+
+TEST_F(FlowTraceTest, test_start_gives_new_flow_id) {
+  test_buf_t buf = {FLOW_TRACE_NO_FLOW};
+  FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  uint16_t flow_id = buf.flow_id;
+  FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  EXPECT_NE(flow_id, buf.flow_id);
+  EXPECT_NE(FLOW_TRACE_NO_FLOW, buf.flow_id);
+}
+
+TEST_F(FlowTraceTest, test_stale_flow_id_replaced) {
+  // Released at the end of its flow, the ID is not taken again
+  test_buf_t buf = {FLOW_TRACE_NO_FLOW};
+  FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  uint16_t flow_id = buf.flow_id;
+  FLOW_TRACE_END(FLOW_TRACE_L2CAP, &buf, "HCI tx");
+  EXPECT_EQ(flow_id, buf.flow_id);
+
+  FLOW_TRACE(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+  EXPECT_NE(flow_id, buf.flow_id);
+
+  // Nor is an ID never given out
+  test_buf_t garbage = {(uint16_t)(buf.flow_id + 1000)};
+  FLOW_TRACE(FLOW_TRACE_L2CAP, &garbage, "L2CAP tx");
+  EXPECT_EQ(buf.flow_id + 1, garbage.flow_id);
+}
+
+TEST_F(FlowTraceTest, test_flow_id_wraps_around) {
+  test_buf_t buf = {FLOW_TRACE_NO_FLOW};
+  for (int i = 0; i < UINT16_MAX + 10; i++) {
+    FLOW_TRACE_START(FLOW_TRACE_L2CAP, &buf, "L2CAP tx");
+    EXPECT_NE(FLOW_TRACE_NO_FLOW, buf.flow_id);
+    FLOW_TRACE_END(FLOW_TRACE_L2CAP, &buf, "HCI tx");
+  }
+}
@@ -0,0 +1,153 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/ilist.h"
+
+class IlistTest : public AllocationTestHarness {};
+
+typedef struct {
+  int value;
+  ilist_link_t link;
+} element_t;
+
+static int value_of(const ilist_link_t* link) {
+  return ILIST_ENTRY(link, element_t, link)->value;
+}
+
+static void init_elements(element_t* elements, int count) {
+  for (int i = 0; i < count; i++) {
+    elements[i].value = i;
+    ilist_link_init(&elements[i].link);
+  }
+}
+
+TEST_F(IlistTest, test_init_is_empty) {
+  ilist_t list;
+  ilist_init(&list);
+  EXPECT_TRUE(ilist_is_empty(&list));
+  EXPECT_EQ(0U, ilist_length(&list));
+  EXPECT_TRUE(ilist_front(&list) == NULL);
+  EXPECT_TRUE(ilist_back(&list) == NULL);
+  EXPECT_TRUE(ilist_pop_front(&list) == NULL);
+  EXPECT_EQ(ilist_end(&list), ilist_begin(&list));
+}
+
+TEST_F(IlistTest, test_append_prepend_order) {
+  element_t elements[3];
+  init_elements(elements, 3);
+
+  ilist_t list;
+  ilist_init(&list);
+  ilist_append(&list, &elements[1].link);
+  ilist_append(&list, &elements[2].link);
+  ilist_prepend(&list, &elements[0].link);
+
+  EXPECT_EQ(3U, ilist_length(&list));
+  EXPECT_EQ(0, value_of(ilist_front(&list)));
+  EXPECT_EQ(2, value_of(ilist_back(&list)));
+
+  int expected = 0;
+  for (ilist_link_t* link = ilist_begin(&list); link != ilist_end(&list);
+       link = ilist_next(link)) {
+    EXPECT_EQ(expected++, value_of(link));
+  }
+  EXPECT_EQ(3, expected);
+}
+
+TEST_F(IlistTest, test_remove_middle) {
+  element_t elements[3];
+  init_elements(elements, 3);
+
+  ilist_t list;
+  ilist_init(&list);
+  for (int i = 0; i < 3; i++) ilist_append(&list, &elements[i].link);
+
+  EXPECT_TRUE(ilist_is_linked(&elements[1].link));
+  ilist_remove(&list, &elements[1].link);
+  EXPECT_FALSE(ilist_is_linked(&elements[1].link));
+
+  EXPECT_EQ(2U, ilist_length(&list));
+  EXPECT_EQ(0, value_of(ilist_front(&list)));
+  EXPECT_EQ(2, value_of(ilist_next(ilist_front(&list))));
+}
+
+TEST_F(IlistTest, test_insert_after) {
+  element_t elements[3];
+  init_elements(elements, 3);
+
+  ilist_t list;
+  ilist_init(&list);
+  ilist_append(&list, &elements[0].link);
+  ilist_append(&list, &elements[2].link);
+  ilist_insert_after(&list, &elements[0].link, &elements[1].link);
+
+  int expected = 0;
+  for (ilist_link_t* link = ilist_begin(&list); link != ilist_end(&list);
+       link = ilist_next(link)) {
+    EXPECT_EQ(expected++, value_of(link));
+  }
+  EXPECT_EQ(3, expected);
+}
+
+TEST_F(IlistTest, test_queue_fifo) {
+  element_t elements[8];
+  init_elements(elements, 8);
+
+  ilist_t queue;
+  ilist_init(&queue);
+  for (int i = 0; i < 8; i++) ilist_append(&queue, &elements[i].link);
+
+  for (int i = 0; i < 8; i++) {
+    ilist_link_t* link = ilist_pop_front(&queue);
+    ASSERT_TRUE(link != NULL);
+    EXPECT_EQ(i, value_of(link));
+    EXPECT_FALSE(ilist_is_linked(link));
+  }
+  EXPECT_TRUE(ilist_is_empty(&queue));
+
+  // A popped element can be queued again
+  ilist_append(&queue, &elements[3].link);
+  EXPECT_EQ(3, value_of(ilist_front(&queue)));
+}
+
+TEST_F(IlistTest, test_remove_while_iterating) {
+  element_t elements[6];
+  init_elements(elements, 6);
+
+  ilist_t list;
+  ilist_init(&list);
+  for (int i = 0; i < 6; i++) ilist_append(&list, &elements[i].link);
+
+  for (ilist_link_t* link = ilist_begin(&list); link != ilist_end(&list);) {
+    ilist_link_t* next = ilist_next(link);
+    if (value_of(link) % 2) ilist_remove(&list, link);
+    link = next;
+  }
+
+  EXPECT_EQ(3U, ilist_length(&list));
+  int expected = 0;
+  for (ilist_link_t* link = ilist_begin(&list); link != ilist_end(&list);
+       link = ilist_next(link)) {
+    EXPECT_EQ(expected, value_of(link));
+    expected += 2;
+  }
+}
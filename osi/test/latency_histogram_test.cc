@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include "osi/include/latency_histogram.h"
+
+TEST(LatencyHistogramTest, test_empty) {
+  latency_histogram_t histogram;
+  latency_histogram_reset(&histogram);
+  EXPECT_EQ(0U, histogram.count);
+  EXPECT_EQ(0U, latency_histogram_percentile(&histogram, 500));
+  EXPECT_EQ(0U, latency_histogram_percentile(&histogram, 1000));
+}
+
+TEST(LatencyHistogramTest, test_small_values_are_exact) {
+  latency_histogram_t histogram;
+  latency_histogram_reset(&histogram);
+  for (uint64_t i = 0; i < 4; i++) latency_histogram_add(&histogram, i);
+
+  EXPECT_EQ(0U, latency_histogram_percentile(&histogram, 0));
+  EXPECT_EQ(1U, latency_histogram_percentile(&histogram, 500));
+  EXPECT_EQ(3U, latency_histogram_percentile(&histogram, 1000));
+  EXPECT_EQ(3U, histogram.max_us);
+  EXPECT_EQ(6U, histogram.total_us);
+}
+
+TEST(LatencyHistogramTest, test_percentiles) {
+  latency_histogram_t histogram;
+  latency_histogram_reset(&histogram);
+
+  // 1000 samples of 1..1000ms
+  for (uint64_t i = 1; i <= 1000; i++)
+    latency_histogram_add(&histogram, i * 1000);
+  EXPECT_EQ(1000U, histogram.count);
+  EXPECT_EQ(1000U * 1000, histogram.max_us);
+
+  // The reported value is at most 25% above the actual percentile
+  uint64_t p50 = latency_histogram_percentile(&histogram, 500);
+  EXPECT_GE(p50, 500U * 1000);
+  EXPECT_LE(p50, 500U * 1000 * 5 / 4);
+  uint64_t p99 = latency_histogram_percentile(&histogram, 990);
+  EXPECT_GE(p99, 990U * 1000);
+  EXPECT_LE(p99, 1000U * 1000);
+  EXPECT_EQ(1000U * 1000, latency_histogram_percentile(&histogram, 999));
+  EXPECT_EQ(1000U * 1000, latency_histogram_percentile(&histogram, 1000));
+}
+
+TEST(LatencyHistogramTest, test_overflow) {
+  latency_histogram_t histogram;
+  latency_histogram_reset(&histogram);
+  latency_histogram_add(&histogram, UINT64_MAX);
+  EXPECT_EQ(1U, histogram.buckets[LATENCY_HISTOGRAM_BUCKETS - 1]);
+  EXPECT_EQ(UINT64_MAX, latency_histogram_percentile(&histogram, 500));
+}
+
+TEST(LatencyHistogramTest, test_merge) {
+  latency_histogram_t histogram1;
+  latency_histogram_t histogram2;
+  latency_histogram_reset(&histogram1);
+  latency_histogram_reset(&histogram2);
+  for (int i = 0; i < 10; i++) latency_histogram_add(&histogram1, 100);
+  for (int i = 0; i < 10; i++) latency_histogram_add(&histogram2, 10000);
+
+  latency_histogram_merge(&histogram2, &histogram1);
+  EXPECT_EQ(20U, histogram1.count);
+  EXPECT_EQ(10U * 100 + 10U * 10000, histogram1.total_us);
+  EXPECT_EQ(10000U, histogram1.max_us);
+  EXPECT_LE(latency_histogram_percentile(&histogram1, 500), 100U * 5 / 4);
+  EXPECT_EQ(10000U, latency_histogram_percentile(&histogram1, 999));
+}
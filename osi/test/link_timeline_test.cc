@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include "osi/include/link_timeline.h"
+
+TEST(LinkTimelineTest, test_quality_durations) {
+  link_timeline_t timeline;
+  link_timeline_reset(&timeline);
+
+  link_timeline_set_quality(&timeline, 0, 2, 0);
+  link_timeline_set_quality(&timeline, 1500 * 1000, 2, 0);
+  link_timeline_set_quality(&timeline, 2000 * 1000, 1, 3);
+  link_timeline_finish(&timeline, 2250 * 1000);
+  EXPECT_EQ(2000U, timeline.quality_duration_ms[2]);
+  EXPECT_EQ(250U, timeline.quality_duration_ms[1]);
+  EXPECT_FALSE(timeline.has_quality_index);
+
+  // The same index after the end is not a transition
+  link_timeline_set_quality(&timeline, 3000 * 1000, 2, 0);
+  ASSERT_EQ(1U, timeline.num_transitions);
+  ASSERT_EQ(1U, timeline.transitions_kept);
+  const link_timeline_transition_t* transition =
+      link_timeline_get_transition(&timeline, 0);
+  EXPECT_EQ(2000U, transition->time_ms);
+  EXPECT_EQ(2, transition->from_index);
+  EXPECT_EQ(1, transition->to_index);
+  EXPECT_EQ(3U, transition->tx_queue_length);
+
+  // The indices beyond the last one are accounted to the last one
+  link_timeline_set_quality(&timeline, 4000 * 1000,
+                            LINK_TIMELINE_MAX_QUALITY_INDEX + 3, 0);
+  link_timeline_finish(&timeline, 5000 * 1000);
+  EXPECT_EQ(1000U,
+            timeline.quality_duration_ms[LINK_TIMELINE_MAX_QUALITY_INDEX - 1]);
+}
+
+TEST(LinkTimelineTest, test_transition_rssi) {
+  link_timeline_t timeline;
+  link_timeline_reset(&timeline);
+
+  link_timeline_set_quality(&timeline, 0, 2, 0);
+  link_timeline_add_rssi(&timeline, 1000, -40, 1);
+  link_timeline_add_rssi(&timeline, 2000, -75, 6);
+  link_timeline_set_quality(&timeline, 3000, 0, 9);
+  ASSERT_EQ(1U, timeline.transitions_kept);
+  EXPECT_EQ(-75, link_timeline_get_transition(&timeline, 0)->rssi);
+
+  ASSERT_EQ(2U, timeline.rssi_samples_kept);
+  EXPECT_EQ(-40, link_timeline_get_rssi_sample(&timeline, 0)->rssi);
+  EXPECT_EQ(1U, link_timeline_get_rssi_sample(&timeline, 0)->tx_queue_length);
+  EXPECT_EQ(-75, link_timeline_get_rssi_sample(&timeline, 1)->rssi);
+}
+
+TEST(LinkTimelineTest, test_rings_keep_the_last) {
+  link_timeline_t timeline;
+  link_timeline_reset(&timeline);
+
+  const uint32_t count = LINK_TIMELINE_MAX_TRANSITIONS + 5;
+  for (uint32_t i = 0; i <= count; i++)
+    link_timeline_set_quality(&timeline, i * 1000 * 1000, i % 2, i);
+  EXPECT_EQ(count, timeline.num_transitions);
+  ASSERT_EQ((uint32_t)LINK_TIMELINE_MAX_TRANSITIONS,
+            timeline.transitions_kept);
+  EXPECT_EQ(6U * 1000, link_timeline_get_transition(&timeline, 0)->time_ms);
+  EXPECT_EQ(count * 1000,
+            link_timeline_get_transition(
+                &timeline, LINK_TIMELINE_MAX_TRANSITIONS - 1)->time_ms);
+
+  for (int32_t i = 0; i < LINK_TIMELINE_MAX_RSSI_SAMPLES + 1; i++)
+    link_timeline_add_rssi(&timeline, i * 1000, -i, 0);
+  ASSERT_EQ((uint32_t)LINK_TIMELINE_MAX_RSSI_SAMPLES,
+            timeline.rssi_samples_kept);
+  EXPECT_EQ(-1, link_timeline_get_rssi_sample(&timeline, 0)->rssi);
+}
+
+TEST(LinkTimelineTest, test_congestion) {
+  link_timeline_t timeline;
+  link_timeline_reset(&timeline);
+
+  link_timeline_set_congested(&timeline, 0, false);
+  EXPECT_EQ(0U, timeline.congestion_count);
+
+  link_timeline_set_congested(&timeline, 1000, true);
+  link_timeline_set_congested(&timeline, 2000, true);
+  link_timeline_set_congested(&timeline, 5000, false);
+  link_timeline_set_congested(&timeline, 8000, true);
+  link_timeline_finish(&timeline, 9000);
+  EXPECT_EQ(2U, timeline.congestion_count);
+  EXPECT_EQ(5000U, timeline.congestion_total_us);
+  EXPECT_EQ(4000U, timeline.congestion_max_us);
+  EXPECT_FALSE(timeline.is_congested);
+}
+
+TEST(LinkTimelineTest, test_merge) {
+  link_timeline_t timeline1;
+  link_timeline_t timeline2;
+  link_timeline_reset(&timeline1);
+  link_timeline_reset(&timeline2);
+
+  link_timeline_set_quality(&timeline1, 0, 1, 0);
+  link_timeline_set_quality(&timeline1, 1000 * 1000, 2, 0);
+  link_timeline_set_congested(&timeline1, 0, true);
+  link_timeline_finish(&timeline1, 2000 * 1000);
+
+  link_timeline_set_quality(&timeline2, 0, 2, 0);
+  link_timeline_set_quality(&timeline2, 500 * 1000, 0, 0);
+  link_timeline_add_rssi(&timeline2, 0, -60, 0);
+  link_timeline_set_congested(&timeline2, 0, true);
+  link_timeline_set_congested(&timeline2, 3000 * 1000, false);
+  link_timeline_finish(&timeline2, 1000 * 1000);
+
+  link_timeline_merge(&timeline2, &timeline1);
+  EXPECT_EQ(500U, timeline1.quality_duration_ms[0]);
+  EXPECT_EQ(1000U, timeline1.quality_duration_ms[1]);
+  EXPECT_EQ(1500U, timeline1.quality_duration_ms[2]);
+  ASSERT_EQ(2U, timeline1.transitions_kept);
+  EXPECT_EQ(1, link_timeline_get_transition(&timeline1, 0)->from_index);
+  EXPECT_EQ(2, link_timeline_get_transition(&timeline1, 1)->from_index);
+  EXPECT_EQ(1U, timeline1.rssi_samples_kept);
+  EXPECT_EQ(2U, timeline1.congestion_count);
+  EXPECT_EQ(5000U * 1000, timeline1.congestion_total_us);
+  EXPECT_EQ(3000U * 1000, timeline1.congestion_max_us);
+}
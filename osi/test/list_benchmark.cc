@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of appending to and removing from an osi list holding many
+// elements, as with the lists of connections, channels and pending
+// requests.
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "osi/include/list.h"
+
+namespace {
+
+class FullList {
+ public:
+  explicit FullList(int count) : list_(list_new(NULL)), elements_(count) {
+    for (int& element : elements_) list_append(list_, &element);
+  }
+
+  ~FullList() { list_free(list_); }
+
+  list_t* list() { return list_; }
+
+ private:
+  list_t* list_;
+  std::vector<int> elements_;
+};
+
+// Removes the oldest element and appends it again, as a queue does
+void BM_ListAppendRemoveFront(benchmark::State& state) {
+  FullList list(state.range(0));
+  while (state.KeepRunning()) {
+    void* element = list_front(list.list());
+    list_remove(list.list(), element);
+    list_append(list.list(), element);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Removes the newest element and appends it again, which walks the whole
+// list to find it
+void BM_ListAppendRemoveBack(benchmark::State& state) {
+  FullList list(state.range(0));
+  while (state.KeepRunning()) {
+    void* element = list_back(list.list());
+    list_remove(list.list(), element);
+    list_append(list.list(), element);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_ListAppendRemoveFront)->Arg(16)->Arg(256);
+BENCHMARK(BM_ListAppendRemoveBack)->Arg(16)->Arg(256);
+
+BENCHMARK_MAIN();
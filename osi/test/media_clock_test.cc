@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/media_clock.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/thread.h"
+#include "osi/include/time.h"
+
+static const period_ms_t TEST_PERIOD_MS = 10;
+static const int TEST_TICKS = 5;
+
+static std::atomic<int> tick_count(0);
+static std::atomic<uint64_t> last_tick_us(0);
+static semaphore_t* tick_semaphore;
+
+static void tick_cb(UNUSED_ATTR void* context, uint64_t timestamp_us) {
+  last_tick_us = timestamp_us;
+  tick_count++;
+  semaphore_post(tick_semaphore);
+}
+
+static void busy_cb(UNUSED_ATTR void* context) {
+  usleep(5 * TEST_PERIOD_MS * 1000);
+}
+
+class MediaClockTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    tick_count = 0;
+    last_tick_us = 0;
+    tick_semaphore = semaphore_new(0);
+    thread = thread_new("media_clock_test");
+  }
+
+  void TearDown() override {
+    thread_free(thread);
+    semaphore_free(tick_semaphore);
+    AllocationTestHarness::TearDown();
+  }
+
+  thread_t* thread;
+};
+
+TEST_F(MediaClockTest, test_new_free) {
+  media_clock_t* clock = media_clock_new("test_clock");
+  ASSERT_TRUE(clock != NULL);
+  EXPECT_FALSE(media_clock_is_running(clock));
+  media_clock_free(clock);
+
+  // Free a NULL clock: just make sure we don't crash
+  media_clock_free(NULL);
+  EXPECT_FALSE(media_clock_is_running(NULL));
+}
+
+TEST_F(MediaClockTest, test_periodic_ticks) {
+  media_clock_t* clock = media_clock_new("test_clock");
+  uint64_t start_us = time_get_os_boottime_us();
+
+  EXPECT_TRUE(media_clock_start(clock, thread_get_reactor(thread),
+                                TEST_PERIOD_MS, tick_cb, NULL));
+  EXPECT_TRUE(media_clock_is_running(clock));
+  for (int i = 0; i < TEST_TICKS; i++) semaphore_wait(tick_semaphore);
+
+  // The ticks are on the period grid, never early
+  EXPECT_GE(last_tick_us - start_us, TEST_TICKS * TEST_PERIOD_MS * 1000);
+
+  media_clock_stop(clock);
+  EXPECT_FALSE(media_clock_is_running(clock));
+  int stopped_count = tick_count;
+  usleep(3 * TEST_PERIOD_MS * 1000);
+  EXPECT_EQ(stopped_count, tick_count);
+
+  media_clock_free(clock);
+}
+
+TEST_F(MediaClockTest, test_restart) {
+  media_clock_t* clock = media_clock_new("test_clock");
+
+  EXPECT_TRUE(media_clock_start(clock, thread_get_reactor(thread),
+                                TEST_PERIOD_MS, tick_cb, NULL));
+  semaphore_wait(tick_semaphore);
+  EXPECT_TRUE(media_clock_start(clock, thread_get_reactor(thread),
+                                TEST_PERIOD_MS, tick_cb, NULL));
+  semaphore_wait(tick_semaphore);
+  EXPECT_TRUE(media_clock_is_running(clock));
+
+  // Free a running clock
+  media_clock_free(clock);
+  int stopped_count = tick_count;
+  usleep(3 * TEST_PERIOD_MS * 1000);
+  EXPECT_EQ(stopped_count, tick_count);
+}
+
+TEST_F(MediaClockTest, test_missed_ticks) {
+  media_clock_t* clock = media_clock_new("test_clock");
+
+  // Keep the reactor thread busy for a few periods
+  EXPECT_TRUE(media_clock_start(clock, thread_get_reactor(thread),
+                                TEST_PERIOD_MS, tick_cb, NULL));
+  thread_post(thread, busy_cb, NULL);
+  semaphore_wait(tick_semaphore);
+  EXPECT_GE(media_clock_get_missed_ticks(clock), 1U);
+
+  media_clock_free(clock);
+}
@@ -34,6 +34,10 @@
 
 namespace testing {
 
+using clearcut::connectivity::A2DPLatency;
+using clearcut::connectivity::A2DPQualityDuration;
+using clearcut::connectivity::A2DPQualityTransition;
+using clearcut::connectivity::A2DPRssiSample;
 using clearcut::connectivity::A2DPSession;
 using clearcut::connectivity::BluetoothLog;
 using clearcut::connectivity::BluetoothSession;
@@ -41,6 +45,7 @@ using clearcut::connectivity::BluetoothSession_ConnectionTechnologyType;
 using clearcut::connectivity::BluetoothSession_DisconnectReasonType;
 using clearcut::connectivity::DeviceInfo;
 using clearcut::connectivity::DeviceInfo_DeviceType;
+using clearcut::connectivity::EnergySample;
 using clearcut::connectivity::PairEvent;
 using clearcut::connectivity::RFCommSession;
 using clearcut::connectivity::ScanEvent;
@@ -107,6 +112,15 @@ ScanEvent* MakeScanEvent(ScanEvent_ScanEventType event_type,
   return event;
 }
 
+void SetA2DPLatency(A2DPLatency* latency,
+                    const latency_histogram_t& histogram) {
+  latency->set_count(histogram.count);
+  latency->set_p50_micros(latency_histogram_percentile(&histogram, 500));
+  latency->set_p99_micros(latency_histogram_percentile(&histogram, 990));
+  latency->set_p999_micros(latency_histogram_percentile(&histogram, 999));
+  latency->set_max_micros(histogram.max_us);
+}
+
 A2DPSession* MakeA2DPSession(const A2dpSessionMetrics& metrics) {
   A2DPSession* session = new A2DPSession();
   session->set_media_timer_min_millis(metrics.media_timer_min_ms);
@@ -117,6 +131,14 @@ A2DPSession* MakeA2DPSession(const A2dpSessionMetrics& metrics) {
   session->set_buffer_underruns_average(metrics.buffer_underruns_average);
   session->set_buffer_underruns_count(metrics.buffer_underruns_count);
   session->set_audio_duration_millis(metrics.audio_duration_ms);
+  if (metrics.media_read_latency.count > 0)
+    SetA2DPLatency(session->mutable_media_read_latency(),
+                   metrics.media_read_latency);
+  if (metrics.encode_latency.count > 0)
+    SetA2DPLatency(session->mutable_encode_latency(), metrics.encode_latency);
+  if (metrics.tx_queue_latency.count > 0)
+    SetA2DPLatency(session->mutable_tx_queue_latency(),
+                   metrics.tx_queue_latency);
   return session;
 }
 
@@ -303,6 +325,46 @@ TEST(BluetoothA2DPSessionMetricsTest, TestPartialUpdate) {
   EXPECT_EQ(metrics1, metrics_sum);
 }
 
+TEST(BluetoothA2DPSessionMetricsTest, TestUpdateLatency) {
+  A2dpSessionMetrics metrics1;
+  A2dpSessionMetrics metrics2;
+  A2dpSessionMetrics metrics_sum;
+  latency_histogram_add(&metrics1.tx_queue_latency, 1000);
+  latency_histogram_add(&metrics2.tx_queue_latency, 30000);
+  latency_histogram_add(&metrics2.encode_latency, 500);
+  latency_histogram_add(&metrics_sum.tx_queue_latency, 1000);
+  latency_histogram_add(&metrics_sum.tx_queue_latency, 30000);
+  latency_histogram_add(&metrics_sum.encode_latency, 500);
+  metrics1.Update(metrics2);
+  EXPECT_EQ(2U, metrics1.tx_queue_latency.count);
+  EXPECT_EQ(30000U, metrics1.tx_queue_latency.max_us);
+  EXPECT_EQ(0U, metrics1.media_read_latency.count);
+  EXPECT_TRUE(metrics1 == metrics_sum);
+  EXPECT_FALSE(metrics1 == metrics2);
+}
+
+TEST(BluetoothA2DPSessionMetricsTest, TestUpdateLinkTimeline) {
+  A2dpSessionMetrics metrics1;
+  A2dpSessionMetrics metrics2;
+  A2dpSessionMetrics metrics_sum;
+  metrics2.codec_index = 5;
+  metrics_sum.codec_index = 5;
+  link_timeline_set_quality(&metrics1.link_timeline, 0, 2, 0);
+  link_timeline_finish(&metrics1.link_timeline, 1000 * 1000);
+  link_timeline_set_congested(&metrics2.link_timeline, 0, true);
+  link_timeline_finish(&metrics2.link_timeline, 300 * 1000);
+  link_timeline_set_quality(&metrics_sum.link_timeline, 0, 2, 0);
+  link_timeline_finish(&metrics_sum.link_timeline, 1000 * 1000);
+  link_timeline_set_congested(&metrics_sum.link_timeline, 0, true);
+  link_timeline_finish(&metrics_sum.link_timeline, 300 * 1000);
+  metrics1.Update(metrics2);
+  EXPECT_EQ(5, metrics1.codec_index);
+  EXPECT_EQ(1000U, metrics1.link_timeline.quality_duration_ms[2]);
+  EXPECT_EQ(1U, metrics1.link_timeline.congestion_count);
+  EXPECT_TRUE(metrics1 == metrics_sum);
+  EXPECT_FALSE(metrics1 == metrics2);
+}
+
 class BluetoothMetricsLoggerTest : public Test {
  protected:
   // Use to hold test protos
@@ -453,6 +515,37 @@ TEST_F(BluetoothMetricsLoggerTest, ScanEventTest) {
   EXPECT_THAT(msg_str, StrEq(bt_log_str_));
 }
 
+TEST_F(BluetoothMetricsLoggerTest, EnergySampleTest) {
+  EnergySample* event = new EnergySample();
+  event->set_duration_millis(60000);
+  event->set_tx_time_millis(1200);
+  event->set_rx_time_millis(3400);
+  event->set_idle_time_millis(55400);
+  event->set_energy_used(789);
+  event->set_a2dp_codec_index(2);
+  event->set_le_scanning(true);
+  event->set_num_le_links(1);
+  event->set_num_bredr_links(2);
+  event->set_event_time_millis(123456);
+  bt_log_->mutable_energy_sample()->AddAllocated(event);
+  bt_log_->set_num_energy_sample(1);
+  UpdateLog();
+  system_bt_osi::energy_sample_t sample = {};
+  sample.duration_ms = 60000;
+  sample.tx_time_ms = 1200;
+  sample.rx_time_ms = 3400;
+  sample.idle_time_ms = 55400;
+  sample.energy_used = 789;
+  sample.a2dp_codec_index = 2;
+  sample.le_scanning = true;
+  sample.num_le_links = 1;
+  sample.num_bredr_links = 2;
+  BluetoothMetricsLogger::GetInstance()->LogEnergySample(sample, 123456);
+  std::string msg_str;
+  BluetoothMetricsLogger::GetInstance()->WriteString(&msg_str, true);
+  EXPECT_THAT(msg_str, StrEq(bt_log_str_));
+}
+
 TEST_F(BluetoothMetricsLoggerTest, BluetoothSessionTest) {
   bt_sessions_.push_back(MakeBluetoothSession(
       10,
@@ -581,6 +674,100 @@ TEST_F(BluetoothMetricsLoggerTest, A2DPSessionTwoUpdatesTest) {
   EXPECT_THAT(msg_str, StrEq(bt_log_str_));
 }
 
+TEST_F(BluetoothMetricsLoggerTest, A2DPSessionLatencyTest) {
+  A2dpSessionMetrics metrics1;
+  A2dpSessionMetrics metrics2;
+  A2dpSessionMetrics metrics_sum;
+  metrics1.audio_duration_ms = 10;
+  metrics2.audio_duration_ms = 25;
+  metrics_sum.audio_duration_ms = 35;
+  for (uint64_t i = 1; i <= 100; i++) {
+    latency_histogram_add(&metrics1.tx_queue_latency, i * 100);
+    latency_histogram_add(&metrics2.tx_queue_latency, i * 200);
+    latency_histogram_add(&metrics_sum.tx_queue_latency, i * 100);
+    latency_histogram_add(&metrics_sum.tx_queue_latency, i * 200);
+  }
+  latency_histogram_add(&metrics2.media_read_latency, 50);
+  latency_histogram_add(&metrics_sum.media_read_latency, 50);
+  DeviceInfo* info = MakeDeviceInfo(
+      BTM_COD_MAJOR_AUDIO_TEST,
+      DeviceInfo_DeviceType::DeviceInfo_DeviceType_DEVICE_TYPE_BREDR);
+  A2DPSession* session = MakeA2DPSession(metrics_sum);
+  bt_sessions_.push_back(MakeBluetoothSession(
+      10,
+      BluetoothSession_ConnectionTechnologyType::
+          BluetoothSession_ConnectionTechnologyType_CONNECTION_TECHNOLOGY_TYPE_BREDR,
+      BluetoothSession_DisconnectReasonType::
+          BluetoothSession_DisconnectReasonType_UNKNOWN,
+      info, nullptr, session));
+  UpdateLog();
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionStart(
+      system_bt_osi::CONNECTION_TECHNOLOGY_TYPE_BREDR, 123456);
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionDeviceInfo(
+      BTM_COD_MAJOR_AUDIO_TEST, system_bt_osi::DEVICE_TYPE_BREDR);
+  BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics1);
+  BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics2);
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionEnd(
+      system_bt_osi::DISCONNECT_REASON_UNKNOWN, 133456);
+  std::string msg_str;
+  BluetoothMetricsLogger::GetInstance()->WriteString(&msg_str, true);
+  EXPECT_THAT(msg_str, StrEq(bt_log_str_));
+}
+
+TEST_F(BluetoothMetricsLoggerTest, A2DPSessionLinkTimelineTest) {
+  A2dpSessionMetrics metrics;
+  metrics.audio_duration_ms = 10;
+  metrics.codec_index = 5;
+  link_timeline_set_quality(&metrics.link_timeline, 0, 2, 0);
+  link_timeline_add_rssi(&metrics.link_timeline, 100 * 1000, -70, 4);
+  link_timeline_set_quality(&metrics.link_timeline, 200 * 1000, 1, 6);
+  link_timeline_set_congested(&metrics.link_timeline, 150 * 1000, true);
+  link_timeline_finish(&metrics.link_timeline, 500 * 1000);
+  DeviceInfo* info = MakeDeviceInfo(
+      BTM_COD_MAJOR_AUDIO_TEST,
+      DeviceInfo_DeviceType::DeviceInfo_DeviceType_DEVICE_TYPE_BREDR);
+  A2DPSession* session = MakeA2DPSession(metrics);
+  session->set_codec_index(5);
+  A2DPQualityDuration* duration = session->add_quality_durations();
+  duration->set_quality_index(1);
+  duration->set_duration_millis(300);
+  duration = session->add_quality_durations();
+  duration->set_quality_index(2);
+  duration->set_duration_millis(200);
+  session->set_quality_transitions_count(1);
+  A2DPQualityTransition* transition = session->add_quality_transitions();
+  transition->set_session_time_millis(200);
+  transition->set_from_quality_index(2);
+  transition->set_to_quality_index(1);
+  transition->set_rssi(-70);
+  transition->set_tx_queue_length(6);
+  A2DPRssiSample* sample = session->add_rssi_samples();
+  sample->set_session_time_millis(100);
+  sample->set_rssi(-70);
+  sample->set_tx_queue_length(4);
+  session->set_congestion_count(1);
+  session->set_congestion_total_millis(350);
+  session->set_congestion_max_millis(350);
+  bt_sessions_.push_back(MakeBluetoothSession(
+      10,
+      BluetoothSession_ConnectionTechnologyType::
+          BluetoothSession_ConnectionTechnologyType_CONNECTION_TECHNOLOGY_TYPE_BREDR,
+      BluetoothSession_DisconnectReasonType::
+          BluetoothSession_DisconnectReasonType_UNKNOWN,
+      info, nullptr, session));
+  UpdateLog();
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionStart(
+      system_bt_osi::CONNECTION_TECHNOLOGY_TYPE_BREDR, 123456);
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionDeviceInfo(
+      BTM_COD_MAJOR_AUDIO_TEST, system_bt_osi::DEVICE_TYPE_BREDR);
+  BluetoothMetricsLogger::GetInstance()->LogA2dpSession(metrics);
+  BluetoothMetricsLogger::GetInstance()->LogBluetoothSessionEnd(
+      system_bt_osi::DISCONNECT_REASON_UNKNOWN, 133456);
+  std::string msg_str;
+  BluetoothMetricsLogger::GetInstance()->WriteString(&msg_str, true);
+  EXPECT_THAT(msg_str, StrEq(bt_log_str_));
+}
+
 /*
  * Test Case: A2DPSessionTwoUpdatesSeparatedbyDumpTest
  *
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/pool.h"
+
+static const size_t TEST_BUFFER_SIZE = 100;
+static const size_t TEST_POOL_CAPACITY = 4;
+
+class PoolTest : public AllocationTestHarness {};
+
+TEST_F(PoolTest, test_new_free_simple) {
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+  ASSERT_TRUE(pool != NULL);
+  EXPECT_EQ(TEST_BUFFER_SIZE, pool_buffer_size(pool));
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_capacity(pool));
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pool));
+  pool_free(pool);
+}
+
+TEST_F(PoolTest, test_free_null) {
+  // Just make sure we don't crash
+  pool_free(NULL);
+  EXPECT_FALSE(pool_release(NULL));
+}
+
+TEST_F(PoolTest, test_alloc_until_exhausted) {
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+  void* buffers[TEST_POOL_CAPACITY];
+
+  for (size_t i = 0; i < TEST_POOL_CAPACITY; i++) {
+    buffers[i] = pool_alloc(pool);
+    ASSERT_TRUE(buffers[i] != NULL);
+    memset(buffers[i], 0x5a, TEST_BUFFER_SIZE);
+    for (size_t j = 0; j < i; j++) EXPECT_NE(buffers[i], buffers[j]);
+  }
+  EXPECT_EQ(0U, pool_available(pool));
+  EXPECT_EQ(0U, pool_exhausted_count(pool));
+
+  EXPECT_TRUE(pool_alloc(pool) == NULL);
+  EXPECT_EQ(1U, pool_exhausted_count(pool));
+
+  for (size_t i = 0; i < TEST_POOL_CAPACITY; i++) osi_free(buffers[i]);
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pool));
+
+  pool_free(pool);
+}
+
+TEST_F(PoolTest, test_osi_free_returns_buffer) {
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+
+  void* buffer = pool_alloc(pool);
+  EXPECT_EQ(TEST_POOL_CAPACITY - 1, pool_available(pool));
+  osi_free(buffer);
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pool));
+
+  // Heap buffers are not claimed by the pool
+  void* heap_buffer = osi_malloc(TEST_BUFFER_SIZE);
+  EXPECT_FALSE(pool_release(heap_buffer));
+  osi_free(heap_buffer);
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pool));
+
+  pool_free(pool);
+}
+
+TEST_F(PoolTest, test_fixed_queue_flush_returns_buffers) {
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+  fixed_queue_t* queue = fixed_queue_new(TEST_POOL_CAPACITY);
+
+  for (size_t i = 0; i < TEST_POOL_CAPACITY; i++)
+    fixed_queue_enqueue(queue, pool_alloc(pool));
+  EXPECT_EQ(0U, pool_available(pool));
+
+  fixed_queue_flush(queue, osi_free);
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pool));
+
+  fixed_queue_free(queue, NULL);
+  pool_free(pool);
+}
+
+TEST_F(PoolTest, test_free_with_outstanding_buffers) {
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+
+  void* buffer = pool_alloc(pool);
+  pool_free(pool);
+
+  // The outstanding buffer is still usable, and freeing it releases the slab
+  memset(buffer, 0xa5, TEST_BUFFER_SIZE);
+  osi_free(buffer);
+}
+
+TEST_F(PoolTest, test_max_pools) {
+  pool_t* pools[POOL_MAX_POOLS];
+
+  for (size_t i = 0; i < POOL_MAX_POOLS; i++) {
+    pools[i] = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+    ASSERT_TRUE(pools[i] != NULL);
+  }
+  EXPECT_TRUE(pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY) == NULL);
+
+  // Buffers are returned to the pool they were taken from
+  void* buffer = pool_alloc(pools[POOL_MAX_POOLS - 1]);
+  osi_free(buffer);
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pools[POOL_MAX_POOLS - 1]));
+  EXPECT_EQ(TEST_POOL_CAPACITY, pool_available(pools[0]));
+
+  for (size_t i = 0; i < POOL_MAX_POOLS; i++) pool_free(pools[i]);
+
+  // A released slot can be claimed again
+  pool_t* pool = pool_new(TEST_BUFFER_SIZE, TEST_POOL_CAPACITY);
+  EXPECT_TRUE(pool != NULL);
+  pool_free(pool);
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Rate at which a reactor dispatches ready file descriptors to their
+// callbacks, as the HCI and BTU threads do for each packet and message.
+
+#include <benchmark/benchmark.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "osi/include/reactor.h"
+#include "osi/include/semaphore.h"
+
+namespace {
+
+// An event file descriptor registered with a reactor, which posts |done|
+// each time it is dispatched.
+class Event {
+ public:
+  Event(reactor_t* reactor, semaphore_t* done)
+      : fd_(eventfd(0, EFD_NONBLOCK)), done_(done) {
+    object_ = reactor_register(reactor, fd_, this, ReadReady, NULL);
+  }
+
+  ~Event() {
+    reactor_unregister(object_);
+    close(fd_);
+  }
+
+  void Signal() { eventfd_write(fd_, 1); }
+
+ private:
+  static void ReadReady(void* context) {
+    Event* event = static_cast<Event*>(context);
+    eventfd_t value;
+    eventfd_read(event->fd_, &value);
+    semaphore_post(event->done_);
+  }
+
+  int fd_;
+  semaphore_t* done_;
+  reactor_object_t* object_;
+};
+
+// Signals |state.range(0)| file descriptors at once and waits for the
+// reactor thread to dispatch all of them
+void BM_ReactorDispatch(benchmark::State& state) {
+  reactor_t* reactor = reactor_new();
+  semaphore_t* done = semaphore_new_lightweight(0);
+  std::vector<Event*> events;
+  for (int i = 0; i < state.range(0); i++)
+    events.push_back(new Event(reactor, done));
+  std::thread loop(reactor_start, reactor);
+
+  while (state.KeepRunning()) {
+    for (Event* event : events) event->Signal();
+    for (size_t i = 0; i < events.size(); i++) semaphore_wait(done);
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+
+  reactor_stop(reactor);
+  loop.join();
+  for (Event* event : events) delete event;
+  semaphore_free(done);
+  reactor_free(reactor);
+}
+
+}  // namespace
+
+BENCHMARK(BM_ReactorDispatch)->Arg(1)->Arg(8)->Arg(64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -111,3 +111,120 @@ TEST_F(ReactorTest, reactor_unregister_from_separate_thread) {
   close(fd);
   reactor_free(reactor);
 }
+
+static int dispatch_order[8];
+static int dispatch_count;
+
+static void record_dispatch_cb(void* context) {
+  int fd = (int)(intptr_t)context;
+  eventfd_t value;
+  eventfd_read(fd, &value);
+  dispatch_order[dispatch_count++] = fd;
+}
+
+TEST_F(ReactorTest, reactor_dispatch_by_priority) {
+  reactor_t* reactor = reactor_new();
+
+  int low_fd = eventfd(0, 0);
+  int normal_fd = eventfd(0, 0);
+  int high_fd = eventfd(0, 0);
+  reactor_object_t* low = reactor_register_with_priority(
+      reactor, low_fd, (void*)(intptr_t)low_fd, REACTOR_PRIORITY_LOW,
+      record_dispatch_cb, NULL);
+  reactor_object_t* normal =
+      reactor_register(reactor, normal_fd, (void*)(intptr_t)normal_fd,
+                       record_dispatch_cb, NULL);
+  reactor_object_t* high = reactor_register_with_priority(
+      reactor, high_fd, (void*)(intptr_t)high_fd, REACTOR_PRIORITY_HIGH,
+      record_dispatch_cb, NULL);
+
+  eventfd_write(low_fd, 1);
+  eventfd_write(normal_fd, 1);
+  eventfd_write(high_fd, 1);
+
+  dispatch_count = 0;
+  EXPECT_EQ(REACTOR_STATUS_DONE, reactor_run_once(reactor));
+  EXPECT_EQ(3, dispatch_count);
+  EXPECT_EQ(high_fd, dispatch_order[0]);
+  EXPECT_EQ(normal_fd, dispatch_order[1]);
+  EXPECT_EQ(low_fd, dispatch_order[2]);
+
+  reactor_object_stats_t stats;
+  reactor_object_get_stats(high, &stats);
+  EXPECT_EQ(1U, stats.dispatch_count);
+  EXPECT_LE(stats.max_delay_us, stats.total_delay_us);
+
+  reactor_unregister(low);
+  reactor_unregister(normal);
+  reactor_unregister(high);
+  close(low_fd);
+  close(normal_fd);
+  close(high_fd);
+  reactor_free(reactor);
+}
+
+TEST_F(ReactorTest, reactor_low_priority_batch) {
+  reactor_t* reactor = reactor_new();
+
+  const int num_fds = REACTOR_LOW_PRIORITY_BATCH + 2;
+  int fds[num_fds];
+  reactor_object_t* objects[num_fds];
+  for (int i = 0; i < num_fds; i++) {
+    fds[i] = eventfd(0, 0);
+    objects[i] = reactor_register_with_priority(
+        reactor, fds[i], (void*)(intptr_t)fds[i], REACTOR_PRIORITY_LOW,
+        record_dispatch_cb, NULL);
+    eventfd_write(fds[i], 1);
+  }
+
+  // The objects left out of the first iteration are dispatched on the next
+  dispatch_count = 0;
+  EXPECT_EQ(REACTOR_STATUS_DONE, reactor_run_once(reactor));
+  EXPECT_EQ(REACTOR_LOW_PRIORITY_BATCH, dispatch_count);
+  EXPECT_EQ(REACTOR_STATUS_DONE, reactor_run_once(reactor));
+  EXPECT_EQ(num_fds, dispatch_count);
+
+  for (int i = 0; i < num_fds; i++) {
+    reactor_unregister(objects[i]);
+    close(fds[i]);
+  }
+  reactor_free(reactor);
+}
+
+static reactor_t* occupancy_reactor;
+static uint64_t occupancy_dispatch_start_us;
+
+static void busy_dispatch_cb(void* context) {
+  int fd = (int)(intptr_t)context;
+  eventfd_t value;
+  eventfd_read(fd, &value);
+
+  reactor_occupancy_t occupancy;
+  reactor_get_occupancy(occupancy_reactor, &occupancy);
+  occupancy_dispatch_start_us = occupancy.dispatch_start_us;
+  usleep(10000);
+}
+
+TEST_F(ReactorTest, reactor_occupancy) {
+  occupancy_reactor = reactor_new();
+  reactor_occupancy_t occupancy;
+  reactor_get_occupancy(occupancy_reactor, &occupancy);
+  EXPECT_EQ(0U, occupancy.busy_us);
+  EXPECT_EQ(0U, occupancy.dispatch_start_us);
+
+  int fd = eventfd(0, 0);
+  reactor_object_t* object = reactor_register(
+      occupancy_reactor, fd, (void*)(intptr_t)fd, busy_dispatch_cb, NULL);
+  eventfd_write(fd, 1);
+  EXPECT_EQ(REACTOR_STATUS_DONE, reactor_run_once(occupancy_reactor));
+
+  // The running callbacks are seen, and their time is counted once done
+  EXPECT_NE(0U, occupancy_dispatch_start_us);
+  reactor_get_occupancy(occupancy_reactor, &occupancy);
+  EXPECT_LE(10000U, occupancy.busy_us);
+  EXPECT_EQ(0U, occupancy.dispatch_start_us);
+
+  reactor_unregister(object);
+  close(fd);
+  reactor_free(occupancy_reactor);
+}
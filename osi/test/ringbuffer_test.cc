@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#include <thread>
+
 #include "osi/include/osi.h"
 #include "osi/include/ringbuffer.h"
 
@@ -137,3 +141,147 @@ TEST(RingbufferTest, test_multi_insert_delete) {
 
   ringbuffer_free(rb);
 }
+
+TEST(RingbufferTest, test_reserve_commit) {
+  ringbuffer_t* rb = ringbuffer_init(8);
+  uint8_t* span;
+
+  // Nothing is visible until committed
+  EXPECT_EQ((size_t)5, ringbuffer_reserve(rb, &span, 5));
+  memset(span, 0xAA, 5);
+  EXPECT_EQ((size_t)0, ringbuffer_size(rb));
+  ringbuffer_commit(rb, 5);
+  EXPECT_EQ((size_t)5, ringbuffer_size(rb));
+  EXPECT_EQ((size_t)3, ringbuffer_available(rb));
+
+  // The free space is bounded by the end of the buffer
+  uint8_t peek[8] = {0};
+  EXPECT_EQ((size_t)4, ringbuffer_pop(rb, peek, 4));
+  EXPECT_EQ((size_t)3, ringbuffer_reserve(rb, &span, 8));
+  memset(span, 0xBB, 3);
+  ringbuffer_commit(rb, 3);
+
+  // Then it wraps around to the start of the buffer
+  EXPECT_EQ((size_t)4, ringbuffer_reserve(rb, &span, 8));
+  memset(span, 0xCC, 2);
+  ringbuffer_commit(rb, 2);
+  EXPECT_EQ((size_t)6, ringbuffer_size(rb));
+
+  uint8_t content[] = {0xAA, 0xBB, 0xBB, 0xBB, 0xCC, 0xCC};
+  EXPECT_EQ((size_t)6, ringbuffer_peek(rb, 0, peek, 8));
+  ASSERT_TRUE(0 == memcmp(content, peek, sizeof(content)));
+
+  // A full buffer has no room
+  EXPECT_EQ((size_t)2, ringbuffer_reserve(rb, &span, 8));
+  ringbuffer_commit(rb, 2);
+  EXPECT_EQ((size_t)0, ringbuffer_reserve(rb, &span, 8));
+  EXPECT_EQ((size_t)0, ringbuffer_available(rb));
+
+  ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_peek_contiguous_release) {
+  ringbuffer_t* rb = ringbuffer_init(8);
+  const uint8_t* span;
+
+  EXPECT_EQ((size_t)0, ringbuffer_peek_contiguous(rb, &span));
+
+  uint8_t aa[] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+  uint8_t bb[] = {0xBB, 0xBB, 0xBB, 0xBB};
+  ringbuffer_insert(rb, aa, sizeof(aa));
+  ringbuffer_delete(rb, 4);
+  ringbuffer_insert(rb, bb, sizeof(bb));
+
+  // The data wrapping around comes as two spans
+  EXPECT_EQ((size_t)4, ringbuffer_peek_contiguous(rb, &span));
+  uint8_t first[] = {0xAA, 0xAA, 0xBB, 0xBB};
+  ASSERT_TRUE(0 == memcmp(first, span, sizeof(first)));
+  ringbuffer_release(rb, 4);
+  EXPECT_EQ((size_t)2, ringbuffer_size(rb));
+
+  EXPECT_EQ((size_t)2, ringbuffer_peek_contiguous(rb, &span));
+  ASSERT_TRUE(0 == memcmp(bb, span, 2));
+  ringbuffer_release(rb, 1);
+  EXPECT_EQ((size_t)1, ringbuffer_peek_contiguous(rb, &span));
+  ringbuffer_release(rb, 1);
+
+  EXPECT_EQ((size_t)0, ringbuffer_size(rb));
+  EXPECT_EQ((size_t)8, ringbuffer_available(rb));
+
+  ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_concurrent) {
+  static const size_t stress_bytes = 1000000;
+  ringbuffer_t* rb = ringbuffer_init(61);
+
+  // The producer writes in place, the consumer copies out, in odd sizes
+  std::thread producer([rb]() {
+    size_t written = 0;
+    while (written < stress_bytes) {
+      uint8_t* span;
+      size_t length = ringbuffer_reserve(rb, &span, 7 + written % 13);
+      if (length == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (length > stress_bytes - written) length = stress_bytes - written;
+      for (size_t i = 0; i < length; i++) span[i] = (written + i) & 0xFF;
+      ringbuffer_commit(rb, length);
+      written += length;
+    }
+  });
+
+  size_t read = 0;
+  while (read < stress_bytes) {
+    uint8_t buffer[17];
+    size_t length = ringbuffer_pop(rb, buffer, 1 + read % sizeof(buffer));
+    if (length == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (size_t i = 0; i < length; i++)
+      ASSERT_EQ((read + i) & 0xFF, buffer[i]);
+    read += length;
+  }
+
+  producer.join();
+  EXPECT_EQ((size_t)0, ringbuffer_size(rb));
+  ringbuffer_free(rb);
+}
+
+TEST(RingbufferTest, test_concurrent_zero_copy) {
+  static const size_t stress_bytes = 1000000;
+  ringbuffer_t* rb = ringbuffer_init(64);
+
+  // The consumer reads in place too
+  std::thread producer([rb]() {
+    uint8_t buffer[23];
+    size_t written = 0;
+    while (written < stress_bytes) {
+      size_t length = sizeof(buffer);
+      if (length > stress_bytes - written) length = stress_bytes - written;
+      for (size_t i = 0; i < length; i++) buffer[i] = (written + i) & 0xFF;
+      size_t inserted = ringbuffer_insert(rb, buffer, length);
+      if (inserted == 0) std::this_thread::yield();
+      written += inserted;
+    }
+  });
+
+  size_t read = 0;
+  while (read < stress_bytes) {
+    const uint8_t* span;
+    size_t length = ringbuffer_peek_contiguous(rb, &span);
+    if (length == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    for (size_t i = 0; i < length; i++) ASSERT_EQ((read + i) & 0xFF, span[i]);
+    ringbuffer_release(rb, length);
+    read += length;
+  }
+
+  producer.join();
+  EXPECT_EQ((size_t)0, ringbuffer_size(rb));
+  ringbuffer_free(rb);
+}
@@ -60,6 +60,22 @@ TEST_F(SemaphoreTest, test_try_wait) {
   semaphore_free(semaphore);
 }
 
+TEST_F(SemaphoreTest, test_try_wait_n_post_n) {
+  semaphore_t* semaphore = semaphore_new(0);
+  ASSERT_TRUE(semaphore != NULL);
+
+  EXPECT_EQ((size_t)0, semaphore_try_wait_n(semaphore, 4));
+  semaphore_post_n(semaphore, 3);
+  EXPECT_EQ((size_t)2, semaphore_try_wait_n(semaphore, 2));
+  EXPECT_EQ((size_t)1, semaphore_try_wait_n(semaphore, 4));
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+
+  semaphore_post_n(semaphore, 0);
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+
+  semaphore_free(semaphore);
+}
+
 TEST_F(SemaphoreTest, test_wait_after_post) {
   semaphore_t* semaphore = semaphore_new(0);
   ASSERT_TRUE(semaphore != NULL);
@@ -84,3 +100,33 @@ TEST_F(SemaphoreTest, test_ensure_wait) {
   semaphore_free(semaphore);
   thread_free(thread);
 }
+
+TEST_F(SemaphoreTest, test_lightweight_try_wait_n_post_n) {
+  semaphore_t* semaphore = semaphore_new_lightweight(1);
+  ASSERT_TRUE(semaphore != NULL);
+
+  EXPECT_TRUE(semaphore_try_wait(semaphore));
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+  semaphore_post_n(semaphore, 3);
+  EXPECT_EQ((size_t)2, semaphore_try_wait_n(semaphore, 2));
+  EXPECT_EQ((size_t)1, semaphore_try_wait_n(semaphore, 4));
+  EXPECT_FALSE(semaphore_try_wait(semaphore));
+
+  semaphore_free(semaphore);
+}
+
+TEST_F(SemaphoreTest, test_lightweight_ensure_wait) {
+  semaphore_t* semaphore = semaphore_new_lightweight(0);
+  ASSERT_TRUE(semaphore != NULL);
+  thread_t* thread = thread_new("semaphore_test_thread");
+  ASSERT_TRUE(thread != NULL);
+
+  SemaphoreTestSequenceHelper sequence_helper = {semaphore, 0};
+  thread_post(thread, sleep_then_increment_counter, &sequence_helper);
+  semaphore_wait(semaphore);
+  EXPECT_EQ(sequence_helper.counter, 1)
+      << "semaphore_wait() did not wait for counter to increment";
+
+  semaphore_free(semaphore);
+  thread_free(thread);
+}
@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/semaphore.h"
+#include "osi/include/slab.h"
+#include "osi/include/thread.h"
+
+class SlabTest : public AllocationTestHarness {
+ protected:
+  virtual void SetUp() {
+    AllocationTestHarness::SetUp();
+    slab_init();
+  }
+};
+
+TEST_F(SlabTest, test_init_enables) { EXPECT_TRUE(slab_is_enabled()); }
+
+TEST_F(SlabTest, test_alloc_too_large) {
+  EXPECT_TRUE(slab_alloc(64 * 1024) == NULL);
+}
+
+TEST_F(SlabTest, test_release_heap_pointer) {
+  void* ptr = malloc(32);
+  EXPECT_FALSE(slab_release(ptr));
+  free(ptr);
+}
+
+TEST_F(SlabTest, test_alloc_release_reuses) {
+  void* ptr = slab_alloc(100);
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(ptr) % 16);
+  EXPECT_TRUE(slab_release(ptr));
+
+  // The object is taken back from the magazine of this thread
+  void* again = slab_alloc(100);
+  EXPECT_EQ(ptr, again);
+  EXPECT_TRUE(slab_release(again));
+}
+
+TEST_F(SlabTest, test_size_classes_do_not_overlap) {
+  uint8_t* small = static_cast<uint8_t*>(slab_alloc(32));
+  uint8_t* large = static_cast<uint8_t*>(slab_alloc(4000));
+  ASSERT_TRUE(small != NULL);
+  ASSERT_TRUE(large != NULL);
+
+  memset(small, 0xaa, 32);
+  memset(large, 0x55, 4000);
+  for (int i = 0; i < 32; i++) EXPECT_EQ(0xaa, small[i]);
+
+  EXPECT_TRUE(slab_release(small));
+  EXPECT_TRUE(slab_release(large));
+}
+
+TEST_F(SlabTest, test_osi_calloc_zeroes_reused_object) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(64));
+  memset(ptr, 0xff, 64);
+  osi_free(ptr);
+
+  uint8_t* zeroed = static_cast<uint8_t*>(osi_calloc(64));
+  for (int i = 0; i < 64; i++) EXPECT_EQ(0, zeroed[i]);
+  osi_free(zeroed);
+}
+
+static const int kObjectCount = 200;
+static void* objects[kObjectCount];
+static semaphore_t* done_sem;
+
+static void allocate_objects(void* context) {
+  for (int i = 0; i < kObjectCount; i++) {
+    objects[i] = osi_malloc(200);
+    memset(objects[i], i, 200);
+  }
+  semaphore_post(done_sem);
+}
+
+TEST_F(SlabTest, test_free_on_another_thread) {
+  done_sem = semaphore_new(0);
+  thread_t* thread = thread_new("slab_test");
+
+  // Flows through the depot each way, beyond what a magazine holds
+  for (int round = 0; round < 3; round++) {
+    thread_post(thread, allocate_objects, NULL);
+    semaphore_wait(done_sem);
+    for (int i = 0; i < kObjectCount; i++) {
+      EXPECT_EQ((uint8_t)i, static_cast<uint8_t*>(objects[i])[199]);
+      osi_free(objects[i]);
+    }
+  }
+
+  thread_free(thread);
+  semaphore_free(done_sem);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/spsc_queue.h"
+#include "osi/include/time.h"
+
+static const size_t TEST_QUEUE_SIZE = 10;
+static const uintptr_t TEST_STRESS_ELEMENTS = 100000;
+
+static int test_queue_entry_free_counter = 0;
+
+static void test_queue_entry_free_cb(void* data) {
+  test_queue_entry_free_counter++;
+  osi_free(data);
+}
+
+class SpscQueueTest : public AllocationTestHarness {};
+
+TEST_F(SpscQueueTest, test_spsc_queue_new_free) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ(TEST_QUEUE_SIZE, spsc_queue_capacity(queue));
+  EXPECT_TRUE(spsc_queue_is_empty(queue));
+  spsc_queue_free(queue, NULL);
+
+  // Free a NULL queue: just make sure we don't crash
+  spsc_queue_free(NULL, NULL);
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_null) {
+  EXPECT_TRUE(spsc_queue_is_empty(NULL));
+  EXPECT_EQ(0U, spsc_queue_length(NULL));
+  EXPECT_TRUE(spsc_queue_try_dequeue(NULL) == NULL);
+  EXPECT_EQ(0U, spsc_queue_first_enqueue_us(NULL));
+  EXPECT_EQ(0U, spsc_queue_flush(NULL, NULL));
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_enqueue_dequeue) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+
+  // Fill the queue, wrapping around the ring a few times
+  for (uintptr_t round = 0; round < 3; round++) {
+    for (uintptr_t i = 1; i <= TEST_QUEUE_SIZE; i++) {
+      EXPECT_TRUE(spsc_queue_try_enqueue(queue, (void*)i));
+      EXPECT_EQ(i, spsc_queue_length(queue));
+    }
+    EXPECT_FALSE(spsc_queue_try_enqueue(queue, (void*)1));
+
+    // Elements are dequeued in FIFO order
+    for (uintptr_t i = 1; i <= TEST_QUEUE_SIZE; i++)
+      EXPECT_EQ((void*)i, spsc_queue_try_dequeue(queue));
+    EXPECT_TRUE(spsc_queue_try_dequeue(queue) == NULL);
+    EXPECT_TRUE(spsc_queue_is_empty(queue));
+  }
+
+  spsc_queue_free(queue, NULL);
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_flush) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+
+  for (size_t i = 0; i < TEST_QUEUE_SIZE / 2; i++)
+    spsc_queue_try_enqueue(queue, osi_malloc(1));
+
+  test_queue_entry_free_counter = 0;
+  EXPECT_EQ(TEST_QUEUE_SIZE / 2,
+            spsc_queue_flush(queue, test_queue_entry_free_cb));
+  EXPECT_EQ((int)(TEST_QUEUE_SIZE / 2), test_queue_entry_free_counter);
+  EXPECT_TRUE(spsc_queue_is_empty(queue));
+
+  // The remaining elements are freed together with the queue
+  spsc_queue_try_enqueue(queue, osi_malloc(1));
+  test_queue_entry_free_counter = 0;
+  spsc_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(1, test_queue_entry_free_counter);
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_enqueue_time) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+  EXPECT_EQ(0U, spsc_queue_first_enqueue_us(queue));
+
+  uint64_t before_us = time_get_os_boottime_us();
+  spsc_queue_try_enqueue(queue, (void*)1);
+  uint64_t after_us = time_get_os_boottime_us();
+  spsc_queue_try_enqueue(queue, (void*)2);
+
+  uint64_t first_enqueue_us = spsc_queue_first_enqueue_us(queue);
+  EXPECT_LE(before_us, first_enqueue_us);
+  EXPECT_GE(after_us, first_enqueue_us);
+
+  uint64_t enqueue_us = 0;
+  EXPECT_EQ((void*)1, spsc_queue_try_dequeue_timed(queue, &enqueue_us));
+  EXPECT_EQ(first_enqueue_us, enqueue_us);
+  EXPECT_LE(after_us, spsc_queue_first_enqueue_us(queue));
+
+  spsc_queue_free(queue, NULL);
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_concurrent) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+
+  std::thread producer([queue]() {
+    for (uintptr_t i = 1; i <= TEST_STRESS_ELEMENTS; i++) {
+      while (!spsc_queue_try_enqueue(queue, (void*)i)) std::this_thread::yield();
+    }
+  });
+
+  // Every element is received exactly once and in order
+  uintptr_t expected = 1;
+  while (expected <= TEST_STRESS_ELEMENTS) {
+    void* data = spsc_queue_try_dequeue(queue);
+    if (data == NULL) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ((void*)expected, data);
+    expected++;
+  }
+
+  producer.join();
+  EXPECT_TRUE(spsc_queue_is_empty(queue));
+  spsc_queue_free(queue, NULL);
+}
+
+TEST_F(SpscQueueTest, test_spsc_queue_concurrent_flush) {
+  spsc_queue_t* queue = spsc_queue_new(TEST_QUEUE_SIZE);
+  std::atomic<bool> producer_done(false);
+  size_t flushed_n = 0;
+
+  // The producer flushes the queue while the consumer drains it
+  std::thread producer([queue, &producer_done, &flushed_n]() {
+    for (uintptr_t i = 1; i <= TEST_STRESS_ELEMENTS; i++) {
+      while (!spsc_queue_try_enqueue(queue, (void*)i)) std::this_thread::yield();
+      if ((i % 16) == 0) flushed_n += spsc_queue_flush(queue, NULL);
+    }
+    producer_done = true;
+  });
+
+  // No element is received twice, and the order is preserved
+  size_t received_n = 0;
+  uintptr_t last = 0;
+  while (!producer_done.load() || !spsc_queue_is_empty(queue)) {
+    void* data = spsc_queue_try_dequeue(queue);
+    if (data == NULL) {
+      std::this_thread::yield();
+      continue;
+    }
+    EXPECT_LT(last, (uintptr_t)data);
+    last = (uintptr_t)data;
+    received_n++;
+  }
+
+  producer.join();
+  EXPECT_EQ(TEST_STRESS_ELEMENTS, flushed_n + received_n);
+  spsc_queue_free(queue, NULL);
+}
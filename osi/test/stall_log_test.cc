@@ -0,0 +1,136 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "osi/include/stall_log.h"
+#include "osi/include/time.h"
+
+// Returns the text of the dump of the stall log
+static std::string stall_log_dump_to_string() {
+  FILE* file = tmpfile();
+  stall_log_debug_dump(fileno(file));
+  fflush(file);
+
+  std::string dump;
+  char buf[1024];
+  size_t len;
+  rewind(file);
+  while ((len = fread(buf, 1, sizeof(buf), file)) > 0) dump.append(buf, len);
+  fclose(file);
+  return dump;
+}
+
+static void callback(void* context) {}
+
+static void busy_wait_ms(uint32_t ms) {
+  uint64_t end_us = time_get_os_boottime_us() + ms * 1000;
+  while (time_get_os_boottime_us() < end_us) {
+  }
+}
+
+class StallLogTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    stall_log_set_threshold_ms(STALL_LOG_DEFAULT_THRESHOLD_MS);
+    stall_log_set_sampling(false);
+    stall_log_clear();
+  }
+
+  void TearDown() override {
+    stall_log_set_threshold_ms(STALL_LOG_DEFAULT_THRESHOLD_MS);
+    stall_log_set_sampling(false);
+    stall_log_clear();
+  }
+};
+
+TEST_F(StallLogTest, test_below_threshold_not_recorded) {
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_end(0, STALL_LOG_DEFAULT_THRESHOLD_MS * 1000 - 1);
+  EXPECT_EQ(0u, stall_log_get_count());
+}
+
+TEST_F(StallLogTest, test_over_threshold_recorded) {
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_end(0, 25123);
+  EXPECT_EQ(1u, stall_log_get_count());
+  EXPECT_NE(std::string::npos, stall_log_dump_to_string().find("25.123 ms"));
+}
+
+TEST_F(StallLogTest, test_disabled) {
+  stall_log_set_threshold_ms(0);
+  EXPECT_EQ(0u, stall_log_get_threshold_ms());
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_end(0, 1000000);
+  EXPECT_EQ(0u, stall_log_get_count());
+  EXPECT_NE(std::string::npos, stall_log_dump_to_string().find("Disabled"));
+}
+
+TEST_F(StallLogTest, test_nested_callbacks_recorded_once) {
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_end(0, 30000);
+  EXPECT_EQ(0u, stall_log_get_count());
+  stall_log_dispatch_end(0, 40000);
+  EXPECT_EQ(1u, stall_log_get_count());
+}
+
+TEST_F(StallLogTest, test_origin_recorded) {
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_set_origin("test_origin_function", "a/b/origin_file.cc", 42);
+  stall_log_dispatch_end(0, 30000);
+  EXPECT_NE(std::string::npos,
+            stall_log_dump_to_string().find(
+                "test_origin_function@origin_file.cc:42"));
+
+  // The origin is dropped with the callback
+  stall_log_set_origin("test_stale_origin", "origin_file.cc", 43);
+  stall_log_dispatch_start((const void*)callback);
+  stall_log_dispatch_end(0, 30000);
+  EXPECT_EQ(std::string::npos,
+            stall_log_dump_to_string().find("test_stale_origin"));
+}
+
+TEST_F(StallLogTest, test_wrap_around) {
+  for (int i = 0; i < STALL_LOG_SIZE + 5; i++) {
+    stall_log_dispatch_start((const void*)callback);
+    stall_log_dispatch_end(0, 30000);
+  }
+  EXPECT_EQ((uint64_t)STALL_LOG_SIZE + 5, stall_log_get_count());
+
+  stall_log_clear();
+  EXPECT_EQ(0u, stall_log_get_count());
+}
+
+TEST_F(StallLogTest, test_sampling) {
+  stall_log_set_threshold_ms(5);
+  stall_log_set_sampling(true);
+
+  uint64_t start_us = time_get_os_boottime_us();
+  stall_log_dispatch_start((const void*)callback);
+  busy_wait_ms(30);
+  stall_log_dispatch_end(start_us, time_get_os_boottime_us() - start_us);
+
+  EXPECT_EQ(1u, stall_log_get_count());
+  EXPECT_NE(std::string::npos, stall_log_dump_to_string().find("    #00 "));
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "AllocationTestHarness.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "osi/include/compat.h"
+#include "osi/include/config.h"
+#include "osi/include/thread.h"
+#include "osi/include/thread_policy.h"
+
+class ThreadPolicyTest : public AllocationTestHarness {
+ protected:
+  void SetUp() override {
+    AllocationTestHarness::SetUp();
+    config = config_new_empty();
+  }
+
+  void TearDown() override {
+    thread_policy_load(NULL);
+    config_free(config);
+    AllocationTestHarness::TearDown();
+  }
+
+  config_t* config;
+};
+
+TEST_F(ThreadPolicyTest, test_load) {
+  config_set_string(config, "ThreadPolicy:test_policy", "CpuMask", "0xf0");
+  config_set_string(config, "ThreadPolicy:test_policy", "SchedClass", "fifo");
+  config_set_int(config, "ThreadPolicy:test_policy", "Priority", 2);
+  config_set_string(config, "ThreadPolicy:test_bad", "SchedClass", "bad");
+  config_set_string(config, "test_other", "SchedClass", "fifo");
+  thread_policy_load(config);
+
+  thread_policy_t policy;
+  ASSERT_TRUE(thread_policy_get("test_policy", &policy));
+  EXPECT_EQ(0xf0u, policy.cpu_mask);
+  EXPECT_EQ(THREAD_SCHED_FIFO, policy.sched_class);
+  EXPECT_EQ(2, policy.priority);
+  EXPECT_FALSE(thread_policy_get("test_bad", &policy));
+  EXPECT_FALSE(thread_policy_get("test_other", &policy));
+
+  thread_policy_load(NULL);
+  EXPECT_FALSE(thread_policy_get("test_policy", &policy));
+}
+
+TEST_F(ThreadPolicyTest, test_deadline_needs_budget) {
+  config_set_string(config, "ThreadPolicy:test_dl", "SchedClass", "deadline");
+  thread_policy_load(config);
+  thread_policy_t policy;
+  EXPECT_FALSE(thread_policy_get("test_dl", &policy));
+
+  config_set_int(config, "ThreadPolicy:test_dl", "RuntimeUs", 500);
+  config_set_int(config, "ThreadPolicy:test_dl", "PeriodUs", 5000);
+  thread_policy_load(config);
+  ASSERT_TRUE(thread_policy_get("test_dl", &policy));
+  EXPECT_EQ(500u, policy.runtime_us);
+  EXPECT_EQ(5000u, policy.period_us);
+}
+
+static void expect_nice_fn(void* context) {
+  EXPECT_EQ(*(int*)context, getpriority(PRIO_PROCESS, gettid()));
+}
+
+TEST_F(ThreadPolicyTest, test_applied_to_new_thread) {
+  config_set_string(config, "ThreadPolicy:test_nice", "SchedClass", "other");
+  config_set_int(config, "ThreadPolicy:test_nice", "Priority", 5);
+  thread_policy_load(config);
+
+  thread_t* thread = thread_new("test_nice");
+  int nice = 5;
+  thread_post(thread, expect_nice_fn, &nice);
+
+  // The configured scheduling is kept
+  EXPECT_TRUE(thread_set_priority(thread, 7));
+  thread_post(thread, expect_nice_fn, &nice);
+  thread_free(thread);
+}
+
+TEST_F(ThreadPolicyTest, test_applied_to_running_thread) {
+  thread_t* thread = thread_new("test_running");
+
+  config_set_string(config, "ThreadPolicy:test_running", "SchedClass",
+                    "batch");
+  config_set_int(config, "ThreadPolicy:test_running", "Priority", 6);
+  thread_policy_load(config);
+
+  int configured_nice = 6;
+  thread_post(thread, expect_nice_fn, &configured_nice);
+  thread_free(thread);
+}
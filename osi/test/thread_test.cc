@@ -2,6 +2,7 @@
 
 #include "AllocationTestHarness.h"
 
+#include <sched.h>
 #include <sys/select.h>
 
 #include "osi/include/osi.h"
@@ -55,3 +56,21 @@ TEST_F(ThreadTest, test_thread_is_not_self) {
   EXPECT_FALSE(thread_is_self(thread));
   thread_free(thread);
 }
+
+static void thread_cpu_affinity_fn(void* context) {
+  int cpu = *(int*)context;
+  EXPECT_EQ(cpu, sched_getcpu());
+}
+
+TEST_F(ThreadTest, test_thread_set_cpu_affinity) {
+  thread_t* thread = thread_new("test_thread");
+  EXPECT_FALSE(thread_set_cpu_affinity(thread, 0));
+
+  int cpu = sched_getcpu();
+  ASSERT_GE(cpu, 0);
+  if (cpu < 64) {
+    EXPECT_TRUE(thread_set_cpu_affinity(thread, 1ULL << cpu));
+    thread_post(thread, thread_cpu_affinity_fn, &cpu);
+  }
+  thread_free(thread);
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "osi/include/trace_ring.h"
+
+static const char* TEST_TAG = "bt_test_trace_ring";
+
+// Returns the text of the dump of the trace ring
+static std::string trace_ring_dump_to_string() {
+  FILE* file = tmpfile();
+  trace_ring_debug_dump(fileno(file));
+  fflush(file);
+
+  std::string dump;
+  char buf[1024];
+  size_t len;
+  rewind(file);
+  while ((len = fread(buf, 1, sizeof(buf), file)) > 0) dump.append(buf, len);
+  fclose(file);
+  return dump;
+}
+
+// The ring is never released, so the tests share it: each test looks for
+// traces of its own.
+class TraceRingTest : public ::testing::Test {
+ protected:
+  void SetUp() override { trace_ring_init(); }
+};
+
+TEST_F(TraceRingTest, test_trace_ring_enabled) {
+  EXPECT_TRUE(trace_ring_is_enabled());
+
+  // Initializing again keeps the traces
+  trace_ring_log(TRACE_RING_INFO, TEST_TAG, "test_trace_ring_enabled");
+  trace_ring_init();
+  EXPECT_NE(std::string::npos,
+            trace_ring_dump_to_string().find("test_trace_ring_enabled"));
+}
+
+TEST_F(TraceRingTest, test_trace_ring_format_integers) {
+  int8_t i8 = -5;
+  uint16_t u16 = 65535;
+  TRACE_RING_LOG(TRACE_RING_DEBUG, TEST_TAG,
+                 "integers: %d %u %ld %llu %hhd %hu %zu 0x%04x %%", -42,
+                 4000000000u, -1234567890123L, 18446744073709551615ull, i8,
+                 u16, (size_t)7, 0xbeef);
+  std::string dump = trace_ring_dump_to_string();
+  EXPECT_NE(std::string::npos,
+            dump.find("D bt_test_trace_ring: integers: -42 4000000000 "
+                      "-1234567890123 18446744073709551615 -5 65535 7 "
+                      "0xbeef %\n"));
+}
+
+TEST_F(TraceRingTest, test_trace_ring_format_others) {
+  char str[] = "copied";
+  TRACE_RING_LOG(TRACE_RING_WARN, TEST_TAG, "others: %s %.2f %5d|%-*d| %.*s %c",
+                 str, 3.14159, 12, 4, 7, 3, "abcdef", 'z');
+  // The string arguments are copied when recorded
+  str[0] = 'X';
+  std::string dump = trace_ring_dump_to_string();
+  EXPECT_NE(std::string::npos,
+            dump.find("W bt_test_trace_ring: others: copied 3.14    12|7   | "
+                      "abc z\n"));
+}
+
+TEST_F(TraceRingTest, test_trace_ring_too_many_args) {
+  TRACE_RING_LOG(TRACE_RING_ERROR, TEST_TAG,
+                 "too_many_args: %d %d %d %d %d %d %d %d %d %d", 1, 2, 3, 4,
+                 5, 6, 7, 8, 9, 10);
+  std::string dump = trace_ring_dump_to_string();
+  EXPECT_NE(std::string::npos,
+            dump.find("too_many_args: 1 2 3 4 5 6 7 8 (...)\n"));
+}
+
+TEST_F(TraceRingTest, test_trace_ring_wrap_around) {
+  for (int i = 0; i < TRACE_RING_SIZE + 10; i++)
+    TRACE_RING_LOG(TRACE_RING_VERBOSE, TEST_TAG, "wrap_around: %d", i);
+
+  // Only the most recent traces are kept, oldest first
+  std::string dump = trace_ring_dump_to_string();
+  EXPECT_EQ(std::string::npos, dump.find("wrap_around: 9\n"));
+  size_t first = dump.find("wrap_around: 10\n");
+  size_t last = dump.find("wrap_around: 2057\n");
+  EXPECT_NE(std::string::npos, first);
+  EXPECT_NE(std::string::npos, last);
+  EXPECT_LT(first, last);
+}
@@ -23,6 +23,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "osi/include/wakelock.h"
 
@@ -67,6 +68,9 @@ class WakelockTest : public AllocationTestHarness {
 
     creat(lock_path_.c_str(), S_IRWXU);
     creat(unlock_path_.c_str(), S_IRWXU);
+
+    // Most tests check the OS wakelock right after its release
+    wakelock_set_release_delay_ms(0);
   }
 
   virtual void TearDown() {
@@ -155,3 +159,41 @@ TEST_F(WakelockTest, test_set_paths) {
     ASSERT_FALSE(IsFileWakeLockAcquired());
   }
 }
+
+TEST_F(WakelockTest, test_reasons) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+
+  ASSERT_TRUE(wakelock_acquire_reason(WAKELOCK_REASON_MEDIA));
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_TRUE(wakelock_acquire());
+  ASSERT_TRUE(wakelock_acquire_reason(WAKELOCK_REASON_MEDIA));
+
+  // Held as long as any reason holds it
+  ASSERT_TRUE(wakelock_release());
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_TRUE(wakelock_release_reason(WAKELOCK_REASON_MEDIA));
+  ASSERT_TRUE(is_wake_lock_acquired);
+  ASSERT_TRUE(wakelock_release_reason(WAKELOCK_REASON_MEDIA));
+  ASSERT_FALSE(is_wake_lock_acquired);
+
+  // Not held for the reason anymore
+  ASSERT_FALSE(wakelock_release_reason(WAKELOCK_REASON_MEDIA));
+  ASSERT_FALSE(wakelock_release_reason(WAKELOCK_REASON_HCI));
+}
+
+TEST_F(WakelockTest, test_release_delay) {
+  wakelock_set_os_callouts(&bt_wakelock_callouts);
+  wakelock_set_release_delay_ms(100);
+
+  // The release and acquire cycles within the delay keep it held
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(wakelock_acquire());
+    ASSERT_TRUE(is_wake_lock_acquired);
+    ASSERT_TRUE(wakelock_release());
+    ASSERT_TRUE(is_wake_lock_acquired);
+  }
+
+  // And it is released once the delay expires
+  sleep(1);
+  ASSERT_FALSE(is_wake_lock_acquired);
+}
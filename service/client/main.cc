@@ -286,6 +286,12 @@ class CLIBluetoothLeScannerCallback
     return Status::ok();
   }
 
+  Status OnScanResults(const std::vector<android::bluetooth::ScanResult>&
+                           scan_results) override {
+    for (const auto& scan_result : scan_results) OnScanResult(scan_result);
+    return Status::ok();
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CLIBluetoothLeScannerCallback);
 };
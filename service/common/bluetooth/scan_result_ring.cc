@@ -0,0 +1,219 @@
+//
+//  Copyright (C) 2017 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include "service/common/bluetooth/scan_result_ring.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <base/logging.h>
+
+namespace bluetooth {
+
+namespace {
+
+static_assert(sizeof(ScanResultRingHeader) == 64,
+              "The ring header layout must not change");
+static_assert(sizeof(ScanResultRingSlot) == 88,
+              "The ring slot layout must not change");
+
+// The number of times a consumer retries a slot that the daemon is writing.
+const int kMaxReadRetries = 16;
+
+uint64_t NowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+size_t RingSize(uint32_t capacity) {
+  return sizeof(ScanResultRingHeader) +
+         (size_t)capacity * sizeof(ScanResultRingSlot);
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<ScanResultRing> ScanResultRing::Create(const std::string& path,
+                                                       uint32_t capacity) {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    LOG(ERROR) << "Invalid scan result ring capacity: " << capacity;
+    return nullptr;
+  }
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to create the scan result ring " << path;
+    return nullptr;
+  }
+
+  size_t size = RingSize(capacity);
+  if (ftruncate(fd, size) < 0) {
+    PLOG(ERROR) << "Failed to size the scan result ring " << path;
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  void* memory =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map the scan result ring " << path;
+    close(fd);
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  // The file is zero-filled: construct the atomics in place, and publish the
+  // magic last so that the consumers never see a partial header.
+  ScanResultRingHeader* header = static_cast<ScanResultRingHeader*>(memory);
+  header->version = kVersion;
+  header->capacity = capacity;
+  header->slot_size = sizeof(ScanResultRingSlot);
+  new (&header->write_index) std::atomic<uint64_t>(0);
+  ScanResultRingSlot* slots = reinterpret_cast<ScanResultRingSlot*>(header + 1);
+  for (uint32_t i = 0; i < capacity; i++)
+    new (&slots[i].sequence) std::atomic<uint64_t>(0);
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+
+  return std::unique_ptr<ScanResultRing>(
+      new ScanResultRing(path, true, fd, memory, size));
+}
+
+// static
+std::unique_ptr<ScanResultRing> ScanResultRing::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open the scan result ring " << path;
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ScanResultRingHeader)) {
+    LOG(ERROR) << "Invalid scan result ring " << path;
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = st.st_size;
+  void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to map the scan result ring " << path;
+    close(fd);
+    return nullptr;
+  }
+
+  const ScanResultRingHeader* header =
+      static_cast<const ScanResultRingHeader*>(memory);
+  uint32_t capacity = header->capacity;
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->slot_size != sizeof(ScanResultRingSlot) || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0 || RingSize(capacity) > size) {
+    LOG(ERROR) << "Unsupported scan result ring " << path;
+    munmap(memory, size);
+    close(fd);
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return std::unique_ptr<ScanResultRing>(
+      new ScanResultRing(path, false, fd, memory, size));
+}
+
+ScanResultRing::ScanResultRing(const std::string& path, bool owner, int fd,
+                               void* memory, size_t size)
+    : path_(path),
+      owner_(owner),
+      fd_(fd),
+      memory_(memory),
+      size_(size),
+      header_(static_cast<ScanResultRingHeader*>(memory)) {}
+
+ScanResultRing::~ScanResultRing() {
+  munmap(memory_, size_);
+  close(fd_);
+  if (owner_) unlink(path_.c_str());
+}
+
+void ScanResultRing::Write(const uint8_t device_address[6], int rssi,
+                           const uint8_t* scan_record,
+                           size_t scan_record_length) {
+  CHECK(owner_);
+
+  uint64_t index = header_->write_index.load(std::memory_order_relaxed);
+  ScanResultRingSlot* s = slot(index);
+
+  s->sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ScanResultRingRecord* record = &s->record;
+  record->timestamp_us = NowUs();
+  memcpy(record->device_address, device_address,
+         sizeof(record->device_address));
+  record->rssi = rssi;
+  if (scan_record_length > kScanResultRingMaxRecordLength)
+    scan_record_length = kScanResultRingMaxRecordLength;
+  record->scan_record_length = scan_record_length;
+  memcpy(record->scan_record, scan_record, scan_record_length);
+
+  s->sequence.store(2 * index + 2, std::memory_order_release);
+  header_->write_index.store(index + 1, std::memory_order_release);
+}
+
+bool ScanResultRing::Read(uint64_t* index,
+                          ScanResultRingRecord* record) const {
+  for (int retry = 0; retry < kMaxReadRetries; retry++) {
+    uint64_t write_index = header_->write_index.load(std::memory_order_acquire);
+    if (*index >= write_index) return false;
+
+    // Skip the records overwritten since the last read.
+    if (write_index - *index > header_->capacity)
+      *index = write_index - header_->capacity;
+
+    const ScanResultRingSlot* s = slot(*index);
+    uint64_t sequence = s->sequence.load(std::memory_order_acquire);
+    memcpy(record, &s->record, sizeof(*record));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence == 2 * *index + 2 &&
+        s->sequence.load(std::memory_order_relaxed) == sequence) {
+      (*index)++;
+      return true;
+    }
+
+    // The daemon is overwriting the slot: retry from the new write index.
+  }
+
+  return false;
+}
+
+uint64_t ScanResultRing::write_index() const {
+  return header_->write_index.load(std::memory_order_acquire);
+}
+
+ScanResultRingSlot* ScanResultRing::slot(uint64_t index) const {
+  ScanResultRingSlot* slots =
+      reinterpret_cast<ScanResultRingSlot*>(header_ + 1);
+  return &slots[index & (header_->capacity - 1)];
+}
+
+}  // namespace bluetooth
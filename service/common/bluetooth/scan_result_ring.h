@@ -0,0 +1,127 @@
+//
+//  Copyright (C) 2017 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <base/macros.h>
+
+namespace bluetooth {
+
+// The maximum length of the advertising and scan response data of a record.
+const size_t kScanResultRingMaxRecordLength = 62;
+
+// A single scan result, as laid out in the ring.
+struct ScanResultRingRecord {
+  // The CLOCK_BOOTTIME time at which the daemon received the result.
+  uint64_t timestamp_us;
+
+  // The BD_ADDR of the remote device, most significant byte first.
+  uint8_t device_address[6];
+
+  int8_t rssi;
+
+  // The number of valid bytes in |scan_record|.
+  uint8_t scan_record_length;
+  uint8_t scan_record[kScanResultRingMaxRecordLength];
+  uint8_t reserved[2];
+};
+
+// A slot of the ring. |sequence| is odd while the daemon writes the slot,
+// and 2 * (index + 1) once the record of |index| is complete.
+struct ScanResultRingSlot {
+  std::atomic<uint64_t> sequence;
+  ScanResultRingRecord record;
+};
+
+// The header at the start of the shared memory. |write_index| is the number
+// of records written so far.
+struct ScanResultRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t slot_size;
+  std::atomic<uint64_t> write_index;
+  uint8_t reserved[40];
+};
+
+// ScanResultRing is a shared-memory transport for the LE scan results, for
+// the high-volume consumers on the same device: the daemon writes every scan
+// result into a memory-mapped file, and the clients map the same file and
+// poll it, with no per-result IPC.
+//
+// The ring has a single producer and never waits for the consumers: each
+// consumer keeps its own read index, and loses the records that were
+// overwritten before it read them.
+class ScanResultRing final {
+ public:
+  static const uint32_t kMagic = 0x53525247;  // "SRRG"
+  static const uint32_t kVersion = 1;
+
+  // Creates the ring file at |path|, with room for |capacity| records, which
+  // must be a power of two. Returns nullptr on failure. The file is removed
+  // when the returned ring is destroyed.
+  static std::unique_ptr<ScanResultRing> Create(const std::string& path,
+                                                uint32_t capacity);
+
+  // Maps the ring file created by the daemon at |path| for reading. Returns
+  // nullptr on failure.
+  static std::unique_ptr<ScanResultRing> Open(const std::string& path);
+
+  ~ScanResultRing();
+
+  // Writes a scan result into the ring, overwriting the oldest one if the ring
+  // is full. |scan_record| is truncated to kScanResultRingMaxRecordLength
+  // bytes. Must only be called on a ring obtained with Create, and from one
+  // thread at a time.
+  void Write(const uint8_t device_address[6], int rssi,
+             const uint8_t* scan_record, size_t scan_record_length);
+
+  // Reads the record of |*index| into |record| and advances |*index|.
+  // Returns false if no record was written at |*index| yet. If the consumer
+  // fell behind by more than the capacity, |*index| first skips the
+  // overwritten records.
+  bool Read(uint64_t* index, ScanResultRingRecord* record) const;
+
+  // Returns the index of the next record to be written. A consumer that
+  // starts at this index only reads the records written from now on.
+  uint64_t write_index() const;
+
+  uint32_t capacity() const { return header_->capacity; }
+
+ private:
+  ScanResultRing(const std::string& path, bool owner, int fd, void* memory,
+                 size_t size);
+
+  ScanResultRingSlot* slot(uint64_t index) const;
+
+  std::string path_;
+  bool owner_;
+  int fd_;
+  void* memory_;
+  size_t size_;
+  ScanResultRingHeader* header_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultRing);
+};
+
+}  // namespace bluetooth
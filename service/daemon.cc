@@ -21,6 +21,7 @@
 #include <base/logging.h>
 
 #include "service/adapter.h"
+#include "service/common/bluetooth/scan_result_ring.h"
 #include "service/hal/bluetooth_gatt_interface.h"
 #include "service/hal/bluetooth_interface.h"
 #include "service/ipc/ipc_manager.h"
@@ -33,6 +34,9 @@ namespace {
 // The global Daemon instance.
 Daemon* g_daemon = nullptr;
 
+// The number of scan results kept in the scan result ring.
+const uint32_t kScanResultRingCapacity = 1024;
+
 class DaemonImpl : public Daemon {
  public:
   DaemonImpl() : initialized_(false) {}
@@ -94,6 +98,17 @@ class DaemonImpl : public Daemon {
     return true;
   }
 
+  void SetUpScanResultRing() {
+    auto ring = ScanResultRing::Create(
+        settings_->scan_result_ring_path().value(), kScanResultRingCapacity);
+    if (!ring) {
+      LOG(ERROR) << "Failed to set up the scan result ring";
+      return;
+    }
+
+    adapter_->GetLeScannerFactory()->SetScanResultRing(std::move(ring));
+  }
+
   bool Init() override {
     CHECK(!initialized_);
     message_loop_.reset(new base::MessageLoop());
@@ -110,6 +125,7 @@ class DaemonImpl : public Daemon {
     }
 
     adapter_ = Adapter::Create();
+    if (!settings_->scan_result_ring_path().empty()) SetUpScanResultRing();
     ipc_manager_.reset(new ipc::IPCManager(adapter_.get()));
 
     if (!SetUpIPC()) {
@@ -16,9 +16,12 @@
 
 #include "service/ipc/binder/bluetooth_le_scanner_binder_server.h"
 
+#include <base/bind.h>
 #include <base/logging.h>
+#include <base/message_loop/message_loop.h>
 
 #include "service/adapter.h"
+#include "service/daemon.h"
 
 using android::String8;
 using android::String16;
@@ -29,11 +32,18 @@ namespace binder {
 
 namespace {
 const int kInvalidInstanceId = -1;
+
+// The number of batched scan results that are flushed without waiting for
+// the report delay, to bound the size of a single transaction.
+const size_t kMaxScanResultBatchSize = 64;
 }  // namespace
 
 BluetoothLeScannerBinderServer::BluetoothLeScannerBinderServer(
     bluetooth::Adapter* adapter)
-    : adapter_(adapter) {
+    : adapter_(adapter),
+      task_runner_(
+          bluetooth::Daemon::Get()->GetMessageLoop()->task_runner()),
+      weak_ptr_factory_(this) {
   CHECK(adapter_);
 }
 
@@ -53,12 +63,15 @@ Status BluetoothLeScannerBinderServer::RegisterScanner(
 Status BluetoothLeScannerBinderServer::UnregisterScanner(int scanner_id) {
   VLOG(2) << __func__;
   UnregisterInstanceBase(scanner_id);
+  ClearScanResults(scanner_id);
   return Status::ok();
 }
 
 Status BluetoothLeScannerBinderServer::UnregisterAll() {
   VLOG(2) << __func__;
   UnregisterAllBase();
+  std::lock_guard<std::mutex> lock(pending_results_lock_);
+  pending_results_.clear();
   return Status::ok();
 }
 
@@ -98,15 +111,34 @@ Status BluetoothLeScannerBinderServer::StopScan(int scanner_id,
   }
 
   *_aidl_return = scanner->StopScan();
+  ClearScanResults(scanner_id);
   return Status::ok();
 }
 
 void BluetoothLeScannerBinderServer::OnScanResult(
     bluetooth::LowEnergyScanner* scanner, const bluetooth::ScanResult& result) {
   VLOG(2) << __func__;
+  int scanner_id = scanner->GetInstanceId();
+
+  // Batch the results of the scans with a report delay: they are sent from
+  // the main loop once the delay expires, or once the batch is full.
+  base::TimeDelta report_delay = scanner->scan_settings().report_delay();
+  if (report_delay > base::TimeDelta()) {
+    std::lock_guard<std::mutex> lock(pending_results_lock_);
+    auto& results = pending_results_[scanner_id];
+    results.push_back(result);
+    base::Closure flush =
+        base::Bind(&BluetoothLeScannerBinderServer::FlushScanResults,
+                   weak_ptr_factory_.GetWeakPtr(), scanner_id);
+    if (results.size() == 1)
+      task_runner_->PostDelayedTask(FROM_HERE, flush, report_delay);
+    else if (results.size() == kMaxScanResultBatchSize)
+      task_runner_->PostTask(FROM_HERE, flush);
+    return;
+  }
+
   std::lock_guard<std::mutex> lock(*maps_lock());
 
-  int scanner_id = scanner->GetInstanceId();
   auto cb = GetLECallback(scanner->GetInstanceId());
   if (!cb.get()) {
     VLOG(2) << "Scanner was unregistered - scanner_id: " << scanner_id;
@@ -116,6 +148,33 @@ void BluetoothLeScannerBinderServer::OnScanResult(
   cb->OnScanResult(result);
 }
 
+void BluetoothLeScannerBinderServer::FlushScanResults(int scanner_id) {
+  std::vector<android::bluetooth::ScanResult> results;
+  {
+    std::lock_guard<std::mutex> lock(pending_results_lock_);
+    auto iter = pending_results_.find(scanner_id);
+    if (iter == pending_results_.end()) return;  // Already flushed or cleared
+    results.swap(iter->second);
+    pending_results_.erase(iter);
+  }
+
+  VLOG(2) << __func__ << " scanner_id: " << scanner_id
+          << " results: " << results.size();
+  std::lock_guard<std::mutex> lock(*maps_lock());
+  auto cb = GetLECallback(scanner_id);
+  if (!cb.get()) {
+    VLOG(2) << "Scanner was unregistered - scanner_id: " << scanner_id;
+    return;
+  }
+
+  cb->OnScanResults(results);
+}
+
+void BluetoothLeScannerBinderServer::ClearScanResults(int scanner_id) {
+  std::lock_guard<std::mutex> lock(pending_results_lock_);
+  pending_results_.erase(scanner_id);
+}
+
 android::sp<IBluetoothLeScannerCallback>
 BluetoothLeScannerBinderServer::GetLECallback(int scanner_id) {
   auto cb = GetCallback(scanner_id);
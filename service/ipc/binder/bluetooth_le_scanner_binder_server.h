@@ -17,8 +17,14 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <base/macros.h>
+#include <base/memory/ref_counted.h>
+#include <base/memory/weak_ptr.h>
+#include <base/single_thread_task_runner.h>
 
 #include <android/bluetooth/IBluetoothLeScannerCallback.h>
 #include "android/bluetooth/BnBluetoothLeScanner.h"
@@ -73,6 +79,14 @@ class BluetoothLeScannerBinderServer
   // |scanner_id|. Returns NULL if such a scanner cannot be found.
   std::shared_ptr<bluetooth::LowEnergyScanner> GetLEScanner(int scanner_id);
 
+  // Sends the scan results batched for |scanner_id| to its callback in a
+  // single OnScanResults call. Runs on the daemon's main loop, so that the
+  // HAL callback thread never makes a binder call for a batched scan.
+  void FlushScanResults(int scanner_id);
+
+  // Drops the scan results batched for |scanner_id|.
+  void ClearScanResults(int scanner_id);
+
   // InterfaceWithInstancesBase override:
   void OnRegisterInstanceImpl(bluetooth::BLEStatus status,
                               android::sp<IInterface> callback,
@@ -80,6 +94,20 @@ class BluetoothLeScannerBinderServer
 
   bluetooth::Adapter* adapter_;  // weak
 
+  // The daemon's main loop, on which the batched scan results are flushed.
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+
+  // The scan results not yet sent, for the scanners whose scan settings have
+  // a non-zero report delay. A flush is pending on |task_runner_| for every
+  // scanner with an entry in this map.
+  std::mutex pending_results_lock_;
+  std::unordered_map<int, std::vector<android::bluetooth::ScanResult>>
+      pending_results_;
+
+  // Keep this as the last member so that the weak pointers are invalidated
+  // before the other members are destroyed.
+  base::WeakPtrFactory<BluetoothLeScannerBinderServer> weak_ptr_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(BluetoothLeScannerBinderServer);
 };
 
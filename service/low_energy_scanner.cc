@@ -41,7 +41,7 @@ const size_t kScanRecordLength = 62;
 // Returns the length of the given scan record array. We have to calculate this
 // based on the maximum possible data length and the TLV data. See TODO above
 // |kScanRecordLength|.
-size_t GetScanRecordLength(std::vector<uint8_t> bytes) {
+size_t GetScanRecordLength(const std::vector<uint8_t>& bytes) {
   for (size_t i = 0, field_len = 0; i < kScanRecordLength;
        i += (field_len + 1)) {
     field_len = bytes[i];
@@ -111,6 +111,7 @@ bool LowEnergyScanner::StartScan(const ScanSettings& settings,
     return false;
   }
 
+  scan_settings_ = settings;
   scan_started_ = true;
   return true;
 }
@@ -170,6 +171,12 @@ LowEnergyScannerFactory::~LowEnergyScannerFactory() {
   hal::BluetoothGattInterface::Get()->RemoveScannerObserver(this);
 }
 
+void LowEnergyScannerFactory::SetScanResultRing(
+    std::unique_ptr<ScanResultRing> ring) {
+  lock_guard<mutex> lock(scan_result_ring_lock_);
+  scan_result_ring_ = std::move(ring);
+}
+
 bool LowEnergyScannerFactory::RegisterInstance(
     const UUID& uuid, const RegisterCallback& callback) {
   VLOG(1) << __func__ << " - UUID: " << uuid.ToString();
@@ -224,4 +231,16 @@ void LowEnergyScannerFactory::RegisterScannerCallback(
   pending_calls_.erase(iter);
 }
 
+void LowEnergyScannerFactory::ScanResultCallback(
+    hal::BluetoothGattInterface* /* gatt_iface */, const bt_bdaddr_t& bda,
+    int rssi, std::vector<uint8_t> adv_data) {
+  // The HAL reports each result once to all the observers: write it to the
+  // ring here rather than in every scanning LowEnergyScanner.
+  lock_guard<mutex> lock(scan_result_ring_lock_);
+  if (!scan_result_ring_) return;
+
+  size_t record_len = GetScanRecordLength(adv_data);
+  scan_result_ring_->Write(bda.address, rssi, adv_data.data(), record_len);
+}
+
 }  // namespace bluetooth
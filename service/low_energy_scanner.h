@@ -19,6 +19,7 @@
 #include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 
 #include <base/macros.h>
@@ -29,6 +30,7 @@
 #include "service/common/bluetooth/low_energy_constants.h"
 #include "service/common/bluetooth/scan_filter.h"
 #include "service/common/bluetooth/scan_result.h"
+#include "service/common/bluetooth/scan_result_ring.h"
 #include "service/common/bluetooth/scan_settings.h"
 #include "service/common/bluetooth/uuid.h"
 #include "service/hal/bluetooth_gatt_interface.h"
@@ -140,6 +142,10 @@ class LowEnergyScannerFactory
   bool RegisterInstance(const UUID& app_uuid,
                         const RegisterCallback& callback) override;
 
+  // Writes all the scan results reported by the HAL into |ring| from now on,
+  // replacing the previous ring if any. Passing nullptr stops the writes.
+  void SetScanResultRing(std::unique_ptr<ScanResultRing> ring);
+
  private:
   friend class LowEnergyScanner;
 
@@ -147,11 +153,18 @@ class LowEnergyScannerFactory
   void RegisterScannerCallback(const RegisterCallback& callback,
                                const UUID& app_uuid, uint8_t scanner_id,
                                uint8_t status);
+  void ScanResultCallback(hal::BluetoothGattInterface* gatt_iface,
+                          const bt_bdaddr_t& bda, int rssi,
+                          std::vector<uint8_t> adv_data) override;
 
   // Map of pending calls to register.
   std::mutex pending_calls_lock_;
   std::unordered_set<UUID> pending_calls_;
 
+  // The shared-memory ring that the scan results are written to, if any.
+  std::mutex scan_result_ring_lock_;
+  std::unique_ptr<ScanResultRing> scan_result_ring_;
+
   // Raw pointer to the Adapter that owns this factory.
   Adapter& adapter_;
 
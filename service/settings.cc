@@ -54,6 +54,16 @@ bool Settings::Init() {
       }
 
       android_ipc_socket_suffix_ = suffix;
+    } else if (iter.first == switches::kScanResultRingPath) {
+      // kScanResultRingPath: An optional argument that makes the daemon write
+      // the LE scan results into a shared-memory ring at this path.
+      base::FilePath path(iter.second);
+      if (path.empty() || path.EndsWithSeparator()) {
+        LOG(ERROR) << "Invalid scan result ring path";
+        return false;
+      }
+
+      scan_result_ring_path_ = path;
     }
     // Check for libbase logging switches. These get processed by
     // logging::InitLogging directly.
@@ -53,6 +53,12 @@ class Settings {
     return create_ipc_socket_path_;
   }
 
+  // Path of the shared-memory ring that the LE scan results are written to.
+  // Empty if the ring is disabled.
+  const base::FilePath& scan_result_ring_path() const {
+    return scan_result_ring_path_;
+  }
+
   // Returns true if domain-socket based IPC should be used. If false, then
   // Binder IPC must be used.
   inline bool UseSocketIPC() const {
@@ -64,6 +70,7 @@ class Settings {
   bool initialized_;
   std::string android_ipc_socket_suffix_;
   base::FilePath create_ipc_socket_path_;
+  base::FilePath scan_result_ring_path_;
 
   DISALLOW_COPY_AND_ASSIGN(Settings);
 };
@@ -26,6 +26,7 @@ const char kHelpLong[] = "help";
 const char kHelpShort[] = "h";
 const char kAndroidIPCSocketSuffix[] = "android-ipc-socket-suffix";
 const char kCreateIPCSocketPath[] = "create-ipc-socket";
+const char kScanResultRingPath[] = "scan-result-ring";
 
 const char kHelpMessage[] =
     "\nBluetooth System Service\n"
@@ -36,6 +37,10 @@ const char kHelpMessage[] =
     "Mutually exclusive with --create-ipc-socket.\n"
     "\t--create-ipc-socket\t\tSocket path created for Unix domain socket based "
     "IPC. Mutually exclusive with --android-ipc-socket-suffix.\n"
+    "\t--scan-result-ring\t\tFile path of a shared-memory ring that all the "
+    "LE scan results are written to, for local clients to map.\n"
+    "\t--hci\t\t\t\tController to use on Linux (e.g. --hci=1 or "
+    "--hci=hci1), overriding bluetooth.interface.\n"
     "\t--v\t\t\t\tLog verbosity level (e.g. -v=1)\n";
 
 }  // namespace switches
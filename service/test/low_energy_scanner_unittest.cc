@@ -282,8 +282,10 @@ TEST_F(LowEnergyScannerPostRegisterTest, ScanSettings) {
   // implemented
 
   // These should succeed and result in a HAL call
+  settings.set_report_delay(base::TimeDelta::FromMilliseconds(500));
   EXPECT_CALL(*mock_handler_, Scan(true)).Times(1).WillOnce(Return());
   EXPECT_TRUE(le_scanner_->StartScan(settings, filters));
+  EXPECT_EQ(settings, le_scanner_->scan_settings());
 
   // These should succeed and result in a HAL call
   EXPECT_CALL(*mock_handler_, Scan(false)).Times(1).WillOnce(Return());
@@ -0,0 +1,132 @@
+//
+//  Copyright (C) 2017 The Android Open Source Project
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at:
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "service/common/bluetooth/scan_result_ring.h"
+
+namespace bluetooth {
+namespace {
+
+const uint8_t kTestAddress[6] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC};
+const uint8_t kTestScanRecord[] = {0x02, 0x01, 0x06, 0x03, 0x09, 'h', 'r'};
+
+class ScanResultRingTest : public ::testing::Test {
+ public:
+  ScanResultRingTest() = default;
+  ~ScanResultRingTest() override = default;
+
+  void SetUp() override {
+#if defined(OS_GENERIC)
+    path_ = "/tmp/scan_result_ring_test.";
+#else
+    path_ = "/data/local/tmp/scan_result_ring_test.";
+#endif  // !defined(OS_GENERIC)
+    path_ += std::to_string(getpid());
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+ protected:
+  std::string path_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScanResultRingTest);
+};
+
+TEST_F(ScanResultRingTest, InvalidCapacity) {
+  EXPECT_EQ(nullptr, ScanResultRing::Create(path_, 0));
+  EXPECT_EQ(nullptr, ScanResultRing::Create(path_, 3));
+}
+
+TEST_F(ScanResultRingTest, OpenMissingRing) {
+  EXPECT_EQ(nullptr, ScanResultRing::Open(path_));
+}
+
+TEST_F(ScanResultRingTest, WriteAndRead) {
+  auto producer = ScanResultRing::Create(path_, 4);
+  ASSERT_NE(nullptr, producer);
+  auto consumer = ScanResultRing::Open(path_);
+  ASSERT_NE(nullptr, consumer);
+  EXPECT_EQ(4U, consumer->capacity());
+
+  uint64_t index = consumer->write_index();
+  ScanResultRingRecord record;
+  EXPECT_FALSE(consumer->Read(&index, &record));
+
+  producer->Write(kTestAddress, -42, kTestScanRecord, sizeof(kTestScanRecord));
+  ASSERT_TRUE(consumer->Read(&index, &record));
+  EXPECT_EQ(1U, index);
+  EXPECT_EQ(0, memcmp(kTestAddress, record.device_address, 6));
+  EXPECT_EQ(-42, record.rssi);
+  ASSERT_EQ(sizeof(kTestScanRecord), record.scan_record_length);
+  EXPECT_EQ(0, memcmp(kTestScanRecord, record.scan_record,
+                      sizeof(kTestScanRecord)));
+  EXPECT_NE(0U, record.timestamp_us);
+
+  EXPECT_FALSE(consumer->Read(&index, &record));
+}
+
+TEST_F(ScanResultRingTest, TruncatedScanRecord) {
+  auto producer = ScanResultRing::Create(path_, 4);
+  ASSERT_NE(nullptr, producer);
+  auto consumer = ScanResultRing::Open(path_);
+  ASSERT_NE(nullptr, consumer);
+
+  uint8_t scan_record[kScanResultRingMaxRecordLength + 10];
+  memset(scan_record, 0xAA, sizeof(scan_record));
+  producer->Write(kTestAddress, 0, scan_record, sizeof(scan_record));
+
+  uint64_t index = 0;
+  ScanResultRingRecord record;
+  ASSERT_TRUE(consumer->Read(&index, &record));
+  EXPECT_EQ(kScanResultRingMaxRecordLength, record.scan_record_length);
+}
+
+TEST_F(ScanResultRingTest, ConsumerOverrun) {
+  auto producer = ScanResultRing::Create(path_, 4);
+  ASSERT_NE(nullptr, producer);
+  auto consumer = ScanResultRing::Open(path_);
+  ASSERT_NE(nullptr, consumer);
+
+  for (int i = 0; i < 10; i++)
+    producer->Write(kTestAddress, -i, kTestScanRecord, sizeof(kTestScanRecord));
+
+  // The first six records were overwritten: the read index skips them.
+  uint64_t index = 0;
+  ScanResultRingRecord record;
+  for (int i = 6; i < 10; i++) {
+    ASSERT_TRUE(consumer->Read(&index, &record));
+    EXPECT_EQ(-i, record.rssi);
+    EXPECT_EQ((uint64_t)i + 1, index);
+  }
+  EXPECT_FALSE(consumer->Read(&index, &record));
+}
+
+TEST_F(ScanResultRingTest, RingRemovedWithProducer) {
+  auto producer = ScanResultRing::Create(path_, 4);
+  ASSERT_NE(nullptr, producer);
+  producer.reset();
+  EXPECT_NE(0, access(path_.c_str(), F_OK));
+}
+
+}  // namespace
+}  // namespace bluetooth
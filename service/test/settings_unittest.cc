@@ -97,4 +97,13 @@ TEST_F(SettingsTest, GoodArgumentsAndroidIpc) {
   EXPECT_TRUE(settings_.Init());
 }
 
+TEST_F(SettingsTest, GoodArgumentsScanResultRing) {
+  const base::CommandLine::CharType* argv[] = {
+      "program", "--scan-result-ring=/dev/shm/bt_scan_results"};
+  EXPECT_TRUE(base::CommandLine::Init(arraysize(argv), argv));
+  EXPECT_TRUE(settings_.Init());
+  EXPECT_EQ("/dev/shm/bt_scan_results",
+            settings_.scan_result_ring_path().value());
+}
+
 }  // namespace
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_aac_abr"
+
+#include "a2dp_aac_abr.h"
+
+#include <string.h>
+
+#include "osi/include/log.h"
+
+//
+// AAC ABR(Adaptive Bit Rate) Source Code
+//
+
+static void a2dp_aac_abr_set_bit_rate(tA2DP_AAC_ABR* p_abr, uint64_t now_us,
+                                      uint32_t bit_rate) {
+  if (bit_rate < p_abr->min_bit_rate) bit_rate = p_abr->min_bit_rate;
+  if (bit_rate > p_abr->max_bit_rate) bit_rate = p_abr->max_bit_rate;
+  if (bit_rate == p_abr->bit_rate) return;
+
+  LOG_DEBUG(LOG_TAG, "%s: bit rate %u -> %u (queue delay %llu ms)", __func__,
+            p_abr->bit_rate, bit_rate,
+            (unsigned long long)p_abr->last_queue_delay_us / 1000);
+  p_abr->bit_rate = bit_rate;
+  p_abr->last_adjustment_us = now_us;
+  p_abr->adjustments++;
+}
+
+void a2dp_aac_abr_init(tA2DP_AAC_ABR* p_abr, uint32_t min_bit_rate,
+                       uint32_t max_bit_rate) {
+  memset(p_abr, 0, sizeof(*p_abr));
+  if (min_bit_rate > max_bit_rate) min_bit_rate = max_bit_rate;
+  p_abr->min_bit_rate = min_bit_rate;
+  p_abr->max_bit_rate = max_bit_rate;
+  p_abr->bit_rate = max_bit_rate;
+}
+
+uint32_t a2dp_aac_abr_proc(tA2DP_AAC_ABR* p_abr, uint64_t now_us,
+                           uint64_t queue_delay_us, bool is_congested) {
+  p_abr->last_queue_delay_us = queue_delay_us;
+
+  if (queue_delay_us >= A2DP_AAC_ABR_DELAY_CRITICAL_US) {
+    // The link cannot keep up at all: drop to the lowest bit rate right away
+    p_abr->clear_since_us = 0;
+    a2dp_aac_abr_set_bit_rate(p_abr, now_us, p_abr->min_bit_rate);
+  } else if (is_congested || queue_delay_us >= A2DP_AAC_ABR_DELAY_HIGH_US) {
+    // Cut the bit rate, giving the previous cut time to drain the queue
+    p_abr->clear_since_us = 0;
+    if (now_us - p_abr->last_adjustment_us >=
+        A2DP_AAC_ABR_STEP_DOWN_INTERVAL_US) {
+      uint64_t bit_rate = (uint64_t)p_abr->bit_rate *
+                          A2DP_AAC_ABR_STEP_DOWN_PERCENT / 100;
+      a2dp_aac_abr_set_bit_rate(p_abr, now_us, (uint32_t)bit_rate);
+    }
+  } else if (queue_delay_us <= A2DP_AAC_ABR_DELAY_LOW_US) {
+    // Step up only after the link has been clear for a while
+    if (p_abr->clear_since_us == 0) p_abr->clear_since_us = now_us;
+    if (now_us - p_abr->clear_since_us >= A2DP_AAC_ABR_STEP_UP_INTERVAL_US &&
+        now_us - p_abr->last_adjustment_us >=
+            A2DP_AAC_ABR_STEP_UP_INTERVAL_US) {
+      a2dp_aac_abr_set_bit_rate(
+          p_abr, now_us, p_abr->bit_rate + A2DP_AAC_ABR_STEP_UP_BIT_RATE);
+      p_abr->clear_since_us = now_us;
+    }
+  } else {
+    // Between the thresholds: keep the current bit rate
+    p_abr->clear_since_us = 0;
+  }
+
+  return p_abr->bit_rate;
+}
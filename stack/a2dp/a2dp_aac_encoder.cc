@@ -26,6 +26,8 @@
 #include <base/logging.h>
 
 #include "a2dp_aac.h"
+#include "a2dp_aac_abr.h"
+#include "a2dp_pacing.h"
 #include "bt_common.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -54,9 +56,7 @@ typedef struct {
 } tA2DP_AAC_ENCODER_PARAMS;
 
 typedef struct {
-  uint32_t counter;
-  uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
-  uint64_t last_frame_us;
+  tA2DP_PACING pacing; /* pcm bytes to read each media task tick */
 } tA2DP_AAC_FEEDING_STATE;
 
 typedef struct {
@@ -85,6 +85,9 @@ typedef struct {
   HANDLE_AACENCODER aac_handle;
   bool has_aac_handle;  // True if aac_handle is valid
 
+  tA2DP_AAC_ABR aac_abr;
+  bool has_aac_abr;  // True if the bit rate is adapted by |aac_abr|
+
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_AAC_ENCODER_PARAMS aac_encoder_params;
   tA2DP_AAC_FEEDING_STATE aac_feeding_state;
@@ -181,7 +184,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
       &a2dp_aac_encoder_cb.aac_encoder_params;
   uint8_t codec_info[AVDT_CODEC_SIZE];
   AACENC_ERROR aac_error;
-  int aac_param_value, aac_sampling_freq, aac_peak_bit_rate;
+  int aac_param_value, aac_sampling_freq, aac_peak_bit_rate, aac_bit_rate;
 
   *p_restart_input = false;
   *p_restart_output = false;
@@ -333,6 +336,7 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
               __func__, aac_param_value, aac_error);
     return;  // TODO: Return an error?
   }
+  aac_bit_rate = aac_param_value;  // Save for the ABR below
 
   // Set the encoder's parameters: PEAK Bit Rate
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
@@ -386,14 +390,17 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
   }
 
   // Set the encoder's parameters: Variable Bit Rate Support
-  aac_param_value = A2DP_GetVariableBitRateSupportAac(p_codec_info);
-  if (aac_param_value == -1) {
+  // The peer supporting VBR only allows the bit rate to vary: the encoder
+  // stays in CBR mode, which keeps each frame within the peak bit rate
+  // derived from the MTU, and the ABR below varies the bit rate instead.
+  if (A2DP_GetVariableBitRateSupportAac(p_codec_info) == -1) {
     LOG_ERROR(LOG_TAG,
               "%s: Cannot set AAC parameter AACENC_BITRATEMODE: "
               "invalid codec bit rate mode",
               __func__);
     return;  // TODO: Return an error?
   }
+  aac_param_value = 0;  // CBR
   aac_error = aacEncoder_SetParam(a2dp_aac_encoder_cb.aac_handle,
                                   AACENC_BITRATEMODE, aac_param_value);
   if (aac_error != AACENC_OK) {
@@ -432,6 +439,11 @@ static void a2dp_aac_encoder_update(uint16_t peer_mtu,
             __func__, p_encoder_params->frame_length,
             p_encoder_params->input_channels_n,
             p_encoder_params->max_encoded_buffer_bytes);
+
+  // The ABR starts from the configured bit rate, and never goes above it
+  a2dp_aac_abr_init(&a2dp_aac_encoder_cb.aac_abr, A2DP_AAC_ABR_MIN_BIT_RATE,
+                    aac_bit_rate);
+  a2dp_aac_encoder_cb.has_aac_abr = true;
 }
 
 void a2dp_aac_encoder_cleanup(void) {
@@ -445,19 +457,19 @@ void a2dp_aac_feeding_reset(void) {
   memset(&a2dp_aac_encoder_cb.aac_feeding_state, 0,
          sizeof(a2dp_aac_encoder_cb.aac_feeding_state));
 
-  a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick =
-      (a2dp_aac_encoder_cb.feeding_params.sample_rate *
-       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_aac_encoder_cb.feeding_params.channel_count *
-       A2DP_AAC_ENCODER_INTERVAL_MS) /
-      1000;
+  a2dp_pacing_init(&a2dp_aac_encoder_cb.aac_feeding_state.pacing,
+                   a2dp_aac_encoder_cb.feeding_params.sample_rate *
+                       a2dp_aac_encoder_cb.feeding_params.bits_per_sample / 8 *
+                       a2dp_aac_encoder_cb.feeding_params.channel_count,
+                   A2DP_AAC_ENCODER_INTERVAL_MS * 1000);
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick);
+            a2dp_pacing_get_bytes_per_tick(
+                &a2dp_aac_encoder_cb.aac_feeding_state.pacing));
 }
 
 void a2dp_aac_feeding_flush(void) {
-  a2dp_aac_encoder_cb.aac_feeding_state.counter = 0;
+  a2dp_pacing_flush(&a2dp_aac_encoder_cb.aac_feeding_state.pacing);
 }
 
 period_ms_t a2dp_aac_get_encoder_interval_ms(void) {
@@ -496,19 +508,11 @@ static void a2dp_aac_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
-  uint32_t us_this_tick = A2DP_AAC_ENCODER_INTERVAL_MS * 1000;
-  uint64_t now_us = timestamp_us;
-  if (a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us != 0)
-    us_this_tick =
-        (now_us - a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us);
-  a2dp_aac_encoder_cb.aac_feeding_state.last_frame_us = now_us;
-
-  a2dp_aac_encoder_cb.aac_feeding_state.counter +=
-      a2dp_aac_encoder_cb.aac_feeding_state.bytes_per_tick * us_this_tick /
-      (A2DP_AAC_ENCODER_INTERVAL_MS * 1000);
-
-  result = a2dp_aac_encoder_cb.aac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_aac_encoder_cb.aac_feeding_state.counter -= result * pcm_bytes_per_frame;
+  result =
+      a2dp_pacing_update(&a2dp_aac_encoder_cb.aac_feeding_state.pacing,
+                         timestamp_us, pcm_bytes_per_frame);
+  a2dp_pacing_consume(&a2dp_aac_encoder_cb.aac_feeding_state.pacing, result,
+                      pcm_bytes_per_frame);
   nof = result;
 
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
@@ -568,7 +572,8 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
   int written = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(
+        BT_DEFAULT_BUFFER_SIZE, OSI_MEM_A2DP);
     p_buf->offset = A2DP_AAC_OFFSET;
     p_buf->len = 0;
     p_buf->layer_specific = 0;
@@ -606,10 +611,10 @@ static void a2dp_aac_encode_frames(uint8_t nb_frame) {
         p_buf->layer_specific++;  // added a frame to the buffer
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_aac_encoder_cb.aac_feeding_state.counter +=
-            nb_frame * p_encoder_params->frame_length *
-            p_feeding_params->channel_count *
-            p_feeding_params->bits_per_sample / 8;
+        a2dp_pacing_credit(&a2dp_aac_encoder_cb.aac_feeding_state.pacing,
+                           nb_frame * p_encoder_params->frame_length *
+                               p_feeding_params->channel_count *
+                               p_feeding_params->bits_per_sample / 8);
 
         // no more pcm to read
         nb_frame = 0;
@@ -669,6 +674,33 @@ period_ms_t A2dpCodecConfigAac::encoderIntervalMs() const {
   return a2dp_aac_get_encoder_interval_ms();
 }
 
+void a2dp_aac_set_transmit_queue_delay(uint64_t queue_delay_us,
+                                       bool is_congested) {
+  if (!a2dp_aac_encoder_cb.has_aac_abr) return;
+
+  tA2DP_AAC_ABR* p_abr = &a2dp_aac_encoder_cb.aac_abr;
+  uint32_t prev_bit_rate = p_abr->bit_rate;
+  uint32_t bit_rate = a2dp_aac_abr_proc(p_abr, time_get_os_boottime_us(),
+                                        queue_delay_us, is_congested);
+  if (bit_rate == prev_bit_rate) return;
+
+  // The encoder applies the new bit rate from the next frame, without being
+  // reopened.
+  AACENC_ERROR aac_error = aacEncoder_SetParam(
+      a2dp_aac_encoder_cb.aac_handle, AACENC_BITRATE, bit_rate);
+  if (aac_error != AACENC_OK) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot set AAC parameter AACENC_BITRATE to %u: "
+              "AAC error 0x%x",
+              __func__, bit_rate, aac_error);
+    p_abr->bit_rate = prev_bit_rate;
+    return;
+  }
+  LOG_DEBUG(LOG_TAG, "%s: ABR bit rate %u -> %u (queue delay %llu ms)",
+            __func__, prev_bit_rate, bit_rate,
+            (unsigned long long)queue_delay_us / 1000);
+}
+
 void A2dpCodecConfigAac::debug_codec_dump(int fd) {
   a2dp_aac_encoder_stats_t* stats = &a2dp_aac_encoder_cb.stats;
 
@@ -691,4 +723,15 @@ void A2dpCodecConfigAac::debug_codec_dump(int fd) {
           "%zu\n",
           stats->media_read_total_expected_read_bytes,
           stats->media_read_total_actual_read_bytes);
+
+  if (a2dp_aac_encoder_cb.has_aac_abr) {
+    dprintf(fd,
+            "  AAC adaptive bit rate (current/max)                     : %u / "
+            "%u\n",
+            a2dp_aac_encoder_cb.aac_abr.bit_rate,
+            a2dp_aac_encoder_cb.aac_abr.max_bit_rate);
+    dprintf(fd,
+            "  AAC adaptive bit rate adjustments                       : %zu\n",
+            a2dp_aac_encoder_cb.aac_abr.adjustments);
+  }
 }
@@ -33,11 +33,31 @@
 #include "a2dp_vendor_ldac.h"
 #include "a2dp_vendor_lhdc.h"
 #include "a2dp_vendor_lhdc_ll.h"
+#include "bt_common.h"
 #include "osi/include/log.h"
+#include "osi/include/pool.h"
 
 /* The Media Type offset within the codec info byte array */
 #define A2DP_MEDIA_TYPE_OFFSET 1
 
+// The largest header offset used by the encoders for the outgoing media
+// packets: the media header, the codec-specific media payload header and
+// the SCMS-T content protection header.
+#define A2DP_ENCODER_PACKET_MAX_OFFSET (AVDT_MEDIA_OFFSET + 4)
+
+// The packets handed over to L2CAP are still in flight while the transmit
+// queue fills up again, hence the pool holds twice the transmit queue size.
+#define A2DP_ENCODER_PACKET_POOL_FACTOR 2
+
+// The number of configurations kept by the configuration cache of each
+// codec.
+#define A2DP_CODEC_CONFIG_CACHE_SIZE 4
+
+// The pool of buffers for the outgoing media packets. It is owned by the
+// A2DP Source media thread.
+static pool_t* a2dp_encoder_packet_pool = NULL;
+static size_t a2dp_encoder_packet_pool_fallbacks = 0;
+
 // Initializes the codec config.
 // |codec_config| is the codec config to initialize.
 // |codec_index| and |codec_priority| are the codec type and priority to use
@@ -50,12 +70,35 @@ static void init_btav_a2dp_codec_config(
   codec_config->codec_priority = codec_priority;
 }
 
+// Checks whether the codec configs |lhs| and |rhs| are the same.
+static bool codec_config_equals(const btav_a2dp_codec_config_t& lhs,
+                                const btav_a2dp_codec_config_t& rhs) {
+  return (lhs.codec_type == rhs.codec_type) &&
+         (lhs.codec_priority == rhs.codec_priority) &&
+         (lhs.sample_rate == rhs.sample_rate) &&
+         (lhs.bits_per_sample == rhs.bits_per_sample) &&
+         (lhs.channel_mode == rhs.channel_mode) &&
+         (lhs.codec_specific_1 == rhs.codec_specific_1) &&
+         (lhs.codec_specific_2 == rhs.codec_specific_2) &&
+         (lhs.codec_specific_3 == rhs.codec_specific_3) &&
+         (lhs.codec_specific_4 == rhs.codec_specific_4);
+}
+
+// Gets the length of the codec info |p_codec_info|, including its length
+// octet.
+static size_t codec_info_length(const uint8_t* p_codec_info) {
+  size_t length = p_codec_info[0] + 1;
+  return (length < AVDT_CODEC_SIZE) ? length : AVDT_CODEC_SIZE;
+}
+
 A2dpCodecConfig::A2dpCodecConfig(btav_a2dp_codec_index_t codec_index,
                                  const std::string& name,
                                  btav_a2dp_codec_priority_t codec_priority)
     : codec_index_(codec_index),
       name_(name),
-      default_codec_priority_(codec_priority) {
+      default_codec_priority_(codec_priority),
+      config_cache_hits_(0),
+      config_cache_misses_(0) {
   setCodecPriority(codec_priority);
 
   init_btav_a2dp_codec_config(&codec_config_, codec_index_, codecPriority());
@@ -145,6 +188,8 @@ A2dpCodecConfig* A2dpCodecConfig::createCodec(
 
 bool A2dpCodecConfig::isValid() const { return true; }
 
+uint64_t A2dpCodecConfig::encoderLookaheadUs() const { return 0; }
+
 bool A2dpCodecConfig::copyOutOtaCodecConfig(uint8_t* p_codec_info) {
   std::lock_guard<std::recursive_mutex> lock(codec_mutex_);
 
@@ -244,12 +289,17 @@ bool A2dpCodecConfig::setCodecUserConfig(
   uint8_t saved_ota_codec_config[AVDT_CODEC_SIZE];
   memcpy(saved_ota_codec_config, ota_codec_config_, sizeof(ota_codec_config_));
 
+  // The configurations computed with the previous user configuration are
+  // not wanted anymore.
+  if (!codec_config_equals(codec_user_config_, codec_user_config))
+    clearConfigCache();
+
   btav_a2dp_codec_config_t saved_codec_user_config = codec_user_config_;
   codec_user_config_ = codec_user_config;
   btav_a2dp_codec_config_t saved_codec_audio_config = codec_audio_config_;
   codec_audio_config_ = codec_audio_config;
-  bool success =
-      setCodecConfig(p_peer_codec_info, is_capability, p_result_codec_config);
+  bool success = setCodecConfigCached(p_peer_codec_info, is_capability,
+                                      p_result_codec_config);
   if (!success) {
     // Restore the local copy of the user and audio config
     codec_user_config_ = saved_codec_user_config;
@@ -291,6 +341,78 @@ bool A2dpCodecConfig::setCodecUserConfig(
   return true;
 }
 
+bool A2dpCodecConfig::setCodecConfigCached(const uint8_t* p_peer_codec_info,
+                                           bool is_capability,
+                                           uint8_t* p_result_codec_config) {
+  std::lock_guard<std::recursive_mutex> lock(codec_mutex_);
+  size_t peer_codec_info_length = codec_info_length(p_peer_codec_info);
+
+  for (auto iter = config_cache_.begin(); iter != config_cache_.end();
+       ++iter) {
+    const ConfigCacheEntry& entry = *iter;
+    if ((entry.is_capability != is_capability) ||
+        (memcmp(entry.peer_codec_info, p_peer_codec_info,
+                peer_codec_info_length) != 0) ||
+        !codec_config_equals(entry.codec_config, codec_config_) ||
+        !codec_config_equals(entry.codec_capability, codec_capability_) ||
+        !codec_config_equals(entry.codec_selectable_capability,
+                             codec_selectable_capability_) ||
+        !codec_config_equals(entry.codec_user_config, codec_user_config_) ||
+        !codec_config_equals(entry.codec_audio_config, codec_audio_config_)) {
+      continue;
+    }
+
+    codec_config_ = entry.result_codec_config;
+    codec_capability_ = entry.result_codec_capability;
+    codec_selectable_capability_ = entry.result_codec_selectable_capability;
+    memcpy(ota_codec_config_, entry.result_ota_codec_config,
+           sizeof(ota_codec_config_));
+    memcpy(is_capability ? ota_codec_peer_capability_ : ota_codec_peer_config_,
+           entry.result_ota_codec_peer_info, AVDT_CODEC_SIZE);
+    memcpy(p_result_codec_config, entry.result_codec_info,
+           codec_info_length(entry.result_codec_info));
+    config_cache_.splice(config_cache_.begin(), config_cache_, iter);
+    config_cache_hits_++;
+    return true;
+  }
+
+  ConfigCacheEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  memcpy(entry.peer_codec_info, p_peer_codec_info, peer_codec_info_length);
+  entry.is_capability = is_capability;
+  entry.codec_config = codec_config_;
+  entry.codec_capability = codec_capability_;
+  entry.codec_selectable_capability = codec_selectable_capability_;
+  entry.codec_user_config = codec_user_config_;
+  entry.codec_audio_config = codec_audio_config_;
+
+  if (!setCodecConfig(p_peer_codec_info, is_capability,
+                      p_result_codec_config)) {
+    return false;
+  }
+  config_cache_misses_++;
+
+  entry.result_codec_config = codec_config_;
+  entry.result_codec_capability = codec_capability_;
+  entry.result_codec_selectable_capability = codec_selectable_capability_;
+  memcpy(entry.result_codec_info, p_result_codec_config,
+         codec_info_length(p_result_codec_config));
+  memcpy(entry.result_ota_codec_config, ota_codec_config_,
+         sizeof(ota_codec_config_));
+  memcpy(entry.result_ota_codec_peer_info,
+         is_capability ? ota_codec_peer_capability_ : ota_codec_peer_config_,
+         AVDT_CODEC_SIZE);
+  config_cache_.push_front(entry);
+  if (config_cache_.size() > A2DP_CODEC_CONFIG_CACHE_SIZE)
+    config_cache_.pop_back();
+  return true;
+}
+
+void A2dpCodecConfig::clearConfigCache() {
+  std::lock_guard<std::recursive_mutex> lock(codec_mutex_);
+  config_cache_.clear();
+}
+
 bool A2dpCodecConfig::codecConfigIsValid(
     const btav_a2dp_codec_config_t& codec_config) {
   return (codec_config.codec_type < BTAV_A2DP_CODEC_INDEX_MAX) &&
@@ -404,6 +526,7 @@ void A2dpCodecConfig::debug_codec_dump(int fd) {
   dprintf(fd, "\nA2DP %s State:\n", name().c_str());
   dprintf(fd, "  Priority: %d\n", codecPriority());
   dprintf(fd, "  Encoder interval (ms): %" PRIu64 "\n", encoderIntervalMs());
+  dprintf(fd, "  Encoder lookahead (us): %" PRIu64 "\n", encoderLookaheadUs());
 
   result = codecConfig2Str(getCodecConfig());
   dprintf(fd, "  Config: %s\n", result.c_str());
@@ -413,6 +536,9 @@ void A2dpCodecConfig::debug_codec_dump(int fd) {
 
   result = codecConfig2Str(getCodecLocalCapability());
   dprintf(fd, "  Local capability: %s\n", result.c_str());
+
+  dprintf(fd, "  Config cache hits/misses: %zu/%zu\n", config_cache_hits_,
+          config_cache_misses_);
 }
 
 //
@@ -528,8 +654,8 @@ bool A2dpCodecs::setCodecConfig(const uint8_t* p_peer_codec_info,
   std::lock_guard<std::recursive_mutex> lock(codec_mutex_);
   A2dpCodecConfig* a2dp_codec_config = findSourceCodecConfig(p_peer_codec_info);
   if (a2dp_codec_config == nullptr) return false;
-  if (!a2dp_codec_config->setCodecConfig(p_peer_codec_info, is_capability,
-                                         p_result_codec_config)) {
+  if (!a2dp_codec_config->setCodecConfigCached(
+          p_peer_codec_info, is_capability, p_result_codec_config)) {
     return false;
   }
   if (select_current_codec) {
@@ -1184,6 +1310,45 @@ bool A2DP_BuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
   return false;
 }
 
+bool A2DP_PacketEndsFrame(const uint8_t* p_codec_info, const BT_HDR* p_buf) {
+  tA2DP_CODEC_TYPE codec_type = A2DP_GetCodecType(p_codec_info);
+
+  switch (codec_type) {
+    case A2DP_MEDIA_CT_SBC:
+    case A2DP_MEDIA_CT_AAC:
+      // Each packet carries complete frames
+      return true;
+    case A2DP_MEDIA_CT_NON_A2DP:
+      return A2DP_VendorPacketEndsFrame(p_codec_info, p_buf);
+    default:
+      break;
+  }
+
+  return true;
+}
+
+bool A2DP_MergePackets(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                       const BT_HDR* p_next, uint16_t max_len) {
+  // The merged packet must fit in the buffer of |p_buf|
+  if (sizeof(BT_HDR) + p_buf->offset + p_buf->len + p_next->len >
+      BT_DEFAULT_BUFFER_SIZE)
+    return false;
+
+  tA2DP_CODEC_TYPE codec_type = A2DP_GetCodecType(p_codec_info);
+
+  switch (codec_type) {
+    case A2DP_MEDIA_CT_SBC:
+    case A2DP_MEDIA_CT_AAC:
+      return false;
+    case A2DP_MEDIA_CT_NON_A2DP:
+      return A2DP_VendorMergePackets(p_codec_info, p_buf, p_next, max_len);
+    default:
+      break;
+  }
+
+  return false;
+}
+
 const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterface(
     const uint8_t* p_codec_info) {
   tA2DP_CODEC_TYPE codec_type = A2DP_GetCodecType(p_codec_info);
@@ -1205,6 +1370,113 @@ const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterface(
   return NULL;
 }
 
+const tA2DP_DECODER_INTERFACE* A2DP_GetDecoderInterface(
+    const uint8_t* p_codec_info) {
+  tA2DP_CODEC_TYPE codec_type = A2DP_GetCodecType(p_codec_info);
+
+  LOG_VERBOSE(LOG_TAG, "%s: codec_type = 0x%x", __func__, codec_type);
+
+  switch (codec_type) {
+    case A2DP_MEDIA_CT_SBC:
+      return A2DP_GetDecoderInterfaceSbc(p_codec_info);
+    case A2DP_MEDIA_CT_NON_A2DP:
+      return A2DP_VendorGetDecoderInterface(p_codec_info);
+    default:
+      break;
+  }
+
+  LOG_ERROR(LOG_TAG, "%s: unsupported codec type 0x%x", __func__, codec_type);
+  return NULL;
+}
+
+void A2DP_InitEncoderPacketPool(uint16_t peer_mtu,
+                                size_t max_queued_packets) {
+  A2DP_CleanupEncoderPacketPool();
+
+  size_t buffer_size =
+      sizeof(BT_HDR) + A2DP_ENCODER_PACKET_MAX_OFFSET + peer_mtu;
+  if (buffer_size > BT_DEFAULT_BUFFER_SIZE)
+    buffer_size = BT_DEFAULT_BUFFER_SIZE;
+  size_t capacity = max_queued_packets * A2DP_ENCODER_PACKET_POOL_FACTOR;
+
+  a2dp_encoder_packet_pool = pool_new(buffer_size, capacity);
+  if (a2dp_encoder_packet_pool == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: cannot create the encoder packet pool", __func__);
+    return;
+  }
+  a2dp_encoder_packet_pool_fallbacks = 0;
+
+  LOG_DEBUG(LOG_TAG, "%s: peer_mtu=%d buffer_size=%zu capacity=%zu", __func__,
+            peer_mtu, buffer_size, capacity);
+}
+
+void A2DP_ReserveEncoderPacketSize(uint16_t offset, uint16_t max_len) {
+  if (a2dp_encoder_packet_pool == NULL) return;
+
+  size_t buffer_size = sizeof(BT_HDR) + offset + max_len;
+  if (buffer_size > BT_DEFAULT_BUFFER_SIZE)
+    buffer_size = BT_DEFAULT_BUFFER_SIZE;
+  if (buffer_size <= pool_buffer_size(a2dp_encoder_packet_pool)) return;
+
+  // The packets taken from the previous pool remain valid until freed
+  size_t capacity = pool_capacity(a2dp_encoder_packet_pool);
+  pool_free(a2dp_encoder_packet_pool);
+  a2dp_encoder_packet_pool = pool_new(buffer_size, capacity);
+  if (a2dp_encoder_packet_pool == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: cannot resize the encoder packet pool", __func__);
+    return;
+  }
+
+  LOG_DEBUG(LOG_TAG, "%s: buffer_size=%zu capacity=%zu", __func__,
+            buffer_size, capacity);
+}
+
+void A2DP_CleanupEncoderPacketPool(void) {
+  pool_free(a2dp_encoder_packet_pool);
+  a2dp_encoder_packet_pool = NULL;
+}
+
+BT_HDR* A2DP_AllocEncoderPacket(uint16_t offset, uint16_t max_len) {
+  size_t size = sizeof(BT_HDR) + offset + max_len;
+  BT_HDR* p_buf = NULL;
+
+  if (a2dp_encoder_packet_pool != NULL &&
+      size <= pool_buffer_size(a2dp_encoder_packet_pool)) {
+    p_buf = (BT_HDR*)pool_alloc(a2dp_encoder_packet_pool);
+  }
+  if (p_buf == NULL) {
+    CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
+    a2dp_encoder_packet_pool_fallbacks++;
+    p_buf = (BT_HDR*)osi_malloc_tagged(BT_DEFAULT_BUFFER_SIZE, OSI_MEM_A2DP);
+  }
+
+  p_buf->offset = offset;
+  p_buf->len = 0;
+  p_buf->layer_specific = 0;
+  return p_buf;
+}
+
+void A2DP_EncoderPacketPoolDebugDump(int fd) {
+  if (a2dp_encoder_packet_pool == NULL) {
+    dprintf(fd,
+            "  Encoder packet pool                                     : "
+            "none\n");
+    return;
+  }
+
+  dprintf(fd,
+          "  Encoder packet pool (buffer size/capacity/available)    : %zu / "
+          "%zu / %zu\n",
+          pool_buffer_size(a2dp_encoder_packet_pool),
+          pool_capacity(a2dp_encoder_packet_pool),
+          pool_available(a2dp_encoder_packet_pool));
+  dprintf(fd,
+          "  Encoder packet pool (exhausted/heap fallbacks)          : %zu / "
+          "%zu\n",
+          pool_exhausted_count(a2dp_encoder_packet_pool),
+          a2dp_encoder_packet_pool_fallbacks);
+}
+
 bool A2DP_AdjustCodec(uint8_t* p_codec_info) {
   tA2DP_CODEC_TYPE codec_type = A2DP_GetCodecType(p_codec_info);
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_jitter_buffer"
+
+#include "a2dp_jitter_buffer.h"
+
+#include <string.h>
+
+#include "osi/include/log.h"
+
+#define US_PER_SEC 1000000
+// The RFC 3550 jitter estimate gain is 1/16.
+#define JITTER_GAIN_SHIFT 4
+// The transit variation peak decays by 1/256 per packet.
+#define PEAK_DECAY_SHIFT 8
+// The target delay covers this many times the jitter estimate.
+#define JITTER_MULTIPLIER 4
+// RTP timestamp steps larger than this are discontinuities, not jitter.
+#define MAX_TIMESTAMP_STEP_US US_PER_SEC
+
+static uint64_t frames_to_us(const tA2DP_JITTER_BUFFER* p_jb,
+                             uint64_t num_frames) {
+  if (p_jb->sample_rate == 0) return 0;
+  return num_frames * p_jb->samples_per_frame * US_PER_SEC / p_jb->sample_rate;
+}
+
+static void a2dp_jitter_buffer_update_target(tA2DP_JITTER_BUFFER* p_jb) {
+  uint64_t target_us = JITTER_MULTIPLIER * p_jb->jitter_us;
+  if (target_us < p_jb->peak_us) target_us = p_jb->peak_us;
+  // One tick worth of frames is consumed at once
+  target_us += frames_to_us(p_jb, p_jb->frames_per_tick);
+  if (target_us < A2DP_JITTER_MIN_DELAY_US)
+    target_us = A2DP_JITTER_MIN_DELAY_US;
+  if (target_us > A2DP_JITTER_MAX_DELAY_US)
+    target_us = A2DP_JITTER_MAX_DELAY_US;
+  p_jb->target_us = target_us;
+}
+
+void a2dp_jitter_buffer_init(tA2DP_JITTER_BUFFER* p_jb, uint32_t sample_rate,
+                             uint32_t samples_per_frame,
+                             uint32_t frames_per_tick) {
+  memset(p_jb, 0, sizeof(*p_jb));
+  p_jb->sample_rate = sample_rate;
+  p_jb->samples_per_frame = samples_per_frame;
+  p_jb->frames_per_tick = frames_per_tick;
+  a2dp_jitter_buffer_update_target(p_jb);
+}
+
+void a2dp_jitter_buffer_flush(tA2DP_JITTER_BUFFER* p_jb) {
+  p_jb->queued_frames = 0;
+  p_jb->is_playing = false;
+  p_jb->has_reference = false;
+  p_jb->ticks_since_adjustment = 0;
+}
+
+void a2dp_jitter_buffer_on_packet(tA2DP_JITTER_BUFFER* p_jb, uint64_t now_us,
+                                  uint32_t timestamp, uint32_t num_frames) {
+  p_jb->queued_frames += num_frames;
+
+  if (p_jb->has_reference && p_jb->sample_rate != 0) {
+    // The RTP timestamp wraps around: the unsigned difference is the step
+    uint64_t media_us = (uint64_t)(uint32_t)(timestamp - p_jb->last_timestamp) *
+                        US_PER_SEC / p_jb->sample_rate;
+    if (media_us <= MAX_TIMESTAMP_STEP_US && now_us >= p_jb->last_arrival_us) {
+      int64_t transit_us =
+          (int64_t)(now_us - p_jb->last_arrival_us) - (int64_t)media_us;
+      uint64_t variation_us =
+          (transit_us < 0) ? (uint64_t)-transit_us : (uint64_t)transit_us;
+
+      if (variation_us > p_jb->jitter_us) {
+        p_jb->jitter_us += (variation_us - p_jb->jitter_us) >> JITTER_GAIN_SHIFT;
+      } else {
+        p_jb->jitter_us -= (p_jb->jitter_us - variation_us) >> JITTER_GAIN_SHIFT;
+      }
+      if (variation_us > p_jb->peak_us) {
+        p_jb->peak_us = variation_us;
+      } else {
+        p_jb->peak_us -= p_jb->peak_us >> PEAK_DECAY_SHIFT;
+      }
+      a2dp_jitter_buffer_update_target(p_jb);
+    }
+  }
+
+  p_jb->has_reference = true;
+  p_jb->last_timestamp = timestamp;
+  p_jb->last_arrival_us = now_us;
+}
+
+bool a2dp_jitter_buffer_is_overflow(const tA2DP_JITTER_BUFFER* p_jb) {
+  return a2dp_jitter_buffer_get_queued_us(p_jb) > 2 * p_jb->target_us;
+}
+
+void a2dp_jitter_buffer_on_overflow(tA2DP_JITTER_BUFFER* p_jb,
+                                    uint32_t num_frames) {
+  if (num_frames > p_jb->queued_frames) num_frames = p_jb->queued_frames;
+  p_jb->queued_frames -= num_frames;
+  p_jb->overflow_frames += num_frames;
+}
+
+uint32_t a2dp_jitter_buffer_tick(tA2DP_JITTER_BUFFER* p_jb,
+                                 tA2DP_JITTER_ACTION* p_action) {
+  uint64_t queued_us = a2dp_jitter_buffer_get_queued_us(p_jb);
+  uint32_t num_frames = p_jb->frames_per_tick;
+
+  *p_action = A2DP_JITTER_ACTION_NONE;
+  if (!p_jb->is_playing) {
+    if (queued_us < p_jb->target_us) return 0;
+    LOG_DEBUG(LOG_TAG, "%s: start playout with %llu us queued", __func__,
+              (unsigned long long)queued_us);
+    p_jb->is_playing = true;
+    p_jb->ticks_since_adjustment = 0;
+  } else if (p_jb->queued_frames == 0) {
+    // Rebuffer up to the target instead of playing packets as they arrive
+    p_jb->is_playing = false;
+    p_jb->underruns++;
+    return 0;
+  }
+
+  p_jb->ticks_since_adjustment++;
+  if (p_jb->ticks_since_adjustment >= A2DP_JITTER_ADJUST_INTERVAL_TICKS) {
+    if (queued_us >
+        p_jb->target_us + frames_to_us(p_jb, p_jb->frames_per_tick)) {
+      *p_action = A2DP_JITTER_ACTION_DROP;
+      num_frames++;
+      p_jb->dropped_frames++;
+      p_jb->ticks_since_adjustment = 0;
+    } else if (queued_us < p_jb->target_us / 2 && num_frames > 1) {
+      *p_action = A2DP_JITTER_ACTION_REPEAT;
+      num_frames--;
+      p_jb->repeated_frames++;
+      p_jb->ticks_since_adjustment = 0;
+    }
+  }
+
+  if (num_frames > p_jb->queued_frames) num_frames = p_jb->queued_frames;
+  p_jb->queued_frames -= num_frames;
+  return num_frames;
+}
+
+uint64_t a2dp_jitter_buffer_get_queued_us(const tA2DP_JITTER_BUFFER* p_jb) {
+  return frames_to_us(p_jb, p_jb->queued_frames);
+}
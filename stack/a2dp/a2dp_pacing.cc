@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_pacing"
+
+#include "a2dp_pacing.h"
+
+#include <string.h>
+
+#include "osi/include/log.h"
+
+#define US_PER_SEC 1000000
+
+void a2dp_pacing_init(tA2DP_PACING* p_pacing, uint32_t bytes_per_second,
+                      uint32_t interval_us) {
+  memset(p_pacing, 0, sizeof(*p_pacing));
+  p_pacing->bytes_per_second = bytes_per_second;
+  p_pacing->interval_us = interval_us;
+}
+
+void a2dp_pacing_flush(tA2DP_PACING* p_pacing) {
+  p_pacing->backlog_us = 0;
+  p_pacing->counter = 0;
+}
+
+uint32_t a2dp_pacing_get_bytes_per_tick(const tA2DP_PACING* p_pacing) {
+  return p_pacing->bytes_per_second * p_pacing->interval_us / US_PER_SEC;
+}
+
+uint32_t a2dp_pacing_update(tA2DP_PACING* p_pacing, uint64_t timestamp_us,
+                            uint32_t pcm_bytes_per_frame) {
+  uint64_t elapsed_us = p_pacing->interval_us;
+  if (p_pacing->last_tick_us != 0 && timestamp_us >= p_pacing->last_tick_us)
+    elapsed_us = timestamp_us - p_pacing->last_tick_us;
+  p_pacing->last_tick_us = timestamp_us;
+
+  p_pacing->backlog_us += elapsed_us;
+  if (p_pacing->backlog_us > A2DP_PACING_MAX_BACKLOG_US) {
+    LOG_WARN(LOG_TAG, "%s: dropping %llu us of PCM", __func__,
+             (unsigned long long)(p_pacing->backlog_us -
+                                  A2DP_PACING_MAX_BACKLOG_US));
+    p_pacing->dropped_us +=
+        p_pacing->backlog_us - A2DP_PACING_MAX_BACKLOG_US;
+    p_pacing->backlog_us = A2DP_PACING_MAX_BACKLOG_US;
+  }
+
+  // Spread a late tick over the following ones
+  uint64_t credit_us = p_pacing->backlog_us;
+  uint64_t max_credit_us =
+      (uint64_t)p_pacing->interval_us * A2DP_PACING_MAX_INTERVALS_PER_TICK;
+  if (credit_us > max_credit_us) credit_us = max_credit_us;
+  p_pacing->backlog_us -= credit_us;
+  p_pacing->counter += credit_us * p_pacing->bytes_per_second;
+
+  if (pcm_bytes_per_frame == 0) return 0;
+  return p_pacing->counter / ((uint64_t)pcm_bytes_per_frame * US_PER_SEC);
+}
+
+void a2dp_pacing_consume(tA2DP_PACING* p_pacing, uint32_t num_frames,
+                         uint32_t pcm_bytes_per_frame) {
+  uint64_t consumed = (uint64_t)num_frames * pcm_bytes_per_frame * US_PER_SEC;
+  if (consumed > p_pacing->counter) consumed = p_pacing->counter;
+  p_pacing->counter -= consumed;
+}
+
+void a2dp_pacing_credit(tA2DP_PACING* p_pacing, uint32_t num_bytes) {
+  p_pacing->counter += (uint64_t)num_bytes * US_PER_SEC;
+}
+
+void a2dp_pacing_limit(tA2DP_PACING* p_pacing, uint32_t max_intervals) {
+  uint64_t max_counter = (uint64_t)p_pacing->interval_us * max_intervals *
+                         p_pacing->bytes_per_second;
+  if (p_pacing->counter <= max_counter) return;
+
+  if (p_pacing->bytes_per_second != 0) {
+    p_pacing->dropped_us +=
+        (p_pacing->counter - max_counter) / p_pacing->bytes_per_second;
+  }
+  p_pacing->counter = max_counter;
+}
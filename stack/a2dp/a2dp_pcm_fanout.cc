@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_pcm_fanout"
+
+#include "a2dp_pcm_fanout.h"
+
+#include <string.h>
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+
+bool a2dp_pcm_fanout_init(tA2DP_PCM_FANOUT* p_fanout,
+                          a2dp_source_read_callback_t read_callback,
+                          uint8_t num_readers, uint32_t frame_size,
+                          uint32_t size) {
+  memset(p_fanout, 0, sizeof(*p_fanout));
+  if (read_callback == NULL || num_readers == 0 ||
+      num_readers > A2DP_PCM_FANOUT_MAX_READERS || frame_size == 0 ||
+      size < frame_size) {
+    LOG_ERROR(LOG_TAG, "%s: invalid fan-out: %u readers, %u/%u octets",
+              __func__, num_readers, frame_size, size);
+    return false;
+  }
+
+  p_fanout->read_callback = read_callback;
+  p_fanout->num_readers = num_readers;
+  p_fanout->frame_size = frame_size;
+  p_fanout->size = size - size % frame_size;
+  p_fanout->buf = (uint8_t*)osi_malloc(p_fanout->size);
+  return true;
+}
+
+void a2dp_pcm_fanout_cleanup(tA2DP_PCM_FANOUT* p_fanout) {
+  osi_free(p_fanout->buf);
+  memset(p_fanout, 0, sizeof(*p_fanout));
+}
+
+void a2dp_pcm_fanout_flush(tA2DP_PCM_FANOUT* p_fanout) {
+  p_fanout->write_pos = 0;
+  memset(p_fanout->read_pos, 0, sizeof(p_fanout->read_pos));
+}
+
+// Makes room for |len| more octets in the ring buffer, skipping the readers
+// that would lose unread PCM ahead to the oldest PCM that is kept.
+static void a2dp_pcm_fanout_make_room(tA2DP_PCM_FANOUT* p_fanout,
+                                      uint32_t len) {
+  if (p_fanout->write_pos + len <= p_fanout->size) return;
+
+  uint64_t oldest_pos = p_fanout->write_pos + len - p_fanout->size;
+  // Skip whole frames only, so that the readers stay frame aligned
+  uint32_t remainder = oldest_pos % p_fanout->frame_size;
+  if (remainder != 0) oldest_pos += p_fanout->frame_size - remainder;
+
+  for (uint8_t i = 0; i < p_fanout->num_readers; i++) {
+    if (p_fanout->read_pos[i] >= oldest_pos) continue;
+    uint64_t skipped = oldest_pos - p_fanout->read_pos[i];
+    LOG_WARN(LOG_TAG, "%s: reader %u skips %llu octets", __func__, i,
+             (unsigned long long)skipped);
+    p_fanout->skipped_bytes[i] += skipped;
+    p_fanout->read_pos[i] = oldest_pos;
+  }
+}
+
+uint32_t a2dp_pcm_fanout_read(tA2DP_PCM_FANOUT* p_fanout, uint8_t reader,
+                              uint8_t* p_buf, uint32_t len) {
+  if (reader >= p_fanout->num_readers) return 0;
+  if (len > p_fanout->size) len = p_fanout->size;
+
+  // Pull the PCM no reader read yet from the source
+  uint64_t buffered = p_fanout->write_pos - p_fanout->read_pos[reader];
+  if (buffered < len) {
+    uint32_t needed = len - buffered;
+    a2dp_pcm_fanout_make_room(p_fanout, needed);
+    while (needed > 0) {
+      uint32_t offset = p_fanout->write_pos % p_fanout->size;
+      uint32_t chunk = p_fanout->size - offset;
+      if (chunk > needed) chunk = needed;
+      uint32_t bytes_read =
+          p_fanout->read_callback(p_fanout->buf + offset, chunk);
+      p_fanout->write_pos += bytes_read;
+      needed -= bytes_read;
+      if (bytes_read < chunk) break;
+    }
+  }
+
+  // Copy the PCM of the reader out of the ring buffer
+  buffered = p_fanout->write_pos - p_fanout->read_pos[reader];
+  uint32_t copied = (buffered < len) ? buffered : len;
+  uint32_t done = 0;
+  while (done < copied) {
+    uint32_t offset = p_fanout->read_pos[reader] % p_fanout->size;
+    uint32_t chunk = p_fanout->size - offset;
+    if (chunk > copied - done) chunk = copied - done;
+    memcpy(p_buf + done, p_fanout->buf + offset, chunk);
+    p_fanout->read_pos[reader] += chunk;
+    done += chunk;
+  }
+
+  return copied;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_resampler"
+
+#include "a2dp_resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#define A2DP_RESAMPLER_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define A2DP_RESAMPLER_SSE2
+#endif
+
+#include "osi/include/allocator.h"
+#include "osi/include/log.h"
+
+// The filter coefficients are Q14, so that a phase sums to 1 << 14.
+#define COEF_SHIFT 14
+// The cutoff frequency, relative to the lower of the two Nyquist rates.
+#define CUTOFF_RATIO 0.9
+// The filter taps per phase for each source sample skipped per output.
+#define TAPS_PER_ZERO_CROSSING 32
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// Returns the dot product of the |taps| coefficients |p_coefs| with the
+// input history |p_x|. |taps| is a multiple of 8.
+static int32_t dot_product(const int16_t* p_x, const int16_t* p_coefs,
+                           uint16_t taps) {
+#if defined(A2DP_RESAMPLER_NEON)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (uint16_t i = 0; i < taps; i += 8) {
+    int16x8_t x = vld1q_s16(p_x + i);
+    int16x8_t c = vld1q_s16(p_coefs + i);
+    acc = vmlal_s16(acc, vget_low_s16(x), vget_low_s16(c));
+    acc = vmlal_s16(acc, vget_high_s16(x), vget_high_s16(c));
+  }
+  int32x2_t sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+  return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#elif defined(A2DP_RESAMPLER_SSE2)
+  __m128i acc = _mm_setzero_si128();
+  for (uint16_t i = 0; i < taps; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(p_x + i));
+    __m128i c = _mm_loadu_si128((const __m128i*)(p_coefs + i));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(x, c));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(acc);
+#else
+  int32_t acc = 0;
+  for (uint16_t i = 0; i < taps; i++) acc += (int32_t)p_x[i] * p_coefs[i];
+  return acc;
+#endif
+}
+
+// Computes the |taps| coefficients of the filter phase |phase| out of |up|.
+// The history is stored oldest first, and the output of phase p lies p/L
+// of a sample after the input |taps| / 2 samples before the newest one.
+static void compute_phase(int16_t* p_coefs, uint32_t phase, uint32_t up,
+                          uint32_t down, uint16_t taps) {
+  double cutoff = CUTOFF_RATIO * (up < down ? (double)up / down : 1.0);
+  double half = taps / 2;
+  double values[A2DP_RESAMPLER_MAX_TAPS];
+  double total = 0;
+
+  for (uint16_t i = 0; i < taps; i++) {
+    // Distance in source samples between the input and the output
+    double t = half - (double)phase / up - (taps - 1 - i);
+    double x = M_PI * cutoff * t;
+    double sinc = (x == 0) ? 1.0 : sin(x) / x;
+    double w = 0;
+    if (fabs(t) < half) {
+      // Blackman window
+      w = 0.42 + 0.5 * cos(M_PI * t / half) + 0.08 * cos(2 * M_PI * t / half);
+    }
+    values[i] = sinc * w;
+    total += values[i];
+  }
+
+  // Normalize for unity DC gain, folding the rounding error into the
+  // largest tap so that the phase sums exactly to 1.
+  int32_t sum = 0;
+  uint16_t largest = 0;
+  for (uint16_t i = 0; i < taps; i++) {
+    p_coefs[i] = (int16_t)lrint(values[i] / total * (1 << COEF_SHIFT));
+    sum += p_coefs[i];
+    if (p_coefs[i] > p_coefs[largest]) largest = i;
+  }
+  p_coefs[largest] += (1 << COEF_SHIFT) - sum;
+}
+
+bool a2dp_resampler_init(tA2DP_RESAMPLER* p_resampler, uint32_t src_rate,
+                         uint32_t dst_rate, uint8_t channel_count) {
+  memset(p_resampler, 0, sizeof(*p_resampler));
+  if (src_rate == 0 || dst_rate == 0 || channel_count == 0 ||
+      channel_count > A2DP_RESAMPLER_MAX_CHANNELS) {
+    LOG_ERROR(LOG_TAG, "%s: unsupported conversion %u Hz -> %u Hz (%u ch)",
+              __func__, src_rate, dst_rate, channel_count);
+    return false;
+  }
+
+  uint32_t divisor = gcd(src_rate, dst_rate);
+  uint32_t up = dst_rate / divisor;
+  uint32_t down = src_rate / divisor;
+  if (up > A2DP_RESAMPLER_MAX_PHASES) {
+    LOG_ERROR(LOG_TAG, "%s: %u Hz -> %u Hz needs too many phases (%u)",
+              __func__, src_rate, dst_rate, up);
+    return false;
+  }
+
+  // Widen the filter when decimating so that its transition band shrinks
+  // with the output Nyquist rate.
+  uint32_t taps = TAPS_PER_ZERO_CROSSING * ((down + up - 1) / up);
+  if (taps > A2DP_RESAMPLER_MAX_TAPS) taps = A2DP_RESAMPLER_MAX_TAPS;
+
+  p_resampler->src_rate = src_rate;
+  p_resampler->dst_rate = dst_rate;
+  p_resampler->up = up;
+  p_resampler->down = down;
+  p_resampler->channel_count = channel_count;
+  p_resampler->taps = taps;
+  p_resampler->coefs = (int16_t*)osi_malloc(up * taps * sizeof(int16_t));
+  for (uint32_t phase = 0; phase < up; phase++) {
+    compute_phase(p_resampler->coefs + phase * taps, phase, up, down, taps);
+  }
+  a2dp_resampler_reset(p_resampler);
+
+  LOG_DEBUG(LOG_TAG, "%s: %u Hz -> %u Hz: L=%u M=%u taps=%u", __func__,
+            src_rate, dst_rate, up, down, taps);
+  return true;
+}
+
+void a2dp_resampler_cleanup(tA2DP_RESAMPLER* p_resampler) {
+  osi_free(p_resampler->coefs);
+  memset(p_resampler, 0, sizeof(*p_resampler));
+}
+
+void a2dp_resampler_reset(tA2DP_RESAMPLER* p_resampler) {
+  memset(p_resampler->history, 0, sizeof(p_resampler->history));
+  p_resampler->history_pos = 0;
+  p_resampler->partial_len = 0;
+  // Consume a source sample before the first output
+  p_resampler->phase = p_resampler->up;
+}
+
+uint32_t a2dp_resampler_process(tA2DP_RESAMPLER* p_resampler,
+                                const int16_t* p_src, uint32_t src_frames,
+                                uint32_t* p_src_used, int16_t* p_dst,
+                                uint32_t dst_frames) {
+  const uint8_t channel_count = p_resampler->channel_count;
+  const uint16_t taps = p_resampler->taps;
+  uint32_t src_used = 0;
+  uint32_t dst_used = 0;
+
+  while (dst_used < dst_frames) {
+    // Advance the history up to the next output
+    while (p_resampler->phase >= p_resampler->up && src_used < src_frames) {
+      uint16_t pos = p_resampler->history_pos;
+      for (uint8_t ch = 0; ch < channel_count; ch++) {
+        int16_t sample = p_src[src_used * channel_count + ch];
+        p_resampler->history[ch][pos] = sample;
+        p_resampler->history[ch][pos + taps] = sample;
+      }
+      p_resampler->history_pos = (pos + 1 == taps) ? 0 : pos + 1;
+      p_resampler->phase -= p_resampler->up;
+      src_used++;
+    }
+    if (p_resampler->phase >= p_resampler->up) break;
+
+    const int16_t* p_coefs = p_resampler->coefs + p_resampler->phase * taps;
+    for (uint8_t ch = 0; ch < channel_count; ch++) {
+      const int16_t* p_x =
+          &p_resampler->history[ch][p_resampler->history_pos];
+      int32_t acc = dot_product(p_x, p_coefs, taps);
+      acc = (acc + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT;
+      if (acc > INT16_MAX) acc = INT16_MAX;
+      if (acc < INT16_MIN) acc = INT16_MIN;
+      p_dst[dst_used * channel_count + ch] = (int16_t)acc;
+    }
+    p_resampler->phase += p_resampler->down;
+    dst_used++;
+  }
+
+  *p_src_used = src_used;
+  return dst_used;
+}
+
+uint32_t a2dp_resampler_read(tA2DP_RESAMPLER* p_resampler,
+                             a2dp_source_read_callback_t read_callback,
+                             uint8_t* p_buf, uint32_t len) {
+  const uint32_t frame_size = p_resampler->channel_count * sizeof(int16_t);
+  int16_t src[A2DP_RESAMPLER_READ_FRAMES * A2DP_RESAMPLER_MAX_CHANNELS];
+  uint32_t dst_frames = len / frame_size;
+  uint32_t dst_used = 0;
+
+  while (dst_used < dst_frames) {
+    // The source frames consumed by the remaining outputs
+    uint64_t needed = ((uint64_t)p_resampler->phase +
+                       (uint64_t)(dst_frames - dst_used - 1) *
+                           p_resampler->down) /
+                      p_resampler->up;
+    if (needed > A2DP_RESAMPLER_READ_FRAMES)
+      needed = A2DP_RESAMPLER_READ_FRAMES;
+
+    uint32_t src_len = p_resampler->partial_len;
+    memcpy(src, p_resampler->partial, src_len);
+    if (needed > 0) {
+      src_len += read_callback((uint8_t*)src + src_len,
+                               needed * frame_size - src_len);
+    }
+    uint32_t src_frames = src_len / frame_size;
+    // Keep an incomplete frame for the next read
+    p_resampler->partial_len = src_len - src_frames * frame_size;
+    memcpy(p_resampler->partial, (uint8_t*)src + src_frames * frame_size,
+           p_resampler->partial_len);
+
+    uint32_t src_used = 0;
+    uint32_t converted = a2dp_resampler_process(
+        p_resampler, src, src_frames, &src_used,
+        (int16_t*)(p_buf + dst_used * frame_size), dst_frames - dst_used);
+    dst_used += converted;
+    if (converted == 0 || src_frames < needed) break;
+  }
+
+  return dst_used * frame_size;
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2016 The Android Open Source Project
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "a2dp_sbc_decoder"
+
+#include "a2dp_sbc_decoder.h"
+
+#include <string.h>
+
+#include "a2dp_sbc.h"
+#include "bt_common.h"
+#include "embdrv/sbc/decoder/include/oi_codec_sbc.h"
+#include "embdrv/sbc/decoder/include/oi_status.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+typedef struct {
+  OI_CODEC_SBC_DECODER_CONTEXT decoder_context;
+  uint32_t decoder_context_data[CODEC_DATA_WORDS(
+      2, SBC_CODEC_FAST_FILTER_BUFFERS)];
+  size_t frame_samples;
+} tA2DP_SBC_DECODER_CB;
+
+static tA2DP_SBC_DECODER_CB a2dp_sbc_decoder_cb;
+
+bool a2dp_sbc_decoder_init(const uint8_t* p_codec_info) {
+  memset(&a2dp_sbc_decoder_cb, 0, sizeof(a2dp_sbc_decoder_cb));
+
+  OI_STATUS status = OI_CODEC_SBC_DecoderReset(
+      &a2dp_sbc_decoder_cb.decoder_context,
+      a2dp_sbc_decoder_cb.decoder_context_data,
+      sizeof(a2dp_sbc_decoder_cb.decoder_context_data), 2, 2, false);
+  if (!OI_SUCCESS(status)) {
+    LOG_ERROR(LOG_TAG,
+              "%s: OI_CODEC_SBC_DecoderReset failed with error code %d",
+              __func__, status);
+    return false;
+  }
+
+  int num_subbands = A2DP_GetNumberOfSubbandsSbc(p_codec_info);
+  int num_blocks = A2DP_GetNumberOfBlocksSbc(p_codec_info);
+  if (num_subbands > 0 && num_blocks > 0)
+    a2dp_sbc_decoder_cb.frame_samples = num_subbands * num_blocks;
+
+  return true;
+}
+
+void a2dp_sbc_decoder_cleanup(void) {
+  memset(&a2dp_sbc_decoder_cb, 0, sizeof(a2dp_sbc_decoder_cb));
+}
+
+size_t a2dp_sbc_get_frame_samples(void) {
+  return a2dp_sbc_decoder_cb.frame_samples;
+}
+
+uint16_t a2dp_sbc_assemble_frames(const uint8_t* p_data, uint16_t len,
+                                  const uint8_t** p_frames,
+                                  uint16_t* frames_len) {
+  if (len <= A2DP_SBC_MPL_HDR_LEN) return 0;
+
+  *p_frames = p_data + A2DP_SBC_MPL_HDR_LEN;
+  *frames_len = len - A2DP_SBC_MPL_HDR_LEN;
+  return p_data[0] & A2DP_SBC_HDR_NUM_MSK;
+}
+
+uint16_t a2dp_sbc_decode_frames(const uint8_t* p_frames, uint16_t frames_len,
+                                uint16_t num_frames, int16_t* p_pcm,
+                                uint32_t* p_pcm_len) {
+  const OI_BYTE* p_data = p_frames;
+  uint32_t data_len = frames_len;
+  uint32_t avail_pcm_bytes = *p_pcm_len;
+  uint16_t count;
+
+  for (count = 0; count < num_frames && data_len != 0; count++) {
+    uint32_t pcm_bytes = avail_pcm_bytes;
+    OI_STATUS status =
+        OI_CODEC_SBC_DecodeFrame(&a2dp_sbc_decoder_cb.decoder_context, &p_data,
+                                 &data_len, p_pcm, &pcm_bytes);
+    if (!OI_SUCCESS(status)) {
+      LOG_ERROR(LOG_TAG, "%s: decoding failure: %d", __func__, status);
+      break;
+    }
+    avail_pcm_bytes -= pcm_bytes;
+    p_pcm += pcm_bytes / sizeof(int16_t);
+  }
+
+  *p_pcm_len -= avail_pcm_bytes;
+  return count;
+}
@@ -25,8 +25,9 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "a2dp_pacing.h"
+#include "a2dp_resampler.h"
 #include "a2dp_sbc.h"
-#include "a2dp_sbc_up_sample.h"
 #include "bt_common.h"
 #include "embdrv/sbc/encoder/include/sbc_encoder.h"
 #include "osi/include/log.h"
@@ -72,11 +73,8 @@
 
 typedef struct {
   uint32_t aa_frame_counter;
-  int32_t aa_feed_counter;
   int32_t aa_feed_residue;
-  uint32_t counter;
-  uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
-  uint64_t last_frame_us;
+  tA2DP_PACING pacing; /* pcm bytes to read each media task tick */
 } tA2DP_SBC_FEEDING_STATE;
 
 typedef struct {
@@ -106,6 +104,7 @@ typedef struct {
   SBC_ENC_PARAMS sbc_encoder_params;
   tA2DP_FEEDING_PARAMS feeding_params;
   tA2DP_SBC_FEEDING_STATE feeding_state;
+  tA2DP_RESAMPLER resampler; /* used when the feeding and SBC rates differ */
   int16_t pcmBuffer[SBC_MAX_PCM_BUFFER_SIZE];
 
   a2dp_sbc_encoder_stats_t stats;
@@ -125,6 +124,7 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
                                              uint64_t timestamp_us);
 static uint8_t calculate_max_frames_per_packet(void);
 static uint16_t a2dp_sbc_source_rate(void);
+static uint32_t a2dp_sbc_get_sampling_rate(void);
 static uint32_t a2dp_sbc_frame_length(void);
 
 bool A2DP_LoadEncoderSbc(void) {
@@ -140,6 +140,7 @@ void a2dp_sbc_encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
                            A2dpCodecConfig* a2dp_codec_config,
                            a2dp_source_read_callback_t read_callback,
                            a2dp_source_enqueue_callback_t enqueue_callback) {
+  a2dp_resampler_cleanup(&a2dp_sbc_encoder_cb.resampler);
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 
   a2dp_sbc_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
@@ -368,12 +369,24 @@ static void a2dp_sbc_encoder_update(uint16_t peer_mtu,
   LOG_DEBUG(LOG_TAG, "%s: final bit rate %d, final bit pool %d", __func__,
             p_encoder_params->u16BitRate, p_encoder_params->s16BitPool);
 
+  /* Convert the feeding PCM if it is not at the SBC sampling rate */
+  uint32_t sbc_sampling = a2dp_sbc_get_sampling_rate();
+  a2dp_resampler_cleanup(&a2dp_sbc_encoder_cb.resampler);
+  if (sbc_sampling != p_feeding_params->sample_rate &&
+      !a2dp_resampler_init(&a2dp_sbc_encoder_cb.resampler,
+                           p_feeding_params->sample_rate, sbc_sampling,
+                           p_feeding_params->channel_count)) {
+    LOG_ERROR(LOG_TAG, "%s: cannot convert the PCM from %u Hz to %u Hz",
+              __func__, p_feeding_params->sample_rate, sbc_sampling);
+  }
+
   /* Reset entirely the SBC encoder */
   SBC_Encoder_Init(&a2dp_sbc_encoder_cb.sbc_encoder_params);
   a2dp_sbc_encoder_cb.tx_sbc_frames = calculate_max_frames_per_packet();
 }
 
 void a2dp_sbc_encoder_cleanup(void) {
+  a2dp_resampler_cleanup(&a2dp_sbc_encoder_cb.resampler);
   memset(&a2dp_sbc_encoder_cb, 0, sizeof(a2dp_sbc_encoder_cb));
 }
 
@@ -382,20 +395,22 @@ void a2dp_sbc_feeding_reset(void) {
   memset(&a2dp_sbc_encoder_cb.feeding_state, 0,
          sizeof(a2dp_sbc_encoder_cb.feeding_state));
 
-  a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick =
-      (a2dp_sbc_encoder_cb.feeding_params.sample_rate *
-       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_sbc_encoder_cb.feeding_params.channel_count *
-       A2DP_SBC_ENCODER_INTERVAL_MS) /
-      1000;
+  a2dp_pacing_init(&a2dp_sbc_encoder_cb.feeding_state.pacing,
+                   a2dp_sbc_encoder_cb.feeding_params.sample_rate *
+                       a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8 *
+                       a2dp_sbc_encoder_cb.feeding_params.channel_count,
+                   A2DP_SBC_ENCODER_INTERVAL_MS * 1000);
+  a2dp_resampler_reset(&a2dp_sbc_encoder_cb.resampler);
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick);
+            a2dp_pacing_get_bytes_per_tick(
+                &a2dp_sbc_encoder_cb.feeding_state.pacing));
 }
 
 void a2dp_sbc_feeding_flush(void) {
-  a2dp_sbc_encoder_cb.feeding_state.counter = 0;
+  a2dp_pacing_flush(&a2dp_sbc_encoder_cb.feeding_state.pacing);
   a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+  a2dp_resampler_reset(&a2dp_sbc_encoder_cb.resampler);
 }
 
 period_ms_t a2dp_sbc_get_encoder_interval_ms(void) {
@@ -435,19 +450,10 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
-  uint32_t us_this_tick = A2DP_SBC_ENCODER_INTERVAL_MS * 1000;
-  uint64_t now_us = timestamp_us;
-  if (a2dp_sbc_encoder_cb.feeding_state.last_frame_us != 0)
-    us_this_tick = (now_us - a2dp_sbc_encoder_cb.feeding_state.last_frame_us);
-  a2dp_sbc_encoder_cb.feeding_state.last_frame_us = now_us;
-
-  a2dp_sbc_encoder_cb.feeding_state.counter +=
-      a2dp_sbc_encoder_cb.feeding_state.bytes_per_tick * us_this_tick /
-      (A2DP_SBC_ENCODER_INTERVAL_MS * 1000);
-
   /* Calculate the number of frames pending for this media tick */
   projected_nof =
-      a2dp_sbc_encoder_cb.feeding_state.counter / pcm_bytes_per_frame;
+      a2dp_pacing_update(&a2dp_sbc_encoder_cb.feeding_state.pacing,
+                         timestamp_us, pcm_bytes_per_frame);
   // Update the stats
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_frames += projected_nof;
 
@@ -486,8 +492,9 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
           LOG_ERROR(LOG_TAG, "%s: Audio Congestion (iterations:%d > max (%d))",
                     __func__, noi, A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK);
           noi = A2DP_SBC_MAX_PCM_ITER_NUM_PER_TICK;
-          a2dp_sbc_encoder_cb.feeding_state.counter =
-              noi * nof * pcm_bytes_per_frame;
+          a2dp_pacing_flush(&a2dp_sbc_encoder_cb.feeding_state.pacing);
+          a2dp_pacing_credit(&a2dp_sbc_encoder_cb.feeding_state.pacing,
+                             noi * nof * pcm_bytes_per_frame);
         }
         projected_nof = nof;
       } else {
@@ -509,12 +516,14 @@ static void a2dp_sbc_get_num_frame_iteration(uint8_t* num_of_iterations,
       a2dp_sbc_encoder_cb.stats.media_read_total_dropped_frames += delta;
 
       projected_nof = MAX_PCM_FRAME_NUM_PER_TICK;
-      a2dp_sbc_encoder_cb.feeding_state.counter =
-          noi * projected_nof * pcm_bytes_per_frame;
+      a2dp_pacing_flush(&a2dp_sbc_encoder_cb.feeding_state.pacing);
+      a2dp_pacing_credit(&a2dp_sbc_encoder_cb.feeding_state.pacing,
+                         noi * projected_nof * pcm_bytes_per_frame);
     }
     nof = projected_nof;
   }
-  a2dp_sbc_encoder_cb.feeding_state.counter -= noi * nof * pcm_bytes_per_frame;
+  a2dp_pacing_consume(&a2dp_sbc_encoder_cb.feeding_state.pacing, noi * nof,
+                      pcm_bytes_per_frame);
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
               __func__, nof, noi);
 
@@ -530,10 +539,8 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
 
   uint8_t last_frame_len = 0;
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(A2DP_SBC_BUFFER_SIZE);
-    p_buf->offset = A2DP_SBC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
+    BT_HDR* p_buf = A2DP_AllocEncoderPacket(A2DP_SBC_OFFSET,
+                                            a2dp_sbc_encoder_cb.TxAaMtuSize);
     a2dp_sbc_encoder_cb.stats.media_read_total_expected_packets++;
 
     do {
@@ -557,11 +564,12 @@ static void a2dp_sbc_encode_frames(uint8_t nb_frame) {
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d, %d", __func__, nb_frame,
                  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
-        a2dp_sbc_encoder_cb.feeding_state.counter +=
+        a2dp_pacing_credit(
+            &a2dp_sbc_encoder_cb.feeding_state.pacing,
             nb_frame * p_encoder_params->s16NumOfSubBands *
-            p_encoder_params->s16NumOfBlocks *
-            a2dp_sbc_encoder_cb.feeding_params.channel_count *
-            a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8;
+                p_encoder_params->s16NumOfBlocks *
+                a2dp_sbc_encoder_cb.feeding_params.channel_count *
+                a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
         /* no more pcm to read */
         nb_frame = 0;
       }
@@ -593,156 +601,50 @@ static bool a2dp_sbc_read_feeding(void) {
   uint16_t blocm_x_subband =
       p_encoder_params->s16NumOfSubBands * p_encoder_params->s16NumOfBlocks;
   uint32_t read_size;
-  uint32_t sbc_sampling = 48000;
-  uint32_t src_samples;
   uint16_t bytes_needed = blocm_x_subband * p_encoder_params->s16NumOfChannels *
                           a2dp_sbc_encoder_cb.feeding_params.bits_per_sample /
                           8;
-  static uint16_t up_sampled_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                                    SBC_MAX_NUM_OF_CHANNELS *
-                                    SBC_MAX_NUM_OF_SUBBANDS * 2];
-  static uint16_t read_buffer[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS *
-                              SBC_MAX_NUM_OF_CHANNELS *
-                              SBC_MAX_NUM_OF_SUBBANDS];
-  uint32_t src_size_used;
-  uint32_t dst_size_used;
-  bool fract_needed;
-  int32_t fract_max;
-  int32_t fract_threshold;
+  uint8_t* p_read_buf;
   uint32_t nb_byte_read;
 
-  /* Get the SBC sampling rate */
-  switch (p_encoder_params->s16SamplingFreq) {
-    case SBC_sf48000:
-      sbc_sampling = 48000;
-      break;
-    case SBC_sf44100:
-      sbc_sampling = 44100;
-      break;
-    case SBC_sf32000:
-      sbc_sampling = 32000;
-      break;
-    case SBC_sf16000:
-      sbc_sampling = 16000;
-      break;
-  }
-
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_reads_count++;
-  if (sbc_sampling == a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    read_size =
-        bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
-    a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(
-        ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
-            a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-        read_size);
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes +=
-        nb_byte_read;
-
-    if (nb_byte_read != read_size) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
-      return false;
-    }
-    a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
-    return true;
-  }
-
-  /*
-   * Some Feeding PCM frequencies require to split the number of sample
-   * to read.
-   * E.g 128 / 6 = 21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0
-   */
-  fract_needed = false; /* Default */
-  switch (a2dp_sbc_encoder_cb.feeding_params.sample_rate) {
-    case 32000:
-    case 8000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 0; /* Add one for the first */
-      break;
-    case 16000:
-      fract_needed = true;
-      fract_max = 2;       /* 0, 1 and 2 */
-      fract_threshold = 1; /* Add one for the first two frames*/
-      break;
-  }
-
-  /* Compute number of sample to read from source */
-  src_samples = blocm_x_subband;
-  src_samples *= a2dp_sbc_encoder_cb.feeding_params.sample_rate;
-  src_samples /= sbc_sampling;
-
-  /* The previous division may have a remainder not null */
-  if (fract_needed) {
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter <= fract_threshold) {
-      src_samples++; /* for every read before threshold add one sample */
-    }
-
-    /* do nothing if counter >= threshold */
-    a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter++; /* one more read */
-    if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter > fract_max) {
-      a2dp_sbc_encoder_cb.feeding_state.aa_feed_counter = 0;
-    }
-  }
-
-  /* Compute number of bytes to read from source */
-  read_size = src_samples;
-  read_size *= a2dp_sbc_encoder_cb.feeding_params.channel_count;
-  read_size *= (a2dp_sbc_encoder_cb.feeding_params.bits_per_sample / 8);
+  read_size = bytes_needed - a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
   a2dp_sbc_encoder_cb.stats.media_read_total_expected_read_bytes += read_size;
-
-  /* Read Data from UIPC channel */
-  nb_byte_read =
-      a2dp_sbc_encoder_cb.read_callback((uint8_t*)read_buffer, read_size);
+  p_read_buf = ((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer) +
+               a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue;
+  if (a2dp_sbc_encoder_cb.resampler.coefs != NULL) {
+    /* Re-sample the PCM to the SBC sampling rate */
+    nb_byte_read =
+        a2dp_resampler_read(&a2dp_sbc_encoder_cb.resampler,
+                            a2dp_sbc_encoder_cb.read_callback, p_read_buf,
+                            read_size);
+  } else {
+    nb_byte_read = a2dp_sbc_encoder_cb.read_callback(p_read_buf, read_size);
+  }
   a2dp_sbc_encoder_cb.stats.media_read_total_actual_read_bytes += nb_byte_read;
 
-  if (nb_byte_read < read_size) {
-    if (nb_byte_read == 0) return false;
-
-    /* Fill the unfilled part of the read buffer with silence (0) */
-    memset(((uint8_t*)read_buffer) + nb_byte_read, 0, read_size - nb_byte_read);
-    nb_byte_read = read_size;
+  if (nb_byte_read != read_size) {
+    a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += nb_byte_read;
+    return false;
   }
   a2dp_sbc_encoder_cb.stats.media_read_total_actual_reads_count++;
+  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue = 0;
+  return true;
+}
 
-  /* Initialize PCM up-sampling engine */
-  a2dp_sbc_init_up_sample(a2dp_sbc_encoder_cb.feeding_params.sample_rate,
-                          sbc_sampling,
-                          a2dp_sbc_encoder_cb.feeding_params.bits_per_sample,
-                          a2dp_sbc_encoder_cb.feeding_params.channel_count);
-
-  /*
-   * Re-sample the read buffer.
-   * The output PCM buffer will be stereo, 16 bit per sample.
-   */
-  dst_size_used = a2dp_sbc_up_sample(
-      (uint8_t*)read_buffer,
-      (uint8_t*)up_sampled_buffer +
-          a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      nb_byte_read, sizeof(up_sampled_buffer) -
-                        a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue,
-      &src_size_used);
-
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue += dst_size_used;
-
-  /* only copy the pcm sample when we have up-sampled enough PCM */
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue < bytes_needed)
-    return false;
-
-  /* Copy the output pcm samples in SBC encoding buffer */
-  memcpy((uint8_t*)a2dp_sbc_encoder_cb.pcmBuffer, (uint8_t*)up_sampled_buffer,
-         bytes_needed);
-  /* update the residue */
-  a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue -= bytes_needed;
-
-  if (a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue != 0) {
-    memcpy((uint8_t*)up_sampled_buffer,
-           (uint8_t*)up_sampled_buffer + bytes_needed,
-           a2dp_sbc_encoder_cb.feeding_state.aa_feed_residue);
+// Returns the SBC sampling rate in Hz.
+static uint32_t a2dp_sbc_get_sampling_rate(void) {
+  switch (a2dp_sbc_encoder_cb.sbc_encoder_params.s16SamplingFreq) {
+    case SBC_sf16000:
+      return 16000;
+    case SBC_sf32000:
+      return 32000;
+    case SBC_sf44100:
+      return 44100;
+    case SBC_sf48000:
+    default:
+      return 48000;
   }
-  return true;
 }
 
 static uint8_t calculate_max_frames_per_packet(void) {
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_silence"
+
+#include "a2dp_silence.h"
+
+#include <string.h>
+
+#include "osi/include/log.h"
+
+// The PCM is scanned by chunks of this many 64-bit words, OR-ed together
+// without any branch so that the compiler vectorizes the loop (NEON, SSE2).
+#define A2DP_SILENCE_CHUNK_WORDS 8
+
+void a2dp_silence_init(tA2DP_SILENCE* p_silence, uint32_t bytes_per_second,
+                       uint32_t threshold_ms) {
+  memset(p_silence, 0, sizeof(*p_silence));
+  p_silence->threshold_bytes = (uint64_t)bytes_per_second * threshold_ms / 1000;
+}
+
+bool a2dp_silence_proc(tA2DP_SILENCE* p_silence, const uint8_t* p_pcm,
+                       size_t len) {
+  if (!a2dp_silence_is_pcm_silent(p_pcm, len)) {
+    if (p_silence->is_silent) {
+      LOG_DEBUG(LOG_TAG, "%s: silence ended after %llu octets", __func__,
+                (unsigned long long)p_silence->silent_bytes);
+    }
+    p_silence->silent_bytes = 0;
+    p_silence->is_silent = false;
+    return false;
+  }
+
+  p_silence->silent_bytes += len;
+  if (!p_silence->is_silent &&
+      p_silence->silent_bytes >= p_silence->threshold_bytes) {
+    LOG_DEBUG(LOG_TAG, "%s: silence started", __func__);
+    p_silence->is_silent = true;
+    p_silence->silences++;
+  }
+  return p_silence->is_silent;
+}
+
+bool a2dp_silence_is_pcm_silent(const uint8_t* p_pcm, size_t len) {
+  const size_t chunk_size = A2DP_SILENCE_CHUNK_WORDS * sizeof(uint64_t);
+  size_t i = 0;
+
+  for (; i + chunk_size <= len; i += chunk_size) {
+    uint64_t words[A2DP_SILENCE_CHUNK_WORDS];
+    uint64_t acc = 0;
+    memcpy(words, p_pcm + i, chunk_size);  // |p_pcm| may not be aligned
+    for (size_t j = 0; j < A2DP_SILENCE_CHUNK_WORDS; j++) acc |= words[j];
+    if (acc != 0) return false;
+  }
+  for (; i < len; i++) {
+    if (p_pcm[i] != 0) return false;
+  }
+  return true;
+}
@@ -66,9 +66,14 @@ bool A2DP_IsVendorSourceCodecValid(const uint8_t* p_codec_info) {
   return false;
 }
 
-bool A2DP_IsVendorSinkCodecValid(UNUSED_ATTR const uint8_t* p_codec_info) {
-  // uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
-  // uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+bool A2DP_IsVendorSinkCodecValid(const uint8_t* p_codec_info) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_IsVendorSinkCodecValidLhdc(p_codec_info);
+  }
 
   // Add checks based on <vendor_id, codec_id>
   // NOTE: Should be done only for local Sink codecs.
@@ -123,9 +128,14 @@ bool A2DP_IsVendorPeerSinkCodecValid(const uint8_t* p_codec_info) {
   return false;
 }
 
-bool A2DP_IsVendorSinkCodecSupported(UNUSED_ATTR const uint8_t* p_codec_info) {
-  // uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
-  // uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+bool A2DP_IsVendorSinkCodecSupported(const uint8_t* p_codec_info) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_IsVendorSinkCodecSupportedLhdc(p_codec_info);
+  }
 
   // Add checks based on <vendor_id, codec_id>
   // NOTE: Should be done only for local Sink codecs.
@@ -459,10 +469,14 @@ int A2DP_VendorGetTrackChannelCount(const uint8_t* p_codec_info) {
   return -1;
 }
 
-int A2DP_VendorGetSinkTrackChannelType(
-    UNUSED_ATTR const uint8_t* p_codec_info) {
-  // uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
-  // uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+int A2DP_VendorGetSinkTrackChannelType(const uint8_t* p_codec_info) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_VendorGetSinkTrackChannelTypeLhdc(p_codec_info);
+  }
 
   // Add checks based on <vendor_id, codec_id>
   // NOTE: Should be done only for local Sink codecs.
@@ -470,11 +484,16 @@ int A2DP_VendorGetSinkTrackChannelType(
   return -1;
 }
 
-int A2DP_VendorGetSinkFramesCountToProcess(
-    UNUSED_ATTR uint64_t time_interval_ms,
-    UNUSED_ATTR const uint8_t* p_codec_info) {
-  // uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
-  // uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+int A2DP_VendorGetSinkFramesCountToProcess(uint64_t time_interval_ms,
+                                           const uint8_t* p_codec_info) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_VendorGetSinkFramesCountToProcessLhdc(time_interval_ms,
+                                                      p_codec_info);
+  }
 
   // Add checks based on <vendor_id, codec_id>
   // NOTE: Should be done only for local Sink codecs.
@@ -563,6 +582,48 @@ bool A2DP_VendorBuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
   return false;
 }
 
+bool A2DP_VendorPacketEndsFrame(const uint8_t* p_codec_info,
+                                const BT_HDR* p_buf) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_VendorPacketEndsFrameLhdc(p_codec_info, p_buf);
+  }
+
+  // Check for LHDC_LL
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_LL_CODEC_ID) {
+    return A2DP_VendorPacketEndsFrameLhdcLL(p_codec_info, p_buf);
+  }
+
+  // Add checks based on <vendor_id, codec_id>
+
+  // Other codecs do not fragment their frames
+  return true;
+}
+
+bool A2DP_VendorMergePackets(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                             const BT_HDR* p_next, uint16_t max_len) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_VendorMergePacketsLhdc(p_codec_info, p_buf, p_next, max_len);
+  }
+
+  // Check for LHDC_LL
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_LL_CODEC_ID) {
+    return A2DP_VendorMergePacketsLhdcLL(p_codec_info, p_buf, p_next,
+                                         max_len);
+  }
+
+  // Add checks based on <vendor_id, codec_id>
+
+  return false;
+}
+
 const tA2DP_ENCODER_INTERFACE* A2DP_VendorGetEncoderInterface(
     const uint8_t* p_codec_info) {
   uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
@@ -600,6 +661,21 @@ const tA2DP_ENCODER_INTERFACE* A2DP_VendorGetEncoderInterface(
   return NULL;
 }
 
+const tA2DP_DECODER_INTERFACE* A2DP_VendorGetDecoderInterface(
+    const uint8_t* p_codec_info) {
+  uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
+  uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
+
+  // Check for LHDC
+  if (vendor_id == A2DP_LHDC_VENDOR_ID && codec_id == A2DP_LHDC_CODEC_ID) {
+    return A2DP_VendorGetDecoderInterfaceLhdc(p_codec_info);
+  }
+
+  // Add checks based on <vendor_id, codec_id>
+
+  return NULL;
+}
+
 bool A2DP_VendorAdjustCodec(uint8_t* p_codec_info) {
   uint32_t vendor_id = A2DP_VendorCodecGetVendorId(p_codec_info);
   uint16_t codec_id = A2DP_VendorCodecGetCodecId(p_codec_info);
@@ -25,6 +25,7 @@
 
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx.h"
+#include "a2dp_vendor_aptx_pcm.h"
 #include "bt_common.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -61,7 +62,14 @@ static tAPTX_ENCODER_SIZEOF_PARAMS aptx_encoder_sizeof_params_func;
 #define A2DP_APTX_OFFSET (AVDT_MEDIA_OFFSET - AVDT_MEDIA_HDR_SIZE)
 #endif
 
-#define A2DP_APTX_MAX_PCM_BYTES_PER_READ 1024
+// The PCM octets read for a packet, a multiple of the 16 octets of the 4
+// stereo frames encoded by each call to the library. The framing reads at
+// most 12 times 240 octets.
+#define A2DP_APTX_MAX_PCM_BYTES_PER_TICK 4096
+#define A2DP_APTX_MAX_PCM_FRAMES_PER_TICK (A2DP_APTX_MAX_PCM_BYTES_PER_TICK / 4)
+
+// The delay of the aptX QMF analysis filters, in samples
+#define A2DP_APTX_ENCODER_LOOKAHEAD_SAMPLES 90
 
 typedef struct {
   uint64_t sleep_time_ns;
@@ -108,8 +116,7 @@ static void a2dp_vendor_aptx_encoder_update(uint16_t peer_mtu,
                                             bool* p_config_updated);
 static void aptx_init_framing_params(tAPTX_FRAMING_PARAMS* framing_params);
 static void aptx_update_framing_params(tAPTX_FRAMING_PARAMS* framing_params);
-static size_t aptx_encode_16bit(tAPTX_FRAMING_PARAMS* framing_params,
-                                size_t* data_out_index, uint16_t* data16_in,
+static size_t aptx_encode_16bit(const uint16_t* data16_in, size_t frames,
                                 uint8_t* data_out);
 
 bool A2DP_VendorLoadEncoderAptx(void) {
@@ -377,33 +384,38 @@ period_ms_t a2dp_vendor_aptx_get_encoder_interval_ms(void) {
 void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   tAPTX_FRAMING_PARAMS* framing_params = &a2dp_aptx_encoder_cb.framing_params;
 
+  aptx_update_framing_params(framing_params);
+
   // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-  p_buf->offset = A2DP_APTX_OFFSET;
-  p_buf->len = 0;
-  p_buf->layer_specific = 0;
+  BT_HDR* p_buf =
+      A2DP_AllocEncoderPacket(A2DP_APTX_OFFSET, framing_params->aptx_bytes);
 
   uint8_t* encoded_ptr = (uint8_t*)(p_buf + 1);
   encoded_ptr += p_buf->offset;
 
-  aptx_update_framing_params(framing_params);
-
   //
   // Read the PCM data and encode it
   //
   LOG_VERBOSE(LOG_TAG, "%s: %u PCM reads of size %u", __func__,
               framing_params->pcm_reads, framing_params->pcm_bytes_per_read);
-  size_t encoded_ptr_index = 0;
-  size_t pcm_bytes_encoded = 0;
+  size_t pcm_bytes_read_total = 0;
+  size_t pcm_reads = framing_params->pcm_reads;
+  if (pcm_reads * framing_params->pcm_bytes_per_read >
+      A2DP_APTX_MAX_PCM_BYTES_PER_TICK) {
+    pcm_reads =
+        A2DP_APTX_MAX_PCM_BYTES_PER_TICK / framing_params->pcm_bytes_per_read;
+  }
   a2dp_aptx_encoder_cb.stats.media_read_total_expected_packets++;
   a2dp_aptx_encoder_cb.stats.media_read_total_expected_reads_count +=
       framing_params->pcm_reads;
   a2dp_aptx_encoder_cb.stats.media_read_total_expected_read_bytes +=
       framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
-  for (size_t reads = 0; reads < framing_params->pcm_reads; reads++) {
-    uint16_t read_buffer16[A2DP_APTX_MAX_PCM_BYTES_PER_READ / sizeof(uint16_t)];
+  // The reads of the packet are gathered, then encoded at once
+  uint16_t read_buffer16[A2DP_APTX_MAX_PCM_BYTES_PER_TICK / sizeof(uint16_t)];
+  for (size_t reads = 0; reads < pcm_reads; reads++) {
     size_t pcm_bytes_read = a2dp_aptx_encoder_cb.read_callback(
-        (uint8_t*)read_buffer16, framing_params->pcm_bytes_per_read);
+        (uint8_t*)read_buffer16 + pcm_bytes_read_total,
+        framing_params->pcm_bytes_per_read);
     a2dp_aptx_encoder_cb.stats.media_read_total_actual_read_bytes +=
         pcm_bytes_read;
     if (pcm_bytes_read < framing_params->pcm_bytes_per_read) {
@@ -415,9 +427,10 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
       break;
     }
     a2dp_aptx_encoder_cb.stats.media_read_total_actual_reads_count++;
-    pcm_bytes_encoded += aptx_encode_16bit(framing_params, &encoded_ptr_index,
-                                           read_buffer16, encoded_ptr);
+    pcm_bytes_read_total += pcm_bytes_read;
   }
+  size_t pcm_bytes_encoded =
+      aptx_encode_16bit(read_buffer16, pcm_bytes_read_total / 4, encoded_ptr);
 
   // Compute the number of encoded bytes
   const int COMPRESSION_RATIO = 4;
@@ -442,43 +455,41 @@ void a2dp_vendor_aptx_send_frames(uint64_t timestamp_us) {
   }
 }
 
-static size_t aptx_encode_16bit(tAPTX_FRAMING_PARAMS* framing_params,
-                                size_t* data_out_index, uint16_t* data16_in,
+// Encodes the |frames| stereo frames of |data16_in| into |data_out|, 4 octets
+// for each group of 4 frames. Returns the number of PCM octets encoded.
+static size_t aptx_encode_16bit(const uint16_t* data16_in, size_t frames,
                                 uint8_t* data_out) {
-  size_t pcm_bytes_encoded = 0;
-  size_t frame = 0;
-
-  for (size_t aptx_samples = 0;
-       aptx_samples < framing_params->pcm_bytes_per_read / 16; aptx_samples++) {
-    uint32_t pcmL[4];
-    uint32_t pcmR[4];
-    uint16_t encoded_sample[2];
-
-    for (size_t i = 0, j = frame; i < 4; i++, j++) {
-      pcmL[i] = (uint16_t) * (data16_in + (2 * j));
-      pcmR[i] = (uint16_t) * (data16_in + ((2 * j) + 1));
-    }
-
-    aptx_encoder_encode_stereo_func(a2dp_aptx_encoder_cb.aptx_encoder_state,
-                                    &pcmL, &pcmR, &encoded_sample);
+  uint32_t pcmL[A2DP_APTX_MAX_PCM_FRAMES_PER_TICK];
+  uint32_t pcmR[A2DP_APTX_MAX_PCM_FRAMES_PER_TICK];
+  tAPTX_ENCODER_ENCODE_STEREO encode_stereo = aptx_encoder_encode_stereo_func;
+  void* state = a2dp_aptx_encoder_cb.aptx_encoder_state;
 
-    data_out[*data_out_index + 0] = (uint8_t)((encoded_sample[0] >> 8) & 0xff);
-    data_out[*data_out_index + 1] = (uint8_t)((encoded_sample[0] >> 0) & 0xff);
-    data_out[*data_out_index + 2] = (uint8_t)((encoded_sample[1] >> 8) & 0xff);
-    data_out[*data_out_index + 3] = (uint8_t)((encoded_sample[1] >> 0) & 0xff);
+  frames -= frames % 4;
+  a2dp_aptx_deinterleave_16(data16_in, frames, pcmL, pcmR);
 
-    frame += 4;
-    pcm_bytes_encoded += 16;
-    *data_out_index += 4;
+  for (size_t frame = 0; frame < frames; frame += 4) {
+    uint16_t encoded_sample[2];
+    encode_stereo(state, &pcmL[frame], &pcmR[frame], &encoded_sample);
+    data_out[0] = (uint8_t)((encoded_sample[0] >> 8) & 0xff);
+    data_out[1] = (uint8_t)((encoded_sample[0] >> 0) & 0xff);
+    data_out[2] = (uint8_t)((encoded_sample[1] >> 8) & 0xff);
+    data_out[3] = (uint8_t)((encoded_sample[1] >> 0) & 0xff);
+    data_out += 4;
   }
 
-  return pcm_bytes_encoded;
+  return frames * 4;
 }
 
 period_ms_t A2dpCodecConfigAptx::encoderIntervalMs() const {
   return a2dp_vendor_aptx_get_encoder_interval_ms();
 }
 
+uint64_t A2dpCodecConfigAptx::encoderLookaheadUs() const {
+  uint32_t sample_rate = a2dp_aptx_encoder_cb.feeding_params.sample_rate;
+  if (sample_rate == 0) return 0;
+  return (uint64_t)A2DP_APTX_ENCODER_LOOKAHEAD_SAMPLES * 1000000 / sample_rate;
+}
+
 void A2dpCodecConfigAptx::debug_codec_dump(int fd) {
   a2dp_aptx_encoder_stats_t* stats = &a2dp_aptx_encoder_cb.stats;
 
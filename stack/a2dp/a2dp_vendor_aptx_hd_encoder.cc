@@ -25,6 +25,7 @@
 
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_aptx_hd.h"
+#include "a2dp_vendor_aptx_pcm.h"
 #include "bt_common.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -61,7 +62,15 @@ static tAPTX_HD_ENCODER_SIZEOF_PARAMS aptx_hd_encoder_sizeof_params_func;
 #define A2DP_APTX_HD_OFFSET AVDT_MEDIA_OFFSET
 #endif
 
-#define A2DP_APTX_HD_MAX_PCM_BYTES_PER_READ 1024
+// The PCM octets read for a packet, a multiple of the 24 octets of the 4
+// stereo frames encoded by each call to the library. The framing reads at
+// most 108 times 24 octets.
+#define A2DP_APTX_HD_MAX_PCM_BYTES_PER_TICK 4096
+#define A2DP_APTX_HD_MAX_PCM_FRAMES_PER_TICK \
+  (A2DP_APTX_HD_MAX_PCM_BYTES_PER_TICK / 6)
+
+// The delay of the aptX HD QMF analysis filters, in samples
+#define A2DP_APTX_HD_ENCODER_LOOKAHEAD_SAMPLES 90
 
 typedef struct {
   uint64_t sleep_time_ns;
@@ -108,8 +117,7 @@ static void aptx_hd_init_framing_params(
     tAPTX_HD_FRAMING_PARAMS* framing_params);
 static void aptx_hd_update_framing_params(
     tAPTX_HD_FRAMING_PARAMS* framing_params);
-static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
-                                   size_t* data_out_index, uint32_t* data32_in,
+static size_t aptx_hd_encode_24bit(const uint8_t* data_in, size_t frames,
                                    uint8_t* data_out);
 
 bool A2DP_VendorLoadEncoderAptxHd(void) {
@@ -362,34 +370,38 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   tAPTX_HD_FRAMING_PARAMS* framing_params =
       &a2dp_aptx_hd_encoder_cb.framing_params;
 
+  aptx_hd_update_framing_params(framing_params);
+
   // Prepare the packet to send
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-  p_buf->offset = A2DP_APTX_HD_OFFSET;
-  p_buf->len = 0;
-  p_buf->layer_specific = 0;
+  BT_HDR* p_buf = A2DP_AllocEncoderPacket(A2DP_APTX_HD_OFFSET,
+                                          framing_params->aptx_hd_bytes);
 
   uint8_t* encoded_ptr = (uint8_t*)(p_buf + 1);
   encoded_ptr += p_buf->offset;
 
-  aptx_hd_update_framing_params(framing_params);
-
   //
   // Read the PCM data and encode it
   //
   LOG_VERBOSE(LOG_TAG, "%s: %u PCM reads of size %u", __func__,
               framing_params->pcm_reads, framing_params->pcm_bytes_per_read);
-  size_t encoded_ptr_index = 0;
-  size_t pcm_bytes_encoded = 0;
+  size_t pcm_bytes_read_total = 0;
+  size_t pcm_reads = framing_params->pcm_reads;
+  if (pcm_reads * framing_params->pcm_bytes_per_read >
+      A2DP_APTX_HD_MAX_PCM_BYTES_PER_TICK) {
+    pcm_reads = A2DP_APTX_HD_MAX_PCM_BYTES_PER_TICK /
+                framing_params->pcm_bytes_per_read;
+  }
   a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_packets++;
   a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_reads_count +=
       framing_params->pcm_reads;
   a2dp_aptx_hd_encoder_cb.stats.media_read_total_expected_read_bytes +=
       framing_params->pcm_reads * framing_params->pcm_bytes_per_read;
-  for (size_t reads = 0; reads < framing_params->pcm_reads; reads++) {
-    uint32_t
-        read_buffer32[A2DP_APTX_HD_MAX_PCM_BYTES_PER_READ / sizeof(uint32_t)];
+  // The reads of the packet are gathered, then encoded at once
+  uint8_t read_buffer[A2DP_APTX_HD_MAX_PCM_BYTES_PER_TICK];
+  for (size_t reads = 0; reads < pcm_reads; reads++) {
     size_t pcm_bytes_read = a2dp_aptx_hd_encoder_cb.read_callback(
-        (uint8_t*)read_buffer32, framing_params->pcm_bytes_per_read);
+        read_buffer + pcm_bytes_read_total,
+        framing_params->pcm_bytes_per_read);
     a2dp_aptx_hd_encoder_cb.stats.media_read_total_actual_read_bytes +=
         pcm_bytes_read;
     if (pcm_bytes_read < framing_params->pcm_bytes_per_read) {
@@ -401,9 +413,10 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
       break;
     }
     a2dp_aptx_hd_encoder_cb.stats.media_read_total_actual_reads_count++;
-    pcm_bytes_encoded += aptx_hd_encode_24bit(
-        framing_params, &encoded_ptr_index, read_buffer32, encoded_ptr);
+    pcm_bytes_read_total += pcm_bytes_read;
   }
+  size_t pcm_bytes_encoded =
+      aptx_hd_encode_24bit(read_buffer, pcm_bytes_read_total / 6, encoded_ptr);
 
   // Compute the number of encoded bytes
   const int COMPRESSION_RATIO = 4;
@@ -429,51 +442,49 @@ void a2dp_vendor_aptx_hd_send_frames(uint64_t timestamp_us) {
   }
 }
 
-static size_t aptx_hd_encode_24bit(tAPTX_HD_FRAMING_PARAMS* framing_params,
-                                   size_t* data_out_index, uint32_t* data32_in,
+// Encodes the |frames| stereo frames of packed 24-bit PCM of |data_in| into
+// |data_out|, 6 octets for each group of 4 frames. Returns the number of PCM
+// octets encoded.
+static size_t aptx_hd_encode_24bit(const uint8_t* data_in, size_t frames,
                                    uint8_t* data_out) {
-  size_t pcm_bytes_encoded = 0;
-  const uint8_t* p = (const uint8_t*)(data32_in);
-
-  for (size_t aptx_hd_samples = 0;
-       aptx_hd_samples < framing_params->pcm_bytes_per_read / 24;
-       aptx_hd_samples++) {
-    uint32_t pcmL[4];
-    uint32_t pcmR[4];
+  uint32_t pcmL[A2DP_APTX_HD_MAX_PCM_FRAMES_PER_TICK];
+  uint32_t pcmR[A2DP_APTX_HD_MAX_PCM_FRAMES_PER_TICK];
+  tAPTX_HD_ENCODER_ENCODE_STEREO encode_stereo =
+      aptx_hd_encoder_encode_stereo_func;
+  void* state = a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state;
+
+  // Expand from AUDIO_FORMAT_PCM_24_BIT_PACKED data (3 bytes per sample)
+  // into AUDIO_FORMAT_PCM_8_24_BIT (4 bytes per sample).
+  frames -= frames % 4;
+  a2dp_aptx_deinterleave_24(data_in, frames, pcmL, pcmR);
+
+  for (size_t frame = 0; frame < frames; frame += 4) {
     uint32_t encoded_sample[2];
-
-    // Expand from AUDIO_FORMAT_PCM_24_BIT_PACKED data (3 bytes per sample)
-    // into AUDIO_FORMAT_PCM_8_24_BIT (4 bytes per sample).
-    for (size_t i = 0; i < 4; i++) {
-      pcmL[i] = ((p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16));
-      p += 3;
-      pcmR[i] = ((p[0] << 0) | (p[1] << 8) | (((int8_t)p[2]) << 16));
-      p += 3;
-    }
-
-    aptx_hd_encoder_encode_stereo_func(
-        a2dp_aptx_hd_encoder_cb.aptx_hd_encoder_state, &pcmL, &pcmR,
-        &encoded_sample);
-
+    encode_stereo(state, &pcmL[frame], &pcmR[frame], &encoded_sample);
     uint8_t* encoded_ptr = (uint8_t*)&encoded_sample[0];
-    data_out[*data_out_index + 0] = *(encoded_ptr + 2);
-    data_out[*data_out_index + 1] = *(encoded_ptr + 1);
-    data_out[*data_out_index + 2] = *(encoded_ptr + 0);
-    data_out[*data_out_index + 3] = *(encoded_ptr + 6);
-    data_out[*data_out_index + 4] = *(encoded_ptr + 5);
-    data_out[*data_out_index + 5] = *(encoded_ptr + 4);
-
-    pcm_bytes_encoded += 24;
-    *data_out_index += 6;
+    data_out[0] = *(encoded_ptr + 2);
+    data_out[1] = *(encoded_ptr + 1);
+    data_out[2] = *(encoded_ptr + 0);
+    data_out[3] = *(encoded_ptr + 6);
+    data_out[4] = *(encoded_ptr + 5);
+    data_out[5] = *(encoded_ptr + 4);
+    data_out += 6;
   }
 
-  return pcm_bytes_encoded;
+  return frames * 6;
 }
 
 period_ms_t A2dpCodecConfigAptxHd::encoderIntervalMs() const {
   return a2dp_vendor_aptx_hd_get_encoder_interval_ms();
 }
 
+uint64_t A2dpCodecConfigAptxHd::encoderLookaheadUs() const {
+  uint32_t sample_rate = a2dp_aptx_hd_encoder_cb.feeding_params.sample_rate;
+  if (sample_rate == 0) return 0;
+  return (uint64_t)A2DP_APTX_HD_ENCODER_LOOKAHEAD_SAMPLES * 1000000 /
+         sample_rate;
+}
+
 void A2dpCodecConfigAptxHd::debug_codec_dump(int fd) {
   a2dp_aptx_hd_encoder_stats_t* stats = &a2dp_aptx_hd_encoder_cb.stats;
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "a2dp_vendor_aptx_pcm.h"
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#define A2DP_APTX_PCM_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define A2DP_APTX_PCM_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define A2DP_APTX_PCM_SSSE3
+#endif
+#endif
+
+void a2dp_aptx_deinterleave_16(const uint16_t* p_pcm, size_t frames,
+                               uint32_t* p_left, uint32_t* p_right) {
+  size_t i = 0;
+
+#if defined(A2DP_APTX_PCM_NEON)
+  for (; i + 8 <= frames; i += 8) {
+    uint16x8x2_t x = vld2q_u16(p_pcm + 2 * i);
+    vst1q_u32(p_left + i, vmovl_u16(vget_low_u16(x.val[0])));
+    vst1q_u32(p_left + i + 4, vmovl_u16(vget_high_u16(x.val[0])));
+    vst1q_u32(p_right + i, vmovl_u16(vget_low_u16(x.val[1])));
+    vst1q_u32(p_right + i + 4, vmovl_u16(vget_high_u16(x.val[1])));
+  }
+#elif defined(A2DP_APTX_PCM_SSE2)
+  // Read as 32-bit words, each frame has the left sample in its low half
+  // and the right sample in its high half.
+  const __m128i low_mask = _mm_set1_epi32(0xffff);
+  for (; i + 4 <= frames; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(p_pcm + 2 * i));
+    _mm_storeu_si128((__m128i*)(p_left + i), _mm_and_si128(x, low_mask));
+    _mm_storeu_si128((__m128i*)(p_right + i), _mm_srli_epi32(x, 16));
+  }
+#endif
+
+  for (; i < frames; i++) {
+    p_left[i] = p_pcm[2 * i];
+    p_right[i] = p_pcm[2 * i + 1];
+  }
+}
+
+// Returns the packed 24-bit sample at |p|, sign-extended to 32 bits.
+static uint32_t unpack_24(const uint8_t* p) {
+  return (uint32_t)(p[0] | (p[1] << 8) | (((int8_t)p[2]) << 16));
+}
+
+void a2dp_aptx_deinterleave_24(const uint8_t* p_pcm, size_t frames,
+                               uint32_t* p_left, uint32_t* p_right) {
+  size_t i = 0;
+
+#if defined(A2DP_APTX_PCM_NEON)
+  for (; i + 8 <= frames; i += 8) {
+    // The three bytes of 16 samples, alternating left and right
+    uint8x16x3_t x = vld3q_u8(p_pcm + 6 * i);
+    uint8x16x2_t b0 = vuzpq_u8(x.val[0], x.val[0]);
+    uint8x16x2_t b1 = vuzpq_u8(x.val[1], x.val[1]);
+    uint8x16x2_t b2 = vuzpq_u8(x.val[2], x.val[2]);
+    uint32_t* p_out[2] = {p_left + i, p_right + i};
+    for (int ch = 0; ch < 2; ch++) {
+      uint16x8_t lo = vorrq_u16(vmovl_u8(vget_low_u8(b0.val[ch])),
+                                vshll_n_u8(vget_low_u8(b1.val[ch]), 8));
+      int16x8_t hi = vmovl_s8(vreinterpret_s8_u8(vget_low_u8(b2.val[ch])));
+      uint32x4_t s0 =
+          vorrq_u32(vreinterpretq_u32_s32(vshll_n_s16(vget_low_s16(hi), 16)),
+                    vmovl_u16(vget_low_u16(lo)));
+      uint32x4_t s1 =
+          vorrq_u32(vreinterpretq_u32_s32(vshll_n_s16(vget_high_s16(hi), 16)),
+                    vmovl_u16(vget_high_u16(lo)));
+      vst1q_u32(p_out[ch], s0);
+      vst1q_u32(p_out[ch] + 4, s1);
+    }
+  }
+#elif defined(A2DP_APTX_PCM_SSSE3)
+  // Moves the three bytes of each sample to the top of a 32-bit lane, for
+  // an arithmetic shift to sign-extend them. The first load holds frames 0
+  // and 1, the second one, 8 octets later, frames 2 and 3, so that neither
+  // reads past the 4 frames.
+  const __m128i left_lo =
+      _mm_setr_epi8(-1, 0, 1, 2, -1, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i left_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, 4,
+                                        5, 6, -1, 10, 11, 12);
+  const __m128i right_lo = _mm_setr_epi8(-1, 3, 4, 5, -1, 9, 10, 11, -1, -1,
+                                         -1, -1, -1, -1, -1, -1);
+  const __m128i right_hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         7, 8, 9, -1, 13, 14, 15);
+  for (; i + 4 <= frames; i += 4) {
+    const uint8_t* p = p_pcm + 6 * i;
+    __m128i a = _mm_loadu_si128((const __m128i*)p);
+    __m128i b = _mm_loadu_si128((const __m128i*)(p + 8));
+    __m128i left = _mm_or_si128(_mm_shuffle_epi8(a, left_lo),
+                                _mm_shuffle_epi8(b, left_hi));
+    __m128i right = _mm_or_si128(_mm_shuffle_epi8(a, right_lo),
+                                 _mm_shuffle_epi8(b, right_hi));
+    _mm_storeu_si128((__m128i*)(p_left + i), _mm_srai_epi32(left, 8));
+    _mm_storeu_si128((__m128i*)(p_right + i), _mm_srai_epi32(right, 8));
+  }
+#endif
+
+  for (; i < frames; i++) {
+    p_left[i] = unpack_24(p_pcm + 6 * i);
+    p_right[i] = unpack_24(p_pcm + 6 * i + 3);
+  }
+}
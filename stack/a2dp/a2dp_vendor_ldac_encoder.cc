@@ -25,6 +25,7 @@
 
 #include <ldacBT.h>
 
+#include "a2dp_pacing.h"
 #include "a2dp_vendor.h"
 #include "a2dp_vendor_ldac.h"
 #include "a2dp_vendor_ldac_abr.h"
@@ -119,9 +120,7 @@ typedef struct {
 } tA2DP_LDAC_ENCODER_PARAMS;
 
 typedef struct {
-  uint32_t counter;
-  uint32_t bytes_per_tick; /* pcm bytes read each media task tick */
-  uint64_t last_frame_us;
+  tA2DP_PACING pacing; /* pcm bytes to read each media task tick */
 } tA2DP_LDAC_FEEDING_STATE;
 
 typedef struct {
@@ -175,6 +174,7 @@ static void a2dp_vendor_ldac_encoder_update(uint16_t peer_mtu,
 static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
                                               uint8_t* num_of_frames,
                                               uint64_t timestamp_us);
+static uint16_t a2dp_ldac_get_frame_size(uint32_t sample_rate);
 static void a2dp_ldac_encode_frames(uint8_t nb_frame);
 static bool a2dp_ldac_read_feeding(uint8_t* read_buffer);
 static std::string quality_mode_index_to_name(int quality_mode_index);
@@ -507,19 +507,19 @@ void a2dp_vendor_ldac_feeding_reset(void) {
   memset(&a2dp_ldac_encoder_cb.ldac_feeding_state, 0,
          sizeof(a2dp_ldac_encoder_cb.ldac_feeding_state));
 
-  a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick =
-      (a2dp_ldac_encoder_cb.feeding_params.sample_rate *
-       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8 *
-       a2dp_ldac_encoder_cb.feeding_params.channel_count *
-       A2DP_LDAC_ENCODER_INTERVAL_MS) /
-      1000;
+  a2dp_pacing_init(&a2dp_ldac_encoder_cb.ldac_feeding_state.pacing,
+                   a2dp_ldac_encoder_cb.feeding_params.sample_rate *
+                       a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8 *
+                       a2dp_ldac_encoder_cb.feeding_params.channel_count,
+                   A2DP_LDAC_ENCODER_INTERVAL_MS * 1000);
 
   LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
-            a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick);
+            a2dp_pacing_get_bytes_per_tick(
+                &a2dp_ldac_encoder_cb.ldac_feeding_state.pacing));
 }
 
 void a2dp_vendor_ldac_feeding_flush(void) {
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter = 0;
+  a2dp_pacing_flush(&a2dp_ldac_encoder_cb.ldac_feeding_state.pacing);
 }
 
 period_ms_t a2dp_vendor_ldac_get_encoder_interval_ms(void) {
@@ -568,21 +568,11 @@ static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
   LOG_VERBOSE(LOG_TAG, "%s: pcm_bytes_per_frame %u", __func__,
               pcm_bytes_per_frame);
 
-  uint32_t us_this_tick = A2DP_LDAC_ENCODER_INTERVAL_MS * 1000;
-  uint64_t now_us = timestamp_us;
-  if (a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us != 0)
-    us_this_tick =
-        (now_us - a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us);
-  a2dp_ldac_encoder_cb.ldac_feeding_state.last_frame_us = now_us;
-
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
-      a2dp_ldac_encoder_cb.ldac_feeding_state.bytes_per_tick * us_this_tick /
-      (A2DP_LDAC_ENCODER_INTERVAL_MS * 1000);
-
   result =
-      a2dp_ldac_encoder_cb.ldac_feeding_state.counter / pcm_bytes_per_frame;
-  a2dp_ldac_encoder_cb.ldac_feeding_state.counter -=
-      result * pcm_bytes_per_frame;
+      a2dp_pacing_update(&a2dp_ldac_encoder_cb.ldac_feeding_state.pacing,
+                         timestamp_us, pcm_bytes_per_frame);
+  a2dp_pacing_consume(&a2dp_ldac_encoder_cb.ldac_feeding_state.pacing, result,
+                      pcm_bytes_per_frame);
   nof = result;
 
   LOG_VERBOSE(LOG_TAG, "%s: effective num of frames %u, iterations %u",
@@ -592,28 +582,29 @@ static void a2dp_ldac_get_num_frame_iteration(uint8_t* num_of_iterations,
   *num_of_iterations = noi;
 }
 
-static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
-  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
-      &a2dp_ldac_encoder_cb.ldac_encoder_params;
-  uint8_t remain_nb_frame = nb_frame;
-  uint16_t ldac_frame_size;
-  uint8_t read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
-
-  switch (p_encoder_params->sample_rate) {
+// Returns the number of samples per channel of an LDAC frame.
+static uint16_t a2dp_ldac_get_frame_size(uint32_t sample_rate) {
+  switch (sample_rate) {
     case 176400:
     case 192000:
-      ldac_frame_size = 512;  // sample/ch
-      break;
+      return 512;
     case 88200:
     case 96000:
-      ldac_frame_size = 256;  // sample/ch
-      break;
+      return 256;
     case 44100:
     case 48000:
     default:
-      ldac_frame_size = 128;  // sample/ch
-      break;
+      return 128;
   }
+}
+
+static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
+  tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
+      &a2dp_ldac_encoder_cb.ldac_encoder_params;
+  uint8_t remain_nb_frame = nb_frame;
+  uint16_t ldac_frame_size =
+      a2dp_ldac_get_frame_size(p_encoder_params->sample_rate);
+  uint8_t read_buffer[LDACBT_MAX_LSU * 4 /* byte/sample */ * 2 /* ch */];
 
   uint32_t count;
   int32_t encode_count = 0;
@@ -621,10 +612,8 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
   int written = 0;
 
   while (nb_frame) {
-    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-    p_buf->offset = A2DP_LDAC_OFFSET;
-    p_buf->len = 0;
-    p_buf->layer_specific = 0;
+    BT_HDR* p_buf = A2DP_AllocEncoderPacket(A2DP_LDAC_OFFSET,
+                                            a2dp_ldac_encoder_cb.TxAaMtuSize);
     a2dp_ldac_encoder_cb.stats.media_read_total_expected_packets++;
 
     count = 0;
@@ -661,10 +650,11 @@ static void a2dp_ldac_encode_frames(uint8_t nb_frame) {
         p_buf->layer_specific += out_frames;  // added a frame to the buffer
       } else {
         LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, nb_frame);
-        a2dp_ldac_encoder_cb.ldac_feeding_state.counter +=
+        a2dp_pacing_credit(
+            &a2dp_ldac_encoder_cb.ldac_feeding_state.pacing,
             nb_frame * LDACBT_ENC_LSU *
-            a2dp_ldac_encoder_cb.feeding_params.channel_count *
-            a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8;
+                a2dp_ldac_encoder_cb.feeding_params.channel_count *
+                a2dp_ldac_encoder_cb.feeding_params.bits_per_sample / 8);
 
         // no more pcm to read
         nb_frame = 0;
@@ -742,6 +732,14 @@ period_ms_t A2dpCodecConfigLdac::encoderIntervalMs() const {
   return a2dp_vendor_ldac_get_encoder_interval_ms();
 }
 
+uint64_t A2dpCodecConfigLdac::encoderLookaheadUs() const {
+  // The overlapped transform holds back one frame
+  uint32_t sample_rate = a2dp_ldac_encoder_cb.ldac_encoder_params.sample_rate;
+  if (sample_rate == 0) return 0;
+  return (uint64_t)a2dp_ldac_get_frame_size(sample_rate) * 1000000 /
+         sample_rate;
+}
+
 void A2dpCodecConfigLdac::debug_codec_dump(int fd) {
   a2dp_ldac_encoder_stats_t* stats = &a2dp_ldac_encoder_cb.stats;
   tA2DP_LDAC_ENCODER_PARAMS* p_encoder_params =
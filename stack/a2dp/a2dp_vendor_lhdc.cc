@@ -30,7 +30,9 @@
 #include <string.h>
 
 #include <base/logging.h>
+#include <lhdcBT.h>
 #include "a2dp_vendor.h"
+#include "a2dp_vendor_lhdc_decoder.h"
 #include "a2dp_vendor_lhdc_encoder.h"
 #include "bt_utils.h"
 #include "osi/include/log.h"
@@ -63,6 +65,20 @@ static const tA2DP_LHDC_CIE a2dp_lhdc_caps = {
 };
     //(BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16)};
 
+/* LHDC Sink codec capabilities */
+static const tA2DP_LHDC_CIE a2dp_lhdc_sink_caps = {
+    A2DP_LHDC_VENDOR_ID,  // vendorId
+    A2DP_LHDC_CODEC_ID,   // codecId
+    // sampleRate
+    (A2DP_LHDC_SAMPLING_FREQ_44100 | A2DP_LHDC_SAMPLING_FREQ_48000 |
+     A2DP_LHDC_SAMPLING_FREQ_88200 | A2DP_LHDC_SAMPLING_FREQ_96000),
+    // channelMode
+    (A2DP_LHDC_CHANNEL_MODE_STEREO),
+    // bits_per_sample
+    (BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16 | BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24),
+    // Channel Separation
+    false};
+
 /* Default LHDC codec configuration */
 static const tA2DP_LHDC_CIE a2dp_lhdc_default_config = {
     A2DP_LHDC_VENDOR_ID,                // vendorId
@@ -80,7 +96,21 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_lhdc = {
     a2dp_vendor_lhdc_feeding_flush,
     a2dp_vendor_lhdc_get_encoder_interval_ms,
     a2dp_vendor_lhdc_send_frames,
-    a2dp_vendor_lhdc_set_transmit_queue_length};
+    a2dp_vendor_lhdc_set_transmit_queue_length,
+    a2dp_vendor_lhdc_set_transmit_queue_delay,
+    nullptr,  // is_ultra_low_latency
+    a2dp_vendor_lhdc_set_pcm_available,
+    a2dp_vendor_lhdc_get_quality_index,
+    a2dp_vendor_lhdc_set_link_quality
+};
+
+static const tA2DP_DECODER_INTERFACE a2dp_decoder_interface_lhdc = {
+    a2dp_vendor_lhdc_decoder_init,
+    a2dp_vendor_lhdc_decoder_cleanup,
+    a2dp_vendor_lhdc_get_frame_samples,
+    a2dp_vendor_lhdc_assemble_frames,
+    a2dp_vendor_lhdc_decode_frames
+};
 
 UNUSED_ATTR static tA2DP_STATUS A2DP_CodecInfoMatchesCapabilityLhdc(
     const tA2DP_LHDC_CIE* p_cap, const uint8_t* p_codec_info,
@@ -271,6 +301,23 @@ bool A2DP_IsVendorPeerSinkCodecValidLhdc(const uint8_t* p_codec_info) {
          (A2DP_ParseInfoLhdc(&cfg_cie, p_codec_info, true) == A2DP_SUCCESS);
 }
 
+bool A2DP_IsVendorSinkCodecValidLhdc(const uint8_t* p_codec_info) {
+  tA2DP_LHDC_CIE cfg_cie;
+
+  /* Use a liberal check when parsing the codec info */
+  return (A2DP_ParseInfoLhdc(&cfg_cie, p_codec_info, false) == A2DP_SUCCESS) ||
+         (A2DP_ParseInfoLhdc(&cfg_cie, p_codec_info, true) == A2DP_SUCCESS);
+}
+
+bool A2DP_IsVendorSinkCodecSupportedLhdc(const uint8_t* p_codec_info) {
+  if (A2DP_CodecInfoMatchesCapabilityLhdc(&a2dp_lhdc_sink_caps, p_codec_info,
+                                          false) != A2DP_SUCCESS)
+    return false;
+
+  // The decoder library is optional
+  return A2DP_VendorLoadDecoderLhdc();
+}
+
 // Checks whether A2DP LHDC codec configuration matches with a device's codec
 // capabilities. |p_cap| is the LHDC codec configuration. |p_codec_info| is
 // the device's codec capabilities.
@@ -408,7 +455,7 @@ int A2DP_VendorGetTrackBitsPerSampleLhdc(const uint8_t* p_codec_info) {
     return -1;
   }
 
-  switch (a2dp_lhdc_caps.bits_per_sample) {
+  switch (lhdc_cie.bits_per_sample) {
     case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_16:
       return 16;
     case BTAV_A2DP_CODEC_BITS_PER_SAMPLE_24:
@@ -460,6 +507,35 @@ int A2DP_VendorGetChannelModeCodeLhdc(const uint8_t* p_codec_info) {
   return -1;
 }
 
+int A2DP_VendorGetSinkTrackChannelTypeLhdc(const uint8_t* p_codec_info) {
+  tA2DP_LHDC_CIE lhdc_cie;
+
+  // Check whether the codec info contains valid data
+  tA2DP_STATUS a2dp_status = A2DP_ParseInfoLhdc(&lhdc_cie, p_codec_info, false);
+  if (a2dp_status != A2DP_SUCCESS) {
+    LOG_ERROR(LOG_TAG, "%s: cannot decode codec information: %d", __func__,
+              a2dp_status);
+    return -1;
+  }
+
+  switch (lhdc_cie.channelMode) {
+    case A2DP_LHDC_CHANNEL_MODE_STEREO:
+      return 3;
+  }
+
+  return -1;
+}
+
+int A2DP_VendorGetSinkFramesCountToProcessLhdc(uint64_t time_interval_ms,
+                                               const uint8_t* p_codec_info) {
+  int sample_rate = A2DP_VendorGetTrackSampleRateLhdc(p_codec_info);
+  if (sample_rate == -1) return -1;
+
+  // Each LHDC frame carries LHDCBT_ENC_BLOCK_SIZE samples per channel
+  return (int)((time_interval_ms * sample_rate) /
+               (1000 * LHDCBT_ENC_BLOCK_SIZE));
+}
+
 bool A2DP_VendorGetPacketTimestampLhdc(UNUSED_ATTR const uint8_t* p_codec_info,
                                        const uint8_t* p_data,
                                        uint32_t* p_timestamp) {
@@ -484,6 +560,13 @@ bool A2DP_VendorGetChannelSeparation(const uint8_t* p_codec_info){
   return lhdc_cie.isChannelSeparation == 0 ? false : true;
 }
 
+// The number of packets merged into the packet before them. The packet
+// sequence numbers of the encoder are shifted down by it, so that the sink
+// sees them contiguous.
+static uint8_t a2dp_lhdc_merged_packets = 0;
+
+void A2DP_VendorResetMergedPacketsLhdc(void) { a2dp_lhdc_merged_packets = 0; }
+
 bool A2DP_VendorBuildCodecHeaderLhdc(UNUSED_ATTR const uint8_t* p_codec_info,
                                      BT_HDR* p_buf,
                                      uint16_t frames_per_packet) {
@@ -493,11 +576,52 @@ bool A2DP_VendorBuildCodecHeaderLhdc(UNUSED_ATTR const uint8_t* p_codec_info,
   p = (uint8_t*)(p_buf + 1) + p_buf->offset;
   p_buf->len += A2DP_LHDC_MPL_HDR_LEN;
   p[0] = ( uint8_t)( frames_per_packet & 0xff);
-  p[1] = ( uint8_t)( ( frames_per_packet >> 8) & 0xff);
+  p[1] = ( uint8_t)( ( ( frames_per_packet >> 8) - a2dp_lhdc_merged_packets) & 0xff);
   //A2DP_BuildMediaPayloadHeaderLhdc(p, frames_per_packet);
   return true;
 }
 
+bool A2DP_VendorPacketEndsFrameLhdc(UNUSED_ATTR const uint8_t* p_codec_info,
+                                    const BT_HDR* p_buf) {
+  // A frame that is not fragmented is carried in a single packet
+  if ((p_buf->layer_specific & A2DP_LHDC_HDR_F_MSK) == 0) return true;
+  return (p_buf->layer_specific & A2DP_LHDC_HDR_L_MSK) != 0;
+}
+
+bool A2DP_VendorMergePacketsLhdc(UNUSED_ATTR const uint8_t* p_codec_info,
+                                 BT_HDR* p_buf, const BT_HDR* p_next,
+                                 uint16_t max_len) {
+  uint8_t header = p_buf->layer_specific & 0xff;
+  uint8_t next_header = p_next->layer_specific & 0xff;
+
+  // The fragments of a frame must stay in their own packets
+  if ((header & A2DP_LHDC_HDR_F_MSK) || (next_header & A2DP_LHDC_HDR_F_MSK))
+    return false;
+  if ((header & A2DP_LHDC_HDR_LATENCY_MSK) !=
+      (next_header & A2DP_LHDC_HDR_LATENCY_MSK))
+    return false;
+
+  uint8_t num = (header >> A2DP_LHDC_HDR_NUM_SHIFT) & A2DP_LHDC_HDR_NUM_MSK;
+  uint8_t next_num =
+      (next_header >> A2DP_LHDC_HDR_NUM_SHIFT) & A2DP_LHDC_HDR_NUM_MSK;
+  if (num + next_num > A2DP_LHDC_HDR_NUM_MAX) return false;
+  if (max_len < A2DP_LHDC_MPL_HDR_LEN ||
+      p_buf->len + p_next->len > max_len - A2DP_LHDC_MPL_HDR_LEN)
+    return false;
+
+  memcpy((uint8_t*)(p_buf + 1) + p_buf->offset + p_buf->len,
+         (const uint8_t*)(p_next + 1) + p_next->offset, p_next->len);
+  p_buf->len += p_next->len;
+
+  // The merged packet takes the sequence number of |p_next|, and the
+  // following packets are shifted down by one.
+  header &= ~(A2DP_LHDC_HDR_NUM_MSK << A2DP_LHDC_HDR_NUM_SHIFT);
+  header |= (num + next_num) << A2DP_LHDC_HDR_NUM_SHIFT;
+  p_buf->layer_specific = (p_next->layer_specific & 0xff00) | header;
+  a2dp_lhdc_merged_packets++;
+  return true;
+}
+
 void A2DP_VendorDumpCodecInfoLhdc(const uint8_t* p_codec_info) {
   tA2DP_STATUS a2dp_status;
   tA2DP_LHDC_CIE lhdc_cie;
@@ -537,6 +661,13 @@ const tA2DP_ENCODER_INTERFACE* A2DP_VendorGetEncoderInterfaceLhdc(
   return &a2dp_encoder_interface_lhdc;
 }
 
+const tA2DP_DECODER_INTERFACE* A2DP_VendorGetDecoderInterfaceLhdc(
+    const uint8_t* p_codec_info) {
+  if (!A2DP_IsVendorSinkCodecValidLhdc(p_codec_info)) return NULL;
+
+  return &a2dp_decoder_interface_lhdc;
+}
+
 bool A2DP_VendorAdjustCodecLhdc(uint8_t* p_codec_info) {
   tA2DP_LHDC_CIE cfg_cie;
 
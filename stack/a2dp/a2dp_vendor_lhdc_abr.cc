@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_vendor_lhdc_abr"
+
+#include "a2dp_vendor_lhdc_abr.h"
+
+#include <string.h>
+
+#include "osi/include/log.h"
+
+//
+// LHDC ABR(Adaptive Bit Rate) Source Code
+//
+
+static void a2dp_lhdc_abr_set_quality(tA2DP_LHDC_ABR* p_abr, uint64_t now_us,
+                                      int quality_mode_index) {
+  int max_quality_mode_index = p_abr->max_quality_mode_index;
+  if (max_quality_mode_index > p_abr->link_max_quality_mode_index)
+    max_quality_mode_index = p_abr->link_max_quality_mode_index;
+  if (quality_mode_index > max_quality_mode_index)
+    quality_mode_index = max_quality_mode_index;
+  if (quality_mode_index < p_abr->min_quality_mode_index)
+    quality_mode_index = p_abr->min_quality_mode_index;
+  if (quality_mode_index == p_abr->quality_mode_index) return;
+
+  LOG_DEBUG(LOG_TAG, "%s: quality mode %d -> %d (queue delay %llu ms)",
+            __func__, p_abr->quality_mode_index, quality_mode_index,
+            (unsigned long long)p_abr->last_queue_delay_us / 1000);
+  p_abr->quality_mode_index = quality_mode_index;
+  p_abr->last_adjustment_us = now_us;
+  p_abr->adjustments++;
+}
+
+void a2dp_lhdc_abr_init(tA2DP_LHDC_ABR* p_abr, int min_quality_mode_index,
+                        int max_quality_mode_index, int quality_mode_index) {
+  memset(p_abr, 0, sizeof(*p_abr));
+  p_abr->min_quality_mode_index = min_quality_mode_index;
+  p_abr->max_quality_mode_index = max_quality_mode_index;
+  p_abr->link_max_quality_mode_index = max_quality_mode_index;
+  p_abr->last_link_quality = 255;
+  if (quality_mode_index < min_quality_mode_index)
+    quality_mode_index = min_quality_mode_index;
+  if (quality_mode_index > max_quality_mode_index)
+    quality_mode_index = max_quality_mode_index;
+  p_abr->quality_mode_index = quality_mode_index;
+}
+
+int a2dp_lhdc_abr_proc(tA2DP_LHDC_ABR* p_abr, uint64_t now_us,
+                       uint64_t queue_delay_us, bool is_congested) {
+  p_abr->last_queue_delay_us = queue_delay_us;
+
+  if (queue_delay_us >= A2DP_LHDC_ABR_DELAY_CRITICAL_US) {
+    // The link cannot keep up at all: drop to the lowest quality right away
+    p_abr->clear_since_us = 0;
+    a2dp_lhdc_abr_set_quality(p_abr, now_us, p_abr->min_quality_mode_index);
+  } else if (is_congested || queue_delay_us >= A2DP_LHDC_ABR_DELAY_HIGH_US) {
+    // Step down, giving the previous step time to drain the queue
+    p_abr->clear_since_us = 0;
+    if (now_us - p_abr->last_adjustment_us >=
+        A2DP_LHDC_ABR_STEP_DOWN_INTERVAL_US) {
+      a2dp_lhdc_abr_set_quality(p_abr, now_us, p_abr->quality_mode_index - 1);
+    }
+  } else if (queue_delay_us <= A2DP_LHDC_ABR_DELAY_LOW_US) {
+    // Step up only after the link has been clear for a while
+    if (p_abr->clear_since_us == 0) p_abr->clear_since_us = now_us;
+    if (now_us - p_abr->clear_since_us >= A2DP_LHDC_ABR_STEP_UP_INTERVAL_US &&
+        now_us - p_abr->last_adjustment_us >=
+            A2DP_LHDC_ABR_STEP_UP_INTERVAL_US) {
+      a2dp_lhdc_abr_set_quality(p_abr, now_us, p_abr->quality_mode_index + 1);
+      p_abr->clear_since_us = now_us;
+    }
+  } else {
+    // Between the thresholds: keep the current quality
+    p_abr->clear_since_us = 0;
+  }
+
+  return p_abr->quality_mode_index;
+}
+
+// Returns the highest quality mode index a link signal allows: one step
+// below the highest one if it is fair, and the lowest one if it is poor.
+static int a2dp_lhdc_abr_link_cap(const tA2DP_LHDC_ABR* p_abr, bool is_fair,
+                                  bool is_poor) {
+  if (is_poor) return p_abr->min_quality_mode_index;
+  if (is_fair) return p_abr->max_quality_mode_index - 1;
+  return p_abr->max_quality_mode_index;
+}
+
+int a2dp_lhdc_abr_link_proc(tA2DP_LHDC_ABR* p_abr, uint64_t now_us,
+                            int8_t rssi, uint8_t link_quality,
+                            uint32_t failed_contacts) {
+  p_abr->last_rssi = rssi;
+  p_abr->last_link_quality = link_quality;
+  p_abr->last_failed_contacts = failed_contacts;
+
+  const int caps[] = {
+      a2dp_lhdc_abr_link_cap(p_abr, rssi <= A2DP_LHDC_ABR_RSSI_FAIR,
+                             rssi <= A2DP_LHDC_ABR_RSSI_POOR),
+      a2dp_lhdc_abr_link_cap(
+          p_abr, link_quality <= A2DP_LHDC_ABR_LINK_QUALITY_FAIR,
+          link_quality <= A2DP_LHDC_ABR_LINK_QUALITY_POOR),
+      a2dp_lhdc_abr_link_cap(
+          p_abr, failed_contacts >= A2DP_LHDC_ABR_FAILED_CONTACTS_FAIR,
+          failed_contacts >= A2DP_LHDC_ABR_FAILED_CONTACTS_POOR)};
+  int link_max_quality_mode_index = p_abr->max_quality_mode_index;
+  for (int cap : caps) {
+    if (cap < link_max_quality_mode_index) link_max_quality_mode_index = cap;
+  }
+  if (link_max_quality_mode_index < p_abr->min_quality_mode_index)
+    link_max_quality_mode_index = p_abr->min_quality_mode_index;
+
+  if (link_max_quality_mode_index != p_abr->link_max_quality_mode_index) {
+    LOG_DEBUG(LOG_TAG,
+              "%s: link caps the quality mode at %d (rssi %d, link quality "
+              "%u, failed contacts %u)",
+              __func__, link_max_quality_mode_index, rssi, link_quality,
+              failed_contacts);
+    p_abr->link_max_quality_mode_index = link_max_quality_mode_index;
+  }
+
+  // Step down before the queue builds up. Stepping back up is left to
+  // a2dp_lhdc_abr_proc(), once the link has stayed clear for a while.
+  if (p_abr->quality_mode_index > link_max_quality_mode_index) {
+    p_abr->clear_since_us = 0;
+    a2dp_lhdc_abr_set_quality(p_abr, now_us, link_max_quality_mode_index);
+    p_abr->link_step_downs++;
+  }
+
+  return p_abr->quality_mode_index;
+}
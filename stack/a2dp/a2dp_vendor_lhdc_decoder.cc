@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_vendor_lhdc_decoder"
+
+#include "a2dp_vendor_lhdc_decoder.h"
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include <lhdcBT.h>
+#include <lhdcBT_dec.h>
+
+#include "a2dp_vendor.h"
+#include "a2dp_vendor_lhdc.h"
+#include "a2dp_vendor_lhdc_constants.h"
+#include "bt_common.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+//
+// Decoder for LHDC Sink Codec
+//
+
+//
+// The LHDC decoder shared library, and the functions to use
+//
+static const char* LHDC_DECODER_LIB_NAME = "liblhdcBT_dec.so";
+static void* lhdc_decoder_lib_handle = NULL;
+
+static const char* LHDC_DEC_INIT_DECODER_NAME = "lhdcBT_dec_init_decoder";
+typedef int32_t (*tLHDC_DEC_INIT_DECODER)(tLHDCV3_DEC_CONFIG* config);
+
+static const char* LHDC_DEC_DECODE_NAME = "lhdcBT_dec_decode";
+typedef int32_t (*tLHDC_DEC_DECODE)(const uint8_t* frameData,
+                                    uint32_t frameBytes, uint8_t* pcmData,
+                                    uint32_t* pcmBytes, uint32_t bits_depth);
+
+static const char* LHDC_DEC_DEINIT_DECODER_NAME = "lhdcBT_dec_deinit_decoder";
+typedef int32_t (*tLHDC_DEC_DEINIT_DECODER)(void);
+
+static tLHDC_DEC_INIT_DECODER lhdc_dec_init_decoder_func;
+static tLHDC_DEC_DECODE lhdc_dec_decode_func;
+static tLHDC_DEC_DEINIT_DECODER lhdc_dec_deinit_decoder_func;
+
+// The maximum size of a media frame fragmented over several packets
+#define A2DP_LHDC_DECODER_MAX_ASSEMBLY_LEN (32 * 1024)
+
+typedef struct {
+  bool has_decoder;
+  int bits_per_sample;
+  int channel_count;
+
+  // The media frame being reassembled from its fragments, starting with a
+  // media payload header for the whole frame
+  uint8_t* assembly_buffer;
+  uint16_t assembly_len;
+  uint16_t assembly_frames;
+  bool is_assembling;
+  uint8_t next_seq;
+
+  // The PCM of the decoded frames, as output by the library
+  uint8_t* pcm_buffer;
+  uint32_t pcm_buffer_size;
+} tA2DP_LHDC_DECODER_CB;
+
+static tA2DP_LHDC_DECODER_CB a2dp_lhdc_decoder_cb;
+
+static void* load_func(const char* func_name) {
+  void* func_ptr = dlsym(lhdc_decoder_lib_handle, func_name);
+  if (func_ptr == NULL) {
+    LOG_ERROR(LOG_TAG,
+              "%s: cannot find function '%s' in the decoder library: %s",
+              __func__, func_name, dlerror());
+    A2DP_VendorUnloadDecoderLhdc();
+    return NULL;
+  }
+  return func_ptr;
+}
+
+bool A2DP_VendorLoadDecoderLhdc(void) {
+  if (lhdc_decoder_lib_handle != NULL) return true;  // Already loaded
+
+  // Open the decoder library
+  lhdc_decoder_lib_handle = dlopen(LHDC_DECODER_LIB_NAME, RTLD_NOW);
+  if (lhdc_decoder_lib_handle == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: cannot open LHDC decoder library %s: %s", __func__,
+              LHDC_DECODER_LIB_NAME, dlerror());
+    return false;
+  }
+
+  // Load all functions
+  lhdc_dec_init_decoder_func =
+      (tLHDC_DEC_INIT_DECODER)load_func(LHDC_DEC_INIT_DECODER_NAME);
+  if (lhdc_dec_init_decoder_func == NULL) return false;
+  lhdc_dec_decode_func = (tLHDC_DEC_DECODE)load_func(LHDC_DEC_DECODE_NAME);
+  if (lhdc_dec_decode_func == NULL) return false;
+  lhdc_dec_deinit_decoder_func =
+      (tLHDC_DEC_DEINIT_DECODER)load_func(LHDC_DEC_DEINIT_DECODER_NAME);
+  if (lhdc_dec_deinit_decoder_func == NULL) return false;
+
+  return true;
+}
+
+void A2DP_VendorUnloadDecoderLhdc(void) {
+  a2dp_vendor_lhdc_decoder_cleanup();
+
+  lhdc_dec_init_decoder_func = NULL;
+  lhdc_dec_decode_func = NULL;
+  lhdc_dec_deinit_decoder_func = NULL;
+
+  if (lhdc_decoder_lib_handle != NULL) {
+    dlclose(lhdc_decoder_lib_handle);
+    lhdc_decoder_lib_handle = NULL;
+  }
+}
+
+bool a2dp_vendor_lhdc_decoder_init(const uint8_t* p_codec_info) {
+  a2dp_vendor_lhdc_decoder_cleanup();
+  if (!A2DP_VendorLoadDecoderLhdc()) return false;
+
+  int sample_rate = A2DP_VendorGetTrackSampleRateLhdc(p_codec_info);
+  int bits_per_sample = A2DP_VendorGetTrackBitsPerSampleLhdc(p_codec_info);
+  int channel_count = A2DP_VendorGetTrackChannelCountLhdc(p_codec_info);
+  if (sample_rate == -1 || bits_per_sample == -1 || channel_count == -1) {
+    LOG_ERROR(LOG_TAG, "%s: invalid codec configuration", __func__);
+    return false;
+  }
+
+  tLHDCV3_DEC_CONFIG config;
+  memset(&config, 0, sizeof(config));
+  config.version = VERSION_3;
+  config.sample_rate = sample_rate;
+  config.bits_depth = bits_per_sample;
+  int32_t result = lhdc_dec_init_decoder_func(&config);
+  if (result != LHDCBT_DEC_FUNC_SUCCEED) {
+    LOG_ERROR(LOG_TAG, "%s: cannot initialize the decoder: %d", __func__,
+              result);
+    return false;
+  }
+
+  a2dp_lhdc_decoder_cb.has_decoder = true;
+  a2dp_lhdc_decoder_cb.bits_per_sample = bits_per_sample;
+  a2dp_lhdc_decoder_cb.channel_count = channel_count;
+  // Room for the most frames a packet carries, in 32-bit samples at most
+  a2dp_lhdc_decoder_cb.pcm_buffer_size =
+      A2DP_LHDC_HDR_NUM_MAX * LHDCBT_ENC_BLOCK_SIZE * channel_count * 4;
+  a2dp_lhdc_decoder_cb.pcm_buffer =
+      (uint8_t*)osi_malloc(a2dp_lhdc_decoder_cb.pcm_buffer_size);
+
+  LOG_DEBUG(LOG_TAG, "%s: sample_rate=%d bits_per_sample=%d channels=%d",
+            __func__, sample_rate, bits_per_sample, channel_count);
+  return true;
+}
+
+void a2dp_vendor_lhdc_decoder_cleanup(void) {
+  if (a2dp_lhdc_decoder_cb.has_decoder && lhdc_dec_deinit_decoder_func != NULL)
+    lhdc_dec_deinit_decoder_func();
+  osi_free(a2dp_lhdc_decoder_cb.assembly_buffer);
+  osi_free(a2dp_lhdc_decoder_cb.pcm_buffer);
+  memset(&a2dp_lhdc_decoder_cb, 0, sizeof(a2dp_lhdc_decoder_cb));
+}
+
+size_t a2dp_vendor_lhdc_get_frame_samples(void) {
+  return LHDCBT_ENC_BLOCK_SIZE;
+}
+
+uint16_t a2dp_vendor_lhdc_assemble_frames(const uint8_t* p_data, uint16_t len,
+                                          const uint8_t** p_frames,
+                                          uint16_t* frames_len) {
+  tA2DP_LHDC_DECODER_CB* cb = &a2dp_lhdc_decoder_cb;
+
+  if (len <= A2DP_LHDC_MPL_HDR_LEN) return 0;
+  uint8_t header = p_data[0];
+  uint8_t seq = p_data[1];
+  uint16_t num_frames =
+      (header >> A2DP_LHDC_HDR_NUM_SHIFT) & A2DP_LHDC_HDR_NUM_MSK;
+
+  if ((header & A2DP_LHDC_HDR_F_MSK) == 0) {
+    if (cb->is_assembling) {
+      LOG_WARN(LOG_TAG, "%s: fragmented frame %d not completed", __func__,
+               cb->next_seq);
+      cb->is_assembling = false;
+    }
+    *p_frames = p_data;
+    *frames_len = len;
+    return num_frames;
+  }
+
+  if (header & A2DP_LHDC_HDR_S_MSK) {
+    // The first fragment: the header of the reassembled media frame keeps
+    // its number of frames and latency, and is not fragmented
+    if (cb->is_assembling) {
+      LOG_WARN(LOG_TAG, "%s: fragmented frame %d not completed", __func__,
+               cb->next_seq);
+    }
+    if (cb->assembly_buffer == NULL) {
+      cb->assembly_buffer =
+          (uint8_t*)osi_malloc(A2DP_LHDC_DECODER_MAX_ASSEMBLY_LEN);
+    }
+    cb->is_assembling = true;
+    cb->assembly_frames = num_frames;
+    cb->assembly_len = A2DP_LHDC_MPL_HDR_LEN;
+    cb->assembly_buffer[0] =
+        header & ~(A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_S_MSK);
+    cb->assembly_buffer[1] = seq;
+  } else if (!cb->is_assembling || seq != cb->next_seq) {
+    // A fragment was lost: drop the rest of the frame
+    if (cb->is_assembling) {
+      LOG_WARN(LOG_TAG, "%s: fragment %d lost", __func__, cb->next_seq);
+    }
+    cb->is_assembling = false;
+    return 0;
+  }
+
+  uint16_t payload_len = len - A2DP_LHDC_MPL_HDR_LEN;
+  if (cb->assembly_len + payload_len > A2DP_LHDC_DECODER_MAX_ASSEMBLY_LEN) {
+    LOG_ERROR(LOG_TAG, "%s: fragmented frame too large", __func__);
+    cb->is_assembling = false;
+    return 0;
+  }
+  memcpy(cb->assembly_buffer + cb->assembly_len,
+         p_data + A2DP_LHDC_MPL_HDR_LEN, payload_len);
+  cb->assembly_len += payload_len;
+  cb->next_seq = seq + 1;
+
+  if ((header & A2DP_LHDC_HDR_L_MSK) == 0) return 0;
+
+  cb->is_assembling = false;
+  *p_frames = cb->assembly_buffer;
+  *frames_len = cb->assembly_len;
+  return cb->assembly_frames;
+}
+
+uint16_t a2dp_vendor_lhdc_decode_frames(const uint8_t* p_frames,
+                                        uint16_t frames_len,
+                                        UNUSED_ATTR uint16_t num_frames,
+                                        int16_t* p_pcm, uint32_t* p_pcm_len) {
+  tA2DP_LHDC_DECODER_CB* cb = &a2dp_lhdc_decoder_cb;
+  uint32_t pcm_bytes = cb->pcm_buffer_size;
+
+  if (!cb->has_decoder) {
+    *p_pcm_len = 0;
+    return 0;
+  }
+
+  int32_t result =
+      lhdc_dec_decode_func(p_frames, frames_len, cb->pcm_buffer, &pcm_bytes,
+                           cb->bits_per_sample);
+  if (result != LHDCBT_DEC_FUNC_SUCCEED) {
+    LOG_ERROR(LOG_TAG, "%s: decoding failure: %d", __func__, result);
+    *p_pcm_len = 0;
+    return 0;
+  }
+
+  // The library outputs the PCM at the bit depth of the stream, as packed
+  // 24-bit samples for 24 bits: only their 16 most significant bits are
+  // kept for the audio track.
+  uint32_t sample_bytes = (cb->bits_per_sample == 24) ? 3 : sizeof(int16_t);
+  uint32_t num_samples = pcm_bytes / sample_bytes;
+  if (num_samples > *p_pcm_len / sizeof(int16_t))
+    num_samples = *p_pcm_len / sizeof(int16_t);
+  if (sample_bytes == sizeof(int16_t)) {
+    memcpy(p_pcm, cb->pcm_buffer, num_samples * sizeof(int16_t));
+  } else {
+    const uint8_t* p = cb->pcm_buffer;
+    for (uint32_t i = 0; i < num_samples; i++, p += sample_bytes)
+      p_pcm[i] = (int16_t)(p[1] | (p[2] << 8));
+  }
+
+  *p_pcm_len = num_samples * sizeof(int16_t);
+  return num_samples / (LHDCBT_ENC_BLOCK_SIZE * cb->channel_count);
+}
@@ -0,0 +1,1624 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Encoder core shared by the LHDC and LHDC LL Source Codecs
+//
+// Both codecs drive the same LHDC encoder library, and only differ in their
+// tick, frame pacing and packetization. The core is a class template over a
+// policy that provides them at compile time:
+//
+//   struct Policy {
+//     // The nominal encoder interval in milliseconds, and the range the
+//     // interval of a session is picked from the peer MTU, quality mode and
+//     // latency mode
+//     static constexpr period_ms_t kEncoderIntervalMs = ...;
+//     static constexpr period_ms_t kMinEncoderIntervalMs = ...;
+//     static constexpr period_ms_t kMaxEncoderIntervalMs = ...;
+//     // The packets of the peer MTU to fill on each tick
+//     static constexpr uint32_t kPacketsPerTick = ...;
+//     // True to drop the leading silence of a stream, and to catch up on
+//     // the PCM buffered meanwhile by encoding extra frames
+//     static constexpr bool kSkipLeadingSilence = ...;
+//     // True to pack whole frames into packets when the channels are
+//     // separated, instead of fragmenting the frames of a tick
+//     static constexpr bool kPackSeparatedChannelFrames = ...;
+//     // The encoder interval in the ultra-low-latency mode, where each
+//     // encoded frame is enqueued right away, or 0 if not supported
+//     static constexpr period_ms_t kUltraLowLatencyIntervalMs = ...;
+//     // True if the ultra-low-latency mode is enabled
+//     static bool IsUltraLowLatencyEnabled(void);
+//     // The codec information accessors of the codec
+//     static int GetTrackSampleRate(const uint8_t* p_codec_info);
+//     static int GetTrackChannelCount(const uint8_t* p_codec_info);
+//     static int GetChannelModeCode(const uint8_t* p_codec_info);
+//     static bool GetChannelSeparation(const uint8_t* p_codec_info);
+//   };
+//
+// Each instantiation has its own encoder state, so both codecs can be loaded
+// at the same time. The file including this header defines LOG_TAG.
+//
+
+#ifndef A2DP_VENDOR_LHDC_ENCODER_CORE_H
+#define A2DP_VENDOR_LHDC_ENCODER_CORE_H
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include <lhdcBT.h>
+
+#include "a2dp_codec_api.h"
+#include "a2dp_pacing.h"
+#include "a2dp_resampler.h"
+#include "a2dp_silence.h"
+#include "a2dp_vendor.h"
+#include "a2dp_vendor_lhdc_abr.h"
+#include "a2dp_vendor_lhdc.h"
+#include "a2dp_vendor_lhdc_constants.h"
+#include "a2dp_vendor_lhdc_interval.h"
+#include "bt_common.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/trace_ring.h"
+
+//
+// The LHDC encoder shared library, and the functions to use
+//
+static const char* LHDC_ENCODER_LIB_NAME = "liblhdcBT_enc.so";
+
+static const char* LHDC_GET_HANDLE_NAME = "lhdcBT_get_handle";
+typedef HANDLE_LHDC_BT (*tLHDC_GET_HANDLE)(void);
+
+static const char* LHDC_FREE_HANDLE_NAME = "lhdcBT_free_handle";
+typedef void (*tLHDC_FREE_HANDLE)(HANDLE_LHDC_BT hLhdcParam);
+
+static const char* LHDC_GET_BITRATE_NAME = "lhdcBT_get_bitrate";
+typedef int (*tLHDC_GET_BITRATE)(HANDLE_LHDC_BT hLhdcParam);
+static const char* LHDC_SET_BITRATE_NAME = "lhdcBT_set_bitrate";
+typedef int (*tLHDC_SET_BITRATE)(HANDLE_LHDC_BT hLhdcParam, int index);
+
+static const char* LHDC_GET_SAMPLING_FREQ_NAME = "lhdcBT_get_sampling_freq";
+typedef int (*tLHDC_GET_SAMPLING_FREQ)(HANDLE_LHDC_BT hLhdcParam);
+
+static const char* LHDC_INIT_HANDLE_ENCODE_NAME = "lhdcBT_init_handle_encode";
+typedef int (*tLHDC_INIT_HANDLE_ENCODE)(HANDLE_LHDC_BT hLhdcParam,int sampling_freq, int bitPerSample, int bitrate_inx, int dualChannels);
+
+//int lhdcBT_adjust_bitrate(HANDLE_LHDC_BT handle, int queueLength)
+static const char* LHDC_AUTO_ADJUST_BITRATE_NAME = "lhdcBT_adjust_bitrate";
+typedef int (*tLHDC_AUTO_ADJUST_BITRATE)(HANDLE_LHDC_BT hLhdcParam, size_t queueLength);
+
+static const char* LHDC_ENCODE_NAME = "lhdcBT_encode";
+typedef int (*tLHDC_ENCODE)(HANDLE_LHDC_BT hLhdcParam, void* p_pcm, unsigned char* p_stream);
+
+static const char* LHDC_SET_LIMIT_BITRATE_ENABLED_NAME = "lhdcBT_setLimitBitRateEnabled";
+typedef void (*tLHDC_SET_LIMIT_BITRATE_ENABLED)(HANDLE_LHDC_BT hLhdcParam, int enabled);
+
+static const char* LHDC_GET_ERROR_CODE_NAME = "lhdcBT_get_error_code";
+typedef int (*tLHDC_GET_ERROR_CODE)(HANDLE_LHDC_BT hLhdcParam);
+
+#define A2DP_LHDC_MEDIA_BYTES_PER_FRAME 512
+
+// The maximum number of media packets produced by one encoder call
+#define A2DP_LHDC_MAX_FRAGMENTS 64
+
+// The maximum number of encoder blocks of PCM read at once
+#define A2DP_LHDC_MAX_READ_FRAMES 8
+
+// The maximum number of initialized encoder handles kept warm for reuse
+#define A2DP_LHDC_HANDLE_CACHE_SIZE 3
+
+// The number of ticks that encode an extra frame once the leading silence
+// was skipped
+#define A2DP_LHDC_CATCH_UP_TICKS 4
+
+// The time of digital silence after which the bitrate drops to the lowest
+// quality mode, until the audio comes back
+#define A2DP_LHDC_SILENCE_MS 500
+
+// offset
+#if (BTA_AV_CO_CP_SCMS_T == TRUE)
+#define A2DP_LHDC_OFFSET (AVDT_MEDIA_OFFSET + A2DP_LHDC_MPL_HDR_LEN + 1)
+#else
+#define A2DP_LHDC_OFFSET (AVDT_MEDIA_OFFSET + A2DP_LHDC_MPL_HDR_LEN)
+#endif
+
+typedef struct {
+  uint32_t sample_rate;
+  uint8_t channel_mode;
+  uint8_t bits_per_sample;
+  int quality_mode_index;
+  int latency_mode_index;
+  int pcm_wlength;
+  LHDCBT_SMPL_FMT_T pcm_fmt;
+  bool isChannelSeparation;
+} tA2DP_LHDC_ENCODER_PARAMS;
+
+// The parameters an encoder handle was initialized with. The quality mode is
+// not part of it, as it is changed on the fly with |lhdc_set_bitrate_func|.
+typedef struct {
+  uint32_t sample_rate;
+  LHDCBT_SMPL_FMT_T pcm_fmt;
+  bool isChannelSeparation;
+} tA2DP_LHDC_HANDLE_KEY;
+
+typedef struct {
+  HANDLE_LHDC_BT lhdc_handle;  // NULL if the entry is unused
+  tA2DP_LHDC_HANDLE_KEY key;
+  uint64_t last_used_us;
+} tA2DP_LHDC_HANDLE_CACHE_ENTRY;
+
+typedef struct {
+  tA2DP_PACING pacing; /* pcm bytes to read each media task tick */
+  uint32_t pcm_read_offset; /* next block to encode in the PCM buffer */
+  uint32_t pcm_read_len;    /* pcm bytes read into the PCM buffer */
+  bool is_audio_started;    /* false while skipping the leading silence */
+  uint32_t silent_frames;   /* leading silent frames skipped */
+  uint8_t catch_up_ticks;   /* ticks left that encode an extra frame */
+  tA2DP_SILENCE silence;    /* the silence of the PCM read */
+  bool has_pcm_available;   /* true if pcm_available is valid */
+  size_t pcm_available;     /* pcm bytes ready to be read this tick */
+} tA2DP_LHDC_FEEDING_STATE;
+
+typedef struct {
+  uint64_t session_start_us;
+
+  size_t media_read_total_expected_packets;
+  size_t media_read_total_expected_reads_count;
+  size_t media_read_total_expected_read_bytes;
+
+  size_t media_read_total_dropped_packets;
+  size_t media_read_total_actual_reads_count;
+  size_t media_read_total_actual_read_bytes;
+
+  // The frames deferred to a later tick, their PCM not being available yet
+  size_t media_read_total_deferred_frames;
+
+  // The time spent in the encoder library, to tell its share of the media
+  // thread
+  size_t encode_count;
+  uint64_t encode_total_us;
+  uint64_t encode_max_us;
+} a2dp_lhdc_encoder_stats_t;
+
+typedef struct {
+  a2dp_source_read_callback_t read_callback;
+  a2dp_source_enqueue_callback_t enqueue_callback;
+  uint16_t TxAaMtuSize;
+  size_t TxQueueLength;
+
+  bool use_SCMS_T;
+  bool is_peer_edr;          // True if the peer device supports EDR
+  bool peer_supports_3mbps;  // True if the peer device supports 3Mbps EDR
+  uint16_t peer_mtu;         // MTU of the A2DP peer
+  uint32_t timestamp;        // Timestamp for the A2DP frames
+
+  HANDLE_LHDC_BT lhdc_handle;
+  bool has_lhdc_handle;  // True if lhdc_handle is valid
+  bool is_lhdc_handle_initialized;  // True if lhdc_handle_key is valid
+  tA2DP_LHDC_HANDLE_KEY lhdc_handle_key;
+  tA2DP_LHDC_ABR lhdc_abr;
+  bool has_lhdc_abr;  // True if the bitrate is adapted by |lhdc_abr|
+  bool use_link_quality;  // True if |lhdc_abr| also follows the link signals
+  tA2DP_LINK_QUALITY link_quality;  // The last link signals
+  size_t link_quality_samples;
+  uint64_t last_queue_delay_us;
+  // The encoder interval of the session, picked when the encoder is
+  // initialized and when a suspended stream is resumed; 0 if not picked yet
+  period_ms_t encoder_interval_ms;
+  tA2DP_FEEDING_PARAMS feeding_params;
+  tA2DP_LHDC_ENCODER_PARAMS lhdc_encoder_params;
+  tA2DP_LHDC_FEEDING_STATE lhdc_feeding_state;
+  // Converts the feeding PCM when it is not at the encoder sample rate
+  tA2DP_RESAMPLER resampler;
+
+  // Scratch buffers, sized when the encoder is updated so that encoding does
+  // not allocate any memory. |pcm_buffer| holds the PCM of up to
+  // |A2DP_LHDC_MAX_READ_FRAMES| blocks, |bitstream_buffer| one encoded block.
+  uint8_t* pcm_buffer;
+  uint8_t* bitstream_buffer;
+  uint32_t scratch_buffer_size;  // Size of one encoder block in octets
+  // The room for encoded audio in each packet: the MTU and, if it fits, one
+  // more encoded block so that blocks are encoded in place in the packet
+  uint16_t packet_buffer_len;
+  BT_HDR* fragments[A2DP_LHDC_MAX_FRAGMENTS];
+
+  a2dp_lhdc_encoder_stats_t stats;
+  uint32_t buf_seq;
+} tA2DP_LHDC_ENCODER_CB;
+
+template <class Policy>
+class A2dpLhdcEncoder {
+ public:
+  static bool load_encoder(void);
+  static void unload_encoder(void);
+  static void encoder_init(const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+                           A2dpCodecConfig* a2dp_codec_config,
+                           a2dp_source_read_callback_t read_callback,
+                           a2dp_source_enqueue_callback_t enqueue_callback);
+  static bool update_encoder_user_config(
+      A2dpCodecConfig* a2dp_codec_config,
+      const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+      bool* p_restart_input, bool* p_restart_output, bool* p_config_updated);
+  static void encoder_cleanup(void);
+  static void feeding_reset(void);
+  static void feeding_flush(void);
+  static period_ms_t get_encoder_interval_ms(void);
+  static uint64_t get_encoder_lookahead_us(void);
+  static void send_frames(uint64_t timestamp_us);
+  static bool is_ultra_low_latency(void);
+  static void set_pcm_available(size_t pcm_available);
+  static int get_quality_index(void);
+  static void set_transmit_queue_length(size_t transmit_queue_length);
+  static void set_transmit_queue_delay(uint64_t queue_delay_us,
+                                       bool is_congested);
+  static void set_link_quality(const tA2DP_LINK_QUALITY* p_link_quality);
+  // Dumps the encoder state, after the generic codec state.
+  static void debug_codec_dump(int fd);
+
+ private:
+  static void* load_func(const char* func_name);
+  static void encoder_update(uint16_t peer_mtu,
+                             A2dpCodecConfig* a2dp_codec_config,
+                             bool* p_restart_input, bool* p_restart_output,
+                             bool* p_config_updated);
+  static void get_num_frame_iteration(uint8_t* num_of_iterations,
+                                      uint8_t* num_of_frames,
+                                      uint64_t timestamp_us);
+  static BT_HDR* bt_buf_new(void);
+  static void free_scratch_buffers(void);
+  static bool handle_key_equals(const tA2DP_LHDC_HANDLE_KEY* p_a,
+                                const tA2DP_LHDC_HANDLE_KEY* p_b);
+  static void release_handle(void);
+  static bool acquire_cached_handle(const tA2DP_LHDC_HANDLE_KEY* p_key);
+  static void free_handle_cache(void);
+  static void encode_frames(uint8_t nb_frame);
+  static void encode_fragmented_frames(uint8_t nb_frame);
+  static void encode_packed_frames(uint8_t nb_frame);
+  static int encode_block(uint8_t* read_buffer, uint8_t* write_buffer);
+  static void enqueue_packet(BT_HDR* p_buf, uint8_t header);
+  static bool read_next_frame(uint8_t* p_nb_frame, uint8_t** p_read_buffer);
+  static bool read_feeding(uint8_t nb_frame, uint8_t** p_read_buffer);
+  static void update_silence(const uint8_t* read_buffer, uint32_t read_size);
+  static int get_bitrate_quality_mode_index(void);
+  static void select_encoder_interval(void);
+  static void account_data_rate(int bytes);
+  static uint32_t get_max_payload_len(void);
+  static uint32_t get_pcm_bytes_per_block(void);
+  static std::string quality_mode_index_to_name(int quality_mode_index);
+  static std::string latency_mode_index_to_name(int latency_mode_index);
+
+  static void* lhdc_encoder_lib_handle;
+  static tLHDC_GET_HANDLE lhdc_get_handle_func;
+  static tLHDC_FREE_HANDLE lhdc_free_handle_func;
+  static tLHDC_GET_BITRATE lhdc_get_bitrate_func;
+  static tLHDC_SET_BITRATE lhdc_set_bitrate_func;
+  static tLHDC_GET_SAMPLING_FREQ lhdc_get_sampling_freq_func;
+  static tLHDC_INIT_HANDLE_ENCODE lhdc_init_handle_encode_func;
+  static tLHDC_ENCODE lhdc_encode_func;
+  static tLHDC_AUTO_ADJUST_BITRATE lhdc_auto_adjust_bitrate_func;
+  static tLHDC_GET_ERROR_CODE lhdc_get_error_code_func;
+  static tLHDC_SET_LIMIT_BITRATE_ENABLED lhdc_set_limit_bitrate_enabled;
+
+  static tA2DP_LHDC_ENCODER_CB a2dp_lhdc_encoder_cb;
+  // True if the current session is in the ultra-low-latency mode
+  static bool ultra_low_latency;
+  // The initialized encoder handles that are not in use
+  static tA2DP_LHDC_HANDLE_CACHE_ENTRY
+      a2dp_lhdc_handle_cache[A2DP_LHDC_HANDLE_CACHE_SIZE];
+};
+
+template <class Policy>
+void* A2dpLhdcEncoder<Policy>::lhdc_encoder_lib_handle = NULL;
+template <class Policy>
+tLHDC_GET_HANDLE A2dpLhdcEncoder<Policy>::lhdc_get_handle_func;
+template <class Policy>
+tLHDC_FREE_HANDLE A2dpLhdcEncoder<Policy>::lhdc_free_handle_func;
+template <class Policy>
+tLHDC_GET_BITRATE A2dpLhdcEncoder<Policy>::lhdc_get_bitrate_func;
+template <class Policy>
+tLHDC_SET_BITRATE A2dpLhdcEncoder<Policy>::lhdc_set_bitrate_func;
+template <class Policy>
+tLHDC_GET_SAMPLING_FREQ A2dpLhdcEncoder<Policy>::lhdc_get_sampling_freq_func;
+template <class Policy>
+tLHDC_INIT_HANDLE_ENCODE A2dpLhdcEncoder<Policy>::lhdc_init_handle_encode_func;
+template <class Policy>
+tLHDC_ENCODE A2dpLhdcEncoder<Policy>::lhdc_encode_func;
+template <class Policy>
+tLHDC_AUTO_ADJUST_BITRATE
+    A2dpLhdcEncoder<Policy>::lhdc_auto_adjust_bitrate_func;
+template <class Policy>
+tLHDC_GET_ERROR_CODE A2dpLhdcEncoder<Policy>::lhdc_get_error_code_func;
+template <class Policy>
+tLHDC_SET_LIMIT_BITRATE_ENABLED
+    A2dpLhdcEncoder<Policy>::lhdc_set_limit_bitrate_enabled;
+template <class Policy>
+tA2DP_LHDC_ENCODER_CB A2dpLhdcEncoder<Policy>::a2dp_lhdc_encoder_cb;
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::ultra_low_latency = false;
+template <class Policy>
+tA2DP_LHDC_HANDLE_CACHE_ENTRY
+    A2dpLhdcEncoder<Policy>::a2dp_lhdc_handle_cache[A2DP_LHDC_HANDLE_CACHE_SIZE];
+
+template <class Policy>
+void* A2dpLhdcEncoder<Policy>::load_func(const char* func_name) {
+  void* func_ptr = dlsym(lhdc_encoder_lib_handle, func_name);
+  if (func_ptr == NULL) {
+    LOG_ERROR(LOG_TAG,
+              "%s: cannot find function '%s' in the encoder library: %s",
+              __func__, func_name, dlerror());
+    unload_encoder();
+    return NULL;
+  }
+  return func_ptr;
+}
+
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::load_encoder(void) {
+  if (lhdc_encoder_lib_handle != NULL) return true;  // Already loaded
+
+  // Initialize the control block
+  memset(&a2dp_lhdc_encoder_cb, 0, sizeof(a2dp_lhdc_encoder_cb));
+
+  // Open the encoder library
+  lhdc_encoder_lib_handle = dlopen(LHDC_ENCODER_LIB_NAME, RTLD_NOW);
+  if (lhdc_encoder_lib_handle == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: cannot open LHDC encoder library %s: %s", __func__,
+              LHDC_ENCODER_LIB_NAME, dlerror());
+    return false;
+  }
+
+  // Load all functions
+  lhdc_get_handle_func = (tLHDC_GET_HANDLE)load_func(LHDC_GET_HANDLE_NAME);
+  if (lhdc_get_handle_func == NULL) return false;
+  lhdc_free_handle_func = (tLHDC_FREE_HANDLE)load_func(LHDC_FREE_HANDLE_NAME);
+  if (lhdc_free_handle_func == NULL) return false;
+  lhdc_get_bitrate_func = (tLHDC_GET_BITRATE)load_func(LHDC_GET_BITRATE_NAME);
+  if (lhdc_get_bitrate_func == NULL) return false;
+  lhdc_set_bitrate_func = (tLHDC_SET_BITRATE)load_func(LHDC_SET_BITRATE_NAME);
+  if (lhdc_set_bitrate_func == NULL) return false;
+  lhdc_get_sampling_freq_func =
+      (tLHDC_GET_SAMPLING_FREQ)load_func(LHDC_GET_SAMPLING_FREQ_NAME);
+  if (lhdc_get_sampling_freq_func == NULL) return false;
+  lhdc_init_handle_encode_func =
+      (tLHDC_INIT_HANDLE_ENCODE)load_func(LHDC_INIT_HANDLE_ENCODE_NAME);
+  if (lhdc_init_handle_encode_func == NULL) return false;
+  lhdc_encode_func = (tLHDC_ENCODE)load_func(LHDC_ENCODE_NAME);
+  if (lhdc_encode_func == NULL) return false;
+  lhdc_auto_adjust_bitrate_func = (tLHDC_AUTO_ADJUST_BITRATE)load_func(LHDC_AUTO_ADJUST_BITRATE_NAME);
+  if (lhdc_auto_adjust_bitrate_func == NULL) return false;
+  lhdc_get_error_code_func = (tLHDC_GET_ERROR_CODE)load_func(LHDC_GET_ERROR_CODE_NAME);
+  if (lhdc_get_error_code_func == NULL) return false;
+  lhdc_set_limit_bitrate_enabled = (tLHDC_SET_LIMIT_BITRATE_ENABLED)load_func(LHDC_SET_LIMIT_BITRATE_ENABLED_NAME);
+  if (lhdc_set_limit_bitrate_enabled == NULL) return false;
+
+  return true;
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::unload_encoder(void) {
+  // Cleanup any LHDC-related state
+
+  LOG_DEBUG(LOG_TAG, "%s: a2dp_lhdc_encoder_cb.has_lhdc_handle = %d, lhdc_free_handle_func = %p",
+            __func__, a2dp_lhdc_encoder_cb.has_lhdc_handle, lhdc_free_handle_func);
+  if (lhdc_free_handle_func != NULL) {
+    release_handle();
+    free_handle_cache();
+  }
+  free_scratch_buffers();
+  a2dp_resampler_cleanup(&a2dp_lhdc_encoder_cb.resampler);
+  memset(&a2dp_lhdc_encoder_cb, 0, sizeof(a2dp_lhdc_encoder_cb));
+
+  lhdc_get_handle_func = NULL;
+  lhdc_free_handle_func = NULL;
+  lhdc_get_bitrate_func = NULL;
+  lhdc_set_bitrate_func = NULL;
+  lhdc_get_sampling_freq_func = NULL;
+  lhdc_init_handle_encode_func = NULL;
+  lhdc_encode_func = NULL;
+  lhdc_auto_adjust_bitrate_func = NULL;
+  lhdc_get_error_code_func = NULL;
+  lhdc_set_limit_bitrate_enabled = NULL;
+
+  if (lhdc_encoder_lib_handle != NULL) {
+    dlclose(lhdc_encoder_lib_handle);
+    lhdc_encoder_lib_handle = NULL;
+  }
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encoder_init(
+    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params,
+    A2dpCodecConfig* a2dp_codec_config,
+    a2dp_source_read_callback_t read_callback,
+    a2dp_source_enqueue_callback_t enqueue_callback) {
+  release_handle();
+
+  free_scratch_buffers();
+  a2dp_resampler_cleanup(&a2dp_lhdc_encoder_cb.resampler);
+  memset(&a2dp_lhdc_encoder_cb, 0, sizeof(a2dp_lhdc_encoder_cb));
+  A2DP_VendorResetMergedPacketsLhdc();
+
+  a2dp_lhdc_encoder_cb.stats.session_start_us = time_get_os_boottime_us();
+
+  a2dp_lhdc_encoder_cb.read_callback = read_callback;
+  a2dp_lhdc_encoder_cb.enqueue_callback = enqueue_callback;
+  a2dp_lhdc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
+  a2dp_lhdc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  a2dp_lhdc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
+  a2dp_lhdc_encoder_cb.timestamp = 0;
+
+  ultra_low_latency = Policy::kUltraLowLatencyIntervalMs > 0 &&
+                      Policy::IsUltraLowLatencyEnabled();
+  LOG_DEBUG(LOG_TAG, "%s: ultra-low-latency mode %s", __func__,
+            ultra_low_latency ? "enabled" : "disabled");
+
+  a2dp_lhdc_encoder_cb.use_SCMS_T = false;  // TODO: should be a parameter
+#if (BTA_AV_CO_CP_SCMS_T == TRUE)
+  a2dp_lhdc_encoder_cb.use_SCMS_T = true;
+#endif
+
+  // NOTE: Ignore the restart_input / restart_output flags - this initization
+  // happens when the connection is (re)started.
+  bool restart_input = false;
+  bool restart_output = false;
+  bool config_updated = false;
+  encoder_update(a2dp_lhdc_encoder_cb.peer_mtu, a2dp_codec_config,
+                 &restart_input, &restart_output, &config_updated);
+  select_encoder_interval();
+}
+
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::update_encoder_user_config(
+    A2dpCodecConfig* a2dp_codec_config,
+    const tA2DP_ENCODER_INIT_PEER_PARAMS* p_peer_params, bool* p_restart_input,
+    bool* p_restart_output, bool* p_config_updated) {
+  a2dp_lhdc_encoder_cb.is_peer_edr = p_peer_params->is_peer_edr;
+  a2dp_lhdc_encoder_cb.peer_supports_3mbps = p_peer_params->peer_supports_3mbps;
+  a2dp_lhdc_encoder_cb.peer_mtu = p_peer_params->peer_mtu;
+  a2dp_lhdc_encoder_cb.timestamp = 0;
+
+  if (a2dp_lhdc_encoder_cb.peer_mtu == 0) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot update the codec encoder for %s: "
+              "invalid peer MTU",
+              __func__, a2dp_codec_config->name().c_str());
+    return false;
+  }
+
+  encoder_update(a2dp_lhdc_encoder_cb.peer_mtu, a2dp_codec_config,
+                 p_restart_input, p_restart_output, p_config_updated);
+  return true;
+}
+
+// Update the A2DP LHDC encoder.
+// |peer_mtu| is the peer MTU.
+// |a2dp_codec_config| is the A2DP codec to use for the update.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encoder_update(uint16_t peer_mtu,
+                                             A2dpCodecConfig* a2dp_codec_config,
+                                             bool* p_restart_input,
+                                             bool* p_restart_output,
+                                             bool* p_config_updated) {
+  tA2DP_LHDC_ENCODER_PARAMS* p_encoder_params =
+      &a2dp_lhdc_encoder_cb.lhdc_encoder_params;
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+
+  *p_restart_input = false;
+  *p_restart_output = false;
+  *p_config_updated = false;
+
+  if (!a2dp_codec_config->copyOutOtaCodecConfig(codec_info)) {
+    LOG_ERROR(LOG_TAG,
+              "%s: Cannot update the codec encoder for %s: "
+              "invalid codec config",
+              __func__, a2dp_codec_config->name().c_str());
+    return;
+  }
+  const uint8_t* p_codec_info = codec_info;
+  btav_a2dp_codec_config_t codec_config = a2dp_codec_config->getCodecConfig();
+
+  // The feeding parameters
+  tA2DP_FEEDING_PARAMS* p_feeding_params = &a2dp_lhdc_encoder_cb.feeding_params;
+  p_feeding_params->sample_rate = Policy::GetTrackSampleRate(p_codec_info);
+  p_feeding_params->bits_per_sample =
+      a2dp_codec_config->getAudioBitsPerSample();
+  p_feeding_params->channel_count = Policy::GetTrackChannelCount(p_codec_info);
+  LOG_DEBUG(LOG_TAG, "%s: sample_rate=%u bits_per_sample=%u channel_count=%u",
+            __func__, p_feeding_params->sample_rate,
+            p_feeding_params->bits_per_sample, p_feeding_params->channel_count);
+
+  // The codec parameters
+  p_encoder_params->sample_rate =
+      a2dp_lhdc_encoder_cb.feeding_params.sample_rate;
+  p_encoder_params->channel_mode = Policy::GetChannelModeCode(p_codec_info);
+
+  uint16_t mtu_size =
+      BT_DEFAULT_BUFFER_SIZE - A2DP_LHDC_OFFSET - sizeof(BT_HDR);
+  if (mtu_size < peer_mtu) {
+    a2dp_lhdc_encoder_cb.TxAaMtuSize = mtu_size;
+  } else {
+    a2dp_lhdc_encoder_cb.TxAaMtuSize = peer_mtu;
+  }
+
+  //get separation feature.
+  p_encoder_params->isChannelSeparation =
+      Policy::GetChannelSeparation(p_codec_info);
+  // Set the quality mode index
+  LOG_DEBUG(LOG_TAG, "%s:codec_config.codec_specific_1 = %d, codec_config.codec_specific_2 = %d", __func__, (int32_t)codec_config.codec_specific_1, (int32_t)codec_config.codec_specific_2);
+  if ((codec_config.codec_specific_1 & A2DP_LHDC_VENDOR_CMD_MASK) == A2DP_LDHC_QUALITY_MAGIC_NUM) {
+      int newValue = codec_config.codec_specific_1 & 0xff;
+      if (newValue != p_encoder_params->quality_mode_index) {
+
+        p_encoder_params->quality_mode_index = newValue;
+        LOG_DEBUG(LOG_TAG, "%s: setting quality mode to %s(%d)", __func__,
+                  quality_mode_index_to_name(p_encoder_params->quality_mode_index)
+                      .c_str(), p_encoder_params->quality_mode_index);
+      }
+  }else {
+      p_encoder_params->quality_mode_index = A2DP_LHDC_QUALITY_LOW;
+  }
+  if (p_encoder_params->isChannelSeparation && p_encoder_params->quality_mode_index >= A2DP_LHDC_QUALITY_HIGH) {
+      LOG_DEBUG(LOG_TAG, "%s: Channel separation enabled, Max bit rate = A2DP_LHDC_QUALITY_MID", __func__);
+      p_encoder_params->quality_mode_index = A2DP_LHDC_QUALITY_MID;
+  }
+  // In ABR mode the quality mode is picked by the in-stack ABR controller,
+  // and in auto mode the link signals cap it as well
+  bool use_link_quality =
+      p_encoder_params->quality_mode_index == A2DP_LHDC_QUALITY_AUTO;
+  if (p_encoder_params->quality_mode_index == A2DP_LHDC_QUALITY_ABR ||
+      use_link_quality) {
+    if (!a2dp_lhdc_encoder_cb.has_lhdc_abr ||
+        use_link_quality != a2dp_lhdc_encoder_cb.use_link_quality) {
+      a2dp_lhdc_abr_init(&a2dp_lhdc_encoder_cb.lhdc_abr, A2DP_LHDC_QUALITY_LOW,
+                         A2DP_LHDC_QUALITY_HIGH, A2DP_LHDC_QUALITY_MID);
+      a2dp_lhdc_encoder_cb.has_lhdc_abr = true;
+      memset(&a2dp_lhdc_encoder_cb.link_quality, 0,
+             sizeof(a2dp_lhdc_encoder_cb.link_quality));
+    }
+  } else {
+    a2dp_lhdc_encoder_cb.has_lhdc_abr = false;
+  }
+  a2dp_lhdc_encoder_cb.use_link_quality = use_link_quality;
+  int bitrate_quality_mode_index = get_bitrate_quality_mode_index();
+
+  if ((codec_config.codec_specific_2 & A2DP_LHDC_VENDOR_CMD_MASK) == A2DP_LHDC_LATENCY_MAGIC_NUM) {
+      int newValue = codec_config.codec_specific_2 & 0xff;
+      if (newValue != p_encoder_params->latency_mode_index) {
+          p_encoder_params->latency_mode_index = newValue;
+          LOG_DEBUG(LOG_TAG, "%s: setting latency value to %s(%d)", __func__,
+                    latency_mode_index_to_name(p_encoder_params->latency_mode_index).c_str(),
+                    p_encoder_params->latency_mode_index);
+      }
+  }else {
+      p_encoder_params->latency_mode_index = A2DP_LHDC_LATENCY_MID;
+  }
+
+  p_encoder_params->pcm_wlength =
+      a2dp_lhdc_encoder_cb.feeding_params.bits_per_sample >> 3;
+  // Set the Audio format from pcm_wlength
+  p_encoder_params->pcm_fmt = LHDCBT_SMPL_FMT_S16;
+  if (p_encoder_params->pcm_wlength == 2)
+    p_encoder_params->pcm_fmt = LHDCBT_SMPL_FMT_S16;
+  else if (p_encoder_params->pcm_wlength == 3)
+    p_encoder_params->pcm_fmt = LHDCBT_SMPL_FMT_S24;
+
+  LOG_DEBUG(LOG_TAG, "%s: MTU=%d, peer_mtu=%d", __func__,
+            a2dp_lhdc_encoder_cb.TxAaMtuSize, peer_mtu);
+  LOG_DEBUG(LOG_TAG,
+            "%s: sample_rate: %d channel_mode: %d "
+            "quality_mode_index: %d pcm_wlength: %d pcm_fmt: %d",
+            __func__, p_encoder_params->sample_rate,
+            p_encoder_params->channel_mode,
+            p_encoder_params->quality_mode_index, p_encoder_params->pcm_wlength,
+            p_encoder_params->pcm_fmt);
+
+  // Size the scratch buffers for the encoder blocks
+  uint32_t pcm_bytes_per_frame = get_pcm_bytes_per_block();
+  if (a2dp_lhdc_encoder_cb.scratch_buffer_size < pcm_bytes_per_frame) {
+    free_scratch_buffers();
+    a2dp_lhdc_encoder_cb.pcm_buffer = (uint8_t*)osi_malloc(
+        pcm_bytes_per_frame * A2DP_LHDC_MAX_READ_FRAMES);
+    a2dp_lhdc_encoder_cb.bitstream_buffer =
+        (uint8_t*)osi_malloc(pcm_bytes_per_frame);
+    a2dp_lhdc_encoder_cb.scratch_buffer_size = pcm_bytes_per_frame;
+  }
+  uint32_t packet_buffer_len =
+      a2dp_lhdc_encoder_cb.TxAaMtuSize + pcm_bytes_per_frame;
+  if (packet_buffer_len > mtu_size) packet_buffer_len = mtu_size;
+  a2dp_lhdc_encoder_cb.packet_buffer_len = packet_buffer_len;
+  A2DP_ReserveEncoderPacketSize(A2DP_LHDC_OFFSET, packet_buffer_len);
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.pcm_read_offset = 0;
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.pcm_read_len = 0;
+
+  a2dp_resampler_cleanup(&a2dp_lhdc_encoder_cb.resampler);
+  if (p_feeding_params->sample_rate != p_encoder_params->sample_rate) {
+    // Only 16-bit PCM can be converted
+    if (p_feeding_params->bits_per_sample != 16 ||
+        !a2dp_resampler_init(&a2dp_lhdc_encoder_cb.resampler,
+                             p_feeding_params->sample_rate,
+                             p_encoder_params->sample_rate,
+                             p_feeding_params->channel_count)) {
+      LOG_ERROR(LOG_TAG, "%s: cannot convert %u-bit PCM from %u Hz to %u Hz",
+                __func__, p_feeding_params->bits_per_sample,
+                p_feeding_params->sample_rate, p_encoder_params->sample_rate);
+    }
+  }
+
+  // Reuse an encoder handle initialized with the same parameters if there
+  // is one, as the initialization takes up to a few hundred milliseconds.
+  tA2DP_LHDC_HANDLE_KEY handle_key;
+  handle_key.sample_rate = p_encoder_params->sample_rate;
+  handle_key.pcm_fmt = p_encoder_params->pcm_fmt;
+  handle_key.isChannelSeparation = p_encoder_params->isChannelSeparation;
+  if (a2dp_lhdc_encoder_cb.is_lhdc_handle_initialized &&
+      handle_key_equals(&a2dp_lhdc_encoder_cb.lhdc_handle_key, &handle_key)) {
+    lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle,
+                          bitrate_quality_mode_index);
+    return;
+  }
+  release_handle();
+  if (acquire_cached_handle(&handle_key)) {
+    LOG_DEBUG(LOG_TAG, "%s: reusing a cached LHDC encoder handle", __func__);
+    lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle,
+                          bitrate_quality_mode_index);
+    return;
+  }
+
+  a2dp_lhdc_encoder_cb.lhdc_handle = lhdc_get_handle_func();
+  if (a2dp_lhdc_encoder_cb.lhdc_handle == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: Cannot get LHDC encoder handle", __func__);
+    return;  // TODO: Return an error?
+  }
+  a2dp_lhdc_encoder_cb.has_lhdc_handle = true;
+  //Example for limit bit rate
+  lhdc_set_limit_bitrate_enabled(a2dp_lhdc_encoder_cb.lhdc_handle, 0);
+  lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle, bitrate_quality_mode_index);
+
+  // Initialize the encoder.
+  // NOTE: MTU in the initialization must include the AVDT media header size.
+  int result = lhdc_init_handle_encode_func(
+      a2dp_lhdc_encoder_cb.lhdc_handle,
+      p_encoder_params->sample_rate,
+      p_encoder_params->pcm_fmt,
+      bitrate_quality_mode_index,
+      p_encoder_params->isChannelSeparation == true ? 1 : 0
+  );
+  if (result != 0) {
+    LOG_ERROR(LOG_TAG, "%s: error initializing the LHDC encoder: %d", __func__,
+              result);
+    return;
+  }
+  a2dp_lhdc_encoder_cb.is_lhdc_handle_initialized = true;
+  a2dp_lhdc_encoder_cb.lhdc_handle_key = handle_key;
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encoder_cleanup(void) {
+  // Keep the handle warm for the next stream
+  release_handle();
+  free_scratch_buffers();
+  a2dp_resampler_cleanup(&a2dp_lhdc_encoder_cb.resampler);
+  memset(&a2dp_lhdc_encoder_cb, 0, sizeof(a2dp_lhdc_encoder_cb));
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::feeding_reset(void) {
+  /* By default, just clear the entire state */
+  memset(&a2dp_lhdc_encoder_cb.lhdc_feeding_state, 0,
+         sizeof(a2dp_lhdc_encoder_cb.lhdc_feeding_state));
+  // The stream is (re)started: the interval follows the current MTU and
+  // quality mode until the next suspend
+  select_encoder_interval();
+
+  a2dp_pacing_init(&a2dp_lhdc_encoder_cb.lhdc_feeding_state.pacing,
+                   a2dp_lhdc_encoder_cb.feeding_params.sample_rate *
+                       a2dp_lhdc_encoder_cb.feeding_params.bits_per_sample / 8 *
+                       a2dp_lhdc_encoder_cb.feeding_params.channel_count,
+                   get_encoder_interval_ms() * 1000);
+  // The PCM is read at the encoder sample rate
+  a2dp_silence_init(&a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence,
+                    a2dp_lhdc_encoder_cb.lhdc_encoder_params.sample_rate *
+                        a2dp_lhdc_encoder_cb.feeding_params.bits_per_sample /
+                        8 * a2dp_lhdc_encoder_cb.feeding_params.channel_count,
+                    A2DP_LHDC_SILENCE_MS);
+  a2dp_resampler_reset(&a2dp_lhdc_encoder_cb.resampler);
+  a2dp_lhdc_encoder_cb.buf_seq = 0;
+  A2DP_VendorResetMergedPacketsLhdc();
+  LOG_DEBUG(LOG_TAG, "%s: PCM bytes per tick %u", __func__,
+            a2dp_pacing_get_bytes_per_tick(
+                &a2dp_lhdc_encoder_cb.lhdc_feeding_state.pacing));
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::feeding_flush(void) {
+  a2dp_pacing_flush(&a2dp_lhdc_encoder_cb.lhdc_feeding_state.pacing);
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.pcm_read_offset = 0;
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.pcm_read_len = 0;
+  a2dp_resampler_reset(&a2dp_lhdc_encoder_cb.resampler);
+  LOG_DEBUG(LOG_TAG, "%s", __func__);
+}
+
+template <class Policy>
+period_ms_t A2dpLhdcEncoder<Policy>::get_encoder_interval_ms(void) {
+  period_ms_t interval_ms = a2dp_lhdc_encoder_cb.encoder_interval_ms;
+  if (interval_ms == 0) {
+    interval_ms = ultra_low_latency ? Policy::kUltraLowLatencyIntervalMs
+                                    : Policy::kEncoderIntervalMs;
+  }
+  LOG_DEBUG(LOG_TAG, "%s: encoder interval %u ms", __func__,
+            (uint32_t)interval_ms);
+  return interval_ms;
+}
+
+// The encoder holds back one block of the overlapped transform.
+template <class Policy>
+uint64_t A2dpLhdcEncoder<Policy>::get_encoder_lookahead_us(void) {
+  uint32_t sample_rate = a2dp_lhdc_encoder_cb.feeding_params.sample_rate;
+  if (sample_rate == 0) return 0;
+  return (uint64_t)LHDCBT_ENC_BLOCK_SIZE * 1000000 / sample_rate;
+}
+
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::is_ultra_low_latency(void) {
+  return ultra_low_latency;
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::set_pcm_available(size_t pcm_available) {
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.pcm_available = pcm_available;
+  a2dp_lhdc_encoder_cb.lhdc_feeding_state.has_pcm_available = true;
+}
+
+template <class Policy>
+int A2dpLhdcEncoder<Policy>::get_quality_index(void) {
+  if (!a2dp_lhdc_encoder_cb.has_lhdc_handle) return -1;
+  return get_bitrate_quality_mode_index();
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::send_frames(uint64_t timestamp_us) {
+  uint8_t nb_frame = 0;
+  uint8_t nb_iterations = 0;
+
+  get_num_frame_iteration(&nb_iterations, &nb_frame, timestamp_us);
+  TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG,
+                 "%s: Sending %d frames per iteration, %d iterations", __func__,
+                 nb_frame, nb_iterations);
+  if (nb_frame == 0) return;
+
+  for (uint8_t counter = 0; counter < nb_iterations; counter++) {
+    // Transcode frame and enqueue
+    encode_frames(nb_frame);
+  }
+}
+
+// Obtains the number of frames to send and number of iterations
+// to be used. |num_of_iterations| and |num_of_frames| parameters
+// are used as output param for returning the respective values.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::get_num_frame_iteration(
+    uint8_t* num_of_iterations, uint8_t* num_of_frames,
+    uint64_t timestamp_us) {
+  tA2DP_LHDC_FEEDING_STATE* p_feeding_state =
+      &a2dp_lhdc_encoder_cb.lhdc_feeding_state;
+  uint32_t result = 0;
+  uint8_t nof = 0;
+  uint8_t noi = 1;
+
+  uint32_t pcm_bytes_per_frame =
+      A2DP_LHDC_MEDIA_BYTES_PER_FRAME *
+      a2dp_lhdc_encoder_cb.feeding_params.channel_count *
+      a2dp_lhdc_encoder_cb.feeding_params.bits_per_sample / 8;
+  TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG, "%s: pcm_bytes_per_frame %u",
+                 __func__, pcm_bytes_per_frame);
+
+  result = a2dp_pacing_update(&p_feeding_state->pacing, timestamp_us,
+                              pcm_bytes_per_frame);
+
+  // Only send the frames whose PCM is already there, instead of reading
+  // short and padding them with silence. The others stay credited to the
+  // following ticks. The PCM read through the resampler is not known ahead.
+  if (p_feeding_state->has_pcm_available &&
+      a2dp_lhdc_encoder_cb.resampler.coefs == NULL && pcm_bytes_per_frame > 0) {
+    size_t pcm_available = p_feeding_state->pcm_available;
+    if (p_feeding_state->pcm_read_len > p_feeding_state->pcm_read_offset) {
+      pcm_available +=
+          p_feeding_state->pcm_read_len - p_feeding_state->pcm_read_offset;
+    }
+    size_t available_frames = pcm_available / pcm_bytes_per_frame;
+    if (result > available_frames) {
+      TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG,
+                     "%s: deferring %u frames, %zu bytes available", __func__,
+                     (unsigned)(result - available_frames), pcm_available);
+      a2dp_lhdc_encoder_cb.stats.media_read_total_deferred_frames +=
+          result - available_frames;
+      result = available_frames;
+    }
+  }
+  p_feeding_state->has_pcm_available = false;
+
+  a2dp_pacing_consume(&p_feeding_state->pacing, result, pcm_bytes_per_frame);
+  a2dp_pacing_limit(&p_feeding_state->pacing,
+                    A2DP_PACING_MAX_INTERVALS_PER_TICK);
+  nof = result;
+
+  TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG,
+                 "%s: effective num of frames %u, iterations %u", __func__, nof,
+                 noi);
+
+  *num_of_frames = nof;
+  *num_of_iterations = noi;
+}
+
+template <class Policy>
+BT_HDR* A2dpLhdcEncoder<Policy>::bt_buf_new(void) {
+  BT_HDR* p_buf = A2DP_AllocEncoderPacket(
+      A2DP_LHDC_OFFSET, a2dp_lhdc_encoder_cb.packet_buffer_len);
+  if (p_buf == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: bt_buf_new failed!", __func__);
+    return NULL;
+  }
+  return p_buf;
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::free_scratch_buffers(void) {
+  osi_free_and_reset((void**)&a2dp_lhdc_encoder_cb.pcm_buffer);
+  osi_free_and_reset((void**)&a2dp_lhdc_encoder_cb.bitstream_buffer);
+  a2dp_lhdc_encoder_cb.scratch_buffer_size = 0;
+}
+
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::handle_key_equals(
+    const tA2DP_LHDC_HANDLE_KEY* p_a, const tA2DP_LHDC_HANDLE_KEY* p_b) {
+  return p_a->sample_rate == p_b->sample_rate &&
+         p_a->pcm_fmt == p_b->pcm_fmt &&
+         p_a->isChannelSeparation == p_b->isChannelSeparation;
+}
+
+// Releases the encoder handle in use. An initialized handle is kept in the
+// handle cache, evicting the least recently used one if the cache is full.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::release_handle(void) {
+  if (!a2dp_lhdc_encoder_cb.has_lhdc_handle) return;
+  a2dp_lhdc_encoder_cb.has_lhdc_handle = false;
+
+  if (!a2dp_lhdc_encoder_cb.is_lhdc_handle_initialized) {
+    lhdc_free_handle_func(a2dp_lhdc_encoder_cb.lhdc_handle);
+    return;
+  }
+  a2dp_lhdc_encoder_cb.is_lhdc_handle_initialized = false;
+
+  tA2DP_LHDC_HANDLE_CACHE_ENTRY* p_entry = &a2dp_lhdc_handle_cache[0];
+  for (size_t i = 0; i < A2DP_LHDC_HANDLE_CACHE_SIZE; i++) {
+    tA2DP_LHDC_HANDLE_CACHE_ENTRY* p_other = &a2dp_lhdc_handle_cache[i];
+    if (p_other->lhdc_handle == NULL) {
+      p_entry = p_other;
+      break;
+    }
+    if (p_other->last_used_us < p_entry->last_used_us) p_entry = p_other;
+  }
+  if (p_entry->lhdc_handle != NULL) lhdc_free_handle_func(p_entry->lhdc_handle);
+
+  p_entry->lhdc_handle = a2dp_lhdc_encoder_cb.lhdc_handle;
+  p_entry->key = a2dp_lhdc_encoder_cb.lhdc_handle_key;
+  p_entry->last_used_us = time_get_os_boottime_us();
+}
+
+// Moves a cached encoder handle initialized for |p_key| into use.
+// Returns true on success, otherwise false if there is none.
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::acquire_cached_handle(
+    const tA2DP_LHDC_HANDLE_KEY* p_key) {
+  for (size_t i = 0; i < A2DP_LHDC_HANDLE_CACHE_SIZE; i++) {
+    tA2DP_LHDC_HANDLE_CACHE_ENTRY* p_entry = &a2dp_lhdc_handle_cache[i];
+    if (p_entry->lhdc_handle == NULL ||
+        !handle_key_equals(&p_entry->key, p_key)) {
+      continue;
+    }
+    a2dp_lhdc_encoder_cb.lhdc_handle = p_entry->lhdc_handle;
+    a2dp_lhdc_encoder_cb.has_lhdc_handle = true;
+    a2dp_lhdc_encoder_cb.is_lhdc_handle_initialized = true;
+    a2dp_lhdc_encoder_cb.lhdc_handle_key = *p_key;
+    memset(p_entry, 0, sizeof(*p_entry));
+    return true;
+  }
+  return false;
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::free_handle_cache(void) {
+  for (size_t i = 0; i < A2DP_LHDC_HANDLE_CACHE_SIZE; i++) {
+    tA2DP_LHDC_HANDLE_CACHE_ENTRY* p_entry = &a2dp_lhdc_handle_cache[i];
+    if (p_entry->lhdc_handle != NULL) lhdc_free_handle_func(p_entry->lhdc_handle);
+    memset(p_entry, 0, sizeof(*p_entry));
+  }
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encode_frames(uint8_t nb_frame) {
+  if (a2dp_lhdc_encoder_cb.pcm_buffer == NULL ||
+      a2dp_lhdc_encoder_cb.bitstream_buffer == NULL) {
+    LOG_ERROR(LOG_TAG, "%s: encoder scratch buffers not allocated", __func__);
+    return;
+  }
+
+  if (Policy::kSkipLeadingSilence) {
+    tA2DP_LHDC_FEEDING_STATE* p_feeding_state =
+        &a2dp_lhdc_encoder_cb.lhdc_feeding_state;
+    if (p_feeding_state->catch_up_ticks > 0) {
+      p_feeding_state->catch_up_ticks--;
+      nb_frame++;
+      if (p_feeding_state->catch_up_ticks == 0)
+        LOG_DEBUG(LOG_TAG, "%s: caught up", __func__);
+    }
+  }
+
+  if (ultra_low_latency) {
+    // Enqueue each frame as soon as it is encoded
+    while (nb_frame > 0) {
+      nb_frame--;
+      encode_fragmented_frames(1);
+    }
+  } else if (Policy::kPackSeparatedChannelFrames &&
+             a2dp_lhdc_encoder_cb.lhdc_encoder_params.isChannelSeparation) {
+    encode_packed_frames(nb_frame);
+  } else {
+    encode_fragmented_frames(nb_frame);
+  }
+}
+
+// Encodes the |nb_frame| frames of a tick as a single media frame, which is
+// fragmented over as many packets as needed. The blocks are encoded in place
+// at the end of the current packet when it has room for a whole block, and
+// only the part beyond the MTU is copied to the next packets.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encode_fragmented_frames(uint8_t nb_frame) {
+    BT_HDR * p_buf = NULL;
+    BT_HDR ** btBufs = a2dp_lhdc_encoder_cb.fragments;
+    size_t nb_btBufs = 0;
+    uint8_t frame_cnt = 0;
+    uint32_t max_mtu_len = get_max_payload_len();
+    uint32_t block_len = get_pcm_bytes_per_block();
+    uint8_t * read_buffer = NULL;
+    uint8_t * write_buffer = NULL;
+    uint8_t latency = a2dp_lhdc_encoder_cb.lhdc_encoder_params.latency_mode_index;
+    int out_offset = 0;
+    int out_len = 0;
+
+    while( nb_frame && nb_btBufs < A2DP_LHDC_MAX_FRAGMENTS) {
+        if ( !read_next_frame(&nb_frame, &read_buffer)) break;
+
+        if (p_buf == NULL) {
+            if (NULL == (p_buf = bt_buf_new())) {
+                LOG_ERROR (LOG_TAG, "%s: ERROR", __func__);
+                for (size_t i = 0; i < nb_btBufs; i++) {
+                    osi_free(btBufs[i]);
+                }
+                return;
+            }
+        }
+
+        out_offset = 0;
+        if ((uint32_t)(a2dp_lhdc_encoder_cb.packet_buffer_len - p_buf->len) >=
+            block_len) {
+            write_buffer = ( uint8_t *)( p_buf + 1) + p_buf->offset + p_buf->len;
+            out_len = encode_block(read_buffer, write_buffer);
+            if (out_len > 0) {
+                int space = max_mtu_len - p_buf->len;
+                out_offset = ( out_len < space)? out_len : space;
+                out_len -= out_offset;
+                p_buf->len += out_offset;
+                account_data_rate(out_offset);
+            }
+        } else {
+            write_buffer = a2dp_lhdc_encoder_cb.bitstream_buffer;
+            out_len = encode_block(read_buffer, write_buffer);
+        }
+        nb_frame--;
+        frame_cnt++;
+
+        while (true) {
+            if ( p_buf != NULL && p_buf->len >= max_mtu_len ) {
+                btBufs[nb_btBufs++] = p_buf;
+                // allocate new one
+                p_buf = NULL;
+                if (nb_btBufs >= A2DP_LHDC_MAX_FRAGMENTS) {
+                    LOG_ERROR(LOG_TAG, "%s: Packet buffer usage to big!(%u)", __func__, (uint32_t)nb_btBufs);
+                    break;
+                }
+            }
+            if (out_len <= 0) break;
+
+            if (p_buf == NULL) {
+                if (NULL == (p_buf = bt_buf_new())) {
+                    LOG_ERROR (LOG_TAG, "%s: ERROR", __func__);
+                    for (size_t i = 0; i < nb_btBufs; i++) {
+                        osi_free(btBufs[i]);
+                    }
+                    return;
+                }
+            }
+
+            uint8_t *p = ( uint8_t *)( p_buf + 1) + p_buf->offset + p_buf->len;
+            int space = max_mtu_len - p_buf->len;
+            int bytes = ( out_len < space)? out_len : space;
+            memcpy( p, &write_buffer[out_offset], bytes);
+            out_offset += bytes;
+            out_len -= bytes;
+            p_buf->len += bytes;
+            account_data_rate(bytes);
+        }
+    }
+
+    if ( p_buf) {
+        if (p_buf->len > 0) {
+            btBufs[nb_btBufs++] = p_buf;
+        } else {
+            osi_free(p_buf);
+        }
+    }
+
+    TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG, "%s:nb_btBufs = %u", __func__,
+                   (uint32_t)nb_btBufs);
+    if ( nb_btBufs == 1) {
+        enqueue_packet(btBufs[0], latency | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+    } else {
+        for( size_t i = 0; i < nb_btBufs; i++) {
+            uint8_t header = A2DP_LHDC_HDR_F_MSK | latency;
+            if ( i == 0) {
+                header |= ( A2DP_LHDC_HDR_S_MSK | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+            } else if ( i == ( nb_btBufs - 1)) {
+                header |= A2DP_LHDC_HDR_L_MSK;
+            }
+            enqueue_packet(btBufs[i], header);
+        }
+    }
+
+    a2dp_lhdc_encoder_cb.timestamp += ( frame_cnt * LHDCBT_ENC_BLOCK_SIZE);
+}
+
+// Encodes the |nb_frame| frames of a tick, packing as many whole frames in
+// each packet as fit. Each packet is a media frame of its own. The blocks
+// are encoded in place at the end of the current packet when it has room
+// for a whole block, and a block that does not fit in the MTU is moved to
+// the next packet.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::encode_packed_frames(uint8_t nb_frame) {
+    BT_HDR * p_buf = NULL;
+    uint8_t frame_cnt = 0;
+    uint32_t max_mtu_len = get_max_payload_len();
+    uint32_t block_len = get_pcm_bytes_per_block();
+    uint8_t * read_buffer = NULL;
+    uint8_t * write_buffer = NULL;
+    uint8_t latency = a2dp_lhdc_encoder_cb.lhdc_encoder_params.latency_mode_index;
+    int out_len = 0;
+
+    while( nb_frame) {
+        if ( !read_next_frame(&nb_frame, &read_buffer)) break;
+
+        if (p_buf != NULL && frame_cnt == A2DP_LHDC_HDR_NUM_MAX) {
+            enqueue_packet(p_buf, latency | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+            a2dp_lhdc_encoder_cb.timestamp += ( frame_cnt * LHDCBT_ENC_BLOCK_SIZE);
+            p_buf = NULL;
+            frame_cnt = 0;
+        }
+        if (p_buf == NULL) {
+            if (NULL == (p_buf = bt_buf_new())) {
+                LOG_ERROR (LOG_TAG, "%s: ERROR", __func__);
+                return;
+            }
+        }
+
+        uint8_t *p = ( uint8_t *)( p_buf + 1) + p_buf->offset + p_buf->len;
+        if ((uint32_t)(a2dp_lhdc_encoder_cb.packet_buffer_len - p_buf->len) >=
+            block_len) {
+            write_buffer = p;
+        } else {
+            write_buffer = a2dp_lhdc_encoder_cb.bitstream_buffer;
+        }
+        out_len = encode_block(read_buffer, write_buffer);
+        nb_frame--;
+        if (out_len <= 0 || out_len > (int)max_mtu_len) {
+            LOG_WARN(LOG_TAG, "%s: encoded size to large %d, skip 1 frame.", __func__, out_len);
+            continue;
+        }
+
+        if ((uint32_t)(p_buf->len + out_len) > max_mtu_len) {
+            // The packet is full, the block starts the next one
+            BT_HDR * p_next = bt_buf_new();
+            if (p_next == NULL) {
+                LOG_ERROR (LOG_TAG, "%s: ERROR", __func__);
+                enqueue_packet(p_buf, latency | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+                a2dp_lhdc_encoder_cb.timestamp += ( frame_cnt * LHDCBT_ENC_BLOCK_SIZE);
+                return;
+            }
+            memcpy(( uint8_t *)( p_next + 1) + p_next->offset, write_buffer, out_len);
+            enqueue_packet(p_buf, latency | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+            a2dp_lhdc_encoder_cb.timestamp += ( frame_cnt * LHDCBT_ENC_BLOCK_SIZE);
+            p_buf = p_next;
+            frame_cnt = 0;
+        } else if (write_buffer != p) {
+            memcpy( p, write_buffer, out_len);
+        }
+        p_buf->len += out_len;
+        account_data_rate(out_len);
+        frame_cnt++;
+    }
+
+    if ( p_buf) {
+        if (frame_cnt > 0) {
+            enqueue_packet(p_buf, latency | ( frame_cnt << A2DP_LHDC_HDR_NUM_SHIFT));
+            a2dp_lhdc_encoder_cb.timestamp += ( frame_cnt * LHDCBT_ENC_BLOCK_SIZE);
+        } else {
+            osi_free(p_buf);
+        }
+    }
+}
+
+// Encodes the block of PCM |read_buffer| to |write_buffer|, accounting the
+// time spent. Returns the size of the encoded block.
+template <class Policy>
+int A2dpLhdcEncoder<Policy>::encode_block(uint8_t* read_buffer,
+                                          uint8_t* write_buffer) {
+  a2dp_lhdc_encoder_stats_t* stats = &a2dp_lhdc_encoder_cb.stats;
+  uint64_t start_us = time_get_os_boottime_us();
+  int out_len = lhdc_encode_func(a2dp_lhdc_encoder_cb.lhdc_handle, read_buffer,
+                                 write_buffer);
+  uint64_t encode_us = time_get_os_boottime_us() - start_us;
+
+  stats->encode_count++;
+  stats->encode_total_us += encode_us;
+  if (encode_us > stats->encode_max_us) stats->encode_max_us = encode_us;
+  return out_len;
+}
+
+// Sets the LHDC media payload |header| and the timestamp of |p_buf|, and
+// enqueues it.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::enqueue_packet(BT_HDR* p_buf, uint8_t header) {
+  p_buf->layer_specific = a2dp_lhdc_encoder_cb.buf_seq++;
+  p_buf->layer_specific <<= 8;
+  p_buf->layer_specific |= header;
+
+  *((uint32_t*)(p_buf + 1)) = a2dp_lhdc_encoder_cb.timestamp;
+
+  a2dp_lhdc_encoder_cb.enqueue_callback(p_buf, 1);
+}
+
+// Returns in |p_read_buffer| the PCM of the next frame to encode, out of the
+// |*p_nb_frame| frames left in this tick. With |kSkipLeadingSilence|, the
+// silent frames at the start of the stream are dropped, and |*p_nb_frame| is
+// updated accordingly.
+// Returns false on underflow, after crediting the pacing with the PCM that
+// could not be read.
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::read_next_frame(uint8_t* p_nb_frame,
+                                              uint8_t** p_read_buffer) {
+  tA2DP_LHDC_FEEDING_STATE* p_feeding_state =
+      &a2dp_lhdc_encoder_cb.lhdc_feeding_state;
+  uint32_t read_size = get_pcm_bytes_per_block();
+
+  while (*p_nb_frame > 0) {
+    if (!read_feeding(*p_nb_frame, p_read_buffer)) {
+      LOG_WARN(LOG_TAG, "%s: underflow %d", __func__, *p_nb_frame);
+      a2dp_pacing_credit(&p_feeding_state->pacing, *p_nb_frame * read_size);
+      return false;
+    }
+    if (!Policy::kSkipLeadingSilence || p_feeding_state->is_audio_started) {
+      update_silence(*p_read_buffer, read_size);
+      return true;
+    }
+
+    const uint8_t* p = *p_read_buffer;
+    uint32_t i = 0;
+    while (i < read_size && p[i] == 0) i++;
+    if (i < read_size) {
+      // Catch up on the PCM buffered while skipping the silence
+      LOG_DEBUG(LOG_TAG, "%s: skipped %u silent frames", __func__,
+                p_feeding_state->silent_frames);
+      p_feeding_state->is_audio_started = true;
+      p_feeding_state->catch_up_ticks = A2DP_LHDC_CATCH_UP_TICKS;
+      (*p_nb_frame)++;
+      return true;
+    }
+    p_feeding_state->silent_frames++;
+    (*p_nb_frame)--;
+  }
+  return false;
+}
+
+// Returns in |p_read_buffer| the PCM of the next encoder block. The PCM of
+// the |nb_frame| blocks left in this tick is read at once, so that a single
+// read call feeds the whole tick.
+// Returns false if no PCM is available.
+template <class Policy>
+bool A2dpLhdcEncoder<Policy>::read_feeding(uint8_t nb_frame,
+                                           uint8_t** p_read_buffer) {
+  tA2DP_LHDC_FEEDING_STATE* p_feeding_state =
+      &a2dp_lhdc_encoder_cb.lhdc_feeding_state;
+  uint32_t read_size = get_pcm_bytes_per_block();
+
+  if (p_feeding_state->pcm_read_offset >= p_feeding_state->pcm_read_len) {
+    if (nb_frame == 0) nb_frame = 1;
+    if (nb_frame > A2DP_LHDC_MAX_READ_FRAMES)
+      nb_frame = A2DP_LHDC_MAX_READ_FRAMES;
+    uint32_t batch_size = nb_frame * read_size;
+
+    a2dp_lhdc_encoder_cb.stats.media_read_total_expected_reads_count +=
+        nb_frame;
+    a2dp_lhdc_encoder_cb.stats.media_read_total_expected_read_bytes +=
+        batch_size;
+
+    /* Read Data from UIPC channel, at the encoder sample rate */
+    uint32_t nb_byte_read;
+    if (a2dp_lhdc_encoder_cb.resampler.coefs != NULL) {
+      nb_byte_read = a2dp_resampler_read(&a2dp_lhdc_encoder_cb.resampler,
+                                         a2dp_lhdc_encoder_cb.read_callback,
+                                         a2dp_lhdc_encoder_cb.pcm_buffer,
+                                         batch_size);
+    } else {
+      nb_byte_read = a2dp_lhdc_encoder_cb.read_callback(
+          a2dp_lhdc_encoder_cb.pcm_buffer, batch_size);
+    }
+    TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG,
+                   "%s: want to read size %u, read byte number %u", __func__,
+                   batch_size, nb_byte_read);
+    a2dp_lhdc_encoder_cb.stats.media_read_total_actual_read_bytes +=
+        nb_byte_read;
+
+    p_feeding_state->pcm_read_offset = 0;
+    p_feeding_state->pcm_read_len = 0;
+    if (nb_byte_read == 0) return false;
+
+    uint32_t partial = nb_byte_read % read_size;
+    if (partial != 0) {
+      /* Fill the unfilled part of the last block with silence (0) */
+      memset(a2dp_lhdc_encoder_cb.pcm_buffer + nb_byte_read, 0,
+             read_size - partial);
+      nb_byte_read += read_size - partial;
+    }
+    p_feeding_state->pcm_read_len = nb_byte_read;
+    a2dp_lhdc_encoder_cb.stats.media_read_total_actual_reads_count +=
+        nb_byte_read / read_size;
+  }
+
+  *p_read_buffer =
+      a2dp_lhdc_encoder_cb.pcm_buffer + p_feeding_state->pcm_read_offset;
+  p_feeding_state->pcm_read_offset += read_size;
+  return true;
+}
+
+// Accounts the |read_size| octets of PCM |read_buffer| about to be encoded.
+// The bitrate drops to the lowest quality mode once the PCM has been silent
+// for |A2DP_LHDC_SILENCE_MS|, and is restored on the first block that is not
+// silent.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::update_silence(const uint8_t* read_buffer,
+                                             uint32_t read_size) {
+  tA2DP_SILENCE* p_silence = &a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence;
+  bool was_silent = p_silence->is_silent;
+  bool is_silent = a2dp_silence_proc(p_silence, read_buffer, read_size);
+  if (is_silent == was_silent || !a2dp_lhdc_encoder_cb.has_lhdc_handle) return;
+
+  int quality_mode_index = get_bitrate_quality_mode_index();
+  LOG_DEBUG(LOG_TAG, "%s: silence %s, quality mode %s", __func__,
+            is_silent ? "started" : "ended",
+            quality_mode_index_to_name(quality_mode_index).c_str());
+  lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle, quality_mode_index);
+}
+
+// Returns the quality mode the encoder bitrate should be set to: the lowest
+// one during a silence, otherwise the one picked by the ABR controller in
+// ABR mode, or the configured one.
+// Picks the encoder interval of the session. The ultra-low-latency mode
+// keeps its fixed interval, as each frame is enqueued right away anyway.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::select_encoder_interval(void) {
+  if (ultra_low_latency) {
+    a2dp_lhdc_encoder_cb.encoder_interval_ms =
+        Policy::kUltraLowLatencyIntervalMs;
+    return;
+  }
+  if (a2dp_lhdc_encoder_cb.TxAaMtuSize <= A2DP_LHDC_MPL_HDR_LEN + 1) {
+    a2dp_lhdc_encoder_cb.encoder_interval_ms = Policy::kEncoderIntervalMs;
+    return;
+  }
+
+  tA2DP_LHDC_INTERVAL_RANGE range = {
+      (uint32_t)Policy::kMinEncoderIntervalMs,
+      (uint32_t)Policy::kEncoderIntervalMs,
+      (uint32_t)Policy::kMaxEncoderIntervalMs, Policy::kPacketsPerTick};
+  a2dp_lhdc_encoder_cb.encoder_interval_ms =
+      a2dp_lhdc_select_encoder_interval_ms(
+          &range, get_max_payload_len(), get_bitrate_quality_mode_index(),
+          a2dp_lhdc_encoder_cb.lhdc_encoder_params.latency_mode_index);
+}
+
+template <class Policy>
+int A2dpLhdcEncoder<Policy>::get_bitrate_quality_mode_index(void) {
+  if (a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence.is_silent)
+    return A2DP_LHDC_QUALITY_LOW;
+  if (a2dp_lhdc_encoder_cb.has_lhdc_abr)
+    return a2dp_lhdc_encoder_cb.lhdc_abr.quality_mode_index;
+  return a2dp_lhdc_encoder_cb.lhdc_encoder_params.quality_mode_index;
+}
+
+// Accounts |bytes| of encoded data sent, and logs the data rate about once a
+// second.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::account_data_rate(int bytes) {
+  static uint32_t time_prev = time_get_os_boottime_ms();
+  static uint32_t allSendbytes = 0;
+
+  allSendbytes += bytes;
+  uint32_t now_ms = time_get_os_boottime_ms();
+  if (now_ms - time_prev >= 1000) {
+    TRACE_RING_LOG(TRACE_RING_INFO, LOG_TAG,
+                   "%s: Current data rate about %d kbps", __func__,
+                   (allSendbytes * 8) / 1000);
+    allSendbytes = 0;
+    time_prev = now_ms;
+  }
+}
+
+// Returns the room left for the encoded frames in a packet, after the LHDC
+// media payload header.
+template <class Policy>
+uint32_t A2dpLhdcEncoder<Policy>::get_max_payload_len(void) {
+#if (BTA_AV_CO_CP_SCMS_T == TRUE)
+  return (uint32_t)(a2dp_lhdc_encoder_cb.TxAaMtuSize - A2DP_LHDC_MPL_HDR_LEN - 1);
+#else
+  return (uint32_t)(a2dp_lhdc_encoder_cb.TxAaMtuSize - A2DP_LHDC_MPL_HDR_LEN);
+#endif
+}
+
+// Returns the size of the PCM of one encoder block in octets.
+template <class Policy>
+uint32_t A2dpLhdcEncoder<Policy>::get_pcm_bytes_per_block(void) {
+  return LHDCBT_ENC_BLOCK_SIZE *
+         a2dp_lhdc_encoder_cb.feeding_params.channel_count *
+         a2dp_lhdc_encoder_cb.feeding_params.bits_per_sample / 8;
+}
+
+template <class Policy>
+std::string A2dpLhdcEncoder<Policy>::quality_mode_index_to_name(
+    int quality_mode_index) {
+  switch (quality_mode_index) {
+    case A2DP_LHDC_QUALITY_HIGH:
+      return "HIGH";
+    case A2DP_LHDC_QUALITY_MID:
+      return "MID";
+    case A2DP_LHDC_QUALITY_LOW:
+      return "LOW";
+    case A2DP_LHDC_QUALITY_ABR:
+      return "ABR";
+    case A2DP_LHDC_QUALITY_AUTO:
+      return "AUTO";
+    default:
+      return "Unknown";
+  }
+}
+
+template <class Policy>
+std::string A2dpLhdcEncoder<Policy>::latency_mode_index_to_name(
+    int latency_mode_index) {
+  switch (latency_mode_index) {
+    case A2DP_LHDC_LATENCY_HIGH:
+      return "Long Latency";
+    case A2DP_LHDC_LATENCY_MID:
+      return "Middle Latency";
+    case A2DP_LHDC_LATENCY_LOW:
+      return "Short Latency";
+    default:
+      return "Unknown";
+  }
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::set_transmit_queue_length(
+    size_t transmit_queue_length) {
+  a2dp_lhdc_encoder_cb.TxQueueLength = transmit_queue_length;
+  TRACE_RING_LOG(TRACE_RING_DEBUG, LOG_TAG, "%s: transmit_queue_length %zu",
+                 __func__, transmit_queue_length);
+  // In ABR mode the bitrate follows the transmit queue delay instead, see
+  // set_transmit_queue_delay().
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::set_transmit_queue_delay(uint64_t queue_delay_us,
+                                                       bool is_congested) {
+  a2dp_lhdc_encoder_cb.last_queue_delay_us = queue_delay_us;
+  if (!a2dp_lhdc_encoder_cb.has_lhdc_abr) return;
+
+  tA2DP_LHDC_ABR* p_abr = &a2dp_lhdc_encoder_cb.lhdc_abr;
+  int prev_quality_mode_index = p_abr->quality_mode_index;
+  int quality_mode_index = a2dp_lhdc_abr_proc(
+      p_abr, time_get_os_boottime_us(), queue_delay_us, is_congested);
+  if (quality_mode_index == prev_quality_mode_index) return;
+  // The lowest quality mode is kept until the silence ends
+  if (a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence.is_silent) return;
+
+  LOG_DEBUG(LOG_TAG, "%s: ABR quality mode %s -> %s (queue delay %llu ms)",
+            __func__, quality_mode_index_to_name(prev_quality_mode_index).c_str(),
+            quality_mode_index_to_name(quality_mode_index).c_str(),
+            (unsigned long long)queue_delay_us / 1000);
+  lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle, quality_mode_index);
+}
+
+// In auto mode, caps the ABR quality mode from the link signals. The
+// failed contact counter only counts since the connection, so the ABR is
+// given the failed contacts since the previous sample.
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::set_link_quality(
+    const tA2DP_LINK_QUALITY* p_link_quality) {
+  if (!a2dp_lhdc_encoder_cb.has_lhdc_abr ||
+      !a2dp_lhdc_encoder_cb.use_link_quality)
+    return;
+
+  tA2DP_LINK_QUALITY* p_last = &a2dp_lhdc_encoder_cb.link_quality;
+  uint32_t failed_contacts = 0;
+  if (p_link_quality->has_failed_contact_counter &&
+      p_last->has_failed_contact_counter) {
+    failed_contacts = (uint16_t)(p_link_quality->failed_contact_counter -
+                                 p_last->failed_contact_counter);
+  }
+  *p_last = *p_link_quality;
+  a2dp_lhdc_encoder_cb.link_quality_samples++;
+
+  tA2DP_LHDC_ABR* p_abr = &a2dp_lhdc_encoder_cb.lhdc_abr;
+  int prev_quality_mode_index = p_abr->quality_mode_index;
+  int quality_mode_index = a2dp_lhdc_abr_link_proc(
+      p_abr, time_get_os_boottime_us(),
+      p_link_quality->has_rssi ? p_link_quality->rssi : 0,
+      p_link_quality->has_link_quality ? p_link_quality->link_quality : 255,
+      failed_contacts);
+  if (quality_mode_index == prev_quality_mode_index) return;
+  // The lowest quality mode is kept until the silence ends
+  if (a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence.is_silent) return;
+
+  LOG_DEBUG(LOG_TAG, "%s: link quality mode %s -> %s", __func__,
+            quality_mode_index_to_name(prev_quality_mode_index).c_str(),
+            quality_mode_index_to_name(quality_mode_index).c_str());
+  lhdc_set_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle, quality_mode_index);
+}
+
+template <class Policy>
+void A2dpLhdcEncoder<Policy>::debug_codec_dump(int fd) {
+  a2dp_lhdc_encoder_stats_t* stats = &a2dp_lhdc_encoder_cb.stats;
+  tA2DP_LHDC_ENCODER_PARAMS* p_encoder_params =
+      &a2dp_lhdc_encoder_cb.lhdc_encoder_params;
+
+  dprintf(fd,
+          "  Packet counts (expected/dropped)                        : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_packets,
+          stats->media_read_total_dropped_packets);
+
+  dprintf(fd,
+          "  PCM read counts (expected/actual)                       : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_reads_count,
+          stats->media_read_total_actual_reads_count);
+
+  dprintf(fd,
+          "  PCM read bytes (expected/actual)                        : %zu / "
+          "%zu\n",
+          stats->media_read_total_expected_read_bytes,
+          stats->media_read_total_actual_read_bytes);
+
+  dprintf(
+      fd, "  LHDC quality mode                                       : %s\n",
+      quality_mode_index_to_name(p_encoder_params->quality_mode_index).c_str());
+
+  dprintf(fd,
+          "  LHDC channel separation                                 : %s\n",
+          p_encoder_params->isChannelSeparation ? "true" : "false");
+
+  dprintf(fd,
+          "  LHDC encoder interval (ms)                              : %u\n",
+          (uint32_t)get_encoder_interval_ms());
+
+  dprintf(fd,
+          "  LHDC encoded blocks (count/avg us/max us)               : %zu / "
+          "%llu / %llu\n",
+          stats->encode_count,
+          (unsigned long long)(stats->encode_count > 0
+                                   ? stats->encode_total_us /
+                                         stats->encode_count
+                                   : 0),
+          (unsigned long long)stats->encode_max_us);
+
+  dprintf(fd,
+          "  LHDC transmission bitrate (Kbps)                        : %d\n",
+          lhdc_get_bitrate_func(a2dp_lhdc_encoder_cb.lhdc_handle));
+
+  dprintf(fd,
+          "  LHDC saved transmit queue length                        : %zu\n",
+          a2dp_lhdc_encoder_cb.TxQueueLength);
+
+  dprintf(fd,
+          "  LHDC saved transmit queue delay (ms)                    : %llu\n",
+          (unsigned long long)a2dp_lhdc_encoder_cb.last_queue_delay_us / 1000);
+
+  dprintf(fd,
+          "  LHDC frames deferred for the PCM not available          : %zu\n",
+          stats->media_read_total_deferred_frames);
+
+  if (Policy::kSkipLeadingSilence) {
+    dprintf(fd,
+            "  LHDC leading silent frames skipped                      : %u\n",
+            a2dp_lhdc_encoder_cb.lhdc_feeding_state.silent_frames);
+  }
+
+  dprintf(fd,
+          "  LHDC silences (count/ongoing)                           : %zu / "
+          "%s\n",
+          a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence.silences,
+          a2dp_lhdc_encoder_cb.lhdc_feeding_state.silence.is_silent ? "true"
+                                                                    : "false");
+
+  if (a2dp_lhdc_encoder_cb.has_lhdc_abr) {
+    dprintf(fd,
+            "  LHDC adaptive bit rate quality mode                     : %s\n",
+            quality_mode_index_to_name(
+                a2dp_lhdc_encoder_cb.lhdc_abr.quality_mode_index)
+                .c_str());
+    dprintf(fd,
+            "  LHDC adaptive bit rate adjustments                      : %zu\n",
+            a2dp_lhdc_encoder_cb.lhdc_abr.adjustments);
+  }
+
+  if (a2dp_lhdc_encoder_cb.has_lhdc_abr &&
+      a2dp_lhdc_encoder_cb.use_link_quality) {
+    const tA2DP_LINK_QUALITY* p_link = &a2dp_lhdc_encoder_cb.link_quality;
+    dprintf(fd,
+            "  LHDC link quality mode cap                              : %s\n",
+            quality_mode_index_to_name(
+                a2dp_lhdc_encoder_cb.lhdc_abr.link_max_quality_mode_index)
+                .c_str());
+    dprintf(fd,
+            "  LHDC link step downs (count/samples)                    : %zu / "
+            "%zu\n",
+            a2dp_lhdc_encoder_cb.lhdc_abr.link_step_downs,
+            a2dp_lhdc_encoder_cb.link_quality_samples);
+    if (p_link->has_rssi) {
+      dprintf(fd,
+              "  LHDC link RSSI (dB)                                     : "
+              "%d\n",
+              p_link->rssi);
+    }
+    if (p_link->has_link_quality) {
+      dprintf(fd,
+              "  LHDC link quality                                       : "
+              "%u\n",
+              p_link->link_quality);
+    }
+    if (p_link->has_failed_contact_counter) {
+      dprintf(fd,
+              "  LHDC link failed contacts (total/last sample)           : "
+              "%u / %u\n",
+              p_link->failed_contact_counter,
+              a2dp_lhdc_encoder_cb.lhdc_abr.last_failed_contacts);
+    }
+  }
+}
+
+#endif  // A2DP_VENDOR_LHDC_ENCODER_CORE_H
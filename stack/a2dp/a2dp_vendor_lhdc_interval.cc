@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "a2dp_vendor_lhdc_interval"
+
+#include "a2dp_vendor_lhdc_interval.h"
+
+#include "a2dp_vendor_lhdc_constants.h"
+#include "osi/include/log.h"
+
+//
+// LHDC encoder interval selection
+//
+
+uint32_t a2dp_lhdc_get_quality_bit_rate_kbps(int quality_mode_index) {
+  switch (quality_mode_index) {
+    case A2DP_LHDC_QUALITY_HIGH:
+      return 900;
+    case A2DP_LHDC_QUALITY_MID:
+      return 560;
+    case A2DP_LHDC_QUALITY_LOW:
+      return 400;
+    default:
+      return 0;
+  }
+}
+
+uint32_t a2dp_lhdc_select_encoder_interval_ms(
+    const tA2DP_LHDC_INTERVAL_RANGE* p_range, uint32_t max_payload_len,
+    int quality_mode_index, int latency_mode_index) {
+  uint32_t min_interval_ms = p_range->min_interval_ms;
+  uint32_t max_interval_ms = p_range->max_interval_ms;
+  if (latency_mode_index == A2DP_LHDC_LATENCY_LOW)
+    max_interval_ms = p_range->nominal_interval_ms;
+  else if (latency_mode_index == A2DP_LHDC_LATENCY_HIGH)
+    min_interval_ms = p_range->nominal_interval_ms;
+
+  uint32_t bit_rate_kbps =
+      a2dp_lhdc_get_quality_bit_rate_kbps(quality_mode_index);
+  if (bit_rate_kbps == 0 || max_payload_len == 0 ||
+      p_range->packets_per_tick == 0)
+    return p_range->nominal_interval_ms;
+
+  // A bit rate in kbps is also in bits per millisecond
+  uint32_t tick_bits = p_range->packets_per_tick * max_payload_len * 8;
+  uint32_t interval_ms = (tick_bits + bit_rate_kbps - 1) / bit_rate_kbps;
+  if (interval_ms < min_interval_ms) interval_ms = min_interval_ms;
+  if (interval_ms > max_interval_ms) interval_ms = max_interval_ms;
+
+  LOG_DEBUG(LOG_TAG,
+            "%s: %u ms for %u packets of %u octets at %u kbps "
+            "(latency mode %d)",
+            __func__, interval_ms, p_range->packets_per_tick, max_payload_len,
+            bit_rate_kbps, latency_mode_index);
+  return interval_ms;
+}
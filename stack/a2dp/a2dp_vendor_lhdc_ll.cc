@@ -31,6 +31,7 @@
 
 #include <base/logging.h>
 #include "a2dp_vendor.h"
+#include "a2dp_vendor_lhdc.h"
 #include "a2dp_vendor_lhdc_ll_encoder.h"
 #include "bt_utils.h"
 #include "osi/include/log.h"
@@ -79,7 +80,12 @@ static const tA2DP_ENCODER_INTERFACE a2dp_encoder_interface_lhdc_ll = {
     a2dp_vendor_lhdc_ll_feeding_flush,
     a2dp_vendor_lhdc_ll_get_encoder_interval_ms,
     a2dp_vendor_lhdc_ll_send_frames,
-    a2dp_vendor_lhdc_ll_set_transmit_queue_length};
+    a2dp_vendor_lhdc_ll_set_transmit_queue_length,
+    a2dp_vendor_lhdc_ll_set_transmit_queue_delay,
+    a2dp_vendor_lhdc_ll_is_ultra_low_latency,
+    a2dp_vendor_lhdc_ll_set_pcm_available,
+    a2dp_vendor_lhdc_ll_get_quality_index,
+    a2dp_vendor_lhdc_ll_set_link_quality};
 
 UNUSED_ATTR static tA2DP_STATUS A2DP_CodecInfoMatchesCapabilityLhdcLL(
     const tA2DP_LHDC_CIE* p_cap, const uint8_t* p_codec_info,
@@ -473,18 +479,24 @@ bool A2DP_VendorGetChannelSeparationLL(const uint8_t* p_codec_info){
   return lhdc_cie.isChannelSeparation == 0 ? false : true;
 }
 
-bool A2DP_VendorBuildCodecHeaderLhdcLL(UNUSED_ATTR const uint8_t* p_codec_info,
-                                     BT_HDR* p_buf,
-                                     uint16_t frames_per_packet) {
-  uint8_t* p;
-
-  p_buf->offset -= A2DP_LHDC_MPL_HDR_LEN;
-  p = (uint8_t*)(p_buf + 1) + p_buf->offset;
-  p_buf->len += A2DP_LHDC_MPL_HDR_LEN;
-  p[0] = ( uint8_t)( frames_per_packet & 0xff);
-  p[1] = ( uint8_t)( ( frames_per_packet >> 8) & 0xff);
-  //A2DP_BuildMediaPayloadHeaderLhdc(p, frames_per_packet);
-  return true;
+bool A2DP_VendorBuildCodecHeaderLhdcLL(const uint8_t* p_codec_info,
+                                       BT_HDR* p_buf,
+                                       uint16_t frames_per_packet) {
+  // LHDC LL uses the LHDC media payload header
+  return A2DP_VendorBuildCodecHeaderLhdc(p_codec_info, p_buf,
+                                         frames_per_packet);
+}
+
+bool A2DP_VendorPacketEndsFrameLhdcLL(UNUSED_ATTR const uint8_t* p_codec_info,
+                                      const BT_HDR* p_buf) {
+  // A frame that is not fragmented is carried in a single packet
+  if ((p_buf->layer_specific & A2DP_LHDC_HDR_F_MSK) == 0) return true;
+  return (p_buf->layer_specific & A2DP_LHDC_HDR_L_MSK) != 0;
+}
+
+bool A2DP_VendorMergePacketsLhdcLL(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                                   const BT_HDR* p_next, uint16_t max_len) {
+  return A2DP_VendorMergePacketsLhdc(p_codec_info, p_buf, p_next, max_len);
 }
 
 void A2DP_VendorDumpCodecInfoLhdcLL(const uint8_t* p_codec_info) {
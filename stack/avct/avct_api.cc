@@ -78,6 +78,7 @@ void AVCT_Register(uint16_t mtu, UNUSED_ATTR uint16_t mtu_br,
                        0, 0);
 
   if (mtu_br < AVCT_MIN_BROWSE_MTU) mtu_br = AVCT_MIN_BROWSE_MTU;
+  if (mtu_br > AVCT_MAX_BROWSE_MTU) mtu_br = AVCT_MAX_BROWSE_MTU;
   avct_cb.mtu_br = mtu_br;
 
 #if defined(AVCT_INITIAL_TRACE_LEVEL)
@@ -101,10 +101,10 @@ void avct_bcb_chnl_open(tAVCT_BCB* p_bcb, UNUSED_ATTR tAVCT_LCB_EVT* p_data) {
   /* Set the FCR options: Browsing channel mandates ERTM */
   ertm_info.preferred_mode = avct_l2c_br_fcr_opts_def.mode;
   ertm_info.allowed_modes = L2CAP_FCR_CHAN_OPT_ERTM;
-  ertm_info.user_rx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.user_tx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.fcr_rx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.fcr_tx_buf_size = BT_DEFAULT_BUFFER_SIZE;
+  ertm_info.user_rx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.user_tx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.fcr_rx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.fcr_tx_buf_size = AVCT_BR_BUF_SIZE;
 
   /* call l2cap connect req */
   p_bcb->ch_state = AVCT_CH_CONN;
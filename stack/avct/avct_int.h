@@ -55,6 +55,18 @@ enum {
 /* "no event" indicator used by ccb dealloc */
 #define AVCT_NO_EVT 0xFF
 
+/* the buffer size of the browsing channel, for the SDUs that its ERTM
+ * reassembles and segments */
+#ifndef AVCT_BR_BUF_SIZE
+#define AVCT_BR_BUF_SIZE BT_DEFAULT_BUFFER_SIZE
+#endif
+
+/* the largest browsing channel message that an AVCT_BR_BUF_SIZE buffer
+ * holds */
+#define AVCT_MAX_BROWSE_MTU                                                   \
+  (AVCT_BR_BUF_SIZE - BT_HDR_SIZE - L2CAP_MIN_OFFSET - L2CAP_SDU_LEN_OFFSET - \
+   L2CAP_FCS_LEN)
+
 /*****************************************************************************
  * data types
  ****************************************************************************/
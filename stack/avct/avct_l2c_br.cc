@@ -151,10 +151,10 @@ void avct_l2c_br_connect_ind_cback(BD_ADDR bd_addr, uint16_t lcid,
   /* Set the FCR options: Browsing channel mandates ERTM */
   ertm_info.preferred_mode = cfg.fcr.mode;
   ertm_info.allowed_modes = L2CAP_FCR_CHAN_OPT_ERTM;
-  ertm_info.user_rx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.user_tx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.fcr_rx_buf_size = BT_DEFAULT_BUFFER_SIZE;
-  ertm_info.fcr_tx_buf_size = BT_DEFAULT_BUFFER_SIZE;
+  ertm_info.user_rx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.user_tx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.fcr_rx_buf_size = AVCT_BR_BUF_SIZE;
+  ertm_info.fcr_tx_buf_size = AVCT_BR_BUF_SIZE;
 
   /* Send L2CAP connect rsp */
   L2CA_ErtmConnectRsp(bd_addr, id, lcid, result, 0, &ertm_info);
@@ -262,7 +262,7 @@ void avct_l2c_br_config_cfm_cback(uint16_t lcid, tL2CAP_CFG_INFO* p_cfg) {
  ******************************************************************************/
 void avct_l2c_br_config_ind_cback(uint16_t lcid, tL2CAP_CFG_INFO* p_cfg) {
   tAVCT_BCB* p_lcb;
-  uint16_t max_mtu = BT_DEFAULT_BUFFER_SIZE - L2CAP_MIN_OFFSET - BT_HDR_SIZE;
+  uint16_t max_mtu = AVCT_MAX_BROWSE_MTU;
 
   /* Don't include QoS nor flush timeout in the response since we
      currently always accept these values.  Note: fcr_present is left
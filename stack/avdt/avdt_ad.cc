@@ -83,7 +83,7 @@ static uint8_t avdt_ad_tcid_to_type(uint8_t tcid) {
     */
     type = ((tcid + AVDT_CHAN_NUM_TYPES - 2) % (AVDT_CHAN_NUM_TYPES - 1)) + 1;
   }
-  AVDT_TRACE_DEBUG("tcid: %d, type: %d", tcid, type);
+  /* no trace here, this is called for each packet received */
   return type;
 }
 
@@ -98,7 +98,7 @@ static uint8_t avdt_ad_tcid_to_type(uint8_t tcid) {
  *
  ******************************************************************************/
 void avdt_ad_init(void) {
-  int i;
+  int i, j;
   tAVDT_TC_TBL* p_tbl = avdt_cb.ad.tc_tbl;
   memset(&avdt_cb.ad, 0, sizeof(tAVDT_AD));
 
@@ -106,6 +106,13 @@ void avdt_ad_init(void) {
   for (i = 0; i < AVDT_NUM_TC_TBL; i++, p_tbl++) {
     p_tbl->peer_mtu = L2CAP_DEFAULT_MTU;
   }
+
+  /* no transport channel assigned to any route yet */
+  for (i = 0; i < AVDT_NUM_LINKS; i++) {
+    for (j = 0; j < AVDT_NUM_RT_TBL; j++) {
+      avdt_cb.ad.rt_tbl[i][j].tc_idx = AVDT_NUM_TC_TBL;
+    }
+  }
 }
 
 /*******************************************************************************
@@ -176,6 +183,10 @@ tAVDT_TC_TBL* avdt_ad_tc_tbl_by_st(uint8_t type, tAVDT_CCB* p_ccb,
 tAVDT_TC_TBL* avdt_ad_tc_tbl_by_lcid(uint16_t lcid) {
   uint8_t idx;
 
+  if ((lcid < L2CAP_BASE_APPL_CID) ||
+      (lcid >= L2CAP_BASE_APPL_CID + L2CAP_CHANNELS_LIMIT)) {
+    return NULL;
+  }
   idx = avdt_cb.ad.lcid_tbl[lcid - L2CAP_BASE_APPL_CID];
 
   if (idx < AVDT_NUM_TC_TBL) {
@@ -190,7 +201,10 @@ tAVDT_TC_TBL* avdt_ad_tc_tbl_by_lcid(uint16_t lcid) {
  * Function         avdt_ad_tc_tbl_by_type
  *
  * Description      This function retrieves the transport channel table entry
- *                  for a particular channel.
+ *                  for a particular channel.  The entry is found through the
+ *                  stream routing table, which is done for each message sent.
+ *                  The table is only searched if the channel was never
+ *                  assigned an entry.
  *
  *
  * Returns          Pointer to transport channel table entry.
@@ -202,10 +216,18 @@ tAVDT_TC_TBL* avdt_ad_tc_tbl_by_type(uint8_t type, tAVDT_CCB* p_ccb,
   int i;
   tAVDT_TC_TBL* p_tbl = avdt_cb.ad.tc_tbl;
   uint8_t ccb_idx = avdt_ccb_to_idx(p_ccb);
+  uint8_t tc_idx;
 
   /* get tcid from type, scb */
   tcid = avdt_ad_type_to_tcid(type, p_scb);
 
+  /* the entry may since have been given to another channel */
+  tc_idx = avdt_cb.ad.rt_tbl[ccb_idx][tcid].tc_idx;
+  if ((tc_idx < AVDT_NUM_TC_TBL) && (p_tbl[tc_idx].tcid == tcid) &&
+      (p_tbl[tc_idx].ccb_idx == ccb_idx)) {
+    return &p_tbl[tc_idx];
+  }
+
   for (i = 0; i < AVDT_NUM_TC_TBL; i++, p_tbl++) {
     if ((p_tbl->tcid == tcid) && (p_tbl->ccb_idx == ccb_idx)) {
       break;
@@ -488,6 +510,8 @@ void avdt_ad_open_req(uint8_t type, tAVDT_CCB* p_ccb, tAVDT_SCB* p_scb,
   }
 
   p_tbl->tcid = avdt_ad_type_to_tcid(type, p_scb);
+  avdt_cb.ad.rt_tbl[avdt_ccb_to_idx(p_ccb)][p_tbl->tcid].tc_idx =
+      avdt_ad_tc_tbl_to_idx(p_tbl);
   AVDT_TRACE_DEBUG("avdt_ad_open_req: type: %d, role: %d, tcid:%d", type, role,
                    p_tbl->tcid);
 
@@ -32,6 +32,7 @@
 #include "btm_api.h"
 #include "btu.h"
 #include "l2c_api.h"
+#include "osi/include/flow_trace.h"
 
 /* Control block for AVDT */
 tAVDT_CB avdt_cb;
@@ -300,8 +301,13 @@ static uint16_t avdt_get_cap_req(BD_ADDR bd_addr, tAVDT_CCB_API_GETCAP* p_evt) {
   }
 
   if (result == AVDT_SUCCESS) {
-    /* make sure no discovery or get capabilities req already in progress */
-    if (p_ccb->proc_busy) {
+    /* make sure no discovery or get capabilities req already in progress,
+    ** unless the peer accepts get capabilities commands back to back
+    */
+    if (p_ccb->proc_busy &&
+        (!p_ccb->pipelining || p_ccb->proc_getcaps == 0 ||
+         p_ccb->proc_getcaps >= AVDT_PIPELINE_DEPTH ||
+         p_ccb->proc_cback != p_evt->p_cback)) {
       result = AVDT_BUSY;
     }
     /* send event to ccb */
@@ -324,8 +330,12 @@ static uint16_t avdt_get_cap_req(BD_ADDR bd_addr, tAVDT_CCB_API_GETCAP* p_evt) {
  *
  *                  When the procedure is complete, an AVDT_GETCAP_CFM_EVT is
  *                  sent to the application via its callback function.  The
- *                  application must not call AVDT_GetCapReq() or
- *                  AVDT_DiscoverReq() again until the procedure is complete.
+ *                  application must not call AVDT_DiscoverReq() again until
+ *                  the procedure is complete.  With the same callback, it
+ *                  can get the capabilities of up to AVDT_PIPELINE_DEPTH
+ *                  stream endpoints at once, if the peer accepts pipelined
+ *                  commands; otherwise AVDT_BUSY is returned.  The
+ *                  AVDT_GETCAP_CFM_EVT of each has the p_cfg of its request.
  *
  *                  The memory pointed to by p_cfg is allocated by the
  *                  application.  This memory is written to by AVDTP as part
@@ -359,8 +369,12 @@ uint16_t AVDT_GetCapReq(BD_ADDR bd_addr, uint8_t seid, tAVDT_CFG* p_cfg,
  *
  *                  When the procedure is complete, an AVDT_GETCAP_CFM_EVT is
  *                  sent to the application via its callback function.  The
- *                  application must not call AVDT_GetCapReq() or
- *                  AVDT_DiscoverReq() again until the procedure is complete.
+ *                  application must not call AVDT_DiscoverReq() again until
+ *                  the procedure is complete.  With the same callback, it
+ *                  can get the capabilities of up to AVDT_PIPELINE_DEPTH
+ *                  stream endpoints at once, if the peer accepts pipelined
+ *                  commands; otherwise AVDT_BUSY is returned.  The
+ *                  AVDT_GETCAP_CFM_EVT of each has the p_cfg of its request.
  *
  *                  The memory pointed to by p_cfg is allocated by the
  *                  application.  This memory is written to by AVDTP as part
@@ -824,6 +838,8 @@ uint16_t AVDT_WriteReqOpt(uint8_t handle, BT_HDR* p_pkt, uint32_t time_stamp,
   tAVDT_SCB_EVT evt;
   uint16_t result = AVDT_SUCCESS;
 
+  FLOW_TRACE(FLOW_TRACE_AVDTP, p_pkt, "AVDTP tx");
+
   /* map handle to scb */
   p_scb = avdt_scb_by_hdl(handle);
   if (p_scb == NULL) {
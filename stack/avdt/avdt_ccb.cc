@@ -32,6 +32,7 @@
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btu.h"
+#include "device/include/interop.h"
 #include "osi/include/osi.h"
 
 /*****************************************************************************
@@ -450,6 +451,10 @@ tAVDT_CCB* avdt_ccb_alloc(BD_ADDR bd_addr) {
       p_ccb->idle_ccb_timer = alarm_new("avdt_ccb.idle_ccb_timer");
       p_ccb->ret_ccb_timer = alarm_new("avdt_ccb.ret_ccb_timer");
       p_ccb->rsp_ccb_timer = alarm_new("avdt_ccb.rsp_ccb_timer");
+      p_ccb->pipelining =
+          (AVDT_PIPELINE_DEPTH > 1) &&
+          !interop_match_addr(INTEROP_DISABLE_AVDTP_PIPELINING,
+                              (const bt_bdaddr_t*)&p_ccb->peer_addr);
       AVDT_TRACE_DEBUG("avdt_ccb_alloc %d", i);
       break;
     }
@@ -228,8 +228,10 @@ void avdt_ccb_hdl_getcap_cmd(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
  *
  ******************************************************************************/
 void avdt_ccb_hdl_getcap_rsp(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
-  /* we're done with procedure */
-  p_ccb->proc_busy = false;
+  /* we're done with procedure, once the pipelined ones are done too */
+  if (p_ccb->proc_getcaps > 0) p_ccb->proc_getcaps--;
+  p_ccb->proc_busy = (p_ccb->proc_getcaps != 0);
+  p_ccb->p_getcap_cfg[p_data->msg.hdr.label & 0x0F] = NULL;
 
   /* call app callback with results */
   (*p_ccb->proc_cback)(0, p_ccb->peer_addr, AVDT_GETCAP_CFM_EVT,
@@ -437,6 +439,10 @@ void avdt_ccb_snd_getcap_cmd(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
 
   /* we're busy */
   p_ccb->proc_busy = true;
+  p_ccb->proc_getcaps++;
+
+  /* the response is parsed to the storage of the label of the command */
+  p_ccb->p_getcap_cfg[p_ccb->label] = p_data->getcap.p_cfg;
 
   /* build and queue discover req */
   if (p_data->msg.hdr.sig_id == AVDT_SIG_GET_ALLCAP)
@@ -657,45 +663,86 @@ void avdt_ccb_clear_cmds(tAVDT_CCB* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
   }
 }
 
+/* Returns true if |p_msg| is a get capabilities command, the commands that
+ * can be pipelined. */
+static bool avdt_ccb_is_getcap(const BT_HDR* p_msg) {
+  return (p_msg->event == AVDT_SIG_GETCAP) ||
+         (p_msg->event == AVDT_SIG_GET_ALLCAP);
+}
+
 /*******************************************************************************
  *
- * Function         avdt_ccb_cmd_fail
+ * Function         avdt_ccb_rej_cmd
  *
- * Description      This function is called when there is a response timeout.
- *                  The currently pending command is freed and we fake a
- *                  reject message back to ourselves.
+ * Description      This function fakes a reject message back to ourselves
+ *                  for a command awaiting a response.
  *
  *
  * Returns          void.
  *
  ******************************************************************************/
-void avdt_ccb_cmd_fail(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
+static void avdt_ccb_rej_cmd(tAVDT_CCB* p_ccb, BT_HDR* p_cmd,
+                             uint8_t err_code) {
   tAVDT_MSG msg;
   uint8_t evt;
   tAVDT_SCB* p_scb;
 
-  if (p_ccb->p_curr_cmd != NULL) {
-    /* set up data */
-    msg.hdr.err_code = p_data->err_code;
-    msg.hdr.err_param = 0;
-    msg.hdr.ccb_idx = avdt_ccb_to_idx(p_ccb);
-
-    /* pretend that we received a rej message */
-    evt = avdt_msg_rej_2_evt[p_ccb->p_curr_cmd->event - 1];
-
-    if (evt & AVDT_CCB_MKR) {
-      avdt_ccb_event(p_ccb, (uint8_t)(evt & ~AVDT_CCB_MKR),
-                     (tAVDT_CCB_EVT*)&msg);
-    } else {
-      /* we get the scb out of the current cmd */
-      p_scb = avdt_scb_by_hdl(*((uint8_t*)(p_ccb->p_curr_cmd + 1)));
-      if (p_scb != NULL) {
-        avdt_scb_event(p_scb, evt, (tAVDT_SCB_EVT*)&msg);
-      }
+  /* set up data */
+  msg.hdr.err_code = err_code;
+  msg.hdr.err_param = 0;
+  msg.hdr.ccb_idx = avdt_ccb_to_idx(p_ccb);
+  msg.hdr.label = AVDT_LAYERSPEC_LABEL(p_cmd->layer_specific);
+  if (avdt_ccb_is_getcap(p_cmd))
+    msg.svccap.p_cfg = p_ccb->p_getcap_cfg[msg.hdr.label];
+
+  /* pretend that we received a rej message */
+  evt = avdt_msg_rej_2_evt[p_cmd->event - 1];
+
+  if (evt & AVDT_CCB_MKR) {
+    avdt_ccb_event(p_ccb, (uint8_t)(evt & ~AVDT_CCB_MKR), (tAVDT_CCB_EVT*)&msg);
+  } else {
+    /* we get the scb out of the current cmd */
+    p_scb = avdt_scb_by_hdl(*((uint8_t*)(p_cmd + 1)));
+    if (p_scb != NULL) {
+      avdt_scb_event(p_scb, evt, (tAVDT_SCB_EVT*)&msg);
     }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         avdt_ccb_cmd_fail
+ *
+ * Description      This function is called when there is a response timeout.
+ *                  The currently pending command, and the commands
+ *                  pipelined after it, are freed and we fake a reject
+ *                  message back to ourselves for each.
+ *
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+void avdt_ccb_cmd_fail(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
+  BT_HDR* p_cmd;
 
+  if (p_ccb->p_curr_cmd != NULL) {
+    avdt_ccb_rej_cmd(p_ccb, p_ccb->p_curr_cmd, p_data->err_code);
     osi_free_and_reset((void**)&p_ccb->p_curr_cmd);
   }
+
+  /* the commands pipelined after it fail with it; a peer that let one time
+  ** out does not get pipelined commands anymore
+  */
+  if ((p_ccb->pipe_num > 0) && (p_data->err_code == AVDT_ERR_TIMEOUT)) {
+    AVDT_TRACE_WARNING("%s: pipelined command timed out, pipelining disabled",
+                       __func__);
+    p_ccb->pipelining = false;
+  }
+  while (p_ccb->pipe_num > 0) {
+    p_cmd = p_ccb->p_pipe_cmd[0];
+    avdt_ccb_rej_cmd(p_ccb, p_cmd, p_data->err_code);
+    avdt_ccb_free_pipe_cmd(p_ccb, p_cmd);
+  }
 }
 
 /*******************************************************************************
@@ -711,6 +758,73 @@ void avdt_ccb_cmd_fail(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data) {
  ******************************************************************************/
 void avdt_ccb_free_cmd(tAVDT_CCB* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
   osi_free_and_reset((void**)&p_ccb->p_curr_cmd);
+
+  /* the first command pipelined is now the one awaiting a response */
+  if (p_ccb->pipe_num > 0) {
+    p_ccb->p_curr_cmd = p_ccb->p_pipe_cmd[0];
+    p_ccb->pipe_num--;
+    memmove(&p_ccb->p_pipe_cmd[0], &p_ccb->p_pipe_cmd[1],
+            p_ccb->pipe_num * sizeof(BT_HDR*));
+
+    alarm_cancel(p_ccb->idle_ccb_timer);
+    alarm_cancel(p_ccb->ret_ccb_timer);
+    period_ms_t interval_ms = avdt_cb.rcb.sig_tout * 1000;
+    alarm_set_on_queue(p_ccb->rsp_ccb_timer, interval_ms,
+                       avdt_ccb_rsp_ccb_timer_timeout, p_ccb,
+                       btu_general_alarm_queue);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         avdt_ccb_find_cmd
+ *
+ * Description      This function finds the command awaiting a response
+ *                  with the given label, either the current command or one
+ *                  pipelined after it.
+ *
+ *
+ * Returns          the command, or NULL if none has the label.
+ *
+ ******************************************************************************/
+BT_HDR* avdt_ccb_find_cmd(tAVDT_CCB* p_ccb, uint8_t label) {
+  int i;
+
+  if ((p_ccb->p_curr_cmd != NULL) &&
+      (AVDT_LAYERSPEC_LABEL(p_ccb->p_curr_cmd->layer_specific) == label))
+    return p_ccb->p_curr_cmd;
+
+  for (i = 0; i < p_ccb->pipe_num; i++) {
+    if (AVDT_LAYERSPEC_LABEL(p_ccb->p_pipe_cmd[i]->layer_specific) == label)
+      return p_ccb->p_pipe_cmd[i];
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         avdt_ccb_free_pipe_cmd
+ *
+ * Description      This function is called when a response is received for a
+ *                  command pipelined after the current command.  The command
+ *                  is freed.
+ *
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+void avdt_ccb_free_pipe_cmd(tAVDT_CCB* p_ccb, BT_HDR* p_cmd) {
+  int i;
+
+  for (i = 0; i < p_ccb->pipe_num; i++) {
+    if (p_ccb->p_pipe_cmd[i] == p_cmd) {
+      p_ccb->pipe_num--;
+      memmove(&p_ccb->p_pipe_cmd[i], &p_ccb->p_pipe_cmd[i + 1],
+              (p_ccb->pipe_num - i) * sizeof(BT_HDR*));
+      osi_free(p_cmd);
+      return;
+    }
+  }
 }
 
 /*******************************************************************************
@@ -802,6 +916,23 @@ void avdt_ccb_snd_cmd(tAVDT_CCB* p_ccb, UNUSED_ATTR tAVDT_CCB_EVT* p_data) {
       avdt_msg_send(p_ccb, p_msg);
     }
   }
+
+  /* while waiting for the response to a get capabilities command, send the
+  ** next get capabilities commands back to back if the peer accepts it
+  */
+  while ((!p_ccb->cong) && (p_ccb->p_curr_msg == NULL) &&
+         (p_ccb->p_curr_cmd != NULL) && p_ccb->pipelining &&
+         (p_ccb->pipe_num < AVDT_PIPELINE_DEPTH - 1) &&
+         avdt_ccb_is_getcap(p_ccb->p_curr_cmd)) {
+    p_msg = (BT_HDR*)fixed_queue_try_peek_first(p_ccb->cmd_q);
+    if ((p_msg == NULL) || !avdt_ccb_is_getcap(p_msg)) break;
+
+    fixed_queue_try_dequeue(p_ccb->cmd_q);
+    BT_HDR* p_cmd = (BT_HDR*)osi_malloc(AVDT_CMD_BUF_SIZE);
+    memcpy(p_cmd, p_msg, (sizeof(BT_HDR) + p_msg->offset + p_msg->len));
+    p_ccb->p_pipe_cmd[p_ccb->pipe_num++] = p_cmd;
+    avdt_msg_send(p_ccb, p_msg);
+  }
 }
 
 /*******************************************************************************
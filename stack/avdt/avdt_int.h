@@ -96,6 +96,12 @@ enum {
 #define AVDT_RET_MAX 1
 #endif
 
+/* maximum number of get capabilities commands awaiting their response at
+ * once, sent back to back to a peer that accepts pipelined commands */
+#ifndef AVDT_PIPELINE_DEPTH
+#define AVDT_PIPELINE_DEPTH 4
+#endif
+
 /* ccb state machine states */
 enum {
   AVDT_CCB_IDLE_ST,
@@ -415,6 +421,10 @@ typedef struct {
       p_conn_cback;   /* Connection/disconnection callback function */
   void* p_proc_data;  /* Pointer to data storage for procedure */
   BT_HDR* p_curr_cmd; /* Current command being sent awaiting response */
+  BT_HDR* p_pipe_cmd[AVDT_PIPELINE_DEPTH]; /* Commands sent after p_curr_cmd,
+                                             awaiting response */
+  uint8_t pipe_num;                  /* Number of commands in p_pipe_cmd */
+  tAVDT_CFG* p_getcap_cfg[16];       /* Get capabilities storage, by label */
   BT_HDR* p_curr_msg; /* Current message being sent */
   BT_HDR* p_rx_msg;   /* Current message being received */
   bool allocated;     /* Whether ccb is allocated */
@@ -422,6 +432,8 @@ typedef struct {
   bool ll_opened;     /* true if LL is opened */
   bool proc_busy;     /* true when a discover or get capabilities procedure in
                          progress */
+  uint8_t proc_getcaps; /* Number of get capabilities procedures in progress */
+  bool pipelining;      /* true if the peer accepts pipelined commands */
   uint8_t proc_param; /* Procedure parameter; either SEID for get capabilities
                          or number of SEPS for discover */
   bool cong;          /* Whether signaling channel is congested */
@@ -469,6 +481,9 @@ typedef struct {
   BT_HDR* p_pkt;                    /* packet waiting to be sent */
   tAVDT_CCB* p_ccb;                 /* ccb associated with this scb */
   uint16_t media_seq;               /* media packet sequence number */
+  uint8_t media_hdr[AVDT_MEDIA_HDR_SIZE]; /* media packet header template */
+  bool media_hdr_valid; /* whether media_hdr is built for curr_cfg */
+  bool media_hdr_rtp;   /* whether the media packets have an RTP header */
   bool allocated;                   /* whether scb is allocated or unused */
   bool in_use;                      /* whether stream being used by peer */
   uint8_t role;       /* initiator/acceptor role in current procedure */
@@ -500,13 +515,14 @@ typedef struct {
 typedef struct {
   uint16_t lcid;   /* L2CAP LCID of the associated transport channel */
   uint8_t scb_hdl; /* stream control block associated with this tc */
+  uint8_t tc_idx;  /* tc_tbl index of the associated transport channel */
 } tAVDT_RT_TBL;
 
 /* adaption layer control block */
 typedef struct {
   tAVDT_RT_TBL rt_tbl[AVDT_NUM_LINKS][AVDT_NUM_RT_TBL];
   tAVDT_TC_TBL tc_tbl[AVDT_NUM_TC_TBL];
-  uint8_t lcid_tbl[MAX_L2CAP_CHANNELS]; /* map LCID to tc_tbl index */
+  uint8_t lcid_tbl[L2CAP_CHANNELS_LIMIT]; /* map LCID to tc_tbl index */
 } tAVDT_AD;
 
 /* Control block for AVDT */
@@ -559,6 +575,8 @@ extern void avdt_ccb_snd_suspend_rsp(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
 extern void avdt_ccb_clear_cmds(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
 extern void avdt_ccb_cmd_fail(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
 extern void avdt_ccb_free_cmd(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
+extern BT_HDR* avdt_ccb_find_cmd(tAVDT_CCB* p_ccb, uint8_t label);
+extern void avdt_ccb_free_pipe_cmd(tAVDT_CCB* p_ccb, BT_HDR* p_cmd);
 extern void avdt_ccb_cong_state(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
 extern void avdt_ccb_ret_cmd(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
 extern void avdt_ccb_snd_cmd(tAVDT_CCB* p_ccb, tAVDT_CCB_EVT* p_data);
@@ -585,6 +603,7 @@ extern uint8_t avdt_scb_verify(tAVDT_CCB* p_ccb, uint8_t state, uint8_t* p_seid,
                                uint16_t num_seid, uint8_t* p_err_code);
 extern void avdt_scb_peer_seid_list(tAVDT_MULTI* p_multi);
 extern uint32_t avdt_scb_gen_ssrc(tAVDT_SCB* p_scb);
+extern void avdt_scb_build_media_hdr(tAVDT_SCB* p_scb, uint8_t m_pt);
 
 /* SCB action functions */
 extern void avdt_scb_hdl_abort_cmd(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data);
@@ -34,6 +34,7 @@
 #include "device/include/interop.h"
 #include "l2c_api.h"
 #include "l2cdefs.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/osi.h"
 
 /* callback function declarations */
@@ -188,6 +189,8 @@ void avdt_l2c_connect_ind_cback(BD_ADDR bd_addr, uint16_t lcid,
       p_tbl->my_mtu = avdt_cb.rcb.ctrl_mtu;
       p_tbl->my_flush_to = L2CAP_DEFAULT_FLUSH_TO;
       p_tbl->tcid = AVDT_CHAN_SIG;
+      avdt_cb.ad.rt_tbl[avdt_ccb_to_idx(p_ccb)][AVDT_CHAN_SIG].tc_idx =
+          avdt_ad_tc_tbl_to_idx(p_tbl);
       p_tbl->lcid = lcid;
       p_tbl->id = id;
       p_tbl->state = AVDT_AD_ST_SEC_ACP;
@@ -508,6 +511,8 @@ void avdt_l2c_congestion_ind_cback(uint16_t lcid, bool is_congested) {
 void avdt_l2c_data_ind_cback(uint16_t lcid, BT_HDR* p_buf) {
   tAVDT_TC_TBL* p_tbl;
 
+  FLOW_TRACE(FLOW_TRACE_AVDTP, p_buf, "AVDTP rx");
+
   /* look up info for this channel */
   p_tbl = avdt_ad_tc_tbl_by_lcid(lcid);
   if (p_tbl != NULL) {
@@ -1497,6 +1497,8 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
   uint8_t err;
   uint8_t evt = 0;
   uint8_t scb_hdl;
+  BT_HDR* p_cmd = NULL;
+  bool pipe_rsp = false;
 
   /* reassemble message; if no message available (we received a fragment) return
    */
@@ -1515,6 +1517,11 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
   msg.hdr.label = label;
   msg.hdr.ccb_idx = avdt_ccb_to_idx(p_ccb);
 
+  /* find the command sent with the label, if it is a rsp or rej */
+  if ((msg_type == AVDT_MSG_TYPE_RSP) || (msg_type == AVDT_MSG_TYPE_REJ)) {
+    p_cmd = avdt_ccb_find_cmd(p_ccb, label);
+  }
+
   /* verify msg type */
   if (msg_type == AVDT_MSG_TYPE_GRJ) {
     AVDT_TRACE_WARNING("Dropping msg msg_type=%d", msg_type);
@@ -1524,8 +1531,13 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
   else if ((msg_type == AVDT_MSG_TYPE_REJ) &&
            (p_buf->len == AVDT_LEN_GEN_REJ)) {
     gen_rej = true;
-    if (p_ccb->p_curr_cmd != NULL) {
-      msg.hdr.sig_id = sig = (uint8_t)p_ccb->p_curr_cmd->event;
+    if (p_cmd != NULL) {
+      /* a peer that rejects pipelined commands does not get them anymore */
+      if (p_ccb->pipe_num > 0) {
+        AVDT_TRACE_WARNING("Pipelined cmd rejected, pipelining disabled");
+        p_ccb->pipelining = false;
+      }
+      msg.hdr.sig_id = sig = (uint8_t)p_cmd->event;
       evt = avdt_msg_rej_2_evt[sig - 1];
       msg.hdr.err_code = AVDT_ERR_NSC;
       msg.hdr.err_param = 0;
@@ -1557,8 +1569,12 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
       msg.discover_rsp.num_seps = p_ccb->proc_param;
     } else if ((msg_type == AVDT_MSG_TYPE_RSP) &&
                ((sig == AVDT_SIG_GETCAP) || (sig == AVDT_SIG_GET_ALLCAP))) {
-      /* parse discover rsp message to struct supplied by app */
-      msg.svccap.p_cfg = (tAVDT_CFG*)p_ccb->p_proc_data;
+      /* parse getcap rsp message to struct supplied by app for the cmd */
+      if ((p_cmd != NULL) && (p_cmd->event == sig) &&
+          (p_ccb->p_getcap_cfg[label] != NULL))
+        msg.svccap.p_cfg = p_ccb->p_getcap_cfg[label];
+      else
+        msg.svccap.p_cfg = &cfg;
     } else if ((msg_type == AVDT_MSG_TYPE_RSP) && (sig == AVDT_SIG_GETCONFIG)) {
       /* parse get config rsp message to struct allocated locally */
       msg.svccap.p_cfg = &cfg;
@@ -1605,15 +1621,25 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
   */
   if (ok) {
     if ((msg_type == AVDT_MSG_TYPE_RSP) || (msg_type == AVDT_MSG_TYPE_REJ)) {
-      if ((p_ccb->p_curr_cmd != NULL) && (p_ccb->p_curr_cmd->event == sig) &&
-          (AVDT_LAYERSPEC_LABEL(p_ccb->p_curr_cmd->layer_specific) == label)) {
-        /* stop timer */
-        alarm_cancel(p_ccb->idle_ccb_timer);
-        alarm_cancel(p_ccb->ret_ccb_timer);
-        alarm_cancel(p_ccb->rsp_ccb_timer);
+      if ((p_cmd != NULL) && (p_cmd->event == sig)) {
+        /* the timers are for the current cmd, not the pipelined ones */
+        if (p_cmd == p_ccb->p_curr_cmd) {
+          /* stop timer */
+          alarm_cancel(p_ccb->idle_ccb_timer);
+          alarm_cancel(p_ccb->ret_ccb_timer);
+          alarm_cancel(p_ccb->rsp_ccb_timer);
 
-        /* clear retransmission count */
-        p_ccb->ret_count = 0;
+          /* clear retransmission count */
+          p_ccb->ret_count = 0;
+        } else {
+          pipe_rsp = true;
+        }
+
+        /* a getcap rej is for the struct supplied by app for the cmd, too */
+        if ((msg_type == AVDT_MSG_TYPE_REJ) &&
+            ((sig == AVDT_SIG_GETCAP) || (sig == AVDT_SIG_GET_ALLCAP))) {
+          msg.svccap.p_cfg = p_ccb->p_getcap_cfg[label];
+        }
 
         /* later in this function handle ccb event */
         handle_rsp = true;
@@ -1633,12 +1659,12 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
     /* if it's a scb event */
     else {
       /* Scb events always have a single seid.  For cmd, get seid from
-      ** message.  For rej and rsp, get seid from p_curr_cmd.
+      ** message.  For rej and rsp, get seid from the cmd sent.
       */
       if (msg_type == AVDT_MSG_TYPE_CMD) {
         scb_hdl = msg.single.seid;
       } else {
-        scb_hdl = *((uint8_t*)(p_ccb->p_curr_cmd + 1));
+        scb_hdl = *((uint8_t*)(p_cmd + 1));
       }
 
       /* Map seid to the scb and send it the event.  For cmd, seid has
@@ -1660,6 +1686,15 @@ void avdt_msg_ind(tAVDT_CCB* p_ccb, BT_HDR* p_buf) {
   ** cmd msg buffer and handle cmd queue
   */
   if (handle_rsp) {
-    avdt_ccb_event(p_ccb, AVDT_CCB_RCVRSP_EVT, NULL);
+    if (!pipe_rsp) {
+      avdt_ccb_event(p_ccb, AVDT_CCB_RCVRSP_EVT, NULL);
+    } else {
+      /* look it up again, in case the event handling cleared the cmds */
+      p_cmd = avdt_ccb_find_cmd(p_ccb, label);
+      if ((p_cmd != NULL) && (p_cmd != p_ccb->p_curr_cmd)) {
+        avdt_ccb_free_pipe_cmd(p_ccb, p_cmd);
+      }
+      avdt_ccb_event(p_ccb, AVDT_CCB_SENDMSG_EVT, NULL);
+    }
   }
 }
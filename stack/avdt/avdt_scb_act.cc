@@ -70,6 +70,34 @@ uint32_t avdt_scb_gen_ssrc(tAVDT_SCB* p_scb) {
       (uint32_t)(p_scb->cs.cfg.codec_info[1] | p_scb->cs.cfg.codec_info[2]));
 }
 
+/*******************************************************************************
+ *
+ * Function         avdt_scb_build_media_hdr
+ *
+ * Description      This function builds the template of the media packet
+ *                  header of the stream for the payload type m_pt: whether
+ *                  the media packets have an RTP header and its fields that
+ *                  do not change from packet to packet.  Only the sequence
+ *                  number and the time stamp are written for each packet.
+ *
+ * Returns          Nothing.
+ *
+ ******************************************************************************/
+void avdt_scb_build_media_hdr(tAVDT_SCB* p_scb, uint8_t m_pt) {
+  uint8_t* p = p_scb->media_hdr;
+  bool is_content_protection = (p_scb->curr_cfg.num_protect > 0);
+
+  p_scb->media_hdr_rtp =
+      A2DP_UsesRtpHeader(is_content_protection, p_scb->curr_cfg.codec_info);
+
+  memset(p_scb->media_hdr, 0, AVDT_MEDIA_HDR_SIZE);
+  UINT8_TO_BE_STREAM(p, AVDT_MEDIA_OCTET1);
+  UINT8_TO_BE_STREAM(p, m_pt);
+  p += 6; /* sequence number and time stamp */
+  UINT32_TO_BE_STREAM(p, avdt_scb_gen_ssrc(p_scb));
+  p_scb->media_hdr_valid = true;
+}
+
 /*******************************************************************************
  *
  * Function         avdt_scb_hdl_abort_cmd
@@ -440,6 +468,7 @@ void avdt_scb_hdl_reconfig_rsp(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
       memcpy(p_scb->curr_cfg.protect_info, p_scb->req_cfg.protect_info,
              AVDT_PROTECT_SIZE);
     }
+    p_scb->media_hdr_valid = false;
   }
 
   p_data->msg.svccap.p_cfg = &p_scb->curr_cfg;
@@ -571,6 +600,7 @@ void avdt_scb_hdl_setconfig_rsp(tAVDT_SCB* p_scb,
   if (p_scb->p_ccb != NULL) {
     /* save configuration */
     memcpy(&p_scb->curr_cfg, &p_scb->req_cfg, sizeof(tAVDT_CFG));
+    p_scb->media_hdr_valid = false;
 
     /* initiate open */
     single.seid = p_scb->peer_seid;
@@ -676,6 +706,7 @@ void avdt_scb_hdl_tc_close(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   /* clear sep variables */
   avdt_scb_clr_vars(p_scb, p_data);
   p_scb->media_seq = 0;
+  p_scb->media_hdr_valid = false;
   p_scb->cong = false;
 
   /* free pkt we're holding, if any */
@@ -866,7 +897,6 @@ void avdt_scb_hdl_tc_open_sto(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
  ******************************************************************************/
 void avdt_scb_hdl_write_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   uint8_t* p;
-  uint32_t ssrc;
   bool add_rtp_header = !(p_data->apiwrite.opt & AVDT_DATA_OPT_NO_RTP);
 
   /* free packet we're holding, if any; to be replaced with new */
@@ -878,25 +908,25 @@ void avdt_scb_hdl_write_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
 
   /* Recompute only if the RTP header wasn't disabled by the API */
   if (add_rtp_header) {
-    bool is_content_protection = (p_scb->curr_cfg.num_protect > 0);
-    add_rtp_header =
-        A2DP_UsesRtpHeader(is_content_protection, p_scb->curr_cfg.codec_info);
+    if (!p_scb->media_hdr_valid ||
+        p_scb->media_hdr[1] != p_data->apiwrite.m_pt) {
+      avdt_scb_build_media_hdr(p_scb, p_data->apiwrite.m_pt);
+    }
+    add_rtp_header = p_scb->media_hdr_rtp;
   }
 
   /* Build a media packet, and add an RTP header if required. */
   if (add_rtp_header) {
-    ssrc = avdt_scb_gen_ssrc(p_scb);
-
     p_data->apiwrite.p_buf->len += AVDT_MEDIA_HDR_SIZE;
     p_data->apiwrite.p_buf->offset -= AVDT_MEDIA_HDR_SIZE;
     p_scb->media_seq++;
     p = (uint8_t*)(p_data->apiwrite.p_buf + 1) + p_data->apiwrite.p_buf->offset;
 
-    UINT8_TO_BE_STREAM(p, AVDT_MEDIA_OCTET1);
-    UINT8_TO_BE_STREAM(p, p_data->apiwrite.m_pt);
+    /* only the sequence number and time stamp change between packets */
+    memcpy(p, p_scb->media_hdr, AVDT_MEDIA_HDR_SIZE);
+    p += 2;
     UINT16_TO_BE_STREAM(p, p_scb->media_seq);
     UINT32_TO_BE_STREAM(p, p_data->apiwrite.time_stamp);
-    UINT32_TO_BE_STREAM(p, ssrc);
   }
 
   /* store it */
@@ -1099,6 +1129,7 @@ void avdt_scb_snd_reconfig_rsp(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
       memcpy(p_scb->curr_cfg.protect_info, p_scb->req_cfg.protect_info,
              AVDT_PROTECT_SIZE);
     }
+    p_scb->media_hdr_valid = false;
 
     /* send response */
     avdt_msg_send_rsp(p_scb->p_ccb, AVDT_SIG_RECONFIG, &p_data->msg);
@@ -1201,6 +1232,7 @@ void avdt_scb_snd_setconfig_req(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
 void avdt_scb_snd_setconfig_rsp(tAVDT_SCB* p_scb, tAVDT_SCB_EVT* p_data) {
   if (p_scb->p_ccb != NULL) {
     memcpy(&p_scb->curr_cfg, &p_scb->req_cfg, sizeof(tAVDT_CFG));
+    p_scb->media_hdr_valid = false;
 
     avdt_msg_send_rsp(p_scb->p_ccb, AVDT_SIG_SETCONFIG, &p_data->msg);
   }
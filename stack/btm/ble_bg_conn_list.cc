@@ -0,0 +1,210 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_bg_conn_list.h"
+
+#include <string.h>
+#include <algorithm>
+
+void BleBgConnList::SetCapacity(size_t capacity) {
+  capacity_ = capacity;
+  if (size_ != 0) dirty_ = true;
+}
+
+bool BleBgConnList::Add(const BD_ADDR addr, bool connected, uint64_t now_ms) {
+  auto it = devices_.find(Key(addr));
+  if (it == devices_.end()) {
+    Device device;
+    memset(&device, 0, sizeof(device));
+    memcpy(device.bd_addr, addr, BD_ADDR_LEN);
+    device.seq = seq_++;
+    it = devices_.emplace(Key(addr), device).first;
+  } else if (it->second.wanted) {
+    return false;
+  }
+
+  Device& device = it->second;
+  device.wanted = true;
+  device.connected = connected;
+  device.active_ms = now_ms;
+  size_++;
+  if (connected) connected_++;
+  dirty_ = true;
+  return true;
+}
+
+bool BleBgConnList::Remove(const BD_ADDR addr) {
+  auto it = devices_.find(Key(addr));
+  if (it == devices_.end() || !it->second.wanted) return false;
+
+  /* the selection only changes with the device while the devices exceed the
+   * white list */
+  if (it->second.in_controller || size_ > capacity_) dirty_ = true;
+
+  size_--;
+  if (it->second.connected) connected_--;
+  if (it->second.in_controller) {
+    /* kept until Sync() removes it from the white list */
+    it->second.wanted = false;
+    it->second.rotating = false;
+  } else {
+    devices_.erase(it);
+  }
+  return true;
+}
+
+bool BleBgConnList::Contains(const BD_ADDR addr) const {
+  auto it = devices_.find(Key(addr));
+  return it != devices_.end() && it->second.wanted;
+}
+
+bool BleBgConnList::UpdateLink(const BD_ADDR addr, bool connected,
+                               uint64_t now_ms) {
+  auto it = devices_.find(Key(addr));
+  if (it == devices_.end() || !it->second.wanted) return false;
+
+  Device& device = it->second;
+  device.active_ms = now_ms;
+  if (device.connected == connected) return false;
+
+  device.connected = connected;
+  if (connected)
+    connected_++;
+  else
+    connected_--;
+
+  /* the connected devices are only left out of a full white list */
+  if (size_ <= capacity_) return false;
+  dirty_ = true;
+  return true;
+}
+
+bool BleBgConnList::Rotate() {
+  if (!Overflows()) return false;
+
+  for (auto& it : devices_) it.second.rotating = false;
+  round_++;
+  dirty_ = true;
+  return true;
+}
+
+void BleBgConnList::Clear() {
+  devices_.clear();
+  size_ = 0;
+  connected_ = 0;
+  controller_size_ = 0;
+  dirty_ = false;
+}
+
+bool BleBgConnList::Overflows() const {
+  return size_ - connected_ > capacity_;
+}
+
+bool BleBgConnList::Pending() const { return size_ > connected_; }
+
+void BleBgConnList::Sync(std::vector<Op>* ops) {
+  std::vector<Device*> candidates;
+  Candidates(&candidates);
+
+  std::vector<Device*> selected;
+  if (candidates.size() <= capacity_) {
+    selected.swap(candidates);
+    for (Device* device : selected) device->rotating = false;
+  } else if (capacity_ != 0) {
+    size_t rotating = std::max(capacity_ / 4, (size_t)1);
+    size_t priority = capacity_ - rotating;
+
+    /* the most recently active devices first */
+    std::partial_sort(candidates.begin(), candidates.begin() + priority,
+                      candidates.end(), [](const Device* a, const Device* b) {
+                        if (a->active_ms != b->active_ms)
+                          return a->active_ms > b->active_ms;
+                        return a->seq < b->seq;
+                      });
+    for (size_t i = 0; i < priority; i++) {
+      candidates[i]->rotating = false;
+      selected.push_back(candidates[i]);
+    }
+
+    /* then the devices in their turn, and the ones that waited the longest */
+    std::sort(candidates.begin() + priority, candidates.end(),
+              [](const Device* a, const Device* b) {
+                if (a->rotating != b->rotating) return a->rotating;
+                if (a->turn != b->turn) return a->turn < b->turn;
+                return a->seq < b->seq;
+              });
+    for (size_t i = priority; i < candidates.size(); i++) {
+      Device* device = candidates[i];
+      if (i < capacity_) {
+        if (!device->rotating) {
+          device->rotating = true;
+          device->turn = round_;
+        }
+        selected.push_back(device);
+      }
+    }
+  }
+
+  for (Device* device : selected) device->selected = true;
+
+  /* the removals first, so that the white list has room for the additions */
+  for (auto it = devices_.begin(); it != devices_.end();) {
+    Device& device = it->second;
+    if (!device.selected) device.rotating = false;
+    if (device.in_controller && !device.selected) {
+      Op op;
+      op.to_add = false;
+      memcpy(op.bd_addr, device.bd_addr, BD_ADDR_LEN);
+      ops->push_back(op);
+      device.in_controller = false;
+      controller_size_--;
+    }
+    if (!device.wanted)
+      it = devices_.erase(it);
+    else
+      ++it;
+  }
+
+  for (Device* device : selected) {
+    device->selected = false;
+    if (device->in_controller) continue;
+    Op op;
+    op.to_add = true;
+    memcpy(op.bd_addr, device->bd_addr, BD_ADDR_LEN);
+    ops->push_back(op);
+    device->in_controller = true;
+    controller_size_++;
+  }
+
+  dirty_ = false;
+}
+
+uint64_t BleBgConnList::Key(const BD_ADDR addr) {
+  uint64_t key = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) key = (key << 8) | addr[i];
+  return key;
+}
+
+void BleBgConnList::Candidates(std::vector<Device*>* candidates) {
+  bool skip_connected = size_ > capacity_;
+  for (auto& it : devices_) {
+    Device& device = it.second;
+    if (!device.wanted || (skip_connected && device.connected)) continue;
+    candidates->push_back(&device);
+  }
+}
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BLE_BG_CONN_LIST_H
+#define BLE_BG_CONN_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class keeps the devices of the background connection, and the ones
+ * loaded in the white list of the controller. The changes to the devices are
+ * only recorded: Sync() diffs the devices to be in the white list against the
+ * ones in it, so that a burst of changes is applied with the fewest HCI
+ * commands, in a single suspension of the white list activity.
+ *
+ * While the devices fit in the white list, all of them are loaded. Once they
+ * exceed its capacity, the connected devices are left out, and the white
+ * list is shared between the most recently active devices and, in the
+ * remaining quarter of its entries, the others taking turns: Rotate() gives
+ * their entries to the devices that waited the longest. */
+class BleBgConnList {
+ public:
+  struct Op {
+    bool to_add;
+    BD_ADDR bd_addr;
+  };
+
+  /* Sets the number of entries of the white list of the controller. */
+  void SetCapacity(size_t capacity);
+
+  /* Adds |addr|, connected or not, active at |now_ms|. Returns false if it
+   * was already there. */
+  bool Add(const BD_ADDR addr, bool connected, uint64_t now_ms);
+
+  /* Removes |addr|. Returns false if it was not there. */
+  bool Remove(const BD_ADDR addr);
+
+  bool Contains(const BD_ADDR addr) const;
+
+  /* Records that the link to |addr| is up or down at |now_ms|. Returns true
+   * if the white list has to be synchronized for it. */
+  bool UpdateLink(const BD_ADDR addr, bool connected, uint64_t now_ms);
+
+  /* Hands the rotating entries of the white list over to the devices that
+   * waited the longest. Returns true if the white list has to be
+   * synchronized. */
+  bool Rotate();
+
+  /* Forgets all the devices, along with the content of the white list,
+   * which is to be cleared by the caller. */
+  void Clear();
+
+  /* Appends to |ops| the removals, then the additions, that bring the white
+   * list to the devices it should hold, and records them as done. */
+  void Sync(std::vector<Op>* ops);
+
+  /* Returns true if Sync() has changes to apply. */
+  bool NeedsSync() const { return dirty_; }
+
+  /* Returns true if the devices to connect to exceed the white list, so that
+   * they take turns. */
+  bool Overflows() const;
+
+  /* Returns true if a device is not connected. */
+  bool Pending() const;
+
+  /* Returns the number of devices, and of the ones in the white list. */
+  size_t Size() const { return size_; }
+  size_t ControllerSize() const { return controller_size_; }
+
+ private:
+  struct Device {
+    BD_ADDR bd_addr;
+    bool wanted;
+    bool connected;
+    bool in_controller;
+    bool selected;
+
+    /* in a rotating entry, and the round it got one in */
+    bool rotating;
+    uint32_t turn;
+
+    uint64_t active_ms;
+    uint64_t seq;
+  };
+
+  static uint64_t Key(const BD_ADDR addr);
+
+  /* Returns the devices to connect to, excluding the connected ones if
+   * needed to fit the white list. */
+  void Candidates(std::vector<Device*>* candidates);
+
+  std::unordered_map<uint64_t, Device> devices_;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t connected_ = 0;
+  size_t controller_size_ = 0;
+  uint32_t round_ = 1;
+  uint64_t seq_ = 0;
+  bool dirty_ = false;
+};
+
+#endif  // BLE_BG_CONN_LIST_H
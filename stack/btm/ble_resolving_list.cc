@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_resolving_list.h"
+
+#include <string.h>
+#include <algorithm>
+
+BleResolvingList::BleResolvingList(uint64_t min_residency_ms)
+    : min_residency_ms_(min_residency_ms) {}
+
+void BleResolvingList::SetCapacity(size_t capacity) {
+  capacity_ = capacity;
+  if (!devices_.empty()) dirty_ = true;
+}
+
+bool BleResolvingList::Add(const BD_ADDR addr, uint64_t now_ms) {
+  if (devices_.count(Key(addr)) != 0) return false;
+
+  Device device;
+  memset(&device, 0, sizeof(device));
+  memcpy(device.bd_addr, addr, BD_ADDR_LEN);
+  device.active_ms = now_ms;
+  device.seq = seq_++;
+  devices_.emplace(Key(addr), device);
+  dirty_ = true;
+  return true;
+}
+
+bool BleResolvingList::Remove(const BD_ADDR addr) {
+  auto it = devices_.find(Key(addr));
+  if (it == devices_.end()) return false;
+
+  /* its entry goes to another device */
+  if (it->second.in_controller) {
+    controller_size_--;
+    if (devices_.size() > capacity_) dirty_ = true;
+  }
+  devices_.erase(it);
+  return true;
+}
+
+bool BleResolvingList::Contains(const BD_ADDR addr) const {
+  return devices_.count(Key(addr)) != 0;
+}
+
+bool BleResolvingList::InController(const BD_ADDR addr) const {
+  auto it = devices_.find(Key(addr));
+  return it != devices_.end() && it->second.in_controller;
+}
+
+bool BleResolvingList::Resolved(const BD_ADDR addr, bool by_controller,
+                                uint64_t now_ms) {
+  auto it = devices_.find(Key(addr));
+  if (it == devices_.end()) return false;
+
+  if (by_controller)
+    hits_++;
+  else
+    misses_++;
+
+  Device& device = it->second;
+  device.active_ms = now_ms;
+  if (device.in_controller) return false;
+
+  dirty_ = true;
+  return true;
+}
+
+void BleResolvingList::ControllerCleared() {
+  for (auto& it : devices_) it.second.in_controller = false;
+  controller_size_ = 0;
+  dirty_ = !devices_.empty();
+}
+
+void BleResolvingList::Clear() {
+  devices_.clear();
+  controller_size_ = 0;
+  dirty_ = false;
+  hits_ = 0;
+  misses_ = 0;
+  swaps_ = 0;
+}
+
+void BleResolvingList::Sync(uint64_t now_ms, size_t max_ops,
+                            std::vector<Op>* ops) {
+  std::vector<Device*> inside;
+  std::vector<Device*> outside;
+  for (auto& it : devices_) {
+    if (it.second.in_controller)
+      inside.push_back(&it.second);
+    else
+      outside.push_back(&it.second);
+  }
+
+  /* the devices loaded first, and evicted from the least recently active */
+  std::sort(outside.begin(), outside.end(),
+            [](const Device* a, const Device* b) {
+              if (a->active_ms != b->active_ms)
+                return a->active_ms > b->active_ms;
+              return a->seq < b->seq;
+            });
+  std::sort(inside.begin(), inside.end(), [](const Device* a, const Device* b) {
+    if (a->active_ms != b->active_ms) return a->active_ms < b->active_ms;
+    return a->seq < b->seq;
+  });
+
+  std::vector<Device*> removed;
+  std::vector<Device*> added;
+  bool truncated = false;
+  size_t next = 0;
+
+  /* the devices beyond a smaller resolving list */
+  while (controller_size_ - removed.size() > capacity_) {
+    if (removed.size() == max_ops) {
+      truncated = true;
+      break;
+    }
+    removed.push_back(inside[next++]);
+  }
+
+  size_t free = capacity_ + removed.size() > controller_size_
+                    ? capacity_ + removed.size() - controller_size_
+                    : 0;
+  for (Device* device : outside) {
+    size_t budget = max_ops - removed.size() - added.size();
+    if (free > 0) {
+      if (budget == 0) {
+        truncated = true;
+        break;
+      }
+      added.push_back(device);
+      free--;
+      continue;
+    }
+
+    /* swapped with a less active device, loaded long enough */
+    while (next < inside.size() &&
+           now_ms - inside[next]->loaded_ms < min_residency_ms_)
+      next++;
+    if (next == inside.size() || inside[next]->active_ms >= device->active_ms)
+      break;
+    if (budget < 2) {
+      truncated = true;
+      break;
+    }
+    removed.push_back(inside[next++]);
+    added.push_back(device);
+    swaps_++;
+  }
+
+  for (Device* device : removed) {
+    Op op;
+    op.to_add = false;
+    memcpy(op.bd_addr, device->bd_addr, BD_ADDR_LEN);
+    ops->push_back(op);
+    device->in_controller = false;
+    controller_size_--;
+  }
+  for (Device* device : added) {
+    Op op;
+    op.to_add = true;
+    memcpy(op.bd_addr, device->bd_addr, BD_ADDR_LEN);
+    ops->push_back(op);
+    device->in_controller = true;
+    device->loaded_ms = now_ms;
+    controller_size_++;
+  }
+
+  dirty_ = truncated;
+}
+
+uint64_t BleResolvingList::Key(const BD_ADDR addr) {
+  uint64_t key = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) key = (key << 8) | addr[i];
+  return key;
+}
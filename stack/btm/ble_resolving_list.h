@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BLE_RESOLVING_LIST_H
+#define BLE_RESOLVING_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class keeps the bonded devices with an IRK, and the ones loaded in
+ * the resolving list of the controller. Once the devices exceed the
+ * resolving list, it holds the most recently active ones: a device the host
+ * had to resolve, for missing from the list, takes the entry of the least
+ * recently active device. The changes are only applied by Sync(), so that
+ * they are made in batches, in a single pause of the address resolution.
+ *
+ * A device loaded stays in the list for at least |min_residency_ms|, so that
+ * more active devices than entries don't swap them endlessly. */
+class BleResolvingList {
+ public:
+  struct Op {
+    bool to_add;
+    BD_ADDR bd_addr;
+  };
+
+  explicit BleResolvingList(uint64_t min_residency_ms);
+
+  /* Sets the number of entries of the resolving list of the controller. */
+  void SetCapacity(size_t capacity);
+
+  /* Adds the device |addr|, active at |now_ms|. Returns false if it was
+   * already there. */
+  bool Add(const BD_ADDR addr, uint64_t now_ms);
+
+  /* Forgets the device |addr|, to be removed from the resolving list by the
+   * caller if it is in it. Returns false if it was not there. */
+  bool Remove(const BD_ADDR addr);
+
+  bool Contains(const BD_ADDR addr) const;
+  bool InController(const BD_ADDR addr) const;
+
+  /* Records that an address of |addr| was resolved at |now_ms|, by the
+   * controller or by the host. Returns true if the resolving list has to be
+   * synchronized for it. */
+  bool Resolved(const BD_ADDR addr, bool by_controller, uint64_t now_ms);
+
+  /* Records that the resolving list of the controller was cleared. */
+  void ControllerCleared();
+
+  /* Forgets all the devices, and the statistics. */
+  void Clear();
+
+  /* Appends to |ops| the removals, then the additions, that bring the
+   * resolving list to the most recently active devices at |now_ms|, in at
+   * most |max_ops| operations, and records them as done. */
+  void Sync(uint64_t now_ms, size_t max_ops, std::vector<Op>* ops);
+
+  /* Returns true if Sync() has changes to apply. */
+  bool NeedsSync() const { return dirty_; }
+
+  size_t Size() const { return devices_.size(); }
+  size_t ControllerSize() const { return controller_size_; }
+  size_t Capacity() const { return capacity_; }
+
+  /* The addresses resolved by the controller, by the host, and the devices
+   * swapped into the resolving list. */
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+  uint32_t swaps() const { return swaps_; }
+
+ private:
+  struct Device {
+    BD_ADDR bd_addr;
+    bool in_controller;
+    uint64_t active_ms;
+    uint64_t loaded_ms;
+    uint64_t seq;
+  };
+
+  static uint64_t Key(const BD_ADDR addr);
+
+  const uint64_t min_residency_ms_;
+  std::unordered_map<uint64_t, Device> devices_;
+  size_t capacity_ = 0;
+  size_t controller_size_ = 0;
+  uint64_t seq_ = 0;
+  bool dirty_ = false;
+
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  uint32_t swaps_ = 0;
+};
+
+#endif  // BLE_RESOLVING_LIST_H
@@ -0,0 +1,131 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_rpa_resolver.h"
+
+#include <string.h>
+#include <algorithm>
+
+/* The address is prand || hash, prand being its 3 most significant octets */
+#define RPA_PRAND_LEN 3
+#define RPA_HASH_LEN 3
+
+const size_t BleRpaResolver::kBatchSize;
+
+BleRpaResolver::BleRpaResolver(size_t cache_size, uint64_t cache_timeout_ms)
+    : cache_size_(cache_size), cache_timeout_ms_(cache_timeout_ms) {}
+
+void BleRpaResolver::AddIrk(const BT_OCTET16 irk) {
+  Irk entry;
+  memcpy(entry.irk, irk, BT_OCTET16_LEN);
+  irks_.push_back(entry);
+
+  uint8_t key[BT_OCTET16_LEN];
+  for (int i = 0; i < BT_OCTET16_LEN; i++) key[i] = irk[BT_OCTET16_LEN - 1 - i];
+  keys_.resize(keys_.size() + 1);
+  smp_aes_set_key(key, &keys_.back());
+
+  /* the addresses resolved by none of the IRKs may be resolved by this one */
+  ClearCache();
+}
+
+void BleRpaResolver::Clear() {
+  /* the IRKs are not left behind in the memory released */
+  std::fill(irks_.begin(), irks_.end(), Irk());
+  memset(keys_.data(), 0, keys_.size() * sizeof(tSMP_AES_KEY));
+  irks_.clear();
+  keys_.clear();
+  ClearCache();
+}
+
+bool BleRpaResolver::Resolve(const BD_ADDR rpa, uint64_t now_ms,
+                             BT_OCTET16 irk) {
+  if (cache_.empty() && cache_size_ > 0) {
+    size_t num_slots = 1;
+    while (num_slots < cache_size_) num_slots <<= 1;
+    cache_.resize(num_slots);
+    ClearCache();
+  }
+
+  if (!cache_.empty()) {
+    CacheEntry& entry = CacheSlot(rpa);
+    if (entry.valid && now_ms < entry.expiry_ms &&
+        memcmp(entry.rpa, rpa, BD_ADDR_LEN) == 0) {
+      cache_hits_++;
+      if (entry.resolved) memcpy(irk, entry.irk, BT_OCTET16_LEN);
+      return entry.resolved;
+    }
+  }
+
+  cache_misses_++;
+  bool resolved = ResolveWithIrks(rpa, irk);
+
+  if (!cache_.empty()) {
+    CacheEntry& entry = CacheSlot(rpa);
+    memcpy(entry.rpa, rpa, BD_ADDR_LEN);
+    entry.valid = true;
+    entry.resolved = resolved;
+    if (resolved)
+      memcpy(entry.irk, irk, BT_OCTET16_LEN);
+    else
+      memset(entry.irk, 0, BT_OCTET16_LEN);
+    entry.expiry_ms = now_ms + cache_timeout_ms_;
+  }
+  return resolved;
+}
+
+BleRpaResolver::CacheEntry& BleRpaResolver::CacheSlot(const BD_ADDR rpa) {
+  /* the hash of the address is an AES output: its bits are as good as any
+   * hash of the address */
+  uint32_t hash = (rpa[3] << 16) | (rpa[4] << 8) | rpa[5];
+  return cache_[hash & (cache_.size() - 1)];
+}
+
+void BleRpaResolver::ClearCache() {
+  for (CacheEntry& entry : cache_) memset(&entry, 0, sizeof(entry));
+}
+
+bool BleRpaResolver::ResolveWithIrks(const BD_ADDR rpa, BT_OCTET16 irk) {
+  /* hash = ah(IRK, prand): the 24 least significant bits of the encryption of
+   * prand, zero padded, with the IRK */
+  uint8_t block[N_BLOCK] = {0};
+  memcpy(&block[N_BLOCK - RPA_PRAND_LEN], rpa, RPA_PRAND_LEN);
+  const uint8_t* hash = &rpa[RPA_PRAND_LEN];
+
+  uint8_t out[kBatchSize * N_BLOCK];
+  for (size_t first = 0; first < keys_.size(); first += kBatchSize) {
+    size_t num_keys = std::min(kBatchSize, keys_.size() - first);
+    smp_aes_encrypt_keys(&keys_[first], num_keys, block, out);
+
+    for (size_t i = 0; i < num_keys; i++) {
+      if (memcmp(&out[(i + 1) * N_BLOCK - RPA_HASH_LEN], hash, RPA_HASH_LEN))
+        continue;
+
+      size_t index = first + i;
+      memcpy(irk, irks_[index].irk, BT_OCTET16_LEN);
+
+      /* the IRK moves first, as its device is likely to be seen again */
+      std::rotate(keys_.begin(), keys_.begin() + index,
+                  keys_.begin() + index + 1);
+      std::rotate(irks_.begin(), irks_.begin() + index,
+                  irks_.begin() + index + 1);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BLE_RPA_RESOLVER_H
+#define BLE_RPA_RESOLVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+#include "stack/smp/smp_aes.h"
+
+/* This class resolves the resolvable private addresses in the host, against
+ * the IRKs of the bonded devices, when the controller does not resolve them.
+ *
+ * The IRKs are kept expanded, ordered by the last address they resolved, and
+ * all tried at once with the batched AES of the CPU. The results, including
+ * the addresses resolved by none of the IRKs, are cached for
+ * |cache_timeout_ms|, as every advertising report of a device otherwise
+ * costs as many AES as there are IRKs. */
+class BleRpaResolver {
+ public:
+  /* Caches the results of up to |cache_size| addresses. */
+  BleRpaResolver(size_t cache_size, uint64_t cache_timeout_ms);
+
+  /* Adds the IRK |irk|, in little endian order as stored in the security
+   * records. The results cached are forgotten. */
+  void AddIrk(const BT_OCTET16 irk);
+
+  /* Forgets all the IRKs and the results cached. */
+  void Clear();
+
+  /* Returns the number of IRKs. */
+  size_t NumIrks() const { return irks_.size(); }
+
+  /* Returns true if |rpa|, received at the time |now_ms|, is resolved by one
+   * of the IRKs, copied to |irk|. */
+  bool Resolve(const BD_ADDR rpa, uint64_t now_ms, BT_OCTET16 irk);
+
+  /* The number of Resolve() answered from the cache, and otherwise. */
+  uint32_t cache_hits() const { return cache_hits_; }
+  uint32_t cache_misses() const { return cache_misses_; }
+
+ private:
+  /* The IRKs are tried by batches, stopping at the first batch resolving the
+   * address */
+  static const size_t kBatchSize = 8;
+
+  struct Irk {
+    BT_OCTET16 irk;
+  };
+
+  struct CacheEntry {
+    BD_ADDR rpa;
+    bool valid;
+    bool resolved;
+    BT_OCTET16 irk;
+    uint64_t expiry_ms;
+  };
+
+  CacheEntry& CacheSlot(const BD_ADDR rpa);
+  void ClearCache();
+  bool ResolveWithIrks(const BD_ADDR rpa, BT_OCTET16 irk);
+
+  const size_t cache_size_;
+  const uint64_t cache_timeout_ms_;
+
+  /* |keys_| holds the expanded |irks_|, the most recently used first */
+  std::vector<tSMP_AES_KEY> keys_;
+  std::vector<Irk> irks_;
+
+  /* a direct-mapped cache, its size being a power of two. It is only
+   * allocated once resolving */
+  std::vector<CacheEntry> cache_;
+
+  uint32_t cache_hits_ = 0;
+  uint32_t cache_misses_ = 0;
+};
+
+#endif  // BLE_RPA_RESOLVER_H
@@ -0,0 +1,192 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_scan_dedup.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const uint32_t fnv_offset_basis = 2166136261u;
+const uint32_t fnv_prime = 16777619u;
+
+uint32_t Fnv1a(uint32_t hash, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= fnv_prime;
+  }
+  return hash;
+}
+
+}  // namespace
+
+const uint16_t BleScanDedup::kNone;
+
+BleScanDedup::BleScanDedup(size_t max_devices, uint64_t aging_ms,
+                           uint8_t rssi_threshold)
+    : max_devices_(std::min(max_devices, (size_t)kNone)),
+      aging_ms_(aging_ms),
+      rssi_threshold_(rssi_threshold) {}
+
+bool BleScanDedup::ShouldReport(uint8_t addr_type, const BD_ADDR addr,
+                                uint8_t sid, int8_t rssi, const uint8_t* data,
+                                size_t len, uint64_t now_ms) {
+  if (max_devices_ == 0) return true;
+
+  /* the table is only allocated once scanning */
+  if (entries_.empty()) {
+    size_t num_slots = 1;
+    /* keep the load factor under 3/4, so that the probing stays short */
+    while (num_slots * 3 < max_devices_ * 4) num_slots <<= 1;
+    slots_.resize(num_slots);
+    entries_.resize(max_devices_);
+    Clear();
+  }
+
+  uint32_t hash = Hash(data, len);
+  uint16_t index = Find(addr_type, addr, sid);
+  if (index == kNone) {
+    index = Insert(addr_type, addr, sid);
+  } else {
+    Unlink(index);
+    PushFront(index);
+
+    Entry& entry = entries_[index];
+    if (entry.hash == hash && abs(rssi - entry.rssi) <= rssi_threshold_ &&
+        now_ms - entry.reported_ms < aging_ms_)
+      return false;
+  }
+
+  Entry& entry = entries_[index];
+  entry.hash = hash;
+  entry.rssi = rssi;
+  entry.reported_ms = now_ms;
+  return true;
+}
+
+void BleScanDedup::Clear() {
+  std::fill(slots_.begin(), slots_.end(), kNone);
+
+  free_ = kNone;
+  for (size_t i = entries_.size(); i > 0; i--) {
+    entries_[i - 1].next = free_;
+    free_ = i - 1;
+  }
+  head_ = tail_ = kNone;
+  size_ = 0;
+}
+
+uint32_t BleScanDedup::Slot(uint8_t addr_type, const BD_ADDR addr,
+                            uint8_t sid) const {
+  uint32_t hash = Fnv1a(fnv_offset_basis, addr, BD_ADDR_LEN);
+  hash = Fnv1a(hash, &addr_type, 1);
+  hash = Fnv1a(hash, &sid, 1);
+  return hash & (slots_.size() - 1);
+}
+
+uint16_t BleScanDedup::Find(uint8_t addr_type, const BD_ADDR addr,
+                            uint8_t sid) const {
+  uint32_t mask = slots_.size() - 1;
+  for (uint32_t i = Slot(addr_type, addr, sid); slots_[i] != kNone;
+       i = (i + 1) & mask) {
+    const Entry& entry = entries_[slots_[i]];
+    if (entry.addr_type == addr_type && entry.sid == sid &&
+        memcmp(entry.addr, addr, BD_ADDR_LEN) == 0)
+      return slots_[i];
+  }
+  return kNone;
+}
+
+uint16_t BleScanDedup::Insert(uint8_t addr_type, const BD_ADDR addr,
+                              uint8_t sid) {
+  /* make room by evicting the least recently seen device */
+  if (free_ == kNone) Erase(tail_);
+
+  uint16_t index = free_;
+  Entry& entry = entries_[index];
+  free_ = entry.next;
+
+  memcpy(entry.addr, addr, BD_ADDR_LEN);
+  entry.addr_type = addr_type;
+  entry.sid = sid;
+
+  uint32_t mask = slots_.size() - 1;
+  uint32_t i = Slot(addr_type, addr, sid);
+  while (slots_[i] != kNone) i = (i + 1) & mask;
+  slots_[i] = index;
+  entry.slot = i;
+
+  PushFront(index);
+  size_++;
+  return index;
+}
+
+void BleScanDedup::Erase(uint16_t index) {
+  Unlink(index);
+
+  /* shift back the entries probed past the slot freed, so that the probing
+   * does not need tombstones */
+  uint32_t mask = slots_.size() - 1;
+  uint32_t i = entries_[index].slot;
+  slots_[i] = kNone;
+  for (uint32_t j = (i + 1) & mask; slots_[j] != kNone; j = (j + 1) & mask) {
+    const Entry& entry = entries_[slots_[j]];
+    uint32_t home = Slot(entry.addr_type, entry.addr, entry.sid);
+
+    /* the entry stays if its home slot lies cyclically in (i, j] */
+    bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+    if (stays) continue;
+
+    slots_[i] = slots_[j];
+    entries_[slots_[i]].slot = i;
+    slots_[j] = kNone;
+    i = j;
+  }
+
+  entries_[index].next = free_;
+  free_ = index;
+  size_--;
+}
+
+void BleScanDedup::Unlink(uint16_t index) {
+  Entry& entry = entries_[index];
+  if (entry.prev != kNone)
+    entries_[entry.prev].next = entry.next;
+  else
+    head_ = entry.next;
+
+  if (entry.next != kNone)
+    entries_[entry.next].prev = entry.prev;
+  else
+    tail_ = entry.prev;
+}
+
+void BleScanDedup::PushFront(uint16_t index) {
+  Entry& entry = entries_[index];
+  entry.prev = kNone;
+  entry.next = head_;
+  if (head_ != kNone) entries_[head_].prev = index;
+  head_ = index;
+  if (tail_ == kNone) tail_ = index;
+}
+
+uint32_t BleScanDedup::Hash(const uint8_t* data, size_t len) {
+  return Fnv1a(fnv_offset_basis, data, len);
+}
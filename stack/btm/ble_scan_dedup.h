@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BLE_SCAN_DEDUP_H
+#define BLE_SCAN_DEDUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class suppresses the duplicate advertising reports in the host, so
+ * that the scan can run without the duplicate filter of the controller and
+ * still track the RSSI of the devices. The devices, identified by their
+ * address and advertising set, are kept with a hash of the data, the RSSI and
+ * the time of the last report delivered for them. A report is only delivered
+ * if its data differs, its RSSI moved by more than the threshold, or the
+ * aging interval elapsed since the last report delivered.
+ *
+ * The devices are kept in an open-addressed hash table, probed linearly, over
+ * a fixed pool of entries. Once the pool is full, the least recently seen
+ * device is evicted to make room. Nothing is allocated after the first
+ * report. */
+class BleScanDedup {
+ public:
+  /* Tracks up to |max_devices| devices, at most 65535. */
+  BleScanDedup(size_t max_devices, uint64_t aging_ms, uint8_t rssi_threshold);
+
+  /* Returns true if the report from |addr_type, addr|, for the advertising
+   * set |sid|, with the data |data| of length |len|, received at |rssi| and
+   * at the time |now_ms|, is to be delivered. */
+  bool ShouldReport(uint8_t addr_type, const BD_ADDR addr, uint8_t sid,
+                    int8_t rssi, const uint8_t* data, size_t len,
+                    uint64_t now_ms);
+
+  /* Forgets all the devices: their next report is delivered. */
+  void Clear();
+
+  /* Returns the number of devices tracked. */
+  size_t Size() const { return size_; }
+
+ private:
+  static const uint16_t kNone = 0xFFFF;
+
+  struct Entry {
+    uint8_t addr[BD_ADDR_LEN];
+    uint8_t addr_type;
+    uint8_t sid;
+    int8_t rssi;
+    uint32_t hash;
+    uint64_t reported_ms;
+
+    /* the least recently used list, and the slot of the entry */
+    uint16_t prev;
+    uint16_t next;
+    uint32_t slot;
+  };
+
+  uint32_t Slot(uint8_t addr_type, const BD_ADDR addr, uint8_t sid) const;
+  uint16_t Find(uint8_t addr_type, const BD_ADDR addr, uint8_t sid) const;
+  uint16_t Insert(uint8_t addr_type, const BD_ADDR addr, uint8_t sid);
+  void Erase(uint16_t index);
+
+  void Unlink(uint16_t index);
+  void PushFront(uint16_t index);
+
+  static uint32_t Hash(const uint8_t* data, size_t len);
+
+  const size_t max_devices_;
+  const uint64_t aging_ms_;
+  const uint8_t rssi_threshold_;
+
+  /* |slots_| holds the index of the entries, or kNone, its size being a power
+   * of two */
+  std::vector<uint16_t> slots_;
+  std::vector<Entry> entries_;
+  uint16_t free_ = kNone;
+  uint16_t head_ = kNone;
+  uint16_t tail_ = kNone;
+  size_t size_ = 0;
+};
+
+#endif  // BLE_SCAN_DEDUP_H
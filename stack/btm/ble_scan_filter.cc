@@ -0,0 +1,460 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "ble_scan_filter.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "advertise_data_parser.h"
+#include "btm_api_types.h"
+#include "btm_ble_api_types.h"
+
+/* AD types of the service solicitation UUIDs */
+#define AD_TYPE_SOL_16BITS_UUID 0x14
+#define AD_TYPE_SOL_128BITS_UUID 0x15
+#define AD_TYPE_SOL_32BITS_UUID 0x1F
+
+#define BTM_BLE_PF_BIT(x) (uint16_t)(1 << (x))
+
+/* the features whose conditions are combined by the filter logic type */
+#define FILT_LOGIC_FEATURES                \
+  (BTM_BLE_PF_BIT(BTM_BLE_PF_LOCAL_NAME) | \
+   BTM_BLE_PF_BIT(BTM_BLE_PF_MANU_DATA) |  \
+   BTM_BLE_PF_BIT(BTM_BLE_PF_SRVC_DATA_PATTERN))
+
+namespace {
+
+/* Bluetooth base UUID, in little endian order */
+const uint8_t base_uuid[LEN_UUID_128] = {0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00,
+                                         0x00, 0x80, 0x00, 0x10, 0x00, 0x00,
+                                         0x00, 0x00, 0x00, 0x00};
+
+/* Iterates over the fields of type |type| of |ad|, calling |match| with the
+ * data of each of them until it returns true. */
+template <typename Match>
+bool AnyField(const uint8_t* ad, size_t ad_len, uint8_t type, Match match) {
+  for (const auto& field : AdvertiseDataParser::Fields(ad, ad_len)) {
+    if (field.type == type && match(field.data, field.len)) return true;
+  }
+  return false;
+}
+
+/* Returns whether a report matches the conditions |conds| of a feature,
+ * AND-ed if |and_logic|, OR-ed otherwise, |cond_matches| telling whether it
+ * matches each of them. A feature without any condition does not restrict the
+ * reports. */
+template <typename Cond, typename CondMatches>
+bool ListMatches(const std::vector<Cond>& conds, bool and_logic,
+                 CondMatches cond_matches) {
+  if (conds.empty()) return true;
+
+  for (const Cond& cond : conds) {
+    bool matched = cond_matches(cond);
+    if (matched != and_logic) return matched;
+  }
+  return and_logic;
+}
+
+/* Stores the UUID |uuid| of |len| octets, found in advertising data, in the
+ * 128-bit form into |uuid128|. */
+void UuidTo128(const uint8_t* uuid, size_t len,
+               uint8_t uuid128[LEN_UUID_128]) {
+  if (len == LEN_UUID_128) {
+    memcpy(uuid128, uuid, LEN_UUID_128);
+    return;
+  }
+
+  memcpy(uuid128, base_uuid, LEN_UUID_128);
+  memcpy(uuid128 + LEN_UUID_128 - 4, uuid, len);
+}
+
+}  // namespace
+
+void BleScanFilter::SetParams(uint8_t filt_index, uint16_t feat_seln,
+                              uint16_t list_logic_type,
+                              uint8_t filt_logic_type, int8_t rssi_high_thres) {
+  Filter& filter = filters_[filt_index];
+  filter.params_set = true;
+  filter.feat_seln = feat_seln;
+  filter.list_logic_type = list_logic_type;
+  filter.filt_logic_type = filt_logic_type;
+  filter.rssi_high_thres = rssi_high_thres;
+}
+
+void BleScanFilter::RemoveParams(uint8_t filt_index) {
+  auto it = filters_.find(filt_index);
+  if (it != filters_.end()) it->second.params_set = false;
+}
+
+void BleScanFilter::Remove(uint8_t filt_index) { filters_.erase(filt_index); }
+
+void BleScanFilter::RemoveAll() { filters_.clear(); }
+
+void BleScanFilter::AddAddress(uint8_t filt_index, const BD_ADDR addr) {
+  std::array<uint8_t, BD_ADDR_LEN> cond;
+  memcpy(cond.data(), addr, BD_ADDR_LEN);
+
+  auto& addrs = filters_[filt_index].addrs;
+  if (std::find(addrs.begin(), addrs.end(), cond) == addrs.end())
+    addrs.push_back(cond);
+}
+
+void BleScanFilter::RemoveAddress(uint8_t filt_index, const BD_ADDR addr) {
+  std::array<uint8_t, BD_ADDR_LEN> cond;
+  memcpy(cond.data(), addr, BD_ADDR_LEN);
+
+  auto& addrs = filters_[filt_index].addrs;
+  addrs.erase(std::remove(addrs.begin(), addrs.end(), cond), addrs.end());
+}
+
+void BleScanFilter::AddUuid(uint8_t filt_index, uint8_t filter_type,
+                            const tBT_UUID& uuid, const uint8_t* uuid_mask) {
+  UuidCond cond;
+  ToUuidCond(uuid, uuid_mask, &cond);
+
+  Filter& filter = filters_[filt_index];
+  auto& uuids = filter_type == BTM_BLE_PF_SRVC_SOL_UUID ? filter.sol_uuids
+                                                        : filter.srvc_uuids;
+  for (const UuidCond& c : uuids) {
+    if (memcmp(c.uuid, cond.uuid, LEN_UUID_128) == 0 &&
+        memcmp(c.mask, cond.mask, LEN_UUID_128) == 0)
+      return;
+  }
+  uuids.push_back(cond);
+}
+
+void BleScanFilter::RemoveUuid(uint8_t filt_index, uint8_t filter_type,
+                               const tBT_UUID& uuid) {
+  UuidCond cond;
+  ToUuidCond(uuid, NULL, &cond);
+
+  Filter& filter = filters_[filt_index];
+  auto& uuids = filter_type == BTM_BLE_PF_SRVC_SOL_UUID ? filter.sol_uuids
+                                                        : filter.srvc_uuids;
+  uuids.erase(std::remove_if(uuids.begin(), uuids.end(),
+                             [&cond](const UuidCond& c) {
+                               return memcmp(c.uuid, cond.uuid,
+                                             LEN_UUID_128) == 0;
+                             }),
+              uuids.end());
+}
+
+void BleScanFilter::AddLocalName(uint8_t filt_index,
+                                 std::vector<uint8_t> name) {
+  auto& names = filters_[filt_index].names;
+  if (std::find(names.begin(), names.end(), name) == names.end())
+    names.push_back(std::move(name));
+}
+
+void BleScanFilter::RemoveLocalName(uint8_t filt_index,
+                                    const std::vector<uint8_t>& name) {
+  auto& names = filters_[filt_index].names;
+  names.erase(std::remove(names.begin(), names.end(), name), names.end());
+}
+
+void BleScanFilter::AddManufacturerData(uint8_t filt_index,
+                                        uint16_t company_id,
+                                        uint16_t company_id_mask,
+                                        std::vector<uint8_t> data,
+                                        std::vector<uint8_t> data_mask) {
+  auto& manu_data = filters_[filt_index].manu_data;
+  for (const DataCond& c : manu_data) {
+    if (c.company_id == company_id && c.company_id_mask == company_id_mask &&
+        c.data == data && c.mask == data_mask)
+      return;
+  }
+  manu_data.push_back(
+      {company_id, company_id_mask, std::move(data), std::move(data_mask)});
+}
+
+void BleScanFilter::RemoveManufacturerData(uint8_t filt_index,
+                                           uint16_t company_id,
+                                           const std::vector<uint8_t>& data) {
+  auto& manu_data = filters_[filt_index].manu_data;
+  manu_data.erase(std::remove_if(manu_data.begin(), manu_data.end(),
+                                 [&](const DataCond& c) {
+                                   return c.company_id == company_id &&
+                                          c.data == data;
+                                 }),
+                  manu_data.end());
+}
+
+void BleScanFilter::AddServiceData(uint8_t filt_index,
+                                   std::vector<uint8_t> data,
+                                   std::vector<uint8_t> data_mask) {
+  auto& srvc_data = filters_[filt_index].srvc_data;
+  for (const DataCond& c : srvc_data) {
+    if (c.data == data && c.mask == data_mask) return;
+  }
+  srvc_data.push_back({0, 0, std::move(data), std::move(data_mask)});
+}
+
+void BleScanFilter::RemoveServiceData(uint8_t filt_index,
+                                      const std::vector<uint8_t>& data) {
+  auto& srvc_data = filters_[filt_index].srvc_data;
+  srvc_data.erase(
+      std::remove_if(srvc_data.begin(), srvc_data.end(),
+                     [&data](const DataCond& c) { return c.data == data; }),
+      srvc_data.end());
+}
+
+void BleScanFilter::ClearConditions(uint8_t filt_index, uint8_t feature) {
+  auto it = filters_.find(filt_index);
+  if (it == filters_.end()) return;
+
+  Filter& filter = it->second;
+  switch (feature) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      filter.addrs.clear();
+      break;
+    case BTM_BLE_PF_SRVC_UUID:
+      filter.srvc_uuids.clear();
+      break;
+    case BTM_BLE_PF_SRVC_SOL_UUID:
+      filter.sol_uuids.clear();
+      break;
+    case BTM_BLE_PF_LOCAL_NAME:
+      filter.names.clear();
+      break;
+    case BTM_BLE_PF_MANU_DATA:
+      filter.manu_data.clear();
+      break;
+    case BTM_BLE_PF_SRVC_DATA_PATTERN:
+      filter.srvc_data.clear();
+      break;
+    default:
+      break;
+  }
+}
+
+bool BleScanFilter::Matches(const BD_ADDR bda, int8_t rssi, const uint8_t* ad,
+                            size_t ad_len) const {
+  if (!enabled_) return true;
+
+  AdTypes present = PresentTypes(ad, ad_len);
+  for (const auto& it : filters_) {
+    if (it.second.params_set &&
+        FilterMatches(it.second, present, bda, rssi, ad, ad_len))
+      return true;
+  }
+  return false;
+}
+
+bool BleScanFilter::FilterMatches(const Filter& filter, const AdTypes& present,
+                                  const BD_ADDR bda, int8_t rssi,
+                                  const uint8_t* ad, size_t ad_len) const {
+  if (rssi < filter.rssi_high_thres) return false;
+
+  bool and_logic = filter.filt_logic_type == BTM_BLE_PF_LOGIC_AND;
+  bool logic_selected = false;
+  bool logic_matched = false;
+
+  for (uint8_t feature = 0; feature < BTM_BLE_PF_TYPE_ALL; feature++) {
+    if (!(filter.feat_seln & BTM_BLE_PF_BIT(feature))) continue;
+
+    bool matched = FeatureMatches(filter, feature, present, bda, ad, ad_len);
+
+    /* the features outside of the filter logic are always AND-ed */
+    if (!(FILT_LOGIC_FEATURES & BTM_BLE_PF_BIT(feature))) {
+      if (!matched) return false;
+      continue;
+    }
+
+    if (and_logic && !matched) return false;
+    logic_selected = true;
+    logic_matched |= matched;
+  }
+
+  return !logic_selected || logic_matched;
+}
+
+bool BleScanFilter::FeatureMatches(const Filter& filter, uint8_t feature,
+                                   const AdTypes& present, const BD_ADDR bda,
+                                   const uint8_t* ad, size_t ad_len) const {
+  bool and_logic = filter.list_logic_type & BTM_BLE_PF_BIT(feature);
+
+  switch (feature) {
+    case BTM_BLE_PF_ADDR_FILTER:
+      return ListMatches(filter.addrs, and_logic,
+                         [bda](const std::array<uint8_t, BD_ADDR_LEN>& addr) {
+                           return memcmp(addr.data(), bda, BD_ADDR_LEN) == 0;
+                         });
+
+    case BTM_BLE_PF_SRVC_DATA:
+      /* the change of the service data can only be tracked by the
+       * controller: any service data matches */
+      return present[BT_EIR_SERVICE_DATA_16BITS_UUID_TYPE] ||
+             present[BT_EIR_SERVICE_DATA_32BITS_UUID_TYPE] ||
+             present[BT_EIR_SERVICE_DATA_128BITS_UUID_TYPE];
+
+    case BTM_BLE_PF_SRVC_UUID:
+    case BTM_BLE_PF_SRVC_SOL_UUID: {
+      bool solicitation = feature == BTM_BLE_PF_SRVC_SOL_UUID;
+      return ListMatches(
+          solicitation ? filter.sol_uuids : filter.srvc_uuids, and_logic,
+          [&](const UuidCond& cond) {
+            return UuidMatches(cond, solicitation, present, ad, ad_len);
+          });
+    }
+
+    case BTM_BLE_PF_LOCAL_NAME:
+      return ListMatches(
+          filter.names, and_logic, [&](const std::vector<uint8_t>& name) {
+            auto equals = [&name](const uint8_t* field, uint8_t len) {
+              return len == name.size() &&
+                     std::equal(name.begin(), name.end(), field);
+            };
+            return (present[BT_EIR_COMPLETE_LOCAL_NAME_TYPE] &&
+                    AnyField(ad, ad_len, BT_EIR_COMPLETE_LOCAL_NAME_TYPE,
+                             equals)) ||
+                   (present[BT_EIR_SHORTENED_LOCAL_NAME_TYPE] &&
+                    AnyField(ad, ad_len, BT_EIR_SHORTENED_LOCAL_NAME_TYPE,
+                             equals));
+          });
+
+    case BTM_BLE_PF_MANU_DATA:
+      return ListMatches(
+          filter.manu_data, and_logic, [&](const DataCond& cond) {
+            if (!present[BT_EIR_MANUFACTURER_SPECIFIC_TYPE]) return false;
+            return AnyField(
+                ad, ad_len, BT_EIR_MANUFACTURER_SPECIFIC_TYPE,
+                [&cond](const uint8_t* field, uint8_t len) {
+                  if (len < 2) return false;
+                  uint16_t company_id = field[0] | (field[1] << 8);
+                  if ((company_id ^ cond.company_id) & cond.company_id_mask)
+                    return false;
+                  return DataMatches(field + 2, len - 2, cond.data,
+                                     cond.mask);
+                });
+          });
+
+    case BTM_BLE_PF_SRVC_DATA_PATTERN:
+      return ListMatches(
+          filter.srvc_data, and_logic, [&](const DataCond& cond) {
+            auto data_matches = [&cond](const uint8_t* field, uint8_t len) {
+              return DataMatches(field, len, cond.data, cond.mask);
+            };
+            for (uint8_t type : {BT_EIR_SERVICE_DATA_16BITS_UUID_TYPE,
+                                 BT_EIR_SERVICE_DATA_32BITS_UUID_TYPE,
+                                 BT_EIR_SERVICE_DATA_128BITS_UUID_TYPE}) {
+              if (present[type] && AnyField(ad, ad_len, type, data_matches))
+                return true;
+            }
+            return false;
+          });
+
+    default:
+      return true;
+  }
+}
+
+BleScanFilter::AdTypes BleScanFilter::PresentTypes(const uint8_t* ad,
+                                                   size_t ad_len) {
+  AdTypes present;
+  size_t position = 0;
+
+  while (position < ad_len) {
+    uint8_t len = ad[position];
+    if (len == 0 || position + len >= ad_len) break;
+
+    present.set(ad[position + 1]);
+    position += len + 1;
+  }
+  return present;
+}
+
+void BleScanFilter::ToUuidCond(const tBT_UUID& uuid, const uint8_t* uuid_mask,
+                               UuidCond* cond) {
+  uint8_t value[LEN_UUID_128];
+  if (uuid.len == LEN_UUID_16) {
+    value[0] = uuid.uu.uuid16 & 0xFF;
+    value[1] = uuid.uu.uuid16 >> 8;
+  } else if (uuid.len == LEN_UUID_32) {
+    for (int i = 0; i < LEN_UUID_32; i++) value[i] = uuid.uu.uuid32 >> (8 * i);
+  } else {
+    memcpy(value, uuid.uu.uuid128, LEN_UUID_128);
+  }
+  UuidTo128(value, uuid.len, cond->uuid);
+
+  /* the base UUID is always compared for the short UUIDs */
+  memset(cond->mask, 0xFF, LEN_UUID_128);
+  if (uuid_mask != NULL) {
+    uint8_t* mask = uuid.len == LEN_UUID_128 ? cond->mask
+                                             : cond->mask + LEN_UUID_128 - 4;
+    memcpy(mask, uuid_mask, uuid.len);
+  }
+}
+
+bool BleScanFilter::UuidMatches(const UuidCond& cond, bool solicitation,
+                                const AdTypes& present, const uint8_t* ad,
+                                size_t ad_len) {
+  struct UuidType {
+    uint8_t type;
+    uint8_t uuid_len;
+  };
+  static const UuidType srvc_types[] = {
+      {BT_EIR_MORE_16BITS_UUID_TYPE, LEN_UUID_16},
+      {BT_EIR_COMPLETE_16BITS_UUID_TYPE, LEN_UUID_16},
+      {BT_EIR_MORE_32BITS_UUID_TYPE, LEN_UUID_32},
+      {BT_EIR_COMPLETE_32BITS_UUID_TYPE, LEN_UUID_32},
+      {BT_EIR_MORE_128BITS_UUID_TYPE, LEN_UUID_128},
+      {BT_EIR_COMPLETE_128BITS_UUID_TYPE, LEN_UUID_128}};
+  static const UuidType sol_types[] = {
+      {AD_TYPE_SOL_16BITS_UUID, LEN_UUID_16},
+      {AD_TYPE_SOL_32BITS_UUID, LEN_UUID_32},
+      {AD_TYPE_SOL_128BITS_UUID, LEN_UUID_128}};
+
+  const UuidType* types = solicitation ? sol_types : srvc_types;
+  size_t num_types = solicitation ? sizeof(sol_types) / sizeof(sol_types[0])
+                                  : sizeof(srvc_types) / sizeof(srvc_types[0]);
+
+  for (size_t k = 0; k < num_types; k++) {
+    const UuidType& t = types[k];
+    if (!present[t.type]) continue;
+
+    bool found =
+        AnyField(ad, ad_len, t.type, [&](const uint8_t* field, uint8_t len) {
+          for (size_t i = 0; i + t.uuid_len <= len; i += t.uuid_len) {
+            uint8_t uuid[LEN_UUID_128];
+            UuidTo128(field + i, t.uuid_len, uuid);
+
+            int j = 0;
+            while (j < LEN_UUID_128 &&
+                   ((uuid[j] ^ cond.uuid[j]) & cond.mask[j]) == 0)
+              j++;
+            if (j == LEN_UUID_128) return true;
+          }
+          return false;
+        });
+    if (found) return true;
+  }
+  return false;
+}
+
+bool BleScanFilter::DataMatches(const uint8_t* field, size_t field_len,
+                                const std::vector<uint8_t>& data,
+                                const std::vector<uint8_t>& mask) {
+  if (field_len < data.size()) return false;
+
+  for (size_t i = 0; i < data.size(); i++) {
+    uint8_t m = i < mask.size() ? mask[i] : 0xFF;
+    if ((field[i] ^ data[i]) & m) return false;
+  }
+  return true;
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BLE_SCAN_FILTER_H
+#define BLE_SCAN_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <bitset>
+#include <map>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class implements the advertising packet content filter (APCF) in the
+ * host, for the controllers that do not offload it. It keeps the same model
+ * as the controller: filters, identified by their filter index, hold lists of
+ * conditions per feature (address, service data, service UUID, solicitation
+ * UUID, local name, manufacturer data and service data pattern, indexed by
+ * the BTM_BLE_PF_* feature bits), and a filter only takes part in the
+ * matching once its parameters are set, selecting the features it checks.
+ *
+ * The conditions are matched against the raw advertising data of a report,
+ * without copying or allocating anything: the AD types present in the report
+ * are collected in a single pass, so that the conditions looking for an AD
+ * type the report does not carry are rejected without searching for it. */
+class BleScanFilter {
+ public:
+  /* When disabled, every report matches. */
+  void Enable(bool enable) { enabled_ = enable; }
+  bool IsEnabled() const { return enabled_; }
+
+  /* Selects the features of the filter |filt_index|, by their BTM_BLE_PF_*
+   * bit in |feat_seln|. |list_logic_type| tells, per feature bit, whether the
+   * conditions of the feature are AND-ed (bit set) or OR-ed. The local name,
+   * manufacturer data and service data pattern features are AND-ed if
+   * |filt_logic_type| is BTM_BLE_PF_LOGIC_AND, OR-ed otherwise, and AND-ed
+   * with the other features. The reports weaker than |rssi_high_thres| never
+   * match the filter. */
+  void SetParams(uint8_t filt_index, uint16_t feat_seln,
+                 uint16_t list_logic_type, uint8_t filt_logic_type,
+                 int8_t rssi_high_thres);
+
+  /* Removes the parameters of the filter |filt_index|: it does not take part
+   * in the matching until they are set again, but keeps its conditions. */
+  void RemoveParams(uint8_t filt_index);
+
+  /* Removes the filter |filt_index| altogether, or all of them. */
+  void Remove(uint8_t filt_index);
+  void RemoveAll();
+
+  /* The conditions of the filter |filt_index|. Adding a condition that is
+   * already there has no effect, and so has removing one that is not. The
+   * |uuid_mask|, |company_id_mask| and data masks are bitwise: a bit cleared
+   * in the mask is not compared. For the UUIDs, |filter_type| is either
+   * BTM_BLE_PF_SRVC_UUID or BTM_BLE_PF_SRVC_SOL_UUID, and |uuid_mask| is as
+   * long as |uuid|, in little endian order, or NULL to compare all the bits.
+   * An empty data mask compares all the bits of the data. */
+  void AddAddress(uint8_t filt_index, const BD_ADDR addr);
+  void RemoveAddress(uint8_t filt_index, const BD_ADDR addr);
+
+  void AddUuid(uint8_t filt_index, uint8_t filter_type, const tBT_UUID& uuid,
+               const uint8_t* uuid_mask);
+  void RemoveUuid(uint8_t filt_index, uint8_t filter_type,
+                  const tBT_UUID& uuid);
+
+  void AddLocalName(uint8_t filt_index, std::vector<uint8_t> name);
+  void RemoveLocalName(uint8_t filt_index, const std::vector<uint8_t>& name);
+
+  void AddManufacturerData(uint8_t filt_index, uint16_t company_id,
+                           uint16_t company_id_mask, std::vector<uint8_t> data,
+                           std::vector<uint8_t> data_mask);
+  void RemoveManufacturerData(uint8_t filt_index, uint16_t company_id,
+                              const std::vector<uint8_t>& data);
+
+  void AddServiceData(uint8_t filt_index, std::vector<uint8_t> data,
+                      std::vector<uint8_t> data_mask);
+  void RemoveServiceData(uint8_t filt_index, const std::vector<uint8_t>& data);
+
+  /* Removes all the conditions of the feature |feature| of the filter
+   * |filt_index|. |feature| is a BTM_BLE_PF_* feature bit. */
+  void ClearConditions(uint8_t filt_index, uint8_t feature);
+
+  /* Returns true if the report from |bda|, received at |rssi| with the
+   * advertising data |ad| of length |ad_len|, matches one of the filters whose
+   * parameters are set, or if the filter is disabled. */
+  bool Matches(const BD_ADDR bda, int8_t rssi, const uint8_t* ad,
+               size_t ad_len) const;
+
+ private:
+  using AdTypes = std::bitset<256>;
+
+  /* A UUID condition, in the 128-bit form. */
+  struct UuidCond {
+    uint8_t uuid[LEN_UUID_128];
+    uint8_t mask[LEN_UUID_128];
+  };
+
+  /* A data condition, on manufacturer data past the company id or on service
+   * data. */
+  struct DataCond {
+    uint16_t company_id;
+    uint16_t company_id_mask;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> mask;
+  };
+
+  struct Filter {
+    bool params_set = false;
+    uint16_t feat_seln = 0;
+    uint16_t list_logic_type = 0;
+    uint8_t filt_logic_type = 0;
+    int8_t rssi_high_thres = 0;
+
+    std::vector<std::array<uint8_t, BD_ADDR_LEN>> addrs;
+    std::vector<UuidCond> srvc_uuids;
+    std::vector<UuidCond> sol_uuids;
+    std::vector<std::vector<uint8_t>> names;
+    std::vector<DataCond> manu_data;
+    std::vector<DataCond> srvc_data;
+  };
+
+  bool FilterMatches(const Filter& filter, const AdTypes& present,
+                     const BD_ADDR bda, int8_t rssi, const uint8_t* ad,
+                     size_t ad_len) const;
+  bool FeatureMatches(const Filter& filter, uint8_t feature,
+                      const AdTypes& present, const BD_ADDR bda,
+                      const uint8_t* ad, size_t ad_len) const;
+
+  static AdTypes PresentTypes(const uint8_t* ad, size_t ad_len);
+  static void ToUuidCond(const tBT_UUID& uuid, const uint8_t* uuid_mask,
+                         UuidCond* cond);
+  static bool UuidMatches(const UuidCond& cond, bool solicitation,
+                          const AdTypes& present, const uint8_t* ad,
+                          size_t ad_len);
+  static bool DataMatches(const uint8_t* field, size_t field_len,
+                          const std::vector<uint8_t>& data,
+                          const std::vector<uint8_t>& mask);
+
+  bool enabled_ = false;
+  std::map<uint8_t, Filter> filters_;
+};
+
+#endif  // BLE_SCAN_FILTER_H
@@ -48,6 +48,7 @@
 #include "hcimsgs.h"
 #include "l2c_int.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
@@ -59,6 +60,23 @@ static void btm_process_remote_ext_features(tACL_CONN* p_acl_cb,
 /* 3 seconds timeout waiting for responses */
 #define BTM_DEV_REPLY_TIMEOUT_MS (3 * 1000)
 
+/* The high throughput links are sampled every second. A link that waited
+ * for the controller for most of its completed packets, and has a congested
+ * channel, in two samples in a row cannot keep up. It falls back to 2-DH3
+ * for a hold off that doubles each time the 5 slot packets fail again. */
+#define BTM_ACL_TPUT_SAMPLE_MS 1000
+#define BTM_ACL_TPUT_BLOCKED_PCT 50
+#define BTM_ACL_TPUT_BAD_SAMPLES 2
+#define BTM_ACL_TPUT_MIN_HOLD_OFF_MS (10 * 1000)
+#define BTM_ACL_TPUT_MAX_HOLD_OFF_MS (160 * 1000)
+
+/* The packets of a link that fell back: up to 3 slots, and no 8DPSK */
+#define BTM_ACL_TPUT_FALLBACK_NO_PKTS                                   \
+  (BTM_ACL_PKT_TYPES_MASK_NO_3_DH1 | BTM_ACL_PKT_TYPES_MASK_NO_3_DH3 | \
+   BTM_ACL_PKT_TYPES_MASK_NO_2_DH5 | BTM_ACL_PKT_TYPES_MASK_NO_3_DH5)
+
+static void btm_acl_tput_timer_timeout(void* data);
+
 /*******************************************************************************
  *
  * Function         btm_acl_init
@@ -400,6 +418,8 @@ void btm_acl_removed(BD_ADDR bda, tBT_TRANSPORT transport) {
       BTM_TRACE_ERROR("Device not found");
     }
 
+    if (p->transport == BT_TRANSPORT_LE) btm_ble_update_bg_conn_link(bda, false);
+
     /* Clear the ACL connection data */
     memset(p, 0, sizeof(tACL_CONN));
   }
@@ -1908,6 +1928,229 @@ tBTM_STATUS BTM_ReadLinkQuality(BD_ADDR remote_bda, tBTM_CMPL_CB* p_cb) {
   return (BTM_UNKNOWN_ADDR);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_ReadFailedContactCounter
+ *
+ * Description      This function is called to read the failed contact counter
+ *                  of the link. The value of the counter is returned in the
+ *                  callback.
+ *                  (tBTM_FAILED_CONTACT_COUNTER_RESULTS)
+ *
+ * Returns          BTM_CMD_STARTED if successfully initiated or error code
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_ReadFailedContactCounter(const BD_ADDR remote_bda,
+                                         tBTM_CMPL_CB* p_cb) {
+  tACL_CONN* p;
+
+  BTM_TRACE_API("%s: RemBdAddr: %02x%02x%02x%02x%02x%02x", __func__,
+                remote_bda[0], remote_bda[1], remote_bda[2], remote_bda[3],
+                remote_bda[4], remote_bda[5]);
+
+  /* If someone already waiting on the counter, do not allow another */
+  if (btm_cb.devcb.p_failed_contact_cmpl_cb) return (BTM_BUSY);
+
+  p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  if (p != (tACL_CONN*)NULL) {
+    btm_cb.devcb.p_failed_contact_cmpl_cb = p_cb;
+    alarm_set_on_queue(btm_cb.devcb.read_failed_contact_counter_timer,
+                       BTM_DEV_REPLY_TIMEOUT_MS,
+                       btm_read_failed_contact_counter_timeout, NULL,
+                       btu_general_alarm_queue);
+
+    btsnd_hcic_read_failed_contact_counter(p->hci_handle);
+    return (BTM_CMD_STARTED);
+  }
+
+  /* If here, no BD Addr found */
+  return (BTM_UNKNOWN_ADDR);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_tput_pkt_types
+ *
+ * Description      Returns the packet types for the link under the high
+ *                  throughput policy, keeping the 8DPSK packets disabled for
+ *                  the peers that only work with 2 Mbps.
+ *
+ ******************************************************************************/
+static uint16_t btm_acl_tput_pkt_types(tACL_CONN* p) {
+  uint16_t pkt_types =
+      btm_cb.btm_acl_pkt_types_supported |
+      (p->tput_saved_pkt_types &
+       (BTM_ACL_PKT_TYPES_MASK_NO_3_DH1 | BTM_ACL_PKT_TYPES_MASK_NO_3_DH3 |
+        BTM_ACL_PKT_TYPES_MASK_NO_3_DH5));
+  if (p->tput_fallback) {
+    pkt_types &= ~(BTM_ACL_PKT_TYPES_MASK_DM5 | BTM_ACL_PKT_TYPES_MASK_DH5);
+    pkt_types |= BTM_ACL_TPUT_FALLBACK_NO_PKTS;
+  }
+  return pkt_types;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_SetAclHighThroughput
+ *
+ * Description      This function is called while a stream needs most of the
+ *                  throughput of the BR/EDR link.
+ *
+ * Returns          BTM_SUCCESS if the policy of the link is set
+ *                  BTM_UNKNOWN_ADDR if no active link with bd addr specified
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_SetAclHighThroughput(const BD_ADDR remote_bda, bool enable) {
+  tACL_CONN* p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return BTM_UNKNOWN_ADDR;
+
+  BTM_TRACE_API("%s: handle 0x%04x %s", __func__, p->hci_handle,
+                enable ? "on" : "off");
+  if (p->high_tput == enable) return BTM_SUCCESS;
+
+  if (enable) {
+    p->high_tput = true;
+    p->tput_fallback = false;
+    p->tput_bad_samples = 0;
+    p->tput_saved_pkt_types = p->pkt_types_mask;
+    p->tput_hold_off_ms = BTM_ACL_TPUT_MIN_HOLD_OFF_MS;
+    p->tput_goodput_kbps = 0;
+    p->tput_blocked_pct = 0;
+
+    tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(p->hci_handle);
+    if (p_lcb != NULL) {
+      p->tput_sent_pkts = p_lcb->acl_sent_pkts;
+      p->tput_sent_bytes = p_lcb->acl_sent_bytes;
+      p->tput_completed_pkts = p_lcb->acl_completed_pkts;
+      p->tput_blocked_pkts = p_lcb->acl_blocked_pkts;
+    }
+
+    btm_set_packet_types(p, btm_acl_tput_pkt_types(p));
+    if (!alarm_is_scheduled(btm_cb.devcb.acl_tput_timer))
+      alarm_set_on_queue(btm_cb.devcb.acl_tput_timer, BTM_ACL_TPUT_SAMPLE_MS,
+                         btm_acl_tput_timer_timeout, NULL,
+                         btu_general_alarm_queue);
+  } else {
+    p->high_tput = false;
+    p->tput_fallback = false;
+    btm_set_packet_types(p, p->tput_saved_pkt_types);
+  }
+  return BTM_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_tput_congested
+ *
+ * Description      Returns true if a channel of the link has more data than
+ *                  it can queue.
+ *
+ ******************************************************************************/
+static bool btm_acl_tput_congested(tL2C_LCB* p_lcb) {
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb != NULL;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (p_ccb->cong_sent) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_acl_tput_timer_timeout
+ *
+ * Description      Samples the completed packets of the high throughput
+ *                  links, and moves them between the 5 slot packets and the
+ *                  2-DH3 fallback.
+ *
+ ******************************************************************************/
+static void btm_acl_tput_timer_timeout(UNUSED_ATTR void* data) {
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  bool active = false;
+
+  tACL_CONN* p = &btm_cb.acl_db[0];
+  for (uint8_t xx = 0; xx < MAX_L2CAP_LINKS; xx++, p++) {
+    if (!p->in_use || !p->high_tput) continue;
+    active = true;
+
+    tL2C_LCB* p_lcb = l2cu_find_lcb_by_handle(p->hci_handle);
+    if (p_lcb == NULL) continue;
+
+    uint32_t sent = p_lcb->acl_sent_pkts - p->tput_sent_pkts;
+    uint64_t bytes = p_lcb->acl_sent_bytes - p->tput_sent_bytes;
+    uint32_t completed = p_lcb->acl_completed_pkts - p->tput_completed_pkts;
+    uint32_t blocked = p_lcb->acl_blocked_pkts - p->tput_blocked_pkts;
+    p->tput_sent_pkts = p_lcb->acl_sent_pkts;
+    p->tput_sent_bytes = p_lcb->acl_sent_bytes;
+    p->tput_completed_pkts = p_lcb->acl_completed_pkts;
+    p->tput_blocked_pkts = p_lcb->acl_blocked_pkts;
+
+    /* the controller does not tell which packets completed, they are taken
+     * to be of the average size sent */
+    p->tput_goodput_kbps =
+        (sent == 0) ? 0 : (uint32_t)(bytes * completed / sent * 8 /
+                                     BTM_ACL_TPUT_SAMPLE_MS);
+    p->tput_blocked_pct =
+        (completed == 0) ? 0 : (uint8_t)(blocked * 100 / completed);
+
+    if (p->tput_fallback) {
+      if (now_ms < p->tput_retry_ms) continue;
+
+      BTM_TRACE_EVENT("%s: handle 0x%04x retrying the 5 slot packets",
+                      __func__, p->hci_handle);
+      p->tput_fallback = false;
+      p->tput_bad_samples = 0;
+      btm_set_packet_types(p, btm_acl_tput_pkt_types(p));
+      continue;
+    }
+
+    if (completed == 0 || p->tput_blocked_pct < BTM_ACL_TPUT_BLOCKED_PCT ||
+        !btm_acl_tput_congested(p_lcb)) {
+      p->tput_bad_samples = 0;
+      continue;
+    }
+    if (++p->tput_bad_samples < BTM_ACL_TPUT_BAD_SAMPLES) continue;
+
+    BTM_TRACE_WARNING(
+        "%s: handle 0x%04x falling back to 2-DH3 for %u ms, goodput %u kbps, "
+        "%u%% blocked",
+        __func__, p->hci_handle, (uint32_t)p->tput_hold_off_ms,
+        p->tput_goodput_kbps, p->tput_blocked_pct);
+    p->tput_fallback = true;
+    p->tput_num_fallbacks++;
+    p->tput_retry_ms = now_ms + p->tput_hold_off_ms;
+    p->tput_hold_off_ms *= 2;
+    if (p->tput_hold_off_ms > BTM_ACL_TPUT_MAX_HOLD_OFF_MS)
+      p->tput_hold_off_ms = BTM_ACL_TPUT_MAX_HOLD_OFF_MS;
+    btm_set_packet_types(p, btm_acl_tput_pkt_types(p));
+  }
+
+  if (!active) alarm_cancel(btm_cb.devcb.acl_tput_timer);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadAclThroughput
+ *
+ * Description      This function reads the throughput the BR/EDR link
+ *                  carried over the last second.
+ *
+ * Returns          true if found, false otherwise
+ *
+ ******************************************************************************/
+bool BTM_ReadAclThroughput(const BD_ADDR remote_bda,
+                           tBTM_ACL_THROUGHPUT* p_tput) {
+  tACL_CONN* p = btm_bda_to_acl(remote_bda, BT_TRANSPORT_BR_EDR);
+  if (p == NULL) return false;
+
+  p_tput->high_throughput = p->high_tput;
+  p_tput->fallback = p->tput_fallback;
+  p_tput->num_fallbacks = p->tput_num_fallbacks;
+  p_tput->pkt_types_mask = p->pkt_types_mask;
+  p_tput->goodput_kbps = p->tput_goodput_kbps;
+  p_tput->blocked_pct = p->tput_blocked_pct;
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         BTM_ReadTxPower
@@ -2151,6 +2394,73 @@ void btm_read_link_quality_complete(uint8_t* p) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_read_failed_contact_counter_timeout
+ *
+ * Description      Callback when reading the failed contact counter times
+ *                  out.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_read_failed_contact_counter_timeout(UNUSED_ATTR void* data) {
+  tBTM_CMPL_CB* p_cb = btm_cb.devcb.p_failed_contact_cmpl_cb;
+  btm_cb.devcb.p_failed_contact_cmpl_cb = NULL;
+  if (p_cb) (*p_cb)((void*)NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_read_failed_contact_counter_complete
+ *
+ * Description      This function is called when the command complete message
+ *                  is received from the HCI for the read failed contact
+ *                  counter.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_read_failed_contact_counter_complete(uint8_t* p) {
+  tBTM_CMPL_CB* p_cb = btm_cb.devcb.p_failed_contact_cmpl_cb;
+  tBTM_FAILED_CONTACT_COUNTER_RESULTS results;
+  uint16_t handle;
+  tACL_CONN* p_acl_cb = &btm_cb.acl_db[0];
+  uint16_t index;
+
+  BTM_TRACE_DEBUG("%s", __func__);
+  alarm_cancel(btm_cb.devcb.read_failed_contact_counter_timer);
+  btm_cb.devcb.p_failed_contact_cmpl_cb = NULL;
+
+  /* If there was a registered callback, call it */
+  if (p_cb) {
+    memset(&results, 0, sizeof(results));
+    STREAM_TO_UINT8(results.hci_status, p);
+
+    if (results.hci_status == HCI_SUCCESS) {
+      results.status = BTM_SUCCESS;
+
+      STREAM_TO_UINT16(handle, p);
+
+      STREAM_TO_UINT16(results.failed_contact_counter, p);
+      BTM_TRACE_DEBUG("%s: failed contact counter %d, hci status 0x%02x",
+                      __func__, results.failed_contact_counter,
+                      results.hci_status);
+
+      /* Search through the list of active channels for the correct BD Addr */
+      for (index = 0; index < MAX_L2CAP_LINKS; index++, p_acl_cb++) {
+        if ((p_acl_cb->in_use) && (handle == p_acl_cb->hci_handle)) {
+          memcpy(results.rem_bda, p_acl_cb->remote_addr, BD_ADDR_LEN);
+          break;
+        }
+      }
+    } else
+      results.status = BTM_ERR_PROCESSING;
+
+    (*p_cb)(&results);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         btm_remove_acl
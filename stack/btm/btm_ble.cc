@@ -824,6 +824,46 @@ tBTM_STATUS BTM_SetBleDataLength(BD_ADDR bd_addr, uint16_t tx_pdu_length) {
   return BTM_SUCCESS;
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleSetPhy
+ *
+ * Description      This function is to set the preferred PHYs of an LE link.
+ *                  The PHY update complete event follows if the PHYs change.
+ *
+ * Returns          BTM_SUCCESS if success; otherwise failed.
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_BleSetPhy(BD_ADDR bd_addr, uint8_t tx_phys, uint8_t rx_phys,
+                          uint16_t phy_options) {
+  tACL_CONN* p_acl = btm_bda_to_acl(bd_addr, BT_TRANSPORT_LE);
+
+  if (p_acl == NULL) {
+    BTM_TRACE_ERROR("%s: Wrong mode: no LE link exist or LE not supported",
+                    __func__);
+    return BTM_WRONG_MODE;
+  }
+
+  BTM_TRACE_DEBUG("%s: tx_phys 0x%x rx_phys 0x%x", __func__, tx_phys, rx_phys);
+
+  if (((tx_phys | rx_phys) & PHY_LE_2M) &&
+      (!controller_get_interface()->supports_ble_2m_phy() ||
+       !HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features))) {
+    BTM_TRACE_ERROR("%s failed, 2M PHY not supported", __func__);
+    return BTM_ILLEGAL_VALUE;
+  }
+
+  /* no preference for the directions given no PHY */
+  uint8_t all_phys = 0;
+  if (tx_phys == 0) all_phys |= 0x01;
+  if (rx_phys == 0) all_phys |= 0x02;
+
+  btsnd_hcic_ble_set_phy(p_acl->hci_handle, all_phys, tx_phys, rx_phys,
+                         phy_options);
+
+  return BTM_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_determine_security_act
@@ -1159,6 +1199,7 @@ void btm_sec_save_le_key(BD_ADDR bd_addr, tBTM_LE_KEY_TYPE key_type,
         memcpy(p_rec->bd_addr, p_keys->pid_key.static_addr, BD_ADDR_LEN);
         /* combine DUMO device security record if needed */
         btm_consolidate_dev(p_rec);
+        btm_ble_rpa_resolver_invalidate();
         break;
 
       case BTM_LE_KEY_PCSRK:
@@ -1746,6 +1787,7 @@ void btm_ble_connected(uint8_t* bda, uint16_t handle, uint8_t enc_mode,
 
   p_cb->inq_var.directed_conn = BTM_BLE_CONNECT_EVT;
 
+  btm_ble_update_bg_conn_link(bda, true);
   return;
 }
 
@@ -1788,6 +1830,10 @@ void btm_ble_conn_complete(uint8_t* p, UNUSED_ATTR uint16_t evt_len,
     peer_addr_type = bda_type;
     match = btm_identity_addr_to_random_pseudo(bda, &bda_type, true);
 
+    /* an identity address reported by the controller, that resolved it */
+    if (match && (peer_addr_type & BLE_ADDR_TYPE_ID_BIT))
+      btm_ble_resolving_list_note_resolution(btm_find_dev(bda), true);
+
     /* possiblly receive connection complete with resolvable random while
        the device has been paired */
     if (!match && BTM_BLE_IS_RESOLVE_BDA(bda)) {
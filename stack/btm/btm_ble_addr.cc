@@ -32,11 +32,23 @@
 #include "gap_api.h"
 #include "hcimsgs.h"
 
+#include "ble_rpa_resolver.h"
 #include "btm_ble_int.h"
+#include "osi/include/time.h"
 #include "smp_api.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
+namespace {
+
+/* the private addresses are resolved in the host, against the IRKs of the
+ * security records, loaded lazily */
+BleRpaResolver rpa_resolver(BTM_BLE_RPA_CACHE_SIZE,
+                            BTM_BLE_RPA_CACHE_TIMEOUT_MS);
+bool rpa_resolver_loaded = false;
+
+}  // namespace
+
 /*******************************************************************************
  *
  * Function         btm_gen_resolve_paddr_cmpl
@@ -66,9 +78,10 @@ static void btm_gen_resolve_paddr_cmpl(tSMP_ENC* p) {
 #if (BTM_BLE_CONFORMANCE_TESTING == TRUE)
     interval_ms = btm_cb.ble_ctr_cb.rpa_tout * 1000;
 #endif
-    alarm_set_on_queue(p_cb->refresh_raddr_timer, interval_ms,
-                       btm_ble_refresh_raddr_timer_timeout, NULL,
-                       btu_general_alarm_queue);
+    alarm_set_on_queue_with_slack(p_cb->refresh_raddr_timer, interval_ms,
+                                  BTM_BLE_PRIVATE_ADDR_SLACK_MS,
+                                  btm_ble_refresh_raddr_timer_timeout, NULL,
+                                  btu_general_alarm_queue);
   } else {
     /* random address set failure */
     BTM_TRACE_DEBUG("set random address failed");
@@ -172,34 +185,6 @@ void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
 /*******************************************************************************
  *  Utility functions for Random address resolving
  ******************************************************************************/
-/*******************************************************************************
- *
- * Function         btm_ble_proc_resolve_x
- *
- * Description      This function compares the X with random address 3 MSO bytes
- *                  to find a match.
- *
- * Returns          true on match, false otherwise
- *
- ******************************************************************************/
-static bool btm_ble_proc_resolve_x(const tSMP_ENC& encrypt_output,
-                                   const bt_bdaddr_t& random_bda) {
-  BTM_TRACE_EVENT("btm_ble_proc_resolve_x");
-
-  /* compare the hash with 3 LSB of bd address */
-  uint8_t comp[3];
-  comp[0] = random_bda.address[5];
-  comp[1] = random_bda.address[4];
-  comp[2] = random_bda.address[3];
-
-  if (!memcmp(encrypt_output.param_buf, comp, 3)) {
-    BTM_TRACE_EVENT("match is found");
-    return true;
-  }
-
-  return false;
-}
-
 /*******************************************************************************
  *
  * Function         btm_ble_init_pseudo_addr
@@ -264,43 +249,70 @@ bool btm_ble_addr_resolvable(BD_ADDR rpa, tBTM_SEC_DEV_REC* p_dev_rec) {
 
 /*******************************************************************************
  *
- * Function         btm_ble_match_random_bda
+ * Function         btm_ble_load_irks
  *
- * Description      This function match the random address to the appointed
- *                  device record, starting from calculating IRK. If the record
- *                  index exceeds the maximum record number, matching failed and
- *                  send a callback.
+ * Description      This function loads the IRKs of the security records in the
+ *                  RPA resolver, if they changed since they were loaded.
  *
- * Returns          None.
+ * Returns          void
  *
  ******************************************************************************/
-static bool btm_ble_match_random_bda(void* data, void* context) {
-  bt_bdaddr_t random_bda;
-  bdcpy(random_bda.address, (uint8_t *)context);
-
-  /* use the 3 MSB of bd address as prand */
-
-  uint8_t rand[3];
-  rand[0] = random_bda.address[2];
-  rand[1] = random_bda.address[1];
-  rand[2] = random_bda.address[0];
+static void btm_ble_load_irks(void) {
+  if (rpa_resolver_loaded) return;
 
-  BTM_TRACE_EVENT("%s next iteration", __func__);
-
-  tSMP_ENC output;
-  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(data);
+  rpa_resolver.Clear();
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+        (p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
+      rpa_resolver.AddIrk(p_dev_rec->ble.keys.irk);
+  }
+  rpa_resolver_loaded = true;
 
-  BTM_TRACE_DEBUG("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags,
-                  p_dev_rec->device_type);
+  BTM_TRACE_DEBUG("%s %zu IRKs", __func__, rpa_resolver.NumIrks());
+}
 
-  if (!(p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) ||
-      !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-    return true;
+/*******************************************************************************
+ *
+ * Function         btm_ble_find_dev_by_irk
+ *
+ * Description      This function finds the security record holding the IRK
+ *                  |irk|.
+ *
+ * Returns          pointer to the record, or NULL if none holds it.
+ *
+ ******************************************************************************/
+static tBTM_SEC_DEV_REC* btm_ble_find_dev_by_irk(const BT_OCTET16 irk) {
+  list_node_t* end = list_end(btm_cb.sec_dev_rec);
+  for (list_node_t* node = list_begin(btm_cb.sec_dev_rec); node != end;
+       node = list_next(node)) {
+    tBTM_SEC_DEV_REC* p_dev_rec =
+        static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+    if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+        (p_dev_rec->ble.key_type & BTM_LE_KEY_PID) &&
+        memcmp(p_dev_rec->ble.keys.irk, irk, BT_OCTET16_LEN) == 0)
+      return p_dev_rec;
+  }
+  return NULL;
+}
 
-  /* generate X = E irk(R0, R1, R2) and R is random address 3 LSO */
-  SMP_Encrypt(p_dev_rec->ble.keys.irk, BT_OCTET16_LEN, &rand[0], 3, &output);
-  // if it was match, finish iteration, otherwise continue
-  return !btm_ble_proc_resolve_x(output, random_bda);
+/*******************************************************************************
+ *
+ * Function         btm_ble_rpa_resolver_invalidate
+ *
+ * Description      This function is called when an IRK is added to, or a
+ *                  record is removed from the security records, so that the
+ *                  IRKs are loaded again in the RPA resolver.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_rpa_resolver_invalidate(void) {
+  rpa_resolver_loaded = false;
+  rpa_resolver.Clear();
 }
 
 /*******************************************************************************
@@ -316,16 +328,25 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(BD_ADDR random_bda) {
   BTM_TRACE_EVENT("%s", __func__);
 
-  /* start to resolve random address */
-  /* check for next security record */
-
-  list_node_t* n =
-      list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda, random_bda);
   tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
-  if (n != nullptr) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  uint64_t now_ms = time_get_os_boottime_ms();
+  BT_OCTET16 irk;
+
+  /* the records may have changed in a way the IRKs loaded missed: they are
+   * loaded again if the IRK resolving the address is gone */
+  for (int attempt = 0; attempt < 2 && p_dev_rec == nullptr; attempt++) {
+    btm_ble_load_irks();
+    if (!rpa_resolver.Resolve(random_bda, now_ms, irk)) break;
+
+    p_dev_rec = btm_ble_find_dev_by_irk(irk);
+    if (p_dev_rec == nullptr) btm_ble_rpa_resolver_invalidate();
+  }
 
   BTM_TRACE_EVENT("%s:  %sresolved", __func__,
                   (p_dev_rec == nullptr ? "not " : ""));
+#if (BLE_PRIVACY_SPT == TRUE)
+  btm_ble_resolving_list_note_resolution(p_dev_rec, false);
+#endif
   return p_dev_rec;
 }
 
@@ -25,6 +25,7 @@
 
 #include "bt_target.h"
 
+#include "ble_scan_filter.h"
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
@@ -54,6 +55,10 @@ tBTM_BLE_ADV_FILTER_CB btm_ble_adv_filt_cb;
 tBTM_BLE_VSC_CB cmn_ble_vsc_cb;
 static const BD_ADDR na_bda = {0};
 
+/* The filter applied in the host to the advertising reports, when the
+ * controller does not offload it */
+static BleScanFilter host_scan_filter;
+
 static uint8_t btm_ble_cs_update_pf_counter(tBTM_BLE_SCAN_COND_OP action,
                                             uint8_t cond_type,
                                             tBLE_BD_ADDR* p_bd_addr,
@@ -100,6 +105,26 @@ tBTM_STATUS btm_ble_obtain_vsc_details() {
   return st;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_adv_filter_in_host
+ *
+ * Description      Checks whether the adv payload filter is applied in the host
+ *                  rather than offloaded to the controller, as it does not
+ *                  support the vendor specific APCF commands
+ *
+ * Returns          true if the filter is applied in the host
+ *
+ ******************************************************************************/
+static bool btm_ble_adv_filter_in_host() {
+#if (BLE_VND_INCLUDED == TRUE)
+  BTM_BleGetVendorCapabilities(&cmn_ble_vsc_cb);
+  return !cmn_ble_vsc_cb.filter_support || cmn_ble_vsc_cb.max_filter == 0;
+#else
+  return true;
+#endif
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_condtype_to_ocf
@@ -318,6 +343,21 @@ bool btm_ble_dealloc_addr_filter_counter(tBLE_BD_ADDR* p_bd_addr,
 void BTM_LE_PF_local_name(tBTM_BLE_SCAN_COND_OP action,
                           tBTM_BLE_PF_FILT_INDEX filt_index,
                           std::vector<uint8_t> name, tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    if (name.size() > BTM_BLE_PF_STR_LEN_MAX)
+      name.resize(BTM_BLE_PF_STR_LEN_MAX);
+
+    if (action == BTM_BLE_SCAN_COND_ADD)
+      host_scan_filter.AddLocalName(filt_index, std::move(name));
+    else if (action == BTM_BLE_SCAN_COND_DELETE)
+      host_scan_filter.RemoveLocalName(filt_index, name);
+    else
+      host_scan_filter.ClearConditions(filt_index, BTM_BLE_PF_LOCAL_NAME);
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   uint8_t len = BTM_BLE_ADV_FILT_META_HDR_LENGTH;
 
   uint8_t len_max = len + BTM_BLE_PF_STR_LEN_MAX;
@@ -348,6 +388,9 @@ void BTM_LE_PF_local_name(tBTM_BLE_SCAN_COND_OP action,
  */
 void BTM_LE_PF_srvc_data(tBTM_BLE_SCAN_COND_OP action,
                          tBTM_BLE_PF_FILT_INDEX filt_index) {
+  /* the host filter has no condition to keep for the service data */
+  if (btm_ble_adv_filter_in_host()) return;
+
   uint8_t num_avail = (action == BTM_BLE_SCAN_COND_ADD) ? 0 : 1;
 
   btm_ble_cs_update_pf_counter(action, BTM_BLE_PF_SRVC_DATA, nullptr,
@@ -363,6 +406,26 @@ void BTM_LE_PF_manu_data(tBTM_BLE_SCAN_COND_OP action,
                          uint16_t company_id_mask, std::vector<uint8_t> data,
                          std::vector<uint8_t> data_mask,
                          tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    /* as for the controller, the data is only compared with a mask */
+    size_t size = std::min(data.size(), (size_t)(BTM_BLE_PF_STR_LEN_MAX - 2));
+    if (data_mask.empty()) size = 0;
+    data.resize(size);
+    data_mask.resize(size);
+
+    if (action == BTM_BLE_SCAN_COND_ADD)
+      host_scan_filter.AddManufacturerData(
+          filt_index, company_id, company_id_mask ? company_id_mask : 0xFFFF,
+          std::move(data), std::move(data_mask));
+    else if (action == BTM_BLE_SCAN_COND_DELETE)
+      host_scan_filter.RemoveManufacturerData(filt_index, company_id, data);
+    else
+      host_scan_filter.ClearConditions(filt_index, BTM_BLE_PF_MANU_DATA);
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   uint8_t len = BTM_BLE_ADV_FILT_META_HDR_LENGTH;
   int len_max = len + BTM_BLE_PF_STR_LEN_MAX + BTM_BLE_PF_STR_LEN_MAX;
 
@@ -415,6 +478,24 @@ void BTM_LE_PF_srvc_data_pattern(tBTM_BLE_SCAN_COND_OP action,
                                  std::vector<uint8_t> data,
                                  std::vector<uint8_t> data_mask,
                                  tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    size_t size = std::min(data.size(), (size_t)(BTM_BLE_PF_STR_LEN_MAX - 2));
+    data.resize(size);
+    data_mask.resize(size);
+
+    if (action == BTM_BLE_SCAN_COND_ADD)
+      host_scan_filter.AddServiceData(filt_index, std::move(data),
+                                      std::move(data_mask));
+    else if (action == BTM_BLE_SCAN_COND_DELETE)
+      host_scan_filter.RemoveServiceData(filt_index, data);
+    else
+      host_scan_filter.ClearConditions(filt_index,
+                                       BTM_BLE_PF_SRVC_DATA_PATTERN);
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   uint8_t len = BTM_BLE_ADV_FILT_META_HDR_LENGTH;
   int len_max = len + BTM_BLE_PF_STR_LEN_MAX + BTM_BLE_PF_STR_LEN_MAX;
 
@@ -513,6 +594,18 @@ uint8_t btm_ble_cs_update_pf_counter(tBTM_BLE_SCAN_COND_OP action,
 void BTM_LE_PF_addr_filter(tBTM_BLE_SCAN_COND_OP action,
                            tBTM_BLE_PF_FILT_INDEX filt_index, tBLE_BD_ADDR addr,
                            tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    if (action == BTM_BLE_SCAN_COND_ADD)
+      host_scan_filter.AddAddress(filt_index, addr.bda);
+    else if (action == BTM_BLE_SCAN_COND_DELETE)
+      host_scan_filter.RemoveAddress(filt_index, addr.bda);
+    else
+      host_scan_filter.ClearConditions(filt_index, BTM_BLE_PF_ADDR_FILTER);
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   const uint8_t len = BTM_BLE_ADV_FILT_META_HDR_LENGTH + BTM_BLE_META_ADDR_LEN;
 
   uint8_t param[len];
@@ -545,6 +638,36 @@ void BTM_LE_PF_uuid_filter(tBTM_BLE_SCAN_COND_OP action,
                            tBTM_BLE_PF_LOGIC_TYPE cond_logic,
                            tBTM_BLE_PF_COND_MASK* p_uuid_mask,
                            tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    if (action == BTM_BLE_SCAN_COND_CLEAR) {
+      host_scan_filter.ClearConditions(filt_index, filter_type);
+    } else if (uuid.len != LEN_UUID_16 && uuid.len != LEN_UUID_32 &&
+               uuid.len != LEN_UUID_128) {
+      BTM_TRACE_ERROR("illegal UUID length: %d", uuid.len);
+      cb.Run(0, BTM_BLE_PF_CONFIG, 1 /*BTA_FAILURE*/);
+      return;
+    } else if (action == BTM_BLE_SCAN_COND_ADD) {
+      uint8_t mask[LEN_UUID_128];
+      uint8_t* p = mask;
+      if (p_uuid_mask) {
+        if (uuid.len == LEN_UUID_16) {
+          UINT16_TO_STREAM(p, p_uuid_mask->uuid16_mask);
+        } else if (uuid.len == LEN_UUID_32) {
+          UINT32_TO_STREAM(p, p_uuid_mask->uuid32_mask);
+        } else {
+          ARRAY_TO_STREAM(p, p_uuid_mask->uuid128_mask, LEN_UUID_128);
+        }
+      }
+      host_scan_filter.AddUuid(filt_index, filter_type, uuid,
+                               p_uuid_mask ? mask : NULL);
+    } else {
+      host_scan_filter.RemoveUuid(filt_index, filter_type, uuid);
+    }
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   uint8_t evt_type;
 
   if (BTM_BLE_PF_SRVC_UUID == filter_type) {
@@ -607,6 +730,12 @@ void BTM_LE_PF_uuid_filter(tBTM_BLE_SCAN_COND_OP action,
  */
 void BTM_LE_PF_clear(tBTM_BLE_PF_FILT_INDEX filt_index,
                      tBTM_BLE_PF_CFG_CBACK cb) {
+  if (btm_ble_adv_filter_in_host()) {
+    host_scan_filter.Remove(filt_index);
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, BTM_BLE_SCAN_COND_CLEAR, HCI_SUCCESS);
+    return;
+  }
+
   /* clear the general filter entry */
   {
     tBTM_BLE_PF_CFG_CBACK fDoNothing;
@@ -677,6 +806,21 @@ void BTM_BleAdvFilterParamSetup(
                 BTM_BLE_ADV_FILT_FEAT_SELN_LEN + BTM_BLE_ADV_FILT_TRACK_NUM;
   uint8_t param[len], *p;
 
+  if (btm_ble_adv_filter_in_host()) {
+    if (BTM_BLE_SCAN_COND_ADD == action)
+      host_scan_filter.SetParams(filt_index, p_filt_params->feat_seln,
+                                 p_filt_params->list_logic_type,
+                                 p_filt_params->filt_logic_type,
+                                 (int8_t)p_filt_params->rssi_high_thres);
+    else if (BTM_BLE_SCAN_COND_DELETE == action)
+      host_scan_filter.RemoveParams(filt_index);
+    else if (BTM_BLE_SCAN_COND_CLEAR == action)
+      host_scan_filter.RemoveAll();
+
+    cb.Run(BTM_BLE_MAX_FILTER_COUNTER, action, HCI_SUCCESS);
+    return;
+  }
+
   if (BTM_SUCCESS != btm_ble_obtain_vsc_details()) {
     cb.Run(0, BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -795,6 +939,12 @@ void enable_cmpl_cback(tBTM_BLE_PF_STATUS_CBACK p_stat_cback, uint8_t* p,
  ******************************************************************************/
 void BTM_BleEnableDisableFilterFeature(uint8_t enable,
                                        tBTM_BLE_PF_STATUS_CBACK p_stat_cback) {
+  if (btm_ble_adv_filter_in_host()) {
+    host_scan_filter.Enable(enable);
+    if (p_stat_cback) p_stat_cback.Run(enable, BTM_SUCCESS);
+    return;
+  }
+
   if (BTM_SUCCESS != btm_ble_obtain_vsc_details()) {
     if (p_stat_cback) p_stat_cback.Run(BTM_BLE_PF_ENABLE, 1 /* BTA_FAILURE */);
     return;
@@ -825,6 +975,9 @@ void BTM_BleEnableDisableFilterFeature(uint8_t enable,
  ******************************************************************************/
 void btm_ble_adv_filter_init(void) {
   memset(&btm_ble_adv_filt_cb, 0, sizeof(tBTM_BLE_ADV_FILTER_CB));
+  host_scan_filter.Enable(false);
+  host_scan_filter.RemoveAll();
+
   if (BTM_SUCCESS != btm_ble_obtain_vsc_details()) return;
 
   if (cmn_ble_vsc_cb.max_filter > 0) {
@@ -847,3 +1000,23 @@ void btm_ble_adv_filter_init(void) {
 void btm_ble_adv_filter_cleanup(void) {
   osi_free_and_reset((void**)&btm_ble_adv_filt_cb.p_addr_filter_count);
 }
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_adv_filter_matches
+ *
+ * Description      This function checks an advertising report against the adv
+ *                  payload filter applied in the host. The reports always
+ *                  match when the filter is offloaded to the controller.
+ *
+ * Parameters       bda - address of the advertiser
+ *                  rssi - RSSI of the report
+ *                  data, len - advertising data of the report
+ *
+ * Returns          true if the report is to be delivered
+ *
+ ******************************************************************************/
+bool btm_ble_adv_filter_matches(const BD_ADDR bda, int8_t rssi,
+                                const uint8_t* data, size_t len) {
+  return host_scan_filter.Matches(bda, rssi, data, len);
+}
@@ -19,6 +19,8 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <deque>
 #include <vector>
 #include "bt_target.h"
 
@@ -29,6 +31,7 @@
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
+#include "osi/include/time.h"
 
 using base::Bind;
 using base::Callback;
@@ -44,8 +47,148 @@ tBTM_BLE_ADV_TRACK_CB ble_advtrack_cb;
 #define BTM_BLE_BATCH_SCAN_ENB_DISB_LEN 2
 #define BTM_BLE_BATCH_SCAN_READ_RESULTS_LEN 2
 
+/* layout of the batch scan records: the address, address type, TX power,
+ * RSSI and timestamp, followed in the full records by the advertising data
+ * and the scan response, each after their length */
+#define BTM_BLE_BATCH_SCAN_RECORD_LEN 11
+#define BTM_BLE_BATCH_SCAN_TIMESTAMP_OFFSET 9
+/* the timestamps count in units of 50 ms */
+#define BTM_BLE_BATCH_SCAN_TIMESTAMP_UNIT_MS 50
+
 namespace {
 
+/* The reports of one read from the controller */
+struct BatchScanChunk {
+  std::vector<uint8_t> data;
+  uint8_t num_records;
+  uint64_t read_ms;
+};
+
+/* The reports read from the controller and not yet delivered, per report
+ * format: the truncated ones for the passive mode, the full ones for the
+ * active mode */
+struct BatchScanBuffer {
+  std::deque<BatchScanChunk> chunks;
+  size_t size = 0;
+};
+
+BatchScanBuffer batchscan_buffers[BTM_BLE_BATCH_SCAN_MODE_ACTI];
+tBTM_BLE_BATCH_SCAN_STATS batchscan_stats;
+
+BatchScanBuffer* batchscan_buffer(uint8_t report_format) {
+  if (report_format != BTM_BLE_BATCH_SCAN_MODE_PASS &&
+      report_format != BTM_BLE_BATCH_SCAN_MODE_ACTI)
+    return NULL;
+  return &batchscan_buffers[report_format - 1];
+}
+
+/* Returns the length of the batch scan record at |p|, of |len| octets at most,
+ * or 0 if it does not fit */
+size_t batchscan_record_len(uint8_t report_format, const uint8_t* p,
+                            size_t len) {
+  size_t record_len = BTM_BLE_BATCH_SCAN_RECORD_LEN;
+  if (report_format == BTM_BLE_BATCH_SCAN_MODE_ACTI) {
+    /* advertising data, then scan response */
+    for (int i = 0; i < 2; i++) {
+      if (record_len >= len) return 0;
+      record_len += 1 + p[record_len];
+    }
+  }
+  return record_len <= len ? record_len : 0;
+}
+
+/* Keeps the |num_records| reports of |data|, read from the controller, until
+ * the client reads them, dropping the oldest ones if there is no room left */
+void batchscan_buffer_add(uint8_t report_format, const uint8_t* data,
+                          size_t len, uint8_t num_records) {
+  batchscan_stats.reports_read += num_records;
+
+  BatchScanBuffer* buffer = batchscan_buffer(report_format);
+  if (buffer == NULL || len > BTM_BLE_BATCH_SCAN_HOST_BUFFER_SIZE) {
+    BTM_TRACE_ERROR("%s: dropping %d reports of format %d", __func__,
+                    num_records, report_format);
+    batchscan_stats.reports_dropped += num_records;
+    return;
+  }
+
+  while (buffer->size + len > BTM_BLE_BATCH_SCAN_HOST_BUFFER_SIZE) {
+    BatchScanChunk& oldest = buffer->chunks.front();
+    BTM_TRACE_WARNING("%s: buffer full, dropping %d reports", __func__,
+                      oldest.num_records);
+    batchscan_stats.reports_dropped += oldest.num_records;
+    buffer->size -= oldest.data.size();
+    buffer->chunks.pop_front();
+  }
+
+  BatchScanChunk chunk;
+  chunk.data.assign(data, data + len);
+  chunk.num_records = num_records;
+  chunk.read_ms = time_get_os_boottime_ms();
+  buffer->size += len;
+  buffer->chunks.push_back(std::move(chunk));
+}
+
+/* The timestamps of the records tell how long ago they were received, when
+ * read: they are aged by the time the records spent in the buffer */
+void batchscan_age_records(uint8_t report_format, std::vector<uint8_t>* data,
+                           uint64_t age_ms) {
+  uint32_t age = age_ms / BTM_BLE_BATCH_SCAN_TIMESTAMP_UNIT_MS;
+  if (age == 0) return;
+
+  uint8_t* p = data->data();
+  size_t len = data->size();
+  while (len > 0) {
+    size_t record_len = batchscan_record_len(report_format, p, len);
+    if (record_len == 0) {
+      BTM_TRACE_ERROR("%s: bad record", __func__);
+      return;
+    }
+
+    uint8_t* pp = p + BTM_BLE_BATCH_SCAN_TIMESTAMP_OFFSET;
+    uint16_t timestamp = pp[0] | (pp[1] << 8);
+    timestamp = std::min(timestamp + age, (uint32_t)0xFFFF);
+    UINT16_TO_STREAM(pp, timestamp);
+
+    p += record_len;
+    len -= record_len;
+  }
+}
+
+/* Delivers the reports of |report_format| kept in the buffer to |cb|, in as
+ * many calls as needed to carry their number */
+void batchscan_buffer_deliver(uint8_t status, uint8_t report_format,
+                              tBTM_BLE_SCAN_REP_CBACK cb) {
+  BatchScanBuffer* buffer = batchscan_buffer(report_format);
+  if (buffer == NULL || buffer->chunks.empty()) {
+    cb.Run(status, report_format, 0, {});
+    return;
+  }
+
+  uint64_t now_ms = time_get_os_boottime_ms();
+  std::vector<uint8_t> data;
+  uint8_t num_records = 0;
+  for (BatchScanChunk& chunk : buffer->chunks) {
+    if (num_records + chunk.num_records > UINT8_MAX) {
+      cb.Run(BTM_SUCCESS, report_format, num_records, std::move(data));
+      data.clear();
+      num_records = 0;
+    }
+
+    batchscan_age_records(report_format, &chunk.data, now_ms - chunk.read_ms);
+    data.insert(data.end(), chunk.data.begin(), chunk.data.end());
+    num_records += chunk.num_records;
+    batchscan_stats.reports_delivered += chunk.num_records;
+  }
+  buffer->chunks.clear();
+  buffer->size = 0;
+
+  /* the reports already read are delivered even if the last read failed */
+  cb.Run(BTM_SUCCESS, report_format, num_records, std::move(data));
+}
+
+void btm_ble_drain_batchscan_reports(uint8_t scan_modes,
+                                     Callback<void(uint8_t /* status */)> cb);
+
 bool can_do_batch_scan() {
   if (!controller_get_interface()->supports_ble()) return false;
 
@@ -57,6 +200,11 @@ bool can_do_batch_scan() {
   return true;
 }
 
+void threshold_drained_cb(uint8_t status) {
+  if (ble_batchscan_cb.p_thres_cback)
+    ble_batchscan_cb.p_thres_cback(ble_batchscan_cb.ref_value);
+}
+
 /* VSE callback for batch scan, filter, and tracking events */
 void btm_ble_batchscan_filter_track_adv_vse_cback(uint8_t len, uint8_t* p) {
   tBTM_BLE_TRACK_ADV_DATA adv_data;
@@ -70,7 +218,10 @@ void btm_ble_batchscan_filter_track_adv_vse_cback(uint8_t len, uint8_t* p) {
       sub_event);
   if (HCI_VSE_SUBCODE_BLE_THRESHOLD_SUB_EVT == sub_event &&
       NULL != ble_batchscan_cb.p_thres_cback) {
-    ble_batchscan_cb.p_thres_cback(ble_batchscan_cb.ref_value);
+    /* drain the controller right away, so that it does not run out of room
+     * before the client reads the reports */
+    btm_ble_drain_batchscan_reports(ble_batchscan_cb.scan_mode,
+                                    Bind(&threshold_drained_cb));
     return;
   }
 
@@ -243,12 +394,14 @@ void btm_ble_read_batchscan_reports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
   btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_BATCH_SCAN_OCF, param, len, cb);
 }
 
-/* read reports. data is accumulated in |data_all|, number of records is
- * accumulated in |num_records_all| */
-void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
-                     tBTM_BLE_SCAN_REP_CBACK cb, uint8_t* p, uint16_t len) {
+/* read reports of |scan_mode| into the buffer, then drain the reports of
+ * |scan_modes| */
+void drain_reports_cb(uint8_t scan_mode, uint8_t scan_modes,
+                      Callback<void(uint8_t /* status */)> cb, uint8_t* p,
+                      uint16_t len) {
   if (len < 2) {
     BTM_TRACE_ERROR("%s: wrong length", __func__);
+    cb.Run(BTM_ERR_PROCESSING);
     return;
   }
 
@@ -260,30 +413,56 @@ void read_reports_cb(std::vector<uint8_t> data_all, uint8_t num_records_all,
   if (subcode != expected_opcode) {
     BTM_TRACE_ERROR("%s: bad subcode, expected: %d got: %d", __func__,
                     expected_opcode, subcode);
+    cb.Run(BTM_ERR_PROCESSING);
     return;
   }
 
-  uint8_t report_format, num_records;
-  STREAM_TO_UINT8(report_format, p);
-  STREAM_TO_UINT8(num_records, p);
+  uint8_t report_format = 0, num_records = 0;
+  if (len >= 4) {
+    STREAM_TO_UINT8(report_format, p);
+    STREAM_TO_UINT8(num_records, p);
+  }
 
   BTM_TRACE_DEBUG("%s: status=%d,len=%d,rec=%d", __func__, status, len - 4,
                   num_records);
 
-  if (num_records == 0) {
-    cb.Run(status, report_format, num_records_all, data_all);
+  if (status != HCI_SUCCESS) batchscan_stats.read_failures++;
+
+  if (status != HCI_SUCCESS || num_records == 0 || len <= 4) {
+    if (scan_modes == 0)
+      cb.Run(status);
+    else
+      btm_ble_drain_batchscan_reports(scan_modes, std::move(cb));
     return;
   }
 
-  if (len > 4) {
-    data_all.insert(data_all.end(), p, p + len - 4);
-    num_records_all += num_records;
+  batchscan_buffer_add(report_format, p, len - 4, num_records);
+
+  /* More records could be in the buffer and needs to be pulled out */
+  btm_ble_read_batchscan_reports(
+      scan_mode,
+      base::Bind(&drain_reports_cb, scan_mode, scan_modes, std::move(cb)));
+}
 
-    /* More records could be in the buffer and needs to be pulled out */
-    btm_ble_read_batchscan_reports(
-        report_format, base::Bind(&read_reports_cb, std::move(data_all),
-                                  num_records_all, std::move(cb)));
+/* This function reads all the reports of |scan_modes| from the controller
+ * into the buffer, then calls |cb| with the status of the last read */
+void btm_ble_drain_batchscan_reports(uint8_t scan_modes,
+                                     Callback<void(uint8_t /* status */)> cb) {
+  uint8_t scan_mode = scan_modes & BTM_BLE_BATCH_SCAN_MODE_ACTI;
+  if (scan_mode == 0) scan_mode = scan_modes & BTM_BLE_BATCH_SCAN_MODE_PASS;
+  if (scan_mode == 0) {
+    cb.Run(HCI_SUCCESS);
+    return;
   }
+
+  btm_ble_read_batchscan_reports(
+      scan_mode, base::Bind(&drain_reports_cb, scan_mode,
+                            scan_modes & ~scan_mode, std::move(cb)));
+}
+
+void read_reports_drained_cb(uint8_t scan_mode, tBTM_BLE_SCAN_REP_CBACK cb,
+                             uint8_t status) {
+  batchscan_buffer_deliver(status, scan_mode, std::move(cb));
 }
 
 /**
@@ -504,8 +683,8 @@ void BTM_BleReadScanReports(tBTM_BLE_BATCH_SCAN_MODE scan_mode,
     return;
   }
 
-  btm_ble_read_batchscan_reports(
-      scan_mode, base::Bind(&read_reports_cb, std::vector<uint8_t>(), 0, cb));
+  btm_ble_drain_batchscan_reports(
+      scan_mode, base::Bind(&read_reports_drained_cb, scan_mode, cb));
   return;
 }
 
@@ -531,6 +710,24 @@ void BTM_BleTrackAdvertiser(tBTM_BLE_TRACK_ADV_CBACK* p_track_cback,
   return;
 }
 
+/* This function is called to read the batch scan statistics */
+void BTM_BleGetBatchScanStats(tBTM_BLE_BATCH_SCAN_STATS* p_stats) {
+  *p_stats = batchscan_stats;
+}
+
+/* This function is called to dump the batch scan statistics to |fd| */
+void BTM_BleBatchScanDumpStatistics(int fd) {
+  dprintf(fd, "\nBLE Batch Scan:\n");
+  dprintf(fd, "  Reports read/delivered/dropped : %u / %u / %u\n",
+          batchscan_stats.reports_read, batchscan_stats.reports_delivered,
+          batchscan_stats.reports_dropped);
+  dprintf(fd, "  Read failures                  : %u\n",
+          batchscan_stats.read_failures);
+  dprintf(fd, "  Reports buffered (full/trunc)  : %zu / %zu octets\n",
+          batchscan_buffers[BTM_BLE_BATCH_SCAN_MODE_ACTI - 1].size,
+          batchscan_buffers[BTM_BLE_BATCH_SCAN_MODE_PASS - 1].size);
+}
+
 /**
  * This function initialize the batch scan control block.
  **/
@@ -549,4 +746,9 @@ void btm_ble_batchscan_cleanup(void) {
 
   memset(&ble_batchscan_cb, 0, sizeof(tBTM_BLE_BATCH_SCAN_CB));
   memset(&ble_advtrack_cb, 0, sizeof(tBTM_BLE_ADV_TRACK_CB));
+
+  for (BatchScanBuffer& buffer : batchscan_buffers) {
+    buffer.chunks.clear();
+    buffer.size = 0;
+  }
 }
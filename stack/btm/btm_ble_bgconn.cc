@@ -24,8 +24,9 @@
 
 #include <base/logging.h>
 #include <string.h>
-#include <unordered_map>
+#include <vector>
 
+#include "ble_bg_conn_list.h"
 #include "bt_types.h"
 #include "bt_utils.h"
 #include "btm_int.h"
@@ -35,62 +36,34 @@
 #include "l2c_int.h"
 #include "osi/include/allocator.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 #ifndef BTM_BLE_SCAN_PARAM_TOUT
 #define BTM_BLE_SCAN_PARAM_TOUT 50 /* 50 seconds */
 #endif
 
+#ifndef BTM_BLE_WL_SYNC_DELAY_MS
+#define BTM_BLE_WL_SYNC_DELAY_MS 10 /* gathers the bursts of changes */
+#endif
+
+#ifndef BTM_BLE_BG_CONN_ROTATE_MS
+#define BTM_BLE_BG_CONN_ROTATE_MS (10 * 1000) /* 10 seconds */
+#endif
+
+extern fixed_queue_t* btu_general_alarm_queue;
+
 static void btm_suspend_wl_activity(tBTM_BLE_WL_STATE wl_state);
 static void btm_resume_wl_activity(tBTM_BLE_WL_STATE wl_state);
+static void btm_ble_wl_sync_timeout(void* data);
+static void btm_ble_bg_conn_rotate_timeout(void* data);
 
 // Unfortunately (for now?) we have to maintain a copy of the device whitelist
 // on the host to determine if a device is pending to be connected or not. This
 // controls whether the host should keep trying to scan for whitelisted
-// peripherals or not.
+// peripherals or not. The copy also tells the changes to make to the white
+// list of the controller, and which devices it holds once they exceed it.
 // TODO: Move all of this to controller/le/background_list or similar?
-typedef struct background_connection_t {
-  bt_bdaddr_t address;
-} background_connection_t;
-
-struct KeyEqual {
-  bool operator()(const bt_bdaddr_t* x, const bt_bdaddr_t* y) const {
-    return bdaddr_equals(x, y);
-  }
-};
-
-static std::unordered_map<bt_bdaddr_t*, background_connection_t*,
-                          std::hash<bt_bdaddr_t*>, KeyEqual>
-    background_connections;
-
-static void background_connection_add(bt_bdaddr_t* address) {
-  CHECK(address);
-
-  auto map_iter = background_connections.find(address);
-  if (map_iter == background_connections.end()) {
-    background_connection_t* connection =
-        (background_connection_t*)osi_calloc(sizeof(background_connection_t));
-    connection->address = *address;
-    background_connections[&(connection->address)] = connection;
-  }
-}
-
-static void background_connection_remove(bt_bdaddr_t* address) {
-  background_connections.erase(address);
-}
-
-static void background_connections_clear() { background_connections.clear(); }
-
-static bool background_connections_pending() {
-  for (const auto& map_el : background_connections) {
-    background_connection_t* connection = map_el.second;
-    const bool connected =
-        BTM_IsAclConnectionUp(connection->address.address, BT_TRANSPORT_LE);
-    if (!connected) {
-      return true;
-    }
-  }
-  return false;
-}
+static BleBgConnList background_connections;
 
 /*******************************************************************************
  *
@@ -173,82 +146,150 @@ bool btm_add_dev_to_controller(bool to_add, BD_ADDR bd_addr) {
 
   return started;
 }
+/*******************************************************************************
+ *
+ * Function         btm_ble_schedule_bg_conn_rotation
+ *
+ * Description      Rotates the devices through the white list while they
+ *                  exceed it, or stops rotating them.
+ *
+ ******************************************************************************/
+static void btm_ble_schedule_bg_conn_rotation(void) {
+  tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
+
+  if (!background_connections.Overflows()) {
+    alarm_cancel(p_cb->bg_conn_rotate_timer);
+  } else if (!alarm_is_scheduled(p_cb->bg_conn_rotate_timer)) {
+    alarm_set_on_queue(p_cb->bg_conn_rotate_timer, BTM_BLE_BG_CONN_ROTATE_MS,
+                       btm_ble_bg_conn_rotate_timeout, NULL,
+                       btu_general_alarm_queue);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         btm_execute_wl_dev_operation
  *
  * Description      execute the pending whitelist device operation (loading or
- *                                                                  removing)
+ *                  removing), as the difference between the background
+ *                  connection devices and the content of the white list.
+ *
+ * Returns          false if a device could not be loaded.
+ *
  ******************************************************************************/
 bool btm_execute_wl_dev_operation(void) {
-  tBTM_BLE_WL_OP* p_dev_op = btm_cb.ble_ctr_cb.wl_op_q;
-  uint8_t i = 0;
+  std::vector<BleBgConnList::Op> ops;
   bool rt = true;
 
-  for (i = 0; i < BTM_BLE_MAX_BG_CONN_DEV_NUM && rt; i++, p_dev_op++) {
-    if (p_dev_op->in_use) {
-      rt = btm_add_dev_to_controller(p_dev_op->to_add, p_dev_op->bd_addr);
-      memset(p_dev_op, 0, sizeof(tBTM_BLE_WL_OP));
-    } else
-      break;
+  if (!background_connections.NeedsSync()) return rt;
+
+  background_connections.Sync(&ops);
+  BTM_TRACE_DEBUG("%s %zu operations, %zu of %zu devices in white list",
+                  __func__, ops.size(), background_connections.ControllerSize(),
+                  background_connections.Size());
+  for (auto& op : ops) {
+    if (!btm_add_dev_to_controller(op.to_add, op.bd_addr)) rt = false;
   }
+
+  btm_ble_schedule_bg_conn_rotation();
   return rt;
 }
+
 /*******************************************************************************
  *
- * Function         btm_enq_wl_dev_operation
+ * Function         btm_ble_schedule_wl_sync
+ *
+ * Description      Schedules the white list changes, so that the changes made
+ *                  in a row are applied together.
  *
- * Description      enqueue the pending whitelist device operation (loading or
- *                                                                  removing).
  ******************************************************************************/
-void btm_enq_wl_dev_operation(bool to_add, BD_ADDR bd_addr) {
-  tBTM_BLE_WL_OP* p_dev_op = btm_cb.ble_ctr_cb.wl_op_q;
-  uint8_t i = 0;
-
-  for (i = 0; i < BTM_BLE_MAX_BG_CONN_DEV_NUM; i++, p_dev_op++) {
-    if (p_dev_op->in_use && !memcmp(p_dev_op->bd_addr, bd_addr, BD_ADDR_LEN)) {
-      p_dev_op->to_add = to_add;
-      return;
-    } else if (!p_dev_op->in_use)
-      break;
-  }
-  if (i != BTM_BLE_MAX_BG_CONN_DEV_NUM) {
-    p_dev_op->in_use = true;
-    p_dev_op->to_add = to_add;
-    memcpy(p_dev_op->bd_addr, bd_addr, BD_ADDR_LEN);
-  } else {
-    BTM_TRACE_ERROR("max pending WL operation reached, discard");
-  }
-  return;
+static void btm_ble_schedule_wl_sync(void) {
+  tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
+
+  if (!background_connections.NeedsSync() ||
+      alarm_is_scheduled(p_cb->wl_sync_timer))
+    return;
+
+  alarm_set_on_queue(p_cb->wl_sync_timer, BTM_BLE_WL_SYNC_DELAY_MS,
+                     btm_ble_wl_sync_timeout, NULL, btu_general_alarm_queue);
 }
 
 /*******************************************************************************
  *
- * Function         btm_update_dev_to_white_list
+ * Function         btm_ble_wl_sync_timeout
  *
- * Description      This function adds or removes a device into/from
- *                  the white list.
+ * Description      Applies the white list changes, in a single suspension of
+ *                  the white list activity.
  *
  ******************************************************************************/
-bool btm_update_dev_to_white_list(bool to_add, BD_ADDR bd_addr) {
+static void btm_ble_wl_sync_timeout(UNUSED_ATTR void* data) {
   tBTM_BLE_CB* p_cb = &btm_cb.ble_ctr_cb;
 
-  if (to_add && p_cb->white_list_avail_size == 0) {
-    BTM_TRACE_ERROR("%s Whitelist full, unable to add device", __func__);
-    return false;
-  }
-
-  if (to_add)
-    background_connection_add((bt_bdaddr_t*)bd_addr);
-  else
-    background_connection_remove((bt_bdaddr_t*)bd_addr);
+  if (!background_connections.NeedsSync()) return;
 
   btm_suspend_wl_activity(p_cb->wl_state);
-  btm_enq_wl_dev_operation(to_add, bd_addr);
+  btm_execute_wl_dev_operation();
   btm_resume_wl_activity(p_cb->wl_state);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_bg_conn_rotate_timeout
+ *
+ * Description      Gives the rotating entries of the white list to the devices
+ *                  that waited the longest.
+ *
+ ******************************************************************************/
+static void btm_ble_bg_conn_rotate_timeout(UNUSED_ATTR void* data) {
+  if (background_connections.Rotate())
+    btm_ble_wl_sync_timeout(NULL);
+  else
+    btm_ble_schedule_bg_conn_rotation();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_update_dev_to_white_list
+ *
+ * Description      This function adds or removes a device into/from
+ *                  the background connection devices. The white list is
+ *                  updated shortly after, along with the other changes.
+ *
+ ******************************************************************************/
+bool btm_update_dev_to_white_list(bool to_add, BD_ADDR bd_addr) {
+  if (to_add) {
+    /* the devices exceeding the white list take turns in it */
+    if (!background_connections.Contains(bd_addr) &&
+        background_connections.Size() >=
+            controller_get_interface()->get_ble_white_list_size())
+      BTM_TRACE_WARNING("%s white list full, device rotated through it",
+                        __func__);
+    background_connections.Add(bd_addr,
+                               BTM_IsAclConnectionUp(bd_addr, BT_TRANSPORT_LE),
+                               time_get_os_boottime_ms());
+  } else {
+    background_connections.Remove(bd_addr);
+  }
+
+  btm_ble_schedule_wl_sync();
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_update_bg_conn_link
+ *
+ * Description      This function records that the LE link to a device is up
+ *                  or down: the recently active devices are kept in a full
+ *                  white list, and the connected ones are left out of it.
+ *
+ ******************************************************************************/
+void btm_ble_update_bg_conn_link(BD_ADDR bd_addr, bool connected) {
+  if (background_connections.UpdateLink(bd_addr, connected,
+                                        time_get_os_boottime_ms()))
+    btm_ble_schedule_wl_sync();
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_clear_white_list
@@ -259,7 +300,9 @@ bool btm_update_dev_to_white_list(bool to_add, BD_ADDR bd_addr) {
 void btm_ble_clear_white_list(void) {
   BTM_TRACE_EVENT("btm_ble_clear_white_list");
   btsnd_hcic_ble_clear_white_list();
-  background_connections_clear();
+  background_connections.Clear();
+  alarm_cancel(btm_cb.ble_ctr_cb.wl_sync_timer);
+  alarm_cancel(btm_cb.ble_ctr_cb.bg_conn_rotate_timer);
 }
 
 /*******************************************************************************
@@ -292,6 +335,7 @@ void btm_ble_clear_white_list_complete(uint8_t* p_data,
 void btm_ble_white_list_init(uint8_t white_list_size) {
   BTM_TRACE_DEBUG("%s white_list_size = %d", __func__, white_list_size);
   btm_cb.ble_ctr_cb.white_list_avail_size = white_list_size;
+  background_connections.SetCapacity(white_list_size);
 }
 
 /*******************************************************************************
@@ -382,7 +426,7 @@ bool btm_ble_start_auto_conn(bool start) {
   if (controller_get_interface()->supports_ble_coded_phy()) phy |= PHY_LE_CODED;
 
   if (start) {
-    if (p_cb->conn_state == BLE_CONN_IDLE && background_connections_pending() &&
+    if (p_cb->conn_state == BLE_CONN_IDLE && background_connections.Pending() &&
         btm_ble_topology_check(BTM_BLE_STATE_INIT)) {
       p_cb->wl_state |= BTM_BLE_WL_INIT;
 
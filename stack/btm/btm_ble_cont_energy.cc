@@ -16,7 +16,9 @@
  *
  ******************************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
+#include <atomic>
 #include "bt_target.h"
 
 #include "bt_types.h"
@@ -26,8 +28,119 @@
 #include "btu.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
+#include "osi/include/alarm.h"
+#include "osi/include/metrics.h"
+#include "osi/include/properties.h"
+#include "osi/include/time.h"
+
+using system_bt_osi::BluetoothMetricsLogger;
+
+extern fixed_queue_t* btu_general_alarm_queue;
+
+/* the property setting the period of the background sampling of the
+ * controller energy counters in milliseconds, 0 to disable it */
+#define BTM_BLE_ENERGY_SAMPLE_PERIOD_PROPERTY \
+  "persist.bluetooth.energy_sample_period_ms"
+
+#ifndef BTM_BLE_ENERGY_SAMPLE_PERIOD_MS
+#define BTM_BLE_ENERGY_SAMPLE_PERIOD_MS (5 * 60 * 1000)
+#endif
+
+/* background sampling of the controller energy counters */
+typedef struct {
+  alarm_t* timer;
+  period_ms_t period_ms;
+  bool read_pending; /* a sampling read waits for its result */
+  bool has_last;     /* the counters of the last read are valid */
+  uint64_t last_time_ms;
+  uint32_t last_tx_time;
+  uint32_t last_rx_time;
+  uint32_t last_idle_time;
+  uint32_t last_energy_used;
+} tBTM_BLE_ENERGY_SAMPLER;
 
 tBTM_BLE_ENERGY_INFO_CB ble_energy_info_cb;
+static tBTM_BLE_ENERGY_SAMPLER ble_energy_sampler;
+
+/* set from the media task */
+static std::atomic<int32_t> ble_energy_a2dp_codec_index{-1};
+
+static void btm_ble_energy_sample_timeout(void* data);
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_add_sample
+ *
+ * Description      Logs the controller activity since the last read of the
+ *                  energy counters, with the profiles active now. The
+ *                  counters are cumulative and wrap around.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_energy_add_sample(uint32_t tx_time, uint32_t rx_time,
+                                      uint32_t idle_time,
+                                      uint32_t energy_used) {
+  tBTM_BLE_ENERGY_SAMPLER* p_cb = &ble_energy_sampler;
+  uint64_t now_ms = time_get_os_boottime_ms();
+
+  if (p_cb->has_last) {
+    system_bt_osi::energy_sample_t sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.duration_ms = now_ms - p_cb->last_time_ms;
+    sample.tx_time_ms = tx_time - p_cb->last_tx_time;
+    sample.rx_time_ms = rx_time - p_cb->last_rx_time;
+    sample.idle_time_ms = idle_time - p_cb->last_idle_time;
+    sample.energy_used = energy_used - p_cb->last_energy_used;
+    sample.a2dp_codec_index = ble_energy_a2dp_codec_index;
+    sample.le_scanning =
+        BTM_BLE_IS_SCAN_ACTIVE(btm_cb.ble_ctr_cb.scan_activity) != 0;
+    for (int i = 0; i < MAX_L2CAP_LINKS; i++) {
+      const tACL_CONN* p_acl = &btm_cb.acl_db[i];
+      if (!p_acl->in_use) continue;
+      if (p_acl->transport == BT_TRANSPORT_LE)
+        sample.num_le_links++;
+      else
+        sample.num_bredr_links++;
+    }
+    BluetoothMetricsLogger::GetInstance()->LogEnergySample(sample, now_ms);
+  }
+
+  p_cb->has_last = true;
+  p_cb->last_time_ms = now_ms;
+  p_cb->last_tx_time = tx_time;
+  p_cb->last_rx_time = rx_time;
+  p_cb->last_idle_time = idle_time;
+  p_cb->last_energy_used = energy_used;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_parse
+ *
+ * Description      Parses the result of the energy info VSC.
+ *
+ * Returns          true if the result is valid
+ *
+ ******************************************************************************/
+static bool btm_ble_energy_parse(tBTM_VSC_CMPL* p_params, uint8_t* p_status,
+                                 uint32_t* p_tx_time, uint32_t* p_rx_time,
+                                 uint32_t* p_idle_time,
+                                 uint32_t* p_energy_used) {
+  uint8_t* p = p_params->p_param_buf;
+
+  if (p_params->param_len < 17) {
+    BTM_TRACE_ERROR("wrong length for energy info");
+    return false;
+  }
+
+  STREAM_TO_UINT8(*p_status, p);
+  STREAM_TO_UINT32(*p_tx_time, p);
+  STREAM_TO_UINT32(*p_rx_time, p);
+  STREAM_TO_UINT32(*p_idle_time, p);
+  STREAM_TO_UINT32(*p_energy_used, p);
+  return true;
+}
 
 /*******************************************************************************
  *
@@ -41,22 +154,17 @@ tBTM_BLE_ENERGY_INFO_CB ble_energy_info_cb;
  *
  ******************************************************************************/
 void btm_ble_cont_energy_cmpl_cback(tBTM_VSC_CMPL* p_params) {
-  uint8_t* p = p_params->p_param_buf;
-  uint16_t len = p_params->param_len;
   uint8_t status = 0;
   uint32_t total_tx_time = 0, total_rx_time = 0, total_idle_time = 0,
            total_energy_used = 0;
 
-  if (len < 17) {
-    BTM_TRACE_ERROR("wrong length for btm_ble_cont_energy_cmpl_cback");
+  if (!btm_ble_energy_parse(p_params, &status, &total_tx_time, &total_rx_time,
+                            &total_idle_time, &total_energy_used))
     return;
-  }
 
-  STREAM_TO_UINT8(status, p);
-  STREAM_TO_UINT32(total_tx_time, p);
-  STREAM_TO_UINT32(total_rx_time, p);
-  STREAM_TO_UINT32(total_idle_time, p);
-  STREAM_TO_UINT32(total_energy_used, p);
+  if (status == HCI_SUCCESS)
+    btm_ble_energy_add_sample(total_tx_time, total_rx_time, total_idle_time,
+                              total_energy_used);
 
   BTM_TRACE_DEBUG(
       "energy_info status=%d,tx_t=%ld, rx_t=%ld, ener_used=%ld, idle_t=%ld",
@@ -97,3 +205,113 @@ tBTM_STATUS BTM_BleGetEnergyInfo(tBTM_BLE_ENERGY_INFO_CBACK* p_ener_cback) {
                             btm_ble_cont_energy_cmpl_cback);
   return BTM_CMD_STARTED;
 }
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_sample_cmpl_cback
+ *
+ * Description      Controller VSC complete callback of a sampling read
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_energy_sample_cmpl_cback(tBTM_VSC_CMPL* p_params) {
+  uint8_t status = 0;
+  uint32_t tx_time = 0, rx_time = 0, idle_time = 0, energy_used = 0;
+
+  ble_energy_sampler.read_pending = false;
+  if (!btm_ble_energy_parse(p_params, &status, &tx_time, &rx_time, &idle_time,
+                            &energy_used))
+    return;
+
+  if (status == HCI_SUCCESS)
+    btm_ble_energy_add_sample(tx_time, rx_time, idle_time, energy_used);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_sample_timeout
+ *
+ * Description      Reads the controller energy counters, unless the last
+ *                  read is still pending. The timer has a slack of a quarter
+ *                  of the period so that it fires along with other wakeups,
+ *                  e.g. the media timer of a stream.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_energy_sample_timeout(UNUSED_ATTR void* data) {
+  tBTM_BLE_ENERGY_SAMPLER* p_cb = &ble_energy_sampler;
+
+  if (!p_cb->read_pending) {
+    p_cb->read_pending = true;
+    BTM_VendorSpecificCommand(HCI_BLE_ENERGY_INFO_OCF, 0, NULL,
+                              btm_ble_energy_sample_cmpl_cback);
+  }
+
+  alarm_set_on_queue_with_slack(p_cb->timer, p_cb->period_ms,
+                                p_cb->period_ms / 4,
+                                btm_ble_energy_sample_timeout, NULL,
+                                btu_general_alarm_queue);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_sampling_init
+ *
+ * Description      Starts the background sampling of the controller energy
+ *                  counters, if the controller reports them and the sampling
+ *                  period is not 0.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_energy_sampling_init(void) {
+  tBTM_BLE_ENERGY_SAMPLER* p_cb = &ble_energy_sampler;
+
+  btm_ble_energy_sampling_cleanup();
+  if (btm_cb.cmn_ble_vsc_cb.energy_support == 0) return;
+
+  char period_str[PROPERTY_VALUE_MAX] = {0};
+  osi_property_get(BTM_BLE_ENERGY_SAMPLE_PERIOD_PROPERTY, period_str, "");
+  int period_ms = (period_str[0] != '\0') ? atoi(period_str)
+                                          : BTM_BLE_ENERGY_SAMPLE_PERIOD_MS;
+  if (period_ms <= 0) return;
+
+  BTM_TRACE_EVENT("%s: every %d ms", __func__, period_ms);
+  p_cb->period_ms = period_ms;
+  p_cb->timer = alarm_new("btm_ble.energy_sample_timer");
+  btm_ble_energy_sample_timeout(NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_energy_sampling_cleanup
+ *
+ * Description      Stops the background sampling of the controller energy
+ *                  counters.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_energy_sampling_cleanup(void) {
+  alarm_free(ble_energy_sampler.timer);
+  memset(&ble_energy_sampler, 0, sizeof(ble_energy_sampler));
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleSetEnergyA2dpCodec
+ *
+ * Description      Sets the A2DP codec streaming, that the controller energy
+ *                  samples are attributed to.
+ *
+ * Parameters       codec_index - the btav_a2dp_codec_index_t of the codec
+ *                                streaming, -1 if none
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_BleSetEnergyA2dpCodec(int32_t codec_index) {
+  ble_energy_a2dp_codec_index = codec_index;
+}
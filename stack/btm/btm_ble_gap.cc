@@ -39,16 +39,19 @@
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
+#include "device/include/interop.h"
 #include "gap_api.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
 
 #include "advertise_data_parser.h"
+#include "ble_scan_dedup.h"
 #include "btm_ble_int.h"
 #include "gatt_int.h"
 #include "gattdefs.h"
 #include "l2c_int.h"
 #include "osi/include/log.h"
+#include "osi/include/time.h"
 
 #define BTM_BLE_NAME_SHORT 0x01
 #define BTM_BLE_NAME_CMPL 0x02
@@ -100,6 +103,11 @@ class AdvertisingCache {
     return items.front().data;
   }
 
+  /* Return true if data is kept for device |addr_type, addr| */
+  bool Exist(uint8_t addr_type, BD_ADDR addr) {
+    return Find(addr_type, addr) != items.end();
+  }
+
   /* Clear data for device |addr_type, addr| */
   void Clear(uint8_t addr_type, BD_ADDR addr) {
     auto it = Find(addr_type, addr);
@@ -139,6 +147,12 @@ class AdvertisingCache {
  * on secondary channel */
 AdvertisingCache cache;
 
+/* the scan runs without the duplicate filter of the controller, to keep
+ * tracking the RSSI: the duplicate reports are suppressed here */
+BleScanDedup scan_dedup(BTM_BLE_SCAN_DEDUP_MAX_DEVICES,
+                        BTM_BLE_SCAN_DEDUP_AGING_MS,
+                        BTM_BLE_SCAN_DEDUP_RSSI_THRESHOLD);
+
 }  // namespace
 
 #if (BLE_VND_INCLUDED == TRUE)
@@ -611,7 +625,8 @@ static void btm_ble_vendor_capability_vsc_cmpl_cback(
 
   btm_ble_adv_init();
 
-  if (btm_cb.cmn_ble_vsc_cb.max_filter > 0) btm_ble_adv_filter_init();
+  /* also sets up the filter in the host when it is not offloaded */
+  btm_ble_adv_filter_init();
 
 #if (BLE_PRIVACY_SPT == TRUE)
   /* VS capability included and non-4.2 device */
@@ -622,6 +637,8 @@ static void btm_ble_vendor_capability_vsc_cmpl_cback(
 
   if (btm_cb.cmn_ble_vsc_cb.tot_scan_results_strg > 0) btm_ble_batchscan_init();
 
+  btm_ble_energy_sampling_init();
+
   if (p_ctrl_le_feature_rd_cmpl_cback != NULL)
     p_ctrl_le_feature_rd_cmpl_cback(status);
 }
@@ -1655,8 +1672,8 @@ static void btm_ble_update_adv_flag(uint8_t flag) {
  * Check ADV flag to make sure device is discoverable and match the search
  * condition
  */
-uint8_t btm_ble_is_discoverable(BD_ADDR bda,
-                                std::vector<uint8_t> const& adv_data) {
+uint8_t btm_ble_is_discoverable(BD_ADDR bda, const uint8_t* adv_data,
+                                size_t adv_len) {
   uint8_t flag = 0, rt = 0;
   uint8_t data_len;
   tBTM_INQ_PARMS* p_cond = &btm_cb.btm_inq_vars.inqparms;
@@ -1672,9 +1689,9 @@ uint8_t btm_ble_is_discoverable(BD_ADDR bda,
     return rt;
   }
 
-  if (!adv_data.empty()) {
+  if (adv_len != 0) {
     const uint8_t* p_flag = AdvertiseDataParser::GetFieldByType(
-        adv_data, BTM_BLE_AD_TYPE_FLAG, &data_len);
+        adv_data, adv_len, BTM_BLE_AD_TYPE_FLAG, &data_len);
     if (p_flag != NULL) {
       flag = *p_flag;
 
@@ -1826,8 +1843,8 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type, BD_ADDR bda,
                                uint16_t evt_type, uint8_t primary_phy,
                                uint8_t secondary_phy, uint8_t advertising_sid,
                                int8_t tx_power, int8_t rssi,
-                               uint16_t periodic_adv_int,
-                               std::vector<uint8_t> const& data) {
+                               uint16_t periodic_adv_int, const uint8_t* data,
+                               size_t data_len) {
   tBTM_INQ_RESULTS* p_cur = &p_i->inq_info.results;
   uint8_t len;
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
@@ -1858,13 +1875,15 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type, BD_ADDR bda,
 
   p_i->inq_count = p_inq->inq_counter; /* Mark entry for current inquiry */
 
-  if (!data.empty()) {
-    const uint8_t* p_flag =
-        AdvertiseDataParser::GetFieldByType(data, BTM_BLE_AD_TYPE_FLAG, &len);
-    if (p_flag != NULL) p_cur->flag = *p_flag;
-  }
+  if (data_len != 0) {
+    /* the fields of interest, found in a single pass over the report */
+    const uint8_t types[] = {BTM_BLE_AD_TYPE_FLAG, BTM_BLE_AD_TYPE_APPEARANCE,
+                             BTM_BLE_AD_TYPE_16SRV_CMPL};
+    AdvertiseDataParser::Field fields[3];
+    AdvertiseDataParser::GetFieldsByType(data, data_len, types, 3, fields);
+
+    if (fields[0].data != NULL) p_cur->flag = *fields[0].data;
 
-  if (!data.empty()) {
     /* Check to see the BLE device has the Appearance UUID in the advertising
      * data.  If it does
      * then try to convert the appearance value to a class of device value
@@ -1872,14 +1891,13 @@ void btm_ble_update_inq_result(tINQ_DB_ENT* p_i, uint8_t addr_type, BD_ADDR bda,
      * Otherwise fall back to trying to infer if it is a HID device based on the
      * service class.
      */
-    const uint8_t* p_uuid16 = AdvertiseDataParser::GetFieldByType(
-        data, BTM_BLE_AD_TYPE_APPEARANCE, &len);
-    if (p_uuid16 && len == 2) {
+    const uint8_t* p_uuid16 = fields[1].data;
+    if (p_uuid16 && fields[1].len == 2) {
       btm_ble_appearance_to_cod((uint16_t)p_uuid16[0] | (p_uuid16[1] << 8),
                                 p_cur->dev_class);
     } else {
-      p_uuid16 = AdvertiseDataParser::GetFieldByType(
-          data, BTM_BLE_AD_TYPE_16SRV_CMPL, &len);
+      p_uuid16 = fields[2].data;
+      len = fields[2].len;
       if (p_uuid16 != NULL) {
         uint8_t i;
         for (i = 0; i + 2 <= len; i = i + 2) {
@@ -1930,15 +1948,20 @@ void btm_clear_all_pending_le_entry(void) {
     if ((p_ent->in_use) &&
         (p_ent->inq_info.results.device_type == BT_DEVICE_TYPE_BLE) &&
         !p_ent->scan_rsp)
-      p_ent->in_use = false;
+      btm_inq_db_free(p_ent);
   }
 }
 
 void btm_ble_process_adv_addr(BD_ADDR bda, uint8_t addr_type) {
 #if (BLE_PRIVACY_SPT == TRUE)
   /* map address to security record */
+  uint8_t peer_addr_type = addr_type;
   bool match = btm_identity_addr_to_random_pseudo(bda, &addr_type, false);
 
+  /* an identity address reported by the controller, that resolved it */
+  if (match && (peer_addr_type & BLE_ADDR_TYPE_ID_BIT))
+    btm_ble_resolving_list_note_resolution(btm_find_dev(bda), true);
+
   BTM_TRACE_DEBUG("%s: bda= %0x:%0x:%0x:%0x:%0x:%0x", __func__, bda[0], bda[1],
                   bda[2], bda[3], bda[4], bda[5]);
   /* always do RRA resolution on host */
@@ -2097,9 +2120,6 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
   bool update = true;
 
-  std::vector<uint8_t> tmp;
-  if (data_len != 0) tmp.insert(tmp.begin(), data, data + data_len);
-
   bool is_scannable = ble_evt_type_is_scannable(evt_type);
   bool is_scan_resp = ble_evt_type_is_scan_resp(evt_type);
 
@@ -2108,12 +2128,27 @@ static void btm_ble_process_adv_pkt_cont(
   // already existing data.
   bool is_start =
       ble_evt_type_is_legacy(evt_type) && is_scannable && !is_scan_resp;
-  std::vector<uint8_t> const& adv_data =
-      is_start ? cache.Set(addr_type, bda, std::move(tmp))
-               : cache.Append(addr_type, bda, std::move(tmp));
 
   bool data_complete = (ble_evt_type_data_status(evt_type) != 0x01);
 
+  bool is_active_scan =
+      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
+  bool wait_scan_rsp = is_active_scan && is_scannable && !is_scan_resp;
+
+  // Most reports carry the whole data of the device: they are processed in
+  // place, from the HCI event. Only the data that has to be completed by
+  // later reports goes through the cache.
+  const uint8_t* adv_data = data;
+  size_t adv_len = data_len;
+  if (!data_complete || wait_scan_rsp || cache.Exist(addr_type, bda)) {
+    std::vector<uint8_t> tmp(data, data + data_len);
+    std::vector<uint8_t> const& cached =
+        is_start ? cache.Set(addr_type, bda, std::move(tmp))
+                 : cache.Append(addr_type, bda, std::move(tmp));
+    adv_data = cached.data();
+    adv_len = cached.size();
+  }
+
   if (!data_complete) {
     // If we didn't receive whole adv data yet, don't report the device.
     DVLOG(1) << "Data not complete yet, waiting for more "
@@ -2121,18 +2156,23 @@ static void btm_ble_process_adv_pkt_cont(
     return;
   }
 
-  bool is_active_scan =
-      btm_cb.ble_ctr_cb.inq_var.scan_type == BTM_BLE_SCAN_MODE_ACTI;
-  if (is_active_scan && is_scannable && !is_scan_resp) {
+  if (wait_scan_rsp) {
     // If we didn't receive scan response yet, don't report the device.
     DVLOG(1) << " Waiting for scan response "
              << base::HexEncode(bda, BD_ADDR_LEN);
     return;
   }
 
-  if (!AdvertiseDataParser::IsValid(adv_data)) {
+  if (!AdvertiseDataParser::IsValid(adv_data, adv_len)) {
     DVLOG(1) << __func__ << "Dropping bad advertisement packet: "
-             << base::HexEncode(adv_data.data(), adv_data.size());
+             << base::HexEncode(adv_data, adv_len);
+    return;
+  }
+
+  // Reports the controller would have filtered out, were it offloading the
+  // APCF, are dropped before updating the inquiry database.
+  if (!btm_ble_adv_filter_matches(bda, rssi, adv_data, adv_len)) {
+    cache.Clear(addr_type, bda);
     return;
   }
 
@@ -2169,9 +2209,9 @@ static void btm_ble_process_adv_pkt_cont(
   /* update the LE device information in inquiry database */
   btm_ble_update_inq_result(p_i, addr_type, bda, evt_type, primary_phy,
                             secondary_phy, advertising_sid, tx_power, rssi,
-                            periodic_adv_int, adv_data);
+                            periodic_adv_int, adv_data, adv_len);
 
-  uint8_t result = btm_ble_is_discoverable(bda, adv_data);
+  uint8_t result = btm_ble_is_discoverable(bda, adv_data, adv_len);
   if (result == 0) {
     cache.Clear(addr_type, bda);
     LOG_WARN(LOG_TAG,
@@ -2208,13 +2248,15 @@ static void btm_ble_process_adv_pkt_cont(
   tBTM_INQ_RESULTS_CB* p_inq_results_cb = p_inq->p_inq_results_cb;
   if (p_inq_results_cb && (result & BTM_BLE_INQ_RESULT)) {
     (p_inq_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_len);
   }
 
   tBTM_INQ_RESULTS_CB* p_obs_results_cb = btm_cb.ble_ctr_cb.p_obs_results_cb;
-  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT)) {
+  if (p_obs_results_cb && (result & BTM_BLE_OBS_RESULT) &&
+      scan_dedup.ShouldReport(addr_type, bda, advertising_sid, rssi, adv_data,
+                              adv_len, time_get_os_boottime_ms())) {
     (p_obs_results_cb)((tBTM_INQ_RESULTS*)&p_i->inq_info.results,
-                       const_cast<uint8_t*>(adv_data.data()), adv_data.size());
+                       const_cast<uint8_t*>(adv_data), adv_len);
   }
 
   cache.Clear(addr_type, bda);
@@ -2256,6 +2298,9 @@ void btm_ble_process_phy_update_pkt(uint8_t len, uint8_t* data) {
  ******************************************************************************/
 tBTM_STATUS btm_ble_start_scan(void) {
   tBTM_BLE_INQ_CB* p_inq = &btm_cb.ble_ctr_cb.inq_var;
+  /* every device is reported again by a new scan */
+  scan_dedup.Clear();
+
   /* start scan, disable duplicate filtering */
   btm_send_hci_scan_enable(BTM_BLE_SCAN_ENABLE, p_inq->scan_duplicate_filter);
 
@@ -2548,6 +2593,17 @@ void btm_ble_read_remote_features_complete(uint8_t* p) {
 
   if (status == HCI_SUCCESS) {
     STREAM_TO_ARRAY(btm_cb.acl_db[idx].peer_le_features, p, BD_FEATURES_LEN);
+
+    /* The longest data PDUs are negotiated as soon as both sides are known to
+     * support them, not only when a large ATT MTU is exchanged */
+    bt_bdaddr_t bd_addr;
+    memcpy(bd_addr.address, btm_cb.acl_db[idx].remote_addr, BD_ADDR_LEN);
+    if (controller_get_interface()->supports_ble_packet_extension() &&
+        HCI_LE_DATA_LEN_EXT_SUPPORTED(btm_cb.acl_db[idx].peer_le_features) &&
+        !interop_match_addr(INTEROP_DISABLE_LE_AUTO_MTU_AND_DATA_LENGTH,
+                            &bd_addr))
+      BTM_SetBleDataLength(btm_cb.acl_db[idx].remote_addr,
+                           BTM_BLE_DATA_SIZE_MAX);
   }
 
   btsnd_hcic_rmt_ver_req(handle);
@@ -2704,11 +2760,15 @@ void btm_ble_init(void) {
 
   alarm_free(p_cb->observer_timer);
   alarm_free(p_cb->inq_var.fast_adv_timer);
+  alarm_free(p_cb->wl_sync_timer);
+  alarm_free(p_cb->bg_conn_rotate_timer);
   memset(p_cb, 0, sizeof(tBTM_BLE_CB));
   memset(&(btm_cb.cmn_ble_vsc_cb), 0, sizeof(tBTM_BLE_VSC_CB));
   btm_cb.cmn_ble_vsc_cb.values_read = false;
 
   p_cb->observer_timer = alarm_new("btm_ble.observer_timer");
+  p_cb->wl_sync_timer = alarm_new("btm_ble.wl_sync_timer");
+  p_cb->bg_conn_rotate_timer = alarm_new("btm_ble.bg_conn_rotate_timer");
   p_cb->cur_states = 0;
   p_cb->conn_pending_q = fixed_queue_new(SIZE_MAX);
 
@@ -111,6 +111,7 @@ extern uint8_t btm_ble_read_sec_key_size(BD_ADDR bd_addr);
 
 /* white list function */
 extern bool btm_update_dev_to_white_list(bool to_add, BD_ADDR bd_addr);
+extern void btm_ble_update_bg_conn_link(BD_ADDR bd_addr, bool connected);
 extern void btm_update_scanner_filter_policy(tBTM_BLE_SFP scan_policy);
 extern void btm_update_adv_filter_policy(tBTM_BLE_AFP adv_policy);
 extern void btm_ble_clear_white_list(void);
@@ -149,6 +150,7 @@ extern void btm_gen_resolvable_private_addr(base::Callback<void(BT_OCTET8)> cb);
 extern void btm_gen_non_resolvable_private_addr(tBTM_BLE_ADDR_CBACK* p_cback,
                                                 void* p);
 extern tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(BD_ADDR random_bda);
+extern void btm_ble_rpa_resolver_invalidate(void);
 extern void btm_gen_resolve_paddr_low(BT_OCTET8 rand);
 
 /*  privacy function */
@@ -187,6 +189,10 @@ extern void btm_ble_batchscan_init(void);
 extern void btm_ble_batchscan_cleanup(void);
 extern void btm_ble_adv_filter_init(void);
 extern void btm_ble_adv_filter_cleanup(void);
+extern void btm_ble_energy_sampling_init(void);
+extern void btm_ble_energy_sampling_cleanup(void);
+extern bool btm_ble_adv_filter_matches(const BD_ADDR bda, int8_t rssi,
+                                       const uint8_t* data, size_t len);
 extern bool btm_ble_topology_check(tBTM_BLE_STATE_MASK request);
 extern bool btm_ble_clear_topology_mask(tBTM_BLE_STATE_MASK request_state);
 extern bool btm_ble_set_topology_mask(tBTM_BLE_STATE_MASK request_state);
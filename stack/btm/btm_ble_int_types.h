@@ -126,6 +126,8 @@ typedef struct {
 
 /* 15 minutes minimum for random address refreshing */
 #define BTM_BLE_PRIVATE_ADDR_INT_MS (15 * 60 * 1000)
+/* The refresh may be deferred to share a wakeup with other timers */
+#define BTM_BLE_PRIVATE_ADDR_SLACK_MS (10 * 1000)
 
 typedef struct {
   uint16_t discoverable_mode;
@@ -174,8 +176,6 @@ typedef struct {
   alarm_t* refresh_raddr_timer;
 } tBTM_LE_RANDOM_CB;
 
-#define BTM_BLE_MAX_BG_CONN_DEV_NUM 10
-
 typedef struct {
   uint16_t min_conn_int;
   uint16_t max_conn_int;
@@ -260,13 +260,6 @@ typedef struct {
   uint8_t q_pending;
 } tBTM_BLE_RESOLVE_Q;
 
-typedef struct {
-  bool in_use;
-  bool to_add;
-  BD_ADDR bd_addr;
-  uint8_t attr;
-} tBTM_BLE_WL_OP;
-
 /* BLE privacy mode */
 #define BTM_PRIVACY_NONE 0 /* BLE no privacy */
 #define BTM_PRIVACY_1_1 1  /* BLE privacy 1.1, do not support privacy 1.0 */
@@ -302,6 +295,8 @@ typedef struct {
   /* white list information */
   uint8_t white_list_avail_size;
   tBTM_BLE_WL_STATE wl_state;
+  alarm_t* wl_sync_timer;        /* applies the white list changes */
+  alarm_t* bg_conn_rotate_timer; /* rotates the devices of a full list */
 
   fixed_queue_t* conn_pending_q;
   tBTM_BLE_CONN_ST conn_state;
@@ -319,10 +314,9 @@ typedef struct {
   tBTM_BLE_RL_STATE suspended_rl_state;     /* Suspended resolving list state */
   uint8_t* irk_list_mask; /* IRK list availability mask, up to max entry bits */
   tBTM_BLE_RL_STATE rl_state; /* Resolving list state */
+  alarm_t* rl_sync_timer;     /* applies the resolving list changes */
 #endif
 
-  tBTM_BLE_WL_OP wl_op_q[BTM_BLE_MAX_BG_CONN_DEV_NUM];
-
   /* current BLE link state */
   tBTM_BLE_STATE_MASK cur_states; /* bit mask of tBTM_BLE_STATE */
   uint8_t link_count[2];          /* total link count master and slave*/
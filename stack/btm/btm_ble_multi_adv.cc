@@ -20,13 +20,17 @@
 #include <base/bind.h>
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
+#include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <queue>
 #include <vector>
 
 #include "bt_target.h"
 #include "device/include/controller.h"
 #include "osi/include/alarm.h"
+#include "osi/include/time.h"
+#include "stack_config.h"
 
 #include "ble_advertiser.h"
 #include "ble_advertiser_hci_interface.h"
@@ -43,6 +47,11 @@ extern fixed_queue_t* btu_general_alarm_queue;
 
 constexpr int ADV_DATA_LEN_MAX = 251;
 
+// The advertising interval, in 0.625 ms units, of a rotated advertiser that
+// gets the least airtime: shorter intervals get proportionally more turns.
+constexpr uint32_t ROTATION_REFERENCE_INTERVAL = 1600; /* 1 s */
+constexpr uint8_t ROTATION_WEIGHT_MAX = 16;
+
 namespace {
 
 bool is_connectable(uint16_t advertising_event_properties) {
@@ -74,6 +83,20 @@ struct AdvertisingInstance {
    */
   bool enable_status;
 
+  /* When true, this instance has no advertising set of its own: it takes turns
+   * on the rotation set with the other rotated instances, and its parameters
+   * and data are kept here until its turn. */
+  bool rotated;
+  tBTM_BLE_ADV_PARAMS rotation_params;
+  std::vector<uint8_t> rotation_adv_data;
+  std::vector<uint8_t> rotation_scan_rsp_data;
+  uint8_t rotation_weight;
+  /* The airtime of the instance, divided by its weight: the instance with the
+   * least virtual time is the next on air */
+  uint64_t rotation_virtual_time;
+  uint64_t airtime_ms;
+  uint32_t turns;
+
   bool IsEnabled() { return enable_status; }
 
   bool IsConnectable() { return is_connectable(advertising_event_properties); }
@@ -88,7 +111,13 @@ struct AdvertisingInstance {
         own_address_type(0),
         own_address{0},
         address_update_required(false),
-        enable_status(false) {
+        enable_status(false),
+        rotated(false),
+        rotation_params(),
+        rotation_weight(1),
+        rotation_virtual_time(0),
+        airtime_ms(0),
+        turns(0) {
     adv_raddr_timer = alarm_new_periodic("btm_ble.adv_raddr_timer");
   }
 
@@ -99,6 +128,7 @@ struct AdvertisingInstance {
 };
 
 void btm_ble_adv_raddr_timer_timeout(void* data);
+void btm_ble_adv_rotation_timeout(void* data);
 
 void DoNothing(uint8_t) {}
 void DoNothing2(uint8_t, uint8_t) {}
@@ -156,7 +186,10 @@ class BleAdvertisingManagerImpl
                    base::Unretained(this)));
   }
 
-  ~BleAdvertisingManagerImpl() { adv_inst.clear(); }
+  ~BleAdvertisingManagerImpl() {
+    adv_inst.clear();
+    alarm_free(rotation_timer);
+  }
 
   void GetOwnAddress(uint8_t inst_id, GetAddressCallback cb) override {
     bt_bdaddr_t addr;
@@ -166,11 +199,47 @@ class BleAdvertisingManagerImpl
 
   void ReadInstanceCountCb(uint8_t instance_count) {
     this->inst_count = instance_count;
-    adv_inst.reserve(inst_count);
+    /* The rotated instances are added after the advertising sets: reserve room
+     * for them, as the instances must never move */
+    adv_inst.reserve(inst_count + BTM_BLE_ADV_ROTATION_MAX);
     /* Initialize adv instance indices and IDs. */
     for (uint8_t i = 0; i < inst_count; i++) {
       adv_inst.emplace_back(i);
     }
+
+    if (rotation_requested) SetUpRotation();
+  }
+
+  void SetRotation(uint8_t rotated_advertisers) override {
+    rotation_requested = std::min<int>(
+        {rotated_advertisers, BTM_BLE_ADV_ROTATION_MAX, 0xFE - inst_count});
+    if (adv_inst.size() == inst_count && inst_count) SetUpRotation();
+  }
+
+  /* Reserves the last free advertising set for the rotated instances, and adds
+   * them after the advertising sets */
+  void SetUpRotation() {
+    if (rotation_count) return;
+    rotation_requested = std::min<int>(rotation_requested, 0xFE - inst_count);
+    if (!rotation_requested) return;
+
+    for (int i = inst_count - 1; i >= 0; i--) {
+      if (adv_inst[i].in_use) continue;
+
+      adv_inst[i].in_use = true;
+      rotation_handle = i;
+      for (uint8_t j = 0; j < rotation_requested; j++) {
+        adv_inst.emplace_back(inst_count + j);
+        adv_inst.back().rotated = true;
+      }
+      rotation_count = rotation_requested;
+      rotation_timer = alarm_new("btm_ble.adv_rotation");
+      LOG(INFO) << __func__ << ": " << +rotation_count
+                << " rotated advertisers on set " << +rotation_handle;
+      return;
+    }
+
+    LOG(ERROR) << __func__ << ": no free advertising set for the rotation";
   }
 
   void OnRpaGenerationComplete(base::Callback<void(bt_bdaddr_t)> cb,
@@ -208,6 +277,20 @@ class BleAdvertisingManagerImpl
   }
 
   void ConfigureRpa(AdvertisingInstance* p_inst, MultiAdvCb configuredCb) {
+    /* The address of a rotated instance is set at each of its turns */
+    if (p_inst->rotated) {
+      GenerateRpa(Bind(
+          [](AdvertisingInstance* p_inst, MultiAdvCb configuredCb,
+             bt_bdaddr_t bda) {
+            memcpy(p_inst->own_address, &bda, BD_ADDR_LEN);
+            ((BleAdvertisingManagerImpl*)BleAdvertisingManager::Get())
+                ->RotationUpdate(p_inst);
+            configuredCb.Run(0x00);
+          },
+          p_inst, std::move(configuredCb)));
+      return;
+    }
+
     /* Connectable advertising set must be disabled when updating RPA */
     bool restart = p_inst->IsEnabled() && p_inst->IsConnectable();
 
@@ -260,7 +343,7 @@ class BleAdvertisingManagerImpl
       base::Callback<void(uint8_t /* inst_id */, uint8_t /* status */)> cb)
       override {
     AdvertisingInstance* p_inst = &adv_inst[0];
-    for (uint8_t i = 0; i < inst_count; i++, p_inst++) {
+    for (uint8_t i = 0; i < adv_inst.size(); i++, p_inst++) {
       if (p_inst->in_use) continue;
 
       p_inst->in_use = true;
@@ -275,10 +358,11 @@ class BleAdvertisingManagerImpl
                bt_bdaddr_t bda) {
               memcpy(p_inst->own_address, &bda, BD_ADDR_LEN);
 
-              alarm_set_on_queue(p_inst->adv_raddr_timer,
-                                 BTM_BLE_PRIVATE_ADDR_INT_MS,
-                                 btm_ble_adv_raddr_timer_timeout, p_inst,
-                                 btu_general_alarm_queue);
+              alarm_set_on_queue_with_slack(
+                  p_inst->adv_raddr_timer, BTM_BLE_PRIVATE_ADDR_INT_MS,
+                  BTM_BLE_PRIVATE_ADDR_SLACK_MS,
+                  btm_ble_adv_raddr_timer_timeout, p_inst,
+                  btu_general_alarm_queue);
               cb.Run(p_inst->inst_id, BTM_BLE_MULTI_ADV_SUCCESS);
             },
             p_inst, cb));
@@ -341,7 +425,7 @@ class BleAdvertisingManagerImpl
         c->self->adv_inst[c->inst_id].tx_power = tx_power;
 
         BD_ADDR *rpa = &c->self->adv_inst[c->inst_id].own_address;
-        c->self->GetHciInterface()->SetRandomAddress(c->inst_id, *rpa, Bind(
+        c->self->SetRandomAddress(c->inst_id, *rpa, Bind(
           [](c_type c, uint8_t status) {
             if (status != 0) {
               LOG(ERROR) << "setting random address failed, status: " << +status;
@@ -421,7 +505,7 @@ class BleAdvertisingManagerImpl
             c->self->adv_inst[c->inst_id].tx_power = tx_power;
 
             BD_ADDR *rpa = &c->self->adv_inst[c->inst_id].own_address;
-            c->self->GetHciInterface()->SetRandomAddress(c->inst_id, *rpa, Bind(
+            c->self->SetRandomAddress(c->inst_id, *rpa, Bind(
               [](c_type c, uint8_t status) {
                 if (status != 0) {
                   c->self->Unregister(c->inst_id);
@@ -545,7 +629,7 @@ class BleAdvertisingManagerImpl
   void Enable(uint8_t inst_id, bool enable, MultiAdvCb cb, uint16_t duration,
               uint8_t maxExtAdvEvents, MultiAdvCb timeout_cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
-    if (inst_id >= inst_count) {
+    if (inst_id >= adv_inst.size()) {
       LOG(ERROR) << "bad instance id " << +inst_id;
       return;
     }
@@ -578,6 +662,11 @@ class BleAdvertisingManagerImpl
 
   void EnableFinish(AdvertisingInstance* p_inst, bool enable, MultiAdvCb cb,
                     uint8_t status) {
+    if (p_inst->rotated) {
+      RotatedEnableFinish(p_inst, enable, std::move(cb));
+      return;
+    }
+
     if (enable && p_inst->duration) {
       p_inst->enable_status = enable;
       // TODO(jpawlowski): HCI implementation that can't do duration should
@@ -604,7 +693,7 @@ class BleAdvertisingManagerImpl
   void SetParameters(uint8_t inst_id, tBTM_BLE_ADV_PARAMS* p_params,
                      ParametersCb cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
-    if (inst_id >= inst_count) {
+    if (inst_id >= adv_inst.size()) {
       LOG(ERROR) << "bad instance id " << +inst_id;
       return;
     }
@@ -616,6 +705,11 @@ class BleAdvertisingManagerImpl
       return;
     }
 
+    if (p_inst->rotated) {
+      RotatedSetParameters(p_inst, p_params, std::move(cb));
+      return;
+    }
+
     // TODO: disable only if was enabled, currently no use scenario needs that,
     // we always set parameters before enabling
     // GetHciInterface()->Enable(false, inst_id, Bind(DoNothing));
@@ -642,7 +736,7 @@ class BleAdvertisingManagerImpl
   void SetData(uint8_t inst_id, bool is_scan_rsp, std::vector<uint8_t> data,
                MultiAdvCb cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
-    if (inst_id >= inst_count) {
+    if (inst_id >= adv_inst.size()) {
       LOG(ERROR) << "bad instance id " << +inst_id;
       return;
     }
@@ -676,6 +770,16 @@ class BleAdvertisingManagerImpl
     }
 
     VLOG(1) << "data is: " << base::HexEncode(data.data(), data.size());
+    if (p_inst->rotated) {
+      if (is_scan_rsp)
+        p_inst->rotation_scan_rsp_data = std::move(data);
+      else
+        p_inst->rotation_adv_data = std::move(data);
+      RotationUpdate(p_inst);
+      cb.Run(BTM_BLE_MULTI_ADV_SUCCESS);
+      return;
+    }
+
     DivideAndSendData(
         inst_id, data, cb,
         base::Bind(&BleAdvertisingManagerImpl::SetDataAdvDataSender,
@@ -736,6 +840,11 @@ class BleAdvertisingManagerImpl
                                         tBLE_PERIODIC_ADV_PARAMS* params,
                                         MultiAdvCb cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
+    if (IsRotated(inst_id)) {
+      LOG(ERROR) << "no periodic advertising on rotated instance " << +inst_id;
+      cb.Run(BTM_BLE_MULTI_ADV_FAILURE);
+      return;
+    }
 
     GetHciInterface()->SetPeriodicAdvertisingParameters(
         inst_id, params->min_interval, params->max_interval,
@@ -745,6 +854,11 @@ class BleAdvertisingManagerImpl
   void SetPeriodicAdvertisingData(uint8_t inst_id, std::vector<uint8_t> data,
                                   MultiAdvCb cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
+    if (IsRotated(inst_id)) {
+      LOG(ERROR) << "no periodic advertising on rotated instance " << +inst_id;
+      cb.Run(BTM_BLE_MULTI_ADV_FAILURE);
+      return;
+    }
 
     VLOG(1) << "data is: " << base::HexEncode(data.data(), data.size());
 
@@ -757,6 +871,11 @@ class BleAdvertisingManagerImpl
   void SetPeriodicAdvertisingEnable(uint8_t inst_id, uint8_t enable,
                                     MultiAdvCb cb) override {
     VLOG(1) << __func__ << " inst_id: " << +inst_id << ", enable: " << +enable;
+    if (IsRotated(inst_id)) {
+      if (enable) LOG(ERROR) << "no periodic advertising on rotated instance";
+      cb.Run(enable ? BTM_BLE_MULTI_ADV_FAILURE : BTM_BLE_MULTI_ADV_SUCCESS);
+      return;
+    }
 
     GetHciInterface()->SetPeriodicAdvertisingEnable(enable, inst_id, cb);
   }
@@ -765,11 +884,16 @@ class BleAdvertisingManagerImpl
     AdvertisingInstance* p_inst = &adv_inst[inst_id];
 
     VLOG(1) << __func__ << " inst_id: " << +inst_id;
-    if (inst_id >= inst_count) {
+    if (inst_id >= adv_inst.size()) {
       LOG(ERROR) << "bad instance id " << +inst_id;
       return;
     }
 
+    if (p_inst->rotated) {
+      RotatedUnregister(p_inst);
+      return;
+    }
+
     if (adv_inst[inst_id].IsEnabled()) {
       p_inst->enable_status = false;
       GetHciInterface()->Enable(false, inst_id, 0x00, 0x00, Bind(DoNothing));
@@ -784,6 +908,9 @@ class BleAdvertisingManagerImpl
   void OnAdvertisingSetTerminated(
       uint8_t status, uint8_t advertising_handle, uint16_t connection_handle,
       uint8_t num_completed_extended_adv_events) override {
+    /* The rotation set is non-connectable, and has no timeout */
+    if (advertising_handle == rotation_handle) return;
+
     AdvertisingInstance* p_inst = &adv_inst[advertising_handle];
     VLOG(1) << __func__ << "status: 0x" << std::hex << +status
             << ", advertising_handle: 0x" << std::hex << +advertising_handle
@@ -823,12 +950,334 @@ class BleAdvertisingManagerImpl
     }
   }
 
+  /* Sets the random address of an advertising set. The address of a rotated
+   * instance is set at each of its turns instead. */
+  void SetRandomAddress(uint8_t inst_id, BD_ADDR address, MultiAdvCb cb) {
+    if (adv_inst[inst_id].rotated) {
+      cb.Run(BTM_BLE_MULTI_ADV_SUCCESS);
+      return;
+    }
+
+    GetHciInterface()->SetRandomAddress(inst_id, address, std::move(cb));
+  }
+
+  bool IsRotated(uint8_t inst_id) {
+    return inst_id < adv_inst.size() && adv_inst[inst_id].rotated;
+  }
+
+  void RotatedSetParameters(AdvertisingInstance* p_inst,
+                            tBTM_BLE_ADV_PARAMS* p_params, ParametersCb cb) {
+    /* A connection would end the rotation on the set: only broadcast */
+    if (is_connectable(p_params->advertising_event_properties) ||
+        (p_params->advertising_event_properties & 0x0C)) {
+      LOG(ERROR) << "rotated instance " << +p_inst->inst_id
+                 << " must be non-connectable and undirected";
+      cb.Run(BTM_BLE_MULTI_ADV_FAILURE, 0);
+      return;
+    }
+
+    p_inst->advertising_event_properties =
+        p_params->advertising_event_properties;
+    p_inst->tx_power = p_params->tx_power;
+    p_inst->rotation_params = *p_params;
+
+    uint32_t interval = std::max<uint32_t>(p_params->adv_int_max, 1);
+    p_inst->rotation_weight = std::min<uint32_t>(
+        std::max<uint32_t>(ROTATION_REFERENCE_INTERVAL / interval, 1),
+        ROTATION_WEIGHT_MAX);
+
+    RotationUpdate(p_inst);
+    cb.Run(BTM_BLE_MULTI_ADV_SUCCESS, p_inst->tx_power);
+  }
+
+  void RotatedEnableFinish(AdvertisingInstance* p_inst, bool enable,
+                           MultiAdvCb cb) {
+    if (p_inst->timeout_timer) {
+      alarm_cancel(p_inst->timeout_timer);
+      alarm_free(p_inst->timeout_timer);
+      p_inst->timeout_timer = nullptr;
+    }
+
+    /* Join the rotation at its virtual time, so that the instance does not
+     * take the airtime of the others to catch up */
+    if (enable && !p_inst->IsEnabled())
+      p_inst->rotation_virtual_time = RotationVirtualTime();
+    p_inst->enable_status = enable;
+    RotationUpdate(p_inst);
+
+    if (enable && p_inst->duration) {
+      EnableWithTimerCb(p_inst->inst_id, std::move(cb), p_inst->duration,
+                        p_inst->timeout_cb, BTM_BLE_MULTI_ADV_SUCCESS);
+    } else {
+      cb.Run(BTM_BLE_MULTI_ADV_SUCCESS);
+    }
+  }
+
+  void RotatedUnregister(AdvertisingInstance* p_inst) {
+    if (p_inst->timeout_timer) {
+      alarm_cancel(p_inst->timeout_timer);
+      alarm_free(p_inst->timeout_timer);
+      p_inst->timeout_timer = nullptr;
+    }
+    alarm_cancel(p_inst->adv_raddr_timer);
+
+    p_inst->enable_status = false;
+    p_inst->in_use = false;
+    RotationUpdate(p_inst);
+
+    p_inst->rotation_adv_data.clear();
+    p_inst->rotation_scan_rsp_data.clear();
+    p_inst->rotation_virtual_time = 0;
+    p_inst->airtime_ms = 0;
+    p_inst->turns = 0;
+  }
+
+  /* Returns the least virtual time of the enabled rotated instances */
+  uint64_t RotationVirtualTime() {
+    uint64_t virtual_time = UINT64_MAX;
+    for (uint8_t i = inst_count; i < adv_inst.size(); i++) {
+      if (adv_inst[i].in_use && adv_inst[i].IsEnabled())
+        virtual_time =
+            std::min(virtual_time, adv_inst[i].rotation_virtual_time);
+    }
+    return virtual_time == UINT64_MAX ? 0 : virtual_time;
+  }
+
+  /* Called when a rotated instance is enabled, disabled or reconfigured */
+  void RotationUpdate(AdvertisingInstance* p_inst) {
+    if (p_inst->inst_id == rotation_current) rotation_dirty = true;
+
+    if (rotation_current < 0 || rotation_dirty) {
+      Rotate();
+      return;
+    }
+
+    ScheduleRotation();
+  }
+
+  /* Arms the rotation timer while at least two instances take turns */
+  void ScheduleRotation() {
+    int enabled = 0;
+    for (uint8_t i = inst_count; i < adv_inst.size(); i++) {
+      if (adv_inst[i].in_use && adv_inst[i].IsEnabled()) enabled++;
+    }
+
+    if (enabled < 2) {
+      alarm_cancel(rotation_timer);
+      rotation_timer_armed = false;
+      return;
+    }
+
+    if (rotation_timer_armed) return;
+    rotation_timer_armed = true;
+    alarm_set_on_queue(rotation_timer, BTM_BLE_ADV_ROTATION_SLOT_MS,
+                       btm_ble_adv_rotation_timeout, nullptr,
+                       btu_general_alarm_queue);
+  }
+
+  void OnRotationTimeout() {
+    rotation_timer_armed = false;
+    Rotate();
+  }
+
+  /* Ends the turn of the instance on air, and puts the next one on the rotation
+   * set: the enabled instance with the least virtual time, the ones after the
+   * current instance first on ties. */
+  void Rotate() {
+    if (rotation_busy) {
+      rotation_pending = true;
+      return;
+    }
+
+    uint32_t now_ms = time_get_os_boottime_ms();
+    if (rotation_current >= 0) {
+      AdvertisingInstance* p_cur = &adv_inst[rotation_current];
+      uint32_t elapsed_ms = now_ms - rotation_slot_start_ms;
+      p_cur->airtime_ms += elapsed_ms;
+      p_cur->rotation_virtual_time +=
+          (uint64_t)elapsed_ms * ROTATION_WEIGHT_MAX / p_cur->rotation_weight;
+    }
+    rotation_slot_start_ms = now_ms;
+
+    int first = rotation_current >= 0 ? rotation_current - inst_count + 1 : 0;
+    int next = -1;
+    for (uint8_t i = 0; i < rotation_count; i++) {
+      int inst_id = inst_count + (first + i) % rotation_count;
+      AdvertisingInstance* p_inst = &adv_inst[inst_id];
+      if (!p_inst->in_use || !p_inst->IsEnabled()) continue;
+
+      if (next < 0 || p_inst->rotation_virtual_time <
+                          adv_inst[next].rotation_virtual_time)
+        next = inst_id;
+    }
+
+    if (next < 0) {
+      AdvertisingInstance* p_host = &adv_inst[rotation_handle];
+      if (p_host->IsEnabled()) {
+        p_host->enable_status = false;
+        GetHciInterface()->Enable(false, rotation_handle, 0x00, 0x00,
+                                  Bind(DoNothing));
+      }
+      rotation_current = -1;
+      rotation_dirty = false;
+      ScheduleRotation();
+      return;
+    }
+
+    if (next != rotation_current || rotation_dirty) {
+      rotation_current = next;
+      rotation_dirty = false;
+      adv_inst[next].turns++;
+      ProgramRotationSet(&adv_inst[next]);
+    }
+
+    ScheduleRotation();
+  }
+
+  /* Programs the rotation set with the parameters and data of |p_inst|, and
+   * enables it */
+  void ProgramRotationSet(AdvertisingInstance* p_inst) {
+    VLOG(1) << __func__ << " inst_id: " << +p_inst->inst_id;
+    rotation_busy = true;
+
+    AdvertisingInstance* p_host = &adv_inst[rotation_handle];
+    if (p_host->IsEnabled()) {
+      p_host->enable_status = false;
+      GetHciInterface()->Enable(false, rotation_handle, 0x00, 0x00,
+                                Bind(DoNothing));
+    }
+
+    tBTM_BLE_ADV_PARAMS* p_params = &p_inst->rotation_params;
+    BD_ADDR peer_address = {0, 0, 0, 0, 0, 0};
+    GetHciInterface()->SetParameters(
+        rotation_handle, p_params->advertising_event_properties,
+        p_params->adv_int_min, p_params->adv_int_max, p_params->channel_map,
+        p_inst->own_address_type, p_inst->own_address, 0x00, peer_address,
+        p_params->adv_filter_policy, p_inst->tx_power,
+        p_params->primary_advertising_phy, 0x01,
+        p_params->secondary_advertising_phy, 0x01 /* TODO: proper SID */,
+        p_params->scan_request_notification_enable,
+        Bind(&BleAdvertisingManagerImpl::OnRotationParametersSet,
+             base::Unretained(this), p_inst));
+  }
+
+  void OnRotationParametersSet(AdvertisingInstance* p_inst, uint8_t status,
+                               int8_t tx_power) {
+    if (status != 0) {
+      LOG(ERROR) << "setting rotation parameters failed, status: " << +status;
+      OnRotationSetEnabled(status);
+      return;
+    }
+
+    if (p_inst->own_address_type != BLE_ADDR_RANDOM) {
+      OnRotationAddressSet(p_inst, 0);
+      return;
+    }
+
+    GetHciInterface()->SetRandomAddress(
+        rotation_handle, p_inst->own_address,
+        Bind(&BleAdvertisingManagerImpl::OnRotationAddressSet,
+             base::Unretained(this), p_inst));
+  }
+
+  void OnRotationAddressSet(AdvertisingInstance* p_inst, uint8_t status) {
+    if (status != 0) {
+      LOG(ERROR) << "setting rotation address failed, status: " << +status;
+      OnRotationSetEnabled(status);
+      return;
+    }
+
+    DivideAndSendData(
+        rotation_handle, p_inst->rotation_adv_data,
+        Bind(&BleAdvertisingManagerImpl::OnRotationDataSet,
+             base::Unretained(this), p_inst),
+        base::Bind(&BleAdvertisingManagerImpl::SetDataAdvDataSender,
+                   base::Unretained(this), false));
+  }
+
+  void OnRotationDataSet(AdvertisingInstance* p_inst, uint8_t status) {
+    if (status != 0) {
+      LOG(ERROR) << "setting rotation data failed, status: " << +status;
+      OnRotationSetEnabled(status);
+      return;
+    }
+
+    DivideAndSendData(
+        rotation_handle, p_inst->rotation_scan_rsp_data,
+        Bind(&BleAdvertisingManagerImpl::OnRotationScanResponseSet,
+             base::Unretained(this)),
+        base::Bind(&BleAdvertisingManagerImpl::SetDataAdvDataSender,
+                   base::Unretained(this), true));
+  }
+
+  void OnRotationScanResponseSet(uint8_t status) {
+    if (status != 0) {
+      LOG(ERROR) << "setting rotation scan response failed, status: "
+                 << +status;
+      OnRotationSetEnabled(status);
+      return;
+    }
+
+    adv_inst[rotation_handle].enable_status = true;
+    GetHciInterface()->Enable(
+        true, rotation_handle, 0x00, 0x00,
+        Bind(&BleAdvertisingManagerImpl::OnRotationSetEnabled,
+             base::Unretained(this)));
+  }
+
+  void OnRotationSetEnabled(uint8_t status) {
+    if (status != 0) {
+      LOG(ERROR) << "enabling rotation set failed, status: " << +status;
+      adv_inst[rotation_handle].enable_status = false;
+    }
+
+    rotation_busy = false;
+    if (rotation_pending) {
+      rotation_pending = false;
+      Rotate();
+    }
+  }
+
+  void DumpRotation(int fd) {
+    dprintf(fd, "\nBLE Advertiser Rotation:\n");
+    if (!rotation_count) {
+      dprintf(fd, "  Disabled\n");
+      return;
+    }
+
+    dprintf(fd, "  Rotation set / slot              : %u / %u ms\n",
+            rotation_handle, BTM_BLE_ADV_ROTATION_SLOT_MS);
+    for (uint8_t i = inst_count; i < adv_inst.size(); i++) {
+      AdvertisingInstance* p_inst = &adv_inst[i];
+      if (!p_inst->in_use) continue;
+      dprintf(fd,
+              "  Advertiser %3u%s: %s, weight %2u, %u turns, %llu ms on air\n",
+              i, i == rotation_current ? "*" : " ",
+              p_inst->IsEnabled() ? "enabled " : "disabled",
+              p_inst->rotation_weight, p_inst->turns,
+              (unsigned long long)p_inst->airtime_ms);
+    }
+  }
+
  private:
   BleAdvertiserHciInterface* GetHciInterface() { return hci_interface; }
 
   BleAdvertiserHciInterface* hci_interface = nullptr;
   std::vector<AdvertisingInstance> adv_inst;
-  uint8_t inst_count;
+  uint8_t inst_count = 0;
+
+  /* Software rotation of the instances beyond the advertising sets: the
+   * rotated instances take turns on the |rotation_handle| set */
+  uint8_t rotation_requested = 0;
+  uint8_t rotation_count = 0;
+  uint8_t rotation_handle = 0xFF;
+  alarm_t* rotation_timer = nullptr;
+  bool rotation_timer_armed = false;
+  int rotation_current = -1; /* The instance on air, or -1 */
+  bool rotation_dirty = false;
+  bool rotation_busy = false;
+  bool rotation_pending = false;
+  uint32_t rotation_slot_start_ms = 0;
 };
 
 BleAdvertisingManager* instance;
@@ -837,6 +1286,11 @@ void btm_ble_adv_raddr_timer_timeout(void* data) {
   ((BleAdvertisingManagerImpl*)BleAdvertisingManager::Get())
       ->ConfigureRpa((AdvertisingInstance*)data, base::Bind(DoNothing));
 }
+
+void btm_ble_adv_rotation_timeout(void* data) {
+  ((BleAdvertisingManagerImpl*)BleAdvertisingManager::Get())
+      ->OnRotationTimeout();
+}
 }  // namespace
 
 void BleAdvertisingManager::Initialize(BleAdvertiserHciInterface* interface) {
@@ -861,6 +1315,8 @@ void btm_ble_adv_init() {
   BleAdvertisingManager::Initialize(BleAdvertiserHciInterface::Get());
   BleAdvertiserHciInterface::Get()->SetAdvertisingEventObserver(
       (BleAdvertisingManagerImpl*)BleAdvertisingManager::Get());
+  BleAdvertisingManager::Get()->SetRotation(
+      stack_config_get_interface()->get_ble_adv_rotated_advertisers());
 
   if (BleAdvertiserHciInterface::Get()->QuirkAdvertiserZeroHandle()) {
     // If handle 0 can't be used, register advertiser for it, but never use it.
@@ -868,6 +1324,12 @@ void btm_ble_adv_init() {
   }
 }
 
+/* This function is called to dump the advertiser rotation to |fd| */
+void BTM_BleAdvRotationDumpStatistics(int fd) {
+  if (!instance) return;
+  ((BleAdvertisingManagerImpl*)instance)->DumpRotation(fd);
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_multi_adv_cleanup
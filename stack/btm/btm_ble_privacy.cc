@@ -21,15 +21,20 @@
  *  This file contains functions for BLE controller based privacy.
  *
  ******************************************************************************/
+#include <stdio.h>
 #include <string.h>
 #include "bt_target.h"
 
 #if (BLE_PRIVACY_SPT == TRUE)
+#include <vector>
+
+#include "ble_resolving_list.h"
 #include "bt_types.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
+#include "osi/include/time.h"
 #include "vendor_hcidefs.h"
 
 /* RPA offload VSC specifics */
@@ -47,6 +52,31 @@
 #define BTM_BLE_META_READ_IRK_LEN 2
 #define BTM_BLE_META_ADD_WL_ATTR_LEN 9
 
+/* Delay gathering the resolving list changes into one pause of the address
+ * resolution */
+#ifndef BTM_BLE_RL_SYNC_DELAY_MS
+#define BTM_BLE_RL_SYNC_DELAY_MS 10
+#endif
+
+/* Delay gathering the devices resolved by the host into one batch of swaps */
+#ifndef BTM_BLE_RL_SWAP_DELAY_MS
+#define BTM_BLE_RL_SWAP_DELAY_MS 1000
+#endif
+
+/* Minimum time a device spends in the resolving list before it can be
+ * swapped out */
+#ifndef BTM_BLE_RL_MIN_RESIDENCY_MS
+#define BTM_BLE_RL_MIN_RESIDENCY_MS (30 * 1000)
+#endif
+
+extern fixed_queue_t* btu_general_alarm_queue;
+
+/* The bonded devices with an IRK, the most recently active ones being loaded
+ * in the resolving list of the controller */
+static BleResolvingList resolving_list(BTM_BLE_RL_MIN_RESIDENCY_MS);
+
+static void btm_ble_schedule_resolving_list_sync(uint64_t delay_ms);
+
 /*******************************************************************************
  *         Functions implemented controller based privacy using Resolving List
  ******************************************************************************/
@@ -250,6 +280,9 @@ void btm_ble_clear_resolving_list_complete(uint8_t* p, uint16_t evt_len) {
                     btm_cb.ble_ctr_cb.resolving_list_avail_size);
 
     list_foreach(btm_cb.sec_dev_rec, clear_resolving_list_bit, NULL);
+
+    resolving_list.ControllerCleared();
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SYNC_DELAY_MS);
   }
 }
 
@@ -655,12 +688,157 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
   return true;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_ble_add_resolving_list_entry
+ *
+ * Description      This function adds the IRK of a device into the resolving
+ *                  list, with the address resolution disabled.
+ *
+ * Parameters       pointer to device security record
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_add_resolving_list_entry(tBTM_SEC_DEV_REC* p_dev_rec) {
+  btm_ble_update_resolving_list(p_dev_rec->bd_addr, true);
+  if (controller_get_interface()->supports_ble_privacy()) {
+    BD_ADDR dummy_bda = {0};
+    uint8_t* peer_irk = p_dev_rec->ble.keys.irk;
+    uint8_t* local_irk = btm_cb.devcb.id_keys.irk;
+
+    if (memcmp(p_dev_rec->ble.static_addr, dummy_bda, BD_ADDR_LEN) == 0) {
+      memcpy(p_dev_rec->ble.static_addr, p_dev_rec->bd_addr, BD_ADDR_LEN);
+      p_dev_rec->ble.static_addr_type = p_dev_rec->ble.ble_addr_type;
+    }
+
+    BTM_TRACE_DEBUG("%s:adding device to controller resolving list", __func__);
+    // use identical IRK for now
+    btsnd_hcic_ble_add_device_resolving_list(p_dev_rec->ble.static_addr_type,
+                                             p_dev_rec->ble.static_addr,
+                                             peer_irk, local_irk);
+
+    BTM_TRACE_DEBUG("%s: adding device privacy mode", __func__);
+    btsnd_hcic_ble_set_privacy_mode(p_dev_rec->ble.static_addr_type,
+                                    p_dev_rec->ble.static_addr, 0x01);
+  } else {
+    uint8_t param[40] = {0};
+    uint8_t* p = param;
+
+    UINT8_TO_STREAM(p, BTM_BLE_META_ADD_IRK_ENTRY);
+    ARRAY_TO_STREAM(p, p_dev_rec->ble.keys.irk, BT_OCTET16_LEN);
+    UINT8_TO_STREAM(p, p_dev_rec->ble.static_addr_type);
+    BDADDR_TO_STREAM(p, p_dev_rec->ble.static_addr);
+
+    BTM_VendorSpecificCommand(HCI_VENDOR_BLE_RPA_VSC, BTM_BLE_META_ADD_IRK_LEN,
+                              param, btm_ble_resolving_list_vsc_op_cmpl);
+  }
+
+  btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
+                                     BTM_BLE_META_ADD_IRK_ENTRY);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_sync_timeout
+ *
+ * Description      This function applies the pending resolving list changes,
+ *                  in a single pause of the address resolution, as many as
+ *                  the pending operation queue of the controller can hold.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_resolving_list_sync_timeout(UNUSED_ATTR void* data) {
+  tBTM_BLE_RESOLVE_Q* p_q = &btm_cb.ble_ctr_cb.resolving_list_pend_q;
+  uint8_t max_size =
+      controller_get_interface()->get_ble_resolving_list_max_size();
+
+  if (max_size == 0 || !resolving_list.NeedsSync()) return;
+
+  /* the resolving list can not be edited with a direct connection going on */
+  if (btm_ble_get_conn_st() == BLE_DIR_CONN) {
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SWAP_DELAY_MS);
+    return;
+  }
+
+  /* as many operations as the pending operation queue has room for */
+  uint8_t pending = (p_q->q_next + max_size - p_q->q_pending) % max_size;
+  size_t budget = max_size > 1 ? max_size - 1 - pending : 1;
+  if (budget == 0) {
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SYNC_DELAY_MS);
+    return;
+  }
+
+  uint8_t rl_mask = btm_cb.ble_ctr_cb.rl_state;
+  if (rl_mask && !btm_ble_disable_resolving_list(rl_mask, false)) {
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SWAP_DELAY_MS);
+    return;
+  }
+
+  std::vector<BleResolvingList::Op> ops;
+  resolving_list.Sync(time_get_os_boottime_ms(), budget, &ops);
+
+  bool added = false;
+  if (!ops.empty()) {
+    for (const auto& op : ops) {
+      tBTM_SEC_DEV_REC* p_dev_rec = btm_find_dev((uint8_t*)op.bd_addr);
+      if (p_dev_rec == NULL) continue;
+
+      if (op.to_add) {
+        btm_ble_add_resolving_list_entry(p_dev_rec);
+        added = true;
+      } else if (p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) {
+        btm_ble_update_resolving_list(p_dev_rec->bd_addr, false);
+        btm_ble_remove_resolving_list_entry(p_dev_rec);
+      }
+    }
+
+    BTM_TRACE_DEBUG("%s %zu operations, %zu/%zu devices loaded", __func__,
+                    ops.size(), resolving_list.ControllerSize(),
+                    resolving_list.Size());
+  }
+
+  /* if resolving list has been turned on, re-enable it */
+  if (rl_mask)
+    btm_ble_enable_resolving_list(rl_mask);
+  else if (added)
+    btm_ble_enable_resolving_list(BTM_BLE_RL_INIT);
+
+  if (resolving_list.NeedsSync())
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SYNC_DELAY_MS);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_schedule_resolving_list_sync
+ *
+ * Description      This function schedules the resolving list changes to be
+ *                  applied in |delay_ms|, unless they are already scheduled
+ *                  sooner.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_ble_schedule_resolving_list_sync(uint64_t delay_ms) {
+  alarm_t* timer = btm_cb.ble_ctr_cb.rl_sync_timer;
+  if (timer == NULL || !resolving_list.NeedsSync()) return;
+
+  if (alarm_is_scheduled(timer) && alarm_get_remaining_ms(timer) <= delay_ms)
+    return;
+
+  alarm_set_on_queue(timer, delay_ms, btm_ble_resolving_list_sync_timeout,
+                     NULL, btu_general_alarm_queue);
+}
+
 /*******************************************************************************
  *
  * Function         btm_ble_resolving_list_load_dev
  *
- * Description      This function adds a device which is using RPA into the
- *                  white list.
+ * Description      This function adds a device which is using RPA to the
+ *                  devices of the resolving list. It is loaded into the
+ *                  resolving list of the controller with the next batch of
+ *                  changes, if it is one of the most recently active devices.
  *
  * Parameters       pointer to device security record
  *
@@ -668,9 +846,6 @@ bool btm_ble_disable_resolving_list(uint8_t rl_mask, bool to_resume) {
  *
  ******************************************************************************/
 bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
-  bool rt = false;
-  uint8_t rl_mask = btm_cb.ble_ctr_cb.rl_state;
-
   BTM_TRACE_DEBUG("%s btm_cb.ble_ctr_cb.privacy_mode = %d", __func__,
                   btm_cb.ble_ctr_cb.privacy_mode);
 
@@ -678,76 +853,43 @@ bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
   if (controller_get_interface()->get_ble_resolving_list_max_size() == 0)
     return false;
 
-  BTM_TRACE_DEBUG("%s btm_cb.ble_ctr_cb.privacy_mode = %d", __func__,
-                  btm_cb.ble_ctr_cb.privacy_mode);
-
   /* only add RPA enabled device into resolving list */
-  if (p_dev_rec != NULL && /* RPA is being used and PID is known */
-      ((p_dev_rec->ble.key_type & BTM_LE_KEY_PID) != 0 ||
-       (p_dev_rec->ble.key_type & BTM_LE_KEY_LID) != 0)) {
-    if (!(p_dev_rec->ble.in_controller_list & BTM_RESOLVING_LIST_BIT) &&
-        btm_ble_brcm_find_resolving_pending_entry(
-            p_dev_rec->bd_addr, BTM_BLE_META_ADD_IRK_ENTRY) == false) {
-      if (btm_cb.ble_ctr_cb.resolving_list_avail_size > 0) {
-        if (rl_mask) {
-          if (!btm_ble_disable_resolving_list(rl_mask, false)) return false;
-        }
-
-        btm_ble_update_resolving_list(p_dev_rec->bd_addr, true);
-        if (controller_get_interface()->supports_ble_privacy()) {
-          BD_ADDR dummy_bda = {0};
-          uint8_t* peer_irk = p_dev_rec->ble.keys.irk;
-          uint8_t* local_irk = btm_cb.devcb.id_keys.irk;
-
-          if (memcmp(p_dev_rec->ble.static_addr, dummy_bda, BD_ADDR_LEN) == 0) {
-            memcpy(p_dev_rec->ble.static_addr, p_dev_rec->bd_addr, BD_ADDR_LEN);
-            p_dev_rec->ble.static_addr_type = p_dev_rec->ble.ble_addr_type;
-          }
-
-          BTM_TRACE_DEBUG("%s:adding device to controller resolving list",
-                          __func__);
-          // use identical IRK for now
-          btsnd_hcic_ble_add_device_resolving_list(
-              p_dev_rec->ble.static_addr_type, p_dev_rec->ble.static_addr,
-              peer_irk, local_irk);
-
-          if (controller_get_interface()->supports_ble_privacy()) {
-            BTM_TRACE_DEBUG("%s: adding device privacy mode", __func__);
-            btsnd_hcic_ble_set_privacy_mode(p_dev_rec->ble.static_addr_type,
-                                            p_dev_rec->ble.static_addr, 0x01);
-          }
-        } else {
-          uint8_t param[40] = {0};
-          uint8_t* p = param;
-
-          UINT8_TO_STREAM(p, BTM_BLE_META_ADD_IRK_ENTRY);
-          ARRAY_TO_STREAM(p, p_dev_rec->ble.keys.irk, BT_OCTET16_LEN);
-          UINT8_TO_STREAM(p, p_dev_rec->ble.static_addr_type);
-          BDADDR_TO_STREAM(p, p_dev_rec->ble.static_addr);
-
-          BTM_VendorSpecificCommand(HCI_VENDOR_BLE_RPA_VSC,
-                                    BTM_BLE_META_ADD_IRK_LEN, param,
-                                    btm_ble_resolving_list_vsc_op_cmpl);
-        }
-
-        rt = true;
-        btm_ble_enq_resolving_list_pending(p_dev_rec->bd_addr,
-                                           BTM_BLE_META_ADD_IRK_ENTRY);
-
-        /* if resolving list has been turned on, re-enable it */
-        if (rl_mask)
-          btm_ble_enable_resolving_list(rl_mask);
-        else
-          btm_ble_enable_resolving_list(BTM_BLE_RL_INIT);
-      }
-    } else {
-      BTM_TRACE_ERROR("Device already in Resolving list");
-      rt = true;
-    }
-  } else {
+  if (p_dev_rec == NULL || /* RPA is being used and PID is known */
+      ((p_dev_rec->ble.key_type & BTM_LE_KEY_PID) == 0 &&
+       (p_dev_rec->ble.key_type & BTM_LE_KEY_LID) == 0)) {
     BTM_TRACE_DEBUG("Device not a RPA enabled device");
+    return false;
   }
-  return rt;
+
+  if (!resolving_list.Add(p_dev_rec->bd_addr, time_get_os_boottime_ms()))
+    BTM_TRACE_DEBUG("Device already in Resolving list");
+
+  btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SYNC_DELAY_MS);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_ble_resolving_list_note_resolution
+ *
+ * Description      This function records that an address of a device was
+ *                  resolved, by the controller or by the host. A device
+ *                  resolved by the host is swapped into the resolving list
+ *                  with the next batch of swaps.
+ *
+ * Parameters       p_dev_rec: pointer to device security record
+ *                  by_controller: true if resolved by the controller
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_ble_resolving_list_note_resolution(tBTM_SEC_DEV_REC* p_dev_rec,
+                                            bool by_controller) {
+  if (p_dev_rec == NULL) return;
+
+  if (resolving_list.Resolved(p_dev_rec->bd_addr, by_controller,
+                              time_get_os_boottime_ms()))
+    btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SWAP_DELAY_MS);
 }
 
 /*******************************************************************************
@@ -765,6 +907,8 @@ void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
   uint8_t rl_mask = btm_cb.ble_ctr_cb.rl_state;
 
   BTM_TRACE_EVENT("%s", __func__);
+  resolving_list.Remove(p_dev_rec->bd_addr);
+
   if (rl_mask) {
     if (!btm_ble_disable_resolving_list(rl_mask, false)) return;
   }
@@ -780,6 +924,9 @@ void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
 
   /* if resolving list has been turned on, re-enable it */
   if (rl_mask) btm_ble_enable_resolving_list(rl_mask);
+
+  /* its entry goes to another device */
+  btm_ble_schedule_resolving_list_sync(BTM_BLE_RL_SYNC_DELAY_MS);
 }
 
 /*******************************************************************************
@@ -886,6 +1033,10 @@ void btm_ble_resolving_list_init(uint8_t max_irk_list_sz) {
     BTM_TRACE_DEBUG("%s max_irk_list_sz = %d", __func__, max_irk_list_sz);
   }
 
+  if (btm_cb.ble_ctr_cb.rl_sync_timer == NULL)
+    btm_cb.ble_ctr_cb.rl_sync_timer = alarm_new("btm_ble.rl_sync_timer");
+  resolving_list.SetCapacity(max_irk_list_sz);
+
   controller_get_interface()->set_ble_resolving_list_max_size(max_irk_list_sz);
   btm_ble_clear_resolving_list();
   btm_cb.ble_ctr_cb.resolving_list_avail_size = max_irk_list_sz;
@@ -911,5 +1062,44 @@ void btm_ble_resolving_list_cleanup(void) {
   controller_get_interface()->set_ble_resolving_list_max_size(0);
 
   osi_free_and_reset((void**)&btm_cb.ble_ctr_cb.irk_list_mask);
+
+  alarm_free(btm_cb.ble_ctr_cb.rl_sync_timer);
+  btm_cb.ble_ctr_cb.rl_sync_timer = NULL;
+  resolving_list.Clear();
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_BleResolvingListDumpStatistics
+ *
+ * Description      This function dumps the devices of the resolving list, and
+ *                  how often their addresses were resolved by the controller.
+ *
+ * Parameters       fd: file descriptor to dump to
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_BleResolvingListDumpStatistics(int fd) {
+  uint32_t hits = resolving_list.hits();
+  uint32_t resolved = hits + resolving_list.misses();
+
+  dprintf(fd, "\nLE Resolving List Statistics:\n");
+  dprintf(fd, "  Devices                              : %zu\n",
+          resolving_list.Size());
+  dprintf(fd, "  Loaded in controller                 : %zu/%zu\n",
+          resolving_list.ControllerSize(), resolving_list.Capacity());
+  dprintf(fd, "  Resolved by controller               : %u\n", hits);
+  dprintf(fd, "  Resolved by host                     : %u\n",
+          resolving_list.misses());
+  dprintf(fd, "  Controller hit rate                  : %u%%\n",
+          resolved ? (uint32_t)(100ULL * hits / resolved) : 0);
+  dprintf(fd, "  Devices swapped in                   : %u\n",
+          resolving_list.swaps());
+}
+#else
+void BTM_BleResolvingListDumpStatistics(int fd) {
+  dprintf(fd, "\nLE Resolving List Statistics:\n");
+  dprintf(fd, "  Disabled\n");
 }
 #endif
@@ -36,6 +36,20 @@
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "l2c_api.h"
+#include "sec_dev_index.h"
+
+/* Indexes btm_cb.sec_dev_rec by address and by handle */
+static SecDevIndex sec_dev_index(BTM_SEC_DEV_INDEX_SIZE);
+
+/*******************************************************************************
+ *
+ * Function         btm_sec_dev_index_clear
+ *
+ * Description      Forget the records indexed, once btm_cb.sec_dev_rec is
+ *                  created
+ *
+ ******************************************************************************/
+void btm_sec_dev_index_clear(void) { sec_dev_index.Clear(); }
 
 /*******************************************************************************
  *
@@ -271,7 +285,9 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(BD_ADDR bd_addr) {
 void btm_sec_free_dev(tBTM_SEC_DEV_REC* p_dev_rec) {
   /* Clear out any saved BLE keys */
   btm_sec_clear_ble_keys(p_dev_rec);
+  sec_dev_index.Erase(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
+  btm_ble_rpa_resolver_invalidate();
 }
 
 /*******************************************************************************
@@ -343,10 +359,27 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      static_cast<tBTM_SEC_DEV_REC*>(sec_dev_index.FindHandle(handle));
+  if (p_dev_rec != NULL && !is_handle_equal(p_dev_rec, &handle))
+    return p_dev_rec;
+
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n == NULL) return NULL;
+
+  p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  /* the records of the links down all share the invalid handle */
+  if (handle != BTM_SEC_INVALID_HANDLE)
+    sec_dev_index.PutHandle(handle, p_dev_rec);
+  return p_dev_rec;
+}
 
-  return NULL;
+/* Returns true if |bd_addr| is the address or the pseudo address of
+ * |p_dev_rec|, without resolving it. */
+static bool is_address_known(const tBTM_SEC_DEV_REC* p_dev_rec,
+                             const BD_ADDR bd_addr) {
+  return !memcmp(p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN) ||
+         !memcmp(p_dev_rec->ble.pseudo_addr, bd_addr, BD_ADDR_LEN);
 }
 
 bool is_address_equal(void* data, void* context) {
@@ -374,11 +407,21 @@ bool is_address_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev(const BD_ADDR bd_addr) {
   if (!bd_addr) return NULL;
 
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      static_cast<tBTM_SEC_DEV_REC*>(sec_dev_index.FindAddr(bd_addr));
+  if (p_dev_rec != NULL && is_address_known(p_dev_rec, bd_addr))
+    return p_dev_rec;
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n == NULL) return NULL;
 
-  return NULL;
+  p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  /* the private addresses resolved change with time: only the identity and
+   * the pseudo addresses are remembered */
+  if (is_address_known(p_dev_rec, bd_addr))
+    sec_dev_index.PutAddr(bd_addr, p_dev_rec);
+  return p_dev_rec;
 }
 
 /*******************************************************************************
@@ -418,6 +461,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
       p_target_rec->bond_type = temp_rec.bond_type;
 
       /* remove the combined record */
+      sec_dev_index.Erase(p_dev_rec);
       list_remove(btm_cb.sec_dev_rec, p_dev_rec);
       break;
     }
@@ -430,6 +474,7 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
         p_target_rec->device_type |= p_dev_rec->device_type;
 
         /* remove the combined record */
+        sec_dev_index.Erase(p_dev_rec);
         list_remove(btm_cb.sec_dev_rec, p_dev_rec);
       }
       break;
@@ -520,6 +565,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
 
   if (list_length(btm_cb.sec_dev_rec) > BTM_SEC_MAX_DEVICE_RECORDS) {
     p_dev_rec = btm_find_oldest_dev_rec();
+    sec_dev_index.Erase(p_dev_rec);
     list_remove(btm_cb.sec_dev_rec, p_dev_rec);
   }
 
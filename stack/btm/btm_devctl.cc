@@ -40,6 +40,7 @@
 #include "l2c_int.h"
 #include "osi/include/osi.h"
 #include "osi/include/thread.h"
+#include "smp_api.h"
 
 #include "gatt_int.h"
 
@@ -85,6 +86,9 @@ void btm_dev_init(void) {
   btm_cb.devcb.read_rssi_timer = alarm_new("btm.read_rssi_timer");
   btm_cb.devcb.read_link_quality_timer =
       alarm_new("btm.read_link_quality_timer");
+  btm_cb.devcb.read_failed_contact_counter_timer =
+      alarm_new("btm.read_failed_contact_counter_timer");
+  btm_cb.devcb.acl_tput_timer = alarm_new_periodic("btm.acl_tput_timer");
   btm_cb.devcb.read_inq_tx_power_timer =
       alarm_new("btm.read_inq_tx_power_timer");
   btm_cb.devcb.qos_setup_timer = alarm_new("btm.qos_setup_timer");
@@ -181,6 +185,7 @@ static void reset_complete(void* result) {
   if (controller->supports_ble()) {
     btm_ble_white_list_init(controller->get_ble_white_list_size());
     l2c_link_processs_ble_num_bufs(controller->get_acl_buffer_count_ble());
+    SMP_FillKeyPairPool();
   }
 
   BTM_SetPinType(btm_cb.cfg.pin_type, btm_cb.cfg.pin_code,
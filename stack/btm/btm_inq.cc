@@ -30,6 +30,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "device/include/controller.h"
 #include "osi/include/osi.h"
 #include "osi/include/time.h"
@@ -42,6 +45,7 @@
 #include "btu.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
+#include "inq_db_index.h"
 
 /* 3 second timeout waiting for responses */
 #define BTM_INQ_REPLY_TIMEOUT_MS (3 * 1000)
@@ -59,6 +63,10 @@ extern fixed_queue_t* btu_general_alarm_queue;
 static const LAP general_inq_lap = {0x9e, 0x8b, 0x33};
 static const LAP limited_inq_lap = {0x9e, 0x8b, 0x00};
 
+/* Indexes btm_cb.btm_inq_vars.inq_db by address, in the order the devices
+ * were found */
+static InqDbIndex inq_db_index(BTM_INQ_DB_SIZE);
+
 const uint16_t BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES] = {
     UUID_SERVCLASS_SERVICE_DISCOVERY_SERVER,
     /*    UUID_SERVCLASS_BROWSE_GROUP_DESCRIPTOR,   */
@@ -1041,15 +1049,12 @@ tBTM_INQ_INFO* BTM_InqDbRead(const BD_ADDR p_bda) {
  *
  ******************************************************************************/
 tBTM_INQ_INFO* BTM_InqDbFirst(void) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
+  uint16_t inx = inq_db_index.First();
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) return (&p_ent->inq_info);
-  }
+  /* If no used entry found */
+  if (inx == InqDbIndex::kNone) return ((tBTM_INQ_INFO*)NULL);
 
-  /* If here, no used entry found */
-  return ((tBTM_INQ_INFO*)NULL);
+  return (&btm_cb.btm_inq_vars.inq_db[inx].inq_info);
 }
 
 /*******************************************************************************
@@ -1069,15 +1074,12 @@ tBTM_INQ_INFO* BTM_InqDbNext(tBTM_INQ_INFO* p_cur) {
 
   if (p_cur) {
     p_ent = (tINQ_DB_ENT*)((uint8_t*)p_cur - offsetof(tINQ_DB_ENT, inq_info));
-    inx = (uint16_t)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
+    inx = inq_db_index.Next((uint16_t)(p_ent - btm_cb.btm_inq_vars.inq_db));
 
-    for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE;
-         inx++, p_ent++) {
-      if (p_ent->in_use) return (&p_ent->inq_info);
-    }
+    /* If no more entries found */
+    if (inx == InqDbIndex::kNone) return ((tBTM_INQ_INFO*)NULL);
 
-    /* If here, more entries found */
-    return ((tBTM_INQ_INFO*)NULL);
+    return (&btm_cb.btm_inq_vars.inq_db[inx].inq_info);
   } else
     return (BTM_InqDbFirst());
 }
@@ -1229,6 +1231,7 @@ void btm_inq_db_init(void) {
   btm_cb.btm_inq_vars.remote_name_timer =
       alarm_new("btm_inq.remote_name_timer");
   btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+  inq_db_index.Clear();
 }
 
 /*******************************************************************************
@@ -1301,14 +1304,14 @@ void btm_clr_inq_db(BD_ADDR p_bda) {
   BTM_TRACE_DEBUG("btm_clr_inq_db: inq_active:0x%x state:%d",
                   btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) {
-      /* If this is the specified BD_ADDR or clearing all devices */
-      if (p_bda == NULL || (!memcmp(p_ent->inq_info.results.remote_bd_addr,
-                                    p_bda, BD_ADDR_LEN))) {
-        p_ent->in_use = false;
-      }
-    }
+  if (p_bda == NULL) {
+    /* Clearing all devices */
+    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) p_ent->in_use = false;
+    inq_db_index.Clear();
+  } else {
+    /* Only the specified BD_ADDR */
+    xx = inq_db_index.Find(p_bda);
+    if (xx != InqDbIndex::kNone) btm_inq_db_free(&p_ent[xx]);
   }
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("inq_active:0x%x state:%d", btm_cb.btm_inq_vars.inq_active,
@@ -1380,58 +1383,54 @@ bool btm_inq_find_bdaddr(BD_ADDR p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const BD_ADDR p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
+  uint16_t xx = inq_db_index.Find(p_bda);
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if ((p_ent->in_use) &&
-        (!memcmp(p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
-      return (p_ent);
-  }
+  /* If not found */
+  if (xx == InqDbIndex::kNone) return (NULL);
 
-  /* If here, not found */
-  return (NULL);
+  inq_db_index.Touch(xx);
+  return (&btm_cb.btm_inq_vars.inq_db[xx]);
 }
 
 /*******************************************************************************
  *
  * Function         btm_inq_db_new
  *
- * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
- *                  entry.
+ * Description      This function allocates an entry of the inquiry database
+ *                  for a device not in it. If no entry is free, it reuses the
+ *                  least recently used entry.
  *
- * Returns          pointer to entry
+ * Returns          pointer to entry, or NULL if the database has no entries
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(BD_ADDR p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint32_t ot = 0xFFFFFFFF;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      memcpy(p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-      p_ent->in_use = true;
+  uint16_t xx = inq_db_index.Insert(p_bda);
+  tINQ_DB_ENT* p_ent;
 
-      return (p_ent);
-    }
+  if (xx == InqDbIndex::kNone) return (NULL);
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
-    }
-  }
+  p_ent = &btm_cb.btm_inq_vars.inq_db[xx];
+  memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+  memcpy(p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
+  p_ent->in_use = true;
 
-  /* If here, no free entry found. Return the oldest. */
+  return (p_ent);
+}
 
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  memcpy(p_old->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-  p_old->in_use = true;
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function removes an entry from the inquiry database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(tINQ_DB_ENT* p_ent) {
+  if (!p_ent->in_use) return;
 
-  return (p_old);
+  p_ent->in_use = false;
+  inq_db_index.Erase((uint16_t)(p_ent - btm_cb.btm_inq_vars.inq_db));
 }
 
 /*******************************************************************************
@@ -1888,28 +1887,26 @@ void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode) {
  *
  ******************************************************************************/
 void btm_sort_inq_result(void) {
-  uint8_t xx, yy, num_resp;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_next = btm_cb.btm_inq_vars.inq_db + 1;
-  int size;
-  tINQ_DB_ENT* p_tmp = (tINQ_DB_ENT*)osi_malloc(sizeof(tINQ_DB_ENT));
-
-  num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp < BTM_INQ_DB_SIZE)
-                 ? btm_cb.btm_inq_vars.inq_cmpl_info.num_resp
-                 : BTM_INQ_DB_SIZE;
-
-  size = sizeof(tINQ_DB_ENT);
-  for (xx = 0; xx < num_resp - 1; xx++, p_ent++) {
-    for (yy = xx + 1, p_next = p_ent + 1; yy < num_resp; yy++, p_next++) {
-      if (p_ent->inq_info.results.rssi < p_next->inq_info.results.rssi) {
-        memcpy(p_tmp, p_next, size);
-        memcpy(p_next, p_ent, size);
-        memcpy(p_ent, p_tmp, size);
-      }
-    }
-  }
-
-  osi_free(p_tmp);
+  const tINQ_DB_ENT* p_db = btm_cb.btm_inq_vars.inq_db;
+  std::vector<uint16_t> order;
+  size_t num_resp;
+
+  order.reserve(inq_db_index.Size());
+  for (uint16_t xx = inq_db_index.First(); xx != InqDbIndex::kNone;
+       xx = inq_db_index.Next(xx))
+    order.push_back(xx);
+
+  /* The entries are walked through from the strongest to the weakest of the
+   * first responses, without moving them */
+  num_resp = std::min((size_t)btm_cb.btm_inq_vars.inq_cmpl_info.num_resp,
+                      order.size());
+  std::stable_sort(order.begin(), order.begin() + num_resp,
+                   [p_db](uint16_t a, uint16_t b) {
+                     return p_db[a].inq_info.results.rssi >
+                            p_db[b].inq_info.results.rssi;
+                   });
+
+  inq_db_index.Reorder(order);
 }
 
 /*******************************************************************************
@@ -100,6 +100,9 @@ extern void btm_read_tx_power_complete(uint8_t* p, bool is_ble);
 extern void btm_read_link_quality_timeout(void* data);
 extern void btm_read_link_quality_complete(uint8_t* p);
 
+extern void btm_read_failed_contact_counter_timeout(void* data);
+extern void btm_read_failed_contact_counter_complete(uint8_t* p);
+
 extern tBTM_STATUS btm_set_packet_types(tACL_CONN* p, uint16_t pkt_types);
 extern void btm_process_clk_off_comp_evt(uint16_t hci_handle,
                                          uint16_t clock_offset);
@@ -126,6 +129,7 @@ extern void btm_acl_update_conn_addr(uint8_t conn_handle, BD_ADDR address);
 
 extern void btm_pm_reset(void);
 extern void btm_pm_sm_alloc(uint8_t ind);
+extern void btm_pm_traffic(uint16_t hci_handle);
 extern void btm_pm_proc_cmd_status(uint8_t status);
 extern void btm_pm_proc_mode_change(uint8_t hci_status, uint16_t hci_handle,
                                     uint8_t mode, uint16_t interval);
@@ -164,6 +168,18 @@ extern void btm_read_def_esco_mode(enh_esco_params_t* p_parms);
 extern uint16_t btm_find_scb_by_handle(uint16_t handle);
 extern void btm_sco_flush_sco_data(uint16_t sco_inx);
 
+/* Internal functions provided by btm_iso.cc
+ *******************************************
+*/
+extern void btm_iso_init(void);
+extern void btm_iso_process_num_completed_pkts(uint8_t* p);
+extern bool btm_iso_disconnected(uint16_t handle, uint8_t reason);
+extern void btm_iso_process_cis_est_evt(uint8_t* p, uint16_t evt_len);
+extern void btm_iso_process_cis_req_evt(uint8_t* p, uint16_t evt_len);
+extern void btm_iso_process_big_cmpl_evt(uint8_t* p, uint16_t evt_len);
+extern void btm_iso_process_big_term_evt(uint8_t* p, uint16_t evt_len);
+extern void btm_iso_rcv_data(BT_HDR* p_msg);
+
 /* Internal functions provided by btm_devctl.cc
  *********************************************
 */
@@ -180,6 +196,8 @@ extern tBTM_STATUS btm_ble_read_resolving_list_entry(
     tBTM_SEC_DEV_REC* p_dev_rec);
 extern bool btm_ble_resolving_list_load_dev(tBTM_SEC_DEV_REC* p_dev_rec);
 extern void btm_ble_resolving_list_remove_dev(tBTM_SEC_DEV_REC* p_dev_rec);
+extern void btm_ble_resolving_list_note_resolution(tBTM_SEC_DEV_REC* p_dev_rec,
+                                                   bool by_controller);
 
 /* Vendor Specific Command complete evt handler */
 extern void btm_vsc_complete(uint8_t* p, uint16_t cc_opcode, uint16_t evt_len,
@@ -197,6 +215,7 @@ extern bool btm_dev_support_switch(BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void);
 extern tBTM_SEC_DEV_REC* btm_sec_alloc_dev(BD_ADDR bd_addr);
 extern void btm_sec_free_dev(tBTM_SEC_DEV_REC* p_dev_rec);
+extern void btm_sec_dev_index_clear(void);
 extern tBTM_SEC_DEV_REC* btm_find_dev(const BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_or_alloc_dev(BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle);
@@ -263,6 +282,7 @@ extern bool btm_ble_start_sec_check(BD_ADDR bd_addr, uint16_t psm,
                                     void* p_ref_data);
 
 extern tINQ_DB_ENT* btm_inq_db_new(BD_ADDR p_bda);
+extern void btm_inq_db_free(tINQ_DB_ENT* p_ent);
 
 extern void btm_rem_oob_req(uint8_t* p);
 extern void btm_read_local_oob_complete(uint8_t* p);
@@ -104,6 +104,22 @@ typedef struct {
                                       connection */
   BD_FEATURES peer_le_features; /* Peer LE Used features mask for the device */
 
+  /* High throughput policy, see BTM_SetAclHighThroughput */
+  bool high_tput;              /* the link prefers the 5 slot EDR packets */
+  bool tput_fallback;          /* the link fell back to 2-DH3 */
+  uint8_t tput_bad_samples;    /* consecutive samples the link could not keep
+                                  up in */
+  uint8_t tput_blocked_pct;    /* completions waited for in the last sample */
+  uint16_t tput_num_fallbacks; /* times the link fell back */
+  uint16_t tput_saved_pkt_types; /* packet types before the policy */
+  uint32_t tput_goodput_kbps;    /* payload completed in the last sample */
+  uint32_t tput_sent_pkts;       /* L2CAP counters at the last sample */
+  uint64_t tput_sent_bytes;
+  uint32_t tput_completed_pkts;
+  uint32_t tput_blocked_pkts;
+  period_ms_t tput_hold_off_ms; /* how long the next fallback lasts */
+  period_ms_t tput_retry_ms;    /* when the 5 slot packets are tried again */
+
 } tACL_CONN;
 
 /* Define the Device Management control structure
@@ -125,6 +141,11 @@ typedef struct {
   alarm_t* read_link_quality_timer;
   tBTM_CMPL_CB* p_link_qual_cmpl_cb; /* Callback function to be called when  */
                                      /* read link quality function completes */
+  alarm_t* read_failed_contact_counter_timer;
+  alarm_t* acl_tput_timer; /* samples the high throughput links */
+  tBTM_CMPL_CB* p_failed_contact_cmpl_cb; /* Callback function to be called */
+                                          /* when read failed contact counter */
+                                          /* function completes */
 
   alarm_t* read_inq_tx_power_timer;
   tBTM_CMPL_CB*
@@ -334,12 +355,28 @@ typedef struct {
   uint8_t hci_status;
 } tBTM_ESCO_INFO;
 
+#if (BTM_SCO_HCI_INCLUDED == TRUE)
+/* Statistics of the SCO data routed over HCI on a link */
+typedef struct {
+  uint32_t rx_packets;
+  uint32_t rx_octets;
+  uint32_t rx_status[4]; /* packets received, by tBTM_SCO_DATA_FLAG */
+  uint64_t last_rx_us;   /* time the last packet was received */
+  uint32_t last_gap_us;  /* interval between the last two packets */
+  uint32_t max_gap_us;
+  uint32_t jitter_us; /* smoothed variation of the intervals, as RFC 3550 */
+  uint32_t tx_packets;
+  uint32_t tx_truncated;
+} tSCO_DATA_STATS;
+#endif
+
 /* Define the structure used for SCO Management
 */
 typedef struct {
   tBTM_ESCO_INFO esco; /* Current settings             */
 #if (BTM_SCO_HCI_INCLUDED == TRUE)
   fixed_queue_t* xmit_data_q; /* SCO data transmitting queue  */
+  tSCO_DATA_STATS data_stats; /* SCO data of the connection    */
 #endif
   tBTM_SCO_CB* p_conn_cb; /* Callback for when connected  */
   tBTM_SCO_CB* p_disc_cb; /* Callback for when disconnect */
@@ -646,6 +683,19 @@ typedef struct {
   uint8_t link_ind;
 } tBTM_PM_SM_DATA;
 
+/* The gaps between the ACL packets of a link are counted in buckets, bounded
+ * by btm_pm_gap_bounds_ms, the last one holding the longer gaps */
+#define BTM_PM_GAP_BUCKETS 11
+
+typedef struct {
+  period_ms_t last_ms;                /* time of the last ACL packet */
+  uint32_t packets;                   /* ACL packets sent and received */
+  uint32_t gaps[BTM_PM_GAP_BUCKETS];  /* the gaps between the packets */
+  uint32_t sniff_count;               /* times the link went to sniff */
+  period_ms_t sniff_ms;               /* time spent in sniff mode */
+  period_ms_t mode_change_ms;         /* time of the last mode change */
+} tBTM_PM_TRAFFIC;
+
 typedef struct {
   tBTM_PM_PWR_MD req_mode[BTM_MAX_PM_RECORDS + 1]; /* the desired mode and
                                                       parameters of the
@@ -660,6 +710,7 @@ typedef struct {
 #endif
   tBTM_PM_STATE state; /* contains the current mode of the connection */
   bool chg_ind;        /* a request change indication */
+  tBTM_PM_TRAFFIC traffic; /* the ACL traffic of the connection */
 } tBTM_PM_MCB;
 
 #define BTM_PM_REC_NOT_USED 0
@@ -0,0 +1,802 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the functions of the LE isochronous channels: the CIG
+ *  and BIG set up through HCI, and the SDUs sent on their streams with the
+ *  ISO data packets, within the ISO buffers of the controller.
+ *
+ ******************************************************************************/
+
+#include <base/bind.h>
+#include <base/logging.h>
+#include <string.h>
+#include <vector>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "bt_types.h"
+#include "btm_api.h"
+#include "btm_int.h"
+#include "btm_iso_api.h"
+#include "device/include/controller.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+#include "iso_tx_scheduler.h"
+#include "osi/include/fixed_queue.h"
+
+/* The ISO data packet header, without time stamp */
+#define BTM_ISO_PREAMBLE_SIZE 4
+#define BTM_ISO_HANDLE_MASK 0x0FFF
+#define BTM_ISO_PB_COMPLETE_SDU (0x2 << 12)
+#define BTM_ISO_TS_FLAG 0x4000
+#define BTM_ISO_TIME_STAMP_SIZE 4
+#define BTM_ISO_DATA_LOAD_LENGTH_MASK 0x3FFF
+
+/* The data path of the SDUs through HCI, with the codec transparent to the
+ * controller */
+#define BTM_ISO_DATA_PATH_HCI 0x00
+#define BTM_ISO_CODEC_TRANSPARENT 0x03
+
+#define BTM_ISO_ST_UNUSED 0
+#define BTM_ISO_ST_CONFIGURED 1 /* CIS set in its CIG, or requested */
+#define BTM_ISO_ST_ESTABLISHED 2
+
+typedef struct {
+  uint8_t state;
+  uint16_t handle;
+  uint8_t group_id; /* CIG ID or BIG handle */
+  bool is_bis;
+  bool is_master;
+  bool tx_path; /* the input data path is set up */
+  uint32_t sdu_interval_us;
+  uint32_t trans_lat_us;
+  uint16_t max_sdu;
+  fixed_queue_t* tx_q; /* the SDUs waiting for the controller buffers */
+  uint16_t unacked;    /* ISO data packets sent, not completed */
+  uint32_t pkts_sent;
+  uint32_t pkts_completed;
+} tBTM_ISO_STREAM;
+
+typedef struct {
+  tBTM_ISO_CBACK* p_cback;
+  tBTM_ISO_DATA_CBACK* p_data_cback;
+  tBTM_ISO_STREAM streams[BTM_ISO_MAX_STREAMS];
+  bool credits_read;
+  uint16_t credits; /* ISO buffers of the controller free */
+  uint8_t rr_idx;   /* the stream to send from first */
+} tBTM_ISO_CB;
+
+static tBTM_ISO_CB btm_iso_cb;
+
+/* The timelines of the SDUs of each stream, of the same index */
+static IsoTxScheduler btm_iso_schedulers[BTM_ISO_MAX_STREAMS];
+
+static void btm_iso_send(void);
+
+static tBTM_ISO_STREAM* btm_iso_find(uint16_t handle) {
+  for (tBTM_ISO_STREAM& stream : btm_iso_cb.streams) {
+    if (stream.state != BTM_ISO_ST_UNUSED && stream.handle == handle)
+      return &stream;
+  }
+  return NULL;
+}
+
+static tBTM_ISO_STREAM* btm_iso_alloc(uint16_t handle) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (p_stream != NULL) return p_stream;
+
+  for (tBTM_ISO_STREAM& stream : btm_iso_cb.streams) {
+    if (stream.state == BTM_ISO_ST_UNUSED) {
+      memset(&stream, 0, sizeof(stream));
+      stream.state = BTM_ISO_ST_CONFIGURED;
+      stream.handle = handle;
+      stream.tx_q = fixed_queue_new(SIZE_MAX);
+      return &stream;
+    }
+  }
+  BTM_TRACE_ERROR("%s: no room for ISO stream 0x%04x", __func__, handle);
+  return NULL;
+}
+
+static IsoTxScheduler& btm_iso_scheduler(const tBTM_ISO_STREAM* p_stream) {
+  return btm_iso_schedulers[p_stream - btm_iso_cb.streams];
+}
+
+/* Drops the SDUs queued, and gives back the buffers of the packets the
+ * controller will not complete. */
+static void btm_iso_free(tBTM_ISO_STREAM* p_stream) {
+  btm_iso_cb.credits += p_stream->unacked;
+  fixed_queue_free(p_stream->tx_q, osi_free);
+  memset(p_stream, 0, sizeof(*p_stream));
+}
+
+static void btm_iso_notify(tBTM_ISO_EVT event, tBTM_ISO_EVT_DATA* p_data) {
+  if (btm_iso_cb.p_cback) (*btm_iso_cb.p_cback)(event, p_data);
+}
+
+/* The controller buffers taken by the ISO data packet |p_buf|, fragmented
+ * by the HCI layer to their size. */
+static uint16_t btm_iso_buffers_needed(const BT_HDR* p_buf) {
+  uint16_t data_size = controller_get_interface()->get_iso_data_size();
+  uint16_t load_len = p_buf->len - BTM_ISO_PREAMBLE_SIZE;
+  if (data_size == 0) return 1;
+  return (load_len + data_size - 1) / data_size;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_init
+ *
+ * Description      Initializes the ISO channels control block.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_init(void) {
+  for (tBTM_ISO_STREAM& stream : btm_iso_cb.streams) {
+    if (stream.state != BTM_ISO_ST_UNUSED)
+      fixed_queue_free(stream.tx_q, osi_free);
+  }
+  memset(&btm_iso_cb, 0, sizeof(btm_iso_cb));
+}
+
+void BTM_IsoRegister(tBTM_ISO_CBACK* p_cback,
+                     tBTM_ISO_DATA_CBACK* p_data_cback) {
+  btm_iso_cb.p_cback = p_cback;
+  btm_iso_cb.p_data_cback = p_data_cback;
+}
+
+bool BTM_IsoIsSupported(void) {
+  const controller_t* controller = controller_get_interface();
+  return controller->supports_ble() &&
+         controller->supports_ble_isochronous_channels() &&
+         controller->get_iso_data_size() != 0 &&
+         controller->get_iso_buffer_count() != 0;
+}
+
+static void btm_iso_cig_set_cmpl(tBTM_ISO_CIG_PARAMS params, uint8_t* p,
+                                 uint16_t len) {
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  STREAM_TO_UINT8(data.cig_set.status, p);
+  if (data.cig_set.status == HCI_SUCCESS && len >= 3) {
+    STREAM_TO_UINT8(data.cig_set.cig_id, p);
+    STREAM_TO_UINT8(data.cig_set.num_cis, p);
+    if (data.cig_set.num_cis > params.cis_count ||
+        len < 3 + 2 * data.cig_set.num_cis) {
+      BTM_TRACE_ERROR("%s: bad CIS count %d", __func__, data.cig_set.num_cis);
+      data.cig_set.status = HCI_ERR_UNSPECIFIED;
+      data.cig_set.num_cis = 0;
+    }
+
+    for (uint8_t i = 0; i < data.cig_set.num_cis; i++) {
+      STREAM_TO_UINT16(data.cig_set.cis_handles[i], p);
+      tBTM_ISO_STREAM* p_stream = btm_iso_alloc(data.cig_set.cis_handles[i]);
+      if (p_stream == NULL) continue;
+      p_stream->group_id = data.cig_set.cig_id;
+      p_stream->is_master = true;
+      p_stream->sdu_interval_us = params.sdu_interval_mtos_us;
+      p_stream->trans_lat_us = params.max_trans_lat_mtos_ms * 1000;
+      p_stream->max_sdu = params.cis_cfg[i].max_sdu_mtos;
+    }
+  }
+  btm_iso_notify(BTM_ISO_CIG_SET_EVT, &data);
+}
+
+tBTM_STATUS BTM_IsoSetCigParams(uint8_t cig_id,
+                                const tBTM_ISO_CIG_PARAMS* p_params) {
+  if (!BTM_IsoIsSupported()) return BTM_MODE_UNSUPPORTED;
+  if (p_params->cis_count == 0 ||
+      p_params->cis_count > BTM_ISO_MAX_GROUP_STREAMS)
+    return BTM_ILLEGAL_VALUE;
+
+  CIS_CFG cis_cfg[BTM_ISO_MAX_GROUP_STREAMS];
+  for (uint8_t i = 0; i < p_params->cis_count; i++) {
+    const tBTM_ISO_CIS_CFG& cfg = p_params->cis_cfg[i];
+    cis_cfg[i] = {cfg.cis_id,   cfg.max_sdu_mtos, cfg.max_sdu_stom,
+                  cfg.phy_mtos, cfg.phy_stom,     cfg.rtn_mtos,
+                  cfg.rtn_stom};
+  }
+
+  btsnd_hcic_ble_set_cig_params(
+      cig_id, p_params->sdu_interval_mtos_us, p_params->sdu_interval_stom_us,
+      p_params->sca, p_params->packing, p_params->framing,
+      p_params->max_trans_lat_mtos_ms, p_params->max_trans_lat_stom_ms,
+      p_params->cis_count, cis_cfg,
+      base::Bind(&btm_iso_cig_set_cmpl, *p_params));
+  return BTM_CMD_STARTED;
+}
+
+/* Reports an ISO command that failed before its event came. */
+static void btm_iso_cis_cmd_status(uint16_t cis_handle, uint8_t* p,
+                                   uint16_t len) {
+  uint8_t status;
+  STREAM_TO_UINT8(status, p);
+  if (status == HCI_SUCCESS) return;
+
+  BTM_TRACE_WARNING("%s: CIS 0x%04x status 0x%02x", __func__, cis_handle,
+                    status);
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.cis_established.status = status;
+  data.cis_established.cis_handle = cis_handle;
+  btm_iso_notify(BTM_ISO_CIS_ESTABLISHED_EVT, &data);
+}
+
+static void btm_iso_create_cis_status(std::vector<uint16_t> cis_handles,
+                                      uint8_t* p, uint16_t len) {
+  for (uint16_t cis_handle : cis_handles)
+    btm_iso_cis_cmd_status(cis_handle, p, len);
+}
+
+tBTM_STATUS BTM_IsoCreateCis(uint8_t num_cis, const uint16_t* cis_handles,
+                             const uint16_t* acl_handles) {
+  if (num_cis == 0 || num_cis > BTM_ISO_MAX_GROUP_STREAMS)
+    return BTM_ILLEGAL_VALUE;
+  for (uint8_t i = 0; i < num_cis; i++) {
+    tBTM_ISO_STREAM* p_stream = btm_iso_find(cis_handles[i]);
+    if (p_stream == NULL || p_stream->is_bis || !p_stream->is_master ||
+        p_stream->state != BTM_ISO_ST_CONFIGURED)
+      return BTM_WRONG_MODE;
+  }
+
+  btsnd_hcic_ble_create_cis(
+      num_cis, cis_handles, acl_handles,
+      base::Bind(&btm_iso_create_cis_status,
+                 std::vector<uint16_t>(cis_handles, cis_handles + num_cis)));
+  return BTM_CMD_STARTED;
+}
+
+static void btm_iso_remove_cig_cmpl(uint8_t* p, uint16_t len) {
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  STREAM_TO_UINT8(data.cig_removed.status, p);
+  if (len >= 2) STREAM_TO_UINT8(data.cig_removed.cig_id, p);
+
+  if (data.cig_removed.status == HCI_SUCCESS) {
+    for (tBTM_ISO_STREAM& stream : btm_iso_cb.streams) {
+      if (stream.state != BTM_ISO_ST_UNUSED && !stream.is_bis &&
+          stream.is_master && stream.group_id == data.cig_removed.cig_id)
+        btm_iso_free(&stream);
+    }
+  }
+  btm_iso_notify(BTM_ISO_CIG_REMOVED_EVT, &data);
+}
+
+tBTM_STATUS BTM_IsoRemoveCig(uint8_t cig_id) {
+  btsnd_hcic_ble_remove_cig(cig_id, base::Bind(&btm_iso_remove_cig_cmpl));
+  return BTM_CMD_STARTED;
+}
+
+static void btm_iso_reject_cis_cmpl(uint8_t* p, uint16_t len) {
+  uint8_t status;
+  STREAM_TO_UINT8(status, p);
+  if (status != HCI_SUCCESS)
+    BTM_TRACE_WARNING("%s: status 0x%02x", __func__, status);
+}
+
+void BTM_IsoAcceptCis(uint16_t cis_handle, bool accept, uint8_t reason) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(cis_handle);
+  if (accept) {
+    btsnd_hcic_ble_accept_cis_req(
+        cis_handle, base::Bind(&btm_iso_cis_cmd_status, cis_handle));
+    return;
+  }
+
+  if (p_stream != NULL) btm_iso_free(p_stream);
+  btsnd_hcic_ble_reject_cis_req(cis_handle, reason,
+                                base::Bind(&btm_iso_reject_cis_cmpl));
+}
+
+tBTM_STATUS BTM_IsoDisconnectCis(uint16_t cis_handle, uint8_t reason) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(cis_handle);
+  if (p_stream == NULL || p_stream->is_bis ||
+      p_stream->state != BTM_ISO_ST_ESTABLISHED)
+    return BTM_WRONG_MODE;
+
+  btsnd_hcic_disconnect(cis_handle, reason);
+  return BTM_CMD_STARTED;
+}
+
+static void btm_iso_create_big_status(uint8_t big_handle, uint8_t* p,
+                                      uint16_t len) {
+  uint8_t status;
+  STREAM_TO_UINT8(status, p);
+  if (status == HCI_SUCCESS) return;
+
+  BTM_TRACE_WARNING("%s: BIG %d status 0x%02x", __func__, big_handle, status);
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.big_created.status = status;
+  data.big_created.big_handle = big_handle;
+  btm_iso_notify(BTM_ISO_BIG_CREATED_EVT, &data);
+}
+
+/* The BIG parameters asked for, until the BIS handles are known */
+static struct {
+  uint8_t big_handle;
+  uint32_t sdu_interval_us;
+  uint16_t max_sdu;
+} btm_iso_pending_big;
+
+tBTM_STATUS BTM_IsoCreateBig(uint8_t big_handle,
+                             const tBTM_ISO_BIG_PARAMS* p_params) {
+  if (!BTM_IsoIsSupported()) return BTM_MODE_UNSUPPORTED;
+  if (p_params->num_bis == 0 || p_params->num_bis > BTM_ISO_MAX_GROUP_STREAMS)
+    return BTM_ILLEGAL_VALUE;
+
+  btm_iso_pending_big.big_handle = big_handle;
+  btm_iso_pending_big.sdu_interval_us = p_params->sdu_interval_us;
+  btm_iso_pending_big.max_sdu = p_params->max_sdu;
+
+  btsnd_hcic_ble_create_big(
+      big_handle, p_params->adv_handle, p_params->num_bis,
+      p_params->sdu_interval_us, p_params->max_sdu,
+      p_params->max_trans_lat_ms, p_params->rtn, p_params->phy,
+      p_params->packing, p_params->framing, p_params->enc,
+      p_params->bcst_code, base::Bind(&btm_iso_create_big_status, big_handle));
+  return BTM_CMD_STARTED;
+}
+
+static void btm_iso_term_big_status(uint8_t big_handle, uint8_t* p,
+                                    uint16_t len) {
+  uint8_t status;
+  STREAM_TO_UINT8(status, p);
+  if (status != HCI_SUCCESS)
+    BTM_TRACE_WARNING("%s: BIG %d status 0x%02x", __func__, big_handle,
+                      status);
+}
+
+tBTM_STATUS BTM_IsoTerminateBig(uint8_t big_handle, uint8_t reason) {
+  btsnd_hcic_ble_term_big(big_handle, reason,
+                          base::Bind(&btm_iso_term_big_status, big_handle));
+  return BTM_CMD_STARTED;
+}
+
+static void btm_iso_data_path_cmpl(uint8_t direction, bool removed,
+                                   uint16_t handle, uint8_t* p, uint16_t len) {
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  STREAM_TO_UINT8(data.data_path.status, p);
+  data.data_path.handle = handle;
+  data.data_path.direction = direction;
+  data.data_path.removed = removed;
+
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (data.data_path.status == HCI_SUCCESS && p_stream != NULL &&
+      direction == BTM_ISO_DATA_PATH_INPUT) {
+    if (removed) {
+      /* the SDUs queued never reached the controller */
+      p_stream->tx_path = false;
+      fixed_queue_flush(p_stream->tx_q, osi_free);
+    } else {
+      if (!btm_iso_cb.credits_read) {
+        btm_iso_cb.credits_read = true;
+        btm_iso_cb.credits =
+            controller_get_interface()->get_iso_buffer_count();
+      }
+      p_stream->tx_path = true;
+      btm_iso_scheduler(p_stream).Start(p_stream->sdu_interval_us,
+                                        p_stream->trans_lat_us);
+    }
+  }
+  btm_iso_notify(BTM_ISO_DATA_PATH_EVT, &data);
+}
+
+tBTM_STATUS BTM_IsoSetupDataPath(uint16_t handle, uint8_t direction) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (p_stream == NULL || p_stream->state != BTM_ISO_ST_ESTABLISHED)
+    return BTM_WRONG_MODE;
+  if (direction == BTM_ISO_DATA_PATH_INPUT && !BTM_IsoIsSupported())
+    return BTM_MODE_UNSUPPORTED;
+
+  btsnd_hcic_ble_setup_iso_data_path(
+      handle, direction, BTM_ISO_DATA_PATH_HCI, BTM_ISO_CODEC_TRANSPARENT, 0,
+      0, 0, base::Bind(&btm_iso_data_path_cmpl, direction, false, handle));
+  return BTM_CMD_STARTED;
+}
+
+tBTM_STATUS BTM_IsoRemoveDataPath(uint16_t handle, uint8_t direction) {
+  if (btm_iso_find(handle) == NULL) return BTM_WRONG_MODE;
+
+  /* The Remove ISO Data Path command takes a bit per direction */
+  btsnd_hcic_ble_remove_iso_data_path(
+      handle, 1 << direction,
+      base::Bind(&btm_iso_data_path_cmpl, direction, true, handle));
+  return BTM_CMD_STARTED;
+}
+
+tBTM_STATUS BTM_IsoWriteSdu(uint16_t handle, BT_HDR* p_buf,
+                            uint64_t timestamp_us) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (p_stream == NULL || !p_stream->tx_path) {
+    osi_free(p_buf);
+    return BTM_WRONG_MODE;
+  }
+  if (p_buf->offset < BTM_ISO_SDU_OFFSET ||
+      (p_stream->max_sdu != 0 && p_buf->len > p_stream->max_sdu)) {
+    BTM_TRACE_ERROR("%s: bad SDU of %d octets at offset %d", __func__,
+                    p_buf->len, p_buf->offset);
+    osi_free(p_buf);
+    return BTM_ILLEGAL_VALUE;
+  }
+
+  IsoTxScheduler& scheduler = btm_iso_scheduler(p_stream);
+  uint16_t seq = scheduler.Schedule(timestamp_us);
+  uint16_t sdu_len = p_buf->len;
+
+  p_buf->offset -= BTM_ISO_SDU_OFFSET;
+  p_buf->len += BTM_ISO_SDU_OFFSET;
+  uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+  UINT16_TO_STREAM(p, handle | BTM_ISO_PB_COMPLETE_SDU);
+  UINT16_TO_STREAM(p, p_buf->len - BTM_ISO_PREAMBLE_SIZE);
+  UINT16_TO_STREAM(p, seq);
+  UINT16_TO_STREAM(p, sdu_len);
+  p_buf->event = BT_EVT_TO_LM_HCI_ISO;
+
+  fixed_queue_enqueue(p_stream->tx_q, p_buf);
+
+  /* An SDU waiting longer than the transport latency would be sent too late
+   * to be played, and would hold back the ones after it */
+  while (fixed_queue_length(p_stream->tx_q) > scheduler.MaxQueued()) {
+    osi_free(fixed_queue_try_dequeue(p_stream->tx_q));
+    scheduler.Dropped();
+  }
+
+  btm_iso_send();
+  return BTM_SUCCESS;
+}
+
+bool BTM_IsoReadTxStats(uint16_t handle, tBTM_ISO_TX_STATS* p_stats) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (p_stream == NULL) return false;
+
+  const IsoTxScheduler& scheduler = btm_iso_scheduler(p_stream);
+  p_stats->sdus = scheduler.sdus();
+  p_stats->sdus_late = scheduler.late();
+  p_stats->sdus_lost = scheduler.lost();
+  p_stats->sdus_dropped = scheduler.dropped();
+  p_stats->pkts_sent = p_stream->pkts_sent;
+  p_stats->pkts_completed = p_stream->pkts_completed;
+  p_stats->queued = fixed_queue_length(p_stream->tx_q);
+  p_stats->max_queued = scheduler.MaxQueued();
+  return true;
+}
+
+/* Sends the SDUs queued while the controller has buffers for them, taking
+ * the streams in turn so that none waits on the others. */
+static void btm_iso_send(void) {
+  bool sent = true;
+  while (sent) {
+    sent = false;
+    for (uint8_t i = 0; i < BTM_ISO_MAX_STREAMS; i++) {
+      uint8_t idx = (btm_iso_cb.rr_idx + i) % BTM_ISO_MAX_STREAMS;
+      tBTM_ISO_STREAM* p_stream = &btm_iso_cb.streams[idx];
+      if (p_stream->state == BTM_ISO_ST_UNUSED || !p_stream->tx_path)
+        continue;
+
+      BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_peek_first(p_stream->tx_q);
+      if (p_buf == NULL) continue;
+
+      uint16_t needed = btm_iso_buffers_needed(p_buf);
+      if (needed > btm_iso_cb.credits) continue;
+
+      fixed_queue_try_dequeue(p_stream->tx_q);
+      btm_iso_cb.credits -= needed;
+      p_stream->unacked += needed;
+      p_stream->pkts_sent++;
+      btm_iso_cb.rr_idx = (idx + 1) % BTM_ISO_MAX_STREAMS;
+      bte_main_hci_send(p_buf, BT_EVT_TO_LM_HCI_ISO | LOCAL_BLE_CONTROLLER_ID);
+      sent = true;
+      break;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_process_num_completed_pkts
+ *
+ * Description      Gives back the controller buffers of the ISO data packets
+ *                  completed in a Number Of Completed Packets event, and
+ *                  sends the SDUs that waited for them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_process_num_completed_pkts(uint8_t* p) {
+  uint8_t num_handles;
+  bool completed = false;
+
+  STREAM_TO_UINT8(num_handles, p);
+  for (uint8_t xx = 0; xx < num_handles; xx++) {
+    uint16_t handle, num_sent;
+    STREAM_TO_UINT16(handle, p);
+    STREAM_TO_UINT16(num_sent, p);
+
+    tBTM_ISO_STREAM* p_stream = btm_iso_find(HCID_GET_HANDLE(handle));
+    if (p_stream == NULL) continue;
+
+    if (num_sent > p_stream->unacked) num_sent = p_stream->unacked;
+    p_stream->unacked -= num_sent;
+    p_stream->pkts_completed += num_sent;
+    btm_iso_cb.credits += num_sent;
+    completed = true;
+  }
+
+  if (completed) btm_iso_send();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_disconnected
+ *
+ * Description      Handles the disconnection of |handle| if it is a CIS.
+ *
+ * Returns          true if |handle| was a CIS.
+ *
+ ******************************************************************************/
+bool btm_iso_disconnected(uint16_t handle, uint8_t reason) {
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(handle);
+  if (p_stream == NULL || p_stream->is_bis) return false;
+
+  bool is_master = p_stream->is_master;
+  tBTM_ISO_EVT_DATA data;
+  memset(&data, 0, sizeof(data));
+  data.cis_disconnected.handle = handle;
+  data.cis_disconnected.reason = reason;
+
+  /* A CIS of the local CIG may be created again until the CIG is removed */
+  if (is_master) {
+    uint8_t cig_id = p_stream->group_id;
+    uint32_t sdu_interval_us = p_stream->sdu_interval_us;
+    uint32_t trans_lat_us = p_stream->trans_lat_us;
+    uint16_t max_sdu = p_stream->max_sdu;
+    btm_iso_free(p_stream);
+    p_stream = btm_iso_alloc(handle);
+    p_stream->group_id = cig_id;
+    p_stream->is_master = true;
+    p_stream->sdu_interval_us = sdu_interval_us;
+    p_stream->trans_lat_us = trans_lat_us;
+    p_stream->max_sdu = max_sdu;
+  } else {
+    btm_iso_free(p_stream);
+  }
+
+  btm_iso_notify(BTM_ISO_CIS_DISCONNECTED_EVT, &data);
+  btm_iso_send();
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_process_cis_est_evt
+ *
+ * Description      Processes the LE CIS Established event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_process_cis_est_evt(uint8_t* p, uint16_t evt_len) {
+  tBTM_ISO_EVT_DATA data;
+  uint32_t sync_delay;
+  uint8_t skip[7];
+
+  if (evt_len < 28) {
+    BTM_TRACE_ERROR("%s: bad event length %d", __func__, evt_len);
+    return;
+  }
+
+  memset(&data, 0, sizeof(data));
+  tBTM_ISO_CIS_ESTABLISHED& est = data.cis_established;
+  STREAM_TO_UINT8(est.status, p);
+  STREAM_TO_UINT16(est.cis_handle, p);
+  STREAM_TO_UINT24(sync_delay, p); /* CIG sync delay */
+  STREAM_TO_UINT24(sync_delay, p); /* CIS sync delay */
+  STREAM_TO_UINT24(est.trans_lat_mtos_us, p);
+  STREAM_TO_UINT24(est.trans_lat_stom_us, p);
+  /* PHYs, NSE, BN and FT */
+  STREAM_TO_ARRAY(skip, p, (int)sizeof(skip));
+  STREAM_TO_UINT16(est.max_pdu_mtos, p);
+  STREAM_TO_UINT16(est.max_pdu_stom, p);
+  STREAM_TO_UINT16(est.iso_interval, p);
+
+  tBTM_ISO_STREAM* p_stream = btm_iso_find(est.cis_handle);
+  if (p_stream != NULL) {
+    if (est.status != HCI_SUCCESS) {
+      if (!p_stream->is_master) btm_iso_free(p_stream);
+    } else {
+      p_stream->state = BTM_ISO_ST_ESTABLISHED;
+      if (p_stream->is_master) {
+        p_stream->trans_lat_us = est.trans_lat_mtos_us;
+      } else {
+        /* The SDU interval of the master is not told to the slave */
+        p_stream->sdu_interval_us = est.iso_interval * 1250;
+        p_stream->trans_lat_us = est.trans_lat_stom_us;
+        p_stream->max_sdu = 0;
+      }
+    }
+  }
+  btm_iso_notify(BTM_ISO_CIS_ESTABLISHED_EVT, &data);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_process_cis_req_evt
+ *
+ * Description      Processes the LE CIS Request event, of a CIS the peer
+ *                  asks to set up.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_process_cis_req_evt(uint8_t* p, uint16_t evt_len) {
+  tBTM_ISO_EVT_DATA data;
+
+  if (evt_len < 6) {
+    BTM_TRACE_ERROR("%s: bad event length %d", __func__, evt_len);
+    return;
+  }
+
+  memset(&data, 0, sizeof(data));
+  STREAM_TO_UINT16(data.cis_request.acl_handle, p);
+  STREAM_TO_UINT16(data.cis_request.cis_handle, p);
+  STREAM_TO_UINT8(data.cis_request.cig_id, p);
+  STREAM_TO_UINT8(data.cis_request.cis_id, p);
+
+  tBTM_ISO_STREAM* p_stream = NULL;
+  if (btm_iso_cb.p_cback != NULL)
+    p_stream = btm_iso_alloc(data.cis_request.cis_handle);
+  if (p_stream == NULL) {
+    btsnd_hcic_ble_reject_cis_req(data.cis_request.cis_handle,
+                                  HCI_ERR_HOST_REJECT_RESOURCES,
+                                  base::Bind(&btm_iso_reject_cis_cmpl));
+    return;
+  }
+  p_stream->group_id = data.cis_request.cig_id;
+  btm_iso_notify(BTM_ISO_CIS_REQUEST_EVT, &data);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_process_big_cmpl_evt
+ *
+ * Description      Processes the LE Create BIG Complete event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_process_big_cmpl_evt(uint8_t* p, uint16_t evt_len) {
+  tBTM_ISO_EVT_DATA data;
+  uint32_t sync_delay;
+  uint8_t skip[5];
+  uint16_t max_pdu, iso_interval;
+
+  if (evt_len < 18) {
+    BTM_TRACE_ERROR("%s: bad event length %d", __func__, evt_len);
+    return;
+  }
+
+  memset(&data, 0, sizeof(data));
+  tBTM_ISO_BIG_CREATED& big = data.big_created;
+  STREAM_TO_UINT8(big.status, p);
+  STREAM_TO_UINT8(big.big_handle, p);
+  STREAM_TO_UINT24(sync_delay, p);
+  STREAM_TO_UINT24(big.trans_lat_us, p);
+  /* PHY, NSE, BN, PTO and IRC */
+  STREAM_TO_ARRAY(skip, p, (int)sizeof(skip));
+  STREAM_TO_UINT16(max_pdu, p);
+  STREAM_TO_UINT16(iso_interval, p);
+  STREAM_TO_UINT8(big.num_bis, p);
+
+  if (big.status == HCI_SUCCESS &&
+      (big.num_bis > BTM_ISO_MAX_GROUP_STREAMS ||
+       evt_len < 18 + 2 * big.num_bis)) {
+    BTM_TRACE_ERROR("%s: bad BIS count %d", __func__, big.num_bis);
+    big.num_bis = 0;
+  }
+  if (big.status != HCI_SUCCESS) big.num_bis = 0;
+
+  for (uint8_t i = 0; i < big.num_bis; i++) {
+    STREAM_TO_UINT16(big.bis_handles[i], p);
+    tBTM_ISO_STREAM* p_stream = btm_iso_alloc(big.bis_handles[i]);
+    if (p_stream == NULL) continue;
+    p_stream->state = BTM_ISO_ST_ESTABLISHED;
+    p_stream->group_id = big.big_handle;
+    p_stream->is_bis = true;
+    p_stream->is_master = true;
+    p_stream->trans_lat_us = big.trans_lat_us;
+    if (btm_iso_pending_big.big_handle == big.big_handle) {
+      p_stream->sdu_interval_us = btm_iso_pending_big.sdu_interval_us;
+      p_stream->max_sdu = btm_iso_pending_big.max_sdu;
+    } else {
+      p_stream->sdu_interval_us = iso_interval * 1250;
+    }
+  }
+  btm_iso_notify(BTM_ISO_BIG_CREATED_EVT, &data);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_process_big_term_evt
+ *
+ * Description      Processes the LE Terminate BIG Complete event.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_process_big_term_evt(uint8_t* p, uint16_t evt_len) {
+  tBTM_ISO_EVT_DATA data;
+
+  if (evt_len < 2) {
+    BTM_TRACE_ERROR("%s: bad event length %d", __func__, evt_len);
+    return;
+  }
+
+  memset(&data, 0, sizeof(data));
+  STREAM_TO_UINT8(data.big_terminated.big_handle, p);
+  STREAM_TO_UINT8(data.big_terminated.reason, p);
+
+  for (tBTM_ISO_STREAM& stream : btm_iso_cb.streams) {
+    if (stream.state != BTM_ISO_ST_UNUSED && stream.is_bis &&
+        stream.group_id == data.big_terminated.big_handle)
+      btm_iso_free(&stream);
+  }
+  btm_iso_notify(BTM_ISO_BIG_TERMINATED_EVT, &data);
+  btm_iso_send();
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_iso_rcv_data
+ *
+ * Description      Gives the SDU of an ISO data packet received to the
+ *                  registered data callback, from its sequence number.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_iso_rcv_data(BT_HDR* p_msg) {
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint16_t handle, load_len;
+
+  if (p_msg->len < BTM_ISO_PREAMBLE_SIZE) {
+    osi_free(p_msg);
+    return;
+  }
+  STREAM_TO_UINT16(handle, p);
+  STREAM_TO_UINT16(load_len, p);
+
+  uint16_t header_len = BTM_ISO_PREAMBLE_SIZE;
+  if (handle & BTM_ISO_TS_FLAG) header_len += BTM_ISO_TIME_STAMP_SIZE;
+  handle &= BTM_ISO_HANDLE_MASK;
+  load_len &= BTM_ISO_DATA_LOAD_LENGTH_MASK;
+
+  if (btm_iso_cb.p_data_cback == NULL || btm_iso_find(handle) == NULL ||
+      p_msg->len < header_len ||
+      load_len != p_msg->len - BTM_ISO_PREAMBLE_SIZE) {
+    osi_free(p_msg);
+    return;
+  }
+
+  p_msg->offset += header_len;
+  p_msg->len -= header_len;
+  (*btm_iso_cb.p_data_cback)(handle, p_msg);
+}
@@ -69,8 +69,10 @@ void btm_init(void) {
 #if (BTM_SCO_INCLUDED == TRUE)
   btm_sco_init(); /* SCO Database and Structures (If included) */
 #endif
+  btm_iso_init(); /* LE isochronous streams */
 
   btm_cb.sec_dev_rec = list_new(osi_free);
+  btm_sec_dev_index_clear();
 
   btm_dev_init(); /* Device Manager Structures & HCI_Reset */
 }
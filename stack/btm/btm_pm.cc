@@ -30,6 +30,7 @@
 
 #define LOG_TAG "bt_btm_pm"
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include "l2c_int.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 /*****************************************************************************/
 /*      to handle different modes                                            */
@@ -71,11 +73,21 @@ const uint8_t
 
         BTM_PM_GET_MD1,  BTM_PM_GET_MD2,  BTM_PM_GET_COMP};
 
+/* The upper bounds of the first BTM_PM_GAP_BUCKETS - 1 buckets of the gaps
+ * between the ACL packets of a link */
+static const period_ms_t btm_pm_gap_bounds_ms[BTM_PM_GAP_BUCKETS - 1] = {
+    10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+
+/* The gaps needed to predict the end of the pause of a link */
+#define BTM_PM_MIN_PREDICT_GAPS 4
+
 /* function prototype */
 static int btm_pm_find_acl_ind(BD_ADDR remote_bda);
 static tBTM_STATUS btm_pm_snd_md_req(uint8_t pm_id, int link_ind,
                                      tBTM_PM_PWR_MD* p_mode);
 static const char* mode_to_string(tBTM_PM_MODE mode);
+static period_ms_t btm_pm_predict_idle(const tBTM_PM_TRAFFIC* p_traffic,
+                                       period_ms_t idle_ms);
 
 #if (BTM_PM_DEBUG == TRUE)
 const char* btm_pm_state_str[] = {"pm_active_state", "pm_hold_state",
@@ -378,6 +390,7 @@ void btm_pm_sm_alloc(uint8_t ind) {
   tBTM_PM_MCB* p_db = &btm_cb.pm_mode_db[ind]; /* per ACL link */
   memset(p_db, 0, sizeof(tBTM_PM_MCB));
   p_db->state = BTM_PM_ST_ACTIVE;
+  p_db->traffic.mode_change_ms = time_get_os_boottime_ms();
 #if (BTM_PM_DEBUG == TRUE)
   BTM_TRACE_DEBUG("btm_pm_sm_alloc ind:%d st:%d", ind, p_db->state);
 #endif  // BTM_PM_DEBUG
@@ -756,6 +769,14 @@ void btm_pm_proc_mode_change(uint8_t hci_status, uint16_t hci_handle,
   p_cb->state = mode;
   p_cb->interval = interval;
 
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  if ((old_state & ~BTM_PM_STORED_MASK) == BTM_PM_ST_SNIFF)
+    p_cb->traffic.sniff_ms += now_ms - p_cb->traffic.mode_change_ms;
+  if (mode == BTM_PM_ST_SNIFF &&
+      (old_state & ~BTM_PM_STORED_MASK) != BTM_PM_ST_SNIFF)
+    p_cb->traffic.sniff_count++;
+  p_cb->traffic.mode_change_ms = now_ms;
+
   BTM_TRACE_DEBUG("%s switched from %s to %s.", __func__,
                   mode_to_string(old_state), mode_to_string(p_cb->state));
 
@@ -937,6 +958,141 @@ tBTM_CONTRL_STATE BTM_PM_ReadControllerState(void) {
     return BTM_CONTRL_IDLE;
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_pm_traffic
+ *
+ * Description      This function is called by L2CAP for each ACL packet sent
+ *                  or received on a BR/EDR link, to count the gap since the
+ *                  previous one.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_pm_traffic(uint16_t hci_handle) {
+  uint8_t xx = btm_handle_to_acl_index(hci_handle);
+  if (xx >= MAX_L2CAP_LINKS) return;
+
+  tBTM_PM_TRAFFIC* p_traffic = &btm_cb.pm_mode_db[xx].traffic;
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  if (p_traffic->packets > 0) {
+    period_ms_t gap_ms = now_ms - p_traffic->last_ms;
+    int i = 0;
+    while (i < BTM_PM_GAP_BUCKETS - 1 && gap_ms >= btm_pm_gap_bounds_ms[i]) i++;
+    p_traffic->gaps[i]++;
+  }
+  p_traffic->packets++;
+  p_traffic->last_ms = now_ms;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_pm_predict_idle
+ *
+ * Description      Predicts the length of the current pause of a link, idle
+ *                  for |idle_ms|: the median of the past gaps at least as
+ *                  long as the pause already is.
+ *
+ * Returns          the predicted length of the whole pause, or 0 if there
+ *                  are too few such gaps, or if they are longer than the
+ *                  buckets tell.
+ *
+ ******************************************************************************/
+static period_ms_t btm_pm_predict_idle(const tBTM_PM_TRAFFIC* p_traffic,
+                                       period_ms_t idle_ms) {
+  int first = 0;
+  while (first < BTM_PM_GAP_BUCKETS - 1 &&
+         btm_pm_gap_bounds_ms[first] <= idle_ms)
+    first++;
+
+  uint32_t total = 0;
+  for (int i = first; i < BTM_PM_GAP_BUCKETS; i++)
+    total += p_traffic->gaps[i];
+  if (total < BTM_PM_MIN_PREDICT_GAPS) return 0;
+
+  uint32_t count = 0;
+  for (int i = first; i < BTM_PM_GAP_BUCKETS - 1; i++) {
+    count += p_traffic->gaps[i];
+    if (count * 2 >= total) return btm_pm_gap_bounds_ms[i];
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmReadIdle
+ *
+ * Description      This function returns how long an ACL link has had no
+ *                  traffic, and how long its past traffic predicts the pause
+ *                  to last.
+ *
+ * Returns          BTM_SUCCESS if successful,
+ *                  BTM_UNKNOWN_ADDR if bd addr is not active or bad
+ *
+ ******************************************************************************/
+tBTM_STATUS BTM_PmReadIdle(BD_ADDR remote_bda, period_ms_t* p_idle_ms,
+                           period_ms_t* p_predicted_ms) {
+  int acl_ind = btm_pm_find_acl_ind(remote_bda);
+  if (acl_ind == MAX_L2CAP_LINKS) return BTM_UNKNOWN_ADDR;
+
+  const tBTM_PM_TRAFFIC* p_traffic = &btm_cb.pm_mode_db[acl_ind].traffic;
+  period_ms_t since_ms = p_traffic->packets > 0 ? p_traffic->last_ms
+                                                : p_traffic->mode_change_ms;
+  *p_idle_ms = time_get_os_boottime_ms() - since_ms;
+  *p_predicted_ms = btm_pm_predict_idle(p_traffic, *p_idle_ms);
+  return BTM_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmDumpStatistics
+ *
+ * Description      This function dumps the power mode of the ACL links, and
+ *                  the statistics of their traffic, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_PmDumpStatistics(int fd) {
+  period_ms_t now_ms = time_get_os_boottime_ms();
+
+  dprintf(fd, "\nBluetooth Power Mode Statistics:\n");
+  dprintf(fd, "  Gap buckets (ms):");
+  for (int i = 0; i < BTM_PM_GAP_BUCKETS - 1; i++)
+    dprintf(fd, " <%" PRIu64, btm_pm_gap_bounds_ms[i]);
+  dprintf(fd, " more\n");
+
+  for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+    const tACL_CONN* p_acl = &btm_cb.acl_db[xx];
+    if (!p_acl->in_use || p_acl->transport != BT_TRANSPORT_BR_EDR) continue;
+
+    const tBTM_PM_MCB* p_cb = &btm_cb.pm_mode_db[xx];
+    const tBTM_PM_TRAFFIC* p_traffic = &p_cb->traffic;
+    period_ms_t sniff_ms = p_traffic->sniff_ms;
+    if ((p_cb->state & ~BTM_PM_STORED_MASK) == BTM_PM_ST_SNIFF)
+      sniff_ms += now_ms - p_traffic->mode_change_ms;
+    period_ms_t idle_ms =
+        now_ms - (p_traffic->packets > 0 ? p_traffic->last_ms
+                                         : p_traffic->mode_change_ms);
+
+    dprintf(fd, "  %02x:%02x:%02x:%02x:%02x:%02x mode: %s interval: %d\n",
+            p_acl->remote_addr[0], p_acl->remote_addr[1],
+            p_acl->remote_addr[2], p_acl->remote_addr[3],
+            p_acl->remote_addr[4], p_acl->remote_addr[5],
+            mode_to_string(p_cb->state), p_cb->interval);
+    dprintf(fd, "    Packets: %u idle: %" PRIu64 " ms predicted: %" PRIu64
+                " ms\n",
+            p_traffic->packets, idle_ms,
+            btm_pm_predict_idle(p_traffic, idle_ms));
+    dprintf(fd, "    Gaps:");
+    for (int i = 0; i < BTM_PM_GAP_BUCKETS; i++)
+      dprintf(fd, " %u", p_traffic->gaps[i]);
+    dprintf(fd, "\n");
+    dprintf(fd, "    Sniff: %u times, %" PRIu64 " ms\n",
+            p_traffic->sniff_count, sniff_ms);
+  }
+}
+
 static const char* mode_to_string(tBTM_PM_MODE mode) {
   switch (mode) {
     case BTM_PM_MD_ACTIVE:
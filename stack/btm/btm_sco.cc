@@ -23,6 +23,7 @@
  *
  ******************************************************************************/
 
+#include <stdio.h>
 #include <string.h>
 #include "bt_common.h"
 #include "bt_target.h"
@@ -36,6 +37,7 @@
 #include "hcidefs.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 #if (BTM_SCO_INCLUDED == TRUE)
 
@@ -231,6 +233,41 @@ void btm_sco_check_send_pkts(uint16_t sco_inx) {
     HCI_SCO_DATA_TO_LOWER(p_buf);
   }
 }
+
+/*******************************************************************************
+ *
+ * Function         btm_sco_update_rx_stats
+ *
+ * Description      This function accounts a packet of |pkt_size| octets and
+ *                  of Packet_Status_Flag |pkt_status|, received on a link of
+ *                  statistics |p_stats|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_sco_update_rx_stats(tSCO_DATA_STATS* p_stats,
+                                    uint8_t pkt_size, uint8_t pkt_status) {
+  uint64_t now_us = time_get_os_boottime_us();
+
+  p_stats->rx_packets++;
+  p_stats->rx_octets += pkt_size;
+  p_stats->rx_status[pkt_status & 0x03]++;
+
+  if (p_stats->last_rx_us != 0) {
+    uint32_t gap_us = (uint32_t)(now_us - p_stats->last_rx_us);
+    if (gap_us > p_stats->max_gap_us) p_stats->max_gap_us = gap_us;
+
+    /* J += (|D| - J) / 16, D being the change of the interval between two
+     * packets, which are sent periodically */
+    if (p_stats->rx_packets > 2) {
+      int32_t d = (int32_t)(gap_us - p_stats->last_gap_us);
+      if (d < 0) d = -d;
+      p_stats->jitter_us += (d - (int32_t)p_stats->jitter_us) / 16;
+    }
+    p_stats->last_gap_us = gap_us;
+  }
+  p_stats->last_rx_us = now_us;
+}
 #endif /* BTM_SCO_HCI_INCLUDED == TRUE */
 
 /*******************************************************************************
@@ -258,6 +295,9 @@ void btm_route_sco_data(BT_HDR* p_msg) {
 
   sco_inx = btm_find_scb_by_handle(handle);
   if (sco_inx != BTM_MAX_SCO_LINKS) {
+    btm_sco_update_rx_stats(&btm_cb.sco_cb.sco_db[sco_inx].data_stats,
+                            pkt_size, pkt_status);
+
     /* send data callback */
     if (!btm_cb.sco_cb.p_data_cb)
       /* if no data callback registered,  just free the buffer  */
@@ -323,14 +363,21 @@ tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf) {
       if (p_buf->len > BTM_SCO_DATA_SIZE_MAX) {
         p_buf->len = BTM_SCO_DATA_SIZE_MAX;
         status = BTM_SCO_BAD_LENGTH;
+        p_ccb->data_stats.tx_truncated++;
       }
 
       UINT8_TO_STREAM(p, (uint8_t)p_buf->len);
       p_buf->len += HCI_SCO_PREAMBLE_SIZE;
+      p_ccb->data_stats.tx_packets++;
 
-      fixed_queue_enqueue(p_ccb->xmit_data_q, p_buf);
-
-      btm_sco_check_send_pkts(sco_inx);
+      /* A packet every few milliseconds: it goes to the controller without a
+       * round trip through the transmit queue when nothing is waiting */
+      if (fixed_queue_is_empty(p_ccb->xmit_data_q)) {
+        HCI_SCO_DATA_TO_LOWER(p_buf);
+      } else {
+        fixed_queue_enqueue(p_ccb->xmit_data_q, p_buf);
+        btm_sco_check_send_pkts(sco_inx);
+      }
     }
   } else {
     osi_free(p_buf);
@@ -937,6 +984,9 @@ void btm_sco_connected(uint8_t hci_status, BD_ADDR bda, uint16_t hci_handle,
 
       p->state = SCO_ST_CONNECTED;
       p->hci_handle = hci_handle;
+#if (BTM_SCO_HCI_INCLUDED == TRUE)
+      memset(&p->data_stats, 0, sizeof(p->data_stats));
+#endif
 
       if (!btm_cb.sco_cb.esco_supported) {
         p->esco.data.link_type = BTM_LINK_TYPE_SCO;
@@ -1794,6 +1844,41 @@ static uint16_t btm_sco_voice_settings_to_legacy(enh_esco_params_t* p_params) {
   return (voice_settings);
 }
 
+/*******************************************************************************
+ *
+ * Function         BTM_ScoDumpStatistics
+ *
+ * Description      This function dumps the SCO links, and the statistics of
+ *                  their data routed over HCI, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTM_ScoDumpStatistics(int fd) {
+  dprintf(fd, "\nSCO Links:\n");
+#if (BTM_MAX_SCO_LINKS > 0)
+  for (int xx = 0; xx < BTM_MAX_SCO_LINKS; xx++) {
+    tSCO_CONN* p = &btm_cb.sco_cb.sco_db[xx];
+    if (p->state != SCO_ST_CONNECTED) continue;
+
+    dprintf(fd, "  Link %d handle 0x%04x type %d route %d\n", xx,
+            p->hci_handle, p->esco.data.link_type, btm_cb.sco_cb.sco_route);
+#if (BTM_SCO_HCI_INCLUDED == TRUE)
+    tSCO_DATA_STATS* p_stats = &p->data_stats;
+    dprintf(fd, "    Packets rx/tx (truncated)   : %u / %u (%u)\n",
+            p_stats->rx_packets, p_stats->tx_packets, p_stats->tx_truncated);
+    dprintf(fd, "    Octets rx                   : %u\n", p_stats->rx_octets);
+    dprintf(fd, "    Rx invalid/no data/lost     : %u / %u / %u\n",
+            p_stats->rx_status[BTM_SCO_DATA_PAR_ERR],
+            p_stats->rx_status[BTM_SCO_DATA_NONE],
+            p_stats->rx_status[BTM_SCO_DATA_PAR_LOST]);
+    dprintf(fd, "    Rx interval (max)/jitter    : %u (%u) / %u us\n",
+            p_stats->last_gap_us, p_stats->max_gap_us, p_stats->jitter_us);
+#endif
+  }
+#endif
+}
+
 #else /* SCO_EXCLUDED == TRUE (Link in stubs) */
 
 tBTM_STATUS BTM_CreateSco(BD_ADDR remote_bda, bool is_orig, uint16_t pkt_types,
@@ -1829,5 +1914,6 @@ tBTM_STATUS BTM_ChangeEScoLinkParms(uint16_t sco_inx,
 void BTM_EScoConnRsp(uint16_t sco_inx, uint8_t hci_status,
                      enh_esco_params_t* p_parms) {}
 uint8_t BTM_GetNumScoLinks(void) { return (0); }
+void BTM_ScoDumpStatistics(int fd) {}
 
 #endif /* If SCO is being used */
@@ -0,0 +1,183 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "inq_db_index.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const uint32_t fnv_offset_basis = 2166136261u;
+const uint32_t fnv_prime = 16777619u;
+
+}  // namespace
+
+const uint16_t InqDbIndex::kNone;
+
+InqDbIndex::InqDbIndex(size_t size)
+    : entries_(std::min(size, (size_t)kNone)) {
+  size_t num_slots = 1;
+  /* keep the load factor under 3/4, so that the probing stays short */
+  while (num_slots * 3 < entries_.size() * 4) num_slots <<= 1;
+  slots_.resize(num_slots);
+  Clear();
+}
+
+uint16_t InqDbIndex::Find(const BD_ADDR addr) const {
+  if (entries_.empty()) return kNone;
+
+  uint32_t mask = slots_.size() - 1;
+  for (uint32_t i = Slot(addr); slots_[i] != kNone; i = (i + 1) & mask) {
+    if (memcmp(entries_[slots_[i]].addr, addr, BD_ADDR_LEN) == 0)
+      return slots_[i];
+  }
+  return kNone;
+}
+
+void InqDbIndex::Touch(uint16_t index) {
+  if (lru_head_ == index) return;
+
+  LruUnlink(index);
+  LruPushFront(index);
+}
+
+uint16_t InqDbIndex::Insert(const BD_ADDR addr) {
+  if (entries_.empty()) return kNone;
+
+  /* make room by evicting the least recently used entry */
+  if (free_ == kNone) Erase(lru_tail_);
+
+  uint16_t index = free_;
+  Entry& entry = entries_[index];
+  free_ = entry.next;
+
+  memcpy(entry.addr, addr, BD_ADDR_LEN);
+
+  uint32_t mask = slots_.size() - 1;
+  uint32_t i = Slot(addr);
+  while (slots_[i] != kNone) i = (i + 1) & mask;
+  slots_[i] = index;
+  entry.slot = i;
+
+  Append(index);
+  LruPushFront(index);
+  size_++;
+  return index;
+}
+
+void InqDbIndex::Erase(uint16_t index) {
+  Unlink(index);
+  LruUnlink(index);
+
+  /* shift back the entries probed past the slot freed, so that the probing
+   * does not need tombstones */
+  uint32_t mask = slots_.size() - 1;
+  uint32_t i = entries_[index].slot;
+  slots_[i] = kNone;
+  for (uint32_t j = (i + 1) & mask; slots_[j] != kNone; j = (j + 1) & mask) {
+    uint32_t home = Slot(entries_[slots_[j]].addr);
+
+    /* the entry stays if its home slot lies cyclically in (i, j] */
+    bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+    if (stays) continue;
+
+    slots_[i] = slots_[j];
+    entries_[slots_[i]].slot = i;
+    slots_[j] = kNone;
+    i = j;
+  }
+
+  entries_[index].next = free_;
+  free_ = index;
+  size_--;
+}
+
+void InqDbIndex::Clear() {
+  std::fill(slots_.begin(), slots_.end(), kNone);
+
+  /* the free entries are taken in the order of the array */
+  free_ = kNone;
+  for (size_t i = entries_.size(); i > 0; i--) {
+    entries_[i - 1].next = free_;
+    free_ = i - 1;
+  }
+  first_ = last_ = kNone;
+  lru_head_ = lru_tail_ = kNone;
+  size_ = 0;
+}
+
+void InqDbIndex::Reorder(const std::vector<uint16_t>& order) {
+  first_ = last_ = kNone;
+  for (uint16_t index : order) Append(index);
+}
+
+uint32_t InqDbIndex::Slot(const BD_ADDR addr) const {
+  uint32_t hash = fnv_offset_basis;
+  for (size_t i = 0; i < BD_ADDR_LEN; i++) {
+    hash ^= addr[i];
+    hash *= fnv_prime;
+  }
+  return hash & (slots_.size() - 1);
+}
+
+void InqDbIndex::Append(uint16_t index) {
+  Entry& entry = entries_[index];
+  entry.prev = last_;
+  entry.next = kNone;
+  if (last_ != kNone)
+    entries_[last_].next = index;
+  else
+    first_ = index;
+  last_ = index;
+}
+
+void InqDbIndex::Unlink(uint16_t index) {
+  Entry& entry = entries_[index];
+  if (entry.prev != kNone)
+    entries_[entry.prev].next = entry.next;
+  else
+    first_ = entry.next;
+
+  if (entry.next != kNone)
+    entries_[entry.next].prev = entry.prev;
+  else
+    last_ = entry.prev;
+}
+
+void InqDbIndex::LruUnlink(uint16_t index) {
+  Entry& entry = entries_[index];
+  if (entry.lru_prev != kNone)
+    entries_[entry.lru_prev].lru_next = entry.lru_next;
+  else
+    lru_head_ = entry.lru_next;
+
+  if (entry.lru_next != kNone)
+    entries_[entry.lru_next].lru_prev = entry.lru_prev;
+  else
+    lru_tail_ = entry.lru_prev;
+}
+
+void InqDbIndex::LruPushFront(uint16_t index) {
+  Entry& entry = entries_[index];
+  entry.lru_prev = kNone;
+  entry.lru_next = lru_head_;
+  if (lru_head_ != kNone) entries_[lru_head_].lru_prev = index;
+  lru_head_ = index;
+  if (lru_tail_ == kNone) lru_tail_ = index;
+}
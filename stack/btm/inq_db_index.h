@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef INQ_DB_INDEX_H
+#define INQ_DB_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class indexes the entries of the inquiry database by the address of
+ * the devices, so that the inquiry results and advertising reports find
+ * their entry without scanning the database. The entries are the |size|
+ * first ones of an array, kept by the caller, and are designated by their
+ * index in it.
+ *
+ * The addresses are kept in an open-addressed hash table, probed linearly.
+ * The entries are also kept in two lists: in the order they were inserted,
+ * to walk through the database, and from the most to the least recently
+ * used, to pick the entry evicted once all of them are used. */
+class InqDbIndex {
+ public:
+  static const uint16_t kNone = 0xFFFF;
+
+  /* Indexes up to |size| entries, at most 65535. */
+  explicit InqDbIndex(size_t size);
+
+  /* Returns the index of the entry of |addr|, or kNone. */
+  uint16_t Find(const BD_ADDR addr) const;
+
+  /* Makes the entry |index| the most recently used. */
+  void Touch(uint16_t index);
+
+  /* Returns the index of a new entry for |addr|, which must not be indexed
+   * yet, last in the insertion order and the most recently used. Once all
+   * the entries are used, the least recently used one is evicted for it.
+   * Returns kNone if the index was created with a |size| of 0. */
+  uint16_t Insert(const BD_ADDR addr);
+
+  /* Frees the entry |index|. */
+  void Erase(uint16_t index);
+
+  /* Frees all the entries. */
+  void Clear();
+
+  /* Returns the first entry in the insertion order, or kNone. */
+  uint16_t First() const { return first_; }
+
+  /* Returns the entry following |index| in the insertion order, or kNone. */
+  uint16_t Next(uint16_t index) const { return entries_[index].next; }
+
+  /* Sets the order the entries are walked through in: |order| must hold
+   * each entry used once. */
+  void Reorder(const std::vector<uint16_t>& order);
+
+  /* Returns the number of entries used. */
+  size_t Size() const { return size_; }
+
+ private:
+  struct Entry {
+    uint8_t addr[BD_ADDR_LEN];
+
+    /* the insertion order, where |next| also links the free entries; the
+     * least recently used list; and the slot of the entry */
+    uint16_t prev;
+    uint16_t next;
+    uint16_t lru_prev;
+    uint16_t lru_next;
+    uint32_t slot;
+  };
+
+  uint32_t Slot(const BD_ADDR addr) const;
+
+  void Append(uint16_t index);
+  void Unlink(uint16_t index);
+  void LruUnlink(uint16_t index);
+  void LruPushFront(uint16_t index);
+
+  /* |slots_| holds the index of the entries, or kNone, its size being a power
+   * of two */
+  std::vector<uint16_t> slots_;
+  std::vector<Entry> entries_;
+  uint16_t free_ = kNone;
+  uint16_t first_ = kNone;
+  uint16_t last_ = kNone;
+  uint16_t lru_head_ = kNone;
+  uint16_t lru_tail_ = kNone;
+  size_t size_ = 0;
+};
+
+#endif  // INQ_DB_INDEX_H
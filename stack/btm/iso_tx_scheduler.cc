@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "iso_tx_scheduler.h"
+
+void IsoTxScheduler::Start(uint32_t sdu_interval_us,
+                           uint32_t max_transport_latency_us) {
+  sdu_interval_us_ = sdu_interval_us;
+  max_queued_ = 1;
+  if (sdu_interval_us != 0 && max_transport_latency_us > sdu_interval_us)
+    max_queued_ = max_transport_latency_us / sdu_interval_us;
+  anchored_ = false;
+  anchor_us_ = 0;
+  next_seq_ = 0;
+  sdus_ = 0;
+  late_ = 0;
+  lost_ = 0;
+  dropped_ = 0;
+}
+
+uint16_t IsoTxScheduler::Schedule(uint64_t timestamp_us) {
+  sdus_++;
+  if (!anchored_ || sdu_interval_us_ == 0) {
+    anchored_ = true;
+    anchor_us_ = timestamp_us;
+    return (uint16_t)next_seq_++;
+  }
+
+  /* the interval the SDU starts in, to the nearest one */
+  uint64_t seq = 0;
+  if (timestamp_us > anchor_us_)
+    seq = (timestamp_us - anchor_us_ + sdu_interval_us_ / 2) /
+          sdu_interval_us_;
+
+  if (seq < next_seq_) {
+    late_++;
+    seq = next_seq_;
+  } else if (seq > next_seq_) {
+    lost_ += seq - next_seq_;
+  }
+  next_seq_ = seq + 1;
+  return (uint16_t)seq;
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef ISO_TX_SCHEDULER_H
+#define ISO_TX_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* This class numbers the SDUs sent on an ISO channel from the audio clock:
+ * the sequence number of an SDU is the number of SDU intervals between the
+ * time of its first sample and the one of the first SDU, so that the
+ * controller sends each SDU in the interval it belongs to, however late the
+ * encoder ran. An SDU that would take the number of one already sent, for
+ * the jitter of the encoder, takes the next one instead; the numbers skipped,
+ * for SDUs never produced, are counted as lost.
+ *
+ * It also bounds the SDUs waiting for the controller buffers to those that
+ * can still be sent within the transport latency: the older ones are dropped
+ * rather than delaying all the next ones. */
+class IsoTxScheduler {
+ public:
+  /* Starts numbering the SDUs of |sdu_interval_us| from the next one, with
+   * at most |max_transport_latency_us| between their production and their
+   * transmission. */
+  void Start(uint32_t sdu_interval_us, uint32_t max_transport_latency_us);
+
+  /* Returns the sequence number of the SDU whose first sample is at
+   * |timestamp_us| of the audio clock. */
+  uint16_t Schedule(uint64_t timestamp_us);
+
+  /* Records that a queued SDU was dropped, too old to be sent. */
+  void Dropped() { dropped_++; }
+
+  /* The number of SDUs that may wait for the controller buffers. */
+  size_t MaxQueued() const { return max_queued_; }
+
+  bool started() const { return sdu_interval_us_ != 0; }
+  uint32_t sdu_interval_us() const { return sdu_interval_us_; }
+
+  /* The SDUs numbered, those numbered after the one they belonged to, the
+   * ones skipped, and the ones dropped. */
+  uint32_t sdus() const { return sdus_; }
+  uint32_t late() const { return late_; }
+  uint32_t lost() const { return lost_; }
+  uint32_t dropped() const { return dropped_; }
+
+ private:
+  uint32_t sdu_interval_us_ = 0;
+  size_t max_queued_ = 1;
+  bool anchored_ = false;
+  uint64_t anchor_us_ = 0;
+  uint64_t next_seq_ = 0;
+
+  uint32_t sdus_ = 0;
+  uint32_t late_ = 0;
+  uint32_t lost_ = 0;
+  uint32_t dropped_ = 0;
+};
+
+#endif  // ISO_TX_SCHEDULER_H
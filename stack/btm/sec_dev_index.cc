@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "sec_dev_index.h"
+
+#include <string.h>
+
+namespace {
+
+const uint32_t fnv_offset_basis = 2166136261u;
+const uint32_t fnv_prime = 16777619u;
+
+}  // namespace
+
+SecDevIndex::SecDevIndex(size_t size) {
+  size_t num_slots = 1;
+  while (num_slots < size) num_slots <<= 1;
+  addr_slots_.resize(num_slots);
+  handle_slots_.resize(num_slots);
+  Clear();
+}
+
+void* SecDevIndex::FindAddr(const BD_ADDR addr) const {
+  const AddrSlot& slot = addr_slots_[AddrSlotOf(addr)];
+  if (slot.record == NULL || memcmp(slot.addr, addr, BD_ADDR_LEN) != 0)
+    return NULL;
+  return slot.record;
+}
+
+void* SecDevIndex::FindHandle(uint16_t handle) const {
+  const HandleSlot& slot = handle_slots_[HandleSlotOf(handle)];
+  if (slot.record == NULL || slot.handle != handle) return NULL;
+  return slot.record;
+}
+
+void SecDevIndex::PutAddr(const BD_ADDR addr, void* record) {
+  AddrSlot& slot = addr_slots_[AddrSlotOf(addr)];
+  memcpy(slot.addr, addr, BD_ADDR_LEN);
+  slot.record = record;
+}
+
+void SecDevIndex::PutHandle(uint16_t handle, void* record) {
+  HandleSlot& slot = handle_slots_[HandleSlotOf(handle)];
+  slot.handle = handle;
+  slot.record = record;
+}
+
+void SecDevIndex::Erase(const void* record) {
+  /* the records are erased when they are freed, far less often than they
+   * are looked up */
+  for (AddrSlot& slot : addr_slots_) {
+    if (slot.record == record) slot.record = NULL;
+  }
+  for (HandleSlot& slot : handle_slots_) {
+    if (slot.record == record) slot.record = NULL;
+  }
+}
+
+void SecDevIndex::Clear() {
+  for (AddrSlot& slot : addr_slots_) slot.record = NULL;
+  for (HandleSlot& slot : handle_slots_) slot.record = NULL;
+}
+
+size_t SecDevIndex::AddrSlotOf(const BD_ADDR addr) const {
+  uint32_t hash = fnv_offset_basis;
+  for (size_t i = 0; i < BD_ADDR_LEN; i++) {
+    hash ^= addr[i];
+    hash *= fnv_prime;
+  }
+  return hash & (addr_slots_.size() - 1);
+}
+
+size_t SecDevIndex::HandleSlotOf(uint16_t handle) const {
+  /* the controllers mostly hand out the handles in sequence */
+  return handle & (handle_slots_.size() - 1);
+}
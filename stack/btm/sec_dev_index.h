@@ -0,0 +1,82 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef SEC_DEV_INDEX_H
+#define SEC_DEV_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "stack/include/bt_types.h"
+
+/* This class remembers where the security records of the devices were last
+ * found, by their address and by their connection handles, so that the HCI
+ * events find their record without walking the list of records.
+ *
+ * The records are only designated, and their fields change outside of the
+ * index: the callers check that a record found still has the address or the
+ * handle it was looked up by, and walk the list of records otherwise. A
+ * record must be erased from the index before it is freed.
+ *
+ * The addresses and the handles are kept in two direct mapped tables: a key
+ * may evict another one hashing to the same slot. */
+class SecDevIndex {
+ public:
+  /* Remembers up to |size| addresses and |size| handles, rounded up to a
+   * power of two. */
+  explicit SecDevIndex(size_t size);
+
+  /* Returns the record last put for |addr|, or NULL. */
+  void* FindAddr(const BD_ADDR addr) const;
+
+  /* Returns the record last put for |handle|, or NULL. */
+  void* FindHandle(uint16_t handle) const;
+
+  /* Remembers |record| for |addr|. */
+  void PutAddr(const BD_ADDR addr, void* record);
+
+  /* Remembers |record| for |handle|. */
+  void PutHandle(uint16_t handle, void* record);
+
+  /* Forgets all the keys of |record|. */
+  void Erase(const void* record);
+
+  /* Forgets all the records. */
+  void Clear();
+
+ private:
+  struct AddrSlot {
+    uint8_t addr[BD_ADDR_LEN];
+    void* record;
+  };
+
+  struct HandleSlot {
+    uint16_t handle;
+    void* record;
+  };
+
+  size_t AddrSlotOf(const BD_ADDR addr) const;
+  size_t HandleSlotOf(uint16_t handle) const;
+
+  /* both of the same size, a power of two */
+  std::vector<AddrSlot> addr_slots_;
+  std::vector<HandleSlot> handle_slots_;
+};
+
+#endif  // SEC_DEV_INDEX_H
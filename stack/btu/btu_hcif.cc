@@ -41,6 +41,7 @@
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
+#include "hci_event_filter.h"
 #include "hci_layer.h"
 #include "hcimsgs.h"
 #include "l2c_int.h"
@@ -127,6 +128,105 @@ static void btu_ble_rc_param_req_evt(uint8_t* p);
 static void btu_ble_proc_enhanced_conn_cmpl(uint8_t* p, uint16_t evt_len);
 #endif
 
+/* The events handled by btu_hcif_process_event. The HCI layer drops the
+ * others before they reach the BTU thread. */
+static const uint8_t btu_hcif_events[] = {
+    HCI_INQUIRY_COMP_EVT,
+    HCI_INQUIRY_RESULT_EVT,
+    HCI_INQUIRY_RSSI_RESULT_EVT,
+    HCI_EXTENDED_INQUIRY_RESULT_EVT,
+    HCI_CONNECTION_COMP_EVT,
+    HCI_CONNECTION_REQUEST_EVT,
+    HCI_DISCONNECTION_COMP_EVT,
+    HCI_AUTHENTICATION_COMP_EVT,
+    HCI_RMT_NAME_REQUEST_COMP_EVT,
+    HCI_ENCRYPTION_CHANGE_EVT,
+    HCI_ENCRYPTION_KEY_REFRESH_COMP_EVT,
+    HCI_READ_RMT_FEATURES_COMP_EVT,
+    HCI_READ_RMT_EXT_FEATURES_COMP_EVT,
+    HCI_READ_RMT_VERSION_COMP_EVT,
+    HCI_QOS_SETUP_COMP_EVT,
+    HCI_COMMAND_COMPLETE_EVT,
+    HCI_COMMAND_STATUS_EVT,
+    HCI_HARDWARE_ERROR_EVT,
+    HCI_FLUSH_OCCURED_EVT,
+    HCI_ROLE_CHANGE_EVT,
+    HCI_NUM_COMPL_DATA_PKTS_EVT,
+    HCI_MODE_CHANGE_EVT,
+    HCI_PIN_CODE_REQUEST_EVT,
+    HCI_LINK_KEY_REQUEST_EVT,
+    HCI_LINK_KEY_NOTIFICATION_EVT,
+    HCI_LOOPBACK_COMMAND_EVT,
+    HCI_DATA_BUF_OVERFLOW_EVT,
+    HCI_MAX_SLOTS_CHANGED_EVT,
+    HCI_READ_CLOCK_OFF_COMP_EVT,
+    HCI_CONN_PKT_TYPE_CHANGE_EVT,
+    HCI_QOS_VIOLATION_EVT,
+    HCI_PAGE_SCAN_MODE_CHANGE_EVT,
+    HCI_PAGE_SCAN_REP_MODE_CHNG_EVT,
+    HCI_ESCO_CONNECTION_COMP_EVT,
+    HCI_ESCO_CONNECTION_CHANGED_EVT,
+#if (BTM_SSR_INCLUDED == TRUE)
+    HCI_SNIFF_SUB_RATE_EVT,
+#endif
+    HCI_RMT_HOST_SUP_FEAT_NOTIFY_EVT,
+    HCI_IO_CAPABILITY_REQUEST_EVT,
+    HCI_IO_CAPABILITY_RESPONSE_EVT,
+    HCI_USER_CONFIRMATION_REQUEST_EVT,
+    HCI_USER_PASSKEY_REQUEST_EVT,
+    HCI_REMOTE_OOB_DATA_REQUEST_EVT,
+    HCI_SIMPLE_PAIRING_COMPLETE_EVT,
+    HCI_USER_PASSKEY_NOTIFY_EVT,
+    HCI_KEYPRESS_NOTIFY_EVT,
+#if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
+    HCI_ENHANCED_FLUSH_COMPLETE_EVT,
+#endif
+    HCI_BLE_EVENT,
+    HCI_VENDOR_SPECIFIC_EVT,
+};
+
+static const uint8_t btu_hcif_ble_subevents[] = {
+    HCI_BLE_ADV_PKT_RPT_EVT,
+    HCI_BLE_CONN_COMPLETE_EVT,
+    HCI_BLE_LL_CONN_PARAM_UPD_EVT,
+    HCI_BLE_READ_REMOTE_FEAT_CMPL_EVT,
+    HCI_BLE_LTK_REQ_EVT,
+#if (BLE_PRIVACY_SPT == TRUE)
+    HCI_BLE_ENHANCED_CONN_COMPLETE_EVT,
+#endif
+#if (BLE_LLT_INCLUDED == TRUE)
+    HCI_BLE_RC_PARAM_REQ_EVT,
+#endif
+    HCI_BLE_DATA_LENGTH_CHANGE_EVT,
+    HCI_LE_PHY_UPDATE_COMPLETE_EVT,
+    HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT,
+    HCI_LE_ADVERTISING_SET_TERMINATED_EVT,
+    HCI_BLE_CIS_EST_EVT,
+    HCI_BLE_CIS_REQ_EVT,
+    HCI_BLE_CREATE_BIG_CPL_EVT,
+    HCI_BLE_TERM_BIG_CPL_EVT,
+};
+
+/*******************************************************************************
+ *
+ * Function         btu_hcif_subscribe_events
+ *
+ * Description      This function subscribes the stack to the events handled
+ *                  by btu_hcif_process_event, or unsubscribes it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btu_hcif_subscribe_events(bool subscribe) {
+  if (subscribe) {
+    hci_event_filter_subscribe(btu_hcif_events, sizeof(btu_hcif_events),
+                               btu_hcif_ble_subevents,
+                               sizeof(btu_hcif_ble_subevents));
+  } else {
+    hci_event_filter_subscribe(NULL, 0, NULL, 0);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         btu_hcif_process_event
@@ -343,6 +443,22 @@ void btu_hcif_process_event(UNUSED_ATTR uint8_t controller_id, BT_HDR* p_msg) {
         case HCI_LE_ADVERTISING_SET_TERMINATED_EVT:
           btm_le_on_advertising_set_terminated(p, hci_evt_len);
           break;
+
+        case HCI_BLE_CIS_EST_EVT:
+          btm_iso_process_cis_est_evt(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_CIS_REQ_EVT:
+          btm_iso_process_cis_req_evt(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_CREATE_BIG_CPL_EVT:
+          btm_iso_process_big_cmpl_evt(p, ble_evt_len);
+          break;
+
+        case HCI_BLE_TERM_BIG_CPL_EVT:
+          btm_iso_process_big_term_evt(p, ble_evt_len);
+          break;
       }
       break;
     }
@@ -485,7 +601,7 @@ static void btu_hcif_command_status_evt_with_cb(uint8_t status, BT_HDR* command,
 void btu_hcif_send_cmd_with_cb(const tracked_objects::Location& posted_from,
                                uint16_t opcode, uint8_t* params,
                                uint8_t params_len, hci_cmd_cb cb) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + params_len;
@@ -523,6 +639,8 @@ static void btu_hcif_inquiry_comp_evt(uint8_t* p) {
 
   STREAM_TO_UINT8(status, p);
 
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, false);
+
   /* Tell inquiry processing that we are done */
   btm_process_inq_complete(status, BTM_BR_INQUIRY_MASK);
 }
@@ -660,6 +778,9 @@ static void btu_hcif_disconnection_comp_evt(uint8_t* p) {
 
   handle = HCID_GET_HANDLE(handle);
 
+  /* The CIS are not known to L2CAP nor to the security manager */
+  if (btm_iso_disconnected(handle, reason)) return;
+
 #if (BTM_SCO_INCLUDED == TRUE)
   /* If L2CAP doesn't know about it, send it to SCO */
   if (!l2c_link_hci_disc_comp(handle, reason)) btm_sco_removed(handle, reason);
@@ -911,6 +1032,10 @@ static void btu_hcif_hdl_command_complete(uint16_t opcode, uint8_t* p,
       btm_read_rssi_complete(p);
       break;
 
+    case HCI_READ_FAILED_CONTACT_COUNT:
+      btm_read_failed_contact_counter_complete(p);
+      break;
+
     case HCI_READ_TRANSMIT_POWER_LEVEL:
       btm_read_tx_power_complete(p, false);
       break;
@@ -1078,6 +1203,9 @@ static void btu_hcif_hdl_command_status(uint16_t opcode, uint8_t status,
       if (status != HCI_SUCCESS) {
         switch (opcode) {
           case HCI_INQUIRY:
+            hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY,
+                                                false);
+
             /* Tell inquiry processing that we are done */
             btm_process_inq_complete(status, BTM_BR_INQUIRY_MASK);
             break;
@@ -1286,6 +1414,9 @@ static void btu_hcif_num_compl_data_pkts_evt(uint8_t* p) {
   /* Process for L2CAP and SCO */
   l2c_link_process_num_completed_pkts(p);
 
+  /* And for the ISO streams */
+  btm_iso_process_num_completed_pkts(p);
+
   /* Send on to SCO */
   /*?? No SCO for now */
 }
@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "bt_target.h"
+#include "bta_sys.h"
 #include "btm_int.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -30,6 +31,7 @@
 #include "gatt_int.h"
 #include "l2c_int.h"
 #include "osi/include/alarm.h"
+#include "osi/include/executor.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
 #include "osi/include/thread.h"
@@ -39,10 +41,14 @@
 // RT priority for audio-related tasks
 #define BTU_TASK_RT_PRIORITY 1
 
+// Worker threads of the executor for the CPU-heavy work of the stack
+#define BT_EXECUTOR_NUM_WORKERS 2
+
 extern fixed_queue_t* btif_msg_queue;
 
-// Communication queue from bta thread to bt_workqueue.
-fixed_queue_t* btu_bta_msg_queue;
+// Communication queues from bta thread to bt_workqueue, one per lane of
+// bta_sys.
+fixed_queue_t* btu_bta_msg_queue[BTA_SYS_LANE_MAX];
 
 // Communication queue from hci thread to bt_workqueue.
 extern fixed_queue_t* btu_hci_msg_queue;
@@ -53,6 +59,12 @@ fixed_queue_t* btu_general_alarm_queue;
 thread_t* bt_workqueue_thread;
 static const char* BT_WORKQUEUE_NAME = "bt_workqueue";
 
+// Runs the CPU-heavy work of the stack, e.g. the SMP ECC computations, off
+// bt_workqueue. The completions are posted back to bt_workqueue. May be NULL,
+// in which case the work is done in place.
+executor_t* bt_executor;
+static const char* BT_EXECUTOR_NAME = "bt_executor";
+
 extern void PLATFORM_DisableHciTransport(uint8_t bDisable);
 /*****************************************************************************
  *                          V A R I A B L E S                                *
@@ -86,6 +98,8 @@ void btu_init_core(void) {
   SMP_Init();
 
   btm_ble_init();
+
+  btu_hcif_subscribe_events(true);
 }
 
 /*****************************************************************************
@@ -99,10 +113,14 @@ void btu_init_core(void) {
  *
  *****************************************************************************/
 void btu_free_core(void) {
+  btu_hcif_subscribe_events(false);
+
   /* Free the mandatory core stack components */
   l2c_free();
 
   gatt_free();
+
+  smp_key_pair_pool_free();
 }
 
 /*****************************************************************************
@@ -120,8 +138,10 @@ void btu_free_core(void) {
 void BTU_StartUp(void) {
   btu_trace_level = HCI_INITIAL_TRACE_LEVEL;
 
-  btu_bta_msg_queue = fixed_queue_new(SIZE_MAX);
-  if (btu_bta_msg_queue == NULL) goto error_exit;
+  for (int lane = 0; lane < BTA_SYS_LANE_MAX; lane++) {
+    btu_bta_msg_queue[lane] = fixed_queue_new(SIZE_MAX);
+    if (btu_bta_msg_queue[lane] == NULL) goto error_exit;
+  }
 
   btu_general_alarm_queue = fixed_queue_new(SIZE_MAX);
   if (btu_general_alarm_queue == NULL) goto error_exit;
@@ -131,6 +151,10 @@ void BTU_StartUp(void) {
 
   thread_set_rt_priority(bt_workqueue_thread, BTU_TASK_RT_PRIORITY);
 
+  bt_executor = executor_new(BT_EXECUTOR_NAME, BT_EXECUTOR_NUM_WORKERS);
+  if (bt_executor == NULL)
+    LOG_WARN(LOG_TAG, "%s Unable to create bt_executor", __func__);
+
   // Continue startup on bt workqueue thread.
   thread_post(bt_workqueue_thread, btu_task_start_up, NULL);
   return;
@@ -144,12 +168,18 @@ error_exit:;
 void BTU_ShutDown(void) {
   btu_task_shut_down(NULL);
 
-  fixed_queue_free(btu_bta_msg_queue, NULL);
-  btu_bta_msg_queue = NULL;
+  for (int lane = 0; lane < BTA_SYS_LANE_MAX; lane++) {
+    fixed_queue_free(btu_bta_msg_queue[lane], NULL);
+    btu_bta_msg_queue[lane] = NULL;
+  }
 
   fixed_queue_free(btu_general_alarm_queue, NULL);
   btu_general_alarm_queue = NULL;
 
+  // Done before freeing bt_workqueue, as the completions are posted to it
+  executor_free(bt_executor);
+  bt_executor = NULL;
+
   thread_free(bt_workqueue_thread);
 
   bt_workqueue_thread = NULL;
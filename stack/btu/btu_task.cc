@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <mutex>
+
 #include "bt_common.h"
 #include "bt_target.h"
 #include "bt_trace.h"
@@ -43,6 +45,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/thread.h"
+#include "osi/include/time.h"
 #include "port_api.h"
 #include "port_ext.h"
 #include "sdpint.h"
@@ -80,8 +83,8 @@ extern void avdt_rcv_sync_info(BT_HDR* p_buf); /* this is for hci_test */
 */
 uint8_t btu_trace_level = HCI_INITIAL_TRACE_LEVEL;
 
-// Communication queue between btu_task and bta.
-extern fixed_queue_t* btu_bta_msg_queue;
+// Communication queues between btu_task and bta, one per lane.
+extern fixed_queue_t* btu_bta_msg_queue[BTA_SYS_LANE_MAX];
 
 // Communication queue between btu_task and hci.
 extern fixed_queue_t* btu_hci_msg_queue;
@@ -94,16 +97,196 @@ extern fixed_queue_t* btif_msg_queue;
 
 extern thread_t* bt_workqueue_thread;
 
+// The most HCI messages processed per wakeup of the BTU thread. The queue
+// stays readable while messages are left, so the reactor serves the BTA
+// messages and alarms in between batches.
+#define BTU_HCI_MSG_BATCH_SIZE 8
+
 static void btu_hci_msg_process(BT_HDR* p_msg);
 
 void btu_hci_msg_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
-  BT_HDR* p_msg = (BT_HDR*)fixed_queue_dequeue(queue);
-  btu_hci_msg_process(p_msg);
+  void* p_msgs[BTU_HCI_MSG_BATCH_SIZE];
+  size_t count =
+      fixed_queue_try_dequeue_batch(queue, p_msgs, BTU_HCI_MSG_BATCH_SIZE);
+  for (size_t i = 0; i < count; i++) btu_hci_msg_process((BT_HDR*)p_msgs[i]);
+}
+
+// The BTU watchdog samples the occupancy of the BTU thread: the share of
+// the time its reactor spends in callbacks, processing the HCI and BTA
+// messages, the alarms and the posted closures. It runs on the alarm
+// thread, so that it still sees a BTU thread stuck in a callback.
+#define BTU_WATCHDOG_INTERVAL_MS 1000
+#define BTU_WATCHDOG_SLACK_MS 500
+
+// A period at least this busy, in thousandths, is counted as saturated
+#define BTU_WATCHDOG_SATURATED_PERMILLE 900
+
+// A callback running for this long is reported as a stall
+#define BTU_WATCHDOG_STALL_MS 2000
+
+// The periods are counted by tenth of occupancy
+#define BTU_WATCHDOG_BUCKETS 10
+
+typedef struct {
+  alarm_t* alarm;
+  uint64_t start_us;
+  uint64_t start_busy_us;
+  uint64_t last_check_us;
+  uint64_t last_busy_us;  // Including the part of the running callbacks
+  uint32_t last_permille;
+  uint32_t max_permille;
+  uint32_t saturated_streak;
+  uint32_t max_saturated_streak;
+  uint32_t saturated_periods;
+  uint32_t stall_count;
+  uint64_t stall_start_us;  // Of the last stall reported
+  uint32_t periods[BTU_WATCHDOG_BUCKETS];
+} btu_watchdog_t;
+
+static btu_watchdog_t btu_watchdog;
+static std::mutex btu_watchdog_mutex;
+
+static void btu_watchdog_check(UNUSED_ATTR void* context) {
+  std::lock_guard<std::mutex> lock(btu_watchdog_mutex);
+  if (btu_watchdog.alarm == NULL) return;
+
+  reactor_occupancy_t occupancy;
+  reactor_get_occupancy(thread_get_reactor(bt_workqueue_thread), &occupancy);
+  uint64_t now_us = time_get_os_boottime_us();
+
+  // The callbacks still running count as busy up to now
+  uint64_t running_us = 0;
+  if (occupancy.dispatch_start_us != 0 && now_us > occupancy.dispatch_start_us)
+    running_us = now_us - occupancy.dispatch_start_us;
+  uint64_t busy_us = occupancy.busy_us + running_us;
+  uint64_t period_us = now_us - btu_watchdog.last_check_us;
+  uint64_t period_busy_us = (busy_us > btu_watchdog.last_busy_us)
+                                ? busy_us - btu_watchdog.last_busy_us
+                                : 0;
+  btu_watchdog.last_check_us = now_us;
+  btu_watchdog.last_busy_us = busy_us;
+  if (period_us == 0) return;
+
+  uint32_t permille = (uint32_t)(period_busy_us * 1000 / period_us);
+  if (permille > 1000) permille = 1000;
+  btu_watchdog.last_permille = permille;
+  if (permille > btu_watchdog.max_permille)
+    btu_watchdog.max_permille = permille;
+  uint32_t bucket = permille * BTU_WATCHDOG_BUCKETS / 1000;
+  if (bucket >= BTU_WATCHDOG_BUCKETS) bucket = BTU_WATCHDOG_BUCKETS - 1;
+  btu_watchdog.periods[bucket]++;
+
+  if (permille >= BTU_WATCHDOG_SATURATED_PERMILLE) {
+    if (btu_watchdog.saturated_streak++ == 0)
+      LOG_WARN(LOG_TAG, "%s: BTU thread %u.%u%% busy", __func__,
+               permille / 10, permille % 10);
+    btu_watchdog.saturated_periods++;
+    if (btu_watchdog.saturated_streak > btu_watchdog.max_saturated_streak)
+      btu_watchdog.max_saturated_streak = btu_watchdog.saturated_streak;
+  } else {
+    btu_watchdog.saturated_streak = 0;
+  }
+
+  if (running_us >= BTU_WATCHDOG_STALL_MS * 1000 &&
+      occupancy.dispatch_start_us != btu_watchdog.stall_start_us) {
+    LOG_ERROR(LOG_TAG, "%s: BTU thread stuck in a callback for %llu ms",
+              __func__, (unsigned long long)(running_us / 1000));
+    btu_watchdog.stall_start_us = occupancy.dispatch_start_us;
+    btu_watchdog.stall_count++;
+  }
 }
 
-void btu_bta_msg_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
+static void btu_watchdog_start(void) {
+  std::lock_guard<std::mutex> lock(btu_watchdog_mutex);
+  memset(&btu_watchdog, 0, sizeof(btu_watchdog));
+
+  reactor_occupancy_t occupancy;
+  reactor_get_occupancy(thread_get_reactor(bt_workqueue_thread), &occupancy);
+  btu_watchdog.start_us = time_get_os_boottime_us();
+  btu_watchdog.last_check_us = btu_watchdog.start_us;
+  btu_watchdog.start_busy_us = occupancy.busy_us;
+  btu_watchdog.last_busy_us = occupancy.busy_us;
+
+  btu_watchdog.alarm = alarm_new_periodic("btu.watchdog");
+  alarm_set_with_slack(btu_watchdog.alarm, BTU_WATCHDOG_INTERVAL_MS,
+                       BTU_WATCHDOG_SLACK_MS, btu_watchdog_check, NULL);
+}
+
+static void btu_watchdog_stop(void) {
+  alarm_t* alarm;
+  {
+    std::lock_guard<std::mutex> lock(btu_watchdog_mutex);
+    alarm = btu_watchdog.alarm;
+    btu_watchdog.alarm = NULL;
+  }
+  // Outside of the lock, as the alarm waits for a running callback
+  alarm_free(alarm);
+}
+
+/*******************************************************************************
+ *
+ * Function         BTU_DumpStatistics
+ *
+ * Description      This function dumps the occupancy of the BTU thread, as
+ *                  sampled by the BTU watchdog, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void BTU_DumpStatistics(int fd) {
+  std::lock_guard<std::mutex> lock(btu_watchdog_mutex);
+
+  dprintf(fd, "\nBTU Thread:\n");
+  if (btu_watchdog.alarm == NULL) {
+    dprintf(fd, "  Watchdog not running\n");
+    return;
+  }
+
+  reactor_occupancy_t occupancy;
+  reactor_get_occupancy(thread_get_reactor(bt_workqueue_thread), &occupancy);
+  uint64_t elapsed_us = time_get_os_boottime_us() - btu_watchdog.start_us;
+  uint32_t average_permille = 0;
+  if (elapsed_us > 0) {
+    average_permille = (uint32_t)(
+        (occupancy.busy_us - btu_watchdog.start_busy_us) * 1000 / elapsed_us);
+  }
+  uint32_t total_periods = 0;
+  for (int i = 0; i < BTU_WATCHDOG_BUCKETS; i++)
+    total_periods += btu_watchdog.periods[i];
+
+  dprintf(fd,
+          "  Occupancy: last %u.%u%%, max %u.%u%%, average %u.%u%% over "
+          "%llu s\n",
+          btu_watchdog.last_permille / 10, btu_watchdog.last_permille % 10,
+          btu_watchdog.max_permille / 10, btu_watchdog.max_permille % 10,
+          average_permille / 10, average_permille % 10,
+          (unsigned long long)(elapsed_us / 1000000));
+  dprintf(fd,
+          "  Saturated periods (>= %u%%): %u (longest run %u, current %u)\n",
+          BTU_WATCHDOG_SATURATED_PERMILLE / 10, btu_watchdog.saturated_periods,
+          btu_watchdog.max_saturated_streak, btu_watchdog.saturated_streak);
+  dprintf(fd, "  Stalls (>= %u ms): %u\n", BTU_WATCHDOG_STALL_MS,
+          btu_watchdog.stall_count);
+  dprintf(fd, "  Periods by occupancy (of %u):", total_periods);
+  for (int i = 0; i < BTU_WATCHDOG_BUCKETS; i++)
+    dprintf(fd, " %d%%: %u", i * 100 / BTU_WATCHDOG_BUCKETS,
+            btu_watchdog.periods[i]);
+  dprintf(fd, "\n");
+}
+
+// The reactor priorities of the BTA lanes. The reactor dispatches each ready
+// lane once per iteration, from the highest priority to the lowest, and each
+// dispatch handles one message: a burst on a lane delays the other lanes by
+// at most a message.
+static const reactor_priority_t btu_bta_lane_priority[BTA_SYS_LANE_MAX] = {
+    REACTOR_PRIORITY_HIGH,    // BTA_SYS_LANE_MEDIA
+    REACTOR_PRIORITY_NORMAL,  // BTA_SYS_LANE_HID
+    REACTOR_PRIORITY_LOW,     // BTA_SYS_LANE_DEFAULT
+};
+
+void btu_bta_msg_ready(fixed_queue_t* queue, void* context) {
   BT_HDR* p_msg = (BT_HDR*)fixed_queue_dequeue(queue);
-  bta_sys_event(p_msg);
+  bta_sys_lane_event((tBTA_SYS_LANE)(uintptr_t)context, p_msg);
 }
 
 static void btu_hci_msg_process(BT_HDR* p_msg) {
@@ -123,6 +306,10 @@ static void btu_hci_msg_process(BT_HDR* p_msg) {
       l2c_link_segments_xmitted(p_msg);
       break;
 
+    case BT_EVT_TO_BTU_HCI_ISO:
+      btm_iso_rcv_data(p_msg);
+      break;
+
     case BT_EVT_TO_BTU_HCI_SCO:
 #if (BTM_SCO_INCLUDED == TRUE)
       btm_route_sco_data(p_msg);
@@ -173,19 +360,27 @@ void btu_task_start_up(UNUSED_ATTR void* context) {
   // Inform the bt jni thread initialization is ok.
   btif_transfer_context(btif_init_ok, 0, NULL, 0, NULL);
 
-  fixed_queue_register_dequeue(btu_bta_msg_queue,
-                               thread_get_reactor(bt_workqueue_thread),
-                               btu_bta_msg_ready, NULL);
+  for (int lane = 0; lane < BTA_SYS_LANE_MAX; lane++) {
+    fixed_queue_register_dequeue_with_priority(
+        btu_bta_msg_queue[lane], thread_get_reactor(bt_workqueue_thread),
+        btu_bta_lane_priority[lane], btu_bta_msg_ready, (void*)(uintptr_t)lane);
+  }
 
-  fixed_queue_register_dequeue(btu_hci_msg_queue,
-                               thread_get_reactor(bt_workqueue_thread),
-                               btu_hci_msg_ready, NULL);
+  // The HCI events and ACL data go before the messages from BTA
+  fixed_queue_register_dequeue_with_priority(
+      btu_hci_msg_queue, thread_get_reactor(bt_workqueue_thread),
+      REACTOR_PRIORITY_HIGH, btu_hci_msg_ready, NULL);
 
   alarm_register_processing_queue(btu_general_alarm_queue, bt_workqueue_thread);
+
+  btu_watchdog_start();
 }
 
 void btu_task_shut_down(UNUSED_ATTR void* context) {
-  fixed_queue_unregister_dequeue(btu_bta_msg_queue);
+  btu_watchdog_stop();
+
+  for (int lane = 0; lane < BTA_SYS_LANE_MAX; lane++)
+    fixed_queue_unregister_dequeue(btu_bta_msg_queue[lane]);
   fixed_queue_unregister_dequeue(btu_hci_msg_queue);
   alarm_unregister_processing_queue(btu_general_alarm_queue);
 
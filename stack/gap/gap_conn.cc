@@ -20,6 +20,7 @@
 #include "bt_target.h"
 #include "bt_utils.h"
 #include "btu.h"
+#include "device/include/controller.h"
 #include "gap_int.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
@@ -167,9 +168,18 @@ uint16_t GAP_ConnOpen(const char* p_serv_name, uint8_t service_id,
 
   /* Configure L2CAP COC, if transport is LE */
   if (transport == BT_TRANSPORT_LE) {
-    p_ccb->local_coc_cfg.credits = L2CAP_LE_DEFAULT_CREDIT;
+    /* The peer PDUs fill an LE ACL buffer, with the L2CAP header */
+    uint16_t mps = controller_get_interface()->get_acl_data_size_ble();
+    if (mps > L2CAP_LE_MIN_MPS + L2CAP_PKT_OVERHEAD)
+      mps -= L2CAP_PKT_OVERHEAD;
+    else
+      mps = L2CAP_LE_DEFAULT_MPS;
+    if (mps > p_cfg->mtu + L2CAP_LCC_SDU_LENGTH)
+      mps = p_cfg->mtu + L2CAP_LCC_SDU_LENGTH;
+
+    p_ccb->local_coc_cfg.credits = L2CAP_LE_COC_INITIAL_CREDIT;
     p_ccb->local_coc_cfg.mtu = p_cfg->mtu;
-    p_ccb->local_coc_cfg.mps = L2CAP_LE_DEFAULT_MPS;
+    p_ccb->local_coc_cfg.mps = mps;
   }
 
   p_ccb->p_callback = p_cb;
@@ -26,6 +26,7 @@
 
 #include "gatt_int.h"
 #include "l2c_api.h"
+#include "osi/include/flow_trace.h"
 
 #define GATT_HDR_FIND_TYPE_VALUE_LEN 21
 #define GATT_OP_CODE_SIZE 1
@@ -323,6 +324,8 @@ BT_HDR* attp_build_value_cmd(uint16_t payload_size, uint8_t op_code,
 tGATT_STATUS attp_send_msg_to_l2cap(tGATT_TCB* p_tcb, BT_HDR* p_toL2CAP) {
   uint16_t l2cap_ret;
 
+  FLOW_TRACE_START(FLOW_TRACE_ATT, p_toL2CAP, "ATT tx");
+
   if (p_tcb->att_lcid == L2CAP_ATT_CID)
     l2cap_ret =
         L2CA_SendFixedChnlData(L2CAP_ATT_CID, p_tcb->peer_bda, p_toL2CAP);
@@ -424,6 +427,24 @@ tGATT_STATUS attp_send_sr_msg(tGATT_TCB* p_tcb, BT_HDR* p_msg) {
   return cmd_sent;
 }
 
+/*******************************************************************************
+ *
+ * Function         attp_cl_cmd_waiting
+ *
+ * Description      Check if a client message waits in the command queue of
+ *                  a connection to be sent, behind the request in progress.
+ *
+ * Returns          true if a message waits to be sent.
+ *
+ ******************************************************************************/
+static bool attp_cl_cmd_waiting(tGATT_TCB* p_tcb) {
+  for (uint8_t i = p_tcb->pending_cl_req; i != p_tcb->next_slot_inq;
+       i = (i + 1) % GATT_CL_MAX_LCB) {
+    if (p_tcb->cl_cmd_q[i].to_send) return true;
+  }
+  return false;
+}
+
 /*******************************************************************************
  *
  * Function         attp_cl_send_cmd
@@ -443,9 +464,12 @@ tGATT_STATUS attp_cl_send_cmd(tGATT_TCB* p_tcb, uint16_t clcb_idx,
   if (p_tcb != NULL) {
     cmd_code &= ~GATT_AUTH_SIGN_MASK;
 
-    /* no pending request or value confirmation */
+    /* no pending request or value confirmation. A write command needs no
+     * response, so it goes out while a request waits for its response, unless
+     * queued messages have to go first. */
     if (p_tcb->pending_cl_req == p_tcb->next_slot_inq ||
-        cmd_code == GATT_HANDLE_VALUE_CONF) {
+        cmd_code == GATT_HANDLE_VALUE_CONF ||
+        (cmd_code == GATT_CMD_WRITE && !attp_cl_cmd_waiting(p_tcb))) {
       att_ret = attp_send_msg_to_l2cap(p_tcb, p_cmd);
       if (att_ret == GATT_CONGESTED || att_ret == GATT_SUCCESS) {
         /* do not enq cmd if handle value confirmation or set request */
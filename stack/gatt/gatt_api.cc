@@ -348,6 +348,7 @@ uint16_t GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     if (list.asgn_range.s_handle < it->s_hdl) break;
   }
   auto rit = lst_ptr->emplace(it);
+  (*gatt_cb.srv_list_index)[list.asgn_range.e_handle] = rit;
 
   tGATT_SRV_LIST_ELEM& elem = *rit;
   elem.gatt_if = gatt_if;
@@ -461,12 +462,14 @@ void GATTS_StopService(uint16_t service_handle) {
   if (it == gatt_cb.srv_list_info->end()) {
     GATT_TRACE_ERROR("%s: service_handle: %u is not in use", __func__,
                      service_handle);
+    return;
   }
 
   if (it->sdp_handle) {
     SDP_DeleteRecord(it->sdp_handle);
   }
 
+  gatt_cb.srv_list_index->erase(it->e_hdl);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_pri_srv_info();
 }
@@ -548,7 +551,10 @@ tGATT_STATUS GATTS_HandleValueIndication(uint16_t conn_id, uint16_t attr_handle,
  *                  val_len: Length of the indicated attribute value.
  *                  p_val: Pointer to the indicated attribute value data.
  *
- * Returns          GATT_SUCCESS if sucessfully sent; otherwise error code.
+ * Returns          GATT_SUCCESS if sucessfully sent, GATT_CONGESTED if sent
+ *                  or held until the channel is uncongested, in which case
+ *                  the application should wait for its congestion callback
+ *                  to send more; otherwise error code.
  *
  ******************************************************************************/
 tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
@@ -580,7 +586,7 @@ tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
     p_buf = attp_build_sr_msg(p_tcb, GATT_HANDLE_VALUE_NOTIF,
                               (tGATT_SR_MSG*)&notif);
     if (p_buf != NULL) {
-      cmd_sent = attp_send_sr_msg(p_tcb, p_buf);
+      cmd_sent = gatt_send_notif(p_tcb, p_buf);
     } else
       cmd_sent = GATT_NO_RESOURCES;
   }
@@ -630,6 +636,92 @@ tGATT_STATUS GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
   return cmd_sent;
 }
 
+/* Returns the value attribute |attr_handle| of a service of |gatt_if|, whose
+ * value the app may give to the stack. */
+static tGATT_ATTR* gatts_find_app_value_attr(tGATT_IF gatt_if,
+                                             uint16_t attr_handle) {
+  auto it = gatt_sr_find_i_rcb_by_handle(attr_handle);
+  if (it == gatt_cb.srv_list_info->end() || it->gatt_if != gatt_if)
+    return NULL;
+
+  tGATT_ATTR* p_attr = find_attr_by_handle(it->p_db, attr_handle);
+  if (p_attr == NULL || (p_attr->gatt_type != BTGATT_DB_CHARACTERISTIC &&
+                         p_attr->gatt_type != BTGATT_DB_DESCRIPTOR))
+    return NULL;
+  return p_attr;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_SetAttributeValue
+ *
+ * Description      This function sets the value of an attribute, read by the
+ *                  stack for the clients instead of asking the application
+ *                  until it is invalidated.
+ *
+ * Parameter        gatt_if: application interface.
+ *                  attr_handle: characteristic value or descriptor handle.
+ *                  version: of the value, newer than the one of the last
+ *                           update of the attribute, 0 before the first.
+ *                  len: length of the value.
+ *                  p_value: the value.
+ *
+ * Returns          GATT_SUCCESS if the value is set; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_SetAttributeValue(tGATT_IF gatt_if, uint16_t attr_handle,
+                                     uint32_t version, uint16_t len,
+                                     const uint8_t* p_value) {
+  tGATT_ATTR* p_attr = gatts_find_app_value_attr(gatt_if, attr_handle);
+  if (p_attr == NULL) {
+    GATT_TRACE_ERROR("%s: no value 0x%04x for gatt_if=%d", __func__,
+                     attr_handle, gatt_if);
+    return GATT_INVALID_HANDLE;
+  }
+  if (len > GATT_MAX_ATTR_LEN) return GATT_INVALID_ATTR_LEN;
+
+  /* an update that was overtaken by a newer one */
+  if (version <= p_attr->cached_version) {
+    GATT_TRACE_WARNING("%s: 0x%04x version %u not after %u", __func__,
+                       attr_handle, version, p_attr->cached_version);
+    return GATT_WRONG_STATE;
+  }
+
+  p_attr->p_cached_value.reset(
+      new std::vector<uint8_t>(p_value, p_value + len));
+  p_attr->cached_version = version;
+  return GATT_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         GATTS_InvalidateAttributeValue
+ *
+ * Description      This function drops the value of an attribute set by
+ *                  GATTS_SetAttributeValue, so that its reads are sent to the
+ *                  application again. A value is also dropped when a client
+ *                  writes the attribute.
+ *
+ * Parameter        gatt_if: application interface.
+ *                  attr_handle: characteristic value or descriptor handle.
+ *                  version: of the invalidation, newer than the one of the
+ *                           last update of the attribute.
+ *
+ * Returns          GATT_SUCCESS if the value is dropped; otherwise error code.
+ *
+ ******************************************************************************/
+tGATT_STATUS GATTS_InvalidateAttributeValue(tGATT_IF gatt_if,
+                                            uint16_t attr_handle,
+                                            uint32_t version) {
+  tGATT_ATTR* p_attr = gatts_find_app_value_attr(gatt_if, attr_handle);
+  if (p_attr == NULL) return GATT_INVALID_HANDLE;
+  if (version <= p_attr->cached_version) return GATT_WRONG_STATE;
+
+  p_attr->p_cached_value.reset();
+  p_attr->cached_version = version;
+  return GATT_SUCCESS;
+}
+
 /******************************************************************************/
 /* GATT Profile Srvr Functions */
 /******************************************************************************/
@@ -679,8 +771,19 @@ tGATT_STATUS GATTC_ConfigureMTU(uint16_t conn_id, uint16_t mtu) {
   }
 
   p_clcb = gatt_clcb_alloc(conn_id);
+  if (p_clcb != NULL && p_tcb->mtu_requested) {
+    /* A client exchanges the MTU once per link: when the stack already did,
+     * the MTU it settled on is given back */
+    GATT_TRACE_DEBUG("GATTC_ConfigureMTU MTU already exchanged: %d",
+                     p_tcb->payload_size);
+    p_clcb->operation = GATTC_OPTYPE_CONFIG;
+    gatt_end_operation(p_clcb, GATT_SUCCESS, NULL);
+    return GATT_SUCCESS;
+  }
+
   if (p_clcb != NULL) {
     p_clcb->p_tcb->payload_size = mtu;
+    p_clcb->p_tcb->mtu_requested = true;
     p_clcb->operation = GATTC_OPTYPE_CONFIG;
 
     ret = attp_send_cl_msg(p_clcb->p_tcb, p_clcb->clcb_idx, GATT_REQ_MTU,
@@ -690,6 +793,44 @@ tGATT_STATUS GATTC_ConfigureMTU(uint16_t conn_id, uint16_t mtu) {
   return ret;
 }
 
+/*******************************************************************************
+ *
+ * Function         GATT_DumpConnections
+ *
+ * Description      This function dumps the ATT MTU and the LE data length of
+ *                  the GATT connections, with the payload they leave to the
+ *                  attribute values, to |fd|.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+void GATT_DumpConnections(int fd) {
+  dprintf(fd, "\nGATT Connections:\n");
+  for (int i = 0; i < GATT_MAX_PHY_CHANNEL; i++) {
+    tGATT_TCB* p_tcb = &gatt_cb.tcb[i];
+    if (!p_tcb->in_use || gatt_get_ch_state(p_tcb) != GATT_CH_OPEN) continue;
+
+    const uint8_t* bda = p_tcb->peer_bda;
+    dprintf(fd, "  %02x:%02x:%02x:%02x:%02x:%02x transport %s\n", bda[0],
+            bda[1], bda[2], bda[3], bda[4], bda[5],
+            p_tcb->transport == BT_TRANSPORT_LE ? "LE" : "BR/EDR");
+    dprintf(fd, "    ATT MTU                     : %u%s\n",
+            p_tcb->payload_size, p_tcb->mtu_requested ? "" : " (default)");
+    if (p_tcb->transport != BT_TRANSPORT_LE) continue;
+
+    /* A notification carries MTU - 3 octets of value, in L2CAP PDUs of
+     * 4 more octets, split over LL PDUs of the data length */
+    uint16_t data_len = L2CA_GetBleTxDataLength(p_tcb->peer_bda);
+    if (data_len == 0) data_len = BTM_BLE_DATA_SIZE_MIN;
+    uint16_t sdu_len = p_tcb->payload_size + L2CAP_PKT_OVERHEAD;
+    dprintf(fd, "    LL TX data length           : %u\n", data_len);
+    dprintf(fd, "    LL PDUs per notification    : %u\n",
+            (sdu_len + data_len - 1) / data_len);
+    dprintf(fd, "    Value octets per LL PDU     : %u\n",
+            (p_tcb->payload_size - 3) * data_len / sdu_len);
+  }
+}
+
 void read_phy_cb(
     base::Callback<void(uint8_t tx_phy, uint8_t rx_phy, uint8_t status)> cb,
     uint8_t* data, uint16_t len) {
@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include "btm_int.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
@@ -218,6 +219,16 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
       }
       status = GATT_SUCCESS;
     }
+  } else if (attr16.p_cached_value) {
+    /* value set by the app, read without asking it */
+    const std::vector<uint8_t>& value = *attr16.p_cached_value;
+    if (offset > value.size()) {
+      status = GATT_INVALID_OFFSET;
+    } else {
+      len = std::min<size_t>(value.size() - offset, mtu);
+      ARRAY_TO_STREAM(p, value.data() + offset, len);
+      status = GATT_SUCCESS;
+    }
   } else /* characteristic description or characteristic value */
   {
     status = GATT_PENDING;
@@ -255,42 +266,54 @@ tGATT_STATUS gatts_db_read_attr_value_by_type(
   uint16_t len = 0;
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
+  /* the attributes of the type, in handle order */
+  const std::vector<uint16_t>* positions = NULL;
   if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      tBT_UUID attr_uuid = attr.uuid;
+    auto it = p_db->attr_by_type.find(BtUuidKey(type));
+    if (it != p_db->attr_by_type.end()) positions = &it->second;
+  }
 
-      if (attr.handle >= s_handle && gatt_uuid_compare(type, attr_uuid)) {
-        if (*p_len <= 2) {
-          status = GATT_NO_RESOURCES;
-          break;
-        }
+  if (positions) {
+    uint16_t first_handle = p_db->attr_list.front().handle;
+    uint16_t first = s_handle > first_handle ? s_handle - first_handle : 0;
+
+    auto pos = std::lower_bound(positions->begin(), positions->end(), first);
+    for (; pos != positions->end(); pos++) {
+      tGATT_ATTR& attr = p_db->attr_list[*pos];
+      if (attr.handle > e_handle) break;
+
+      if (*p_len <= 2) {
+        status = GATT_NO_RESOURCES;
+        break;
+      }
 
-        UINT16_TO_STREAM(p, attr.handle);
+      UINT16_TO_STREAM(p, attr.handle);
 
-        status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
-                                 &len, sec_flag, key_size);
+      /* the length of each handle and value pair takes one octet */
+      uint16_t max_len = std::min<uint16_t>(*p_len - 2, UINT8_MAX - 2);
+      status = read_attr_value(attr, 0, &p, false, max_len, &len, sec_flag,
+                               key_size);
 
-        if (status == GATT_PENDING) {
-          status = gatts_send_app_read_request(p_tcb, op_code, attr.handle, 0,
-                                               trans_id, attr.gatt_type);
+      if (status == GATT_PENDING) {
+        status = gatts_send_app_read_request(p_tcb, op_code, attr.handle, 0,
+                                             trans_id, attr.gatt_type);
 
-          /* one callback at a time */
-          break;
-        } else if (status == GATT_SUCCESS) {
-          if (p_rsp->offset == 0) p_rsp->offset = len + 2;
-
-          if (p_rsp->offset == len + 2) {
-            p_rsp->len += (len + 2);
-            *p_len -= (len + 2);
-          } else {
-            GATT_TRACE_ERROR("format mismatch");
-            status = GATT_NO_RESOURCES;
-            break;
-          }
+        /* one callback at a time */
+        break;
+      } else if (status == GATT_SUCCESS) {
+        if (p_rsp->offset == 0) p_rsp->offset = len + 2;
+
+        if (p_rsp->offset == len + 2) {
+          p_rsp->len += (len + 2);
+          *p_len -= (len + 2);
         } else {
-          *p_cur_handle = attr.handle;
+          GATT_TRACE_ERROR("format mismatch");
+          status = GATT_NO_RESOURCES;
           break;
         }
+      } else {
+        *p_cur_handle = attr.handle;
+        break;
       }
     }
   }
@@ -444,14 +467,15 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 /* Service Attribute Database Query Utility Functions */
 /******************************************************************************/
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
-  if (!p_db) return nullptr;
+  if (!p_db || p_db->attr_list.empty()) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  /* the handles of a service are allocated in sequence, see
+   * allocate_attr_in_db */
+  uint16_t first_handle = p_db->attr_list.front().handle;
+  if (handle < first_handle || handle - first_handle >= p_db->attr_list.size())
+    return nullptr;
 
-  return nullptr;
+  return &p_db->attr_list[handle - first_handle];
 }
 
 /*******************************************************************************
@@ -714,6 +738,7 @@ static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const tBT_UUID& uuid,
                << ", next_handle = " << +db.next_handle;
   }
 
+  db.attr_by_type[BtUuidKey(uuid)].push_back(db.attr_list.size());
   db.attr_list.emplace_back();
   tGATT_ATTR& attr = db.attr_list.back();
   attr.handle = db.next_handle++;
@@ -23,12 +23,16 @@
 
 #include "bt_trace.h"
 #include "btm_ble_api.h"
+#include "bt_uuid_key.h"
 #include "btu.h"
 #include "gatt_api.h"
 #include "osi/include/fixed_queue.h"
 
 #include <string.h>
+#include <array>
 #include <list>
+#include <map>
+#include <unordered_map>
 #include <vector>
 
 #define GATT_CREATE_CONN_ID(tcb_idx, gatt_if) \
@@ -171,12 +175,17 @@ typedef struct {
   uint16_t handle;
   tBT_UUID uuid;
   bt_gatt_db_attribute_type_t gatt_type;
+  /* value set by the app for the stack to read, NULL if the app answers */
+  std::unique_ptr<std::vector<uint8_t>> p_cached_value;
+  uint32_t cached_version; /* of the last update of p_cached_value */
 } tGATT_ATTR;
 
 /* Service Database definition
 */
 typedef struct {
   std::vector<tGATT_ATTR> attr_list; /* pointer to the attributes */
+  /* positions in attr_list of the attributes of each type, in handle order */
+  std::unordered_map<BtUuidKey, std::vector<uint16_t>> attr_by_type;
   uint16_t end_handle;       /* Last handle number           */
   uint16_t next_handle;      /* Next usable handle value     */
 } tGATT_SVC_DB;
@@ -260,7 +269,7 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
-typedef struct {
+typedef struct t_gatt_tcb {
   fixed_queue_t* pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
   BD_ADDR peer_bda;
@@ -269,6 +278,7 @@ typedef struct {
 
   uint16_t att_lcid; /* L2CAP channel ID for ATT */
   uint16_t payload_size;
+  bool mtu_requested; /* the MTU was exchanged, or is being, as a client */
 
   tGATT_CH_STATE ch_state;
   uint8_t ch_flags;
@@ -280,6 +290,8 @@ typedef struct {
   tGATT_SR_CMD sr_cmd;
   uint16_t indicate_handle;
   fixed_queue_t* pending_ind_q;
+  fixed_queue_t* pending_notif_q; /* notifications held while congested */
+  bool congested;                 /* the ATT channel is congested */
 
   alarm_t* conf_timer; /* peer confirm to indication timer */
 
@@ -293,6 +305,11 @@ typedef struct {
 
   bool in_use;
   uint8_t tcb_idx;
+
+  /* Next TCBs in the buckets of gatt_cb.p_tcb_by_addr and gatt_cb.p_tcb_by_cid
+   */
+  struct t_gatt_tcb* p_next_addr_tcb;
+  struct t_gatt_tcb* p_next_cid_tcb;
 } tGATT_TCB;
 
 /* logic channel */
@@ -367,6 +384,11 @@ typedef struct {
 
 typedef struct {
   tGATT_TCB tcb[GATT_MAX_PHY_CHANNEL];
+  /* The in use TCBs, hashed by peer address and by the dynamic L2CAP CID of
+   * their ATT channel. The CID of a TCB is set through gatt_set_tcb_lcid(),
+   * and a TCB is removed with gatt_unhash_tcb() before it is cleared. */
+  tGATT_TCB* p_tcb_by_addr[GATT_TCB_HASH_SIZE];
+  tGATT_TCB* p_tcb_by_cid[GATT_TCB_HASH_SIZE];
   fixed_queue_t* sign_op_queue;
 
   uint16_t next_handle;     /* next available handle */
@@ -375,10 +397,14 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  /* the started services of srv_list_info, by end handle */
+  std::map<uint16_t, std::list<tGATT_SRV_LIST_ELEM>::iterator>* srv_list_index;
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
   tGATT_CLCB clcb[GATT_CL_MAX_LCB]; /* connection link control block*/
+  uint16_t free_clcb_idx[GATT_CL_MAX_LCB]; /* the free CLCBs, a stack */
+  uint16_t num_free_clcb;
   tGATT_SCCB sccb[GATT_MAX_SCCB];   /* sign complete callback function
                                        GATT_MAX_SCCB <= GATT_CL_MAX_LCB */
   uint8_t trace_level;
@@ -451,6 +477,8 @@ extern bool gatt_parse_uuid_from_cmd(tBT_UUID* p_uuid, uint16_t len,
                                      uint8_t** p_data);
 extern uint8_t gatt_build_uuid_to_stream(uint8_t** p_dst, tBT_UUID uuid);
 extern bool gatt_uuid_compare(tBT_UUID src, tBT_UUID tar);
+extern void gatt_convert_uuid16_to_uuid128(uint8_t uuid_128[LEN_UUID_128],
+                                           uint16_t uuid_16);
 extern void gatt_convert_uuid32_to_uuid128(uint8_t uuid_128[LEN_UUID_128],
                                            uint32_t uuid_32);
 extern void gatt_sr_get_sec_info(BD_ADDR rem_bda, tBT_TRANSPORT transport,
@@ -477,6 +505,8 @@ extern bool gatt_find_the_connected_bda(uint8_t start_idx, BD_ADDR bda,
 extern void gatt_set_srv_chg(void);
 extern void gatt_delete_dev_from_srv_chg_clt_list(BD_ADDR bd_addr);
 extern tGATT_VALUE* gatt_add_pending_ind(tGATT_TCB* p_tcb, tGATT_VALUE* p_ind);
+extern tGATT_STATUS gatt_send_notif(tGATT_TCB* p_tcb, BT_HDR* p_buf);
+extern void gatt_send_pending_notif(tGATT_TCB* p_tcb);
 extern void gatt_free_srvc_db_buffer_app_id(tBT_UUID* p_app_id);
 extern bool gatt_cl_send_next_cmd_inq(tGATT_TCB* p_tcb);
 
@@ -499,6 +529,8 @@ extern void gatt_deregister_bgdev_list(tGATT_IF gatt_if);
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_first_i_rcb(
+    uint16_t handle);
 extern bool gatt_sr_find_i_rcb_by_app_id(tBT_UUID* p_app_uuid128,
                                          tBT_UUID* p_svc_uuid,
                                          uint16_t svc_inst);
@@ -538,6 +570,8 @@ extern bool gatt_find_app_hold_link(tGATT_TCB* p_tcb, uint8_t start_idx,
 extern uint8_t gatt_num_apps_hold_link(tGATT_TCB* p_tcb);
 extern uint8_t gatt_num_clcb_by_bd_addr(BD_ADDR bda);
 extern tGATT_TCB* gatt_find_tcb_by_cid(uint16_t lcid);
+extern void gatt_set_tcb_lcid(tGATT_TCB* p_tcb, uint16_t lcid);
+extern void gatt_unhash_tcb(tGATT_TCB* p_tcb);
 extern tGATT_TCB* gatt_allocate_tcb_by_bdaddr(BD_ADDR bda,
                                               tBT_TRANSPORT transport);
 extern tGATT_TCB* gatt_get_tcb_by_idx(uint8_t tcb_idx);
@@ -588,6 +622,7 @@ extern uint16_t gatts_add_characteristic(tGATT_SVC_DB& db, tGATT_PERM perm,
                                          tBT_UUID& char_uuid);
 extern uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
                                      tBT_UUID& dscp_uuid);
+extern tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle);
 extern tGATT_STATUS gatts_db_read_attr_value_by_type(
     tGATT_TCB* p_tcb, tGATT_SVC_DB* p_db, uint8_t op_code, BT_HDR* p_rsp,
     uint16_t s_handle, uint16_t e_handle, tBT_UUID type, uint16_t* p_len,
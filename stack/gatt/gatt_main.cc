@@ -32,6 +32,7 @@
 #include "device/include/interop.h"
 #include "gatt_int.h"
 #include "l2c_api.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/osi.h"
 
 /* Configuration flags. */
@@ -64,6 +65,7 @@ static void gatt_l2cif_disconnect_cfm_cback(uint16_t l2cap_cid,
                                             uint16_t result);
 static void gatt_l2cif_data_ind_cback(uint16_t l2cap_cid, BT_HDR* p_msg);
 static void gatt_send_conn_cback(tGATT_TCB* p_tcb);
+static void gatt_auto_configure_mtu(tGATT_TCB* p_tcb);
 static void gatt_l2cif_congest_cback(uint16_t cid, bool congested);
 
 static const tL2CAP_APPL_INFO dyn_info = {gatt_l2cif_connect_ind_cback,
@@ -98,6 +100,11 @@ void gatt_init(void) {
   memset(&gatt_cb, 0, sizeof(tGATT_CB));
   memset(&fixed_reg, 0, sizeof(tL2CAP_FIXED_CHNL_REG));
 
+  /* All the CLCBs are free, the lowest indexes on top */
+  for (int i = 0; i < GATT_CL_MAX_LCB; i++)
+    gatt_cb.free_clcb_idx[i] = GATT_CL_MAX_LCB - 1 - i;
+  gatt_cb.num_free_clcb = GATT_CL_MAX_LCB;
+
 #if defined(GATT_INITIAL_TRACE_LEVEL)
   gatt_cb.trace_level = GATT_INITIAL_TRACE_LEVEL;
 #else
@@ -137,6 +144,8 @@ void gatt_init(void) {
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.srv_list_index =
+      new std::map<uint16_t, std::list<tGATT_SRV_LIST_ELEM>::iterator>();
   gatt_profile_db_init();
 }
 
@@ -164,6 +173,9 @@ void gatt_free(void) {
     fixed_queue_free(gatt_cb.tcb[i].pending_ind_q, NULL);
     gatt_cb.tcb[i].pending_ind_q = NULL;
 
+    fixed_queue_free(gatt_cb.tcb[i].pending_notif_q, osi_free);
+    gatt_cb.tcb[i].pending_notif_q = NULL;
+
     alarm_free(gatt_cb.tcb[i].conf_timer);
     gatt_cb.tcb[i].conf_timer = NULL;
 
@@ -178,6 +190,8 @@ void gatt_free(void) {
   gatt_cb.hdl_list_info = nullptr;
   gatt_cb.srv_list_info->clear();
   gatt_cb.srv_list_info = nullptr;
+  delete gatt_cb.srv_list_index;
+  gatt_cb.srv_list_index = nullptr;
 }
 
 /*******************************************************************************
@@ -200,10 +214,10 @@ bool gatt_connect(BD_ADDR rem_bda, tGATT_TCB* p_tcb, tBT_TRANSPORT transport,
     gatt_set_ch_state(p_tcb, GATT_CH_CONN);
 
   if (transport == BT_TRANSPORT_LE) {
-    p_tcb->att_lcid = L2CAP_ATT_CID;
+    gatt_set_tcb_lcid(p_tcb, L2CAP_ATT_CID);
     gatt_ret = L2CA_ConnectFixedChnl(L2CAP_ATT_CID, rem_bda, initiating_phys);
   } else {
-    p_tcb->att_lcid = L2CA_ConnectReq(BT_PSM_ATT, rem_bda);
+    gatt_set_tcb_lcid(p_tcb, L2CA_ConnectReq(BT_PSM_ATT, rem_bda));
     if (p_tcb->att_lcid != 0) gatt_ret = true;
   }
 
@@ -377,6 +391,8 @@ bool gatt_act_connect(tGATT_REG* p_reg, BD_ADDR bd_addr,
         GATT_TRACE_ERROR("gatt_connect failed");
         fixed_queue_free(p_tcb->pending_enc_clcb, NULL);
         fixed_queue_free(p_tcb->pending_ind_q, NULL);
+        fixed_queue_free(p_tcb->pending_notif_q, NULL);
+        gatt_unhash_tcb(p_tcb);
         memset(p_tcb, 0, sizeof(tGATT_TCB));
       } else
         ret = true;
@@ -397,6 +413,40 @@ bool gatt_act_connect(tGATT_REG* p_reg, BD_ADDR bd_addr,
   return ret;
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_auto_configure_mtu
+ *
+ * Description      This function requests the GATT_AUTO_MTU_SIZE ATT MTU on
+ *                  a new LE link, as the internal GATT profile. The peer may
+ *                  then send longer PDUs from the first operation on, without
+ *                  waiting for an application to configure the MTU.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void gatt_auto_configure_mtu(tGATT_TCB* p_tcb) {
+#if (GATT_AUTO_MTU_SIZE > GATT_DEF_BLE_MTU_SIZE)
+  if (p_tcb->transport != BT_TRANSPORT_LE || p_tcb->mtu_requested ||
+      gatt_cb.gatt_if == 0)
+    return;
+
+  bt_bdaddr_t bd_addr;
+  memcpy(bd_addr.address, p_tcb->peer_bda, BD_ADDR_LEN);
+  if (interop_match_addr(INTEROP_DISABLE_LE_AUTO_MTU_AND_DATA_LENGTH,
+                         &bd_addr)) {
+    GATT_TRACE_DEBUG("%s: disabled by interop", __func__);
+    return;
+  }
+
+  uint16_t conn_id = GATT_CREATE_CONN_ID(p_tcb->tcb_idx, gatt_cb.gatt_if);
+  tGATT_STATUS status = GATTC_ConfigureMTU(conn_id, GATT_AUTO_MTU_SIZE);
+  if (status != GATT_SUCCESS && status != GATT_CMD_STARTED)
+    GATT_TRACE_WARNING("%s: MTU request not sent, status %d", __func__,
+                       status);
+#endif
+}
+
 /*******************************************************************************
  *
  * Function         gatt_le_connect_cback
@@ -440,6 +490,7 @@ static void gatt_le_connect_cback(uint16_t chan, BD_ADDR bd_addr,
         p_tcb->payload_size = GATT_DEF_BLE_MTU_SIZE;
 
         gatt_send_conn_cback(p_tcb);
+        gatt_auto_configure_mtu(p_tcb);
       }
       if (check_srv_chg) gatt_chk_srv_chg(p_srv_chg_clt);
     }
@@ -448,13 +499,14 @@ static void gatt_le_connect_cback(uint16_t chan, BD_ADDR bd_addr,
     else {
       p_tcb = gatt_allocate_tcb_by_bdaddr(bd_addr, BT_TRANSPORT_LE);
       if (p_tcb != NULL) {
-        p_tcb->att_lcid = L2CAP_ATT_CID;
+        gatt_set_tcb_lcid(p_tcb, L2CAP_ATT_CID);
 
         gatt_set_ch_state(p_tcb, GATT_CH_OPEN);
 
         p_tcb->payload_size = GATT_DEF_BLE_MTU_SIZE;
 
         gatt_send_conn_cback(p_tcb);
+        gatt_auto_configure_mtu(p_tcb);
         if (check_srv_chg) {
           gatt_chk_srv_chg(p_srv_chg_clt);
         }
@@ -483,9 +535,16 @@ static void gatt_channel_congestion(tGATT_TCB* p_tcb, bool congested) {
   tGATT_REG* p_reg = NULL;
   uint16_t conn_id;
 
+  p_tcb->congested = congested;
+
   /* if uncongested, check to see if there is any more pending data */
-  if (p_tcb != NULL && congested == false) {
+  if (congested == false) {
     gatt_cl_send_next_cmd_inq(p_tcb);
+    gatt_send_pending_notif(p_tcb);
+
+    /* the pending notifications congested the channel again: the
+     * applications stay congested */
+    if (p_tcb->congested) return;
   }
   /* notifying all applications for the connection up event */
   for (i = 0, p_reg = gatt_cb.cl_rcb; i < GATT_MAX_APPS; i++, p_reg++) {
@@ -611,7 +670,7 @@ static void gatt_l2cif_connect_ind_cback(BD_ADDR bd_addr, uint16_t lcid,
       /* no tcb available, reject L2CAP connection */
       result = L2CAP_CONN_NO_RESOURCES;
     } else
-      p_tcb->att_lcid = lcid;
+      gatt_set_tcb_lcid(p_tcb, lcid);
 
   } else /* existing connection , reject it */
   {
@@ -953,6 +1012,8 @@ void gatt_data_process(tGATT_TCB* p_tcb, BT_HDR* p_buf) {
   uint8_t op_code, pseudo_op_code;
   uint16_t msg_len;
 
+  FLOW_TRACE_END(FLOW_TRACE_ATT, p_buf, "ATT rx");
+
   if (p_buf->len > 0) {
     msg_len = p_buf->len - 1;
     STREAM_TO_UINT8(op_code, p);
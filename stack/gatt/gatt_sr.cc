@@ -715,13 +715,14 @@ static void gatts_process_find_info(tGATT_TCB* p_tcb, uint8_t op_code,
 
     buf_len = p_tcb->payload_size - 2;
 
-    for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-        reason = gatt_build_find_info_rsp(el, p_msg, &buf_len, s_hdl, e_hdl);
-        if (reason == GATT_NO_RESOURCES) {
-          reason = GATT_SUCCESS;
-          break;
-        }
+    /* the services are in handle order, from the first one in range */
+    for (auto it = gatt_sr_find_first_i_rcb(s_hdl);
+         it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+      tGATT_SRV_LIST_ELEM& el = *it;
+      reason = gatt_build_find_info_rsp(el, p_msg, &buf_len, s_hdl, e_hdl);
+      if (reason == GATT_NO_RESOURCES) {
+        reason = GATT_SUCCESS;
+        break;
       }
     }
 
@@ -848,23 +849,24 @@ void gatts_process_read_by_type_req(tGATT_TCB* p_tcb, uint8_t op_code,
 
     reason = GATT_NOT_FOUND;
 
-    for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-        gatt_sr_get_sec_info(p_tcb->peer_bda, p_tcb->transport, &sec_flag,
-                             &key_size);
+    /* the services are in handle order, from the first one in range */
+    for (auto it = gatt_sr_find_first_i_rcb(s_hdl);
+         it != gatt_cb.srv_list_info->end() && it->s_hdl <= e_hdl; it++) {
+      tGATT_SRV_LIST_ELEM& el = *it;
+      gatt_sr_get_sec_info(p_tcb->peer_bda, p_tcb->transport, &sec_flag,
+                           &key_size);
 
-        ret = gatts_db_read_attr_value_by_type(p_tcb, el.p_db, op_code, p_msg,
-                                               s_hdl, e_hdl, uuid, &buf_len,
-                                               sec_flag, key_size, 0, &err_hdl);
-        if (ret != GATT_NOT_FOUND) {
-          reason = ret;
+      ret = gatts_db_read_attr_value_by_type(p_tcb, el.p_db, op_code, p_msg,
+                                             s_hdl, e_hdl, uuid, &buf_len,
+                                             sec_flag, key_size, 0, &err_hdl);
+      if (ret != GATT_NOT_FOUND) {
+        reason = ret;
 
-          if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
-        }
-        if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
-          s_hdl = err_hdl;
-          break;
-        }
+        if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
+      }
+      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
+        s_hdl = err_hdl;
+        break;
       }
     }
     *p = (uint8_t)p_msg->offset;
@@ -935,6 +937,10 @@ void gatts_process_write_req(tGATT_TCB* p_tcb, tGATT_SRV_LIST_ELEM& el,
                                        sec_flag, key_size);
 
   if (status == GATT_SUCCESS) {
+    /* the app answers the reads again, until it sets the value written */
+    tGATT_ATTR* p_attr = find_attr_by_handle(el.p_db, handle);
+    if (p_attr != NULL) p_attr->p_cached_value.reset();
+
     trans_id = gatt_sr_enqueue_cmd(p_tcb, op_code, handle);
     if (trans_id != 0) {
       conn_id = GATT_CREATE_CONN_ID(p_tcb->tcb_idx, el.gatt_if);
@@ -1047,32 +1053,28 @@ void gatts_process_attribute_req(tGATT_TCB* p_tcb, uint8_t op_code,
 #endif
 
   if (GATT_HANDLE_IS_VALID(handle)) {
-    for (auto& el : *gatt_cb.srv_list_info) {
-      if (el.s_hdl <= handle && el.e_hdl >= handle) {
-        for (const auto& attr : el.p_db->attr_list) {
-          if (attr.handle == handle) {
-            switch (op_code) {
-              case GATT_REQ_READ: /* read char/char descriptor value */
-              case GATT_REQ_READ_BLOB:
-                gatts_process_read_req(p_tcb, el, op_code, handle, len, p);
-                break;
-
-              case GATT_REQ_WRITE: /* write char/char descriptor value */
-              case GATT_CMD_WRITE:
-              case GATT_SIGN_CMD_WRITE:
-              case GATT_REQ_PREPARE_WRITE:
-                gatts_process_write_req(p_tcb, el, handle, op_code, len, p,
-                                        attr.gatt_type);
-                break;
-              default:
-                break;
-            }
-            status = GATT_SUCCESS;
-            break;
-          }
-        }
-        break;
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    tGATT_ATTR* p_attr = it != gatt_cb.srv_list_info->end()
+                             ? find_attr_by_handle(it->p_db, handle)
+                             : NULL;
+    if (p_attr) {
+      switch (op_code) {
+        case GATT_REQ_READ: /* read char/char descriptor value */
+        case GATT_REQ_READ_BLOB:
+          gatts_process_read_req(p_tcb, *it, op_code, handle, len, p);
+          break;
+
+        case GATT_REQ_WRITE: /* write char/char descriptor value */
+        case GATT_CMD_WRITE:
+        case GATT_SIGN_CMD_WRITE:
+        case GATT_REQ_PREPARE_WRITE:
+          gatts_process_write_req(p_tcb, *it, handle, op_code, len, p,
+                                  p_attr->gatt_type);
+          break;
+        default:
+          break;
       }
+      status = GATT_SUCCESS;
     }
   }
 
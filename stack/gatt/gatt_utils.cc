@@ -40,6 +40,13 @@
 
 #define GATT_GET_NEXT_VALID_HANDLE(x) (((x) / 10 + 1) * 10)
 
+static_assert((GATT_TCB_HASH_SIZE & (GATT_TCB_HASH_SIZE - 1)) == 0,
+              "GATT_TCB_HASH_SIZE must be a power of two");
+static_assert(GATT_MAX_PHY_CHANNEL < GATT_INDEX_INVALID,
+              "The TCB indexes of the connection IDs are 8 bits");
+static_assert(GATT_CL_MAX_LCB <= 0x100,
+              "The client command queue indexes are 8 bits");
+
 const char* const op_code_name[] = {"UNKNOWN",
                                     "ATT_RSP_ERROR",
                                     "ATT_REQ_MTU",
@@ -100,6 +107,22 @@ void gatt_free_pending_ind(tGATT_TCB* p_tcb) {
   p_tcb->pending_ind_q = NULL;
 }
 
+/*******************************************************************************
+ *
+ * Function         gatt_free_pending_notif
+ *
+ * Description    Free all the notifications held for a congested channel
+ *
+ * Returns       None
+ *
+ ******************************************************************************/
+static void gatt_free_pending_notif(tGATT_TCB* p_tcb) {
+  if (p_tcb->pending_notif_q == NULL) return;
+
+  fixed_queue_free(p_tcb->pending_notif_q, osi_free);
+  p_tcb->pending_notif_q = NULL;
+}
+
 /*******************************************************************************
  *
  * Function         gatt_free_pending_enc_queue
@@ -200,6 +223,57 @@ tGATT_VALUE* gatt_add_pending_ind(tGATT_TCB* p_tcb, tGATT_VALUE* p_ind) {
   return p_buf;
 }
 
+/*******************************************************************************
+ *
+ * Function     gatt_send_notif
+ *
+ * Description  Send a handle value notification, or hold it until the ATT
+ *              channel is uncongested. The notifications are sent in order:
+ *              a new one is held as long as older ones are.
+ *
+ * Returns    GATT_SUCCESS if sent, GATT_CONGESTED if sent or held while the
+ *            channel is congested, in which case the application should wait
+ *            for the channel to be uncongested to send more, and an error
+ *            code if the notification is dropped.
+ *
+ ******************************************************************************/
+tGATT_STATUS gatt_send_notif(tGATT_TCB* p_tcb, BT_HDR* p_buf) {
+  if (!p_tcb->congested && fixed_queue_is_empty(p_tcb->pending_notif_q)) {
+    tGATT_STATUS status = attp_send_sr_msg(p_tcb, p_buf);
+    if (status == GATT_CONGESTED) p_tcb->congested = true;
+    return status;
+  }
+
+  if (!fixed_queue_try_enqueue(p_tcb->pending_notif_q, p_buf)) {
+    GATT_TRACE_WARNING("%s: %d notifications pending, dropping", __func__,
+                       GATT_MAX_PENDING_NOTIF);
+    osi_free(p_buf);
+    return GATT_NO_RESOURCES;
+  }
+
+  return GATT_CONGESTED;
+}
+
+/*******************************************************************************
+ *
+ * Function     gatt_send_pending_notif
+ *
+ * Description  Send the notifications held for the ATT channel, until it is
+ *              congested again. L2CAP congests the channel when its share of
+ *              the controller ACL buffers is used up, so the notifications
+ *              go out at the pace the link takes them.
+ *
+ * Returns    None
+ *
+ ******************************************************************************/
+void gatt_send_pending_notif(tGATT_TCB* p_tcb) {
+  while (!p_tcb->congested && !fixed_queue_is_empty(p_tcb->pending_notif_q)) {
+    BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_tcb->pending_notif_q);
+    if (attp_send_sr_msg(p_tcb, p_buf) == GATT_CONGESTED)
+      p_tcb->congested = true;
+  }
+}
+
 /*******************************************************************************
  *
  * Function     gatt_add_srv_chg_clt
@@ -392,6 +466,84 @@ bool gatt_is_bda_connected(BD_ADDR bda) {
   return connected;
 }
 
+/* The buckets of an address and of a CID in the TCB hash tables */
+static tGATT_TCB** gatt_tcb_addr_bucket(const BD_ADDR bda) {
+  uint32_t hash = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) hash = hash * 31 + bda[i];
+  return &gatt_cb.p_tcb_by_addr[hash & (GATT_TCB_HASH_SIZE - 1)];
+}
+
+static tGATT_TCB** gatt_tcb_cid_bucket(uint16_t lcid) {
+  return &gatt_cb.p_tcb_by_cid[lcid & (GATT_TCB_HASH_SIZE - 1)];
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_unhash_tcb
+ *
+ * Description      Remove a TCB from the hash tables, before it is cleared.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_unhash_tcb(tGATT_TCB* p_tcb) {
+  tGATT_TCB** pp_tcb;
+
+  for (pp_tcb = gatt_tcb_addr_bucket(p_tcb->peer_bda); *pp_tcb;
+       pp_tcb = &(*pp_tcb)->p_next_addr_tcb) {
+    if (*pp_tcb == p_tcb) {
+      *pp_tcb = p_tcb->p_next_addr_tcb;
+      break;
+    }
+  }
+  p_tcb->p_next_addr_tcb = NULL;
+
+  /* Only the dynamic CIDs are hashed, the fixed ones are shared by the LE
+   * links */
+  if (p_tcb->att_lcid < L2CAP_BASE_APPL_CID) return;
+
+  for (pp_tcb = gatt_tcb_cid_bucket(p_tcb->att_lcid); *pp_tcb;
+       pp_tcb = &(*pp_tcb)->p_next_cid_tcb) {
+    if (*pp_tcb == p_tcb) {
+      *pp_tcb = p_tcb->p_next_cid_tcb;
+      break;
+    }
+  }
+  p_tcb->p_next_cid_tcb = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_set_tcb_lcid
+ *
+ * Description      Set the L2CAP CID of the ATT channel of a TCB, and hash
+ *                  the TCB by the CID so gatt_find_tcb_by_cid finds it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_set_tcb_lcid(tGATT_TCB* p_tcb, uint16_t lcid) {
+  tGATT_TCB** pp_tcb;
+
+  if (p_tcb->att_lcid >= L2CAP_BASE_APPL_CID) {
+    for (pp_tcb = gatt_tcb_cid_bucket(p_tcb->att_lcid); *pp_tcb;
+         pp_tcb = &(*pp_tcb)->p_next_cid_tcb) {
+      if (*pp_tcb == p_tcb) {
+        *pp_tcb = p_tcb->p_next_cid_tcb;
+        break;
+      }
+    }
+    p_tcb->p_next_cid_tcb = NULL;
+  }
+
+  p_tcb->att_lcid = lcid;
+  if (lcid < L2CAP_BASE_APPL_CID) return;
+
+  pp_tcb = gatt_tcb_cid_bucket(lcid);
+  p_tcb->p_next_cid_tcb = *pp_tcb;
+  *pp_tcb = p_tcb;
+}
+
 /*******************************************************************************
  *
  * Function         gatt_find_i_tcb_by_addr
@@ -402,12 +554,12 @@ bool gatt_is_bda_connected(BD_ADDR bda) {
  *
  ******************************************************************************/
 uint8_t gatt_find_i_tcb_by_addr(BD_ADDR bda, tBT_TRANSPORT transport) {
-  uint8_t i = 0;
+  tGATT_TCB* p_tcb = *gatt_tcb_addr_bucket(bda);
 
-  for (; i < GATT_MAX_PHY_CHANNEL; i++) {
-    if (!memcmp(gatt_cb.tcb[i].peer_bda, bda, BD_ADDR_LEN) &&
-        gatt_cb.tcb[i].transport == transport) {
-      return i;
+  for (; p_tcb; p_tcb = p_tcb->p_next_addr_tcb) {
+    if (!memcmp(p_tcb->peer_bda, bda, BD_ADDR_LEN) &&
+        p_tcb->transport == transport) {
+      return p_tcb->tcb_idx;
     }
   }
   return GATT_INDEX_INVALID;
@@ -497,13 +649,18 @@ tGATT_TCB* gatt_allocate_tcb_by_bdaddr(BD_ADDR bda, tBT_TRANSPORT transport) {
       memset(p_tcb, 0, sizeof(tGATT_TCB));
       p_tcb->pending_enc_clcb = fixed_queue_new(SIZE_MAX);
       p_tcb->pending_ind_q = fixed_queue_new(SIZE_MAX);
+      p_tcb->pending_notif_q = fixed_queue_new(GATT_MAX_PENDING_NOTIF);
       p_tcb->conf_timer = alarm_new("gatt.conf_timer");
       p_tcb->ind_ack_timer = alarm_new("gatt.ind_ack_timer");
       p_tcb->in_use = true;
       p_tcb->tcb_idx = i;
       p_tcb->transport = transport;
+      memcpy(p_tcb->peer_bda, bda, BD_ADDR_LEN);
+
+      tGATT_TCB** pp_bucket = gatt_tcb_addr_bucket(bda);
+      p_tcb->p_next_addr_tcb = *pp_bucket;
+      *pp_bucket = p_tcb;
     }
-    memcpy(p_tcb->peer_bda, bda, BD_ADDR_LEN);
   }
   return p_tcb;
 }
@@ -553,47 +710,12 @@ void gatt_convert_uuid32_to_uuid128(uint8_t uuid_128[LEN_UUID_128],
  *
  ******************************************************************************/
 bool gatt_uuid_compare(tBT_UUID src, tBT_UUID tar) {
-  uint8_t su[LEN_UUID_128], tu[LEN_UUID_128];
-  uint8_t *ps, *pt;
-
   /* any of the UUID is unspecified */
   if (src.len == 0 || tar.len == 0) {
     return true;
   }
 
-  /* If both are 16-bit, we can do a simple compare */
-  if (src.len == LEN_UUID_16 && tar.len == LEN_UUID_16) {
-    return src.uu.uuid16 == tar.uu.uuid16;
-  }
-
-  /* If both are 32-bit, we can do a simple compare */
-  if (src.len == LEN_UUID_32 && tar.len == LEN_UUID_32) {
-    return src.uu.uuid32 == tar.uu.uuid32;
-  }
-
-  /* One or both of the UUIDs is 128-bit */
-  if (src.len == LEN_UUID_16) {
-    /* convert a 16 bits UUID to 128 bits value */
-    gatt_convert_uuid16_to_uuid128(su, src.uu.uuid16);
-    ps = su;
-  } else if (src.len == LEN_UUID_32) {
-    gatt_convert_uuid32_to_uuid128(su, src.uu.uuid32);
-    ps = su;
-  } else
-    ps = src.uu.uuid128;
-
-  if (tar.len == LEN_UUID_16) {
-    /* convert a 16 bits UUID to 128 bits value */
-    gatt_convert_uuid16_to_uuid128(tu, tar.uu.uuid16);
-    pt = tu;
-  } else if (tar.len == LEN_UUID_32) {
-    /* convert a 32 bits UUID to 128 bits value */
-    gatt_convert_uuid32_to_uuid128(tu, tar.uu.uuid32);
-    pt = tu;
-  } else
-    pt = tar.uu.uuid128;
-
-  return (memcmp(ps, pt, LEN_UUID_128) == 0);
+  return BtUuidKey::Equal(src, tar);
 }
 
 /*******************************************************************************
@@ -828,15 +950,29 @@ void gatt_ind_ack_timeout(void* data) {
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  auto it = gatt_sr_find_first_i_rcb(handle);
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
+  if (it != gatt_cb.srv_list_info->end() && it->s_hdl <= handle) return it;
 
-  return it;
+  return gatt_cb.srv_list_info->end();
+}
+
+/*******************************************************************************
+ *
+ * Description      Search for the first service that ends at or after a
+ *                  specific handle. The services that follow it in the list
+ *                  come after it in the database.
+ *
+ * Returns          The end of the list if not found. Otherwise the service.
+ *
+ ******************************************************************************/
+std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_first_i_rcb(
+    uint16_t handle) {
+  auto it = gatt_cb.srv_list_index->lower_bound(handle);
+
+  if (it == gatt_cb.srv_list_index->end()) return gatt_cb.srv_list_info->end();
+
+  return it->second;
 }
 
 /*******************************************************************************
@@ -1068,25 +1204,23 @@ bool gatt_is_clcb_allocated(uint16_t conn_id) {
  *
  ******************************************************************************/
 tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id) {
-  uint8_t i = 0;
+  uint16_t i = 0;
   tGATT_CLCB* p_clcb = NULL;
   tGATT_IF gatt_if = GATT_GET_GATT_IF(conn_id);
   uint8_t tcb_idx = GATT_GET_TCB_IDX(conn_id);
   tGATT_TCB* p_tcb = gatt_get_tcb_by_idx(tcb_idx);
   tGATT_REG* p_reg = gatt_get_regcb(gatt_if);
 
-  for (i = 0; i < GATT_CL_MAX_LCB; i++) {
-    if (!gatt_cb.clcb[i].in_use) {
-      p_clcb = &gatt_cb.clcb[i];
+  if (gatt_cb.num_free_clcb == 0) return NULL;
 
-      p_clcb->in_use = true;
-      p_clcb->conn_id = conn_id;
-      p_clcb->clcb_idx = i;
-      p_clcb->p_reg = p_reg;
-      p_clcb->p_tcb = p_tcb;
-      break;
-    }
-  }
+  i = gatt_cb.free_clcb_idx[--gatt_cb.num_free_clcb];
+  p_clcb = &gatt_cb.clcb[i];
+
+  p_clcb->in_use = true;
+  p_clcb->conn_id = conn_id;
+  p_clcb->clcb_idx = i;
+  p_clcb->p_reg = p_reg;
+  p_clcb->p_tcb = p_tcb;
   return p_clcb;
 }
 
@@ -1103,6 +1237,7 @@ tGATT_CLCB* gatt_clcb_alloc(uint16_t conn_id) {
 void gatt_clcb_dealloc(tGATT_CLCB* p_clcb) {
   if (p_clcb && p_clcb->in_use) {
     alarm_free(p_clcb->gatt_rsp_timer_ent);
+    gatt_cb.free_clcb_idx[gatt_cb.num_free_clcb++] = p_clcb->clcb_idx;
     memset(p_clcb, 0, sizeof(tGATT_CLCB));
   }
 }
@@ -1121,6 +1256,14 @@ tGATT_TCB* gatt_find_tcb_by_cid(uint16_t lcid) {
   uint16_t xx = 0;
   tGATT_TCB* p_tcb = NULL;
 
+  if (lcid >= L2CAP_BASE_APPL_CID) {
+    for (p_tcb = *gatt_tcb_cid_bucket(lcid); p_tcb;
+         p_tcb = p_tcb->p_next_cid_tcb) {
+      if (p_tcb->att_lcid == lcid) break;
+    }
+    return p_tcb;
+  }
+
   for (xx = 0; xx < GATT_MAX_PHY_CHANNEL; xx++) {
     if (gatt_cb.tcb[xx].in_use && gatt_cb.tcb[xx].att_lcid == lcid) {
       p_tcb = &gatt_cb.tcb[xx];
@@ -1608,6 +1751,7 @@ void gatt_cleanup_upon_disc(BD_ADDR bda, uint16_t reason,
     alarm_free(p_tcb->conf_timer);
     p_tcb->conf_timer = NULL;
     gatt_free_pending_ind(p_tcb);
+    gatt_free_pending_notif(p_tcb);
     gatt_free_pending_enc_queue(p_tcb);
     fixed_queue_free(p_tcb->sr_cmd.multi_rsp_q, NULL);
     p_tcb->sr_cmd.multi_rsp_q = NULL;
@@ -1622,6 +1766,7 @@ void gatt_cleanup_upon_disc(BD_ADDR bda, uint16_t reason,
                                    transport);
       }
     }
+    gatt_unhash_tcb(p_tcb);
     memset(p_tcb, 0, sizeof(tGATT_TCB));
   }
   GATT_TRACE_DEBUG("exit gatt_cleanup_upon_disc ");
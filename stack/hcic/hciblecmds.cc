@@ -26,6 +26,7 @@
 #include "bt_common.h"
 #include "bt_target.h"
 #include "btu.h"
+#include "hci_event_filter.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 
@@ -34,7 +35,7 @@
 #include <string.h>
 
 void btsnd_hcic_ble_set_local_used_feat(uint8_t feat_set[8]) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SET_USED_FEAT_CMD;
@@ -47,7 +48,7 @@ void btsnd_hcic_ble_set_local_used_feat(uint8_t feat_set[8]) {
 }
 
 void btsnd_hcic_ble_set_random_addr(BD_ADDR random_bda) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_RANDOM_ADDR_CMD;
@@ -66,7 +67,7 @@ void btsnd_hcic_ble_write_adv_params(uint16_t adv_int_min, uint16_t adv_int_max,
                                      uint8_t addr_type_dir, BD_ADDR direct_bda,
                                      uint8_t channel_map,
                                      uint8_t adv_filter_policy) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_ADV_PARAMS;
@@ -87,7 +88,7 @@ void btsnd_hcic_ble_write_adv_params(uint16_t adv_int_min, uint16_t adv_int_max,
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 void btsnd_hcic_ble_read_adv_chnl_tx_power(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CMD;
@@ -100,7 +101,7 @@ void btsnd_hcic_ble_read_adv_chnl_tx_power(void) {
 }
 
 void btsnd_hcic_ble_set_adv_data(uint8_t data_len, uint8_t* p_data) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_ADV_DATA + 1;
@@ -122,7 +123,7 @@ void btsnd_hcic_ble_set_adv_data(uint8_t data_len, uint8_t* p_data) {
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 void btsnd_hcic_ble_set_scan_rsp_data(uint8_t data_len, uint8_t* p_scan_rsp) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_SCAN_RSP + 1;
@@ -146,7 +147,7 @@ void btsnd_hcic_ble_set_scan_rsp_data(uint8_t data_len, uint8_t* p_scan_rsp) {
 }
 
 void btsnd_hcic_ble_set_adv_enable(uint8_t adv_enable) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_ADV_ENABLE;
@@ -162,7 +163,7 @@ void btsnd_hcic_ble_set_adv_enable(uint8_t adv_enable) {
 void btsnd_hcic_ble_set_scan_params(uint8_t scan_type, uint16_t scan_int,
                                     uint16_t scan_win, uint8_t addr_type_own,
                                     uint8_t scan_filter_policy) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_SCAN_PARAM;
@@ -181,7 +182,7 @@ void btsnd_hcic_ble_set_scan_params(uint8_t scan_type, uint16_t scan_int,
 }
 
 void btsnd_hcic_ble_set_scan_enable(uint8_t scan_enable, uint8_t duplicate) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_WRITE_SCAN_ENABLE;
@@ -193,7 +194,14 @@ void btsnd_hcic_ble_set_scan_enable(uint8_t scan_enable, uint8_t duplicate) {
   UINT8_TO_STREAM(pp, scan_enable);
   UINT8_TO_STREAM(pp, duplicate);
 
+  /* The reports are asked for before the scan starts */
+  if (scan_enable)
+    hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, true);
+
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+
+  if (!scan_enable)
+    hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, false);
 }
 
 /* link layer connection management commands */
@@ -204,7 +212,7 @@ void btsnd_hcic_ble_create_ll_conn(uint16_t scan_int, uint16_t scan_win,
                                    uint16_t conn_int_max, uint16_t conn_latency,
                                    uint16_t conn_timeout, uint16_t min_ce_len,
                                    uint16_t max_ce_len) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_CREATE_LL_CONN;
@@ -233,7 +241,7 @@ void btsnd_hcic_ble_create_ll_conn(uint16_t scan_int, uint16_t scan_win,
 }
 
 void btsnd_hcic_ble_create_conn_cancel(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_CREATE_CONN_CANCEL;
@@ -246,7 +254,7 @@ void btsnd_hcic_ble_create_conn_cancel(void) {
 }
 
 void btsnd_hcic_ble_clear_white_list(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CLEAR_WHITE_LIST;
@@ -259,7 +267,7 @@ void btsnd_hcic_ble_clear_white_list(void) {
 }
 
 void btsnd_hcic_ble_add_white_list(uint8_t addr_type, BD_ADDR bda) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ADD_WHITE_LIST;
@@ -275,7 +283,7 @@ void btsnd_hcic_ble_add_white_list(uint8_t addr_type, BD_ADDR bda) {
 }
 
 void btsnd_hcic_ble_remove_from_white_list(uint8_t addr_type, BD_ADDR bda) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_REMOVE_WHITE_LIST;
@@ -296,7 +304,7 @@ void btsnd_hcic_ble_upd_ll_conn_params(uint16_t handle, uint16_t conn_int_min,
                                        uint16_t conn_timeout,
                                        uint16_t min_ce_len,
                                        uint16_t max_ce_len) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_UPD_LL_CONN_PARAMS;
@@ -319,7 +327,7 @@ void btsnd_hcic_ble_upd_ll_conn_params(uint16_t handle, uint16_t conn_int_min,
 
 void btsnd_hcic_ble_set_host_chnl_class(
     uint8_t chnl_map[HCIC_BLE_CHNL_MAP_SIZE]) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SET_HOST_CHNL_CLASS;
@@ -334,7 +342,7 @@ void btsnd_hcic_ble_set_host_chnl_class(
 }
 
 void btsnd_hcic_ble_read_chnl_map(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CHNL_MAP;
@@ -349,7 +357,7 @@ void btsnd_hcic_ble_read_chnl_map(uint16_t handle) {
 }
 
 void btsnd_hcic_ble_read_remote_feat(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_READ_REMOTE_FEAT;
@@ -366,7 +374,7 @@ void btsnd_hcic_ble_read_remote_feat(uint16_t handle) {
 /* security management commands */
 void btsnd_hcic_ble_encrypt(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
                             uint8_t pt_len, void* p_cmd_cplt_cback) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_ENCRYPT;
@@ -407,7 +415,7 @@ void btsnd_hcic_ble_start_enc(uint16_t handle,
                               uint8_t rand[HCIC_BLE_RAND_DI_SIZE],
                               uint16_t ediv,
                               uint8_t ltk[HCIC_BLE_ENCRYT_KEY_SIZE]) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_START_ENC;
@@ -426,7 +434,7 @@ void btsnd_hcic_ble_start_enc(uint16_t handle,
 
 void btsnd_hcic_ble_ltk_req_reply(uint16_t handle,
                                   uint8_t ltk[HCIC_BLE_ENCRYT_KEY_SIZE]) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_LTK_REQ_REPLY;
@@ -442,7 +450,7 @@ void btsnd_hcic_ble_ltk_req_reply(uint16_t handle,
 }
 
 void btsnd_hcic_ble_ltk_req_neg_reply(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_LTK_REQ_NEG_REPLY;
@@ -457,7 +465,7 @@ void btsnd_hcic_ble_ltk_req_neg_reply(uint16_t handle) {
 }
 
 void btsnd_hcic_ble_receiver_test(uint8_t rx_freq) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -473,7 +481,7 @@ void btsnd_hcic_ble_receiver_test(uint8_t rx_freq) {
 
 void btsnd_hcic_ble_transmitter_test(uint8_t tx_freq, uint8_t test_data_len,
                                      uint8_t payload) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM3;
@@ -490,7 +498,7 @@ void btsnd_hcic_ble_transmitter_test(uint8_t tx_freq, uint8_t test_data_len,
 }
 
 void btsnd_hcic_ble_test_end(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CMD;
@@ -503,7 +511,7 @@ void btsnd_hcic_ble_test_end(void) {
 }
 
 void btsnd_hcic_ble_read_host_supported(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CMD;
@@ -523,7 +531,7 @@ void btsnd_hcic_ble_rc_param_req_reply(uint16_t handle, uint16_t conn_int_min,
                                        uint16_t conn_timeout,
                                        uint16_t min_ce_len,
                                        uint16_t max_ce_len) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_RC_PARAM_REQ_REPLY;
@@ -544,7 +552,7 @@ void btsnd_hcic_ble_rc_param_req_reply(uint16_t handle, uint16_t conn_int_min,
 }
 
 void btsnd_hcic_ble_rc_param_req_neg_reply(uint16_t handle, uint8_t reason) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_RC_PARAM_REQ_NEG_REPLY;
@@ -563,7 +571,7 @@ void btsnd_hcic_ble_rc_param_req_neg_reply(uint16_t handle, uint8_t reason) {
 void btsnd_hcic_ble_add_device_resolving_list(
     uint8_t addr_type_peer, BD_ADDR bda_peer,
     uint8_t irk_peer[HCIC_BLE_IRK_SIZE], uint8_t irk_local[HCIC_BLE_IRK_SIZE]) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_ADD_DEV_RESOLVING_LIST;
@@ -581,7 +589,7 @@ void btsnd_hcic_ble_add_device_resolving_list(
 
 void btsnd_hcic_ble_rm_device_resolving_list(uint8_t addr_type_peer,
                                              BD_ADDR bda_peer) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_RM_DEV_RESOLVING_LIST;
@@ -597,7 +605,7 @@ void btsnd_hcic_ble_rm_device_resolving_list(uint8_t addr_type_peer,
 
 void btsnd_hcic_ble_set_privacy_mode(uint8_t addr_type_peer, BD_ADDR bda_peer,
                                      uint8_t privacy_type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_PRIVACY_MODE;
@@ -613,7 +621,7 @@ void btsnd_hcic_ble_set_privacy_mode(uint8_t addr_type_peer, BD_ADDR bda_peer,
 }
 
 void btsnd_hcic_ble_clear_resolving_list(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_CLEAR_RESOLVING_LIST;
@@ -627,7 +635,7 @@ void btsnd_hcic_ble_clear_resolving_list(void) {
 
 void btsnd_hcic_ble_read_resolvable_addr_peer(uint8_t addr_type_peer,
                                               BD_ADDR bda_peer) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_READ_RESOLVABLE_ADDR_PEER;
@@ -643,7 +651,7 @@ void btsnd_hcic_ble_read_resolvable_addr_peer(uint8_t addr_type_peer,
 
 void btsnd_hcic_ble_read_resolvable_addr_local(uint8_t addr_type_peer,
                                                BD_ADDR bda_peer) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_READ_RESOLVABLE_ADDR_LOCAL;
@@ -658,7 +666,7 @@ void btsnd_hcic_ble_read_resolvable_addr_local(uint8_t addr_type_peer,
 }
 
 void btsnd_hcic_ble_set_addr_resolution_enable(uint8_t addr_resolution_enable) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_ADDR_RESOLUTION_ENABLE;
@@ -672,7 +680,7 @@ void btsnd_hcic_ble_set_addr_resolution_enable(uint8_t addr_resolution_enable) {
 }
 
 void btsnd_hcic_ble_set_rand_priv_addr_timeout(uint16_t rpa_timout) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_RAND_PRIV_ADDR_TIMOUT;
@@ -687,7 +695,7 @@ void btsnd_hcic_ble_set_rand_priv_addr_timeout(uint16_t rpa_timout) {
 
 void btsnd_hcic_ble_set_data_length(uint16_t conn_handle, uint16_t tx_octets,
                                     uint16_t tx_time) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_DATA_LENGTH;
@@ -703,11 +711,32 @@ void btsnd_hcic_ble_set_data_length(uint16_t conn_handle, uint16_t tx_octets,
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 
+void btsnd_hcic_ble_set_phy(uint16_t conn_handle, uint8_t all_phys,
+                            uint8_t tx_phys, uint8_t rx_phys,
+                            uint16_t phy_options) {
+  BT_HDR* p = HCI_GET_CMD_BUF();
+  uint8_t* pp = (uint8_t*)(p + 1);
+
+  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_BLE_SET_PHY;
+  p->offset = 0;
+
+  UINT16_TO_STREAM(pp, HCI_LE_SET_PHY);
+  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_BLE_SET_PHY);
+
+  UINT16_TO_STREAM(pp, conn_handle);
+  UINT8_TO_STREAM(pp, all_phys);
+  UINT8_TO_STREAM(pp, tx_phys);
+  UINT8_TO_STREAM(pp, rx_phys);
+  UINT16_TO_STREAM(pp, phy_options);
+
+  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+}
+
 void btsnd_hcic_ble_set_extended_scan_params(uint8_t own_address_type,
                                              uint8_t scanning_filter_policy,
                                              uint8_t scanning_phys,
                                              scanning_phy_cfg* phy_cfg) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   int phy_cnt =
@@ -737,7 +766,7 @@ void btsnd_hcic_ble_set_extended_scan_enable(uint8_t enable,
                                              uint8_t filter_duplicates,
                                              uint16_t duration,
                                              uint16_t period) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   const int param_len = 6;
@@ -752,7 +781,13 @@ void btsnd_hcic_ble_set_extended_scan_enable(uint8_t enable,
   UINT16_TO_STREAM(pp, duration);
   UINT16_TO_STREAM(pp, period);
 
+  if (enable)
+    hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, true);
+
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+
+  if (!enable)
+    hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_LE_SCAN, false);
 }
 
 void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
@@ -760,7 +795,7 @@ void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
                                     uint8_t addr_type_peer, BD_ADDR bda_peer,
                                     uint8_t initiating_phys,
                                     EXT_CONN_PHY_CFG* phy_cfg) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   int phy_cnt =
@@ -796,3 +831,168 @@ void btsnd_hcic_ble_ext_create_conn(uint8_t init_filter_policy,
 
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
+
+void btsnd_hcic_ble_set_cig_params(
+    uint8_t cig_id, uint32_t sdu_itv_mtos, uint32_t sdu_itv_stom, uint8_t sca,
+    uint8_t packing, uint8_t framing, uint16_t max_trans_lat_mtos,
+    uint16_t max_trans_lat_stom, uint8_t cis_cnt, const CIS_CFG* cis_cfg,
+    base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 15 + cis_cnt * 9;
+  uint8_t param[UINT8_MAX];
+  uint8_t* pp = param;
+  CHECK(params_len <= UINT8_MAX);
+
+  UINT8_TO_STREAM(pp, cig_id);
+  UINT24_TO_STREAM(pp, sdu_itv_mtos);
+  UINT24_TO_STREAM(pp, sdu_itv_stom);
+  UINT8_TO_STREAM(pp, sca);
+  UINT8_TO_STREAM(pp, packing);
+  UINT8_TO_STREAM(pp, framing);
+  UINT16_TO_STREAM(pp, max_trans_lat_mtos);
+  UINT16_TO_STREAM(pp, max_trans_lat_stom);
+  UINT8_TO_STREAM(pp, cis_cnt);
+
+  for (int i = 0; i < cis_cnt; i++) {
+    UINT8_TO_STREAM(pp, cis_cfg[i].cis_id);
+    UINT16_TO_STREAM(pp, cis_cfg[i].max_sdu_size_mtos);
+    UINT16_TO_STREAM(pp, cis_cfg[i].max_sdu_size_stom);
+    UINT8_TO_STREAM(pp, cis_cfg[i].phy_mtos);
+    UINT8_TO_STREAM(pp, cis_cfg[i].phy_stom);
+    UINT8_TO_STREAM(pp, cis_cfg[i].rtn_mtos);
+    UINT8_TO_STREAM(pp, cis_cfg[i].rtn_stom);
+  }
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_SET_CIG_PARAMS, param,
+                            params_len, std::move(cb));
+}
+
+void btsnd_hcic_ble_create_cis(uint8_t num_cis, const uint16_t* cis_handles,
+                               const uint16_t* acl_handles,
+                               base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 1 + num_cis * 4;
+  uint8_t param[UINT8_MAX];
+  uint8_t* pp = param;
+  CHECK(params_len <= UINT8_MAX);
+
+  UINT8_TO_STREAM(pp, num_cis);
+  for (int i = 0; i < num_cis; i++) {
+    UINT16_TO_STREAM(pp, cis_handles[i]);
+    UINT16_TO_STREAM(pp, acl_handles[i]);
+  }
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_CREATE_CIS, param, params_len,
+                            std::move(cb));
+}
+
+void btsnd_hcic_ble_remove_cig(uint8_t cig_id,
+                               base::Callback<void(uint8_t*, uint16_t)> cb) {
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_REMOVE_CIG, &cig_id, 1,
+                            std::move(cb));
+}
+
+void btsnd_hcic_ble_accept_cis_req(
+    uint16_t cis_handle, base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 2;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, cis_handle);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_ACCEPT_CIS_REQ, param,
+                            params_len, std::move(cb));
+}
+
+void btsnd_hcic_ble_reject_cis_req(
+    uint16_t cis_handle, uint8_t reason,
+    base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 3;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, cis_handle);
+  UINT8_TO_STREAM(pp, reason);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_REJECT_CIS_REQ, param,
+                            params_len, std::move(cb));
+}
+
+void btsnd_hcic_ble_create_big(uint8_t big_handle, uint8_t adv_handle,
+                               uint8_t num_bis, uint32_t sdu_itv,
+                               uint16_t max_sdu_size, uint16_t max_trans_lat,
+                               uint8_t rtn, uint8_t phy, uint8_t packing,
+                               uint8_t framing, uint8_t enc,
+                               const uint8_t* bcst_code,
+                               base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 15 + HCIC_BLE_ISO_BCST_CODE_SIZE;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT8_TO_STREAM(pp, big_handle);
+  UINT8_TO_STREAM(pp, adv_handle);
+  UINT8_TO_STREAM(pp, num_bis);
+  UINT24_TO_STREAM(pp, sdu_itv);
+  UINT16_TO_STREAM(pp, max_sdu_size);
+  UINT16_TO_STREAM(pp, max_trans_lat);
+  UINT8_TO_STREAM(pp, rtn);
+  UINT8_TO_STREAM(pp, phy);
+  UINT8_TO_STREAM(pp, packing);
+  UINT8_TO_STREAM(pp, framing);
+  UINT8_TO_STREAM(pp, enc);
+  if (bcst_code != NULL) {
+    ARRAY_TO_STREAM(pp, bcst_code, HCIC_BLE_ISO_BCST_CODE_SIZE);
+  } else {
+    memset(pp, 0, HCIC_BLE_ISO_BCST_CODE_SIZE);
+  }
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_CREATE_BIG, param, params_len,
+                            std::move(cb));
+}
+
+void btsnd_hcic_ble_term_big(uint8_t big_handle, uint8_t reason,
+                             base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 2;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT8_TO_STREAM(pp, big_handle);
+  UINT8_TO_STREAM(pp, reason);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_TERMINATE_BIG, param,
+                            params_len, std::move(cb));
+}
+
+void btsnd_hcic_ble_setup_iso_data_path(
+    uint16_t iso_handle, uint8_t data_path_dir, uint8_t data_path_id,
+    uint8_t codec_id_format, uint16_t codec_id_company,
+    uint16_t codec_id_vendor, uint32_t controller_delay,
+    base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 13;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, iso_handle);
+  UINT8_TO_STREAM(pp, data_path_dir);
+  UINT8_TO_STREAM(pp, data_path_id);
+  UINT8_TO_STREAM(pp, codec_id_format);
+  UINT16_TO_STREAM(pp, codec_id_company);
+  UINT16_TO_STREAM(pp, codec_id_vendor);
+  UINT24_TO_STREAM(pp, controller_delay);
+  UINT8_TO_STREAM(pp, 0); /* no codec configuration */
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_SETUP_ISO_DATA_PATH, param,
+                            params_len, std::move(cb));
+}
+
+void btsnd_hcic_ble_remove_iso_data_path(
+    uint16_t iso_handle, uint8_t data_path_dir,
+    base::Callback<void(uint8_t*, uint16_t)> cb) {
+  const int params_len = 3;
+  uint8_t param[params_len];
+  uint8_t* pp = param;
+
+  UINT16_TO_STREAM(pp, iso_handle);
+  UINT8_TO_STREAM(pp, data_path_dir);
+
+  btu_hcif_send_cmd_with_cb(FROM_HERE, HCI_BLE_REMOVE_ISO_DATA_PATH, param,
+                            params_len, std::move(cb));
+}
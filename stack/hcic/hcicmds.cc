@@ -26,6 +26,7 @@
 #include "bt_common.h"
 #include "bt_target.h"
 #include "btu.h"
+#include "hci_event_filter.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
 
@@ -36,7 +37,7 @@
 
 void btsnd_hcic_inquiry(const LAP inq_lap, uint8_t duration,
                         uint8_t response_cnt) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_INQUIRY;
@@ -49,11 +50,14 @@ void btsnd_hcic_inquiry(const LAP inq_lap, uint8_t duration,
   UINT8_TO_STREAM(pp, duration);
   UINT8_TO_STREAM(pp, response_cnt);
 
+  /* The results are asked for before the inquiry starts */
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, true);
+
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 
 void btsnd_hcic_inq_cancel(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_INQ_CANCEL;
@@ -62,12 +66,14 @@ void btsnd_hcic_inq_cancel(void) {
   UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_INQ_CANCEL);
 
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_INQUIRY, false);
 }
 
 void btsnd_hcic_per_inq_mode(uint16_t max_period, uint16_t min_period,
                              const LAP inq_lap, uint8_t duration,
                              uint8_t response_cnt) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_PER_INQ_MODE;
@@ -82,11 +88,14 @@ void btsnd_hcic_per_inq_mode(uint16_t max_period, uint16_t min_period,
   UINT8_TO_STREAM(pp, duration);
   UINT8_TO_STREAM(pp, response_cnt);
 
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_PERIODIC_INQUIRY,
+                                      true);
+
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 
 void btsnd_hcic_exit_per_inq(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_EXIT_PER_INQ;
@@ -95,12 +104,15 @@ void btsnd_hcic_exit_per_inq(void) {
   UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_EXIT_PER_INQ);
 
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+
+  hci_event_filter_set_feature_active(HCI_EVENT_FEATURE_PERIODIC_INQUIRY,
+                                      false);
 }
 
 void btsnd_hcic_create_conn(BD_ADDR dest, uint16_t packet_types,
                             uint8_t page_scan_rep_mode, uint8_t page_scan_mode,
                             uint16_t clock_offset, uint8_t allow_switch) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
 #ifndef BT_10A
@@ -128,7 +140,7 @@ void btsnd_hcic_create_conn(BD_ADDR dest, uint16_t packet_types,
 }
 
 void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_DISCONNECT;
@@ -144,7 +156,7 @@ void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {
 
 #if (BTM_SCO_INCLUDED == TRUE)
 void btsnd_hcic_add_SCO_conn(uint16_t handle, uint16_t packet_types) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ADD_SCO_CONN;
@@ -161,7 +173,7 @@ void btsnd_hcic_add_SCO_conn(uint16_t handle, uint16_t packet_types) {
 #endif /* BTM_SCO_INCLUDED */
 
 void btsnd_hcic_create_conn_cancel(BD_ADDR dest) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CREATE_CONN_CANCEL;
@@ -176,7 +188,7 @@ void btsnd_hcic_create_conn_cancel(BD_ADDR dest) {
 }
 
 void btsnd_hcic_accept_conn(BD_ADDR dest, uint8_t role) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ACCEPT_CONN;
@@ -191,7 +203,7 @@ void btsnd_hcic_accept_conn(BD_ADDR dest, uint8_t role) {
 }
 
 void btsnd_hcic_reject_conn(BD_ADDR dest, uint8_t reason) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_REJECT_CONN;
@@ -207,7 +219,7 @@ void btsnd_hcic_reject_conn(BD_ADDR dest, uint8_t reason) {
 }
 
 void btsnd_hcic_link_key_req_reply(BD_ADDR bd_addr, LINK_KEY link_key) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_LINK_KEY_REQ_REPLY;
@@ -223,7 +235,7 @@ void btsnd_hcic_link_key_req_reply(BD_ADDR bd_addr, LINK_KEY link_key) {
 }
 
 void btsnd_hcic_link_key_neg_reply(BD_ADDR bd_addr) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_LINK_KEY_NEG_REPLY;
@@ -239,7 +251,7 @@ void btsnd_hcic_link_key_neg_reply(BD_ADDR bd_addr) {
 
 void btsnd_hcic_pin_code_req_reply(BD_ADDR bd_addr, uint8_t pin_code_len,
                                    PIN_CODE pin_code) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
   int i;
 
@@ -260,7 +272,7 @@ void btsnd_hcic_pin_code_req_reply(BD_ADDR bd_addr, uint8_t pin_code_len,
 }
 
 void btsnd_hcic_pin_code_neg_reply(BD_ADDR bd_addr) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_PIN_CODE_NEG_REPLY;
@@ -275,7 +287,7 @@ void btsnd_hcic_pin_code_neg_reply(BD_ADDR bd_addr) {
 }
 
 void btsnd_hcic_change_conn_type(uint16_t handle, uint16_t packet_types) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CHANGE_CONN_TYPE;
@@ -291,7 +303,7 @@ void btsnd_hcic_change_conn_type(uint16_t handle, uint16_t packet_types) {
 }
 
 void btsnd_hcic_auth_request(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -306,7 +318,7 @@ void btsnd_hcic_auth_request(uint16_t handle) {
 }
 
 void btsnd_hcic_set_conn_encrypt(uint16_t handle, bool enable) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SET_CONN_ENCRYPT;
@@ -323,7 +335,7 @@ void btsnd_hcic_set_conn_encrypt(uint16_t handle, bool enable) {
 
 void btsnd_hcic_rmt_name_req(BD_ADDR bd_addr, uint8_t page_scan_rep_mode,
                              uint8_t page_scan_mode, uint16_t clock_offset) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_RMT_NAME_REQ;
@@ -341,7 +353,7 @@ void btsnd_hcic_rmt_name_req(BD_ADDR bd_addr, uint8_t page_scan_rep_mode,
 }
 
 void btsnd_hcic_rmt_name_req_cancel(BD_ADDR bd_addr) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_RMT_NAME_REQ_CANCEL;
@@ -356,7 +368,7 @@ void btsnd_hcic_rmt_name_req_cancel(BD_ADDR bd_addr) {
 }
 
 void btsnd_hcic_rmt_features_req(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -371,7 +383,7 @@ void btsnd_hcic_rmt_features_req(uint16_t handle) {
 }
 
 void btsnd_hcic_rmt_ext_features(uint16_t handle, uint8_t page_num) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_RMT_EXT_FEATURES;
@@ -387,7 +399,7 @@ void btsnd_hcic_rmt_ext_features(uint16_t handle, uint8_t page_num) {
 }
 
 void btsnd_hcic_rmt_ver_req(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -402,7 +414,7 @@ void btsnd_hcic_rmt_ver_req(uint16_t handle) {
 }
 
 void btsnd_hcic_read_rmt_clk_offset(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -417,7 +429,7 @@ void btsnd_hcic_read_rmt_clk_offset(uint16_t handle) {
 }
 
 void btsnd_hcic_read_lmp_handle(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -435,7 +447,7 @@ void btsnd_hcic_setup_esco_conn(uint16_t handle, uint32_t transmit_bandwidth,
                                 uint32_t receive_bandwidth,
                                 uint16_t max_latency, uint16_t voice,
                                 uint8_t retrans_effort, uint16_t packet_types) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SETUP_ESCO;
@@ -460,7 +472,7 @@ void btsnd_hcic_accept_esco_conn(BD_ADDR bd_addr, uint32_t transmit_bandwidth,
                                  uint16_t max_latency, uint16_t content_fmt,
                                  uint8_t retrans_effort,
                                  uint16_t packet_types) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ACCEPT_ESCO;
@@ -481,7 +493,7 @@ void btsnd_hcic_accept_esco_conn(BD_ADDR bd_addr, uint32_t transmit_bandwidth,
 }
 
 void btsnd_hcic_reject_esco_conn(BD_ADDR bd_addr, uint8_t reason) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_REJECT_ESCO;
@@ -498,7 +510,7 @@ void btsnd_hcic_reject_esco_conn(BD_ADDR bd_addr, uint8_t reason) {
 
 void btsnd_hcic_hold_mode(uint16_t handle, uint16_t max_hold_period,
                           uint16_t min_hold_period) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_HOLD_MODE;
@@ -517,7 +529,7 @@ void btsnd_hcic_hold_mode(uint16_t handle, uint16_t max_hold_period,
 void btsnd_hcic_sniff_mode(uint16_t handle, uint16_t max_sniff_period,
                            uint16_t min_sniff_period, uint16_t sniff_attempt,
                            uint16_t sniff_timeout) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SNIFF_MODE;
@@ -536,7 +548,7 @@ void btsnd_hcic_sniff_mode(uint16_t handle, uint16_t max_sniff_period,
 }
 
 void btsnd_hcic_exit_sniff_mode(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -552,7 +564,7 @@ void btsnd_hcic_exit_sniff_mode(uint16_t handle) {
 
 void btsnd_hcic_park_mode(uint16_t handle, uint16_t beacon_max_interval,
                           uint16_t beacon_min_interval) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_PARK_MODE;
@@ -569,7 +581,7 @@ void btsnd_hcic_park_mode(uint16_t handle, uint16_t beacon_max_interval,
 }
 
 void btsnd_hcic_exit_park_mode(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -586,7 +598,7 @@ void btsnd_hcic_exit_park_mode(uint16_t handle) {
 void btsnd_hcic_qos_setup(uint16_t handle, uint8_t flags, uint8_t service_type,
                           uint32_t token_rate, uint32_t peak, uint32_t latency,
                           uint32_t delay_var) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_QOS_SETUP;
@@ -607,7 +619,7 @@ void btsnd_hcic_qos_setup(uint16_t handle, uint8_t flags, uint8_t service_type,
 }
 
 void btsnd_hcic_switch_role(BD_ADDR bd_addr, uint8_t role) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SWITCH_ROLE;
@@ -623,7 +635,7 @@ void btsnd_hcic_switch_role(BD_ADDR bd_addr, uint8_t role) {
 }
 
 void btsnd_hcic_write_policy_set(uint16_t handle, uint16_t settings) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_POLICY_SET;
@@ -638,7 +650,7 @@ void btsnd_hcic_write_policy_set(uint16_t handle, uint16_t settings) {
 }
 
 void btsnd_hcic_write_def_policy_set(uint16_t settings) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_DEF_POLICY_SET;
@@ -653,7 +665,7 @@ void btsnd_hcic_write_def_policy_set(uint16_t settings) {
 
 void btsnd_hcic_set_event_filter(uint8_t filt_type, uint8_t filt_cond_type,
                                  uint8_t* filt_cond, uint8_t filt_cond_len) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->offset = 0;
@@ -693,7 +705,7 @@ void btsnd_hcic_set_event_filter(uint8_t filt_type, uint8_t filt_cond_type,
 }
 
 void btsnd_hcic_write_pin_type(uint8_t type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -708,7 +720,7 @@ void btsnd_hcic_write_pin_type(uint8_t type) {
 }
 
 void btsnd_hcic_delete_stored_key(BD_ADDR bd_addr, bool delete_all_flag) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_DELETE_STORED_KEY;
@@ -724,7 +736,7 @@ void btsnd_hcic_delete_stored_key(BD_ADDR bd_addr, bool delete_all_flag) {
 }
 
 void btsnd_hcic_change_name(BD_NAME name) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
   uint16_t len = strlen((char*)name) + 1;
 
@@ -744,7 +756,7 @@ void btsnd_hcic_change_name(BD_NAME name) {
 }
 
 void btsnd_hcic_read_name(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CMD;
@@ -757,7 +769,7 @@ void btsnd_hcic_read_name(void) {
 }
 
 void btsnd_hcic_write_page_tout(uint16_t timeout) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM2;
@@ -772,7 +784,7 @@ void btsnd_hcic_write_page_tout(uint16_t timeout) {
 }
 
 void btsnd_hcic_write_scan_enable(uint8_t flag) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -787,7 +799,7 @@ void btsnd_hcic_write_scan_enable(uint8_t flag) {
 }
 
 void btsnd_hcic_write_pagescan_cfg(uint16_t interval, uint16_t window) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PAGESCAN_CFG;
@@ -803,7 +815,7 @@ void btsnd_hcic_write_pagescan_cfg(uint16_t interval, uint16_t window) {
 }
 
 void btsnd_hcic_write_inqscan_cfg(uint16_t interval, uint16_t window) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_INQSCAN_CFG;
@@ -819,7 +831,7 @@ void btsnd_hcic_write_inqscan_cfg(uint16_t interval, uint16_t window) {
 }
 
 void btsnd_hcic_write_auth_enable(uint8_t flag) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -834,7 +846,7 @@ void btsnd_hcic_write_auth_enable(uint8_t flag) {
 }
 
 void btsnd_hcic_write_dev_class(DEV_CLASS dev_class) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM3;
@@ -849,7 +861,7 @@ void btsnd_hcic_write_dev_class(DEV_CLASS dev_class) {
 }
 
 void btsnd_hcic_write_voice_settings(uint16_t flags) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM2;
@@ -864,7 +876,7 @@ void btsnd_hcic_write_voice_settings(uint16_t flags) {
 }
 
 void btsnd_hcic_write_auto_flush_tout(uint16_t handle, uint16_t tout) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_AUTO_FLUSH_TOUT;
@@ -880,7 +892,7 @@ void btsnd_hcic_write_auto_flush_tout(uint16_t handle, uint16_t tout) {
 }
 
 void btsnd_hcic_read_tx_power(uint16_t handle, uint8_t type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_TX_POWER;
@@ -897,7 +909,7 @@ void btsnd_hcic_read_tx_power(uint16_t handle, uint8_t type) {
 
 void btsnd_hcic_host_num_xmitted_pkts(uint8_t num_handles, uint16_t* handle,
                                       uint16_t* num_pkts) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + 1 + (num_handles * 4);
@@ -918,7 +930,7 @@ void btsnd_hcic_host_num_xmitted_pkts(uint8_t num_handles, uint16_t* handle,
 
 void btsnd_hcic_write_link_super_tout(uint8_t local_controller_id,
                                       uint16_t handle, uint16_t timeout) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_LINK_SUPER_TOUT;
@@ -934,7 +946,7 @@ void btsnd_hcic_write_link_super_tout(uint8_t local_controller_id,
 }
 
 void btsnd_hcic_write_cur_iac_lap(uint8_t num_cur_iac, LAP* const iac_lap) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + 1 + (LAP_LEN * num_cur_iac);
@@ -958,7 +970,7 @@ void btsnd_hcic_write_cur_iac_lap(uint8_t num_cur_iac, LAP* const iac_lap) {
 void btsnd_hcic_sniff_sub_rate(uint16_t handle, uint16_t max_lat,
                                uint16_t min_remote_lat,
                                uint16_t min_local_lat) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SNIFF_SUB_RATE;
@@ -994,7 +1006,7 @@ void btsnd_hcic_write_ext_inquiry_response(void* buffer, uint8_t fec_req) {
 
 void btsnd_hcic_io_cap_req_reply(BD_ADDR bd_addr, uint8_t capability,
                                  uint8_t oob_present, uint8_t auth_req) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_IO_CAP_RESP;
@@ -1013,7 +1025,7 @@ void btsnd_hcic_io_cap_req_reply(BD_ADDR bd_addr, uint8_t capability,
 
 void btsnd_hcic_enhanced_set_up_synchronous_connection(
     uint16_t conn_handle, enh_esco_params_t* p_params) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ENH_SET_ESCO_CONN;
@@ -1062,7 +1074,7 @@ void btsnd_hcic_enhanced_set_up_synchronous_connection(
 
 void btsnd_hcic_enhanced_accept_synchronous_connection(
     BD_ADDR bd_addr, enh_esco_params_t* p_params) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ENH_ACC_ESCO_CONN;
@@ -1110,7 +1122,7 @@ void btsnd_hcic_enhanced_accept_synchronous_connection(
 }
 
 void btsnd_hcic_io_cap_req_neg_reply(BD_ADDR bd_addr, uint8_t err_code) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_IO_CAP_NEG_REPLY;
@@ -1126,7 +1138,7 @@ void btsnd_hcic_io_cap_req_neg_reply(BD_ADDR bd_addr, uint8_t err_code) {
 }
 
 void btsnd_hcic_read_local_oob_data(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_R_LOCAL_OOB;
@@ -1139,7 +1151,7 @@ void btsnd_hcic_read_local_oob_data(void) {
 }
 
 void btsnd_hcic_user_conf_reply(BD_ADDR bd_addr, bool is_yes) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_UCONF_REPLY;
@@ -1161,7 +1173,7 @@ void btsnd_hcic_user_conf_reply(BD_ADDR bd_addr, bool is_yes) {
 }
 
 void btsnd_hcic_user_passkey_reply(BD_ADDR bd_addr, uint32_t value) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_U_PKEY_REPLY;
@@ -1177,7 +1189,7 @@ void btsnd_hcic_user_passkey_reply(BD_ADDR bd_addr, uint32_t value) {
 }
 
 void btsnd_hcic_user_passkey_neg_reply(BD_ADDR bd_addr) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_U_PKEY_NEG_REPLY;
@@ -1192,7 +1204,7 @@ void btsnd_hcic_user_passkey_neg_reply(BD_ADDR bd_addr) {
 }
 
 void btsnd_hcic_rem_oob_reply(BD_ADDR bd_addr, uint8_t* p_c, uint8_t* p_r) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_REM_OOB_REPLY;
@@ -1209,7 +1221,7 @@ void btsnd_hcic_rem_oob_reply(BD_ADDR bd_addr, uint8_t* p_c, uint8_t* p_r) {
 }
 
 void btsnd_hcic_rem_oob_neg_reply(BD_ADDR bd_addr) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_REM_OOB_NEG_REPLY;
@@ -1224,7 +1236,7 @@ void btsnd_hcic_rem_oob_neg_reply(BD_ADDR bd_addr) {
 }
 
 void btsnd_hcic_read_inq_tx_power(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_R_TX_POWER;
@@ -1237,7 +1249,7 @@ void btsnd_hcic_read_inq_tx_power(void) {
 }
 
 void btsnd_hcic_send_keypress_notif(BD_ADDR bd_addr, uint8_t notif) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_SEND_KEYPRESS_NOTIF;
@@ -1256,7 +1268,7 @@ void btsnd_hcic_send_keypress_notif(BD_ADDR bd_addr, uint8_t notif) {
 
 #if (L2CAP_NON_FLUSHABLE_PB_INCLUDED == TRUE)
 void btsnd_hcic_enhanced_flush(uint16_t handle, uint8_t packet_type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_ENHANCED_FLUSH;
@@ -1276,7 +1288,7 @@ void btsnd_hcic_enhanced_flush(uint16_t handle, uint8_t packet_type) {
  *************************/
 
 void btsnd_hcic_get_link_quality(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -1291,7 +1303,7 @@ void btsnd_hcic_get_link_quality(uint16_t handle) {
 }
 
 void btsnd_hcic_read_rssi(uint16_t handle) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
@@ -1305,8 +1317,23 @@ void btsnd_hcic_read_rssi(uint16_t handle) {
   btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
 }
 
+void btsnd_hcic_read_failed_contact_counter(uint16_t handle) {
+  BT_HDR* p = HCI_GET_CMD_BUF();
+  uint8_t* pp = (uint8_t*)(p + 1);
+
+  p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_CMD_HANDLE;
+  p->offset = 0;
+
+  UINT16_TO_STREAM(pp, HCI_READ_FAILED_CONTACT_COUNT);
+  UINT8_TO_STREAM(pp, HCIC_PARAM_SIZE_CMD_HANDLE);
+
+  UINT16_TO_STREAM(pp, handle);
+
+  btu_hcif_send_cmd(LOCAL_BR_EDR_CONTROLLER_ID, p);
+}
+
 void btsnd_hcic_enable_test_mode(void) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_READ_CMD;
@@ -1319,7 +1346,7 @@ void btsnd_hcic_enable_test_mode(void) {
 }
 
 void btsnd_hcic_write_inqscan_type(uint8_t type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -1334,7 +1361,7 @@ void btsnd_hcic_write_inqscan_type(uint8_t type) {
 }
 
 void btsnd_hcic_write_inquiry_mode(uint8_t mode) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -1349,7 +1376,7 @@ void btsnd_hcic_write_inquiry_mode(uint8_t mode) {
 }
 
 void btsnd_hcic_write_pagescan_type(uint8_t type) {
-  BT_HDR* p = (BT_HDR*)osi_malloc(HCI_CMD_BUF_SIZE);
+  BT_HDR* p = HCI_GET_CMD_BUF();
   uint8_t* pp = (uint8_t*)(p + 1);
 
   p->len = HCIC_PREAMBLE_SIZE + HCIC_PARAM_SIZE_WRITE_PARAM1;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP AAC ABR
+//
+// The AAC ABR (Adaptive Bit Rate) controller picks the AAC encoder bit rate
+// from the time the encoded packets spend in the transmit queue and the
+// congestion of the link. The bit rate is cut by a fraction as soon as the
+// queue delay builds up, and is raised back by small steps only after the
+// link has stayed clear for a while.
+//
+
+#ifndef A2DP_AAC_ABR_H
+#define A2DP_AAC_ABR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lowest bit rate the AAC ABR steps down to, in bits per second.
+#define A2DP_AAC_ABR_MIN_BIT_RATE (96 * 1000)
+// Bit rate added by each step up, in bits per second.
+#define A2DP_AAC_ABR_STEP_UP_BIT_RATE (32 * 1000)
+// Fraction of the bit rate kept by each step down, in percent.
+#define A2DP_AAC_ABR_STEP_DOWN_PERCENT 75
+
+// Queue delay above which the bit rate drops to the lowest one.
+#define A2DP_AAC_ABR_DELAY_CRITICAL_US (200 * 1000)
+// Queue delay above which the bit rate is stepped down.
+#define A2DP_AAC_ABR_DELAY_HIGH_US (80 * 1000)
+// Queue delay below which the link is considered clear.
+#define A2DP_AAC_ABR_DELAY_LOW_US (30 * 1000)
+// Minimum time between two consecutive step downs.
+#define A2DP_AAC_ABR_STEP_DOWN_INTERVAL_US (200 * 1000)
+// Time the link must stay clear before the bit rate is stepped up.
+#define A2DP_AAC_ABR_STEP_UP_INTERVAL_US (3000 * 1000)
+
+typedef struct {
+  uint32_t min_bit_rate;
+  uint32_t max_bit_rate;
+  uint32_t bit_rate;             // The current bit rate
+  uint64_t last_adjustment_us;   // Time of the last bit rate change
+  uint64_t clear_since_us;       // Start of the current clear period, or 0
+  uint64_t last_queue_delay_us;  // The last reported transmit queue delay
+  size_t adjustments;            // Number of bit rate changes
+} tA2DP_AAC_ABR;
+
+// Initializes the AAC ABR controller |p_abr|. The bit rate is kept within
+// [|min_bit_rate|, |max_bit_rate|] and starts at |max_bit_rate|.
+void a2dp_aac_abr_init(tA2DP_AAC_ABR* p_abr, uint32_t min_bit_rate,
+                       uint32_t max_bit_rate);
+
+// AAC ABR main process.
+// |now_us| is the current time, |queue_delay_us| is how long the oldest
+// packet in the transmit queue has been waiting, and |is_congested| is true
+// if the link reported congestion since the previous call.
+// Returns the bit rate the AAC encoder should use.
+uint32_t a2dp_aac_abr_proc(tA2DP_AAC_ABR* p_abr, uint64_t now_us,
+                           uint64_t queue_delay_us, bool is_congested);
+
+#endif  // A2DP_AAC_ABR_H
@@ -57,4 +57,11 @@ period_ms_t a2dp_aac_get_encoder_interval_ms(void);
 // |timestamp_us| is the current timestamp (in microseconds).
 void a2dp_aac_send_frames(uint64_t timestamp_us);
 
+// Set the transmit queue delay for the A2DP AAC encoder.
+// |queue_delay_us| is how long the oldest queued packet has been waiting,
+// and |is_congested| is true if the link reported congestion. The encoder
+// bit rate is adapted to them.
+void a2dp_aac_set_transmit_queue_delay(uint64_t queue_delay_us,
+                                       bool is_congested);
+
 #endif  // A2DP_AAC_ENCODER_H
@@ -118,6 +118,15 @@ class A2dpCodecConfig {
   // Returns true if |codec_config| is empty, otherwise false.
   static bool isCodecConfigEmpty(const btav_a2dp_codec_config_t& codec_config);
 
+  // Gets the number of codec configurations taken from the configuration
+  // cache instead of being computed again.
+  size_t configCacheHits() const { return config_cache_hits_; }
+
+  // Returns the encoder's algorithmic delay (in microseconds), i.e. how long
+  // the encoder holds the audio before its first output that covers it.
+  // The default is zero.
+  virtual uint64_t encoderLookaheadUs() const;
+
  protected:
   // Sets the current priority of the codec to |codec_priority|.
   // If |codec_priority| is BTAV_A2DP_CODEC_PRIORITY_DEFAULT, the priority is
@@ -256,6 +265,41 @@ class A2dpCodecConfig {
   uint8_t ota_codec_config_[AVDT_CODEC_SIZE];
   uint8_t ota_codec_peer_capability_[AVDT_CODEC_SIZE];
   uint8_t ota_codec_peer_config_[AVDT_CODEC_SIZE];
+
+ private:
+  // A configuration computed by |setCodecConfig|: the peer's codec
+  // information and the internal state it was computed from, and the
+  // internal state and the OTA codec configuration it resulted in.
+  struct ConfigCacheEntry {
+    uint8_t peer_codec_info[AVDT_CODEC_SIZE];
+    bool is_capability;
+    btav_a2dp_codec_config_t codec_config;
+    btav_a2dp_codec_config_t codec_capability;
+    btav_a2dp_codec_config_t codec_selectable_capability;
+    btav_a2dp_codec_config_t codec_user_config;
+    btav_a2dp_codec_config_t codec_audio_config;
+    btav_a2dp_codec_config_t result_codec_config;
+    btav_a2dp_codec_config_t result_codec_capability;
+    btav_a2dp_codec_config_t result_codec_selectable_capability;
+    uint8_t result_codec_info[AVDT_CODEC_SIZE];
+    uint8_t result_ota_codec_config[AVDT_CODEC_SIZE];
+    uint8_t result_ota_codec_peer_info[AVDT_CODEC_SIZE];
+  };
+
+  // Same as |setCodecConfig|, but the configurations already computed
+  // for the same peer's codec information and the same internal state are
+  // taken from the configuration cache.
+  bool setCodecConfigCached(const uint8_t* p_peer_codec_info,
+                            bool is_capability,
+                            uint8_t* p_result_codec_config);
+
+  // Forgets the configurations of the configuration cache.
+  void clearConfigCache();
+
+  // The most recently used configurations first
+  std::list<ConfigCacheEntry> config_cache_;
+  size_t config_cache_hits_;
+  size_t config_cache_misses_;
 };
 
 class A2dpCodecs {
@@ -442,6 +486,19 @@ typedef struct {
   tA2DP_CHANNEL_COUNT channel_count;      // 1 for mono or 2 for stereo
 } tA2DP_FEEDING_PARAMS;
 
+/**
+ * Structure used to pass the link signals of the A2DP peer, as last read
+ * from the controller.
+ */
+typedef struct {
+  bool has_rssi;
+  int8_t rssi;  // In dB from the golden receive power range
+  bool has_link_quality;
+  uint8_t link_quality;  // From 0 to 255, higher is better
+  bool has_failed_contact_counter;
+  uint16_t failed_contact_counter;  // Flush timeouts since the connection
+} tA2DP_LINK_QUALITY;
+
 // Prototype for a callback to read audio data for encoding.
 // |p_buf| is the buffer to store the data. |len| is the number of octets to
 // read.
@@ -488,8 +545,74 @@ typedef struct {
 
   // Set transmit queue length for the A2DP encoder.
   void (*set_transmit_queue_length)(size_t transmit_queue_length);
+
+  // Set transmit queue delay for the A2DP encoder.
+  // |queue_delay_us| is how long (in microseconds) the oldest packet in the
+  // transmit queue has been waiting, and |is_congested| is true if the link
+  // was congested since the previous call.
+  void (*set_transmit_queue_delay)(uint64_t queue_delay_us, bool is_congested);
+
+  // Returns true if the A2DP encoder enqueues each packet as soon as it is
+  // encoded, so that it should be sent right away instead of once per
+  // encoder interval.
+  bool (*is_ultra_low_latency)(void);
+
+  // Set the number of PCM octets that can be read without waiting, before
+  // the next call to |send_frames|. An encoder that implements it plans the
+  // frames of the tick from the PCM actually available, and defers the rest
+  // to the next ticks instead of padding it with silence.
+  void (*set_pcm_available)(size_t pcm_available);
+
+  // Returns the index of the bitrate quality mode the A2DP encoder currently
+  // uses, e.g. as selected by its adaptive bitrate, or -1 if it has none.
+  // Used for the session metrics only.
+  int (*get_quality_index)(void);
+
+  // Set the link signals of the peer for the A2DP encoder, so that its
+  // adaptive bitrate can act before the transmit queue builds up.
+  // The link signals are only sampled for the encoders that implement it.
+  void (*set_link_quality)(const tA2DP_LINK_QUALITY* p_link_quality);
 } tA2DP_ENCODER_INTERFACE;
 
+//
+// A2DP decoder callbacks interface.
+// |assemble_frames| may be called concurrently with |decode_frames|, but not
+// with |decoder_init| and |decoder_cleanup|.
+//
+typedef struct {
+  // Initialize the A2DP decoder for the codec configuration |p_codec_info|.
+  // Returns true on success, otherwise false.
+  bool (*decoder_init)(const uint8_t* p_codec_info);
+
+  // Cleanup the A2DP decoder.
+  void (*decoder_cleanup)(void);
+
+  // Get the number of PCM samples per channel of each decoded audio frame,
+  // or 0 if it is not known.
+  size_t (*get_frame_samples)(void);
+
+  // Takes the media packet |p_data| of |len| octets received from the peer,
+  // after the RTP header, and reassembles the audio frames fragmented over
+  // several packets.
+  // Returns the number of audio frames completed by the packet, which are
+  // stored in |p_frames| and |frames_len|, in the form |decode_frames| takes.
+  // They are valid until the next call. Returns 0 if the packet does not
+  // complete any frame, e.g. if it is malformed, or only carries part of a
+  // fragmented frame.
+  uint16_t (*assemble_frames)(const uint8_t* p_data, uint16_t len,
+                              const uint8_t** p_frames, uint16_t* frames_len);
+
+  // Decode the |num_frames| audio frames |p_frames| of |frames_len| octets
+  // given by |assemble_frames| as interleaved 16-bit PCM into |p_pcm|.
+  // |p_pcm_len| contains the size of |p_pcm| in octets, and is updated with
+  // the number of octets decoded.
+  // Returns the number of frames decoded, which is less than |num_frames| on
+  // error.
+  uint16_t (*decode_frames)(const uint8_t* p_frames, uint16_t frames_len,
+                            uint16_t num_frames, int16_t* p_pcm,
+                            uint32_t* p_pcm_len);
+} tA2DP_DECODER_INTERFACE;
+
 // Gets the A2DP codec type.
 // |p_codec_info| contains information about the codec capabilities.
 tA2DP_CODEC_TYPE A2DP_GetCodecType(const uint8_t* p_codec_info);
@@ -622,6 +745,26 @@ bool A2DP_GetPacketTimestamp(const uint8_t* p_codec_info, const uint8_t* p_data,
 bool A2DP_BuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
                            uint16_t frames_per_packet);
 
+// Checks whether an encoded audio packet ends an encoded frame.
+// Codecs that fragment a frame over several packets mark the fragments in
+// |p_buf|; if a packet is dropped, the following packets up to and
+// including the one that ends the frame must be dropped as well.
+// |p_codec_info| contains the codec information.
+// |p_buf| contains the encoded audio data.
+// Returns true if |p_buf| ends a frame, otherwise false.
+bool A2DP_PacketEndsFrame(const uint8_t* p_codec_info, const BT_HDR* p_buf);
+
+// Merges the encoded audio packet |p_next| into |p_buf|, the packet queued
+// right before it, if the codec can carry both in a single media packet of
+// up to |max_len| octets after the media header. Fragments of a frame are
+// never merged. Both packets must come from the encoder, before their codec
+// header is built.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_next| was merged into |p_buf| and can be freed,
+// otherwise false and both packets are unchanged.
+bool A2DP_MergePackets(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                       const BT_HDR* p_next, uint16_t max_len);
+
 // Gets the A2DP encoder interface that can be used to encode and prepare
 // A2DP packets for transmission - see |tA2DP_ENCODER_INTERFACE|.
 // |p_codec_info| contains the codec information.
@@ -630,6 +773,44 @@ bool A2DP_BuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
 const tA2DP_ENCODER_INTERFACE* A2DP_GetEncoderInterface(
     const uint8_t* p_codec_info);
 
+// Gets the A2DP decoder interface that can be used to decode received A2DP
+// packets - see |tA2DP_DECODER_INTERFACE|.
+// |p_codec_info| contains the codec information.
+// Returns the A2DP decoder interface if the |p_codec_info| is valid and
+// supported, otherwise NULL.
+const tA2DP_DECODER_INTERFACE* A2DP_GetDecoderInterface(
+    const uint8_t* p_codec_info);
+
+// Initializes the pool of buffers shared by all A2DP Source encoders for
+// the outgoing media packets.
+// |peer_mtu| is the MTU of the A2DP peer and is used to size each buffer.
+// |max_queued_packets| is the maximum number of packets held in the transmit
+// queue and is used to size the pool.
+// Any previously initialized pool is released.
+void A2DP_InitEncoderPacketPool(uint16_t peer_mtu, size_t max_queued_packets);
+
+// Grows the buffers of the encoder packet pool, if needed, so that the
+// packets of |offset| octets of headers and up to |max_len| octets of data
+// allocated with |A2DP_AllocEncoderPacket| are taken from the pool.
+// This is used by the encoders that encode in place past the MTU.
+void A2DP_ReserveEncoderPacketSize(uint16_t offset, uint16_t max_len);
+
+// Releases the pool of buffers used for the outgoing media packets.
+// Packets that are still in flight remain valid until they are freed.
+void A2DP_CleanupEncoderPacketPool(void);
+
+// Allocates a buffer for an outgoing A2DP Source media packet that has
+// |offset| octets of room for the headers, followed by up to |max_len| octets
+// of encoded audio data. The buffer is taken from the encoder packet pool
+// if it fits, otherwise it is allocated from the heap. The |offset|, |len|
+// and |layer_specific| fields of the returned buffer are initialized.
+// The buffer must be freed with |osi_free|.
+BT_HDR* A2DP_AllocEncoderPacket(uint16_t offset, uint16_t max_len);
+
+// Dumps the encoder packet pool statistics.
+// The information is written in user-friendly form to file descriptor |fd|.
+void A2DP_EncoderPacketPoolDebugDump(int fd);
+
 // Adjusts the A2DP codec, based on local support and Bluetooth specification.
 // |p_codec_info| contains the codec information to adjust.
 // Returns true if |p_codec_info| is valid and supported, otherwise false.
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP Sink jitter buffer
+//
+// The jitter buffer decides the playout of the media frames queued by the
+// A2DP Sink. It estimates the arrival jitter of the media packets from their
+// RTP timestamps, and derives a target playout delay from it. Playback
+// starts once the target delay is queued, and the queue is kept around the
+// target by dropping or repeating a single frame at a time, instead of
+// flushing the whole queue when the packets arrive in bursts.
+//
+
+#ifndef A2DP_JITTER_BUFFER_H
+#define A2DP_JITTER_BUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The bounds of the target playout delay.
+#define A2DP_JITTER_MIN_DELAY_US (40 * 1000)
+#define A2DP_JITTER_MAX_DELAY_US (400 * 1000)
+// The minimum number of ticks between two playout adjustments.
+#define A2DP_JITTER_ADJUST_INTERVAL_TICKS 5
+
+typedef enum {
+  A2DP_JITTER_ACTION_NONE,
+  A2DP_JITTER_ACTION_DROP,   // Discard the first frame decoded on this tick
+  A2DP_JITTER_ACTION_REPEAT  // Play the first frame decoded on this tick twice
+} tA2DP_JITTER_ACTION;
+
+typedef struct {
+  uint32_t sample_rate;        // RTP timestamp clock in Hz
+  uint32_t samples_per_frame;  // Samples per media frame
+  uint32_t frames_per_tick;    // Nominal frames played per tick
+  uint32_t queued_frames;      // Frames queued and not played yet
+  bool is_playing;             // False while (re)buffering to the target
+
+  bool has_reference;          // True if the fields below are valid
+  uint32_t last_timestamp;     // RTP timestamp of the previous packet
+  uint64_t last_arrival_us;    // Arrival time of the previous packet
+  uint64_t jitter_us;          // Interarrival jitter (RFC 3550, 6.4.1)
+  uint64_t peak_us;            // Decaying peak of the transit variation
+  uint64_t target_us;          // The target playout delay
+
+  uint32_t ticks_since_adjustment;
+  uint32_t dropped_frames;     // Frames dropped to reduce the delay
+  uint32_t repeated_frames;    // Frames repeated to increase the delay
+  uint32_t overflow_frames;    // Frames discarded on queue overflow
+  uint32_t underruns;          // Times the queue ran empty while playing
+} tA2DP_JITTER_BUFFER;
+
+// Initializes the jitter buffer |p_jb| for media frames of
+// |samples_per_frame| samples at |sample_rate|, played |frames_per_tick|
+// frames per decoder tick.
+void a2dp_jitter_buffer_init(tA2DP_JITTER_BUFFER* p_jb, uint32_t sample_rate,
+                             uint32_t samples_per_frame,
+                             uint32_t frames_per_tick);
+
+// Resets |p_jb| after the queue was flushed. The jitter estimate is kept,
+// and playback will start again once the target delay is queued.
+void a2dp_jitter_buffer_flush(tA2DP_JITTER_BUFFER* p_jb);
+
+// Accounts a media packet of |num_frames| frames with RTP timestamp
+// |timestamp| that arrived at |now_us|, and updates the target delay.
+void a2dp_jitter_buffer_on_packet(tA2DP_JITTER_BUFFER* p_jb, uint64_t now_us,
+                                  uint32_t timestamp, uint32_t num_frames);
+
+// Returns true if the queue holds so much more than the target delay that
+// its oldest packet should be discarded.
+bool a2dp_jitter_buffer_is_overflow(const tA2DP_JITTER_BUFFER* p_jb);
+
+// Accounts |num_frames| frames discarded from the queue on overflow.
+void a2dp_jitter_buffer_on_overflow(tA2DP_JITTER_BUFFER* p_jb,
+                                    uint32_t num_frames);
+
+// Decides the playout of the next decoder tick, and accounts the frames as
+// played. The playout adjustment, if any, is stored in |p_action|.
+// Returns the number of frames to decode, or 0 while buffering.
+uint32_t a2dp_jitter_buffer_tick(tA2DP_JITTER_BUFFER* p_jb,
+                                 tA2DP_JITTER_ACTION* p_action);
+
+// Returns the playout delay currently queued in |p_jb|.
+uint64_t a2dp_jitter_buffer_get_queued_us(const tA2DP_JITTER_BUFFER* p_jb);
+
+#endif  // A2DP_JITTER_BUFFER_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP encoder pacing
+//
+// The pacing keeps track of how much PCM audio the encoder should have
+// consumed, from the time elapsed between the encoder ticks. The PCM is
+// accounted exactly, so the number of frames sent over time does not
+// drift from the audio clock because of rounding. A late tick is caught up
+// over the following ticks instead of in a single burst.
+//
+
+#ifndef A2DP_PACING_H
+#define A2DP_PACING_H
+
+#include <stdint.h>
+
+// The maximum number of encoder intervals credited on a single tick.
+#define A2DP_PACING_MAX_INTERVALS_PER_TICK 2
+// The maximum elapsed time that is still to be credited. Anything beyond
+// is dropped, e.g. after the media task was stalled.
+#define A2DP_PACING_MAX_BACKLOG_US (200 * 1000)
+
+typedef struct {
+  uint64_t bytes_per_second;  // PCM octets fed per second
+  uint32_t interval_us;       // The encoder interval
+  uint64_t last_tick_us;      // Time of the previous tick, or 0
+  uint64_t backlog_us;        // Elapsed time not credited yet
+  uint64_t counter;           // Credited PCM in octets times 1000000
+  uint64_t dropped_us;        // Total elapsed time dropped
+} tA2DP_PACING;
+
+// Initializes the pacing |p_pacing| for PCM fed at |bytes_per_second|
+// octets per second to an encoder running every |interval_us|.
+void a2dp_pacing_init(tA2DP_PACING* p_pacing, uint32_t bytes_per_second,
+                      uint32_t interval_us);
+
+// Discards the PCM credited to |p_pacing| and not consumed yet.
+void a2dp_pacing_flush(tA2DP_PACING* p_pacing);
+
+// Returns the nominal number of PCM octets per encoder tick.
+uint32_t a2dp_pacing_get_bytes_per_tick(const tA2DP_PACING* p_pacing);
+
+// Credits the time elapsed since the previous tick to |p_pacing|.
+// |timestamp_us| is the time of the current tick.
+// Returns the number of frames of |pcm_bytes_per_frame| octets available.
+uint32_t a2dp_pacing_update(tA2DP_PACING* p_pacing, uint64_t timestamp_us,
+                            uint32_t pcm_bytes_per_frame);
+
+// Consumes |num_frames| frames of |pcm_bytes_per_frame| octets.
+void a2dp_pacing_consume(tA2DP_PACING* p_pacing, uint32_t num_frames,
+                         uint32_t pcm_bytes_per_frame);
+
+// Returns |num_bytes| octets of PCM that could not be encoded, e.g. on
+// underflow, so they are accounted again on the next tick.
+void a2dp_pacing_credit(tA2DP_PACING* p_pacing, uint32_t num_bytes);
+
+// Discards the PCM credited to |p_pacing| beyond |max_intervals| encoder
+// intervals, e.g. the PCM deferred while it was not available to the
+// encoder yet, so that it is not sent in a burst later. The discarded time
+// is accounted in |dropped_us|.
+void a2dp_pacing_limit(tA2DP_PACING* p_pacing, uint32_t max_intervals);
+
+#endif  // A2DP_PACING_H
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP Source PCM fan-out
+//
+// The fan-out lets several encoders consume the same PCM stream, e.g. when
+// streaming to two sinks with different codecs. The PCM is read only once
+// from the source, and kept in a ring buffer until every reader consumed
+// it. Each reader reads at its own pace: a reader that needs PCM no other
+// reader read yet pulls it from the source, and a reader that falls more
+// than the ring buffer behind skips the PCM it missed.
+//
+// The fan-out is not thread-safe: the calls must be serialized.
+//
+
+#ifndef A2DP_PCM_FANOUT_H
+#define A2DP_PCM_FANOUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "a2dp_codec_api.h"
+
+// The maximum number of readers.
+#define A2DP_PCM_FANOUT_MAX_READERS 4
+
+typedef struct {
+  a2dp_source_read_callback_t read_callback;  // Reads the source PCM
+  uint8_t num_readers;
+  uint32_t frame_size;  // Octets per PCM frame, for all the channels
+  uint8_t* buf;         // The ring buffer
+  uint32_t size;        // Octets in |buf|, a multiple of |frame_size|
+  uint64_t write_pos;   // Octets read from the source
+  uint64_t read_pos[A2DP_PCM_FANOUT_MAX_READERS];  // Octets consumed
+  uint64_t skipped_bytes[A2DP_PCM_FANOUT_MAX_READERS];  // Octets missed
+} tA2DP_PCM_FANOUT;
+
+// Initializes the fan-out |p_fanout| for |num_readers| readers of the PCM
+// from |read_callback|, buffering up to |size| octets of PCM frames of
+// |frame_size| octets. Returns true on success, otherwise false. On success,
+// |a2dp_pcm_fanout_cleanup| must be called to release the buffer.
+bool a2dp_pcm_fanout_init(tA2DP_PCM_FANOUT* p_fanout,
+                          a2dp_source_read_callback_t read_callback,
+                          uint8_t num_readers, uint32_t frame_size,
+                          uint32_t size);
+
+// Releases the buffer of |p_fanout|. Calling it on a fan-out that was zeroed
+// or already cleaned up is a no-op.
+void a2dp_pcm_fanout_cleanup(tA2DP_PCM_FANOUT* p_fanout);
+
+// Discards the buffered PCM of |p_fanout|, e.g. when the audio stream is
+// flushed.
+void a2dp_pcm_fanout_flush(tA2DP_PCM_FANOUT* p_fanout);
+
+// Reads up to |len| octets of PCM for |reader| into |p_buf|. The buffered
+// PCM is returned first, and the rest is read from the source.
+// Returns the number of octets read, which is less than |len| if the source
+// ran short. Each reader is typically wrapped in its own
+// |a2dp_source_read_callback_t| for its encoder.
+uint32_t a2dp_pcm_fanout_read(tA2DP_PCM_FANOUT* p_fanout, uint8_t reader,
+                              uint8_t* p_buf, uint32_t len);
+
+#endif  // A2DP_PCM_FANOUT_H
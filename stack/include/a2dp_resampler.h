@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP PCM resampler
+//
+// The resampler converts interleaved 16-bit PCM between two sample rates
+// (e.g. 44.1 kHz, 48 kHz and 96 kHz) with a polyphase windowed-sinc filter.
+// The rate ratio is reduced to L/M, and one filter phase is precomputed for
+// each of the L output positions between two input samples, so that each
+// output sample is a single dot product over the input history.
+//
+
+#ifndef A2DP_RESAMPLER_H
+#define A2DP_RESAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "a2dp_codec_api.h"
+
+// The maximum number of interleaved channels.
+#define A2DP_RESAMPLER_MAX_CHANNELS 2
+// The maximum number of filter taps per phase, a multiple of 8.
+#define A2DP_RESAMPLER_MAX_TAPS 64
+// The maximum number of filter phases (441 for 16 kHz -> 44.1 kHz).
+#define A2DP_RESAMPLER_MAX_PHASES 512
+// The number of source frames read at once by |a2dp_resampler_read|.
+#define A2DP_RESAMPLER_READ_FRAMES 256
+
+typedef struct {
+  uint32_t src_rate;       // Source sample rate in Hz
+  uint32_t dst_rate;       // Destination sample rate in Hz
+  uint32_t up;             // L: the number of filter phases
+  uint32_t down;           // M: the phase step per output sample
+  uint32_t phase;          // Position of the next output, in 1/L samples
+  uint8_t channel_count;   // Interleaved channels
+  uint16_t taps;           // Filter taps per phase
+  int16_t* coefs;          // |up| phases of |taps| Q14 coefficients
+  // Per channel history, mirrored so that the last |taps| input samples are
+  // always contiguous at |history_pos|.
+  uint16_t history_pos;
+  int16_t history[A2DP_RESAMPLER_MAX_CHANNELS][2 * A2DP_RESAMPLER_MAX_TAPS];
+  // Trailing octets of an incomplete source frame from the last read.
+  uint8_t partial_len;
+  uint8_t partial[A2DP_RESAMPLER_MAX_CHANNELS * sizeof(int16_t)];
+} tA2DP_RESAMPLER;
+
+// Initializes the resampler |p_resampler| to convert |channel_count|
+// interleaved channels of 16-bit PCM from |src_rate| to |dst_rate|.
+// Returns true on success, otherwise false if the conversion is not
+// supported. On success, |a2dp_resampler_cleanup| must be called to release
+// the filter.
+bool a2dp_resampler_init(tA2DP_RESAMPLER* p_resampler, uint32_t src_rate,
+                         uint32_t dst_rate, uint8_t channel_count);
+
+// Releases the filter of |p_resampler|. Calling it on a resampler that was
+// zeroed or already cleaned up is a no-op.
+void a2dp_resampler_cleanup(tA2DP_RESAMPLER* p_resampler);
+
+// Discards the input history of |p_resampler|, e.g. when the audio stream
+// is flushed.
+void a2dp_resampler_reset(tA2DP_RESAMPLER* p_resampler);
+
+// Converts up to |src_frames| frames from |p_src| into up to |dst_frames|
+// frames in |p_dst|. The number of source frames consumed is stored in
+// |p_src_used|. Returns the number of frames written to |p_dst|.
+uint32_t a2dp_resampler_process(tA2DP_RESAMPLER* p_resampler,
+                                const int16_t* p_src, uint32_t src_frames,
+                                uint32_t* p_src_used, int16_t* p_dst,
+                                uint32_t dst_frames);
+
+// Fills |p_buf| with |len| octets of resampled PCM, reading only as much
+// source PCM from |read_callback| as the output requires.
+// Returns the number of octets written, which is less than |len| if the
+// source ran short.
+uint32_t a2dp_resampler_read(tA2DP_RESAMPLER* p_resampler,
+                             a2dp_source_read_callback_t read_callback,
+                             uint8_t* p_buf, uint32_t len);
+
+#endif  // A2DP_RESAMPLER_H
@@ -0,0 +1,55 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2016 The Android Open Source Project
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//
+// Interface to the A2DP SBC Decoder
+//
+
+#ifndef A2DP_SBC_DECODER_H
+#define A2DP_SBC_DECODER_H
+
+#include "a2dp_codec_api.h"
+
+// Initialize the A2DP SBC decoder for the codec configuration
+// |p_codec_info|.
+// Returns true on success, otherwise false.
+bool a2dp_sbc_decoder_init(const uint8_t* p_codec_info);
+
+// Cleanup the A2DP SBC decoder.
+void a2dp_sbc_decoder_cleanup(void);
+
+// Get the number of PCM samples per channel of each SBC frame.
+size_t a2dp_sbc_get_frame_samples(void);
+
+// Get the SBC frames of the media packet |p_data| of |len| octets.
+// SBC frames are never fragmented: the frames are the packet itself, after
+// the SBC media payload header.
+// Returns the number of frames of the packet.
+uint16_t a2dp_sbc_assemble_frames(const uint8_t* p_data, uint16_t len,
+                                  const uint8_t** p_frames,
+                                  uint16_t* frames_len);
+
+// Decode the |num_frames| SBC frames |p_frames| of |frames_len| octets into
+// |p_pcm| of |*p_pcm_len| octets.
+// Returns the number of frames decoded.
+uint16_t a2dp_sbc_decode_frames(const uint8_t* p_frames, uint16_t frames_len,
+                                uint16_t num_frames, int16_t* p_pcm,
+                                uint32_t* p_pcm_len);
+
+#endif  // A2DP_SBC_DECODER_H
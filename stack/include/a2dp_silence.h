@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP encoder silence detection
+//
+// The silence detector tells when the PCM read by an encoder has been
+// digital silence (all samples zero) for a while, e.g. when an app pauses
+// without the stream being suspended. The encoder may then lower its bit
+// rate until the audio comes back. The silence ends on the first block of
+// PCM that is not silent.
+//
+
+#ifndef A2DP_SILENCE_H
+#define A2DP_SILENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint64_t threshold_bytes;  // Silent PCM octets before the silence starts
+  uint64_t silent_bytes;     // Silent PCM octets read in a row
+  bool is_silent;            // True once |threshold_bytes| were silent
+  size_t silences;           // Number of silences detected
+} tA2DP_SILENCE;
+
+// Initializes the silence detector |p_silence| for PCM fed at
+// |bytes_per_second| octets per second. The silence starts after
+// |threshold_ms| of silent PCM.
+void a2dp_silence_init(tA2DP_SILENCE* p_silence, uint32_t bytes_per_second,
+                       uint32_t threshold_ms);
+
+// Accounts the |len| octets of PCM |p_pcm| read by the encoder.
+// Returns true if the PCM is part of a silence.
+bool a2dp_silence_proc(tA2DP_SILENCE* p_silence, const uint8_t* p_pcm,
+                       size_t len);
+
+// Checks whether the |len| octets of PCM |p_pcm| are all zero.
+bool a2dp_silence_is_pcm_silent(const uint8_t* p_pcm, size_t len);
+
+#endif  // A2DP_SILENCE_H
@@ -171,6 +171,22 @@ bool A2DP_VendorGetPacketTimestamp(const uint8_t* p_codec_info,
 bool A2DP_VendorBuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
                                  uint16_t frames_per_packet);
 
+// Checks whether an encoded vendor-specific audio packet ends an encoded
+// frame.
+// |p_codec_info| contains the codec information.
+// |p_buf| contains the encoded audio data.
+// Returns true if |p_buf| ends a frame, otherwise false.
+bool A2DP_VendorPacketEndsFrame(const uint8_t* p_codec_info,
+                                const BT_HDR* p_buf);
+
+// Merges the encoded vendor-specific audio packet |p_next| into |p_buf|, if
+// the codec can carry both in a single media packet of up to |max_len|
+// octets - see |A2DP_MergePackets|.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_next| was merged into |p_buf|, otherwise false.
+bool A2DP_VendorMergePackets(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                             const BT_HDR* p_next, uint16_t max_len);
+
 // Gets the A2DP vendor encoder interface that can be used to encode and
 // prepare A2DP packets for transmission - see |tA2DP_ENCODER_INTERFACE|.
 // |p_codec_info| contains the codec information.
@@ -179,6 +195,14 @@ bool A2DP_VendorBuildCodecHeader(const uint8_t* p_codec_info, BT_HDR* p_buf,
 const tA2DP_ENCODER_INTERFACE* A2DP_VendorGetEncoderInterface(
     const uint8_t* p_codec_info);
 
+// Gets the A2DP vendor decoder interface that can be used to decode received
+// A2DP packets - see |tA2DP_DECODER_INTERFACE|.
+// |p_codec_info| contains the codec information.
+// Returns the A2DP vendor decoder interface if the |p_codec_info| is valid and
+// supported, otherwise NULL.
+const tA2DP_DECODER_INTERFACE* A2DP_VendorGetDecoderInterface(
+    const uint8_t* p_codec_info);
+
 // Adjusts the A2DP vendor-specific codec, based on local support and Bluetooth
 // specification.
 // |p_codec_info| contains the codec information to adjust.
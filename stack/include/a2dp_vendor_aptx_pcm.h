@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// PCM deinterleaving for the aptX and aptX-HD encoders
+//
+// The aptX encoder libraries take the left and right channels of each group
+// of 4 stereo frames as separate arrays of 32-bit samples. These functions
+// split the PCM of a whole encoder tick at once, so that the encoders only
+// pass pointers into the split channels to the libraries.
+//
+
+#ifndef A2DP_VENDOR_APTX_PCM_H
+#define A2DP_VENDOR_APTX_PCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Splits |frames| stereo frames of interleaved 16-bit PCM from |p_pcm| into
+// |p_left| and |p_right|. The samples are zero-extended to 32 bits, as the
+// aptX encoder expects.
+void a2dp_aptx_deinterleave_16(const uint16_t* p_pcm, size_t frames,
+                               uint32_t* p_left, uint32_t* p_right);
+
+// Splits |frames| stereo frames of interleaved packed 24-bit PCM
+// (AUDIO_FORMAT_PCM_24_BIT_PACKED) from |p_pcm| into |p_left| and |p_right|.
+// The samples are sign-extended to 32 bits (AUDIO_FORMAT_PCM_8_24_BIT), as
+// the aptX-HD encoder expects.
+void a2dp_aptx_deinterleave_24(const uint8_t* p_pcm, size_t frames,
+                               uint32_t* p_left, uint32_t* p_right);
+
+#endif  // A2DP_VENDOR_APTX_PCM_H
@@ -32,6 +32,7 @@ class A2dpCodecConfigLhdc : public A2dpCodecConfig {
 
   bool init() override;
   period_ms_t encoderIntervalMs() const override;
+  uint64_t encoderLookaheadUs() const override;
   bool setCodecConfig(const uint8_t* p_peer_codec_info, bool is_capability,
                       uint8_t* p_result_codec_config) override;
 
@@ -58,6 +59,19 @@ bool A2DP_IsVendorSourceCodecValidLhdc(const uint8_t* p_codec_info);
 // codec, otherwise false.
 bool A2DP_IsVendorPeerSinkCodecValidLhdc(const uint8_t* p_codec_info);
 
+// Checks whether the codec capabilities contain a valid A2DP LHDC Sink
+// codec.
+// NOTE: only codecs that are implemented are considered valid.
+// Returns true if |p_codec_info| contains information about a valid LHDC
+// codec, otherwise false.
+bool A2DP_IsVendorSinkCodecValidLhdc(const uint8_t* p_codec_info);
+
+// Checks whether A2DP LHDC Sink codec is supported.
+// |p_codec_info| contains information about the codec capabilities.
+// Returns true if the A2DP LHDC Sink codec is supported, and the LHDC
+// decoder library can be loaded, otherwise false.
+bool A2DP_IsVendorSinkCodecSupportedLhdc(const uint8_t* p_codec_info);
+
 // Checks whether the A2DP data packets should contain RTP header.
 // |content_protection_enabled| is true if Content Protection is
 // enabled. |p_codec_info| contains information about the codec capabilities.
@@ -107,6 +121,21 @@ int A2DP_VendorGetTrackChannelCountLhdc(const uint8_t* p_codec_info);
 // contains invalid codec information.
 int A2DP_VendorGetChannelModeCodeLhdc(const uint8_t* p_codec_info);
 
+// Gets the channel type for the A2DP LHDC Sink codec:
+// 3 for stereo.
+// |p_codec_info| is a pointer to the LHDC codec_info to decode.
+// Returns the channel type on success, or -1 if |p_codec_info|
+// contains invalid codec information.
+int A2DP_VendorGetSinkTrackChannelTypeLhdc(const uint8_t* p_codec_info);
+
+// Computes the number of frames to process in a time window for the A2DP
+// LHDC Sink codec. |time_interval_ms| is the time interval (in milliseconds).
+// |p_codec_info| is a pointer to the codec_info to decode.
+// Returns the number of frames to process on success, or -1 if |p_codec_info|
+// contains invalid codec information.
+int A2DP_VendorGetSinkFramesCountToProcessLhdc(uint64_t time_interval_ms,
+                                               const uint8_t* p_codec_info);
+
 // Gets the A2DP LHDC audio data timestamp from an audio packet.
 // |p_codec_info| contains the codec information.
 // |p_data| contains the audio data.
@@ -124,6 +153,25 @@ bool A2DP_VendorGetPacketTimestampLhdc(const uint8_t* p_codec_info,
 bool A2DP_VendorBuildCodecHeaderLhdc(const uint8_t* p_codec_info, BT_HDR* p_buf,
                                      uint16_t frames_per_packet);
 
+// Checks whether an encoded A2DP LHDC audio packet ends an encoded frame,
+// based on the fragment markers in |p_buf->layer_specific|.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_buf| ends a frame, otherwise false.
+bool A2DP_VendorPacketEndsFrameLhdc(const uint8_t* p_codec_info,
+                                    const BT_HDR* p_buf);
+
+// Merges the encoded A2DP LHDC audio packet |p_next| into |p_buf|, if both
+// carry whole frames with the same latency mode, and the frames and the
+// payload fit in a single media packet of up to |max_len| octets.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_next| was merged into |p_buf|, otherwise false.
+bool A2DP_VendorMergePacketsLhdc(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                                 const BT_HDR* p_next, uint16_t max_len);
+
+// Resets the count of the A2DP LHDC packets merged so far, when the encoder
+// restarts its packet sequence numbers.
+void A2DP_VendorResetMergedPacketsLhdc(void);
+
 
 // New feature to check codec info is supported Channel Separation.
 bool A2DP_VendorGetChannelSeparation(const uint8_t* p_codec_info);
@@ -140,6 +188,14 @@ void A2DP_VendorDumpCodecInfoLhdc(const uint8_t* p_codec_info);
 const tA2DP_ENCODER_INTERFACE* A2DP_VendorGetEncoderInterfaceLhdc(
     const uint8_t* p_codec_info);
 
+// Gets the A2DP LHDC decoder interface that can be used to decode received
+// A2DP packets - see |tA2DP_DECODER_INTERFACE|.
+// |p_codec_info| contains the codec information.
+// Returns the A2DP LHDC decoder interface if the |p_codec_info| is valid and
+// supported, otherwise NULL.
+const tA2DP_DECODER_INTERFACE* A2DP_VendorGetDecoderInterfaceLhdc(
+    const uint8_t* p_codec_info);
+
 // Adjusts the A2DP LHDC codec, based on local support and Bluetooth
 // specification.
 // |p_codec_info| contains the codec information to adjust.
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP LHDC ABR
+//
+// The LHDC ABR (Adaptive Bit Rate) controller picks the LHDC quality mode
+// from the time the encoded packets spend in the transmit queue and the
+// congestion of the link. The quality mode is stepped down as soon as the
+// queue delay builds up, and is stepped back up only after the link has
+// stayed clear for a while.
+//
+// The link signals sampled from the controller can also cap the quality
+// mode, so that it is stepped down before the queue builds up on a fading
+// link.
+//
+
+#ifndef A2DP_VENDOR_LHDC_ABR_H
+#define A2DP_VENDOR_LHDC_ABR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Queue delay above which the quality mode drops to the lowest one.
+#define A2DP_LHDC_ABR_DELAY_CRITICAL_US (200 * 1000)
+// Queue delay above which the quality mode is stepped down.
+#define A2DP_LHDC_ABR_DELAY_HIGH_US (80 * 1000)
+// Queue delay below which the link is considered clear.
+#define A2DP_LHDC_ABR_DELAY_LOW_US (30 * 1000)
+// Minimum time between two consecutive step downs.
+#define A2DP_LHDC_ABR_STEP_DOWN_INTERVAL_US (200 * 1000)
+// Time the link must stay clear before the quality mode is stepped up.
+#define A2DP_LHDC_ABR_STEP_UP_INTERVAL_US (5000 * 1000)
+
+// The link signals at or below which the quality mode is capped one step
+// below the highest one (FAIR), or at the lowest one (POOR). The RSSI is in
+// dB from the golden receive power range of the controller, and the link
+// quality in the [0, 255] range of the HCI Get Link Quality command.
+#define A2DP_LHDC_ABR_RSSI_FAIR (-5)
+#define A2DP_LHDC_ABR_RSSI_POOR (-10)
+#define A2DP_LHDC_ABR_LINK_QUALITY_FAIR 230
+#define A2DP_LHDC_ABR_LINK_QUALITY_POOR 200
+// The failed contacts since the previous link sample at or above which the
+// quality mode is capped.
+#define A2DP_LHDC_ABR_FAILED_CONTACTS_FAIR 1
+#define A2DP_LHDC_ABR_FAILED_CONTACTS_POOR 4
+
+typedef struct {
+  int min_quality_mode_index;
+  int max_quality_mode_index;
+  int quality_mode_index;        // The current quality mode index
+  uint64_t last_adjustment_us;   // Time of the last quality mode change
+  uint64_t clear_since_us;       // Start of the current clear period, or 0
+  uint64_t last_queue_delay_us;  // The last reported transmit queue delay
+  size_t adjustments;            // Number of quality mode changes
+  // The highest quality mode index the link signals allow
+  int link_max_quality_mode_index;
+  size_t link_step_downs;  // Number of quality mode changes forced by the link
+  int8_t last_rssi;             // The last link signals
+  uint8_t last_link_quality;
+  uint32_t last_failed_contacts;
+} tA2DP_LHDC_ABR;
+
+// Initializes the LHDC ABR controller |p_abr|. The quality mode index is
+// kept within [|min_quality_mode_index|, |max_quality_mode_index|] and
+// starts at |quality_mode_index|.
+void a2dp_lhdc_abr_init(tA2DP_LHDC_ABR* p_abr, int min_quality_mode_index,
+                        int max_quality_mode_index, int quality_mode_index);
+
+// LHDC ABR main process.
+// |now_us| is the current time, |queue_delay_us| is how long the oldest
+// packet in the transmit queue has been waiting, and |is_congested| is true
+// if the link reported congestion since the previous call.
+// Returns the quality mode index the LHDC encoder should use.
+int a2dp_lhdc_abr_proc(tA2DP_LHDC_ABR* p_abr, uint64_t now_us,
+                       uint64_t queue_delay_us, bool is_congested);
+
+// LHDC ABR link process.
+// |now_us| is the current time, |rssi| and |link_quality| are the last
+// values read from the controller, and |failed_contacts| is the number of
+// failed contacts since the previous call. A signal that is not known is
+// passed as 0, 255 and 0 respectively.
+// Returns the quality mode index the LHDC encoder should use.
+int a2dp_lhdc_abr_link_proc(tA2DP_LHDC_ABR* p_abr, uint64_t now_us,
+                            int8_t rssi, uint8_t link_quality,
+                            uint32_t failed_contacts);
+
+#endif  // A2DP_VENDOR_LHDC_ABR_H
@@ -26,6 +26,7 @@
 // LHDC Quality Mode Index
 //LHDC not supported auto bit rate now.
 #define A2DP_LDHC_QUALITY_MAGIC_NUM 0x8000
+#define A2DP_LHDC_QUALITY_AUTO 4  // ABR mode that also follows the link signals
 #define A2DP_LHDC_QUALITY_ABR 3   // ABR mode, range: 990,660,492,396,330(kbps)
 #define A2DP_LHDC_QUALITY_HIGH 2  // Equal to LHDCBT_EQMID_HQ 900kbps
 #define A2DP_LHDC_QUALITY_MID 1   // Equal to LHDCBT_EQMID_SQ 500/560kbps
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP LHDC Decoder
+//
+
+#ifndef A2DP_VENDOR_LHDC_DECODER_H
+#define A2DP_VENDOR_LHDC_DECODER_H
+
+#include "a2dp_codec_api.h"
+
+// Loads the A2DP LHDC decoder.
+// Return true on success, otherwise false.
+bool A2DP_VendorLoadDecoderLhdc(void);
+
+// Unloads the A2DP LHDC decoder.
+void A2DP_VendorUnloadDecoderLhdc(void);
+
+// Initialize the A2DP LHDC decoder for the codec configuration
+// |p_codec_info|.
+// Returns true on success, otherwise false.
+bool a2dp_vendor_lhdc_decoder_init(const uint8_t* p_codec_info);
+
+// Cleanup the A2DP LHDC decoder.
+void a2dp_vendor_lhdc_decoder_cleanup(void);
+
+// Get the number of PCM samples per channel of each LHDC frame.
+size_t a2dp_vendor_lhdc_get_frame_samples(void);
+
+// Reassemble the LHDC frames of the media packet |p_data| of |len| octets.
+// The frames of a media frame too large for a packet are fragmented over
+// several packets: they are only returned with the last fragment, once all
+// the fragments were received in sequence.
+// Returns the number of frames completed by the packet.
+uint16_t a2dp_vendor_lhdc_assemble_frames(const uint8_t* p_data, uint16_t len,
+                                          const uint8_t** p_frames,
+                                          uint16_t* frames_len);
+
+// Decode the |num_frames| LHDC frames |p_frames| of |frames_len| octets into
+// |p_pcm| of |*p_pcm_len| octets, as 16-bit PCM.
+// Returns the number of frames decoded.
+uint16_t a2dp_vendor_lhdc_decode_frames(const uint8_t* p_frames,
+                                        uint16_t frames_len,
+                                        uint16_t num_frames, int16_t* p_pcm,
+                                        uint32_t* p_pcm_len);
+
+#endif  // A2DP_VENDOR_LHDC_DECODER_H
@@ -58,7 +58,26 @@ period_ms_t a2dp_vendor_lhdc_get_encoder_interval_ms(void);
 // |timestamp_us| is the current timestamp (in microseconds).
 void a2dp_vendor_lhdc_send_frames(uint64_t timestamp_us);
 
+// Set the number of PCM octets |pcm_available| that can be read without
+// blocking on the next tick, so that only the frames already fed are sent.
+void a2dp_vendor_lhdc_set_pcm_available(size_t pcm_available);
+
+// Get the bitrate quality mode currently used by the encoder, one of the
+// A2DP_LHDC_QUALITY_* values other than ABR, or -1 if not initialized.
+int a2dp_vendor_lhdc_get_quality_index(void);
+
 // Set transmit queue length for the A2DP LDAC ABR(Adaptive Bit Rate) mechanism.
 void a2dp_vendor_lhdc_set_transmit_queue_length(size_t transmit_queue_length);
 
+// Set transmit queue delay for the A2DP LHDC ABR(Adaptive Bit Rate) mechanism.
+// |queue_delay_us| is how long the oldest packet in the transmit queue has
+// been waiting, and |is_congested| is true if the link was congested since
+// the previous call.
+void a2dp_vendor_lhdc_set_transmit_queue_delay(uint64_t queue_delay_us,
+                                              bool is_congested);
+
+// Set the link signals of the peer for the A2DP LHDC auto quality mode.
+void a2dp_vendor_lhdc_set_link_quality(
+    const tA2DP_LINK_QUALITY* p_link_quality);
+
 #endif  // A2DP_VENDOR_LDAC_ENCODER_H
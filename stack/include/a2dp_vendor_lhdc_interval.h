@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Interface to the A2DP LHDC encoder interval selection
+//
+// A short encoder interval wakes the media task more often and sends
+// smaller packets, a long one adds latency and makes the airtime bursty.
+// The interval of a session is the time the encoder takes to fill a given
+// number of packets of the peer MTU at the bit rate of the quality mode,
+// kept within a range around the nominal interval of the codec that depends
+// on the latency mode.
+//
+
+#ifndef A2DP_VENDOR_LHDC_INTERVAL_H
+#define A2DP_VENDOR_LHDC_INTERVAL_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t min_interval_ms;      // The shortest interval
+  uint32_t nominal_interval_ms;  // The interval if nothing else is known
+  uint32_t max_interval_ms;      // The longest interval
+  uint32_t packets_per_tick;     // The packets to fill on each tick
+} tA2DP_LHDC_INTERVAL_RANGE;
+
+// Returns the nominal bit rate in kbps of the LHDC quality mode
+// |quality_mode_index|, or 0 if it is not a fixed bit rate quality mode.
+uint32_t a2dp_lhdc_get_quality_bit_rate_kbps(int quality_mode_index);
+
+// Returns the encoder interval in milliseconds for the packets of
+// |max_payload_len| octets of encoded audio, at the quality mode
+// |quality_mode_index| and in the latency mode |latency_mode_index|.
+// The low latency mode caps the interval at the nominal one, and the high
+// latency mode never goes below it.
+uint32_t a2dp_lhdc_select_encoder_interval_ms(
+    const tA2DP_LHDC_INTERVAL_RANGE* p_range, uint32_t max_payload_len,
+    int quality_mode_index, int latency_mode_index);
+
+#endif  // A2DP_VENDOR_LHDC_INTERVAL_H
@@ -32,6 +32,7 @@ class A2dpCodecConfigLhdcLL : public A2dpCodecConfig {
 
   bool init() override;
   period_ms_t encoderIntervalMs() const override;
+  uint64_t encoderLookaheadUs() const override;
   bool setCodecConfig(const uint8_t* p_peer_codec_info, bool is_capability,
                       uint8_t* p_result_codec_config) override;
 
@@ -124,6 +125,20 @@ bool A2DP_VendorGetPacketTimestampLhdcLL(const uint8_t* p_codec_info,
 bool A2DP_VendorBuildCodecHeaderLhdcLL(const uint8_t* p_codec_info, BT_HDR* p_buf,
                                      uint16_t frames_per_packet);
 
+// Checks whether an encoded A2DP LHDC audio packet ends an encoded frame,
+// based on the fragment markers in |p_buf->layer_specific|.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_buf| ends a frame, otherwise false.
+bool A2DP_VendorPacketEndsFrameLhdcLL(const uint8_t* p_codec_info,
+                                      const BT_HDR* p_buf);
+
+// Merges the encoded A2DP LHDC LL audio packet |p_next| into |p_buf| - see
+// |A2DP_VendorMergePacketsLhdc|.
+// |p_codec_info| contains the codec information.
+// Returns true if |p_next| was merged into |p_buf|, otherwise false.
+bool A2DP_VendorMergePacketsLhdcLL(const uint8_t* p_codec_info, BT_HDR* p_buf,
+                                   const BT_HDR* p_next, uint16_t max_len);
+
 
 // New feature to check codec info is supported Channel Separation.
 bool A2DP_VendorGetChannelSeparationLL(const uint8_t* p_codec_info);
@@ -18,17 +18,112 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <vector>
 
 class AdvertiseDataParser {
  public:
+  /** A field of advertising data, pointing inside the data it was found in */
+  struct Field {
+    uint8_t type;
+    uint8_t len;  // The length of |data|, without the length and type octets
+    const uint8_t* data;
+  };
+
   /**
-   * Return true if this |ad| represent properly formatted advertising data.
+   * Iterates over the fields of the |ad| array of length |ad_len| in place,
+   * e.g. in the HCI report, without copying it. The iteration stops at the
+   * first badly formatted field. An iterator at |ad_len| is the end.
    */
-  static bool IsValid(const std::vector<uint8_t>& ad) {
+  class FieldIterator {
+   public:
+    FieldIterator(const uint8_t* ad, size_t ad_len, size_t position)
+        : ad_(ad), ad_len_(ad_len), position_(position) {
+      Check();
+    }
+
+    const Field& operator*() const { return field_; }
+    const Field* operator->() const { return &field_; }
+
+    FieldIterator& operator++() {
+      position_ += field_.len + 2;
+      Check();
+      return *this;
+    }
+
+    bool operator!=(const FieldIterator& other) const {
+      return position_ != other.position_;
+    }
+
+   private:
+    /* Sets |field_| to the field at |position_|, or ends the iteration */
+    void Check() {
+      if (position_ == ad_len_) return;
+
+      uint8_t len = ad_[position_];
+      if (len == 0 || position_ + len >= ad_len_) {
+        position_ = ad_len_;
+        return;
+      }
+      field_.type = ad_[position_ + 1];
+      field_.len = len - 1; /* minus the length of type */
+      field_.data = ad_ + position_ + 2;
+    }
+
+    const uint8_t* ad_;
+    size_t ad_len_;
+    size_t position_;
+    Field field_;
+  };
+
+  /** The fields of advertising data, for a range-based for loop */
+  class Fields {
+   public:
+    Fields(const uint8_t* ad, size_t ad_len) : ad_(ad), ad_len_(ad_len) {}
+
+    FieldIterator begin() const { return FieldIterator(ad_, ad_len_, 0); }
+    FieldIterator end() const { return FieldIterator(ad_, ad_len_, ad_len_); }
+
+   private:
+    const uint8_t* ad_;
+    size_t ad_len_;
+  };
+
+  /**
+   * Finds the first field of each of the |num_types| types of |types| in the
+   * |ad| array of length |ad_len|, in a single pass. |fields[i]| is set to
+   * the field of type |types[i]|, its |data| is NULL if there is none.
+   * Returns the number of types found.
+   */
+  static size_t GetFieldsByType(const uint8_t* ad, size_t ad_len,
+                                const uint8_t* types, size_t num_types,
+                                Field* fields) {
+    for (size_t i = 0; i < num_types; i++) {
+      fields[i].type = types[i];
+      fields[i].len = 0;
+      fields[i].data = NULL;
+    }
+
+    size_t found = 0;
+    for (const Field& field : Fields(ad, ad_len)) {
+      for (size_t i = 0; i < num_types; i++) {
+        if (field.type != types[i] || fields[i].data != NULL) continue;
+        fields[i] = field;
+        if (++found == num_types) return found;
+      }
+    }
+    return found;
+  }
+
+  /**
+   * Return true if the |ad| array of length |ad_len| represent properly
+   * formatted advertising data.
+   */
+  static bool IsValid(const uint8_t* ad, size_t ad_len) {
     size_t position = 0;
 
-    size_t ad_len = ad.size();
     while (position != ad_len) {
       uint8_t len = ad[position];
 
@@ -48,29 +143,24 @@ class AdvertiseDataParser {
     return true;
   }
 
+  /**
+   * Return true if this |ad| represent properly formatted advertising data.
+   */
+  static bool IsValid(const std::vector<uint8_t>& ad) {
+    return IsValid(ad.data(), ad.size());
+  }
+
   /**
    * This function returns a pointer inside the |ad| array of length |ad_len|
    * where a field of |type| is located, together with its length in |p_length|
    */
   static const uint8_t* GetFieldByType(const uint8_t* ad, size_t ad_len,
                                        uint8_t type, uint8_t* p_length) {
-    size_t position = 0;
-
-    while (position != ad_len) {
-      uint8_t len = ad[position];
-
-      if (len == 0) break;
-      if (position + len >= ad_len) break;
-
-      uint8_t adv_type = ad[position + 1];
-
-      if (adv_type == type) {
-        /* length doesn't include itself */
-        *p_length = len - 1; /* minus the length of type */
-        return ad + position + 2;
+    for (const Field& field : Fields(ad, ad_len)) {
+      if (field.type == type) {
+        *p_length = field.len;
+        return field.data;
       }
-
-      position += len + 1; /* skip the length of data */
     }
 
     *p_length = 0;
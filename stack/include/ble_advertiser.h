@@ -151,6 +151,13 @@ class BleAdvertisingManager {
       uint8_t status, uint8_t advertising_handle, uint16_t connection_handle,
       uint8_t num_completed_extended_adv_events) = 0;
 
+  /* Allows up to |rotated_advertisers| advertisers beyond the advertising sets
+   * of the controller. The last free set is reserved for them: they take turns
+   * on it, with more airtime for the shorter advertising intervals. Only
+   * non-connectable advertising, without periodic advertising, is supported
+   * on these advertisers. */
+  virtual void SetRotation(uint8_t rotated_advertisers) = 0;
+
   using GetAddressCallback =
       base::Callback<void(uint8_t /* address_type*/, bt_bdaddr_t /*address*/)>;
   virtual void GetOwnAddress(uint8_t inst_id, GetAddressCallback cb) = 0;
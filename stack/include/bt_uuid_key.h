@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <functional>
+
+#include "bt_types.h"
+
+/**
+ * The canonical 128-bit form of a tBT_UUID of any length, with a hash of it
+ * computed once, so that UUIDs received in different lengths compare with a
+ * single memcmp, and key hash maps.
+ *
+ * The 128-bit UUIDs are in the little endian order of tBT_UUID, the 16 and
+ * 32-bit ones are the last 4 octets of the Bluetooth base UUID.
+ */
+class BtUuidKey {
+ public:
+  explicit BtUuidKey(const tBT_UUID& uuid) {
+    if (uuid.len == LEN_UUID_16)
+      SetValue32(uuid.uu.uuid16);
+    else if (uuid.len == LEN_UUID_32)
+      SetValue32(uuid.uu.uuid32);
+    else
+      memcpy(uuid128_, uuid.uu.uuid128, LEN_UUID_128);
+    hash_ = Hash(uuid128_);
+  }
+
+  const uint8_t* uuid128() const { return uuid128_; }
+  uint32_t hash() const { return hash_; }
+
+  bool operator==(const BtUuidKey& other) const {
+    return hash_ == other.hash_ &&
+           memcmp(uuid128_, other.uuid128_, LEN_UUID_128) == 0;
+  }
+  bool operator!=(const BtUuidKey& other) const { return !(*this == other); }
+
+  /**
+   * Returns whether |a| and |b| are the same UUID, whatever their lengths.
+   * The common case of two UUIDs of the same length compares their values
+   * only, and a 16 or 32-bit UUID compares with a 128-bit one without
+   * building the 128-bit form of the former.
+   */
+  static bool Equal(const tBT_UUID& a, const tBT_UUID& b) {
+    if (a.len == LEN_UUID_16 && b.len == LEN_UUID_16)
+      return a.uu.uuid16 == b.uu.uuid16;
+    if (a.len == LEN_UUID_128 && b.len == LEN_UUID_128)
+      return memcmp(a.uu.uuid128, b.uu.uuid128, LEN_UUID_128) == 0;
+
+    uint32_t a32, b32;
+    if (!Value32(a, &a32) || !Value32(b, &b32)) return false;
+    return a32 == b32;
+  }
+
+ private:
+  static const size_t kBaseUuidLen = LEN_UUID_128 - 4;
+
+  /* The part of the Bluetooth base UUID ahead of its 32-bit value */
+  static const uint8_t* BaseUuid() {
+    static const uint8_t base_uuid[kBaseUuidLen] = {0xFB, 0x34, 0x9B, 0x5F,
+                                                    0x80, 0x00, 0x00, 0x80,
+                                                    0x00, 0x10, 0x00, 0x00};
+    return base_uuid;
+  }
+
+  void SetValue32(uint32_t value) {
+    memcpy(uuid128_, BaseUuid(), kBaseUuidLen);
+    uuid128_[12] = value;
+    uuid128_[13] = value >> 8;
+    uuid128_[14] = value >> 16;
+    uuid128_[15] = value >> 24;
+  }
+
+  /* Returns the 32-bit value of |uuid| in |value|, or false if it is a
+   * 128-bit UUID that is not based on the Bluetooth base UUID. */
+  static bool Value32(const tBT_UUID& uuid, uint32_t* value) {
+    if (uuid.len == LEN_UUID_16) {
+      *value = uuid.uu.uuid16;
+      return true;
+    }
+    if (uuid.len == LEN_UUID_32) {
+      *value = uuid.uu.uuid32;
+      return true;
+    }
+    if (uuid.len != LEN_UUID_128 ||
+        memcmp(uuid.uu.uuid128, BaseUuid(), kBaseUuidLen) != 0)
+      return false;
+
+    const uint8_t* p = uuid.uu.uuid128 + kBaseUuidLen;
+    *value = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    return true;
+  }
+
+  /* Folds the four words of the UUID, the 32-bit value of the assigned
+   * UUIDs being where they differ */
+  static uint32_t Hash(const uint8_t* uuid128) {
+    uint32_t words[4];
+    memcpy(words, uuid128, sizeof(words));
+    return (words[0] ^ words[1] ^ words[2] ^ words[3]) * 0x9E3779B1u;
+  }
+
+  uint8_t uuid128_[LEN_UUID_128];
+  uint32_t hash_;
+};
+
+namespace std {
+template <>
+struct hash<BtUuidKey> {
+  size_t operator()(const BtUuidKey& key) const { return key.hash(); }
+};
+}  // namespace std
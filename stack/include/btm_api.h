@@ -28,6 +28,7 @@
 #include "bt_target.h"
 #include "device/include/esco_parameters.h"
 #include "hcidefs.h"
+#include "osi/include/time.h"
 #include "sdp_api.h"
 
 #include "smp_api.h"
@@ -922,6 +923,55 @@ extern tBTM_STATUS BTM_ReadTxPower(BD_ADDR remote_bda, tBT_TRANSPORT transport,
  ******************************************************************************/
 extern tBTM_STATUS BTM_ReadLinkQuality(BD_ADDR remote_bda, tBTM_CMPL_CB* p_cb);
 
+/*******************************************************************************
+ *
+ * Function         BTM_ReadFailedContactCounter
+ *
+ * Description      This function is called to read the number of consecutive
+ *                  times the flush timeout of the link expired, since it was
+ *                  connected. The value is returned in the callback.
+ *                  (tBTM_FAILED_CONTACT_COUNTER_RESULTS)
+ *
+ * Returns          BTM_CMD_STARTED if command issued to controller.
+ *                  BTM_UNKNOWN_ADDR if no active link with bd addr specified
+ *                  BTM_BUSY if command is already in progress
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_ReadFailedContactCounter(const BD_ADDR remote_bda,
+                                                tBTM_CMPL_CB* p_cb);
+
+/*******************************************************************************
+ *
+ * Function         BTM_SetAclHighThroughput
+ *
+ * Description      This function is called while a stream needs most of the
+ *                  throughput of the BR/EDR link, e.g. a high bitrate A2DP
+ *                  codec. The link then allows every packet type up to
+ *                  3-DH5, and falls back to at most 2-DH3 for a while when
+ *                  its completed packets show it cannot keep up.
+ *                  Disabling it restores the packet types of the link.
+ *
+ * Returns          BTM_SUCCESS if the policy of the link is set
+ *                  BTM_UNKNOWN_ADDR if no active link with bd addr specified
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_SetAclHighThroughput(const BD_ADDR remote_bda,
+                                            bool enable);
+
+/*******************************************************************************
+ *
+ * Function         BTM_ReadAclThroughput
+ *
+ * Description      This function reads the throughput the BR/EDR link
+ *                  carried over the last second, and the state of its high
+ *                  throughput policy.
+ *
+ * Returns          true if found, false otherwise
+ *
+ ******************************************************************************/
+extern bool BTM_ReadAclThroughput(const BD_ADDR remote_bda,
+                                  tBTM_ACL_THROUGHPUT* p_tput);
+
 /*******************************************************************************
  *
  * Function         BTM_RegBusyLevelNotif
@@ -1810,6 +1860,40 @@ extern tBTM_STATUS BTM_SetPowerMode(uint8_t pm_id, BD_ADDR remote_bda,
  ******************************************************************************/
 extern tBTM_STATUS BTM_ReadPowerMode(BD_ADDR remote_bda, tBTM_PM_MODE* p_mode);
 
+/*******************************************************************************
+ *
+ * Function         BTM_PmReadIdle
+ *
+ * Description      This returns how long an ACL connection has had no
+ *                  traffic, and how long its pause is predicted to last.
+ *
+ * Input Param      remote_bda - device address of desired ACL connection
+ *
+ * Output Param     p_idle_ms - the time since the last ACL packet
+ *                  p_predicted_ms - the predicted length of the whole pause,
+ *                                   from the past gaps of the link, or 0 if
+ *                                   there is no prediction
+ *                          (valid only if return code is BTM_SUCCESS)
+ *
+ * Returns          BTM_SUCCESS if successful,
+ *                  BTM_UNKNOWN_ADDR if bd addr is not active or bad
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_PmReadIdle(BD_ADDR remote_bda, period_ms_t* p_idle_ms,
+                                  period_ms_t* p_predicted_ms);
+
+/*******************************************************************************
+ *
+ * Function         BTM_PmDumpStatistics
+ *
+ * Description      This function dumps the power mode of the ACL links, and
+ *                  the statistics of their traffic, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_PmDumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_SetSsrParams
@@ -2038,6 +2122,18 @@ extern tBTM_STATUS BTM_ConfigScoPath(esco_data_path_t path,
  ******************************************************************************/
 extern tBTM_STATUS BTM_WriteScoData(uint16_t sco_inx, BT_HDR* p_buf);
 
+/*******************************************************************************
+ *
+ * Function         BTM_ScoDumpStatistics
+ *
+ * Description      This function dumps the SCO links, and the statistics of
+ *                  their data routed over HCI, to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_ScoDumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_SetARCMode
@@ -797,6 +797,26 @@ typedef struct {
   BD_ADDR rem_bda;
 } tBTM_LINK_QUALITY_RESULTS;
 
+/* Structure returned with read failed contact counter event (in tBTM_CMPL_CB
+ * callback function) in response to BTM_ReadFailedContactCounter call.
+*/
+typedef struct {
+  tBTM_STATUS status;
+  uint8_t hci_status;
+  uint16_t failed_contact_counter;
+  BD_ADDR rem_bda;
+} tBTM_FAILED_CONTACT_COUNTER_RESULTS;
+
+/* ACL throughput of a link, returned by BTM_ReadAclThroughput */
+typedef struct {
+  bool high_throughput;    /* the link prefers the 5 slot EDR packets */
+  bool fallback;           /* the link fell back to 2-DH3 under interference */
+  uint16_t num_fallbacks;  /* times the link fell back */
+  uint16_t pkt_types_mask; /* ACL packet types the link may use */
+  uint32_t goodput_kbps;   /* payload the controller completed, last second */
+  uint8_t blocked_pct; /* completions the link waited for, last second (%) */
+} tBTM_ACL_THROUGHPUT;
+
 /* Structure returned with read inq tx power quality event (in tBTM_CMPL_CB
  * callback function) in response to BTM_ReadInquiryRspTxPower call.
 */
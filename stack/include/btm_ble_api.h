@@ -165,6 +165,18 @@ extern void BTM_BleReadScanReports(tBLE_SCAN_MODE scan_mode,
 extern void BTM_BleTrackAdvertiser(tBTM_BLE_TRACK_ADV_CBACK* p_track_cback,
                                    tBTM_BLE_REF_VALUE ref_value);
 
+/* This function is called to read the batch scan statistics */
+extern void BTM_BleGetBatchScanStats(tBTM_BLE_BATCH_SCAN_STATS* p_stats);
+
+/* This function is called to dump the batch scan statistics to |fd| */
+extern void BTM_BleBatchScanDumpStatistics(int fd);
+
+/* This function is called to dump the advertiser rotation to |fd| */
+extern void BTM_BleAdvRotationDumpStatistics(int fd);
+
+/* This function is called to dump the resolving list statistics to |fd| */
+extern void BTM_BleResolvingListDumpStatistics(int fd);
+
 /*******************************************************************************
  *
  * Function         BTM_BleWriteScanRsp
@@ -811,6 +823,20 @@ extern void BTM_BleEnableDisableFilterFeature(
 extern tBTM_STATUS BTM_BleGetEnergyInfo(
     tBTM_BLE_ENERGY_INFO_CBACK* p_ener_cback);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleSetEnergyA2dpCodec
+ *
+ * Description      Sets the A2DP codec streaming, that the background samples
+ *                  of the controller energy counters are attributed to. It
+ *                  may be called from any thread.
+ *
+ * Parameters       codec_index - the btav_a2dp_codec_index_t of the codec
+ *                                streaming, -1 if none
+ *
+ ******************************************************************************/
+extern void BTM_BleSetEnergyA2dpCodec(int32_t codec_index);
+
 /*******************************************************************************
  *
  * Function         BTM_SetBleDataLength
@@ -823,6 +849,20 @@ extern tBTM_STATUS BTM_BleGetEnergyInfo(
 extern tBTM_STATUS BTM_SetBleDataLength(BD_ADDR bd_addr,
                                         uint16_t tx_pdu_length);
 
+/*******************************************************************************
+ *
+ * Function         BTM_BleSetPhy
+ *
+ * Description      Set the preferred PHYs of an LE link, PHY_LE_1M and/or
+ *                  PHY_LE_2M for each direction.
+ *
+ * Returns          BTM_SUCCESS if the PHY update is requested; otherwise
+ *                  failed.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_BleSetPhy(BD_ADDR bd_addr, uint8_t tx_phys,
+                                 uint8_t rx_phys, uint16_t phy_options);
+
 extern void btm_ble_multi_adv_cleanup(void);
 
 #endif
@@ -363,6 +363,16 @@ typedef void(tBTM_BLE_ADV_DATA_CMPL_CBACK)(tBTM_STATUS status);
         than this number */
 #endif
 
+/* The maximum number of advertisers rotated on a single advertising set */
+#ifndef BTM_BLE_ADV_ROTATION_MAX
+#define BTM_BLE_ADV_ROTATION_MAX 32
+#endif
+
+/* The length of a turn of a rotated advertiser */
+#ifndef BTM_BLE_ADV_ROTATION_SLOT_MS
+#define BTM_BLE_ADV_ROTATION_SLOT_MS 200
+#endif
+
 typedef uint8_t tGATT_IF;
 
 typedef void(tBTM_BLE_SCAN_THRESHOLD_CBACK)(tBTM_BLE_REF_VALUE ref_value);
@@ -400,6 +410,14 @@ typedef struct {
   tBTM_BLE_REF_VALUE ref_value;
 } tBTM_BLE_BATCH_SCAN_CB;
 
+/* The statistics of the batch scan reports, since the stack started */
+typedef struct {
+  uint32_t reports_read;      /* read from the controller */
+  uint32_t reports_delivered; /* delivered to the clients */
+  uint32_t reports_dropped;   /* dropped as the host buffer was full */
+  uint32_t read_failures;     /* reads the controller failed */
+} tBTM_BLE_BATCH_SCAN_STATS;
+
 /* filter selection bit index  */
 #define BTM_BLE_PF_ADDR_FILTER 0
 #define BTM_BLE_PF_SRVC_DATA 1
@@ -0,0 +1,348 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the Bluetooth Manager (BTM) API of the LE isochronous
+ *  channels: the CIG and CIS set up to a peer, the BIG broadcast, and the
+ *  SDUs sent on them through the HCI data path.
+ *
+ ******************************************************************************/
+#ifndef BTM_ISO_API_H
+#define BTM_ISO_API_H
+
+#include "bt_target.h"
+#include "btm_api_types.h"
+
+/* The headers written in front of an SDU given to BTM_IsoWriteSdu: the ISO
+ * data packet header, the packet sequence number and the SDU length. */
+#define BTM_ISO_SDU_OFFSET 8
+
+/* The directions of the ISO data paths */
+#define BTM_ISO_DATA_PATH_INPUT 0  /* host to controller */
+#define BTM_ISO_DATA_PATH_OUTPUT 1 /* controller to host */
+
+/* ISO events */
+#define BTM_ISO_CIG_SET_EVT 0          /* CIG parameters set */
+#define BTM_ISO_CIG_REMOVED_EVT 1      /* CIG removed */
+#define BTM_ISO_CIS_ESTABLISHED_EVT 2  /* CIS established, or failed to */
+#define BTM_ISO_CIS_REQUEST_EVT 3      /* CIS requested by the peer */
+#define BTM_ISO_CIS_DISCONNECTED_EVT 4 /* CIS disconnected */
+#define BTM_ISO_BIG_CREATED_EVT 5      /* BIG created, or failed to */
+#define BTM_ISO_BIG_TERMINATED_EVT 6   /* BIG terminated */
+#define BTM_ISO_DATA_PATH_EVT 7        /* ISO data path set up or removed */
+typedef uint8_t tBTM_ISO_EVT;
+
+/* The configuration of a CIS, in the CIG parameters */
+typedef struct {
+  uint8_t cis_id;
+  uint16_t max_sdu_mtos; /* octets of the SDUs from the master */
+  uint16_t max_sdu_stom; /* octets of the SDUs from the slave */
+  uint8_t phy_mtos;
+  uint8_t phy_stom;
+  uint8_t rtn_mtos; /* retransmissions of the SDUs from the master */
+  uint8_t rtn_stom; /* retransmissions of the SDUs from the slave */
+} tBTM_ISO_CIS_CFG;
+
+typedef struct {
+  uint32_t sdu_interval_mtos_us;
+  uint32_t sdu_interval_stom_us;
+  uint8_t sca;
+  uint8_t packing;
+  uint8_t framing;
+  uint16_t max_trans_lat_mtos_ms;
+  uint16_t max_trans_lat_stom_ms;
+  uint8_t cis_count;
+  tBTM_ISO_CIS_CFG cis_cfg[BTM_ISO_MAX_GROUP_STREAMS];
+} tBTM_ISO_CIG_PARAMS;
+
+typedef struct {
+  uint8_t adv_handle; /* periodic advertising set of the BIG */
+  uint8_t num_bis;
+  uint32_t sdu_interval_us;
+  uint16_t max_sdu;
+  uint16_t max_trans_lat_ms;
+  uint8_t rtn;
+  uint8_t phy;
+  uint8_t packing;
+  uint8_t framing;
+  uint8_t enc;
+  BT_OCTET16 bcst_code;
+} tBTM_ISO_BIG_PARAMS;
+
+typedef struct {
+  uint8_t status;
+  uint8_t cig_id;
+  uint8_t num_cis;
+  uint16_t cis_handles[BTM_ISO_MAX_GROUP_STREAMS];
+} tBTM_ISO_CIG_SET;
+
+typedef struct {
+  uint8_t status;
+  uint8_t cig_id;
+} tBTM_ISO_CIG_REMOVED;
+
+typedef struct {
+  uint8_t status;
+  uint16_t cis_handle;
+  uint32_t trans_lat_mtos_us;
+  uint32_t trans_lat_stom_us;
+  uint16_t max_pdu_mtos;
+  uint16_t max_pdu_stom;
+  uint16_t iso_interval; /* in 1.25 ms */
+} tBTM_ISO_CIS_ESTABLISHED;
+
+typedef struct {
+  uint16_t acl_handle;
+  uint16_t cis_handle;
+  uint8_t cig_id;
+  uint8_t cis_id;
+} tBTM_ISO_CIS_REQUEST;
+
+typedef struct {
+  uint16_t handle;
+  uint8_t reason;
+} tBTM_ISO_DISCONNECTED;
+
+typedef struct {
+  uint8_t status;
+  uint8_t big_handle;
+  uint32_t trans_lat_us;
+  uint8_t num_bis;
+  uint16_t bis_handles[BTM_ISO_MAX_GROUP_STREAMS];
+} tBTM_ISO_BIG_CREATED;
+
+typedef struct {
+  uint8_t big_handle;
+  uint8_t reason;
+} tBTM_ISO_BIG_TERMINATED;
+
+typedef struct {
+  uint8_t status;
+  uint16_t handle;
+  uint8_t direction;
+  bool removed;
+} tBTM_ISO_DATA_PATH;
+
+typedef union {
+  tBTM_ISO_CIG_SET cig_set;
+  tBTM_ISO_CIG_REMOVED cig_removed;
+  tBTM_ISO_CIS_ESTABLISHED cis_established;
+  tBTM_ISO_CIS_REQUEST cis_request;
+  tBTM_ISO_DISCONNECTED cis_disconnected;
+  tBTM_ISO_BIG_CREATED big_created;
+  tBTM_ISO_BIG_TERMINATED big_terminated;
+  tBTM_ISO_DATA_PATH data_path;
+} tBTM_ISO_EVT_DATA;
+
+typedef void(tBTM_ISO_CBACK)(tBTM_ISO_EVT event, tBTM_ISO_EVT_DATA* p_data);
+
+/* Called with the SDUs received on |handle|, at the offset of the packet
+ * sequence number, to be freed by the callee. */
+typedef void(tBTM_ISO_DATA_CBACK)(uint16_t handle, BT_HDR* p_data);
+
+/* The SDUs sent on a stream since its data path was set up */
+typedef struct {
+  uint32_t sdus;         /* SDUs written */
+  uint32_t sdus_late;    /* SDUs numbered after the interval they belong to */
+  uint32_t sdus_lost;    /* SDU intervals without SDU */
+  uint32_t sdus_dropped; /* SDUs too old to be sent */
+  uint32_t pkts_sent;    /* ISO data packets sent to the controller */
+  uint32_t pkts_completed;
+  uint16_t queued;      /* SDUs waiting for the controller buffers */
+  uint16_t max_queued;  /* the most that may wait */
+} tBTM_ISO_TX_STATS;
+
+/*****************************************************************************
+ *  EXTERNAL FUNCTION DECLARATIONS
+ ****************************************************************************/
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoRegister
+ *
+ * Description      Registers the callbacks of the ISO events, and of the
+ *                  SDUs received. There is a single user of the ISO
+ *                  channels.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_IsoRegister(tBTM_ISO_CBACK* p_cback,
+                            tBTM_ISO_DATA_CBACK* p_data_cback);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoIsSupported
+ *
+ * Description      Returns true if the controller sets up CIS as master, or
+ *                  broadcasts BIS, with the SDUs sent by the host.
+ *
+ ******************************************************************************/
+extern bool BTM_IsoIsSupported(void);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoSetCigParams
+ *
+ * Description      Sets the parameters of the CIG |cig_id|, reported by
+ *                  BTM_ISO_CIG_SET_EVT with the handles of its CIS.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoSetCigParams(uint8_t cig_id,
+                                       const tBTM_ISO_CIG_PARAMS* p_params);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoCreateCis
+ *
+ * Description      Establishes the |num_cis| CIS of |cis_handles|, set up by
+ *                  BTM_IsoSetCigParams, each on the ACL link of the same
+ *                  index in |acl_handles|. Each is reported by
+ *                  BTM_ISO_CIS_ESTABLISHED_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoCreateCis(uint8_t num_cis,
+                                    const uint16_t* cis_handles,
+                                    const uint16_t* acl_handles);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoRemoveCig
+ *
+ * Description      Removes the CIG |cig_id|, whose CIS are all
+ *                  disconnected, reported by BTM_ISO_CIG_REMOVED_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoRemoveCig(uint8_t cig_id);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoAcceptCis
+ *
+ * Description      Accepts, or rejects with |reason|, the CIS requested by
+ *                  the peer with BTM_ISO_CIS_REQUEST_EVT. An accepted CIS is
+ *                  reported by BTM_ISO_CIS_ESTABLISHED_EVT.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void BTM_IsoAcceptCis(uint16_t cis_handle, bool accept, uint8_t reason);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoDisconnectCis
+ *
+ * Description      Disconnects the CIS |cis_handle|, reported by
+ *                  BTM_ISO_CIS_DISCONNECTED_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoDisconnectCis(uint16_t cis_handle, uint8_t reason);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoCreateBig
+ *
+ * Description      Creates the BIG |big_handle|, broadcast on the periodic
+ *                  advertising set of |p_params|, reported by
+ *                  BTM_ISO_BIG_CREATED_EVT with the handles of its BIS.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoCreateBig(uint8_t big_handle,
+                                    const tBTM_ISO_BIG_PARAMS* p_params);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoTerminateBig
+ *
+ * Description      Terminates the BIG |big_handle|, reported by
+ *                  BTM_ISO_BIG_TERMINATED_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoTerminateBig(uint8_t big_handle, uint8_t reason);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoSetupDataPath
+ *
+ * Description      Sets up the HCI data path of the CIS or BIS |handle| in
+ *                  |direction|, with the codec of the SDUs transparent to
+ *                  the controller. Reported by BTM_ISO_DATA_PATH_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoSetupDataPath(uint16_t handle, uint8_t direction);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoRemoveDataPath
+ *
+ * Description      Removes the data path of the CIS or BIS |handle| in
+ *                  |direction|, dropping the SDUs still queued. Reported by
+ *                  BTM_ISO_DATA_PATH_EVT.
+ *
+ * Returns          BTM_CMD_STARTED if the command was sent.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoRemoveDataPath(uint16_t handle, uint8_t direction);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoWriteSdu
+ *
+ * Description      Sends the SDU |p_buf| on the CIS or BIS |handle|, whose
+ *                  input data path is set up. |timestamp_us| is the time of
+ *                  its first sample on the audio clock, which gives the SDU
+ *                  interval it is sent in. The buffer is taken over, and
+ *                  needs BTM_ISO_SDU_OFFSET octets in front of the SDU.
+ *
+ *                  This is the sink of the encoders sending on ISO channels:
+ *                  an SDU waits in BTM only for the controller buffers, and
+ *                  is dropped once older than the transport latency.
+ *
+ * Returns          BTM_SUCCESS if the SDU was queued.
+ *
+ ******************************************************************************/
+extern tBTM_STATUS BTM_IsoWriteSdu(uint16_t handle, BT_HDR* p_buf,
+                                   uint64_t timestamp_us);
+
+/*******************************************************************************
+ *
+ * Function         BTM_IsoReadTxStats
+ *
+ * Description      Reads the statistics of the SDUs sent on |handle|.
+ *
+ * Returns          false if |handle| is not an ISO stream.
+ *
+ ******************************************************************************/
+extern bool BTM_IsoReadTxStats(uint16_t handle, tBTM_ISO_TX_STATS* p_stats);
+
+#endif /* BTM_ISO_API_H */
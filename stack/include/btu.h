@@ -59,6 +59,7 @@ extern const BD_ADDR BT_BD_ANY;
 /* Functions provided by btu_hcif.cc
  ***********************************
 */
+extern void btu_hcif_subscribe_events(bool subscribe);
 extern void btu_hcif_process_event(uint8_t controller_id, BT_HDR* p_buf);
 extern void btu_hcif_send_cmd(uint8_t controller_id, BT_HDR* p_msg);
 extern void btu_hcif_send_cmd_with_cb(
@@ -75,4 +76,7 @@ extern void btu_free_core(void);
 void BTU_StartUp(void);
 void BTU_ShutDown(void);
 
+/* Dumps the occupancy of the BTU thread to |fd| */
+void BTU_DumpStatistics(int fd);
+
 #endif
@@ -814,6 +814,50 @@ extern tGATT_STATUS GATTS_HandleValueNotification(uint16_t conn_id,
 extern tGATT_STATUS GATTS_SendRsp(uint16_t conn_id, uint32_t trans_id,
                                   tGATT_STATUS status, tGATTS_RSP* p_msg);
 
+/*******************************************************************************
+ *
+ * Function         GATTS_SetAttributeValue
+ *
+ * Description      This function sets the value of an attribute, read by the
+ *                  stack for the clients instead of asking the application
+ *                  until it is invalidated.
+ *
+ * Parameter        gatt_if: application interface.
+ *                  attr_handle: characteristic value or descriptor handle.
+ *                  version: of the value, newer than the one of the last
+ *                           update of the attribute, 0 before the first.
+ *                  len: length of the value.
+ *                  p_value: the value.
+ *
+ * Returns          GATT_SUCCESS if the value is set; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_SetAttributeValue(tGATT_IF gatt_if,
+                                            uint16_t attr_handle,
+                                            uint32_t version, uint16_t len,
+                                            const uint8_t* p_value);
+
+/*******************************************************************************
+ *
+ * Function         GATTS_InvalidateAttributeValue
+ *
+ * Description      This function drops the value of an attribute set by
+ *                  GATTS_SetAttributeValue, so that its reads are sent to the
+ *                  application again. A value is also dropped when a client
+ *                  writes the attribute.
+ *
+ * Parameter        gatt_if: application interface.
+ *                  attr_handle: characteristic value or descriptor handle.
+ *                  version: of the invalidation, newer than the one of the
+ *                           last update of the attribute.
+ *
+ * Returns          GATT_SUCCESS if the value is dropped; otherwise error code.
+ *
+ ******************************************************************************/
+extern tGATT_STATUS GATTS_InvalidateAttributeValue(tGATT_IF gatt_if,
+                                                   uint16_t attr_handle,
+                                                   uint32_t version);
+
 /******************************************************************************/
 /* GATT Profile Client Functions */
 /******************************************************************************/
@@ -1093,6 +1137,19 @@ extern bool GATT_GetConnIdIfConnected(tGATT_IF gatt_if, BD_ADDR bd_addr,
 extern void GATT_ConfigServiceChangeCCC(BD_ADDR remote_bda, bool enable,
                                         tBT_TRANSPORT transport);
 
+/*******************************************************************************
+ *
+ * Function         GATT_DumpConnections
+ *
+ * Description      This function dumps the ATT MTU and the LE data length of
+ *                  the GATT connections, with the payload they leave to the
+ *                  attribute values, to |fd|.
+ *
+ * Returns          None.
+ *
+ ******************************************************************************/
+extern void GATT_DumpConnections(int fd);
+
 // Enables the GATT profile on the device.
 // It clears out the control blocks, and registers with L2CAP.
 extern void gatt_init(void);
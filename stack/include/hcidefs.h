@@ -376,6 +376,19 @@
 #define HCI_LE_EXTENDED_CREATE_CONNECTION (0x0043 | HCI_GRP_BLE_CMDS)
 #define HCI_BLE_SET_PRIVACY_MODE (0x004E | HCI_GRP_BLE_CMDS)
 
+/* LE Isochronous Channels */
+#define HCI_BLE_READ_BUFFER_SIZE_V2 (0x0060 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_SET_CIG_PARAMS (0x0062 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_CREATE_CIS (0x0064 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_REMOVE_CIG (0x0065 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_ACCEPT_CIS_REQ (0x0066 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_REJECT_CIS_REQ (0x0067 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_CREATE_BIG (0x0068 | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_TERMINATE_BIG (0x006A | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_SETUP_ISO_DATA_PATH (0x006E | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_REMOVE_ISO_DATA_PATH (0x006F | HCI_GRP_BLE_CMDS)
+#define HCI_BLE_SET_HOST_FEATURE (0x0074 | HCI_GRP_BLE_CMDS)
+
 /* LE Get Vendor Capabilities Command OCF */
 #define HCI_BLE_VENDOR_CAP_OCF (0x0153 | HCI_GRP_VENDOR_SPECIFIC)
 
@@ -400,6 +413,24 @@
 /* Controller debug info OCF */
 #define HCI_CONTROLLER_DEBUG_INFO_OCF (0x015B | HCI_GRP_VENDOR_SPECIFIC)
 
+/* A2DP offload OCF */
+#define HCI_CONTROLLER_A2DP_OPCODE (0x015D | HCI_GRP_VENDOR_SPECIFIC)
+
+/* subcode for A2DP offload feature */
+#define HCI_A2DP_OFFLOAD_START 0x01
+#define HCI_A2DP_OFFLOAD_STOP 0x02
+
+/* codec types of the A2DP offload start command */
+#define HCI_A2DP_OFFLOAD_CODEC_SBC 0x00000001
+#define HCI_A2DP_OFFLOAD_CODEC_AAC 0x00000002
+#define HCI_A2DP_OFFLOAD_CODEC_APTX 0x00000004
+#define HCI_A2DP_OFFLOAD_CODEC_APTX_HD 0x00000008
+#define HCI_A2DP_OFFLOAD_CODEC_LDAC 0x00000010
+#define HCI_A2DP_OFFLOAD_CODEC_LHDC 0x00000020
+
+/* length of the codec information of the A2DP offload start command */
+#define HCI_A2DP_OFFLOAD_CODEC_INFO_LEN 32
+
 /* subcode for multi adv feature */
 #define BTM_BLE_MULTI_ADV_SET_PARAM 0x01
 #define BTM_BLE_MULTI_ADV_WRITE_ADV_DATA 0x02
@@ -844,6 +875,10 @@
 #define HCI_LE_PHY_UPDATE_COMPLETE_EVT 0x0C
 #define HCI_LE_EXTENDED_ADVERTISING_REPORT_EVT 0x0D
 #define HCI_LE_ADVERTISING_SET_TERMINATED_EVT 0x12
+#define HCI_BLE_CIS_EST_EVT 0x19
+#define HCI_BLE_CIS_REQ_EVT 0x1A
+#define HCI_BLE_CREATE_BIG_CPL_EVT 0x1B
+#define HCI_BLE_TERM_BIG_CPL_EVT 0x1C
 
 /* Definitions for LE Channel Map */
 #define HCI_BLE_CHNL_MAP_SIZE 5
@@ -1980,6 +2015,28 @@ typedef struct {
 #define HCI_LE_DATA_LEN_EXT_SUPPORTED(x) \
   ((x)[HCI_LE_FEATURE_DATA_LEN_EXT_OFF] & HCI_LE_FEATURE_DATA_LEN_EXT_MASK)
 
+/* Connected Isochronous Stream Master */
+#define HCI_LE_FEATURE_CIS_MASTER_MASK 0x10
+#define HCI_LE_FEATURE_CIS_MASTER_OFF 3
+#define HCI_LE_CIS_MASTER_SUPPORTED(x) \
+  ((x)[HCI_LE_FEATURE_CIS_MASTER_OFF] & HCI_LE_FEATURE_CIS_MASTER_MASK)
+
+/* Connected Isochronous Stream Slave */
+#define HCI_LE_FEATURE_CIS_SLAVE_MASK 0x20
+#define HCI_LE_FEATURE_CIS_SLAVE_OFF 3
+#define HCI_LE_CIS_SLAVE_SUPPORTED(x) \
+  ((x)[HCI_LE_FEATURE_CIS_SLAVE_OFF] & HCI_LE_FEATURE_CIS_SLAVE_MASK)
+
+/* Isochronous Broadcaster */
+#define HCI_LE_FEATURE_ISO_BROADCASTER_MASK 0x40
+#define HCI_LE_FEATURE_ISO_BROADCASTER_OFF 3
+#define HCI_LE_ISO_BROADCASTER_SUPPORTED(x)  \
+  ((x)[HCI_LE_FEATURE_ISO_BROADCASTER_OFF] & \
+   HCI_LE_FEATURE_ISO_BROADCASTER_MASK)
+
+/* Isochronous Channels (Host Support), set by LE Set Host Feature */
+#define HCI_LE_FEATURE_ISO_HOST_SUPPORT_BIT 32
+
 /*
  *   Local Supported Commands encoding
 */
@@ -3012,6 +3069,12 @@ typedef struct {
   ((x)[HCI_SUPP_COMMANDS_READ_LOCAL_CODECS_OFF] & \
    HCI_SUPP_COMMANDS_READ_LOCAL_CODECS_MASK)
 
+#define HCI_SUPP_COMMANDS_BLE_READ_BUFFER_SIZE_V2_MASK 0x20
+#define HCI_SUPP_COMMANDS_BLE_READ_BUFFER_SIZE_V2_OFF 41
+#define HCI_BLE_READ_BUFFER_SIZE_V2_SUPPORTED(x)        \
+  ((x)[HCI_SUPP_COMMANDS_BLE_READ_BUFFER_SIZE_V2_OFF] & \
+   HCI_SUPP_COMMANDS_BLE_READ_BUFFER_SIZE_V2_MASK)
+
 #define HCI_SUPP_COMMANDS_SET_MWS_CHANN_PARAM_MASK 0x40
 #define HCI_SUPP_COMMANDS_SET_MWS_CHANN_PARAM_OFF 29
 #define HCI_SET_MWS_CHANNEL_PARAMETERS_SUPPORTED(x) \
@@ -21,6 +21,7 @@
 
 #include "bt_target.h"
 #include "bt_types.h"
+#include "buffer_allocator.h"
 #include "device/include/esco_parameters.h"
 #include "hcidefs.h"
 
@@ -28,6 +29,12 @@
 
 void bte_main_hci_send(BT_HDR* p_msg, uint16_t event);
 
+/* Returns a buffer of HCI_CMD_BUF_SIZE octets for an HCI command, from the
+ * pool of HCI command buffers while it has some left. It is freed with
+ * osi_free like the other buffers. */
+#define HCI_GET_CMD_BUF() \
+  ((BT_HDR*)buffer_allocator_get_command_interface()->alloc(HCI_CMD_BUF_SIZE))
+
 /* Message by message.... */
 
 extern void btsnd_hcic_inquiry(const LAP inq_lap, uint8_t duration,
@@ -602,6 +609,8 @@ extern void btsnd_hcic_write_cur_iac_lap(
 
 extern void btsnd_hcic_get_link_quality(uint16_t handle); /* Get Link Quality */
 extern void btsnd_hcic_read_rssi(uint16_t handle);        /* Read RSSI */
+/* Read Failed Contact Counter */
+extern void btsnd_hcic_read_failed_contact_counter(uint16_t handle);
 extern void btsnd_hcic_enable_test_mode(
     void); /* Enable Device Under Test Mode */
 extern void btsnd_hcic_write_pagescan_type(
@@ -807,6 +816,11 @@ extern void btsnd_hcic_ble_set_data_length(uint16_t conn_handle,
                                            uint16_t tx_octets,
                                            uint16_t tx_time);
 
+#define HCIC_PARAM_SIZE_BLE_SET_PHY 7
+extern void btsnd_hcic_ble_set_phy(uint16_t conn_handle, uint8_t all_phys,
+                                   uint8_t tx_phys, uint8_t rx_phys,
+                                   uint16_t phy_options);
+
 extern void btsnd_hcic_ble_add_device_resolving_list(
     uint8_t addr_type_peer, BD_ADDR bda_peer,
     uint8_t irk_peer[HCIC_BLE_IRK_SIZE], uint8_t irk_local[HCIC_BLE_IRK_SIZE]);
@@ -865,6 +879,61 @@ extern void btsnd_hcic_ble_set_addr_resolution_enable(
 
 extern void btsnd_hcic_ble_set_rand_priv_addr_timeout(uint16_t rpa_timout);
 
+/* LE Isochronous Channels. |cb| gets the return parameters of the command
+ * complete event, or the status of a command status event reporting an
+ * error. */
+struct CIS_CFG {
+  uint8_t cis_id;
+  uint16_t max_sdu_size_mtos;
+  uint16_t max_sdu_size_stom;
+  uint8_t phy_mtos;
+  uint8_t phy_stom;
+  uint8_t rtn_mtos;
+  uint8_t rtn_stom;
+};
+
+extern void btsnd_hcic_ble_set_cig_params(
+    uint8_t cig_id, uint32_t sdu_itv_mtos, uint32_t sdu_itv_stom, uint8_t sca,
+    uint8_t packing, uint8_t framing, uint16_t max_trans_lat_mtos,
+    uint16_t max_trans_lat_stom, uint8_t cis_cnt, const CIS_CFG* cis_cfg,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_create_cis(
+    uint8_t num_cis, const uint16_t* cis_handles, const uint16_t* acl_handles,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_remove_cig(
+    uint8_t cig_id, base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_accept_cis_req(
+    uint16_t cis_handle, base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_reject_cis_req(
+    uint16_t cis_handle, uint8_t reason,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
+#define HCIC_BLE_ISO_BCST_CODE_SIZE 16
+
+extern void btsnd_hcic_ble_create_big(
+    uint8_t big_handle, uint8_t adv_handle, uint8_t num_bis,
+    uint32_t sdu_itv, uint16_t max_sdu_size, uint16_t max_trans_lat,
+    uint8_t rtn, uint8_t phy, uint8_t packing, uint8_t framing, uint8_t enc,
+    const uint8_t* bcst_code, base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_term_big(
+    uint8_t big_handle, uint8_t reason,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_setup_iso_data_path(
+    uint16_t iso_handle, uint8_t data_path_dir, uint8_t data_path_id,
+    uint8_t codec_id_format, uint16_t codec_id_company,
+    uint16_t codec_id_vendor, uint32_t controller_delay,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
+extern void btsnd_hcic_ble_remove_iso_data_path(
+    uint16_t iso_handle, uint8_t data_path_dir,
+    base::Callback<void(uint8_t*, uint16_t)> cb);
+
 extern void btsnd_hcic_read_authenticated_payload_tout(uint16_t handle);
 
 extern void btsnd_hcic_write_authenticated_payload_tout(uint16_t handle,
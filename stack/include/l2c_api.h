@@ -1220,6 +1220,18 @@ extern bool L2CA_EnableUpdateBleConnParams(BD_ADDR rem_bda, bool enable);
  ******************************************************************************/
 extern uint8_t L2CA_GetBleConnRole(BD_ADDR bd_addr);
 
+/*******************************************************************************
+ *
+ * Function         L2CA_GetBleTxDataLength
+ *
+ * Description      This function returns the length of the data PDUs sent on
+ *                  an LE link.
+ *
+ * Returns          data length in octets, or 0 if the link is not found.
+ *
+ ******************************************************************************/
+extern uint16_t L2CA_GetBleTxDataLength(BD_ADDR bd_addr);
+
 /*******************************************************************************
  *
  * Function         L2CA_GetDisconnectReason
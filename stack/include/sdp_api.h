@@ -71,6 +71,11 @@
 typedef void(tSDP_DISC_CMPL_CB)(uint16_t result);
 typedef void(tSDP_DISC_CMPL_CB2)(uint16_t result, void* user_data);
 
+/* Gives the cached responses of a device, serialized, each time they change.
+ * |data_len| is 0 if none is left. */
+typedef void(tSDP_CACHE_CBACK)(BD_ADDR bd_addr, uint8_t* p_data,
+                               uint16_t data_len);
+
 typedef struct {
   BD_ADDR peer_addr;
   uint16_t peer_mtu;
@@ -115,6 +120,11 @@ typedef struct t_sdp_disc_rec {
   BD_ADDR remote_bd_addr;            /* Remote BD address            */
 } tSDP_DISC_REC;
 
+/* A chunk of memory a growable discovery database took */
+typedef struct t_sdp_db_chunk {
+  struct t_sdp_db_chunk* p_next; /* Next chunk of the DB        */
+} tSDP_DB_CHUNK;
+
 typedef struct {
   uint32_t mem_size;          /* Memory size of the DB        */
   uint32_t mem_free;          /* Memory still available       */
@@ -123,7 +133,9 @@ typedef struct {
   tSDP_UUID uuid_filters[SDP_MAX_UUID_FILTERS]; /* UUIDs to filter      */
   uint16_t num_attr_filters; /* Number of attribute filters  */
   uint16_t attr_filters[SDP_MAX_ATTR_FILTERS]; /* Attributes to filter */
-  uint8_t* p_free_mem; /* Pointer to free memory       */
+  uint8_t* p_free_mem;     /* Pointer to free memory       */
+  bool growable;           /* Takes new chunks when full   */
+  tSDP_DB_CHUNK* p_chunks; /* Chunks taken, newest first   */
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   uint8_t*
       raw_data; /* Received record from server. allocated/released by client  */
@@ -179,6 +191,36 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
                          uint16_t num_uuid, tSDP_UUID* p_uuid_list,
                          uint16_t num_attr, uint16_t* p_attr_list);
 
+/*******************************************************************************
+ *
+ * Function         SDP_AllocDiscoveryDb
+ *
+ * Description      This function allocates and initializes a discovery
+ *                  database that grows by chunks of SDP_DB_CHUNK_SIZE bytes
+ *                  as the records are saved, rather than being truncated.
+ *                  It is freed with SDP_FreeDiscoveryDb, and must not be
+ *                  initialized again with SDP_InitDiscoveryDb.
+ *
+ * Returns          the database, or NULL if one or more parameters are bad
+ *
+ ******************************************************************************/
+tSDP_DISCOVERY_DB* SDP_AllocDiscoveryDb(uint16_t num_uuid,
+                                        tSDP_UUID* p_uuid_list,
+                                        uint16_t num_attr,
+                                        uint16_t* p_attr_list);
+
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees a discovery database allocated by
+ *                  SDP_AllocDiscoveryDb, with all the chunks it took.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db);
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
@@ -637,6 +679,43 @@ uint8_t SDP_SetTraceLevel(uint8_t new_level);
  ******************************************************************************/
 bool SDP_FindServiceUUIDInRec(tSDP_DISC_REC* p_rec, tBT_UUID* p_uuid);
 
+/*******************************************************************************
+ *
+ * Function         SDP_SetCacheCallback
+ *
+ * Description      This function registers the callback given the cached
+ *                  service search attribute responses of a device each time
+ *                  they change, to persist them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_SetCacheCallback(tSDP_CACHE_CBACK* p_cb);
+
+/*******************************************************************************
+ *
+ * Function         SDP_LoadCache
+ *
+ * Description      This function replaces the cached responses of a device
+ *                  with the ones given, as persisted from the cache callback.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_LoadCache(BD_ADDR bd_addr, uint8_t* p_data, uint16_t data_len);
+
+/*******************************************************************************
+ *
+ * Function         SDP_InvalidateCache
+ *
+ * Description      This function drops the cached responses of a device, so
+ *                  that its services are searched again.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_InvalidateCache(BD_ADDR bd_addr);
+
 // Converts UUID-16 to UUID-128 by including the base UUID.
 // |uuid16| is the 2-byte UUID to convert.
 // The result with the expanded 128-bit UUID is stored in |p_uuid128|.
@@ -219,6 +219,26 @@ extern void SMP_KeypressNotification(BD_ADDR bd_addr, uint8_t value);
 extern bool SMP_CreateLocalSecureConnectionsOobData(
     tBLE_BD_ADDR* addr_to_send_to);
 
+/*******************************************************************************
+ *
+ * Function         SMP_FillKeyPairPool
+ *
+ * Description      This function starts generating the LE Secure Connections
+ *                  key pairs used by the next pairings, once the controller
+ *                  is ready.
+ *
+ ******************************************************************************/
+extern void SMP_FillKeyPairPool(void);
+
+/*******************************************************************************
+ *
+ * Function         SMP_DumpKeyPairPool
+ *
+ * Description      This function dumps the state of the key pair pool to |fd|.
+ *
+ ******************************************************************************/
+extern void SMP_DumpKeyPairPool(int fd);
+
 // Called when LTK request is received from controller.
 extern bool smp_proc_ltk_request(BD_ADDR bda);
 
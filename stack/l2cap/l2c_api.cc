@@ -39,6 +39,7 @@
 #include "l2c_int.h"
 #include "l2cdefs.h"
 #include "osi/include/allocator.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/log.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
@@ -628,7 +629,8 @@ bool L2CA_SetConnectionCallbacks(uint16_t local_cid,
   // from the old control block.
   tL2C_RCB* registration_control_block = channel_control_block->p_rcb;
   if (!channel_control_block->should_free_rcb) {
-    registration_control_block = (tL2C_RCB*)osi_calloc(sizeof(tL2C_RCB));
+    registration_control_block = (tL2C_RCB*)osi_calloc_tagged(
+        sizeof(tL2C_RCB), OSI_MEM_L2CAP);
 
     *registration_control_block = *channel_control_block->p_rcb;
     channel_control_block->p_rcb = registration_control_block;
@@ -1195,7 +1197,7 @@ uint16_t L2CA_LocalLoopbackReq(uint16_t psm, uint16_t handle,
   }
 
   p_lcb->link_state = LST_CONNECTED;
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Allocate a channel control block */
   p_ccb = l2cu_allocate_ccb(p_lcb, 0);
@@ -1737,6 +1739,8 @@ uint16_t L2CA_SendFixedChnlData(uint16_t fixed_cid, BD_ADDR rem_bda,
   if (fixed_cid >= L2CAP_ATT_CID && fixed_cid <= L2CAP_SMP_CID)
     transport = BT_TRANSPORT_LE;
 
+  FLOW_TRACE(FLOW_TRACE_L2CAP, p_buf, "L2CAP fixed channel tx");
+
   // Check CID is valid and registered
   if ((fixed_cid < L2CAP_FIRST_FIXED_CHNL) ||
       (fixed_cid > L2CAP_LAST_FIXED_CHNL) ||
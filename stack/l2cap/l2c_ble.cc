@@ -32,11 +32,16 @@
 #include "l2c_int.h"
 #include "l2cdefs.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "stack_config.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
 static void l2cble_start_conn_update(tL2C_LCB* p_lcb);
+#if (L2CAP_BLE_BULK_OCTETS_PER_SEC > 0)
+static void l2cble_traffic_timer_timeout(void* data);
+static void l2cble_set_bulk(tL2C_LCB* p_lcb, bool bulk);
+#endif
 
 /*******************************************************************************
  *
@@ -125,6 +130,16 @@ bool L2CA_UpdateBleConnParams(BD_ADDR rem_bda, uint16_t min_int,
     return (false);
   }
 
+  /* While the link carries bulk traffic, the parameters are only applied once
+   * it stops */
+  if (p_lcb->ble_traffic.params_saved) {
+    p_lcb->ble_traffic.min_interval = min_int;
+    p_lcb->ble_traffic.max_interval = max_int;
+    p_lcb->ble_traffic.latency = latency;
+    p_lcb->ble_traffic.timeout = timeout;
+    return (true);
+  }
+
   p_lcb->min_interval = min_int;
   p_lcb->max_interval = max_int;
   p_lcb->latency = latency;
@@ -207,6 +222,23 @@ uint8_t L2CA_GetBleConnRole(BD_ADDR bd_addr) {
 
   return role;
 }
+
+/*******************************************************************************
+ *
+ * Function         L2CA_GetBleTxDataLength
+ *
+ * Description      This function returns the length of the data PDUs sent on
+ *                  an LE link.
+ *
+ * Returns          data length in octets, or 0 if the link is not found.
+ *
+ ******************************************************************************/
+uint16_t L2CA_GetBleTxDataLength(BD_ADDR bd_addr) {
+  tL2C_LCB* p_lcb = l2cu_find_lcb_by_bd_addr(bd_addr, BT_TRANSPORT_LE);
+  if (p_lcb == NULL) return 0;
+
+  return p_lcb->tx_data_len;
+}
 /*******************************************************************************
  *
  * Function         L2CA_GetDisconnectReason
@@ -311,7 +343,7 @@ void l2cble_scanner_conn_comp(uint16_t handle, BD_ADDR bda, tBLE_ADDR_TYPE type,
   alarm_cancel(p_lcb->l2c_lcb_timer);
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Connected OK. Change state to connected, we were scanning so we are master
    */
@@ -323,6 +355,7 @@ void l2cble_scanner_conn_comp(uint16_t handle, BD_ADDR bda, tBLE_ADDR_TYPE type,
   p_lcb->timeout = conn_timeout;
   p_lcb->latency = conn_latency;
   p_lcb->conn_update_mask = L2C_BLE_NOT_DEFAULT_PARAM;
+  p_lcb->ble_traffic.conn_ms = time_get_os_boottime_ms();
 
   /* Tell BTM Acl management about the link */
   btm_acl_created(bda, NULL, p_dev_rec->sec_bd_name, handle, p_lcb->link_role,
@@ -381,7 +414,7 @@ void l2cble_advertiser_conn_comp(uint16_t handle, BD_ADDR bda,
   }
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   /* Connected OK. Change state to connected, we were advertising, so we are
    * slave */
@@ -393,6 +426,7 @@ void l2cble_advertiser_conn_comp(uint16_t handle, BD_ADDR bda,
   p_lcb->timeout = conn_timeout;
   p_lcb->latency = conn_latency;
   p_lcb->conn_update_mask = L2C_BLE_NOT_DEFAULT_PARAM;
+  p_lcb->ble_traffic.conn_ms = time_get_os_boottime_ms();
 
   /* Tell BTM Acl management about the link */
   p_dev_rec = btm_find_or_alloc_dev(bda);
@@ -716,9 +750,10 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
       p_ccb->peer_conn_cfg.mps = mps;
       p_ccb->peer_conn_cfg.credits = initial_credit;
 
-      p_ccb->tx_mps = mps;
+      l2cu_adjust_le_out_mps(p_ccb);
       p_ccb->ble_sdu = NULL;
       p_ccb->ble_sdu_length = 0;
+      p_ccb->ble_rx_credits_used = 0;
       p_ccb->is_first_seg = true;
       p_ccb->peer_cfg.fcr.mode = L2CAP_FCR_LE_COC_MODE;
 
@@ -764,9 +799,10 @@ void l2cble_process_sig_cmd(tL2C_LCB* p_lcb, uint8_t* p, uint16_t pkt_len) {
           break;
         }
 
-        p_ccb->tx_mps = p_ccb->peer_conn_cfg.mps;
+        l2cu_adjust_le_out_mps(p_ccb);
         p_ccb->ble_sdu = NULL;
         p_ccb->ble_sdu_length = 0;
+        p_ccb->ble_rx_credits_used = 0;
         p_ccb->is_first_seg = true;
         p_ccb->peer_cfg.fcr.mode = L2CAP_FCR_LE_COC_MODE;
 
@@ -1159,8 +1195,9 @@ void l2cble_update_data_length(tL2C_LCB* p_lcb) {
 
   if (tx_mtu > BTM_BLE_DATA_SIZE_MAX) tx_mtu = BTM_BLE_DATA_SIZE_MAX;
 
-  /* update TX data length if changed */
-  if (p_lcb->tx_data_len != tx_mtu)
+  /* update TX data length if longer: it may have been raised already, on
+   * connection or for bulk traffic */
+  if (p_lcb->tx_data_len < tx_mtu)
     BTM_SetBleDataLength(p_lcb->remote_bd_addr, tx_mtu);
 }
 
@@ -1416,7 +1453,8 @@ bool l2ble_sec_access_req(BD_ADDR bd_addr, uint16_t psm, bool is_originator,
   }
 
   tL2CAP_SEC_DATA* p_buf =
-      (tL2CAP_SEC_DATA*)osi_malloc((uint16_t)sizeof(tL2CAP_SEC_DATA));
+      (tL2CAP_SEC_DATA*)osi_malloc_tagged(
+          (uint16_t)sizeof(tL2CAP_SEC_DATA), OSI_MEM_L2CAP);
   if (!p_buf) {
     p_callback(bd_addr, BT_TRANSPORT_LE, p_ref_data, BTM_NO_RESOURCES);
     return false;
@@ -1432,3 +1470,180 @@ bool l2ble_sec_access_req(BD_ADDR bd_addr, uint16_t psm, bool is_originator,
 
   return status;
 }
+
+/*******************************************************************************
+ *
+ * Function         l2cble_traffic_init
+ *
+ * Description      This function prepares the traffic sampling of a new LE
+ *                  link.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_traffic_init(UNUSED_ATTR tL2C_LCB* p_lcb) {
+#if (L2CAP_BLE_BULK_OCTETS_PER_SEC > 0)
+  p_lcb->ble_traffic.timer = alarm_new("l2c_lcb.ble_traffic_timer");
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_traffic
+ *
+ * Description      This function accounts for the octets sent or received on
+ *                  an LE link, and starts sampling its traffic if it was
+ *                  idle.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_traffic(UNUSED_ATTR tL2C_LCB* p_lcb,
+                    UNUSED_ATTR uint16_t octets) {
+#if (L2CAP_BLE_BULK_OCTETS_PER_SEC > 0)
+  tL2C_BLE_TRAFFIC* p_traffic = &p_lcb->ble_traffic;
+
+  p_traffic->octets += octets;
+  if (!p_traffic->sampling && p_traffic->timer != NULL) {
+    p_traffic->sampling = true;
+    alarm_set_on_queue(p_traffic->timer, L2CAP_BLE_TRAFFIC_SAMPLE_MS,
+                       l2cble_traffic_timer_timeout, p_lcb,
+                       btu_general_alarm_queue);
+  }
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_traffic_release
+ *
+ * Description      This function stops the traffic sampling of an LE link
+ *                  going down, and traces the time it spent bulk.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cble_traffic_release(tL2C_LCB* p_lcb) {
+  tL2C_BLE_TRAFFIC* p_traffic = &p_lcb->ble_traffic;
+
+  alarm_free(p_traffic->timer);
+  p_traffic->timer = NULL;
+  p_traffic->sampling = false;
+
+  if (p_lcb->transport != BT_TRANSPORT_LE || p_traffic->conn_ms == 0) return;
+
+  period_ms_t now_ms = time_get_os_boottime_ms();
+  period_ms_t bulk_ms = p_traffic->bulk_ms;
+  if (p_traffic->bulk) bulk_ms += now_ms - p_traffic->bulk_start_ms;
+
+  L2CAP_TRACE_DEBUG("%s: handle 0x%04x bulk for %llu ms of %llu ms", __func__,
+                    p_lcb->handle, (unsigned long long)bulk_ms,
+                    (unsigned long long)(now_ms - p_traffic->conn_ms));
+}
+
+#if (L2CAP_BLE_BULK_OCTETS_PER_SEC > 0)
+/*******************************************************************************
+ *
+ * Function         l2cble_traffic_timer_timeout
+ *
+ * Description      This function samples the traffic of an LE link, moving it
+ *                  to or from the bulk link parameters.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cble_traffic_timer_timeout(void* data) {
+  tL2C_LCB* p_lcb = (tL2C_LCB*)data;
+  tL2C_BLE_TRAFFIC* p_traffic = &p_lcb->ble_traffic;
+  uint64_t rate =
+      (uint64_t)p_traffic->octets * 1000 / L2CAP_BLE_TRAFFIC_SAMPLE_MS;
+
+  p_traffic->octets = 0;
+  p_traffic->sampling = false;
+
+  if (p_lcb->link_state != LST_CONNECTED) return;
+
+  if (rate >= L2CAP_BLE_BULK_OCTETS_PER_SEC) {
+    p_traffic->idle_samples = 0;
+    if (!p_traffic->bulk) l2cble_set_bulk(p_lcb, true);
+  } else if (p_traffic->bulk &&
+             ++p_traffic->idle_samples >= L2CAP_BLE_BULK_IDLE_SAMPLES) {
+    l2cble_set_bulk(p_lcb, false);
+  }
+
+  /* A bulk link is sampled even without traffic, to notice it stopped */
+  if (p_traffic->bulk) {
+    p_traffic->sampling = true;
+    alarm_set_on_queue(p_traffic->timer, L2CAP_BLE_TRAFFIC_SAMPLE_MS,
+                       l2cble_traffic_timer_timeout, p_lcb,
+                       btu_general_alarm_queue);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         l2cble_set_bulk
+ *
+ * Description      This function moves an LE link to the bulk link
+ *                  parameters, or gives it its connection parameters back.
+ *                  The PHY and the data length are kept once raised, as they
+ *                  carry the same traffic in less air time.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2cble_set_bulk(tL2C_LCB* p_lcb, bool bulk) {
+  tL2C_BLE_TRAFFIC* p_traffic = &p_lcb->ble_traffic;
+  tACL_CONN* p_acl = btm_bda_to_acl(p_lcb->remote_bd_addr, BT_TRANSPORT_LE);
+  const controller_t* controller = controller_get_interface();
+  period_ms_t now_ms = time_get_os_boottime_ms();
+
+  L2CAP_TRACE_DEBUG("%s: handle 0x%04x bulk %d", __func__, p_lcb->handle,
+                    bulk);
+
+  p_traffic->bulk = bulk;
+  p_traffic->idle_samples = 0;
+
+  if (bulk) {
+    p_traffic->bulk_start_ms = now_ms;
+
+    if (p_acl != NULL && controller->supports_ble_2m_phy() &&
+        HCI_LE_2M_PHY_SUPPORTED(p_acl->peer_le_features))
+      BTM_BleSetPhy(p_lcb->remote_bd_addr, PHY_LE_2M, PHY_LE_2M, 0);
+
+    if (p_acl != NULL && controller->supports_ble_packet_extension() &&
+        HCI_LE_DATA_LEN_EXT_SUPPORTED(p_acl->peer_le_features) &&
+        p_lcb->tx_data_len < BTM_BLE_DATA_SIZE_MAX)
+      BTM_SetBleDataLength(p_lcb->remote_bd_addr, BTM_BLE_DATA_SIZE_MAX);
+
+    /* The interval is left alone if the application disabled the updates, or
+     * if it is short enough already */
+    if ((p_lcb->conn_update_mask & L2C_BLE_CONN_UPDATE_DISABLE) ||
+        p_lcb->max_interval <= L2CAP_BLE_BULK_CONN_INT_MAX)
+      return;
+
+    p_traffic->params_saved = true;
+    p_traffic->min_interval = p_lcb->min_interval;
+    p_traffic->max_interval = p_lcb->max_interval;
+    p_traffic->latency = p_lcb->latency;
+    p_traffic->timeout = p_lcb->timeout;
+
+    p_lcb->min_interval = L2CAP_BLE_BULK_CONN_INT_MIN;
+    p_lcb->max_interval = L2CAP_BLE_BULK_CONN_INT_MAX;
+    p_lcb->latency = 0;
+  } else {
+    p_traffic->bulk_ms += now_ms - p_traffic->bulk_start_ms;
+
+    if (!p_traffic->params_saved) return;
+
+    p_traffic->params_saved = false;
+    p_lcb->min_interval = p_traffic->min_interval;
+    p_lcb->max_interval = p_traffic->max_interval;
+    p_lcb->latency = p_traffic->latency;
+    p_lcb->timeout = p_traffic->timeout;
+  }
+
+  p_lcb->conn_update_mask |= L2C_BLE_NEW_CONN_PARAM;
+  l2cble_start_conn_update(p_lcb);
+}
+#endif
@@ -29,6 +29,7 @@
 #include "bt_common.h"
 #include "bt_target.h"
 #include "btm_int.h"
+#include "btsnoop.h"
 #include "btu.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
@@ -57,6 +58,7 @@ static void l2c_csm_w4_l2ca_disconnect_rsp(tL2C_CCB* p_ccb, uint16_t event,
                                            void* p_data);
 
 static const char* l2c_csm_get_event_name(uint16_t event);
+static void l2c_csm_snoop_channel_open(tL2C_CCB* p_ccb);
 
 /*******************************************************************************
  *
@@ -117,6 +119,24 @@ void l2c_csm_execute(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         l2c_csm_snoop_channel_open
+ *
+ * Description      This function registers an opened channel with btsnoop, so
+ *                  that the capture filter rules by PSM apply to it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_csm_snoop_channel_open(tL2C_CCB* p_ccb) {
+  if (p_ccb->p_rcb == NULL) return;
+
+  btsnoop_get_interface()->add_l2c_channel(
+      p_ccb->p_lcb->handle, p_ccb->p_rcb->real_psm, p_ccb->local_cid,
+      p_ccb->remote_cid);
+}
+
 /*******************************************************************************
  *
  * Function         l2c_csm_closed
@@ -831,6 +851,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
           p_ccb->config_done |= RECONFIG_FLAG;
           p_ccb->chnl_state = CST_OPEN;
           l2c_link_adjust_chnl_allocation();
+          l2c_csm_snoop_channel_open(p_ccb);
           alarm_cancel(p_ccb->l2c_ccb_timer);
 
           /* If using eRTM and waiting for an ACK, restart the ACK timer */
@@ -928,6 +949,7 @@ static void l2c_csm_config(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {
         p_ccb->config_done |= RECONFIG_FLAG;
         p_ccb->chnl_state = CST_OPEN;
         l2c_link_adjust_chnl_allocation();
+        l2c_csm_snoop_channel_open(p_ccb);
         alarm_cancel(p_ccb->l2c_ccb_timer);
       }
 
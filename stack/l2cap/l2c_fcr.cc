@@ -37,6 +37,7 @@
 #include "l2c_api.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
+#include "osi/include/flow_trace.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
@@ -92,6 +93,8 @@ static void process_s_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word);
 static void process_i_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word,
                             bool delay_ack);
 static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq);
+static void send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
+                         uint16_t pf_bit, uint8_t req_seq);
 static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                             bool is_retransmission);
 static void process_stream_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf);
@@ -102,21 +105,64 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 #endif
 
+/*******************************************************************************
+ *
+ * Function         l2c_fcr_get_crc_tables
+ *
+ * Description      This function returns the look-up tables for computing
+ *                  the CRC eight octets at a time. Entry [k][i] is the CRC
+ *                  of octet i followed by k zero octets, so that the first
+ *                  table is |crctab|.
+ *
+ * Returns          The tables, built on the first call
+ *
+ ******************************************************************************/
+namespace {
+struct tL2C_FCR_CRC_TABLES {
+  uint16_t t[8][256];
+
+  tL2C_FCR_CRC_TABLES() {
+    for (int i = 0; i < 256; i++) t[0][i] = crctab[i];
+    for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++)
+        t[k][i] = (t[k - 1][i] >> 8) ^ crctab[t[k - 1][i] & 0xff];
+    }
+  }
+};
+}  // namespace
+
+static const tL2C_FCR_CRC_TABLES& l2c_fcr_get_crc_tables(void) {
+  static const tL2C_FCR_CRC_TABLES tables;
+  return tables;
+}
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_updcrc
  *
- * Description      This function computes the CRC using the look-up table.
+ * Description      This function computes the CRC using the look-up tables.
+ *                  The bulk of the frame is processed eight octets at a
+ *                  time, and the remaining octets one at a time.
  *
  * Returns          CRC
  *
  ******************************************************************************/
 static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
                                      int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
+  const tL2C_FCR_CRC_TABLES& tables = l2c_fcr_get_crc_tables();
+  uint16_t crc = icrc;
+  const uint8_t* cp = icp;
   int cnt = icnt;
 
+  while (cnt >= 8) {
+    crc ^= cp[0] | (cp[1] << 8);
+    crc = tables.t[7][crc & 0xff] ^ tables.t[6][crc >> 8] ^
+          tables.t[5][cp[2]] ^ tables.t[4][cp[3]] ^ tables.t[3][cp[4]] ^
+          tables.t[2][cp[5]] ^ tables.t[1][cp[6]] ^ tables.t[0][cp[7]];
+    cp += 8;
+    cnt -= 8;
+  }
+
   while (cnt--) {
     crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
   }
@@ -234,7 +280,7 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
       (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE)) {
     uint32_t dur = time_get_os_boottime_ms() - p_ccb->fcrb.connect_tick_count;
     size_t p_str_size = 120;
-    char* p_str = (char*)osi_malloc(p_str_size);
+    char* p_str = (char*)osi_malloc_tagged(p_str_size, OSI_MEM_L2CAP);
     uint16_t i;
     uint32_t throughput_avg, ack_delay_avg, ack_q_count_avg;
 
@@ -244,10 +290,11 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
              p_ccb->local_cid, dur);
     BT_TRACE(TRACE_CTRL_GENERAL | TRACE_LAYER_GKI | TRACE_ORG_GKI,
              TRACE_TYPE_GENERIC,
-             "Retransmissions:%08u Times Flow Controlled:%08u Retrans "
-             "Touts:%08u Ack Touts:%08u",
-             p_ccb->fcrb.pkts_retransmitted, p_ccb->fcrb.xmit_window_closed,
-             p_ccb->fcrb.retrans_touts, p_ccb->fcrb.xmit_ack_touts);
+             "Retransmissions:%08u Bytes:%08u Times Flow Controlled:%08u "
+             "Retrans Touts:%08u Ack Touts:%08u",
+             p_ccb->fcrb.pkts_retransmitted, p_ccb->fcrb.bytes_retransmitted,
+             p_ccb->fcrb.xmit_window_closed, p_ccb->fcrb.retrans_touts,
+             p_ccb->fcrb.xmit_ack_touts);
     BT_TRACE(TRACE_CTRL_GENERAL | TRACE_LAYER_GKI | TRACE_ORG_GKI,
              TRACE_TYPE_GENERIC,
              "Times there is less than 2 packets in controller when flow "
@@ -354,10 +401,11 @@ BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
    */
   buf_size += sizeof(uint32_t);
 #endif
-  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc(buf_size);
+  BT_HDR* p_buf2 = (BT_HDR*)osi_malloc_tagged(buf_size, OSI_MEM_L2CAP);
 
   p_buf2->offset = new_offset;
   p_buf2->len = no_of_bytes;
+  FLOW_TRACE_COPY(p_buf2, p_buf);
   memcpy(((uint8_t*)(p_buf2 + 1)) + p_buf2->offset,
          ((uint8_t*)(p_buf + 1)) + p_buf->offset, no_of_bytes);
 
@@ -507,6 +555,22 @@ static void prepare_I_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
                           uint16_t pf_bit) {
   CHECK(p_ccb != NULL);
+  send_S_frame(p_ccb, function_code, pf_bit, p_ccb->fcrb.next_seq_expected);
+}
+
+/*******************************************************************************
+ *
+ * Function         send_S_frame
+ *
+ * Description      This function formats and sends an S-frame with the
+ *                  given receive sequence number, e.g. a Selective Reject of
+ *                  a frame after the next one expected.
+ *
+ * Returns          -
+ *
+ ******************************************************************************/
+static void send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
+                         uint16_t pf_bit, uint8_t req_seq) {
   uint8_t* p;
   uint16_t ctrl_word;
   uint16_t fcs;
@@ -526,10 +590,10 @@ void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
 
   /* Create the control word to use */
   ctrl_word = (function_code << L2CAP_FCR_SUP_SHIFT) | L2CAP_FCR_S_FRAME_BIT;
-  ctrl_word |= (p_ccb->fcrb.next_seq_expected << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
+  ctrl_word |= (req_seq << L2CAP_FCR_REQ_SEQ_BITS_SHIFT);
   ctrl_word |= pf_bit;
 
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(L2CAP_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(L2CAP_CMD_BUF_SIZE, OSI_MEM_L2CAP);
   p_buf->offset = HCI_DATA_PREAMBLE_SIZE;
   p_buf->len = L2CAP_PKT_OVERHEAD + L2CAP_FCR_OVERHEAD;
 
@@ -844,7 +908,7 @@ void l2c_lcc_proc_pdu(tL2C_CCB* p_ccb, BT_HDR* p_buf) {
       return;
     }
 
-    p_data = (BT_HDR*)osi_malloc(L2CAP_MAX_BUF_SIZE);
+    p_data = (BT_HDR*)osi_malloc_tagged(L2CAP_MAX_BUF_SIZE, OSI_MEM_L2CAP);
     if (p_data == NULL) {
       osi_free(p_buf);
       return;
@@ -1245,8 +1309,10 @@ static void process_i_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word,
             p_ccb->local_cid, tx_seq, p_fcrb->next_seq_expected,
             p_fcrb->rej_sent);
 
-        /* If only one lost, we will send SREJ, otherwise we will send REJ */
-        if (num_lost > 1) {
+        /* If only a few were lost, we will send an SREJ for each of them,
+         * otherwise we will send REJ */
+        if ((num_lost > L2CAP_FCR_MAX_SREJ_FRAMES) ||
+            (num_lost >= p_ccb->our_cfg.fcr.tx_win_sz)) {
           osi_free(p_buf);
           p_fcrb->rej_sent = true;
           l2c_fcr_send_S_frame(p_ccb, L2CAP_FCR_SUP_REJ, 0);
@@ -1261,7 +1327,15 @@ static void process_i_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word,
           p_buf->layer_specific = tx_seq;
           fixed_queue_enqueue(p_fcrb->srej_rcv_hold_q, p_buf);
           p_fcrb->srej_sent = true;
-          l2c_fcr_send_S_frame(p_ccb, L2CAP_FCR_SUP_SREJ, 0);
+          p_fcrb->srej_count = num_lost;
+
+          /* The lost frames are the ones from the next expected on, and
+           * are retransmitted in order */
+          for (uint8_t xx = 0; xx < num_lost; xx++) {
+            send_S_frame(
+                p_ccb, L2CAP_FCR_SUP_SREJ, 0,
+                (p_fcrb->next_seq_expected + xx) & L2CAP_FCR_SEQ_MODULO);
+          }
         }
         alarm_cancel(p_ccb->fcrb.ack_timer);
       }
@@ -1270,8 +1344,14 @@ static void process_i_frame(tL2C_CCB* p_ccb, BT_HDR* p_buf, uint16_t ctrl_word,
   }
 
   /* Seq number is the next expected. Clear possible reject exception in case it
-   * occured */
-  p_fcrb->rej_sent = p_fcrb->srej_sent = false;
+   * occured, unless more selectively rejected frames are still missing */
+  p_fcrb->rej_sent = false;
+  if (p_fcrb->srej_count > 1) {
+    p_fcrb->srej_count--;
+  } else {
+    p_fcrb->srej_sent = false;
+    p_fcrb->srej_count = 0;
+  }
 
   /* Adjust the next_seq, so that if the upper layer sends more data in the
      callback
@@ -1457,7 +1537,8 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
                             p_fcrb->rx_sdu_len, p_fcrb->rx_sdu_len);
         packet_ok = false;
       } else {
-        p_fcrb->p_rx_sdu = (BT_HDR*)osi_malloc(L2CAP_MAX_BUF_SIZE);
+        p_fcrb->p_rx_sdu = (BT_HDR*)osi_malloc_tagged(
+            L2CAP_MAX_BUF_SIZE, OSI_MEM_L2CAP);
         p_fcrb->p_rx_sdu->offset = OBX_BUF_MIN_OFFSET;
         p_fcrb->p_rx_sdu->len = 0;
       }
@@ -1529,6 +1610,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
   uint8_t* p;
   uint8_t buf_seq;
   uint16_t ctrl_word;
+  bool count_try = true;
 
   if ((!fixed_queue_is_empty(p_ccb->fcrb.waiting_for_ack_q)) &&
       (p_ccb->peer_cfg.fcr.max_transmit != 0) &&
@@ -1580,6 +1662,10 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
                         fixed_queue_length(p_ccb->fcrb.waiting_for_ack_q));
       return (true);
     }
+
+    /* The frames after the oldest one are retransmitted when several were
+     * selectively rejected at once, they do not count as another try */
+    count_try = (list_ack != NULL) && (node_ack == list_begin(list_ack));
   } else {
     // Iterate though list and flush the amount requested from
     // the transmit data queue that satisfy the layer and event conditions.
@@ -1621,7 +1707,7 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
   l2c_link_check_send_pkts(p_ccb->p_lcb, NULL, NULL);
 
   if (fixed_queue_length(p_ccb->fcrb.waiting_for_ack_q)) {
-    p_ccb->fcrb.num_tries++;
+    if (count_try) p_ccb->fcrb.num_tries++;
     l2c_fcr_start_timer(p_ccb);
   }
 
@@ -1661,6 +1747,7 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
 
 #if (L2CAP_ERTM_STATS == TRUE)
     p_ccb->fcrb.pkts_retransmitted++;
+    p_ccb->fcrb.bytes_retransmitted += (p_buf->len - 8);
     p_ccb->fcrb.ertm_pkt_counts[0]++;
     p_ccb->fcrb.ertm_byte_counts[0] += (p_buf->len - 8);
 #endif
@@ -1812,7 +1899,7 @@ BT_HDR* l2c_lcc_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   uint16_t sdu_len = 0;
   BT_HDR *p_buf, *p_xmit;
   uint8_t* p;
-  uint16_t max_pdu = p_ccb->peer_conn_cfg.mps;
+  uint16_t max_pdu = p_ccb->tx_mps;
 
   p_buf = (BT_HDR*)fixed_queue_try_peek_first(p_ccb->xmit_hold_q);
 
@@ -64,6 +64,10 @@
 #define L2CAP_BLE_LINK_CONNECT_TIMEOUT_MS (30 * 1000)  /* 30 seconds */
 #define L2CAP_FCR_ACK_TIMEOUT_MS 200                   /* 200 milliseconds */
 
+/* The most I-frames lost in a row that are recovered with one Selective
+ * Reject each, instead of a Reject of every frame after the first lost */
+#define L2CAP_FCR_MAX_SREJ_FRAMES 8
+
 /* Define the possible L2CAP channel states. The names of
  * the states may seem a bit strange, but they are taken from
  * the Bluetooth specification.
@@ -181,6 +185,7 @@ typedef struct {
 
   bool rej_sent;       /* Reject was sent */
   bool srej_sent;      /* Selective Reject was sent */
+  uint8_t srej_count;  /* Frames selectively rejected, not yet received */
   bool wait_ack;       /* Transmitter is waiting ack (poll sent) */
   bool rej_after_srej; /* Send a REJ when SREJ clears */
 
@@ -206,6 +211,7 @@ typedef struct {
   uint32_t controller_idle; /* # of times less than 2 packets in controller */
                             /* when the xmit window was closed */
   uint32_t pkts_retransmitted; /* # of packets that were retransmitted */
+  uint32_t bytes_retransmitted; /* # of bytes that were retransmitted */
   uint32_t retrans_touts;      /* # of retransmission timouts */
   uint32_t xmit_ack_touts;     /* # of xmit ack timouts */
 
@@ -283,6 +289,7 @@ typedef struct t_l2c_ccb {
                               segment or not */
   BT_HDR* ble_sdu;         /* Buffer for storing unassembled sdu*/
   uint16_t ble_sdu_length; /* Length of unassembled sdu length*/
+  uint16_t ble_rx_credits_used; /* Credits used by the peer, not returned */
   struct t_l2c_ccb* p_next_ccb; /* Next CCB in the chain */
   struct t_l2c_ccb* p_prev_ccb; /* Previous CCB in the chain */
   struct t_l2c_linkcb* p_lcb;   /* Link this CCB is assigned to */
@@ -378,6 +385,27 @@ typedef struct {
 
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+/* The traffic sampled on an LE link, to move it to the bulk link parameters
+ * while it carries more than L2CAP_BLE_BULK_OCTETS_PER_SEC.
+*/
+typedef struct {
+  alarm_t* timer;       /* Sampling timer, running while the link is busy */
+  bool sampling;        /* true while the timer runs */
+  uint32_t octets;      /* Octets carried since the last sample */
+  bool bulk;            /* true while the bulk link parameters are used */
+  uint8_t idle_samples; /* Samples below the bulk rate in a row, while bulk */
+
+  bool params_saved; /* The connection parameters the bulk ones replaced */
+  uint16_t min_interval;
+  uint16_t max_interval;
+  uint16_t latency;
+  uint16_t timeout;
+
+  period_ms_t conn_ms;       /* When the link came up */
+  period_ms_t bulk_start_ms; /* When the link last became bulk */
+  period_ms_t bulk_ms;       /* Total time spent bulk, before bulk_start_ms */
+} tL2C_BLE_TRAFFIC;
+
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
 */
@@ -385,6 +413,10 @@ typedef struct t_l2c_linkcb {
   bool in_use; /* true when in use, false when not */
   tL2C_LINK_STATE link_state;
 
+  /* Next LCBs in the buckets of l2cb.p_lcb_by_addr and l2cb.p_lcb_by_handle */
+  struct t_l2c_linkcb* p_next_addr_lcb;
+  struct t_l2c_linkcb* p_next_handle_lcb;
+
   alarm_t* l2c_lcb_timer; /* Timer entry for timeout evt */
   uint16_t handle;        /* The handle used with LM */
 
@@ -406,6 +438,12 @@ typedef struct t_l2c_linkcb {
   uint16_t link_xmit_quota; /* Num outstanding pkts allowed */
   uint16_t sent_not_acked;  /* Num packets sent but not acked */
 
+  /* ACL transmit counters, read by the A2DP throughput policy of BTM */
+  uint32_t acl_sent_pkts;      /* Num packets sent to the controller */
+  uint64_t acl_sent_bytes;     /* Octets of payload they carried */
+  uint32_t acl_completed_pkts; /* Num packets completed by the controller */
+  uint32_t acl_blocked_pkts;   /* Num completed while the quota was used up */
+
   bool partial_segment_being_sent; /* Set true when a partial segment */
                                    /* is being sent. */
   bool w4_info_rsp;                /* true when info request is active */
@@ -454,6 +492,8 @@ typedef struct t_l2c_linkcb {
   uint16_t latency;
   uint16_t timeout;
 
+  tL2C_BLE_TRAFFIC ble_traffic;
+
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
   /* each priority group is limited burst transmission */
   /* round robin service for the same priority channels */
@@ -476,12 +516,18 @@ typedef struct {
   bool is_cong_cback_context;
 
   tL2C_LCB lcb_pool[MAX_L2CAP_LINKS];    /* Link Control Block pool */
-  tL2C_CCB ccb_pool[MAX_L2CAP_CHANNELS]; /* Channel Control Block pool */
+  tL2C_CCB* ccb_pool;                    /* Channel Control Block pool */
+  uint16_t num_ccb;                      /* Number of CCBs in the pool */
   tL2C_RCB rcb_pool[MAX_L2CAP_CLIENTS];  /* Registration info pool */
 
   tL2C_CCB* p_free_ccb_first; /* Pointer to first free CCB */
   tL2C_CCB* p_free_ccb_last;  /* Pointer to last  free CCB */
 
+  /* The in use LCBs, hashed by address and by handle. The handle of an LCB is
+   * set through l2cu_set_lcb_handle() to keep it hashed. */
+  tL2C_LCB* p_lcb_by_addr[L2CAP_LCB_HASH_SIZE];
+  tL2C_LCB* p_lcb_by_handle[L2CAP_LCB_HASH_SIZE];
+
   uint8_t
       desire_role; /* desire to be master/slave when accepting a connection */
   bool disallow_switch;     /* false, to allow switch at create conn */
@@ -587,6 +633,7 @@ extern void l2cu_release_lcb(tL2C_LCB* p_lcb);
 extern tL2C_LCB* l2cu_find_lcb_by_bd_addr(BD_ADDR p_bd_addr,
                                           tBT_TRANSPORT transport);
 extern tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle);
+extern void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle);
 extern void l2cu_update_lcb_4_bonding(BD_ADDR p_bd_addr, bool is_bonding);
 
 extern uint8_t l2cu_get_conn_role(tL2C_LCB* p_this_lcb);
@@ -704,6 +751,7 @@ extern BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb);
 extern void l2cu_resubmit_pending_sec_req(BD_ADDR p_bda);
 extern void l2cu_initialize_amp_ccb(tL2C_LCB* p_lcb);
 extern void l2cu_adjust_out_mps(tL2C_CCB* p_ccb);
+extern void l2cu_adjust_le_out_mps(tL2C_CCB* p_ccb);
 
 /* Functions provided by l2c_link.cc
  ***********************************
@@ -824,6 +872,9 @@ extern void l2cble_set_fixed_channel_tx_data_length(BD_ADDR remote_bda,
 extern void l2cble_process_data_length_change_event(uint16_t handle,
                                                     uint16_t tx_data_len,
                                                     uint16_t rx_data_len);
+extern void l2cble_traffic_init(tL2C_LCB* p_lcb);
+extern void l2cble_traffic(tL2C_LCB* p_lcb, uint16_t octets);
+extern void l2cble_traffic_release(tL2C_LCB* p_lcb);
 
 extern void l2cu_process_fixed_disc_cback(tL2C_LCB* p_lcb);
 
@@ -41,11 +41,14 @@
 #include "l2c_api.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/osi.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
 static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf);
+static bool l2c_link_is_window_reserved(tL2C_LCB* p_lcb);
+static void l2c_link_check_send_hipri_pkts(tL2C_LCB* p_lcb);
 
 /*******************************************************************************
  *
@@ -176,7 +179,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle, BD_ADDR p_bda) {
   }
 
   /* Save the handle */
-  p_lcb->handle = handle;
+  l2cu_set_lcb_handle(p_lcb, handle);
 
   if (ci.status == HCI_SUCCESS) {
     /* Connected OK. Change state to connected */
@@ -228,7 +231,7 @@ bool l2c_link_hci_conn_comp(uint8_t status, uint16_t handle, BD_ADDR p_bda) {
   else if ((ci.status == HCI_ERR_MAX_NUM_OF_CONNECTIONS) &&
            l2cu_lcb_disconnecting()) {
     p_lcb->link_state = LST_CONNECT_HOLDING;
-    p_lcb->handle = HCI_INVALID_HANDLE;
+    l2cu_set_lcb_handle(p_lcb, HCI_INVALID_HANDLE);
   } else {
     /* Just in case app decides to try again in the callback context */
     p_lcb->link_state = LST_DISCONNECTING;
@@ -779,12 +782,12 @@ void l2c_link_adjust_allocation(void) {
  *
  ******************************************************************************/
 void l2c_link_adjust_chnl_allocation(void) {
-  uint8_t xx;
+  uint16_t xx;
 
   L2CAP_TRACE_DEBUG("%s", __func__);
 
   /* assign buffer quota to each channel based on its data rate requirement */
-  for (xx = 0; xx < MAX_L2CAP_CHANNELS; xx++) {
+  for (xx = 0; xx < l2cb.num_ccb; xx++) {
     tL2C_CCB* p_ccb = l2cb.ccb_pool + xx;
 
     if (!p_ccb->in_use) continue;
@@ -1009,6 +1012,9 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
           (p_lcb->link_xmit_quota != 0) || (L2C_LINK_CHECK_POWER_MODE(p_lcb)))
         continue;
 
+      /* Leave the remaining controller buffers to the high priority links */
+      if (l2c_link_is_window_reserved(p_lcb)) continue;
+
       /* See if we can send anything from the Link Queue */
       if (!list_is_empty(p_lcb->link_xmit_data_q)) {
         p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
@@ -1050,7 +1056,8 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
              (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
             (l2cb.controller_le_xmit_window != 0 &&
              (p_lcb->transport == BT_TRANSPORT_LE))) &&
-           (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
+           (p_lcb->sent_not_acked < p_lcb->link_xmit_quota) &&
+           !l2c_link_is_window_reserved(p_lcb)) {
       if (list_is_empty(p_lcb->link_xmit_data_q)) break;
 
       p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
@@ -1064,7 +1071,8 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
                (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
               (l2cb.controller_le_xmit_window != 0 &&
                (p_lcb->transport == BT_TRANSPORT_LE))) &&
-             (p_lcb->sent_not_acked < p_lcb->link_xmit_quota)) {
+             (p_lcb->sent_not_acked < p_lcb->link_xmit_quota) &&
+             !l2c_link_is_window_reserved(p_lcb)) {
         p_buf = l2cu_get_next_buffer_to_send(p_lcb);
         if (p_buf == NULL) break;
 
@@ -1084,6 +1092,75 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         l2c_link_is_window_reserved
+ *
+ * Description      This function checks if the controller buffers left on
+ *                  the transport of a low priority link are reserved for
+ *                  the high priority links. Each high priority link keeps
+ *                  the part of its transmit quota it did not use yet, so
+ *                  that a low priority link that went over its own quota,
+ *                  e.g. after the quotas were readjusted, cannot starve the
+ *                  media streams whose packets have a deadline.
+ *
+ * Returns          true if the low priority link must not send now
+ *
+ ******************************************************************************/
+static bool l2c_link_is_window_reserved(tL2C_LCB* p_lcb) {
+  uint16_t xmit_window, reserved = 0;
+  tL2C_LCB* p_hipri_lcb;
+  int xx;
+
+  if (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) return false;
+
+  for (xx = 0, p_hipri_lcb = &l2cb.lcb_pool[0]; xx < MAX_L2CAP_LINKS;
+       xx++, p_hipri_lcb++) {
+    if ((!p_hipri_lcb->in_use) ||
+        (p_hipri_lcb->acl_priority != L2CAP_PRIORITY_HIGH) ||
+        (p_hipri_lcb->transport != p_lcb->transport) ||
+        (p_hipri_lcb->link_state != LST_CONNECTED))
+      continue;
+
+    if (p_hipri_lcb->sent_not_acked < p_hipri_lcb->link_xmit_quota)
+      reserved += p_hipri_lcb->link_xmit_quota - p_hipri_lcb->sent_not_acked;
+  }
+
+  xmit_window = (p_lcb->transport == BT_TRANSPORT_LE)
+                    ? l2cb.controller_le_xmit_window
+                    : l2cb.controller_xmit_window;
+
+  return (xmit_window <= reserved);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_check_send_hipri_pkts
+ *
+ * Description      This function is called when a low priority link got
+ *                  controller buffers back, to let the high priority links
+ *                  on the same transport send their pending packets first.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_check_send_hipri_pkts(tL2C_LCB* p_lcb) {
+  tL2C_LCB* p_hipri_lcb;
+  int xx;
+
+  for (xx = 0, p_hipri_lcb = &l2cb.lcb_pool[0]; xx < MAX_L2CAP_LINKS;
+       xx++, p_hipri_lcb++) {
+    if ((p_hipri_lcb == p_lcb) || (!p_hipri_lcb->in_use) ||
+        (p_hipri_lcb->acl_priority != L2CAP_PRIORITY_HIGH) ||
+        (p_hipri_lcb->transport != p_lcb->transport) ||
+        (p_hipri_lcb->link_xmit_quota == 0) ||
+        (p_hipri_lcb->sent_not_acked >= p_hipri_lcb->link_xmit_quota))
+      continue;
+
+    l2c_link_check_send_pkts(p_hipri_lcb, NULL, NULL);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         l2c_link_send_to_lower
@@ -1098,6 +1175,8 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf) {
   uint16_t xmit_window, acl_data_size;
   const controller_t* controller = controller_get_interface();
 
+  FLOW_TRACE(FLOW_TRACE_L2CAP, p_buf, "L2CAP to HCI");
+
   if ((p_buf->len <= controller->get_acl_packet_size_classic() &&
        (p_lcb->transport == BT_TRANSPORT_BR_EDR)) ||
       ((p_lcb->transport == BT_TRANSPORT_LE) &&
@@ -1109,13 +1188,17 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf) {
         l2cb.round_robin_unacked++;
     }
     p_lcb->sent_not_acked++;
+    p_lcb->acl_sent_pkts++;
+    p_lcb->acl_sent_bytes += p_buf->len - HCI_DATA_PREAMBLE_SIZE;
     p_buf->layer_specific = 0;
 
     if (p_lcb->transport == BT_TRANSPORT_LE) {
+      l2cble_traffic(p_lcb, p_buf->len);
       l2cb.controller_le_xmit_window--;
       bte_main_hci_send(
           p_buf, (uint16_t)(BT_EVT_TO_LM_HCI_ACL | LOCAL_BLE_CONTROLLER_ID));
     } else {
+      btm_pm_traffic(p_lcb->handle);
       l2cb.controller_xmit_window--;
       bte_main_hci_send(p_buf, BT_EVT_TO_LM_HCI_ACL);
     }
@@ -1159,10 +1242,17 @@ static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf) {
     }
 
     p_lcb->sent_not_acked += num_segs;
+    p_lcb->acl_sent_pkts += num_segs;
+    if (p_buf->len - HCI_DATA_PREAMBLE_SIZE > num_segs * acl_data_size)
+      p_lcb->acl_sent_bytes += num_segs * acl_data_size;
+    else
+      p_lcb->acl_sent_bytes += p_buf->len - HCI_DATA_PREAMBLE_SIZE;
     if (p_lcb->transport == BT_TRANSPORT_LE) {
+      l2cble_traffic(p_lcb, p_buf->len);
       bte_main_hci_send(
           p_buf, (uint16_t)(BT_EVT_TO_LM_HCI_ACL | LOCAL_BLE_CONTROLLER_ID));
     } else {
+      btm_pm_traffic(p_lcb->handle);
       bte_main_hci_send(p_buf, BT_EVT_TO_LM_HCI_ACL);
     }
   }
@@ -1242,12 +1332,22 @@ void l2c_link_process_num_completed_pkts(uint8_t* p) {
         }
       }
 
+      p_lcb->acl_completed_pkts += num_sent;
+      if (p_lcb->link_xmit_quota != 0 &&
+          p_lcb->sent_not_acked >= p_lcb->link_xmit_quota)
+        p_lcb->acl_blocked_pkts += num_sent;
+
       /* Don't go negative */
       if (p_lcb->sent_not_acked > num_sent)
         p_lcb->sent_not_acked -= num_sent;
       else
         p_lcb->sent_not_acked = 0;
 
+      /* The buffers released by a low priority link go first to the high
+       * priority links that are waiting for one */
+      if (p_lcb->acl_priority != L2CAP_PRIORITY_HIGH)
+        l2c_link_check_send_hipri_pkts(p_lcb);
+
       l2c_link_check_send_pkts(p_lcb, NULL, NULL);
 
       /* If we were doing round-robin for low priority links, check 'em */
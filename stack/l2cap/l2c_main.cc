@@ -37,8 +37,10 @@
 #include "l2c_api.h"
 #include "l2c_int.h"
 #include "l2cdefs.h"
+#include "osi/include/flow_trace.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
+#include "stack_config.h"
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
@@ -71,6 +73,8 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
   uint16_t l2cap_len, rcv_cid, psm;
   uint16_t credit;
 
+  FLOW_TRACE(FLOW_TRACE_L2CAP, p_msg, "L2CAP rx");
+
   /* Extract the handle */
   STREAM_TO_UINT16(handle, p);
   pkt_type = HCID_GET_EVENT(handle);
@@ -149,6 +153,11 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
      * not in disconnecting mode */
     l2cble_notify_le_connection(p_lcb->remote_bd_addr);
 
+  if (p_lcb && p_lcb->transport == BT_TRANSPORT_LE)
+    l2cble_traffic(p_lcb, hci_len);
+  else if (p_lcb)
+    btm_pm_traffic(p_lcb->handle);
+
   /* Find the CCB for this CID */
   if (rcv_cid >= L2CAP_BASE_APPL_CID) {
     p_ccb = l2cu_find_ccb_by_cid(p_lcb, rcv_cid);
@@ -221,9 +230,14 @@ void l2c_rcv_acl_data(BT_HDR* p_msg) {
     else {
       if (p_lcb->transport == BT_TRANSPORT_LE) {
         l2c_lcc_proc_pdu(p_ccb, p_msg);
-        // Got a pkt, valid send out credits to the peer device
-        credit = L2CAP_LE_DEFAULT_CREDIT;
-        l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credit);
+        // Got a pkt, the credits are sent out to the peer device once half of
+        // the ones given are used, before it runs out of them
+        p_ccb->ble_rx_credits_used++;
+        if (p_ccb->ble_rx_credits_used * 2 >= p_ccb->local_conn_cfg.credits) {
+          credit = p_ccb->ble_rx_credits_used;
+          p_ccb->ble_rx_credits_used = 0;
+          l2c_csm_execute(p_ccb, L2CEVT_L2CA_SEND_FLOW_CONTROL_CREDIT, &credit);
+        }
       } else {
         /* Basic mode packets go straight to the state machine */
         if (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_BASIC_MODE)
@@ -770,8 +784,17 @@ void l2c_init(void) {
   /* the psm is increased by 2 before being used */
   l2cb.dyn_psm = 0xFFF;
 
+  /* The channel control blocks are sized by the capacity profile */
+  int num_ccb = stack_config_get_interface()->get_l2cap_max_channels();
+  if (num_ccb <= 0) num_ccb = MAX_L2CAP_CHANNELS;
+  if (num_ccb > L2CAP_CHANNELS_LIMIT) num_ccb = L2CAP_CHANNELS_LIMIT;
+  l2cb.num_ccb = num_ccb;
+  l2cb.ccb_pool = (tL2C_CCB*)osi_calloc_tagged(
+      num_ccb * sizeof(tL2C_CCB), OSI_MEM_L2CAP);
+  L2CAP_TRACE_DEBUG("%s: %d channel control blocks", __func__, num_ccb);
+
   /* Put all the channel control blocks on the free queue */
-  for (xx = 0; xx < MAX_L2CAP_CHANNELS - 1; xx++) {
+  for (xx = 0; xx < num_ccb - 1; xx++) {
     l2cb.ccb_pool[xx].p_next_ccb = &l2cb.ccb_pool[xx + 1];
   }
 
@@ -781,7 +804,7 @@ void l2c_init(void) {
 #endif
 
   l2cb.p_free_ccb_first = &l2cb.ccb_pool[0];
-  l2cb.p_free_ccb_last = &l2cb.ccb_pool[MAX_L2CAP_CHANNELS - 1];
+  l2cb.p_free_ccb_last = &l2cb.ccb_pool[num_ccb - 1];
 
 #ifdef L2CAP_DESIRED_LINK_ROLE
   l2cb.desire_role = L2CAP_DESIRED_LINK_ROLE;
@@ -821,6 +844,8 @@ void l2c_init(void) {
 void l2c_free(void) {
   list_free(l2cb.rcv_pending_q);
   l2cb.rcv_pending_q = NULL;
+  osi_free_and_reset((void**)&l2cb.ccb_pool);
+  l2cb.num_ccb = 0;
 }
 
 void l2c_receive_hold_timer_timeout(UNUSED_ATTR void* data) {
@@ -861,6 +886,8 @@ void l2c_lcb_timer_timeout(void* data) {
 uint8_t l2c_data_write(uint16_t cid, BT_HDR* p_data, uint16_t flags) {
   tL2C_CCB* p_ccb;
 
+  FLOW_TRACE(FLOW_TRACE_L2CAP, p_data, "L2CAP tx");
+
   /* Find the channel control block. We don't know the link it is on. */
   p_ccb = l2cu_find_ccb_by_cid(NULL, cid);
   if (p_ccb == NULL) {
@@ -31,6 +31,7 @@
 #include "bt_utils.h"
 #include "btm_api.h"
 #include "btm_int.h"
+#include "btsnoop.h"
 #include "btu.h"
 #include "device/include/controller.h"
 #include "hcidefs.h"
@@ -41,6 +42,49 @@
 
 extern fixed_queue_t* btu_general_alarm_queue;
 
+static_assert((L2CAP_LCB_HASH_SIZE & (L2CAP_LCB_HASH_SIZE - 1)) == 0,
+              "L2CAP_LCB_HASH_SIZE must be a power of two");
+static_assert(MAX_L2CAP_LINKS <= 0xFF,
+              "The ACL indexes of BTM do not fit MAX_L2CAP_LINKS");
+
+/* The buckets of an address and of a handle in the LCB hash tables */
+static tL2C_LCB** l2cu_lcb_addr_bucket(const BD_ADDR bd_addr) {
+  uint32_t hash = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) hash = hash * 31 + bd_addr[i];
+  return &l2cb.p_lcb_by_addr[hash & (L2CAP_LCB_HASH_SIZE - 1)];
+}
+
+static tL2C_LCB** l2cu_lcb_handle_bucket(uint16_t handle) {
+  return &l2cb.p_lcb_by_handle[handle & (L2CAP_LCB_HASH_SIZE - 1)];
+}
+
+/* Removes |p_lcb| from the bucket of its address */
+static void l2cu_unhash_lcb_addr(tL2C_LCB* p_lcb) {
+  tL2C_LCB** pp_lcb = l2cu_lcb_addr_bucket(p_lcb->remote_bd_addr);
+
+  for (; *pp_lcb; pp_lcb = &(*pp_lcb)->p_next_addr_lcb) {
+    if (*pp_lcb == p_lcb) {
+      *pp_lcb = p_lcb->p_next_addr_lcb;
+      break;
+    }
+  }
+  p_lcb->p_next_addr_lcb = NULL;
+}
+
+/* Removes |p_lcb| from the bucket of its handle, if it has one */
+static void l2cu_unhash_lcb_handle(tL2C_LCB* p_lcb) {
+  if (p_lcb->handle == HCI_INVALID_HANDLE) return;
+
+  tL2C_LCB** pp_lcb = l2cu_lcb_handle_bucket(p_lcb->handle);
+  for (; *pp_lcb; pp_lcb = &(*pp_lcb)->p_next_handle_lcb) {
+    if (*pp_lcb == p_lcb) {
+      *pp_lcb = p_lcb->p_next_handle_lcb;
+      break;
+    }
+  }
+  p_lcb->p_next_handle_lcb = NULL;
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_allocate_lcb
@@ -59,10 +103,15 @@ tL2C_LCB* l2cu_allocate_lcb(BD_ADDR p_bd_addr, bool is_bonding,
     if (!p_lcb->in_use) {
       alarm_free(p_lcb->l2c_lcb_timer);
       alarm_free(p_lcb->info_resp_timer);
+      alarm_free(p_lcb->ble_traffic.timer);
       memset(p_lcb, 0, sizeof(tL2C_LCB));
 
       memcpy(p_lcb->remote_bd_addr, p_bd_addr, BD_ADDR_LEN);
 
+      tL2C_LCB** pp_bucket = l2cu_lcb_addr_bucket(p_bd_addr);
+      p_lcb->p_next_addr_lcb = *pp_bucket;
+      *pp_bucket = p_lcb;
+
       p_lcb->in_use = true;
       p_lcb->link_state = LST_DISCONNECTED;
       p_lcb->handle = HCI_INVALID_HANDLE;
@@ -78,6 +127,7 @@ tL2C_LCB* l2cu_allocate_lcb(BD_ADDR p_bd_addr, bool is_bonding,
       p_lcb->le_sec_pending_q = fixed_queue_new(SIZE_MAX);
 
       if (transport == BT_TRANSPORT_LE) {
+        l2cble_traffic_init(p_lcb);
         l2cb.num_ble_links_active++;
         l2c_ble_link_adjust_allocation();
       } else {
@@ -132,6 +182,9 @@ void l2cu_update_lcb_4_bonding(BD_ADDR p_bd_addr, bool is_bonding) {
 void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   tL2C_CCB* p_ccb;
 
+  l2cu_unhash_lcb_addr(p_lcb);
+  l2cu_unhash_lcb_handle(p_lcb);
+
   p_lcb->in_use = false;
   p_lcb->is_bonding = false;
 
@@ -140,6 +193,7 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   p_lcb->l2c_lcb_timer = NULL;
   alarm_free(p_lcb->info_resp_timer);
   p_lcb->info_resp_timer = NULL;
+  l2cble_traffic_release(p_lcb);
 
   /* Release any unfinished L2CAP packet on this link */
   osi_free_and_reset((void**)&p_lcb->p_hcit_rcv_acl);
@@ -245,11 +299,10 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_bd_addr(BD_ADDR p_bd_addr, tBT_TRANSPORT transport) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  tL2C_LCB* p_lcb = *l2cu_lcb_addr_bucket(p_bd_addr);
 
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-    if ((p_lcb->in_use) && p_lcb->transport == transport &&
+  for (; p_lcb; p_lcb = p_lcb->p_next_addr_lcb) {
+    if (p_lcb->transport == transport &&
         (!memcmp(p_lcb->remote_bd_addr, p_bd_addr, BD_ADDR_LEN))) {
       return (p_lcb);
     }
@@ -317,7 +370,7 @@ bool l2c_is_cmd_rejected(uint8_t cmd_code, uint8_t id, tL2C_LCB* p_lcb) {
  ******************************************************************************/
 BT_HDR* l2cu_build_header(tL2C_LCB* p_lcb, uint16_t len, uint8_t cmd,
                           uint8_t id) {
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(L2CAP_CMD_BUF_SIZE);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(L2CAP_CMD_BUF_SIZE, OSI_MEM_L2CAP);
   uint8_t* p;
 
   p_buf->offset = L2CAP_SEND_CMD_OFFSET;
@@ -744,7 +797,7 @@ void l2cu_send_peer_config_rej(tL2C_CCB* p_ccb, uint8_t* p_data,
     return;
   }
 
-  BT_HDR* p_buf = (BT_HDR*)osi_malloc(len + rej_len);
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc_tagged(len + rej_len, OSI_MEM_L2CAP);
   p_buf->offset = L2CAP_SEND_CMD_OFFSET;
   p = (uint8_t*)(p_buf + 1) + L2CAP_SEND_CMD_OFFSET;
 
@@ -1598,6 +1651,8 @@ void l2cu_release_ccb(tL2C_CCB* p_ccb) {
 #endif
                       )) {
     l2cu_dequeue_ccb(p_ccb);
+    btsnoop_get_interface()->remove_l2c_channel(p_lcb->handle,
+                                                p_ccb->local_cid);
 
     /* Delink the CCB from the LCB */
     p_ccb->p_lcb = NULL;
@@ -2515,6 +2570,36 @@ void l2cu_adjust_out_mps(tL2C_CCB* p_ccb) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_adjust_le_out_mps
+ *
+ * Description      Sets our tx MPS on an LE Credit Based channel so that each
+ *                  PDU fills a whole number of LE ACL buffers of the
+ *                  controller, instead of leaving a short last fragment.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_adjust_le_out_mps(tL2C_CCB* p_ccb) {
+  uint16_t mps = p_ccb->peer_conn_cfg.mps;
+  uint16_t acl_data_size = controller_get_interface()->get_acl_data_size_ble();
+
+  /* The PDUs are the MPS plus the L2CAP header. An MPS of a PDU shorter than
+   * an ACL buffer is kept, as splitting the SDUs would only cost credits */
+  p_ccb->tx_mps = mps;
+  if (acl_data_size > L2CAP_PKT_OVERHEAD &&
+      mps + L2CAP_PKT_OVERHEAD > acl_data_size) {
+    uint16_t tx_mps = (mps + L2CAP_PKT_OVERHEAD) / acl_data_size *
+                          acl_data_size -
+                      L2CAP_PKT_OVERHEAD;
+    if (tx_mps >= L2CAP_LE_MIN_MPS) p_ccb->tx_mps = tx_mps;
+  }
+
+  L2CAP_TRACE_DEBUG("%s use %d based on peer mps: %u acl_data_size: %u",
+                    __func__, p_ccb->tx_mps, mps, acl_data_size);
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_initialize_fixed_ccb
@@ -3022,11 +3107,10 @@ void l2cu_send_peer_ble_credit_based_disconn_req(tL2C_CCB* p_ccb) {
  *
  ******************************************************************************/
 tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
-  int xx;
-  tL2C_LCB* p_lcb = &l2cb.lcb_pool[0];
+  tL2C_LCB* p_lcb = *l2cu_lcb_handle_bucket(handle);
 
-  for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++) {
-    if ((p_lcb->in_use) && (p_lcb->handle == handle)) {
+  for (; p_lcb; p_lcb = p_lcb->p_next_handle_lcb) {
+    if (p_lcb->handle == handle) {
       return (p_lcb);
     }
   }
@@ -3035,6 +3119,27 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         l2cu_set_lcb_handle
+ *
+ * Description      Set the HCI handle of an LCB, and move the LCB to the
+ *                  bucket of the handle so l2cu_find_lcb_by_handle finds it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void l2cu_set_lcb_handle(tL2C_LCB* p_lcb, uint16_t handle) {
+  l2cu_unhash_lcb_handle(p_lcb);
+
+  p_lcb->handle = handle;
+  if (handle == HCI_INVALID_HANDLE) return;
+
+  tL2C_LCB** pp_bucket = l2cu_lcb_handle_bucket(handle);
+  p_lcb->p_next_handle_lcb = *pp_bucket;
+  *pp_bucket = p_lcb;
+}
+
 /*******************************************************************************
  *
  * Function         l2cu_find_ccb_by_cid
@@ -3049,14 +3154,14 @@ tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) {
 tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
   tL2C_CCB* p_ccb = NULL;
 #if (L2CAP_UCD_INCLUDED == TRUE)
-  uint8_t xx;
+  uint16_t xx;
 #endif
 
   if (local_cid >= L2CAP_BASE_APPL_CID) {
     /* find the associated CCB by "index" */
     local_cid -= L2CAP_BASE_APPL_CID;
 
-    if (local_cid >= MAX_L2CAP_CHANNELS) return NULL;
+    if (local_cid >= l2cb.num_ccb) return NULL;
 
     p_ccb = l2cb.ccb_pool + local_cid;
 
@@ -3073,14 +3178,14 @@ tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
   else {
     /* searching fixed channel */
     p_ccb = l2cb.ccb_pool;
-    for (xx = 0; xx < MAX_L2CAP_CHANNELS; xx++) {
+    for (xx = 0; xx < l2cb.num_ccb; xx++) {
       if ((p_ccb->local_cid == local_cid) && (p_ccb->in_use) &&
           (p_lcb == p_ccb->p_lcb))
         break;
       else
         p_ccb++;
     }
-    if (xx >= MAX_L2CAP_CHANNELS) return NULL;
+    if (xx >= l2cb.num_ccb) return NULL;
   }
 #endif
 
@@ -104,7 +104,8 @@ l2cap_client_t* l2cap_client_new(const l2cap_client_callbacks_t* callbacks,
     }
   }
 
-  l2cap_client_t* ret = (l2cap_client_t*)osi_calloc(sizeof(l2cap_client_t));
+  l2cap_client_t* ret = (l2cap_client_t*)osi_calloc_tagged(
+      sizeof(l2cap_client_t), OSI_MEM_L2CAP);
 
   ret->callbacks = *callbacks;
   ret->context = context;
@@ -393,7 +394,9 @@ static void fragment_packet(l2cap_client_t* client, buffer_t* packet) {
 
   // TODO(sharvil): eliminate copy into BT_HDR.
   BT_HDR* bt_packet = static_cast<BT_HDR*>(
-      osi_malloc(buffer_length(packet) + L2CAP_MIN_OFFSET + sizeof(BT_HDR)));
+      osi_malloc_tagged(
+          buffer_length(packet) + L2CAP_MIN_OFFSET + sizeof(BT_HDR),
+          OSI_MEM_L2CAP));
   bt_packet->offset = L2CAP_MIN_OFFSET;
   bt_packet->len = buffer_length(packet);
   memcpy(bt_packet->data + bt_packet->offset, buffer_ptr(packet),
@@ -409,7 +412,9 @@ static void fragment_packet(l2cap_client_t* client, buffer_t* packet) {
     }
 
     BT_HDR* fragment = static_cast<BT_HDR*>(
-        osi_malloc(client->remote_mtu + L2CAP_MIN_OFFSET + sizeof(BT_HDR)));
+        osi_malloc_tagged(
+            client->remote_mtu + L2CAP_MIN_OFFSET + sizeof(BT_HDR),
+            OSI_MEM_L2CAP));
     fragment->offset = L2CAP_MIN_OFFSET;
     fragment->len = client->remote_mtu;
     memcpy(fragment->data + fragment->offset,
@@ -187,7 +187,7 @@ typedef struct {
 /* transport control block */
 typedef struct {
   tMCA_TC_TBL tc_tbl[MCA_NUM_TC_TBL];
-  uint8_t lcid_tbl[MAX_L2CAP_CHANNELS]; /* map LCID to tc_tbl index */
+  uint8_t lcid_tbl[L2CAP_CHANNELS_LIMIT]; /* map LCID to tc_tbl index */
 } tMCA_TC;
 
 /* registration control block */
@@ -315,7 +315,7 @@ void pan_dump_status(void) {
              p_pcb->rem_bda[2], p_pcb->rem_bda[3], p_pcb->rem_bda[4],
              p_pcb->rem_bda[5]);
 
-    PAN_TRACE_DEBUG(buff);
+    PAN_TRACE_DEBUG("%s", buff);
   }
 #endif
 }
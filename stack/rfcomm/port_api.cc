@@ -25,7 +25,9 @@
 #define LOG_TAG "bt_port_api"
 
 #include <string.h>
+#include <sys/uio.h>
 
+#include "osi/include/flow_trace.h"
 #include "osi/include/log.h"
 #include "osi/include/mutex.h"
 
@@ -1279,6 +1281,8 @@ int PORT_Read(uint16_t handle, BT_HDR** pp_buf) {
  *
  ******************************************************************************/
 static int port_write(tPORT* p_port, BT_HDR* p_buf) {
+  FLOW_TRACE_START(FLOW_TRACE_RFCOMM, p_buf, "RFCOMM tx");
+
   /* We should not allow to write data in to server port when connection is not
    * opened */
   if (p_port->is_server && (p_port->rfc.state != RFC_STATE_OPENED)) {
@@ -1383,6 +1387,65 @@ int PORT_Write(uint16_t handle, BT_HDR* p_buf) {
 
   return (PORT_SUCCESS);
 }
+/*******************************************************************************
+ *
+ * Function         port_read_data_co
+ *
+ * Description      This function allocates the buffers for up to |available|
+ *                  bytes of the application data, as many as the transmit
+ *                  queue accepts, and fills them with a single read through
+ *                  the data call-out, instead of a read for each buffer.
+ *
+ * Parameters:      p_port     - Port
+ *                  handle     - Handle of the port
+ *                  length     - Maximum data length of a buffer
+ *                  available  - Byte count the application has to send
+ *                  bufs       - Buffers read, PORT_TX_BUF_HIGH_WM + 1 at most
+ *
+ * Returns          The number of buffers read, or -1 if the read failed
+ *
+ ******************************************************************************/
+static int port_read_data_co(tPORT* p_port, uint16_t handle, uint16_t length,
+                             int available, BT_HDR** bufs) {
+  struct iovec iov[PORT_TX_BUF_HIGH_WM + 1];
+  uint32_t queue_size = p_port->tx.queue_size;
+  size_t queue_count = fixed_queue_length(p_port->tx.queue);
+  int num_bufs = 0;
+
+  /* The buffers are counted as queued, the first one being already allowed */
+  while (available && (num_bufs <= PORT_TX_BUF_HIGH_WM)) {
+    if (num_bufs && ((queue_size > PORT_TX_HIGH_WM) ||
+                     (queue_count > PORT_TX_BUF_HIGH_WM)))
+      break;
+
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
+    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+    p_buf->layer_specific = handle;
+    p_buf->len = (available < (int)length) ? (uint16_t)available : length;
+    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+
+    iov[num_bufs].iov_base = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    iov[num_bufs].iov_len = p_buf->len;
+    bufs[num_bufs++] = p_buf;
+
+    queue_size += p_buf->len;
+    queue_count++;
+    available -= p_buf->len;
+  }
+
+  if (p_port->p_data_co_callback(handle, (uint8_t*)iov, num_bufs,
+                                 DATA_CO_CALLBACK_TYPE_OUTGOING_IOV) == false) {
+    error(
+        "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_IOV failed, "
+        "num_bufs:%d",
+        num_bufs);
+    for (int i = 0; i < num_bufs; i++) osi_free(bufs[i]);
+    return -1;
+  }
+
+  return num_bufs;
+}
+
 /*******************************************************************************
  *
  * Function         PORT_WriteDataCO
@@ -1478,6 +1541,8 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
 
   // max_read = available < max_read ? available : max_read;
 
+  if (p_port->peer_mtu < length) length = p_port->peer_mtu;
+
   while (available) {
     /* if we're over buffer high water mark, we're done */
     if ((p_port->tx.queue_size > PORT_TX_HIGH_WM) ||
@@ -1492,40 +1557,34 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
     }
 
     /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
+    BT_HDR* bufs[PORT_TX_BUF_HIGH_WM + 1];
+    int num_bufs = port_read_data_co(p_port, handle, length, available, bufs);
+    if (num_bufs < 0) return (PORT_UNKNOWN_ERROR);
+
+    for (int i = 0; i < num_bufs; i++) {
+      /* the data read after a buffer failing to be written is dropped */
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) {
+        osi_free(bufs[i]);
+        continue;
+      }
 
-    if (p_port->peer_mtu < length) length = p_port->peer_mtu;
-    if (available < (int)length) length = (uint16_t)available;
-    p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+      uint16_t buf_len = bufs[i]->len;
+      RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", buf_len);
 
-    // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset, p_data, length);
-    // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset, (int)length, 0) !=
-    // (int)length)
-    if (p_port->p_data_co_callback(
-            handle, (uint8_t*)(p_buf + 1) + p_buf->offset, length,
-            DATA_CO_CALLBACK_TYPE_OUTGOING) == false) {
-      error(
-          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d",
-          length);
-      return (PORT_UNKNOWN_ERROR);
-    }
+      rc = port_write(p_port, bufs[i]);
 
-    RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", length);
+      /* If queue went below the threashold need to send flow control */
+      event |= port_flow_control_user(p_port);
 
-    rc = port_write(p_port, p_buf);
+      if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
 
-    /* If queue went below the threashold need to send flow control */
-    event |= port_flow_control_user(p_port);
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) continue;
 
-    if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
+      *p_len += buf_len;
+      available -= (int)buf_len;
+    }
 
     if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
-
-    *p_len += length;
-    available -= (int)length;
   }
   if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
     event |= PORT_EV_TXEMPTY;
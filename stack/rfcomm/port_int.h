@@ -30,6 +30,7 @@
 #include "osi/include/alarm.h"
 #include "osi/include/fixed_queue.h"
 #include "port_api.h"
+#include "port_tx_scheduler.h"
 #include "rfcdefs.h"
 
 /* Local events passed when application event is sent from the api to PORT */
@@ -108,6 +109,7 @@ typedef struct {
       pending_lcid; /* store LCID for incoming connection while connecting */
   uint8_t
       pending_id; /* store l2cap ID for incoming connection while connecting */
+  PortTxScheduler tx_scheduler; /* Turns of the DLCIs sending queued data */
 } tRFC_MCB;
 
 /*
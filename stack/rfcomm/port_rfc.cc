@@ -24,6 +24,7 @@
  ******************************************************************************/
 #include <string.h>
 
+#include "osi/include/flow_trace.h"
 #include "osi/include/mutex.h"
 #include "osi/include/osi.h"
 
@@ -763,6 +764,7 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
   RFCOMM_TRACE_EVENT(
       "PORT_DataInd with data length %d, p_mcb:%p,p_port:%p,dlci:%d",
       p_buf->len, p_mcb, p_port, dlci);
+  FLOW_TRACE(FLOW_TRACE_RFCOMM, p_buf, "RFCOMM rx");
   if (!p_port) {
     osi_free(p_buf);
     return;
@@ -836,17 +838,85 @@ void PORT_DataInd(tRFC_MCB* p_mcb, uint8_t dlci, BT_HDR* p_buf) {
   if (p_port->p_callback && events) p_port->p_callback(events, p_port->inx);
 }
 
+/*******************************************************************************
+ *
+ * Function         port_rfc_tx_frame_len
+ *
+ * Description      This function returns the length of the next frame the
+ *                  port of the dlci on the multiplexer can send, or -1 if it
+ *                  can send none.
+ *
+ ******************************************************************************/
+static int port_rfc_tx_frame_len(tRFC_MCB* p_mcb, uint8_t dlci) {
+  tPORT* p_port = port_find_mcb_dlci_port(p_mcb, dlci);
+  if (p_port == NULL || !p_port->in_use ||
+      p_port->rfc.state != RFC_STATE_OPENED || p_port->tx.peer_fc)
+    return -1;
+
+  mutex_global_lock();
+  BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_peek_first(p_port->tx.queue);
+  int len = (p_buf != NULL) ? p_buf->len : -1;
+  mutex_global_unlock();
+  return len;
+}
+
+/*******************************************************************************
+ *
+ * Function         port_rfc_send_mx_tx_data
+ *
+ * Description      This function sends the data queued on the ports of the
+ *                  multiplexer while the peer is ready, the ports taking
+ *                  turns of an L2CAP MTU.  The events of the ports sending
+ *                  are added to the events array, indexed by port.
+ *
+ ******************************************************************************/
+static void port_rfc_send_mx_tx_data(tRFC_MCB* p_mcb, uint32_t* events) {
+  uint16_t quantum =
+      p_mcb->peer_l2cap_mtu ? p_mcb->peer_l2cap_mtu : L2CAP_DEFAULT_MTU;
+  bool sent[MAX_RFC_PORTS] = {false};
+
+  while (p_mcb->peer_ready) {
+    uint8_t dlci = p_mcb->tx_scheduler.Next(quantum, [p_mcb](uint8_t dlci) {
+      return port_rfc_tx_frame_len(p_mcb, dlci);
+    });
+    if (dlci == 0) break;
+
+    tPORT* p_port = port_find_mcb_dlci_port(p_mcb, dlci);
+    mutex_global_lock();
+    BT_HDR* p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_port->tx.queue);
+    p_port->tx.queue_size -= p_buf->len;
+    mutex_global_unlock();
+
+    RFCOMM_TRACE_DEBUG("Sending RFCOMM_DataReq dlci=%d tx.queue_size=%d", dlci,
+                       p_port->tx.queue_size);
+
+    RFCOMM_DataReq(p_mcb, dlci, p_buf);
+
+    events[p_port->inx - 1] |= PORT_EV_TXCHAR;
+    if (p_port->tx.queue_size == 0) events[p_port->inx - 1] |= PORT_EV_TXEMPTY;
+    sent[p_port->inx - 1] = true;
+  }
+
+  /* If we flow controlled users based on the queue size enable data again */
+  for (int i = 0; i < MAX_RFC_PORTS; i++) {
+    if (sent[i]) events[i] |= port_flow_control_user(&rfc_cb.port.port[i]);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         PORT_FlowInd
  *
  * Description      This function is called from the RFCOMM layer on the flow
  *                  control signal change.  Propagate change to the user.
+ *                  The data the ports of the multiplexer can then send is
+ *                  sent, the ports taking turns, so that a port with a lot
+ *                  of data queued does not hold back the others.
  *
  ******************************************************************************/
 void PORT_FlowInd(tRFC_MCB* p_mcb, uint8_t dlci, bool enable_data) {
   tPORT* p_port = (tPORT*)NULL;
-  uint32_t events = 0;
+  uint32_t events[MAX_RFC_PORTS] = {0};
   int i;
 
   RFCOMM_TRACE_EVENT("PORT_FlowInd fc:%d", enable_data);
@@ -867,23 +937,26 @@ void PORT_FlowInd(tRFC_MCB* p_mcb, uint8_t dlci, bool enable_data) {
       if (!p_port->in_use || (p_port->rfc.p_mcb != p_mcb) ||
           (p_port->rfc.state != RFC_STATE_OPENED))
         continue;
+    } else if (p_port != &rfc_cb.port.port[i]) {
+      continue;
     }
-    events = 0;
 
     /* Check if flow of data is still enabled */
-    events |= port_flow_control_user(p_port);
+    events[i] |= port_flow_control_user(p_port);
+  }
 
-    /* Check if data can be sent and send it */
-    events |= port_rfc_send_tx_data(p_port);
+  /* Check if data can be sent and send it */
+  port_rfc_send_mx_tx_data(p_mcb, events);
+
+  for (i = 0; i < MAX_RFC_PORTS; i++) {
+    p_port = &rfc_cb.port.port[i];
 
     /* Mask out all events that are not of interest to user */
-    events &= p_port->ev_mask;
+    events[i] &= p_port->ev_mask;
 
     /* Send event to the application */
-    if (p_port->p_callback && events) (p_port->p_callback)(events, p_port->inx);
-
-    /* If DLCI is not 0 event applies to one port only */
-    if (dlci != 0) break;
+    if (p_port->p_callback && events[i])
+      (p_port->p_callback)(events[i], p_port->inx);
   }
 }
 
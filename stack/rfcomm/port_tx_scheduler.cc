@@ -0,0 +1,55 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "port_tx_scheduler.h"
+
+uint8_t PortTxScheduler::Next(uint16_t quantum, const FrameLen& frame_len) {
+  /* every round adds to the deficits, so that the loop ends */
+  if (quantum == 0) quantum = 1;
+
+  while (true) {
+    if (current_ != 0) {
+      int len = frame_len(current_);
+      if (len >= 0 && (uint32_t)len <= deficit_[current_]) {
+        deficit_[current_] -= len;
+        return current_;
+      }
+      if (len < 0) deficit_[current_] = 0;
+    }
+
+    if (!NextTurn(quantum, frame_len)) {
+      current_ = 0;
+      return 0;
+    }
+  }
+}
+
+bool PortTxScheduler::NextTurn(uint16_t quantum, const FrameLen& frame_len) {
+  /* the data DLCIs, from the one after the current, to the current last */
+  for (int i = 1; i <= RFCOMM_MAX_DLCI; i++) {
+    uint8_t dlci = (current_ + i - 1) % RFCOMM_MAX_DLCI + 1;
+    if (frame_len(dlci) < 0) {
+      deficit_[dlci] = 0;
+      continue;
+    }
+    current_ = dlci;
+    deficit_[dlci] += quantum;
+    return true;
+  }
+  return false;
+}
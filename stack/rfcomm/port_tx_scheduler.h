@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef PORT_TX_SCHEDULER_H
+#define PORT_TX_SCHEDULER_H
+
+#include <stdint.h>
+
+#include <functional>
+
+#include "rfcdefs.h"
+
+/* This class shares the transmissions of an RFCOMM multiplexer between its
+ * DLCIs, in deficit round robin: the DLCIs with frames to send take turns,
+ * and each turn lets a DLCI send up to a quantum of octets more than it has
+ * left from its last turn. A bulk transfer on one DLCI then only delays the
+ * frames of the others by its share of a round, however much it queued.
+ *
+ * A DLCI without a frame it can send, for an empty queue or no credits,
+ * loses its turn and what it had left of it. A zeroed scheduler is reset,
+ * so that it can live in the multiplexer control block. */
+class PortTxScheduler {
+ public:
+  /* Returns the length of the next frame of |dlci|, or -1 if it has none it
+   * can send now. */
+  typedef std::function<int(uint8_t dlci)> FrameLen;
+
+  /* Returns the DLCI to send the next frame from, or 0 if none can send,
+   * with turns of |quantum| octets. The caller sends the frame before asking
+   * for the next one. */
+  uint8_t Next(uint16_t quantum, const FrameLen& frame_len);
+
+ private:
+  /* Starts the turn of the next DLCI, after the current one, with a frame to
+   * send. Returns false if there is none. */
+  bool NextTurn(uint16_t quantum, const FrameLen& frame_len);
+
+  uint8_t current_;
+  uint32_t deficit_[RFCOMM_MAX_DLCI + 1];
+};
+
+#endif  // PORT_TX_SCHEDULER_H
@@ -180,12 +180,19 @@ void port_select_mtu(tPORT* p_port) {
   } else {
     RFCOMM_TRACE_DEBUG("port_select_mtu application selected %d", p_port->mtu);
   }
-  p_port->credit_rx_max = (PORT_RX_HIGH_WM / p_port->mtu);
-  if (p_port->credit_rx_max > PORT_RX_BUF_HIGH_WM)
-    p_port->credit_rx_max = PORT_RX_BUF_HIGH_WM;
-  p_port->credit_rx_low = (PORT_RX_LOW_WM / p_port->mtu);
-  if (p_port->credit_rx_low > PORT_RX_BUF_LOW_WM)
-    p_port->credit_rx_low = PORT_RX_BUF_LOW_WM;
+  if (p_port->p_data_co_callback) {
+    /* The data received is handed to the call-out as it arrives, and not
+     * queued in the port: the window is not bound by the receive queue */
+    p_port->credit_rx_max = PORT_CO_CREDIT_RX_MAX;
+    p_port->credit_rx_low = PORT_CO_CREDIT_RX_LOW;
+  } else {
+    p_port->credit_rx_max = (PORT_RX_HIGH_WM / p_port->mtu);
+    if (p_port->credit_rx_max > PORT_RX_BUF_HIGH_WM)
+      p_port->credit_rx_max = PORT_RX_BUF_HIGH_WM;
+    p_port->credit_rx_low = (PORT_RX_LOW_WM / p_port->mtu);
+    if (p_port->credit_rx_low > PORT_RX_BUF_LOW_WM)
+      p_port->credit_rx_low = PORT_RX_BUF_LOW_WM;
+  }
   p_port->rx_buf_critical = (PORT_RX_CRITICAL_WM / p_port->mtu);
   if (p_port->rx_buf_critical > PORT_RX_BUF_CRITICAL_WM)
     p_port->rx_buf_critical = PORT_RX_BUF_CRITICAL_WM;
@@ -358,7 +365,9 @@ tPORT* port_find_dlci_port(uint8_t dlci) {
  *
  * Function         port_find_port
  *
- * Description      Find port with DLCI, BD_ADDR
+ * Description      Find port with DLCI, BD_ADDR.  The ports of an open
+ *                  multiplexer channel are looked up in its DLCI table, the
+ *                  others, not on a channel yet, in the port pool.
  *
  * Returns          Pointer to the PORT or NULL if not found
  *
@@ -367,6 +376,12 @@ tPORT* port_find_port(uint8_t dlci, BD_ADDR bd_addr) {
   uint16_t i;
   tPORT* p_port;
 
+  /* The ports on a multiplexer channel are indexed by DLCI */
+  p_port = port_find_mcb_dlci_port(port_find_mcb(bd_addr), dlci);
+  if (p_port != NULL && p_port->in_use && (p_port->dlci == dlci) &&
+      !memcmp(p_port->bd_addr, bd_addr, BD_ADDR_LEN))
+    return (p_port);
+
   for (i = 0; i < MAX_RFC_PORTS; i++) {
     p_port = &rfc_cb.port.port[i];
     if (p_port->in_use && (p_port->dlci == dlci) &&
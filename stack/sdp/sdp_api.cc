@@ -101,6 +101,58 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         SDP_AllocDiscoveryDb
+ *
+ * Description      This function allocates and initializes a discovery
+ *                  database that grows by chunks as the records are saved.
+ *                  The first chunk is allocated with the database.
+ *
+ * Parameters:      num_uuid    - (input) number of UUID filters applied
+ *                  p_uuid_list - (input) list of UUID filters
+ *                  num_attr    - (input) number of attribute filters applied
+ *                  p_attr_list - (input) list of attribute filters
+ *
+ *
+ * Returns          the database, to be freed with SDP_FreeDiscoveryDb, or
+ *                  NULL if one or more parameters are bad
+ *
+ ******************************************************************************/
+tSDP_DISCOVERY_DB* SDP_AllocDiscoveryDb(uint16_t num_uuid,
+                                        tSDP_UUID* p_uuid_list,
+                                        uint16_t num_attr,
+                                        uint16_t* p_attr_list) {
+  uint32_t len = sizeof(tSDP_DISCOVERY_DB) + SDP_DB_CHUNK_SIZE;
+  tSDP_DISCOVERY_DB* p_db = (tSDP_DISCOVERY_DB*)osi_malloc(len);
+
+  if (!SDP_InitDiscoveryDb(p_db, len, num_uuid, p_uuid_list, num_attr,
+                           p_attr_list)) {
+    osi_free(p_db);
+    return (NULL);
+  }
+
+  p_db->growable = true;
+  return (p_db);
+}
+
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees a discovery database allocated by
+ *                  SDP_AllocDiscoveryDb, with all the chunks it took.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db) {
+  if (p_db == NULL) return;
+
+  sdpu_free_db_chunks(p_db);
+  osi_free(p_db);
+}
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
@@ -164,6 +216,10 @@ bool SDP_ServiceSearchAttributeRequest(uint8_t* p_bd_addr,
                                        tSDP_DISC_CMPL_CB* p_cb) {
   tCONN_CB* p_ccb;
 
+  /* Answered without connecting if the device was asked the same before */
+  if (sdp_disc_start_from_cache(p_bd_addr, p_db, p_cb, NULL, NULL))
+    return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
@@ -197,6 +253,10 @@ bool SDP_ServiceSearchAttributeRequest2(uint8_t* p_bd_addr,
                                         void* user_data) {
   tCONN_CB* p_ccb;
 
+  /* Answered without connecting if the device was asked the same before */
+  if (sdp_disc_start_from_cache(p_bd_addr, p_db, NULL, p_cb2, user_data))
+    return (true);
+
   /* Specific BD address */
   p_ccb = sdp_conn_originate(p_bd_addr);
 
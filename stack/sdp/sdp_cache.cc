@@ -0,0 +1,328 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  this file contains the cache of the service search attribute responses
+ *  of the bonded devices
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include "bt_common.h"
+#include "bt_target.h"
+#include "osi/include/osi.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+#if (SDP_CACHE_SIZE > 0)
+
+/* A cached response: the attribute lists of the request whose UUID and
+ * attribute sequences make the key */
+typedef struct {
+  BD_ADDR bd_addr;
+  uint8_t* p_data; /* The key followed by the list, NULL if unused */
+  uint16_t key_len;
+  uint16_t list_len;
+  uint32_t stored_time; /* Wall clock time, in seconds */
+  uint32_t last_used;
+} tSDP_CACHE_ENTRY;
+
+/* Kept across the restarts of the stack, unlike sdp_cb */
+static tSDP_CACHE_ENTRY sdp_cache[SDP_CACHE_SIZE];
+static uint32_t sdp_cache_clock;
+static tSDP_CACHE_CBACK* sdp_cache_cb;
+
+/* The serialized entry header: the key length, the list length and the
+ * stored time */
+#define SDP_CACHE_HDR_LEN 8
+
+/******************************************************************************/
+/*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
+/******************************************************************************/
+static tSDP_CACHE_ENTRY* cache_find(BD_ADDR bd_addr, uint8_t* p_key,
+                                    uint16_t key_len);
+static void cache_put(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                      uint8_t* p_list, uint16_t list_len,
+                      uint32_t stored_time);
+static void cache_remove_entry(tSDP_CACHE_ENTRY* p_entry);
+static void cache_persist(BD_ADDR bd_addr);
+
+static uint32_t cache_now(void) { return (uint32_t)time(NULL); }
+
+static bool cache_is_expired(uint32_t stored_time) {
+  /* A clock set back makes the entry expire too */
+  uint32_t now = cache_now();
+  return (now < stored_time) || (now - stored_time >= SDP_CACHE_TTL_SEC);
+}
+
+/*******************************************************************************
+ *
+ * Function         SDP_SetCacheCallback
+ *
+ * Description      This function registers the callback given the cached
+ *                  responses of a device each time they change, to persist
+ *                  them.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_SetCacheCallback(tSDP_CACHE_CBACK* p_cb) { sdp_cache_cb = p_cb; }
+
+/*******************************************************************************
+ *
+ * Function         SDP_LoadCache
+ *
+ * Description      This function replaces the cached responses of a device
+ *                  with the ones given, as persisted from the cache
+ *                  callback. The expired ones are dropped.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_LoadCache(BD_ADDR bd_addr, uint8_t* p_data, uint16_t data_len) {
+  uint8_t* p = p_data;
+  uint8_t* p_end = p_data + data_len;
+  uint16_t xx, key_len, list_len;
+  uint32_t stored_time;
+
+  for (xx = 0; xx < SDP_CACHE_SIZE; xx++) {
+    if (sdp_cache[xx].p_data &&
+        !memcmp(sdp_cache[xx].bd_addr, bd_addr, BD_ADDR_LEN))
+      cache_remove_entry(&sdp_cache[xx]);
+  }
+
+  while (p_end - p >= SDP_CACHE_HDR_LEN) {
+    STREAM_TO_UINT16(key_len, p);
+    STREAM_TO_UINT16(list_len, p);
+    STREAM_TO_UINT32(stored_time, p);
+    if ((key_len == 0) || (list_len == 0) ||
+        (p_end - p < key_len + list_len)) {
+      SDP_TRACE_WARNING("%s: bad cache entry, key_len:%d list_len:%d",
+                        __func__, key_len, list_len);
+      return;
+    }
+
+    if (!cache_is_expired(stored_time))
+      cache_put(bd_addr, p, key_len, p + key_len, list_len, stored_time);
+    p += key_len + list_len;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         SDP_InvalidateCache
+ *
+ * Description      This function drops the cached responses of a device, so
+ *                  that its services are searched again.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_InvalidateCache(BD_ADDR bd_addr) {
+  uint16_t xx;
+  bool found = false;
+
+  for (xx = 0; xx < SDP_CACHE_SIZE; xx++) {
+    if (sdp_cache[xx].p_data &&
+        !memcmp(sdp_cache[xx].bd_addr, bd_addr, BD_ADDR_LEN)) {
+      cache_remove_entry(&sdp_cache[xx]);
+      found = true;
+    }
+  }
+
+  if (found) cache_persist(bd_addr);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_find
+ *
+ * Description      This function looks up the response of a device to the
+ *                  request made of the given key. An expired response is
+ *                  dropped.
+ *
+ * Returns          true if found, with the list returned in pp_list and
+ *                  p_list_len. The list is owned by the cache.
+ *
+ ******************************************************************************/
+bool sdp_cache_find(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                    uint8_t** pp_list, uint16_t* p_list_len) {
+  tSDP_CACHE_ENTRY* p_entry = cache_find(bd_addr, p_key, key_len);
+
+  if (!p_entry) return (false);
+
+  if (cache_is_expired(p_entry->stored_time)) {
+    cache_remove_entry(p_entry);
+    cache_persist(bd_addr);
+    return (false);
+  }
+
+  p_entry->last_used = ++sdp_cache_clock;
+  *pp_list = p_entry->p_data + p_entry->key_len;
+  *p_list_len = p_entry->list_len;
+  return (true);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_store
+ *
+ * Description      This function caches the response of a device to the
+ *                  request made of the given key, and persists it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_cache_store(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                     uint8_t* p_list, uint16_t list_len) {
+  cache_put(bd_addr, p_key, key_len, p_list, list_len, cache_now());
+  cache_persist(bd_addr);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_cache_remove
+ *
+ * Description      This function drops the response of a device to the
+ *                  request made of the given key, if cached.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_cache_remove(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len) {
+  tSDP_CACHE_ENTRY* p_entry = cache_find(bd_addr, p_key, key_len);
+
+  if (!p_entry) return;
+
+  cache_remove_entry(p_entry);
+  cache_persist(bd_addr);
+}
+
+static tSDP_CACHE_ENTRY* cache_find(BD_ADDR bd_addr, uint8_t* p_key,
+                                    uint16_t key_len) {
+  uint16_t xx;
+
+  for (xx = 0; xx < SDP_CACHE_SIZE; xx++) {
+    tSDP_CACHE_ENTRY* p_entry = &sdp_cache[xx];
+    if (p_entry->p_data && (p_entry->key_len == key_len) &&
+        !memcmp(p_entry->bd_addr, bd_addr, BD_ADDR_LEN) &&
+        !memcmp(p_entry->p_data, p_key, key_len))
+      return (p_entry);
+  }
+
+  return (NULL);
+}
+
+/* Replaces the entry of the same key, else an unused one, else the least
+ * recently used one */
+static void cache_put(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                      uint8_t* p_list, uint16_t list_len,
+                      uint32_t stored_time) {
+  tSDP_CACHE_ENTRY* p_entry = cache_find(bd_addr, p_key, key_len);
+  uint16_t xx;
+
+  if (!p_entry) {
+    p_entry = &sdp_cache[0];
+    for (xx = 0; xx < SDP_CACHE_SIZE && p_entry->p_data; xx++) {
+      if (!sdp_cache[xx].p_data ||
+          (sdp_cache[xx].last_used < p_entry->last_used))
+        p_entry = &sdp_cache[xx];
+    }
+  }
+
+  /* The device of an evicted entry is persisted again on its next change */
+  cache_remove_entry(p_entry);
+
+  memcpy(p_entry->bd_addr, bd_addr, BD_ADDR_LEN);
+  p_entry->p_data = (uint8_t*)osi_malloc(key_len + list_len);
+  memcpy(p_entry->p_data, p_key, key_len);
+  memcpy(p_entry->p_data + key_len, p_list, list_len);
+  p_entry->key_len = key_len;
+  p_entry->list_len = list_len;
+  p_entry->stored_time = stored_time;
+  p_entry->last_used = ++sdp_cache_clock;
+}
+
+static void cache_remove_entry(tSDP_CACHE_ENTRY* p_entry) {
+  osi_free(p_entry->p_data);
+  memset(p_entry, 0, sizeof(tSDP_CACHE_ENTRY));
+}
+
+/* Gives the cache callback all the entries of the device, serialized */
+static void cache_persist(BD_ADDR bd_addr) {
+  uint16_t xx;
+  uint32_t data_len = 0;
+  uint8_t *p_data, *p;
+
+  if (!sdp_cache_cb) return;
+
+  for (xx = 0; xx < SDP_CACHE_SIZE; xx++) {
+    if (sdp_cache[xx].p_data &&
+        !memcmp(sdp_cache[xx].bd_addr, bd_addr, BD_ADDR_LEN))
+      data_len += SDP_CACHE_HDR_LEN + sdp_cache[xx].key_len +
+                  sdp_cache[xx].list_len;
+  }
+
+  if (data_len > 0xFFFF) {
+    SDP_TRACE_WARNING("%s: %d bytes, too much to persist", __func__, data_len);
+    return;
+  }
+
+  p = p_data = (uint8_t*)osi_malloc(data_len + 1);
+  for (xx = 0; xx < SDP_CACHE_SIZE; xx++) {
+    tSDP_CACHE_ENTRY* p_entry = &sdp_cache[xx];
+    if (!p_entry->p_data || memcmp(p_entry->bd_addr, bd_addr, BD_ADDR_LEN))
+      continue;
+
+    UINT16_TO_STREAM(p, p_entry->key_len);
+    UINT16_TO_STREAM(p, p_entry->list_len);
+    UINT32_TO_STREAM(p, p_entry->stored_time);
+    ARRAY_TO_STREAM(p, p_entry->p_data, p_entry->key_len + p_entry->list_len);
+  }
+
+  (*sdp_cache_cb)(bd_addr, p_data, (uint16_t)data_len);
+  osi_free(p_data);
+}
+
+#else /* SDP_CACHE_SIZE == 0 */
+
+void SDP_SetCacheCallback(UNUSED_ATTR tSDP_CACHE_CBACK* p_cb) {}
+
+void SDP_LoadCache(UNUSED_ATTR BD_ADDR bd_addr, UNUSED_ATTR uint8_t* p_data,
+                   UNUSED_ATTR uint16_t data_len) {}
+
+void SDP_InvalidateCache(UNUSED_ATTR BD_ADDR bd_addr) {}
+
+bool sdp_cache_find(UNUSED_ATTR BD_ADDR bd_addr, UNUSED_ATTR uint8_t* p_key,
+                    UNUSED_ATTR uint16_t key_len,
+                    UNUSED_ATTR uint8_t** pp_list,
+                    UNUSED_ATTR uint16_t* p_list_len) {
+  return (false);
+}
+
+void sdp_cache_store(UNUSED_ATTR BD_ADDR bd_addr, UNUSED_ATTR uint8_t* p_key,
+                     UNUSED_ATTR uint16_t key_len, UNUSED_ATTR uint8_t* p_list,
+                     UNUSED_ATTR uint16_t list_len) {}
+
+void sdp_cache_remove(UNUSED_ATTR BD_ADDR bd_addr, UNUSED_ATTR uint8_t* p_key,
+                      UNUSED_ATTR uint16_t key_len) {}
+
+#endif /* SDP_CACHE_SIZE > 0 */
@@ -43,6 +43,12 @@
 /******************************************************************************/
 static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
                              uint16_t his_len, int nest_level);
+static bool rec_has_uuid(tSDP_RECORD* p_rec, tUID_ENT* p_uid,
+                         uint8_t* p_uuid128);
+static void index_uuid(tSDP_RECORD* p_rec, uint8_t* p_uuid, uint32_t len);
+static void index_uuids_in_seq(tSDP_RECORD* p_rec, uint8_t* p, uint32_t seq_len,
+                               int nest_level);
+static void sdp_db_index_uuids(tSDP_RECORD* p_rec);
 
 /*******************************************************************************
  *
@@ -56,9 +62,17 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
-  uint16_t xx, yy;
-  tSDP_ATTRIBUTE* p_attr;
+  uint16_t yy;
   tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  uint8_t uuids[MAX_UUIDS_PER_SEQ][MAX_UUID_SIZE];
+
+  /* Compare the UUIDs in their 128-bit form, as they are indexed. A UUID of
+   * an invalid length matches no record. */
+  for (yy = 0; yy < p_seq->num_uids; yy++) {
+    if (!sdpu_uuid_to_uuid128(&p_seq->uuid_entry[yy].value[0],
+                              p_seq->uuid_entry[yy].len, uuids[yy]))
+      return (NULL);
+  }
 
   /* If NULL, start at the beginning, else start at the first specified record
    */
@@ -71,22 +85,8 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
   /* the record contains all the passed UUIDs in it.                */
   for (; p_rec < p_end; p_rec++) {
     for (yy = 0; yy < p_seq->num_uids; yy++) {
-      p_attr = &p_rec->attribute[0];
-      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
-        if (p_attr->type == UUID_DESC_TYPE) {
-          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
-                                       &p_seq->uuid_entry[yy].value[0],
-                                       p_seq->uuid_entry[yy].len))
-            break;
-        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
-          if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
-                               &p_seq->uuid_entry[yy].value[0],
-                               p_seq->uuid_entry[yy].len, 0))
-            break;
-        }
-      }
       /* If any UUID was not found,  on to the next record */
-      if (xx == p_rec->num_attributes) break;
+      if (!rec_has_uuid(p_rec, &p_seq->uuid_entry[yy], uuids[yy])) break;
     }
 
     /* If every UUID was found in the record, return the record */
@@ -97,6 +97,46 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         rec_has_uuid
+ *
+ * Description      This function checks if a record contains a UUID, given
+ *                  as found in the request and in its 128-bit form. The UUIDs
+ *                  indexed are compared, or if they do not all fit, the
+ *                  attributes of the record are searched.
+ *
+ * Returns          true if found, else false
+ *
+ ******************************************************************************/
+static bool rec_has_uuid(tSDP_RECORD* p_rec, tUID_ENT* p_uid,
+                         uint8_t* p_uuid128) {
+  uint16_t xx;
+  tSDP_ATTRIBUTE* p_attr;
+
+  if (!p_rec->uuids_overflow) {
+    for (xx = 0; xx < p_rec->num_uuids; xx++) {
+      if (memcmp(p_rec->uuids[xx], p_uuid128, MAX_UUID_SIZE) == 0)
+        return (true);
+    }
+    return (false);
+  }
+
+  p_attr = &p_rec->attribute[0];
+  for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+    if (p_attr->type == UUID_DESC_TYPE) {
+      if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
+                                   &p_uid->value[0], p_uid->len))
+        return (true);
+    } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+      if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len, &p_uid->value[0],
+                           p_uid->len, 0))
+        return (true);
+    }
+  }
+  return (false);
+}
+
 /*******************************************************************************
  *
  * Function         find_uuid_in_seq
@@ -132,6 +172,91 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
   return (false);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_uuids
+ *
+ * Description      This function indexes the UUIDs of a record, the ones
+ *                  searched by find_uuid_in_seq included. It is called each
+ *                  time the attributes of the record are changed.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_uuids(tSDP_RECORD* p_rec) {
+  uint16_t xx;
+  tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
+
+  p_rec->num_uuids = 0;
+  p_rec->uuids_overflow = false;
+
+  for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+    if (p_attr->type == UUID_DESC_TYPE)
+      index_uuid(p_rec, p_attr->value_ptr, p_attr->len);
+    else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE)
+      index_uuids_in_seq(p_rec, p_attr->value_ptr, p_attr->len, 0);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         index_uuids_in_seq
+ *
+ * Description      This function indexes the UUIDs of a data element
+ *                  sequence, down to the nesting level find_uuid_in_seq
+ *                  searches.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void index_uuids_in_seq(tSDP_RECORD* p_rec, uint8_t* p, uint32_t seq_len,
+                               int nest_level) {
+  uint8_t* p_end = p + seq_len;
+  uint8_t type;
+  uint32_t len;
+
+  if (nest_level > 3) return;
+
+  while (p < p_end) {
+    type = *p++;
+    p = sdpu_get_len_from_type(p, type, &len);
+    type = type >> 3;
+    if (type == UUID_DESC_TYPE)
+      index_uuid(p_rec, p, len);
+    else if (type == DATA_ELE_SEQ_DESC_TYPE)
+      index_uuids_in_seq(p_rec, p, len, nest_level + 1);
+    p = p + len;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         index_uuid
+ *
+ * Description      This function adds a UUID to the index of a record, unless
+ *                  already there. A UUID of an invalid length is not added, as
+ *                  it matches no UUID.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void index_uuid(tSDP_RECORD* p_rec, uint8_t* p_uuid, uint32_t len) {
+  uint8_t uuid128[MAX_UUID_SIZE];
+  uint16_t xx;
+
+  if (!sdpu_uuid_to_uuid128(p_uuid, len, uuid128)) return;
+
+  for (xx = 0; xx < p_rec->num_uuids; xx++) {
+    if (memcmp(p_rec->uuids[xx], uuid128, MAX_UUID_SIZE) == 0) return;
+  }
+
+  if (p_rec->num_uuids == SDP_MAX_REC_UUIDS) {
+    p_rec->uuids_overflow = true;
+    return;
+  }
+  memcpy(p_rec->uuids[p_rec->num_uuids++], uuid128, MAX_UUID_SIZE);
+}
+
 /*******************************************************************************
  *
  * Function         sdp_db_find_record
@@ -267,6 +392,7 @@ uint32_t SDP_CreateRecord(void) {
     p_db->record[p_db->num_records].record_handle = handle;
 
     p_db->num_records++;
+    p_db->generation++;
     SDP_TRACE_DEBUG("SDP_CreateRecord ok, num_records:%d", p_db->num_records);
     /* Add the first attribute (the handle) automatically */
     UINT32_TO_BE_FIELD(buf, handle);
@@ -302,6 +428,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
   if (handle == 0 || sdp_cb.server_db.num_records == 0) {
     /* Delete all records in the database */
     sdp_cb.server_db.num_records = 0;
+    sdp_cb.server_db.generation++;
 
     /* require new DI record to be created in SDP_SetLocalDiRecord */
     sdp_cb.server_db.di_primary_handle = 0;
@@ -321,6 +448,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
         }
 
         sdp_cb.server_db.num_records--;
+        sdp_cb.server_db.generation++;
 
         SDP_TRACE_DEBUG("SDP_DeleteRecord ok, num_records:%d",
                         sdp_cb.server_db.num_records);
@@ -446,9 +574,13 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
             "SDP_AddAttribute fail, length exceed maximum: ID %d: attr_len:%d ",
             attr_id, attr_len);
         p_attr->id = p_attr->type = p_attr->len = 0;
+        sdp_cb.server_db.generation++;
+        sdp_db_index_uuids(p_rec);
         return (false);
       }
       p_rec->num_attributes++;
+      sdp_cb.server_db.generation++;
+      sdp_db_index_uuids(p_rec);
       return (true);
     }
   }
@@ -830,6 +962,8 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
             for (yy = 0; yy < xx; yy++, pad_ptr++) *pad_ptr = *(pad_ptr + len);
             p_rec->free_pad_ptr -= len;
           }
+          sdp_cb.server_db.generation++;
+          sdp_db_index_uuids(p_rec);
           return (true);
         }
       }
@@ -29,6 +29,7 @@
 #include "bt_common.h"
 #include "bt_target.h"
 #include "btm_api.h"
+#include "btm_int.h"
 #include "btu.h"
 #include "hcidefs.h"
 #include "hcimsgs.h"
@@ -51,10 +52,19 @@ static tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db, BD_ADDR p_bda);
 static uint8_t* add_attr(uint8_t* p, tSDP_DISCOVERY_DB* p_db,
                          tSDP_DISC_REC* p_rec, uint16_t attr_id,
                          tSDP_DISC_ATTR* p_parent_attr, uint8_t nest_level);
+static uint16_t save_search_attr_list(tCONN_CB* p_ccb);
+static uint16_t build_cache_key(tSDP_DISCOVERY_DB* p_db, uint8_t* p_key);
+static void sdp_disc_cached_rsp(void* data);
 
 /* Safety check in case we go crazy */
 #define MAX_NEST_LEVELS 5
 
+/* The longest cache key: the UUID sequence and the attribute sequence of the
+ * service search attribute request */
+#define SDP_CACHE_KEY_MAX_LEN                                  \
+  (2 + SDP_MAX_UUID_FILTERS * (1 + MAX_UUID_SIZE) + 3 + 5 + \
+   SDP_MAX_ATTR_FILTERS * 3)
+
 extern fixed_queue_t* btu_general_alarm_queue;
 
 /*******************************************************************************
@@ -622,6 +632,39 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply) {
 /* We now have the full response, which is a sequence of sequences */
 /*******************************************************************/
 
+  uint16_t reason = save_search_attr_list(p_ccb);
+
+  /* Keep the response of a bonded device to answer the same request made
+   * again without connecting. One with no record is not, as the device may
+   * not have registered its services yet. */
+  if ((reason == SDP_SUCCESS) && (p_ccb->p_db->p_first_rec) &&
+      btm_sec_is_a_bonded_dev(p_ccb->device_address)) {
+    uint8_t key[SDP_CACHE_KEY_MAX_LEN];
+    uint16_t key_len = build_cache_key(p_ccb->p_db, key);
+    sdp_cache_store(p_ccb->device_address, key, key_len, p_ccb->rsp_list,
+                    p_ccb->list_len);
+  }
+
+  /* Since we got everything we need, disconnect the call */
+  sdp_disconnect(p_ccb, reason);
+}
+
+/*******************************************************************************
+ *
+ * Function         save_search_attr_list
+ *
+ * Description      This function saves the full service search attribute
+ *                  response, a sequence of attribute sequences, to the
+ *                  discovery database.
+ *
+ * Returns          SDP_SUCCESS if saved, else the error
+ *
+ ******************************************************************************/
+static uint16_t save_search_attr_list(tCONN_CB* p_ccb) {
+  uint8_t *p, *p_end;
+  uint8_t type;
+  uint32_t seq_len;
+
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   SDP_TRACE_WARNING("process_service_search_attr_rsp");
   sdp_copy_raw_data(p_ccb, true);
@@ -634,27 +677,121 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply) {
 
   if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE) {
     SDP_TRACE_WARNING("SDP - Wrong type: 0x%02x in attr_rsp", type);
-    return;
+    return (SDP_INVALID_PDU);
   }
   p = sdpu_get_len_from_type(p, type, &seq_len);
 
   p_end = &p_ccb->rsp_list[p_ccb->list_len];
 
-  if ((p + seq_len) != p_end) {
-    sdp_disconnect(p_ccb, SDP_INVALID_CONT_STATE);
-    return;
-  }
+  if ((p + seq_len) != p_end) return (SDP_INVALID_CONT_STATE);
 
   while (p < p_end) {
     p = save_attr_seq(p_ccb, p, &p_ccb->rsp_list[p_ccb->list_len]);
-    if (!p) {
-      sdp_disconnect(p_ccb, SDP_DB_FULL);
-      return;
-    }
+    if (!p) return (SDP_DB_FULL);
   }
 
-  /* Since we got everything we need, disconnect the call */
-  sdp_disconnect(p_ccb, SDP_SUCCESS);
+  return (SDP_SUCCESS);
+}
+
+/*******************************************************************************
+ *
+ * Function         build_cache_key
+ *
+ * Description      This function builds the cache key of the service search
+ *                  attribute request of a discovery database: its UUID and
+ *                  attribute sequences, as sent.
+ *
+ * Returns          the length of the key, at most SDP_CACHE_KEY_MAX_LEN
+ *
+ ******************************************************************************/
+static uint16_t build_cache_key(tSDP_DISCOVERY_DB* p_db, uint8_t* p_key) {
+  uint8_t* p = p_key;
+
+  p = sdpu_build_uuid_seq(p, p_db->num_uuid_filters, p_db->uuid_filters);
+  if (p_db->num_attr_filters)
+    p = sdpu_build_attrib_seq(p, p_db->attr_filters, p_db->num_attr_filters);
+  else
+    p = sdpu_build_attrib_seq(p, NULL, 0);
+
+  return (uint16_t)(p - p_key);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_start_from_cache
+ *
+ * Description      This function starts a service search attribute request
+ *                  answered from the cache, if it holds the response of the
+ *                  device to the same request. The response is saved to the
+ *                  discovery database and the callback called from the
+ *                  timer of the connection control block, as they would be
+ *                  once a connection answered it.
+ *
+ * Returns          true if started, else false
+ *
+ ******************************************************************************/
+bool sdp_disc_start_from_cache(uint8_t* p_bd_addr, tSDP_DISCOVERY_DB* p_db,
+                               tSDP_DISC_CMPL_CB* p_cb,
+                               tSDP_DISC_CMPL_CB2* p_cb2, void* user_data) {
+  uint8_t key[SDP_CACHE_KEY_MAX_LEN];
+  uint16_t key_len = build_cache_key(p_db, key);
+  uint8_t* p_list;
+  uint16_t list_len;
+  tCONN_CB* p_ccb;
+
+  if (!sdp_cache_find(p_bd_addr, key, key_len, &p_list, &list_len))
+    return (false);
+
+  p_ccb = sdpu_allocate_ccb();
+  if (p_ccb == NULL) return (false);
+
+  SDP_TRACE_EVENT("SDP - search attributes answered from the cache");
+
+  memcpy(&p_ccb->device_address[0], p_bd_addr, sizeof(BD_ADDR));
+  p_ccb->con_flags |= SDP_FLAGS_IS_ORIG;
+
+  /* With no connection ID, sdp_disconnect completes it at once, whether
+   * answered or cancelled before */
+  p_ccb->con_state = SDP_STATE_CONN_SETUP;
+  p_ccb->disc_state = SDP_DISC_WAIT_SEARCH_ATTR;
+  p_ccb->is_attr_search = true;
+  p_ccb->p_db = p_db;
+  p_ccb->p_cb = p_cb;
+  p_ccb->p_cb2 = p_cb2;
+  p_ccb->user_data = user_data;
+
+  p_ccb->rsp_list = (uint8_t*)osi_malloc(list_len);
+  memcpy(p_ccb->rsp_list, p_list, list_len);
+  p_ccb->list_len = list_len;
+
+  alarm_set_on_queue(p_ccb->sdp_conn_timer, 0, sdp_disc_cached_rsp, p_ccb,
+                     btu_general_alarm_queue);
+  return (true);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_disc_cached_rsp
+ *
+ * Description      This function is called from the timer of a request
+ *                  answered from the cache, to save the response. A response
+ *                  that cannot be saved is dropped from the cache, for the
+ *                  next request to connect.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_disc_cached_rsp(void* data) {
+  tCONN_CB* p_ccb = (tCONN_CB*)data;
+  uint16_t reason = save_search_attr_list(p_ccb);
+
+  if (reason != SDP_SUCCESS) {
+    uint8_t key[SDP_CACHE_KEY_MAX_LEN];
+    uint16_t key_len = build_cache_key(p_ccb->p_db, key);
+    sdp_cache_remove(p_ccb->device_address, key, key_len);
+  }
+
+  sdp_disconnect(p_ccb, reason);
 }
 
 /*******************************************************************************
@@ -706,6 +843,19 @@ static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
     }
     BE_STREAM_TO_UINT16(attr_id, p);
 
+    /* Skip the value of an attribute that was not asked for, rather than
+     * copying it to the DB */
+    if (!sdpu_is_attr_wanted(p_ccb->p_db, attr_id)) {
+      type = *p++;
+      p = sdpu_get_len_from_type(p, type, &attr_len);
+      if ((type >> 3) != NULL_DESC_TYPE) p += attr_len;
+      if (p > p_seq_end) {
+        SDP_TRACE_WARNING("SDP - Bad len: %d in attr_rsp", attr_len);
+        return (NULL);
+      }
+      continue;
+    }
+
     /* Now, add the attribute value */
     p = add_attr(p, p_ccb->p_db, p_rec, attr_id, NULL, 0);
 
@@ -731,7 +881,7 @@ tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db, BD_ADDR p_bda) {
   tSDP_DISC_REC* p_rec;
 
   /* See if there is enough space in the database */
-  if (p_db->mem_free < sizeof(tSDP_DISC_REC)) return (NULL);
+  if (!sdpu_db_reserve(p_db, sizeof(tSDP_DISC_REC))) return (NULL);
 
   p_rec = (tSDP_DISC_REC*)p_db->p_free_mem;
   p_db->p_free_mem += sizeof(tSDP_DISC_REC);
@@ -796,8 +946,14 @@ static uint8_t* add_attr(uint8_t* p, tSDP_DISCOVERY_DB* p_db,
   /* Ensure it is a multiple of 4 */
   total_len = (total_len + 3) & ~3;
 
-  /* See if there is enough space in the database */
-  if (p_db->mem_free < total_len) return (NULL);
+  /* See if there is enough space in the database. A growable one only needs
+   * room for the header of a sequence now, its entries take their own. */
+  if (p_db->growable && ((attr_type == DATA_ELE_SEQ_DESC_TYPE) ||
+                         (attr_type == DATA_ELE_ALT_DESC_TYPE))) {
+    if (!sdpu_db_reserve(p_db, sizeof(tSDP_DISC_ATTR))) return (NULL);
+  } else if (!sdpu_db_reserve(p_db, total_len)) {
+    return (NULL);
+  }
 
   p_attr = (tSDP_DISC_ATTR*)p_db->p_free_mem;
   p_attr->attr_id = attr_id;
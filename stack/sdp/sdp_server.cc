@@ -64,6 +64,13 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                             uint16_t param_len, uint8_t* p_req,
                                             UNUSED_ATTR uint8_t* p_req_end);
 
+static void get_search_attr_list(tCONN_CB* p_ccb, tSDP_UUID_SEQ* p_uid_seq,
+                                 tSDP_ATTR_SEQ* p_attr_seq);
+
+static uint8_t* build_search_attr_list(tSDP_UUID_SEQ* p_uid_seq,
+                                       tSDP_ATTR_SEQ* p_attr_seq,
+                                       uint16_t* p_list_len);
+
 /******************************************************************************/
 /*                E R R O R   T E X T   S T R I N G S                         */
 /*                                                                            */
@@ -346,6 +353,7 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   /* Free and reallocate buffer */
   osi_free(p_ccb->rsp_list);
   p_ccb->rsp_list = (uint8_t*)osi_malloc(max_list_len);
+  p_ccb->cont_info.whole_list = false;
 
   /* Check if this is a continuation request */
   if (*p_req) {
@@ -372,7 +380,6 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     p_rsp = &p_ccb->rsp_list[3]; /* Leave space for data elem descr */
 
     /* Reset continuation parameters in p_ccb */
-    p_ccb->cont_info.prev_sdp_rec = NULL;
     p_ccb->cont_info.next_attr_index = 0;
     p_ccb->cont_info.attr_offset = 0;
   }
@@ -509,6 +516,12 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
  *                  message with info from the database, and sends the reply
  *                  back to the client.
  *
+ *                  The whole attribute list is built, or taken from the cache,
+ *                  with the first response, and the continuations send the
+ *                  rest of it. They so make progress even if the records are
+ *                  changed in between, which used to leave the client
+ *                  requesting the same continuation again and again.
+ *
  * Returns          void
  *
  ******************************************************************************/
@@ -516,17 +529,11 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                             uint16_t param_len, uint8_t* p_req,
                                             UNUSED_ATTR uint8_t* p_req_end) {
   uint16_t max_list_len;
-  int16_t rem_len;
   uint16_t len_to_send, cont_offset;
   tSDP_UUID_SEQ uid_seq;
   uint8_t *p_rsp, *p_rsp_start, *p_rsp_param_len;
-  uint16_t rsp_param_len, xx;
-  tSDP_RECORD* p_rec;
-  tSDP_ATTR_SEQ attr_seq, attr_seq_sav;
-  tSDP_ATTRIBUTE* p_attr;
-  bool maxxed_out = false, is_cont = false;
-  uint8_t* p_seq_start;
-  uint16_t seq_len, attr_len;
+  uint16_t rsp_param_len;
+  tSDP_ATTR_SEQ attr_seq;
 
   /* Extract the UUID sequence to search for */
   p_req = sdpu_extract_uid_seq(p_req, param_len, &uid_seq);
@@ -551,12 +558,6 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     return;
   }
 
-  memcpy(&attr_seq_sav, &attr_seq, sizeof(tSDP_ATTR_SEQ));
-
-  /* Free and reallocate buffer */
-  osi_free(p_ccb->rsp_list);
-  p_ccb->rsp_list = (uint8_t*)osi_malloc(max_list_len);
-
   /* Check if this is a continuation request */
   if (*p_req) {
     if (*p_req++ != SDP_CONTINUATION_LEN) {
@@ -566,183 +567,28 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     }
     BE_STREAM_TO_UINT16(cont_offset, p_req);
 
-    if (cont_offset != p_ccb->cont_offset) {
+    if ((cont_offset != p_ccb->cont_offset) ||
+        (!p_ccb->cont_info.whole_list) || (cont_offset >= p_ccb->list_len)) {
       sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE,
                               SDP_TEXT_BAD_CONT_INX);
       return;
     }
-    is_cont = true;
-
-    /* Initialise for continuation response */
-    p_rsp = &p_ccb->rsp_list[0];
-    attr_seq.attr_entry[p_ccb->cont_info.next_attr_index].start =
-        p_ccb->cont_info.next_attr_start_id;
   } else {
+    get_search_attr_list(p_ccb, &uid_seq, &attr_seq);
     p_ccb->cont_offset = 0;
-    p_rsp = &p_ccb->rsp_list[3]; /* Leave space for data elem descr */
-
-    /* Reset continuation parameters in p_ccb */
-    p_ccb->cont_info.prev_sdp_rec = NULL;
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
-    p_ccb->cont_info.attr_offset = 0;
-  }
-
-  /* Get a list of handles that match the UUIDs given to us */
-  for (p_rec = sdp_db_service_search(p_ccb->cont_info.prev_sdp_rec, &uid_seq);
-       p_rec; p_rec = sdp_db_service_search(p_rec, &uid_seq)) {
-    /* Allow space for attribute sequence type and length */
-    p_seq_start = p_rsp;
-    if (p_ccb->cont_info.last_attr_seq_desc_sent == false) {
-      /* See if there is enough room to include a new service in the current
-       * response */
-      rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-      if (rem_len < 3) {
-        /* Not enough room. Update continuation info for next response */
-        p_ccb->cont_info.next_attr_index = 0;
-        p_ccb->cont_info.next_attr_start_id = attr_seq.attr_entry[0].start;
-        break;
-      }
-      p_rsp += 3;
-    }
-
-    /* Get a list of handles that match the UUIDs given to us */
-    for (xx = p_ccb->cont_info.next_attr_index; xx < attr_seq.num_attr; xx++) {
-      p_attr = sdp_db_find_attr_in_rec(p_rec, attr_seq.attr_entry[xx].start,
-                                       attr_seq.attr_entry[xx].end);
-
-      if (p_attr) {
-        /* Check if attribute fits. Assume 3-byte value type/length */
-        rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-
-        /* just in case */
-        if (rem_len <= 0) {
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        }
-
-        attr_len = sdpu_get_attrib_entry_len(p_attr);
-        /* if there is a partial attribute pending to be sent */
-        if (p_ccb->cont_info.attr_offset) {
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, rem_len, &p_ccb->cont_info.attr_offset);
-
-          /* If the partial attrib could not been fully added yet */
-          if (p_ccb->cont_info.attr_offset != attr_len) {
-            maxxed_out = true;
-            break;
-          } else /* If the partial attrib has been added in full by now */
-            p_ccb->cont_info.attr_offset = 0; /* reset attr_offset */
-        } else if (rem_len <
-                   attr_len) /* Not enough space for attr... so add partially */
-        {
-          if (attr_len >= SDP_MAX_ATTR_LEN) {
-            SDP_TRACE_ERROR("SDP attr too big: max_list_len=%d,attr_len=%d",
-                            max_list_len, attr_len);
-            sdpu_build_n_send_error(p_ccb, trans_num, SDP_NO_RESOURCES, NULL);
-            return;
-          }
-
-          /* add the partial attribute if possible */
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, (uint16_t)rem_len, &p_ccb->cont_info.attr_offset);
-
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        } else /* build the whole attribute */
-          p_rsp = sdpu_build_attrib_entry(p_rsp, p_attr);
-
-        /* If doing a range, stick with this one till no more attributes found
-         */
-        if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end) {
-          /* Update for next time through */
-          attr_seq.attr_entry[xx].start = p_attr->id + 1;
-
-          xx--;
-        }
-      }
-    }
-
-    /* Go back and put the type and length into the buffer */
-    if (p_ccb->cont_info.last_attr_seq_desc_sent == false) {
-      seq_len = sdpu_get_attrib_seq_len(p_rec, &attr_seq_sav);
-      if (seq_len != 0) {
-        UINT8_TO_BE_STREAM(p_seq_start,
-                           (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-        UINT16_TO_BE_STREAM(p_seq_start, seq_len);
-
-        if (maxxed_out) p_ccb->cont_info.last_attr_seq_desc_sent = true;
-      } else
-        p_rsp = p_seq_start;
-    }
-
-    if (maxxed_out) break;
-
-    /* Restore the attr_seq to look for in the next sdp record */
-    memcpy(&attr_seq, &attr_seq_sav, sizeof(tSDP_ATTR_SEQ));
-
-    /* Reset the next attr index */
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.prev_sdp_rec = p_rec;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
+    p_ccb->cont_info.whole_list = true;
   }
 
   /* response length */
-  len_to_send = (uint16_t)(p_rsp - &p_ccb->rsp_list[0]);
-  cont_offset = 0;
+  len_to_send = p_ccb->list_len - p_ccb->cont_offset;
+  if (len_to_send > max_list_len) len_to_send = max_list_len;
 
-  // The current SDP server design has a critical flaw where it can run into
-  // an infinite request/response loop with the client. Here's the scenario:
-  // - client makes SDP request
-  // - server returns the first fragment of the response with a continuation
-  //   token
-  // - an SDP record is deleted from the server
-  // - client issues another request with previous continuation token
-  // - server has nothing to send back because the record is unavailable but
-  //   in the first fragment, it had specified more response bytes than are
-  //   now available
-  // - server sends back no additional response bytes and returns the same
-  //   continuation token
-  // - client issues another request with the continuation token, and the
-  //   process repeats
-  //
-  // We work around this design flaw here by checking if we will make forward
-  // progress (i.e. we will send > 0 response bytes) on a continued request.
-  // If not, we must have run into the above situation and we tell the peer an
-  // error occurred.
-  //
-  // TODO(sharvil): rewrite SDP server.
-  if (is_cont && len_to_send == 0) {
-    sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE, NULL);
+  /* No room for any of the list: the client would never get the rest */
+  if (len_to_send == 0) {
+    sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_REQ_SYNTAX, NULL);
     return;
   }
 
-  /* If first response, insert sequence header */
-  if (!is_cont) {
-    /* Get the total list length for requested uid and attribute sequence */
-    p_ccb->list_len = sdpu_get_list_len(&uid_seq, &attr_seq_sav) + 3;
-    /* Put in the sequence header (2 or 3 bytes) */
-    if (p_ccb->list_len > 255) {
-      p_ccb->rsp_list[0] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-      p_ccb->rsp_list[1] = (uint8_t)((p_ccb->list_len - 3) >> 8);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-    } else {
-      cont_offset = 1;
-
-      p_ccb->rsp_list[1] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-
-      p_ccb->list_len--;
-      len_to_send--;
-    }
-  }
-
   /* Get a buffer to use to build the response */
   BT_HDR* p_buf = (BT_HDR*)osi_malloc(SDP_DATA_BUF_SIZE);
   p_buf->offset = L2CAP_MIN_OFFSET;
@@ -760,15 +606,13 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   UINT16_TO_BE_STREAM(p_rsp, len_to_send);
 
   /* copy from rsp_list to the actual buffer to be sent */
-  memcpy(p_rsp, &p_ccb->rsp_list[cont_offset], len_to_send);
+  memcpy(p_rsp, &p_ccb->rsp_list[p_ccb->cont_offset], len_to_send);
   p_rsp += len_to_send;
 
   p_ccb->cont_offset += len_to_send;
 
   /* If anything left to send, continuation needed */
   if (p_ccb->cont_offset < p_ccb->list_len) {
-    is_cont = true;
-
     UINT8_TO_BE_STREAM(p_rsp, SDP_CONTINUATION_LEN);
     UINT16_TO_BE_STREAM(p_rsp, p_ccb->cont_offset);
   } else
@@ -785,4 +629,216 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   L2CA_DataWrite(p_ccb->connection_id, p_buf);
 }
 
+#if (SDP_SERVER_RSP_CACHE_SIZE > 0)
+/*******************************************************************************
+ *
+ * Function         rsp_cache_is_current
+ *
+ * Description      This function checks if a cache entry holds a list built
+ *                  from the database as it is now.
+ *
+ * Returns          true if current, else false
+ *
+ ******************************************************************************/
+static bool rsp_cache_is_current(tSDP_RSP_CACHE* p_entry) {
+  return (p_entry->p_list != NULL) &&
+         (p_entry->db_generation == sdp_cb.server_db.generation);
+}
+
+/*******************************************************************************
+ *
+ * Function         rsp_cache_matches
+ *
+ * Description      This function checks if a cache entry holds the list of
+ *                  the given UUID and attribute sequences.
+ *
+ * Returns          true if matched, else false
+ *
+ ******************************************************************************/
+static bool rsp_cache_matches(tSDP_RSP_CACHE* p_entry,
+                              tSDP_UUID_SEQ* p_uid_seq,
+                              tSDP_ATTR_SEQ* p_attr_seq) {
+  uint16_t xx;
+
+  if ((p_entry->uid_seq.num_uids != p_uid_seq->num_uids) ||
+      (p_entry->attr_seq.num_attr != p_attr_seq->num_attr))
+    return (false);
+
+  for (xx = 0; xx < p_uid_seq->num_uids; xx++) {
+    tUID_ENT* p_uid = &p_uid_seq->uuid_entry[xx];
+    if ((p_entry->uid_seq.uuid_entry[xx].len != p_uid->len) ||
+        (memcmp(p_entry->uid_seq.uuid_entry[xx].value, p_uid->value,
+                p_uid->len) != 0))
+      return (false);
+  }
+
+  for (xx = 0; xx < p_attr_seq->num_attr; xx++) {
+    if ((p_entry->attr_seq.attr_entry[xx].start !=
+         p_attr_seq->attr_entry[xx].start) ||
+        (p_entry->attr_seq.attr_entry[xx].end !=
+         p_attr_seq->attr_entry[xx].end))
+      return (false);
+  }
+
+  return (true);
+}
+
+/*******************************************************************************
+ *
+ * Function         rsp_cache_store
+ *
+ * Description      This function keeps a copy of the list of the given UUID
+ *                  and attribute sequences in a cache entry.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void rsp_cache_store(tSDP_RSP_CACHE* p_entry, tSDP_UUID_SEQ* p_uid_seq,
+                            tSDP_ATTR_SEQ* p_attr_seq, uint8_t* p_list,
+                            uint16_t list_len) {
+  uint16_t xx;
+
+  osi_free(p_entry->p_list);
+  memset(p_entry, 0, sizeof(tSDP_RSP_CACHE));
+
+  p_entry->p_list = (uint8_t*)osi_malloc(list_len);
+  memcpy(p_entry->p_list, p_list, list_len);
+  p_entry->list_len = list_len;
+  p_entry->db_generation = sdp_cb.server_db.generation;
+  p_entry->last_used = ++sdp_cb.rsp_cache_clock;
+
+  /* Only the entries in use are compared */
+  p_entry->uid_seq.num_uids = p_uid_seq->num_uids;
+  for (xx = 0; xx < p_uid_seq->num_uids; xx++)
+    p_entry->uid_seq.uuid_entry[xx] = p_uid_seq->uuid_entry[xx];
+  p_entry->attr_seq.num_attr = p_attr_seq->num_attr;
+  for (xx = 0; xx < p_attr_seq->num_attr; xx++)
+    p_entry->attr_seq.attr_entry[xx] = p_attr_seq->attr_entry[xx];
+}
+#endif /* SDP_SERVER_RSP_CACHE_SIZE > 0 */
+
+/*******************************************************************************
+ *
+ * Function         get_search_attr_list
+ *
+ * Description      This function gets the attribute list of a service search
+ *                  attribute request into the response list of the
+ *                  connection, from the cache if it holds it for the database
+ *                  as it is now, else built and then cached. The least
+ *                  recently used entry of the cache is replaced, unless one
+ *                  is unused or out of date.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void get_search_attr_list(tCONN_CB* p_ccb, tSDP_UUID_SEQ* p_uid_seq,
+                                 tSDP_ATTR_SEQ* p_attr_seq) {
+  osi_free_and_reset((void**)&p_ccb->rsp_list);
+
+#if (SDP_SERVER_RSP_CACHE_SIZE > 0)
+  tSDP_RSP_CACHE* p_victim = &sdp_cb.rsp_cache[0];
+  uint16_t xx;
+
+  for (xx = 0; xx < SDP_SERVER_RSP_CACHE_SIZE; xx++) {
+    tSDP_RSP_CACHE* p_entry = &sdp_cb.rsp_cache[xx];
+
+    if (!rsp_cache_is_current(p_entry)) {
+      if (rsp_cache_is_current(p_victim)) p_victim = p_entry;
+      continue;
+    }
+
+    if (rsp_cache_matches(p_entry, p_uid_seq, p_attr_seq)) {
+      p_entry->last_used = ++sdp_cb.rsp_cache_clock;
+      p_ccb->rsp_list = (uint8_t*)osi_malloc(p_entry->list_len);
+      memcpy(p_ccb->rsp_list, p_entry->p_list, p_entry->list_len);
+      p_ccb->list_len = p_entry->list_len;
+      return;
+    }
+
+    if (rsp_cache_is_current(p_victim) &&
+        (p_entry->last_used < p_victim->last_used))
+      p_victim = p_entry;
+  }
+
+  p_ccb->rsp_list =
+      build_search_attr_list(p_uid_seq, p_attr_seq, &p_ccb->list_len);
+  rsp_cache_store(p_victim, p_uid_seq, p_attr_seq, p_ccb->rsp_list,
+                  p_ccb->list_len);
+#else
+  p_ccb->rsp_list =
+      build_search_attr_list(p_uid_seq, p_attr_seq, &p_ccb->list_len);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * Function         build_search_attr_list
+ *
+ * Description      This function builds the whole attribute list of a service
+ *                  search attribute request: a sequence of the attributes of
+ *                  each record found, with a 2 or 3 byte sequence header, as
+ *                  counted by sdpu_get_list_len.
+ *
+ * Returns          Pointer to the list, to be freed by the caller. Its length
+ *                  is returned in p_list_len.
+ *
+ ******************************************************************************/
+static uint8_t* build_search_attr_list(tSDP_UUID_SEQ* p_uid_seq,
+                                       tSDP_ATTR_SEQ* p_attr_seq,
+                                       uint16_t* p_list_len) {
+  uint16_t seq_len = sdpu_get_list_len(p_uid_seq, p_attr_seq);
+  bool is_long = (seq_len + 3 > 255);
+  uint16_t list_len = seq_len + (is_long ? 3 : 2);
+  uint8_t* p_list = (uint8_t*)osi_malloc(list_len);
+  uint8_t* p = p_list;
+  tSDP_RECORD* p_rec;
+  tSDP_ATTRIBUTE* p_attr;
+  uint16_t rec_len, xx;
+  uint16_t start_id = 0, end_id = 0;
+  bool is_range;
+
+  /* Put in the sequence header (2 or 3 bytes) */
+  if (is_long) {
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+    UINT16_TO_BE_STREAM(p, seq_len);
+  } else {
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    UINT8_TO_BE_STREAM(p, seq_len);
+  }
+
+  for (p_rec = sdp_db_service_search(NULL, p_uid_seq); p_rec;
+       p_rec = sdp_db_service_search(p_rec, p_uid_seq)) {
+    rec_len = sdpu_get_attrib_seq_len(p_rec, p_attr_seq);
+    if (rec_len == 0) continue;
+
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+    UINT16_TO_BE_STREAM(p, rec_len);
+
+    /* The attributes in the order sdpu_get_attrib_seq_len counts them */
+    is_range = false;
+    for (xx = 0; xx < p_attr_seq->num_attr; xx++) {
+      if (is_range == false) {
+        start_id = p_attr_seq->attr_entry[xx].start;
+        end_id = p_attr_seq->attr_entry[xx].end;
+      }
+      p_attr = sdp_db_find_attr_in_rec(p_rec, start_id, end_id);
+      is_range = false;
+      if (!p_attr) continue;
+
+      p = sdpu_build_attrib_entry(p, p_attr);
+
+      /* If doing a range, stick with this one till no more attributes found */
+      if (start_id != end_id) {
+        /* Update for next time through */
+        start_id = p_attr->id + 1;
+        xx--;
+        is_range = true;
+      }
+    }
+  }
+
+  *p_list_len = list_len;
+  return (p_list);
+}
+
 #endif /* SDP_SERVER_ENABLED == TRUE */
@@ -740,6 +740,80 @@ void sdpu_sort_attr_list(uint16_t num_attr, tSDP_DISCOVERY_DB* p_db) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         sdpu_is_attr_wanted
+ *
+ * Description      This function checks if an attribute passes the sorted
+ *                  attribute filters of the discovery database, which keep
+ *                  them all if empty.
+ *
+ * Returns          true if the attribute is to be saved, else false
+ *
+ ******************************************************************************/
+bool sdpu_is_attr_wanted(tSDP_DISCOVERY_DB* p_db, uint16_t attr_id) {
+  int low = 0;
+  int high = p_db->num_attr_filters - 1;
+
+  if (p_db->num_attr_filters == 0) return (true);
+
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (p_db->attr_filters[mid] == attr_id) return (true);
+    if (p_db->attr_filters[mid] < attr_id)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+
+  return (false);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdpu_db_reserve
+ *
+ * Description      This function makes sure the discovery database has |len|
+ *                  contiguous bytes free, taking a new chunk for them if it
+ *                  is growable. What was left of the last chunk is lost.
+ *
+ * Returns          true if the bytes are free, false if the DB is full
+ *
+ ******************************************************************************/
+bool sdpu_db_reserve(tSDP_DISCOVERY_DB* p_db, uint32_t len) {
+  if (p_db->mem_free >= len) return (true);
+  if (!p_db->growable) return (false);
+
+  uint32_t chunk_size = (len > SDP_DB_CHUNK_SIZE) ? len : SDP_DB_CHUNK_SIZE;
+  tSDP_DB_CHUNK* p_chunk =
+      (tSDP_DB_CHUNK*)osi_malloc(sizeof(tSDP_DB_CHUNK) + chunk_size);
+  p_chunk->p_next = p_db->p_chunks;
+  p_db->p_chunks = p_chunk;
+
+  p_db->mem_size += chunk_size;
+  p_db->mem_free = chunk_size;
+  p_db->p_free_mem = (uint8_t*)(p_chunk + 1);
+  return (true);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdpu_free_db_chunks
+ *
+ * Description      This function frees the chunks a growable discovery
+ *                  database took.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdpu_free_db_chunks(tSDP_DISCOVERY_DB* p_db) {
+  while (p_db->p_chunks) {
+    tSDP_DB_CHUNK* p_chunk = p_db->p_chunks;
+    p_db->p_chunks = p_chunk->p_next;
+    osi_free(p_chunk);
+  }
+}
+
 /*******************************************************************************
  *
  * Function         sdpu_get_list_len
@@ -904,6 +978,28 @@ uint8_t* sdpu_build_partial_attrib_entry(uint8_t* p_out, tSDP_ATTRIBUTE* p_attr,
   return p_out;
 }
 
+/*******************************************************************************
+ *
+ * Function         sdpu_uuid_to_uuid128
+ *
+ * Description      This function converts a BE UUID of 2, 4 or 16 bytes to its
+ *                  128-bit form, in which the UUIDs matched by
+ *                  sdpu_compare_uuid_arrays are equal.
+ *
+ * Returns          true if converted, false if the length is invalid
+ *
+ ******************************************************************************/
+bool sdpu_uuid_to_uuid128(uint8_t* p_uuid, uint32_t len, uint8_t* p_uuid128) {
+  if ((len != 2) && (len != 4) && (len != 16)) return false;
+
+  memcpy(p_uuid128, sdp_base_uuid, MAX_UUID_SIZE);
+  if (len == 2)
+    memcpy(p_uuid128 + 2, p_uuid, len);
+  else
+    memcpy(p_uuid128, p_uuid, len);
+  return true;
+}
+
 /*******************************************************************************
  *
  * Function         sdpu_uuid16_to_uuid128
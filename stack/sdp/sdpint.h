@@ -78,6 +78,9 @@
 #define MAX_UUIDS_PER_SEQ 16
 #define MAX_ATTR_PER_SEQ 16
 
+/* Max distinct UUIDs indexed per record of the server database */
+#define SDP_MAX_REC_UUIDS 16
+
 /* Max length we support for any attribute */
 #ifdef SDP_MAX_ATTR_LEN
 #define MAX_ATTR_LEN SDP_MAX_ATTR_LEN
@@ -122,6 +125,12 @@ typedef struct {
   uint16_t num_attributes;
   tSDP_ATTRIBUTE attribute[SDP_MAX_REC_ATTR];
   uint8_t attr_pad[SDP_MAX_PAD_LEN];
+
+  /* The UUIDs found in the attributes, in their 128-bit form, for the service
+   * searches. If they do not all fit, the attributes are searched instead. */
+  uint16_t num_uuids;
+  bool uuids_overflow;
+  uint8_t uuids[SDP_MAX_REC_UUIDS][MAX_UUID_SIZE];
 } tSDP_RECORD;
 
 /* Define the SDP database */
@@ -130,6 +139,7 @@ typedef struct {
       di_primary_handle; /* Device ID Primary record or NULL if nonexistent */
   uint16_t num_records;
   tSDP_RECORD record[SDP_MAX_RECORDS];
+  uint32_t generation; /* Changed each time a record is changed */
 } tSDP_DB;
 
 enum {
@@ -143,13 +153,22 @@ typedef struct {
   uint16_t next_attr_index;    /* attr index for next continuation response */
   uint16_t next_attr_start_id; /* attr id to start with for the attr index in
                                   next cont. response */
-  tSDP_RECORD* prev_sdp_rec; /* last sdp record that was completely sent in the
-                                response */
-  bool last_attr_seq_desc_sent; /* whether attr seq length has been sent
-                                   previously */
   uint16_t attr_offset; /* offset within the attr to keep trak of partial
                            attributes in the responses */
+  bool whole_list; /* whether rsp_list holds a whole service search attribute
+                     list, the continuations are sent from */
 } tSDP_CONT_INFO;
+
+/* A ServiceSearchAttributeResponse attribute list, kept for the following
+ * requests of the same UUIDs and attributes while the database is unchanged */
+typedef struct {
+  uint8_t* p_list; /* The list with its sequence header, NULL if unused */
+  uint16_t list_len;
+  uint32_t db_generation;
+  uint32_t last_used;
+  tSDP_UUID_SEQ uid_seq;
+  tSDP_ATTR_SEQ attr_seq;
+} tSDP_RSP_CACHE;
 #endif /* SDP_SERVER_ENABLED == TRUE */
 
 /* Define the SDP Connection Control Block */
@@ -210,6 +229,10 @@ typedef struct {
   tCONN_CB ccb[SDP_MAX_CONNECTIONS];
 #if (SDP_SERVER_ENABLED == TRUE)
   tSDP_DB server_db;
+#if (SDP_SERVER_RSP_CACHE_SIZE > 0)
+  tSDP_RSP_CACHE rsp_cache[SDP_SERVER_RSP_CACHE_SIZE];
+  uint32_t rsp_cache_clock;
+#endif
 #endif
   tL2CAP_APPL_INFO reg_info;    /* L2CAP Registration info */
   uint16_t max_attr_list_size;  /* Max attribute list size to use   */
@@ -266,11 +289,16 @@ extern uint8_t* sdpu_get_len_from_type(uint8_t* p, uint8_t type,
 extern bool sdpu_is_base_uuid(uint8_t* p_uuid);
 extern bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1,
                                      uint8_t* p_uuid2, uint16_t len2);
+extern bool sdpu_uuid_to_uuid128(uint8_t* p_uuid, uint32_t len,
+                                 uint8_t* p_uuid128);
 extern bool sdpu_compare_bt_uuids(tBT_UUID* p_uuid1, tBT_UUID* p_uuid2);
 extern bool sdpu_compare_uuid_with_attr(tBT_UUID* p_btuuid,
                                         tSDP_DISC_ATTR* p_attr);
 
 extern void sdpu_sort_attr_list(uint16_t num_attr, tSDP_DISCOVERY_DB* p_db);
+extern bool sdpu_is_attr_wanted(tSDP_DISCOVERY_DB* p_db, uint16_t attr_id);
+extern bool sdpu_db_reserve(tSDP_DISCOVERY_DB* p_db, uint32_t len);
+extern void sdpu_free_db_chunks(tSDP_DISCOVERY_DB* p_db);
 extern uint16_t sdpu_get_list_len(tSDP_UUID_SEQ* uid_seq,
                                   tSDP_ATTR_SEQ* attr_seq);
 extern uint16_t sdpu_get_attrib_seq_len(tSDP_RECORD* p_rec,
@@ -289,6 +317,15 @@ extern tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec,
                                                uint16_t start_attr,
                                                uint16_t end_attr);
 
+/* Functions provided by sdp_cache.cc
+*/
+extern bool sdp_cache_find(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                           uint8_t** pp_list, uint16_t* p_list_len);
+extern void sdp_cache_store(BD_ADDR bd_addr, uint8_t* p_key, uint16_t key_len,
+                            uint8_t* p_list, uint16_t list_len);
+extern void sdp_cache_remove(BD_ADDR bd_addr, uint8_t* p_key,
+                             uint16_t key_len);
+
 /* Functions provided by sdp_server.cc
 */
 #if (SDP_SERVER_ENABLED == TRUE)
@@ -301,5 +338,10 @@ extern void sdp_server_handle_client_req(tCONN_CB* p_ccb, BT_HDR* p_msg);
 */
 extern void sdp_disc_connected(tCONN_CB* p_ccb);
 extern void sdp_disc_server_rsp(tCONN_CB* p_ccb, BT_HDR* p_msg);
+extern bool sdp_disc_start_from_cache(uint8_t* p_bd_addr,
+                                      tSDP_DISCOVERY_DB* p_db,
+                                      tSDP_DISC_CMPL_CB* p_cb,
+                                      tSDP_DISC_CMPL_CB2* p_cb2,
+                                      void* user_data);
 
 #endif
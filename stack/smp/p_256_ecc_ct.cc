@@ -0,0 +1,709 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *
+ *  This file contains the constant-time P-256 point multiplications, over
+ *  field elements in the Montgomery form and points in Jacobian coordinates.
+ *
+ *  The field elements are fully reduced after each operation, and the
+ *  operations do not branch nor index memory on secret data. The only
+ *  exception is the addition of two equal points, which falls back to the
+ *  doubling: it does not happen in the multiplications but with negligible
+ *  probability.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "p_256_ecc_pp.h"
+
+namespace {
+
+// The limbs are the widest whose products the CPU computes natively: 64 bits
+// where the compiler has 128-bit integers, and 32 bits otherwise, where the
+// products compile to UMULL/UMLAL on ARM.
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t p256_limb_t;
+typedef unsigned __int128 p256_dlimb_t;
+#define P256_LIMB_BITS 64
+#define P256_LIMB(lo, hi) (((uint64_t)(hi) << 32) | (lo))
+#define P256_FELEM(w0, w1, w2, w3, w4, w5, w6, w7) \
+  {                                                \
+    P256_LIMB(w0, w1), P256_LIMB(w2, w3),          \
+    P256_LIMB(w4, w5), P256_LIMB(w6, w7)           \
+  }
+#else
+typedef uint32_t p256_limb_t;
+typedef uint64_t p256_dlimb_t;
+#define P256_LIMB_BITS 32
+#define P256_FELEM(w0, w1, w2, w3, w4, w5, w6, w7) \
+  { w0, w1, w2, w3, w4, w5, w6, w7 }
+#endif
+
+#define P256_NLIMBS (256 / P256_LIMB_BITS)
+
+typedef p256_limb_t felem[P256_NLIMBS];
+
+struct jacobian_point {
+  felem x;
+  felem y;
+  felem z;
+};
+
+struct affine_point {
+  felem x;
+  felem y;
+};
+
+// The constants are given as 32-bit words, least significant first.
+
+// p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+const felem kP = P256_FELEM(0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+                            0x00000000, 0x00000000, 0x00000001, 0xffffffff);
+
+// 1 in the Montgomery form: 2^256 mod p
+const felem kOne = P256_FELEM(0x00000001, 0x00000000, 0x00000000, 0xffffffff,
+                              0xffffffff, 0xffffffff, 0xfffffffe, 0x00000000);
+
+// 2^512 mod p, to convert to the Montgomery form
+const felem kRR = P256_FELEM(0x00000003, 0x00000000, 0xffffffff, 0xfffffffb,
+                             0xfffffffe, 0xffffffff, 0xfffffffd, 0x00000004);
+
+// The multiples of the base point G for the comb of ECC_PointMult_Base, in
+// affine coordinates and the Montgomery form: kBaseTable[t][b - 1] is the sum
+// of the 2^(64 * i + 32 * t) * G for the bits i set in b.
+const affine_point kBaseTable[2][15] = {
+    {
+        {P256_FELEM(0x18a9143c, 0x79e730d4, 0x5fedb601, 0x75ba95fc,
+                    0x77622510, 0x79fb732b, 0xa53755c6, 0x18905f76),
+         P256_FELEM(0xce95560a, 0xddf25357, 0xba19e45c, 0x8b4ab8e4,
+                    0xdd21f325, 0xd2e88688, 0x25885d85, 0x8571ff18)},
+        {P256_FELEM(0x16a0d2bb, 0x4f922fc5, 0x1a623499, 0x0d5cc16c,
+                    0x57c62c8b, 0x9241cf3a, 0xfd1b667f, 0x2f5e6961),
+         P256_FELEM(0xf5a01797, 0x5c15c70b, 0x60956192, 0x3d20b44d,
+                    0x071fdb52, 0x04911b37, 0x8d6f0f7b, 0xf648f916)},
+        {P256_FELEM(0xe137bbbc, 0x9e566847, 0x8a6a0bec, 0xe434469e,
+                    0x79d73463, 0xb1c42761, 0x133d0015, 0x5abe0285),
+         P256_FELEM(0xc04c7dab, 0x92aa837c, 0x43260c07, 0x573d9f4c,
+                    0x78e6cc37, 0x0c931562, 0x6b6f7383, 0x94bb725b)},
+        {P256_FELEM(0xbfe20925, 0x62a8c244, 0x8fdce867, 0x91c19ac3,
+                    0xdd387063, 0x5a96a5d5, 0x21d324f6, 0x61d587d4),
+         P256_FELEM(0xa37173ea, 0xe87673a2, 0x53778b65, 0x23848008,
+                    0x05bab43e, 0x10f8441e, 0x4621efbe, 0xfa11fe12)},
+        {P256_FELEM(0x2cb19ffd, 0x1c891f2b, 0xb1923c23, 0x01ba8d5b,
+                    0x8ac5ca8e, 0xb6d03d67, 0x1f13bedc, 0x586eb04c),
+         P256_FELEM(0x27e8ed09, 0x0c35c6e5, 0x1819ede2, 0x1e81a33c,
+                    0x56c652fa, 0x278fd6c0, 0x70864f11, 0x19d5ac08)},
+        {P256_FELEM(0xd2b533d5, 0x62577734, 0xa1bdddc0, 0x673b8af6,
+                    0xa79ec293, 0x577e7c9a, 0xc3b266b1, 0xbb6de651),
+         P256_FELEM(0xb65259b3, 0xe7e9303a, 0xd03a7480, 0xd6a0afd3,
+                    0x9b3cfc27, 0xc5ac83d1, 0x5d18b99b, 0x60b4619a)},
+        {P256_FELEM(0x1ae5aa1c, 0xbd6a38e1, 0x49e73658, 0xb8b7652b,
+                    0xee5f87ed, 0x0b130014, 0xaeebffcd, 0x9d0f27b2),
+         P256_FELEM(0x7a730a55, 0xca924631, 0xddbbc83a, 0x9c955b2f,
+                    0xac019a71, 0x07c1dfe0, 0x356ec48d, 0x244a566d)},
+        {P256_FELEM(0xf4f8b16a, 0x56f8410e, 0xc47b266a, 0x97241afe,
+                    0x6d9c87c1, 0x0a406b8e, 0xcd42ab1b, 0x803f3e02),
+         P256_FELEM(0x04dbec69, 0x7f0309a8, 0x3bbad05f, 0xa83b85f7,
+                    0xad8e197f, 0xc6097273, 0x5067adc1, 0xc097440e)},
+        {P256_FELEM(0xc379ab34, 0x846a56f2, 0x841df8d1, 0xa8ee068b,
+                    0x176c68ef, 0x20314459, 0x915f1f30, 0xf1af32d5),
+         P256_FELEM(0x5d75bd50, 0x99c37531, 0xf72f67bc, 0x837cffba,
+                    0x48d7723f, 0x0613a418, 0xe2d41c8b, 0x23d0f130)},
+        {P256_FELEM(0xd5be5a2b, 0xed93e225, 0x5934f3c6, 0x6fe79983,
+                    0x22626ffc, 0x43140926, 0x7990216a, 0x50bbb4d9),
+         P256_FELEM(0xe57ec63e, 0x378191c6, 0x181dcdb2, 0x65422c40,
+                    0x0236e0f6, 0x41a8099b, 0x01fe49c3, 0x2b100118)},
+        {P256_FELEM(0x9b391593, 0xfc68b5c5, 0x598270fc, 0xc385f5a2,
+                    0xd19adcbb, 0x7144f3aa, 0x83fbae0c, 0xdd558999),
+         P256_FELEM(0x74b82ff4, 0x93b88b8e, 0x71e734c9, 0xd2e03c40,
+                    0x43c0322a, 0x9a7a9eaf, 0x149d6041, 0xe6e4c551)},
+        {P256_FELEM(0x80ec21fe, 0x5fe14bfe, 0xc255be82, 0xf6ce116a,
+                    0x2f4a5d67, 0x98bc5a07, 0xdb7e63af, 0xfad27148),
+         P256_FELEM(0x29ab05b3, 0x90c0b6ac, 0x4e251ae6, 0x37a9a83c,
+                    0xc2aade7d, 0x0a7dc875, 0x9f0e1a84, 0x77387de3)},
+        {P256_FELEM(0xa56c0dd7, 0x1e9ecc49, 0x46086c74, 0xa5cffcd8,
+                    0xf505aece, 0x8f7a1408, 0xbef0c47e, 0xb37b85c0),
+         P256_FELEM(0xcc0e6a8f, 0x3596b6e4, 0x6b388f23, 0xfd6d4bbf,
+                    0xc39cef4e, 0xaba453fa, 0xf9f628d5, 0x9c135ac8)},
+        {P256_FELEM(0x95c8f8be, 0x0a1c7294, 0x3bf362bf, 0x2961c480,
+                    0xdf63d4ac, 0x9e418403, 0x91ece900, 0xc109f9cb),
+         P256_FELEM(0x58945705, 0xc2d095d0, 0xddeb85c0, 0xb9083d96,
+                    0x7a40449b, 0x84692b8d, 0x2eee1ee1, 0x9bc3344f)},
+        {P256_FELEM(0x42913074, 0x0d5ae356, 0x48a542b1, 0x55491b27,
+                    0xb310732a, 0x469ca665, 0x5f1a4cc1, 0x29591d52),
+         P256_FELEM(0xb84f983f, 0xe76f5b6b, 0x9f5f84e1, 0xbe7eef41,
+                    0x80baa189, 0x1200d496, 0x18ef332c, 0x6376551f)},
+    },
+    {
+        {P256_FELEM(0x4147519a, 0x20288602, 0x26b372f0, 0xd0981eac,
+                    0xa785ebc8, 0xa9d4a7ca, 0xdbdf58e9, 0xd953c50d),
+         P256_FELEM(0xfd590f8f, 0x9d6361cc, 0x44e6c917, 0x72e9626b,
+                    0x22eb64cf, 0x7fd96110, 0x9eb288f3, 0x863ebb7e)},
+        {P256_FELEM(0xb0e63d34, 0x4fe7ee31, 0xa9e54fab, 0xf4600572,
+                    0xd5e7b5a4, 0xc0493334, 0x06d54831, 0x8589fb92),
+         P256_FELEM(0x6583553a, 0xaa70f5cc, 0xe25649e5, 0x0879094a,
+                    0x10044652, 0xcc904507, 0x02541c4f, 0xebb0696d)},
+        {P256_FELEM(0x3b89da99, 0xabbaa0c0, 0xb8284022, 0xa6f2d79e,
+                    0xb81c05e8, 0x27847862, 0x05e54d63, 0x337a4b59),
+         P256_FELEM(0x21f7794a, 0x3c67500d, 0x7d6d7f61, 0x207005b7,
+                    0x04cfd6e8, 0x0a5a3781, 0xf4c2fbd6, 0x0d65e0d5)},
+        {P256_FELEM(0x6d3549cf, 0xd433e50f, 0xfacd665e, 0x6f33696f,
+                    0xce11fcb4, 0x695bfdac, 0xaf7c9860, 0x810ee252),
+         P256_FELEM(0x7159bb2c, 0x65450fe1, 0x758b357b, 0xf7dfbebe,
+                    0xd69fea72, 0x2b057e74, 0x92731745, 0xd485717a)},
+        {P256_FELEM(0xe83f7669, 0xce1f69bb, 0x72877d6b, 0x09f8ae82,
+                    0x3244278d, 0x9548ae54, 0xe3c2c19c, 0x207755de),
+         P256_FELEM(0x6fef1945, 0x87bd61d9, 0xb12d28c3, 0x18813cef,
+                    0x72df64aa, 0x9fbcd1d6, 0x7154b00d, 0x48dc5ee5)},
+        {P256_FELEM(0xf49a3154, 0xef0f469e, 0x6e2b2e9a, 0x3e85a595,
+                    0xaa924a9c, 0x45aaec1e, 0xa09e4719, 0xaa12dfc8),
+         P256_FELEM(0x4df69f1d, 0x26f27227, 0xa2ff5e73, 0xe0e4c82c,
+                    0xb7a9dd44, 0xb9d8ce73, 0xe48ca901, 0x6c036e73)},
+        {P256_FELEM(0xa47153f0, 0xe1e421e1, 0x920418c9, 0xb86c3b79,
+                    0x705d7672, 0x93bdce87, 0xcab79a77, 0xf25ae793),
+         P256_FELEM(0x6d869d0c, 0x1f3194a3, 0x4986c264, 0x9d55c882,
+                    0x096e945e, 0x49fb5ea3, 0x13db0a3e, 0x39b8e653)},
+        {P256_FELEM(0x35d0b34a, 0xe3417bc0, 0x8327c0a7, 0x440b386b,
+                    0xac0362d1, 0x8fb7262d, 0xe0cdf943, 0x2c41114c),
+         P256_FELEM(0xad95a0b1, 0x2ba5cef1, 0x67d54362, 0xc09b37a8,
+                    0x01e486c9, 0x26d6cdd2, 0x42ff9297, 0x20477abf)},
+        {P256_FELEM(0xbc0a67d2, 0x0f121b41, 0x444d248a, 0x62d4760a,
+                    0x659b4737, 0x0e044f1d, 0x250bb4a8, 0x08fde365),
+         P256_FELEM(0x848bf287, 0xaceec3da, 0xd3369d6e, 0xc2a62182,
+                    0x92449482, 0x3582dfdc, 0x565d6cd7, 0x2f7e2fd2)},
+        {P256_FELEM(0x178a876b, 0x0a0122b5, 0x085104b4, 0x51ff96ff,
+                    0x14f29f76, 0x050b31ab, 0x5f87d4e6, 0x84abb28b),
+         P256_FELEM(0x8270790a, 0xd5ed439f, 0x85e3f46b, 0x2d6cb59d,
+                    0x6c1e2212, 0x75f55c1b, 0x17655640, 0xe5436f67)},
+        {P256_FELEM(0x9aeb596d, 0xc2965ecc, 0x023c92b4, 0x01ea03e7,
+                    0x2e013961, 0x4704b4b6, 0x905ea367, 0x0ca8fd3f),
+         P256_FELEM(0x551b2b61, 0x92523a42, 0x390fcd06, 0x1eb7a89c,
+                    0x0392a63e, 0xe7f1d2be, 0x4ddb0c33, 0x96dca264)},
+        {P256_FELEM(0x15339848, 0x231c210e, 0x70778c8d, 0xe87a28e8,
+                    0x6956e170, 0x9d1de661, 0x2bb09c0b, 0x4ac3c938),
+         P256_FELEM(0x6998987d, 0x19be0551, 0xae09f4d6, 0x8b2376c4,
+                    0x1a3f933d, 0x1de0b765, 0xe39705f4, 0x380d94c7)},
+        {P256_FELEM(0x8c31c31d, 0x3685954b, 0x5bf21a0c, 0x68533d00,
+                    0x75c79ec9, 0x0bd7626e, 0x42c69d54, 0xca177547),
+         P256_FELEM(0xf6d2dbb2, 0xcc6edaff, 0x174a9d18, 0xfd0d8cbd,
+                    0xaa4578e8, 0x875e8793, 0x9cab2ce6, 0xa976a713)},
+        {P256_FELEM(0xb43ea1db, 0xce37ab11, 0x5259d292, 0x0a7ff1a9,
+                    0x8f84f186, 0x851b0221, 0xdefaad13, 0xa7222bea),
+         P256_FELEM(0x2b0a9144, 0xa2ac78ec, 0xf2fa59c5, 0x5a024051,
+                    0x6147ce38, 0x91d1eca5, 0xbc2ac690, 0xbe94d523)},
+        {P256_FELEM(0x79ec1a0f, 0x2d8daefd, 0xceb39c97, 0x3bbcd6fd,
+                    0x58f61a95, 0xf5575ffc, 0xadf7b420, 0xdbd986c4),
+         P256_FELEM(0x15f39eb7, 0x81aa8814, 0xb98d976c, 0x6ee2fcf5,
+                    0xcf2f717d, 0x5465475d, 0x6860bbd0, 0x8e24d3c4)},
+    },
+};
+
+// Returns an all-ones mask if |a| is zero, and zero otherwise
+p256_limb_t limb_is_zero(p256_limb_t a) {
+  return ((a | (0 - a)) >> (P256_LIMB_BITS - 1)) - 1;
+}
+
+p256_limb_t felem_is_zero(const felem a) {
+  p256_limb_t acc = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) acc |= a[i];
+  return limb_is_zero(acc);
+}
+
+// r = |mask| ? a : b
+void felem_select(felem r, p256_limb_t mask, const felem a, const felem b) {
+  for (int i = 0; i < P256_NLIMBS; i++) r[i] = (a[i] & mask) | (b[i] & ~mask);
+}
+
+p256_limb_t addc(p256_limb_t a, p256_limb_t b, p256_limb_t* carry) {
+  p256_dlimb_t t = (p256_dlimb_t)a + b + *carry;
+  *carry = (p256_limb_t)(t >> P256_LIMB_BITS);
+  return (p256_limb_t)t;
+}
+
+p256_limb_t subb(p256_limb_t a, p256_limb_t b, p256_limb_t* borrow) {
+  p256_dlimb_t t = (p256_dlimb_t)a - b - *borrow;
+  *borrow = (p256_limb_t)(t >> P256_LIMB_BITS) & 1;
+  return (p256_limb_t)t;
+}
+
+// r = a + carry * 2^256 reduced once, for a + carry * 2^256 < 2p
+void felem_reduce_once(felem r, const p256_limb_t* a, p256_limb_t carry) {
+  felem t;
+  p256_limb_t borrow = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) t[i] = subb(a[i], kP[i], &borrow);
+
+  // a is kept if it was below p
+  felem_select(r, 0 - (borrow & (carry ^ 1)), a, t);
+}
+
+// r = a + b mod p
+void felem_add(felem r, const felem a, const felem b) {
+  felem t;
+  p256_limb_t carry = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) t[i] = addc(a[i], b[i], &carry);
+  felem_reduce_once(r, t, carry);
+}
+
+// r = a - b mod p
+void felem_sub(felem r, const felem a, const felem b) {
+  felem t;
+  p256_limb_t borrow = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) t[i] = subb(a[i], b[i], &borrow);
+
+  // p is added back if it borrowed
+  p256_limb_t mask = 0 - borrow;
+  p256_limb_t carry = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) r[i] = addc(t[i], kP[i] & mask, &carry);
+}
+
+#if P256_LIMB_BITS == 64
+// r = a * b / 2^256 mod p, by the Montgomery multiplication. As p is -1
+// modulo the limb size, the multiple of p to add at each step is the lowest
+// limb itself.
+void felem_mul(felem r, const felem a, const felem b) {
+  p256_limb_t t[P256_NLIMBS + 2] = {0};
+
+  for (int i = 0; i < P256_NLIMBS; i++) {
+    p256_limb_t carry = 0;
+    for (int j = 0; j < P256_NLIMBS; j++) {
+      p256_dlimb_t u = (p256_dlimb_t)a[j] * b[i] + t[j] + carry;
+      t[j] = (p256_limb_t)u;
+      carry = (p256_limb_t)(u >> P256_LIMB_BITS);
+    }
+    p256_dlimb_t u = (p256_dlimb_t)t[P256_NLIMBS] + carry;
+    t[P256_NLIMBS] = (p256_limb_t)u;
+    t[P256_NLIMBS + 1] = (p256_limb_t)(u >> P256_LIMB_BITS);
+
+    // t = (t + m * p) / 2^P256_LIMB_BITS
+    p256_limb_t m = t[0];
+    u = (p256_dlimb_t)m * kP[0] + t[0];
+    carry = (p256_limb_t)(u >> P256_LIMB_BITS);
+    for (int j = 1; j < P256_NLIMBS; j++) {
+      u = (p256_dlimb_t)m * kP[j] + t[j] + carry;
+      t[j - 1] = (p256_limb_t)u;
+      carry = (p256_limb_t)(u >> P256_LIMB_BITS);
+    }
+    u = (p256_dlimb_t)t[P256_NLIMBS] + carry;
+    t[P256_NLIMBS - 1] = (p256_limb_t)u;
+    t[P256_NLIMBS] =
+        t[P256_NLIMBS + 1] + (p256_limb_t)(u >> P256_LIMB_BITS);
+  }
+
+  felem_reduce_once(r, t, t[P256_NLIMBS]);
+}
+
+void felem_sqr(felem r, const felem a) { felem_mul(r, a, a); }
+#else
+// The Montgomery reduction of the 512-bit |t| into r = t / 2^256 mod p. The
+// limb m of the row i is cancelled by adding m * p, with p = 2^256 - 2^224 +
+// 2^192 + 2^96 - 1: that is m to the limbs i + 3 and i + 6, and m * (2^32 - 1)
+// to the limbs i + 7 and i + 8. This takes no multiplication, where a generic
+// reduction takes as many as the product itself. The sums are kept in 64 bits
+// and their carries propagated limb by limb.
+void felem_reduce(felem r, const uint32_t* t) {
+  uint64_t sums[2 * P256_NLIMBS];
+  for (int i = 0; i < 2 * P256_NLIMBS; i++) sums[i] = t[i];
+
+  uint64_t carry = 0;
+  for (int i = 0; i < 2 * P256_NLIMBS; i++) {
+    uint64_t sum = sums[i] + carry;
+    uint32_t m = (uint32_t)sum;
+    carry = sum >> 32;
+    if (i < P256_NLIMBS) {
+      sums[i + 3] += m;
+      sums[i + 6] += m;
+      sums[i + 7] += 0 - m;
+      sums[i + 8] += m - 1 - limb_is_zero(m);
+    } else {
+      sums[i] = m;
+    }
+  }
+
+  uint32_t u[P256_NLIMBS];
+  for (int i = 0; i < P256_NLIMBS; i++) u[i] = (uint32_t)sums[P256_NLIMBS + i];
+  felem_reduce_once(r, u, (uint32_t)carry);
+}
+
+// r = a * b / 2^256 mod p. Each step of the product is a multiply-accumulate
+// of two limbs, UMAAL on ARM.
+void felem_mul(felem r, const felem a, const felem b) {
+  uint32_t t[2 * P256_NLIMBS] = {0};
+
+  for (int i = 0; i < P256_NLIMBS; i++) {
+    uint32_t carry = 0;
+    for (int j = 0; j < P256_NLIMBS; j++) {
+      uint64_t u = (uint64_t)a[j] * b[i] + t[i + j] + carry;
+      t[i + j] = (uint32_t)u;
+      carry = (uint32_t)(u >> 32);
+    }
+    t[i + P256_NLIMBS] = carry;
+  }
+
+  felem_reduce(r, t);
+}
+
+// r = a^2 / 2^256 mod p, computing the products of distinct limbs once
+void felem_sqr(felem r, const felem a) {
+  uint32_t t[2 * P256_NLIMBS] = {0};
+
+  for (int i = 0; i < P256_NLIMBS - 1; i++) {
+    uint32_t carry = 0;
+    for (int j = i + 1; j < P256_NLIMBS; j++) {
+      uint64_t u = (uint64_t)a[j] * a[i] + t[i + j] + carry;
+      t[i + j] = (uint32_t)u;
+      carry = (uint32_t)(u >> 32);
+    }
+    t[i + P256_NLIMBS] = carry;
+  }
+
+  // t = 2 * t + the squares of the limbs
+  uint32_t top = 0;
+  for (int i = 0; i < 2 * P256_NLIMBS; i++) {
+    uint32_t v = t[i];
+    t[i] = (v << 1) | top;
+    top = v >> 31;
+  }
+  uint32_t carry = 0;
+  for (int i = 0; i < P256_NLIMBS; i++) {
+    uint64_t u = (uint64_t)a[i] * a[i] + t[2 * i] + carry;
+    t[2 * i] = (uint32_t)u;
+    u = (u >> 32) + t[2 * i + 1];
+    t[2 * i + 1] = (uint32_t)u;
+    carry = (uint32_t)(u >> 32);
+  }
+
+  felem_reduce(r, t);
+}
+#endif
+
+void felem_sqr_n(felem r, const felem a, int n) {
+  felem_sqr(r, a);
+  for (int i = 1; i < n; i++) felem_sqr(r, r);
+}
+
+// r = a^(p - 2) = 1 / a mod p, by a fixed addition chain, and 0 for a = 0
+void felem_inv(felem r, const felem a) {
+  felem x2, x3, x6, x12, x15, x30, x32, t;
+
+  felem_sqr(t, a);
+  felem_mul(x2, t, a);  // 2^2 - 1
+  felem_sqr(t, x2);
+  felem_mul(x3, t, a);  // 2^3 - 1
+  felem_sqr_n(t, x3, 3);
+  felem_mul(x6, t, x3);  // 2^6 - 1
+  felem_sqr_n(t, x6, 6);
+  felem_mul(x12, t, x6);  // 2^12 - 1
+  felem_sqr_n(t, x12, 3);
+  felem_mul(x15, t, x3);  // 2^15 - 1
+  felem_sqr_n(t, x15, 15);
+  felem_mul(x30, t, x15);  // 2^30 - 1
+  felem_sqr_n(t, x30, 2);
+  felem_mul(x32, t, x2);  // 2^32 - 1
+
+  // p - 2 = ffffffff 00000001 00000000 00000000
+  //         00000000 ffffffff ffffffff fffffffd
+  felem_sqr_n(t, x32, 32);
+  felem_mul(t, t, a);
+  felem_sqr_n(t, t, 128);
+  felem_mul(t, t, x32);
+  felem_sqr_n(t, t, 32);
+  felem_mul(t, t, x32);
+  felem_sqr_n(t, t, 30);
+  felem_mul(t, t, x30);
+  felem_sqr_n(t, t, 2);
+  felem_mul(r, t, a);
+}
+
+// Loads the little-endian 256-bit |words| in the Montgomery form
+void felem_from_words(felem r, const uint32_t* words) {
+  for (int i = 0; i < P256_NLIMBS; i++) {
+#if P256_LIMB_BITS == 64
+    r[i] = P256_LIMB(words[2 * i], words[2 * i + 1]);
+#else
+    r[i] = words[i];
+#endif
+  }
+  felem_mul(r, r, kRR);
+}
+
+// Stores |a| out of the Montgomery form in the little-endian 256-bit |words|
+void felem_to_words(uint32_t* words, const felem a) {
+  felem one = {1};
+  felem t;
+  felem_mul(t, a, one);
+  for (int i = 0; i < P256_NLIMBS; i++) {
+#if P256_LIMB_BITS == 64
+    words[2 * i] = (uint32_t)t[i];
+    words[2 * i + 1] = (uint32_t)(t[i] >> 32);
+#else
+    words[i] = t[i];
+#endif
+  }
+}
+
+// r = 2a, by the dbl-2001-b formulas for a = -3. The point at infinity, with
+// z = 0, doubles to itself.
+void point_double(jacobian_point* r, const jacobian_point* a) {
+  felem delta, gamma, beta, alpha, t1, t2;
+
+  felem_sqr(delta, a->z);
+  felem_sqr(gamma, a->y);
+  felem_mul(beta, a->x, gamma);
+
+  // alpha = 3 * (x - delta) * (x + delta)
+  felem_sub(t1, a->x, delta);
+  felem_add(t2, a->x, delta);
+  felem_mul(t1, t1, t2);
+  felem_add(alpha, t1, t1);
+  felem_add(alpha, alpha, t1);
+
+  // z3 = (y + z)^2 - gamma - delta
+  felem_add(t1, a->y, a->z);
+  felem_sqr(t1, t1);
+  felem_sub(t1, t1, gamma);
+  felem_sub(r->z, t1, delta);
+
+  // x3 = alpha^2 - 8 * beta
+  felem_add(beta, beta, beta);
+  felem_add(beta, beta, beta);
+  felem_add(t2, beta, beta);
+  felem_sqr(t1, alpha);
+  felem_sub(r->x, t1, t2);
+
+  // y3 = alpha * (4 * beta - x3) - 8 * gamma^2
+  felem_sub(t1, beta, r->x);
+  felem_mul(t1, alpha, t1);
+  felem_sqr(gamma, gamma);
+  felem_add(gamma, gamma, gamma);
+  felem_add(gamma, gamma, gamma);
+  felem_add(gamma, gamma, gamma);
+  felem_sub(r->y, t1, gamma);
+}
+
+// r = a + b, by the add-2007-bl formulas
+void point_add(jacobian_point* r, const jacobian_point* a,
+               const jacobian_point* b) {
+  felem z1z1, z2z2, u1, u2, s1, s2, h, rr, i, j, v, t;
+  felem x3, y3, z3;
+
+  felem_sqr(z1z1, a->z);
+  felem_sqr(z2z2, b->z);
+  felem_mul(u1, a->x, z2z2);
+  felem_mul(u2, b->x, z1z1);
+  felem_mul(s1, a->y, b->z);
+  felem_mul(s1, s1, z2z2);
+  felem_mul(s2, b->y, a->z);
+  felem_mul(s2, s2, z1z1);
+  felem_sub(h, u2, u1);
+  felem_sub(rr, s2, s1);
+
+  p256_limb_t a_infinity = felem_is_zero(a->z);
+  p256_limb_t b_infinity = felem_is_zero(b->z);
+  if (felem_is_zero(h) & felem_is_zero(rr) & ~a_infinity & ~b_infinity) {
+    point_double(r, a);
+    return;
+  }
+
+  felem_add(rr, rr, rr);
+  felem_add(i, h, h);
+  felem_sqr(i, i);
+  felem_mul(j, h, i);
+  felem_mul(v, u1, i);
+
+  // x3 = rr^2 - j - 2 * v
+  felem_sqr(x3, rr);
+  felem_sub(x3, x3, j);
+  felem_sub(x3, x3, v);
+  felem_sub(x3, x3, v);
+
+  // y3 = rr * (v - x3) - 2 * s1 * j
+  felem_sub(y3, v, x3);
+  felem_mul(y3, y3, rr);
+  felem_mul(t, s1, j);
+  felem_add(t, t, t);
+  felem_sub(y3, y3, t);
+
+  // z3 = ((z1 + z2)^2 - z1z1 - z2z2) * h
+  felem_add(z3, a->z, b->z);
+  felem_sqr(z3, z3);
+  felem_sub(z3, z3, z1z1);
+  felem_sub(z3, z3, z2z2);
+  felem_mul(z3, z3, h);
+
+  felem_select(x3, a_infinity, b->x, x3);
+  felem_select(y3, a_infinity, b->y, y3);
+  felem_select(z3, a_infinity, b->z, z3);
+  felem_select(r->x, b_infinity, a->x, x3);
+  felem_select(r->y, b_infinity, a->y, y3);
+  felem_select(r->z, b_infinity, a->z, z3);
+}
+
+// r = a + b for an affine b, by the madd-2007-bl formulas. b is the point at
+// infinity if |b_infinity| is set.
+void point_add_mixed(jacobian_point* r, const jacobian_point* a,
+                     const affine_point* b, p256_limb_t b_infinity) {
+  felem z1z1, u2, s2, h, hh, rr, i, j, v, t;
+  felem x3, y3, z3;
+
+  felem_sqr(z1z1, a->z);
+  felem_mul(u2, b->x, z1z1);
+  felem_mul(s2, b->y, a->z);
+  felem_mul(s2, s2, z1z1);
+  felem_sub(h, u2, a->x);
+  felem_sub(rr, s2, a->y);
+
+  p256_limb_t a_infinity = felem_is_zero(a->z);
+  if (felem_is_zero(h) & felem_is_zero(rr) & ~a_infinity & ~b_infinity) {
+    point_double(r, a);
+    return;
+  }
+
+  felem_add(rr, rr, rr);
+  felem_sqr(hh, h);
+  felem_add(i, hh, hh);
+  felem_add(i, i, i);
+  felem_mul(j, h, i);
+  felem_mul(v, a->x, i);
+
+  // x3 = rr^2 - j - 2 * v
+  felem_sqr(x3, rr);
+  felem_sub(x3, x3, j);
+  felem_sub(x3, x3, v);
+  felem_sub(x3, x3, v);
+
+  // y3 = rr * (v - x3) - 2 * y1 * j
+  felem_sub(y3, v, x3);
+  felem_mul(y3, y3, rr);
+  felem_mul(t, a->y, j);
+  felem_add(t, t, t);
+  felem_sub(y3, y3, t);
+
+  // z3 = (z1 + h)^2 - z1z1 - hh
+  felem_add(z3, a->z, h);
+  felem_sqr(z3, z3);
+  felem_sub(z3, z3, z1z1);
+  felem_sub(z3, z3, hh);
+
+  felem_select(x3, a_infinity, b->x, x3);
+  felem_select(y3, a_infinity, b->y, y3);
+  felem_select(z3, a_infinity, kOne, z3);
+  felem_select(r->x, b_infinity, a->x, x3);
+  felem_select(r->y, b_infinity, a->y, y3);
+  felem_select(r->z, b_infinity, a->z, z3);
+}
+
+// r = table[index], reading all the |count| entries
+void point_lookup(jacobian_point* r, const jacobian_point* table, int count,
+                  uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (int k = 0; k < count; k++) {
+    p256_limb_t mask = limb_is_zero(k ^ index);
+    for (int i = 0; i < P256_NLIMBS; i++) {
+      r->x[i] |= table[k].x[i] & mask;
+      r->y[i] |= table[k].y[i] & mask;
+      r->z[i] |= table[k].z[i] & mask;
+    }
+  }
+}
+
+// r = kBaseTable[t][index - 1], returning an all-ones mask for the point at
+// infinity when |index| is 0
+p256_limb_t base_point_lookup(affine_point* r, int t, uint32_t index) {
+  memset(r, 0, sizeof(*r));
+  for (int k = 0; k < 15; k++) {
+    p256_limb_t mask = limb_is_zero((k + 1) ^ index);
+    for (int i = 0; i < P256_NLIMBS; i++) {
+      r->x[i] |= kBaseTable[t][k].x[i] & mask;
+      r->y[i] |= kBaseTable[t][k].y[i] & mask;
+    }
+  }
+  return limb_is_zero(index);
+}
+
+uint32_t scalar_bit(const uint32_t* n, int i) {
+  return (n[i / DWORD_BITS] >> (i % DWORD_BITS)) & 1;
+}
+
+void point_to_affine(Point* q, const jacobian_point* a) {
+  felem z_inv, z_inv2, t;
+
+  felem_inv(z_inv, a->z);
+  felem_sqr(z_inv2, z_inv);
+  felem_mul(t, a->x, z_inv2);
+  felem_to_words(q->x, t);
+  felem_mul(t, a->y, z_inv2);
+  felem_mul(t, t, z_inv);
+  felem_to_words(q->y, t);
+
+  multiprecision_init(q->z, KEY_LENGTH_DWORDS_P256);
+  q->z[0] = 1;
+}
+
+}  // namespace
+
+// Fixed 4-bit windows over a table of the 16 first multiples of p: 252
+// doublings and 64 additions.
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n) {
+  jacobian_point table[16];
+
+  memset(&table[0], 0, sizeof(table[0]));
+  felem_from_words(table[1].x, p->x);
+  felem_from_words(table[1].y, p->y);
+  memcpy(table[1].z, kOne, sizeof(felem));
+  for (int i = 2; i < 16; i += 2) {
+    point_double(&table[i], &table[i / 2]);
+    point_add(&table[i + 1], &table[i], &table[1]);
+  }
+
+  jacobian_point r;
+  memset(&r, 0, sizeof(r));
+  for (int i = 256 / 4 - 1; i >= 0; i--) {
+    if (i != 256 / 4 - 1) {
+      for (int k = 0; k < 4; k++) point_double(&r, &r);
+    }
+
+    jacobian_point t;
+    point_lookup(&t, table, 16, (n[i / 8] >> ((i % 8) * 4)) & 0x0F);
+    point_add(&r, &r, &t);
+  }
+
+  point_to_affine(q, &r);
+}
+
+// Comb of 2 tables of 4 teeth spaced 64 bits apart, the teeth of the second
+// table being offset by 32 bits: 31 doublings and 64 mixed additions.
+void ECC_PointMult_Base(Point* q, const uint32_t* n) {
+  jacobian_point r;
+  memset(&r, 0, sizeof(r));
+  for (int j = 31; j >= 0; j--) {
+    if (j != 31) point_double(&r, &r);
+
+    for (int t = 0; t < 2; t++) {
+      uint32_t index = 0;
+      for (int i = 0; i < 4; i++)
+        index |= scalar_bit(n, 64 * i + 32 * t + j) << i;
+
+      affine_point b;
+      p256_limb_t b_infinity = base_point_lookup(&b, t, index);
+      point_add_mixed(&r, &r, &b, b_infinity);
+    }
+  }
+
+  point_to_affine(q, &r);
+}
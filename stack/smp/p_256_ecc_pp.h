@@ -60,4 +60,10 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 #define ECC_PointMult(q, p, n, keyLength) \
   ECC_PointMult_Bin_NAF(q, p, n, keyLength)
 
+// Constant-time P-256 multiplications q = n * p and q = n * G, for the
+// little-endian 256-bit scalar |n| and the affine point |p|. |q| is returned
+// in affine coordinates. Unlike ECC_PointMult, |n| is left untouched.
+void ECC_PointMult_Window(Point* q, const Point* p, const uint32_t* n);
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
+
 void p_256_init_curve(uint32_t keyLength);
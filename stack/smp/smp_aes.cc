@@ -0,0 +1,217 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the implementations of the AES-128 block cipher. They
+ *  all share the key schedule of aes.cc, whose round keys are in the byte
+ *  order of FIPS-197, as the AES instructions of the CPUs expect them.
+ *
+ ******************************************************************************/
+
+#include "smp_aes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <wmmintrin.h>
+#define SMP_AES_NI
+#endif
+
+#if defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#define SMP_AES_ARMV8_CE
+#endif
+
+#define SMP_AES_128_ROUNDS 10
+
+/* The number of encryptions interleaved by the AES instructions: enough to
+ * cover the latency of the instructions of the CPUs supported */
+#define SMP_AES_LANES 4
+
+namespace {
+
+bool portable_is_supported(void) { return true; }
+
+void portable_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                      uint8_t* out) {
+  aes_encrypt(in, out, &p_key->ctx);
+}
+
+void portable_encrypt_keys(const tSMP_AES_KEY* keys, size_t num_keys,
+                           const uint8_t* in, uint8_t* out) {
+  for (size_t i = 0; i < num_keys; i++)
+    aes_encrypt(in, &out[i * N_BLOCK], &keys[i].ctx);
+}
+
+const tSMP_AES_BACKEND portable_backend = {"portable", portable_is_supported,
+                                           portable_encrypt,
+                                           portable_encrypt_keys};
+
+#if defined(SMP_AES_NI)
+bool aes_ni_is_supported(void) {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (ecx & bit_AES) != 0 && (edx & bit_SSE2) != 0;
+}
+
+__attribute__((target("aes,sse2"))) void aes_ni_encrypt(
+    const tSMP_AES_KEY* p_key, const uint8_t* in, uint8_t* out) {
+  const __m128i* rk = (const __m128i*)p_key->ctx.ksch;
+  __m128i state = _mm_loadu_si128((const __m128i*)in);
+
+  state = _mm_xor_si128(state, _mm_loadu_si128(&rk[0]));
+  for (int i = 1; i < SMP_AES_128_ROUNDS; i++)
+    state = _mm_aesenc_si128(state, _mm_loadu_si128(&rk[i]));
+  state =
+      _mm_aesenclast_si128(state, _mm_loadu_si128(&rk[SMP_AES_128_ROUNDS]));
+
+  _mm_storeu_si128((__m128i*)out, state);
+}
+
+__attribute__((target("aes,sse2"))) void aes_ni_encrypt_keys(
+    const tSMP_AES_KEY* keys, size_t num_keys, const uint8_t* in,
+    uint8_t* out) {
+  const __m128i block = _mm_loadu_si128((const __m128i*)in);
+  size_t i = 0;
+
+  for (; i + SMP_AES_LANES <= num_keys; i += SMP_AES_LANES) {
+    const __m128i* rk[SMP_AES_LANES];
+    __m128i state[SMP_AES_LANES];
+    for (int lane = 0; lane < SMP_AES_LANES; lane++) {
+      rk[lane] = (const __m128i*)keys[i + lane].ctx.ksch;
+      state[lane] = _mm_xor_si128(block, _mm_loadu_si128(&rk[lane][0]));
+    }
+
+    for (int round = 1; round < SMP_AES_128_ROUNDS; round++) {
+      for (int lane = 0; lane < SMP_AES_LANES; lane++)
+        state[lane] = _mm_aesenc_si128(state[lane],
+                                       _mm_loadu_si128(&rk[lane][round]));
+    }
+
+    for (int lane = 0; lane < SMP_AES_LANES; lane++) {
+      state[lane] = _mm_aesenclast_si128(
+          state[lane], _mm_loadu_si128(&rk[lane][SMP_AES_128_ROUNDS]));
+      _mm_storeu_si128((__m128i*)&out[(i + lane) * N_BLOCK], state[lane]);
+    }
+  }
+
+  for (; i < num_keys; i++) aes_ni_encrypt(&keys[i], in, &out[i * N_BLOCK]);
+}
+
+const tSMP_AES_BACKEND aes_ni_backend = {"aes-ni", aes_ni_is_supported,
+                                         aes_ni_encrypt, aes_ni_encrypt_keys};
+#endif
+
+#if defined(SMP_AES_ARMV8_CE)
+bool armv8_ce_is_supported(void) {
+  return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+
+void armv8_ce_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                      uint8_t* out) {
+  const uint8_t* rk = p_key->ctx.ksch;
+  uint8x16_t state = vld1q_u8(in);
+
+  /* AESE adds the round key before the substitution, so the last round key
+   * is added separately */
+  for (int i = 0; i < SMP_AES_128_ROUNDS - 1; i++)
+    state = vaesmcq_u8(vaeseq_u8(state, vld1q_u8(&rk[i * N_BLOCK])));
+  state = vaeseq_u8(state, vld1q_u8(&rk[(SMP_AES_128_ROUNDS - 1) * N_BLOCK]));
+  state = veorq_u8(state, vld1q_u8(&rk[SMP_AES_128_ROUNDS * N_BLOCK]));
+
+  vst1q_u8(out, state);
+}
+
+void armv8_ce_encrypt_keys(const tSMP_AES_KEY* keys, size_t num_keys,
+                           const uint8_t* in, uint8_t* out) {
+  const uint8x16_t block = vld1q_u8(in);
+  size_t i = 0;
+
+  for (; i + SMP_AES_LANES <= num_keys; i += SMP_AES_LANES) {
+    const uint8_t* rk[SMP_AES_LANES];
+    uint8x16_t state[SMP_AES_LANES];
+    for (int lane = 0; lane < SMP_AES_LANES; lane++) {
+      rk[lane] = keys[i + lane].ctx.ksch;
+      state[lane] = block;
+    }
+
+    for (int round = 0; round < SMP_AES_128_ROUNDS - 1; round++) {
+      for (int lane = 0; lane < SMP_AES_LANES; lane++)
+        state[lane] = vaesmcq_u8(
+            vaeseq_u8(state[lane], vld1q_u8(&rk[lane][round * N_BLOCK])));
+    }
+
+    for (int lane = 0; lane < SMP_AES_LANES; lane++) {
+      state[lane] = vaeseq_u8(
+          state[lane],
+          vld1q_u8(&rk[lane][(SMP_AES_128_ROUNDS - 1) * N_BLOCK]));
+      state[lane] = veorq_u8(
+          state[lane], vld1q_u8(&rk[lane][SMP_AES_128_ROUNDS * N_BLOCK]));
+      vst1q_u8(&out[(i + lane) * N_BLOCK], state[lane]);
+    }
+  }
+
+  for (; i < num_keys; i++) armv8_ce_encrypt(&keys[i], in, &out[i * N_BLOCK]);
+}
+
+const tSMP_AES_BACKEND armv8_ce_backend = {"armv8-ce", armv8_ce_is_supported,
+                                           armv8_ce_encrypt,
+                                           armv8_ce_encrypt_keys};
+#endif
+
+const tSMP_AES_BACKEND* select_backend(void) {
+  for (size_t i = 0; smp_aes_backends[i] != NULL; i++) {
+    if (smp_aes_backends[i]->is_supported()) return smp_aes_backends[i];
+  }
+  return &portable_backend;
+}
+
+}  // namespace
+
+const tSMP_AES_BACKEND* const smp_aes_backends[] = {
+#if defined(SMP_AES_NI)
+    &aes_ni_backend,
+#endif
+#if defined(SMP_AES_ARMV8_CE)
+    &armv8_ce_backend,
+#endif
+    &portable_backend, NULL};
+
+const tSMP_AES_BACKEND* smp_aes_get_backend(void) {
+  static const tSMP_AES_BACKEND* backend = select_backend();
+  return backend;
+}
+
+void smp_aes_set_key(const uint8_t* key, tSMP_AES_KEY* p_key) {
+  aes_set_key(key, N_BLOCK, &p_key->ctx);
+}
+
+void smp_aes_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                     uint8_t* out) {
+  smp_aes_get_backend()->encrypt(p_key, in, out);
+}
+
+void smp_aes_encrypt_keys(const tSMP_AES_KEY* keys, size_t num_keys,
+                          const uint8_t* in, uint8_t* out) {
+  smp_aes_get_backend()->encrypt_keys(keys, num_keys, in, out);
+}
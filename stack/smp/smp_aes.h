@@ -0,0 +1,73 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the AES-128 block cipher used by SMP, the signed writes
+ *  and the resolution of the private addresses, with the implementations
+ *  using the AES instructions of the CPU when it has them.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes.h"
+
+// The expanded AES-128 key
+typedef struct { aes_context ctx; } tSMP_AES_KEY;
+
+// An implementation of the AES-128 block cipher
+typedef struct {
+  const char* name;
+
+  // Returns true if the CPU can run the implementation
+  bool (*is_supported)(void);
+
+  // Encrypts the block |in| to |out|, which may be the same buffer
+  void (*encrypt)(const tSMP_AES_KEY* p_key, const uint8_t* in, uint8_t* out);
+
+  // Encrypts the block |in| with each of the |num_keys| keys of |keys|, to
+  // the consecutive blocks of |out|
+  void (*encrypt_keys)(const tSMP_AES_KEY* keys, size_t num_keys,
+                       const uint8_t* in, uint8_t* out);
+} tSMP_AES_BACKEND;
+
+// The implementations built in, NULL terminated. The first one supported is
+// used; the last one is the portable implementation, always supported.
+extern const tSMP_AES_BACKEND* const smp_aes_backends[];
+
+// Returns the implementation used.
+const tSMP_AES_BACKEND* smp_aes_get_backend(void);
+
+// Expands the 128-bit |key|. As in FIPS-197, the key and the blocks are in
+// big-endian order, unlike most of the SMP values.
+void smp_aes_set_key(const uint8_t* key, tSMP_AES_KEY* p_key);
+
+// Encrypts the block |in| to |out| with the implementation used.
+void smp_aes_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                     uint8_t* out);
+
+// Encrypts the block |in| with each of the |num_keys| keys of |keys|, to the
+// consecutive blocks of |out|, with the implementation used. The encryptions
+// are independent, so they are interleaved to keep the AES units of the CPU
+// busy: this is faster than encrypting with one key at a time.
+void smp_aes_encrypt_keys(const tSMP_AES_KEY* keys, size_t num_keys,
+                          const uint8_t* in, uint8_t* out);
@@ -62,6 +62,7 @@ void SMP_Init(void) {
   smp_l2cap_if_init();
   /* initialization of P-256 parameters */
   p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  smp_key_pair_pool_init();
 
   /* Initialize failure case for certification */
   smp_cb.cert_failure =
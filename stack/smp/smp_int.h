@@ -530,6 +530,13 @@ extern bool smp_calculate_f6(uint8_t* w, uint8_t* n1, uint8_t* n2, uint8_t* r,
                              uint8_t* f3);
 extern bool smp_calculate_h6(uint8_t* w, uint8_t* keyid, uint8_t* h2);
 extern bool smp_calculate_h7(uint8_t* salt, uint8_t* w, uint8_t* h2);
+
+/* smp_key_pool.cc */
+extern void smp_key_pair_pool_init(void);
+extern void smp_key_pair_pool_free(void);
+extern bool smp_key_pair_pool_take(BT_OCTET32 private_key,
+                                   tSMP_PUBLIC_KEY* p_public_key);
+
 #if (SMP_DEBUG == TRUE)
 extern void smp_debug_print_nbyte_little_endian(uint8_t* p,
                                                 const char* key_name,
@@ -0,0 +1,336 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the pool of the LE Secure Connections key pairs
+ *  generated ahead of the pairings. The private keys come from the
+ *  controller, and the public keys are calculated on bt_executor. Each key
+ *  pair is used by a single pairing, and replaced once its lifetime elapsed
+ *  if it was not used.
+ *
+ ******************************************************************************/
+
+#include <base/bind.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bt_target.h"
+#include "hcimsgs.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "osi/include/executor.h"
+#include "osi/include/osi.h"
+#include "osi/include/time.h"
+#include "p_256_ecc_pp.h"
+#include "smp_int.h"
+
+using base::Bind;
+
+extern executor_t* bt_executor;
+extern thread_t* bt_workqueue_thread;
+extern fixed_queue_t* btu_general_alarm_queue;
+
+typedef struct {
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+  uint32_t created_ms;
+} tSMP_KEY_PAIR;
+
+/* A key pair being generated */
+typedef struct {
+  uint32_t generation;
+  BT_OCTET32 private_key;
+  Point public_key;
+} tSMP_KEY_PAIR_WORK;
+
+typedef struct {
+  /* the oldest first */
+  tSMP_KEY_PAIR key_pairs[SMP_KEY_PAIR_POOL_SIZE];
+  size_t count;
+
+  /* a single key pair is generated at a time. The generation is bumped when
+   * the stack restarts, to drop the key pairs still being generated. */
+  bool generating;
+  uint32_t generation;
+
+  alarm_t* expiry_timer;
+
+  uint32_t taken;
+  uint32_t missed;
+  uint32_t generated;
+  uint32_t expired;
+} tSMP_KEY_PAIR_POOL;
+
+static tSMP_KEY_PAIR_POOL key_pair_pool;
+
+static void smp_key_pair_pool_expire(void* data);
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_set_timer
+ *
+ * Description      This function sets the expiry timer for the oldest key pair
+ *                  of the pool, if any.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_key_pair_pool_set_timer(void) {
+  alarm_cancel(key_pair_pool.expiry_timer);
+  if (key_pair_pool.count == 0) return;
+
+  uint32_t lifetime_ms = SMP_KEY_PAIR_LIFETIME_MS;
+  uint32_t age_ms =
+      time_get_os_boottime_ms() - key_pair_pool.key_pairs[0].created_ms;
+  alarm_set_on_queue(key_pair_pool.expiry_timer,
+                     age_ms < lifetime_ms ? lifetime_ms - age_ms : 0,
+                     smp_key_pair_pool_expire, NULL, btu_general_alarm_queue);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_init
+ *
+ * Description      This function initializes the key pair pool. The key pairs
+ *                  already generated are kept.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pair_pool_init(void) {
+  key_pair_pool.generating = false;
+  key_pair_pool.generation++;
+  key_pair_pool.expiry_timer = alarm_new("smp.key_pair_expiry_timer");
+  smp_key_pair_pool_set_timer();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_free
+ *
+ * Description      This function stops the key pair pool when the stack shuts
+ *                  down. The key pairs still being generated are dropped.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pair_pool_free(void) {
+  key_pair_pool.generating = false;
+  key_pair_pool.generation++;
+  alarm_free(key_pair_pool.expiry_timer);
+  key_pair_pool.expiry_timer = NULL;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_calculate
+ *
+ * Description      This function calculates the public key of |context|, a
+ *                  tSMP_KEY_PAIR_WORK. It runs on bt_executor.
+ *
+ * Returns          |context|
+ *
+ ******************************************************************************/
+static void* smp_key_pair_pool_calculate(void* context) {
+  tSMP_KEY_PAIR_WORK* p_work = (tSMP_KEY_PAIR_WORK*)context;
+
+  ECC_PointMult_Base(&p_work->public_key,
+                     (const uint32_t*)p_work->private_key);
+  return p_work;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_calculated
+ *
+ * Description      This function is called on bt_workqueue when bt_executor
+ *                  calculated the public key, to add the key pair to the
+ *                  pool.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_key_pair_pool_calculated(void* context, void* result) {
+  tSMP_KEY_PAIR_WORK* p_work = (tSMP_KEY_PAIR_WORK*)result;
+
+  if (p_work->generation == key_pair_pool.generation) {
+    tSMP_KEY_PAIR* p_key_pair = &key_pair_pool.key_pairs[key_pair_pool.count];
+    memcpy(p_key_pair->private_key, p_work->private_key, BT_OCTET32_LEN);
+    memcpy(p_key_pair->public_key.x, p_work->public_key.x, BT_OCTET32_LEN);
+    memcpy(p_key_pair->public_key.y, p_work->public_key.y, BT_OCTET32_LEN);
+    p_key_pair->created_ms = time_get_os_boottime_ms();
+
+    key_pair_pool.count++;
+    key_pair_pool.generated++;
+    key_pair_pool.generating = false;
+    SMP_TRACE_DEBUG("%s %zu key pairs available", __func__,
+                    key_pair_pool.count);
+
+    /* the key pairs are added the newest last: the timer only changes for the
+     * first one */
+    if (key_pair_pool.count == 1) smp_key_pair_pool_set_timer();
+    SMP_FillKeyPairPool();
+  }
+
+  memset(p_work, 0, sizeof(tSMP_KEY_PAIR_WORK));
+  osi_free(p_work);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_rand
+ *
+ * Description      This function is called with the octets of the private key
+ *                  of |p_work| from |offset| generated by the controller. It
+ *                  requests the next octets, or submits the calculation of
+ *                  the public key once the private key is complete.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_key_pair_pool_rand(tSMP_KEY_PAIR_WORK* p_work, size_t offset,
+                                   BT_OCTET8 rand) {
+  memcpy(&p_work->private_key[offset], rand, BT_OCTET8_LEN);
+  offset += BT_OCTET8_LEN;
+  if (offset < BT_OCTET32_LEN) {
+    btsnd_hcic_ble_rand(Bind(&smp_key_pair_pool_rand, p_work, offset));
+    return;
+  }
+
+  if (p_work->generation != key_pair_pool.generation ||
+      !executor_post(bt_executor, smp_key_pair_pool_calculate, p_work,
+                     bt_workqueue_thread, smp_key_pair_pool_calculated)) {
+    if (p_work->generation == key_pair_pool.generation)
+      key_pair_pool.generating = false;
+    memset(p_work, 0, sizeof(tSMP_KEY_PAIR_WORK));
+    osi_free(p_work);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_remove_first
+ *
+ * Description      This function removes the oldest key pair of the pool, and
+ *                  sets the expiry timer for the next one.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_key_pair_pool_remove_first(void) {
+  key_pair_pool.count--;
+  memmove(&key_pair_pool.key_pairs[0], &key_pair_pool.key_pairs[1],
+          key_pair_pool.count * sizeof(tSMP_KEY_PAIR));
+  memset(&key_pair_pool.key_pairs[key_pair_pool.count], 0,
+         sizeof(tSMP_KEY_PAIR));
+  smp_key_pair_pool_set_timer();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_expire
+ *
+ * Description      This function is called when the lifetime of the oldest
+ *                  key pair of the pool elapsed, to replace it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_key_pair_pool_expire(UNUSED_ATTR void* data) {
+  if (key_pair_pool.count == 0) return;
+
+  SMP_TRACE_DEBUG("%s", __func__);
+  key_pair_pool.expired++;
+  smp_key_pair_pool_remove_first();
+  SMP_FillKeyPairPool();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pair_pool_take
+ *
+ * Description      This function takes the oldest key pair of the pool, if
+ *                  any, and starts generating its replacement.
+ *
+ * Returns          true if a key pair was taken, false if the pool was empty
+ *
+ ******************************************************************************/
+bool smp_key_pair_pool_take(BT_OCTET32 private_key,
+                            tSMP_PUBLIC_KEY* p_public_key) {
+  if (key_pair_pool.count == 0) {
+    key_pair_pool.missed++;
+    SMP_FillKeyPairPool();
+    return false;
+  }
+
+  tSMP_KEY_PAIR* p_key_pair = &key_pair_pool.key_pairs[0];
+  memcpy(private_key, p_key_pair->private_key, BT_OCTET32_LEN);
+  memcpy(p_public_key, &p_key_pair->public_key, sizeof(tSMP_PUBLIC_KEY));
+
+  key_pair_pool.taken++;
+  smp_key_pair_pool_remove_first();
+  SMP_FillKeyPairPool();
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         SMP_FillKeyPairPool
+ *
+ * Description      This function starts generating a key pair if the pool is
+ *                  not full. The public keys are only calculated ahead on
+ *                  bt_executor, so the pool stays empty without it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_FillKeyPairPool(void) {
+  if (key_pair_pool.generating || bt_executor == NULL ||
+      key_pair_pool.count >= SMP_KEY_PAIR_POOL_SIZE)
+    return;
+
+  tSMP_KEY_PAIR_WORK* p_work =
+      (tSMP_KEY_PAIR_WORK*)osi_calloc(sizeof(tSMP_KEY_PAIR_WORK));
+  p_work->generation = key_pair_pool.generation;
+  key_pair_pool.generating = true;
+
+  btsnd_hcic_ble_rand(Bind(&smp_key_pair_pool_rand, p_work, (size_t)0));
+}
+
+/*******************************************************************************
+ *
+ * Function         SMP_DumpKeyPairPool
+ *
+ * Description      This function dumps the state of the key pair pool to
+ *                  |fd|, for dumpsys.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_DumpKeyPairPool(int fd) {
+  dprintf(fd, "\nSMP Key Pair Pool:\n");
+  dprintf(fd, "  Key pairs available/max      : %zu / %d\n",
+          key_pair_pool.count, SMP_KEY_PAIR_POOL_SIZE);
+  dprintf(fd, "  Key pair lifetime            : %d ms\n",
+          SMP_KEY_PAIR_LIFETIME_MS);
+  dprintf(fd, "  Pairings served/missed       : %u / %u\n",
+          key_pair_pool.taken, key_pair_pool.missed);
+  dprintf(fd, "  Key pairs generated/expired  : %u / %u\n",
+          key_pair_pool.generated, key_pair_pool.expired);
+}
@@ -28,15 +28,17 @@
 #endif
 #include <base/bind.h>
 #include <string.h>
-#include "aes.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
 #include "btm_ble_int.h"
 #include "btm_int.h"
 #include "device/include/controller.h"
 #include "hcimsgs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/executor.h"
 #include "osi/include/osi.h"
 #include "p_256_ecc_pp.h"
+#include "smp_aes.h"
 #include "smp_int.h"
 
 using base::Bind;
@@ -49,9 +51,21 @@ static void smp_process_stk(tSMP_CB* p_cb, tSMP_ENC* p);
 static bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb,
                                                 tSMP_ENC* output);
 static void smp_process_private_key(tSMP_CB* p_cb);
+static void smp_process_public_key(tSMP_CB* p_cb, Point* p_public_key);
+static void smp_local_public_key_created(tSMP_CB* p_cb);
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
+extern executor_t* bt_executor;
+extern thread_t* bt_workqueue_thread;
+
+// The computation of the local public key, done on bt_executor
+typedef struct {
+  tSMP_CB* p_cb;
+  BT_OCTET32 private_key;
+  Point public_key;
+} tSMP_PUBL_KEY_WORK;
+
 void smp_debug_print_nbyte_little_endian(uint8_t* p, const char* key_name,
                                          uint8_t len) {
 #if (SMP_DEBUG == TRUE)
@@ -111,12 +125,10 @@ void smp_debug_print_nbyte_big_endian(uint8_t* p, const char* key_name,
  ******************************************************************************/
 bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
                       uint8_t pt_len, tSMP_ENC* p_out) {
-  aes_context ctx;
-  uint8_t* p_start = NULL;
-  uint8_t* p = NULL;
-  uint8_t* p_rev_data = NULL;   /* input data in big endilan format */
-  uint8_t* p_rev_key = NULL;    /* input key in big endilan format */
-  uint8_t* p_rev_output = NULL; /* encrypted output in big endilan format */
+  tSMP_AES_KEY aes_key;
+  uint8_t rev_key[SMP_ENCRYT_KEY_SIZE];   /* key in big endian format */
+  uint8_t rev_data[SMP_ENCRYT_DATA_SIZE]; /* data in big endian format */
+  uint8_t* p;
 
   SMP_TRACE_DEBUG("%s", __func__);
   if ((p_out == NULL) || (key_len != SMP_ENCRYT_KEY_SIZE)) {
@@ -124,29 +136,24 @@ bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
     return false;
   }
 
-  p_start = (uint8_t*)osi_calloc(SMP_ENCRYT_DATA_SIZE * 4);
-
   if (pt_len > SMP_ENCRYT_DATA_SIZE) pt_len = SMP_ENCRYT_DATA_SIZE;
 
-  p = p_start;
-  ARRAY_TO_STREAM(p, plain_text, pt_len);          /* byte 0 to byte 15 */
-  p_rev_data = p = p_start + SMP_ENCRYT_DATA_SIZE; /* start at byte 16 */
-  REVERSE_ARRAY_TO_STREAM(p, p_start,
-                          SMP_ENCRYT_DATA_SIZE);        /* byte 16 to byte 31 */
-  p_rev_key = p;                                        /* start at byte 32 */
-  REVERSE_ARRAY_TO_STREAM(p, key, SMP_ENCRYT_KEY_SIZE); /* byte 32 to byte 47 */
+  /* the plain text is zero padded up to the block size */
+  memset(rev_data, 0, SMP_ENCRYT_DATA_SIZE);
+  for (uint8_t i = 0; i < pt_len; i++)
+    rev_data[SMP_ENCRYT_DATA_SIZE - 1 - i] = plain_text[i];
+  p = rev_key;
+  REVERSE_ARRAY_TO_STREAM(p, key, SMP_ENCRYT_KEY_SIZE);
 
 #if (SMP_DEBUG == TRUE && SMP_DEBUG_VERBOSE == TRUE)
   smp_debug_print_nbyte_little_endian(key, "Key", SMP_ENCRYT_KEY_SIZE);
-  smp_debug_print_nbyte_little_endian(p_start, "Plain text",
-                                      SMP_ENCRYT_DATA_SIZE);
+  smp_debug_print_nbyte_little_endian(plain_text, "Plain text", pt_len);
 #endif
-  p_rev_output = p;
-  aes_set_key(p_rev_key, SMP_ENCRYT_KEY_SIZE, &ctx);
-  aes_encrypt(p_rev_data, p, &ctx); /* outputs in byte 48 to byte 63 */
+  smp_aes_set_key(rev_key, &aes_key);
+  smp_aes_encrypt(&aes_key, rev_data, rev_data);
 
   p = p_out->param_buf;
-  REVERSE_ARRAY_TO_STREAM(p, p_rev_output, SMP_ENCRYT_DATA_SIZE);
+  REVERSE_ARRAY_TO_STREAM(p, rev_data, SMP_ENCRYT_DATA_SIZE);
 #if (SMP_DEBUG == TRUE && SMP_DEBUG_VERBOSE == TRUE)
   smp_debug_print_nbyte_little_endian(p_out->param_buf, "Encrypted text",
                                       SMP_ENCRYT_KEY_SIZE);
@@ -156,7 +163,8 @@ bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
   p_out->status = HCI_SUCCESS;
   p_out->opcode = HCI_BLE_ENCRYPT;
 
-  osi_free(p_start);
+  memset(&aes_key, 0, sizeof(aes_key));
+  memset(rev_key, 0, sizeof(rev_key));
 
   return true;
 }
@@ -726,8 +734,10 @@ bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb, tSMP_ENC* output) {
  *
  * Description      This function is called to create private key used to
  *                  calculate public key and DHKey.
- *                  The function starts private key creation requesting
- *                  for the controller to generate [0-7] octets of private key.
+ *                  The key pair is taken from the pool when one is ready.
+ *                  Otherwise the function starts private key creation
+ *                  requesting for the controller to generate [0-7] octets of
+ *                  private key.
  *
  * Returns          void
  *
@@ -735,6 +745,12 @@ bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb, tSMP_ENC* output) {
 void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
+  if (smp_key_pair_pool_take(p_cb->private_key, &p_cb->loc_publ_key)) {
+    SMP_TRACE_DEBUG("%s key pair taken from the pool", __func__);
+    smp_local_public_key_created(p_cb);
+    return;
+  }
+
   btsnd_hcic_ble_rand(Bind(
       [](tSMP_CB* p_cb, BT_OCTET8 rand) {
         memcpy((void*)p_cb->private_key, rand, BT_OCTET8_LEN);
@@ -795,29 +811,106 @@ void smp_use_oob_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         smp_calculate_public_key
+ *
+ * Description      This function calculates the public key of the private key
+ *                  of |context|, a tSMP_PUBL_KEY_WORK. It runs on bt_executor.
+ *
+ * Returns          |context|
+ *
+ ******************************************************************************/
+static void* smp_calculate_public_key(void* context) {
+  tSMP_PUBL_KEY_WORK* p_work = (tSMP_PUBL_KEY_WORK*)context;
+
+  ECC_PointMult_Base(&p_work->public_key,
+                     (const uint32_t*)p_work->private_key);
+  return p_work;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_public_key_calculated
+ *
+ * Description      This function is called on bt_workqueue when bt_executor
+ *                  calculated the public key. The key is dropped if the
+ *                  pairing was reset or restarted with another private key in
+ *                  the meantime.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_public_key_calculated(void* context, void* result) {
+  tSMP_PUBL_KEY_WORK* p_work = (tSMP_PUBL_KEY_WORK*)result;
+  tSMP_CB* p_cb = p_work->p_cb;
+
+  if (memcmp(p_cb->private_key, p_work->private_key, BT_OCTET32_LEN) != 0) {
+    SMP_TRACE_DEBUG("%s private key changed, public key dropped", __func__);
+  } else {
+    smp_process_public_key(p_cb, &p_work->public_key);
+  }
+
+  osi_free(p_work);
+}
+
 /*******************************************************************************
  *
  * Function         smp_process_private_key
  *
  * Description      This function processes private key.
  *                  It calculates public key and notifies SM that private key /
- *                  public key pair is created.
+ *                  public key pair is created. The calculation is done on
+ *                  bt_executor when available, as it takes tens of
+ *                  milliseconds on slow CPUs.
  *
  * Returns          void
  *
  ******************************************************************************/
 void smp_process_private_key(tSMP_CB* p_cb) {
-  Point public_key;
-  BT_OCTET32 private_key;
-
   SMP_TRACE_DEBUG("%s", __func__);
 
-  memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
-  memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
-  memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
+  tSMP_PUBL_KEY_WORK* p_work =
+      (tSMP_PUBL_KEY_WORK*)osi_malloc(sizeof(tSMP_PUBL_KEY_WORK));
+  p_work->p_cb = p_cb;
+  memcpy(p_work->private_key, p_cb->private_key, BT_OCTET32_LEN);
+
+  if (bt_executor != NULL &&
+      executor_post(bt_executor, smp_calculate_public_key, p_work,
+                    bt_workqueue_thread, smp_public_key_calculated)) {
+    return;
+  }
+
+  smp_public_key_calculated(p_work, smp_calculate_public_key(p_work));
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_process_public_key
+ *
+ * Description      This function stores the local public key calculated from
+ *                  the private key.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_process_public_key(tSMP_CB* p_cb, Point* p_public_key) {
+  memcpy(p_cb->loc_publ_key.x, p_public_key->x, BT_OCTET32_LEN);
+  memcpy(p_cb->loc_publ_key.y, p_public_key->y, BT_OCTET32_LEN);
+  smp_local_public_key_created(p_cb);
+}
 
+/*******************************************************************************
+ *
+ * Function         smp_local_public_key_created
+ *
+ * Description      This function notifies SM that private key / public key
+ *                  pair is created.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_local_public_key_created(tSMP_CB* p_cb) {
   smp_debug_print_nbyte_little_endian(p_cb->private_key, "private",
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->loc_publ_key.x, "local public(x)",
@@ -850,8 +943,8 @@ void smp_compute_dhkey(tSMP_CB* p_cb) {
   memcpy(peer_publ_key.x, p_cb->peer_publ_key.x, BT_OCTET32_LEN);
   memcpy(peer_publ_key.y, p_cb->peer_publ_key.y, BT_OCTET32_LEN);
 
-  ECC_PointMult(&new_publ_key, &peer_publ_key, (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Window(&new_publ_key, &peer_publ_key,
+                       (const uint32_t*)private_key);
 
   memcpy(p_cb->dhkey, new_publ_key.x, BT_OCTET32_LEN);
 
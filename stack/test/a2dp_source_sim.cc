@@ -0,0 +1,397 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "a2dp_source_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <deque>
+
+#include "osi/include/allocator.h"
+#include "osi/include/time.h"
+#include "stack/include/a2dp_api.h"
+#include "stack/include/a2dp_codec_api.h"
+
+#define US_PER_SEC 1000000
+
+// The step of the virtual clock
+#define SIM_STEP_US 1000
+
+// The time the virtual clock starts at: some of the stack takes a time of 0
+// as unset.
+#define SIM_START_US (1000 * 1000)
+
+// The maximum PCM the feeder holds, as the UIPC socket would
+#define SIM_FEEDER_MAX_US (200 * 1000)
+
+// The maximum link budget saved up while the tx queue is empty
+#define SIM_LINK_MAX_BUDGET_BYTES 2048
+
+static const tA2DP_ENCODER_INIT_PEER_PARAMS sim_peer_params = {
+    true /* is_peer_edr */, true /* peer_supports_3mbps */,
+    1008 /* peer_mtu */};
+
+typedef struct {
+  BT_HDR* p_buf;
+  uint64_t enqueue_us;
+} sim_tx_entry_t;
+
+typedef struct {
+  uint64_t arrival_us;
+  uint64_t bytes;
+} sim_pcm_chunk_t;
+
+typedef struct {
+  const tA2DP_SOURCE_SIM_SCENARIO* p_scenario;
+  tA2DP_SOURCE_SIM_REPORT* p_report;
+  uint8_t codec_info[AVDT_CODEC_SIZE];
+  uint32_t random_state;
+
+  uint64_t pcm_bytes_per_second;
+  uint64_t pcm_produced_remainder;  // PCM octets times |US_PER_SEC|
+  std::deque<sim_pcm_chunk_t> pcm_in_flight;
+  uint64_t pcm_available;
+
+  std::deque<sim_tx_entry_t> tx_queue;
+  size_t tx_queue_bytes;
+  uint64_t link_budget;
+  bool link_was_congested;  // Since the previous media tick
+  uint64_t received_bytes;
+  uint64_t sample_sent_bytes;
+} sim_state_t;
+
+// The simulation is single threaded, and the callbacks of the encoders do
+// not take any context.
+static sim_state_t* sim;
+static uint64_t sim_now_us = SIM_START_US;
+
+uint32_t time_get_os_boottime_ms(void) {
+  return (uint32_t)(sim_now_us / 1000);
+}
+
+uint64_t time_get_os_boottime_us(void) { return sim_now_us; }
+
+uint64_t time_gettimeofday_us(void) { return sim_now_us; }
+
+// Returns a pseudo-random number in [0, |range|), or 0 if |range| is 0.
+static uint64_t sim_random(uint64_t range) {
+  // The LCG of Numerical Recipes: the same sequence on every platform
+  sim->random_state = sim->random_state * 1664525u + 1013904223u;
+  if (range == 0) return 0;
+  return (uint64_t)(sim->random_state >> 8) % range;
+}
+
+// Checks whether |elapsed_us| falls in the first |length_us| of a window
+// repeating every |period_us|.
+static bool sim_in_window(uint64_t elapsed_us, uint64_t period_us,
+                          uint64_t length_us) {
+  return period_us > 0 && (elapsed_us % period_us) < length_us;
+}
+
+static uint32_t sim_read_callback(uint8_t* p_buf, uint32_t len) {
+  uint32_t bytes_read =
+      (sim->pcm_available < len) ? (uint32_t)sim->pcm_available : len;
+  sim->pcm_available -= bytes_read;
+
+  // White noise: the worst case of the variable bit rate codecs
+  for (uint32_t i = 0; i < bytes_read; i++) p_buf[i] = (uint8_t)sim_random(256);
+
+  if (bytes_read < len) {
+    sim->p_report->underflows++;
+    sim->p_report->underflow_bytes += len - bytes_read;
+  }
+  return bytes_read;
+}
+
+static void sim_drop_front(void) {
+  BT_HDR* p_buf = sim->tx_queue.front().p_buf;
+  sim->tx_queue_bytes -= p_buf->len;
+  sim->tx_queue.pop_front();
+  sim->p_report->dropped_packets++;
+  osi_free(p_buf);
+}
+
+// Same overflow handling as btif_a2dp_source_enqueue_callback().
+static bool sim_enqueue_callback(BT_HDR* p_buf, size_t frames_n) {
+  (void)frames_n;
+  const tA2DP_SOURCE_SIM_SCENARIO* p_scenario = sim->p_scenario;
+
+  if (sim->tx_queue.size() + 1 > p_scenario->tx_queue_max_packets) {
+    sim->p_report->dropouts++;
+    if (p_scenario->tx_queue_flush_all) {
+      while (!sim->tx_queue.empty()) sim_drop_front();
+    } else {
+      while (!sim->tx_queue.empty() &&
+             sim->tx_queue.size() + 1 > p_scenario->tx_queue_max_packets) {
+        // Drop the oldest frame, with all of its fragments
+        bool frame_end = false;
+        while (!sim->tx_queue.empty() && !frame_end) {
+          frame_end = A2DP_PacketEndsFrame(sim->codec_info,
+                                           sim->tx_queue.front().p_buf);
+          sim_drop_front();
+        }
+      }
+    }
+  }
+
+  sim_tx_entry_t entry = {p_buf, sim_now_us};
+  sim->tx_queue.push_back(entry);
+  sim->tx_queue_bytes += p_buf->len;
+  sim->p_report->enqueued_packets++;
+  if (sim->tx_queue.size() > sim->p_report->max_queue_packets)
+    sim->p_report->max_queue_packets = sim->tx_queue.size();
+  return true;
+}
+
+static uint64_t sim_queue_delay_us(void) {
+  if (sim->tx_queue.empty()) return 0;
+  return sim_now_us - sim->tx_queue.front().enqueue_us;
+}
+
+// Produces the PCM of one step of the virtual clock, and delivers the PCM
+// that reached the feeder.
+static void sim_feeder_step(uint64_t elapsed_us) {
+  const tA2DP_SOURCE_SIM_SCENARIO* p_scenario = sim->p_scenario;
+
+  if (!sim_in_window(elapsed_us, p_scenario->feeder_stall_period_us,
+                     p_scenario->feeder_stall_us)) {
+    sim->pcm_produced_remainder += sim->pcm_bytes_per_second * SIM_STEP_US;
+    sim_pcm_chunk_t chunk;
+    chunk.arrival_us = sim_now_us + sim_random(p_scenario->feeder_jitter_us);
+    chunk.bytes = sim->pcm_produced_remainder / US_PER_SEC;
+    sim->pcm_produced_remainder %= US_PER_SEC;
+    sim->pcm_in_flight.push_back(chunk);
+  }
+
+  uint64_t max_available =
+      sim->pcm_bytes_per_second * SIM_FEEDER_MAX_US / US_PER_SEC;
+  for (auto iter = sim->pcm_in_flight.begin();
+       iter != sim->pcm_in_flight.end();) {
+    if (iter->arrival_us > sim_now_us) {
+      ++iter;
+      continue;
+    }
+    sim->pcm_available += iter->bytes;
+    iter = sim->pcm_in_flight.erase(iter);
+  }
+  if (sim->pcm_available > max_available) sim->pcm_available = max_available;
+}
+
+// Drains the tx queue for one step of the virtual clock.
+static void sim_sink_step(uint64_t elapsed_us) {
+  const tA2DP_SOURCE_SIM_SCENARIO* p_scenario = sim->p_scenario;
+
+  if (sim_in_window(elapsed_us, p_scenario->congestion_period_us,
+                    p_scenario->congestion_us)) {
+    sim->link_was_congested = true;
+    return;
+  }
+
+  sim->link_budget +=
+      (uint64_t)p_scenario->link_bytes_per_second * SIM_STEP_US / US_PER_SEC;
+  while (!sim->tx_queue.empty() &&
+         sim->link_budget >= sim->tx_queue.front().p_buf->len) {
+    BT_HDR* p_buf = sim->tx_queue.front().p_buf;
+    sim->tx_queue.pop_front();
+    sim->tx_queue_bytes -= p_buf->len;
+    sim->link_budget -= p_buf->len;
+    sim->p_report->sent_packets++;
+    sim->p_report->sent_bytes += p_buf->len;
+    sim->sample_sent_bytes += p_buf->len;
+    if (sim_random(1000) < p_scenario->loss_per_mille) {
+      sim->p_report->lost_packets++;
+    } else {
+      sim->received_bytes += p_buf->len;
+    }
+    osi_free(p_buf);
+  }
+  if (sim->tx_queue.empty() && sim->link_budget > SIM_LINK_MAX_BUDGET_BYTES)
+    sim->link_budget = SIM_LINK_MAX_BUDGET_BYTES;
+}
+
+static void sim_take_sample(uint64_t elapsed_us, uint64_t interval_us) {
+  tA2DP_SOURCE_SIM_SAMPLE sample;
+  sample.time_us = elapsed_us;
+  sample.queue_packets = sim->tx_queue.size();
+  sample.queue_bytes = sim->tx_queue_bytes;
+  sample.queue_delay_us = sim_queue_delay_us();
+  sample.sent_kbps = (uint32_t)(sim->sample_sent_bytes * 8 * 1000 /
+                                (interval_us > 0 ? interval_us : 1));
+  sim->sample_sent_bytes = 0;
+  sim->p_report->samples.push_back(sample);
+}
+
+void a2dp_source_sim_init_scenario(tA2DP_SOURCE_SIM_SCENARIO* p_scenario) {
+  p_scenario->codec_index = BTAV_A2DP_CODEC_INDEX_SOURCE_SBC;
+  p_scenario->duration_us = 10 * US_PER_SEC;
+  p_scenario->tick_jitter_us = 0;
+  p_scenario->feeder_jitter_us = 0;
+  p_scenario->feeder_stall_period_us = 0;
+  p_scenario->feeder_stall_us = 0;
+  p_scenario->link_bytes_per_second = 1000 * 1000 / 8;  // 1 Mbps
+  p_scenario->congestion_period_us = 0;
+  p_scenario->congestion_us = 0;
+  p_scenario->loss_per_mille = 0;
+  // Same as MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ
+  p_scenario->tx_queue_max_packets = 14 * 6;
+  p_scenario->tx_queue_flush_all = false;
+  p_scenario->sample_interval_us = 100 * 1000;
+  p_scenario->seed = 1;
+  p_scenario->dump_fd = -1;
+}
+
+bool a2dp_source_sim_run(const tA2DP_SOURCE_SIM_SCENARIO* p_scenario,
+                         tA2DP_SOURCE_SIM_REPORT* p_report) {
+  std::vector<btav_a2dp_codec_config_t> default_priorities;
+  A2dpCodecs codecs(default_priorities);
+  tAVDT_CFG avdt_cfg;
+  sim_state_t state;
+
+  p_report->ticks = 0;
+  p_report->enqueued_packets = 0;
+  p_report->sent_packets = 0;
+  p_report->lost_packets = 0;
+  p_report->sent_bytes = 0;
+  p_report->dropouts = 0;
+  p_report->dropped_packets = 0;
+  p_report->underflows = 0;
+  p_report->underflow_bytes = 0;
+  p_report->max_queue_packets = 0;
+  p_report->max_queue_delay_us = 0;
+  p_report->effective_kbps = 0;
+  p_report->samples.clear();
+
+  memset(&avdt_cfg, 0, sizeof(avdt_cfg));
+  if (!codecs.init() ||
+      !A2DP_InitCodecConfig(p_scenario->codec_index, &avdt_cfg) ||
+      !codecs.setCodecConfig(avdt_cfg.codec_info, true /* is_capability */,
+                             state.codec_info,
+                             true /* select_current_codec */)) {
+    return false;
+  }
+  A2dpCodecConfig* codec_config = codecs.getCurrentCodecConfig();
+  const tA2DP_ENCODER_INTERFACE* encoder_interface =
+      A2DP_GetEncoderInterface(state.codec_info);
+  if (codec_config == nullptr || encoder_interface == nullptr) return false;
+
+  state.p_scenario = p_scenario;
+  state.p_report = p_report;
+  state.random_state = p_scenario->seed;
+  int bits_per_sample = codec_config->getAudioBitsPerSample();
+  state.pcm_bytes_per_second =
+      (uint64_t)A2DP_GetTrackSampleRate(state.codec_info) *
+      A2DP_GetTrackChannelCount(state.codec_info) *
+      ((bits_per_sample > 0) ? bits_per_sample / 8 : 2);
+  state.pcm_produced_remainder = 0;
+  state.pcm_available = 0;
+  state.tx_queue_bytes = 0;
+  state.link_budget = 0;
+  state.link_was_congested = false;
+  state.received_bytes = 0;
+  state.sample_sent_bytes = 0;
+  sim = &state;
+  sim_now_us = SIM_START_US;
+
+  A2DP_InitEncoderPacketPool(sim_peer_params.peer_mtu,
+                             p_scenario->tx_queue_max_packets);
+  encoder_interface->encoder_init(&sim_peer_params, codec_config,
+                                  sim_read_callback, sim_enqueue_callback);
+  encoder_interface->feeding_reset();
+
+  uint64_t interval_us = encoder_interface->get_encoder_interval_ms() * 1000;
+  uint64_t next_tick_us = interval_us;  // Nominal time of the next tick
+  uint64_t tick_lateness_us = sim_random(p_scenario->tick_jitter_us);
+  uint64_t next_sample_us = p_scenario->sample_interval_us;
+
+  for (uint64_t elapsed_us = 0; elapsed_us < p_scenario->duration_us;
+       elapsed_us += SIM_STEP_US) {
+    sim_now_us = SIM_START_US + elapsed_us;
+    sim_feeder_step(elapsed_us);
+
+    if (elapsed_us >= next_tick_us + tick_lateness_us) {
+      // Same as btif_a2dp_source_audio_handle_timer()
+      if (encoder_interface->set_transmit_queue_length != nullptr)
+        encoder_interface->set_transmit_queue_length(sim->tx_queue.size());
+      uint64_t queue_delay_us = sim_queue_delay_us();
+      if (encoder_interface->set_transmit_queue_delay != nullptr) {
+        encoder_interface->set_transmit_queue_delay(queue_delay_us,
+                                                    sim->link_was_congested);
+      }
+      sim->link_was_congested = false;
+      encoder_interface->send_frames(sim_now_us);
+      p_report->ticks++;
+
+      // The alarm is periodic: the lateness of a tick does not delay the
+      // next ones.
+      next_tick_us += interval_us;
+      tick_lateness_us = sim_random(p_scenario->tick_jitter_us);
+    }
+
+    sim_sink_step(elapsed_us);
+
+    uint64_t queue_delay_us = sim_queue_delay_us();
+    if (queue_delay_us > p_report->max_queue_delay_us)
+      p_report->max_queue_delay_us = queue_delay_us;
+    if (p_scenario->sample_interval_us > 0 && elapsed_us >= next_sample_us) {
+      sim_take_sample(elapsed_us, p_scenario->sample_interval_us);
+      next_sample_us += p_scenario->sample_interval_us;
+    }
+  }
+
+  if (p_scenario->duration_us > 0) {
+    p_report->effective_kbps =
+        (uint32_t)(sim->received_bytes * 8 * 1000 / p_scenario->duration_us);
+  }
+  if (p_scenario->dump_fd >= 0) codecs.debug_codec_dump(p_scenario->dump_fd);
+
+  encoder_interface->encoder_cleanup();
+  while (!sim->tx_queue.empty()) {
+    osi_free(sim->tx_queue.front().p_buf);
+    sim->tx_queue.pop_front();
+  }
+  A2DP_CleanupEncoderPacketPool();
+  sim = NULL;
+  return true;
+}
+
+void a2dp_source_sim_dump_report(const tA2DP_SOURCE_SIM_REPORT* p_report,
+                                 int fd) {
+  dprintf(fd, "Ticks: %zu\n", p_report->ticks);
+  dprintf(fd, "Packets enqueued/sent/lost: %zu / %zu / %zu\n",
+          p_report->enqueued_packets, p_report->sent_packets,
+          p_report->lost_packets);
+  dprintf(fd, "Bytes sent: %llu\n", (unsigned long long)p_report->sent_bytes);
+  dprintf(fd, "Dropouts: %zu (%zu packets dropped)\n", p_report->dropouts,
+          p_report->dropped_packets);
+  dprintf(fd, "Underflows: %zu (%llu bytes short)\n", p_report->underflows,
+          (unsigned long long)p_report->underflow_bytes);
+  dprintf(fd, "Max queue: %zu packets, %llu ms\n",
+          p_report->max_queue_packets,
+          (unsigned long long)(p_report->max_queue_delay_us / 1000));
+  dprintf(fd, "Effective bitrate: %u kbps\n", p_report->effective_kbps);
+
+  dprintf(fd, "\ntime_ms,queue_packets,queue_bytes,queue_delay_ms,sent_kbps\n");
+  for (const tA2DP_SOURCE_SIM_SAMPLE& sample : p_report->samples) {
+    dprintf(fd, "%llu,%zu,%zu,%llu,%u\n",
+            (unsigned long long)(sample.time_us / 1000), sample.queue_packets,
+            sample.queue_bytes,
+            (unsigned long long)(sample.queue_delay_us / 1000),
+            sample.sent_kbps);
+  }
+}
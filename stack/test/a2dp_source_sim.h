@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//
+// Deterministic simulation of the A2DP Source streaming path
+//
+// The simulation runs the real encoder of a codec on a virtual clock, with
+// the media task of btif_a2dp_source.cc modeled around it: a media tick
+// every encoder interval that reports the tx queue to the encoder and calls
+// |send_frames|, a PCM feeder standing in for the audio HAL over UIPC, and
+// an L2CAP sink draining the tx queue at the link rate. The feeder and the
+// sink follow the patterns of a scenario, driven by a seeded pseudo-random
+// generator, so a scenario always replays the same way, and much faster
+// than in real time.
+//
+// The simulation provides the OSI time functions, so the whole stack linked
+// with it reads the virtual clock.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <hardware/bt_av.h>
+
+typedef struct {
+  btav_a2dp_codec_index_t codec_index;
+  uint64_t duration_us;
+
+  // The media ticks are late by up to |tick_jitter_us|.
+  uint64_t tick_jitter_us;
+
+  // The PCM reaches the feeder late by up to |feeder_jitter_us|. Every
+  // |feeder_stall_period_us|, the feeder produces no PCM at all for
+  // |feeder_stall_us|.
+  uint64_t feeder_jitter_us;
+  uint64_t feeder_stall_period_us;  // 0 for no stalls
+  uint64_t feeder_stall_us;
+
+  // The sink drains |link_bytes_per_second|. Every |congestion_period_us|,
+  // the link is congested and drains nothing for |congestion_us|. Each
+  // packet sent is lost with a probability of |loss_per_mille| / 1000.
+  uint32_t link_bytes_per_second;
+  uint64_t congestion_period_us;  // 0 for no congestion
+  uint64_t congestion_us;
+  uint32_t loss_per_mille;
+
+  // The tx queue holds up to |tx_queue_max_packets|. On overflow, the whole
+  // queue is flushed if |tx_queue_flush_all|, otherwise the oldest frames
+  // are dropped until the new packet fits.
+  size_t tx_queue_max_packets;
+  bool tx_queue_flush_all;
+
+  uint64_t sample_interval_us;  // Interval of the report samples
+  uint32_t seed;                // Seed of the pseudo-random generator
+  int dump_fd;  // The codec state is dumped there at the end, unless -1
+} tA2DP_SOURCE_SIM_SCENARIO;
+
+typedef struct {
+  uint64_t time_us;  // Since the start of the simulation
+  size_t queue_packets;
+  size_t queue_bytes;
+  uint64_t queue_delay_us;  // Age of the oldest packet in the tx queue
+  uint32_t sent_kbps;       // Data rate sent since the previous sample
+} tA2DP_SOURCE_SIM_SAMPLE;
+
+typedef struct {
+  size_t ticks;
+  size_t enqueued_packets;
+  size_t sent_packets;
+  size_t lost_packets;
+  uint64_t sent_bytes;
+
+  size_t dropouts;         // Tx queue overflows
+  size_t dropped_packets;  // Packets dropped by the overflows
+  size_t underflows;       // PCM reads that were short
+  uint64_t underflow_bytes;
+
+  size_t max_queue_packets;
+  uint64_t max_queue_delay_us;
+  uint32_t effective_kbps;  // Data rate sent and not lost
+
+  std::vector<tA2DP_SOURCE_SIM_SAMPLE> samples;
+} tA2DP_SOURCE_SIM_REPORT;
+
+// Initializes |p_scenario| to a clean 10 seconds SBC stream over a link
+// that is fast enough.
+void a2dp_source_sim_init_scenario(tA2DP_SOURCE_SIM_SCENARIO* p_scenario);
+
+// Runs the scenario |p_scenario|, and stores the outcome in |p_report|.
+// Returns false if the codec of the scenario is not supported.
+bool a2dp_source_sim_run(const tA2DP_SOURCE_SIM_SCENARIO* p_scenario,
+                         tA2DP_SOURCE_SIM_REPORT* p_report);
+
+// Writes the report |p_report| to |fd|: a summary, followed by the samples
+// as CSV.
+void a2dp_source_sim_dump_report(const tA2DP_SOURCE_SIM_REPORT* p_report,
+                                 int fd);
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Runs a scenario of the A2DP Source streaming simulation, and prints its
+// report to the standard output. The scenario is a clean 10 seconds SBC
+// stream, changed by the arguments:
+//
+//   --codec=<index>         btav_a2dp_codec_index_t of the codec
+//   --duration_ms=<ms>
+//   --link_kbps=<kbps>      Data rate drained by the link
+//   --congestion=<period_ms>,<ms>
+//   --loss=<per mille>
+//   --jitter=<tick ms>,<feeder ms>
+//   --stall=<period_ms>,<ms>
+//   --queue=<packets>       Capacity of the tx queue
+//   --policy=<drop_oldest|flush_all>
+//   --seed=<n>
+//   --dump                  Dumps the codec state at the end
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "a2dp_source_sim.h"
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [--codec=N] [--duration_ms=MS] [--link_kbps=KBPS] "
+          "[--congestion=PERIOD_MS,MS] [--loss=PER_MILLE] "
+          "[--jitter=TICK_MS,FEEDER_MS] [--stall=PERIOD_MS,MS] "
+          "[--queue=PACKETS] [--policy=drop_oldest|flush_all] [--seed=N] "
+          "[--dump]\n",
+          name);
+}
+
+// Parses the pair "<a>,<b>" of milliseconds |value| into microseconds.
+static bool parse_ms_pair(const char* value, uint64_t* p_a_us,
+                          uint64_t* p_b_us) {
+  unsigned long a, b;
+  if (sscanf(value, "%lu,%lu", &a, &b) != 2) return false;
+  *p_a_us = (uint64_t)a * 1000;
+  *p_b_us = (uint64_t)b * 1000;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  tA2DP_SOURCE_SIM_SCENARIO scenario;
+  a2dp_source_sim_init_scenario(&scenario);
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = strchr(arg, '=');
+    value = (value != NULL) ? value + 1 : "";
+    bool ok = true;
+
+    if (strncmp(arg, "--codec=", 8) == 0) {
+      scenario.codec_index = (btav_a2dp_codec_index_t)atoi(value);
+    } else if (strncmp(arg, "--duration_ms=", 14) == 0) {
+      scenario.duration_us = strtoull(value, NULL, 10) * 1000;
+    } else if (strncmp(arg, "--link_kbps=", 12) == 0) {
+      scenario.link_bytes_per_second = strtoul(value, NULL, 10) * 1000 / 8;
+    } else if (strncmp(arg, "--congestion=", 13) == 0) {
+      ok = parse_ms_pair(value, &scenario.congestion_period_us,
+                         &scenario.congestion_us);
+    } else if (strncmp(arg, "--loss=", 7) == 0) {
+      scenario.loss_per_mille = strtoul(value, NULL, 10);
+    } else if (strncmp(arg, "--jitter=", 9) == 0) {
+      ok = parse_ms_pair(value, &scenario.tick_jitter_us,
+                         &scenario.feeder_jitter_us);
+    } else if (strncmp(arg, "--stall=", 8) == 0) {
+      ok = parse_ms_pair(value, &scenario.feeder_stall_period_us,
+                         &scenario.feeder_stall_us);
+    } else if (strncmp(arg, "--queue=", 8) == 0) {
+      scenario.tx_queue_max_packets = strtoul(value, NULL, 10);
+      ok = scenario.tx_queue_max_packets > 0;
+    } else if (strncmp(arg, "--policy=", 9) == 0) {
+      ok = strcmp(value, "drop_oldest") == 0 || strcmp(value, "flush_all") == 0;
+      scenario.tx_queue_flush_all = strcmp(value, "flush_all") == 0;
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      scenario.seed = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--dump") == 0) {
+      scenario.dump_fd = STDOUT_FILENO;
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  tA2DP_SOURCE_SIM_REPORT report;
+  if (!a2dp_source_sim_run(&scenario, &report)) {
+    fprintf(stderr, "%s: codec %d is not supported\n", argv[0],
+            scenario.codec_index);
+    return 1;
+  }
+  fflush(stdout);
+  a2dp_source_sim_dump_report(&report, STDOUT_FILENO);
+  return 0;
+}
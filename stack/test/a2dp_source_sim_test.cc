@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "a2dp_source_sim.h"
+
+class A2dpSourceSimTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    a2dp_source_sim_init_scenario(&scenario);
+    scenario.duration_us = 5 * 1000 * 1000;
+  }
+
+  tA2DP_SOURCE_SIM_SCENARIO scenario;
+  tA2DP_SOURCE_SIM_REPORT report;
+};
+
+TEST_F(A2dpSourceSimTest, test_clean_stream) {
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+  EXPECT_GT(report.ticks, 0u);
+  EXPECT_GT(report.sent_packets, 0u);
+  EXPECT_EQ(0u, report.dropouts);
+  EXPECT_EQ(0u, report.lost_packets);
+  EXPECT_GT(report.effective_kbps, 0u);
+  EXPECT_EQ(scenario.duration_us / scenario.sample_interval_us - 1,
+            report.samples.size());
+}
+
+TEST_F(A2dpSourceSimTest, test_deterministic) {
+  scenario.tick_jitter_us = 5000;
+  scenario.feeder_jitter_us = 10000;
+  scenario.loss_per_mille = 20;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+
+  tA2DP_SOURCE_SIM_REPORT other;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &other));
+  EXPECT_EQ(report.ticks, other.ticks);
+  EXPECT_EQ(report.sent_packets, other.sent_packets);
+  EXPECT_EQ(report.lost_packets, other.lost_packets);
+  EXPECT_EQ(report.sent_bytes, other.sent_bytes);
+  EXPECT_EQ(report.underflows, other.underflows);
+  ASSERT_EQ(report.samples.size(), other.samples.size());
+  for (size_t i = 0; i < report.samples.size(); i++) {
+    EXPECT_EQ(report.samples[i].queue_bytes, other.samples[i].queue_bytes);
+    EXPECT_EQ(report.samples[i].sent_kbps, other.samples[i].sent_kbps);
+  }
+  EXPECT_GT(report.lost_packets, 0u);
+}
+
+TEST_F(A2dpSourceSimTest, test_congestion) {
+  scenario.congestion_period_us = 3 * 1000 * 1000;
+  scenario.congestion_us = 2 * 1000 * 1000;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+  EXPECT_GT(report.dropouts, 0u);
+  EXPECT_EQ(scenario.tx_queue_max_packets, report.max_queue_packets);
+  EXPECT_GE(report.max_queue_delay_us, 1000u * 1000);
+}
+
+TEST_F(A2dpSourceSimTest, test_flush_all) {
+  scenario.congestion_period_us = 3 * 1000 * 1000;
+  scenario.congestion_us = 2 * 1000 * 1000;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+  size_t dropped_oldest = report.dropped_packets;
+
+  scenario.tx_queue_flush_all = true;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+  EXPECT_GT(report.dropouts, 0u);
+  EXPECT_GT(report.dropped_packets, 0u);
+  EXPECT_NE(dropped_oldest, report.dropped_packets);
+}
+
+TEST_F(A2dpSourceSimTest, test_feeder_stall) {
+  scenario.feeder_stall_period_us = 1000 * 1000;
+  scenario.feeder_stall_us = 300 * 1000;
+  ASSERT_TRUE(a2dp_source_sim_run(&scenario, &report));
+  EXPECT_GT(report.underflows, 0u);
+  EXPECT_GT(report.underflow_bytes, 0u);
+  EXPECT_EQ(0u, report.dropouts);
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of finding the fields the stack looks at in each advertising report,
+// as btm_ble_update_inq_result and the name lookups do: with a scan of the
+// report for each field, and with a single pass for all of them.
+
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "advertise_data_parser.h"
+
+namespace {
+
+constexpr uint8_t kFlags = 0x01;
+constexpr uint8_t kUuid16Complete = 0x03;
+constexpr uint8_t kShortenedName = 0x08;
+constexpr uint8_t kCompleteName = 0x09;
+constexpr uint8_t kAppearance = 0x19;
+
+// Reports as seen in busy places: beacons, trackers and phones
+const std::vector<std::vector<uint8_t>> kReports = {
+    // iBeacon
+    {0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xC5,
+     0x6D, 0xB5, 0xDF, 0xFB, 0x48, 0xD2, 0xB0, 0x60, 0xD0, 0xF5, 0xA7,
+     0x10, 0x96, 0xE0, 0x00, 0x01, 0x00, 0x02, 0xC5},
+    // Eddystone URL
+    {0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE, 0x0E, 0x16, 0xAA, 0xFE,
+     0x10, 0xEE, 0x03, 'e',  'x',  'a',  'm',  'p',  'l',  'e',  0x07},
+    // Apple continuity, without flags
+    {0x0B, 0xFF, 0x4C, 0x00, 0x10, 0x06, 0x1B, 0x1E, 0x4F, 0x3A, 0x8C,
+     0x2D},
+    // Fitness tracker, with a name and an appearance
+    {0x02, 0x01, 0x06, 0x03, 0x19, 0x41, 0x0C, 0x05, 0x03, 0x0D, 0x18,
+     0x0F, 0x18, 0x0A, 0x09, 'T',  'r',  'a',  'c',  'k',  'e',  'r',
+     ' ',  '2', 0x02, 0x0A, 0x00},
+    // Keyboard scan response, with a shortened name
+    {0x03, 0x19, 0xC1, 0x03, 0x03, 0x03, 0x12, 0x18, 0x05, 0x08, 'K',
+     'e',  'y',  'b'},
+};
+
+void BM_FieldByFieldScans(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    for (const auto& report : kReports) {
+      uint8_t len;
+      benchmark::DoNotOptimize(AdvertiseDataParser::GetFieldByType(
+          report.data(), report.size(), kFlags, &len));
+      benchmark::DoNotOptimize(AdvertiseDataParser::GetFieldByType(
+          report.data(), report.size(), kAppearance, &len));
+      benchmark::DoNotOptimize(AdvertiseDataParser::GetFieldByType(
+          report.data(), report.size(), kUuid16Complete, &len));
+      const uint8_t* name = AdvertiseDataParser::GetFieldByType(
+          report.data(), report.size(), kCompleteName, &len);
+      if (name == NULL)
+        name = AdvertiseDataParser::GetFieldByType(
+            report.data(), report.size(), kShortenedName, &len);
+      benchmark::DoNotOptimize(name);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kReports.size());
+}
+BENCHMARK(BM_FieldByFieldScans);
+
+void BM_SinglePass(benchmark::State& state) {
+  const uint8_t types[] = {kFlags, kAppearance, kUuid16Complete,
+                           kCompleteName, kShortenedName};
+  AdvertiseDataParser::Field fields[5];
+  while (state.KeepRunning()) {
+    for (const auto& report : kReports) {
+      AdvertiseDataParser::GetFieldsByType(report.data(), report.size(),
+                                           types, 5, fields);
+      benchmark::DoNotOptimize(fields);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kReports.size());
+}
+BENCHMARK(BM_SinglePass);
+
+}  // namespace
+
+BENCHMARK_MAIN();
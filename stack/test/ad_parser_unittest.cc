@@ -56,6 +56,15 @@ TEST(AdvertiseDataParserTest, IsValidGood) {
   EXPECT_TRUE(AdvertiseDataParser::IsValid(data1));
 }
 
+TEST(AdvertiseDataParserTest, IsValidInPlace) {
+  // The data of a report, followed by the RSSI, in an HCI event.
+  const uint8_t event[]{0x03, 0x02, 0x01, 0x02, 0xC4};
+  EXPECT_TRUE(AdvertiseDataParser::IsValid(event, 4));
+  EXPECT_TRUE(AdvertiseDataParser::IsValid(event, 0));
+  EXPECT_FALSE(AdvertiseDataParser::IsValid(event, 3));
+  EXPECT_FALSE(AdvertiseDataParser::IsValid(event, 5));
+}
+
 TEST(AdvertiseDataParserTest, GetFieldByType) {
   // Single field.
   const std::vector<uint8_t> data0{0x03, 0x02, 0x01, 0x02};
@@ -78,4 +87,47 @@ TEST(AdvertiseDataParserTest, GetFieldByType) {
   data = AdvertiseDataParser::GetFieldByType(data1, 0x03, &p_length);
   EXPECT_EQ(nullptr, data);
   EXPECT_EQ(0, p_length);
-}
\ No newline at end of file
+}
+TEST(AdvertiseDataParserTest, Fields) {
+  // Three fields, the last one length too long.
+  const uint8_t data[]{0x02, 0x01, 0x06, 0x03, 0x09, 'a', 'b', 0x04, 0xFF};
+
+  std::vector<uint8_t> types;
+  for (const auto& field : AdvertiseDataParser::Fields(data, sizeof(data))) {
+    types.push_back(field.type);
+    if (field.type == 0x09) {
+      EXPECT_EQ(data + 5, field.data);
+      EXPECT_EQ(2, field.len);
+    }
+  }
+  EXPECT_EQ((std::vector<uint8_t>{0x01, 0x09}), types);
+
+  int count = 0;
+  for (const auto& field : AdvertiseDataParser::Fields(data, 0)) {
+    (void)field;
+    count++;
+  }
+  EXPECT_EQ(0, count);
+}
+
+TEST(AdvertiseDataParserTest, GetFieldsByType) {
+  const uint8_t data[]{0x02, 0x01, 0x06, 0x03, 0x08, 'a', 'b',
+                       0x02, 0x08, 'c',  0x02, 0x0A, 0xF4};
+  const uint8_t types[]{0x08, 0x09, 0x01};
+
+  AdvertiseDataParser::Field fields[3];
+  EXPECT_EQ((size_t)2, AdvertiseDataParser::GetFieldsByType(
+                           data, sizeof(data), types, 3, fields));
+
+  // The first field of each type only.
+  EXPECT_EQ(0x08, fields[0].type);
+  EXPECT_EQ(data + 5, fields[0].data);
+  EXPECT_EQ(2, fields[0].len);
+
+  EXPECT_EQ(0x09, fields[1].type);
+  EXPECT_EQ(NULL, fields[1].data);
+  EXPECT_EQ(0, fields[1].len);
+
+  EXPECT_EQ(data + 2, fields[2].data);
+  EXPECT_EQ(1, fields[2].len);
+}
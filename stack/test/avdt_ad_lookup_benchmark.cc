@@ -0,0 +1,144 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of finding the AVDTP transport channel of the streams sending at
+// once, as avdt_ad_tc_tbl_by_type does for each signaling message and
+// report: searching the transport channel table, and through the stream
+// routing table.
+
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+// The layout of tAVDT_TC_TBL and tAVDT_RT_TBL.
+struct TcTbl {
+  uint16_t peer_mtu;
+  uint16_t my_mtu;
+  uint16_t my_flush_to;
+  uint16_t lcid;
+  uint8_t tcid;
+  uint8_t ccb_idx;
+  uint8_t state;
+  uint8_t cfg_flags;
+  uint8_t id;
+};
+
+struct RtTbl {
+  uint16_t lcid;
+  uint8_t scb_hdl;
+  uint8_t tc_idx;
+};
+
+// |num_links| links with |num_streams| streams each, and their signaling
+// and media channels allocated in the order they were opened.
+class Channels {
+ public:
+  Channels(int num_links, int num_streams)
+      : num_tc_(num_links * (num_streams + 1)),
+        num_rt_(num_streams + 1),
+        tc_tbl_(num_tc_),
+        rt_tbl_(num_links * num_rt_) {
+    memset(tc_tbl_.data(), 0, num_tc_ * sizeof(TcTbl));
+    for (int link = 0; link < num_links; link++) {
+      for (int tcid = 0; tcid <= num_streams; tcid++) {
+        // the channels of the links opened at once are interleaved
+        int idx = tcid * num_links + link;
+        TcTbl& tc = tc_tbl_[idx];
+        tc.tcid = tcid;
+        tc.ccb_idx = link;
+        tc.state = 1;
+        tc.peer_mtu = 895;
+        Rt(link, tcid).tc_idx = idx;
+        if (tcid != 0) channels_.push_back({link, tcid});
+      }
+    }
+  }
+
+  TcTbl* Search(int ccb_idx, int tcid) {
+    for (int i = 0; i < num_tc_; i++) {
+      TcTbl& tc = tc_tbl_[i];
+      if (tc.tcid == tcid && tc.ccb_idx == ccb_idx) return &tc;
+    }
+    return NULL;
+  }
+
+  // Takes the entry of the routing table first, as avdt_ad.cc does.
+  TcTbl* Find(int ccb_idx, int tcid, bool routed) {
+    if (!routed) return Search(ccb_idx, tcid);
+    uint8_t idx = Rt(ccb_idx, tcid).tc_idx;
+    if (idx < num_tc_ && tc_tbl_[idx].tcid == tcid &&
+        tc_tbl_[idx].ccb_idx == ccb_idx)
+      return &tc_tbl_[idx];
+    return Search(ccb_idx, tcid);
+  }
+
+  struct Channel {
+    int ccb_idx;
+    int tcid;
+  };
+  const std::vector<Channel>& channels() const { return channels_; }
+
+ private:
+  RtTbl& Rt(int ccb_idx, int tcid) {
+    return rt_tbl_[ccb_idx * num_rt_ + tcid];
+  }
+
+  const int num_tc_;
+  const int num_rt_;
+  std::vector<TcTbl> tc_tbl_;
+  std::vector<RtTbl> rt_tbl_;
+  std::vector<Channel> channels_;
+};
+
+void ChannelArgs(benchmark::internal::Benchmark* b) {
+  b->Args({1, 1});
+  b->Args({2, 3});
+  b->Args({4, 6});
+}
+
+// The channel of each stream looked up 16 times, and the signaling channel
+// of its link once.
+void Lookups(benchmark::State& state, bool routed) {
+  Channels channels(state.range(0), state.range(1));
+  while (state.KeepRunning()) {
+    for (const auto& channel : channels.channels()) {
+      for (int i = 0; i < 16; i++) {
+        benchmark::DoNotOptimize(
+            channels.Find(channel.ccb_idx, channel.tcid, routed));
+      }
+      benchmark::DoNotOptimize(channels.Find(channel.ccb_idx, 0, routed));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * channels.channels().size() *
+                          17);
+}
+
+void BM_SearchLookup(benchmark::State& state) { Lookups(state, false); }
+BENCHMARK(BM_SearchLookup)->Apply(ChannelArgs);
+
+void BM_RoutedLookup(benchmark::State& state) { Lookups(state, true); }
+BENCHMARK(BM_RoutedLookup)->Apply(ChannelArgs);
+
+}  // namespace
+
+BENCHMARK_MAIN();
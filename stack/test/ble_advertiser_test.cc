@@ -16,17 +16,25 @@
  *
  ******************************************************************************/
 
+#include <stdio.h>
+#include <string.h>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "device/include/controller.h"
+#include "osi/include/time.h"
 #include "stack/btm/ble_advertiser_hci_interface.h"
 #include "stack/include/ble_advertiser.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack_config.h"
 
 using ::testing::_;
+using ::testing::AnyNumber;
 using ::testing::Args;
 using ::testing::ElementsAreArray;
 using ::testing::Exactly;
+using ::testing::Invoke;
 using ::testing::IsEmpty;
 using ::testing::SaveArg;
 using base::Bind;
@@ -64,12 +72,22 @@ void alarm_set_on_queue(alarm_t* alarm, period_ms_t interval_ms,
   last_alarm_data = data;
 }
 
+void alarm_set_on_queue_with_slack(alarm_t* alarm, period_ms_t interval_ms,
+                                   period_ms_t slack_ms, alarm_callback_t cb,
+                                   void* data, fixed_queue_t* queue) {
+  alarm_set_on_queue(alarm, interval_ms, cb, data, queue);
+}
+
 void alarm_cancel(alarm_t* alarm) {}
 alarm_t* alarm_new_periodic(const char* name) { return nullptr; }
 alarm_t* alarm_new(const char* name) { return nullptr; }
 void alarm_free(alarm_t* alarm) {}
 const controller_t* controller_get_interface() { return nullptr; }
 fixed_queue_t* btu_general_alarm_queue = nullptr;
+const stack_config_t* stack_config_get_interface(void) { return nullptr; }
+
+uint32_t fake_time_ms = 0;
+uint32_t time_get_os_boottime_ms(void) { return fake_time_ms; }
 
 namespace {
 void DoNothing(uint8_t) {}
@@ -741,3 +759,152 @@ TEST_F(BleAdvertisingManagerTest,
   disable_cb.Run(0);
   remove_cb.Run(0);
 }
+
+/* This test verifies that with the rotation, the advertisers beyond the
+ * advertising sets are registered, and that the last set is reserved for
+ * them. */
+TEST_F(BleAdvertisingManagerTest, test_rotation_registration) {
+  const int rotated_advertisers = 4;
+  BleAdvertisingManager::Get()->SetRotation(rotated_advertisers);
+
+  for (int i = 0; i < num_adv_instances - 1 + rotated_advertisers; i++) {
+    BleAdvertisingManager::Get()->RegisterAdvertiser(Bind(
+        &BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+    EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, reg_status);
+    EXPECT_EQ(i < num_adv_instances - 1 ? i : i + 1, reg_inst_id);
+  }
+
+  BleAdvertisingManager::Get()->RegisterAdvertiser(
+      Bind(&BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+  EXPECT_EQ(ADVERTISE_FAILED_TOO_MANY_ADVERTISERS, reg_status);
+}
+
+/* This test verifies that the rotated advertisers take turns on the rotation
+ * set, with airtime in proportion to their advertising rate. */
+TEST_F(BleAdvertisingManagerTest, test_rotation_airtime) {
+  const uint8_t rotation_handle = num_adv_instances - 1;
+  BleAdvertisingManager::Get()->SetRotation(2);
+  for (int i = 0; i < num_adv_instances - 1; i++) {
+    BleAdvertisingManager::Get()->RegisterAdvertiser(Bind(DoNothing2));
+  }
+
+  // Rotated advertisers only support non-connectable advertising
+  BleAdvertisingManager::Get()->RegisterAdvertiser(
+      Bind(&BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+  uint8_t fast_id = reg_inst_id;
+  tBTM_BLE_ADV_PARAMS params = {};
+  params.advertising_event_properties =
+      BleAdvertisingManager::advertising_prop_legacy_connectable;
+  BleAdvertisingManager::Get()->SetParameters(
+      fast_id, &params, Bind(&BleAdvertisingManagerTest::SetParametersCb,
+                             base::Unretained(this)));
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_FAILURE, set_params_status);
+
+  BleAdvertisingManager::Get()->RegisterAdvertiser(
+      Bind(&BleAdvertisingManagerTest::RegistrationCb, base::Unretained(this)));
+  uint8_t slow_id = reg_inst_id;
+
+  // The controller completes the commands right away, and only the rotation
+  // set is programmed
+  int fast_turns = 0;
+  int slow_turns = 0;
+  EXPECT_CALL(*hci_mock, SetParameters1(rotation_handle, _, _, _, _, _, _, _,
+                                        _))
+      .Times(AnyNumber())
+      .WillRepeatedly(Invoke(
+          [&](uint8_t, uint16_t, uint32_t, uint32_t adv_int_max, uint8_t,
+              uint8_t, BD_ADDR, uint8_t, BD_ADDR) {
+            (adv_int_max == 160 ? fast_turns : slow_turns)++;
+          }));
+  EXPECT_CALL(*hci_mock, SetParameters2(_, _, _, _, _, _, _, _))
+      .Times(AnyNumber())
+      .WillRepeatedly(Invoke([](uint8_t, int8_t, uint8_t, uint8_t, uint8_t,
+                                uint8_t, uint8_t,
+                                parameters_cb cb) { cb.Run(0, 0); }));
+  EXPECT_CALL(*hci_mock, SetRandomAddress(rotation_handle, _, _))
+      .Times(AnyNumber())
+      .WillRepeatedly(
+          Invoke([](uint8_t, BD_ADDR, status_cb cb) { cb.Run(0); }));
+  EXPECT_CALL(*hci_mock, SetAdvertisingData(rotation_handle, _, _, _, _, _))
+      .Times(AnyNumber())
+      .WillRepeatedly(Invoke([](uint8_t, uint8_t, uint8_t, uint8_t, uint8_t*,
+                                status_cb cb) { cb.Run(0); }));
+  EXPECT_CALL(*hci_mock, SetScanResponseData(rotation_handle, _, _, _, _, _))
+      .Times(AnyNumber())
+      .WillRepeatedly(Invoke([](uint8_t, uint8_t, uint8_t, uint8_t, uint8_t*,
+                                status_cb cb) { cb.Run(0); }));
+  EXPECT_CALL(*hci_mock, Enable(_, rotation_handle, _, _, _))
+      .Times(AnyNumber())
+      .WillRepeatedly(Invoke([](uint8_t, uint8_t, uint16_t, uint8_t,
+                                status_cb cb) { cb.Run(0); }));
+
+  // A 100 ms and a 1 s advertising interval
+  params.advertising_event_properties =
+      BleAdvertisingManager::advertising_prop_legacy_non_connectable;
+  params.adv_int_min = params.adv_int_max = 160;
+  BleAdvertisingManager::Get()->SetParameters(
+      fast_id, &params, Bind(&BleAdvertisingManagerTest::SetParametersCb,
+                             base::Unretained(this)));
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_params_status);
+  params.adv_int_min = params.adv_int_max = 1600;
+  BleAdvertisingManager::Get()->SetParameters(
+      slow_id, &params, Bind(&BleAdvertisingManagerTest::SetParametersCb,
+                             base::Unretained(this)));
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, set_params_status);
+
+  BleAdvertisingManager::Get()->Enable(
+      fast_id, true,
+      Bind(&BleAdvertisingManagerTest::EnableCb, base::Unretained(this)), 0, 0,
+      base::Callback<void(uint8_t)>());
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, enable_status);
+  EXPECT_EQ(1, fast_turns);
+  BleAdvertisingManager::Get()->Enable(
+      slow_id, true,
+      Bind(&BleAdvertisingManagerTest::EnableCb, base::Unretained(this)), 0, 0,
+      base::Callback<void(uint8_t)>());
+  EXPECT_EQ(BTM_BLE_MULTI_ADV_SUCCESS, enable_status);
+  EXPECT_EQ(0, slow_turns);
+
+  // The rotation timer was the last alarm set
+  alarm_callback_t rotation_cb = last_alarm_cb;
+  for (int i = 0; i < 110; i++) {
+    fake_time_ms += BTM_BLE_ADV_ROTATION_SLOT_MS;
+    rotation_cb(nullptr);
+  }
+
+  // The advertisers alternate, and the fast one keeps the set about ten times
+  // longer on each turn
+  EXPECT_LE(slow_turns, fast_turns);
+  EXPECT_GE(slow_turns + 1, fast_turns);
+  FILE* dump = tmpfile();
+  ASSERT_NE(nullptr, dump);
+  BTM_BleAdvRotationDumpStatistics(fileno(dump));
+  rewind(dump);
+  char line[256];
+  unsigned id;
+  unsigned long long airtime_ms;
+  unsigned long long fast_airtime_ms = 0;
+  unsigned long long slow_airtime_ms = 0;
+  while (fgets(line, sizeof(line), dump)) {
+    const char* on_air = strstr(line, "turns, ");
+    if (sscanf(line, "  Advertiser %u", &id) != 1 || !on_air ||
+        sscanf(on_air, "turns, %llu ms on air", &airtime_ms) != 1)
+      continue;
+    (id == fast_id ? fast_airtime_ms : slow_airtime_ms) = airtime_ms;
+  }
+  fclose(dump);
+  EXPECT_NEAR(10.0, (double)fast_airtime_ms / slow_airtime_ms, 1.0);
+
+  // Once the fast advertiser is gone, the slow one keeps the set
+  BleAdvertisingManager::Get()->Unregister(fast_id);
+  int turns = slow_turns;
+  rotation_cb(nullptr);
+  EXPECT_LE(turns, slow_turns);
+  EXPECT_GE(turns + 1, slow_turns);
+
+  // ... and the set is disabled with the last rotated advertiser
+  EXPECT_CALL(*hci_mock, Enable(0x00 /* disable */, rotation_handle, _, _, _))
+      .Times(1);
+  BleAdvertisingManager::Get()->Unregister(slow_id);
+  ::testing::Mock::VerifyAndClearExpectations(hci_mock.get());
+}
@@ -0,0 +1,287 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "stack/btm/ble_bg_conn_list.h"
+
+namespace {
+
+void MakeAddr(uint32_t n, BD_ADDR addr) {
+  memset(addr, 0, BD_ADDR_LEN);
+  addr[5] = n & 0xFF;
+  addr[4] = (n >> 8) & 0xFF;
+}
+
+uint32_t AddrNum(const BD_ADDR addr) { return (addr[4] << 8) | addr[5]; }
+
+bool Add(BleBgConnList& list, uint32_t n, uint64_t now_ms,
+         bool connected = false) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.Add(addr, connected, now_ms);
+}
+
+bool Remove(BleBgConnList& list, uint32_t n) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.Remove(addr);
+}
+
+bool UpdateLink(BleBgConnList& list, uint32_t n, bool connected,
+                uint64_t now_ms) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.UpdateLink(addr, connected, now_ms);
+}
+
+struct Ops {
+  std::set<uint32_t> added;
+  std::set<uint32_t> removed;
+};
+
+/* Syncs |list| into |controller|, checking that the removals come first. */
+Ops Sync(BleBgConnList& list, std::set<uint32_t>* controller) {
+  std::vector<BleBgConnList::Op> ops;
+  list.Sync(&ops);
+
+  Ops result;
+  bool adding = false;
+  for (const auto& op : ops) {
+    uint32_t n = AddrNum(op.bd_addr);
+    if (op.to_add) {
+      adding = true;
+      EXPECT_TRUE(controller->insert(n).second);
+      result.added.insert(n);
+    } else {
+      EXPECT_FALSE(adding) << "removal after an addition";
+      EXPECT_EQ(1U, controller->erase(n));
+      result.removed.insert(n);
+    }
+  }
+  EXPECT_EQ(controller->size(), list.ControllerSize());
+  EXPECT_FALSE(list.NeedsSync());
+  return result;
+}
+
+}  // namespace
+
+TEST(BleBgConnListTest, BatchesChanges) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  EXPECT_TRUE(Add(list, 1, 0));
+  EXPECT_TRUE(Add(list, 2, 0));
+  EXPECT_TRUE(Add(list, 3, 0));
+  EXPECT_FALSE(Add(list, 3, 0));
+  EXPECT_TRUE(list.NeedsSync());
+  Ops ops = Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2, 3}), ops.added);
+  EXPECT_TRUE(ops.removed.empty());
+
+  /* a device removed then added back, and one added then removed, cost
+   * nothing */
+  EXPECT_TRUE(Remove(list, 2));
+  EXPECT_TRUE(Add(list, 2, 0));
+  EXPECT_TRUE(Add(list, 4, 0));
+  EXPECT_TRUE(Remove(list, 4));
+  EXPECT_TRUE(Remove(list, 1));
+  EXPECT_FALSE(Remove(list, 1));
+  ops = Sync(list, &controller);
+  EXPECT_TRUE(ops.added.empty());
+  EXPECT_EQ(std::set<uint32_t>({1}), ops.removed);
+  EXPECT_EQ(std::set<uint32_t>({2, 3}), controller);
+  EXPECT_EQ(2U, list.Size());
+
+  /* nothing left to do */
+  ops = Sync(list, &controller);
+  EXPECT_TRUE(ops.added.empty());
+  EXPECT_TRUE(ops.removed.empty());
+}
+
+TEST(BleBgConnListTest, Clear) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  Add(list, 1, 0);
+  Add(list, 2, 0);
+  Sync(list, &controller);
+  list.Clear();
+  controller.clear();
+  EXPECT_FALSE(list.NeedsSync());
+  EXPECT_FALSE(list.Pending());
+  EXPECT_EQ(0U, list.Size());
+  EXPECT_EQ(0U, list.ControllerSize());
+
+  Add(list, 1, 0);
+  Ops ops = Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1}), ops.added);
+}
+
+TEST(BleBgConnListTest, Pending) {
+  BleBgConnList list;
+  list.SetCapacity(8);
+  EXPECT_FALSE(list.Pending());
+
+  Add(list, 1, 0, true);
+  EXPECT_FALSE(list.Pending());
+  Add(list, 2, 0);
+  EXPECT_TRUE(list.Pending());
+  UpdateLink(list, 2, true, 1);
+  EXPECT_FALSE(list.Pending());
+  UpdateLink(list, 1, false, 2);
+  EXPECT_TRUE(list.Pending());
+}
+
+TEST(BleBgConnListTest, ConnectedKeptWhileFitting) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  Add(list, 1, 0);
+  Add(list, 2, 0, true);
+  Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), controller);
+
+  /* the link changes don't touch the white list */
+  EXPECT_FALSE(UpdateLink(list, 1, true, 1));
+  EXPECT_FALSE(UpdateLink(list, 2, false, 1));
+  EXPECT_FALSE(list.NeedsSync());
+  EXPECT_FALSE(list.Overflows());
+  EXPECT_FALSE(list.Rotate());
+}
+
+TEST(BleBgConnListTest, ConnectedLeftOutOfFullList) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  for (uint32_t n = 1; n <= 5; n++) Add(list, n, 0);
+  Sync(list, &controller);
+  EXPECT_EQ(4U, controller.size());
+  EXPECT_TRUE(list.Overflows());
+
+  /* once a device is connected, the others fit */
+  EXPECT_TRUE(UpdateLink(list, 1, true, 1));
+  Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({2, 3, 4, 5}), controller);
+  EXPECT_FALSE(list.Overflows());
+
+  /* and it is loaded back once disconnected, as the most recently active */
+  EXPECT_TRUE(UpdateLink(list, 1, false, 2));
+  Sync(list, &controller);
+  EXPECT_EQ(4U, controller.size());
+  EXPECT_EQ(1U, controller.count(1));
+}
+
+TEST(BleBgConnListTest, RecentlyActiveFirst) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  /* the devices 11 to 16 are the most recently active ones */
+  for (uint32_t n = 1; n <= 20; n++) Add(list, n, n < 11 || n > 16 ? 0 : n);
+  Sync(list, &controller);
+  EXPECT_EQ(8U, controller.size());
+  for (uint32_t n = 11; n <= 16; n++) EXPECT_EQ(1U, controller.count(n));
+
+  /* they keep their entries through the rotations */
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(list.Rotate());
+    Sync(list, &controller);
+    EXPECT_EQ(8U, controller.size());
+    for (uint32_t n = 11; n <= 16; n++) EXPECT_EQ(1U, controller.count(n));
+  }
+}
+
+TEST(BleBgConnListTest, RotatesThroughTheOthers) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  /* 6 recently active devices, and 14 taking turns in the 2 other entries */
+  for (uint32_t n = 1; n <= 20; n++) Add(list, n, n <= 6 ? 100 : 0);
+  Sync(list, &controller);
+
+  std::set<uint32_t> seen;
+  for (uint32_t n : controller)
+    if (n > 6) seen.insert(n);
+  EXPECT_EQ(2U, seen.size());
+
+  /* without a rotation, nothing changes */
+  Ops ops = Sync(list, &controller);
+  EXPECT_TRUE(ops.added.empty());
+
+  for (int i = 0; i < 6; i++) {
+    EXPECT_TRUE(list.Rotate());
+    ops = Sync(list, &controller);
+    EXPECT_EQ(2U, ops.added.size());
+    EXPECT_EQ(2U, ops.removed.size());
+    for (uint32_t n : ops.added) {
+      EXPECT_GT(n, 6U);
+      EXPECT_TRUE(seen.insert(n).second) << n << " had a turn already";
+    }
+  }
+  EXPECT_EQ(14U, seen.size());
+
+  /* and then the first ones have their turn again */
+  EXPECT_TRUE(list.Rotate());
+  ops = Sync(list, &controller);
+  EXPECT_EQ(2U, ops.added.size());
+}
+
+TEST(BleBgConnListTest, RemovalFreesEntry) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+  list.SetCapacity(2);
+
+  Add(list, 1, 2);
+  Add(list, 2, 1);
+  Add(list, 3, 0);
+  EXPECT_TRUE(list.Overflows());
+  Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), controller);
+
+  Remove(list, 1);
+  EXPECT_TRUE(list.NeedsSync());
+  Ops ops = Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1}), ops.removed);
+  EXPECT_EQ(std::set<uint32_t>({3}), ops.added);
+  EXPECT_FALSE(list.Overflows());
+}
+
+TEST(BleBgConnListTest, CapacityChange) {
+  BleBgConnList list;
+  std::set<uint32_t> controller;
+
+  Add(list, 1, 0);
+  Sync(list, &controller);
+  EXPECT_TRUE(controller.empty());
+
+  list.SetCapacity(1);
+  EXPECT_TRUE(list.NeedsSync());
+  Sync(list, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1}), controller);
+}
@@ -0,0 +1,261 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "stack/btm/ble_resolving_list.h"
+
+namespace {
+
+const uint64_t min_residency_ms = 1000;
+const size_t max_ops = 64;
+
+void MakeAddr(uint32_t n, BD_ADDR addr) {
+  memset(addr, 0, BD_ADDR_LEN);
+  addr[5] = n & 0xFF;
+  addr[4] = (n >> 8) & 0xFF;
+}
+
+uint32_t AddrNum(const BD_ADDR addr) { return (addr[4] << 8) | addr[5]; }
+
+bool Add(BleResolvingList& list, uint32_t n, uint64_t now_ms) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.Add(addr, now_ms);
+}
+
+bool Remove(BleResolvingList& list, uint32_t n) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.Remove(addr);
+}
+
+bool Resolved(BleResolvingList& list, uint32_t n, bool by_controller,
+              uint64_t now_ms) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return list.Resolved(addr, by_controller, now_ms);
+}
+
+struct Ops {
+  std::set<uint32_t> added;
+  std::set<uint32_t> removed;
+};
+
+/* Syncs |list| into |controller|, checking that the removals come first and
+ * that the controller list never exceeds its capacity. */
+Ops Sync(BleResolvingList& list, uint64_t now_ms,
+         std::set<uint32_t>* controller, size_t ops_budget = max_ops) {
+  std::vector<BleResolvingList::Op> ops;
+  list.Sync(now_ms, ops_budget, &ops);
+  EXPECT_LE(ops.size(), ops_budget);
+
+  Ops result;
+  bool adding = false;
+  for (const auto& op : ops) {
+    uint32_t n = AddrNum(op.bd_addr);
+    if (op.to_add) {
+      adding = true;
+      EXPECT_TRUE(controller->insert(n).second);
+      EXPECT_LE(controller->size(), list.Capacity());
+      result.added.insert(n);
+    } else {
+      EXPECT_FALSE(adding) << "removal after an addition";
+      EXPECT_EQ(1U, controller->erase(n));
+      result.removed.insert(n);
+    }
+  }
+  EXPECT_EQ(controller->size(), list.ControllerSize());
+  return result;
+}
+
+}  // namespace
+
+TEST(BleResolvingListTest, LoadsAllWhileFitting) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  EXPECT_TRUE(Add(list, 1, 0));
+  EXPECT_TRUE(Add(list, 2, 0));
+  EXPECT_FALSE(Add(list, 2, 0));
+  EXPECT_TRUE(list.NeedsSync());
+  Ops ops = Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), ops.added);
+  EXPECT_FALSE(list.NeedsSync());
+
+  /* the devices in the controller need nothing */
+  EXPECT_FALSE(Resolved(list, 1, true, 10));
+  EXPECT_FALSE(list.NeedsSync());
+  EXPECT_EQ(1U, list.hits());
+
+  EXPECT_TRUE(Remove(list, 1));
+  controller.erase(1);
+  EXPECT_FALSE(Remove(list, 1));
+  EXPECT_EQ(1U, list.Size());
+  EXPECT_EQ(1U, list.ControllerSize());
+}
+
+TEST(BleResolvingListTest, SwapsInTheResolvedDevice) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  /* the device 1 is the least recently active */
+  for (uint32_t n = 1; n <= 6; n++) Add(list, n, n);
+  Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({3, 4, 5, 6}), controller);
+
+  /* the device 2, resolved by the host, takes the entry of the device 3 */
+  uint64_t now_ms = 2 * min_residency_ms;
+  EXPECT_TRUE(Resolved(list, 2, false, now_ms));
+  EXPECT_EQ(1U, list.misses());
+  Ops ops = Sync(list, now_ms, &controller);
+  EXPECT_EQ(std::set<uint32_t>({2}), ops.added);
+  EXPECT_EQ(std::set<uint32_t>({3}), ops.removed);
+  EXPECT_EQ(1U, list.swaps());
+  EXPECT_FALSE(list.NeedsSync());
+}
+
+TEST(BleResolvingListTest, SwapsInBatches) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  for (uint32_t n = 1; n <= 20; n++) Add(list, n, 0);
+  Sync(list, 0, &controller);
+  EXPECT_EQ(8U, controller.size());
+
+  /* the devices resolved by the host in a row are swapped together */
+  uint64_t now_ms = 2 * min_residency_ms;
+  std::set<uint32_t> resolved;
+  for (uint32_t n = 1; n <= 20 && resolved.size() < 5; n++) {
+    if (controller.count(n)) continue;
+    EXPECT_TRUE(Resolved(list, n, false, now_ms + n));
+    resolved.insert(n);
+  }
+  Ops ops = Sync(list, now_ms + 100, &controller);
+  EXPECT_EQ(resolved, ops.added);
+  EXPECT_EQ(5U, ops.removed.size());
+  for (uint32_t n : resolved) EXPECT_EQ(1U, controller.count(n));
+}
+
+TEST(BleResolvingListTest, KeepsRecentlyLoadedDevices) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(2);
+
+  Add(list, 1, 0);
+  Add(list, 2, 0);
+  Add(list, 3, 0);
+  Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), controller);
+
+  /* too soon to evict a device */
+  EXPECT_TRUE(Resolved(list, 3, false, 10));
+  Ops ops = Sync(list, 10, &controller);
+  EXPECT_TRUE(ops.added.empty());
+  EXPECT_FALSE(list.NeedsSync());
+
+  /* and once loaded long enough, the least recently active goes */
+  Resolved(list, 1, true, min_residency_ms);
+  EXPECT_TRUE(Resolved(list, 3, false, min_residency_ms + 1));
+  ops = Sync(list, min_residency_ms + 1, &controller);
+  EXPECT_EQ(std::set<uint32_t>({3}), ops.added);
+  EXPECT_EQ(std::set<uint32_t>({2}), ops.removed);
+}
+
+TEST(BleResolvingListTest, BoundsTheOperations) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(8);
+
+  for (uint32_t n = 1; n <= 8; n++) Add(list, n, 0);
+  Ops ops = Sync(list, 0, &controller, 3);
+  EXPECT_EQ(3U, ops.added.size());
+  EXPECT_TRUE(list.NeedsSync());
+  Sync(list, 0, &controller, 3);
+  Sync(list, 0, &controller, 3);
+  EXPECT_EQ(8U, controller.size());
+  EXPECT_FALSE(list.NeedsSync());
+
+  /* a swap is never split */
+  Add(list, 9, min_residency_ms);
+  ops = Sync(list, min_residency_ms, &controller, 1);
+  EXPECT_TRUE(ops.added.empty());
+  EXPECT_TRUE(list.NeedsSync());
+  ops = Sync(list, min_residency_ms, &controller, 2);
+  EXPECT_EQ(std::set<uint32_t>({9}), ops.added);
+  EXPECT_EQ(1U, ops.removed.size());
+}
+
+TEST(BleResolvingListTest, RemovalFreesEntry) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(2);
+
+  Add(list, 1, 2);
+  Add(list, 2, 1);
+  Add(list, 3, 0);
+  Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), controller);
+
+  /* the caller removes it from the controller */
+  EXPECT_TRUE(Remove(list, 1));
+  controller.erase(1);
+  EXPECT_TRUE(list.NeedsSync());
+  Ops ops = Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({3}), ops.added);
+}
+
+TEST(BleResolvingListTest, ControllerCleared) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  Add(list, 1, 0);
+  Add(list, 2, 0);
+  Sync(list, 0, &controller);
+  list.ControllerCleared();
+  controller.clear();
+  EXPECT_TRUE(list.NeedsSync());
+  EXPECT_EQ(0U, list.ControllerSize());
+
+  Ops ops = Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), ops.added);
+}
+
+TEST(BleResolvingListTest, CapacityChange) {
+  BleResolvingList list(min_residency_ms);
+  std::set<uint32_t> controller;
+  list.SetCapacity(4);
+
+  for (uint32_t n = 1; n <= 4; n++) Add(list, n, n);
+  Sync(list, 0, &controller);
+
+  /* the least recently active devices leave a smaller list */
+  list.SetCapacity(2);
+  Ops ops = Sync(list, 0, &controller);
+  EXPECT_EQ(std::set<uint32_t>({1, 2}), ops.removed);
+  EXPECT_TRUE(ops.added.empty());
+}
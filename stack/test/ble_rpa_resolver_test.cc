@@ -0,0 +1,147 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "stack/btm/ble_rpa_resolver.h"
+
+namespace {
+
+const uint64_t cache_timeout_ms = 1000;
+
+/* The sample data of the Core specification, Vol 3 Part H 2.2.2: the IRK
+ * 0xec0234a357c8ad05341010a60a397d9b, in little endian order, resolves the
+ * address 70:81:94:0D:FB:AA (prand 0x708194, hash 0x0dfbaa) */
+const BT_OCTET16 sample_irk = {0x9b, 0x7d, 0x39, 0x0a, 0xa6, 0x10,
+                               0x10, 0x34, 0x05, 0xad, 0xc8, 0x57,
+                               0xa3, 0x34, 0x02, 0xec};
+const BD_ADDR sample_rpa = {0x70, 0x81, 0x94, 0x0d, 0xfb, 0xaa};
+
+void MakeIrk(uint8_t n, BT_OCTET16 irk) {
+  memset(irk, n, BT_OCTET16_LEN);
+  irk[0] = 0xA5;
+}
+
+/* Returns the address of prand |prand| resolved by |irk| */
+void MakeRpa(const BT_OCTET16 irk, uint32_t prand, BD_ADDR rpa) {
+  uint8_t key[BT_OCTET16_LEN];
+  for (int i = 0; i < BT_OCTET16_LEN; i++) key[i] = irk[BT_OCTET16_LEN - 1 - i];
+  tSMP_AES_KEY aes_key;
+  smp_aes_set_key(key, &aes_key);
+
+  uint8_t block[N_BLOCK] = {0};
+  rpa[0] = block[N_BLOCK - 3] = ((prand >> 16) & 0x3F) | 0x40;
+  rpa[1] = block[N_BLOCK - 2] = (prand >> 8) & 0xFF;
+  rpa[2] = block[N_BLOCK - 1] = prand & 0xFF;
+  smp_aes_encrypt(&aes_key, block, block);
+  memcpy(&rpa[3], &block[N_BLOCK - 3], 3);
+}
+
+}  // namespace
+
+TEST(BleRpaResolverTest, SampleData) {
+  BleRpaResolver resolver(16, cache_timeout_ms);
+  BT_OCTET16 irk;
+  EXPECT_FALSE(resolver.Resolve(sample_rpa, 0, irk));
+
+  resolver.AddIrk(sample_irk);
+  ASSERT_TRUE(resolver.Resolve(sample_rpa, 0, irk));
+  EXPECT_EQ(0, memcmp(sample_irk, irk, BT_OCTET16_LEN));
+
+  BD_ADDR other_rpa;
+  memcpy(other_rpa, sample_rpa, BD_ADDR_LEN);
+  other_rpa[5] ^= 1;
+  EXPECT_FALSE(resolver.Resolve(other_rpa, 0, irk));
+}
+
+TEST(BleRpaResolverTest, ManyIrks) {
+  BleRpaResolver resolver(0, cache_timeout_ms);
+  const int num_irks = 200;
+  for (int n = 0; n < num_irks; n++) {
+    BT_OCTET16 irk;
+    MakeIrk(n, irk);
+    resolver.AddIrk(irk);
+  }
+  EXPECT_EQ((size_t)num_irks, resolver.NumIrks());
+
+  /* each one resolves its addresses, whatever its position in the batches */
+  for (int n = num_irks - 1; n >= 0; n--) {
+    BT_OCTET16 irk, resolved_irk;
+    BD_ADDR rpa;
+    MakeIrk(n, irk);
+    MakeRpa(irk, 0x123456 + n, rpa);
+    ASSERT_TRUE(resolver.Resolve(rpa, 0, resolved_irk)) << n;
+    EXPECT_EQ(0, memcmp(irk, resolved_irk, BT_OCTET16_LEN)) << n;
+  }
+
+  BT_OCTET16 irk;
+  BD_ADDR rpa;
+  MakeIrk(0, irk);
+  MakeRpa(irk, 0x123456, rpa);
+  resolver.Clear();
+  EXPECT_EQ(0U, resolver.NumIrks());
+  EXPECT_FALSE(resolver.Resolve(rpa, 0, irk));
+}
+
+TEST(BleRpaResolverTest, Cache) {
+  BleRpaResolver resolver(16, cache_timeout_ms);
+  resolver.AddIrk(sample_irk);
+
+  BT_OCTET16 irk;
+  BD_ADDR unknown_rpa = {0x40, 0x01, 0x02, 0x03, 0x04, 0x05};
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, 0, irk));
+  EXPECT_FALSE(resolver.Resolve(unknown_rpa, 0, irk));
+  EXPECT_EQ(2U, resolver.cache_misses());
+
+  memset(irk, 0, BT_OCTET16_LEN);
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, cache_timeout_ms - 1, irk));
+  EXPECT_EQ(0, memcmp(sample_irk, irk, BT_OCTET16_LEN));
+  EXPECT_FALSE(resolver.Resolve(unknown_rpa, cache_timeout_ms - 1, irk));
+  EXPECT_EQ(2U, resolver.cache_hits());
+
+  /* the results expire */
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, cache_timeout_ms, irk));
+  EXPECT_EQ(3U, resolver.cache_misses());
+}
+
+TEST(BleRpaResolverTest, AddIrkClearsCache) {
+  BleRpaResolver resolver(16, cache_timeout_ms);
+  BT_OCTET16 irk;
+  EXPECT_FALSE(resolver.Resolve(sample_rpa, 0, irk));
+
+  /* the address failing to resolve is not remembered past a new IRK */
+  resolver.AddIrk(sample_irk);
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, 0, irk));
+  EXPECT_EQ(0U, resolver.cache_hits());
+}
+
+TEST(BleRpaResolverTest, CacheCollision) {
+  BleRpaResolver resolver(1, cache_timeout_ms);
+  resolver.AddIrk(sample_irk);
+
+  BT_OCTET16 irk;
+  BD_ADDR unknown_rpa = {0x40, 0x01, 0x02, 0x03, 0x04, 0x05};
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, 0, irk));
+  EXPECT_FALSE(resolver.Resolve(unknown_rpa, 0, irk));
+
+  /* the single slot now holds the other address */
+  EXPECT_TRUE(resolver.Resolve(sample_rpa, 0, irk));
+  EXPECT_EQ(0U, resolver.cache_hits());
+}
@@ -0,0 +1,146 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <list>
+#include <vector>
+
+#include "stack/btm/ble_scan_dedup.h"
+
+namespace {
+
+const uint64_t aging_ms = 1000;
+const uint8_t rssi_threshold = 5;
+
+const std::vector<uint8_t> data1 = {0x02, 0x01, 0x06};
+const std::vector<uint8_t> data2 = {0x02, 0x01, 0x04};
+
+void MakeAddr(uint32_t n, BD_ADDR addr) {
+  memset(addr, 0, BD_ADDR_LEN);
+  addr[0] = n & 0xFF;
+  addr[1] = (n >> 8) & 0xFF;
+  addr[2] = (n >> 16) & 0xFF;
+}
+
+bool Report(BleScanDedup& dedup, uint32_t n, int8_t rssi,
+            const std::vector<uint8_t>& data, uint64_t now_ms,
+            uint8_t sid = 0xFF) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return dedup.ShouldReport(0, addr, sid, rssi, data.data(), data.size(),
+                            now_ms);
+}
+
+}  // namespace
+
+TEST(BleScanDedupTest, Disabled) {
+  BleScanDedup dedup(0, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_EQ(0U, dedup.Size());
+}
+
+TEST(BleScanDedupTest, Duplicate) {
+  BleScanDedup dedup(16, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_FALSE(Report(dedup, 1, -50, data1, 10));
+  EXPECT_FALSE(Report(dedup, 1, -55, data1, 20));
+
+  /* another device, or another advertising set of the device */
+  EXPECT_TRUE(Report(dedup, 2, -50, data1, 30));
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 40, 1));
+  EXPECT_EQ(3U, dedup.Size());
+}
+
+TEST(BleScanDedupTest, DataChange) {
+  BleScanDedup dedup(16, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_TRUE(Report(dedup, 1, -50, data2, 10));
+  EXPECT_FALSE(Report(dedup, 1, -50, data2, 20));
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 30));
+}
+
+TEST(BleScanDedupTest, RssiChange) {
+  BleScanDedup dedup(16, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_TRUE(Report(dedup, 1, -56, data1, 10));
+  EXPECT_FALSE(Report(dedup, 1, -52, data1, 20));
+  EXPECT_TRUE(Report(dedup, 1, -62, data1, 30));
+}
+
+TEST(BleScanDedupTest, Aging) {
+  BleScanDedup dedup(16, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  EXPECT_FALSE(Report(dedup, 1, -50, data1, aging_ms - 1));
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, aging_ms));
+  EXPECT_FALSE(Report(dedup, 1, -50, data1, aging_ms + 1));
+}
+
+TEST(BleScanDedupTest, Clear) {
+  BleScanDedup dedup(16, aging_ms, rssi_threshold);
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 0));
+  dedup.Clear();
+  EXPECT_EQ(0U, dedup.Size());
+  EXPECT_TRUE(Report(dedup, 1, -50, data1, 10));
+}
+
+TEST(BleScanDedupTest, EvictLeastRecentlySeen) {
+  BleScanDedup dedup(4, aging_ms, rssi_threshold);
+  for (uint32_t n = 1; n <= 4; n++) Report(dedup, n, -50, data1, 0);
+
+  /* seeing device 1 again makes device 2 the least recently seen */
+  EXPECT_FALSE(Report(dedup, 1, -50, data1, 10));
+  EXPECT_TRUE(Report(dedup, 5, -50, data1, 20));
+  EXPECT_EQ(4U, dedup.Size());
+
+  EXPECT_FALSE(Report(dedup, 1, -50, data1, 30));
+  EXPECT_FALSE(Report(dedup, 3, -50, data1, 30));
+  EXPECT_TRUE(Report(dedup, 2, -50, data1, 40));
+}
+
+TEST(BleScanDedupTest, ManyDevices) {
+  const size_t max_devices = 1000;
+  BleScanDedup dedup(max_devices, UINT64_MAX, rssi_threshold);
+
+  /* the devices are cycled through a table too small for them, checking the
+   * evictions against a plain list */
+  std::list<uint32_t> lru;
+  uint64_t now_ms = 0;
+  for (int round = 0; round < 5; round++) {
+    for (uint32_t n = 0; n < max_devices * 3 / 2; n += (round % 2) + 1) {
+      uint32_t device = (n * 7919) % (max_devices * 3 / 2);
+      bool known = false;
+      for (auto it = lru.begin(); it != lru.end(); it++) {
+        if (*it == device) {
+          lru.erase(it);
+          known = true;
+          break;
+        }
+      }
+      lru.push_front(device);
+      if (lru.size() > max_devices) lru.pop_back();
+
+      EXPECT_EQ(!known, Report(dedup, device, -50, data1, now_ms));
+      now_ms++;
+    }
+    ASSERT_EQ(lru.size(), dedup.Size());
+  }
+}
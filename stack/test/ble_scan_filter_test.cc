@@ -0,0 +1,240 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "stack/btm/ble_scan_filter.h"
+#include "stack/include/btm_api_types.h"
+#include "stack/include/btm_ble_api_types.h"
+
+#define PF_BIT(x) (1 << (x))
+
+namespace {
+
+const BD_ADDR addr1 = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+const BD_ADDR addr2 = {0x11, 0x12, 0x13, 0x14, 0x15, 0x16};
+
+const uint8_t filt_index = 1;
+
+/* Flags, complete list of 16-bit UUIDs (0x180D, 0x180F), complete local name
+ * "Tag", manufacturer data of company 0x00E0 */
+const std::vector<uint8_t> adv = {
+    0x02, 0x01, 0x06, 0x05, 0x03, 0x0D, 0x18, 0x0F, 0x18, 0x04, 0x09,
+    'T',  'a',  'g',  0x05, 0xFF, 0xE0, 0x00, 0xAB, 0xCD};
+
+/* Service data of the 16-bit UUID 0xFEAA */
+const std::vector<uint8_t> srvc_data_adv = {0x06, 0x16, 0xAA, 0xFE,
+                                            0x10, 0x20, 0x30};
+
+tBT_UUID Uuid16(uint16_t uuid16) {
+  tBT_UUID uuid;
+  uuid.len = LEN_UUID_16;
+  uuid.uu.uuid16 = uuid16;
+  return uuid;
+}
+
+}  // namespace
+
+class BleScanFilterTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { filter.Enable(true); }
+
+  bool Matches(const std::vector<uint8_t>& ad, int8_t rssi = -50) {
+    return filter.Matches(addr1, rssi, ad.data(), ad.size());
+  }
+
+  BleScanFilter filter;
+};
+
+TEST_F(BleScanFilterTest, Disabled) {
+  filter.Enable(false);
+  EXPECT_TRUE(Matches(adv));
+  EXPECT_TRUE(Matches({}));
+}
+
+TEST_F(BleScanFilterTest, NoFilter) {
+  EXPECT_FALSE(Matches(adv));
+
+  /* conditions without parameters are not used */
+  filter.AddAddress(filt_index, addr1);
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, Address) {
+  filter.AddAddress(filt_index, addr2);
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_ADDR_FILTER), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_FALSE(Matches(adv));
+
+  filter.AddAddress(filt_index, addr1);
+  EXPECT_TRUE(Matches(adv));
+
+  filter.RemoveAddress(filt_index, addr1);
+  EXPECT_FALSE(Matches(adv));
+
+  filter.RemoveParams(filt_index);
+  filter.AddAddress(filt_index, addr1);
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, Uuid) {
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_UUID), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddUuid(filt_index, BTM_BLE_PF_SRVC_UUID, Uuid16(0x180A), NULL);
+  EXPECT_FALSE(Matches(adv));
+
+  filter.AddUuid(filt_index, BTM_BLE_PF_SRVC_UUID, Uuid16(0x180F), NULL);
+  EXPECT_TRUE(Matches(adv));
+
+  /* the UUIDs of the service are not the solicited ones */
+  filter.ClearConditions(filt_index, BTM_BLE_PF_SRVC_UUID);
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_SOL_UUID), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddUuid(filt_index, BTM_BLE_PF_SRVC_SOL_UUID, Uuid16(0x180F), NULL);
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, UuidMask) {
+  const uint8_t mask[] = {0x00, 0xFF};
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_UUID), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddUuid(filt_index, BTM_BLE_PF_SRVC_UUID, Uuid16(0x1800), mask);
+  EXPECT_TRUE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, Uuid128) {
+  tBT_UUID uuid;
+  uuid.len = LEN_UUID_128;
+  const uint8_t uuid128[] = {0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80,
+                             0x00, 0x10, 0x00, 0x00, 0x0D, 0x18, 0x00, 0x00};
+  memcpy(uuid.uu.uuid128, uuid128, LEN_UUID_128);
+
+  /* the 16-bit UUIDs of the report match their 128-bit form */
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_UUID), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddUuid(filt_index, BTM_BLE_PF_SRVC_UUID, uuid, NULL);
+  EXPECT_TRUE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, LocalName) {
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_LOCAL_NAME), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddLocalName(filt_index, {'T', 'a'});
+  EXPECT_FALSE(Matches(adv));
+
+  filter.AddLocalName(filt_index, {'T', 'a', 'g'});
+  EXPECT_TRUE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, ManufacturerData) {
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_MANU_DATA), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddManufacturerData(filt_index, 0x00E0, 0xFFFF, {0xAB, 0xCE}, {});
+  EXPECT_FALSE(Matches(adv));
+
+  filter.RemoveManufacturerData(filt_index, 0x00E0, {0xAB, 0xCE});
+  filter.AddManufacturerData(filt_index, 0x00E0, 0xFFFF, {0xAB, 0xCE},
+                             {0xFF, 0xF0});
+  EXPECT_TRUE(Matches(adv));
+
+  filter.ClearConditions(filt_index, BTM_BLE_PF_MANU_DATA);
+  filter.AddManufacturerData(filt_index, 0x01E0, 0x00FF, {0xAB}, {});
+  EXPECT_TRUE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, ServiceData) {
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_DATA_PATTERN), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddServiceData(filt_index, {0xAA, 0xFE, 0x10}, {});
+  EXPECT_FALSE(Matches(adv));
+  EXPECT_TRUE(Matches(srvc_data_adv));
+
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_SRVC_DATA), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_FALSE(Matches(adv));
+  EXPECT_TRUE(Matches(srvc_data_adv));
+}
+
+TEST_F(BleScanFilterTest, ListLogic) {
+  filter.AddLocalName(filt_index, {'T', 'a', 'g'});
+  filter.AddLocalName(filt_index, {'O', 't', 'h', 'e', 'r'});
+
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_LOCAL_NAME), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_TRUE(Matches(adv));
+
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_LOCAL_NAME),
+                   PF_BIT(BTM_BLE_PF_LOCAL_NAME), BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, FilterLogic) {
+  filter.AddLocalName(filt_index, {'O', 't', 'h', 'e', 'r'});
+  filter.AddManufacturerData(filt_index, 0x00E0, 0xFFFF, {}, {});
+  uint16_t features =
+      PF_BIT(BTM_BLE_PF_LOCAL_NAME) | PF_BIT(BTM_BLE_PF_MANU_DATA);
+
+  filter.SetParams(filt_index, features, 0, BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_TRUE(Matches(adv));
+
+  filter.SetParams(filt_index, features, 0, BTM_BLE_PF_LOGIC_AND, -128);
+  EXPECT_FALSE(Matches(adv));
+
+  /* the other features are AND-ed whatever the filter logic */
+  filter.AddAddress(filt_index, addr2);
+  filter.SetParams(filt_index, features | PF_BIT(BTM_BLE_PF_ADDR_FILTER), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, Rssi) {
+  filter.AddAddress(filt_index, addr1);
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_ADDR_FILTER), 0,
+                   BTM_BLE_PF_LOGIC_OR, -60);
+  EXPECT_TRUE(Matches(adv, -50));
+  EXPECT_FALSE(Matches(adv, -70));
+}
+
+TEST_F(BleScanFilterTest, SeveralFilters) {
+  filter.AddAddress(filt_index, addr2);
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_ADDR_FILTER), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  filter.AddLocalName(filt_index + 1, {'T', 'a', 'g'});
+  filter.SetParams(filt_index + 1, PF_BIT(BTM_BLE_PF_LOCAL_NAME), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+  EXPECT_TRUE(Matches(adv));
+
+  filter.Remove(filt_index + 1);
+  EXPECT_FALSE(Matches(adv));
+
+  filter.RemoveAll();
+  EXPECT_FALSE(Matches(adv));
+}
+
+TEST_F(BleScanFilterTest, Malformed) {
+  filter.AddLocalName(filt_index, {'T', 'a', 'g'});
+  filter.SetParams(filt_index, PF_BIT(BTM_BLE_PF_LOCAL_NAME), 0,
+                   BTM_BLE_PF_LOGIC_OR, -128);
+
+  /* the name field runs past the end of the data */
+  EXPECT_FALSE(Matches({0x02, 0x01, 0x06, 0x05, 0x09, 'T', 'a', 'g'}));
+}
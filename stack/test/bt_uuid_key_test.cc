@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <unordered_map>
+
+#include "bt_uuid_key.h"
+
+namespace {
+
+tBT_UUID Uuid16(uint16_t value) {
+  tBT_UUID uuid;
+  uuid.len = LEN_UUID_16;
+  uuid.uu.uuid16 = value;
+  return uuid;
+}
+
+tBT_UUID Uuid32(uint32_t value) {
+  tBT_UUID uuid;
+  uuid.len = LEN_UUID_32;
+  uuid.uu.uuid32 = value;
+  return uuid;
+}
+
+// The 128-bit form of the 32-bit UUID |value|, in little endian order
+tBT_UUID Uuid128(uint32_t value) {
+  tBT_UUID uuid;
+  uuid.len = LEN_UUID_128;
+  const uint8_t base[] = {0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80,
+                          0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  memcpy(uuid.uu.uuid128, base, LEN_UUID_128);
+  uuid.uu.uuid128[12] = value;
+  uuid.uu.uuid128[13] = value >> 8;
+  uuid.uu.uuid128[14] = value >> 16;
+  uuid.uu.uuid128[15] = value >> 24;
+  return uuid;
+}
+
+}  // namespace
+
+TEST(BtUuidKeyTest, EqualAcrossLengths) {
+  EXPECT_TRUE(BtUuidKey::Equal(Uuid16(0x180F), Uuid16(0x180F)));
+  EXPECT_TRUE(BtUuidKey::Equal(Uuid16(0x180F), Uuid32(0x180F)));
+  EXPECT_TRUE(BtUuidKey::Equal(Uuid16(0x180F), Uuid128(0x180F)));
+  EXPECT_TRUE(BtUuidKey::Equal(Uuid128(0x180F), Uuid32(0x180F)));
+  EXPECT_TRUE(BtUuidKey::Equal(Uuid128(0x12345678), Uuid32(0x12345678)));
+
+  EXPECT_FALSE(BtUuidKey::Equal(Uuid16(0x180F), Uuid16(0x180A)));
+  EXPECT_FALSE(BtUuidKey::Equal(Uuid16(0x180F), Uuid128(0x180A)));
+  EXPECT_FALSE(BtUuidKey::Equal(Uuid32(0x1234180F), Uuid16(0x180F)));
+
+  // A 128-bit UUID that is not based on the base UUID
+  tBT_UUID vendor = Uuid128(0x180F);
+  vendor.uu.uuid128[0] ^= 0x01;
+  EXPECT_FALSE(BtUuidKey::Equal(vendor, Uuid16(0x180F)));
+  EXPECT_FALSE(BtUuidKey::Equal(Uuid128(0x180F), vendor));
+  EXPECT_TRUE(BtUuidKey::Equal(vendor, vendor));
+}
+
+TEST(BtUuidKeyTest, CanonicalKey) {
+  EXPECT_EQ(BtUuidKey(Uuid16(0x2A19)), BtUuidKey(Uuid128(0x2A19)));
+  EXPECT_EQ(BtUuidKey(Uuid16(0x2A19)).hash(),
+            BtUuidKey(Uuid32(0x2A19)).hash());
+  EXPECT_NE(BtUuidKey(Uuid16(0x2A19)), BtUuidKey(Uuid16(0x2A1A)));
+  EXPECT_EQ(0, memcmp(BtUuidKey(Uuid16(0x2A19)).uuid128(),
+                      Uuid128(0x2A19).uu.uuid128, LEN_UUID_128));
+
+  std::unordered_map<BtUuidKey, int> index;
+  index[BtUuidKey(Uuid16(0x2803))] = 1;
+  index[BtUuidKey(Uuid128(0x2A19))] = 2;
+  EXPECT_EQ(1, index[BtUuidKey(Uuid128(0x2803))]);
+  EXPECT_EQ(2, index[BtUuidKey(Uuid16(0x2A19))]);
+  EXPECT_EQ((size_t)2, index.size());
+}
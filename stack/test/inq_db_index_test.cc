@@ -0,0 +1,177 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <list>
+#include <vector>
+
+#include "stack/btm/inq_db_index.h"
+
+namespace {
+
+void MakeAddr(uint32_t n, BD_ADDR addr) {
+  memset(addr, 0, BD_ADDR_LEN);
+  addr[3] = n & 0xFF;
+  addr[4] = (n >> 8) & 0xFF;
+  addr[5] = (n >> 16) & 0xFF;
+}
+
+uint16_t Find(const InqDbIndex& index, uint32_t n) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return index.Find(addr);
+}
+
+uint16_t Insert(InqDbIndex& index, uint32_t n) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return index.Insert(addr);
+}
+
+std::vector<uint16_t> Walk(const InqDbIndex& index) {
+  std::vector<uint16_t> order;
+  for (uint16_t i = index.First(); i != InqDbIndex::kNone; i = index.Next(i))
+    order.push_back(i);
+  return order;
+}
+
+}  // namespace
+
+TEST(InqDbIndexTest, Empty) {
+  InqDbIndex index(0);
+  EXPECT_EQ(InqDbIndex::kNone, Insert(index, 1));
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 1));
+  EXPECT_EQ(InqDbIndex::kNone, index.First());
+  EXPECT_EQ(0U, index.Size());
+}
+
+TEST(InqDbIndexTest, InsertFind) {
+  InqDbIndex index(8);
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 1));
+
+  uint16_t a = Insert(index, 1);
+  uint16_t b = Insert(index, 2);
+  ASSERT_NE(InqDbIndex::kNone, a);
+  ASSERT_NE(InqDbIndex::kNone, b);
+  EXPECT_NE(a, b);
+  EXPECT_LT(a, 8);
+  EXPECT_LT(b, 8);
+
+  EXPECT_EQ(a, Find(index, 1));
+  EXPECT_EQ(b, Find(index, 2));
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 3));
+  EXPECT_EQ(2U, index.Size());
+}
+
+TEST(InqDbIndexTest, InsertionOrder) {
+  InqDbIndex index(8);
+  uint16_t a = Insert(index, 1);
+  uint16_t b = Insert(index, 2);
+  uint16_t c = Insert(index, 3);
+  EXPECT_EQ(std::vector<uint16_t>({a, b, c}), Walk(index));
+
+  /* using an entry does not move it in the insertion order */
+  index.Touch(a);
+  EXPECT_EQ(std::vector<uint16_t>({a, b, c}), Walk(index));
+
+  index.Erase(b);
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 2));
+  EXPECT_EQ(std::vector<uint16_t>({a, c}), Walk(index));
+
+  uint16_t d = Insert(index, 4);
+  EXPECT_EQ(std::vector<uint16_t>({a, c, d}), Walk(index));
+}
+
+TEST(InqDbIndexTest, Reorder) {
+  InqDbIndex index(8);
+  uint16_t a = Insert(index, 1);
+  uint16_t b = Insert(index, 2);
+  uint16_t c = Insert(index, 3);
+
+  index.Reorder({c, a, b});
+  EXPECT_EQ(std::vector<uint16_t>({c, a, b}), Walk(index));
+
+  uint16_t d = Insert(index, 4);
+  EXPECT_EQ(std::vector<uint16_t>({c, a, b, d}), Walk(index));
+  index.Erase(c);
+  EXPECT_EQ(std::vector<uint16_t>({a, b, d}), Walk(index));
+}
+
+TEST(InqDbIndexTest, Clear) {
+  InqDbIndex index(4);
+  for (uint32_t n = 1; n <= 4; n++) Insert(index, n);
+  index.Clear();
+  EXPECT_EQ(0U, index.Size());
+  EXPECT_EQ(InqDbIndex::kNone, index.First());
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 1));
+  EXPECT_NE(InqDbIndex::kNone, Insert(index, 1));
+}
+
+TEST(InqDbIndexTest, EvictLeastRecentlyUsed) {
+  InqDbIndex index(4);
+  for (uint32_t n = 1; n <= 4; n++) Insert(index, n);
+
+  /* using device 1 again makes device 2 the least recently used */
+  index.Touch(Find(index, 1));
+  uint16_t evicted = Find(index, 2);
+  EXPECT_EQ(evicted, Insert(index, 5));
+  EXPECT_EQ(4U, index.Size());
+  EXPECT_EQ(InqDbIndex::kNone, Find(index, 2));
+  EXPECT_NE(InqDbIndex::kNone, Find(index, 1));
+
+  /* the new entry is walked through last */
+  EXPECT_EQ(evicted, Walk(index).back());
+}
+
+TEST(InqDbIndexTest, ManyDevices) {
+  const size_t size = 300;
+  InqDbIndex index(size);
+
+  /* the devices are cycled through a database too small for them, checking
+   * the evictions against a plain list */
+  std::list<uint32_t> lru;
+  for (int round = 0; round < 5; round++) {
+    for (uint32_t n = 0; n < size * 3 / 2; n += (round % 2) + 1) {
+      uint32_t device = (n * 7919) % (size * 3 / 2);
+      bool known = false;
+      for (auto it = lru.begin(); it != lru.end(); it++) {
+        if (*it == device) {
+          lru.erase(it);
+          known = true;
+          break;
+        }
+      }
+      lru.push_front(device);
+      if (lru.size() > size) lru.pop_back();
+
+      uint16_t i = Find(index, device);
+      ASSERT_EQ(known, i != InqDbIndex::kNone);
+      if (known)
+        index.Touch(i);
+      else
+        ASSERT_NE(InqDbIndex::kNone, Insert(index, device));
+    }
+    ASSERT_EQ(lru.size(), index.Size());
+    for (uint32_t device : lru)
+      ASSERT_NE(InqDbIndex::kNone, Find(index, device));
+    ASSERT_EQ(lru.size(), Walk(index).size());
+  }
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "stack/btm/iso_tx_scheduler.h"
+
+namespace {
+
+const uint32_t sdu_interval_us = 10000;
+const uint64_t start_us = 123456789;
+
+TEST(IsoTxSchedulerTest, not_started) {
+  IsoTxScheduler scheduler;
+  EXPECT_FALSE(scheduler.started());
+  EXPECT_EQ(1u, scheduler.MaxQueued());
+}
+
+TEST(IsoTxSchedulerTest, first_sdu_anchors) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  EXPECT_TRUE(scheduler.started());
+  EXPECT_EQ(0, scheduler.Schedule(start_us));
+  EXPECT_EQ(1, scheduler.Schedule(start_us + sdu_interval_us));
+  EXPECT_EQ(2, scheduler.Schedule(start_us + 2 * sdu_interval_us));
+  EXPECT_EQ(3u, scheduler.sdus());
+  EXPECT_EQ(0u, scheduler.late());
+  EXPECT_EQ(0u, scheduler.lost());
+}
+
+TEST(IsoTxSchedulerTest, jitter_rounds_to_interval) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  scheduler.Schedule(start_us);
+  EXPECT_EQ(1, scheduler.Schedule(start_us + sdu_interval_us + 3000));
+  EXPECT_EQ(2, scheduler.Schedule(start_us + 2 * sdu_interval_us - 3000));
+  EXPECT_EQ(0u, scheduler.late());
+  EXPECT_EQ(0u, scheduler.lost());
+}
+
+TEST(IsoTxSchedulerTest, early_sdu_takes_next_number) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  scheduler.Schedule(start_us);
+  scheduler.Schedule(start_us + sdu_interval_us);
+  // Starts in the interval of the SDU just sent
+  EXPECT_EQ(2, scheduler.Schedule(start_us + sdu_interval_us + 1000));
+  EXPECT_EQ(1u, scheduler.late());
+  EXPECT_EQ(3, scheduler.Schedule(start_us + 3 * sdu_interval_us));
+  EXPECT_EQ(0u, scheduler.lost());
+}
+
+TEST(IsoTxSchedulerTest, missing_sdus_are_lost) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  scheduler.Schedule(start_us);
+  EXPECT_EQ(4, scheduler.Schedule(start_us + 4 * sdu_interval_us));
+  EXPECT_EQ(3u, scheduler.lost());
+  EXPECT_EQ(5, scheduler.Schedule(start_us + 5 * sdu_interval_us));
+  EXPECT_EQ(3u, scheduler.lost());
+}
+
+TEST(IsoTxSchedulerTest, sequence_number_wraps) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  scheduler.Schedule(start_us);
+  EXPECT_EQ(0, scheduler.Schedule(start_us + 65536ull * sdu_interval_us));
+}
+
+TEST(IsoTxSchedulerTest, max_queued_from_latency) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  EXPECT_EQ(4u, scheduler.MaxQueued());
+  scheduler.Start(sdu_interval_us, 45000);
+  EXPECT_EQ(4u, scheduler.MaxQueued());
+  scheduler.Start(sdu_interval_us, 5000);
+  EXPECT_EQ(1u, scheduler.MaxQueued());
+}
+
+TEST(IsoTxSchedulerTest, restart_resets_counters) {
+  IsoTxScheduler scheduler;
+  scheduler.Start(sdu_interval_us, 40000);
+  scheduler.Schedule(start_us);
+  scheduler.Schedule(start_us + 3 * sdu_interval_us);
+  scheduler.Dropped();
+  EXPECT_EQ(1u, scheduler.dropped());
+
+  scheduler.Start(sdu_interval_us, 40000);
+  EXPECT_EQ(0u, scheduler.sdus());
+  EXPECT_EQ(0u, scheduler.lost());
+  EXPECT_EQ(0u, scheduler.dropped());
+  EXPECT_EQ(0, scheduler.Schedule(start_us + 100 * sdu_interval_us));
+}
+
+}  // namespace
@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <deque>
+#include <map>
+
+#include "stack/rfcomm/port_tx_scheduler.h"
+
+namespace {
+
+const uint16_t quantum = 1000;
+
+/* The frames queued on each DLCI */
+class Queues {
+ public:
+  Queues() { memset(&scheduler_, 0, sizeof(scheduler_)); }
+
+  void Queue(uint8_t dlci, int len, int count) {
+    for (int i = 0; i < count; i++) frames_[dlci].push_back(len);
+  }
+
+  /* Sends the next frame, returns its DLCI */
+  uint8_t Send() {
+    uint8_t dlci = scheduler_.Next(quantum, [this](uint8_t dlci) {
+      auto it = frames_.find(dlci);
+      if (it == frames_.end() || it->second.empty() || blocked_[dlci])
+        return -1;
+      return it->second.front();
+    });
+    if (dlci != 0) frames_[dlci].pop_front();
+    return dlci;
+  }
+
+  std::map<uint8_t, bool> blocked_;
+
+ private:
+  PortTxScheduler scheduler_;
+  std::map<uint8_t, std::deque<int>> frames_;
+};
+
+TEST(PortTxSchedulerTest, nothing_to_send) {
+  Queues queues;
+  EXPECT_EQ(0, queues.Send());
+
+  queues.Queue(4, 100, 1);
+  queues.blocked_[4] = true;
+  EXPECT_EQ(0, queues.Send());
+}
+
+TEST(PortTxSchedulerTest, single_dlci_sends_all) {
+  Queues queues;
+  queues.Queue(6, 990, 5);
+  for (int i = 0; i < 5; i++) EXPECT_EQ(6, queues.Send());
+  EXPECT_EQ(0, queues.Send());
+}
+
+TEST(PortTxSchedulerTest, bulk_dlci_does_not_starve_others) {
+  Queues queues;
+  queues.Queue(2, 990, 100);
+  queues.Queue(10, 20, 3);
+
+  // The AT commands go out between the frames of the transfer
+  EXPECT_EQ(2, queues.Send());
+  EXPECT_EQ(10, queues.Send());
+  EXPECT_EQ(10, queues.Send());
+  EXPECT_EQ(10, queues.Send());
+  EXPECT_EQ(2, queues.Send());
+}
+
+TEST(PortTxSchedulerTest, turns_share_octets) {
+  Queues queues;
+  queues.Queue(2, 1000, 10);
+  queues.Queue(4, 100, 100);
+
+  int sent_4 = 0;
+  EXPECT_EQ(2, queues.Send());
+  while (queues.Send() == 4) sent_4++;
+  EXPECT_EQ(10, sent_4);
+}
+
+TEST(PortTxSchedulerTest, frames_larger_than_quantum) {
+  Queues queues;
+  queues.Queue(2, 1500, 2);
+  queues.Queue(4, 1500, 2);
+
+  EXPECT_EQ(2, queues.Send());
+  EXPECT_EQ(4, queues.Send());
+  EXPECT_EQ(2, queues.Send());
+  EXPECT_EQ(4, queues.Send());
+  EXPECT_EQ(0, queues.Send());
+}
+
+TEST(PortTxSchedulerTest, blocked_dlci_loses_its_turn) {
+  Queues queues;
+  queues.Queue(2, 100, 20);
+  queues.Queue(4, 100, 20);
+
+  EXPECT_EQ(2, queues.Send());
+  queues.blocked_[2] = true;
+  EXPECT_EQ(4, queues.Send());
+  queues.blocked_[2] = false;
+
+  // DLCI 4 keeps the turn it started
+  for (int i = 0; i < 9; i++) EXPECT_EQ(4, queues.Send());
+  EXPECT_EQ(2, queues.Send());
+}
+
+}  // namespace
@@ -0,0 +1,146 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of finding the security records of the devices connecting at once,
+// as btm_find_dev and btm_find_dev_by_handle do for each HCI event of their
+// links: walking the list of the records, and with SecDevIndex.
+
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <list>
+#include <vector>
+
+#include "stack/btm/sec_dev_index.h"
+
+namespace {
+
+// The fields of tBTM_SEC_DEV_REC compared by the lookups, padded to the size
+// of a record so that the walks touch as much memory.
+struct DevRec {
+  BD_ADDR bd_addr;
+  BD_ADDR pseudo_addr;
+  uint16_t hci_handle;
+  uint16_t ble_hci_handle;
+  uint8_t rest[800];
+};
+
+const uint16_t kInvalidHandle = 0xFFFF;
+
+// The |num_records| records bonded, the last |num_links| of which are
+// connected, as the bonded devices reconnecting once the stack is started.
+class Storm {
+ public:
+  Storm(int num_records, int num_links) {
+    for (int i = 0; i < num_records; i++) {
+      records_.emplace_back();
+      DevRec& rec = records_.back();
+      memset(&rec, 0, sizeof(rec));
+      rec.bd_addr[3] = i & 0xFF;
+      rec.bd_addr[4] = (i >> 8) & 0xFF;
+      rec.bd_addr[5] = 0x42;
+      rec.hci_handle = kInvalidHandle;
+      rec.ble_hci_handle = kInvalidHandle;
+      if (i >= num_records - num_links) {
+        rec.hci_handle = (uint16_t)(i - (num_records - num_links));
+        links_.push_back(&rec);
+      }
+    }
+  }
+
+  DevRec* FindAddr(const BD_ADDR addr) {
+    for (DevRec& rec : records_) {
+      if (!memcmp(rec.bd_addr, addr, BD_ADDR_LEN) ||
+          !memcmp(rec.pseudo_addr, addr, BD_ADDR_LEN))
+        return &rec;
+    }
+    return NULL;
+  }
+
+  DevRec* FindHandle(uint16_t handle) {
+    for (DevRec& rec : records_) {
+      if (rec.hci_handle == handle || rec.ble_hci_handle == handle)
+        return &rec;
+    }
+    return NULL;
+  }
+
+  // Looks the records up through |index| first, as btm_dev.cc does.
+  DevRec* FindAddr(SecDevIndex& index, const BD_ADDR addr) {
+    DevRec* rec = static_cast<DevRec*>(index.FindAddr(addr));
+    if (rec != NULL && !memcmp(rec->bd_addr, addr, BD_ADDR_LEN)) return rec;
+    rec = FindAddr(addr);
+    if (rec != NULL) index.PutAddr(addr, rec);
+    return rec;
+  }
+
+  DevRec* FindHandle(SecDevIndex& index, uint16_t handle) {
+    DevRec* rec = static_cast<DevRec*>(index.FindHandle(handle));
+    if (rec != NULL && rec->hci_handle == handle) return rec;
+    rec = FindHandle(handle);
+    if (rec != NULL) index.PutHandle(handle, rec);
+    return rec;
+  }
+
+  const std::vector<DevRec*>& links() const { return links_; }
+
+ private:
+  std::list<DevRec> records_;
+  std::vector<DevRec*> links_;
+};
+
+void StormArgs(benchmark::internal::Benchmark* b) {
+  b->Args({16, 4});
+  b->Args({100, 7});
+  b->Args({100, 32});
+}
+
+// Each link finding its record by address, then by handle for the events
+// following the connection complete.
+void BM_LinearLookup(benchmark::State& state) {
+  Storm storm(state.range(0), state.range(1));
+  while (state.KeepRunning()) {
+    for (DevRec* link : storm.links()) {
+      benchmark::DoNotOptimize(storm.FindAddr(link->bd_addr));
+      for (int i = 0; i < 8; i++)
+        benchmark::DoNotOptimize(storm.FindHandle(link->hci_handle));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * storm.links().size() * 9);
+}
+BENCHMARK(BM_LinearLookup)->Apply(StormArgs);
+
+void BM_IndexedLookup(benchmark::State& state) {
+  Storm storm(state.range(0), state.range(1));
+  SecDevIndex index(4 * state.range(0));
+  while (state.KeepRunning()) {
+    for (DevRec* link : storm.links()) {
+      benchmark::DoNotOptimize(storm.FindAddr(index, link->bd_addr));
+      for (int i = 0; i < 8; i++)
+        benchmark::DoNotOptimize(storm.FindHandle(index, link->hci_handle));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * storm.links().size() * 9);
+}
+BENCHMARK(BM_IndexedLookup)->Apply(StormArgs);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "stack/btm/sec_dev_index.h"
+
+namespace {
+
+void MakeAddr(uint32_t n, BD_ADDR addr) {
+  memset(addr, 0, BD_ADDR_LEN);
+  addr[3] = n & 0xFF;
+  addr[4] = (n >> 8) & 0xFF;
+  addr[5] = (n >> 16) & 0xFF;
+}
+
+void* FindAddr(const SecDevIndex& index, uint32_t n) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  return index.FindAddr(addr);
+}
+
+void PutAddr(SecDevIndex& index, uint32_t n, void* record) {
+  BD_ADDR addr;
+  MakeAddr(n, addr);
+  index.PutAddr(addr, record);
+}
+
+}  // namespace
+
+TEST(SecDevIndexTest, test_empty) {
+  SecDevIndex index(16);
+  EXPECT_EQ(NULL, FindAddr(index, 1));
+  EXPECT_EQ(NULL, index.FindHandle(1));
+}
+
+TEST(SecDevIndexTest, test_put_find) {
+  SecDevIndex index(16);
+  int records[2];
+
+  PutAddr(index, 1, &records[0]);
+  index.PutHandle(0x0001, &records[0]);
+  PutAddr(index, 2, &records[1]);
+  index.PutHandle(0x0042, &records[1]);
+
+  EXPECT_EQ(&records[0], FindAddr(index, 1));
+  EXPECT_EQ(&records[1], FindAddr(index, 2));
+  EXPECT_EQ(&records[0], index.FindHandle(0x0001));
+  EXPECT_EQ(&records[1], index.FindHandle(0x0042));
+
+  /* the keys not put are not found */
+  EXPECT_EQ(NULL, FindAddr(index, 3));
+  EXPECT_EQ(NULL, index.FindHandle(0x0002));
+
+  /* a key put again designates its new record */
+  index.PutHandle(0x0001, &records[1]);
+  EXPECT_EQ(&records[1], index.FindHandle(0x0001));
+}
+
+TEST(SecDevIndexTest, test_erase) {
+  SecDevIndex index(16);
+  int records[2];
+
+  PutAddr(index, 1, &records[0]);
+  PutAddr(index, 2, &records[0]);
+  index.PutHandle(0x0001, &records[0]);
+  PutAddr(index, 3, &records[1]);
+
+  index.Erase(&records[0]);
+  EXPECT_EQ(NULL, FindAddr(index, 1));
+  EXPECT_EQ(NULL, FindAddr(index, 2));
+  EXPECT_EQ(NULL, index.FindHandle(0x0001));
+  EXPECT_EQ(&records[1], FindAddr(index, 3));
+}
+
+TEST(SecDevIndexTest, test_clear) {
+  SecDevIndex index(16);
+  int record;
+
+  PutAddr(index, 1, &record);
+  index.PutHandle(0x0001, &record);
+  index.Clear();
+  EXPECT_EQ(NULL, FindAddr(index, 1));
+  EXPECT_EQ(NULL, index.FindHandle(0x0001));
+}
+
+TEST(SecDevIndexTest, test_collisions) {
+  /* more keys than slots: some are evicted, and the others still designate
+   * their record */
+  SecDevIndex index(16);
+  int records[100];
+
+  for (int i = 0; i < 100; i++) {
+    PutAddr(index, i, &records[i]);
+    index.PutHandle(i, &records[i]);
+  }
+
+  int hits = 0;
+  for (int i = 0; i < 100; i++) {
+    void* record = FindAddr(index, i);
+    if (record != NULL) {
+      EXPECT_EQ(&records[i], record);
+      hits++;
+    }
+    record = index.FindHandle(i);
+    if (record != NULL) EXPECT_EQ(&records[i], record);
+  }
+  EXPECT_GT(hits, 0);
+  EXPECT_EQ(&records[99], FindAddr(index, 99));
+  EXPECT_EQ(&records[99], index.FindHandle(99));
+}
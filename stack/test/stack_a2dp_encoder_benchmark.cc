@@ -0,0 +1,223 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of the A2DP Source encode path of each codec, as driven by the media
+// task: one call to |send_frames| per encoder tick, reading the PCM from and
+// enqueueing the packets to mocked callbacks. The codecs whose encoder
+// library is not installed are skipped.
+//
+// The PCM is a 1 kHz tone at the feeding format of the codec, or the raw
+// PCM of the file named by the A2DP_BENCHMARK_PCM environment variable, in
+// a loop. The file must be at the feeding format of the codec.
+//
+// The label of each benchmark reports the packets per tick, the encoded
+// data rate, the longest tick, and the memory still allocated by the
+// encoder at the callbacks beyond what it held before the first tick. The
+// packets are freed as soon as they are enqueued, so the latter should be 0.
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
+#include "stack/include/a2dp_api.h"
+#include "stack/include/a2dp_codec_api.h"
+
+void allocation_tracker_uninit(void);
+
+namespace {
+
+const tA2DP_ENCODER_INIT_PEER_PARAMS kPeerParams = {
+    true /* is_peer_edr */, true /* peer_supports_3mbps */,
+    1008 /* peer_mtu */};
+
+// The PCM fed to the encoder, in a loop
+std::vector<uint8_t> pcm;
+size_t pcm_offset = 0;
+
+size_t baseline_allocated_size = 0;
+size_t max_held_size = 0;
+size_t enqueued_packets = 0;
+uint64_t enqueued_bytes = 0;
+
+void CheckAllocations(void) {
+  size_t allocated_size = allocation_tracker_expect_no_allocations();
+  if (allocated_size > baseline_allocated_size &&
+      allocated_size - baseline_allocated_size > max_held_size) {
+    max_held_size = allocated_size - baseline_allocated_size;
+  }
+}
+
+uint32_t ReadCallback(uint8_t* p_buf, uint32_t len) {
+  CheckAllocations();
+  for (uint32_t i = 0; i < len; i++) {
+    p_buf[i] = pcm[pcm_offset];
+    if (++pcm_offset == pcm.size()) pcm_offset = 0;
+  }
+  return len;
+}
+
+bool EnqueueCallback(BT_HDR* p_buf, size_t frames_n) {
+  (void)frames_n;
+  CheckAllocations();
+  enqueued_packets++;
+  enqueued_bytes += p_buf->len;
+  osi_free(p_buf);
+  return true;
+}
+
+// Loads the PCM file named by A2DP_BENCHMARK_PCM into |pcm|.
+// Returns false if there is none, or it cannot be read.
+bool LoadPcmFile(void) {
+  const char* path = getenv("A2DP_BENCHMARK_PCM");
+  if (path == NULL) return false;
+
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) return false;
+  pcm.clear();
+  uint8_t buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    pcm.insert(pcm.end(), buf, buf + len);
+  fclose(fp);
+  return !pcm.empty();
+}
+
+// Fills |pcm| with one second of a 1 kHz tone in the format |codec_config|.
+void MakeTone(const btav_a2dp_codec_config_t& codec_config,
+              uint8_t bits_per_sample) {
+  uint32_t sample_rate = 44100;
+  if (codec_config.sample_rate == BTAV_A2DP_CODEC_SAMPLE_RATE_48000)
+    sample_rate = 48000;
+  else if (codec_config.sample_rate == BTAV_A2DP_CODEC_SAMPLE_RATE_88200)
+    sample_rate = 88200;
+  else if (codec_config.sample_rate == BTAV_A2DP_CODEC_SAMPLE_RATE_96000)
+    sample_rate = 96000;
+  int channels =
+      (codec_config.channel_mode == BTAV_A2DP_CODEC_CHANNEL_MODE_MONO) ? 1 : 2;
+  size_t bytes_per_sample = (bits_per_sample > 0) ? bits_per_sample / 8 : 2;
+
+  pcm.resize(sample_rate * channels * bytes_per_sample);
+  uint8_t* p = pcm.data();
+  for (uint32_t i = 0; i < sample_rate; i++) {
+    // Half of the full scale, left-aligned in the sample
+    double value = 0.5 * sin(2 * M_PI * 1000 * i / sample_rate);
+    int32_t sample = (int32_t)(value * 2147483647.0);
+    for (int c = 0; c < channels; c++) {
+      for (size_t b = 0; b < bytes_per_sample; b++)
+        *p++ = (uint8_t)(sample >> (32 - 8 * (bytes_per_sample - b)));
+    }
+  }
+}
+
+void CodecArgs(benchmark::internal::Benchmark* b) {
+  const btav_a2dp_codec_index_t codec_indexes[] = {
+      BTAV_A2DP_CODEC_INDEX_SOURCE_SBC,  BTAV_A2DP_CODEC_INDEX_SOURCE_AAC,
+      BTAV_A2DP_CODEC_INDEX_SOURCE_APTX, BTAV_A2DP_CODEC_INDEX_SOURCE_APTX_HD,
+      BTAV_A2DP_CODEC_INDEX_SOURCE_LDAC, BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC,
+      BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL};
+  for (btav_a2dp_codec_index_t codec_index : codec_indexes)
+    b->Arg(codec_index);
+}
+
+// Encodes one tick per iteration with the codec |state.range(0)|, configured
+// with its local capability as the peer capability.
+void BM_EncodeTick(benchmark::State& state) {
+  btav_a2dp_codec_index_t codec_index =
+      static_cast<btav_a2dp_codec_index_t>(state.range(0));
+  std::vector<btav_a2dp_codec_config_t> default_priorities;
+  A2dpCodecs codecs(default_priorities);
+  tAVDT_CFG avdt_cfg;
+  uint8_t codec_info_result[AVDT_CODEC_SIZE];
+
+  memset(&avdt_cfg, 0, sizeof(avdt_cfg));
+  if (!codecs.init() || !A2DP_InitCodecConfig(codec_index, &avdt_cfg) ||
+      !codecs.setCodecConfig(avdt_cfg.codec_info, true /* is_capability */,
+                             codec_info_result,
+                             true /* select_current_codec */)) {
+    state.SkipWithError("not supported on the device");
+    return;
+  }
+  A2dpCodecConfig* codec_config = codecs.getCurrentCodecConfig();
+  const tA2DP_ENCODER_INTERFACE* encoder_interface =
+      A2DP_GetEncoderInterface(codec_info_result);
+  if (codec_config == nullptr || encoder_interface == nullptr) {
+    state.SkipWithError("no encoder");
+    return;
+  }
+  if (!LoadPcmFile()) {
+    MakeTone(codec_config->getCodecConfig(),
+             codec_config->getAudioBitsPerSample());
+  }
+  pcm_offset = 0;
+
+  allocation_tracker_init();
+  A2DP_InitEncoderPacketPool(kPeerParams.peer_mtu,
+                             84 /* max_queued_packets */);
+  encoder_interface->encoder_init(&kPeerParams, codec_config, ReadCallback,
+                                  EnqueueCallback);
+  encoder_interface->feeding_reset();
+
+  period_ms_t interval_ms = encoder_interface->get_encoder_interval_ms();
+  uint64_t timestamp_us = 0;
+  uint64_t max_tick_us = 0;
+  baseline_allocated_size = allocation_tracker_expect_no_allocations();
+  max_held_size = 0;
+  enqueued_packets = 0;
+  enqueued_bytes = 0;
+
+  while (state.KeepRunning()) {
+    timestamp_us += interval_ms * 1000;
+    auto start = std::chrono::steady_clock::now();
+    encoder_interface->send_frames(timestamp_us);
+    auto tick_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    if ((uint64_t)tick_us > max_tick_us) max_tick_us = tick_us;
+    CheckAllocations();
+  }
+
+  encoder_interface->encoder_cleanup();
+  A2DP_CleanupEncoderPacketPool();
+  allocation_tracker_uninit();
+
+  uint64_t audio_ms = state.iterations() * interval_ms;
+  char label[128];
+  snprintf(label, sizeof(label),
+           "%s %.2f packets/tick %llu kbps max %llu us held %zu bytes",
+           codec_config->name().c_str(),
+           (double)enqueued_packets / state.iterations(),
+           (unsigned long long)(audio_ms > 0 ? enqueued_bytes * 8 / audio_ms
+                                             : 0),
+           (unsigned long long)max_tick_us, max_held_size);
+  state.SetLabel(label);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeTick)->Apply(CodecArgs);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -23,11 +23,24 @@
 
 #include <gtest/gtest.h>
 
+#include "embdrv/sbc/encoder/include/sbc_encoder.h"
+#include "osi/include/allocation_tracker.h"
+#include "osi/include/allocator.h"
 #include "stack/include/a2dp_aac.h"
 #include "stack/include/a2dp_api.h"
 #include "stack/include/a2dp_codec_api.h"
+#include "stack/include/a2dp_jitter_buffer.h"
+#include "stack/include/a2dp_pacing.h"
+#include "stack/include/a2dp_pcm_fanout.h"
+#include "stack/include/a2dp_resampler.h"
 #include "stack/include/a2dp_sbc.h"
+#include "stack/include/a2dp_silence.h"
 #include "stack/include/a2dp_vendor.h"
+#include "stack/include/a2dp_vendor_aptx_pcm.h"
+#include "stack/include/a2dp_vendor_lhdc.h"
+#include "stack/include/a2dp_vendor_lhdc_abr.h"
+#include "stack/include/a2dp_vendor_lhdc_constants.h"
+#include "stack/include/a2dp_vendor_lhdc_interval.h"
 
 namespace {
 const uint8_t codec_info_sbc[AVDT_CODEC_SIZE] = {
@@ -164,8 +177,40 @@ static bool has_shared_library(const char* name) {
   return false;
 }
 
+// The encoder under test returns every packet to the packet pool as soon as
+// it is enqueued, so the memory in use while encoding should stay the same
+// as the memory in use before encoding started.
+static bool encoder_checking_allocations = false;
+static size_t encoder_allocated_size = 0;
+static bool encoder_allocated_while_encoding = false;
+static size_t encoder_enqueued_packets = 0;
+
+static void check_encoder_allocations(void) {
+  if (encoder_checking_allocations &&
+      allocation_tracker_expect_no_allocations() != encoder_allocated_size) {
+    encoder_allocated_while_encoding = true;
+  }
+}
+
+static uint32_t encoder_read_callback(uint8_t* p_buf, uint32_t len) {
+  check_encoder_allocations();
+  // Non-silent audio, so the encoder does not skip any frames
+  memset(p_buf, 0x5a, len);
+  return len;
+}
+
+static bool encoder_enqueue_callback(BT_HDR* p_buf,
+                                     UNUSED_ATTR size_t frames_n) {
+  check_encoder_allocations();
+  encoder_enqueued_packets++;
+  osi_free(p_buf);
+  return true;
+}
+
 }  // namespace
 
+void allocation_tracker_uninit(void);
+
 class StackA2dpTest : public ::testing::Test {
  protected:
   StackA2dpTest() {
@@ -801,6 +846,773 @@ TEST_F(StackA2dpTest, test_a2dp_init_codec_config) {
 #endif
 }
 
+TEST_F(StackA2dpTest, test_a2dp_lhdc_encode_frames_no_allocations) {
+  const btav_a2dp_codec_index_t lhdc_codecs[] = {
+      BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC, BTAV_A2DP_CODEC_INDEX_SOURCE_LHDC_LL};
+  const tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {
+      true /* is_peer_edr */, true /* peer_supports_3mbps */,
+      1008 /* peer_mtu */};
+
+  for (btav_a2dp_codec_index_t codec_index : lhdc_codecs) {
+    // Ignore codecs that are not supported on the device
+    if (!has_codec_support(codec_index)) {
+      continue;
+    }
+
+    allocation_tracker_uninit();
+    allocation_tracker_init();
+
+    std::vector<btav_a2dp_codec_config_t> default_priorities;
+    A2dpCodecs codecs(default_priorities);
+    ASSERT_TRUE(codecs.init());
+
+    // Use the local capability as the peer capability
+    tAVDT_CFG avdt_cfg;
+    uint8_t codec_info_result[AVDT_CODEC_SIZE];
+    memset(&avdt_cfg, 0, sizeof(avdt_cfg));
+    ASSERT_TRUE(A2DP_InitCodecConfig(codec_index, &avdt_cfg));
+    ASSERT_TRUE(codecs.setCodecConfig(
+        avdt_cfg.codec_info, true /* is_capability */, codec_info_result,
+        true /* select_current_codec */));
+    A2dpCodecConfig* codec_config = codecs.getCurrentCodecConfig();
+    ASSERT_NE(codec_config, nullptr);
+    const tA2DP_ENCODER_INTERFACE* encoder_interface =
+        A2DP_GetEncoderInterface(codec_info_result);
+    ASSERT_NE(encoder_interface, nullptr);
+
+    A2DP_InitEncoderPacketPool(peer_params.peer_mtu,
+                               84 /* max_queued_packets */);
+    encoder_interface->encoder_init(&peer_params, codec_config,
+                                    encoder_read_callback,
+                                    encoder_enqueue_callback);
+    encoder_interface->feeding_reset();
+
+    encoder_checking_allocations = true;
+    encoder_allocated_size = allocation_tracker_expect_no_allocations();
+    encoder_allocated_while_encoding = false;
+    encoder_enqueued_packets = 0;
+
+    uint64_t timestamp_us = 0;
+    period_ms_t interval_ms = encoder_interface->get_encoder_interval_ms();
+    for (int i = 0; i < 100; i++) {
+      timestamp_us += interval_ms * 1000;
+      encoder_interface->send_frames(timestamp_us);
+    }
+
+    encoder_checking_allocations = false;
+    EXPECT_GT(encoder_enqueued_packets, 0U);
+    EXPECT_FALSE(encoder_allocated_while_encoding);
+    EXPECT_EQ(encoder_allocated_size,
+              allocation_tracker_expect_no_allocations());
+
+    encoder_interface->encoder_cleanup();
+    A2DP_CleanupEncoderPacketPool();
+    EXPECT_EQ(0U, allocation_tracker_expect_no_allocations());
+    allocation_tracker_uninit();
+  }
+}
+
+TEST_F(StackA2dpTest, test_a2dp_packet_ends_frame) {
+  const uint8_t codec_info_lhdc[AVDT_CODEC_SIZE] = {
+      A2DP_LHDC_CODEC_LEN,     // Length
+      AVDT_MEDIA_TYPE_AUDIO,   // Media Type
+      A2DP_MEDIA_CT_NON_A2DP,  // Media Codec Type
+      0x3a, 0x05, 0x00, 0x00,  // Vendor ID: A2DP_LHDC_VENDOR_ID
+      0x4c, 0x48,              // Codec ID: A2DP_LHDC_CODEC_ID
+      0x00};
+  BT_HDR buf;
+  memset(&buf, 0, sizeof(buf));
+
+  // SBC packets always carry complete frames
+  buf.layer_specific = 5;
+  EXPECT_TRUE(A2DP_PacketEndsFrame(codec_info_sbc, &buf));
+
+  // LHDC frames may be fragmented over several packets
+  buf.layer_specific = (0x12 << 8) | (2 << A2DP_LHDC_HDR_NUM_SHIFT);
+  EXPECT_TRUE(A2DP_PacketEndsFrame(codec_info_lhdc, &buf));
+  buf.layer_specific = (0x12 << 8) | A2DP_LHDC_HDR_F_MSK |
+                       A2DP_LHDC_HDR_S_MSK | (2 << A2DP_LHDC_HDR_NUM_SHIFT);
+  EXPECT_FALSE(A2DP_PacketEndsFrame(codec_info_lhdc, &buf));
+  buf.layer_specific = (0x13 << 8) | A2DP_LHDC_HDR_F_MSK;
+  EXPECT_FALSE(A2DP_PacketEndsFrame(codec_info_lhdc, &buf));
+  buf.layer_specific = (0x14 << 8) | A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_L_MSK;
+  EXPECT_TRUE(A2DP_PacketEndsFrame(codec_info_lhdc, &buf));
+}
+
+TEST_F(StackA2dpTest, test_a2dp_merge_packets) {
+  const uint8_t codec_info_lhdc[AVDT_CODEC_SIZE] = {
+      A2DP_LHDC_CODEC_LEN,     // Length
+      AVDT_MEDIA_TYPE_AUDIO,   // Media Type
+      A2DP_MEDIA_CT_NON_A2DP,  // Media Codec Type
+      0x3a, 0x05, 0x00, 0x00,  // Vendor ID: A2DP_LHDC_VENDOR_ID
+      0x4c, 0x48,              // Codec ID: A2DP_LHDC_CODEC_ID
+      0x00};
+  BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  BT_HDR* p_next = (BT_HDR*)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+  uint8_t* p_data = (uint8_t*)(p_buf + 1);
+  uint8_t* p_next_data = (uint8_t*)(p_next + 1);
+
+  p_buf->offset = 20;
+  p_buf->len = 100;
+  p_buf->layer_specific = (0x10 << 8) | (2 << A2DP_LHDC_HDR_NUM_SHIFT) |
+                          A2DP_LHDC_HDR_LATENCY_MID;
+  memset(p_data + p_buf->offset, 0x11, p_buf->len);
+  p_next->offset = 20;
+  p_next->len = 50;
+  p_next->layer_specific = (0x11 << 8) | (1 << A2DP_LHDC_HDR_NUM_SHIFT) |
+                           A2DP_LHDC_HDR_LATENCY_MID;
+  memset(p_next_data + p_next->offset, 0x22, p_next->len);
+  A2DP_VendorResetMergedPacketsLhdc();
+
+  // SBC packets are never merged
+  EXPECT_FALSE(A2DP_MergePackets(codec_info_sbc, p_buf, p_next, 400));
+
+  // The payload must fit in the MTU with the LHDC header
+  EXPECT_FALSE(A2DP_MergePackets(codec_info_lhdc, p_buf, p_next,
+                                 150 + A2DP_LHDC_MPL_HDR_LEN - 1));
+  EXPECT_EQ(100, p_buf->len);
+
+  // Fragments are never merged
+  p_next->layer_specific |= A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_S_MSK;
+  EXPECT_FALSE(A2DP_MergePackets(codec_info_lhdc, p_buf, p_next, 400));
+  p_next->layer_specific &= ~(A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_S_MSK);
+
+  // The frame count must fit in the LHDC header
+  p_buf->layer_specific |= (A2DP_LHDC_HDR_NUM_MAX - 1)
+                           << A2DP_LHDC_HDR_NUM_SHIFT;
+  EXPECT_FALSE(A2DP_MergePackets(codec_info_lhdc, p_buf, p_next, 400));
+  p_buf->layer_specific = (0x10 << 8) | (2 << A2DP_LHDC_HDR_NUM_SHIFT) |
+                          A2DP_LHDC_HDR_LATENCY_MID;
+
+  // The payload is appended, and the header counts all the frames
+  EXPECT_TRUE(A2DP_MergePackets(codec_info_lhdc, p_buf, p_next,
+                                150 + A2DP_LHDC_MPL_HDR_LEN));
+  EXPECT_EQ(20, p_buf->offset);
+  EXPECT_EQ(150, p_buf->len);
+  EXPECT_EQ((0x11 << 8) | (3 << A2DP_LHDC_HDR_NUM_SHIFT) |
+                A2DP_LHDC_HDR_LATENCY_MID,
+            p_buf->layer_specific);
+  EXPECT_EQ(0x11, p_data[p_buf->offset + 99]);
+  EXPECT_EQ(0x22, p_data[p_buf->offset + 100]);
+  EXPECT_EQ(0x22, p_data[p_buf->offset + 149]);
+
+  // The packets after a merged one are numbered down by one, until the
+  // encoder restarts its sequence numbers
+  p_next->offset = 20;
+  p_next->len = 50;
+  EXPECT_TRUE(
+      A2DP_BuildCodecHeader(codec_info_lhdc, p_next, (0x12 << 8) | 1));
+  EXPECT_EQ(0x11, p_next_data[p_next->offset + 1]);
+  A2DP_VendorResetMergedPacketsLhdc();
+  p_next->offset = 20;
+  p_next->len = 50;
+  EXPECT_TRUE(A2DP_BuildCodecHeader(codec_info_lhdc, p_next, 1));
+  EXPECT_EQ(0x00, p_next_data[p_next->offset + 1]);
+
+  osi_free(p_next);
+  osi_free(p_buf);
+}
+
+TEST_F(StackA2dpTest, test_a2dp_get_decoder_interface) {
+  const uint8_t codec_info_lhdc[AVDT_CODEC_SIZE] = {
+      A2DP_LHDC_CODEC_LEN,     // Length
+      AVDT_MEDIA_TYPE_AUDIO,   // Media Type
+      A2DP_MEDIA_CT_NON_A2DP,  // Media Codec Type
+      0x3a, 0x05, 0x00, 0x00,  // Vendor ID: A2DP_LHDC_VENDOR_ID
+      0x4c, 0x48,              // Codec ID: A2DP_LHDC_CODEC_ID
+      A2DP_LHDC_SAMPLING_FREQ_48000 | A2DP_LHDC_BIT_FMT_24};
+
+  EXPECT_NE(A2DP_GetDecoderInterface(codec_info_sbc), nullptr);
+  EXPECT_NE(A2DP_GetDecoderInterface(codec_info_lhdc), nullptr);
+  EXPECT_EQ(A2DP_GetDecoderInterface(codec_info_aac), nullptr);
+  EXPECT_EQ(A2DP_GetDecoderInterface(codec_info_non_a2dp), nullptr);
+
+  EXPECT_EQ(A2DP_GetTrackSampleRate(codec_info_lhdc), 48000);
+  EXPECT_EQ(A2DP_GetTrackBitsPerSample(codec_info_lhdc), 24);
+}
+
+TEST_F(StackA2dpTest, test_a2dp_assemble_frames_sbc) {
+  const tA2DP_DECODER_INTERFACE* decoder_interface =
+      A2DP_GetDecoderInterface(codec_info_sbc);
+  ASSERT_NE(decoder_interface, nullptr);
+  uint8_t packet[100];
+  const uint8_t* p_frames = NULL;
+  uint16_t frames_len = 0;
+
+  // The frames follow the SBC media payload header
+  memset(packet, 0x11, sizeof(packet));
+  packet[0] = 5;
+  EXPECT_EQ(5, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  EXPECT_EQ(packet + 1, p_frames);
+  EXPECT_EQ(sizeof(packet) - 1, frames_len);
+
+  EXPECT_EQ(0, decoder_interface->assemble_frames(packet, 1, &p_frames,
+                                                  &frames_len));
+}
+
+TEST_F(StackA2dpTest, test_a2dp_assemble_frames_lhdc) {
+  const uint8_t codec_info_lhdc[AVDT_CODEC_SIZE] = {
+      A2DP_LHDC_CODEC_LEN,     // Length
+      AVDT_MEDIA_TYPE_AUDIO,   // Media Type
+      A2DP_MEDIA_CT_NON_A2DP,  // Media Codec Type
+      0x3a, 0x05, 0x00, 0x00,  // Vendor ID: A2DP_LHDC_VENDOR_ID
+      0x4c, 0x48,              // Codec ID: A2DP_LHDC_CODEC_ID
+      A2DP_LHDC_SAMPLING_FREQ_48000 | A2DP_LHDC_BIT_FMT_24};
+  const tA2DP_DECODER_INTERFACE* decoder_interface =
+      A2DP_GetDecoderInterface(codec_info_lhdc);
+  ASSERT_NE(decoder_interface, nullptr);
+  uint8_t packet[A2DP_LHDC_MPL_HDR_LEN + 10];
+  uint8_t* p_payload = packet + A2DP_LHDC_MPL_HDR_LEN;
+  const uint8_t* p_frames = NULL;
+  uint16_t frames_len = 0;
+
+  // Unfragmented frames are given with their header
+  packet[0] = (3 << A2DP_LHDC_HDR_NUM_SHIFT) | A2DP_LHDC_HDR_LATENCY_MID;
+  packet[1] = 0x10;
+  memset(p_payload, 0x11, 10);
+  EXPECT_EQ(3, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  EXPECT_EQ(packet, p_frames);
+  EXPECT_EQ(sizeof(packet), frames_len);
+
+  // A fragmented frame is completed by its last fragment
+  packet[0] = A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_S_MSK |
+              (1 << A2DP_LHDC_HDR_NUM_SHIFT) | A2DP_LHDC_HDR_LATENCY_MID;
+  packet[1] = 0x20;
+  memset(p_payload, 0x22, 10);
+  EXPECT_EQ(0, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  packet[0] = A2DP_LHDC_HDR_F_MSK;
+  packet[1] = 0x21;
+  memset(p_payload, 0x33, 10);
+  EXPECT_EQ(0, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  packet[0] = A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_L_MSK;
+  packet[1] = 0x22;
+  memset(p_payload, 0x44, 10);
+  EXPECT_EQ(1, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  ASSERT_EQ(A2DP_LHDC_MPL_HDR_LEN + 30, frames_len);
+  EXPECT_EQ((1 << A2DP_LHDC_HDR_NUM_SHIFT) | A2DP_LHDC_HDR_LATENCY_MID,
+            p_frames[0]);
+  EXPECT_EQ(0x20, p_frames[1]);
+  EXPECT_EQ(0x22, p_frames[A2DP_LHDC_MPL_HDR_LEN]);
+  EXPECT_EQ(0x33, p_frames[A2DP_LHDC_MPL_HDR_LEN + 10]);
+  EXPECT_EQ(0x44, p_frames[A2DP_LHDC_MPL_HDR_LEN + 29]);
+
+  // A frame missing a fragment is dropped
+  packet[0] = A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_S_MSK |
+              (1 << A2DP_LHDC_HDR_NUM_SHIFT);
+  packet[1] = 0x30;
+  EXPECT_EQ(0, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+  packet[0] = A2DP_LHDC_HDR_F_MSK | A2DP_LHDC_HDR_L_MSK;
+  packet[1] = 0x32;
+  EXPECT_EQ(0, decoder_interface->assemble_frames(packet, sizeof(packet),
+                                                  &p_frames, &frames_len));
+
+  decoder_interface->decoder_cleanup();
+}
+
+TEST_F(StackA2dpTest, test_a2dp_lhdc_abr) {
+  tA2DP_LHDC_ABR abr;
+  // Use a large base time so the first adjustment is not rate-limited
+  uint64_t now_us = 100 * 1000 * 1000;
+
+  a2dp_lhdc_abr_init(&abr, A2DP_LHDC_QUALITY_LOW, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_QUALITY_MID);
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, abr.quality_mode_index);
+
+  // Delay between the thresholds: no change
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID,
+            a2dp_lhdc_abr_proc(&abr, now_us,
+                               A2DP_LHDC_ABR_DELAY_LOW_US + 1000, false));
+
+  // High delay: step down once, then rate-limited
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_proc(&abr, now_us, A2DP_LHDC_ABR_DELAY_HIGH_US,
+                               false));
+  now_us += 10 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_proc(&abr, now_us, A2DP_LHDC_ABR_DELAY_HIGH_US,
+                               true));
+  EXPECT_EQ(1U, abr.adjustments);
+
+  // Clear link: step up only after the clear period
+  now_us += 10 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += A2DP_LHDC_ABR_STEP_UP_INTERVAL_US - 1;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += 1;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += A2DP_LHDC_ABR_STEP_UP_INTERVAL_US;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_HIGH, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += A2DP_LHDC_ABR_STEP_UP_INTERVAL_US;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_HIGH, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+
+  // Congestion alone steps down
+  now_us += 10 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, a2dp_lhdc_abr_proc(&abr, now_us, 0, true));
+
+  // Critical delay drops to the lowest quality right away
+  now_us += 10 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_proc(&abr, now_us, A2DP_LHDC_ABR_DELAY_CRITICAL_US,
+                               false));
+  EXPECT_EQ(5U, abr.adjustments);
+}
+
+TEST_F(StackA2dpTest, test_a2dp_lhdc_abr_link) {
+  tA2DP_LHDC_ABR abr;
+  uint64_t now_us = 100 * 1000 * 1000;
+
+  a2dp_lhdc_abr_init(&abr, A2DP_LHDC_QUALITY_LOW, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_QUALITY_HIGH);
+
+  // A good link changes nothing
+  EXPECT_EQ(A2DP_LHDC_QUALITY_HIGH,
+            a2dp_lhdc_abr_link_proc(&abr, now_us, 0, 255, 0));
+
+  // A fair RSSI steps down once, before the queue builds up
+  now_us += 1000 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID,
+            a2dp_lhdc_abr_link_proc(&abr, now_us, A2DP_LHDC_ABR_RSSI_FAIR,
+                                    255, 0));
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, abr.link_max_quality_mode_index);
+  EXPECT_EQ(1U, abr.link_step_downs);
+
+  // A clear queue cannot step up beyond the link cap
+  now_us += 2 * A2DP_LHDC_ABR_STEP_UP_INTERVAL_US;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += 2 * A2DP_LHDC_ABR_STEP_UP_INTERVAL_US;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+
+  // The failed contacts or a poor link quality drop to the lowest quality
+  now_us += 1000 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_link_proc(&abr, now_us, 0, 255,
+                                    A2DP_LHDC_ABR_FAILED_CONTACTS_POOR));
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_link_proc(&abr, now_us, 0,
+                                    A2DP_LHDC_ABR_LINK_QUALITY_POOR, 0));
+  EXPECT_EQ(2U, abr.link_step_downs);
+
+  // Once the link recovers, the quality steps back up with a clear queue
+  now_us += 1000 * 1000;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW,
+            a2dp_lhdc_abr_link_proc(&abr, now_us, 0, 255, 0));
+  EXPECT_EQ(A2DP_LHDC_QUALITY_HIGH, abr.link_max_quality_mode_index);
+  EXPECT_EQ(A2DP_LHDC_QUALITY_LOW, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+  now_us += A2DP_LHDC_ABR_STEP_UP_INTERVAL_US;
+  EXPECT_EQ(A2DP_LHDC_QUALITY_MID, a2dp_lhdc_abr_proc(&abr, now_us, 0, false));
+}
+
+TEST_F(StackA2dpTest, test_a2dp_lhdc_encoder_interval) {
+  const tA2DP_LHDC_INTERVAL_RANGE range = {10, 20, 30, 2};
+  // The payload of a 895 octets MTU, after the LHDC header
+  const uint32_t payload_len = 893;
+
+  // The interval fills two packets at the bit rate of the quality mode
+  EXPECT_EQ(16U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_LATENCY_MID));
+  EXPECT_EQ(26U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_MID,
+                     A2DP_LHDC_LATENCY_MID));
+
+  // Within the range
+  EXPECT_EQ(30U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_LOW,
+                     A2DP_LHDC_LATENCY_MID));
+  EXPECT_EQ(10U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, 300, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_LATENCY_MID));
+
+  // The latency mode bounds it by the nominal interval
+  EXPECT_EQ(20U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_MID,
+                     A2DP_LHDC_LATENCY_LOW));
+  EXPECT_EQ(20U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_LATENCY_HIGH));
+
+  // Nothing known: the nominal interval
+  EXPECT_EQ(20U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, payload_len, A2DP_LHDC_QUALITY_ABR,
+                     A2DP_LHDC_LATENCY_MID));
+  EXPECT_EQ(20U, a2dp_lhdc_select_encoder_interval_ms(
+                     &range, 0, A2DP_LHDC_QUALITY_HIGH,
+                     A2DP_LHDC_LATENCY_MID));
+}
+
+TEST_F(StackA2dpTest, test_a2dp_pacing) {
+  // 44.1kHz 16-bit stereo, 20ms encoder interval, 512 samples per frame
+  const uint32_t bytes_per_second = 44100 * 2 * 2;
+  const uint32_t interval_us = 20 * 1000;
+  const uint32_t pcm_bytes_per_frame = 512 * 2 * 2;
+  tA2DP_PACING pacing;
+  uint64_t now_us = 1000 * 1000;
+  uint32_t total_frames = 0;
+
+  a2dp_pacing_init(&pacing, bytes_per_second, interval_us);
+  EXPECT_EQ(3528U, a2dp_pacing_get_bytes_per_tick(&pacing));
+
+  // Regular ticks: the frames sent do not drift from the audio clock
+  for (int i = 0; i < 1000; i++) {
+    uint32_t frames = a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+    a2dp_pacing_consume(&pacing, frames, pcm_bytes_per_frame);
+    total_frames += frames;
+    now_us += interval_us;
+  }
+  EXPECT_EQ(1000U * 3528 / pcm_bytes_per_frame, total_frames);
+
+  // A late tick is caught up over the following ticks
+  now_us += 80 * 1000;
+  a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  EXPECT_EQ(60U * 1000, pacing.backlog_us);
+  now_us += interval_us;
+  a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  now_us += interval_us;
+  a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  EXPECT_EQ(20U * 1000, pacing.backlog_us);
+  now_us += interval_us;
+  a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  EXPECT_EQ(0U, pacing.backlog_us);
+  EXPECT_EQ(0U, pacing.dropped_us);
+
+  // A long stall is dropped beyond the maximum backlog
+  now_us += 1000 * 1000;
+  a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  EXPECT_EQ(1000U * 1000 - A2DP_PACING_MAX_BACKLOG_US, pacing.dropped_us);
+  EXPECT_EQ(A2DP_PACING_MAX_BACKLOG_US - 2 * interval_us, pacing.backlog_us);
+
+  // Flush discards everything, credit returns the PCM not encoded
+  a2dp_pacing_flush(&pacing);
+  EXPECT_EQ(0U, pacing.backlog_us);
+  EXPECT_EQ(0U, a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame));
+  now_us += interval_us;
+  EXPECT_EQ(1U, a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame));
+  a2dp_pacing_consume(&pacing, 1, pcm_bytes_per_frame);
+  a2dp_pacing_credit(&pacing, pcm_bytes_per_frame);
+  EXPECT_EQ(1U, a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame));
+
+  // The PCM deferred beyond the limit is dropped instead of sent in a burst
+  a2dp_pacing_flush(&pacing);
+  uint64_t dropped_us = pacing.dropped_us;
+  for (int i = 0; i < 10; i++) {
+    now_us += interval_us;
+    a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame);
+  }
+  a2dp_pacing_limit(&pacing, 10);
+  EXPECT_EQ(dropped_us, pacing.dropped_us);
+  a2dp_pacing_limit(&pacing, 2);
+  EXPECT_EQ(dropped_us + 8 * interval_us, pacing.dropped_us);
+  EXPECT_EQ(2U * 3528 / pcm_bytes_per_frame,
+            a2dp_pacing_update(&pacing, now_us, pcm_bytes_per_frame));
+}
+
+TEST_F(StackA2dpTest, test_a2dp_silence) {
+  // 48kHz 16-bit stereo, 512 samples per block, 100ms before the silence
+  const uint32_t bytes_per_second = 48000 * 2 * 2;
+  const size_t block_size = 512 * 2 * 2;
+  std::vector<uint8_t> silent(block_size + 3, 0);
+  std::vector<uint8_t> audio(block_size, 0);
+  tA2DP_SILENCE silence;
+
+  // Any non-zero octet is found, including in the unaligned tail
+  EXPECT_TRUE(a2dp_silence_is_pcm_silent(silent.data(), silent.size()));
+  EXPECT_TRUE(a2dp_silence_is_pcm_silent(silent.data() + 1, block_size));
+  for (size_t i = 0; i < silent.size(); i++) {
+    silent[i] = 1;
+    EXPECT_FALSE(a2dp_silence_is_pcm_silent(silent.data(), silent.size()));
+    silent[i] = 0;
+  }
+  audio[block_size / 2] = 0x80;
+
+  // The silence starts after 100ms, i.e. 9.4 blocks
+  a2dp_silence_init(&silence, bytes_per_second, 100);
+  for (int i = 0; i < 9; i++)
+    EXPECT_FALSE(a2dp_silence_proc(&silence, silent.data(), block_size));
+  EXPECT_TRUE(a2dp_silence_proc(&silence, silent.data(), block_size));
+  EXPECT_TRUE(a2dp_silence_proc(&silence, silent.data(), block_size));
+  EXPECT_EQ(1U, silence.silences);
+
+  // It ends on the first block of audio, and starts again afterwards
+  EXPECT_FALSE(a2dp_silence_proc(&silence, audio.data(), block_size));
+  EXPECT_FALSE(silence.is_silent);
+  for (int i = 0; i < 9; i++)
+    EXPECT_FALSE(a2dp_silence_proc(&silence, silent.data(), block_size));
+  EXPECT_TRUE(a2dp_silence_proc(&silence, silent.data(), block_size));
+  EXPECT_EQ(2U, silence.silences);
+}
+
+TEST_F(StackA2dpTest, test_a2dp_jitter_buffer) {
+  // 44.1kHz SBC, 128 samples per frame, 7 frames per packet and per tick
+  const uint32_t frames_per_packet = 7;
+  const uint32_t packet_samples = frames_per_packet * 128;
+  const uint64_t packet_us = packet_samples * 1000000ULL / 44100;
+  tA2DP_JITTER_BUFFER jb;
+  tA2DP_JITTER_ACTION action;
+  uint64_t now_us = 1000 * 1000;
+  uint32_t timestamp = 0xFFFFF000;  // Wraps around below
+
+  a2dp_jitter_buffer_init(&jb, 44100, 128, frames_per_packet);
+  EXPECT_EQ((uint64_t)A2DP_JITTER_MIN_DELAY_US, jb.target_us);
+
+  // Buffer up to the target before playing
+  a2dp_jitter_buffer_on_packet(&jb, now_us, timestamp, frames_per_packet);
+  EXPECT_EQ(0U, a2dp_jitter_buffer_tick(&jb, &action));
+  EXPECT_FALSE(jb.is_playing);
+
+  // Regular arrivals: no jitter, no adjustment
+  for (int i = 0; i < 100; i++) {
+    now_us += packet_us;
+    timestamp += packet_samples;
+    a2dp_jitter_buffer_on_packet(&jb, now_us, timestamp, frames_per_packet);
+    EXPECT_EQ(frames_per_packet, a2dp_jitter_buffer_tick(&jb, &action));
+    EXPECT_EQ(A2DP_JITTER_ACTION_NONE, action);
+  }
+  EXPECT_TRUE(jb.is_playing);
+  EXPECT_LT(jb.jitter_us, 100U);
+  EXPECT_EQ((uint64_t)A2DP_JITTER_MIN_DELAY_US, jb.target_us);
+  EXPECT_EQ(0U, jb.dropped_frames + jb.repeated_frames + jb.underruns);
+
+  // A 100ms gap runs the queue empty: rebuffer instead of playing
+  EXPECT_EQ(frames_per_packet, a2dp_jitter_buffer_tick(&jb, &action));
+  EXPECT_EQ(0U, a2dp_jitter_buffer_tick(&jb, &action));
+  EXPECT_EQ(1U, jb.underruns);
+  EXPECT_FALSE(jb.is_playing);
+
+  // The burst that follows raises the target delay above the gap
+  now_us += 100 * 1000 + packet_us;
+  for (int i = 0; i < 6; i++) {
+    timestamp += packet_samples;
+    a2dp_jitter_buffer_on_packet(&jb, now_us, timestamp, frames_per_packet);
+  }
+  EXPECT_GE(jb.target_us, 100U * 1000);
+  EXPECT_LE(jb.target_us, (uint64_t)A2DP_JITTER_MAX_DELAY_US);
+  EXPECT_FALSE(a2dp_jitter_buffer_is_overflow(&jb));
+  EXPECT_EQ(frames_per_packet, a2dp_jitter_buffer_tick(&jb, &action));
+  EXPECT_TRUE(jb.is_playing);
+
+  // Far more than the target is queued: drop a single frame at a time
+  for (int i = 0; i < 30; i++) {
+    timestamp += packet_samples;
+    a2dp_jitter_buffer_on_packet(&jb, now_us, timestamp, frames_per_packet);
+  }
+  EXPECT_TRUE(a2dp_jitter_buffer_is_overflow(&jb));
+  a2dp_jitter_buffer_on_overflow(&jb, 25 * frames_per_packet);
+  EXPECT_EQ(25U * frames_per_packet, jb.overflow_frames);
+  EXPECT_FALSE(a2dp_jitter_buffer_is_overflow(&jb));
+  uint32_t num_drops = 0;
+  for (int i = 0; i < A2DP_JITTER_ADJUST_INTERVAL_TICKS; i++) {
+    uint32_t num_frames = a2dp_jitter_buffer_tick(&jb, &action);
+    if (action == A2DP_JITTER_ACTION_DROP) {
+      EXPECT_EQ(frames_per_packet + 1, num_frames);
+      num_drops++;
+    } else {
+      EXPECT_EQ(frames_per_packet, num_frames);
+    }
+  }
+  EXPECT_EQ(1U, num_drops);
+  EXPECT_EQ(1U, jb.dropped_frames);
+
+  // Flush empties the queue, and playback buffers again
+  a2dp_jitter_buffer_flush(&jb);
+  EXPECT_EQ(0U, a2dp_jitter_buffer_get_queued_us(&jb));
+  EXPECT_EQ(0U, a2dp_jitter_buffer_tick(&jb, &action));
+  EXPECT_FALSE(jb.is_playing);
+}
+
+// Feeds DC PCM to the resampler, in reads of at most |resampler_read_limit|
+// octets to exercise incomplete frames.
+static uint32_t resampler_read_total;
+static uint32_t resampler_read_limit;
+static uint32_t resampler_read_dc(uint8_t* p_buf, uint32_t len) {
+  if (len > resampler_read_limit) len = resampler_read_limit;
+  for (uint32_t i = 0; i < len; i++) {
+    // Little endian 10000 (0x2710) on every channel
+    p_buf[i] = ((resampler_read_total + i) % 2 == 0) ? 0x10 : 0x27;
+  }
+  resampler_read_total += len;
+  return len;
+}
+
+TEST_F(StackA2dpTest, test_a2dp_resampler) {
+  const uint32_t rates[][2] = {
+      {44100, 48000}, {48000, 44100}, {48000, 96000}, {96000, 48000}};
+  tA2DP_RESAMPLER resampler;
+
+  EXPECT_FALSE(a2dp_resampler_init(&resampler, 44100, 48000, 3));
+  EXPECT_FALSE(a2dp_resampler_init(&resampler, 0, 48000, 2));
+
+  for (const auto& rate : rates) {
+    for (uint32_t read_limit : {4096U, 7U}) {
+      const uint32_t channel_count = 2;
+      const uint32_t frame_size = channel_count * sizeof(int16_t);
+      ASSERT_TRUE(
+          a2dp_resampler_init(&resampler, rate[0], rate[1], channel_count));
+      resampler_read_total = 0;
+      resampler_read_limit = read_limit;
+
+      // One second of output consumes one second of input
+      std::vector<int16_t> pcm(rate[1] * channel_count);
+      uint32_t pcm_len = pcm.size() * sizeof(int16_t);
+      uint32_t offset = 0;
+      while (offset < pcm_len) {
+        uint32_t len = 512 * frame_size;
+        if (len > pcm_len - offset) len = pcm_len - offset;
+        uint32_t done = a2dp_resampler_read(
+            &resampler, resampler_read_dc, (uint8_t*)pcm.data() + offset, len);
+        EXPECT_EQ(0U, done % frame_size);
+        offset += done;
+      }
+      EXPECT_EQ(pcm_len, offset);
+      EXPECT_NEAR(rate[0], resampler_read_total / frame_size, resampler.taps);
+
+      // The DC gain is unity once the history is filled
+      size_t filled = resampler.taps * rate[1] / rate[0] + 1;
+      for (size_t i = filled * channel_count; i < pcm.size(); i++) {
+        ASSERT_NEAR(10000, pcm[i], 1);
+      }
+      a2dp_resampler_cleanup(&resampler);
+    }
+  }
+}
+
+TEST_F(StackA2dpTest, test_a2dp_aptx_deinterleave) {
+  // An odd number of frames goes through the vector and the scalar loops
+  const size_t frames = 37;
+  uint8_t pcm[frames * 6];
+  for (size_t i = 0; i < sizeof(pcm); i++) pcm[i] = (uint8_t)(i * 37 + 11);
+  uint32_t left[frames];
+  uint32_t right[frames];
+
+  std::vector<uint16_t> pcm16(frames * 2);
+  memcpy(pcm16.data(), pcm, pcm16.size() * sizeof(uint16_t));
+  a2dp_aptx_deinterleave_16(pcm16.data(), frames, left, right);
+  for (size_t i = 0; i < frames; i++) {
+    EXPECT_EQ((uint32_t)pcm16[2 * i], left[i]);
+    EXPECT_EQ((uint32_t)pcm16[2 * i + 1], right[i]);
+  }
+
+  a2dp_aptx_deinterleave_24(pcm, frames, left, right);
+  for (size_t i = 0; i < frames; i++) {
+    for (size_t ch = 0; ch < 2; ch++) {
+      const uint8_t* p = pcm + 6 * i + 3 * ch;
+      int32_t expected = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                                   (uint32_t)p[2] << 24) >>
+                         8;
+      EXPECT_EQ((uint32_t)expected, ch == 0 ? left[i] : right[i]);
+    }
+  }
+}
+
+// Feeds a counting byte pattern to the fan-out, up to |fanout_read_avail|
+// octets.
+static uint32_t fanout_read_total;
+static uint32_t fanout_read_avail;
+static uint32_t fanout_read_counting(uint8_t* p_buf, uint32_t len) {
+  if (len > fanout_read_avail) len = fanout_read_avail;
+  for (uint32_t i = 0; i < len; i++) {
+    p_buf[i] = (uint8_t)(fanout_read_total + i);
+  }
+  fanout_read_total += len;
+  fanout_read_avail -= len;
+  return len;
+}
+
+TEST_F(StackA2dpTest, test_a2dp_pcm_fanout) {
+  tA2DP_PCM_FANOUT fanout;
+  uint8_t buf[512];
+
+  EXPECT_FALSE(a2dp_pcm_fanout_init(&fanout, fanout_read_counting, 0, 4, 64));
+  EXPECT_FALSE(a2dp_pcm_fanout_init(&fanout, fanout_read_counting,
+                                    A2DP_PCM_FANOUT_MAX_READERS + 1, 4, 64));
+  ASSERT_TRUE(a2dp_pcm_fanout_init(&fanout, fanout_read_counting, 2, 4, 256));
+  fanout_read_total = 0;
+  fanout_read_avail = 10000;
+
+  // Both readers get the same PCM, which is read once from the source
+  for (uint32_t i = 0; i < 20; i++) {
+    EXPECT_EQ(96U, a2dp_pcm_fanout_read(&fanout, 0, buf, 96));
+    for (uint32_t j = 0; j < 96; j++) ASSERT_EQ((uint8_t)(i * 96 + j), buf[j]);
+    EXPECT_EQ(96U, a2dp_pcm_fanout_read(&fanout, 1, buf, 96));
+    for (uint32_t j = 0; j < 96; j++) ASSERT_EQ((uint8_t)(i * 96 + j), buf[j]);
+  }
+  EXPECT_EQ(20U * 96, fanout_read_total);
+
+  // The reads are capped to the ring buffer
+  EXPECT_EQ(256U, a2dp_pcm_fanout_read(&fanout, 0, buf, sizeof(buf)));
+
+  // A reader that falls behind skips the PCM it missed
+  EXPECT_EQ(200U, a2dp_pcm_fanout_read(&fanout, 0, buf, 200));
+  EXPECT_EQ(200U, fanout.skipped_bytes[1]);
+  EXPECT_EQ(0U, fanout.skipped_bytes[0]);
+  EXPECT_EQ(256U, a2dp_pcm_fanout_read(&fanout, 1, buf, sizeof(buf)));
+  EXPECT_EQ((uint8_t)(20 * 96 + 200), buf[0]);
+  EXPECT_EQ(20U * 96 + 456, fanout_read_total);
+
+  // A source underflow is returned to the reader pulling the PCM only
+  fanout_read_avail = 10;
+  EXPECT_EQ(10U, a2dp_pcm_fanout_read(&fanout, 0, buf, 64));
+  EXPECT_EQ(10U, a2dp_pcm_fanout_read(&fanout, 1, buf, 64));
+  EXPECT_EQ(0U, a2dp_pcm_fanout_read(&fanout, 1, buf, 64));
+
+  a2dp_pcm_fanout_flush(&fanout);
+  fanout_read_avail = 10000;
+  EXPECT_EQ(64U, a2dp_pcm_fanout_read(&fanout, 1, buf, 64));
+  EXPECT_EQ(0U, a2dp_pcm_fanout_read(&fanout, 2, buf, 64));
+  a2dp_pcm_fanout_cleanup(&fanout);
+}
+
+TEST_F(StackA2dpTest, test_sbc_encoder_simd_conformance) {
+  const int16_t configs[][2] = {{SUB_BANDS_4, SBC_MONO},
+                                {SUB_BANDS_4, SBC_JOINT_STEREO},
+                                {SUB_BANDS_8, SBC_MONO},
+                                {SUB_BANDS_8, SBC_JOINT_STEREO}};
+  const int num_frames = 200;
+
+  for (const auto& config : configs) {
+    std::vector<uint8_t> bitstream[2];
+
+    // The SIMD windowing must produce the bitstream of the scalar one
+    for (int use_simd = 0; use_simd < 2; use_simd++) {
+      SBC_ENC_PARAMS params;
+      memset(&params, 0, sizeof(params));
+      params.s16SamplingFreq = SBC_sf44100;
+      params.s16ChannelMode = config[1];
+      params.s16NumOfSubBands = config[0];
+      params.s16NumOfBlocks = SBC_BLOCK_3;
+      params.s16AllocationMethod = SBC_LOUDNESS;
+      params.u16BitRate = 328;
+      SBC_Encoder_EnableSimd(use_simd != 0);
+      SBC_Encoder_Init(&params);
+
+      // Full scale noise, to exercise the whole range of the sums
+      uint32_t seed = 1;
+      int num_samples = params.s16NumOfBlocks * params.s16NumOfSubBands *
+                        params.s16NumOfChannels;
+      for (int i = 0; i < num_frames; i++) {
+        int16_t pcm[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS *
+                    SBC_MAX_NUM_OF_SUBBANDS];
+        uint8_t frame[512];
+        for (int j = 0; j < num_samples; j++) {
+          seed = seed * 1103515245 + 12345;
+          pcm[j] = static_cast<int16_t>(seed >> 16);
+        }
+        uint32_t frame_len = SBC_Encode(&params, pcm, frame);
+        EXPECT_GT(frame_len, 0U);
+        bitstream[use_simd].insert(bitstream[use_simd].end(), frame,
+                                   frame + frame_len);
+      }
+    }
+    EXPECT_EQ(bitstream[0], bitstream[1]);
+  }
+  SBC_Encoder_EnableSimd(true);
+}
+
 TEST_F(A2dpCodecConfigTest, createCodec) {
   for (int i = BTAV_A2DP_CODEC_INDEX_MIN; i < BTAV_A2DP_CODEC_INDEX_MAX; i++) {
     btav_a2dp_codec_index_t codec_index =
@@ -904,6 +1716,57 @@ TEST_F(A2dpCodecConfigTest, setCodecConfig) {
   delete a2dp_codecs;
 }
 
+TEST_F(A2dpCodecConfigTest, setCodecConfigCache) {
+  uint8_t codec_info_first[AVDT_CODEC_SIZE];
+  uint8_t codec_info_result[AVDT_CODEC_SIZE];
+  std::vector<btav_a2dp_codec_config_t> default_priorities;
+  A2dpCodecs codecs(default_priorities);
+  const tA2DP_ENCODER_INIT_PEER_PARAMS peer_params = {
+      true /* is_peer_edr */, true /* peer_supports_3mbps */,
+      1008 /* peer_mtu */};
+
+  ASSERT_TRUE(codecs.init());
+  A2dpCodecConfig* codec_config =
+      codecs.findSourceCodecConfig(codec_info_sbc_sink_capability);
+  ASSERT_NE(codec_config, nullptr);
+
+  // The same capability is matched again from the cache, with the same result
+  ASSERT_TRUE(codecs.setCodecConfig(
+      codec_info_sbc_sink_capability, true /* is_capability */,
+      codec_info_first, true /* select_current_codec */));
+  btav_a2dp_codec_config_t first_config = codec_config->getCodecConfig();
+  for (int i = 0; i < 3; i++) {
+    memset(codec_info_result, 0, sizeof(codec_info_result));
+    ASSERT_TRUE(codecs.setCodecConfig(
+        codec_info_sbc_sink_capability, true /* is_capability */,
+        codec_info_result, true /* select_current_codec */));
+    EXPECT_TRUE(A2DP_CodecEquals(codec_info_result, codec_info_first));
+    btav_a2dp_codec_config_t config = codec_config->getCodecConfig();
+    EXPECT_EQ(config.sample_rate, first_config.sample_rate);
+    EXPECT_EQ(config.bits_per_sample, first_config.bits_per_sample);
+    EXPECT_EQ(config.channel_mode, first_config.channel_mode);
+  }
+  size_t hits = codec_config->configCacheHits();
+  EXPECT_GT(hits, 0u);
+
+  // A new user configuration is not answered from the cache
+  btav_a2dp_codec_config_t codec_user_config;
+  memset(&codec_user_config, 0, sizeof(codec_user_config));
+  codec_user_config.codec_type = BTAV_A2DP_CODEC_INDEX_SOURCE_SBC;
+  codec_user_config.codec_priority = BTAV_A2DP_CODEC_PRIORITY_DEFAULT;
+  codec_user_config.sample_rate = BTAV_A2DP_CODEC_SAMPLE_RATE_48000;
+  bool restart_input = false;
+  bool restart_output = false;
+  bool config_updated = false;
+  ASSERT_TRUE(codecs.setCodecUserConfig(
+      codec_user_config, &peer_params, codec_info_sbc_sink_capability,
+      codec_info_result, &restart_input, &restart_output, &config_updated));
+  EXPECT_EQ(codec_config->configCacheHits(), hits);
+  EXPECT_EQ(codec_config->getCodecConfig().sample_rate,
+            BTAV_A2DP_CODEC_SAMPLE_RATE_48000);
+  EXPECT_FALSE(A2DP_CodecEquals(codec_info_result, codec_info_first));
+}
+
 TEST_F(A2dpCodecConfigTest, init) {
   std::vector<btav_a2dp_codec_config_t> default_priorities;
   A2dpCodecs codecs(default_priorities);
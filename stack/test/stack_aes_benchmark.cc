@@ -0,0 +1,181 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of the AES-128 users of the stack, with each implementation the CPU
+// supports: the block cipher itself, the CMAC of the signed writes, and the
+// resolution of a private address against the IRKs of the bonded devices.
+
+#include <benchmark/benchmark.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include <vector>
+
+#include "stack/btm/ble_rpa_resolver.h"
+#include "stack/smp/smp_aes.h"
+
+extern bool aes_cipher_msg_auth_code(uint8_t* key, uint8_t* input,
+                                     uint16_t length, uint16_t tlen,
+                                     uint8_t* p_signature);
+
+namespace {
+
+size_t NumBackends() {
+  size_t n = 0;
+  while (smp_aes_backends[n] != NULL) n++;
+  return n;
+}
+
+// Returns the backend |state.range(0)|, or NULL after skipping the benchmark
+// if the CPU does not support it.
+const tSMP_AES_BACKEND* GetBackend(benchmark::State& state) {
+  const tSMP_AES_BACKEND* backend = smp_aes_backends[state.range(0)];
+  if (!backend->is_supported()) {
+    state.SkipWithError("not supported by the CPU");
+    return NULL;
+  }
+  state.SetLabel(backend->name);
+  return backend;
+}
+
+void BackendArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < NumBackends(); i++) b->Arg(i);
+}
+
+void ResolveArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < NumBackends(); i++) {
+    b->Args({(int)i, 16});
+    b->Args({(int)i, 1024});
+  }
+}
+
+void BM_AesEncrypt(benchmark::State& state) {
+  const tSMP_AES_BACKEND* backend = GetBackend(state);
+  if (backend == NULL) return;
+
+  uint8_t block[N_BLOCK] = {0};
+  tSMP_AES_KEY key;
+  smp_aes_set_key(block, &key);
+  while (state.KeepRunning()) {
+    backend->encrypt(&key, block, block);
+    benchmark::DoNotOptimize(block);
+  }
+  state.SetBytesProcessed(state.iterations() * N_BLOCK);
+}
+BENCHMARK(BM_AesEncrypt)->Apply(BackendArgs);
+
+void BM_AesSetKey(benchmark::State& state) {
+  uint8_t raw_key[N_BLOCK] = {0};
+  while (state.KeepRunning()) {
+    tSMP_AES_KEY key;
+    smp_aes_set_key(raw_key, &key);
+    benchmark::DoNotOptimize(key);
+    raw_key[0]++;
+  }
+}
+BENCHMARK(BM_AesSetKey);
+
+// The encryption of a block with the IRKs of 200 bonded devices at once.
+void BM_AesEncryptKeys(benchmark::State& state) {
+  const tSMP_AES_BACKEND* backend = GetBackend(state);
+  if (backend == NULL) return;
+
+  std::vector<tSMP_AES_KEY> keys(200);
+  for (size_t i = 0; i < keys.size(); i++) {
+    uint8_t raw_key[N_BLOCK];
+    memset(raw_key, (int)i, N_BLOCK);
+    smp_aes_set_key(raw_key, &keys[i]);
+  }
+
+  uint8_t block[N_BLOCK] = {0};
+  std::vector<uint8_t> out(keys.size() * N_BLOCK);
+  while (state.KeepRunning()) {
+    backend->encrypt_keys(keys.data(), keys.size(), block, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_AesEncryptKeys)->Apply(BackendArgs);
+
+// The signature of a signed write of 20 octets of data: the handle, the
+// opcode, the data and the sign counter.
+void BM_SignedWriteCmac(benchmark::State& state) {
+  uint8_t csrk[N_BLOCK] = {0};
+  uint8_t msg[27] = {0};
+  uint8_t mac[8];
+  while (state.KeepRunning()) {
+    aes_cipher_msg_auth_code(csrk, msg, sizeof(msg), sizeof(mac), mac);
+    benchmark::DoNotOptimize(mac);
+  }
+}
+BENCHMARK(BM_SignedWriteCmac);
+
+// Resolves a private address matching none of the |state.range(1)| IRKs, the
+// worst case: as btm_ble_resolve_random_addr, each IRK is expanded and
+// ah(IRK, prand) is compared to the hash of the address.
+void BM_ResolveRpa(benchmark::State& state) {
+  const tSMP_AES_BACKEND* backend = GetBackend(state);
+  if (backend == NULL) return;
+
+  std::vector<uint8_t> irks(state.range(1) * N_BLOCK);
+  for (size_t i = 0; i < irks.size(); i++) irks[i] = (uint8_t)(i * 7 + 1);
+  const uint8_t rpa[6] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0x4b};
+
+  while (state.KeepRunning()) {
+    bool resolved = false;
+    for (size_t i = 0; i < irks.size() && !resolved; i += N_BLOCK) {
+      tSMP_AES_KEY key;
+      uint8_t block[N_BLOCK] = {0};
+      smp_aes_set_key(&irks[i], &key);
+      block[N_BLOCK - 3] = rpa[0];
+      block[N_BLOCK - 2] = rpa[1];
+      block[N_BLOCK - 1] = rpa[2];
+      backend->encrypt(&key, block, block);
+      resolved = memcmp(&block[N_BLOCK - 3], &rpa[3], 3) == 0;
+    }
+    benchmark::DoNotOptimize(resolved);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ResolveRpa)->Apply(ResolveArgs);
+
+// The same resolution with BleRpaResolver, as done by the stack: the IRKs are
+// kept expanded and tried by batches. The cache is disabled, as it answers
+// the addresses seen again without any AES.
+void BM_RpaResolver(benchmark::State& state) {
+  BleRpaResolver resolver(0, 0);
+  for (int i = 0; i < state.range(0); i++) {
+    BT_OCTET16 irk;
+    memset(irk, (uint8_t)(i * 7 + 1), BT_OCTET16_LEN);
+    resolver.AddIrk(irk);
+  }
+  const BD_ADDR rpa = {0x12, 0x34, 0x56, 0x78, 0x9a, 0x4b};
+
+  state.SetLabel(smp_aes_get_backend()->name);
+  while (state.KeepRunning()) {
+    BT_OCTET16 irk;
+    benchmark::DoNotOptimize(resolver.Resolve(rpa, 0, irk));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RpaResolver)->Arg(16)->Arg(1024);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "stack/smp/smp_aes.h"
+
+extern bool aes_cipher_msg_auth_code(uint8_t* key, uint8_t* input,
+                                     uint16_t length, uint16_t tlen,
+                                     uint8_t* p_signature);
+
+namespace {
+
+/* FIPS-197, Appendix C.1 */
+const uint8_t fips_key[N_BLOCK] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+                                   0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+                                   0x0c, 0x0d, 0x0e, 0x0f};
+const uint8_t fips_plain[N_BLOCK] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+                                     0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb,
+                                     0xcc, 0xdd, 0xee, 0xff};
+const uint8_t fips_cipher[N_BLOCK] = {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b,
+                                      0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80,
+                                      0x70, 0xb4, 0xc5, 0x5a};
+
+/* RFC 4493, section 4, in big endian order */
+const uint8_t cmac_key[N_BLOCK] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae,
+                                   0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88,
+                                   0x09, 0xcf, 0x4f, 0x3c};
+const uint8_t cmac_msg[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e,
+    0x11, 0x73, 0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03,
+    0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51, 0x30,
+    0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19,
+    0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b,
+    0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+
+struct CmacVector {
+  uint16_t length;
+  uint8_t mac[N_BLOCK];
+};
+
+const CmacVector cmac_vectors[] = {
+    {0,
+     {0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12,
+      0x9b, 0x75, 0x67, 0x46}},
+    {16,
+     {0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d,
+      0xd0, 0x4a, 0x28, 0x7c}},
+    {40,
+     {0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61,
+      0x14, 0x97, 0xc8, 0x27}},
+    {64,
+     {0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17,
+      0x79, 0x36, 0x3c, 0xfe}},
+};
+
+/* The CMAC of SMP takes and returns little endian values */
+std::vector<uint8_t> Reversed(const uint8_t* data, size_t len) {
+  std::vector<uint8_t> reversed(data, data + len);
+  std::reverse(reversed.begin(), reversed.end());
+  return reversed;
+}
+
+}  // namespace
+
+TEST(SmpAesTest, Fips197) {
+  tSMP_AES_KEY key;
+  smp_aes_set_key(fips_key, &key);
+
+  for (size_t i = 0; smp_aes_backends[i] != NULL; i++) {
+    const tSMP_AES_BACKEND* backend = smp_aes_backends[i];
+    if (!backend->is_supported()) continue;
+
+    uint8_t block[N_BLOCK];
+    backend->encrypt(&key, fips_plain, block);
+    EXPECT_EQ(0, memcmp(fips_cipher, block, N_BLOCK)) << backend->name;
+
+    memcpy(block, fips_plain, N_BLOCK);
+    backend->encrypt(&key, block, block);
+    EXPECT_EQ(0, memcmp(fips_cipher, block, N_BLOCK)) << backend->name;
+  }
+}
+
+TEST(SmpAesTest, BackendsAgree) {
+  const tSMP_AES_BACKEND* portable = NULL;
+  for (size_t i = 0; smp_aes_backends[i] != NULL; i++)
+    portable = smp_aes_backends[i];
+  ASSERT_TRUE(portable->is_supported());
+
+  uint8_t expected[N_BLOCK];
+  memcpy(expected, fips_plain, N_BLOCK);
+  for (size_t i = 0; smp_aes_backends[i] != NULL; i++) {
+    const tSMP_AES_BACKEND* backend = smp_aes_backends[i];
+    if (!backend->is_supported()) continue;
+
+    /* each block is encrypted with the previous one as the key */
+    uint8_t block[N_BLOCK], expected_block[N_BLOCK];
+    memcpy(block, fips_plain, N_BLOCK);
+    memcpy(expected_block, fips_plain, N_BLOCK);
+    for (int round = 0; round < 1000; round++) {
+      tSMP_AES_KEY key;
+      smp_aes_set_key(block, &key);
+      backend->encrypt(&key, block, block);
+
+      smp_aes_set_key(expected_block, &key);
+      portable->encrypt(&key, expected_block, expected_block);
+      ASSERT_EQ(0, memcmp(expected_block, block, N_BLOCK)) << backend->name;
+    }
+  }
+}
+
+TEST(SmpAesTest, EncryptKeys) {
+  /* not a multiple of the encryptions interleaved */
+  std::vector<tSMP_AES_KEY> keys(11);
+  for (size_t i = 0; i < keys.size(); i++) {
+    uint8_t raw_key[N_BLOCK];
+    memset(raw_key, (int)i, N_BLOCK);
+    smp_aes_set_key(raw_key, &keys[i]);
+  }
+
+  for (size_t i = 0; smp_aes_backends[i] != NULL; i++) {
+    const tSMP_AES_BACKEND* backend = smp_aes_backends[i];
+    if (!backend->is_supported()) continue;
+
+    std::vector<uint8_t> out(keys.size() * N_BLOCK);
+    backend->encrypt_keys(keys.data(), keys.size(), fips_plain, out.data());
+    for (size_t k = 0; k < keys.size(); k++) {
+      uint8_t expected[N_BLOCK];
+      backend->encrypt(&keys[k], fips_plain, expected);
+      EXPECT_EQ(0, memcmp(expected, &out[k * N_BLOCK], N_BLOCK))
+          << backend->name << " key " << k;
+    }
+  }
+}
+
+TEST(SmpAesTest, Rfc4493Cmac) {
+  std::vector<uint8_t> key = Reversed(cmac_key, N_BLOCK);
+  for (const CmacVector& vector : cmac_vectors) {
+    std::vector<uint8_t> msg = Reversed(cmac_msg, vector.length);
+    uint8_t mac[N_BLOCK];
+    ASSERT_TRUE(aes_cipher_msg_auth_code(key.data(), msg.data(), vector.length,
+                                         N_BLOCK, mac));
+    EXPECT_EQ(Reversed(vector.mac, N_BLOCK),
+              std::vector<uint8_t>(mac, mac + N_BLOCK))
+        << "length " << vector.length;
+
+    /* a shorter mac is made of the most significant bytes */
+    uint8_t short_mac[8];
+    ASSERT_TRUE(aes_cipher_msg_auth_code(key.data(), msg.data(), vector.length,
+                                         sizeof(short_mac), short_mac));
+    EXPECT_EQ(Reversed(vector.mac, sizeof(short_mac)),
+              std::vector<uint8_t>(short_mac, short_mac + sizeof(short_mac)));
+  }
+
+  uint8_t too_long[N_BLOCK + 1];
+  EXPECT_FALSE(aes_cipher_msg_auth_code(key.data(), NULL, 0, sizeof(too_long),
+                                        too_long));
+}
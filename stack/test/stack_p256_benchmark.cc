@@ -0,0 +1,70 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Cost of the P-256 point multiplications of LE Secure Connections: the
+// public key generation, from the base point, and the DHKey computation,
+// from the public key of the peer.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+namespace {
+
+// The private key of the sample data of the Core specification
+const uint32_t kPrivateKey[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+
+void BM_PointMultBinNaf(benchmark::State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  while (state.KeepRunning()) {
+    // the scalar is consumed by the multiplication
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    memcpy(n, kPrivateKey, sizeof(n));
+    Point q;
+    ECC_PointMult_Bin_NAF(&q, &curve_p256.G, n, KEY_LENGTH_DWORDS_P256);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_PointMultBinNaf);
+
+void BM_PointMultWindow(benchmark::State& state) {
+  p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+  while (state.KeepRunning()) {
+    Point q;
+    ECC_PointMult_Window(&q, &curve_p256.G, kPrivateKey);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_PointMultWindow);
+
+void BM_PointMultBase(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    Point q;
+    ECC_PointMult_Base(&q, kPrivateKey);
+    benchmark::DoNotOptimize(q);
+  }
+}
+BENCHMARK(BM_PointMultBase);
+
+}  // namespace
+
+BENCHMARK_MAIN();
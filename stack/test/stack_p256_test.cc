@@ -0,0 +1,167 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "stack/smp/p_256_ecc_pp.h"
+
+namespace {
+
+/* The sample data of the Core specification, Vol 3 Part H 2.3.5.6.1, and the
+ * order of the curve minus 1 */
+const uint32_t private_a[KEY_LENGTH_DWORDS_P256] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+    0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+
+const uint32_t public_a_x[KEY_LENGTH_DWORDS_P256] = {
+    0x0e359de6, 0xcc030148, 0xacf4fddb, 0xeff49111,
+    0xe9f9a5b9, 0x5e2c83a7, 0xf297be2c, 0x20b003d2};
+
+const uint32_t public_a_y[KEY_LENGTH_DWORDS_P256] = {
+    0x1589d28b, 0x741c8ed0, 0x8fed3024, 0x766345c2,
+    0x5a52155c, 0x63329abf, 0x652aeb6d, 0xdc809c49};
+
+const uint32_t private_b[KEY_LENGTH_DWORDS_P256] = {
+    0xf47fc5fd, 0x6b4fdd49, 0xf19d7cfb, 0x59cb9ac2,
+    0xeed4e72a, 0x900afcfb, 0x32f6bb9a, 0x55188b3d};
+
+const uint32_t public_b_x[KEY_LENGTH_DWORDS_P256] = {
+    0x2faaa190, 0x559077b2, 0x8615a69f, 0x47b58afd,
+    0xf19e4c00, 0x09592284, 0x1faf1d96, 0x1ea1f0f0};
+
+const uint32_t public_b_y[KEY_LENGTH_DWORDS_P256] = {
+    0x15b1214a, 0x5f89aff9, 0xe28e3676, 0x472d1130,
+    0x9ab85160, 0x7356703a, 0x429dad37, 0x4c55f33e};
+
+const uint32_t dhkey[KEY_LENGTH_DWORDS_P256] = {
+    0x73bfa698, 0x868d34f3, 0xb4f866f1, 0x99796b13,
+    0x0a397d9b, 0x341010a6, 0x57c8ad05, 0xec0234a3};
+
+const uint32_t order_minus_1[KEY_LENGTH_DWORDS_P256] = {
+    0xfc632550, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+    0xffffffff, 0xffffffff, 0x00000000, 0xffffffff};
+
+Point MakePoint(const uint32_t* x, const uint32_t* y) {
+  Point point;
+  memset(&point, 0, sizeof(point));
+  memcpy(point.x, x, sizeof(point.x));
+  memcpy(point.y, y, sizeof(point.y));
+  return point;
+}
+
+/* Returns the next scalar of a fixed pseudo-random sequence */
+void NextScalar(uint32_t* seed, uint32_t* n) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    *seed = *seed * 1103515245 + 12345;
+    n[i] = (*seed >> 16) | (*seed << 16);
+  }
+}
+
+void ExpectCoordinate(const uint32_t* expected, const uint32_t* actual) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++)
+    EXPECT_EQ(expected[i], actual[i]) << "word " << i;
+}
+
+}  // namespace
+
+class P256Test : public ::testing::Test {
+ protected:
+  virtual void SetUp() { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+};
+
+TEST_F(P256Test, PublicKey) {
+  Point public_key;
+  ECC_PointMult_Base(&public_key, private_a);
+  ExpectCoordinate(public_a_x, public_key.x);
+  ExpectCoordinate(public_a_y, public_key.y);
+
+  ECC_PointMult_Window(&public_key, &curve_p256.G, private_b);
+  ExpectCoordinate(public_b_x, public_key.x);
+  ExpectCoordinate(public_b_y, public_key.y);
+}
+
+TEST_F(P256Test, DHKey) {
+  Point peer_public_key = MakePoint(public_b_x, public_b_y);
+  Point key;
+  ECC_PointMult_Window(&key, &peer_public_key, private_a);
+  ExpectCoordinate(dhkey, key.x);
+
+  peer_public_key = MakePoint(public_a_x, public_a_y);
+  ECC_PointMult_Window(&key, &peer_public_key, private_b);
+  ExpectCoordinate(dhkey, key.x);
+}
+
+TEST_F(P256Test, SmallAndLargeScalars) {
+  uint32_t one[KEY_LENGTH_DWORDS_P256] = {1};
+  Point point;
+  ECC_PointMult_Base(&point, one);
+  ExpectCoordinate(curve_p256.G.x, point.x);
+  ExpectCoordinate(curve_p256.G.y, point.y);
+
+  /* (n - 1) * G = -G */
+  uint32_t minus_gy[KEY_LENGTH_DWORDS_P256];
+  multiprecision_sub(minus_gy, curve_p256.p, curve_p256.G.y,
+                     KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Base(&point, order_minus_1);
+  ExpectCoordinate(curve_p256.G.x, point.x);
+  ExpectCoordinate(minus_gy, point.y);
+  ECC_PointMult_Window(&point, &curve_p256.G, order_minus_1);
+  ExpectCoordinate(curve_p256.G.x, point.x);
+  ExpectCoordinate(minus_gy, point.y);
+}
+
+TEST_F(P256Test, MatchesBinaryNaf) {
+  uint32_t seed = 1;
+  for (int k = 0; k < 32; k++) {
+    uint32_t n[KEY_LENGTH_DWORDS_P256];
+    NextScalar(&seed, n);
+    uint32_t n_copy[KEY_LENGTH_DWORDS_P256];
+    memcpy(n_copy, n, sizeof(n));
+
+    Point expected;
+    ECC_PointMult_Bin_NAF(&expected, &curve_p256.G, n_copy,
+                          KEY_LENGTH_DWORDS_P256);
+
+    Point base;
+    ECC_PointMult_Base(&base, n);
+    ExpectCoordinate(expected.x, base.x);
+    ExpectCoordinate(expected.y, base.y);
+
+    /* the multiples of another point than the base point */
+    Point point = MakePoint(public_a_x, public_a_y);
+    memcpy(n_copy, n, sizeof(n));
+    ECC_PointMult_Bin_NAF(&expected, &point, n_copy, KEY_LENGTH_DWORDS_P256);
+
+    Point window;
+    ECC_PointMult_Window(&window, &point, n);
+    ExpectCoordinate(expected.x, window.x);
+    ExpectCoordinate(expected.y, window.y);
+  }
+}
+
+TEST_F(P256Test, ScalarUntouched) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256];
+  memcpy(n, private_a, sizeof(n));
+
+  Point point;
+  ECC_PointMult_Base(&point, n);
+  ECC_PointMult_Window(&point, &curve_p256.G, n);
+  ExpectCoordinate(private_a, n);
+}
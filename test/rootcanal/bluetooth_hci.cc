@@ -92,8 +92,15 @@ Return<void> BluetoothHci::initialize(const sp<IBluetoothHciCallbacks>& cb) {
     cb->hciEventReceived(hci_event);
   });
 
-  /* RegisterAcl and RegisterSco
-        cb->aclDataReceived(hci_packet);
+  controller_.RegisterAclChannel([cb](const std::vector<uint8_t>& packet) {
+    hidl_vec<uint8_t> acl_packet;
+    acl_packet.resize(packet.size());
+    memcpy(acl_packet.data(), packet.data(), packet.size());
+
+    cb->aclDataReceived(acl_packet);
+  });
+
+  /* RegisterSco
         cb->scoDataReceived(hci_packet);
   */
 
@@ -142,8 +149,11 @@ Return<void> BluetoothHci::sendHciCommand(const hidl_vec<uint8_t>& packet) {
   return Void();
 }
 
-Return<void> BluetoothHci::sendAclData(const hidl_vec<uint8_t>& /* packet */) {
-  CHECK(false) << __func__ << " not yet implemented";
+Return<void> BluetoothHci::sendAclData(const hidl_vec<uint8_t>& packet) {
+  async_manager_.ExecAsync(std::chrono::milliseconds(0), [this, packet]() {
+    controller_.HandleAcl(
+        std::vector<uint8_t>(packet.data(), packet.data() + packet.size()));
+  });
   return Void();
 }
 
@@ -0,0 +1,170 @@
+#!/bin/sh
+
+known_tests=(
+  net_test_bluetooth_perf
+)
+
+known_benchmarks=(
+  net_bench_osi_alarm
+  net_bench_osi_allocator
+  net_bench_osi_config
+  net_bench_osi_fixed_queue
+  net_bench_osi_list
+  net_bench_osi_reactor
+  net_bench_stack_a2dp_encoder
+)
+
+known_remote_tests=(
+  net_test_rfcomm_perf
+)
+
+scenario="suite/perf/perf_scenario.json"
+remote_scenario="/data/local/tmp/bt_perf_scenario.json"
+remote_results="/data/local/tmp/bt_perf"
+
+usage() {
+  binary="$(basename "$0")"
+  echo "Usage: ${binary} --help"
+  echo "       ${binary} [-s <specific device>] [-o <output directory>] [--all] [<test name>[.<filter>] ...] [--<arg> ...]"
+  echo
+  echo "Unknown long arguments are passed to the tests."
+  echo
+  echo "The results are written to the output directory, bt_perf_results by"
+  echo "default: <test name>.json is the gtest output of a test, with the metrics"
+  echo "as properties of the test cases, <test name>.jsonl holds one metric per"
+  echo "line, and the benchmarks write <benchmark name>.json."
+  echo
+  echo "Known test names:"
+
+  for name in "${known_tests[@]}" "${known_benchmarks[@]}"
+  do
+    echo "    ${name}"
+  done
+
+  echo
+  echo "Known tests that need a remote device:"
+  for name in "${known_remote_tests[@]}"
+  do
+    echo "    ${name}"
+  done
+}
+
+is_benchmark() {
+  for benchmark in "${known_benchmarks[@]}"
+  do
+    if [ "$1" = "${benchmark}" ]; then
+      return 0
+    fi
+  done
+  return 1
+}
+
+device=
+output="bt_perf_results"
+tests=()
+test_args=()
+while [ $# -gt 0 ]
+do
+  case "$1" in
+    -h|--help)
+      usage
+      exit 0
+      ;;
+    -s)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: no device specified" 1>&2
+        usage
+        exit 2
+      fi
+      device="$1"
+      shift
+      ;;
+    -o)
+      shift
+      if [ $# -eq 0 ]; then
+        echo "error: no output directory specified" 1>&2
+        usage
+        exit 2
+      fi
+      output="$1"
+      shift
+      ;;
+    --all)
+      tests+=( "${known_tests[@]}" "${known_benchmarks[@]}" )
+      shift
+      ;;
+    --*)
+      test_args+=( "$1" )
+      shift
+      ;;
+    *)
+      tests+=( "$1" )
+      shift
+      ;;
+  esac
+done
+
+if [ "${#tests[@]}" -eq 0 ]; then
+  tests+=( "${known_tests[@]}" "${known_benchmarks[@]}" )
+fi
+
+adb=( "adb" )
+if [ -n "${device}" ]; then
+  adb+=( "-s" "${device}" )
+fi
+
+# The GATT tests load the scenario into the rootcanal controller.
+"${adb[@]}" push "$(dirname "$0")/${scenario}" "${remote_scenario}"
+"${adb[@]}" shell rm -rf "${remote_results}"
+"${adb[@]}" shell mkdir -p "${remote_results}"
+mkdir -p "${output}"
+
+failed_tests=()
+for spec in "${tests[@]}"
+do
+  name="${spec%%.*}"
+
+  if is_benchmark "${name}"; then
+    binary="/data/benchmarktest/${name}/${name}"
+    test_command=( "${adb[@]}" shell "${binary}" --benchmark_format=json
+                   "${test_args[@]}" )
+  else
+    binary="/data/nativetest/${name}/${name}"
+    test_command=( "${adb[@]}" shell
+                   "BT_PERF_RESULTS=${remote_results}/${name}.jsonl"
+                   "BT_PERF_SCENARIO=${remote_scenario}"
+                   "${binary}"
+                   "--gtest_output=json:${remote_results}/${name}.json" )
+    if [ "${name}" != "${spec}" ]; then
+      filter="${spec#*.}"
+      test_command+=( "--gtest_filter=${filter}" )
+    fi
+    test_command+=( "${test_args[@]}" )
+  fi
+
+  push_command=( "${adb[@]}" push {"${ANDROID_PRODUCT_OUT}",}"${binary}" )
+
+  echo "--- ${name} ---"
+  echo "pushing..."
+  "${push_command[@]}"
+  echo "running..."
+  if is_benchmark "${name}"; then
+    "${test_command[@]}" > "${output}/${name}.json" ||
+        failed_tests+=( "${name}" )
+  else
+    "${test_command[@]}" || failed_tests+=( "${name}" )
+  fi
+done
+
+"${adb[@]}" pull "${remote_results}/." "${output}"
+
+if [ "${#failed_tests[@]}" -ne 0 ]; then
+  for failed_test in "${failed_tests[@]}"
+  do
+    echo "!!! FAILED TEST: ${failed_test} !!!"
+  done
+  exit 1
+fi
+
+exit 0
@@ -10,8 +10,17 @@ known_tests=(
   net_test_device
   net_test_hci
   net_test_stack
+  net_test_stack_a2dp_source_sim
   net_test_stack_multi_adv
   net_test_stack_ad_parser
+  net_test_stack_scan_filter
+  net_test_stack_scan_dedup
+  net_test_stack_rpa_resolver
+  net_test_stack_sec_dev_index
+  net_test_stack_bg_conn_list
+  net_test_stack_resolving_list
+  net_test_stack_p256
+  net_test_stack_aes
   net_test_stack_smp
   net_test_osi
 )
@@ -0,0 +1,320 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "perf/gatt_perf_test.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "btcore/include/bdaddr.h"
+#include "perf/perf_metrics.h"
+
+namespace {
+
+// The test channel of the rootcanal controller.
+const uint16_t kTestChannelPort = 6111;
+
+const char kScenarioVariable[] = "BT_PERF_SCENARIO";
+const char kDefaultScenario[] = "/data/local/tmp/bt_perf_scenario.json";
+
+// The largest ATT MTU, Bluetooth Core Specification Version 4.2, Volume 3,
+// Part F, Section 3.2.8.
+const int kMaxAttMtu = 517;
+
+const bt_uuid_t kPerfClientUuid = {{0x9B, 0x1A, 0x4E, 0x27, 0xC3, 0x5D,
+                                    0x41, 0x8F, 0xA6, 0x02, 0x7E, 0x11,
+                                    0x38, 0xD4, 0x55, 0xF0}};
+
+// Appends the test channel encoding of |string|: its length then its octets.
+void AppendString(const std::string& string, std::vector<uint8_t>* command) {
+  command->push_back(string.size());
+  command->insert(command->end(), string.begin(), string.end());
+}
+
+}  // namespace
+
+namespace bttest {
+
+const size_t GattPerfTest::kScanDevices;
+const size_t GattPerfTest::kPeerServices;
+const char GattPerfTest::kPeerAddress[] = "c0:00:00:00:10:00";
+
+void GattPerfTest::SetUp() {
+  GattTest::SetUp();
+
+  scan_done_sem_ = semaphore_new(0);
+  connect_sem_ = semaphore_new(0);
+  disconnect_sem_ = semaphore_new(0);
+  search_complete_sem_ = semaphore_new(0);
+  gatt_db_sem_ = semaphore_new(0);
+  write_sem_ = semaphore_new(0);
+  write_descriptor_sem_ = semaphore_new(0);
+  mtu_sem_ = semaphore_new(0);
+
+  string_to_bdaddr(kPeerAddress, &peer_address_);
+  bluetooth::hal::BluetoothGattInterface::Get()->AddScannerObserver(this);
+
+  ASSERT_NO_FATAL_FAILURE(LoadScenario());
+
+  bt_uuid_t client_uuid = kPerfClientUuid;
+  gatt_client_interface()->register_client(&client_uuid);
+  semaphore_wait(register_client_callback_sem_);
+  ASSERT_EQ(status(), BT_STATUS_SUCCESS) << "Error registering GATT client.";
+}
+
+void GattPerfTest::TearDown() {
+  DisconnectFromPeer();
+  bluetooth::hal::BluetoothGattInterface::Get()->StopScan(
+      client_interface_id());
+  gatt_client_interface()->unregister_client(client_interface_id());
+  bluetooth::hal::BluetoothGattInterface::Get()->RemoveScannerObserver(this);
+
+  semaphore_free(scan_done_sem_);
+  semaphore_free(connect_sem_);
+  semaphore_free(disconnect_sem_);
+  semaphore_free(search_complete_sem_);
+  semaphore_free(gatt_db_sem_);
+  semaphore_free(write_sem_);
+  semaphore_free(write_descriptor_sem_);
+  semaphore_free(mtu_sem_);
+
+  GattTest::TearDown();
+}
+
+void GattPerfTest::LoadScenario() {
+  const char* scenario = getenv(kScenarioVariable);
+  if (scenario == nullptr || *scenario == '\0') scenario = kDefaultScenario;
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(fd, -1) << "Error creating the test channel socket.";
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(kTestChannelPort);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    close(fd);
+    FAIL() << "Unable to reach the test channel of the controller; the GATT "
+              "performance tests need the rootcanal controller.";
+  }
+
+  std::vector<uint8_t> command;
+  AppendString("LOAD_SCENARIO", &command);
+  command.push_back(1);
+  AppendString(scenario, &command);
+  AppendString("CLOSE_TEST_CHANNEL", &command);
+  ssize_t written = write(fd, command.data(), command.size());
+  close(fd);
+  ASSERT_EQ(written, static_cast<ssize_t>(command.size()))
+      << "Error sending the scenario to the test channel.";
+}
+
+double GattPerfTest::ScanForDevices(size_t count) {
+  {
+    std::lock_guard<std::mutex> lock(scan_lock_);
+    seen_devices_.clear();
+    peer_seen_ = false;
+    scan_target_ = count;
+    scanning_ = true;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  bluetooth::hal::BluetoothGattInterface::Get()->StartScan(
+      client_interface_id());
+  semaphore_wait(scan_done_sem_);
+  double elapsed = MillisecondsSince(start);
+  bluetooth::hal::BluetoothGattInterface::Get()->StopScan(
+      client_interface_id());
+  return elapsed;
+}
+
+void GattPerfTest::FindPeer() { ScanForDevices(0); }
+
+double GattPerfTest::ConnectToPeer() {
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(gatt_client_interface()->connect(client_interface_id(),
+                                             &peer_address_, true,
+                                             BT_TRANSPORT_LE, PHY_LE_1M_MASK),
+            BT_STATUS_SUCCESS);
+  semaphore_wait(connect_sem_);
+  double elapsed = MillisecondsSince(start);
+  EXPECT_EQ(connect_status_, BT_STATUS_SUCCESS) << "Error connecting to peer.";
+  return elapsed;
+}
+
+void GattPerfTest::DisconnectFromPeer() {
+  if (!connected_) return;
+
+  gatt_client_interface()->disconnect(client_interface_id(), &peer_address_,
+                                      conn_id_);
+  semaphore_wait(disconnect_sem_);
+}
+
+double GattPerfTest::DiscoverServices() {
+  auto start = std::chrono::steady_clock::now();
+  gatt_client_interface()->search_service(conn_id_, nullptr);
+  semaphore_wait(search_complete_sem_);
+  double elapsed = MillisecondsSince(start);
+  EXPECT_EQ(search_status_, BT_STATUS_SUCCESS) << "Error discovering services.";
+
+  gatt_client_interface()->get_gatt_db(conn_id_);
+  semaphore_wait(gatt_db_sem_);
+  return elapsed;
+}
+
+int GattPerfTest::ExchangeMtu() {
+  gatt_client_interface()->configure_mtu(conn_id_, kMaxAttMtu);
+  semaphore_wait(mtu_sem_);
+  return mtu_;
+}
+
+uint16_t GattPerfTest::FindCharacteristic(uint8_t properties) const {
+  for (const auto& element : gatt_db_) {
+    if (element.type == BTGATT_DB_CHARACTERISTIC &&
+        (element.properties & properties) == properties)
+      return element.attribute_handle;
+  }
+  return 0;
+}
+
+uint16_t GattPerfTest::FindCccd(uint16_t handle) const {
+  bool in_characteristic = false;
+  for (const auto& element : gatt_db_) {
+    if (element.type != BTGATT_DB_DESCRIPTOR) {
+      if (in_characteristic) break;
+      in_characteristic = element.type == BTGATT_DB_CHARACTERISTIC &&
+                          element.attribute_handle == handle;
+      continue;
+    }
+    // The 16-bit UUID 0x2902 in the Bluetooth Base UUID.
+    if (in_characteristic && element.uuid.uu[12] == 0x02 &&
+        element.uuid.uu[13] == 0x29)
+      return element.attribute_handle;
+  }
+  return 0;
+}
+
+int GattPerfTest::WriteCharacteristic(uint16_t handle, int write_type,
+                                      const std::vector<uint8_t>& value) {
+  gatt_client_interface()->write_characteristic(conn_id_, handle, write_type,
+                                                0 /* auth_req */, value);
+  semaphore_wait(write_sem_);
+  return write_status_;
+}
+
+int GattPerfTest::WriteDescriptor(uint16_t handle,
+                                  const std::vector<uint8_t>& value) {
+  gatt_client_interface()->write_descriptor(conn_id_, handle,
+                                            0 /* auth_req */, value);
+  semaphore_wait(write_descriptor_sem_);
+  return write_status_;
+}
+
+// callback
+void GattPerfTest::ConnectCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status, int client_if, const bt_bdaddr_t& bda) {
+  conn_id_ = conn_id;
+  connect_status_ = status;
+  connected_ = status == BT_STATUS_SUCCESS;
+  semaphore_post(connect_sem_);
+}
+
+// callback
+void GattPerfTest::DisconnectCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status, int client_if, const bt_bdaddr_t& bda) {
+  connected_ = false;
+  semaphore_post(disconnect_sem_);
+}
+
+// callback
+void GattPerfTest::SearchCompleteCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status) {
+  search_status_ = status;
+  semaphore_post(search_complete_sem_);
+}
+
+// callback
+void GattPerfTest::GetGattDbCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    btgatt_db_element_t* gatt_db, int size) {
+  gatt_db_.assign(gatt_db, gatt_db + size);
+  semaphore_post(gatt_db_sem_);
+}
+
+// callback
+void GattPerfTest::NotifyCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    btgatt_notify_params_t* p_data) {
+  notifications_++;
+  notification_bytes_ += p_data->len;
+}
+
+// callback
+void GattPerfTest::WriteCharacteristicCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status, uint16_t handle) {
+  write_status_ = status;
+  semaphore_post(write_sem_);
+}
+
+// callback
+void GattPerfTest::WriteDescriptorCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status, uint16_t handle) {
+  write_status_ = status;
+  semaphore_post(write_descriptor_sem_);
+}
+
+// callback
+void GattPerfTest::MtuChangedCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+    int status, int mtu) {
+  mtu_ = mtu;
+  semaphore_post(mtu_sem_);
+}
+
+// callback
+void GattPerfTest::ScanResultCallback(
+    bluetooth::hal::BluetoothGattInterface* /* unused */,
+    const bt_bdaddr_t& bda, int rssi, std::vector<uint8_t> adv_data) {
+  bdstr_t address;
+  bdaddr_to_string(&bda, address, sizeof(address));
+
+  std::lock_guard<std::mutex> lock(scan_lock_);
+  if (!scanning_) return;
+
+  seen_devices_.insert(address);
+  if (bdaddr_equals(&bda, &peer_address_)) peer_seen_ = true;
+  bool done = scan_target_ == 0 ? peer_seen_
+                                : seen_devices_.size() >= scan_target_;
+  if (!done) return;
+
+  scanning_ = false;
+  semaphore_post(scan_done_sem_);
+}
+
+}  // bttest
@@ -0,0 +1,162 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gatt/gatt_test.h"
+
+namespace bttest {
+
+// The GATT and LE performance tests run against the virtual LE devices of the
+// rootcanal controller. The fixture loads the scenario of the devices,
+// perf/perf_scenario.json, through the test channel of the controller, and
+// registers a GATT client:
+//
+//   - the non-connectable advertisers of the scenario, for the scan tests,
+//   - and one connectable peer with kPeerServices services, including a
+//     service with a writable characteristic and a notifying one.
+//
+// The BT_PERF_SCENARIO environment variable overrides the path of the
+// scenario, which must be readable by the controller.
+class GattPerfTest : public GattTest {
+ protected:
+  // The devices of perf/perf_scenario.json.
+  static const size_t kScanDevices = 100;
+  static const size_t kPeerServices = 10;
+  static const char kPeerAddress[];
+
+  GattPerfTest() = default;
+  virtual ~GattPerfTest() = default;
+
+  void SetUp() override;
+  void TearDown() override;
+
+  // Scans until |count| distinct devices were seen, and returns the time
+  // it took in milliseconds.
+  double ScanForDevices(size_t count);
+
+  // Scans until the peer is seen, so that the stack knows its address type.
+  void FindPeer();
+
+  // Connects to the peer, and returns the time it took in milliseconds.
+  double ConnectToPeer();
+  void DisconnectFromPeer();
+
+  // Discovers the services of the peer into |gatt_db_|, and returns the time
+  // of the discovery in milliseconds.
+  double DiscoverServices();
+
+  // Negotiates the largest ATT MTU with the peer, and returns it.
+  int ExchangeMtu();
+
+  // The handle of the first characteristic of |gatt_db_| that has all the
+  // |properties|, or 0.
+  uint16_t FindCharacteristic(uint8_t properties) const;
+
+  // The handle of the client characteristic configuration descriptor of the
+  // characteristic |handle|, or 0.
+  uint16_t FindCccd(uint16_t handle) const;
+
+  // Writes |value| to the characteristic |handle| and waits for the
+  // completion. Returns the status.
+  int WriteCharacteristic(uint16_t handle, int write_type,
+                          const std::vector<uint8_t>& value);
+
+  // Writes |value| to the descriptor |handle| and waits for the completion.
+  // Returns the status.
+  int WriteDescriptor(uint16_t handle, const std::vector<uint8_t>& value);
+
+  int conn_id() const { return conn_id_; }
+  const bt_bdaddr_t& peer_address() const { return peer_address_; }
+  const std::vector<btgatt_db_element_t>& gatt_db() const { return gatt_db_; }
+
+  // Counters of the notifications received, reset by the tests.
+  std::atomic<uint64_t> notifications_{0};
+  std::atomic<uint64_t> notification_bytes_{0};
+
+  // bluetooth::hal::BluetoothGattInterface::ClientObserver overrides
+  void ConnectCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                       int conn_id, int status, int client_if,
+                       const bt_bdaddr_t& bda) override;
+  void DisconnectCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                          int conn_id, int status, int client_if,
+                          const bt_bdaddr_t& bda) override;
+  void SearchCompleteCallback(
+      bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+      int status) override;
+  void GetGattDbCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                         int conn_id, btgatt_db_element_t* gatt_db,
+                         int size) override;
+  void NotifyCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                      int conn_id, btgatt_notify_params_t* p_data) override;
+  void WriteCharacteristicCallback(
+      bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+      int status, uint16_t handle) override;
+  void WriteDescriptorCallback(
+      bluetooth::hal::BluetoothGattInterface* /* unused */, int conn_id,
+      int status, uint16_t handle) override;
+  void MtuChangedCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                          int conn_id, int status, int mtu) override;
+
+  // bluetooth::hal::BluetoothGattInterface::ScannerObserver overrides
+  void ScanResultCallback(bluetooth::hal::BluetoothGattInterface* /* unused */,
+                          const bt_bdaddr_t& bda, int rssi,
+                          std::vector<uint8_t> adv_data) override;
+
+ private:
+  // Sends the LOAD_SCENARIO command to the test channel of the controller.
+  void LoadScenario();
+
+  semaphore_t* scan_done_sem_;
+  semaphore_t* connect_sem_;
+  semaphore_t* disconnect_sem_;
+  semaphore_t* search_complete_sem_;
+  semaphore_t* gatt_db_sem_;
+  semaphore_t* write_sem_;
+  semaphore_t* write_descriptor_sem_;
+  semaphore_t* mtu_sem_;
+
+  bt_bdaddr_t peer_address_;
+
+  // The scan state, written by the callbacks.
+  std::mutex scan_lock_;
+  std::set<std::string> seen_devices_;
+  size_t scan_target_ = 0;
+  bool peer_seen_ = false;
+  bool scanning_ = false;
+
+  // The state of the connection to the peer. The semaphores order the
+  // accesses of the callbacks and the tests.
+  int conn_id_ = 0;
+  int connect_status_ = 0;
+  bool connected_ = false;
+  std::vector<btgatt_db_element_t> gatt_db_;
+  int search_status_ = 0;
+  int write_status_ = 0;
+  int mtu_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(GattPerfTest);
+};
+
+}  // bttest
@@ -0,0 +1,207 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <unistd.h>
+
+#include <thread>
+
+#include "perf/gatt_perf_test.h"
+#include "perf/perf_metrics.h"
+
+namespace {
+
+const int kIterations = 10;
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part G, Section 3.3.1.1
+const uint8_t kPropertyWriteWithoutResponse = 0x04;
+const uint8_t kPropertyWrite = 0x08;
+const uint8_t kPropertyNotify = 0x10;
+
+// The write types of the HAL, as in stack/include/gatt_api.h.
+const int kWriteTypeNoResponse = 1;
+const int kWriteTypeDefault = 2;
+
+const int kWrites = 500;
+const std::chrono::seconds kNotifyDuration(5);
+
+// The dynamic LE PSM connected to; the peer accepts any. The mask selects an
+// LE credit based connection, as in btif/include/btif_sock_l2cap.h.
+const int kCocPsm = 0x0080;
+const int kLeCocChannelMask = 0x20000;
+const size_t kCocBytes = 1024 * 1024;
+const size_t kCocWriteSize = 512;
+
+}  // namespace
+
+namespace bttest {
+
+TEST_F(GattPerfTest, ScanDiscoveryTime) {
+  std::vector<double> times;
+  for (int i = 0; i < kIterations; i++)
+    times.push_back(ScanForDevices(kScanDevices));
+
+  RecordPerfSamples("scan_" + std::to_string(kScanDevices) + "_devices_time",
+                    times, "ms");
+}
+
+TEST_F(GattPerfTest, ConnectionSetupTime) {
+  FindPeer();
+
+  std::vector<double> times;
+  for (int i = 0; i < kIterations; i++) {
+    times.push_back(ConnectToPeer());
+    ASSERT_FALSE(HasFailure());
+    DisconnectFromPeer();
+  }
+
+  RecordPerfSamples("connection_setup_time", times, "ms");
+}
+
+TEST_F(GattPerfTest, ServiceDiscoveryTime) {
+  FindPeer();
+
+  std::vector<double> times;
+  for (int i = 0; i < kIterations; i++) {
+    // The services of the peer are not cached, as it is not bonded.
+    gatt_client_interface()->refresh(client_interface_id(), &peer_address());
+    ConnectToPeer();
+    ASSERT_FALSE(HasFailure());
+    times.push_back(DiscoverServices());
+
+    size_t services = 0;
+    for (const auto& element : gatt_db())
+      if (element.type == BTGATT_DB_PRIMARY_SERVICE) services++;
+    EXPECT_EQ(kPeerServices, services);
+    DisconnectFromPeer();
+  }
+
+  RecordPerfSamples(
+      "discovery_" + std::to_string(kPeerServices) + "_services_time", times,
+      "ms");
+}
+
+TEST_F(GattPerfTest, WriteRate) {
+  FindPeer();
+  ConnectToPeer();
+  ASSERT_FALSE(HasFailure());
+  DiscoverServices();
+  int mtu = ExchangeMtu();
+  RecordPerfMetric("att_mtu", mtu, "octets");
+
+  uint16_t handle =
+      FindCharacteristic(kPropertyWrite | kPropertyWriteWithoutResponse);
+  ASSERT_NE(handle, 0) << "Writable characteristic not found.";
+
+  // The largest values that fit in one PDU.
+  std::vector<uint8_t> value(mtu - 3, 0x55);
+  struct {
+    const char* name;
+    int write_type;
+  } write_types[] = {{"write_without_response", kWriteTypeNoResponse},
+                     {"write_with_response", kWriteTypeDefault}};
+  for (const auto& write_type : write_types) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kWrites; i++)
+      ASSERT_EQ(WriteCharacteristic(handle, write_type.write_type, value),
+                BT_STATUS_SUCCESS);
+    double seconds = MillisecondsSince(start) / 1000;
+
+    RecordPerfMetric(std::string(write_type.name) + "_rate",
+                     kWrites / seconds, "1/s");
+    RecordPerfMetric(std::string(write_type.name) + "_throughput",
+                     kWrites * value.size() / seconds, "B/s");
+  }
+}
+
+TEST_F(GattPerfTest, NotifyRate) {
+  FindPeer();
+  ConnectToPeer();
+  ASSERT_FALSE(HasFailure());
+  DiscoverServices();
+  ExchangeMtu();
+
+  uint16_t handle = FindCharacteristic(kPropertyNotify);
+  ASSERT_NE(handle, 0) << "Notifying characteristic not found.";
+  uint16_t cccd = FindCccd(handle);
+  ASSERT_NE(cccd, 0) << "Client characteristic configuration not found.";
+
+  gatt_client_interface()->register_for_notification(
+      client_interface_id(), &peer_address(), handle);
+  ASSERT_EQ(WriteDescriptor(cccd, {0x01, 0x00}), BT_STATUS_SUCCESS);
+
+  // Skips the first notifications, sent as soon as they are enabled.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  notifications_ = 0;
+  notification_bytes_ = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(kNotifyDuration);
+  double seconds = MillisecondsSince(start) / 1000;
+  uint64_t notifications = notifications_;
+  uint64_t bytes = notification_bytes_;
+
+  ASSERT_EQ(WriteDescriptor(cccd, {0x00, 0x00}), BT_STATUS_SUCCESS);
+  gatt_client_interface()->deregister_for_notification(
+      client_interface_id(), &peer_address(), handle);
+
+  EXPECT_GT(notifications, 0u) << "No notification received.";
+  RecordPerfMetric("notification_rate", notifications / seconds, "1/s");
+  RecordPerfMetric("notification_throughput", bytes / seconds, "B/s");
+}
+
+TEST_F(GattPerfTest, L2capCocThroughput) {
+  const btsock_interface_t* socket_interface =
+      static_cast<const btsock_interface_t*>(
+          bt_interface()->get_profile_interface(BT_PROFILE_SOCKETS_ID));
+  ASSERT_NE(socket_interface, nullptr);
+  FindPeer();
+
+  int fd = -1;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(socket_interface->connect(&peer_address(), BTSOCK_L2CAP, nullptr,
+                                      kCocPsm | kLeCocChannelMask, &fd, 0,
+                                      getuid()),
+            BT_STATUS_SUCCESS);
+  ASSERT_NE(fd, -1);
+
+  // The socket reports the channel, then the connection.
+  int channel;
+  sock_connect_signal_t signal;
+  ASSERT_EQ(read(fd, &channel, sizeof(channel)),
+            static_cast<ssize_t>(sizeof(channel)));
+  ASSERT_EQ(read(fd, &signal, sizeof(signal)),
+            static_cast<ssize_t>(sizeof(signal)));
+  EXPECT_EQ(signal.status, 0) << "Error connecting the L2CAP channel.";
+  RecordPerfMetric("l2cap_coc_connection_time", MillisecondsSince(start), "ms");
+
+  // The peer is a sink: the throughput is the rate at which the stack takes
+  // the data of the socket, bounded by its buffers and the link.
+  std::vector<uint8_t> data(kCocWriteSize, 0x55);
+  start = std::chrono::steady_clock::now();
+  size_t written = 0;
+  while (written < kCocBytes) {
+    ssize_t length = write(fd, data.data(), data.size());
+    ASSERT_GT(length, 0) << "Error writing to the L2CAP channel.";
+    written += length;
+  }
+  double seconds = MillisecondsSince(start) / 1000;
+  close(fd);
+
+  RecordPerfMetric("l2cap_coc_throughput", written / seconds, "B/s");
+}
+
+}  // bttest
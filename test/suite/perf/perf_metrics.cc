@@ -0,0 +1,91 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "perf/perf_metrics.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+// Serializes the appends of the metrics to the results file.
+std::mutex results_lock;
+
+}  // namespace
+
+namespace bttest {
+
+const char kPerfResultsVariable[] = "BT_PERF_RESULTS";
+
+void RecordPerfMetric(const std::string& name, double value,
+                      const std::string& unit) {
+  char value_string[32];
+  snprintf(value_string, sizeof(value_string), "%.3f", value);
+  ::testing::Test::RecordProperty(name, value_string);
+
+  const ::testing::TestInfo* test_info =
+      ::testing::UnitTest::GetInstance()->current_test_info();
+  std::string test_name = test_info == nullptr
+                              ? "unknown"
+                              : std::string(test_info->test_case_name()) +
+                                    "." + test_info->name();
+  printf("[ PERF     ] %s %s: %s %s\n", test_name.c_str(), name.c_str(),
+         value_string, unit.c_str());
+
+  const char* results_file = getenv(kPerfResultsVariable);
+  if (results_file == nullptr || *results_file == '\0') return;
+
+  std::lock_guard<std::mutex> lock(results_lock);
+  FILE* results = fopen(results_file, "a");
+  if (results == nullptr) {
+    ADD_FAILURE() << "Unable to open " << results_file;
+    return;
+  }
+  fprintf(results,
+          "{\"test\": \"%s\", \"metric\": \"%s\", \"value\": %s, "
+          "\"unit\": \"%s\"}\n",
+          test_name.c_str(), name.c_str(), value_string, unit.c_str());
+  fclose(results);
+}
+
+void RecordPerfSamples(const std::string& name,
+                       const std::vector<double>& samples,
+                       const std::string& unit) {
+  if (samples.empty()) return;
+
+  std::vector<double> sorted(samples);
+  std::sort(sorted.begin(), sorted.end());
+  size_t middle = sorted.size() / 2;
+  double median = sorted.size() % 2 ? sorted[middle]
+                                    : (sorted[middle - 1] + sorted[middle]) / 2;
+  RecordPerfMetric(name + "_median", median, unit);
+  RecordPerfMetric(name + "_min", sorted.front(), unit);
+  RecordPerfMetric(name + "_max", sorted.back(), unit);
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace bttest
@@ -0,0 +1,53 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace bttest {
+
+// The environment variable naming the file the metrics are appended to.
+extern const char kPerfResultsVariable[];
+
+// Records the performance metric |name| of the running test, in |unit|.
+//
+// The metric is a property of the test in the XML or JSON output of gtest
+// (--gtest_output), and is printed to stdout. When the BT_PERF_RESULTS
+// environment variable names a file, the metric is also appended to it as one
+// JSON object per line, e.g.:
+//
+//   {"test": "GattPerfTest.NotifyRate", "metric": "notifications",
+//    "value": 196.4, "unit": "1/s"}
+//
+// so that CI can track the metrics across builds.
+void RecordPerfMetric(const std::string& name, double value,
+                      const std::string& unit);
+
+// Records the median, the minimum and the maximum of |samples|, as the
+// metrics |name|_median, |name|_min and |name|_max.
+void RecordPerfSamples(const std::string& name,
+                       const std::vector<double>& samples,
+                       const std::string& unit);
+
+// The milliseconds elapsed since |start|.
+double MillisecondsSince(std::chrono::steady_clock::time_point start);
+
+}  // namespace bttest
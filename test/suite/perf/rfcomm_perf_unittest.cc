@@ -0,0 +1,131 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+
+#include "adapter/bluetooth_test.h"
+#include "btcore/include/bdaddr.h"
+#include "perf/perf_metrics.h"
+
+namespace {
+
+// The Serial Port Profile.
+const bt_uuid_t kSppUuid = {{0x00, 0x00, 0x11, 0x01, 0x00, 0x00, 0x10, 0x00,
+                             0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB}};
+
+const size_t kRfcommBytes = 4 * 1024 * 1024;
+const size_t kRfcommWriteSize = 990;
+
+}  // namespace
+
+namespace bttest {
+
+// The RFCOMM performance tests need a bonded remote device that serves SPP
+// as a sink, since the virtual devices of rootcanal are LE only.
+class RfcommPerfTest : public BluetoothTest {
+ protected:
+  void SetUp() override {
+    BluetoothTest::SetUp();
+
+    ASSERT_EQ(bt_interface()->enable(false), BT_STATUS_SUCCESS);
+    semaphore_wait(adapter_state_changed_callback_sem_);
+    ASSERT_TRUE(GetState() == BT_STATE_ON);
+    socket_interface_ =
+        (const btsock_interface_t*)bt_interface()->get_profile_interface(
+            BT_PROFILE_SOCKETS_ID);
+    ASSERT_NE(socket_interface_, nullptr);
+
+    // Find a bonded device that supports SPP
+    string_to_bdaddr("00:00:00:00:00:00", &bt_remote_bdaddr_);
+    bt_property_t* bonded_devices_prop =
+        GetProperty(BT_PROPERTY_ADAPTER_BONDED_DEVICES);
+    ASSERT_NE(bonded_devices_prop, nullptr);
+    bt_bdaddr_t* devices = (bt_bdaddr_t*)bonded_devices_prop->val;
+    int num_bonded_devices = bonded_devices_prop->len / sizeof(bt_bdaddr_t);
+
+    for (int i = 0;
+         i < num_bonded_devices && bdaddr_is_empty(&bt_remote_bdaddr_); i++) {
+      ClearSemaphore(remote_device_properties_callback_sem_);
+      bt_interface()->get_remote_device_property(&devices[i],
+                                                 BT_PROPERTY_UUIDS);
+      semaphore_wait(remote_device_properties_callback_sem_);
+
+      bt_property_t* uuid_prop =
+          GetRemoteDeviceProperty(&devices[i], BT_PROPERTY_UUIDS);
+      if (uuid_prop == nullptr) continue;
+      bt_uuid_t* uuids = (bt_uuid_t*)uuid_prop->val;
+      int num_uuids = uuid_prop->len / sizeof(bt_uuid_t);
+
+      for (int j = 0; j < num_uuids; j++) {
+        if (!memcmp(uuids + j, &kSppUuid, sizeof(bt_uuid_t))) {
+          bdaddr_copy(&bt_remote_bdaddr_, devices + i);
+          break;
+        }
+      }
+    }
+
+    ASSERT_FALSE(bdaddr_is_empty(&bt_remote_bdaddr_))
+        << "Could not find paired device that supports SPP";
+  }
+
+  void TearDown() override {
+    socket_interface_ = nullptr;
+
+    ASSERT_EQ(bt_interface()->disable(), BT_STATUS_SUCCESS);
+    semaphore_wait(adapter_state_changed_callback_sem_);
+    BluetoothTest::TearDown();
+  }
+
+  const btsock_interface_t* socket_interface_;
+  bt_bdaddr_t bt_remote_bdaddr_;
+};
+
+TEST_F(RfcommPerfTest, RfcommThroughput) {
+  int fd = -1;
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(socket_interface_->connect(&bt_remote_bdaddr_, BTSOCK_RFCOMM,
+                                       (const uint8_t*)&kSppUuid, 0, &fd, 0,
+                                       getuid()),
+            BT_STATUS_SUCCESS);
+  ASSERT_NE(fd, -1);
+
+  // The socket reports the channel, then the connection.
+  int channel;
+  sock_connect_signal_t signal;
+  ASSERT_EQ(read(fd, &channel, sizeof(channel)),
+            static_cast<ssize_t>(sizeof(channel)));
+  ASSERT_EQ(read(fd, &signal, sizeof(signal)),
+            static_cast<ssize_t>(sizeof(signal)));
+  RecordPerfMetric("rfcomm_connection_time", MillisecondsSince(start), "ms");
+
+  std::vector<uint8_t> data(kRfcommWriteSize, 0x55);
+  start = std::chrono::steady_clock::now();
+  size_t written = 0;
+  while (written < kRfcommBytes) {
+    ssize_t length = write(fd, data.data(), data.size());
+    ASSERT_GT(length, 0) << "Error writing to the RFCOMM channel.";
+    written += length;
+  }
+  double seconds = MillisecondsSince(start) / 1000;
+  close(fd);
+
+  RecordPerfMetric("rfcomm_throughput", written / seconds, "B/s");
+}
+
+}  // bttest
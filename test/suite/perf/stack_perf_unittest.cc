@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2017 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "adapter/bluetooth_test.h"
+#include "perf/perf_metrics.h"
+
+namespace {
+
+const int kIterations = 10;
+
+}  // namespace
+
+namespace bttest {
+
+// The stack tests run with any controller.
+class StackPerfTest : public BluetoothTest {};
+
+TEST_F(StackPerfTest, EnableDisableTime) {
+  std::vector<double> enable_times;
+  std::vector<double> disable_times;
+
+  for (int i = 0; i < kIterations; i++) {
+    ClearSemaphore(adapter_state_changed_callback_sem_);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(bt_interface()->enable(false), BT_STATUS_SUCCESS);
+    semaphore_wait(adapter_state_changed_callback_sem_);
+    ASSERT_EQ(GetState(), BT_STATE_ON) << "Adapter did not turn on.";
+    enable_times.push_back(MillisecondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    ASSERT_EQ(bt_interface()->disable(), BT_STATUS_SUCCESS);
+    semaphore_wait(adapter_state_changed_callback_sem_);
+    ASSERT_EQ(GetState(), BT_STATE_OFF) << "Adapter did not turn off.";
+    disable_times.push_back(MillisecondsSince(start));
+  }
+
+  RecordPerfSamples("enable_time", enable_times, "ms");
+  RecordPerfSamples("disable_time", disable_times, "ms");
+}
+
+}  // bttest
@@ -45,6 +45,10 @@ typedef enum {
 #define UIPC_REG_CBACK 2
 #define UIPC_REG_REMOVE_ACTIVE_READSET 3
 #define UIPC_SET_READ_POLL_TMO 4
+/* param: the busy-poll window of the reads, in microseconds (0 for none) */
+#define UIPC_SET_READ_MEDIA_MODE 5
+/* param: uint32_t* set to the number of bytes readable without waiting */
+#define UIPC_REQ_RX_AVAILABLE 6
 
 typedef void(tUIPC_RCV_CBACK)(
     tUIPC_CH_ID ch_id,
@@ -100,6 +104,19 @@ void UIPC_Close(tUIPC_CH_ID ch_id);
 bool UIPC_Send(tUIPC_CH_ID ch_id, uint16_t msg_evt, const uint8_t* p_buf,
                uint16_t msglen);
 
+/*******************************************************************************
+ *
+ * Function         UIPC_SendFd
+ *
+ * Description      Called to transmit a message over UIPC together with the
+ *                  file descriptor |fd|, passed as SCM_RIGHTS ancillary data.
+ *
+ * Returns          true in case of success, false in case of failure.
+ *
+ ******************************************************************************/
+bool UIPC_SendFd(tUIPC_CH_ID ch_id, const uint8_t* p_buf, uint16_t msglen,
+                 int fd);
+
 /*******************************************************************************
  *
  * Function         UIPC_Read
@@ -118,7 +135,15 @@ uint32_t UIPC_Read(tUIPC_CH_ID ch_id, uint16_t* p_msg_evt, uint8_t* p_buf,
  *
  * Description      Called to control UIPC.
  *
- * Returns          void
+ *                  In the media mode set with |UIPC_SET_READ_MEDIA_MODE|,
+ *                  the reads of the channel wait for the whole data asked
+ *                  instead of waking up on each chunk: the receive low
+ *                  watermark of the socket follows the size of the read, and
+ *                  the data is first busy-polled for a short window before
+ *                  blocking. The receive timeout still applies.
+ *
+ * Returns          true if the request returned a result in |param|,
+ *                  otherwise false.
  *
  ******************************************************************************/
 bool UIPC_Ioctl(tUIPC_CH_ID ch_id, uint32_t request, void* param);
@@ -30,12 +30,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/prctl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <mutex>
@@ -46,6 +48,7 @@
 #include "bt_utils.h"
 #include "osi/include/osi.h"
 #include "osi/include/socket_utils/sockets.h"
+#include "osi/include/time.h"
 #include "uipc.h"
 
 /*****************************************************************************
@@ -66,6 +69,10 @@
 
 #define UIPC_FLUSH_BUFFER_SIZE 1024
 
+/* The highest receive low watermark of the media mode: a read larger than
+ * the socket buffer can never be satisfied at once */
+#define UIPC_MEDIA_MAX_LOW_WATERMARK (AUDIO_STREAM_OUTPUT_BUFFER_SZ / 2)
+
 /*****************************************************************************
  *  Local type definitions
  *****************************************************************************/
@@ -78,6 +85,9 @@ typedef struct {
   int srvfd;
   int fd;
   int read_poll_tmo_ms;
+  bool read_media_mode;         /* see UIPC_SET_READ_MEDIA_MODE */
+  uint32_t read_busy_poll_us;   /* media mode busy-poll window */
+  int read_low_watermark;       /* current SO_RCVLOWAT of |fd| */
   int task_evt_flags; /* event flags pending to be processed in read task */
   tUIPC_RCV_CBACK* cback;
 } tUIPC_CHAN;
@@ -281,6 +291,7 @@ static int uipc_check_fd_locked(tUIPC_CH_ID ch_id) {
     }
 
     uipc_main.ch[ch_id].fd = accept_server_socket(uipc_main.ch[ch_id].srvfd);
+    uipc_main.ch[ch_id].read_low_watermark = 1; /* the socket default */
 
     BTIF_TRACE_EVENT("NEW FD %d", uipc_main.ch[ch_id].fd);
 
@@ -351,6 +362,8 @@ static int uipc_setup_server_locked(tUIPC_CH_ID ch_id, const char* name,
   uipc_main.ch[ch_id].srvfd = fd;
   uipc_main.ch[ch_id].cback = cback;
   uipc_main.ch[ch_id].read_poll_tmo_ms = DEFAULT_READ_POLL_TMO_MS;
+  uipc_main.ch[ch_id].read_media_mode = false;
+  uipc_main.ch[ch_id].read_busy_poll_us = 0;
 
   /* trigger main thread to update read set */
   uipc_wakeup_locked();
@@ -639,6 +652,89 @@ bool UIPC_Send(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t msg_evt,
   return false;
 }
 
+/*******************************************************************************
+ **
+ ** Function         UIPC_SendFd
+ **
+ ** Description      Called to transmit a message over UIPC together with a
+ **                  file descriptor.
+ **
+ ** Returns          true in case of success, false in case of failure.
+ **
+ ******************************************************************************/
+bool UIPC_SendFd(tUIPC_CH_ID ch_id, const uint8_t* p_buf, uint16_t msglen,
+                 int fd) {
+  BTIF_TRACE_DEBUG("UIPC_SendFd : ch_id:%d %d bytes fd:%d", ch_id, msglen, fd);
+
+  if (ch_id >= UIPC_CH_NUM) {
+    BTIF_TRACE_ERROR("UIPC_SendFd : invalid ch id %d", ch_id);
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(uipc_main.mutex);
+
+  struct iovec iov;
+  iov.iov_base = const_cast<uint8_t*>(p_buf);
+  iov.iov_len = msglen;
+
+  char cmsg_buf[CMSG_SPACE(sizeof(int))];
+  memset(cmsg_buf, 0, sizeof(cmsg_buf));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsg_buf;
+  msg.msg_controllen = sizeof(cmsg_buf);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = sendmsg(uipc_main.ch[ch_id].fd, &msg, 0));
+  if (ret < 0) {
+    BTIF_TRACE_ERROR("failed to sendmsg (%s)", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+/* Returns the number of bytes readable without waiting on |fd|, or -1 on
+ * error */
+static int uipc_rx_available(int fd) {
+  int available = 0;
+  if (ioctl(fd, FIONREAD, &available) < 0) return -1;
+  return available;
+}
+
+/* Prepares the media mode read of |remaining| bytes from the channel |p_ch|:
+ * sets the receive low watermark to the size of the read, then busy-polls
+ * for the data within the busy-poll window. */
+static void uipc_media_read_prepare(tUIPC_CHAN* p_ch, uint32_t remaining) {
+  int low_watermark = (int)remaining;
+  if (low_watermark > UIPC_MEDIA_MAX_LOW_WATERMARK)
+    low_watermark = UIPC_MEDIA_MAX_LOW_WATERMARK;
+  if (low_watermark != p_ch->read_low_watermark) {
+    if (setsockopt(p_ch->fd, SOL_SOCKET, SO_RCVLOWAT, &low_watermark,
+                   sizeof(low_watermark)) < 0) {
+      BTIF_TRACE_WARNING("%s: setsockopt SO_RCVLOWAT %d failed (%s)",
+                         __func__, low_watermark, strerror(errno));
+    }
+    p_ch->read_low_watermark = low_watermark;
+  }
+
+  if (p_ch->read_busy_poll_us == 0) return;
+  uint64_t deadline_us = time_get_os_boottime_us() + p_ch->read_busy_poll_us;
+  do {
+    int available = uipc_rx_available(p_ch->fd);
+    if (available < 0 || available >= low_watermark) return;
+  } while (time_get_os_boottime_us() < deadline_us);
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Read
@@ -665,7 +761,10 @@ uint32_t UIPC_Read(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t* p_msg_evt,
     return 0;
   }
 
+  tUIPC_CHAN* p_ch = &uipc_main.ch[ch_id];
   while (n_read < (int)len) {
+    if (p_ch->read_media_mode) uipc_media_read_prepare(p_ch, len - n_read);
+
     pfd.fd = fd;
     pfd.events = POLLIN | POLLHUP;
 
@@ -694,8 +793,11 @@ uint32_t UIPC_Read(tUIPC_CH_ID ch_id, UNUSED_ATTR uint16_t* p_msg_evt,
       return 0;
     }
 
+    /* in the media mode the low watermark must not block the read beyond
+       the poll timeout */
     ssize_t n;
-    OSI_NO_INTR(n = recv(fd, p_buf + n_read, len - n_read, 0));
+    OSI_NO_INTR(n = recv(fd, p_buf + n_read, len - n_read,
+                         p_ch->read_media_mode ? MSG_DONTWAIT : 0));
 
     // BTIF_TRACE_EVENT("read %d bytes", n);
 
@@ -760,6 +862,21 @@ extern bool UIPC_Ioctl(tUIPC_CH_ID ch_id, uint32_t request, void* param) {
                        uipc_main.ch[ch_id].read_poll_tmo_ms);
       break;
 
+    case UIPC_SET_READ_MEDIA_MODE:
+      uipc_main.ch[ch_id].read_media_mode = true;
+      uipc_main.ch[ch_id].read_busy_poll_us = (intptr_t)param;
+      BTIF_TRACE_EVENT("UIPC_SET_READ_MEDIA_MODE : CH %d, busy-poll %u us",
+                       ch_id, uipc_main.ch[ch_id].read_busy_poll_us);
+      break;
+
+    case UIPC_REQ_RX_AVAILABLE: {
+      if (uipc_main.ch[ch_id].fd == UIPC_DISCONNECTED) return false;
+      int available = uipc_rx_available(uipc_main.ch[ch_id].fd);
+      if (available < 0) return false;
+      *(uint32_t*)param = (uint32_t)available;
+      return true;
+    }
+
     default:
       BTIF_TRACE_EVENT("UIPC_Ioctl : request not handled (%d)", request);
       break;
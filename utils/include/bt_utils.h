@@ -28,6 +28,9 @@ static const char BT_UTILS_MODULE[] = "bt_utils_module";
 typedef enum {
   TASK_HIGH_MEDIA = 0,
   TASK_UIPC_READ,
+  TASK_HIGH_MEDIA_ENCODER,
+  TASK_HIGH_MEDIA_DECODER,
+  TASK_HIGH_MEDIA_TRACK,
   TASK_HIGH_MAX
 } tHIGH_PRIORITY_TASK;
 
@@ -47,6 +47,7 @@
 #include "osi/include/compat.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
+#include "osi/include/thread_policy.h"
 
 /*******************************************************************************
  *  Type definitions for callback functions
@@ -140,8 +141,8 @@ void raise_priority_a2dp(tHIGH_PRIORITY_TASK high_task) {
   }
 
   // make A2DP threads use RT scheduling policy since they are part of the
-  // audio pipeline
-  {
+  // audio pipeline, unless they have a scheduling policy configured
+  if (!thread_policy_sets_scheduling(tid)) {
     struct sched_param rt_params;
     rt_params.sched_priority = A2DP_RT_PRIORITY;
 
@@ -20,6 +20,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "async_manager.h"
@@ -28,7 +29,9 @@
 #include "bt_address.h"
 #include "command_packet.h"
 #include "event_packet.h"
+#include "le_link.h"
 #include "test_channel_transport.h"
+#include "virtual_device.h"
 
 namespace test_vendor_lib {
 
@@ -190,6 +193,15 @@ class DualModeController {
   void RegisterEventChannel(
       const std::function<void(std::unique_ptr<EventPacket>)>& send_event);
 
+  // Sets the callback to be used for sending ACL data packets, including their
+  // header, back to the HCI.
+  void RegisterAclChannel(
+      const std::function<void(const std::vector<uint8_t>&)>& send_acl);
+
+  // Handles an ACL data packet from the HCI, including its header, on the
+  // link to a virtual device.
+  void HandleAcl(const std::vector<uint8_t>& packet);
+
   // Controller commands. For error codes, see the Bluetooth Core Specification,
   // Version 4.2, Volume 2, Part D (page 370).
 
@@ -198,6 +210,16 @@ class DualModeController {
   // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.3.2
   void HciReset(const std::vector<uint8_t>& args);
 
+  // OGF: 0x0001
+  // OCF: 0x0006
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.1.6
+  void HciDisconnect(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0001
+  // OCF: 0x001D
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.1.23
+  void HciReadRemoteVersionInformation(const std::vector<uint8_t>& args);
+
   // OGF: 0x0004
   // OGF: 0x0005
   // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.4.5
@@ -382,11 +404,46 @@ class DualModeController {
   // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.11
   void HciLeSetScanEnable(const std::vector<uint8_t>& args);
 
+  // OGF: 0x0008
+  // OCF: 0x000D
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.12
+  void HciLeCreateConnection(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0008
+  // OCF: 0x000E
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.13
+  void HciLeCreateConnectionCancel(const std::vector<uint8_t>& args);
+
   // OGF: 0x0008
   // OCF: 0x000F
   // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.14
   void HciLeReadWhiteListSize(const std::vector<uint8_t>& args);
 
+  // OGF: 0x0008
+  // OCF: 0x0010
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.15
+  void HciLeClearWhiteList(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0008
+  // OCF: 0x0011
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.16
+  void HciLeAddDeviceToWhiteList(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0008
+  // OCF: 0x0012
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.17
+  void HciLeRemoveDeviceFromWhiteList(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0008
+  // OCF: 0x0013
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.18
+  void HciLeConnectionUpdate(const std::vector<uint8_t>& args);
+
+  // OGF: 0x0008
+  // OCF: 0x0016
+  // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.21
+  void HciLeReadRemoteFeatures(const std::vector<uint8_t>& args);
+
   // OGF: 0x0008
   // OCF: 0x0018
   // Bluetooth Core Specification Version 4.2 Volume 2 Part E 7.8.23
@@ -438,6 +495,10 @@ class DualModeController {
   // Discovers a fake device.
   void TestChannelDiscover(const std::vector<std::string>& args);
 
+  // Replaces the virtual devices with the ones of the scenario file args[0],
+  // and disconnects the links to the previous ones.
+  void TestChannelLoadScenario(const std::vector<std::string>& args);
+
   // Causes events to be sent after a delay.
   void TestChannelSetEventDelay(const std::vector<std::string>& args);
 
@@ -485,6 +546,26 @@ class DualModeController {
   // Sends a command status event with default event parameters.
   void SendCommandStatusSuccess(uint16_t command_opcode) const;
 
+  // Sends the LE Advertising Reports of the virtual devices that advertised
+  // since the last tick.
+  void LeScan(std::chrono::steady_clock::time_point now);
+
+  // Completes the pending LE Create Connection with the first virtual device
+  // that matches it, if any.
+  void LeConnect(std::chrono::steady_clock::time_point now);
+
+  // Moves the data on |link|, and sends the resulting completed packets and
+  // ACL data packets back to the HCI.
+  void ServiceLink(LeLink* link, std::chrono::steady_clock::time_point now);
+
+  // Removes the link |handle| and sends its Disconnection Complete event.
+  void Disconnect(uint16_t handle, uint8_t reason);
+
+  // Returns an unused connection handle.
+  uint16_t AllocateHandle();
+
+  bool IsInLeWhiteList(uint8_t address_type, const BtAddress& address) const;
+
   void SetEventDelay(int64_t delay);
 
   // Callbacks to schedule tasks.
@@ -499,6 +580,9 @@ class DualModeController {
   // Callback provided to send events from the controller back to the HCI.
   std::function<void(std::unique_ptr<EventPacket>)> send_event_;
 
+  // Callback provided to send ACL data from the controller back to the HCI.
+  std::function<void(const std::vector<uint8_t>&)> send_acl_;
+
   // Maintains the commands to be registered and used in the HciHandler object.
   // Keys are command opcodes and values are the callbacks to handle each
   // command.
@@ -527,8 +611,29 @@ class DualModeController {
   uint8_t own_address_type_;
   uint8_t scanning_filter_policy_;
 
-  uint8_t le_scan_enable_;
-  uint8_t filter_duplicates_;
+  uint8_t le_scan_enable_ = 0;
+  uint8_t filter_duplicates_ = 0;
+
+  // The virtual devices of the loaded scenario, and whether each one was
+  // reported since the scan started, to filter the duplicates.
+  std::vector<std::unique_ptr<VirtualDevice>> devices_;
+  std::vector<bool> le_scan_reported_;
+
+  // The white list entries, as address types and addresses.
+  std::vector<std::pair<uint8_t, BtAddress>> le_white_list_;
+
+  // The parameters of the pending LE Create Connection command.
+  bool le_connect_pending_ = false;
+  uint8_t le_connect_filter_policy_;
+  uint8_t le_connect_peer_address_type_;
+  BtAddress le_connect_peer_address_;
+  uint16_t le_connect_interval_;
+  uint16_t le_connect_latency_;
+  uint16_t le_connect_supervision_timeout_;
+
+  // The LE links to the virtual devices, by connection handle.
+  std::unordered_map<uint16_t, std::unique_ptr<LeLink>> le_links_;
+  uint16_t next_handle_ = 1;
 
   State state_;
 
@@ -537,7 +642,7 @@ class DualModeController {
   TestChannelState test_channel_state_;
 
   std::vector<AsyncTaskId> controller_events_;
-  AsyncTaskId timer_tick_task_;
+  AsyncTaskId timer_tick_task_ = kInvalidTaskId;
   std::chrono::milliseconds timer_period_ = std::chrono::milliseconds(1000);
 
   DualModeController(const DualModeController& cmdPckt) = delete;
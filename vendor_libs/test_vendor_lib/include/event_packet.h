@@ -119,6 +119,46 @@ class EventPacket : public Packet {
       uint32_t class_of_device, uint16_t clock_offset, uint8_t rssi,
       const std::vector<uint8_t>& extended_inquiry_response);
 
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.5
+  static std::unique_ptr<EventPacket> CreateDisconnectionCompleteEvent(
+      uint8_t status, uint16_t handle, uint8_t reason);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.12
+  static std::unique_ptr<EventPacket>
+  CreateReadRemoteVersionInformationCompleteEvent(uint8_t status,
+                                                  uint16_t handle,
+                                                  uint8_t version,
+                                                  uint16_t manufacturer_name,
+                                                  uint16_t subversion);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.19
+  static std::unique_ptr<EventPacket> CreateNumberOfCompletedPacketsEvent(
+      uint16_t handle, uint16_t num_completed_packets);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, 7.7.65.1
+  static std::unique_ptr<EventPacket> CreateLeConnectionCompleteEvent(
+      uint8_t status, uint16_t handle, uint8_t role, uint8_t peer_address_type,
+      const BtAddress& peer, uint16_t interval, uint16_t latency,
+      uint16_t supervision_timeout);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, 7.7.65.2
+  static std::unique_ptr<EventPacket> CreateLeAdvertisingReportEvent();
+
+  // Adds a report to an LE Advertising Report event. Returns false, leaving
+  // the event unchanged, if the report doesn't fit in the event.
+  bool AddLeAdvertisingReport(uint8_t event_type, uint8_t address_type,
+                              const BtAddress& address,
+                              const std::vector<uint8_t>& data, uint8_t rssi);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, 7.7.65.3
+  static std::unique_ptr<EventPacket> CreateLeConnectionUpdateCompleteEvent(
+      uint8_t status, uint16_t handle, uint16_t interval, uint16_t latency,
+      uint16_t supervision_timeout);
+
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, 7.7.65.4
+  static std::unique_ptr<EventPacket> CreateLeRemoteUsedFeaturesEvent(
+      uint8_t status, uint16_t handle, uint64_t features);
+
   // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.8.2
   static std::unique_ptr<EventPacket> CreateCommandCompleteLeReadBufferSize(
       uint8_t status, uint16_t hc_le_data_packet_length,
@@ -150,6 +190,9 @@ class EventPacket : public Packet {
   // Size of a data packet header, which consists of a 1 octet event code
   static const size_t kEventHeaderSize = 1;
 
+  // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 5.4.4
+  static const size_t kMaxEventParameterOctets = 255;
+
  private:
   explicit EventPacket(uint8_t event_code);
   EventPacket(uint8_t event_code, const std::vector<uint8_t>& payload);
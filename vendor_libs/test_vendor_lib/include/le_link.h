@@ -0,0 +1,123 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "virtual_device.h"
+
+namespace test_vendor_lib {
+
+// An LE ACL link between the host and a virtual device. The link moves the
+// ACL data packets of both directions within the throughput limit of the
+// device, reassembles the L2CAP frames of the host, and routes the ATT channel
+// to the GATT server of the device. The device accepts the LE credit based
+// connections of the host on any PSM; these and the other channels are
+// traffic sinks.
+class LeLink {
+ public:
+  // The L2CAP channel of ATT, Bluetooth Core Specification Version 4.2,
+  // Volume 3, Part A, Section 2.1.
+  static const uint16_t kAttCid = 0x0004;
+  static const uint16_t kLeSignalingCid = 0x0005;
+
+  // The credits granted to the host on each LE credit based connection, and
+  // the credits consumed before more are granted.
+  static const uint16_t kCocCredits = 64;
+  static const uint16_t kCocCreditBatch = 32;
+
+  // The packets to the host queued beyond this number are dropped, so that a
+  // throttled link doesn't grow without bounds.
+  static const size_t kMaxQueuedPackets = 256;
+
+  LeLink(uint16_t handle, VirtualDevice* device,
+         uint16_t le_data_packet_length,
+         std::chrono::steady_clock::time_point now);
+  ~LeLink() = default;
+
+  uint16_t GetHandle() const { return handle_; }
+  VirtualDevice* GetDevice() const { return device_; }
+
+  // Queues the ACL data packet |packet| from the host, including its header.
+  void ReceiveFromHost(const std::vector<uint8_t>& packet);
+
+  // Moves the data queued on the link as far as the throughput limit allows
+  // at |now|: the packets of the host are handed to the device, and the
+  // responses and notifications of the device are appended to |to_host| as
+  // ACL data packets. Returns the number of packets of the host completed.
+  size_t Service(std::chrono::steady_clock::time_point now,
+                 std::vector<std::vector<uint8_t>>* to_host);
+
+  uint64_t GetBytesFromHost() const { return bytes_from_host_; }
+  uint64_t GetBytesToHost() const { return bytes_to_host_; }
+  uint64_t GetDroppedPackets() const { return dropped_packets_; }
+
+ private:
+  // Refills the byte budget of the link for the time elapsed until |now|.
+  void Refill(std::chrono::steady_clock::time_point now);
+
+  // Consumes |bytes| from the budget. Returns false if the budget is short.
+  bool Consume(size_t bytes);
+
+  // Handles the reassembled L2CAP frame in |rx_frame_|.
+  void HandleFrame();
+
+  // Handles the LE signaling command |command| of the host.
+  void HandleSignaling(const std::vector<uint8_t>& command);
+
+  // Counts a K-frame of the host on the LE credit based connection |cid|,
+  // and grants more credits when enough were consumed.
+  void ConsumeCocCredit(uint16_t cid);
+
+  // Fragments |pdu| into ACL data packets on |cid|, queued to the host.
+  void SendToHost(uint16_t cid, const std::vector<uint8_t>& pdu);
+
+  uint16_t handle_;
+  VirtualDevice* device_;
+  uint16_t le_data_packet_length_;
+
+  uint32_t bytes_per_second_;
+  double budget_;
+  double max_budget_;
+  std::chrono::steady_clock::time_point last_refill_;
+
+  std::deque<std::vector<uint8_t>> from_host_;
+  std::deque<std::vector<uint8_t>> to_host_;
+  std::vector<uint8_t> rx_frame_;
+
+  // The LE credit based connections, by local CID.
+  struct CocChannel {
+    uint16_t remote_cid;
+    uint16_t consumed_credits;
+  };
+  std::map<uint16_t, CocChannel> coc_channels_;
+  uint16_t next_coc_cid_ = 0x0040;
+  uint8_t next_signaling_id_ = 1;
+
+  uint64_t bytes_from_host_ = 0;
+  uint64_t bytes_to_host_ = 0;
+  uint64_t dropped_packets_ = 0;
+
+  LeLink(const LeLink&) = delete;
+  LeLink& operator=(const LeLink&) = delete;
+};
+
+}  // namespace test_vendor_lib
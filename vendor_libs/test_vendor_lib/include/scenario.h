@@ -0,0 +1,76 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "virtual_device.h"
+
+namespace base {
+class DictionaryValue;
+}  // namespace base
+
+namespace test_vendor_lib {
+
+// The virtual devices around the controller for a load test, read from a JSON
+// file. See data/load_test_scenario.json for an example. Each entry of
+// "Devices" describes "Count" devices, whose addresses count up from
+// "Address":
+//
+//   "Address", "AddressType" ("Public" or "Random"), "Count",
+//   "AdvertisingIntervalMs" (0 for no advertising), "AdvertisingData",
+//   "ScanResponseData" (hexadecimal strings), "Connectable", "Rssi",
+//   "LinkBytesPerSecond" (0 for no limit) and "Services".
+//
+// Each service has a "Uuid" and "Characteristics", each with a "Uuid",
+// "Properties" (a list of "Read", "WriteWithoutResponse", "Write", "Notify"
+// and "Indicate"), a "Value" and a "NotifyPeriodMs".
+class Scenario {
+ public:
+  Scenario() = default;
+  ~Scenario() = default;
+
+  // Parses the scenario |json|. Returns false if it is ill-formed.
+  bool Parse(const std::string& json);
+
+  // Reads and parses the scenario file |file_name|.
+  bool Load(const std::string& file_name);
+
+  // The period at which the controller runs the devices and their links.
+  std::chrono::milliseconds GetTickPeriod() const { return tick_period_; }
+
+  // Hands the devices of the scenario over to the caller.
+  std::vector<std::unique_ptr<VirtualDevice>> TakeDevices() {
+    return std::move(devices_);
+  }
+
+ private:
+  bool ParseDevices(const base::DictionaryValue& dictionary);
+  bool ParseService(const base::DictionaryValue& dictionary,
+                    GattService* service);
+
+  std::chrono::milliseconds tick_period_ = std::chrono::milliseconds(10);
+  std::vector<std::unique_ptr<VirtualDevice>> devices_;
+
+  Scenario(const Scenario&) = delete;
+  Scenario& operator=(const Scenario&) = delete;
+};
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,191 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "bt_address.h"
+
+namespace test_vendor_lib {
+
+// A characteristic of the GATT database of a virtual device. UUIDs are stored
+// in little-endian order, and are either 2 or 16 octets long.
+struct GattCharacteristic {
+  // Bluetooth Core Specification Version 4.2, Volume 3, Part G, Section 3.3.1.1
+  static const uint8_t kRead = 0x02;
+  static const uint8_t kWriteWithoutResponse = 0x04;
+  static const uint8_t kWrite = 0x08;
+  static const uint8_t kNotify = 0x10;
+  static const uint8_t kIndicate = 0x20;
+
+  std::vector<uint8_t> uuid;
+  uint8_t properties = kRead;
+  std::vector<uint8_t> value;
+
+  // When non-zero, the device notifies |value| at this period once the host
+  // enabled the notifications, as a traffic source.
+  std::chrono::milliseconds notify_period = std::chrono::milliseconds(0);
+};
+
+struct GattService {
+  std::vector<uint8_t> uuid;
+  std::vector<GattCharacteristic> characteristics;
+};
+
+// A remote LE device emulated by the controller: it advertises at a set rate,
+// accepts connections from the host and serves its GATT database over ATT.
+// The controller drives the device with explicit times so that the devices
+// stay deterministic in the unit tests.
+class VirtualDevice {
+ public:
+  // The address types of the LE Advertising Report event.
+  static const uint8_t kPublicAddress = 0x00;
+  static const uint8_t kRandomAddress = 0x01;
+
+  VirtualDevice(const BtAddress& address, uint8_t address_type);
+  ~VirtualDevice() = default;
+
+  const BtAddress& GetAddress() const { return address_; }
+  uint8_t GetAddressType() const { return address_type_; }
+
+  // Advertising
+
+  // Advertises every |interval|, or stops advertising if |interval| is zero.
+  void SetAdvertising(std::chrono::milliseconds interval,
+                      const std::vector<uint8_t>& advertising_data,
+                      const std::vector<uint8_t>& scan_response_data,
+                      bool connectable);
+
+  // Returns the number of advertising events since the last call, and
+  // restarts the count at |now|. The first call only starts the count.
+  size_t TakeAdvertisingEvents(std::chrono::steady_clock::time_point now);
+
+  // Forgets the advertising events since the last call, e.g. when the host
+  // starts scanning.
+  void ResetAdvertisingEvents() { advertising_started_ = false; }
+
+  bool IsAdvertising() const { return advertising_interval_.count() != 0; }
+  bool IsConnectable() const { return connectable_; }
+  const std::vector<uint8_t>& GetAdvertisingData() const {
+    return advertising_data_;
+  }
+  const std::vector<uint8_t>& GetScanResponseData() const {
+    return scan_response_data_;
+  }
+
+  int8_t GetRssi() const { return rssi_; }
+  void SetRssi(int8_t rssi) { rssi_ = rssi; }
+
+  // Connection
+
+  // The combined throughput of the two directions of the link to the device,
+  // in bytes of ACL payload per second. Zero means unlimited.
+  uint32_t GetLinkBytesPerSecond() const { return link_bytes_per_second_; }
+  void SetLinkBytesPerSecond(uint32_t bytes) { link_bytes_per_second_ = bytes; }
+
+  bool IsConnected() const { return connected_; }
+  void Connect();
+
+  // Resets the ATT MTU and the client characteristic configurations, as the
+  // bonding state is not emulated.
+  void Disconnect();
+
+  // GATT
+
+  // Appends |service| to the attribute table.
+  void AddService(const GattService& service);
+
+  // Handles the ATT PDU |request| from the host, and returns the response PDU,
+  // or an empty vector for the commands that have no response.
+  std::vector<uint8_t> HandleAttPdu(const std::vector<uint8_t>& request);
+
+  // Appends the Handle Value Notification PDUs due at |now| to |pdus|.
+  void TakeNotifications(std::chrono::steady_clock::time_point now,
+                         std::vector<std::vector<uint8_t>>* pdus);
+
+  // Sink statistics: the L2CAP payload received on the other channels.
+  void CountSinkBytes(size_t bytes) { sink_bytes_ += bytes; }
+  uint64_t GetSinkBytes() const { return sink_bytes_; }
+
+  uint16_t GetAttMtu() const { return att_mtu_; }
+
+ private:
+  // Bluetooth Core Specification Version 4.2, Volume 3, Part F, Section 3.2
+  struct Attribute {
+    uint16_t handle;
+    std::vector<uint8_t> type;
+    std::vector<uint8_t> value;
+    // The last handle of the service, for the service declarations.
+    uint16_t group_end_handle;
+    bool writable;
+    // The index in |notifiers_| that this configuration descriptor enables, or
+    // -1 for the other attributes.
+    int notifier;
+  };
+
+  struct Notifier {
+    uint16_t value_handle;
+    std::chrono::milliseconds period;
+    bool enabled;
+    std::chrono::steady_clock::time_point next;
+  };
+
+  uint16_t AddAttribute(const std::vector<uint8_t>& type,
+                        const std::vector<uint8_t>& value, bool writable);
+  Attribute* FindAttribute(uint16_t handle);
+
+  std::vector<uint8_t> HandleExchangeMtu(const std::vector<uint8_t>& request);
+  std::vector<uint8_t> HandleFindInformation(
+      const std::vector<uint8_t>& request);
+  std::vector<uint8_t> HandleFindByTypeValue(
+      const std::vector<uint8_t>& request);
+  std::vector<uint8_t> HandleReadByType(const std::vector<uint8_t>& request,
+                                        uint8_t response_opcode);
+  std::vector<uint8_t> HandleRead(const std::vector<uint8_t>& request);
+  std::vector<uint8_t> HandleWrite(const std::vector<uint8_t>& request);
+
+  BtAddress address_;
+  uint8_t address_type_;
+  int8_t rssi_ = -60;
+
+  std::chrono::milliseconds advertising_interval_ =
+      std::chrono::milliseconds(0);
+  std::vector<uint8_t> advertising_data_;
+  std::vector<uint8_t> scan_response_data_;
+  bool connectable_ = false;
+  bool advertising_started_ = false;
+  std::chrono::steady_clock::time_point last_advertising_event_;
+
+  uint32_t link_bytes_per_second_ = 0;
+  bool connected_ = false;
+
+  std::vector<Attribute> attributes_;
+  // The index in |attributes_| of the last service declaration, to update its
+  // group end handle.
+  int last_service_ = -1;
+  std::vector<Notifier> notifiers_;
+  uint16_t att_mtu_;
+
+  uint64_t sink_bytes_ = 0;
+
+  VirtualDevice(const VirtualDevice&) = delete;
+  VirtualDevice& operator=(const VirtualDevice&) = delete;
+};
+
+}  // namespace test_vendor_lib
@@ -198,6 +198,14 @@ class TestChannelShell(cmd.Cmd):
       device_names_and_addresses.append(device.get_address())
     self._test_channel.send_command('DISCOVER', device_names_and_addresses)
 
+  def do_load_scenario(self, args):
+    """
+    Arguments: scenario_file
+    Replaces the virtual LE devices around the controller with the ones of the
+    JSON scenario file, read on the device. See data/load_test_scenario.json.
+    """
+    self._test_channel.send_command('LOAD_SCENARIO', args.split())
+
   def do_set_event_delay(self, args):
     """
     Arguments: interval_in_ms
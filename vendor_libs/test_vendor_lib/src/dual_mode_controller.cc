@@ -18,6 +18,7 @@
 
 #include "dual_mode_controller.h"
 
+#include <cinttypes>
 #include <memory>
 
 #include <base/logging.h>
@@ -25,6 +26,7 @@
 #include "base/json/json_reader.h"
 #include "base/values.h"
 #include "event_packet.h"
+#include "scenario.h"
 
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
@@ -52,6 +54,25 @@ const uint8_t kExtendedOrRssiInquiry = 0x02;
 // The bd address of another (fake) device.
 const vector<uint8_t> kOtherDeviceBdAddress = {6, 5, 4, 3, 2, 1};
 
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.65.2
+const uint8_t kAdvInd = 0x00;
+const uint8_t kAdvScanInd = 0x02;
+const uint8_t kAdvNonconnInd = 0x03;
+const uint8_t kScanRsp = 0x04;
+
+const uint8_t kLeActiveScan = 0x01;
+const uint8_t kLeWhiteListFilterPolicy = 0x01;
+const uint8_t kLeMasterRole = 0x00;
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 5.4.2
+const size_t kAclHeaderSize = 4;
+const uint16_t kAclHandleMask = 0x0fff;
+const uint16_t kMaxConnectionHandle = 0x0eff;
+
+uint16_t GetUint16(const vector<uint8_t>& args, size_t offset) {
+  return args[offset] | (args[offset + 1] << 8);
+}
+
 void LogCommand(const char* command) {
   LOG_INFO(LOG_TAG, "Controller performing command: %s", command);
 }
@@ -108,6 +129,8 @@ DualModeController::DualModeController()
     method(param);                                                      \
   };
   SET_HANDLER(HCI_RESET, HciReset);
+  SET_HANDLER(HCI_DISCONNECT, HciDisconnect);
+  SET_HANDLER(HCI_READ_RMT_VERSION_INFO, HciReadRemoteVersionInformation);
   SET_HANDLER(HCI_READ_BUFFER_SIZE, HciReadBufferSize);
   SET_HANDLER(HCI_HOST_BUFFER_SIZE, HciHostBufferSize);
   SET_HANDLER(HCI_READ_LOCAL_VERSION_INFO, HciReadLocalVersionInformation);
@@ -144,7 +167,14 @@ DualModeController::DualModeController()
   SET_HANDLER(HCI_BLE_WRITE_ADV_PARAMS, HciLeSetAdvertisingParameters);
   SET_HANDLER(HCI_BLE_WRITE_SCAN_PARAMS, HciLeSetScanParameters);
   SET_HANDLER(HCI_BLE_WRITE_SCAN_ENABLE, HciLeSetScanEnable);
+  SET_HANDLER(HCI_BLE_CREATE_LL_CONN, HciLeCreateConnection);
+  SET_HANDLER(HCI_BLE_CREATE_CONN_CANCEL, HciLeCreateConnectionCancel);
   SET_HANDLER(HCI_BLE_READ_WHITE_LIST_SIZE, HciLeReadWhiteListSize);
+  SET_HANDLER(HCI_BLE_CLEAR_WHITE_LIST, HciLeClearWhiteList);
+  SET_HANDLER(HCI_BLE_ADD_WHITE_LIST, HciLeAddDeviceToWhiteList);
+  SET_HANDLER(HCI_BLE_REMOVE_WHITE_LIST, HciLeRemoveDeviceFromWhiteList);
+  SET_HANDLER(HCI_BLE_UPD_LL_CONN_PARAMS, HciLeConnectionUpdate);
+  SET_HANDLER(HCI_BLE_READ_REMOTE_FEAT, HciLeReadRemoteFeatures);
   SET_HANDLER(HCI_BLE_RAND, HciLeRand);
   SET_HANDLER(HCI_BLE_READ_SUPPORTED_STATES, HciLeReadSupportedStates);
   SET_HANDLER((HCI_GRP_VENDOR_SPECIFIC | 0x27), HciBleVendorSleepMode);
@@ -162,6 +192,7 @@ DualModeController::DualModeController()
   SET_TEST_HANDLER("CLEAR", TestChannelClear);
   SET_TEST_HANDLER("CLEAR_EVENT_DELAY", TestChannelClearEventDelay);
   SET_TEST_HANDLER("DISCOVER", TestChannelDiscover);
+  SET_TEST_HANDLER("LOAD_SCENARIO", TestChannelLoadScenario);
   SET_TEST_HANDLER("SET_EVENT_DELAY", TestChannelSetEventDelay);
   SET_TEST_HANDLER("TIMEOUT_ALL", TestChannelTimeoutAll);
 #undef SET_TEST_HANDLER
@@ -211,10 +242,163 @@ void DualModeController::RegisterEventChannel(
   send_event_ = callback;
 }
 
+void DualModeController::RegisterAclChannel(
+    const std::function<void(const vector<uint8_t>&)>& callback) {
+  send_acl_ = callback;
+}
+
+void DualModeController::HandleAcl(const vector<uint8_t>& packet) {
+  if (packet.size() < kAclHeaderSize ||
+      GetUint16(packet, 2) != packet.size() - kAclHeaderSize) {
+    LOG_ERROR(LOG_TAG, "Dropping a malformed ACL data packet.");
+    return;
+  }
+
+  uint16_t handle = GetUint16(packet, 0) & kAclHandleMask;
+  auto link = le_links_.find(handle);
+  if (link == le_links_.end()) {
+    LOG_INFO(LOG_TAG, "Dropping ACL data for unknown handle 0x%04x.", handle);
+    return;
+  }
+
+  link->second->ReceiveFromHost(packet);
+  ServiceLink(link->second.get(), std::chrono::steady_clock::now());
+}
+
 void DualModeController::HandleTimerTick() {
   // PageScan();
-  if (le_scan_enable_) LOG_ERROR(LOG_TAG, "LE scan");
-  // LeScan();
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (le_scan_enable_) LeScan(now);
+  if (le_connect_pending_) LeConnect(now);
+  for (auto& link : le_links_) ServiceLink(link.second.get(), now);
+}
+
+void DualModeController::LeScan(std::chrono::steady_clock::time_point now) {
+  std::unique_ptr<EventPacket> event;
+  size_t num_reports = 0;
+  auto add_report = [this, &event, &num_reports](uint8_t event_type,
+                                                 const VirtualDevice& device,
+                                                 const vector<uint8_t>& data) {
+    if (event == nullptr) event = EventPacket::CreateLeAdvertisingReportEvent();
+    if (!event->AddLeAdvertisingReport(event_type, device.GetAddressType(),
+                                       device.GetAddress(), data,
+                                       device.GetRssi())) {
+      send_event_(std::move(event));
+      event = EventPacket::CreateLeAdvertisingReportEvent();
+      CHECK(event->AddLeAdvertisingReport(event_type, device.GetAddressType(),
+                                          device.GetAddress(), data,
+                                          device.GetRssi()));
+      num_reports = 0;
+    }
+    num_reports++;
+  };
+
+  // The reports of all the devices are packed in as few events as possible.
+  for (size_t i = 0; i < devices_.size(); i++) {
+    VirtualDevice& device = *devices_[i];
+    if (device.IsConnected()) continue;
+
+    size_t events = device.TakeAdvertisingEvents(now);
+    if (events == 0) continue;
+    if (filter_duplicates_) {
+      if (le_scan_reported_[i]) continue;
+      le_scan_reported_[i] = true;
+      events = 1;
+    }
+
+    uint8_t event_type = kAdvInd;
+    if (!device.IsConnectable())
+      event_type =
+          device.GetScanResponseData().empty() ? kAdvNonconnInd : kAdvScanInd;
+    bool scan_response = le_scan_type_ == kLeActiveScan &&
+                         event_type != kAdvNonconnInd &&
+                         !device.GetScanResponseData().empty();
+
+    for (size_t e = 0; e < events; e++) {
+      add_report(event_type, device, device.GetAdvertisingData());
+      if (scan_response)
+        add_report(kScanRsp, device, device.GetScanResponseData());
+    }
+  }
+
+  if (num_reports > 0) send_event_(std::move(event));
+}
+
+bool DualModeController::IsInLeWhiteList(uint8_t address_type,
+                                         const BtAddress& address) const {
+  for (const auto& entry : le_white_list_) {
+    BtAddress entry_address;
+    entry_address = entry.second;
+    if (entry.first == address_type && entry_address == address) return true;
+  }
+  return false;
+}
+
+void DualModeController::LeConnect(std::chrono::steady_clock::time_point now) {
+  for (auto& device : devices_) {
+    if (device->IsConnected() || !device->IsAdvertising() ||
+        !device->IsConnectable())
+      continue;
+
+    if (le_connect_filter_policy_ == kLeWhiteListFilterPolicy) {
+      if (!IsInLeWhiteList(device->GetAddressType(), device->GetAddress()))
+        continue;
+    } else {
+      if (device->GetAddressType() != le_connect_peer_address_type_ ||
+          le_connect_peer_address_ != device->GetAddress())
+        continue;
+    }
+
+    uint16_t handle = AllocateHandle();
+    le_connect_pending_ = false;
+    device->Connect();
+    le_links_[handle] = std::unique_ptr<LeLink>(new LeLink(
+        handle, device.get(), properties_.GetLeDataPacketLength(), now));
+    LOG_INFO(LOG_TAG, "LE link 0x%04x to %s connected.", handle,
+             device->GetAddress().ToString().c_str());
+    send_event_(EventPacket::CreateLeConnectionCompleteEvent(
+        kSuccessStatus, handle, kLeMasterRole, device->GetAddressType(),
+        device->GetAddress(), le_connect_interval_, le_connect_latency_,
+        le_connect_supervision_timeout_));
+    return;
+  }
+}
+
+void DualModeController::ServiceLink(
+    LeLink* link, std::chrono::steady_clock::time_point now) {
+  vector<vector<uint8_t>> to_host;
+  size_t completed = link->Service(now, &to_host);
+  if (completed > 0)
+    send_event_(EventPacket::CreateNumberOfCompletedPacketsEvent(
+        link->GetHandle(), completed));
+  if (!send_acl_) return;
+  for (const auto& packet : to_host) send_acl_(packet);
+}
+
+void DualModeController::Disconnect(uint16_t handle, uint8_t reason) {
+  auto link = le_links_.find(handle);
+  CHECK(link != le_links_.end());
+
+  LeLink* le_link = link->second.get();
+  LOG_INFO(LOG_TAG,
+           "LE link 0x%04x disconnected: %" PRIu64 " bytes from the host, "
+           "%" PRIu64 " bytes to the host, %" PRIu64 " packets dropped.",
+           handle, le_link->GetBytesFromHost(), le_link->GetBytesToHost(),
+           le_link->GetDroppedPackets());
+  le_link->GetDevice()->Disconnect();
+  le_links_.erase(link);
+
+  send_event_(EventPacket::CreateDisconnectionCompleteEvent(kSuccessStatus,
+                                                            handle, reason));
+}
+
+uint16_t DualModeController::AllocateHandle() {
+  while (le_links_.count(next_handle_) != 0 || next_handle_ == 0 ||
+         next_handle_ > kMaxConnectionHandle)
+    next_handle_ = next_handle_ >= kMaxConnectionHandle ? 1 : next_handle_ + 1;
+  uint16_t handle = next_handle_;
+  next_handle_ = next_handle_ >= kMaxConnectionHandle ? 1 : next_handle_ + 1;
+  return handle;
 }
 
 void DualModeController::SetTimerPeriod(std::chrono::milliseconds new_period) {
@@ -257,6 +441,24 @@ void DualModeController::TestChannelDiscover(
   */
 }
 
+void DualModeController::TestChannelLoadScenario(
+    const vector<std::string>& args) {
+  LogCommand("TestChannel Load Scenario");
+  if (args.size() != 1) {
+    LOG_ERROR(LOG_TAG, "LOAD_SCENARIO takes the scenario file name.");
+    return;
+  }
+
+  Scenario scenario;
+  if (!scenario.Load(args[0])) return;
+
+  while (!le_links_.empty())
+    Disconnect(le_links_.begin()->first, HCI_ERR_PEER_USER);
+  devices_ = scenario.TakeDevices();
+  le_scan_reported_.assign(devices_.size(), false);
+  SetTimerPeriod(scenario.GetTickPeriod());
+}
+
 void DualModeController::TestChannelTimeoutAll(
     UNUSED_ATTR const vector<std::string>& args) {
   LogCommand("TestChannel Timeout All");
@@ -278,6 +480,11 @@ void DualModeController::TestChannelClearEventDelay(
 void DualModeController::HciReset(UNUSED_ATTR const vector<uint8_t>& args) {
   LogCommand("Reset");
   state_ = kStandby;
+  le_scan_enable_ = 0;
+  le_connect_pending_ = false;
+  le_white_list_.clear();
+  for (auto& link : le_links_) link.second->GetDevice()->Disconnect();
+  le_links_.clear();
   if (timer_tick_task_ != kInvalidTaskId) {
     LOG_INFO(LOG_TAG, "The timer was already running!");
     StopTimer();
@@ -288,6 +495,36 @@ void DualModeController::HciReset(UNUSED_ATTR const vector<uint8_t>& args) {
   SendCommandCompleteSuccess(HCI_RESET);
 }
 
+void DualModeController::HciDisconnect(const vector<uint8_t>& args) {
+  LogCommand("Disconnect");
+  CHECK(args.size() == 4);
+  uint16_t handle = GetUint16(args, 1);
+  if (le_links_.count(handle) == 0) {
+    SendCommandStatus(HCI_ERR_NO_CONNECTION, HCI_DISCONNECT);
+    return;
+  }
+
+  SendCommandStatusSuccess(HCI_DISCONNECT);
+  Disconnect(handle, HCI_ERR_CONN_CAUSE_LOCAL_HOST);
+}
+
+void DualModeController::HciReadRemoteVersionInformation(
+    const vector<uint8_t>& args) {
+  LogCommand("Read Remote Version Information");
+  CHECK(args.size() == 3);
+  uint16_t handle = GetUint16(args, 1);
+  if (le_links_.count(handle) == 0) {
+    SendCommandStatus(HCI_ERR_NO_CONNECTION, HCI_READ_RMT_VERSION_INFO);
+    return;
+  }
+
+  // The virtual devices report the version of the controller.
+  SendCommandStatusSuccess(HCI_READ_RMT_VERSION_INFO);
+  send_event_(EventPacket::CreateReadRemoteVersionInformationCompleteEvent(
+      kSuccessStatus, handle, properties_.GetLmpPalVersion(),
+      properties_.GetManufacturerName(), properties_.GetLmpPalSubversion()));
+}
+
 void DualModeController::HciReadBufferSize(
     UNUSED_ATTR const vector<uint8_t>& args) {
   LogCommand("Read Buffer Size");
@@ -598,11 +835,53 @@ void DualModeController::HciLeSetScanEnable(const vector<uint8_t>& args) {
   LogCommand("LE SetScanEnable");
   CHECK(args.size() == 3);
   CHECK(args[0] == 2);
+  if (args[1] && !le_scan_enable_) {
+    // Only the advertising events from now on are reported.
+    for (auto& device : devices_) device->ResetAdvertisingEvents();
+    le_scan_reported_.assign(devices_.size(), false);
+  }
   le_scan_enable_ = args[1];
   filter_duplicates_ = args[2];
   SendCommandCompleteSuccess(HCI_BLE_WRITE_SCAN_ENABLE);
 }
 
+void DualModeController::HciLeCreateConnection(const vector<uint8_t>& args) {
+  LogCommand("LE CreateConnection");
+  CHECK(args.size() == 26);
+  if (le_connect_pending_) {
+    SendCommandStatus(HCI_ERR_COMMAND_DISALLOWED, HCI_BLE_CREATE_LL_CONN);
+    return;
+  }
+
+  le_connect_filter_policy_ = args[5];
+  le_connect_peer_address_type_ = args[6];
+  CHECK(le_connect_peer_address_.FromVector(
+      vector<uint8_t>(args.begin() + 7, args.begin() + 13)));
+  le_connect_interval_ = GetUint16(args, 16);
+  le_connect_latency_ = GetUint16(args, 18);
+  le_connect_supervision_timeout_ = GetUint16(args, 20);
+  le_connect_pending_ = true;
+  SendCommandStatusSuccess(HCI_BLE_CREATE_LL_CONN);
+
+  LeConnect(std::chrono::steady_clock::now());
+}
+
+void DualModeController::HciLeCreateConnectionCancel(
+    UNUSED_ATTR const vector<uint8_t>& args) {
+  LogCommand("LE CreateConnectionCancel");
+  if (!le_connect_pending_) {
+    SendCommandCompleteOnlyStatus(HCI_BLE_CREATE_CONN_CANCEL,
+                                  HCI_ERR_COMMAND_DISALLOWED);
+    return;
+  }
+
+  le_connect_pending_ = false;
+  SendCommandCompleteSuccess(HCI_BLE_CREATE_CONN_CANCEL);
+  send_event_(EventPacket::CreateLeConnectionCompleteEvent(
+      HCI_ERR_NO_CONNECTION, 0, kLeMasterRole, le_connect_peer_address_type_,
+      le_connect_peer_address_, 0, 0, 0));
+}
+
 void DualModeController::HciLeReadWhiteListSize(
     UNUSED_ATTR const vector<uint8_t>& args) {
   std::unique_ptr<EventPacket> command_complete =
@@ -611,6 +890,79 @@ void DualModeController::HciLeReadWhiteListSize(
   send_event_(std::move(command_complete));
 }
 
+void DualModeController::HciLeClearWhiteList(
+    UNUSED_ATTR const vector<uint8_t>& args) {
+  LogCommand("LE ClearWhiteList");
+  le_white_list_.clear();
+  SendCommandCompleteSuccess(HCI_BLE_CLEAR_WHITE_LIST);
+}
+
+void DualModeController::HciLeAddDeviceToWhiteList(
+    const vector<uint8_t>& args) {
+  LogCommand("LE AddDeviceToWhiteList");
+  CHECK(args.size() == 8);
+  BtAddress address;
+  CHECK(address.FromVector(vector<uint8_t>(args.begin() + 2, args.end())));
+  if (IsInLeWhiteList(args[1], address)) {
+    SendCommandCompleteSuccess(HCI_BLE_ADD_WHITE_LIST);
+    return;
+  }
+  if (le_white_list_.size() >= properties_.GetLeWhiteListSize()) {
+    SendCommandCompleteOnlyStatus(HCI_BLE_ADD_WHITE_LIST, HCI_ERR_MEMORY_FULL);
+    return;
+  }
+
+  le_white_list_.emplace_back();
+  le_white_list_.back().first = args[1];
+  le_white_list_.back().second = address;
+  SendCommandCompleteSuccess(HCI_BLE_ADD_WHITE_LIST);
+}
+
+void DualModeController::HciLeRemoveDeviceFromWhiteList(
+    const vector<uint8_t>& args) {
+  LogCommand("LE RemoveDeviceFromWhiteList");
+  CHECK(args.size() == 8);
+  BtAddress address;
+  CHECK(address.FromVector(vector<uint8_t>(args.begin() + 2, args.end())));
+  for (auto it = le_white_list_.begin(); it != le_white_list_.end(); it++) {
+    if (it->first == args[1] && it->second == address) {
+      le_white_list_.erase(it);
+      break;
+    }
+  }
+  SendCommandCompleteSuccess(HCI_BLE_REMOVE_WHITE_LIST);
+}
+
+void DualModeController::HciLeConnectionUpdate(const vector<uint8_t>& args) {
+  LogCommand("LE ConnectionUpdate");
+  CHECK(args.size() == 15);
+  uint16_t handle = GetUint16(args, 1);
+  if (le_links_.count(handle) == 0) {
+    SendCommandStatus(HCI_ERR_NO_CONNECTION, HCI_BLE_UPD_LL_CONN_PARAMS);
+    return;
+  }
+
+  SendCommandStatusSuccess(HCI_BLE_UPD_LL_CONN_PARAMS);
+  send_event_(EventPacket::CreateLeConnectionUpdateCompleteEvent(
+      kSuccessStatus, handle, GetUint16(args, 5), GetUint16(args, 7),
+      GetUint16(args, 9)));
+}
+
+void DualModeController::HciLeReadRemoteFeatures(const vector<uint8_t>& args) {
+  LogCommand("LE ReadRemoteFeatures");
+  CHECK(args.size() == 3);
+  uint16_t handle = GetUint16(args, 1);
+  if (le_links_.count(handle) == 0) {
+    SendCommandStatus(HCI_ERR_NO_CONNECTION, HCI_BLE_READ_REMOTE_FEAT);
+    return;
+  }
+
+  // The virtual devices have the LE features of the controller.
+  SendCommandStatusSuccess(HCI_BLE_READ_REMOTE_FEAT);
+  send_event_(EventPacket::CreateLeRemoteUsedFeaturesEvent(
+      kSuccessStatus, handle, properties_.GetLeLocalSupportedFeatures()));
+}
+
 void DualModeController::HciLeRand(UNUSED_ATTR const vector<uint8_t>& args) {
   uint64_t random_val = rand();
   std::unique_ptr<EventPacket> command_complete =
@@ -248,6 +248,138 @@ std::unique_ptr<EventPacket> EventPacket::CreateExtendedInquiryResultEvent(
   return evt_ptr;
 }
 
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.5
+std::unique_ptr<EventPacket> EventPacket::CreateDisconnectionCompleteEvent(
+    uint8_t status, uint16_t handle, uint8_t reason) {
+  std::unique_ptr<EventPacket> evt_ptr =
+      std::unique_ptr<EventPacket>(new EventPacket(HCI_DISCONNECTION_COMP_EVT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(status));
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets1(reason));
+
+  return evt_ptr;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.12
+std::unique_ptr<EventPacket>
+EventPacket::CreateReadRemoteVersionInformationCompleteEvent(
+    uint8_t status, uint16_t handle, uint8_t version,
+    uint16_t manufacturer_name, uint16_t subversion) {
+  std::unique_ptr<EventPacket> evt_ptr = std::unique_ptr<EventPacket>(
+      new EventPacket(HCI_READ_RMT_VERSION_COMP_EVT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(status));
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets1(version));
+  CHECK(evt_ptr->AddPayloadOctets2(manufacturer_name));
+  CHECK(evt_ptr->AddPayloadOctets2(subversion));
+
+  return evt_ptr;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.19
+std::unique_ptr<EventPacket> EventPacket::CreateNumberOfCompletedPacketsEvent(
+    uint16_t handle, uint16_t num_completed_packets) {
+  std::unique_ptr<EventPacket> evt_ptr = std::unique_ptr<EventPacket>(
+      new EventPacket(HCI_NUM_COMPL_DATA_PKTS_EVT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(1));  // Always contains a single handle
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets2(num_completed_packets));
+
+  return evt_ptr;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.65.1
+std::unique_ptr<EventPacket> EventPacket::CreateLeConnectionCompleteEvent(
+    uint8_t status, uint16_t handle, uint8_t role, uint8_t peer_address_type,
+    const BtAddress& peer, uint16_t interval, uint16_t latency,
+    uint16_t supervision_timeout) {
+  std::unique_ptr<EventPacket> evt_ptr =
+      std::unique_ptr<EventPacket>(new EventPacket(HCI_BLE_EVENT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(HCI_BLE_CONN_COMPLETE_EVT));
+  CHECK(evt_ptr->AddPayloadOctets1(status));
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets1(role));
+  CHECK(evt_ptr->AddPayloadOctets1(peer_address_type));
+  CHECK(evt_ptr->AddPayloadBtAddress(peer));
+  CHECK(evt_ptr->AddPayloadOctets2(interval));
+  CHECK(evt_ptr->AddPayloadOctets2(latency));
+  CHECK(evt_ptr->AddPayloadOctets2(supervision_timeout));
+  CHECK(evt_ptr->AddPayloadOctets1(0x00));  // Master clock accuracy
+
+  return evt_ptr;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.65.2
+std::unique_ptr<EventPacket> EventPacket::CreateLeAdvertisingReportEvent() {
+  std::unique_ptr<EventPacket> evt_ptr =
+      std::unique_ptr<EventPacket>(new EventPacket(HCI_BLE_EVENT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(HCI_BLE_ADV_PKT_RPT_EVT));
+  CHECK(evt_ptr->AddPayloadOctets1(0));  // Num_Reports, counted when added
+
+  return evt_ptr;
+}
+
+bool EventPacket::AddLeAdvertisingReport(uint8_t event_type,
+                                         uint8_t address_type,
+                                         const BtAddress& address,
+                                         const vector<uint8_t>& data,
+                                         uint8_t rssi) {
+  CHECK(GetEventCode() == HCI_BLE_EVENT);
+
+  // The report is made of the event type, the address type, the address, the
+  // data length, the data and the RSSI. The payload starts with its length.
+  size_t report_octets = 3 + BtAddress::kOctets + data.size() + 1;
+  if (GetPayloadSize() - 1 + report_octets > kMaxEventParameterOctets)
+    return false;
+
+  // The reports are laid out one after the other, as the host parses them.
+  CHECK(IncrementPayloadCounter(2));  // Increment the number of reports
+  CHECK(AddPayloadOctets1(event_type));
+  CHECK(AddPayloadOctets1(address_type));
+  CHECK(AddPayloadBtAddress(address));
+  CHECK(AddPayloadOctets1(data.size()));
+  CHECK(AddPayloadOctets(data.size(), data));
+  CHECK(AddPayloadOctets1(rssi));
+
+  return true;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.65.3
+std::unique_ptr<EventPacket> EventPacket::CreateLeConnectionUpdateCompleteEvent(
+    uint8_t status, uint16_t handle, uint16_t interval, uint16_t latency,
+    uint16_t supervision_timeout) {
+  std::unique_ptr<EventPacket> evt_ptr =
+      std::unique_ptr<EventPacket>(new EventPacket(HCI_BLE_EVENT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(HCI_BLE_LL_CONN_PARAM_UPD_EVT));
+  CHECK(evt_ptr->AddPayloadOctets1(status));
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets2(interval));
+  CHECK(evt_ptr->AddPayloadOctets2(latency));
+  CHECK(evt_ptr->AddPayloadOctets2(supervision_timeout));
+
+  return evt_ptr;
+}
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.7.65.4
+std::unique_ptr<EventPacket> EventPacket::CreateLeRemoteUsedFeaturesEvent(
+    uint8_t status, uint16_t handle, uint64_t features) {
+  std::unique_ptr<EventPacket> evt_ptr =
+      std::unique_ptr<EventPacket>(new EventPacket(HCI_BLE_EVENT));
+
+  CHECK(evt_ptr->AddPayloadOctets1(HCI_BLE_READ_REMOTE_FEAT_CMPL_EVT));
+  CHECK(evt_ptr->AddPayloadOctets1(status));
+  CHECK(evt_ptr->AddPayloadOctets2(handle));
+  CHECK(evt_ptr->AddPayloadOctets8(features));
+
+  return evt_ptr;
+}
+
 // Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.8.2
 std::unique_ptr<EventPacket> EventPacket::CreateCommandCompleteLeReadBufferSize(
     uint8_t status, uint16_t hc_le_data_packet_length,
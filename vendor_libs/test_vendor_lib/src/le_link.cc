@@ -0,0 +1,273 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define LOG_TAG "le_link"
+
+#include "le_link.h"
+
+#include <algorithm>
+
+#include <base/logging.h>
+
+using std::vector;
+
+namespace {
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 5.4.2
+const size_t kAclHeaderSize = 4;
+const uint16_t kAclHandleMask = 0x0fff;
+const uint8_t kAclContinuingFragment = 0x01;
+const uint8_t kAclFirstAutomaticallyFlushable = 0x02;
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part A, Section 3.1
+const size_t kL2capHeaderSize = 4;
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part A, Section 4
+const size_t kSignalingHeaderSize = 4;
+const uint8_t kCommandReject = 0x01;
+const uint8_t kDisconnectionRequest = 0x06;
+const uint8_t kDisconnectionResponse = 0x07;
+const uint8_t kLeCreditBasedConnectionRequest = 0x14;
+const uint8_t kLeCreditBasedConnectionResponse = 0x15;
+const uint8_t kLeFlowControlCredit = 0x16;
+// The responses, which are never rejected, have odd codes.
+const uint8_t kResponseFlag = 0x01;
+
+const uint16_t kCommandNotUnderstood = 0x0000;
+const uint16_t kInvalidCidInRequest = 0x0002;
+const uint16_t kConnectionSuccessful = 0x0000;
+const uint16_t kNoResourcesAvailable = 0x0004;
+const uint16_t kLastDynamicCid = 0x007f;
+
+// The MTU and MPS of the LE credit based connections of the device.
+const uint16_t kCocMtu = 512;
+const uint16_t kCocMps = 247;
+
+// The budget of a throttled link holds at most this much of the time, so that
+// an idle link doesn't burst.
+const std::chrono::milliseconds kMaxBurst = std::chrono::milliseconds(100);
+
+// The smallest budget of a throttled link, so that the largest ACL data packet
+// always fits.
+const double kMinBudget = 2048;
+
+uint16_t GetUint16(const vector<uint8_t>& data, size_t offset) {
+  return data[offset] | (data[offset + 1] << 8);
+}
+
+void AppendUint16(vector<uint8_t>* data, uint16_t value) {
+  data->push_back(value & 0xff);
+  data->push_back(value >> 8);
+}
+
+}  // namespace
+
+namespace test_vendor_lib {
+
+LeLink::LeLink(uint16_t handle, VirtualDevice* device,
+               uint16_t le_data_packet_length,
+               std::chrono::steady_clock::time_point now)
+    : handle_(handle),
+      device_(device),
+      le_data_packet_length_(le_data_packet_length),
+      bytes_per_second_(device->GetLinkBytesPerSecond()),
+      last_refill_(now) {
+  max_budget_ = std::max(kMinBudget, bytes_per_second_ * kMaxBurst.count() /
+                                         1000.0);
+  budget_ = max_budget_;
+}
+
+void LeLink::Refill(std::chrono::steady_clock::time_point now) {
+  if (bytes_per_second_ == 0) return;
+
+  std::chrono::duration<double> elapsed = now - last_refill_;
+  last_refill_ = now;
+  budget_ =
+      std::min(max_budget_, budget_ + elapsed.count() * bytes_per_second_);
+}
+
+bool LeLink::Consume(size_t bytes) {
+  if (bytes_per_second_ == 0) return true;
+  if (budget_ < bytes) return false;
+  budget_ -= bytes;
+  return true;
+}
+
+void LeLink::ReceiveFromHost(const vector<uint8_t>& packet) {
+  from_host_.push_back(packet);
+}
+
+size_t LeLink::Service(std::chrono::steady_clock::time_point now,
+                       vector<vector<uint8_t>>* to_host) {
+  Refill(now);
+
+  size_t completed = 0;
+  while (!from_host_.empty()) {
+    const vector<uint8_t>& packet = from_host_.front();
+    size_t length = packet.size() - kAclHeaderSize;
+    if (!Consume(length)) break;
+
+    bytes_from_host_ += length;
+    uint8_t packet_boundary = (packet[1] >> 4) & 0x03;
+    if (packet_boundary != kAclContinuingFragment) rx_frame_.clear();
+    rx_frame_.insert(rx_frame_.end(), packet.begin() + kAclHeaderSize,
+                     packet.end());
+    if (rx_frame_.size() >= kL2capHeaderSize &&
+        rx_frame_.size() >= kL2capHeaderSize + GetUint16(rx_frame_, 0)) {
+      HandleFrame();
+      rx_frame_.clear();
+    }
+
+    from_host_.pop_front();
+    completed++;
+  }
+
+  vector<vector<uint8_t>> notifications;
+  device_->TakeNotifications(now, &notifications);
+  for (const auto& pdu : notifications) {
+    if (to_host_.size() >= kMaxQueuedPackets) {
+      dropped_packets_++;
+      continue;
+    }
+    SendToHost(kAttCid, pdu);
+  }
+
+  while (!to_host_.empty()) {
+    size_t length = to_host_.front().size() - kAclHeaderSize;
+    if (!Consume(length)) break;
+
+    bytes_to_host_ += length;
+    to_host->push_back(std::move(to_host_.front()));
+    to_host_.pop_front();
+  }
+
+  return completed;
+}
+
+void LeLink::HandleFrame() {
+  uint16_t length = GetUint16(rx_frame_, 0);
+  uint16_t cid = GetUint16(rx_frame_, 2);
+  vector<uint8_t> pdu(rx_frame_.begin() + kL2capHeaderSize,
+                      rx_frame_.begin() + kL2capHeaderSize + length);
+
+  if (cid == kAttCid) {
+    vector<uint8_t> response = device_->HandleAttPdu(pdu);
+    if (!response.empty()) SendToHost(kAttCid, response);
+    return;
+  }
+
+  if (cid == kLeSignalingCid) {
+    HandleSignaling(pdu);
+    return;
+  }
+
+  device_->CountSinkBytes(pdu.size());
+  if (coc_channels_.count(cid) != 0) ConsumeCocCredit(cid);
+}
+
+void LeLink::HandleSignaling(const vector<uint8_t>& command) {
+  if (command.size() < kSignalingHeaderSize) return;
+
+  uint8_t code = command[0];
+  uint8_t id = command[1];
+  uint16_t length = GetUint16(command, 2);
+  if (command.size() != kSignalingHeaderSize + length) return;
+
+  vector<uint8_t> response;
+  switch (code) {
+    case kLeCreditBasedConnectionRequest: {
+      if (length != 10) return;
+      uint16_t remote_cid = GetUint16(command, 6);
+      uint16_t local_cid = 0;
+      uint16_t result = kConnectionSuccessful;
+      if (next_coc_cid_ > kLastDynamicCid) {
+        result = kNoResourcesAvailable;
+      } else {
+        local_cid = next_coc_cid_++;
+        coc_channels_[local_cid] = {remote_cid, 0};
+      }
+      response = {kLeCreditBasedConnectionResponse, id, 10, 0};
+      AppendUint16(&response, local_cid);
+      AppendUint16(&response, kCocMtu);
+      AppendUint16(&response, kCocMps);
+      AppendUint16(&response, local_cid == 0 ? 0 : kCocCredits);
+      AppendUint16(&response, result);
+      break;
+    }
+    case kDisconnectionRequest: {
+      if (length != 4) return;
+      uint16_t local_cid = GetUint16(command, 4);
+      uint16_t remote_cid = GetUint16(command, 6);
+      if (coc_channels_.erase(local_cid) == 0) {
+        response = {kCommandReject, id, 6, 0};
+        AppendUint16(&response, kInvalidCidInRequest);
+        AppendUint16(&response, local_cid);
+        AppendUint16(&response, remote_cid);
+        break;
+      }
+      response = {kDisconnectionResponse, id, 4, 0};
+      AppendUint16(&response, local_cid);
+      AppendUint16(&response, remote_cid);
+      break;
+    }
+    case kLeFlowControlCredit:
+      // The device never sends on the connections: the credits of the host
+      // are ignored.
+      return;
+    default:
+      if (code & kResponseFlag) return;
+      response = {kCommandReject, id, 2, 0};
+      AppendUint16(&response, kCommandNotUnderstood);
+      break;
+  }
+  SendToHost(kLeSignalingCid, response);
+}
+
+void LeLink::ConsumeCocCredit(uint16_t cid) {
+  CocChannel& channel = coc_channels_[cid];
+  if (++channel.consumed_credits < kCocCreditBatch) return;
+
+  vector<uint8_t> credit = {kLeFlowControlCredit, next_signaling_id_, 4, 0};
+  AppendUint16(&credit, cid);
+  AppendUint16(&credit, channel.consumed_credits);
+  channel.consumed_credits = 0;
+  // The identifiers are non-zero.
+  next_signaling_id_ = next_signaling_id_ == 0xff ? 1 : next_signaling_id_ + 1;
+  SendToHost(kLeSignalingCid, credit);
+}
+
+void LeLink::SendToHost(uint16_t cid, const vector<uint8_t>& pdu) {
+  vector<uint8_t> frame;
+  AppendUint16(&frame, pdu.size());
+  AppendUint16(&frame, cid);
+  frame.insert(frame.end(), pdu.begin(), pdu.end());
+
+  uint8_t packet_boundary = kAclFirstAutomaticallyFlushable;
+  for (size_t offset = 0; offset < frame.size();
+       offset += le_data_packet_length_) {
+    size_t length =
+        std::min<size_t>(le_data_packet_length_, frame.size() - offset);
+    vector<uint8_t> packet;
+    AppendUint16(&packet, (handle_ & kAclHandleMask) | (packet_boundary << 12));
+    AppendUint16(&packet, length);
+    packet.insert(packet.end(), frame.begin() + offset,
+                  frame.begin() + offset + length);
+    to_host_.push_back(std::move(packet));
+    packet_boundary = kAclContinuingFragment;
+  }
+}
+
+}  // namespace test_vendor_lib
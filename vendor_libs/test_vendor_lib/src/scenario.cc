@@ -0,0 +1,251 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define LOG_TAG "scenario"
+
+#include "scenario.h"
+
+#include <algorithm>
+
+#include <base/logging.h>
+#include "base/files/file_util.h"
+#include "base/json/json_reader.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/values.h"
+
+#include "osi/include/log.h"
+
+using std::vector;
+
+namespace {
+
+// Bluetooth Core Specification Version 4.2, Volume 2, Part E, Section 7.8.7
+const size_t kMaxAdvertisingDataLength = 31;
+
+const size_t kMaxDevices = 10000;
+
+// Parses a hexadecimal string. The empty string is accepted.
+bool ParseHex(const std::string& hex, vector<uint8_t>* bytes) {
+  bytes->clear();
+  return hex.empty() || base::HexStringToBytes(hex, bytes);
+}
+
+// Parses "180F" or "0000180F-0000-1000-8000-00805F9B34FB" into a
+// little-endian UUID.
+bool ParseUuid(std::string uuid, vector<uint8_t>* bytes) {
+  uuid.erase(std::remove(uuid.begin(), uuid.end(), '-'), uuid.end());
+  if (!ParseHex(uuid, bytes)) return false;
+  if (bytes->size() != 2 && bytes->size() != 16) return false;
+  std::reverse(bytes->begin(), bytes->end());
+  return true;
+}
+
+bool ParseProperties(const base::ListValue& list, uint8_t* properties) {
+  *properties = 0;
+  for (size_t i = 0; i < list.GetSize(); i++) {
+    std::string name;
+    if (!list.GetString(i, &name)) return false;
+    if (name == "Read")
+      *properties |= test_vendor_lib::GattCharacteristic::kRead;
+    else if (name == "WriteWithoutResponse")
+      *properties |= test_vendor_lib::GattCharacteristic::kWriteWithoutResponse;
+    else if (name == "Write")
+      *properties |= test_vendor_lib::GattCharacteristic::kWrite;
+    else if (name == "Notify")
+      *properties |= test_vendor_lib::GattCharacteristic::kNotify;
+    else if (name == "Indicate")
+      *properties |= test_vendor_lib::GattCharacteristic::kIndicate;
+    else
+      return false;
+  }
+  return true;
+}
+
+// Sets |result| to the address |offset| past |address|.
+void AddressAt(const test_vendor_lib::BtAddress& address, int offset,
+               test_vendor_lib::BtAddress* result) {
+  vector<uint8_t> octets;
+  address.ToVector(octets);
+  for (size_t i = 0; i < octets.size() && offset != 0; i++) {
+    int sum = octets[i] + offset;
+    octets[i] = sum & 0xff;
+    offset = sum >> 8;
+  }
+  CHECK(result->FromVector(octets));
+}
+
+}  // namespace
+
+namespace test_vendor_lib {
+
+bool Scenario::Load(const std::string& file_name) {
+  std::string json;
+  if (!base::ReadFileToString(base::FilePath(file_name), &json)) {
+    LOG_ERROR(LOG_TAG, "Error reading the scenario from %s.",
+              file_name.c_str());
+    return false;
+  }
+  return Parse(json);
+}
+
+bool Scenario::Parse(const std::string& json) {
+  devices_.clear();
+
+  std::unique_ptr<base::Value> value = base::JSONReader::Read(json);
+  const base::DictionaryValue* dictionary;
+  if (value.get() == nullptr || !value->GetAsDictionary(&dictionary)) {
+    LOG_ERROR(LOG_TAG, "The scenario is ill-formed JSON.");
+    return false;
+  }
+
+  int tick_period_ms;
+  if (dictionary->GetInteger("TickPeriodMs", &tick_period_ms)) {
+    if (tick_period_ms <= 0) return false;
+    tick_period_ = std::chrono::milliseconds(tick_period_ms);
+  }
+
+  const base::ListValue* devices;
+  if (!dictionary->GetList("Devices", &devices)) return false;
+  for (size_t i = 0; i < devices->GetSize(); i++) {
+    const base::DictionaryValue* device;
+    if (!devices->GetDictionary(i, &device) || !ParseDevices(*device)) {
+      LOG_ERROR(LOG_TAG, "Invalid device %zu in the scenario.", i);
+      devices_.clear();
+      return false;
+    }
+  }
+
+  LOG_INFO(LOG_TAG, "The scenario has %zu virtual devices.", devices_.size());
+  return true;
+}
+
+bool Scenario::ParseDevices(const base::DictionaryValue& dictionary) {
+  std::string address_string;
+  BtAddress address;
+  if (!dictionary.GetString("Address", &address_string) ||
+      !address.FromString(address_string))
+    return false;
+
+  uint8_t address_type = VirtualDevice::kRandomAddress;
+  std::string address_type_string;
+  if (dictionary.GetString("AddressType", &address_type_string)) {
+    if (address_type_string == "Public")
+      address_type = VirtualDevice::kPublicAddress;
+    else if (address_type_string != "Random")
+      return false;
+  }
+
+  int count = 1;
+  dictionary.GetInteger("Count", &count);
+  if (count <= 0 || devices_.size() + count > kMaxDevices) return false;
+
+  int advertising_interval_ms = 100;
+  dictionary.GetInteger("AdvertisingIntervalMs", &advertising_interval_ms);
+  if (advertising_interval_ms < 0) return false;
+
+  std::string hex;
+  vector<uint8_t> advertising_data;
+  vector<uint8_t> scan_response_data;
+  dictionary.GetString("AdvertisingData", &hex);
+  if (!ParseHex(hex, &advertising_data) ||
+      advertising_data.size() > kMaxAdvertisingDataLength)
+    return false;
+  hex.clear();
+  dictionary.GetString("ScanResponseData", &hex);
+  if (!ParseHex(hex, &scan_response_data) ||
+      scan_response_data.size() > kMaxAdvertisingDataLength)
+    return false;
+
+  bool connectable = true;
+  dictionary.GetBoolean("Connectable", &connectable);
+
+  int rssi = -60;
+  dictionary.GetInteger("Rssi", &rssi);
+  if (rssi < -127 || rssi > 20) return false;
+
+  int link_bytes_per_second = 0;
+  dictionary.GetInteger("LinkBytesPerSecond", &link_bytes_per_second);
+  if (link_bytes_per_second < 0) return false;
+
+  vector<GattService> services;
+  const base::ListValue* service_list;
+  if (dictionary.GetList("Services", &service_list)) {
+    for (size_t i = 0; i < service_list->GetSize(); i++) {
+      const base::DictionaryValue* service_dictionary;
+      GattService service;
+      if (!service_list->GetDictionary(i, &service_dictionary) ||
+          !ParseService(*service_dictionary, &service))
+        return false;
+      services.push_back(service);
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    BtAddress device_address;
+    AddressAt(address, i, &device_address);
+    std::unique_ptr<VirtualDevice> device(
+        new VirtualDevice(device_address, address_type));
+    device->SetAdvertising(
+        std::chrono::milliseconds(advertising_interval_ms), advertising_data,
+        scan_response_data, connectable);
+    device->SetRssi(rssi);
+    device->SetLinkBytesPerSecond(link_bytes_per_second);
+    for (const auto& service : services) device->AddService(service);
+    devices_.push_back(std::move(device));
+  }
+  return true;
+}
+
+bool Scenario::ParseService(const base::DictionaryValue& dictionary,
+                            GattService* service) {
+  std::string uuid;
+  if (!dictionary.GetString("Uuid", &uuid) ||
+      !ParseUuid(uuid, &service->uuid))
+    return false;
+
+  const base::ListValue* characteristics;
+  if (!dictionary.GetList("Characteristics", &characteristics)) return true;
+
+  for (size_t i = 0; i < characteristics->GetSize(); i++) {
+    const base::DictionaryValue* characteristic_dictionary;
+    if (!characteristics->GetDictionary(i, &characteristic_dictionary))
+      return false;
+
+    GattCharacteristic characteristic;
+    if (!characteristic_dictionary->GetString("Uuid", &uuid) ||
+        !ParseUuid(uuid, &characteristic.uuid))
+      return false;
+
+    const base::ListValue* properties;
+    if (characteristic_dictionary->GetList("Properties", &properties) &&
+        !ParseProperties(*properties, &characteristic.properties))
+      return false;
+
+    std::string hex;
+    characteristic_dictionary->GetString("Value", &hex);
+    if (!ParseHex(hex, &characteristic.value)) return false;
+
+    int notify_period_ms = 0;
+    characteristic_dictionary->GetInteger("NotifyPeriodMs", &notify_period_ms);
+    if (notify_period_ms < 0) return false;
+    characteristic.notify_period = std::chrono::milliseconds(notify_period_ms);
+
+    service->characteristics.push_back(characteristic);
+  }
+  return true;
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,415 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#define LOG_TAG "virtual_device"
+
+#include "virtual_device.h"
+
+#include <algorithm>
+
+#include <base/logging.h>
+
+using std::vector;
+
+namespace {
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part F, Section 3.4.8
+const uint8_t kAttErrorResponse = 0x01;
+const uint8_t kAttExchangeMtuRequest = 0x02;
+const uint8_t kAttExchangeMtuResponse = 0x03;
+const uint8_t kAttFindInformationRequest = 0x04;
+const uint8_t kAttFindInformationResponse = 0x05;
+const uint8_t kAttFindByTypeValueRequest = 0x06;
+const uint8_t kAttFindByTypeValueResponse = 0x07;
+const uint8_t kAttReadByTypeRequest = 0x08;
+const uint8_t kAttReadByTypeResponse = 0x09;
+const uint8_t kAttReadRequest = 0x0A;
+const uint8_t kAttReadResponse = 0x0B;
+const uint8_t kAttReadBlobRequest = 0x0C;
+const uint8_t kAttReadBlobResponse = 0x0D;
+const uint8_t kAttReadByGroupTypeRequest = 0x10;
+const uint8_t kAttReadByGroupTypeResponse = 0x11;
+const uint8_t kAttWriteRequest = 0x12;
+const uint8_t kAttWriteResponse = 0x13;
+const uint8_t kAttHandleValueNotification = 0x1B;
+const uint8_t kAttHandleValueConfirmation = 0x1E;
+const uint8_t kAttWriteCommand = 0x52;
+// The commands, which have no response, have this bit set in their opcode.
+const uint8_t kAttCommandFlag = 0x40;
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part F, Section 3.4.1.1
+const uint8_t kAttInvalidHandle = 0x01;
+const uint8_t kAttWriteNotPermitted = 0x03;
+const uint8_t kAttInvalidPdu = 0x04;
+const uint8_t kAttRequestNotSupported = 0x06;
+const uint8_t kAttInvalidOffset = 0x07;
+const uint8_t kAttAttributeNotFound = 0x0A;
+const uint8_t kAttUnsupportedGroupType = 0x10;
+
+const uint16_t kAttDefaultMtu = 23;
+const uint16_t kAttServerMtu = 247;
+
+// Bluetooth Core Specification Version 4.2, Volume 3, Part G, Section 3
+const vector<uint8_t> kPrimaryServiceUuid = {0x00, 0x28};
+const vector<uint8_t> kCharacteristicUuid = {0x03, 0x28};
+const vector<uint8_t> kClientCharacteristicConfigurationUuid = {0x02, 0x29};
+
+// The Bluetooth Base UUID, 00000000-0000-1000-8000-00805F9B34FB, in
+// little-endian order.
+const uint8_t kBaseUuid[16] = {0xFB, 0x34, 0x9B, 0x5F, 0x80, 0x00, 0x00, 0x80,
+                               0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+vector<uint8_t> ToUuid128(const vector<uint8_t>& uuid) {
+  if (uuid.size() != 2) return uuid;
+  vector<uint8_t> uuid128(kBaseUuid, kBaseUuid + sizeof(kBaseUuid));
+  uuid128[12] = uuid[0];
+  uuid128[13] = uuid[1];
+  return uuid128;
+}
+
+bool UuidEquals(const vector<uint8_t>& a, const vector<uint8_t>& b) {
+  if (a.size() == b.size()) return a == b;
+  return ToUuid128(a) == ToUuid128(b);
+}
+
+uint16_t GetUint16(const vector<uint8_t>& pdu, size_t offset) {
+  return pdu[offset] | (pdu[offset + 1] << 8);
+}
+
+void AppendUint16(vector<uint8_t>* pdu, uint16_t value) {
+  pdu->push_back(value & 0xff);
+  pdu->push_back(value >> 8);
+}
+
+vector<uint8_t> ErrorResponse(uint8_t request_opcode, uint16_t handle,
+                              uint8_t error) {
+  vector<uint8_t> response = {kAttErrorResponse, request_opcode};
+  AppendUint16(&response, handle);
+  response.push_back(error);
+  return response;
+}
+
+}  // namespace
+
+namespace test_vendor_lib {
+
+VirtualDevice::VirtualDevice(const BtAddress& address, uint8_t address_type)
+    : address_type_(address_type), att_mtu_(kAttDefaultMtu) {
+  address_ = address;
+}
+
+void VirtualDevice::SetAdvertising(std::chrono::milliseconds interval,
+                                   const vector<uint8_t>& advertising_data,
+                                   const vector<uint8_t>& scan_response_data,
+                                   bool connectable) {
+  advertising_interval_ = interval;
+  advertising_data_ = advertising_data;
+  scan_response_data_ = scan_response_data;
+  connectable_ = connectable;
+  advertising_started_ = false;
+}
+
+size_t VirtualDevice::TakeAdvertisingEvents(
+    std::chrono::steady_clock::time_point now) {
+  if (!IsAdvertising()) return 0;
+
+  if (!advertising_started_) {
+    advertising_started_ = true;
+    last_advertising_event_ = now;
+    return 0;
+  }
+
+  size_t events = (now - last_advertising_event_) / advertising_interval_;
+  last_advertising_event_ += events * advertising_interval_;
+  return events;
+}
+
+void VirtualDevice::Connect() { connected_ = true; }
+
+void VirtualDevice::Disconnect() {
+  connected_ = false;
+  att_mtu_ = kAttDefaultMtu;
+  for (auto& notifier : notifiers_) notifier.enabled = false;
+  for (auto& attribute : attributes_)
+    if (attribute.notifier >= 0) attribute.value = {0x00, 0x00};
+  advertising_started_ = false;
+}
+
+uint16_t VirtualDevice::AddAttribute(const vector<uint8_t>& type,
+                                     const vector<uint8_t>& value,
+                                     bool writable) {
+  uint16_t handle = attributes_.size() + 1;
+  attributes_.push_back({handle, type, value, handle, writable, -1});
+  if (last_service_ >= 0) attributes_[last_service_].group_end_handle = handle;
+  return handle;
+}
+
+VirtualDevice::Attribute* VirtualDevice::FindAttribute(uint16_t handle) {
+  if (handle == 0 || handle > attributes_.size()) return nullptr;
+  return &attributes_[handle - 1];
+}
+
+void VirtualDevice::AddService(const GattService& service) {
+  last_service_ = attributes_.size();
+  AddAttribute(kPrimaryServiceUuid, service.uuid, false);
+
+  for (const auto& characteristic : service.characteristics) {
+    // The declaration holds the handle of the value, which follows it.
+    vector<uint8_t> declaration = {characteristic.properties};
+    AppendUint16(&declaration, attributes_.size() + 2);
+    declaration.insert(declaration.end(), characteristic.uuid.begin(),
+                       characteristic.uuid.end());
+    AddAttribute(kCharacteristicUuid, declaration, false);
+
+    uint8_t write_properties = GattCharacteristic::kWrite |
+                               GattCharacteristic::kWriteWithoutResponse;
+    uint16_t value_handle =
+        AddAttribute(characteristic.uuid, characteristic.value,
+                     characteristic.properties & write_properties);
+
+    if (characteristic.properties &
+        (GattCharacteristic::kNotify | GattCharacteristic::kIndicate)) {
+      AddAttribute(kClientCharacteristicConfigurationUuid, {0x00, 0x00}, true);
+      attributes_.back().notifier = notifiers_.size();
+      notifiers_.push_back({value_handle, characteristic.notify_period, false,
+                            std::chrono::steady_clock::time_point()});
+    }
+  }
+}
+
+vector<uint8_t> VirtualDevice::HandleAttPdu(const vector<uint8_t>& request) {
+  if (request.empty()) return {};
+
+  uint8_t opcode = request[0];
+  switch (opcode) {
+    case kAttExchangeMtuRequest:
+      return HandleExchangeMtu(request);
+    case kAttFindInformationRequest:
+      return HandleFindInformation(request);
+    case kAttFindByTypeValueRequest:
+      return HandleFindByTypeValue(request);
+    case kAttReadByTypeRequest:
+      return HandleReadByType(request, kAttReadByTypeResponse);
+    case kAttReadByGroupTypeRequest:
+      return HandleReadByType(request, kAttReadByGroupTypeResponse);
+    case kAttReadRequest:
+    case kAttReadBlobRequest:
+      return HandleRead(request);
+    case kAttWriteRequest:
+    case kAttWriteCommand:
+      return HandleWrite(request);
+    default:
+      // Confirmations and unsupported commands are silently dropped.
+      if (opcode & kAttCommandFlag || opcode == kAttHandleValueConfirmation)
+        return {};
+      return ErrorResponse(opcode, 0x0000, kAttRequestNotSupported);
+  }
+}
+
+vector<uint8_t> VirtualDevice::HandleExchangeMtu(
+    const vector<uint8_t>& request) {
+  if (request.size() != 3)
+    return ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t client_mtu = GetUint16(request, 1);
+  att_mtu_ = std::max(kAttDefaultMtu, std::min(client_mtu, kAttServerMtu));
+
+  vector<uint8_t> response = {kAttExchangeMtuResponse};
+  AppendUint16(&response, kAttServerMtu);
+  return response;
+}
+
+vector<uint8_t> VirtualDevice::HandleFindInformation(
+    const vector<uint8_t>& request) {
+  if (request.size() != 5)
+    return ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t start = GetUint16(request, 1);
+  uint16_t end = GetUint16(request, 3);
+  if (start == 0 || start > end)
+    return ErrorResponse(request[0], start, kAttInvalidHandle);
+
+  vector<uint8_t> response = {kAttFindInformationResponse, 0};
+  size_t uuid_length = 0;
+  for (const auto& attribute : attributes_) {
+    if (attribute.handle < start || attribute.handle > end) continue;
+    // All the entries of a response have the same format.
+    if (uuid_length == 0) uuid_length = attribute.type.size();
+    if (attribute.type.size() != uuid_length ||
+        response.size() + 2 + uuid_length > att_mtu_)
+      break;
+    AppendUint16(&response, attribute.handle);
+    response.insert(response.end(), attribute.type.begin(),
+                    attribute.type.end());
+  }
+
+  if (uuid_length == 0)
+    return ErrorResponse(request[0], start, kAttAttributeNotFound);
+  response[1] = uuid_length == 2 ? 0x01 : 0x02;
+  return response;
+}
+
+vector<uint8_t> VirtualDevice::HandleFindByTypeValue(
+    const vector<uint8_t>& request) {
+  if (request.size() < 7)
+    return ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t start = GetUint16(request, 1);
+  uint16_t end = GetUint16(request, 3);
+  vector<uint8_t> type(request.begin() + 5, request.begin() + 7);
+  vector<uint8_t> value(request.begin() + 7, request.end());
+  if (start == 0 || start > end)
+    return ErrorResponse(request[0], start, kAttInvalidHandle);
+
+  vector<uint8_t> response = {kAttFindByTypeValueResponse};
+  for (const auto& attribute : attributes_) {
+    if (attribute.handle < start || attribute.handle > end) continue;
+    if (!UuidEquals(attribute.type, type)) continue;
+    // Services are searched by UUID, whatever the size of the UUID given.
+    bool found = type == kPrimaryServiceUuid
+                     ? UuidEquals(attribute.value, value)
+                     : attribute.value == value;
+    if (!found) continue;
+    if (response.size() + 4 > att_mtu_) break;
+    AppendUint16(&response, attribute.handle);
+    AppendUint16(&response, attribute.group_end_handle);
+  }
+
+  if (response.size() == 1)
+    return ErrorResponse(request[0], start, kAttAttributeNotFound);
+  return response;
+}
+
+vector<uint8_t> VirtualDevice::HandleReadByType(const vector<uint8_t>& request,
+                                                uint8_t response_opcode) {
+  if (request.size() != 7 && request.size() != 21)
+    return ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t start = GetUint16(request, 1);
+  uint16_t end = GetUint16(request, 3);
+  vector<uint8_t> type(request.begin() + 5, request.end());
+  if (start == 0 || start > end)
+    return ErrorResponse(request[0], start, kAttInvalidHandle);
+
+  bool group = response_opcode == kAttReadByGroupTypeResponse;
+  if (group && !UuidEquals(type, kPrimaryServiceUuid))
+    return ErrorResponse(request[0], start, kAttUnsupportedGroupType);
+
+  // Each entry is the handle (and the group end handle), and the value
+  // truncated to fit in the PDU. All the entries have the same length.
+  size_t header_length = group ? 4 : 2;
+  size_t max_value_length =
+      std::min<size_t>(att_mtu_ - 2 - header_length, 255 - header_length);
+  vector<uint8_t> response = {response_opcode, 0};
+  size_t entry_length = 0;
+  for (const auto& attribute : attributes_) {
+    if (attribute.handle < start || attribute.handle > end) continue;
+    if (!UuidEquals(attribute.type, type)) continue;
+
+    size_t value_length = std::min(attribute.value.size(), max_value_length);
+    if (entry_length == 0) entry_length = header_length + value_length;
+    if (header_length + value_length != entry_length ||
+        response.size() + entry_length > att_mtu_)
+      break;
+
+    AppendUint16(&response, attribute.handle);
+    if (group) AppendUint16(&response, attribute.group_end_handle);
+    response.insert(response.end(), attribute.value.begin(),
+                    attribute.value.begin() + value_length);
+  }
+
+  if (entry_length == 0)
+    return ErrorResponse(request[0], start, kAttAttributeNotFound);
+  response[1] = entry_length;
+  return response;
+}
+
+vector<uint8_t> VirtualDevice::HandleRead(const vector<uint8_t>& request) {
+  bool blob = request[0] == kAttReadBlobRequest;
+  if (request.size() != (blob ? 5u : 3u))
+    return ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t handle = GetUint16(request, 1);
+  size_t offset = blob ? GetUint16(request, 3) : 0;
+  const Attribute* attribute = FindAttribute(handle);
+  if (attribute == nullptr)
+    return ErrorResponse(request[0], handle, kAttInvalidHandle);
+  if (offset > attribute->value.size())
+    return ErrorResponse(request[0], handle, kAttInvalidOffset);
+
+  size_t length = std::min<size_t>(attribute->value.size() - offset,
+                                   att_mtu_ - 1);
+  vector<uint8_t> response = {blob ? kAttReadBlobResponse : kAttReadResponse};
+  response.insert(response.end(), attribute->value.begin() + offset,
+                  attribute->value.begin() + offset + length);
+  return response;
+}
+
+vector<uint8_t> VirtualDevice::HandleWrite(const vector<uint8_t>& request) {
+  bool command = request[0] == kAttWriteCommand;
+  if (request.size() < 3)
+    return command ? vector<uint8_t>()
+                   : ErrorResponse(request[0], 0x0000, kAttInvalidPdu);
+
+  uint16_t handle = GetUint16(request, 1);
+  Attribute* attribute = FindAttribute(handle);
+  if (attribute == nullptr || !attribute->writable) {
+    if (command) return {};
+    return ErrorResponse(request[0], handle, attribute == nullptr
+                                                 ? kAttInvalidHandle
+                                                 : kAttWriteNotPermitted);
+  }
+
+  attribute->value.assign(request.begin() + 3, request.end());
+  if (attribute->notifier >= 0) {
+    // Only the notifications are emulated: the indications are sent as
+    // notifications.
+    Notifier& notifier = notifiers_[attribute->notifier];
+    bool enabled = !attribute->value.empty() && (attribute->value[0] & 0x03);
+    if (enabled && !notifier.enabled)
+      notifier.next = std::chrono::steady_clock::time_point();
+    notifier.enabled = enabled;
+  }
+
+  if (command) return {};
+  return {kAttWriteResponse};
+}
+
+void VirtualDevice::TakeNotifications(std::chrono::steady_clock::time_point now,
+                                      vector<vector<uint8_t>>* pdus) {
+  if (!connected_) return;
+
+  for (auto& notifier : notifiers_) {
+    if (!notifier.enabled || notifier.period.count() == 0) continue;
+
+    const Attribute* attribute = FindAttribute(notifier.value_handle);
+    CHECK(attribute != nullptr);
+    // The first notification is sent right after the host enables them.
+    if (notifier.next == std::chrono::steady_clock::time_point())
+      notifier.next = now;
+    while (notifier.next <= now) {
+      vector<uint8_t> pdu = {kAttHandleValueNotification};
+      AppendUint16(&pdu, notifier.value_handle);
+      size_t length = std::min<size_t>(attribute->value.size(), att_mtu_ - 3);
+      pdu.insert(pdu.end(), attribute->value.begin(),
+                 attribute->value.begin() + length);
+      pdus->push_back(std::move(pdu));
+      notifier.next += notifier.period;
+    }
+  }
+}
+
+}  // namespace test_vendor_lib
@@ -0,0 +1,320 @@
+//
+// Copyright 2017 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+using std::vector;
+
+#include "le_link.h"
+#include "virtual_device.h"
+
+namespace {
+const std::string kTestAddr = "12:34:56:78:9a:bc";
+
+// The Battery Service, with a notifying Battery Level, then a writable
+// characteristic with a 128-bit UUID.
+const vector<uint8_t> kBatteryServiceUuid = {0x0F, 0x18};
+const vector<uint8_t> kBatteryLevelUuid = {0x19, 0x2A};
+const vector<uint8_t> kCustomUuid = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+                                     0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+                                     0x0C, 0x0D, 0x0E, 0x0F};
+
+// The attribute handles of the database above.
+const uint16_t kBatteryLevelHandle = 3;
+const uint16_t kBatteryLevelCccdHandle = 4;
+const uint16_t kCustomHandle = 6;
+
+const uint16_t kLinkHandle = 0x0040;
+const uint16_t kLeDataPacketLength = 27;
+}
+
+namespace test_vendor_lib {
+
+class VirtualDeviceTest : public ::testing::Test {
+ public:
+  VirtualDeviceTest() {
+    BtAddress address;
+    address.FromString(kTestAddr);
+    device_.reset(new VirtualDevice(address, VirtualDevice::kRandomAddress));
+
+    GattCharacteristic battery_level;
+    battery_level.uuid = kBatteryLevelUuid;
+    battery_level.properties =
+        GattCharacteristic::kRead | GattCharacteristic::kNotify;
+    battery_level.value = {0x64};
+    battery_level.notify_period = std::chrono::milliseconds(100);
+
+    GattCharacteristic custom;
+    custom.uuid = kCustomUuid;
+    custom.properties = GattCharacteristic::kRead | GattCharacteristic::kWrite;
+    custom.value = vector<uint8_t>(40, 0xAB);
+
+    GattService service;
+    service.uuid = kBatteryServiceUuid;
+    service.characteristics = {battery_level, custom};
+    device_->AddService(service);
+    device_->Connect();
+  }
+  ~VirtualDeviceTest() {}
+
+ protected:
+  // Wraps |pdu| in an L2CAP frame on |cid| and a single ACL data packet.
+  static vector<uint8_t> AclPacket(uint16_t cid, const vector<uint8_t>& pdu) {
+    vector<uint8_t> packet = {
+        kLinkHandle & 0xff, 0x20 | (kLinkHandle >> 8),
+        static_cast<uint8_t>((pdu.size() + 4) & 0xff),
+        static_cast<uint8_t>((pdu.size() + 4) >> 8),
+        static_cast<uint8_t>(pdu.size() & 0xff),
+        static_cast<uint8_t>(pdu.size() >> 8),
+        static_cast<uint8_t>(cid & 0xff),
+        static_cast<uint8_t>(cid >> 8)};
+    packet.insert(packet.end(), pdu.begin(), pdu.end());
+    return packet;
+  }
+
+  std::chrono::steady_clock::time_point start_ =
+      std::chrono::steady_clock::now();
+  std::unique_ptr<VirtualDevice> device_;
+};
+
+TEST_F(VirtualDeviceTest, AdvertisingEvents) {
+  device_->SetAdvertising(std::chrono::milliseconds(100), {0x02, 0x01, 0x06},
+                          {}, true);
+  EXPECT_TRUE(device_->IsAdvertising());
+
+  // The first call starts the count.
+  EXPECT_EQ(0u, device_->TakeAdvertisingEvents(start_));
+  EXPECT_EQ(0u, device_->TakeAdvertisingEvents(
+                    start_ + std::chrono::milliseconds(50)));
+  EXPECT_EQ(3u, device_->TakeAdvertisingEvents(
+                    start_ + std::chrono::milliseconds(350)));
+  // The remainder of the interval is carried over.
+  EXPECT_EQ(1u, device_->TakeAdvertisingEvents(
+                    start_ + std::chrono::milliseconds(400)));
+
+  device_->ResetAdvertisingEvents();
+  EXPECT_EQ(0u, device_->TakeAdvertisingEvents(
+                    start_ + std::chrono::milliseconds(1000)));
+
+  device_->SetAdvertising(std::chrono::milliseconds(0), {}, {}, false);
+  EXPECT_FALSE(device_->IsAdvertising());
+  EXPECT_EQ(0u, device_->TakeAdvertisingEvents(
+                    start_ + std::chrono::milliseconds(2000)));
+}
+
+TEST_F(VirtualDeviceTest, ExchangeMtu) {
+  EXPECT_EQ(vector<uint8_t>({0x03, 0xF7, 0x00}),
+            device_->HandleAttPdu({0x02, 0x00, 0x02}));
+  EXPECT_EQ(247, device_->GetAttMtu());
+
+  device_->Disconnect();
+  EXPECT_EQ(23, device_->GetAttMtu());
+}
+
+TEST_F(VirtualDeviceTest, DiscoverServices) {
+  // Read By Group Type of the primary services.
+  EXPECT_EQ(vector<uint8_t>({0x11, 0x06, 0x01, 0x00, 0x06, 0x00, 0x0F, 0x18}),
+            device_->HandleAttPdu({0x10, 0x01, 0x00, 0xFF, 0xFF, 0x00, 0x28}));
+  EXPECT_EQ(vector<uint8_t>({0x01, 0x10, 0x07, 0x00, 0x0A}),
+            device_->HandleAttPdu({0x10, 0x07, 0x00, 0xFF, 0xFF, 0x00, 0x28}));
+
+  // Find By Type Value of the Battery Service.
+  EXPECT_EQ(vector<uint8_t>({0x07, 0x01, 0x00, 0x06, 0x00}),
+            device_->HandleAttPdu(
+                {0x06, 0x01, 0x00, 0xFF, 0xFF, 0x00, 0x28, 0x0F, 0x18}));
+}
+
+TEST_F(VirtualDeviceTest, DiscoverCharacteristics) {
+  // The entries of a response have the same length, so the characteristic
+  // with a 128-bit UUID comes in a second response.
+  EXPECT_EQ(vector<uint8_t>({0x09, 0x07, 0x02, 0x00, 0x12, 0x03, 0x00, 0x19,
+                             0x2A}),
+            device_->HandleAttPdu({0x08, 0x01, 0x00, 0x06, 0x00, 0x03, 0x28}));
+
+  vector<uint8_t> response =
+      device_->HandleAttPdu({0x08, 0x03, 0x00, 0x06, 0x00, 0x03, 0x28});
+  ASSERT_EQ(23u, response.size());
+  EXPECT_EQ(21, response[1]);
+  EXPECT_EQ(0x05, response[2]);
+  EXPECT_EQ(kCustomHandle, response[5]);
+  EXPECT_EQ(kCustomUuid, vector<uint8_t>(response.begin() + 7, response.end()));
+
+  // Find Information of the descriptors of the Battery Level.
+  EXPECT_EQ(vector<uint8_t>({0x05, 0x01, 0x04, 0x00, 0x02, 0x29}),
+            device_->HandleAttPdu({0x04, 0x04, 0x00, 0x04, 0x00}));
+}
+
+TEST_F(VirtualDeviceTest, ReadAndWrite) {
+  EXPECT_EQ(vector<uint8_t>({0x0B, 0x64}),
+            device_->HandleAttPdu({0x0A, kBatteryLevelHandle, 0x00}));
+
+  // Long values are read in MTU - 1 octets.
+  vector<uint8_t> response = device_->HandleAttPdu({0x0A, kCustomHandle, 0x00});
+  EXPECT_EQ(vector<uint8_t>(22, 0xAB),
+            vector<uint8_t>(response.begin() + 1, response.end()));
+  response = device_->HandleAttPdu({0x0C, kCustomHandle, 0x00, 22, 0x00});
+  EXPECT_EQ(0x0D, response[0]);
+  EXPECT_EQ(vector<uint8_t>(18, 0xAB),
+            vector<uint8_t>(response.begin() + 1, response.end()));
+
+  EXPECT_EQ(vector<uint8_t>({0x13}),
+            device_->HandleAttPdu({0x12, kCustomHandle, 0x00, 0x01, 0x02}));
+  EXPECT_EQ(vector<uint8_t>({0x0B, 0x01, 0x02}),
+            device_->HandleAttPdu({0x0A, kCustomHandle, 0x00}));
+
+  EXPECT_EQ(vector<uint8_t>({0x01, 0x12, kBatteryLevelHandle, 0x00, 0x03}),
+            device_->HandleAttPdu({0x12, kBatteryLevelHandle, 0x00, 0x00}));
+  EXPECT_EQ(vector<uint8_t>({0x01, 0x0A, 0x20, 0x00, 0x01}),
+            device_->HandleAttPdu({0x0A, 0x20, 0x00}));
+
+  // Commands have no response, even when they fail.
+  EXPECT_TRUE(device_->HandleAttPdu({0x52, 0x20, 0x00, 0x01}).empty());
+}
+
+TEST_F(VirtualDeviceTest, Notifications) {
+  vector<vector<uint8_t>> pdus;
+  device_->TakeNotifications(start_, &pdus);
+  EXPECT_TRUE(pdus.empty());
+
+  EXPECT_EQ(vector<uint8_t>({0x13}),
+            device_->HandleAttPdu(
+                {0x12, kBatteryLevelCccdHandle, 0x00, 0x01, 0x00}));
+
+  // The first notification is sent right away, then one every period.
+  device_->TakeNotifications(start_, &pdus);
+  ASSERT_EQ(1u, pdus.size());
+  EXPECT_EQ(vector<uint8_t>({0x1B, kBatteryLevelHandle, 0x00, 0x64}), pdus[0]);
+  device_->TakeNotifications(start_ + std::chrono::milliseconds(250), &pdus);
+  EXPECT_EQ(3u, pdus.size());
+
+  device_->Disconnect();
+  device_->Connect();
+  pdus.clear();
+  device_->TakeNotifications(start_ + std::chrono::milliseconds(500), &pdus);
+  EXPECT_TRUE(pdus.empty());
+  EXPECT_EQ(vector<uint8_t>({0x0B, 0x00, 0x00}),
+            device_->HandleAttPdu({0x0A, kBatteryLevelCccdHandle, 0x00}));
+}
+
+TEST_F(VirtualDeviceTest, LinkRoutesAtt) {
+  LeLink link(kLinkHandle, device_.get(), kLeDataPacketLength, start_);
+  vector<vector<uint8_t>> to_host;
+
+  link.ReceiveFromHost(AclPacket(LeLink::kAttCid, {0x02, 0xF7, 0x00}));
+  link.ReceiveFromHost(AclPacket(LeLink::kAttCid, {0x0A, kCustomHandle, 0x00}));
+  EXPECT_EQ(2u, link.Service(start_, &to_host));
+
+  // The 45-octet frame of the read response is fragmented into two ACL data
+  // packets.
+  ASSERT_EQ(3u, to_host.size());
+  EXPECT_EQ(vector<uint8_t>({kLinkHandle & 0xff, 0x20 | (kLinkHandle >> 8),
+                             0x07, 0x00, 0x03, 0x00, 0x04, 0x00, 0x03, 0xF7,
+                             0x00}),
+            to_host[0]);
+  EXPECT_EQ(0x20, to_host[1][1] & 0x30);
+  EXPECT_EQ(kLeDataPacketLength, to_host[1][2]);
+  EXPECT_EQ(0x10, to_host[2][1] & 0x30);
+  EXPECT_EQ(45 - kLeDataPacketLength, to_host[2][2]);
+  EXPECT_EQ(7u + 45, link.GetBytesToHost());
+
+  // Other channels are sinks.
+  link.ReceiveFromHost(AclPacket(0x0040, vector<uint8_t>(10, 0x55)));
+  to_host.clear();
+  EXPECT_EQ(1u, link.Service(start_, &to_host));
+  EXPECT_TRUE(to_host.empty());
+  EXPECT_EQ(10u, device_->GetSinkBytes());
+}
+
+TEST_F(VirtualDeviceTest, LinkReassembles) {
+  LeLink link(kLinkHandle, device_.get(), kLeDataPacketLength, start_);
+  vector<vector<uint8_t>> to_host;
+
+  vector<uint8_t> packet = AclPacket(0x0040, vector<uint8_t>(30, 0x55));
+  vector<uint8_t> first(packet.begin(), packet.begin() + 4 + 20);
+  first[2] = 20;
+  vector<uint8_t> second = {kLinkHandle & 0xff, 0x10 | (kLinkHandle >> 8),
+                            14, 0x00};
+  second.insert(second.end(), packet.begin() + 4 + 20, packet.end());
+
+  link.ReceiveFromHost(first);
+  EXPECT_EQ(1u, link.Service(start_, &to_host));
+  EXPECT_EQ(0u, device_->GetSinkBytes());
+  link.ReceiveFromHost(second);
+  EXPECT_EQ(1u, link.Service(start_, &to_host));
+  EXPECT_EQ(30u, device_->GetSinkBytes());
+}
+
+TEST_F(VirtualDeviceTest, LinkThrottles) {
+  device_->SetLinkBytesPerSecond(10000);
+  LeLink link(kLinkHandle, device_.get(), kLeDataPacketLength, start_);
+  vector<vector<uint8_t>> to_host;
+
+  // The budget starts at 2048 bytes, and refills at 10 bytes per millisecond.
+  for (int i = 0; i < 100; i++)
+    link.ReceiveFromHost(AclPacket(0x0040, vector<uint8_t>(96, 0x55)));
+  EXPECT_EQ(20u, link.Service(start_, &to_host));
+  EXPECT_EQ(0u, link.Service(start_, &to_host));
+  EXPECT_EQ(1u, link.Service(start_ + std::chrono::milliseconds(10), &to_host));
+  EXPECT_EQ(20u,
+            link.Service(start_ + std::chrono::milliseconds(210), &to_host));
+  EXPECT_EQ(41u * 100, link.GetBytesFromHost());
+}
+
+TEST_F(VirtualDeviceTest, LinkAcceptsCreditBasedConnections) {
+  LeLink link(kLinkHandle, device_.get(), kLeDataPacketLength, start_);
+  vector<vector<uint8_t>> to_host;
+
+  // LE Credit Based Connection Request on PSM 0x0080 from CID 0x0041.
+  link.ReceiveFromHost(
+      AclPacket(LeLink::kLeSignalingCid, {0x14, 0x01, 0x0A, 0x00, 0x80, 0x00,
+                                          0x41, 0x00, 0xF7, 0x00, 0x17, 0x00,
+                                          0x0A, 0x00}));
+  EXPECT_EQ(1u, link.Service(start_, &to_host));
+  ASSERT_EQ(1u, to_host.size());
+  EXPECT_EQ(vector<uint8_t>({0x15, 0x01, 0x0A, 0x00, 0x40, 0x00, 0x00, 0x02,
+                             0xF7, 0x00, LeLink::kCocCredits, 0x00, 0x00,
+                             0x00}),
+            vector<uint8_t>(to_host[0].begin() + 8, to_host[0].end()));
+
+  // The credits are granted back in batches.
+  to_host.clear();
+  for (int i = 0; i < LeLink::kCocCreditBatch; i++)
+    link.ReceiveFromHost(AclPacket(0x0040, vector<uint8_t>(10, 0x55)));
+  EXPECT_EQ(static_cast<size_t>(LeLink::kCocCreditBatch),
+            link.Service(start_, &to_host));
+  EXPECT_EQ(10u * LeLink::kCocCreditBatch, device_->GetSinkBytes());
+  ASSERT_EQ(1u, to_host.size());
+  EXPECT_EQ(vector<uint8_t>({0x16, 0x01, 0x04, 0x00, 0x40, 0x00,
+                             LeLink::kCocCreditBatch, 0x00}),
+            vector<uint8_t>(to_host[0].begin() + 8, to_host[0].end()));
+
+  // Disconnection Request, then an unknown command.
+  to_host.clear();
+  link.ReceiveFromHost(AclPacket(
+      LeLink::kLeSignalingCid,
+      {0x06, 0x02, 0x04, 0x00, 0x40, 0x00, 0x41, 0x00}));
+  link.ReceiveFromHost(
+      AclPacket(LeLink::kLeSignalingCid, {0x0A, 0x03, 0x02, 0x00, 0x02, 0x00}));
+  EXPECT_EQ(2u, link.Service(start_, &to_host));
+  ASSERT_EQ(2u, to_host.size());
+  EXPECT_EQ(vector<uint8_t>({0x07, 0x02, 0x04, 0x00, 0x40, 0x00, 0x41, 0x00}),
+            vector<uint8_t>(to_host[0].begin() + 8, to_host[0].end()));
+  EXPECT_EQ(vector<uint8_t>({0x01, 0x03, 0x02, 0x00, 0x00, 0x00}),
+            vector<uint8_t>(to_host[1].begin() + 8, to_host[1].end()));
+}
+
+}  // namespace test_vendor_lib